@@ -135,6 +135,11 @@ class _GStat(gobject.GObject):
         self.old['tool-in-spindle'] = self.stat.tool_in_spindle
         self.old['motion-mode'] = self.stat.motion_mode
 
+    # the fields stat.changed() reports that a signal depends on
+    WATCHED = set(['task_state', 'task_mode', 'interp_state', 'call_level',
+                   'file', 'motion_line', 'motion_mode', 'tool_in_spindle',
+                   'homed'])
+
     def update(self):
         try:
             self.stat.poll()
@@ -142,6 +147,13 @@ class _GStat(gobject.GObject):
             # Reschedule
             return True
         old = dict(self.old)
+        # the first time round everything is new
+        if old:
+            changed = self.WATCHED.intersection(self.stat.changed())
+            if not changed:
+                return True
+        else:
+            changed = set(self.WATCHED)
         self.merge()
 
         state_old = old.get('state', 0)
@@ -161,22 +173,24 @@ class _GStat(gobject.GObject):
             if state_new == linuxcnc.STATE_ON:
                 old['mode'] = 0
                 old['interp'] = 0
+                changed.update(['task_mode', 'interp_state'])
 
         mode_old = old.get('mode', 0)
         mode_new = self.old['mode']
-        if mode_new != mode_old:
+        if 'task_mode' in changed and mode_new != mode_old:
             self.emit(self.MODES[mode_new])
 
         interp_old = old.get('interp', 0)
         interp_new = self.old['interp']
-        if interp_new != interp_old:
+        if 'interp_state' in changed and interp_new != interp_old:
             if not interp_old or interp_old == linuxcnc.INTERP_IDLE:
                 self.emit('interp-run')
             self.emit(self.INTERP[interp_new])
 
         file_old = old.get('file', None)
         file_new = self.old['file']
-        if file_new != file_old:
+        # the file is only taken in at call level 0
+        if changed & set(['file', 'call_level']) and file_new != file_old:
             # if interpreter is reading or waiting, the new file
             # is a remap procedure, with the following test we
             # partly avoid emitting a signal in that case, which would cause 
@@ -196,17 +210,17 @@ class _GStat(gobject.GObject):
         # Moses McKnight
         line_old = old.get('line', None)
         line_new = self.old['line']
-        if line_new != line_old:
+        if 'motion_line' in changed and line_new != line_old:
             self.emit('line-changed', line_new)
 
         tool_old = old.get('tool-in-spindle', None)
         tool_new = self.old['tool-in-spindle']
-        if tool_new != tool_old:
+        if 'tool_in_spindle' in changed and tool_new != tool_old:
             self.emit('tool-in-spindle-changed', tool_new)
 
         motion_mode_old = old.get('motion-mode', None)
         motion_mode_new = self.old['motion-mode']
-        if motion_mode_new != motion_mode_old:
+        if 'motion_mode' in changed and motion_mode_new != motion_mode_old:
             self.emit('motion-mode-changed', motion_mode_new)
 
         # if the homed status has changed
@@ -216,7 +230,7 @@ class _GStat(gobject.GObject):
         # if a joint is homed send 'homed' (with a string of homed joint number)
         homed_joint_old = old.get('homed', None)
         homed_joint_new = self.old['homed']
-        if homed_joint_new != homed_joint_old:
+        if 'homed' in changed and homed_joint_new != homed_joint_old:
             homed_joints = 0
             unhomed_joints = ""
             for joint in range(0, self.stat.joints):
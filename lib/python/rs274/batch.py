@@ -0,0 +1,129 @@
+#    This is a component of AXIS, a front-end for emc
+#
+#    This program is free software; you can redistribute it and/or modify
+#    it under the terms of the GNU General Public License as published by
+#    the Free Software Foundation; either version 2 of the License, or
+#    (at your option) any later version.
+#
+#    This program is distributed in the hope that it will be useful,
+#    but WITHOUT ANY WARRANTY; without even the implied warranty of
+#    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#    GNU General Public License for more details.
+#
+#    You should have received a copy of the GNU General Public License
+#    along with this program; if not, write to the Free Software
+#    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+# Check many programs at once.  The interpreter keeps global state, so
+# one process parses one program at a time; check_files() spreads the
+# programs over a pool of processes, one per CPU by default.
+#
+#    for r in check_files(glob.glob("*.ngc")):
+#        print r.filename, r.result, r.lineno, r.max_extents
+
+import gcode, multiprocessing, sys
+
+class CheckCanon:
+    parameter_file = ""
+
+    def __init__(self, tools=(), axis_mask=7, linear_units=1.0,
+            angular_units=1.0, block_delete=0):
+        self.native_geometry = gcode.geometry()
+        self.tools = list(tools)
+        self.axis_mask = axis_mask
+        self.linear_units = linear_units
+        self.angular_units = angular_units
+        self.block_delete = block_delete
+        self.suppress = 0
+        self.lo = (0,) * 9
+        self.dwell_time = 0
+        self.messages = []
+
+    def next_line(self, st): pass
+    def set_g5x_offset(self, *args): pass
+    def set_g92_offset(self, *args): pass
+    def set_xy_rotation(self, theta): pass
+    def set_plane(self, plane): pass
+    def set_traverse_rate(self, rate): pass
+    def set_feed_rate(self, rate): pass
+    def change_tool(self, pocket): pass
+    def tool_offset(self, *args): pass
+    def user_defined_function(self, i, p, q): pass
+    def dwell(self, arg): self.dwell_time += arg
+    def message(self, msg): self.messages.append(msg)
+    def comment(self, arg):
+        if arg == "AXIS,hide": self.suppress += 1
+        if arg == "AXIS,show": self.suppress -= 1
+    def check_abort(self): return False
+
+    def get_tool(self, pocket):
+        if pocket >= 0 and pocket < len(self.tools):
+            return tuple(self.tools[pocket])
+        return -1, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0
+    def get_external_angular_units(self): return self.angular_units
+    def get_external_length_units(self): return self.linear_units
+    def get_axis_mask(self): return self.axis_mask
+    def get_block_delete(self): return self.block_delete
+
+class CheckResult:
+    def __init__(self, filename, result, lineno, error, canon):
+        self.filename = filename
+        self.result = result
+        self.lineno = lineno
+        self.error = error
+        self.messages = []
+        self.dwell_time = 0
+        self.segments = 0
+        self.min_extents = self.max_extents = None
+        self.min_extents_notool = self.max_extents_notool = None
+        if canon is not None:
+            g = canon.native_geometry
+            self.messages = canon.messages
+            self.dwell_time = canon.dwell_time
+            self.segments = sum(g.count(k)
+                for k in (gcode.TRAVERSE, gcode.FEED, gcode.ARCFEED))
+            (self.min_extents, self.max_extents,
+                self.min_extents_notool, self.max_extents_notool) = g.extents()
+
+    def ok(self):
+        return self.error is None and self.result <= gcode.MIN_ERROR
+
+def check_file(filename, unitcode="", initcode="", **kw):
+    canon = CheckCanon(**kw)
+    try:
+        result, lineno = gcode.parse(filename, canon, unitcode, initcode)
+    except Exception, detail:
+        return CheckResult(filename, -1, 0, str(detail), None)
+    error = None
+    if result > gcode.MIN_ERROR:
+        error = gcode.strerror(result)
+    return CheckResult(filename, result, lineno, error, canon)
+
+def _check_one(args):
+    filename, unitcode, initcode, kw = args
+    return check_file(filename, unitcode, initcode, **kw)
+
+def check_files(filenames, unitcode="", initcode="", processes=None, **kw):
+    """Parse each file in its own worker process and return a CheckResult
+    for each, in the order of filenames"""
+    work = [(f, unitcode, initcode, kw) for f in filenames]
+    if processes == 1 or len(work) < 2:
+        return map(_check_one, work)
+    pool = multiprocessing.Pool(processes)
+    try:
+        return pool.map(_check_one, work, chunksize=1)
+    finally:
+        pool.close()
+        pool.join()
+
+if __name__ == '__main__':
+    failed = 0
+    for r in check_files(sys.argv[1:]):
+        if r.ok():
+            print "%s: ok, %d segments" % (r.filename, r.segments)
+        else:
+            failed += 1
+            print "%s:%d: %s" % (r.filename, r.lineno, r.error)
+    sys.exit(failed != 0)
+
+# vim:ts=8:sts=4:et:
@@ -77,6 +77,12 @@ limiticon = array.array('B',
 
 class GLCanon(Translated, ArcsToSegmentsMixin):
     lineno = -1
+    # a gcode.geometry here makes gcode.parse() collect the moves natively
+    # instead of in traverse, feed and arcfeed
+    native_geometry = None
+    # points closer than this to the last one drawn are left out of the
+    # line strips; set by GlCanonDraw while it builds a coarse display list
+    lod_tolerance = 0
     def __init__(self, colors, geometry, is_foam=0):
         # traverse list - [line number, [start position], [end position], [tlo x, tlo y, tlo z]]
         self.traverse = []; self.traverse_append = self.traverse.append
@@ -159,12 +165,71 @@ class GLCanon(Translated, ArcsToSegmentsMixin):
 
     def check_abort(self): pass
 
+    # Support for gcode.reparse().  A checkpoint is (position, state):
+    # position locates the output made so far, state is everything that
+    # decides what later moves look like and must compare equal when two
+    # parses have converged.
+    _checkpoint_attrs = ('xo', 'yo', 'zo', 'ao', 'bo', 'co', 'uo', 'vo', 'wo',
+        'feedrate', 'first_move', 'suppress', 'plane', 'foam_z', 'foam_w',
+        'g5x_index', 'g5x_offset_x', 'g5x_offset_y', 'g5x_offset_z',
+        'g5x_offset_a', 'g5x_offset_b', 'g5x_offset_c',
+        'g5x_offset_u', 'g5x_offset_v', 'g5x_offset_w',
+        'g92_offset_x', 'g92_offset_y', 'g92_offset_z',
+        'g92_offset_a', 'g92_offset_b', 'g92_offset_c',
+        'g92_offset_u', 'g92_offset_v', 'g92_offset_w', 'rotation_xy')
+
+    def checkpoint(self):
+        position = (len(self.traverse), len(self.feed), len(self.arcfeed),
+                len(self.dwells), self.dwell_time)
+        state = (tuple(self.lo),) + tuple(
+                getattr(self, a, None) for a in self._checkpoint_attrs)
+        return position, state
+
+    def _restore_state(self, state):
+        self.lo = state[0]
+        for a, v in zip(self._checkpoint_attrs, state[1:]):
+            setattr(self, a, v)
+        self.set_xy_rotation(self.rotation_xy)
+
+    def rewind(self, checkpoint):
+        (nt, nf, na, nd, dwell_time), state = checkpoint
+        # keep the old output until we know whether it can be reused
+        self._rewound = ((self.traverse[:], self.feed[:], self.arcfeed[:],
+                self.dwells[:]), self.checkpoint())
+        del self.traverse[nt:]
+        del self.feed[nf:]
+        del self.arcfeed[na:]
+        del self.dwells[nd:]
+        self.dwell_time = dwell_time
+        self._restore_state(state)
+
+    def converge(self, old, new, line_delta):
+        lists, final = self._rewound
+        del self._rewound
+        (ot, of, oa, od, odwell), state = old
+        # everything the old parse produced from the matching checkpoint on
+        # is still valid, just on lines moved by line_delta
+        def moved(items):
+            return [(item[0] + line_delta,) + tuple(item[1:]) for item in items]
+        self.traverse.extend(moved(lists[0][ot:]))
+        self.feed.extend(moved(lists[1][of:]))
+        self.arcfeed.extend(moved(lists[2][oa:]))
+        self.dwells.extend(moved(lists[3][od:]))
+        (ft, ff, fa, fd, fdwell), fstate = final
+        self.dwell_time += fdwell - odwell
+        self._restore_state(fstate)
+
+    def relocate_checkpoint(self, checkpoint, old, new):
+        position, state = checkpoint
+        return tuple(p - o + n for p, o, n in zip(position, old[0], new[0])), state
+
     def next_line(self, st):
         self.state = st
         self.lineno = self.state.sequence_number
 
     def draw_lines(self, lines, for_selection, j=0, geometry=None):
-        return linuxcnc.draw_lines(geometry or self.geometry, lines, for_selection)
+        return linuxcnc.draw_lines(geometry or self.geometry, lines,
+            for_selection, 0 if for_selection else self.lod_tolerance)
 
     def colored_lines(self, color, lines, for_selection, j=0):
         if self.is_foam:
@@ -189,7 +254,10 @@ class GLCanon(Translated, ArcsToSegmentsMixin):
         return linuxcnc.draw_dwells(self.geometry, dwells, alpha, for_selection, self.is_lathe())
 
     def calc_extents(self):
-        self.min_extents, self.max_extents, self.min_extents_notool, self.max_extents_notool = gcode.calc_extents(self.arcfeed, self.feed, self.traverse)
+        if self.native_geometry is not None:
+            self.min_extents, self.max_extents, self.min_extents_notool, self.max_extents_notool = self.native_geometry.extents()
+        else:
+            self.min_extents, self.max_extents, self.min_extents_notool, self.max_extents_notool = gcode.calc_extents(self.arcfeed, self.feed, self.traverse)
         if self.is_foam:
             min_z = min(self.foam_z, self.foam_w)
             max_z = max(self.foam_z, self.foam_w)
@@ -410,11 +478,27 @@ class GlCanonDraw:
         'axis_y': (1.00, 0.20, 0.20),
         'grid': (0.15, 0.15, 0.15),
     }
+    # Programs of at least lod_segments segments are drawn in less detail
+    # as the view zooms out: points closer than lod_pixels pixels are
+    # merged.  The display lists are built per power of two of that
+    # distance, and the lod_cache most recently used are kept.
+    lod_segments = 200000
+    lod_pixels = 1.0
+    lod_cache = 3
+    # Programs of at least buffer_segments segments are drawn from vertex
+    # buffers instead, one per kind of move, uploaded once, when the GL
+    # has them (1.5 and later); they are always drawn in full detail.
+    # 0 leaves them off.
+    buffer_segments = 50000
     def __init__(self, s, lp, g=None):
         self.stat = s
         self.lp = lp
         self.canon = g
         self._dlists = {}
+        self._lod_levels = []
+        self._buffers = {}
+        self._have_buffers = None
+        self.pixel_size = 0
         self.select_buffer_size = 100
         self.cached_tool = -1
         self.initialised = 0
@@ -571,6 +655,7 @@ class GlCanonDraw:
         glMatrixMode(GL_PROJECTION)
         glLoadIdentity()
         gluPerspective(self.fovy, float(w)/float(h), self.near, self.far + self.distance)
+        self.pixel_size = 2 * self.distance * math.tan(math.radians(self.fovy) / 2) / h
 
         gluLookAt(0, 0, self.distance,
             0, 0, 0,
@@ -601,6 +686,7 @@ class GlCanonDraw:
         k = (abs(ztran or 1)) ** .55555
         l = k * h / w
         glOrtho(-k, k, -l, l, -1000, 1000.)
+        self.pixel_size = 2. * k / w
 
         gluLookAt(0, 0, 1,
             0, 0, 0,
@@ -1075,9 +1161,15 @@ class GlCanonDraw:
                 glEnable(GL_BLEND)
                 glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA)
 
-            if self.get_show_rapids():
-                glCallList(self.dlist('program_rapids', gen=self.make_main_list))
-            glCallList(self.dlist('program_norapids', gen=self.make_main_list))
+            if self.use_buffers():
+                if self.get_show_rapids():
+                    self.draw_buffers('program_rapids')
+                self.draw_buffers('program_norapids')
+            else:
+                level = self.lod_level()
+                if self.get_show_rapids():
+                    glCallList(self.program_list('program_rapids', level))
+                glCallList(self.program_list('program_norapids', level))
             glCallList(self.dlist('highlight'))
 
             if self.get_program_alpha():
@@ -1783,28 +1875,156 @@ class GlCanonDraw:
         if self.canon: self.canon.draw(1, True)
         glEndList()
 
-    def make_main_list(self, unused=None):
-        program = self.dlist('program_norapids')
-        rapids = self.dlist('program_rapids')
-        glNewList(program, GL_COMPILE)
-        if self.canon: self.canon.draw(0, True)
+    def lod_level(self):
+        c = self.canon
+        if c is None or self.lod_pixels <= 0 or self.pixel_size <= 0:
+            return None
+        if len(c.traverse) + len(c.feed) + len(c.arcfeed) < self.lod_segments:
+            return None
+        return int(math.floor(math.log(self.pixel_size * self.lod_pixels, 2)))
+
+    def program_list(self, name, level):
+        if level is None:
+            return self.dlist(name, gen=self.make_main_list)
+        if level in self._lod_levels: self._lod_levels.remove(level)
+        self._lod_levels.append(level)
+        while len(self._lod_levels) > self.lod_cache:
+            old = self._lod_levels.pop(0)
+            self.stale_dlist(('program_rapids', old))
+            self.stale_dlist(('program_norapids', old))
+        return self.dlist((name, level),
+            gen=lambda n: self.make_main_list(level=level))
+
+    def stale_program_lists(self):
+        for name in self._dlists.keys():
+            if isinstance(name, tuple): kind = name[0]
+            else: kind = name
+            if kind in ('program_rapids', 'program_norapids',
+                    'program_dwells', 'select_rapids', 'select_norapids'):
+                self.stale_dlist(name)
+        self._lod_levels = []
+        for parts in self._buffers.values():
+            for color, buf, count, stipple in parts:
+                glDeleteBuffers(buf)
+        self._buffers = {}
+
+    def use_buffers(self):
+        c = self.canon
+        if self.buffer_segments <= 0 or not isinstance(c, GLCanon) or c.is_foam:
+            return False
+        if len(c.traverse) + len(c.feed) + len(c.arcfeed) < self.buffer_segments:
+            return False
+        if self._have_buffers is None:
+            try:
+                version = glGetString(GL_VERSION).split()[0].split('.')
+                self._have_buffers = (int(version[0]), int(version[1])) >= (1, 5)
+            except (AttributeError, IndexError, ValueError):
+                self._have_buffers = False
+        return self._have_buffers
+
+    def make_buffers(self, name):
+        c = self.canon
+        if name == 'program_rapids':
+            kinds = [('traverse', c.traverse, True)]
+        else:
+            kinds = [('straight_feed', c.feed, False),
+                ('arc_feed', c.arcfeed, False)]
+        parts = []
+        for color, lines, stipple in kinds:
+            vertices = linuxcnc.line_vertices(c.geometry, lines)
+            buf = glGenBuffers()
+            glBindBuffer(GL_ARRAY_BUFFER, buf)
+            glBufferData(GL_ARRAY_BUFFER, vertices, GL_STATIC_DRAW)
+            parts.append((color, buf, len(vertices) / 12, stipple))
+        glBindBuffer(GL_ARRAY_BUFFER, 0)
+        self._buffers[name] = parts
+        return parts
+
+    def make_dwells_list(self, n):
+        glNewList(n, GL_COMPILE)
+        glLineWidth(2)
+        self.canon.draw_dwells(self.canon.dwells,
+            self.canon.colors.get('dwell_alpha', 1/3.), 0)
+        glLineWidth(1)
         glEndList()
 
-        glNewList(rapids, GL_COMPILE)
-        if self.canon: self.canon.draw(0, False)
-        glEndList()
+    # one glDrawArrays per kind of move; the dwells stay in a display list
+    def draw_buffers(self, name):
+        c = self.canon
+        parts = self._buffers.get(name) or self.make_buffers(name)
+        glEnableClientState(GL_VERTEX_ARRAY)
+        for color, buf, count, stipple in parts:
+            if stipple: glEnable(GL_LINE_STIPPLE)
+            c.color_with_alpha(color)
+            glBindBuffer(GL_ARRAY_BUFFER, buf)
+            glVertexPointer(3, GL_FLOAT, 0, 0)
+            glDrawArrays(GL_LINES, 0, count)
+            if stipple: glDisable(GL_LINE_STIPPLE)
+        glBindBuffer(GL_ARRAY_BUFFER, 0)
+        glDisableClientState(GL_VERTEX_ARRAY)
+        if name == 'program_norapids':
+            glCallList(self.dlist('program_dwells', gen=self.make_dwells_list))
+
+    def make_main_list(self, unused=None, level=None):
+        if level is None:
+            program = self.dlist('program_norapids')
+            rapids = self.dlist('program_rapids')
+        else:
+            program = self.dlist(('program_norapids', level))
+            rapids = self.dlist(('program_rapids', level))
+        if self.canon and level is not None:
+            self.canon.lod_tolerance = 2. ** level
+        try:
+            glNewList(program, GL_COMPILE)
+            if self.canon: self.canon.draw(0, True)
+            glEndList()
+
+            glNewList(rapids, GL_COMPILE)
+            if self.canon: self.canon.draw(0, False)
+            glEndList()
+        finally:
+            if self.canon: self.canon.lod_tolerance = 0
 
     def load_preview(self, f, canon, unitcode, initcode, interpname=""):
         self.set_canon(canon)
         result, seq = gcode.parse(f, canon, unitcode, initcode, interpname)
+        return self._finish_preview(canon, result, seq)
+
+    def reload_preview(self, f, canon, first_line, last_line, line_delta,
+            unitcode, initcode, interpname=""):
+        """Reload after lines first_line..last_line of f were edited.
+
+        canon must be the canon used for the previous load; parsing resumes
+        from the last checkpoint before the edit (see
+        gcode.set_checkpoint_interval) and stops as soon as the result
+        matches the previous load again."""
+        self.set_canon(canon)
+        result, seq = gcode.reparse(f, canon, first_line, last_line,
+                line_delta, unitcode, initcode, interpname)
+        return self._finish_preview(canon, result, seq)
+
+    def load_preview_lines(self, f, canon, first_line, last_line,
+            unitcode, initcode, interpname=""):
+        """Show only the moves of lines first_line..last_line of f.
+
+        canon must be the canon f was last loaded with, by load_preview
+        with checkpoints on (see gcode.set_checkpoint_interval), usually
+        into a native_geometry that kept no moves and only found the
+        extents; those of the whole program are left as they are."""
+        self.set_canon(canon)
+        canon.native_geometry = None
+        for moves in canon.traverse, canon.feed, canon.arcfeed, canon.dwells:
+            del moves[:]
+        result, seq = gcode.parse_lines(f, canon, first_line, last_line,
+                unitcode, initcode, interpname)
+        self.stale_program_lists()
+        return result, seq
 
+    def _finish_preview(self, canon, result, seq):
         if result <= gcode.MIN_ERROR:
             self.canon.progress.nextphase(1)
             canon.calc_extents()
-            self.stale_dlist('program_rapids')
-            self.stale_dlist('program_norapids')
-            self.stale_dlist('select_rapids')
-            self.stale_dlist('select_norapids')
+            self.stale_program_lists()
 
         return result, seq
 
@@ -0,0 +1,50 @@
+#    This is a component of AXIS, a front-end for emc
+#
+#    This program is free software; you can redistribute it and/or modify
+#    it under the terms of the GNU General Public License as published by
+#    the Free Software Foundation; either version 2 of the License, or
+#    (at your option) any later version.
+#
+#    This program is distributed in the hope that it will be useful,
+#    but WITHOUT ANY WARRANTY; without even the implied warranty of
+#    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#    GNU General Public License for more details.
+#
+#    You should have received a copy of the GNU General Public License
+#    along with this program; if not, write to the Free Software
+#    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+# Simulate cutting a block of stock with a program, to check it before it
+# runs.  The moves come from a gcode.geometry, so this works for any GUI
+# or script, e.g. with the tool table of a running machine:
+#
+#    s = linuxcnc.stat(); s.poll()
+#    stock, hits = simulate("part.ngc", (0, 0, -.5), (4, 3, 0), .005,
+#        s.tool_table)
+#    print stock.removed(), hits
+#
+# stock.heights() gives the top of the stock cell by cell for drawing it.
+
+import gcode
+from rs274.batch import CheckCanon
+
+def stock_tools(tool_table, ball=()):
+    """The tools of a tool table by pocket for gcode.stock.cut(); the tool
+    numbers in ball are ball end mills, the rest flat ones"""
+    return [(t[10], t[0] in ball) if t[0] > 0 else None for t in tool_table]
+
+def simulate(filename, minimum, maximum, cell, tool_table, ball=(),
+        unitcode="", initcode="", threads=0, **kw):
+    """Parse filename and cut its moves out of the block of stock from
+    minimum to maximum, both (x, y, z), in cells of side cell.  Returns
+    the gcode.stock and the lines of the traverses that went into the
+    stock; a parse error raises ValueError."""
+    canon = CheckCanon(tools=[tuple(t) for t in tool_table], **kw)
+    result, lineno = gcode.parse(filename, canon, unitcode, initcode)
+    if result > gcode.MIN_ERROR:
+        raise ValueError("%s:%d: %s"
+            % (filename, lineno, gcode.strerror(result)))
+    stock = gcode.stock(minimum, maximum, cell)
+    hits = stock.cut(canon.native_geometry, stock_tools(tool_table, ball),
+        threads)
+    return stock, hits
@@ -19,6 +19,17 @@ from minigl import *
 from math import *
 import glnav
 
+# The values of the pins of each component in the model as of the last
+# PinWatcher.poll(), by id of the component, so a redraw reads them once
+# with a group instead of one call per pin per part
+pin_values = {}
+
+def pin(comp, name):
+    values = pin_values.get(id(comp))
+    if values is not None and name in values:
+	return values[name]
+    return comp[name]
+
 class Collection(object):
     def __init__(self, parts):
 	self.parts = parts
@@ -26,6 +37,9 @@ class Collection(object):
 
     def traverse(self):
 	for p in self.parts:
+	    if getattr(p, "display_list", None):
+		glCallList(p.display_list)
+		continue
 	    if hasattr(p, "apply"):
 		p.apply()
 	    if hasattr(p, "capture"):
@@ -84,7 +98,7 @@ class HalTranslate(Collection):
 
     def apply(self):
 	x, y, z = self.where
-	v = self.comp[self.var]
+	v = pin(self.comp, self.var)
 	
 	glPushMatrix()
 	glTranslatef(x*v, y*v, z*v)
@@ -103,7 +117,7 @@ class HalRotate(Collection):
     def apply(self):
 	th, x, y, z = self.where
 	glPushMatrix()
-	glRotatef(th * self.comp[self.var], x, y, z)
+	glRotatef(th * pin(self.comp, self.var), x, y, z)
 
     def unapply(self):
 	glPopMatrix()
@@ -194,7 +208,7 @@ class CoordsBase(object):
 	return map(self._coord, self._coords)
 
     def _coord(self, v):
-	if isinstance(v, str): return self.comp[v]
+	if isinstance(v, str): return pin(self.comp, v)
 	return v
 
 # give endpoint X values and radii
@@ -761,6 +775,63 @@ class Hud(object):
 		glMatrixMode(GL_MODELVIEW)
 
 
+# Parts that look the same whatever the pins say: vismach's own transforms
+# and colors of such parts, shapes with fixed coordinates, and meshes.
+# Other classes, like the ones a model defines, may read pins in apply()
+# or draw(), so they and the collections holding them are drawn each time.
+def is_static(part):
+    if type(part) in (Collection, Translate, Scale, Rotate, Color):
+	return all(is_static(p) for p in part.parts)
+    if isinstance(part, (AsciiSTL, AsciiOBJ)):
+	return True
+    return (isinstance(part, CoordsBase) and part.comp is None
+	and type(part).__module__ == __name__)
+
+def compile_static(part):
+    """Put each largest static subtree of part in a display list, which
+    Collection.traverse() calls instead of walking the subtree"""
+    for p in getattr(part, "parts", ()):
+	if getattr(p, "display_list", None):
+	    continue
+	if is_static(p):
+	    p.display_list = glGenLists(1)
+	    glNewList(p.display_list, GL_COMPILE)
+	    Collection([p]).traverse()
+	    glEndList()
+	else:
+	    compile_static(p)
+
+def find_comps(part, comps=None):
+    if comps is None: comps = []
+    for v in getattr(part, "__dict__", {}).values():
+	if isinstance(v, hal.component) and v not in comps:
+	    comps.append(v)
+    for p in getattr(part, "parts", ()):
+	find_comps(p, comps)
+    return comps
+
+class PinWatcher(object):
+    """Reads all the pins of the components a model refers to, one group
+    per component, into pin_values"""
+    def __init__(self, model):
+	self.groups = []
+	for comp in find_comps(model):
+	    names = comp.getnames()
+	    if names:
+		self.groups.append((comp, names, comp.group(names)))
+	self.last = {}
+
+    def poll(self):
+	"""Return whether any pin changed since the last poll"""
+	changed = False
+	for comp, names, group in self.groups:
+	    values = group.get()
+	    if values != self.last.get(id(comp)):
+		self.last[id(comp)] = values
+		pin_values[id(comp)] = dict(zip(names, values))
+		changed = True
+	return changed
+
 class O(rs274.OpenGLTk.Opengl):
     def __init__(self, *args, **kw):
         rs274.OpenGLTk.Opengl.__init__(self, *args, **kw)
@@ -772,6 +843,7 @@ class O(rs274.OpenGLTk.Opengl):
 	self.plotlen = 16000
 	#does not show HUD by default
 	self.hud = Hud()
+	self.compiled = False
 
     def basic_lighting(self):
         self.activate()
@@ -796,6 +868,9 @@ class O(rs274.OpenGLTk.Opengl):
 
     def redraw(self, *args):
         if self.winfo_width() == 1: return
+	if not self.compiled:
+	    compile_static(self.model)
+	    self.compiled = True
         self.model.traverse()
 	# current coords: world
 	# the matrices tool2view, work2view, and world2view
@@ -1033,9 +1108,21 @@ def main(model, tool, work, size=10, hud=0, rotation_vectors=None, lat=0, lon=0)
 
     t.pack(fill="both", expand=1)
 
+    # Redraw when a pin changed, looking often while the machine moves and
+    # less and less often while it stands still.  A model without pins
+    # that can be watched is redrawn every 100ms.
+    watcher = PinWatcher(t.model)
+    delay = [50]
     def update():
-	t.tkRedraw()
-	t.after(100, update)
+	if not watcher.groups:
+	    t.tkRedraw()
+	    delay[0] = 100
+	elif watcher.poll():
+	    t.tkRedraw()
+	    delay[0] = 50
+	else:
+	    delay[0] = min(500, delay[0] * 2)
+	t.after(delay[0], update)
     update()
 
     def quit(*args):
@@ -0,0 +1,84 @@
+/********************************************************************
+* Description: canbin.hh
+*   Binary form of a file of canonical calls, written by the stand
+*   alone interpreter (rs274 -c) and run by canterp.
+*
+* License: GPL Version 2
+* System: Linux
+********************************************************************/
+#ifndef CANBIN_HH
+#define CANBIN_HH
+
+#include <stdint.h>
+
+/*
+  A file is a canbin_header, then 'records' canbin_records, then a table
+  of 'string_bytes' bytes of NUL terminated strings that records point
+  into by offset.  Everything is fixed size and in the byte order of the
+  machine that wrote it, so canterp maps the file and runs the records
+  in place.  Only the calls canterp can make are written; the rest,
+  like the offsets a preview uses, are left out.
+*/
+
+#define CANBIN_MAGIC "CANBIN"
+#define CANBIN_VERSION 1
+
+enum canbin_op {
+    CANBIN_STRAIGHT_TRAVERSE = 1,	// d[0..8] x y z a b c u v w
+    CANBIN_STRAIGHT_FEED,		// d[0..8]
+    CANBIN_ARC_FEED,			// d[0..10], i[0] rotation
+    CANBIN_STRAIGHT_PROBE,		// d[0..8], i[0] probe type
+    CANBIN_USE_LENGTH_UNITS,		// i[0] CANON_UNITS
+    CANBIN_SET_FEED_REFERENCE,		// i[0] CANON_FEED_REFERENCE
+    CANBIN_SELECT_PLANE,		// i[0] CANON_PLANE
+    CANBIN_SET_MOTION_CONTROL_MODE,	// i[0] CANON_MOTION_MODE, d[0] tolerance
+    CANBIN_SET_FEED_RATE,		// d[0]
+    CANBIN_SET_SPINDLE_SPEED,		// d[0]
+    CANBIN_START_SPINDLE_CLOCKWISE,	// i[0] wait for at speed
+    CANBIN_START_SPINDLE_COUNTERCLOCKWISE,	// i[0] wait for at speed
+    CANBIN_STOP_SPINDLE_TURNING,
+    CANBIN_ORIENT_SPINDLE,		// d[0] orientation, i[0] mode
+    CANBIN_START_SPEED_FEED_SYNCH,	// d[0] feed per rev, i[0] velocity mode
+    CANBIN_STOP_SPEED_FEED_SYNCH,
+    CANBIN_DWELL,			// d[0] seconds
+    CANBIN_SELECT_POCKET,		// i[0] pocket, i[1] tool
+    CANBIN_CHANGE_TOOL,			// i[0] slot
+    CANBIN_COMMENT,			// str
+    CANBIN_MESSAGE,			// str
+    CANBIN_MIST_ON,
+    CANBIN_MIST_OFF,
+    CANBIN_FLOOD_ON,
+    CANBIN_FLOOD_OFF,
+    CANBIN_ENABLE_FEED_OVERRIDE,
+    CANBIN_DISABLE_FEED_OVERRIDE,
+    CANBIN_ENABLE_SPEED_OVERRIDE,
+    CANBIN_DISABLE_SPEED_OVERRIDE,
+    CANBIN_PROGRAM_STOP,
+    CANBIN_OPTIONAL_PROGRAM_STOP,
+    CANBIN_PROGRAM_END,
+    CANBIN_PALLET_SHUTTLE,
+    CANBIN_TURN_PROBE_ON,
+    CANBIN_TURN_PROBE_OFF,
+    CANBIN_OP_COUNT
+};
+
+struct canbin_header {
+    char magic[6];		// CANBIN_MAGIC, not terminated
+    uint16_t version;		// CANBIN_VERSION
+    uint32_t record_size;	// sizeof(canbin_record) of the writer
+    uint32_t records;
+    uint32_t string_bytes;
+    uint32_t reserved;
+};
+
+struct canbin_record {
+    uint16_t op;		// canbin_op
+    uint16_t reserved;
+    int32_t line;		// source line, given to the motion calls
+    int32_t i[2];
+    uint32_t str;		// offset in the string table
+    uint32_t reserved2;
+    double d[11];
+};
+
+#endif
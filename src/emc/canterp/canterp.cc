@@ -47,17 +47,26 @@
   which typically come out of one of Tom Kramer's interpreters.
   The first two columns are ignored, the rest is converted to
   equivalent canonical calls.
+
+  A file starting with CANBIN_MAGIC is instead the binary form written
+  by rs274 -c (see canbin.hh).  It is mapped and checked once when it is
+  opened, and each record is then made into its call with no parsing.
 */
 
 #include <stdio.h>		// FILE, fopen(), fclose()
 #include <string.h>		// strcpy()
 #include <ctype.h>		// isspace()
 #include <limits.h>
+#include <fcntl.h>		// open()
+#include <unistd.h>		// close()
+#include <sys/mman.h>		// mmap()
+#include <sys/stat.h>		// fstat()
 #include <algorithm>
 #include "config.h"
 #include "emc/nml_intf/interp_return.hh"
 #include "emc/nml_intf/canon.hh"
 #include "emc/rs274ngc/interp_base.hh"
+#include "canbin.hh"
 
 static char the_command[LINELEN] = { 0 };	// our current command
 static char the_command_name[LINELEN] = { 0 };	// just the name part
@@ -65,7 +74,8 @@ static char the_command_args[LINELEN] = { 0 };	// just the args part
 
 class Canterp : public InterpBase {
 public:
-    Canterp () : f(0) {}
+    Canterp () : f(0), map(0), map_size(0), next(0), end(0), current(0),
+		 strings(0) {}
     char *error_text(int errcode, char *buf, size_t buflen);
     char *stack_name(int index, char *buf, size_t buflen);
     char *line_text(char *buf, size_t buflen);
@@ -93,8 +103,16 @@ public:
     void active_m_codes(int active_mcodes[ACTIVE_M_CODES]);
     void active_settings(double active_settings[ACTIVE_SETTINGS]);
     void set_loglevel(int level);
+    int open_binary(int fd);
+    void close_binary();
+    int execute_record(const canbin_record *record);
     FILE *f;
     char filename[PATH_MAX];
+    // the mapped binary file, if that is what was opened
+    void *map;
+    size_t map_size;
+    const canbin_record *next, *end, *current;
+    const char *strings;
 };
 
 char *Canterp::error_text(int errcode, char *buf, size_t buflen) {
@@ -240,6 +258,11 @@ int Canterp::read(const char *line) {
 
 int Canterp::read() {
     char buf[LINELEN];
+    if(map) {
+	if(next == end) return INTERP_ENDFILE;
+	current = next++;
+	return INTERP_OK;
+    }
     if(!f) return INTERP_ERROR;
     if(!fgets(buf, sizeof(buf), f)) return INTERP_ENDFILE;
     return canterp_parse(buf);
@@ -255,6 +278,8 @@ int Canterp::execute(const char *line) {
 	retval = canterp_parse((char *) line);
 	if (retval)
 	    return retval;
+    } else if (map) {
+	return current ? execute_record(current) : INTERP_OK;
     }
 
     // a blank line
@@ -665,6 +690,87 @@ int Canterp::execute(const char *line) {
     return INTERP_ERROR;
 }
 
+/*
+  Makes the call of one record of a binary file.  The records were
+  checked by open_binary, so the ops are known and the strings are in
+  the table.
+*/
+int Canterp::execute_record(const canbin_record *r) {
+    const double *d = r->d;
+    char s1[LINELEN];
+
+    switch (r->op) {
+    case CANBIN_STRAIGHT_TRAVERSE:
+	STRAIGHT_TRAVERSE(r->line, d[0], d[1], d[2], d[3], d[4], d[5],
+			  d[6], d[7], d[8]);
+	break;
+    case CANBIN_STRAIGHT_FEED:
+	STRAIGHT_FEED(r->line, d[0], d[1], d[2], d[3], d[4], d[5],
+		      d[6], d[7], d[8]);
+	break;
+    case CANBIN_ARC_FEED:
+	ARC_FEED(r->line, d[0], d[1], d[2], d[3], r->i[0], d[4], d[5], d[6],
+		 d[7], d[8], d[9], d[10]);
+	break;
+    case CANBIN_STRAIGHT_PROBE:
+	STRAIGHT_PROBE(r->line, d[0], d[1], d[2], d[3], d[4], d[5],
+		       d[6], d[7], d[8], r->i[0]);
+	break;
+    case CANBIN_USE_LENGTH_UNITS:
+	USE_LENGTH_UNITS((CANON_UNITS) r->i[0]);
+	break;
+    case CANBIN_SET_FEED_REFERENCE:
+	SET_FEED_REFERENCE((CANON_FEED_REFERENCE) r->i[0]);
+	break;
+    case CANBIN_SELECT_PLANE:
+	SELECT_PLANE((CANON_PLANE) r->i[0]);
+	break;
+    case CANBIN_SET_MOTION_CONTROL_MODE:
+	SET_MOTION_CONTROL_MODE((CANON_MOTION_MODE) r->i[0], d[0]);
+	break;
+    case CANBIN_SET_FEED_RATE: SET_FEED_RATE(d[0]); break;
+    case CANBIN_SET_SPINDLE_SPEED: SET_SPINDLE_SPEED(d[0]); break;
+    case CANBIN_START_SPINDLE_CLOCKWISE:
+	START_SPINDLE_CLOCKWISE(r->i[0]);
+	break;
+    case CANBIN_START_SPINDLE_COUNTERCLOCKWISE:
+	START_SPINDLE_COUNTERCLOCKWISE(r->i[0]);
+	break;
+    case CANBIN_STOP_SPINDLE_TURNING: STOP_SPINDLE_TURNING(); break;
+    case CANBIN_ORIENT_SPINDLE: ORIENT_SPINDLE(d[0], r->i[0]); break;
+    case CANBIN_START_SPEED_FEED_SYNCH:
+	START_SPEED_FEED_SYNCH(d[0], r->i[0]);
+	break;
+    case CANBIN_STOP_SPEED_FEED_SYNCH: STOP_SPEED_FEED_SYNCH(); break;
+    case CANBIN_DWELL: DWELL(d[0]); break;
+    case CANBIN_SELECT_POCKET: SELECT_POCKET(r->i[0], r->i[1]); break;
+    case CANBIN_CHANGE_TOOL: CHANGE_TOOL(r->i[0]); break;
+    case CANBIN_COMMENT: COMMENT(strings + r->str); break;
+    case CANBIN_MESSAGE:
+	// MESSAGE may write to its argument and the map is read only
+	snprintf(s1, sizeof(s1), "%s", strings + r->str);
+	MESSAGE(s1);
+	break;
+    case CANBIN_MIST_ON: MIST_ON(); break;
+    case CANBIN_MIST_OFF: MIST_OFF(); break;
+    case CANBIN_FLOOD_ON: FLOOD_ON(); break;
+    case CANBIN_FLOOD_OFF: FLOOD_OFF(); break;
+    case CANBIN_ENABLE_FEED_OVERRIDE: ENABLE_FEED_OVERRIDE(); break;
+    case CANBIN_DISABLE_FEED_OVERRIDE: DISABLE_FEED_OVERRIDE(); break;
+    case CANBIN_ENABLE_SPEED_OVERRIDE: ENABLE_SPEED_OVERRIDE(); break;
+    case CANBIN_DISABLE_SPEED_OVERRIDE: DISABLE_SPEED_OVERRIDE(); break;
+    case CANBIN_PROGRAM_STOP: PROGRAM_STOP(); break;
+    case CANBIN_OPTIONAL_PROGRAM_STOP: OPTIONAL_PROGRAM_STOP(); break;
+    case CANBIN_PROGRAM_END: PROGRAM_END(); break;
+    case CANBIN_PALLET_SHUTTLE: PALLET_SHUTTLE(); break;
+    case CANBIN_TURN_PROBE_ON: TURN_PROBE_ON(); break;
+    case CANBIN_TURN_PROBE_OFF: TURN_PROBE_OFF(); break;
+    default:
+	return INTERP_ERROR;
+    }
+    return INTERP_OK;
+}
+
 int Canterp::execute(const char *line, int line_number) {
     return execute(line);
 }
@@ -673,11 +779,90 @@ int Canterp::execute() {
     return execute(0);
 }
 
+/*
+  Maps a binary file and checks all of it, so that running it can't go
+  outside the map: the header, the record and string sizes against the
+  file, every op, and that every string ends inside the table.
+*/
+int Canterp::open_binary(int fd) {
+    struct stat st;
+    const canbin_header *header;
+    const canbin_record *records;
+    size_t size;
+
+    if(fstat(fd, &st) < 0 || (size_t) st.st_size < sizeof(canbin_header))
+	return INTERP_ERROR;
+    size = st.st_size;
+    map = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(map == MAP_FAILED) {
+	map = 0;
+	return INTERP_ERROR;
+    }
+    map_size = size;
+    header = (const canbin_header *) map;
+    if(header->version != CANBIN_VERSION
+	    || header->record_size != sizeof(canbin_record)
+	    || header->records > (size - sizeof(canbin_header))
+				    / sizeof(canbin_record)
+	    || size - sizeof(canbin_header)
+		- (size_t) header->records * sizeof(canbin_record)
+		!= header->string_bytes
+	    || (header->string_bytes
+		&& ((const char *) map)[size - 1] != 0)) {
+	fprintf(stderr, "canterp: %s is not a binary canon file this "
+		"canterp can run\n", filename);
+	close_binary();
+	return INTERP_ERROR;
+    }
+    records = (const canbin_record *) (header + 1);
+    strings = (const char *) (records + header->records);
+    for(uint32_t i = 0; i < header->records; i++) {
+	bool text = records[i].op == CANBIN_COMMENT
+	    || records[i].op == CANBIN_MESSAGE;
+	if(records[i].op == 0 || records[i].op >= CANBIN_OP_COUNT
+		|| (text && records[i].str >= header->string_bytes)) {
+	    fprintf(stderr, "canterp: %s: bad record %u\n", filename, i);
+	    close_binary();
+	    return INTERP_ERROR;
+	}
+    }
+    next = records;
+    end = records + header->records;
+    current = 0;
+    return INTERP_OK;
+}
+
+void Canterp::close_binary() {
+    if(map) munmap(map, map_size);
+    map = 0;
+    map_size = 0;
+    next = end = current = 0;
+    strings = 0;
+}
+
 int Canterp::open(const char *newfilename) {
+    char magic[sizeof(CANBIN_MAGIC) - 1];
+    int fd, retval;
+
     if(f) fclose(f);
-    f = fopen(newfilename, "r");
-    if(f) snprintf(filename, sizeof(filename), "%s", newfilename);
-    return f ? INTERP_OK : INTERP_ERROR;
+    f = 0;
+    close_binary();
+    fd = ::open(newfilename, O_RDONLY);
+    if(fd < 0) return INTERP_ERROR;
+    snprintf(filename, sizeof(filename), "%s", newfilename);
+    if(::read(fd, magic, sizeof(magic)) == (ssize_t) sizeof(magic)
+	    && !memcmp(magic, CANBIN_MAGIC, sizeof(magic))) {
+	retval = open_binary(fd);
+	::close(fd);
+	return retval;
+    }
+    f = fdopen(fd, "r");
+    if(!f) {
+	::close(fd);
+	return INTERP_ERROR;
+    }
+    rewind(f);
+    return INTERP_OK;
 }
 
 int Canterp::close() {
@@ -687,7 +872,7 @@ int Canterp::close() {
 int Canterp::exit() { return 0; }
 int Canterp::synch() { return 0; }
 int Canterp::reset() { return 0; }
-int Canterp::line() { return 0; }
+int Canterp::line() { return current ? current->line : 0; }
 int Canterp::call_level() { return 0; }
 
 char *Canterp::line_text(char *buf, size_t bufsize) {
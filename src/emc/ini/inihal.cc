@@ -22,6 +22,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "emc.hh"
 #include "emcglb.h"
 #include <stdio.h>
+#include <string.h>
 #include "hal.h"
 #include "rtapi.h"
 #include "inihal.hh"
@@ -31,6 +32,8 @@ static int comp_id;
 extern value_inihal_data old_inihal_data;
 
 static ptr_inihal_data *the_inihal_data;
+// the pin values at the last check, to skip the checks when none moved
+static value_inihal_data last_inihal_data;
 
 #define PREFIX "ini."
 #define EPSILON .00001
@@ -59,6 +62,7 @@ static ptr_inihal_data *the_inihal_data;
     fprintf(stderr,"Changed: blend_enable:          %d-->%d\n"\
                    "         blend_fallback_enable: %d-->%d\n"\
                    "         optimization_depth:    %d-->%d\n"\
+                   "         optimization_mode:     %d-->%d\n"\
                    "         gap_cycles:            %f-->%f\n"\
                    "         ramp_freq:             %f-->%f\n"\
            ,old_inihal_data.traj_arc_blend_enable \
@@ -67,6 +71,8 @@ static ptr_inihal_data *the_inihal_data;
            ,new_inihal_data.traj_arc_blend_fallback_enable \
            ,old_inihal_data.traj_arc_blend_optimization_depth \
            ,new_inihal_data.traj_arc_blend_optimization_depth \
+           ,old_inihal_data.traj_arc_blend_optimization_mode \
+           ,new_inihal_data.traj_arc_blend_optimization_mode \
            ,old_inihal_data.traj_arc_blend_gap_cycles \
            ,new_inihal_data.traj_arc_blend_gap_cycles \
            ,old_inihal_data.traj_arc_blend_ramp_freq \
@@ -163,6 +169,7 @@ int ini_hal_init(int numjoints)
     MAKE_BIT_PIN(traj_arc_blend_enable,HAL_IN);
     MAKE_BIT_PIN(traj_arc_blend_fallback_enable,HAL_IN);
     MAKE_S32_PIN(traj_arc_blend_optimization_depth,HAL_IN);
+    MAKE_S32_PIN(traj_arc_blend_optimization_mode,HAL_IN);
     MAKE_FLOAT_PIN(traj_arc_blend_gap_cycles,HAL_IN);
     MAKE_FLOAT_PIN(traj_arc_blend_ramp_freq,HAL_IN);
     MAKE_FLOAT_PIN(traj_arc_blend_tangent_kink_ratio,HAL_IN);
@@ -181,6 +188,7 @@ int ini_hal_init_pins(int numjoints)
     INIT_PIN(traj_arc_blend_enable);
     INIT_PIN(traj_arc_blend_fallback_enable);
     INIT_PIN(traj_arc_blend_optimization_depth);
+    INIT_PIN(traj_arc_blend_optimization_mode);
     INIT_PIN(traj_arc_blend_gap_cycles);
     INIT_PIN(traj_arc_blend_ramp_freq);
     INIT_PIN(traj_arc_blend_tangent_kink_ratio);
@@ -216,12 +224,8 @@ static void copy_hal_data(const ptr_inihal_data &i, value_inihal_data &j)
 #undef ARRAY
 } // copy_hal_data()
 
-int check_ini_hal_items(int numjoints)
+static int check_items(const value_inihal_data &new_inihal_data, int numjoints)
 {
-    value_inihal_data new_inihal_data_mutable;
-    copy_hal_data(*the_inihal_data, new_inihal_data_mutable);
-    const value_inihal_data &new_inihal_data = new_inihal_data_mutable;
-
     if (CHANGED(traj_default_velocity)) {
         if (debug) SHOW_CHANGE(traj_default_velocity)
         UPDATE(traj_default_velocity);
@@ -260,6 +264,7 @@ int check_ini_hal_items(int numjoints)
     if (   CHANGED(traj_arc_blend_enable)
         || CHANGED(traj_arc_blend_fallback_enable)
         || CHANGED(traj_arc_blend_optimization_depth)
+        || CHANGED(traj_arc_blend_optimization_mode)
         || CHANGED(traj_arc_blend_gap_cycles)
         || CHANGED(traj_arc_blend_ramp_freq)
         || CHANGED(traj_arc_blend_tangent_kink_ratio)
@@ -268,12 +273,14 @@ int check_ini_hal_items(int numjoints)
         UPDATE(traj_arc_blend_enable);
         UPDATE(traj_arc_blend_fallback_enable);
         UPDATE(traj_arc_blend_optimization_depth);
+        UPDATE(traj_arc_blend_optimization_mode);
         UPDATE(traj_arc_blend_gap_cycles);
         UPDATE(traj_arc_blend_ramp_freq);
         UPDATE(traj_arc_blend_tangent_kink_ratio);
         if (0 != emcSetupArcBlends(old_inihal_data.traj_arc_blend_enable
                                   ,old_inihal_data.traj_arc_blend_fallback_enable
                                   ,old_inihal_data.traj_arc_blend_optimization_depth
+                                  ,old_inihal_data.traj_arc_blend_optimization_mode
                                   ,old_inihal_data.traj_arc_blend_gap_cycles
                                   ,old_inihal_data.traj_arc_blend_ramp_freq
                                   ,old_inihal_data.traj_arc_blend_tangent_kink_ratio
@@ -407,6 +414,31 @@ int check_ini_hal_items(int numjoints)
     } // EMCMOT_MAX_AXIS
 
     return 0;
+} // check_items()
+
+int check_ini_hal_items(int numjoints)
+{
+    value_inihal_data new_inihal_data;
+    int retval;
+
+    // cleared so that the padding compares equal too
+    memset(&new_inihal_data, 0, sizeof(new_inihal_data));
+    copy_hal_data(*the_inihal_data, new_inihal_data);
+    if (memcmp(&new_inihal_data, &last_inihal_data, sizeof(new_inihal_data)) == 0) {
+        return 0;
+    }
+    last_inihal_data = new_inihal_data;
+
+    // the changes go to motion together, taking effect in the same cycle
+    emcBeginSettings();
+    retval = check_items(new_inihal_data, numjoints);
+    if (0 != emcEndSettings()) {
+        if (emc_debug & EMC_DEBUG_CONFIG) {
+            rcs_print_error("check_ini_hal_items:bad return from emcEndSettings\n");
+        }
+        retval = -1;
+    }
+    return retval;
 } // check_ini_hal_items
 
 // vim: sts=4 sw=4 et
@@ -56,6 +56,7 @@ int ini_hal_init_pins(int numjoints);
     FIELD(hal_bit_t,traj_arc_blend_enable) \
     FIELD(hal_bit_t,traj_arc_blend_fallback_enable) \
     FIELD(hal_s32_t,traj_arc_blend_optimization_depth) \
+    FIELD(hal_s32_t,traj_arc_blend_optimization_mode) \
     FIELD(hal_float_t,traj_arc_blend_gap_cycles) \
     FIELD(hal_float_t,traj_arc_blend_ramp_freq) \
     FIELD(hal_float_t,traj_arc_blend_tangent_kink_ratio) \
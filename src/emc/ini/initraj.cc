@@ -190,6 +190,7 @@ static int loadTraj(EmcIniFile *trajInifile)
         int arcBlendEnable = 1;
         int arcBlendFallbackEnable = 0;
         int arcBlendOptDepth = 50;
+        int arcBlendOptMode = 0;
         int arcBlendGapCycles = 4;
         double arcBlendRampFreq = 100.0;
         double arcBlendTangentKinkRatio = 0.1;
@@ -197,12 +198,13 @@ static int loadTraj(EmcIniFile *trajInifile)
         trajInifile->Find(&arcBlendEnable, "ARC_BLEND_ENABLE", "TRAJ");
         trajInifile->Find(&arcBlendFallbackEnable, "ARC_BLEND_FALLBACK_ENABLE", "TRAJ");
         trajInifile->Find(&arcBlendOptDepth, "ARC_BLEND_OPTIMIZATION_DEPTH", "TRAJ");
+        trajInifile->Find(&arcBlendOptMode, "ARC_BLEND_OPTIMIZATION_MODE", "TRAJ");
         trajInifile->Find(&arcBlendGapCycles, "ARC_BLEND_GAP_CYCLES", "TRAJ");
         trajInifile->Find(&arcBlendRampFreq, "ARC_BLEND_RAMP_FREQ", "TRAJ");
         trajInifile->Find(&arcBlendTangentKinkRatio, "ARC_BLEND_KINK_RATIO", "TRAJ");
 
         if (0 != emcSetupArcBlends(arcBlendEnable, arcBlendFallbackEnable,
-                    arcBlendOptDepth, arcBlendGapCycles, arcBlendRampFreq, arcBlendTangentKinkRatio)) {
+                    arcBlendOptDepth, arcBlendOptMode, arcBlendGapCycles, arcBlendRampFreq, arcBlendTangentKinkRatio)) {
             if (emc_debug & EMC_DEBUG_CONFIG) {
                 rcs_print("bad return value from emcSetupArcBlends\n");
             }
@@ -212,11 +214,32 @@ static int loadTraj(EmcIniFile *trajInifile)
         old_inihal_data.traj_arc_blend_enable = arcBlendEnable;
         old_inihal_data.traj_arc_blend_fallback_enable = arcBlendFallbackEnable;
         old_inihal_data.traj_arc_blend_optimization_depth = arcBlendOptDepth;
+        old_inihal_data.traj_arc_blend_optimization_mode = arcBlendOptMode;
         old_inihal_data.traj_arc_blend_gap_cycles = arcBlendGapCycles;
         old_inihal_data.traj_arc_blend_ramp_freq = arcBlendRampFreq;
         old_inihal_data.traj_arc_blend_tangent_kink_ratio = arcBlendTangentKinkRatio;
         //TODO update inihal
 
+        int plannerType = 0;
+        double maxJerk = 1e99;
+        trajInifile->Find(&plannerType, "PLANNER_TYPE", "TRAJ");
+        trajInifile->Find(&maxJerk, "MAX_JERK", "TRAJ");
+        if (plannerType != 0 && maxJerk >= 1e99) {
+            rcs_print("[TRAJ]PLANNER_TYPE = %d requires [TRAJ]MAX_JERK, using trapezoidal profiles\n",
+                    plannerType);
+            plannerType = 0;
+        }
+        double rapidClearance = 0.0;
+        int rapidIndependent = trajInifile->Find(&rapidClearance,
+                "INDEPENDENT_RAPID_Z", "TRAJ") == IniFile::ERR_NONE;
+        if (0 != emcSetupPlanner(plannerType, plannerType ? maxJerk : 0.0,
+                    rapidIndependent, rapidClearance)) {
+            if (emc_debug & EMC_DEBUG_CONFIG) {
+                rcs_print("bad return value from emcSetupPlanner\n");
+            }
+            return -1;
+        }
+
         double maxFeedScale = 1.0;
         trajInifile->Find(&maxFeedScale, "MAX_FEED_OVERRIDE", "DISPLAY");
 
@@ -311,6 +334,13 @@ static int loadTraj(EmcIniFile *trajInifile)
             }
             return -1;
         }
+
+        if (NULL != (inistring = trajInifile->Find("VOLUMETRIC_COMP_FILE", "TRAJ"))) {
+            if (0 != emcTrajLoadVolComp(inistring)) {
+                rcs_print("can't load [TRAJ] VOLUMETRIC_COMP_FILE %s\n", inistring);
+                return -1;
+            }
+        }
      } //try
 
     catch (EmcIniFile::Exception &e) {
@@ -79,6 +79,13 @@ static NML *emcErrorBuffer = 0;
 static char *ttcomments[CANON_POCKETS_MAX];
 static int fms[CANON_POCKETS_MAX];
 static int random_toolchanger = 0;
+/* [EMCIO]TOOL_PREP_PIPELINE: report a tool prepare done as soon as it is
+   started, so the moves after a T word run while the changer gets the
+   tool ready.  A tool change, or another prepare, issued before the
+   prepare has finished waits for it. */
+static int tool_prep_pipeline = 0;
+static int deferred_load = 0;		/* tool change waiting for a prepare */
+static int deferred_prep = -1;		/* pocket of a waiting prepare, or -1 */
 
 
 struct iocontrol_str {
@@ -244,6 +251,7 @@ static int iniLoad(const char *filename)
     }
 
     inifile.Find(&random_toolchanger, "RANDOM_TOOLCHANGER", "EMCIO");
+    inifile.Find(&tool_prep_pipeline, "TOOL_PREP_PIPELINE", "EMCIO");
 
     // close it
     inifile.Close();
@@ -251,71 +259,6 @@ static int iniLoad(const char *filename)
     return 0;
 }
 
-/********************************************************************
-*
-* Description: saveToolTable(const char *filename, CANON_TOOL_TABLE toolTable[])
-*		Saves the tool table from toolTable[] array into file filename.
-*		  Array is CANON_TOOL_MAX + 1 entries, since 0 is included.
-*
-* Return Value: Zero on success or -1 if file not found.
-*
-* Side Effects: Default setting used if the parameter not found in
-*		the ini file.
-*
-* Called By: main()
-*
-********************************************************************/
-static int saveToolTable(const char *filename,
-			 CANON_TOOL_TABLE toolTable[])
-{
-    int pocket;
-    FILE *fp;
-    const char *name;
-    int start_pocket;
-
-    // check filename
-    if (filename[0] == 0) {
-	name = tool_table_file;
-    } else {
-	// point to name provided
-	name = filename;
-    }
-
-    // open tool table file
-    if (NULL == (fp = fopen(name, "w"))) {
-	// can't open file
-	return -1;
-    }
-
-    if(random_toolchanger) {
-        start_pocket = 0;
-    } else {
-        start_pocket = 1;
-    }
-    for (pocket = start_pocket; pocket < CANON_POCKETS_MAX; pocket++) {
-        if (toolTable[pocket].toolno != -1) {
-            fprintf(fp, "T%d P%d", toolTable[pocket].toolno, random_toolchanger? pocket: fms[pocket]);
-            if (toolTable[pocket].diameter) fprintf(fp, " D%f", toolTable[pocket].diameter);
-            if (toolTable[pocket].offset.tran.x) fprintf(fp, " X%+f", toolTable[pocket].offset.tran.x);
-            if (toolTable[pocket].offset.tran.y) fprintf(fp, " Y%+f", toolTable[pocket].offset.tran.y);
-            if (toolTable[pocket].offset.tran.z) fprintf(fp, " Z%+f", toolTable[pocket].offset.tran.z);
-            if (toolTable[pocket].offset.a) fprintf(fp, " A%+f", toolTable[pocket].offset.a);
-            if (toolTable[pocket].offset.b) fprintf(fp, " B%+f", toolTable[pocket].offset.b);
-            if (toolTable[pocket].offset.c) fprintf(fp, " C%+f", toolTable[pocket].offset.c);
-            if (toolTable[pocket].offset.u) fprintf(fp, " U%+f", toolTable[pocket].offset.u);
-            if (toolTable[pocket].offset.v) fprintf(fp, " V%+f", toolTable[pocket].offset.v);
-            if (toolTable[pocket].offset.w) fprintf(fp, " W%+f", toolTable[pocket].offset.w);
-            if (toolTable[pocket].frontangle) fprintf(fp, " I%+f", toolTable[pocket].frontangle);
-            if (toolTable[pocket].backangle) fprintf(fp, " J%+f", toolTable[pocket].backangle);
-            if (toolTable[pocket].orientation) fprintf(fp, " Q%d", toolTable[pocket].orientation);
-            fprintf(fp, " ;%s\n", ttcomments[pocket]);
-        }
-    }
-
-    fclose(fp);
-    return 0;
-}
-
 static int done = 0;
 
 /********************************************************************
@@ -602,7 +545,8 @@ void load_tool(int pocket) {
         ttcomments[0] = ttcomments[pocket];
         ttcomments[pocket] = comment_temp;
 
-        if (0 != saveToolTable(tool_table_file, emcioStatus.tool.toolTable))
+        if (0 != saveToolTable(tool_table_file, emcioStatus.tool.toolTable,
+			       fms, ttcomments, random_toolchanger))
             emcioStatus.status = RCS_ERROR;
     } else if(pocket == 0) {
         // on non-random tool-changers, asking for pocket 0 is the secret
@@ -630,6 +574,43 @@ void reload_tool_number(int toolno) {
 }
 
 
+/* start preparing the tool in pocket p: set the tool number first, then
+   the prepare pin to tell external logic to get started */
+static void start_tool_prepare(int p)
+{
+    iocontrol_data->tool_prep_index = p;
+    *(iocontrol_data->tool_prep_pocket) = random_toolchanger? p: fms[p];
+    if(!random_toolchanger && p == 0) {
+        *(iocontrol_data->tool_prep_number) = 0;
+    } else {
+        *(iocontrol_data->tool_prep_number) = emcioStatus.tool.toolTable[p].toolno;
+    }
+    *(iocontrol_data->tool_prepare) = 1;
+}
+
+/* start changing to the prepared tool; returns 0 if there is nothing to
+   change */
+static int start_tool_change(void)
+{
+    // it doesn't make sense to load a tool from the spindle pocket
+    if (random_toolchanger && emcioStatus.tool.pocketPrepped == 0) {
+        return 0;
+    }
+
+    // it's not necessary to load the tool already in the spindle
+    if (!random_toolchanger && emcioStatus.tool.pocketPrepped > 0 &&
+        emcioStatus.tool.toolInSpindle == emcioStatus.tool.toolTable[emcioStatus.tool.pocketPrepped].toolno) {
+        return 0;
+    }
+
+    if (emcioStatus.tool.pocketPrepped == -1) {
+        return 0;
+    }
+    //notify HW for toolchange
+    *(iocontrol_data->tool_change) = 1;
+    return 1;
+}
+
 /********************************************************************
 *
 * Description: read_tool_inputs(void)
@@ -650,6 +631,14 @@ int read_tool_inputs(void)
 	emcioStatus.tool.pocketPrepped = iocontrol_data->tool_prep_index; //check if tool has been prepared
 	*(iocontrol_data->tool_prepare) = 0;
 	emcioStatus.status = RCS_DONE;  // we finally finished to do tool-changing, signal task with RCS_DONE
+	if (deferred_load) {
+	    // a pipelined prepare finished under a waiting tool change
+	    deferred_load = 0;
+	    if (start_tool_change()) emcioStatus.status = RCS_EXEC;
+	} else if (deferred_prep != -1) {
+	    start_tool_prepare(deferred_prep);
+	    deferred_prep = -1;
+	}
 	return 10; //prepped finished
     }
     
@@ -668,6 +657,10 @@ int read_tool_inputs(void)
 	iocontrol_data->tool_prep_index = 0; //likewise in HAL
 	*(iocontrol_data->tool_change) = 0; //also reset the tool change signal
 	emcioStatus.status = RCS_DONE;	// we finally finished to do tool-changing, signal task with RCS_DONE
+	if (deferred_prep != -1) {
+	    start_tool_prepare(deferred_prep);
+	    deferred_prep = -1;
+	}
 	return 11; //change finished
     }
     return 0;
@@ -856,32 +849,30 @@ int main(int argc, char *argv[])
 	    *(iocontrol_data->coolant_flood)=0;		/* coolant flood output pin */
 	    *(iocontrol_data->tool_change)=0;		/* abort tool change if in progress */
 	    *(iocontrol_data->tool_prepare)=0;		/* abort tool prepare if in progress */
+	    deferred_load = 0;
+	    deferred_prep = -1;
 	    break;
 
 	case EMC_TOOL_PREPARE_TYPE:
             {
                 signed int p = ((EMC_TOOL_PREPARE*)emcioCommand)->pocket;
-		int t = ((EMC_TOOL_PREPARE*)emcioCommand)->tool;
-                rtapi_print_msg(RTAPI_MSG_DBG, "EMC_TOOL_PREPARE tool=%d pocket=%d\n", t, p);
+                rtapi_print_msg(RTAPI_MSG_DBG, "EMC_TOOL_PREPARE tool=%d pocket=%d\n",
+                                ((EMC_TOOL_PREPARE*)emcioCommand)->tool, p);
 
                 // it doesn't make sense to prep the spindle pocket
                 if(random_toolchanger && p == 0) break;
 
-                /* set tool number first */
-                iocontrol_data->tool_prep_index = p;
-                *(iocontrol_data->tool_prep_pocket) = random_toolchanger? p: fms[p];
-                if(!random_toolchanger && p == 0) {
-                    *(iocontrol_data->tool_prep_number) = 0;
-                } else {
-                    *(iocontrol_data->tool_prep_number) = emcioStatus.tool.toolTable[p].toolno;
-		    rtapi_print_msg(RTAPI_MSG_DBG, "EMC_TOOL_PREPARE: mismatch: tooltable[%d]=%d, got %d\n", 
-				    p, emcioStatus.tool.toolTable[p].toolno, t);
+                if (tool_prep_pipeline &&
+                    (*(iocontrol_data->tool_prepare) || *(iocontrol_data->tool_change))) {
+                    /* start it once the changer is done with the last one */
+                    deferred_prep = p;
+                    emcioStatus.status = RCS_EXEC;
+                    break;
                 }
-                /* then set the prepare pin to tell external logic to get started */
-                *(iocontrol_data->tool_prepare) = 1;
+                start_tool_prepare(p);
                 // the feedback logic is done inside read_hal_inputs()
                 // we only need to set RCS_EXEC if RCS_DONE is not already set by the above logic
-                if (tool_status != 10) //set above to 10 in case PREP already finished (HAL loopback machine)
+                if (!tool_prep_pipeline && tool_status != 10) //set above to 10 in case PREP already finished (HAL loopback machine)
                     emcioStatus.status = RCS_EXEC;
             }
 	    break;
@@ -889,20 +880,14 @@ int main(int argc, char *argv[])
 	case EMC_TOOL_LOAD_TYPE:
 	    rtapi_print_msg(RTAPI_MSG_DBG, "EMC_TOOL_LOAD loaded=%d prepped=%d\n", emcioStatus.tool.toolInSpindle, emcioStatus.tool.pocketPrepped);
 
-            // it doesn't make sense to load a tool from the spindle pocket
-            if (random_toolchanger && emcioStatus.tool.pocketPrepped == 0) {
-                break;
-            }
-
-            // it's not necessary to load the tool already in the spindle
-            if (!random_toolchanger && emcioStatus.tool.pocketPrepped > 0 &&
-                emcioStatus.tool.toolInSpindle == emcioStatus.tool.toolTable[emcioStatus.tool.pocketPrepped].toolno) {
+            if (tool_prep_pipeline && *(iocontrol_data->tool_prepare)) {
+                /* the prepare is still going, change once it is done */
+                deferred_load = 1;
+                emcioStatus.status = RCS_EXEC;
                 break;
             }
 
-	    if (emcioStatus.tool.pocketPrepped != -1) {
-		//notify HW for toolchange
-		*(iocontrol_data->tool_change) = 1;
+	    if (start_tool_change()) {
 		// the feedback logic is done inside read_hal_inputs() we only
 		// need to set RCS_EXEC if RCS_DONE is not already set by the
 		// above logic
@@ -962,7 +947,8 @@ int main(int argc, char *argv[])
                     emcioStatus.tool.toolTable[0] = emcioStatus.tool.toolTable[p];
                 }                    
             }
-	    if (0 != saveToolTable(tool_table_file, emcioStatus.tool.toolTable))
+	    if (0 != saveToolTable(tool_table_file, emcioStatus.tool.toolTable,
+			       fms, ttcomments, random_toolchanger))
 		emcioStatus.status = RCS_ERROR;
 	    break;
 
@@ -81,6 +81,13 @@ static char *ttcomments[CANON_POCKETS_MAX];
 static int fms[CANON_POCKETS_MAX];
 static int random_toolchanger = 0;
 static int support_start_change = 0;
+/* [EMCIO]TOOL_PREP_PIPELINE: report a tool prepare done as soon as it is
+   started, so the moves after a T word run while the changer gets the
+   tool ready.  A tool change, or another prepare, issued before the
+   prepare has finished waits for it. */
+static int tool_prep_pipeline = 0;
+static int deferred_load = 0;		// tool change waiting for a prepare
+static int deferred_prep = -1;		// pocket of a waiting prepare, or -1
 static const char *progname;
 
 typedef enum {
@@ -339,6 +346,7 @@ static int iniLoad(const char *filename)
     rtapi_print_msg(RTAPI_MSG_DBG,"%s: [EMCIO] using v%d protocol\n",progname,proto);
 
     inifile.Find(&random_toolchanger, "RANDOM_TOOLCHANGER", "EMCIO");
+    inifile.Find(&tool_prep_pipeline, "TOOL_PREP_PIPELINE", "EMCIO");
 
     // close it
     inifile.Close();
@@ -346,71 +354,6 @@ static int iniLoad(const char *filename)
     return 0;
 }
 
-/********************************************************************
- *
- * Description: saveToolTable(const char *filename, CANON_TOOL_TABLE toolTable[])
- *		Saves the tool table from toolTable[] array into file filename.
- *		  Array is CANON_TOOL_MAX + 1 entries, since 0 is included.
- *
- * Return Value: Zero on success or -1 if file not found.
- *
- * Side Effects: Default setting used if the parameter not found in
- *		the ini file.
- *
- * Called By: main()
- *
- ********************************************************************/
-static int saveToolTable(const char *filename,
-			 CANON_TOOL_TABLE toolTable[])
-{
-    int pocket;
-    FILE *fp;
-    const char *name;
-    int start_pocket;
-
-    // check filename
-    if (filename[0] == 0) {
-	name = tool_table_file;
-    } else {
-	// point to name provided
-	name = filename;
-    }
-
-    // open tool table file
-    if (NULL == (fp = fopen(name, "w"))) {
-	// can't open file
-	return -1;
-    }
-
-    if(random_toolchanger) {
-	start_pocket = 0;
-    } else {
-	start_pocket = 1;
-    }
-    for (pocket = start_pocket; pocket < CANON_POCKETS_MAX; pocket++) {
-	if (toolTable[pocket].toolno != -1) {
-	    fprintf(fp, "T%d P%d", toolTable[pocket].toolno, random_toolchanger? pocket: fms[pocket]);
-	    if (toolTable[pocket].diameter) fprintf(fp, " D%f", toolTable[pocket].diameter);
-	    if (toolTable[pocket].offset.tran.x) fprintf(fp, " X%+f", toolTable[pocket].offset.tran.x);
-	    if (toolTable[pocket].offset.tran.y) fprintf(fp, " Y%+f", toolTable[pocket].offset.tran.y);
-	    if (toolTable[pocket].offset.tran.z) fprintf(fp, " Z%+f", toolTable[pocket].offset.tran.z);
-	    if (toolTable[pocket].offset.a) fprintf(fp, " A%+f", toolTable[pocket].offset.a);
-	    if (toolTable[pocket].offset.b) fprintf(fp, " B%+f", toolTable[pocket].offset.b);
-	    if (toolTable[pocket].offset.c) fprintf(fp, " C%+f", toolTable[pocket].offset.c);
-	    if (toolTable[pocket].offset.u) fprintf(fp, " U%+f", toolTable[pocket].offset.u);
-	    if (toolTable[pocket].offset.v) fprintf(fp, " V%+f", toolTable[pocket].offset.v);
-	    if (toolTable[pocket].offset.w) fprintf(fp, " W%+f", toolTable[pocket].offset.w);
-	    if (toolTable[pocket].frontangle) fprintf(fp, " I%+f", toolTable[pocket].frontangle);
-	    if (toolTable[pocket].backangle) fprintf(fp, " J%+f", toolTable[pocket].backangle);
-	    if (toolTable[pocket].orientation) fprintf(fp, " Q%d", toolTable[pocket].orientation);
-	    fprintf(fp, " ;%s\n", ttcomments[pocket]);
-	}
-    }
-
-    fclose(fp);
-    return 0;
-}
-
 static int done = 0;
 
 /********************************************************************
@@ -571,7 +514,8 @@ void load_tool(int pocket) {
 	ttcomments[0] = ttcomments[pocket];
 	ttcomments[pocket] = comment_temp;
 
-	if (0 != saveToolTable(tool_table_file, emcioStatus.tool.toolTable))
+	if (0 != saveToolTable(tool_table_file, emcioStatus.tool.toolTable,
+			       fms, ttcomments, random_toolchanger))
 	    emcioStatus.status = RCS_ERROR;
     } else if (pocket == 0) {
 	// magic T0 = pocket 0 = no tool
@@ -769,6 +713,45 @@ int read_inputs(void)
     return retval;
 }
 
+/* start preparing the tool in pocket p: set the tool number first, then
+   the prepare pin to tell external logic to get started */
+static void start_tool_prepare(int p)
+{
+    iocontrol_data->tool_prep_index = p;
+    *(iocontrol_data->tool_prep_pocket) = random_toolchanger? p: fms[p];
+    if (!random_toolchanger && p == 0) {
+	*(iocontrol_data->tool_prep_number) = 0;
+    } else {
+	*(iocontrol_data->tool_prep_number) = emcioStatus.tool.toolTable[p].toolno;
+    }
+    *(iocontrol_data->tool_prepare) = 1;
+    *(iocontrol_data->state) = ST_PREPARING;
+}
+
+/* start changing to the prepared tool; returns 0 if there is nothing to
+   change */
+static int start_tool_change(void)
+{
+    // it doesn't make sense to load a tool from the spindle pocket
+    if (random_toolchanger && emcioStatus.tool.pocketPrepped == 0) {
+	return 0;
+    }
+
+    // it's not necessary to load the tool already in the spindle
+    if (!random_toolchanger && emcioStatus.tool.pocketPrepped > 0 &&
+	emcioStatus.tool.toolInSpindle == emcioStatus.tool.toolTable[emcioStatus.tool.pocketPrepped].toolno) {
+	return 0;
+    }
+
+    if (emcioStatus.tool.pocketPrepped == -1) {
+	return 0;
+    }
+    //notify HW for toolchange
+    *(iocontrol_data->tool_change) = 1;
+    *(iocontrol_data->state) = ST_CHANGING;
+    return 1;
+}
+
 static void do_hal_exit(void) {
     hal_exit(comp_id);
 }
@@ -922,7 +905,23 @@ int main(int argc, char *argv[])
 	    update_status(RCS_DONE, emcioCommand->serial_number + 1);
 	}
 
-	if (input_status & (TI_PREPARING)) {
+	// start what waited for a pipelined prepare to finish
+	if ((input_status & (TI_PREPARE_COMPLETE|TI_CHANGE_COMPLETE)) &&
+	    !*(iocontrol_data->tool_prepare) && !*(iocontrol_data->tool_change)) {
+	    if (deferred_load) {
+		deferred_load = 0;
+		if (start_tool_change()) {
+		    // not done until the change is
+		    input_status &= ~TI_PREPARE_COMPLETE;
+		}
+	    } else if (deferred_prep != -1) {
+		start_tool_prepare(deferred_prep);
+		deferred_prep = -1;
+	    }
+	}
+
+	// a pipelined prepare has been reported done already
+	if ((input_status & (TI_PREPARING)) && !tool_prep_pipeline) {
 	    update_status(RCS_EXEC, emcioCommand->serial_number);
 	}
 
@@ -1013,6 +1012,8 @@ int main(int argc, char *argv[])
 	    *(iocontrol_data->tool_change) = 0;      // abort tool change if in progress
 	    *(iocontrol_data->tool_prepare) = 0;     // abort tool prepare if in progress
 	    *(iocontrol_data->start_change) = 0;
+	    deferred_load = 0;
+	    deferred_prep = -1;
 
 	    // indicate state change - waiting for ack line in V2
 	    // wait-for-ack intermediate state meaningful in V2 mode only
@@ -1029,29 +1030,27 @@ int main(int argc, char *argv[])
 	    if (random_toolchanger && p == 0)
 		break;
 
-	    /* set tool number first */
-            iocontrol_data->tool_prep_index = p;
-            *(iocontrol_data->tool_prep_pocket) = random_toolchanger? p: fms[p];
-	    if (!random_toolchanger && p == 0) {
-		*(iocontrol_data->tool_prep_number) = 0;
-	    } else {
-		*(iocontrol_data->tool_prep_number) = emcioStatus.tool.toolTable[p].toolno;
-		if (emcioStatus.tool.toolTable[p].toolno != t) // sanity check
-		    rtapi_print_msg(RTAPI_MSG_DBG, "EMC_TOOL_PREPARE: mismatch: tooltable[%d]=%d, got %d\n", 
-				    p, emcioStatus.tool.toolTable[p].toolno, t);
-	    }
+	    if ((random_toolchanger || p != 0) &&
+		emcioStatus.tool.toolTable[p].toolno != t) // sanity check
+		rtapi_print_msg(RTAPI_MSG_DBG, "EMC_TOOL_PREPARE: mismatch: tooltable[%d]=%d, got %d\n", 
+				p, emcioStatus.tool.toolTable[p].toolno, t);
 
 	    if ((proto > V1) && *(iocontrol_data->toolchanger_faulted)) { // informational
 		rtapi_print_msg(RTAPI_MSG_DBG, "%s: prepare: toolchanger faulted (reason=%d), next M6 will %s\n",
 				progname,toolchanger_reason,
 				toolchanger_reason > 0 ? "set fault code and reason" : "abort program");
 	    }
-	    // then set the prepare pin to tell external logic to get started
-	    *(iocontrol_data->tool_prepare) = 1;
-	    *(iocontrol_data->state) = ST_PREPARING;
+	    if (tool_prep_pipeline &&
+		(*(iocontrol_data->tool_prepare) || *(iocontrol_data->tool_change))) {
+		// start it once the changer is done with the last one
+		deferred_prep = p;
+		emcioStatus.status = RCS_EXEC;
+		break;
+	    }
+	    start_tool_prepare(p);
 
 	    // delay fetching the next message until prepare done
-	    if (!(input_status & TI_PREPARE_COMPLETE)) {
+	    if (!tool_prep_pipeline && !(input_status & TI_PREPARE_COMPLETE)) {
 		emcioStatus.status = RCS_EXEC;
 	    }
 	}
@@ -1060,22 +1059,14 @@ int main(int argc, char *argv[])
 	case EMC_TOOL_LOAD_TYPE:
 	    rtapi_print_msg(RTAPI_MSG_DBG, "EMC_TOOL_LOAD loaded=%d prepped=%d\n", emcioStatus.tool.toolInSpindle, emcioStatus.tool.pocketPrepped);
 
-	    // it doesn't make sense to load a tool from the spindle pocket
-	    if (random_toolchanger && emcioStatus.tool.pocketPrepped == 0) {
-		break;
-	    }
-
-	    // it's not necessary to load the tool already in the spindle
-	    if (!random_toolchanger && emcioStatus.tool.pocketPrepped > 0 &&
-		emcioStatus.tool.toolInSpindle == emcioStatus.tool.toolTable[emcioStatus.tool.pocketPrepped].toolno) {
+	    if (tool_prep_pipeline && *(iocontrol_data->tool_prepare)) {
+		// the prepare is still going, change once it is done
+		deferred_load = 1;
+		emcioStatus.status = RCS_EXEC;
 		break;
 	    }
 
-	    if (emcioStatus.tool.pocketPrepped != -1) {
-		//notify HW for toolchange
-		*(iocontrol_data->tool_change) = 1;
-		*(iocontrol_data->state) = ST_CHANGING;
-
+	    if (start_tool_change()) {
 		// delay fetching the next message until change done
 		if (! (input_status & TI_CHANGE_COMPLETE)) {
 		    emcioStatus.status = RCS_EXEC;
@@ -1145,7 +1136,8 @@ int main(int argc, char *argv[])
 		emcioStatus.tool.toolTable[0] = emcioStatus.tool.toolTable[p];
 	    }
 	}
-	if (0 != saveToolTable(tool_table_file, emcioStatus.tool.toolTable))
+	if (0 != saveToolTable(tool_table_file, emcioStatus.tool.toolTable,
+			       fms, ttcomments, random_toolchanger))
 	    emcioStatus.status = RCS_ERROR;
 	break;
 
@@ -0,0 +1,89 @@
+#ifndef FIVEAXISKINS_COMMON_H
+#define FIVEAXISKINS_COMMON_H
+/********************************************************************
+* Description: 5axiskins-common.h
+*   kinematics for XYZBC 5 axis bridge mill, shared by the realtime
+*   module and the preview
+*
+*   Derived from a work by Fred Proctor & Will Shackleford
+*
+* Author:
+* License: GPL Version 2
+* System: Linux
+*
+* Copyright (c) 2007 Chris Radek
+*
+* Last change:
+********************************************************************/
+
+// user must include a math.h-type header first
+#include "emcpos.h"
+
+#define d2r(d) ((d)*M_PI/180.0)
+#define r2d(r) ((r)*180.0/M_PI)
+
+static double pivot_length;
+
+static void set_geometry(double pivot_length_)
+{
+    pivot_length = pivot_length_;
+}
+
+static PmCartesian s2r(double r, double t, double p) {
+    PmCartesian c;
+    t = d2r(t), p = d2r(p);
+
+    c.x = r * sin(p) * cos(t);
+    c.y = r * sin(p) * sin(t);
+    c.z = r * cos(p);
+
+    return c;
+}
+
+// 6 joints (5axiskins name is misnomer)
+#define JOINT_0 0
+#define JOINT_1 1
+#define JOINT_2 2
+// joints with identity to axis letters:
+#define JOINT_B 3
+#define JOINT_C 4
+#define JOINT_W 5
+
+static int kinematics_forward(const double *joints, EmcPose *pos)
+{
+    PmCartesian r = s2r(pivot_length + joints[JOINT_W]
+                       ,joints[JOINT_C]
+                       ,180.0 - joints[JOINT_B]);
+
+    pos->tran.x = joints[JOINT_0] + r.x;
+    pos->tran.y = joints[JOINT_1] + r.y;
+    pos->tran.z = joints[JOINT_2] + pivot_length + r.z;
+    pos->b      = joints[JOINT_B];
+    pos->c      = joints[JOINT_C];
+    pos->w      = joints[JOINT_W];
+
+    pos->a = 0;
+    pos->u = 0;
+    pos->v = 0;
+
+    return 0;
+}
+
+static int kinematics_inverse(const EmcPose *pos, double *joints)
+{
+    PmCartesian r = s2r(pivot_length + pos->w
+                       ,pos->c
+                       ,180.0 - pos->b);
+
+    joints[JOINT_0] = pos->tran.x - r.x;
+    joints[JOINT_1] = pos->tran.y - r.y;
+    joints[JOINT_2] = pos->tran.z - pivot_length - r.z;
+
+    joints[JOINT_B] = pos->b;
+    joints[JOINT_C] = pos->c;
+    joints[JOINT_W] = pos->w;
+
+    return 0;
+}
+
+#endif
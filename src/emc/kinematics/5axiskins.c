@@ -18,55 +18,19 @@
 #include "hal.h"
 #include "rtapi_math.h"
 
-#define d2r(d) ((d)*PM_PI/180.0)
-#define r2d(r) ((r)*180.0/PM_PI)
+#include "5axiskins-common.h"
 
 struct haldata {
     hal_float_t *pivot_length;
 } *haldata;
 
-static PmCartesian s2r(double r, double t, double p) {
-    PmCartesian c;
-    t = d2r(t), p = d2r(p);
-
-    c.x = r * sin(p) * cos(t);
-    c.y = r * sin(p) * sin(t);
-    c.z = r * cos(p);
-
-    return c;
-}
-
-
-// 6 joints (5axiskins name is misnomer)
-#define JOINT_0 0
-#define JOINT_1 1
-#define JOINT_2 2
-// joints with identity to axis letters:
-#define JOINT_B 3
-#define JOINT_C 4
-#define JOINT_W 5
-
 int kinematicsForward(const double *joints,
 		      EmcPose * pos,
 		      const KINEMATICS_FORWARD_FLAGS * fflags,
 		      KINEMATICS_INVERSE_FLAGS * iflags)
 {
-    PmCartesian r = s2r(*(haldata->pivot_length)+ joints[JOINT_W]
-                       ,joints[JOINT_C]
-                       ,180.0 - joints[JOINT_B]);
-
-    pos->tran.x = joints[JOINT_0] + r.x;
-    pos->tran.y = joints[JOINT_1] + r.y;
-    pos->tran.z = joints[JOINT_2] + *(haldata->pivot_length) + r.z;
-    pos->b      = joints[JOINT_B];
-    pos->c      = joints[JOINT_C];
-    pos->w      = joints[JOINT_W];
-
-    pos->a = 0;
-    pos->u = 0;
-    pos->v = 0;
-
-    return 0;
+    set_geometry(*(haldata->pivot_length));
+    return kinematics_forward(joints, pos);
 }
 
 int kinematicsInverse(const EmcPose * pos,
@@ -74,20 +38,8 @@ int kinematicsInverse(const EmcPose * pos,
 		      const KINEMATICS_INVERSE_FLAGS * iflags,
 		      KINEMATICS_FORWARD_FLAGS * fflags)
 {
-
-    PmCartesian r = s2r(*(haldata->pivot_length) + pos->w
-                       ,pos->c
-                       ,180.0 - pos->b);
-
-    joints[JOINT_0] = pos->tran.x - r.x;
-    joints[JOINT_1] = pos->tran.y - r.y;
-    joints[JOINT_2] = pos->tran.z - *(haldata->pivot_length) - r.z;
-
-    joints[JOINT_B] = pos->b;
-    joints[JOINT_C] = pos->c;
-    joints[JOINT_W] = pos->w;
-
-    return 0;
+    set_geometry(*(haldata->pivot_length));
+    return kinematics_inverse(pos, joints);
 }
 
 /* implemented for these kinematics as giving joints preference */
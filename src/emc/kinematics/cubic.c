@@ -91,6 +91,53 @@ static double interpolateJerk(CUBIC_COEFF coeff, double t)
     return 6.0 * coeff.a;
 }
 
+/*
+   quinticCoeff calculates the powers of u, from u^0 up, of the uniform
+   quintic B-spline segment with control points p[0..5], for u from 0
+   at the start of the segment to 1 at its end.  Neighbouring segments
+   meet with equal derivatives up to the fourth, so the jerk has no
+   steps at the points.
+*/
+static void quinticCoeff(const double *p, double *q)
+{
+    q[0] = (p[0] + 26.0 * p[1] + 66.0 * p[2] + 26.0 * p[3] + p[4]) / 120.0;
+    q[1] = (-5.0 * p[0] - 50.0 * p[1] + 50.0 * p[3] + 5.0 * p[4]) / 120.0;
+    q[2] = (10.0 * p[0] + 20.0 * p[1] - 60.0 * p[2] + 20.0 * p[3]
+	    + 10.0 * p[4]) / 120.0;
+    q[3] = (-10.0 * p[0] + 20.0 * p[1] - 20.0 * p[3] + 10.0 * p[4]) / 120.0;
+    q[4] = (5.0 * p[0] - 20.0 * p[1] + 30.0 * p[2] - 20.0 * p[3]
+	    + 5.0 * p[4]) / 120.0;
+    q[5] = (-p[0] + 5.0 * p[1] - 10.0 * p[2] + 10.0 * p[3] - 5.0 * p[4]
+	    + p[5]) / 120.0;
+}
+
+/*
+   Interpolate position and its derivatives on a quintic segment at u,
+   the derivatives per unit of u
+*/
+static double interpolateQuintic(const double *q, double u)
+{
+    return ((((q[5] * u + q[4]) * u + q[3]) * u + q[2]) * u + q[1]) * u
+	+ q[0];
+}
+
+static double interpolateQuinticVel(const double *q, double u)
+{
+    return (((5.0 * q[5] * u + 4.0 * q[4]) * u + 3.0 * q[3]) * u
+	    + 2.0 * q[2]) * u + q[1];
+}
+
+static double interpolateQuinticAccel(const double *q, double u)
+{
+    return ((20.0 * q[5] * u + 12.0 * q[4]) * u + 6.0 * q[3]) * u
+	+ 2.0 * q[2];
+}
+
+static double interpolateQuinticJerk(const double *q, double u)
+{
+    return (60.0 * q[5] * u + 24.0 * q[4]) * u + 6.0 * q[3];
+}
+
 /*
    Calculate the cubic spline way point, given a point and its
    previous and successive neighbors
@@ -120,6 +167,7 @@ int cubicInit(CUBIC_STRUCT * ci)
     }
 
     ci->configured = 0;
+    ci->order = CUBIC_ORDER_CUBIC;
     ci->segmentTime = 0.0;
     ci->interpolationRate = 0;
     ci->interpolationIncrement = 0.0;
@@ -178,6 +226,27 @@ int cubicGetInterpolationRate(CUBIC_STRUCT * ci)
     return ci->interpolationRate;
 }
 
+/*
+  cubicSetOrder(CUBIC_STRUCT * ci, int order)
+
+  Selects the cubic or the quintic B-spline.  The quintic one keeps the
+  jerk continuous where the cubic one has steps in it at every point,
+  which matters most when the points come at a low rate, at the cost of
+  one more segment of delay.  Drains the interpolator.
+*/
+int cubicSetOrder(CUBIC_STRUCT * ci, int order)
+{
+    if (0 == ci
+	|| (order != CUBIC_ORDER_CUBIC && order != CUBIC_ORDER_QUINTIC)) {
+	return -1;
+    }
+
+    ci->order = order;
+    cubicDrain(ci);
+
+    return 0;
+}
+
 double cubicGetInterpolationIncrement(CUBIC_STRUCT * ci)
 {
     if (0 == ci || ci->configured != ALL_SET) {
@@ -216,6 +285,9 @@ CUBIC_COEFF cubicGetCubicCoeff(CUBIC_STRUCT * ci)
   is done between the second and third input point, and this filling
   is required so that the output interpolation matches with the input
   points.
+
+  The quintic interpolator works the same way on a queue of six points,
+  interpolating between the third and the fourth.
 */
 int cubicAddPoint(CUBIC_STRUCT * ci, double point)
 {
@@ -232,7 +304,16 @@ int cubicAddPoint(CUBIC_STRUCT * ci, double point)
 	ci->x1 = point;
 	ci->x2 = point;
 	ci->x3 = point;
+	ci->x4 = point;
+	ci->x5 = point;
 	ci->filled = 1;
+    } else if (ci->order == CUBIC_ORDER_QUINTIC) {
+	ci->x0 = ci->x1;
+	ci->x1 = ci->x2;
+	ci->x2 = ci->x3;
+	ci->x3 = ci->x4;
+	ci->x4 = ci->x5;
+	ci->x5 = point;
     } else {
 	ci->x0 = ci->x1;
 	ci->x1 = ci->x2;
@@ -240,6 +321,22 @@ int cubicAddPoint(CUBIC_STRUCT * ci, double point)
 	ci->x3 = point;
     }
 
+    if (ci->order == CUBIC_ORDER_QUINTIC) {
+	double p[6];
+
+	p[0] = ci->x0;
+	p[1] = ci->x1;
+	p[2] = ci->x2;
+	p[3] = ci->x3;
+	p[4] = ci->x4;
+	p[5] = ci->x5;
+	quinticCoeff(p, ci->quintic);
+	ci->interpolationTime = 0.0;
+	ci->needNextPoint = 0;
+
+	return 0;
+    }
+
     /* calculate way points and coeff */
     ci->wp0 = wayPoint(ci->x0, ci->x1, ci->x2);
     ci->wp1 = wayPoint(ci->x1, ci->x2, ci->x3);
@@ -272,6 +369,8 @@ int cubicOffset(CUBIC_STRUCT * ci, double offset)
     ci->x1 += offset;
     ci->x2 += offset;
     ci->x3 += offset;
+    ci->x4 += offset;
+    ci->x5 += offset;
     ci->wp0 += offset;
     ci->wp1 += offset;
 
@@ -280,6 +379,7 @@ int cubicOffset(CUBIC_STRUCT * ci, double offset)
 
     /* only the D coeff is affected, so we can change this directly */
     ci->coeff.d += offset;
+    ci->quintic[0] += offset;
 
     return 0;
 }
@@ -304,24 +404,41 @@ double cubicInterpolate(CUBIC_STRUCT * ci,
 
     if (ci->needNextPoint) {
 	/* queue ran out-- fill right with last point */
-	cubicAddPoint(ci, ci->x3);
+	cubicAddPoint(ci,
+	    ci->order == CUBIC_ORDER_QUINTIC ? ci->x5 : ci->x3);
     }
 
-    retval = interpolateCubic(ci->coeff, ci->interpolationTime);
+    if (ci->order == CUBIC_ORDER_QUINTIC) {
+	double u = ci->interpolationTime / ci->segmentTime;
+	double s = 1.0 / ci->segmentTime;
+
+	retval = interpolateQuintic(ci->quintic, u);
+	if (v != 0) {
+	    *v = interpolateQuinticVel(ci->quintic, u) * s;
+	}
+	if (a != 0) {
+	    *a = interpolateQuinticAccel(ci->quintic, u) * s * s;
+	}
+	if (j != 0) {
+	    *j = interpolateQuinticJerk(ci->quintic, u) * s * s * s;
+	}
+    } else {
+	retval = interpolateCubic(ci->coeff, ci->interpolationTime);
 
-    /* do optional ones */
+	/* do optional ones */
+	if (v != 0) {
+	    *v = interpolateVel(ci->coeff, ci->interpolationTime);
+	}
+	if (a != 0) {
+	    *a = interpolateAccel(ci->coeff, ci->interpolationTime);
+	}
+	if (j != 0) {
+	    *j = interpolateJerk(ci->coeff, ci->interpolationTime);
+	}
+    }
     if (x != 0) {
 	*x = retval;
     }
-    if (v != 0) {
-	*v = interpolateVel(ci->coeff, ci->interpolationTime);
-    }
-    if (a != 0) {
-	*a = interpolateAccel(ci->coeff, ci->interpolationTime);
-    }
-    if (j != 0) {
-	*j = interpolateJerk(ci->coeff, ci->interpolationTime);
-    }
 
     ci->interpolationTime += ci->interpolationIncrement;
 
@@ -342,7 +459,10 @@ int cubicNeedNextPoint(CUBIC_STRUCT * ci)
 
 int cubicDrain(CUBIC_STRUCT * ci)
 {
+    int i;
+
     ci->x0 = ci->x1 = ci->x2 = ci->x3 = 0.0;
+    ci->x4 = ci->x5 = 0.0;
     ci->wp0 = ci->wp1 = 0.0;
     ci->velp0 = ci->velp1 = 0.0;
     ci->filled = 0;
@@ -351,6 +471,9 @@ int cubicDrain(CUBIC_STRUCT * ci)
     ci->coeff.b = 0.0;
     ci->coeff.c = 0.0;
     ci->coeff.d = 0.0;
+    for (i = 0; i < 6; i++) {
+	ci->quintic[i] = 0.0;
+    }
 
     return 0;
 }
@@ -360,7 +483,7 @@ int cubicDrain(CUBIC_STRUCT * ci)
 #include <stdio.h>
 
 /*
-  syntax: testcubic <segment time> <interpolation rate>
+  syntax: testcubic <segment time> <interpolation rate> [<order>]
 */
 int main(int argc, char *argv[])
 {
@@ -370,9 +493,10 @@ int main(int argc, char *argv[])
     double xin;
     double xout;
     double time = 0.0;
+    int order = CUBIC_ORDER_CUBIC;
 
-    if (argc != 3) {
-	fprintf(stderr, "syntax: %s <segment time> <interpolation rate>\n",
+    if (argc != 3 && argc != 4) {
+	fprintf(stderr, "syntax: %s <segment time> <interpolation rate> [<order>]\n",
 		argv[0]);
 	return 1;
     }
@@ -403,6 +527,12 @@ int main(int argc, char *argv[])
 	return 1;
     }
 
+    if (argc == 4 && (1 != sscanf(argv[3], "%d", &order)
+		      || 0 != cubicSetOrder(&cubic, order))) {
+	fprintf(stderr, "invalid order %s, 3 or 5\n", argv[3]);
+	return 1;
+    }
+
     while (!feof(stdin)) {
 	if (cubicNeedNextPoint(&cubic)) {
 	    if (1 != scanf("%lf", &xin)) {
@@ -26,18 +26,26 @@ typedef struct {
     double d;
 } CUBIC_COEFF;
 
+/* cubicSetOrder(): the cubic B-spline, continuous in acceleration, or
+   the quintic one, continuous up to the derivative of jerk */
+#define CUBIC_ORDER_CUBIC 3
+#define CUBIC_ORDER_QUINTIC 5
+
 typedef struct {
     int configured;
+    int order;			/* CUBIC_ORDER_CUBIC or CUBIC_ORDER_QUINTIC */
     double segmentTime;
     int interpolationRate;
     double interpolationTime;
     double interpolationIncrement;
     double x0, x1, x2, x3;
+    double x4, x5;		/* the rest of the quintic window */
     double wp0, wp1;
     double velp0, velp1;
     int filled;
     int needNextPoint;
     CUBIC_COEFF coeff;
+    double quintic[6];		/* quintic segment, powers of the fraction done */
 } CUBIC_STRUCT;
 
 extern int cubicInit(CUBIC_STRUCT * ci);
@@ -45,6 +53,7 @@ extern int cubicSetSegmentTime(CUBIC_STRUCT * ci, double time);
 extern double cubicGetSegmentTime(CUBIC_STRUCT * ci);
 extern int cubicSetInterpolationRate(CUBIC_STRUCT * ci, int rate);
 extern int cubicGetInterpolationRate(CUBIC_STRUCT * ci);
+extern int cubicSetOrder(CUBIC_STRUCT * ci, int order);
 extern int cubicAddPoint(CUBIC_STRUCT * ci, double point);
 extern int cubicOffset(CUBIC_STRUCT * ci, double offset);
 extern double cubicGetInterpolationIncrement(CUBIC_STRUCT * ci);
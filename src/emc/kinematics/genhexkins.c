@@ -106,10 +106,11 @@
  ----------------------------------------------------------------------------*/
 
 #include "rtapi_math.h"
-#include "posemath.h"
+#include "posemath_inline.h"
 #include "genhexkins.h"
 #include "kinematics.h"             /* these decls, KINEMATICS_FORWARD_FLAGS */
 #include "hal.h"
+#include "rtapi_string.h"      /* memcpy() */
 
 struct haldata {
     hal_float_t basex[NUM_STRUTS];
@@ -136,107 +137,97 @@ struct haldata {
 } *haldata;
 
 
-/******************************* MatInvert() ***************************/
+/****************************** MatLUDecomp() *****************************/
 
 /*-----------------------------------------------------------------------------
- This is a function that inverts a 6x6 matrix.
+  This function factors a 6x6 matrix in place into L*U, with partial
+  pivoting; piv[] records the row swaps.  All loops have fixed bounds so
+  the compiler can unroll and vectorize them.  Returns -1 if the matrix
+  is singular.
 -----------------------------------------------------------------------------*/
 
-static int MatInvert(double J[][NUM_STRUTS], double InvJ[][NUM_STRUTS])
+static int MatLUDecomp(double A[][NUM_STRUTS], int piv[])
 {
-  double JAug[NUM_STRUTS][12], m, temp;
-  int j, k, n;
-
-  /* This function determines the inverse of a 6x6 matrix using
-     Gauss-Jordan elimination */
-
-  /* Augment the Identity matrix to the Jacobian matrix */
-
-  for (j=0; j<=5; ++j){
-    for (k=0; k<=5; ++k){     /* Assign J matrix to first 6 columns of AugJ */
-      JAug[j][k] = J[j][k];
-    }
-    for(k=6; k<=11; ++k){    /* Assign I matrix to last six columns of AugJ */
-      if (k-6 == j){
-        JAug[j][k]=1;
-      }
-      else{
-        JAug[j][k]=0;
+  double m, temp;
+  int j, k, n, p;
+
+  for (k = 0; k < NUM_STRUTS; ++k) {
+    /* pick the largest pivot in column k */
+    p = k;
+    for (j = k + 1; j < NUM_STRUTS; ++j) {
+      if (fabs(A[j][k]) > fabs(A[p][k])) {
+        p = j;
       }
     }
-  }
-
-  /* Perform Gauss elimination */
-  for (k=0; k<=4; ++k){               /* Pivot        */
-    if ((JAug[k][k]< 0.01) && (JAug[k][k] > -0.01)){
-      for (j=k+1;j<=5; ++j){
-        if ((JAug[j][k]>0.01) || (JAug[j][k]<-0.01)){
-          for (n=0; n<=11;++n){
-            temp = JAug[k][n];
-            JAug[k][n] = JAug[j][n];
-            JAug[j][n] = temp;
-          }
-          break;
-        }
-      }
+    piv[k] = p;
+    if (A[p][k] == 0.0) {
+      return -1;
     }
-    for (j=k+1; j<=5; ++j){            /* Pivot */
-      m = -JAug[j][k] / JAug[k][k];
-      for (n=0; n<=11; ++n){
-        JAug[j][n]=JAug[j][n] + m*JAug[k][n];   /* (Row j) + m * (Row k) */
-        if ((JAug[j][n] < 0.000001) && (JAug[j][n] > -0.000001)){
-          JAug[j][n] = 0;
-        }
+    if (p != k) {
+      for (n = 0; n < NUM_STRUTS; ++n) {
+        temp = A[k][n];
+        A[k][n] = A[p][n];
+        A[p][n] = temp;
       }
     }
-  }
-
-  /* Normalization of Diagonal Terms */
-  for (j=0; j<=5; ++j){
-    m=1/JAug[j][j];
-    for(k=0; k<=11; ++k){
-      JAug[j][k] = m * JAug[j][k];
-    }
-  }
-
-  /* Perform Gauss Jordan Steps */
-  for (k=5; k>=0; --k){
-    for(j=k-1; j>=0; --j){
-      m = -JAug[j][k]/JAug[k][k];
-      for (n=0; n<=11; ++n){
-        JAug[j][n] = JAug[j][n] + m * JAug[k][n];
+    for (j = k + 1; j < NUM_STRUTS; ++j) {
+      m = A[j][k] / A[k][k];
+      A[j][k] = m;
+      for (n = k + 1; n < NUM_STRUTS; ++n) {
+        A[j][n] -= m * A[k][n];
       }
     }
   }
-
-  /* Assign last 6 columns of JAug to InvJ */
-  for (j=0; j<=5; ++j){
-    for (k=0; k<=5; ++k){
-      InvJ[j][k] = JAug[j][k+6];
-
-    }
-  }
-
-  return 0;         /* FIXME-- check divisors for 0 above */
+  return 0;
 }
 
-/******************************** MatMult() *********************************/
+/****************************** MatLUSolve() *******************************/
 
-/*---------------------------------------------------------------------------
-  This function simply multiplies a 6x6 matrix by a 1x6 vector
-  ---------------------------------------------------------------------------*/
+/*-----------------------------------------------------------------------------
+  This function solves LU*x = b for the factors left by MatLUDecomp().
+-----------------------------------------------------------------------------*/
 
-static void MatMult(double J[][6], const double x[], double Ans[])
+static void MatLUSolve(double LU[][NUM_STRUTS], const int piv[],
+                       const double b[], double x[])
 {
+  double temp;
   int j, k;
-  for (j=0; j<=5; ++j){
-    Ans[j] = 0;
-    for (k=0; k<=5; ++k){
-      Ans[j] = J[j][k]*x[k]+Ans[j];
+
+  for (j = 0; j < NUM_STRUTS; ++j) {
+    x[j] = b[j];
+  }
+  /* apply the row swaps */
+  for (k = 0; k < NUM_STRUTS; ++k) {
+    temp = x[piv[k]];
+    x[piv[k]] = x[k];
+    x[k] = temp;
+  }
+  /* forward substitution */
+  for (k = 0; k < NUM_STRUTS; ++k) {
+    for (j = k + 1; j < NUM_STRUTS; ++j) {
+      x[j] -= LU[j][k] * x[k];
+    }
+  }
+  /* back substitution */
+  for (k = NUM_STRUTS - 1; k >= 0; --k) {
+    for (j = k + 1; j < NUM_STRUTS; ++j) {
+      x[k] -= LU[k][j] * x[j];
     }
+    x[k] /= LU[k][k];
   }
 }
 
+/* The factored inverse Jacobian is kept from one iteration, and one
+   call, to the next.  It is only refactored when the error did not
+   drop by at least REFACTOR_RATIO in the last iteration; close to the
+   solution, as on consecutive servo cycles, the old factors give
+   steps nearly as good as new ones. */
+#define REFACTOR_RATIO 0.1
+
+static double JacobianLU[NUM_STRUTS][NUM_STRUTS];
+static int JacobianPiv[NUM_STRUTS];
+static int JacobianLUValid = 0;
+
 /* declare arrays for base and platform coordinates */
 static PmCartesian b[NUM_STRUTS];
 static PmCartesian a[NUM_STRUTS];
@@ -312,11 +303,11 @@ int kinematicsForward(const double * joints,
   PmCartesian InvKinStrutVect,InvKinStrutVectUnit;
   PmCartesian q_trans, RMatrix_a, RMatrix_a_cross_Strut;
 
-  double Jacobian[NUM_STRUTS][NUM_STRUTS];
   double InverseJacobian[NUM_STRUTS][NUM_STRUTS];
   double InvKinStrutLength, StrutLengthDiff[NUM_STRUTS];
   double delta[NUM_STRUTS];
   double conv_err = 1.0;
+  double last_err = 0.0;
   double corr;
 
   PmRotationMatrix RMatrix;
@@ -356,6 +347,7 @@ int kinematicsForward(const double * joints,
     if ((conv_err > +(haldata->max_error)) ||
     (conv_err < -(haldata->max_error))) {
       /* we can't converge */
+      JacobianLUValid = 0;
       return -2;
     };
 
@@ -365,6 +357,7 @@ int kinematicsForward(const double * joints,
        convergence criterion and return error flag if it can't */
     if (iteration > haldata->iter_limit) {
       /* we can't converge */
+      JacobianLUValid = 0;
       return -5;
     }
 
@@ -404,11 +397,27 @@ int kinematicsForward(const double * joints,
       InverseJacobian[i][5] = RMatrix_a_cross_Strut.z;
     }
 
-    /* invert Inverse Jacobian */
-    MatInvert(InverseJacobian, Jacobian);
+    /* determine value of conv_error (used to determine if no convergence) */
+    last_err = conv_err;
+    conv_err = 0.0;
+    for (i = 0; i < NUM_STRUTS; i++) {
+      conv_err += fabs(StrutLengthDiff[i]);
+    }
 
-    /* multiply Jacobian by LegLengthDiff */
-    MatMult(Jacobian, StrutLengthDiff, delta);
+    /* factor the Inverse Jacobian again unless the last step with the
+       old factors converged well */
+    if (!JacobianLUValid ||
+        (iteration > 1 && conv_err > REFACTOR_RATIO * last_err)) {
+      if (0 != MatLUDecomp(InverseJacobian, JacobianPiv)) {
+        JacobianLUValid = 0;
+        return -1;
+      }
+      memcpy(JacobianLU, InverseJacobian, sizeof(JacobianLU));
+      JacobianLUValid = 1;
+    }
+
+    /* solve Inverse Jacobian * delta = LegLengthDiff */
+    MatLUSolve(JacobianLU, JacobianPiv, StrutLengthDiff, delta);
 
     /* subtract delta from last iterations pos values */
     q_trans.x -= delta[0];
@@ -418,12 +427,6 @@ int kinematicsForward(const double * joints,
     q_RPY.p   -= delta[4];
     q_RPY.y   -= delta[5];
 
-    /* determine value of conv_error (used to determine if no convergence) */
-    conv_err = 0.0;
-    for (i = 0; i < NUM_STRUTS; i++) {
-      conv_err += fabs(StrutLengthDiff[i]);
-    }
-
     /* enter loop to determine if a strut needs another iteration */
     iterate = 0;            /*assume iteration is done */
     for (i = 0; i < NUM_STRUTS; i++) {
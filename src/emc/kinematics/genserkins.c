@@ -27,7 +27,6 @@
   TODO:
     * make number of joints a loadtime parameter
     * add HAL pins for all settable parameters, including joint type: ANGULAR / LINEAR
-    * add HAL pins for debug data (num_iterations)
     * add HAL pins for ULAPI compiled version
 */
 
@@ -48,9 +47,18 @@ struct haldata {
     hal_float_t *alpha[GENSER_MAX_JOINTS];
     hal_float_t *d[GENSER_MAX_JOINTS];
     hal_s32_t   unrotate[GENSER_MAX_JOINTS];
+    hal_bit_t   dls;		// use the warm-started damped least-squares solver
+    hal_float_t damping;	// its damping factor
+    hal_s32_t   *ik_iterations;	// iterations used by the last inverse
+    hal_s32_t   *ik_time;	// and the time it took, in ns
     genser_struct *kins;
     go_pose *pos;		// used in various functions, we malloc it
 				// only once in rtapi_app_main
+    // the last two solutions of the DLS solver, for the warm start
+    int warm;			// how many of them are valid
+    go_real jlast[GENSER_MAX_JOINTS];
+    go_real jlast2[GENSER_MAX_JOINTS];
+    double jout[GENSER_MAX_JOINTS];	// joints[] as returned with jlast
 } *haldata = 0;
 
 double j[GENSER_MAX_JOINTS];
@@ -66,6 +74,7 @@ double j[GENSER_MAX_JOINTS];
 #endif
 
 enum { GENSER_DEFAULT_MAX_ITERATIONS = 100 };
+#define GENSER_DEFAULT_DAMPING 0.01
 
 int genser_kin_init(void) {
     genser_struct *genser = KINS_PTR;
@@ -387,12 +396,74 @@ int genser_kin_fwd(void *kins, const go_real * joints, go_pose * pos)
     return GO_RESULT_OK;
 }
 
-int kinematicsInverse(const EmcPose * world,
-		      double *joints,
-		      const KINEMATICS_INVERSE_FLAGS * iflags,
-		      KINEMATICS_FORWARD_FLAGS * fflags)
+/* dvw is the Cartesian differential that takes the pose estimate pest to
+   pos, in the 0 frame */
+static void compute_dvw(const go_pose * pest, const go_pose * pos, go_real * dvw)
+{
+    go_pose pestinv, Tdelta;
+    go_rvec rvec;
+    go_cart cart;
+
+    /* pestinv is its inverse */
+    go_pose_inv(pest, &pestinv);
+    /*
+	Tdelta is the incremental pose from pest to pos, such that
+
+	0        L         0
+	. pest *  Tdelta =  pos, or
+	L        L         L
+
+	L         L          0
+	.Tdelta =  pestinv *  pos
+	L         0          L
+    */
+    go_pose_pose_mult(&pestinv, pos, &Tdelta);
+
+    /*
+	We need Tdelta in 0 frame, not pest frame, so rotate it
+	back. Since it's effectively a velocity, we just rotate it, and
+	don't translate it.
+    */
+
+    /* first rotate the translation differential */
+    go_quat_cart_mult(&pest->rot, &Tdelta.tran, &cart);
+    dvw[0] = cart.x;
+    dvw[1] = cart.y;
+    dvw[2] = cart.z;
+
+    /* to rotate the rotation differential, convert it to a
+	velocity screw and rotate that */
+    go_quat_rvec_convert(&Tdelta.rot, &rvec);
+    cart.x = rvec.x;
+    cart.y = rvec.y;
+    cart.z = rvec.z;
+    go_quat_cart_mult(&pest->rot, &cart, &cart);
+    dvw[3] = cart.x;
+    dvw[4] = cart.y;
+    dvw[5] = cart.z;
+}
+
+/* check for small joint increments */
+static int joint_steps_small(const go_link * linkout, int link_num, const go_real * dj)
 {
+    int link;
+
+    for (link = 0; link < link_num; link++) {
+	if (GO_QUANTITY_LENGTH == linkout[link].quantity) {
+	    if (!GO_TRAN_SMALL(dj[link]))
+		return 0;
+	} else {
+	    if (!GO_ROT_SMALL(dj[link]))
+		return 0;
+	}
+    }
+    return 1;
+}
 
+/* Newton iteration from the current joints, inverting the Jacobian on
+   every step */
+static int inverse_newton(double *joints)
+{
     genser_struct *genser = KINS_PTR;
     GO_MATRIX_DECLARE(Jfwd, Jfwd_stg, 6, GENSER_MAX_JOINTS);
     GO_MATRIX_DECLARE(Jinv, Jinv_stg, GENSER_MAX_JOINTS, 6);
@@ -400,30 +471,11 @@ int kinematicsInverse(const EmcPose * world,
     go_real dvw[6];
     go_real jest[GENSER_MAX_JOINTS];
     go_real dj[GENSER_MAX_JOINTS];
-    go_pose pest, pestinv, Tdelta;	// pos = converted pose from EmcPose
-    go_rpy rpy;
-    go_rvec rvec;
-    go_cart cart;
+    go_pose pest;
     go_link linkout[GENSER_MAX_JOINTS];
     int link;
-    int smalls;
     int retval;
 
-//    rtapi_print("kineInverse(joints: %f %f %f %f %f %f)\n", joints[0],joints[1],joints[2],joints[3],joints[4],joints[5]);
-//    rtapi_print("kineInverse(world: %f %f %f %f %f %f)\n", world->tran.x, world->tran.y, world->tran.z, world->a, world->b, world->c);
-
-//    genser_kin_init();
-    
-    // FIXME-AJ: rpy or zyx ?
-    rpy.y = world->c * PM_PI / 180;
-    rpy.p = world->b * PM_PI / 180;
-    rpy.r = world->a * PM_PI / 180;
-
-    go_rpy_quat_convert(&rpy, &haldata->pos->rot);
-    haldata->pos->tran.x = world->tran.x;
-    haldata->pos->tran.y = world->tran.y;
-    haldata->pos->tran.z = world->tran.z;
-
     go_matrix_init(Jfwd, Jfwd_stg, 6, genser->link_num);
     go_matrix_init(Jinv, Jinv_stg, genser->link_num, 6);
 
@@ -452,58 +504,13 @@ int kinematicsInverse(const EmcPose * world,
 	/* pest is the resulting pose estimate given joint estimate */
 	genser_kin_fwd(KINS_PTR, jest, &pest);
 //	printf("jest: %f %f %f %f %f %f\n",jest[0],jest[1],jest[2],jest[3],jest[4],jest[5]);
-	/* pestinv is its inverse */
-	go_pose_inv(&pest, &pestinv);
-	/*
-	    Tdelta is the incremental pose from pest to pos, such that
-
-	    0        L         0
-	    . pest *  Tdelta =  pos, or
-	    L        L         L
-
-	    L         L          0
-	    .Tdelta =  pestinv *  pos
-	    L         0          L
-	*/
-	go_pose_pose_mult(&pestinv, haldata->pos, &Tdelta);
-
-	/*
-	    We need Tdelta in 0 frame, not pest frame, so rotate it
-    	    back. Since it's effectively a velocity, we just rotate it, and
-    	    don't translate it.
-        */
-
-        /* first rotate the translation differential */
-        go_quat_cart_mult(&pest.rot, &Tdelta.tran, &cart);
-        dvw[0] = cart.x;
-        dvw[1] = cart.y;
-        dvw[2] = cart.z;
-
-        /* to rotate the rotation differential, convert it to a
-    	    velocity screw and rotate that */
-        go_quat_rvec_convert(&Tdelta.rot, &rvec);
-        cart.x = rvec.x;
-        cart.y = rvec.y;
-        cart.z = rvec.z;
-        go_quat_cart_mult(&pest.rot, &cart, &cart);
-        dvw[3] = cart.x;
-        dvw[4] = cart.y;
-        dvw[5] = cart.z;
+	compute_dvw(&pest, haldata->pos, dvw);
 
 	/* push the Cartesian velocity vector through the inverse Jacobian */
 	go_matrix_vector_mult(&Jinv, dvw, dj);
 
 	/* check for small joint increments, if so we're done */
-	for (link = 0, smalls = 0; link < genser->link_num; link++) {
-	    if (GO_QUANTITY_LENGTH == linkout[link].quantity) {
-		if (GO_TRAN_SMALL(dj[link]))
-		    smalls++;
-	    } else {
-		if (GO_ROT_SMALL(dj[link]))
-		    smalls++;
-	    }
-	}
-	if (smalls == genser->link_num) {
+	if (joint_steps_small(linkout, genser->link_num, dj)) {
 	    /* converged, copy jest[] out */
 	    for (link = 0; link < genser->link_num; link++) {
 		// convert from radians back to angles
@@ -524,6 +531,227 @@ int kinematicsInverse(const EmcPose * world,
     return GO_RESULT_ERROR;
 }
 
+/* Damped least-squares step: dj = JT (J JT + lambda^2 I)inv dvw.  The
+   6x6 system is solved by Cholesky decomposition on the stack instead
+   of inverting the Jacobian; the damping keeps the step bounded near
+   singular poses, where the plain inverse blows up. */
+static int dls_step(go_matrix * J, go_real lambda, const go_real * dvw, go_real * dj)
+{
+    go_real L[6][6];
+    go_real y[6];
+    go_real sum;
+    int n = J->cols;
+    int row, col, k;
+
+    /* L = J JT + lambda^2 I, lower triangle only */
+    for (row = 0; row < 6; row++) {
+	for (col = 0; col <= row; col++) {
+	    sum = (row == col) ? lambda * lambda : 0;
+	    for (k = 0; k < n; k++)
+		sum += J->el[row][k] * J->el[col][k];
+	    L[row][col] = sum;
+	}
+    }
+    /* factor it in place into L LT */
+    for (row = 0; row < 6; row++) {
+	for (col = 0; col <= row; col++) {
+	    sum = L[row][col];
+	    for (k = 0; k < col; k++)
+		sum -= L[row][k] * L[col][k];
+	    if (row == col) {
+		if (sum <= 0)
+		    return GO_RESULT_SINGULAR;
+		L[row][row] = sqrt(sum);
+	    } else {
+		L[row][col] = sum / L[col][col];
+	    }
+	}
+    }
+    /* solve L LT y = dvw */
+    for (row = 0; row < 6; row++) {
+	sum = dvw[row];
+	for (k = 0; k < row; k++)
+	    sum -= L[row][k] * y[k];
+	y[row] = sum / L[row][row];
+    }
+    for (row = 5; row >= 0; row--) {
+	sum = y[row];
+	for (k = row + 1; k < 6; k++)
+	    sum -= L[k][row] * y[k];
+	y[row] = sum / L[row][row];
+    }
+    /* dj = JT y */
+    for (k = 0; k < n; k++) {
+	sum = 0;
+	for (row = 0; row < 6; row++)
+	    sum += J->el[row][k] * y[row];
+	dj[k] = sum;
+    }
+    return GO_RESULT_OK;
+}
+
+/* damped least-squares iteration from jest; the pose that compute_jfwd()
+   builds along with the Jacobian is the forward kinematics of jest, so
+   it is not computed a second time */
+static int dls_iterate(go_real * jest, int max_iterations, int *iterations)
+{
+    genser_struct *genser = KINS_PTR;
+    GO_MATRIX_DECLARE(Jfwd, Jfwd_stg, 6, GENSER_MAX_JOINTS);
+    go_pose pest;
+    go_real dvw[6];
+    go_real dj[GENSER_MAX_JOINTS];
+    go_link linkout[GENSER_MAX_JOINTS];
+    int link;
+    int retval;
+
+    go_matrix_init(Jfwd, Jfwd_stg, 6, genser->link_num);
+
+    for (; *iterations < max_iterations; (*iterations)++) {
+	for (link = 0; link < genser->link_num; link++) {
+	    go_link_joint_set(&genser->links[link], jest[link], &linkout[link]);
+	}
+	retval = compute_jfwd(linkout, genser->link_num, &Jfwd, &pest);
+	if (GO_RESULT_OK != retval)
+	    return retval;
+	compute_dvw(&pest, haldata->pos, dvw);
+	retval = dls_step(&Jfwd, haldata->damping, dvw, dj);
+	if (GO_RESULT_OK != retval)
+	    return retval;
+	if (joint_steps_small(linkout, genser->link_num, dj))
+	    return GO_RESULT_OK;
+	for (link = 0; link < genser->link_num; link++) {
+	    jest[link] += dj[link];
+	}
+    }
+    return GO_RESULT_ERROR;
+}
+
+/* The DLS solver starts from the solution of the previous cycle,
+   extrapolated by the velocity between the two previous solutions, as
+   long as the caller passes back the joints it was given last time.
+   That is what motion does each servo cycle, and the extrapolated start
+   is usually within an iteration or two of the answer.  If it fails to
+   converge, the current joints are tried as well. */
+static int inverse_dls(double *joints)
+{
+    genser_struct *genser = KINS_PTR;
+    go_real jest[GENSER_MAX_JOINTS];
+    int link;
+    int warm = haldata->warm;
+    int iterations = 0;
+    int retval;
+
+    genser_kin_init();
+
+    for (link = 0; link < genser->link_num && warm; link++) {
+	if (fabs(joints[link] - haldata->jout[link]) > 1e-9)
+	    warm = 0;
+    }
+
+    retval = GO_RESULT_ERROR;
+    if (warm) {
+	for (link = 0; link < genser->link_num; link++) {
+	    jest[link] = haldata->jlast[link];
+	    if (warm > 1)
+		jest[link] += haldata->jlast[link] - haldata->jlast2[link];
+	}
+	retval = dls_iterate(jest, genser->max_iterations, &iterations);
+	if (GO_RESULT_OK != retval)
+	    warm = 0;
+    }
+    if (!warm) {
+	for (link = 0; link < genser->link_num; link++) {
+	    jest[link] = joints[link] * (PM_PI / 180);
+	}
+	retval = dls_iterate(jest, iterations + genser->max_iterations,
+	    &iterations);
+    }
+    genser->iterations = iterations;
+    if (GO_RESULT_OK != retval) {
+	haldata->warm = 0;
+	rtapi_print("ERRkineInverse(joints: %f %f %f %f %f %f), (iterations=%d)\n", joints[0],joints[1],joints[2],joints[3],joints[4],joints[5], genser->iterations);
+	return retval;
+    }
+
+    for (link = 0; link < genser->link_num; link++) {
+	haldata->jlast2[link] = haldata->jlast[link];
+	haldata->jlast[link] = jest[link];
+	// convert from radians back to angles
+	joints[link] = jest[link] * 180 / PM_PI;
+	if ((link) && (haldata->unrotate[link]))
+	    joints[link] += (haldata->unrotate[link]) * joints[link-1];
+	haldata->jout[link] = joints[link];
+    }
+    /* a cold start only leaves one solution to extrapolate from */
+    haldata->warm = warm ? 2 : 1;
+    return GO_RESULT_OK;
+}
+
+int kinematicsInverse(const EmcPose * world,
+		      double *joints,
+		      const KINEMATICS_INVERSE_FLAGS * iflags,
+		      KINEMATICS_FORWARD_FLAGS * fflags)
+{
+    go_rpy rpy;
+    long long int start;
+    int retval;
+
+//    rtapi_print("kineInverse(joints: %f %f %f %f %f %f)\n", joints[0],joints[1],joints[2],joints[3],joints[4],joints[5]);
+//    rtapi_print("kineInverse(world: %f %f %f %f %f %f)\n", world->tran.x, world->tran.y, world->tran.z, world->a, world->b, world->c);
+
+//    genser_kin_init();
+
+    start = rtapi_get_time();
+
+    // FIXME-AJ: rpy or zyx ?
+    rpy.y = world->c * PM_PI / 180;
+    rpy.p = world->b * PM_PI / 180;
+    rpy.r = world->a * PM_PI / 180;
+
+    go_rpy_quat_convert(&rpy, &haldata->pos->rot);
+    haldata->pos->tran.x = world->tran.x;
+    haldata->pos->tran.y = world->tran.y;
+    haldata->pos->tran.z = world->tran.z;
+
+    if (haldata->dls) {
+	retval = inverse_dls(joints);
+    } else {
+	haldata->warm = 0;
+	retval = inverse_newton(joints);
+    }
+
+    *(haldata->ik_iterations) = KINS_PTR->iterations;
+    *(haldata->ik_time) = rtapi_get_time() - start;
+    return retval;
+}
+
+/* each pose starts from the solution of the one before it, which with
+   genserkins.dls set is also the warm start of inverse_dls() */
+int kinematicsInverseBatch(const EmcPose * world,
+			   double *joints, int num_joints, int count,
+			   const KINEMATICS_INVERSE_FLAGS * iflags,
+			   KINEMATICS_FORWARD_FLAGS * fflags)
+{
+    double *row;
+    int k, link;
+
+    if (num_joints < KINS_PTR->link_num) {
+	return 0;
+    }
+    for (k = 0; k < count; k++) {
+	row = joints + k * num_joints;
+	if (k > 0) {
+	    for (link = 0; link < num_joints; link++) {
+		row[link] = row[link - num_joints];
+	    }
+	}
+	if (0 != kinematicsInverse(&world[k], row, iflags, fflags)) {
+	    break;
+	}
+    }
+    return k;
+}
+
 /*
   Extras, not callable using go_kin_ wrapper but if you know you have
   linked in these kinematics, go ahead and call these for your ad hoc
@@ -569,6 +797,7 @@ KINEMATICS_TYPE kinematicsType()
 EXPORT_SYMBOL(kinematicsType);
 EXPORT_SYMBOL(kinematicsForward);
 EXPORT_SYMBOL(kinematicsInverse);
+EXPORT_SYMBOL(kinematicsInverseBatch);
 MODULE_LICENSE("GPL");
 
 int comp_id;
@@ -623,6 +852,24 @@ int rtapi_app_main(void)
 
     KINS_PTR->max_iterations = GENSER_DEFAULT_MAX_ITERATIONS;
 
+    if ((res=
+        hal_param_bit_newf(HAL_RW, &(haldata->dls), comp_id, "genserkins.dls")) < 0)
+        goto error;
+    if ((res=
+        hal_param_float_newf(HAL_RW, &(haldata->damping), comp_id, "genserkins.damping")) < 0)
+        goto error;
+    if ((res=
+        hal_pin_s32_newf(HAL_OUT, &(haldata->ik_iterations), comp_id, "genserkins.ik-iterations")) < 0)
+        goto error;
+    if ((res=
+        hal_pin_s32_newf(HAL_OUT, &(haldata->ik_time), comp_id, "genserkins.ik-time")) < 0)
+        goto error;
+    haldata->dls = 0;
+    haldata->damping = GENSER_DEFAULT_DAMPING;
+    *(haldata->ik_iterations) = 0;
+    *(haldata->ik_time) = 0;
+    haldata->warm = 0;
+
 
     A(0) = DEFAULT_A1;
     A(1) = DEFAULT_A2;
@@ -703,6 +950,11 @@ int main(int argc, char *argv[])
 	haldata->alpha[i] = malloc(sizeof(double));
 	haldata->d[i] = malloc(sizeof(double));
     }
+    haldata->ik_iterations = malloc(sizeof(hal_s32_t));
+    haldata->ik_time = malloc(sizeof(hal_s32_t));
+    haldata->dls = 0;
+    haldata->damping = GENSER_DEFAULT_DAMPING;
+    haldata->warm = 0;
     A(0) = DEFAULT_A1;
     A(1) = DEFAULT_A2;
     A(2) = DEFAULT_A3;
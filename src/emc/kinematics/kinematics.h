@@ -88,6 +88,21 @@ extern int kinematicsInverse(const struct EmcPose * world,
 			     const KINEMATICS_INVERSE_FLAGS * iflags,
 			     KINEMATICS_FORWARD_FLAGS * fflags);
 
+/* the batched inverse kinematics convert count poses along a path,
+   world[0] to world[count-1], into the joint rows joint[0..num_joints-1],
+   joint[num_joints..2*num_joints-1] and so on.  num_joints must be at
+   least the number of joints of the kinematics.  The first row holds
+   the starting joints on entry, as for kinematicsInverse().  Returns the
+   number of poses converted, which is less than count if the inverse of
+   world[returned value] failed.  This is optional: modules that don't
+   export it are called through kinematicsInverse() once per pose, and
+   only those that can carry something from one pose to the next, like
+   the starting point of an iterative solution, need to provide it. */
+extern int kinematicsInverseBatch(const struct EmcPose * world,
+				  double *joint, int num_joints, int count,
+				  const KINEMATICS_INVERSE_FLAGS * iflags,
+				  KINEMATICS_FORWARD_FLAGS * fflags);
+
 /* the home kinematics function sets all its arguments to their proper
    values at the known home position. When called, these should be set,
    when known, to initial values, e.g., from an INI file. If the home
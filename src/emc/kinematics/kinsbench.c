@@ -0,0 +1,393 @@
+/********************************************************************
+* Description: kinsbench.c
+*   Measures the cost of kinematicsForward() and kinematicsInverse()
+*   of the realtime kinematics modules.  Each module is loaded from
+*   the rtlib directory the way rtapi_app loads it, and moved along a
+*   path around a typical pose.  Prints the time per call as
+*   percentiles, the time per pose of kinematicsInverseBatch() over
+*   the whole path, and the largest round trip error (inverse, then
+*   forward, compared with the commanded pose).
+*
+*   syntax:  kinsbench [-n samples] [-e tolerance] [module...]
+*
+*   Without modules, all the modules in the table below are measured.
+*   With -e, the exit status is 1 if a call fails or a round trip
+*   error is larger than tolerance.  The realtime environment must be
+*   running ('realtime start' or halrun), since the modules create
+*   their pins in HAL.
+*
+* License: GPL Version 2
+* System: Linux (uspace)
+*
+********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <math.h>
+#include <dlfcn.h>
+
+#include "config.h"
+#include "emcpos.h"
+#include "emcmotcfg.h"		/* EMCMOT_MAX_JOINTS */
+#include "kinematics.h"
+#include "hal.h"
+
+#define NUM_COORDS 9		/* x y z a b c u v w */
+
+/* A path for one module.  The centre of the path is home: the joint
+   positions, or for parallel machines, whose forward kinematics need a
+   starting pose, the pose in x y z a b c u v w.  Each coordinate then
+   swings by amp on a different frequency, so the path is a Lissajous
+   figure that covers the work space around home instead of a single
+   line.  Coordinates with amp 0 stay where home puts them. */
+struct kins_path {
+    const char *module;
+    int home_is_pose;
+    double home[EMCMOT_MAX_JOINTS];
+    double amp[NUM_COORDS];
+};
+
+static const struct kins_path paths[] = {
+    { "trivkins", 0,
+      { 0, 0, 0, 0, 0, 0, 0, 0, 0 },
+      { 100, 100, 50, 30, 30, 30, 10, 10, 10 } },
+    { "5axiskins", 0,
+      { 0, 0, 0, 10, 0, 0 },
+      { 100, 100, 50, 0, 30, 90, 0, 0, 20 } },
+    { "xyzac-trt-kins", 0,
+      { 0, 0, 0, 10, 0 },
+      { 100, 100, 50, 30, 0, 90, 0, 0, 0 } },
+    { "genhexkins", 1,
+      { 0, 0, 20, 0, 0, 0 },
+      { 5, 5, 3, 5, 5, 5, 0, 0, 0 } },
+    { "genserkins", 0,
+      { 0, -30, 30, 0, 30, 0 },
+      { 50, 50, 50, 10, 10, 10, 0, 0, 0 } },
+    { "pumakins", 0,
+      { 0, -30, 30, 0, 30, 0 },
+      { 50, 50, 50, 10, 10, 10, 0, 0, 0 } },
+    { "scarakins", 0,
+      { 0, 90, 0, 0 },
+      { 50, 50, 20, 0, 0, 90, 0, 0, 0 } },
+    { "lineardeltakins", 1,
+      { 0, 0, 0 },
+      { 60, 60, 30, 0, 0, 0, 0, 0, 0 } },
+    { "rotarydeltakins", 0,
+      { 30, 30, 30 },
+      { 2, 2, 2, 0, 0, 0, 0, 0, 0 } },
+};
+
+#define NUM_PATHS ((int) (sizeof(paths) / sizeof(paths[0])))
+
+typedef int (*forward_fn) (const double *, EmcPose *,
+    const KINEMATICS_FORWARD_FLAGS *, KINEMATICS_INVERSE_FLAGS *);
+typedef int (*inverse_fn) (const EmcPose *, double *,
+    const KINEMATICS_INVERSE_FLAGS *, KINEMATICS_FORWARD_FLAGS *);
+typedef int (*inverse_batch_fn) (const EmcPose *, double *, int, int,
+    const KINEMATICS_INVERSE_FLAGS *, KINEMATICS_FORWARD_FLAGS *);
+
+/* kinematicsInverse() of the module being measured, for
+   inverse_batch_loop() */
+static inverse_fn loop_inverse;
+
+/* Stands in for kinematicsInverseBatch() in modules that don't export
+   it: one kinematicsInverse() per pose, each starting from the joints
+   of the pose before. */
+static int inverse_batch_loop(const EmcPose * world, double *joint,
+    int num_joints, int count, const KINEMATICS_INVERSE_FLAGS * iflags,
+    KINEMATICS_FORWARD_FLAGS * fflags)
+{
+    double *row;
+    int i, k;
+
+    for (k = 0; k < count; k++) {
+	row = joint + k * num_joints;
+	if (k > 0) {
+	    for (i = 0; i < num_joints; i++) {
+		row[i] = row[i - num_joints];
+	    }
+	}
+	if (0 != loop_inverse(&world[k], row, iflags, fflags)) {
+	    break;
+	}
+    }
+    return k;
+}
+
+static void usage()
+{
+    fprintf(stderr,
+	"usage: kinsbench [-n samples] [-e tolerance] [module...]\n");
+    exit(1);
+}
+
+static void pose_to_array(const EmcPose * pos, double c[])
+{
+    c[0] = pos->tran.x;
+    c[1] = pos->tran.y;
+    c[2] = pos->tran.z;
+    c[3] = pos->a;
+    c[4] = pos->b;
+    c[5] = pos->c;
+    c[6] = pos->u;
+    c[7] = pos->v;
+    c[8] = pos->w;
+}
+
+static void array_to_pose(const double c[], EmcPose * pos)
+{
+    pos->tran.x = c[0];
+    pos->tran.y = c[1];
+    pos->tran.z = c[2];
+    pos->a = c[3];
+    pos->b = c[4];
+    pos->c = c[5];
+    pos->u = c[6];
+    pos->v = c[7];
+    pos->w = c[8];
+}
+
+/* Difference of two coordinates; angles a, b and c are compared
+   modulo 360 degrees, since some modules return c == -180 for 180. */
+static double coord_error(int i, double x, double y)
+{
+    double d = fabs(x - y);
+    if (i >= 3 && i <= 5) {
+	d = fmod(d, 360.0);
+	if (d > 180.0) {
+	    d = 360.0 - d;
+	}
+    }
+    return d;
+}
+
+static long long now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int compare_ns(const void *a, const void *b)
+{
+    long x = *(const long *) a, y = *(const long *) b;
+    return x < y ? -1 : x > y;
+}
+
+/* Sorts the times and prints the 50th, 90th and 99th percentiles and
+   the maximum. */
+static void print_percentiles(long *ns, int n)
+{
+    qsort(ns, n, sizeof(long), compare_ns);
+    printf(" %6ld %6ld %6ld %7ld", ns[n / 2], ns[n * 9 / 10],
+	ns[n * 99 / 100], ns[n - 1]);
+}
+
+/* Runs one module along its path.  Returns the largest round trip
+   error, or -1 if the module could not be loaded; the number of calls
+   that returned an error is stored in *fails. */
+static double bench(const struct kins_path *path, int samples, int *fails)
+{
+    char file[256];
+    void *module;
+    int (*start) (void);
+    void (*stop) (void);
+    forward_fn forward;
+    inverse_fn inverse;
+    inverse_batch_fn inverse_batch;
+    double joints[EMCMOT_MAX_JOINTS] = { 0 };
+    double home_joints[EMCMOT_MAX_JOINTS];
+    double centre[NUM_COORDS], target[NUM_COORDS], result[NUM_COORDS];
+    EmcPose fpos, *poses;
+    double *batch_joints;
+    KINEMATICS_FORWARD_FLAGS fflags = 0;
+    KINEMATICS_INVERSE_FLAGS iflags = 0;
+    long *fwd_ns, *inv_ns;
+    long long t0, t1, t2, batch_ns;
+    double err, max_err = 0.0;
+    int i, k;
+
+    *fails = 0;
+    snprintf(file, sizeof(file), "%s/%s.so", EMC2_RTLIB_DIR, path->module);
+    module = dlopen(file, RTLD_NOW | RTLD_LOCAL);
+    if (NULL == module) {
+	fprintf(stderr, "kinsbench: %s\n", dlerror());
+	return -1;
+    }
+    start = (int (*)(void)) dlsym(module, "rtapi_app_main");
+    stop = (void (*)(void)) dlsym(module, "rtapi_app_exit");
+    forward = (forward_fn) dlsym(module, "kinematicsForward");
+    inverse = (inverse_fn) dlsym(module, "kinematicsInverse");
+    inverse_batch = (inverse_batch_fn) dlsym(module, "kinematicsInverseBatch");
+    if (NULL == inverse_batch) {
+	loop_inverse = inverse;
+	inverse_batch = inverse_batch_loop;
+    }
+    if (!start || !stop || !forward || !inverse) {
+	fprintf(stderr, "kinsbench: %s is not a kinematics module\n",
+	    path->module);
+	dlclose(module);
+	return -1;
+    }
+    if (0 != start()) {
+	fprintf(stderr, "kinsbench: %s: rtapi_app_main failed\n",
+	    path->module);
+	dlclose(module);
+	return -1;
+    }
+
+    fwd_ns = malloc(samples * sizeof(long));
+    inv_ns = malloc(samples * sizeof(long));
+    poses = malloc(samples * sizeof(EmcPose));
+    batch_joints = malloc(samples * sizeof(joints));
+    if (!fwd_ns || !inv_ns || !poses || !batch_joints) {
+	fprintf(stderr, "kinsbench: out of memory\n");
+	exit(1);
+    }
+
+    /* the forward kinematics of home give the centre of the path and
+       the flags (arm configuration) that the inverse has to keep */
+    memset(&fpos, 0, sizeof(fpos));
+    if (path->home_is_pose) {
+	array_to_pose(path->home, &fpos);
+	k = inverse(&fpos, joints, &iflags, &fflags);
+    } else {
+	memcpy(joints, path->home, sizeof(joints));
+	k = forward(joints, &fpos, &fflags, &iflags);
+    }
+    if (0 != k) {
+	fprintf(stderr, "kinsbench: %s: home is not a valid position\n",
+	    path->module);
+	++*fails;
+    }
+    pose_to_array(&fpos, centre);
+    memcpy(home_joints, joints, sizeof(joints));
+
+    for (k = 0; k < samples; k++) {
+	double t = 2.0 * M_PI * k / samples;
+	for (i = 0; i < NUM_COORDS; i++) {
+	    target[i] = centre[i] + path->amp[i] * sin((i + 1) * t + i);
+	}
+	array_to_pose(target, &poses[k]);
+
+	/* the joints and fpos are left from the last sample, which is
+	   what the iterative modules start from, as in the servo loop */
+	t0 = now_ns();
+	if (0 != inverse(&poses[k], joints, &iflags, &fflags)) {
+	    ++*fails;
+	}
+	t1 = now_ns();
+	if (0 != forward(joints, &fpos, &fflags, &iflags)) {
+	    ++*fails;
+	}
+	t2 = now_ns();
+	inv_ns[k] = t1 - t0;
+	fwd_ns[k] = t2 - t1;
+
+	pose_to_array(&fpos, result);
+	for (i = 0; i < NUM_COORDS; i++) {
+	    err = coord_error(i, result[i], target[i]);
+	    if (err > max_err || isnan(err)) {
+		max_err = err;
+	    }
+	}
+    }
+
+    /* the whole path again through the batched inverse */
+    memcpy(batch_joints, home_joints, sizeof(joints));
+    t0 = now_ns();
+    k = inverse_batch(poses, batch_joints, EMCMOT_MAX_JOINTS, samples,
+	&iflags, &fflags);
+    batch_ns = now_ns() - t0;
+    if (k < samples) {
+	++*fails;
+    }
+
+    printf("%-16s", path->module);
+    print_percentiles(fwd_ns, samples);
+    print_percentiles(inv_ns, samples);
+    printf(" %6lld %10.3g %6d\n", batch_ns / samples, max_err, *fails);
+    fflush(stdout);
+
+    free(fwd_ns);
+    free(inv_ns);
+    free(poses);
+    free(batch_joints);
+    stop();
+    dlclose(module);
+    return max_err;
+}
+
+int main(int argc, char *argv[])
+{
+    int samples = 10000;
+    double tolerance = -1.0;
+    double err;
+    int comp_id, opt, i, k, fails, status = 0;
+
+    while ((opt = getopt(argc, argv, "n:e:")) != -1) {
+	switch (opt) {
+	case 'n':
+	    samples = atoi(optarg);
+	    if (samples < 1) {
+		usage();
+	    }
+	    break;
+	case 'e':
+	    tolerance = strtod(optarg, NULL);
+	    break;
+	default:
+	    usage();
+	}
+    }
+
+    comp_id = hal_init("kinsbench");
+    if (comp_id < 0) {
+	fprintf(stderr, "kinsbench: can't connect to HAL, is realtime "
+	    "running?\n");
+	return 1;
+    }
+    hal_ready(comp_id);
+
+    printf("%-16s %29s %30s %24s\n", "", "forward (ns)", "inverse (ns)",
+	"");
+    printf("%-16s %6s %6s %6s %7s %6s %6s %6s %7s %6s %10s %6s\n", "module",
+	"p50", "p90", "p99", "max", "p50", "p90", "p99", "max", "batch",
+	"error", "fails");
+
+    for (k = 0; k < NUM_PATHS; k++) {
+	if (optind < argc) {
+	    for (i = optind; i < argc; i++) {
+		if (!strcmp(argv[i], paths[k].module)) {
+		    break;
+		}
+	    }
+	    if (i == argc) {
+		continue;
+	    }
+	}
+	err = bench(&paths[k], samples, &fails);
+	if (err < 0) {
+	    status = 1;
+	} else if (tolerance >= 0 && (fails || !(err <= tolerance))) {
+	    status = 1;
+	}
+    }
+
+    for (i = optind; i < argc; i++) {
+	for (k = 0; k < NUM_PATHS; k++) {
+	    if (!strcmp(argv[i], paths[k].module)) {
+		break;
+	    }
+	}
+	if (k == NUM_PATHS) {
+	    fprintf(stderr, "kinsbench: no path for module %s\n", argv[i]);
+	    status = 1;
+	}
+    }
+    hal_exit(comp_id);
+    return status;
+}
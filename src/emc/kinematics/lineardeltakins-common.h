@@ -36,6 +36,9 @@
 
 static double L, R;
 static double Ax, Ay, Bx, By, Cx, Cy, L2;
+// the parts of kinematics_forward() that only depend on the geometry,
+// worked out again by set_geometry() when R or L change
+static double Aw, Bw, Cw, BAy, CAy, den, den2, Ayden;
 
 #define SQ3    (sqrt(3))
 
@@ -61,6 +64,16 @@ static void set_geometry(double r_, double l_)
 
     Cx = SIN_60 * R;
     Cy = -COS_60 * R;
+
+    // n.b. assumption that Ax is 0 all through kinematics_forward()
+    Aw = Ay*Ay;
+    Bw = Bx*Bx + By*By;
+    Cw = Cx*Cx + Cy*Cy;
+    BAy = By-Ay;
+    CAy = Cy-Ay;
+    den = BAy*Cx-CAy*Bx;
+    den2 = den*den;
+    Ayden = Ay*den;
 }
 
 static int kinematics_inverse(const EmcPose *pos, double *joints)
@@ -86,22 +99,20 @@ static int kinematics_forward(const double *joints, EmcPose *pos)
     double q2 = joints[1];
     double q3 = joints[2];
 
-    double den = (By-Ay)*Cx-(Cy-Ay)*Bx;
-
-    double w1 = Ay*Ay + q1*q1; // n.b. assumption that Ax is 0 all through here
-    double w2 = Bx*Bx + By*By + q2*q2;
-    double w3 = Cx*Cx + Cy*Cy + q3*q3;
+    double w1 = Aw + q1*q1;
+    double w2 = Bw + q2*q2;
+    double w3 = Cw + q3*q3;
 
-    double a1 = (q2-q1)*(Cy-Ay)-(q3-q1)*(By-Ay);
-    double b1 = -((w2-w1)*(Cy-Ay)-(w3-w1)*(By-Ay))/2.0;
+    double a1 = (q2-q1)*CAy-(q3-q1)*BAy;
+    double b1 = -((w2-w1)*CAy-(w3-w1)*BAy)/2.0;
 
     double a2 = -(q2-q1)*Cx+(q3-q1)*Bx;
     double b2 = ((w2-w1)*Cx - (w3-w1)*Bx)/2.0;
 
     // a*z^2 + b*z + c = 0
-    double a = a1*a1 + a2*a2 + den*den;
-    double b = 2*(a1*b1 + a2*(b2-Ay*den) - q1*den*den);
-    double c = (b2-Ay*den)*(b2-Ay*den) + b1*b1 + den*den*(q1*q1 - L*L);
+    double a = a1*a1 + a2*a2 + den2;
+    double b = 2*(a1*b1 + a2*(b2-Ayden) - q1*den2);
+    double c = (b2-Ayden)*(b2-Ayden) + b1*b1 + den2*(q1*q1 - L2);
 
     double discr = b*b - 4.0*a*c;
     if (discr < 0) return -1; // non-existing point
@@ -58,6 +58,11 @@ static double shinlength;
 // distance from center of foot (controlled point) to an ankle joint
 static double footradius;
 
+// worked out by set_geometry() from the four above
+static double reach;		// platformradius - footradius
+static double thigh2, shin2;	// their squares
+static double inverse_k;	// the constant part of 'a' in inverse_j0()
+
 #ifndef sq
 #define sq(a) ((a)*(a))
 #endif
@@ -66,12 +71,24 @@ static double footradius;
 #endif
 
 static void set_geometry(double pfr, double tl, double sl, double fr) {
+    if(platformradius == pfr && thighlength == tl && shinlength == sl
+            && footradius == fr && thigh2 != 0) return;
+
     platformradius = pfr;
     thighlength = tl;
     shinlength = sl;
     footradius = fr;
+
+    reach = platformradius - footradius;
+    thigh2 = sq(thighlength);
+    shin2 = sq(shinlength);
+    inverse_k = thigh2 - shin2 - sq(platformradius);
 }
 
+// the rotations onto joint 0 of the points of joints 1 and 2
+#define SIN_120 (0.8660254037844386467637)
+#define COS_120 (-0.5)
+
 // Given three hip joint angles, find the controlled point
 static int kinematics_forward(const double *joints, EmcPose *pos) {
     double
@@ -89,14 +106,14 @@ static int kinematics_forward(const double *joints, EmcPose *pos) {
     j1 = D2R(j1);
     j2 = D2R(j2);
 
-    y1 = -(platformradius - footradius + thighlength * cos(j0));
+    y1 = -(reach + thighlength * cos(j0));
     z1 = -thighlength * sin(j0);
 
-    y2 = (platformradius - footradius + thighlength * cos(j1)) * 0.5;
+    y2 = (reach + thighlength * cos(j1)) * 0.5;
     x2 = y2 * sqrt(3);
     z2 = -thighlength * sin(j1);
 
-    y3 = (platformradius - footradius + thighlength * cos(j2)) * 0.5;
+    y3 = (reach + thighlength * cos(j2)) * 0.5;
     x3 = -y3 * sqrt(3);
     z3 = -thighlength * sin(j2);
 
@@ -116,7 +133,7 @@ static int kinematics_forward(const double *joints, EmcPose *pos) {
     a = sq(a1) + sq(a2) + sq(denom);
     b = 2 * (a1 * b1 + a2 * (b2 - y1 * denom) - z1 * sq(denom));
     c = (b2 - y1 * denom) * (b2 - y1 * denom) +
-        sq(b1) + sq(denom) * (sq(z1) - sq(shinlength));
+        sq(b1) + sq(denom) * (sq(z1) - shin2);
 
     d = sq(b) - 4 * a * c;
     if (d < 0) return -1;
@@ -139,13 +156,12 @@ static int kinematics_forward(const double *joints, EmcPose *pos) {
 // Given controlled point, find joint zero's angle
 // (J0 is the easy one in the ZY plane)
 static int inverse_j0(double x, double y, double z, double *theta) {
-    double a, b, d, knee_y, knee_z;
+    double a, b, d, knee_y, knee_z, rz = 1 / z;
 
-    a = 0.5 * (sq(x) + sq(y - footradius) + sq(z) + sq(thighlength) -
-               sq(shinlength) - sq(platformradius)) / z;
-    b = (footradius - platformradius - y) / z;
+    a = 0.5 * (sq(x) + sq(y - footradius) + sq(z) + inverse_k) * rz;
+    b = (-reach - y) * rz;
 
-    d = sq(thighlength) * (sq(b) + 1) - sq(a - b * platformradius);
+    d = thigh2 * (sq(b) + 1) - sq(a - b * platformradius);
     if (d < 0) return -1;
 
     knee_y = (platformradius + a*b + sqrt(d)) / (sq(b) + 1);
@@ -156,25 +172,16 @@ static int inverse_j0(double x, double y, double z, double *theta) {
     return 0;
 }
 
-static void rotate(double *x, double *y, double theta) {
-    double xx, yy;
-    xx = *x, yy = *y;
-    *x = xx * cos(theta) - yy * sin(theta);
-    *y = xx * sin(theta) + yy * cos(theta);
-}
-
 static int kinematics_inverse(const EmcPose *pos, double *joints) {
-    double xr, yr;
-    if(inverse_j0(pos->tran.x, pos->tran.y, pos->tran.z, &joints[0])) return -1;
-
-    // now use symmetry property to get the other two just as easily...
-    xr = pos->tran.x; yr = pos->tran.y;
-    rotate(&xr, &yr, -2*M_PI/3);
-    if(inverse_j0(xr, yr, pos->tran.z, &joints[1])) return -1;
-
-    xr = pos->tran.x; yr = pos->tran.y;
-    rotate(&xr, &yr, 2*M_PI/3);
-    if(inverse_j0(xr, yr, pos->tran.z, &joints[2])) return -1;
+    double x = pos->tran.x, y = pos->tran.y, z = pos->tran.z;
+    if(inverse_j0(x, y, z, &joints[0])) return -1;
+
+    // now use symmetry property to get the other two just as easily,
+    // rotating by -120 and then +120 degrees
+    if(inverse_j0(x * COS_120 + y * SIN_120, -x * SIN_120 + y * COS_120,
+                z, &joints[1])) return -1;
+    if(inverse_j0(x * COS_120 - y * SIN_120, x * SIN_120 + y * COS_120,
+                z, &joints[2])) return -1;
 
     joints[3] = pos->a;
     joints[4] = pos->b;
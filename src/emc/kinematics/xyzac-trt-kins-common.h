@@ -0,0 +1,116 @@
+#ifndef XYZAC_TRT_KINS_COMMON_H
+#define XYZAC_TRT_KINS_COMMON_H
+/**************************************************************************
+* Copyright 2016 Rudy du Preez <rudy@asmsa.co.za>
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+**************************************************************************/
+
+/*
+ * Kinematics for the 5 axis mill 'xyzac-trt': a tilting table (A axis)
+ * with a horizontal rotary (C axis) mounted to it.
+ */
+
+// common routines used by the preview and the realtime kinematics
+// user must include a math.h-type header first
+#include "emcpos.h"
+
+// sequential joint number assignments
+#define JX 0
+#define JY 1
+#define JZ 2
+
+#define JA 3
+#define JC 4
+
+static double y_offset, z_offset, tool_offset;
+
+static void set_geometry(double y_offset_, double z_offset_,
+                         double tool_offset_)
+{
+    y_offset = y_offset_;
+    z_offset = z_offset_;
+    tool_offset = tool_offset_;
+}
+
+static int kinematics_forward(const double *joints, EmcPose *pos)
+{
+    double    dy = y_offset;
+    double    dz = z_offset;
+    double    dt = tool_offset;
+    double a_rad = joints[JA]*M_PI/180;
+    double c_rad = joints[JC]*M_PI/180;
+
+    dz = dz + dt;
+
+    pos->tran.x = + cos(c_rad)              * (joints[JX]     )
+                  + sin(c_rad) * cos(a_rad) * (joints[JY] - dy)
+                  + sin(c_rad) * sin(a_rad) * (joints[JZ] - dz)
+                  + sin(c_rad) * dy;
+
+    pos->tran.y = - sin(c_rad)              * (joints[JX]     )
+                  + cos(c_rad) * cos(a_rad) * (joints[JY] - dy)
+                  + cos(c_rad) * sin(a_rad) * (joints[JZ] - dz)
+                  + cos(c_rad) * dy;
+
+    pos->tran.z = + 0
+                  - sin(a_rad) * (joints[JY] - dy)
+                  + cos(a_rad) * (joints[JZ] - dz)
+                  + dz;
+
+    pos->a = joints[JA];
+    pos->c = joints[JC];
+
+    pos->b = 0;
+    pos->w = 0;
+    pos->u = 0;
+    pos->v = 0;
+
+    return 0;
+}
+
+static int kinematics_inverse(const EmcPose *pos, double *joints)
+{
+    double    dz = z_offset;
+    double    dy = y_offset;
+    double    dt = tool_offset;
+    double c_rad = pos->c*M_PI/180;
+    double a_rad = pos->a*M_PI/180;
+
+    dz = dz + dt;
+
+    joints[JX] = + cos(c_rad) * pos->tran.x
+                 - sin(c_rad) * pos->tran.y;
+
+    joints[JY] = + sin(c_rad) * cos(a_rad) * pos->tran.x
+                 + cos(c_rad) * cos(a_rad) * pos->tran.y
+                 - sin(a_rad)              * pos->tran.z
+                 - cos(a_rad) * dy
+                 + sin(a_rad) * dz + dy;
+
+    joints[JZ] = + sin(c_rad) * sin(a_rad) * pos->tran.x
+                 + cos(c_rad) * sin(a_rad) * pos->tran.y
+                 + cos(a_rad)              * pos->tran.z
+                 - sin(a_rad) * dy
+                 - cos(a_rad) * dz
+                 + dz;
+
+    joints[JA] = pos->a;
+    joints[JC] = pos->c;
+
+    return 0;
+}
+
+#endif
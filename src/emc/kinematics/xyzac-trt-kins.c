@@ -28,13 +28,7 @@
 #include "rtapi.h"
 #include "rtapi_math.h"
 
-// sequential joint number assignments
-#define JX 0
-#define JY 1
-#define JZ 2
-
-#define JA 3
-#define JC 4
+#include "xyzac-trt-kins-common.h"
 
 struct haldata {
     hal_float_t *z_offset;
@@ -47,38 +41,9 @@ int kinematicsForward(const double *joints,
                       const KINEMATICS_FORWARD_FLAGS * fflags,
                       KINEMATICS_INVERSE_FLAGS * iflags)
 {
-    double    dy = *(haldata->y_offset);
-    double    dz = *(haldata->z_offset);
-    double    dt = *(haldata->tool_offset);
-    double a_rad = joints[JA]*TO_RAD;
-    double c_rad = joints[JC]*TO_RAD;
-
-    dz = dz + dt;
-
-    pos->tran.x = + cos(c_rad)              * (joints[JX]     )
-                  + sin(c_rad) * cos(a_rad) * (joints[JY] - dy)
-                  + sin(c_rad) * sin(a_rad) * (joints[JZ] - dz)
-                  + sin(c_rad) * dy;
-
-    pos->tran.y = - sin(c_rad)              * (joints[JX]     )
-                  + cos(c_rad) * cos(a_rad) * (joints[JY] - dy)
-                  + cos(c_rad) * sin(a_rad) * (joints[JZ] - dz)
-                  + cos(c_rad) * dy;
-
-    pos->tran.z = + 0
-                  - sin(a_rad) * (joints[JY] - dy)
-                  + cos(a_rad) * (joints[JZ] - dz)
-                  + dz;
-
-    pos->a = joints[JA];
-    pos->c = joints[JC];
-
-    pos->b = 0;
-    pos->w = 0;
-    pos->u = 0;
-    pos->v = 0;
-
-    return 0;
+    set_geometry(*(haldata->y_offset), *(haldata->z_offset),
+                 *(haldata->tool_offset));
+    return kinematics_forward(joints, pos);
 }
 
 int kinematicsInverse(const EmcPose * pos,
@@ -86,34 +51,9 @@ int kinematicsInverse(const EmcPose * pos,
                       const KINEMATICS_INVERSE_FLAGS * iflags,
                       KINEMATICS_FORWARD_FLAGS * fflags)
 {
-    double    dz = *(haldata->z_offset);
-    double    dy = *(haldata->y_offset);
-    double    dt = *(haldata->tool_offset);
-    double c_rad = pos->c*TO_RAD;
-    double a_rad = pos->a*TO_RAD;
-
-    dz = dz + dt;
-
-    joints[JX] = + cos(c_rad) * pos->tran.x
-                 - sin(c_rad) * pos->tran.y;
-
-    joints[JY] = + sin(c_rad) * cos(a_rad) * pos->tran.x
-                 + cos(c_rad) * cos(a_rad) * pos->tran.y
-                 - sin(a_rad)              * pos->tran.z
-                 - cos(a_rad) * dy
-                 + sin(a_rad) * dz + dy;
-
-    joints[JZ] = + sin(c_rad) * sin(a_rad) * pos->tran.x
-                 + cos(c_rad) * sin(a_rad) * pos->tran.y
-                 + cos(a_rad)              * pos->tran.z
-                 - sin(a_rad) * dy
-                 - cos(a_rad) * dz
-                 + dz;
-
-    joints[JA] = pos->a;
-    joints[JC] = pos->c;
-
-    return 0;
+    set_geometry(*(haldata->y_offset), *(haldata->z_offset),
+                 *(haldata->tool_offset));
+    return kinematics_inverse(pos, joints);
 }
 
 KINEMATICS_TYPE kinematicsType()
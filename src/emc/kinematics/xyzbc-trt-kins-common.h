@@ -0,0 +1,108 @@
+#ifndef XYZBC_TRT_KINS_COMMON_H
+#define XYZBC_TRT_KINS_COMMON_H
+/**************************************************************************
+* Copyright 2016 Rudy du Preez <rudy@asmsa.co.za>
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+**************************************************************************/
+
+/*
+ * Kinematics for the 5 axis mill 'xyzbc-trt': a tilting table (B axis)
+ * with a horizontal rotary (C axis) mounted to it.
+ */
+
+// common routines used by the preview and the realtime kinematics
+// user must include a math.h-type header first
+#include "emcpos.h"
+
+// sequential joint number assignments
+#define JX 0
+#define JY 1
+#define JZ 2
+
+#define JB 3
+#define JC 4
+
+static double x_offset, z_offset, tool_offset;
+
+static void set_geometry(double x_offset_, double z_offset_,
+                         double tool_offset_)
+{
+    x_offset = x_offset_;
+    z_offset = z_offset_;
+    tool_offset = tool_offset_;
+}
+
+static int kinematics_forward(const double *joints, EmcPose *pos)
+{
+    double    dx = x_offset;
+    double    dz = z_offset + tool_offset;
+    double b_rad = joints[JB]*M_PI/180;
+    double c_rad = joints[JC]*M_PI/180;
+
+    pos->tran.x =   cos(c_rad) * cos(b_rad) * (joints[JX] - dx)
+                  + sin(c_rad) *              (joints[JY])
+                  - cos(c_rad) * sin(b_rad) * (joints[JZ] - dz)
+                  + cos(c_rad) * dx;
+
+    pos->tran.y = - sin(c_rad) * cos(b_rad) * (joints[JX] - dx)
+                  + cos(c_rad) *              (joints[JY])
+                  + sin(c_rad) * sin(b_rad) * (joints[JZ] - dz)
+                  - sin(c_rad) * dx;
+
+    pos->tran.z =   sin(b_rad) * (joints[JX] - dx)
+                  + cos(b_rad) * (joints[JZ] - dz)
+                  + dz;
+
+    pos->b = joints[JB];
+    pos->c = joints[JC];
+
+    pos->a = 0;
+    pos->u = 0;
+    pos->v = 0;
+    pos->w = 0;
+
+    return 0;
+}
+
+static int kinematics_inverse(const EmcPose *pos, double *joints)
+{
+    double    dx = x_offset;
+    double    dz = z_offset + tool_offset;
+    double b_rad = pos->b*M_PI/180;
+    double c_rad = pos->c*M_PI/180;
+    double   dpx = -cos(b_rad)*dx - sin(b_rad)*dz + dx;
+    double   dpz = sin(b_rad)*dx - cos(b_rad)*dz + dz;
+
+    joints[JX] =   cos(c_rad) * cos(b_rad) * (pos->tran.x)
+                 - sin(c_rad) * cos(b_rad) * (pos->tran.y)
+                 + sin(b_rad) * (pos->tran.z)
+                 + dpx;
+
+    joints[JY] =   sin(c_rad) * (pos->tran.x)
+                 + cos(c_rad) * (pos->tran.y);
+
+    joints[JZ] = - cos(c_rad) * sin(b_rad) * (pos->tran.x)
+                 + sin(c_rad) * sin(b_rad) * (pos->tran.y)
+                 + cos(b_rad) * (pos->tran.z)
+                 + dpz;
+
+    joints[JB] = pos->b;
+    joints[JC] = pos->c;
+
+    return 0;
+}
+
+#endif
@@ -28,13 +28,7 @@
 #include "rtapi.h"
 #include "rtapi_math.h"
 
-// sequential joint number assignments
-#define JX 0
-#define JY 1
-#define JZ 2
-
-#define JB 3
-#define JC 4
+#include "xyzbc-trt-kins-common.h"
 
 struct haldata {
     hal_float_t *x_offset;
@@ -47,37 +41,9 @@ int kinematicsForward(const double *joints,
                       const KINEMATICS_FORWARD_FLAGS * fflags,
                       KINEMATICS_INVERSE_FLAGS * iflags)
 {
-    double    dx = *(haldata->x_offset);
-    double    dz = *(haldata->z_offset);
-    double    dt = *(haldata->tool_offset);
-              dz = dz + dt;
-    double b_rad = joints[JB]*TO_RAD;
-    double c_rad = joints[JC]*TO_RAD;
-
-
-    pos->tran.x =   cos(c_rad) * cos(b_rad) * (joints[JX] - dx)
-                  + sin(c_rad) *              (joints[JY])
-                  - cos(c_rad) * sin(b_rad) * (joints[JZ] - dz)
-                  + cos(c_rad) * dx;
-
-    pos->tran.y = - sin(c_rad) * cos(b_rad) * (joints[JX] - dx)
-                  + cos(c_rad) *              (joints[JY])
-                  + sin(c_rad) * sin(b_rad) * (joints[JZ] - dz)
-                  - sin(c_rad) * dx;
-
-    pos->tran.z =   sin(b_rad) * (joints[JX] - dx)
-                  + cos(b_rad) * (joints[JZ] - dz)
-                  + dz;
-
-    pos->b = joints[JB];
-    pos->c = joints[JC];
-
-    pos->a = 0;
-    pos->u = 0;
-    pos->v = 0;
-    pos->w = 0;
-
-    return 0;
+    set_geometry(*(haldata->x_offset), *(haldata->z_offset),
+                 *(haldata->tool_offset));
+    return kinematics_forward(joints, pos);
 }
 
 int kinematicsInverse(const EmcPose * pos,
@@ -85,33 +51,9 @@ int kinematicsInverse(const EmcPose * pos,
                       const KINEMATICS_INVERSE_FLAGS * iflags,
                       KINEMATICS_FORWARD_FLAGS * fflags)
 {
-    double    dx = *(haldata->x_offset);
-    double    dz = *(haldata->z_offset);
-    double    dt = *(haldata->tool_offset);
-              dz = dz + dt;
-    double b_rad = pos->b*TO_RAD;
-    double c_rad = pos->c*TO_RAD;
-    double   dpx = -cos(b_rad)*dx - sin(b_rad)*dz + dx;
-    double   dpz = sin(b_rad)*dx - cos(b_rad)*dz + dz;
-
-
-    joints[JX] =   cos(c_rad) * cos(b_rad) * (pos->tran.x)
-                 - sin(c_rad) * cos(b_rad) * (pos->tran.y)
-                 + sin(b_rad) * (pos->tran.z)
-                 + dpx;
-
-    joints[JY] =   sin(c_rad) * (pos->tran.x)
-                 + cos(c_rad) * (pos->tran.y);
-
-    joints[JZ] = - cos(c_rad) * sin(b_rad) * (pos->tran.x)
-                 + sin(c_rad) * sin(b_rad) * (pos->tran.y)
-                 + cos(b_rad) * (pos->tran.z)
-                 + dpz;
-
-    joints[JB] = pos->b;
-    joints[JC] = pos->c ;
-
-    return 0;
+    set_geometry(*(haldata->x_offset), *(haldata->z_offset),
+                 *(haldata->tool_offset));
+    return kinematics_inverse(pos, joints);
 }
 
 KINEMATICS_TYPE kinematicsType()
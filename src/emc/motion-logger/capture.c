@@ -0,0 +1,165 @@
+//
+// capture.c: reading and writing the binary captures of motion-logger
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "capture.h"
+
+static const unsigned char zstd_magic[4] = { 0x28, 0xb5, 0x2f, 0xfd };
+
+// Runs zstd with its stdout on fd to compress, or its stdin on fd to
+// decompress, and returns the other end as a stream.  fd is closed.
+static FILE *zstd_filter(capture_t *cap, int fd, int compress) {
+    int p[2];
+    pid_t pid;
+
+    if (pipe(p) < 0) {
+        close(fd);
+        return NULL;
+    }
+    pid = fork();
+    if (pid < 0) {
+        close(p[0]);
+        close(p[1]);
+        close(fd);
+        return NULL;
+    }
+    if (pid == 0) {
+        dup2(compress ? p[0] : fd, 0);
+        dup2(compress ? fd : p[1], 1);
+        close(p[0]);
+        close(p[1]);
+        close(fd);
+        if (compress) {
+            execlp("zstd", "zstd", "-q", "-c", (char *)NULL);
+        } else {
+            execlp("zstd", "zstd", "-q", "-d", "-c", (char *)NULL);
+        }
+        _exit(127);
+    }
+    close(fd);
+    close(compress ? p[0] : p[1]);
+    cap->filter = pid;
+    return fdopen(compress ? p[1] : p[0], compress ? "w" : "r");
+}
+
+int capture_create(capture_t *cap, const char *path, int compress) {
+    capture_header_t header;
+    int fd;
+
+    cap->f = NULL;
+    cap->filter = 0;
+    cap->binary = 1;
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) {
+        return -1;
+    }
+    cap->f = compress ? zstd_filter(cap, fd, 1) : fdopen(fd, "w");
+    if (cap->f == NULL) {
+        return -1;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC));
+    header.version = CAPTURE_VERSION;
+    header.record_size = sizeof(capture_record_t);
+    if (fwrite(&header, sizeof(header), 1, cap->f) != 1) {
+        capture_close(cap);
+        return -1;
+    }
+    return 0;
+}
+
+int capture_open(capture_t *cap, const char *path) {
+    capture_header_t header;
+    unsigned char magic[sizeof(zstd_magic)];
+    int fd, compressed;
+
+    cap->f = NULL;
+    cap->filter = 0;
+    cap->binary = 0;
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return -1;
+    }
+    compressed = read(fd, magic, sizeof(magic)) == sizeof(magic)
+        && !memcmp(magic, zstd_magic, sizeof(magic));
+    if (lseek(fd, 0, SEEK_SET) < 0) {
+        perror(path);
+        close(fd);
+        return -1;
+    }
+    cap->f = compressed ? zstd_filter(cap, fd, 0) : fdopen(fd, "r");
+    if (cap->f == NULL) {
+        perror(path);
+        return -1;
+    }
+
+    if (fread(&header, sizeof(header), 1, cap->f) == 1
+            && !memcmp(header.magic, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC))) {
+        if (header.version != CAPTURE_VERSION
+                || header.record_size != sizeof(capture_record_t)) {
+            fprintf(stderr, "%s: capture of another version of motion\n",
+                path);
+            capture_close(cap);
+            return -1;
+        }
+        cap->binary = 1;
+        return 0;
+    }
+    if (compressed || fseek(cap->f, 0, SEEK_SET) < 0) {
+        fprintf(stderr, "%s: not a motion-logger capture\n", path);
+        capture_close(cap);
+        return -1;
+    }
+    return 0;
+}
+
+int capture_read(capture_t *cap, capture_record_t *record) {
+    size_t n = fread(record, 1, sizeof(*record), cap->f);
+
+    if (n == sizeof(*record)) {
+        return 1;
+    }
+    return n == 0 && !ferror(cap->f) ? 0 : -1;
+}
+
+int capture_close(capture_t *cap) {
+    int r = 0, status = 0;
+    pid_t pid;
+
+    if (cap->f && fclose(cap->f) != 0) {
+        r = -1;
+    }
+    cap->f = NULL;
+    if (cap->filter > 0) {
+        while ((pid = waitpid(cap->filter, &status, 0)) < 0 && errno == EINTR) {
+        }
+        if (pid < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            r = -1;
+        }
+        cap->filter = 0;
+    }
+    return r;
+}
@@ -0,0 +1,79 @@
+//
+// capture.h: the binary capture written by motion-logger -b, and read
+//     back by motion-logger -d and tpreplay
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+#ifndef MOTION_LOGGER_CAPTURE_H
+#define MOTION_LOGGER_CAPTURE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+#include "motion.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// A capture is a capture_header_t followed by one capture_record_t per
+// command, as the structs are in memory on the machine that wrote it, so
+// it is only read back by a build of the same motion.h.  It may be
+// compressed as a whole with zstd.
+
+#define CAPTURE_MAGIC "MOTCAPT"
+#define CAPTURE_VERSION 1
+
+typedef struct capture_header_t {
+    char magic[8];              // CAPTURE_MAGIC with its NUL
+    uint32_t version;           // CAPTURE_VERSION
+    uint32_t record_size;       // sizeof(capture_record_t) of the writer
+} capture_header_t;
+
+typedef struct capture_record_t {
+    int64_t time_ns;            // CLOCK_MONOTONIC when it was received
+    emcmot_command_t command;
+} capture_record_t;
+
+typedef struct capture_t {
+    FILE *f;
+    pid_t filter;               // the zstd process, or 0
+    int binary;                 // if not, f is at the start of a text log
+} capture_t;
+
+// Opens a capture for writing, through zstd if compress is set, and
+// writes the header.  Returns 0 or -1 with errno set.
+int capture_create(capture_t *cap, const char *path, int compress);
+
+// Opens a log for reading.  A compressed file is read through zstd; a
+// binary capture has its header checked and sets cap->binary, and any
+// other file is left for reading as the text log.  Returns 0 or -1 with
+// a message printed.
+int capture_open(capture_t *cap, const char *path);
+
+// Reads the next record of a binary capture.  Returns 1, 0 at the end,
+// or -1 on a short record.
+int capture_read(capture_t *cap, capture_record_t *record);
+
+// Closes the file and waits for zstd.  Returns 0, or -1 if either failed.
+int capture_close(capture_t *cap);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -22,6 +22,8 @@
 
 #include <errno.h>
 #include <float.h>
+#include <pthread.h>
+#include <signal.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -35,6 +37,7 @@
 #include "motion_struct.h"
 #include "motion_types.h"
 #include "mot_priv.h"
+#include "capture.h"
 
 static struct motion_logger_data_t {
     hal_bit_t *reopen;
@@ -45,6 +48,7 @@ char *logfile_name = NULL;
 
 emcmot_struct_t *emcmotStruct = 0;
 
+struct emcmot_command_ring_t *ring = 0;
 struct emcmot_command_t *c = 0;
 struct emcmot_status_t *emcmotStatus = 0;
 struct emcmot_config_t *emcmotConfig = 0;
@@ -85,6 +89,7 @@ static int init_comm_buffers(void) {
     emcmotStruct = 0;
     emcmotDebug = 0;
     emcmotStatus = 0;
+    ring = 0;
     c = 0;
     emcmotConfig = 0;
 
@@ -106,7 +111,8 @@ static int init_comm_buffers(void) {
     memset(emcmotStruct, 0, sizeof(emcmot_struct_t));
 
     /* we'll reference emcmotStruct directly */
-    c = &emcmotStruct->command;
+    ring = &emcmotStruct->command_ring;
+    c = &ring->slot[0];
     emcmotStatus = &emcmotStruct->status;
     emcmotConfig = &emcmotStruct->config;
     emcmotDebug = &emcmotStruct->debug;
@@ -151,6 +157,7 @@ static int init_comm_buffers(void) {
 	joint->home_sequence = -1;
 
 	joint->comp.entry = &(joint->comp.array[0]);
+	joint->comp.index_buckets = 0;
 	/* the compensation code has -DBL_MAX at one end of the table
 	   and +DBL_MAX at the other so _all_ commanded positions are
 	   guaranteed to be covered by the table */
@@ -253,7 +260,7 @@ static void mark_joint_homed(int joint_num) {
 }
 
 void maybe_reopen_logfile() {
-    if(*motion_logger_data->reopen) {
+    if(motion_logger_data && *motion_logger_data->reopen) {
         if(logfile != stdout) {
             fclose(logfile);
             logfile = NULL;
@@ -286,420 +293,704 @@ void log_print(const char *fmt, ...) {
 }
 
 
-int main(int argc, char* argv[]) {
-    if (argc == 1) {
-        logfile = stdout;
-        logfile_name = NULL;
-    } else if (argc == 2) {
-        logfile = NULL;
-        logfile_name = argv[1];
-    } else {
-        fprintf(stderr, "usage: motion-logger [LOGFILE]\n");
+//
+// With -b the commands are written as binary records instead.  The loop
+// that takes them from the ring only copies them into the queue, and a
+// thread of their own writes them to the capture in as large pieces as
+// are waiting, so a burst of commands costs no more than a memcpy each.
+//
+
+#define CAPTURE_QUEUE_SIZE 4096
+
+static int capture = 0;
+static int capture_compress = 0;
+static capture_t capture_file;
+static capture_record_t capture_queue[CAPTURE_QUEUE_SIZE];
+static unsigned long capture_head, capture_tail;  // put, written
+static int capture_reopen, capture_stop;
+static pthread_mutex_t capture_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t capture_more = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t capture_room = PTHREAD_COND_INITIALIZER;
+static pthread_t capture_thread;
+static volatile sig_atomic_t done = 0;
+
+static void capture_create_or_exit(void) {
+    if (capture_create(&capture_file, logfile_name, capture_compress) < 0) {
+        fprintf(stderr, "error opening %s: %s\n", logfile_name, strerror(errno));
         exit(1);
     }
+}
 
-    mot_comp_id = hal_init("motion-logger");
-    motion_logger_data = hal_malloc(sizeof(*motion_logger_data));
-    int r = hal_pin_bit_new("motion-logger.reopen-log", HAL_IO, &motion_logger_data->reopen,
-            mot_comp_id);
-    if(r < 0) { errno = -r; perror("hal_pin_bit_new"); exit(1); }
-    *motion_logger_data->reopen = 0;
-    r = hal_ready(mot_comp_id);
-    if(r < 0) { errno = -r; perror("hal_ready"); exit(1); }
-    init_comm_buffers();
+static void *capture_writer(void *arg) {
+    unsigned long head, tail;
+    size_t n;
 
+    pthread_mutex_lock(&capture_lock);
     while (1) {
-        if (c->commandNum != c->tail) {
-            // "split read"
-            continue;
+        while (capture_head == capture_tail && !capture_reopen && !capture_stop) {
+            pthread_cond_wait(&capture_more, &capture_lock);
         }
-        if (c->commandNum == emcmotStatus->commandNumEcho) {
-            // nothing new
-            maybe_reopen_logfile();
-            usleep(10 * 1000);
+        head = capture_head;
+        tail = capture_tail;
+        if (head == tail) {
+            // all written: start the new file, or finish
+            pthread_mutex_unlock(&capture_lock);
+            if (capture_close(&capture_file) < 0) {
+                fprintf(stderr, "error writing %s\n", logfile_name);
+            }
+            pthread_mutex_lock(&capture_lock);
+            if (capture_stop) {
+                break;
+            }
+            capture_reopen = 0;
+            capture_create_or_exit();
             continue;
         }
+        pthread_mutex_unlock(&capture_lock);
 
-        //
-        // new incoming command!
-        //
-
-        emcmotStatus->head++;
-
-        switch (c->command) {
-            case EMCMOT_ABORT:
-                log_print("ABORT\n");
-                break;
-
-            case EMCMOT_JOINT_ABORT:
-                log_print("JOINT_ABORT joint=%d\n", c->joint);
-                break;
-
-            case EMCMOT_ENABLE:
-                log_print("ENABLE\n");
-                SET_MOTION_ENABLE_FLAG(1);
-                update_motion_state();
-                break;
-
-            case EMCMOT_DISABLE:
-                log_print("DISABLE\n");
-                SET_MOTION_ENABLE_FLAG(0);
-                update_motion_state();
-                break;
-
-            case EMCMOT_JOINT_ENABLE_AMPLIFIER:
-                log_print("ENABLE_AMPLIFIER\n");
-                break;
-
-            case EMCMOT_JOINT_DISABLE_AMPLIFIER:
-                log_print("DISABLE_AMPLIFIER\n");
-                break;
+        // the records up to the end of the queue or the newest
+        n = head - tail;
+        if (n > CAPTURE_QUEUE_SIZE - tail % CAPTURE_QUEUE_SIZE) {
+            n = CAPTURE_QUEUE_SIZE - tail % CAPTURE_QUEUE_SIZE;
+        }
+        if (fwrite(&capture_queue[tail % CAPTURE_QUEUE_SIZE],
+                   sizeof(capture_record_t), n, capture_file.f) != n) {
+            fprintf(stderr, "error writing %s: %s\n", logfile_name, strerror(errno));
+            exit(1);
+        }
 
-            case EMCMOT_ENABLE_WATCHDOG:
-                log_print("ENABLE_WATCHDOG\n");
-                break;
+        pthread_mutex_lock(&capture_lock);
+        capture_tail += n;
+        pthread_cond_signal(&capture_room);
+        if (capture_head == capture_tail) {
+            // nothing more for now, so let the file catch up
+            pthread_mutex_unlock(&capture_lock);
+            fflush(capture_file.f);
+            pthread_mutex_lock(&capture_lock);
+        }
+    }
+    pthread_mutex_unlock(&capture_lock);
+    return NULL;
+}
 
-            case EMCMOT_DISABLE_WATCHDOG:
-                log_print("DISABLE_WATCHDOG\n");
-                break;
+static void capture_put(const emcmot_command_t *c) {
+    struct timespec now;
+    capture_record_t *record;
 
-            case EMCMOT_JOINT_ACTIVATE:
-                log_print("JOINT_ACTIVATE joint=%d\n", c->joint);
-                break;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    pthread_mutex_lock(&capture_lock);
+    if(*motion_logger_data->reopen) {
+        capture_reopen = 1;
+        *motion_logger_data->reopen = 0;
+    }
+    while (capture_head - capture_tail == CAPTURE_QUEUE_SIZE) {
+        pthread_cond_wait(&capture_room, &capture_lock);
+    }
+    record = &capture_queue[capture_head % CAPTURE_QUEUE_SIZE];
+    record->time_ns = now.tv_sec * 1000000000LL + now.tv_nsec;
+    record->command = *c;
+    capture_head++;
+    pthread_cond_signal(&capture_more);
+    pthread_mutex_unlock(&capture_lock);
+}
 
-            case EMCMOT_JOINT_DEACTIVATE:
-                log_print("JOINT_DEACTIVATE joint=%d\n", c->joint);
-                break;
+static void capture_idle(void) {
+    pthread_mutex_lock(&capture_lock);
+    if(*motion_logger_data->reopen) {
+        capture_reopen = 1;
+        *motion_logger_data->reopen = 0;
+        pthread_cond_signal(&capture_more);
+    }
+    pthread_mutex_unlock(&capture_lock);
+}
 
-            case EMCMOT_PAUSE:
-                log_print("PAUSE\n");
-                break;
+static void capture_start(void) {
+    capture_create_or_exit();
+    if (pthread_create(&capture_thread, NULL, capture_writer, NULL) != 0) {
+        fprintf(stderr, "motion-logger: can't start the capture writer\n");
+        exit(1);
+    }
+}
 
-            case EMCMOT_RESUME:
-                log_print("RESUME\n");
-                break;
+static void capture_finish(void) {
+    pthread_mutex_lock(&capture_lock);
+    capture_stop = 1;
+    pthread_cond_signal(&capture_more);
+    pthread_mutex_unlock(&capture_lock);
+    pthread_join(capture_thread, NULL);
+}
 
-            case EMCMOT_STEP:
-                log_print("STEP\n");
-                break;
+static void quit(int sig) {
+    done = 1;
+}
 
-            case EMCMOT_FREE:
-                log_print("FREE\n");
-                SET_MOTION_COORD_FLAG(0);
-                SET_MOTION_TELEOP_FLAG(0);
-                update_motion_state();
-                break;
 
-            case EMCMOT_COORD:
-                log_print("COORD\n");
-                SET_MOTION_COORD_FLAG(1);
-                SET_MOTION_TELEOP_FLAG(0);
-                SET_MOTION_ERROR_FLAG(0);
-                update_motion_state();
-                break;
+// Prints a command in the text format of the log.
+static void log_command(const emcmot_command_t *c) {
+    switch (c->command) {
+        case EMCMOT_ABORT:
+            log_print("ABORT\n");
+            break;
 
-            case EMCMOT_TELEOP:
-                log_print("TELEOP\n");
-                SET_MOTION_TELEOP_FLAG(1);
-                SET_MOTION_ERROR_FLAG(0);
-                update_motion_state();
-                break;
+        case EMCMOT_JOINT_ABORT:
+            log_print("JOINT_ABORT joint=%d\n", c->joint);
+            break;
 
-            case EMCMOT_SPINDLE_SCALE:
-                log_print("SPINDLE_SCALE\n");
-                break;
+        case EMCMOT_ENABLE:
+            log_print("ENABLE\n");
+            break;
 
-            case EMCMOT_SS_ENABLE:
-                log_print("SS_ENABLE\n");
-                break;
+        case EMCMOT_DISABLE:
+            log_print("DISABLE\n");
+            break;
 
-            case EMCMOT_FEED_SCALE:
-                log_print("FEED_SCALE\n");
-                break;
+        case EMCMOT_JOINT_ENABLE_AMPLIFIER:
+            log_print("ENABLE_AMPLIFIER\n");
+            break;
 
-            case EMCMOT_RAPID_SCALE:
-                log_print("RAPID_SCALE\n");
-                break;
+        case EMCMOT_JOINT_DISABLE_AMPLIFIER:
+            log_print("DISABLE_AMPLIFIER\n");
+            break;
+
+        case EMCMOT_ENABLE_WATCHDOG:
+            log_print("ENABLE_WATCHDOG\n");
+            break;
+
+        case EMCMOT_DISABLE_WATCHDOG:
+            log_print("DISABLE_WATCHDOG\n");
+            break;
+
+        case EMCMOT_JOINT_ACTIVATE:
+            log_print("JOINT_ACTIVATE joint=%d\n", c->joint);
+            break;
+
+        case EMCMOT_JOINT_DEACTIVATE:
+            log_print("JOINT_DEACTIVATE joint=%d\n", c->joint);
+            break;
+
+        case EMCMOT_PAUSE:
+            log_print("PAUSE\n");
+            break;
+
+        case EMCMOT_RESUME:
+            log_print("RESUME\n");
+            break;
+
+        case EMCMOT_STEP:
+            log_print("STEP\n");
+            break;
+
+        case EMCMOT_FREE:
+            log_print("FREE\n");
+            break;
+
+        case EMCMOT_COORD:
+            log_print("COORD\n");
+            break;
+
+        case EMCMOT_TELEOP:
+            log_print("TELEOP\n");
+            break;
+
+        case EMCMOT_SPINDLE_SCALE:
+            log_print("SPINDLE_SCALE\n");
+            break;
+
+        case EMCMOT_SS_ENABLE:
+            log_print("SS_ENABLE\n");
+            break;
+
+        case EMCMOT_FEED_SCALE:
+            log_print("FEED_SCALE\n");
+            break;
+
+        case EMCMOT_RAPID_SCALE:
+            log_print("RAPID_SCALE\n");
+            break;
+
+        case EMCMOT_FS_ENABLE:
+            log_print("FS_ENABLE\n");
+            break;
+
+        case EMCMOT_FH_ENABLE:
+            log_print("FH_ENABLE\n");
+            break;
+
+        case EMCMOT_AF_ENABLE:
+            log_print("AF_ENABLE\n");
+            break;
+
+        case EMCMOT_OVERRIDE_LIMITS:
+            log_print("OVERRIDE_LIMITS\n");
+            break;
+
+        case EMCMOT_JOINT_HOME:
+            log_print("JOINT_HOME joint=%d\n", c->joint);
+            break;
+
+        case EMCMOT_JOINT_UNHOME:
+            log_print("JOINT_UNHOME joint=%d\n", c->joint);
+            break;
+
+        case EMCMOT_JOG_CONT:
+            log_print("JOG_CONT\n");
+            break;
+
+        case EMCMOT_JOG_INCR:
+            log_print("JOG_INCR\n");
+            break;
+
+        case EMCMOT_JOG_ABS:
+            log_print("JOG_ABS\n");
+            break;
+
+        case EMCMOT_SET_LINE:
+            log_print(
+                "SET_LINE x=%.6f, y=%.6f, z=%.6f, a=%.6f, b=%.6f, c=%.6f, u=%.6f, v=%.6f, w=%.6f, id=%d, motion_type=%d, vel=%.6f, ini_maxvel=%.6f, acc=%.6f, turn=%d\n",
+                c->pos.tran.x, c->pos.tran.y, c->pos.tran.z,
+                c->pos.a, c->pos.b, c->pos.c,
+                c->pos.u, c->pos.v, c->pos.w,
+                c->id, c->motion_type,
+                c->vel, c->ini_maxvel,
+                c->acc, c->turn
+            );
+            break;
+
+        case EMCMOT_SET_CIRCLE:
+            log_print("SET_CIRCLE:\n");
+            log_print(
+                "    pos: x=%.6f, y=%.6f, z=%.6f, a=%.6f, b=%.6f, c=%.6f, u=%.6f, v=%.6f, w=%.6f\n",
+                c->pos.tran.x, c->pos.tran.y, c->pos.tran.z,
+                c->pos.a, c->pos.b, c->pos.c,
+                c->pos.u, c->pos.v, c->pos.w
+            );
+            log_print("    center: x=%.6f, y=%.6f, z=%.6f\n", c->center.x, c->center.y, c->center.z);
+            log_print("    normal: x=%.6f, y=%.6f, z=%.6f\n", c->normal.x, c->normal.y, c->normal.z);
+            log_print("    id=%d, motion_type=%d, vel=%.6f, ini_maxvel=%.6f, acc=%.6f, turn=%d\n",
+                c->id, c->motion_type,
+                c->vel, c->ini_maxvel,
+                c->acc, c->turn
+            );
+            break;
+
+        case EMCMOT_SET_TELEOP_VECTOR:
+            log_print("SET_TELEOP_VECTOR\n");
+            break;
+
+        case EMCMOT_CLEAR_PROBE_FLAGS:
+            log_print("CLEAR_PROBE_FLAGS\n");
+            break;
+
+        case EMCMOT_PROBE:
+            log_print("PROBE\n");
+            break;
+
+        case EMCMOT_RIGID_TAP:
+            log_print("RIGID_TAP\n");
+            break;
+
+        case EMCMOT_SET_JOINT_POSITION_LIMITS:
+            log_print(
+                "SET_JOINT_POSITION_LIMITS joint=%d, min=%.6f, max=%.6f\n",
+                c->joint, c->minLimit, c->maxLimit
+            );
+            break;
+
+        case EMCMOT_SET_AXIS_POSITION_LIMITS:
+            log_print(
+                "SET_AXIS_POSITION_LIMITS axis=%d, min=%.6f, max=%.6f\n",
+                c->axis, c->minLimit, c->maxLimit
+            );
+            break;
+
+        case EMCMOT_SET_AXIS_LOCKING_JOINT:
+            log_print(
+                "SET_AXIS_LOCKING_JOINT axis=%d, locking_joint=%d\n",
+                c->axis, c->joint
+            );
+            break;
+
+        case EMCMOT_SET_JOINT_BACKLASH:
+            log_print("SET_JOINT_BACKLASH joint=%d, backlash=%.6f\n", c->joint, c->backlash);
+            break;
+
+        case EMCMOT_SET_JOINT_MIN_FERROR:
+            log_print("SET_JOINT_MIN_FERROR joint=%d, minFerror=%.6f\n", c->joint, c->minFerror);
+            break;
+
+        case EMCMOT_SET_JOINT_MAX_FERROR:
+            log_print("SET_JOINT_MAX_FERROR joint=%d, maxFerror=%.6f\n", c->joint, c->maxFerror);
+            break;
+
+        case EMCMOT_SET_VEL:
+            log_print("SET_VEL vel=%.6f, ini_maxvel=%.6f\n", c->vel, c->ini_maxvel);
+            break;
+
+        case EMCMOT_SET_VEL_LIMIT:
+            log_print("SET_VEL_LIMIT vel=%.6f\n", c->vel);
+            break;
+
+        case EMCMOT_SET_AXIS_VEL_LIMIT:
+            log_print("SET_AXIS_VEL_LIMIT axis=%d vel=%.6f\n", c->axis, c->vel);
+            break;
+
+        case EMCMOT_SET_JOINT_VEL_LIMIT:
+            log_print("SET_JOINT_VEL_LIMIT joint=%d, vel=%.6f\n", c->joint, c->vel);
+            break;
+
+        case EMCMOT_SET_AXIS_ACC_LIMIT:
+            log_print("SET_AXIS_ACC_LIMIT axis=%d, acc=%.6f\n", c->axis, c->acc);
+            break;
+
+        case EMCMOT_SET_JOINT_ACC_LIMIT:
+            log_print("SET_JOINT_ACC_LIMIT joint=%d, acc=%.6f\n", c->joint, c->acc);
+            break;
+
+        case EMCMOT_SET_ACC:
+            log_print("SET_ACC acc=%.6f\n", c->acc);
+            break;
+
+        case EMCMOT_SET_TERM_COND:
+            log_print("SET_TERM_COND termCond=%d, tolerance=%.6f\n", c->termCond, c->tolerance);
+            break;
+
+        case EMCMOT_SET_NUM_JOINTS:
+            log_print("SET_NUM_JOINTS %d\n", c->joint);
+            break;
+
+        case EMCMOT_SET_WORLD_HOME:
+            log_print(
+                "SET_WORLD_HOME x=%.6f, y=%.6f, z=%.6f, a=%.6f, b=%.6f, c=%.6f, u=%.6f, v=%.6f, w=%.6f\n",
+                c->pos.tran.x, c->pos.tran.y, c->pos.tran.z,
+                c->pos.a, c->pos.b, c->pos.c,
+                c->pos.u, c->pos.v, c->pos.w
+            );
+            break;
+
+        case EMCMOT_SET_JOINT_HOMING_PARAMS:
+            log_print(
+                "SET_JOINT_HOMING_PARAMS joint=%d, offset=%.6f home=%.6f, final_vel=%.6f, search_vel=%.6f, latch_vel=%.6f, flags=0x%08x, sequence=%d, volatile=%d\n",
+                c->joint, c->offset, c->home, c->home_final_vel,
+                c->search_vel, c->latch_vel, c->flags,
+                c->home_sequence, c->volatile_home
+            );
+            break;
+
+        case EMCMOT_UPDATE_JOINT_HOMING_PARAMS:
+            log_print(
+                "UPDATE_JOINT_HOMING_PARAMS joint=%d, offset=%.6f home=%.6f\n",
+                c->joint, c->offset, c->home
+            );
+            break;
+
+        case EMCMOT_SET_DEBUG:
+            log_print("SET_DEBUG\n");
+            break;
+
+        case EMCMOT_SET_DOUT:
+            log_print("SET_DOUT\n");
+            break;
+
+        case EMCMOT_SET_AOUT:
+            log_print("SET_AOUT\n");
+            break;
+
+        case EMCMOT_SET_SPINDLESYNC:
+            log_print("SET_SPINDLESYNC sync=%06f, flags=0x%08x\n", c->spindlesync, c->flags);
+            break;
+
+        case EMCMOT_SPINDLE_ON:
+            log_print("SPINDLE_ON speed=%f, css_factor=%f, xoffset=%f\n", c->vel, c->ini_maxvel, c->acc);
+            break;
+
+        case EMCMOT_SPINDLE_OFF:
+            log_print("SPINDLE_OFF\n");
+            break;
+
+        case EMCMOT_SPINDLE_INCREASE:
+            log_print("SPINDLE_INCREASE\n");
+            break;
+
+        case EMCMOT_SPINDLE_DECREASE:
+            log_print("SPINDLE_DECREASE\n");
+            break;
+
+        case EMCMOT_SPINDLE_BRAKE_ENGAGE:
+            log_print("SPINDLE_BRAKE_ENGAGE\n");
+            break;
+
+        case EMCMOT_SPINDLE_BRAKE_RELEASE:
+            log_print("SPINDLE_BRAKE_RELEASE\n");
+            break;
+
+        case EMCMOT_SPINDLE_ORIENT:
+            log_print("SPINDLE_ORIENT\n");
+            break;
+
+        case EMCMOT_SET_JOINT_MOTOR_OFFSET:
+            log_print("SET_JOINT_MOTOR_OFFSET\n");
+            break;
+
+        case EMCMOT_SET_JOINT_COMP:
+            log_print("SET_JOINT_COMP\n");
+            break;
+
+        case EMCMOT_SET_VOLCOMP:
+            log_print("SET_VOLCOMP n=%d,%d,%d\n",
+                c->volcomp_n[0], c->volcomp_n[1], c->volcomp_n[2]);
+            break;
+
+        case EMCMOT_SET_OFFSET:
+            log_print(
+                "SET_OFFSET x=%.6f, y=%.6f, z=%.6f, a=%.6f, b=%.6f, c=%.6f u=%.6f, v=%.6f, w=%.6f\n",
+                c->tool_offset.tran.x, c->tool_offset.tran.y, c->tool_offset.tran.z,
+                c->tool_offset.a, c->tool_offset.b, c->tool_offset.c,
+                c->tool_offset.u, c->tool_offset.v, c->tool_offset.w
+            );
+            break;
+
+        case EMCMOT_SET_MAX_FEED_OVERRIDE:
+            log_print("SET_MAX_FEED_OVERRIDE %.6f\n", c->maxFeedScale);
+            break;
+
+        case EMCMOT_SETUP_ARC_BLENDS:
+            log_print("SETUP_ARC_BLENDS\n");
+            break;
+
+        case EMCMOT_SETUP_PLANNER:
+            if (c->rapidIndependent) {
+                log_print("SETUP_PLANNER type=%d, max_jerk=%f, rapid_z=%f\n",
+                          c->plannerType,
+                          c->maxJerk,
+                          c->rapidClearance);
+            } else {
+                log_print("SETUP_PLANNER type=%d, max_jerk=%f\n",
+                          c->plannerType,
+                          c->maxJerk);
+            }
+            break;
 
-            case EMCMOT_FS_ENABLE:
-                log_print("FS_ENABLE\n");
-                break;
+        case EMCMOT_SET_PROBE_ERR_INHIBIT:
+            log_print("SETUP_SET_PROBE_ERR_INHIBIT %d %d\n",
+                      c->probe_jog_err_inhibit,
+                      c->probe_home_err_inhibit);
+            break;
 
-            case EMCMOT_FH_ENABLE:
-                log_print("FH_ENABLE\n");
-                break;
 
-            case EMCMOT_AF_ENABLE:
-                log_print("AF_ENABLE\n");
-                break;
+        default:
+            log_print("ERROR: unknown command %d\n", c->command);
+            break;
+    }
+}
 
-            case EMCMOT_OVERRIDE_LIMITS:
-                log_print("OVERRIDE_LIMITS\n");
-                break;
 
-            case EMCMOT_JOINT_HOME:
-                log_print("JOINT_HOME joint=%d\n", c->joint);
-                if (c->joint < 0) {
-                    for (int j = 0; j < num_joints; j ++) {
-                        mark_joint_homed(j);
-                    }
-                } else {
-                    mark_joint_homed(c->joint);
+// Does what Motion would to the parts of the status Task waits for.
+static void apply_command(const emcmot_command_t *c) {
+    switch (c->command) {
+        case EMCMOT_ENABLE:
+            SET_MOTION_ENABLE_FLAG(1);
+            update_motion_state();
+            break;
+
+        case EMCMOT_DISABLE:
+            SET_MOTION_ENABLE_FLAG(0);
+            update_motion_state();
+            break;
+
+        case EMCMOT_FREE:
+            SET_MOTION_COORD_FLAG(0);
+            SET_MOTION_TELEOP_FLAG(0);
+            update_motion_state();
+            break;
+
+        case EMCMOT_COORD:
+            SET_MOTION_COORD_FLAG(1);
+            SET_MOTION_TELEOP_FLAG(0);
+            SET_MOTION_ERROR_FLAG(0);
+            update_motion_state();
+            break;
+
+        case EMCMOT_TELEOP:
+            SET_MOTION_TELEOP_FLAG(1);
+            SET_MOTION_ERROR_FLAG(0);
+            update_motion_state();
+            break;
+
+        case EMCMOT_JOINT_HOME:
+            if (c->joint < 0) {
+                for (int j = 0; j < num_joints; j ++) {
+                    mark_joint_homed(j);
                 }
-                break;
-
-            case EMCMOT_JOINT_UNHOME:
-                log_print("JOINT_UNHOME joint=%d\n", c->joint);
-                break;
-
-            case EMCMOT_JOG_CONT:
-                log_print("JOG_CONT\n");
-                break;
-
-            case EMCMOT_JOG_INCR:
-                log_print("JOG_INCR\n");
-                break;
-
-            case EMCMOT_JOG_ABS:
-                log_print("JOG_ABS\n");
-                break;
-
-            case EMCMOT_SET_LINE:
-                log_print(
-                    "SET_LINE x=%.6f, y=%.6f, z=%.6f, a=%.6f, b=%.6f, c=%.6f, u=%.6f, v=%.6f, w=%.6f, id=%d, motion_type=%d, vel=%.6f, ini_maxvel=%.6f, acc=%.6f, turn=%d\n",
-                    c->pos.tran.x, c->pos.tran.y, c->pos.tran.z,
-                    c->pos.a, c->pos.b, c->pos.c,
-                    c->pos.u, c->pos.v, c->pos.w,
-                    c->id, c->motion_type,
-                    c->vel, c->ini_maxvel,
-                    c->acc, c->turn
-                );
-                break;
-
-            case EMCMOT_SET_CIRCLE:
-                log_print("SET_CIRCLE:\n");
-                log_print(
-                    "    pos: x=%.6f, y=%.6f, z=%.6f, a=%.6f, b=%.6f, c=%.6f, u=%.6f, v=%.6f, w=%.6f\n",
-                    c->pos.tran.x, c->pos.tran.y, c->pos.tran.z,
-                    c->pos.a, c->pos.b, c->pos.c,
-                    c->pos.u, c->pos.v, c->pos.w
-                );
-                log_print("    center: x=%.6f, y=%.6f, z=%.6f\n", c->center.x, c->center.y, c->center.z);
-                log_print("    normal: x=%.6f, y=%.6f, z=%.6f\n", c->normal.x, c->normal.y, c->normal.z);
-                log_print("    id=%d, motion_type=%d, vel=%.6f, ini_maxvel=%.6f, acc=%.6f, turn=%d\n",
-                    c->id, c->motion_type,
-                    c->vel, c->ini_maxvel,
-                    c->acc, c->turn
-                );
-                break;
-
-            case EMCMOT_SET_TELEOP_VECTOR:
-                log_print("SET_TELEOP_VECTOR\n");
-                break;
-
-            case EMCMOT_CLEAR_PROBE_FLAGS:
-                log_print("CLEAR_PROBE_FLAGS\n");
-                break;
-
-            case EMCMOT_PROBE:
-                log_print("PROBE\n");
-                break;
-
-            case EMCMOT_RIGID_TAP:
-                log_print("RIGID_TAP\n");
-                break;
-
-            case EMCMOT_SET_JOINT_POSITION_LIMITS:
-                log_print(
-                    "SET_JOINT_POSITION_LIMITS joint=%d, min=%.6f, max=%.6f\n",
-                    c->joint, c->minLimit, c->maxLimit
-                );
-                joints[c->joint].max_pos_limit = c->maxLimit;
-                joints[c->joint].min_pos_limit = c->minLimit;
-                break;
-
-            case EMCMOT_SET_AXIS_POSITION_LIMITS:
-                log_print(
-                    "SET_AXIS_POSITION_LIMITS axis=%d, min=%.6f, max=%.6f\n",
-                    c->axis, c->minLimit, c->maxLimit
-                );
-                axes[c->axis].max_pos_limit = c->maxLimit;
-                axes[c->axis].min_pos_limit = c->minLimit;
-                break;
-
-            case EMCMOT_SET_AXIS_LOCKING_JOINT:
-                log_print(
-                    "SET_AXIS_LOCKING_JOINT axis=%d, locking_joint=%d\n",
-                    c->axis, c->joint
-                );
-                axes[c->axis].locking_joint = c->joint;
-                break;
-
-            case EMCMOT_SET_JOINT_BACKLASH:
-                log_print("SET_JOINT_BACKLASH joint=%d, backlash=%.6f\n", c->joint, c->backlash);
-                break;
-
-            case EMCMOT_SET_JOINT_MIN_FERROR:
-                log_print("SET_JOINT_MIN_FERROR joint=%d, minFerror=%.6f\n", c->joint, c->minFerror);
-                break;
-
-            case EMCMOT_SET_JOINT_MAX_FERROR:
-                log_print("SET_JOINT_MAX_FERROR joint=%d, maxFerror=%.6f\n", c->joint, c->maxFerror);
-                break;
-
-            case EMCMOT_SET_VEL:
-                log_print("SET_VEL vel=%.6f, ini_maxvel=%.6f\n", c->vel, c->ini_maxvel);
-                break;
-
-            case EMCMOT_SET_VEL_LIMIT:
-                log_print("SET_VEL_LIMIT vel=%.6f\n", c->vel);
-                break;
-
-            case EMCMOT_SET_AXIS_VEL_LIMIT:
-                log_print("SET_AXIS_VEL_LIMIT axis=%d vel=%.6f\n", c->axis, c->vel);
-                break;
-
-            case EMCMOT_SET_JOINT_VEL_LIMIT:
-                log_print("SET_JOINT_VEL_LIMIT joint=%d, vel=%.6f\n", c->joint, c->vel);
-                break;
-
-            case EMCMOT_SET_AXIS_ACC_LIMIT:
-                log_print("SET_AXIS_ACC_LIMIT axis=%d, acc=%.6f\n", c->axis, c->acc);
-                break;
+            } else {
+                mark_joint_homed(c->joint);
+            }
+            break;
 
-            case EMCMOT_SET_JOINT_ACC_LIMIT:
-                log_print("SET_JOINT_ACC_LIMIT joint=%d, acc=%.6f\n", c->joint, c->acc);
-                break;
+        case EMCMOT_SET_JOINT_POSITION_LIMITS:
+            joints[c->joint].max_pos_limit = c->maxLimit;
+            joints[c->joint].min_pos_limit = c->minLimit;
+            break;
 
-            case EMCMOT_SET_ACC:
-                log_print("SET_ACC acc=%.6f\n", c->acc);
-                break;
+        case EMCMOT_SET_AXIS_POSITION_LIMITS:
+            axes[c->axis].max_pos_limit = c->maxLimit;
+            axes[c->axis].min_pos_limit = c->minLimit;
+            break;
 
-            case EMCMOT_SET_TERM_COND:
-                log_print("SET_TERM_COND termCond=%d, tolerance=%.6f\n", c->termCond, c->tolerance);
-                break;
+        case EMCMOT_SET_AXIS_LOCKING_JOINT:
+            axes[c->axis].locking_joint = c->joint;
+            break;
 
-            case EMCMOT_SET_NUM_JOINTS:
-                log_print("SET_NUM_JOINTS %d\n", c->joint);
-                num_joints = c->joint;
-                break;
+        case EMCMOT_SET_NUM_JOINTS:
+            num_joints = c->joint;
+            break;
 
-            case EMCMOT_SET_WORLD_HOME:
-                log_print(
-                    "SET_WORLD_HOME x=%.6f, y=%.6f, z=%.6f, a=%.6f, b=%.6f, c=%.6f, u=%.6f, v=%.6f, w=%.6f\n",
-                    c->pos.tran.x, c->pos.tran.y, c->pos.tran.z,
-                    c->pos.a, c->pos.b, c->pos.c,
-                    c->pos.u, c->pos.v, c->pos.w
-                );
-                break;
+        case EMCMOT_SPINDLE_ON:
+            emcmotStatus->spindle.speed = c->vel;
+            break;
 
-            case EMCMOT_SET_JOINT_HOMING_PARAMS:
-                log_print(
-                    "SET_JOINT_HOMING_PARAMS joint=%d, offset=%.6f home=%.6f, final_vel=%.6f, search_vel=%.6f, latch_vel=%.6f, flags=0x%08x, sequence=%d, volatile=%d\n",
-                    c->joint, c->offset, c->home, c->home_final_vel,
-                    c->search_vel, c->latch_vel, c->flags,
-                    c->home_sequence, c->volatile_home
-                );
-                break;
-
-            case EMCMOT_UPDATE_JOINT_HOMING_PARAMS:
-                log_print(
-                    "UPDATE_JOINT_HOMING_PARAMS joint=%d, offset=%.6f home=%.6f\n",
-                    c->joint, c->offset, c->home
-                );
-                break;
+        case EMCMOT_SPINDLE_OFF:
+            emcmotStatus->spindle.speed = 0;
+            break;
 
-            case EMCMOT_SET_DEBUG:
-                log_print("SET_DEBUG\n");
-                break;
-
-            case EMCMOT_SET_DOUT:
-                log_print("SET_DOUT\n");
-                break;
-
-            case EMCMOT_SET_AOUT:
-                log_print("SET_AOUT\n");
-                break;
-
-            case EMCMOT_SET_SPINDLESYNC:
-                log_print("SET_SPINDLESYNC sync=%06f, flags=0x%08x\n", c->spindlesync, c->flags);
-                break;
+        default:
+            break;
+    }
+}
 
-            case EMCMOT_SPINDLE_ON:
-                log_print("SPINDLE_ON speed=%f, css_factor=%f, xoffset=%f\n", c->vel, c->ini_maxvel, c->acc);
-                emcmotStatus->spindle.speed = c->vel;
-                break;
 
-            case EMCMOT_SPINDLE_OFF:
-                log_print("SPINDLE_OFF\n");
-                emcmotStatus->spindle.speed = 0;
-                break;
+// Prints a binary capture in the text format, for -d.
+static int dump(const char *name, int times) {
+    capture_t cap;
+    capture_record_t record;
+    int64_t start = 0;
+    int r, n = 0;
 
-            case EMCMOT_SPINDLE_INCREASE:
-                log_print("SPINDLE_INCREASE\n");
-                break;
+    if (capture_open(&cap, name) < 0) {
+        return 1;
+    }
+    if (!cap.binary) {
+        fprintf(stderr, "%s: not a binary capture\n", name);
+        capture_close(&cap);
+        return 1;
+    }
+    while ((r = capture_read(&cap, &record)) > 0) {
+        if (n++ == 0) {
+            start = record.time_ns;
+        }
+        if (times) {
+            log_print("%.6f ", (record.time_ns - start) * 1e-9);
+        }
+        log_command(&record.command);
+    }
+    if (r < 0) {
+        fprintf(stderr, "%s: short record after %d commands\n", name, n);
+    }
+    if (capture_close(&cap) < 0 || r < 0) {
+        return 1;
+    }
+    return 0;
+}
 
-            case EMCMOT_SPINDLE_DECREASE:
-                log_print("SPINDLE_DECREASE\n");
-                break;
 
-            case EMCMOT_SPINDLE_BRAKE_ENGAGE:
-                log_print("SPINDLE_BRAKE_ENGAGE\n");
-                break;
+static void usage(void) {
+    fprintf(stderr,
+        "usage: motion-logger [LOGFILE]\n"
+        "       motion-logger -b [-z] CAPTURE\n"
+        "       motion-logger -d [-t] CAPTURE [LOGFILE]\n");
+    exit(1);
+}
 
-            case EMCMOT_SPINDLE_BRAKE_RELEASE:
-                log_print("SPINDLE_BRAKE_RELEASE\n");
-                break;
 
-            case EMCMOT_SPINDLE_ORIENT:
-                log_print("SPINDLE_ORIENT\n");
-                break;
+int main(int argc, char* argv[]) {
+    int opt, dump_mode = 0, dump_times = 0;
+
+    while ((opt = getopt(argc, argv, "bzdt")) != -1) {
+        switch (opt) {
+            case 'z': capture_compress = 1; // fall through
+            case 'b': capture = 1; break;
+            case 'd': dump_mode = 1; break;
+            case 't': dump_times = 1; break;
+            default: usage();
+        }
+    }
+    argc -= optind - 1;
+    argv += optind - 1;
 
-            case EMCMOT_SET_JOINT_MOTOR_OFFSET:
-                log_print("SET_JOINT_MOTOR_OFFSET\n");
-                break;
+    if (dump_mode) {
+        if (capture || argc < 2 || argc > 3) {
+            usage();
+        }
+        logfile = argc == 3 ? NULL : stdout;
+        logfile_name = argc == 3 ? argv[2] : NULL;
+        return dump(argv[1], dump_times);
+    }
+    if (argc == 1 && !capture) {
+        logfile = stdout;
+        logfile_name = NULL;
+    } else if (argc == 2) {
+        logfile = NULL;
+        logfile_name = argv[1];
+    } else {
+        usage();
+    }
 
-            case EMCMOT_SET_JOINT_COMP:
-                log_print("SET_JOINT_COMP\n");
-                break;
+    mot_comp_id = hal_init("motion-logger");
+    motion_logger_data = hal_malloc(sizeof(*motion_logger_data));
+    int r = hal_pin_bit_new("motion-logger.reopen-log", HAL_IO, &motion_logger_data->reopen,
+            mot_comp_id);
+    if(r < 0) { errno = -r; perror("hal_pin_bit_new"); exit(1); }
+    *motion_logger_data->reopen = 0;
+    r = hal_ready(mot_comp_id);
+    if(r < 0) { errno = -r; perror("hal_ready"); exit(1); }
+    init_comm_buffers();
 
-            case EMCMOT_SET_OFFSET:
-                log_print(
-                    "SET_OFFSET x=%.6f, y=%.6f, z=%.6f, a=%.6f, b=%.6f, c=%.6f u=%.6f, v=%.6f, w=%.6f\n",
-                    c->tool_offset.tran.x, c->tool_offset.tran.y, c->tool_offset.tran.z,
-                    c->tool_offset.a, c->tool_offset.b, c->tool_offset.c,
-                    c->tool_offset.u, c->tool_offset.v, c->tool_offset.w
-                );
-                break;
+    if (capture) {
+        // finish the capture when halrun stops us
+        signal(SIGTERM, quit);
+        signal(SIGINT, quit);
+        capture_start();
+    }
 
-            case EMCMOT_SET_MAX_FEED_OVERRIDE:
-                log_print("SET_MAX_FEED_OVERRIDE %.6f\n", c->maxFeedScale);
-                break;
+    while (!done) {
+        if (ring->tail == emcmotRingLoad(&ring->head)) {
+            // nothing new
+            if (capture) {
+                capture_idle();
+            } else {
+                maybe_reopen_logfile();
+            }
+            usleep(10 * 1000);
+            continue;
+        }
 
-            case EMCMOT_SETUP_ARC_BLENDS:
-                log_print("SETUP_ARC_BLENDS\n");
-                break;
+        //
+        // new incoming command!
+        //
 
-            case EMCMOT_SET_PROBE_ERR_INHIBIT:
-                log_print("SETUP_SET_PROBE_ERR_INHIBIT %d %d\n",
-                          c->probe_jog_err_inhibit,
-                          c->probe_home_err_inhibit);
-                break;
+        c = &ring->slot[ring->tail % EMCMOT_COMMAND_RING_SIZE];
 
+        emcmotStatusWriteBegin(emcmotStatus);
 
-            default:
-                log_print("ERROR: unknown command %d\n", c->command);
-                break;
+        if (capture) {
+            capture_put(c);
+        } else {
+            log_command(c);
         }
+        apply_command(c);
 
         update_joint_status();
 
         emcmotStatus->commandEcho = c->command;
         emcmotStatus->commandNumEcho = c->commandNum;
         emcmotStatus->commandStatus = EMCMOT_COMMAND_OK;
-        emcmotStatus->tail = emcmotStatus->head;
+        emcmotStatusWriteEnd(emcmotStatus);
+        emcmotRingStore(&ring->tail, ring->tail + 1);
     }
 
+    if (capture) {
+        capture_finish();
+    }
+    hal_exit(mot_comp_id);
     return 0;
 }
 
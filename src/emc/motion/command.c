@@ -72,6 +72,37 @@
 
 static int rehomeAll;
 
+/* build_comp_index() fills in the bucket index of a compensation table
+   after an entry was added, so compute_screw_comp() can go straight to
+   the entry for a position. */
+static void build_comp_index(emcmot_comp_t *comp)
+{
+    int b, e, buckets;
+    double start, span;
+
+    comp->index_buckets = 0;
+    if (comp->entries < 2) {
+	return;
+    }
+    start = comp->array[1].nominal;
+    span = comp->array[comp->entries].nominal - start;
+    buckets = 2 * comp->entries;
+    if (buckets > EMCMOT_COMP_INDEX) {
+	buckets = EMCMOT_COMP_INDEX;
+    }
+    comp->index_start = start;
+    comp->index_scale = buckets / span;
+    e = 1;
+    for (b = 0; b < buckets; b++) {
+	double nominal = start + b / comp->index_scale;
+	while (e < comp->entries && comp->array[e + 1].nominal <= nominal) {
+	    e++;
+	}
+	comp->index[b] = e;
+    }
+    comp->index_buckets = buckets;
+}
+
 /* loops through the active joints and checks if any are not homed */
 int checkAllHomed(void)
 {
@@ -392,10 +423,11 @@ STATIC int is_feed_type(int motion_type)
 }
 
 /*
-  emcmotCommandHandler() is called each main cycle to read the
-  shared memory buffer
+  emcmotCommandProcess() handles the single command that emcmotCommand
+  points at.  The caller brackets it with emcmotStatusWriteBegin() and
+  emcmotStatusWriteEnd(), so the commands can return early.
   */
-void emcmotCommandHandler(void *arg, long period)
+static void emcmotCommandProcess(void)
 {
     int joint_num, axis_num;
     int n;
@@ -403,18 +435,13 @@ void emcmotCommandHandler(void *arg, long period)
     emcmot_axis_t *axis;
     double tmp1;
     emcmot_comp_entry_t *comp_entry;
+    emcmot_probe_step_t *step;
     char issue_atspeed = 0;
     int abort = 0;
     char* emsg;
 
-    /* check for split read */
-    if (emcmotCommand->head != emcmotCommand->tail) {
-	emcmotDebug->split++;
-	return;			/* not really an error */
-    }
     if (emcmotCommand->commandNum != emcmotStatus->commandNumEcho) {
 	/* increment head count-- we'll be modifying emcmotStatus */
-	emcmotStatus->head++;
 	emcmotDebug->head++;
 
 	/* got a new command-- echo command and number... */
@@ -503,6 +530,12 @@ void emcmotCommandHandler(void *arg, long period)
                 }
 	    } else if (GET_MOTION_COORD_FLAG()) {
 		tpAbort(&emcmotDebug->coord_tp);
+		emcmotDebug->probe_step = -1;
+		emcmotDebug->probe_step_count = 0;
+		/* a running stream stops the way it does when it fails */
+		if (emcmotDebug->stream_state == STREAM_RUN) {
+		    emcmotDebug->stream_state = STREAM_STOP;
+		}
 	    } else {
 		for (joint_num = 0; joint_num < emcmotConfig->numJoints; joint_num++) {
 		    /* point to joint struct */
@@ -1460,6 +1493,88 @@ void emcmotCommandHandler(void *arg, long period)
 	    rtapi_print_msg(RTAPI_MSG_DBG, "CLEAR_PROBE_FLAGS");
 	    emcmotStatus->probing = 0;
             emcmotStatus->probeTripped = 0;
+	    /* also drops the moves of a probe sequence not yet run */
+	    if (emcmotDebug->probe_step < 0) {
+		emcmotDebug->probe_step_count = 0;
+	    }
+	    break;
+
+	case EMCMOT_PROBE_SEQUENCE_ADD:
+	    /* checked here like EMCMOT_PROBE, run later by
+	       run_probe_sequence() in control.c */
+	    rtapi_print_msg(RTAPI_MSG_DBG, "PROBE_SEQUENCE_ADD");
+	    if (emcmotDebug->probe_step >= 0) {
+		reportError(_("can't add to a probe sequence while it runs"));
+		emcmotStatus->commandStatus = EMCMOT_COMMAND_INVALID_COMMAND;
+		break;
+	    }
+	    n = 0;
+	    if (emcmotCommand->motion_type == EMC_MOTION_TYPE_PROBING) {
+		n = 1;
+		for (step = emcmotDebug->probe_steps;
+		     step < emcmotDebug->probe_steps + emcmotDebug->probe_step_count; step++) {
+		    if (step->motion_type == EMC_MOTION_TYPE_PROBING) {
+			n++;
+		    }
+		}
+	    }
+	    if (emcmotDebug->probe_step_count >= EMCMOT_MAX_PROBE_STEPS
+		|| n > EMCMOT_MAX_PROBE_POINTS) {
+		reportError(_("probe sequence too long, at most %d moves and %d probe moves"),
+			    EMCMOT_MAX_PROBE_STEPS, EMCMOT_MAX_PROBE_POINTS);
+		emcmotStatus->commandStatus = EMCMOT_COMMAND_INVALID_PARAMS;
+		emcmotDebug->probe_step_count = 0;
+		break;
+	    } else if (!inRange(emcmotCommand->pos, emcmotCommand->id, "Probe")) {
+		emcmotStatus->commandStatus = EMCMOT_COMMAND_INVALID_PARAMS;
+		emcmotDebug->probe_step_count = 0;
+		break;
+	    }
+	    step = &emcmotDebug->probe_steps[emcmotDebug->probe_step_count++];
+	    step->pos = emcmotCommand->pos;
+	    step->motion_type = emcmotCommand->motion_type;
+	    step->vel = emcmotCommand->vel;
+	    step->ini_maxvel = emcmotCommand->ini_maxvel;
+	    step->acc = emcmotCommand->acc;
+	    step->probe_type = emcmotCommand->probe_type;
+	    step->id = emcmotCommand->id;
+	    break;
+
+	case EMCMOT_PROBE_SEQUENCE_RUN:
+	    rtapi_print_msg(RTAPI_MSG_DBG, "PROBE_SEQUENCE_RUN");
+	    if (!GET_MOTION_COORD_FLAG() || !GET_MOTION_ENABLE_FLAG()) {
+		reportError(_("need to be enabled, in coord mode for probe move"));
+		emcmotStatus->commandStatus = EMCMOT_COMMAND_INVALID_COMMAND;
+		emcmotDebug->probe_step_count = 0;
+		SET_MOTION_ERROR_FLAG(1);
+		break;
+	    } else if (emcmotDebug->probe_step >= 0) {
+		reportError(_("a probe sequence is already running"));
+		emcmotStatus->commandStatus = EMCMOT_COMMAND_INVALID_COMMAND;
+		break;
+	    } else if (emcmotDebug->probe_step_count == 0) {
+		reportError(_("no probe sequence to run"));
+		emcmotStatus->commandStatus = EMCMOT_COMMAND_INVALID_COMMAND;
+		emcmotDebug->probe_step_count = 0;
+		SET_MOTION_ERROR_FLAG(1);
+		break;
+	    } else if (!limits_ok()) {
+		reportError(_("can't do probe move with limits exceeded"));
+		emcmotStatus->commandStatus = EMCMOT_COMMAND_INVALID_PARAMS;
+		emcmotDebug->probe_step_count = 0;
+		SET_MOTION_ERROR_FLAG(1);
+		break;
+	    }
+	    emcmotStatus->probePointCount = 0;
+	    emcmotStatus->probePointsTripped = 0;
+	    emcmotDebug->probe_step = 0;
+	    emcmotDebug->probe_step_started = 0;
+	    /* count the moves as queued before the first reaches the
+	       planner, so task doesn't see motion done in between */
+	    emcmotStatus->depth = tpQueueDepth(&emcmotDebug->coord_tp)
+		+ emcmotDebug->probe_step_count;
+	    SET_MOTION_ERROR_FLAG(0);
+	    rehomeAll = 1;
 	    break;
 
 	case EMCMOT_PROBE:
@@ -1724,6 +1839,41 @@ void emcmotCommandHandler(void *arg, long period)
 		comp_entry[0].rev_trim = comp_entry[1].rev_trim;
 	    }
 	    joint->comp.entries++;
+	    build_comp_index(&joint->comp);
+	    break;
+
+	case EMCMOT_SET_VOLCOMP:
+	    /* can be done only while the machine is off, turning the
+	       correction on or off would make the joints jump */
+	    rtapi_print_msg(RTAPI_MSG_DBG, "SET_VOLCOMP");
+	    if (GET_MOTION_ENABLE_FLAG()) {
+		reportError(_("can't change volumetric compensation while the machine is on"));
+		emcmotStatus->commandStatus = EMCMOT_COMMAND_INVALID_COMMAND;
+		break;
+	    }
+	    emcmotVolcomp->enabled = 0;
+	    if (emcmotCommand->volcomp_n[0] == 0) {
+		/* just turn it off, so user space can write new points */
+		break;
+	    }
+	    for (n = 0; n < 3; n++) {
+		if (emcmotCommand->volcomp_n[n] < 2
+			|| !(emcmotCommand->volcomp_spacing[n] > 0.0)) {
+		    break;
+		}
+	    }
+	    if (n < 3 || emcmotCommand->volcomp_n[0] * emcmotCommand->volcomp_n[1]
+		    > EMCMOT_VOLCOMP_SIZE / emcmotCommand->volcomp_n[2]) {
+		reportError(_("bad volumetric compensation grid"));
+		emcmotStatus->commandStatus = EMCMOT_COMMAND_INVALID_PARAMS;
+		break;
+	    }
+	    for (n = 0; n < 3; n++) {
+		emcmotVolcomp->n[n] = emcmotCommand->volcomp_n[n];
+		emcmotVolcomp->origin[n] = emcmotCommand->volcomp_origin[n];
+		emcmotVolcomp->scale[n] = 1.0 / emcmotCommand->volcomp_spacing[n];
+	    }
+	    emcmotVolcomp->enabled = 1;
 	    break;
 
         case EMCMOT_SET_OFFSET:
@@ -1789,10 +1939,23 @@ void emcmotCommandHandler(void *arg, long period)
             emcmotConfig->arcBlendEnable = emcmotCommand->arcBlendEnable;
             emcmotConfig->arcBlendFallbackEnable = emcmotCommand->arcBlendFallbackEnable;
             emcmotConfig->arcBlendOptDepth = emcmotCommand->arcBlendOptDepth;
+            emcmotConfig->arcBlendOptMode = emcmotCommand->arcBlendOptMode;
             emcmotConfig->arcBlendGapCycles = emcmotCommand->arcBlendGapCycles;
             emcmotConfig->arcBlendRampFreq = emcmotCommand->arcBlendRampFreq;
             emcmotConfig->arcBlendTangentKinkRatio = emcmotCommand->arcBlendTangentKinkRatio;
             break;
+        case EMCMOT_SETUP_PLANNER:
+            rtapi_print_msg(RTAPI_MSG_DBG, "SETUP_PLANNER");
+            emcmotConfig->plannerType = emcmotCommand->plannerType;
+            emcmotConfig->maxJerk = emcmotCommand->maxJerk;
+            emcmotConfig->rapidIndependent = emcmotCommand->rapidIndependent;
+            emcmotConfig->rapidClearance = emcmotCommand->rapidClearance;
+            if (emcmotConfig->plannerType == TP_PLANNER_SCURVE) {
+                tpSetJmax(&emcmotDebug->coord_tp, emcmotConfig->maxJerk);
+            } else {
+                tpSetJmax(&emcmotDebug->coord_tp, 0.0);
+            }
+            break;
         case EMCMOT_SET_PROBE_ERR_INHIBIT:
             emcmotConfig->inhibit_probe_jog_error = emcmotCommand->probe_jog_err_inhibit;
             emcmotConfig->inhibit_probe_home_error = emcmotCommand->probe_home_err_inhibit;
@@ -1802,10 +1965,10 @@ void emcmotCommandHandler(void *arg, long period)
 	if (emcmotStatus->commandStatus != EMCMOT_COMMAND_OK) {
 	    rtapi_print_msg(RTAPI_MSG_DBG, "ERROR: %d",
 		emcmotStatus->commandStatus);
+	    emcmotStatus->commandFailures++;
 	}
 	rtapi_print_msg(RTAPI_MSG_DBG, "\n");
 	/* synch tail count */
-	emcmotStatus->tail = emcmotStatus->head;
 	emcmotConfig->tail = emcmotConfig->head;
 	emcmotDebug->tail = emcmotDebug->head;
 
@@ -1814,3 +1977,47 @@ void emcmotCommandHandler(void *arg, long period)
 
     return;
 }
+
+/*
+  emcmotCommandHandler() is called each main cycle to drain the shared
+  memory command ring.  At most EMCMOT_COMMANDS_PER_PERIOD entries are
+  handled per call so a burst of segments can't blow the servo period.
+  */
+void emcmotCommandHandler(void *arg, long period)
+{
+    static int discard_queued = 0;
+    emcmot_command_ring_t *ring = emcmotCommandRing;
+    unsigned int head = emcmotRingLoad(&ring->head);
+    unsigned int tail = ring->tail;
+    int queued;
+    int n;
+
+    for (n = 0; tail != head && n < EMCMOT_COMMANDS_PER_PERIOD; n++) {
+	emcmotCommand = &ring->slot[tail % EMCMOT_COMMAND_RING_SIZE];
+	queued = emcmotCommandIsQueued(emcmotCommand->command);
+
+	if (queued && discard_queued) {
+	    /* an earlier queued command failed; drop the rest of the
+	       stream until task sends something it waits for */
+	    emcmotStatusWriteBegin(emcmotStatus);
+	    emcmotStatus->commandEcho = emcmotCommand->command;
+	    emcmotStatus->commandNumEcho = emcmotCommand->commandNum;
+	    emcmotStatus->commandStatus = EMCMOT_COMMAND_INVALID_COMMAND;
+	    emcmotStatus->commandFailures++;
+	    emcmotStatusWriteEnd(emcmotStatus);
+	} else {
+	    emcmotStatusWriteBegin(emcmotStatus);
+	    emcmotCommandProcess();
+	    emcmotStatusWriteEnd(emcmotStatus);
+	    if (!queued) {
+		discard_queued = 0;
+	    } else if (emcmotStatus->commandStatus != EMCMOT_COMMAND_OK) {
+		discard_queued = 1;
+		emcmotRingStore(&ring->errors, ring->errors + 1);
+	    }
+	}
+
+	tail++;
+	emcmotRingStore(&ring->tail, tail);
+    }
+}
@@ -84,6 +84,11 @@ static void do_forward_kins(void);
 */
 static void process_probe_inputs(void);
 
+/* 'run_probe_sequence()' gives the moves of a running probe sequence
+   to the planner one at a time, each when the one before has stopped,
+   and records where each probe move tripped, all without task. */
+static void run_probe_sequence(void);
+
 /* 'check_for_faults()' is responsible for detecting fault conditions
    such as limit switches, amp faults, following error, etc.  It only
    checks active axes.  It is also responsible for generating an error
@@ -134,6 +139,13 @@ static void handle_ajogwheels(void);
 */
 static void get_pos_cmds(long period);
 
+/* 'run_stream()' takes the place of the planner in coordinated mode
+   while motion.stream.enable is set and a feeder fills the stream of
+   motmod stream_channel=, and stops the machine itself when the
+   stream fails.  It returns nonzero if it set the commands this cycle.
+*/
+static int run_stream(void);
+
 /* 'compute_screw_comp()' is responsible for calculating backlash and
    lead screw error compensation.  (Leadscrew error compensation is
    a more sophisticated version that includes backlash comp.)  It uses
@@ -165,6 +177,32 @@ static void output_to_hal(void);
 */
 static void update_status(void);
 
+/* 'update_status_hot()' refreshes the compact emcmotStatusHot block
+   from emcmotStatus at the end of each cycle.
+*/
+static void update_status_hot(void);
+
+/* phase_done() ends the timing of one phase of the servo cycle and
+   starts the next, when motmod was loaded with phase_timing=1.  The
+   average is a running one over roughly the last hundred cycles.
+*/
+static long long int phase_start;
+static void phase_done(enum mot_phase phase);
+
+/* 'tp_stats_to_hal()' copies the trajectory planner statistics to the
+   motion.tp.* pins, when motmod was loaded with tp_stats=1, and clears
+   them while motion.tp.stats-reset is TRUE.
+*/
+static void tp_stats_to_hal(void);
+
+/* 'volcomp_apply()' adds the volumetric compensation at a commanded
+   position to it, before the inverse kinematics.  'volcomp_remove()'
+   takes it back out of a position found by the forward kinematics.
+   Both do nothing unless a grid was loaded.
+*/
+static void volcomp_apply(EmcPose *pos);
+static void volcomp_remove(EmcPose *pos);
+
 /***********************************************************************
 *                        PUBLIC FUNCTION CODE                          *
 ************************************************************************/
@@ -204,26 +242,37 @@ void emcmotController(void *arg, long period)
     /* it's faster to do vel = Dpos * freq */
     servo_freq = 1.0 / servo_period;
     /* increment head count to indicate work in progress */
-    emcmotStatus->head++;
+    emcmotStatusWriteBegin(emcmotStatus);
     /* here begins the core of the controller */
 
+    phase_start = now;
     process_inputs();
+    phase_done(MOT_PHASE_INPUTS);
     do_forward_kins();
+    phase_done(MOT_PHASE_KINS);
     process_probe_inputs();
+    run_probe_sequence();
     check_for_faults();
+    phase_done(MOT_PHASE_FAULTS);
     set_operating_mode();
     handle_jjogwheels();
     handle_ajogwheels();
     do_homing_sequence();
     do_homing();
+    phase_done(MOT_PHASE_MODE);
     get_pos_cmds(period);
+    phase_done(MOT_PHASE_CMDS);
     compute_screw_comp();
+    phase_done(MOT_PHASE_COMP);
     output_to_hal();
+    phase_done(MOT_PHASE_OUTPUT);
     update_status();
+    phase_done(MOT_PHASE_STATUS);
     /* here ends the core of the controller */
     emcmotStatus->heartbeat++;
     /* set tail to head, to indicate work complete */
-    emcmotStatus->tail = emcmotStatus->head;
+    emcmotStatusWriteEnd(emcmotStatus);
+    update_status_hot();
 /* end of controller function */
 }
 
@@ -236,16 +285,148 @@ void emcmotController(void *arg, long period)
    prototypes"
 */
 
+/* trilinear interpolation of the grid; positions outside it get the
+   correction of the nearest point on its faces */
+static void volcomp_correction(const PmCartesian *pos, double *corr)
+{
+    const emcmot_volcomp_t *v = emcmotVolcomp;
+    double p[3], t[3];
+    int i[3], k, dy, dz;
+    const float *c;
+
+    p[0] = pos->x;
+    p[1] = pos->y;
+    p[2] = pos->z;
+    for (k = 0; k < 3; k++) {
+	double f = (p[k] - v->origin[k]) * v->scale[k];
+	f = fmin(fmax(f, 0.0), v->n[k] - 1);
+	i[k] = (int) fmin(f, v->n[k] - 2);
+	t[k] = f - i[k];
+    }
+    dy = v->n[0];
+    dz = v->n[0] * v->n[1];
+    c = v->corr[(i[2] * v->n[1] + i[1]) * v->n[0] + i[0]];
+    for (k = 0; k < 3; k++) {
+	/* corr[] is float[3], so steps in x, y and z are 3, 3*dy and 3*dz */
+	double c00 = c[k] + t[0] * (c[k + 3] - c[k]);
+	double c10 = c[k + 3*dy] + t[0] * (c[k + 3*dy + 3] - c[k + 3*dy]);
+	double c01 = c[k + 3*dz] + t[0] * (c[k + 3*dz + 3] - c[k + 3*dz]);
+	double c11 = c[k + 3*(dy + dz)]
+	    + t[0] * (c[k + 3*(dy + dz) + 3] - c[k + 3*(dy + dz)]);
+	double c0 = c00 + t[1] * (c10 - c00);
+	double c1 = c01 + t[1] * (c11 - c01);
+	corr[k] = c0 + t[2] * (c1 - c0);
+    }
+}
+
+static void volcomp_apply(EmcPose *pos)
+{
+    double corr[3];
+
+    if (!emcmotVolcomp->enabled) {
+	return;
+    }
+    volcomp_correction(&pos->tran, corr);
+    pos->tran.x += corr[0];
+    pos->tran.y += corr[1];
+    pos->tran.z += corr[2];
+}
+
+static void volcomp_remove(EmcPose *pos)
+{
+    PmCartesian nominal;
+    double corr[3];
+    int n;
+
+    if (!emcmotVolcomp->enabled) {
+	return;
+    }
+    /* the correction changes slowly, two fixed point steps of
+       nominal = pos - corr(nominal) are plenty */
+    nominal = pos->tran;
+    for (n = 0; n < 2; n++) {
+	volcomp_correction(&nominal, corr);
+	nominal.x = pos->tran.x - corr[0];
+	nominal.y = pos->tran.y - corr[1];
+	nominal.z = pos->tran.z - corr[2];
+    }
+    pos->tran = nominal;
+}
+
+static void phase_done(enum mot_phase phase)
+{
+    long long int now;
+    hal_u32_t t;
+
+    if (!emcmot_hal_data->phase_timing) {
+	return;
+    }
+    now = rtapi_get_clocks();
+    t = (hal_u32_t)(now - phase_start);
+    phase_start = now;
+    if (*emcmot_hal_data->phase_reset) {
+	*(emcmot_hal_data->phase[phase].max) = 0;
+    }
+    *(emcmot_hal_data->phase[phase].time) = t;
+    if (t > *(emcmot_hal_data->phase[phase].max)) {
+	*(emcmot_hal_data->phase[phase].max) = t;
+    }
+    *(emcmot_hal_data->phase[phase].avg) +=
+	(t - *(emcmot_hal_data->phase[phase].avg)) * 0.01;
+}
+
+static void tp_stats_to_hal(void)
+{
+    tp_stats_t stats;
+    int n;
+
+    if (!emcmot_hal_data->tp_stats) {
+	return;
+    }
+    if (*emcmot_hal_data->tp_stats_reset) {
+	tpClearStats(&emcmotDebug->coord_tp);
+    }
+    tpGetStats(&emcmotDebug->coord_tp, &stats);
+    *(emcmot_hal_data->tp_cycles) = stats.cycles;
+    *(emcmot_hal_data->tp_starved) = stats.starved;
+    *(emcmot_hal_data->tp_lookahead) = stats.lookahead;
+    *(emcmot_hal_data->tp_vel_limited) = stats.vel_limited;
+    *(emcmot_hal_data->tp_acc_limited) = stats.acc_limited;
+    *(emcmot_hal_data->tp_slow_time) = stats.slow_time;
+    for (n = 0; n < TP_STATS_DEPTH_BUCKETS; n++) {
+	*(emcmot_hal_data->tp_depth[n]) = stats.depth[n];
+    }
+    *(emcmot_hal_data->tp_blend_tangent) = stats.blend_tangent;
+    *(emcmot_hal_data->tp_blend_arc) = stats.blend_arc;
+    *(emcmot_hal_data->tp_blend_parabolic) = stats.blend_parabolic;
+    *(emcmot_hal_data->tp_blend_stop) = stats.blend_stop;
+}
+
+/* move 'from' up toward 'to' by at most 'step'; going down, or a step
+   of 0 or less, jumps straight to 'to', so the result is never above it */
+static double ramp_scale(double from, double to, double step)
+{
+    if (step <= 0.0 || to - from <= step) {
+	return to;
+    }
+    return from + step;
+}
+
 static void process_inputs(void)
 {
+    static double feed_ramp = 1.0, rapid_ramp = 1.0;
     int joint_num;
-    double abs_ferror, tmp, scale;
+    double abs_ferror, tmp, scale, step, feed_target, rapid_target;
     joint_hal_t *joint_data;
     emcmot_joint_t *joint;
     unsigned char enables;
-    /* read spindle angle (for threading, etc) */
-    emcmotStatus->spindleRevs = *emcmot_hal_data->spindle_revs;
+    /* read spindle angle (for threading, etc).  The encoder was sampled
+       some time before this period's commands reach the drives; moving
+       the angle on by the measured speed over that time keeps the phase
+       of a thread from slipping as the speed goes up. */
     emcmotStatus->spindleSpeedIn = *emcmot_hal_data->spindle_speed_in;
+    emcmotStatus->spindleRevs = *emcmot_hal_data->spindle_revs
+	+ emcmotStatus->spindleSpeedIn * *emcmot_hal_data->spindle_revs_lead;
     emcmotStatus->spindle_is_atspeed = *emcmot_hal_data->spindle_is_atspeed;
     /* compute net feed and spindle scale factors */
     if ( emcmotStatus->motion_state == EMCMOT_MOTION_COORD ) {
@@ -256,14 +437,12 @@ static void process_inputs(void)
 	enables = emcmotStatus->enables_new;
     }
     /* feed scaling first:  feed_scale, adaptive_feed, and feed_hold */
-    scale = 1.0;
+    feed_target = 1.0;
+    rapid_target = 1.0;
     if (   (emcmotStatus->motion_state != EMCMOT_MOTION_FREE)
         && (enables & FS_ENABLED) ) {
-        if (emcmotStatus->motionType == EMC_MOTION_TYPE_TRAVERSE) {
-            scale *= emcmotStatus->rapid_scale;
-        } else {
-            scale *= emcmotStatus->feed_scale;
-        }
+	feed_target *= emcmotStatus->feed_scale;
+	rapid_target *= emcmotStatus->rapid_scale;
     }
     if ( enables & AF_ENABLED ) {
 	/* read and clamp (0.0 to 1.0) adaptive feed HAL pin */
@@ -273,7 +452,26 @@ static void process_inputs(void)
 	} else if ( tmp < 0.0 ) {
 	    tmp = 0.0;
 	}
-	scale *= tmp;
+	feed_target *= tmp;
+	rapid_target *= tmp;
+    }
+    /* ramp override and adaptive feed increases at feed-scale-rate per
+       second, so the planner sees a smooth velocity request; feeds and
+       rapids keep ramps of their own so a change of move type is not
+       ramped.  Decreases, and stopping by feed hold or inhibit, stay
+       immediate.  Outside of coordinated motion the ramps follow their
+       targets at once, so the first moves never start above them. */
+    step = *emcmot_hal_data->feed_scale_rate * servo_period;
+    if (emcmotStatus->motion_state != EMCMOT_MOTION_COORD
+	    || tcqLen(&emcmotDebug->coord_tp.queue) == 0) {
+	step = 0.0;
+    }
+    feed_ramp = ramp_scale(feed_ramp, feed_target, step);
+    rapid_ramp = ramp_scale(rapid_ramp, rapid_target, step);
+    if (emcmotStatus->motionType == EMC_MOTION_TYPE_TRAVERSE) {
+	scale = rapid_ramp;
+    } else {
+	scale = feed_ramp;
     }
     if ( enables & FH_ENABLED ) {
 	/* read feed hold HAL pin */
@@ -446,13 +644,22 @@ static void do_forward_kins(void)
 
 */
 
-/*! \todo FIXME FIXME FIXME - need to put a rate divider in here, run it
-   at the traj rate */
+/* With a trajectory period longer than the servo period, the feedback
+   kinematics run once per trajectory cycle, like the inverse kinematics
+   of coordinated moves.  While probing they run every servo cycle, so
+   that probedPos is the position of the cycle the probe tripped in. */
 
+    static int fb_cycle = 0;
     double joint_pos[EMCMOT_MAX_JOINTS] = {0,};
     int joint_num, result;
     emcmot_joint_t *joint;
 
+    if (++fb_cycle < emcmotConfig->interpolationRate
+	&& !emcmotStatus->probing) {
+	return;
+    }
+    fb_cycle = 0;
+
     /* copy joint position feedback to local array */
     for (joint_num = 0; joint_num < emcmotConfig->numJoints; joint_num++) {
 	/* point to joint struct */
@@ -465,6 +672,7 @@ static void do_forward_kins(void)
     case KINEMATICS_IDENTITY:
 	kinematicsForward(joint_pos, &emcmotStatus->carte_pos_fb, &fflags,
 	    &iflags);
+	volcomp_remove(&emcmotStatus->carte_pos_fb);
 	if (checkAllHomed()) {
 	    emcmotStatus->carte_pos_fb_ok = 1;
 	} else {
@@ -489,6 +697,7 @@ static void do_forward_kins(void)
 		emcmotStatus->carte_pos_fb_ok = 0;
 	    } else {
 		/* it worked! */
+		volcomp_remove(&emcmotStatus->carte_pos_fb);
 		emcmotStatus->carte_pos_fb_ok = 1;
 	    }
 	} else {
@@ -599,6 +808,87 @@ static void process_probe_inputs(void)
     old_probeVal = emcmotStatus->probeVal;
 }
 
+static void stop_probe_sequence(void)
+{
+    emcmotDebug->probe_step = -1;
+    emcmotDebug->probe_step_started = 0;
+    emcmotDebug->probe_step_count = 0;
+}
+
+static void run_probe_sequence(void)
+{
+    emcmot_probe_step_t *step;
+    int n;
+
+    if (emcmotDebug->probe_step < 0) {
+	return;
+    }
+    if (!GET_MOTION_COORD_FLAG() || !GET_MOTION_ENABLE_FLAG()
+	|| GET_MOTION_ERROR_FLAG()) {
+	/* aborted, disabled, or a move failed */
+	stop_probe_sequence();
+	return;
+    }
+    if (emcmotStatus->probing || !GET_MOTION_INPOS_FLAG()
+	|| tpQueueDepth(&emcmotDebug->coord_tp) != 0) {
+	/* the move given to the planner is still going */
+	return;
+    }
+    step = &emcmotDebug->probe_steps[emcmotDebug->probe_step];
+    if (emcmotDebug->probe_step_started) {
+	if (step->motion_type == EMC_MOTION_TYPE_PROBING) {
+	    /* a probe move that ends without the probe changing is an
+	       error unless the probe type suppresses it, as reported by
+	       process_probe_inputs() */
+	    if (!emcmotStatus->probeTripped && !(step->probe_type & 1)) {
+		stop_probe_sequence();
+		return;
+	    }
+	    n = emcmotStatus->probePointCount++;
+	    emcmotStatus->probePoints[n] = emcmotStatus->probedPos;
+	    if (emcmotStatus->probeTripped) {
+		emcmotStatus->probePointsTripped |= 1u << n;
+	    }
+	}
+	emcmotDebug->probe_step_started = 0;
+	if (++emcmotDebug->probe_step >= emcmotDebug->probe_step_count) {
+	    stop_probe_sequence();
+	    return;
+	}
+	step++;
+    }
+
+    if (step->motion_type == EMC_MOTION_TYPE_PROBING && !(step->probe_type & 1)) {
+	/* same check as EMCMOT_PROBE: the probe must not already be in
+	   the state the move looks for */
+	if (emcmotStatus->probeVal != !!(step->probe_type & 2)) {
+	    if (step->probe_type & 2) {
+		reportError(_("Probe is already clear when starting G38.4 or G38.5 move"));
+	    } else {
+		reportError(_("Probe is already tripped when starting G38.2 or G38.3 move"));
+	    }
+	    SET_MOTION_ERROR_FLAG(1);
+	    stop_probe_sequence();
+	    return;
+	}
+    }
+    tpSetId(&emcmotDebug->coord_tp, step->id);
+    if (-1 == tpAddLine(&emcmotDebug->coord_tp, step->pos, step->motion_type,
+			step->vel, step->ini_maxvel, step->acc,
+			emcmotStatus->enables_new, 0, -1)) {
+	reportError(_("can't add probe move"));
+	SET_MOTION_ERROR_FLAG(1);
+	stop_probe_sequence();
+	return;
+    }
+    if (step->motion_type == EMC_MOTION_TYPE_PROBING) {
+	emcmotStatus->probeTripped = 0;
+	emcmotStatus->probe_type = step->probe_type;
+	emcmotStatus->probing = 1;
+    }
+    emcmotDebug->probe_step_started = 1;
+}
+
 static void check_for_faults(void)
 {
     int joint_num;
@@ -759,6 +1049,7 @@ static void set_operating_mode(void)
 	    SET_MOTION_ERROR_FLAG(0);
 
             kinematicsForward(positions, &emcmotStatus->carte_pos_cmd, &fflags, &iflags);
+            volcomp_remove(&emcmotStatus->carte_pos_cmd);
 
             (&axes[0])->teleop_tp.curr_pos = emcmotStatus->carte_pos_cmd.tran.x;
             (&axes[1])->teleop_tp.curr_pos = emcmotStatus->carte_pos_cmd.tran.y;
@@ -1030,6 +1321,229 @@ static void handle_ajogwheels(void)
     first_pass = 0;
 }
 
+/* The samples are joint positions with motmod stream_joints=1, or
+   else XYZABCUVW positions that go through the inverse kinematics,
+   one sample a servo period.  Neither the planner nor the cubic
+   interpolators see them, but the limit checks and screw comp after
+   get_pos_cmds() do.  A stream that runs dry, a sample further from
+   the one before than the velocity limit allows, or stream.enable
+   going off stops along the last velocity with the axis or joint
+   accelerations, ignoring the rest of the stream until stream.enable
+   is off again. */
+static void stream_limits(int n, double *vel, double *acc)
+{
+    if (emcmot_hal_data->stream_joints) {
+	*vel = joints[n].vel_limit;
+	*acc = joints[n].acc_limit;
+    } else {
+	*vel = axes[n].vel_limit;
+	*acc = axes[n].acc_limit;
+    }
+}
+
+static void stream_to_pose(EmcPose *pos, const double *p)
+{
+    pos->tran.x = p[0];
+    pos->tran.y = p[1];
+    pos->tran.z = p[2];
+    pos->a = p[3];
+    pos->b = p[4];
+    pos->c = p[5];
+    pos->u = p[6];
+    pos->v = p[7];
+    pos->w = p[8];
+}
+
+static void stream_from_pose(double *p, const EmcPose *pos)
+{
+    p[0] = pos->tran.x;
+    p[1] = pos->tran.y;
+    p[2] = pos->tran.z;
+    p[3] = pos->a;
+    p[4] = pos->b;
+    p[5] = pos->c;
+    p[6] = pos->u;
+    p[7] = pos->v;
+    p[8] = pos->w;
+}
+
+/* starts the stop, with a message unless it was asked for */
+static void stream_stop(const char *why)
+{
+    if (why) {
+	reportError(_("motion stream: %s, stopping"), why);
+    }
+    emcmotDebug->stream_state = STREAM_STOP;
+}
+
+/* brings stream_vel down by the acceleration limits for one cycle,
+   keeping its direction, and returns nonzero once it is zero */
+static int stream_decelerate(void)
+{
+    int n, num = emcmot_hal_data->stream_num;
+    double vmax, amax, dv, k = 1.0;
+
+    for (n = 0; n < num; n++) {
+	if (emcmotDebug->stream_vel[n] != 0.0) {
+	    stream_limits(n, &vmax, &amax);
+	    /* stream_vel is per cycle, so is the change allowed in it */
+	    dv = amax * servo_period * servo_period;
+	    k = fmin(k, dv / fabs(emcmotDebug->stream_vel[n]));
+	}
+    }
+    for (n = 0; n < num; n++) {
+	emcmotDebug->stream_vel[n] *= 1.0 - k;
+	emcmotDebug->stream_pos[n] += emcmotDebug->stream_vel[n];
+    }
+    return k >= 1.0;
+}
+
+/* sets the commands from stream_pos, returns nonzero if it can't */
+static int stream_output(void)
+{
+    int joint_num, num = emcmotConfig->numJoints;
+    double positions[EMCMOT_MAX_JOINTS];
+    double old_pos_cmd;
+    emcmot_joint_t *joint;
+    EmcPose target;
+
+    if (emcmot_hal_data->stream_joints) {
+	for (joint_num = 0; joint_num < EMCMOT_MAX_JOINTS; joint_num++) {
+	    positions[joint_num] =
+		joint_num < num ? emcmotDebug->stream_pos[joint_num] : 0.0;
+	}
+	kinematicsForward(positions, &emcmotStatus->carte_pos_cmd, &fflags, &iflags);
+	volcomp_remove(&emcmotStatus->carte_pos_cmd);
+    } else {
+	stream_to_pose(&emcmotStatus->carte_pos_cmd, emcmotDebug->stream_pos);
+	target = emcmotStatus->carte_pos_cmd;
+	volcomp_apply(&target);
+	if (kinematicsInverse(&target, positions, &iflags, &fflags) != 0) {
+	    reportError(_("kinematicsInverse failed"));
+	    SET_MOTION_ERROR_FLAG(1);
+	    SET_MOTION_ENABLE_FLAG(0);
+	    emcmotDebug->enabling = 0;
+	    return -1;
+	}
+    }
+    for (joint_num = 0; joint_num < num; joint_num++) {
+	if (!isfinite(positions[joint_num])) {
+	    reportError(_("kinematicsInverse gave non-finite joint location on joint %d"), joint_num);
+	    SET_MOTION_ERROR_FLAG(1);
+	    SET_MOTION_ENABLE_FLAG(0);
+	    emcmotDebug->enabling = 0;
+	    return -1;
+	}
+    }
+    for (joint_num = 0; joint_num < num; joint_num++) {
+	joint = &joints[joint_num];
+	old_pos_cmd = joint->pos_cmd;
+	joint->coarse_pos = positions[joint_num];
+	joint->pos_cmd = positions[joint_num];
+	joint->vel_cmd = (joint->pos_cmd - old_pos_cmd) * servo_freq;
+    }
+    return 0;
+}
+
+/* gives the axes back to the planner where the stream left them */
+static void stream_leave(void)
+{
+    int joint_num;
+
+    emcmotDebug->stream_state = STREAM_IDLE;
+    *emcmot_hal_data->stream_active = 0;
+    tpSetPos(&emcmotDebug->coord_tp, &emcmotStatus->carte_pos_cmd);
+    for (joint_num = 0; joint_num < emcmotConfig->numJoints; joint_num++) {
+	cubicDrain(&(joints[joint_num].cubic));
+    }
+}
+
+static int run_stream(void)
+{
+    emcmot_hal_data_t *h = emcmot_hal_data;
+    union hal_stream_data sample[HAL_STREAM_MAX_PINS];
+    double d, vmax, amax;
+    int n, num = h->stream_num;
+
+    if (num == 0) {
+	return 0;
+    }
+    *h->stream_depth = hal_stream_depth(&h->stream);
+
+    switch (emcmotDebug->stream_state) {
+    case STREAM_IDLE:
+	if (!*h->stream_enable || !tpIsDone(&emcmotDebug->coord_tp)
+	    || !hal_stream_readable(&h->stream)) {
+	    return 0;
+	}
+	if (h->stream_joints) {
+	    for (n = 0; n < num; n++) {
+		emcmotDebug->stream_pos[n] = joints[n].pos_cmd;
+	    }
+	} else {
+	    stream_from_pose(emcmotDebug->stream_pos, &emcmotStatus->carte_pos_cmd);
+	}
+	for (n = 0; n < num; n++) {
+	    emcmotDebug->stream_vel[n] = 0.0;
+	}
+	emcmotDebug->stream_state = STREAM_RUN;
+	*h->stream_active = 1;
+	/* fall through */
+
+    case STREAM_RUN:
+	if (!*h->stream_enable) {
+	    stream_stop(NULL);
+	    break;
+	}
+	if (hal_stream_read(&h->stream, sample, NULL) < 0) {
+	    (*h->stream_underruns)++;
+	    stream_stop(_("ran dry"));
+	    break;
+	}
+	for (n = 0; n < num; n++) {
+	    d = sample[n].f - emcmotDebug->stream_pos[n];
+	    stream_limits(n, &vmax, &amax);
+	    /* a little over the limit for the rounding of the feeder */
+	    if (!isfinite(d) || fabs(d) * servo_freq > 1.001 * vmax) {
+		stream_stop(_("sample over the velocity limit"));
+		break;
+	    }
+	}
+	if (n < num) {
+	    break;
+	}
+	for (n = 0; n < num; n++) {
+	    emcmotDebug->stream_vel[n] = sample[n].f - emcmotDebug->stream_pos[n];
+	    emcmotDebug->stream_pos[n] = sample[n].f;
+	}
+	break;
+
+    case STREAM_STOP:
+    case STREAM_DONE:
+	break;
+    }
+
+    if (emcmotDebug->stream_state == STREAM_STOP && stream_decelerate()) {
+	emcmotDebug->stream_state = STREAM_DONE;
+    }
+    if (emcmotDebug->stream_state != STREAM_RUN) {
+	/* what the feeder still sends is from before the stop */
+	while (hal_stream_readable(&h->stream)) {
+	    hal_stream_read(&h->stream, sample, NULL);
+	}
+    }
+    if (emcmotDebug->stream_state == STREAM_DONE && !*h->stream_enable) {
+	stream_leave();
+	return 0;
+    }
+    if (stream_output() != 0) {
+	stream_leave();
+	return 1;
+    }
+    SET_MOTION_INPOS_FLAG(emcmotDebug->stream_state == STREAM_DONE);
+    return 1;
+}
+
 static void get_pos_cmds(long period)
 {
     int joint_num, axis_num, result;
@@ -1038,6 +1552,7 @@ static void get_pos_cmds(long period)
     double positions[EMCMOT_MAX_JOINTS];
     double old_pos_cmd;
     double vel_lim;
+    EmcPose target;		/* carte_pos_cmd with volumetric comp */
 
     /* used in teleop mode to compute the max accell requested */
     int onlimit = 0;
@@ -1057,6 +1572,13 @@ static void get_pos_cmds(long period)
 
     /* RUN MOTION CALCULATIONS: */
 
+    /* a stream left by a disable or a mode change is over */
+    if (emcmotDebug->stream_state != STREAM_IDLE
+	&& emcmotStatus->motion_state != EMCMOT_MOTION_COORD) {
+	emcmotDebug->stream_state = STREAM_IDLE;
+	*emcmot_hal_data->stream_active = 0;
+    }
+
     /* run traj planner code depending on the state */
     switch ( emcmotStatus->motion_state) {
     case EMCMOT_MOTION_FREE:
@@ -1125,6 +1647,7 @@ static void get_pos_cmds(long period)
 
 	case KINEMATICS_IDENTITY:
 	    kinematicsForward(positions, &emcmotStatus->carte_pos_cmd, &fflags, &iflags);
+	    volcomp_remove(&emcmotStatus->carte_pos_cmd);
 	    if (checkAllHomed()) {
 		emcmotStatus->carte_pos_cmd_ok = 1;
 	    } else {
@@ -1148,6 +1671,7 @@ static void get_pos_cmds(long period)
 		    emcmotStatus->carte_pos_cmd_ok = 0;
 		} else {
 		    /* it worked! */
+		    volcomp_remove(&emcmotStatus->carte_pos_cmd);
 		    emcmotStatus->carte_pos_cmd_ok = 1;
 		}
 	    } else {
@@ -1172,6 +1696,9 @@ static void get_pos_cmds(long period)
 	    axis->teleop_tp.enable = 0;
 	    axis->teleop_tp.curr_vel = 0.0;
         }
+	if (run_stream()) {
+	    break;
+	}
 	/* check joint 0 to see if the interpolators are empty */
 	while (cubicNeedNextPoint(&(joints[0].cubic))) {
 	    /* they're empty, pull next point(s) off Cartesian planner */
@@ -1181,7 +1708,9 @@ static void get_pos_cmds(long period)
 	    tpGetPos(&emcmotDebug->coord_tp, &emcmotStatus->carte_pos_cmd);
 
 	    /* OUTPUT KINEMATICS - convert to joints in local array */
-	    result = kinematicsInverse(&emcmotStatus->carte_pos_cmd, positions,
+	    target = emcmotStatus->carte_pos_cmd;
+	    volcomp_apply(&target);
+	    result = kinematicsInverse(&target, positions,
 		&iflags, &fflags);
 	    if(result == 0)
 	    {
@@ -1263,7 +1792,9 @@ static void get_pos_cmds(long period)
 	    to compute the next positions of the joints */
 
 	/* OUTPUT KINEMATICS - convert to joints in local array */
-	result = kinematicsInverse(&emcmotStatus->carte_pos_cmd, positions, &iflags, &fflags);
+	target = emcmotStatus->carte_pos_cmd;
+	volcomp_apply(&target);
+	result = kinematicsInverse(&target, positions, &iflags, &fflags);
 	/* copy to joint structures and spline them up */
 	if(result == 0)
 	{
@@ -1500,7 +2031,18 @@ static void compute_screw_comp(void)
 	comp = &(joint->comp);
 	if ( comp->entries > 0 ) {
 	    /* there is data in the comp table, use it */
-	    /* first make sure we're in the right spot in the table */
+	    /* jump to the right bucket of the table */
+	    if (comp->index_buckets > 0) {
+		double b = (joint->pos_cmd - comp->index_start) * comp->index_scale;
+		if (!(b >= 0.0)) {
+		    comp->entry = &(comp->array[0]);
+		} else if (b >= comp->index_buckets) {
+		    comp->entry = &(comp->array[comp->entries]);
+		} else {
+		    comp->entry = &(comp->array[comp->index[(int)b]]);
+		}
+	    }
+	    /* then make sure we're in the right spot in the bucket */
 	    while ( joint->pos_cmd < comp->entry->nominal ) {
 		comp->entry--;
 	    }
@@ -1745,6 +2287,7 @@ static void output_to_hal(void)
             emcmotStatus->current_vel = (*emcmot_hal_data->current_vel) = 0.0;
         *(emcmot_hal_data->requested_vel) = 0.0;
     }
+    tp_stats_to_hal();
 
     /* These params can be used to examine any internal variable. */
     /* Change the following lines to assign the variable you want to observe
@@ -1822,6 +2365,9 @@ static void output_to_hal(void)
 	*(joint_data->f_errored) = GET_JOINT_FERROR_FLAG(joint);
 	*(joint_data->faulted) = GET_JOINT_FAULT_FLAG(joint);
 	*(joint_data->home_state) = joint->home_state;
+	*(joint_data->home_phase_time[0]) = joint->home_phase_time[0];
+	*(joint_data->home_phase_time[1]) = joint->home_phase_time[1];
+	*(joint_data->home_phase_time[2]) = joint->home_phase_time[2];
     }
 
     /* output axis info to HAL for scoping, etc */
@@ -1912,6 +2458,12 @@ static void update_status(void)
 
     /* motion emcmotDebug->coord_tp status */
     emcmotStatus->depth = tpQueueDepth(&emcmotDebug->coord_tp);
+    if (emcmotDebug->probe_step >= 0) {
+	/* moves of a probe sequence not yet given to the planner count as
+	   queued, and so does one that has stopped but isn't recorded */
+	emcmotStatus->depth += emcmotDebug->probe_step_count - emcmotDebug->probe_step
+	    - (emcmotDebug->probe_step_started && emcmotStatus->depth > 0);
+    }
     emcmotStatus->activeDepth = tpActiveDepth(&emcmotDebug->coord_tp);
     emcmotStatus->id = tpGetExecId(&emcmotDebug->coord_tp);
     emcmotStatus->motionType = tpGetMotionType(&emcmotDebug->coord_tp);
@@ -1933,3 +2485,32 @@ static void update_status(void)
     }
 #endif
 }
+
+static void update_status_hot(void)
+{
+    emcmot_status_hot_t *hot = emcmotStatusHot;
+    int joint_num;
+
+    emcmotSeqWriteBegin(&hot->seq);
+    hot->heartbeat = emcmotStatus->heartbeat;
+    hot->motion_state = emcmotStatus->motion_state;
+    hot->motionFlag = emcmotStatus->motionFlag;
+    hot->carte_pos_cmd = emcmotStatus->carte_pos_cmd;
+    hot->carte_pos_fb = emcmotStatus->carte_pos_fb;
+    hot->current_vel = emcmotStatus->current_vel;
+    hot->requested_vel = emcmotStatus->requested_vel;
+    hot->distance_to_go = emcmotStatus->distance_to_go;
+    hot->id = emcmotStatus->id;
+    hot->depth = emcmotStatus->depth;
+    hot->queueFull = emcmotStatus->queueFull;
+    hot->paused = emcmotStatus->paused;
+    hot->commandNumEcho = emcmotStatus->commandNumEcho;
+    hot->commandStatus = emcmotStatus->commandStatus;
+    for (joint_num = 0; joint_num < emcmotConfig->numJoints; joint_num++) {
+	hot->joint_flag[joint_num] = emcmotStatus->joint_status[joint_num].flag;
+	hot->joint_pos_cmd[joint_num] = emcmotStatus->joint_status[joint_num].pos_cmd;
+	hot->joint_pos_fb[joint_num] = emcmotStatus->joint_status[joint_num].pos_fb;
+	hot->joint_vel_cmd[joint_num] = emcmotStatus->joint_status[joint_num].vel_cmd;
+    }
+    emcmotSeqWriteEnd(&hot->seq);
+}
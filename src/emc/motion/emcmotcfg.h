@@ -31,8 +31,20 @@
 #error A 64 bit bitmask is used in the planner.  Don't increase these until that's fixed.
 #endif
 
-#define EMCMOT_ERROR_NUM 32	/* how many errors we can queue */
+#define EMCMOT_MAX_PROBE_STEPS 24	/* moves in a probe sequence */
+#define EMCMOT_MAX_PROBE_POINTS 8	/* probe moves in a probe sequence,
+					   at most the bits of an int */
+
+#define EMCMOT_ERROR_RING_SIZE 65536	/* bytes of queued error records,
+					   a power of two */
 #define EMCMOT_ERROR_LEN 1024	/* how long error string can be */
+#define EMCMOT_ERRORS_PER_UPDATE 64	/* max drained per task cycle */
+
+/* Commands from task go through a ring in shared memory.  The ring must
+   stay smaller than TC_QUEUE_MARGIN (tcq.c) so that segments already in
+   flight can't overrun the planner queue after it reports full. */
+#define EMCMOT_COMMAND_RING_SIZE 16	/* must be a power of two */
+#define EMCMOT_COMMANDS_PER_PERIOD 8	/* max ring entries handled per period */
 
 /*
   Shared memory keys for simulated motion process. No base address
@@ -57,10 +69,12 @@
 #define DEFAULT_DIO 4
 #define DEFAULT_AIO 4
 
-/* size of motion queue
- * a TC_STRUCT is about 512 bytes so this queue is
- * about a megabyte.  */
+/* size of motion queue, unless motmod is loaded with tc_queue_size=
+ * a TC_STRUCT and its syncdio_t are about 1200 bytes so this queue is
+ * about 2.4 megabytes.  */
 #define DEFAULT_TC_QUEUE_SIZE 2000
+#define MIN_TC_QUEUE_SIZE 100
+#define MAX_TC_QUEUE_SIZE 200000
 
 /* max following error */
 #define DEFAULT_MAX_FERROR 100
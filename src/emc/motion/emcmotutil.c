@@ -11,11 +11,14 @@
 * Copyright (c) 2004 All rights reserved.
 ********************************************************************/
 
-#include "emcmotcfg.h"		/* EMCMOT_ERROR_NUM,LEN */
+#include "emcmotcfg.h"		/* EMCMOT_ERROR_RING_SIZE,LEN */
 #include "motion.h"		/* these decls */
 #include "dbuf.h"
 #include "stashf.h"
 
+/* record lengths are rounded up so every length word is aligned */
+#define ERROR_RECORD(len) (4 + (((len) + 3) & ~3u))
+
 int emcmotErrorInit(emcmot_error_t * errlog)
 {
     if (errlog == 0) {
@@ -23,10 +26,9 @@ int emcmotErrorInit(emcmot_error_t * errlog)
     }
 
     errlog->head = 0;
-    errlog->start = 0;
-    errlog->end = 0;
-    errlog->num = 0;
     errlog->tail = 0;
+    errlog->busy = 0;
+    errlog->dropped = 0;
 
     return 0;
 }
@@ -35,22 +37,49 @@ int emcmotErrorPutfv(emcmot_error_t * errlog, const char *fmt, va_list ap)
 {
     struct dbuf errbuf;
     struct dbuf_iter it;
+    unsigned int head, pos, skip;
+    unsigned int *len;
 
-    if (errlog == 0 || errlog->num == EMCMOT_ERROR_NUM) {
-	/* full */
+    if (errlog == 0) {
+	return -1;
+    }
+    /* messages come from any realtime thread through the rtapi message
+       handler, so writers take turns; one that would wait is dropped */
+    if (__atomic_exchange_n(&errlog->busy, 1, __ATOMIC_ACQUIRE)) {
+	__atomic_add_fetch(&errlog->dropped, 1, __ATOMIC_RELAXED);
 	return -1;
     }
 
-    errlog->head++;
+    /* room for the longest record, in one piece */
+    head = errlog->head;
+    pos = head % EMCMOT_ERROR_RING_SIZE;
+    skip = EMCMOT_ERROR_RING_SIZE - pos;
+    if (skip >= ERROR_RECORD(EMCMOT_ERROR_LEN)) {
+	skip = 0;
+    }
+    if (EMCMOT_ERROR_RING_SIZE
+	- (head - __atomic_load_n(&errlog->tail, __ATOMIC_ACQUIRE))
+	< skip + ERROR_RECORD(EMCMOT_ERROR_LEN)) {
+	/* full */
+	__atomic_add_fetch(&errlog->dropped, 1, __ATOMIC_RELAXED);
+	__atomic_store_n(&errlog->busy, 0, __ATOMIC_RELEASE);
+	return -1;
+    }
+    if (skip) {
+	*(unsigned int *) (errlog->data + pos) = EMCMOT_ERROR_WRAP;
+	head += skip;
+	pos = 0;
+    }
 
-    dbuf_init(&errbuf, (unsigned char*)errlog->error[errlog->end], EMCMOT_ERROR_LEN);
+    len = (unsigned int *) (errlog->data + pos);
+    dbuf_init(&errbuf, errlog->data + pos + 4, EMCMOT_ERROR_LEN);
     dbuf_iter_init(&it, &errbuf);
     vstashf(&it, fmt, ap);
+    *len = it.offset;
 
-    errlog->end = (errlog->end + 1) % EMCMOT_ERROR_NUM;
-    errlog->num++;
-
-    errlog->tail = errlog->head;
+    __atomic_store_n(&errlog->head, head + ERROR_RECORD(it.offset),
+		     __ATOMIC_RELEASE);
+    __atomic_store_n(&errlog->busy, 0, __ATOMIC_RELEASE);
 
     return 0;
 }
@@ -70,18 +99,43 @@ int emcmotErrorPut(emcmot_error_t *errlog, const char *error)
     return emcmotErrorPutf(errlog, "%s", error);
 }
 
+/* copies the oldest record to error, which has room for EMCMOT_ERROR_LEN */
 int emcmotErrorGet(emcmot_error_t * errlog, char *error)
 {
-    if (errlog == 0 || errlog->num == 0) {
+    unsigned int head, tail, pos, len;
+
+    if (errlog == 0) {
+	return -1;
+    }
+    tail = errlog->tail;
+    head = __atomic_load_n(&errlog->head, __ATOMIC_ACQUIRE);
+    if (tail == head) {
 	/* empty */
 	return -1;
     }
 
-    errlog->head++;
-    memcpy(error, errlog->error[errlog->start], EMCMOT_ERROR_LEN);
-    errlog->start = (errlog->start + 1) % EMCMOT_ERROR_NUM;
-    errlog->num--;
-    errlog->tail = errlog->head;
+    pos = tail % EMCMOT_ERROR_RING_SIZE;
+    len = *(unsigned int *) (errlog->data + pos);
+    if (len == EMCMOT_ERROR_WRAP) {
+	tail += EMCMOT_ERROR_RING_SIZE - pos;
+	pos = 0;
+	len = *(unsigned int *) errlog->data;
+    }
+    if (len > EMCMOT_ERROR_LEN) {
+	len = EMCMOT_ERROR_LEN;
+    }
+    memcpy(error, errlog->data + pos + 4, len);
+    __atomic_store_n(&errlog->tail, tail + ERROR_RECORD(len),
+		     __ATOMIC_RELEASE);
 
     return 0;
 }
+
+/* messages dropped since the ring was set up */
+unsigned int emcmotErrorDropped(emcmot_error_t * errlog)
+{
+    if (errlog == 0) {
+	return 0;
+    }
+    return __atomic_load_n(&errlog->dropped, __ATOMIC_RELAXED);
+}
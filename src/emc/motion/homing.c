@@ -100,6 +100,61 @@ static void home_do_moving_checks(emcmot_joint_t * joint)
     }
 }
 
+/* 'home_phase()' says which part of homing a state belongs to, for the
+   home-search-time, home-latch-time and home-final-time pins: 0 while
+   looking for the switch, 1 while latching the exact home position, 2
+   for the final move, or -1 when not homing. */
+static int home_phase(home_state_t state)
+{
+    if (state >= HOME_START && state <= HOME_SET_COARSE_POSITION) {
+	return 0;
+    }
+    if (state >= HOME_FINAL_BACKOFF_START && state <= HOME_SET_INDEX_POSITION) {
+	return 1;
+    }
+    if (state >= HOME_FINAL_MOVE_START && state <= HOME_LOCK_WAIT) {
+	return 2;
+    }
+    return -1;
+}
+
+/* 'home_latched()' is true once a joint knows its home position: it is
+   on its final move or has finished homing.  With motmod home_overlap=1
+   the next step of a homing sequence starts as soon as every joint of
+   the current step is latched, instead of waiting for the final moves
+   to end. */
+static int home_latched(emcmot_joint_t * joint)
+{
+    if (joint->home_state == HOME_IDLE) {
+	return GET_JOINT_AT_HOME_FLAG(joint);
+    }
+    return joint->home_state >= HOME_FINAL_MOVE_START
+	&& joint->home_state != HOME_ABORT;
+}
+
+/* 'home_earlier_steps()' checks the joints of the steps before
+   'home_sequence', which may still be on their final moves when steps
+   overlap.  It returns -1 if one of them failed, 1 if some are still
+   homing and 0 if all are home. */
+static int home_earlier_steps(void)
+{
+    int i, busy = 0;
+    emcmot_joint_t *joint;
+
+    for (i = 0; i < emcmotConfig->numJoints; i++) {
+	joint = &joints[i];
+	if (ABS(joint->home_sequence) >= home_sequence) {
+	    continue;
+	}
+	if (joint->home_state != HOME_IDLE) {
+	    busy = 1;
+	} else if (!GET_JOINT_AT_HOME_FLAG(joint)) {
+	    return -1;
+	}
+    }
+    return busy;
+}
+
 /***********************************************************************
 *                      PUBLIC FUNCTIONS                                *
 ************************************************************************/
@@ -200,7 +255,12 @@ void do_homing_sequence(void)
 	    /* at least one joint is homing, wait for it */
 	    emcmotStatus->homingSequenceState = HOME_SEQUENCE_WAIT_JOINTS;
 	} else {
-	    /* no joints have this sequence number, we're done */
+	    /* no joints have this sequence number, we're done once the
+	       final moves of overlapped steps are */
+	    if (emcmot_hal_data->home_overlap && home_earlier_steps() > 0) {
+		/* check again next cycle */
+		break;
+	    }
 	    emcmotStatus->homingSequenceState = HOME_SEQUENCE_IDLE;
 	    /* tell the world */
 	    emcmotStatus->homing_active = 0;
@@ -208,6 +268,12 @@ void do_homing_sequence(void)
 	break;
 
     case HOME_SEQUENCE_WAIT_JOINTS:
+	if (emcmot_hal_data->home_overlap && home_earlier_steps() < 0) {
+	    /* a joint of an overlapped step failed its final move */
+	    emcmotStatus->homingSequenceState = HOME_SEQUENCE_IDLE;
+	    emcmotStatus->homing_active = 0;
+	    return;
+	}
 	for(i=0; i < emcmotConfig->numJoints; i++) {
 	    joint = &joints[i];
             // negative joint->home_sequence means sync final move
@@ -216,8 +282,11 @@ void do_homing_sequence(void)
 		continue;
 	    }
 	    if(joint->home_state != HOME_IDLE) {
-		/* still busy homing, keep waiting */
-		seen = 1;
+		/* still busy homing, keep waiting, or with overlapped
+		   steps only until it has latched */
+		if (!emcmot_hal_data->home_overlap || !home_latched(joint)) {
+		    seen = 1;
+		}
 		continue;
 	    }
 	    if(!GET_JOINT_AT_HOME_FLAG(joint)) {
@@ -249,7 +318,7 @@ void do_homing(void)
     int joint_num;
     emcmot_joint_t *joint;
     double offset, tmp;
-    int home_sw_active, homing_flag;
+    int home_sw_active, homing_flag, phase, seq;
 
     homing_flag = 0;
     if (emcmotStatus->motion_state != EMCMOT_MOTION_FREE) {
@@ -268,6 +337,25 @@ void do_homing(void)
 	if (joint->home_state != HOME_IDLE) {
 	    homing_flag = 1; /* at least one joint is homing */
 	}
+	/* time the phase of homing this cycle is spent in */
+	if (joint->home_state == HOME_START) {
+	    joint->home_phase_time[0] = 0.0;
+	    joint->home_phase_time[1] = 0.0;
+	    joint->home_phase_time[2] = 0.0;
+	}
+	phase = home_phase(joint->home_state);
+	if (phase >= 0) {
+	    joint->home_phase_time[phase] += 1.0 / servo_freq;
+	}
+	/* the step of the sequence this joint homes in, if it syncs its
+	   final move with the other joints of that step; with overlapped
+	   steps that need not be the step being started */
+	seq = 0;
+	if (joint->home_sequence < 0
+	    && emcmotStatus->homingSequenceState != HOME_SEQUENCE_IDLE
+	    && ABS(joint->home_sequence) <= home_sequence) {
+	    seq = ABS(joint->home_sequence);
+	}
 	
 	/* when an joint is homing, 'check_for_faults()' ignores its limit
 	   switches, so that this code can do the right thing with them. Once
@@ -785,8 +873,8 @@ void do_homing(void)
 		if (joint->home_pause_timer < (HOME_DELAY * servo_freq)) {
 		    /* no, update timer and wait some more */
 		    joint->home_pause_timer++;
-                    if (joint->home_sequence<0) {
-                        if (!sync_final_move[home_sequence]) break;
+                    if (seq) {
+                        if (!sync_final_move[seq]) break;
                     } else {
                         break;
                     }
@@ -794,26 +882,24 @@ void do_homing(void)
 		}
                 // negative joint->home_sequence means sync final move
                 //          defer final move until all joints in sequence are ready
-                if  (        (joint->home_sequence  < 0)
-                     && ( ABS(joint->home_sequence) == home_sequence)
-                    ) {
-                    if (!sync_final_move[home_sequence]) {
+                if (seq) {
+                    if (!sync_final_move[seq]) {
                         int jno;
                         emcmot_joint_t *jtmp;
-                        sync_final_move[home_sequence] = 1; //disprove
+                        sync_final_move[seq] = 1; //disprove
                         for (jno = 0; jno < emcmotConfig->numJoints; jno++) {
                             jtmp = &joints[jno];
-                            if (ABS(jtmp->home_sequence) != home_sequence) {continue;}
+                            if (ABS(jtmp->home_sequence) != seq) {continue;}
                             if (jtmp->home_flags & HOME_ABSOLUTE_ENCODER)  {continue;}
                             if (   (jtmp->home_state != HOME_FINAL_MOVE_START)
                                 ||
                                    (jtmp->free_tp.active)
                                 ) {
-                                sync_final_move[home_sequence] = 0;
+                                sync_final_move[seq] = 0;
                                 break;
                             }
                         }
-                        if (!sync_final_move[home_sequence]) break;
+                        if (!sync_final_move[seq]) break;
                     }
                 }
 		joint->home_pause_timer = 0;
@@ -29,6 +29,28 @@
 /* joint data */
 #include "hal.h"
 #include "../motion/motion.h"
+#include "tp_types.h"		/* TP_STATS_DEPTH_BUCKETS */
+
+/* the parts of emcmotController() that motion.servo.phase.* time */
+enum mot_phase {
+    MOT_PHASE_INPUTS,		/* process_inputs() */
+    MOT_PHASE_KINS,		/* do_forward_kins() */
+    MOT_PHASE_FAULTS,		/* probe inputs and check_for_faults() */
+    MOT_PHASE_MODE,		/* set_operating_mode(), jogwheels, homing */
+    MOT_PHASE_CMDS,		/* get_pos_cmds(): TP and inverse kins */
+    MOT_PHASE_COMP,		/* compute_screw_comp() */
+    MOT_PHASE_OUTPUT,		/* output_to_hal() */
+    MOT_PHASE_STATUS,		/* update_status() */
+    MOT_NUM_PHASES
+};
+
+/* emcmotDebug->stream_state, see run_stream() in control.c */
+enum mot_stream_state {
+    STREAM_IDLE,		/* the planner has the axes */
+    STREAM_RUN,			/* setpoints come from the stream */
+    STREAM_STOP,		/* stopping without the stream after a fault */
+    STREAM_DONE			/* stopped, waiting for stream.enable to go off */
+};
 
 typedef struct {
     hal_float_t *coarse_pos_cmd;/* RPI: commanded position, w/o comp */
@@ -67,6 +89,7 @@ typedef struct {
     hal_bit_t *amp_fault;	/* RPI: amp fault input */
     hal_bit_t *amp_enable;	/* WPI: amp enable output */
     hal_s32_t *home_state;	/* WPI: homing state machine state */
+    hal_float_t *home_phase_time[3];	/* WPI: seconds in the homing phases */
 
     hal_bit_t *unlock;          /* WPI: command that axis should unlock for rotation */
     hal_bit_t *is_unlocked;     /* RPI: axis is currently unlocked */
@@ -101,8 +124,10 @@ typedef struct {
     hal_bit_t *spindle_index_enable;
     hal_bit_t *spindle_is_atspeed;
     hal_float_t *spindle_revs;
+    hal_float_t *spindle_revs_lead;	/* RPI: seconds to extrapolate spindle_revs */
     hal_bit_t *spindle_inhibit;	/* RPI: set TRUE to stop spindle (non maskable)*/
     hal_float_t *adaptive_feed;	/* RPI: adaptive feedrate, 0.0 to 1.0 */
+    hal_float_t *feed_scale_rate;	/* RPI: max feed scale change per second, 0 = instant */
     hal_bit_t *feed_hold;	/* RPI: set TRUE to stop motion maskable with g53 P1*/
     hal_bit_t *feed_inhibit;	/* RPI: set TRUE to stop motion (non maskable)*/
     hal_bit_t *motion_enabled;	/* RPI: motion enable for all joints */
@@ -179,6 +204,40 @@ typedef struct {
     hal_u32_t last_period;	/* param: last period in clocks */
     hal_float_t last_period_ns;	/* param: last period in nanoseconds */
 
+    // servo cycle phase timing, only when motmod phase_timing=1
+    int phase_timing;		/* not HAL: nonzero if the pins exist */
+    int home_overlap;		/* not HAL: motmod home_overlap */
+    hal_bit_t *phase_reset;	/* RPI: clear the maximums */
+    struct {
+	hal_u32_t *time;	/* WPI: last time in clocks */
+	hal_u32_t *max;		/* WPI: largest time since reset */
+	hal_float_t *avg;	/* WPI: running average in clocks */
+    } phase[MOT_NUM_PHASES];
+
+    // trajectory planner statistics, only when motmod tp_stats=1
+    int tp_stats;		/* not HAL: nonzero if the pins exist */
+    hal_bit_t *tp_stats_reset;	/* RPI: hold the counts at zero */
+    hal_u32_t *tp_cycles;	/* WPI: cycles that ran a segment */
+    hal_u32_t *tp_starved;	/* WPI: slowing with no next segment */
+    hal_u32_t *tp_lookahead;	/* WPI: slowing for the final velocity */
+    hal_u32_t *tp_vel_limited;	/* WPI: held under by a velocity limit */
+    hal_u32_t *tp_acc_limited;	/* WPI: getting up to speed */
+    hal_float_t *tp_slow_time;	/* WPI: seconds under the requested velocity */
+    hal_u32_t *tp_depth[TP_STATS_DEPTH_BUCKETS]; /* WPI: cycles by queue depth */
+    hal_u32_t *tp_blend_tangent;	/* WPI: segments ended tangent */
+    hal_u32_t *tp_blend_arc;	/* WPI: blend arcs run */
+    hal_u32_t *tp_blend_parabolic;	/* WPI: segments ended in parabolic blends */
+    hal_u32_t *tp_blend_stop;	/* WPI: segments ended stopped */
+
+    // servo rate setpoint stream, only when motmod stream_channel >= 0
+    int stream_num;		/* not HAL: floats per sample, 0 if no stream */
+    int stream_joints;		/* not HAL: samples are joint positions */
+    hal_stream_t stream;	/* not HAL: the stream the feeder fills */
+    hal_bit_t *stream_enable;	/* RPI: take the setpoints from the stream */
+    hal_bit_t *stream_active;	/* WPI: the setpoints come from the stream */
+    hal_s32_t *stream_underruns;/* WPI: times the stream ran dry */
+    hal_s32_t *stream_depth;	/* WPI: samples waiting in the stream */
+
     hal_float_t *tooloffset_x;
     hal_float_t *tooloffset_y;
     hal_float_t *tooloffset_z;
@@ -217,11 +276,14 @@ extern double servo_freq;
 
 /* Struct pointers */
 extern struct emcmot_struct_t *emcmotStruct;
+extern struct emcmot_command_ring_t *emcmotCommandRing;
 extern struct emcmot_command_t *emcmotCommand;
 extern struct emcmot_status_t *emcmotStatus;
+extern struct emcmot_status_hot_t *emcmotStatusHot;
 extern struct emcmot_config_t *emcmotConfig;
 extern struct emcmot_debug_t *emcmotDebug;
 extern struct emcmot_error_t *emcmotError;
+extern struct emcmot_volcomp_t *emcmotVolcomp;
 
 /***********************************************************************
 *                    PUBLIC FUNCTION PROTOTYPES                        *
@@ -46,6 +46,12 @@ static long servo_period_nsec = 1000000;	/* servo thread period */
 RTAPI_MP_LONG(servo_period_nsec, "servo thread period (nsecs)");
 static long traj_period_nsec = 0;	/* trajectory planner period */
 RTAPI_MP_LONG(traj_period_nsec, "trajectory planner period (nsecs)");
+static int base_thread_cpu = -1;	/* -1 = default cpu */
+RTAPI_MP_INT(base_thread_cpu, "cpu of the base thread, or -1 for the default");
+static int servo_thread_cpu = -1;	/* -1 = default cpu */
+RTAPI_MP_INT(servo_thread_cpu, "cpu of the servo thread, or -1 for the default");
+static char *servo_thread_workers = NULL;	/* cpus of worker tasks */
+RTAPI_MP_STRING(servo_thread_workers, "cpus of the servo thread workers, as 2,3");
 static int num_joints = EMCMOT_MAX_JOINTS;	/* default number of joints present */
 RTAPI_MP_INT(num_joints, "number of joints");
 static int num_dio = DEFAULT_DIO;	/* default number of motion synched DIO */
@@ -53,8 +59,40 @@ RTAPI_MP_INT(num_dio, "number of digital inputs/outputs");
 static int num_aio = DEFAULT_AIO;	/* default number of motion synched AIO */
 RTAPI_MP_INT(num_aio, "number of analog inputs/outputs");
 
+static int tc_queue_size = DEFAULT_TC_QUEUE_SIZE;	/* motion queue length */
+RTAPI_MP_INT(tc_queue_size, "number of segments in the motion queue");
+
 static int unlock_joints_mask = 0;/* mask to select joints for unlock pins */
 RTAPI_MP_INT(unlock_joints_mask, "mask to select joints for unlock pins");
+
+static int quintic_joints_mask = 0;/* joints with the quintic interpolator */
+RTAPI_MP_INT(quintic_joints_mask, "mask to select joints for the jerk continuous quintic interpolator");
+
+static int phase_timing = 0;	/* export motion.servo.phase.* pins */
+RTAPI_MP_INT(phase_timing, "time the phases of the servo cycle");
+
+static int tp_stats = 0;	/* export motion.tp.* pins */
+RTAPI_MP_INT(tp_stats, "export the trajectory planner statistics");
+
+static int home_overlap = 0;	/* start a homing step once the last latched */
+RTAPI_MP_INT(home_overlap, "start each homing step once the previous one has latched");
+
+static int stream_channel = -1;	/* halstreamer channel of setpoints, or -1 */
+RTAPI_MP_INT(stream_channel, "halstreamer channel to take setpoints from, or -1 for none");
+
+static int stream_depth = 1024;	/* samples in the setpoint stream */
+RTAPI_MP_INT(stream_depth, "samples in the setpoint stream");
+
+static int stream_joints = 0;	/* setpoints are joint, not axis, positions */
+RTAPI_MP_INT(stream_joints, "setpoint stream holds joint positions, not XYZABCUVW");
+
+/* the key of halstreamer -c 0, STREAMER_SHMEM_KEY in streamer.h */
+#define MOT_STREAM_KEY 0x48535430
+
+/* pin names for enum mot_phase */
+static const char *phase_names[MOT_NUM_PHASES] = {
+    "inputs", "kins", "faults", "mode", "cmds", "comp", "output", "status"
+};
 /***********************************************************************
 *                  GLOBAL VARIABLE DEFINITIONS                         *
 ************************************************************************/
@@ -83,17 +121,22 @@ emcmot_axis_t axis_array[EMCMOT_MAX_AXIS];
 
   emcmotStruct is ptr to this memory.
 
-  emcmotCommand points to emcmotStruct->command,
+  emcmotCommandRing points to emcmotStruct->command_ring,
+  emcmotCommand points to the ring entry being processed,
   emcmotStatus points to emcmotStruct->status,
+  emcmotStatusHot points to emcmotStruct->status_hot,
   emcmotError points to emcmotStruct->error, and
  */
 emcmot_struct_t *emcmotStruct = 0;
 /* ptrs to either buffered copies or direct memory for command and status */
+struct emcmot_command_ring_t *emcmotCommandRing = 0;
 struct emcmot_command_t *emcmotCommand = 0;
 struct emcmot_status_t *emcmotStatus = 0;
+struct emcmot_status_hot_t *emcmotStatusHot = 0;
 struct emcmot_config_t *emcmotConfig = 0;
 struct emcmot_debug_t *emcmotDebug = 0;
 struct emcmot_error_t *emcmotError = 0;	/* unused for RT_FIFO */
+struct emcmot_volcomp_t *emcmotVolcomp = 0;
 
 /***********************************************************************
 *                  LOCAL VARIABLE DECLARATIONS                         *
@@ -270,6 +313,9 @@ void rtapi_app_exit(void)
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    _("MOTION: hal_stop_threads() failed, returned %d\n"), retval);
     }
+    if (emcmot_hal_data && emcmot_hal_data->stream_num) {
+	hal_stream_destroy(&emcmot_hal_data->stream);
+    }
     /* free shared memory */
     retval = rtapi_shmem_delete(emc_shmem_id, mot_comp_id);
     if (retval < 0) {
@@ -335,9 +381,11 @@ static int init_hal_io(void)
     *(emcmot_hal_data->spindle_orient) = 0;
 
     if ((retval = hal_pin_float_newf(HAL_IN, &(emcmot_hal_data->spindle_revs), mot_comp_id, "motion.spindle-revs")) != 0) goto error;
+    if ((retval = hal_pin_float_newf(HAL_IN, &(emcmot_hal_data->spindle_revs_lead), mot_comp_id, "motion.spindle-revs-lead")) != 0) goto error;
     if ((retval = hal_pin_float_newf(HAL_IN, &(emcmot_hal_data->spindle_speed_in), mot_comp_id, "motion.spindle-speed-in")) != 0) goto error;
     if ((retval = hal_pin_bit_newf(HAL_IN, &(emcmot_hal_data->spindle_is_atspeed), mot_comp_id, "motion.spindle-at-speed")) != 0) goto error;
     if ((retval = hal_pin_float_newf(HAL_IN, &(emcmot_hal_data->adaptive_feed), mot_comp_id, "motion.adaptive-feed")) != 0) goto error;
+    if ((retval = hal_pin_float_newf(HAL_IN, &(emcmot_hal_data->feed_scale_rate), mot_comp_id, "motion.feed-scale-rate")) != 0) goto error;
     if ((retval = hal_pin_bit_newf(HAL_IN, &(emcmot_hal_data->feed_hold), mot_comp_id, "motion.feed-hold")) != 0) goto error;
     if ((retval = hal_pin_bit_newf(HAL_IN, &(emcmot_hal_data->feed_inhibit), mot_comp_id, "motion.feed-inhibit")) != 0) goto error;
     if ((retval = hal_pin_bit_newf(HAL_IN, &(emcmot_hal_data->enable), mot_comp_id, "motion.enable")) != 0) goto error;
@@ -400,6 +448,76 @@ static int init_hal_io(void)
 #ifdef HAVE_CPU_KHZ
     if ((retval = hal_param_float_newf(HAL_RO, &(emcmot_hal_data->last_period_ns), mot_comp_id, "motion.servo.last-period-ns")) != 0) goto error;
 #endif
+    if (phase_timing) {
+        if ((retval = hal_pin_bit_newf(HAL_IN, &(emcmot_hal_data->phase_reset), mot_comp_id, "motion.servo.phase-reset")) != 0) goto error;
+        for (n = 0; n < MOT_NUM_PHASES; n++) {
+            if ((retval = hal_pin_u32_newf(HAL_OUT, &(emcmot_hal_data->phase[n].time), mot_comp_id, "motion.servo.phase.%s.time", phase_names[n])) != 0) goto error;
+            if ((retval = hal_pin_u32_newf(HAL_OUT, &(emcmot_hal_data->phase[n].max), mot_comp_id, "motion.servo.phase.%s.max", phase_names[n])) != 0) goto error;
+            if ((retval = hal_pin_float_newf(HAL_OUT, &(emcmot_hal_data->phase[n].avg), mot_comp_id, "motion.servo.phase.%s.avg", phase_names[n])) != 0) goto error;
+            *(emcmot_hal_data->phase[n].time) = 0;
+            *(emcmot_hal_data->phase[n].max) = 0;
+            *(emcmot_hal_data->phase[n].avg) = 0;
+        }
+        *(emcmot_hal_data->phase_reset) = 0;
+    }
+    emcmot_hal_data->phase_timing = phase_timing;
+    if (tp_stats) {
+        if ((retval = hal_pin_bit_newf(HAL_IN, &(emcmot_hal_data->tp_stats_reset), mot_comp_id, "motion.tp.stats-reset")) != 0) goto error;
+        if ((retval = hal_pin_u32_newf(HAL_OUT, &(emcmot_hal_data->tp_cycles), mot_comp_id, "motion.tp.cycles")) != 0) goto error;
+        if ((retval = hal_pin_u32_newf(HAL_OUT, &(emcmot_hal_data->tp_starved), mot_comp_id, "motion.tp.limit.starved")) != 0) goto error;
+        if ((retval = hal_pin_u32_newf(HAL_OUT, &(emcmot_hal_data->tp_lookahead), mot_comp_id, "motion.tp.limit.lookahead")) != 0) goto error;
+        if ((retval = hal_pin_u32_newf(HAL_OUT, &(emcmot_hal_data->tp_vel_limited), mot_comp_id, "motion.tp.limit.velocity")) != 0) goto error;
+        if ((retval = hal_pin_u32_newf(HAL_OUT, &(emcmot_hal_data->tp_acc_limited), mot_comp_id, "motion.tp.limit.accel")) != 0) goto error;
+        if ((retval = hal_pin_float_newf(HAL_OUT, &(emcmot_hal_data->tp_slow_time), mot_comp_id, "motion.tp.slow-time")) != 0) goto error;
+        for (n = 0; n < TP_STATS_DEPTH_BUCKETS; n++) {
+            if ((retval = hal_pin_u32_newf(HAL_OUT, &(emcmot_hal_data->tp_depth[n]), mot_comp_id, "motion.tp.depth.%d", 1 << n)) != 0) goto error;
+            *(emcmot_hal_data->tp_depth[n]) = 0;
+        }
+        if ((retval = hal_pin_u32_newf(HAL_OUT, &(emcmot_hal_data->tp_blend_tangent), mot_comp_id, "motion.tp.blend.tangent")) != 0) goto error;
+        if ((retval = hal_pin_u32_newf(HAL_OUT, &(emcmot_hal_data->tp_blend_arc), mot_comp_id, "motion.tp.blend.arc")) != 0) goto error;
+        if ((retval = hal_pin_u32_newf(HAL_OUT, &(emcmot_hal_data->tp_blend_parabolic), mot_comp_id, "motion.tp.blend.parabolic")) != 0) goto error;
+        if ((retval = hal_pin_u32_newf(HAL_OUT, &(emcmot_hal_data->tp_blend_stop), mot_comp_id, "motion.tp.blend.stop")) != 0) goto error;
+        *(emcmot_hal_data->tp_stats_reset) = 0;
+        *(emcmot_hal_data->tp_cycles) = 0;
+        *(emcmot_hal_data->tp_starved) = 0;
+        *(emcmot_hal_data->tp_lookahead) = 0;
+        *(emcmot_hal_data->tp_vel_limited) = 0;
+        *(emcmot_hal_data->tp_acc_limited) = 0;
+        *(emcmot_hal_data->tp_slow_time) = 0;
+        *(emcmot_hal_data->tp_blend_tangent) = 0;
+        *(emcmot_hal_data->tp_blend_arc) = 0;
+        *(emcmot_hal_data->tp_blend_parabolic) = 0;
+        *(emcmot_hal_data->tp_blend_stop) = 0;
+    }
+    emcmot_hal_data->tp_stats = tp_stats;
+    emcmot_hal_data->home_overlap = home_overlap;
+    emcmot_hal_data->stream_num = 0;
+    if (stream_channel >= 0) {
+        char types[HAL_STREAM_MAX_PINS + 1];
+        int num = stream_joints ? num_joints : EMCMOT_MAX_AXIS;
+
+        for (n = 0; n < num; n++) {
+            types[n] = 'f';
+        }
+        types[n] = '\0';
+        retval = hal_stream_create(&emcmot_hal_data->stream, mot_comp_id,
+            MOT_STREAM_KEY + stream_channel, stream_depth, types);
+        if (retval < 0) {
+            rtapi_print_msg(RTAPI_MSG_ERR,
+                _("MOTION: can't create the stream of channel %d\n"), stream_channel);
+            goto error;
+        }
+        emcmot_hal_data->stream_num = num;
+        emcmot_hal_data->stream_joints = stream_joints;
+        if ((retval = hal_pin_bit_newf(HAL_IN, &(emcmot_hal_data->stream_enable), mot_comp_id, "motion.stream.enable")) != 0) goto error;
+        if ((retval = hal_pin_bit_newf(HAL_OUT, &(emcmot_hal_data->stream_active), mot_comp_id, "motion.stream.active")) != 0) goto error;
+        if ((retval = hal_pin_s32_newf(HAL_OUT, &(emcmot_hal_data->stream_underruns), mot_comp_id, "motion.stream.underruns")) != 0) goto error;
+        if ((retval = hal_pin_s32_newf(HAL_OUT, &(emcmot_hal_data->stream_depth), mot_comp_id, "motion.stream.depth")) != 0) goto error;
+        *(emcmot_hal_data->stream_enable) = 0;
+        *(emcmot_hal_data->stream_active) = 0;
+        *(emcmot_hal_data->stream_underruns) = 0;
+        *(emcmot_hal_data->stream_depth) = 0;
+    }
     if ((retval = hal_pin_float_newf(HAL_OUT, &(emcmot_hal_data->tooloffset_x), mot_comp_id, "motion.tooloffset.x")) != 0) goto error;
     if ((retval = hal_pin_float_newf(HAL_OUT, &(emcmot_hal_data->tooloffset_y), mot_comp_id, "motion.tooloffset.y")) != 0) goto error;
     if ((retval = hal_pin_float_newf(HAL_OUT, &(emcmot_hal_data->tooloffset_z), mot_comp_id, "motion.tooloffset.z")) != 0) goto error;
@@ -413,6 +531,7 @@ static int init_hal_io(void)
     /* initialize machine wide pins and parameters */
     *emcmot_hal_data->spindle_is_atspeed = 1;
     *(emcmot_hal_data->adaptive_feed) = 1.0;
+    *(emcmot_hal_data->feed_scale_rate) = 0.0;
     *(emcmot_hal_data->feed_hold) = 0;
     *(emcmot_hal_data->feed_inhibit) = 0;
 
@@ -550,6 +669,9 @@ static int export_joint(int num, joint_hal_t * addr)
     if ((retval = hal_pin_bit_newf(HAL_OUT, &(addr->homed), mot_comp_id, "joint.%d.homed", num)) != 0) return retval;
     if ((retval = hal_pin_bit_newf(HAL_OUT, &(addr->homing), mot_comp_id, "joint.%d.homing", num)) != 0) return retval;
     if ((retval = hal_pin_s32_newf(HAL_OUT, &(addr->home_state), mot_comp_id, "joint.%d.home-state", num)) != 0) return retval;
+    if ((retval = hal_pin_float_newf(HAL_OUT, &(addr->home_phase_time[0]), mot_comp_id, "joint.%d.home-search-time", num)) != 0) return retval;
+    if ((retval = hal_pin_float_newf(HAL_OUT, &(addr->home_phase_time[1]), mot_comp_id, "joint.%d.home-latch-time", num)) != 0) return retval;
+    if ((retval = hal_pin_float_newf(HAL_OUT, &(addr->home_phase_time[2]), mot_comp_id, "joint.%d.home-final-time", num)) != 0) return retval;
 
     if ( unlock_joints_mask & (1 << num) ) {
         // these pins may be needed for rotary joints
@@ -589,17 +711,36 @@ static int init_comm_buffers(void)
     int joint_num, axis_num, n;
     emcmot_joint_t *joint;
     int retval;
+    unsigned long queue_offset, queue_slots, shmem_size;
+    TC_STRUCT *queueTcSpace;
+    syncdio_t *queueSyncdioSpace;
 
     rtapi_print_msg(RTAPI_MSG_INFO, "MOTION: init_comm_buffers() starting...\n");
 
     emcmotStruct = 0;
     emcmotDebug = 0;
     emcmotStatus = 0;
+    emcmotStatusHot = 0;
+    emcmotCommandRing = 0;
     emcmotCommand = 0;
     emcmotConfig = 0;
+    emcmotVolcomp = 0;
+
+    if (tc_queue_size < MIN_TC_QUEUE_SIZE || tc_queue_size > MAX_TC_QUEUE_SIZE) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "MOTION: tc_queue_size must be between %d and %d\n",
+	    MIN_TC_QUEUE_SIZE, MAX_TC_QUEUE_SIZE);
+	return -1;
+    }
+    /* the queue goes after the structure, plus 10 more for safety;
+       user space maps only sizeof(emcmot_struct_t) */
+    queue_offset = (sizeof(emcmot_struct_t) + 63) & ~63UL;
+    queue_slots = tc_queue_size + 10;
+    shmem_size = queue_offset
+	+ queue_slots * (sizeof(TC_STRUCT) + sizeof(syncdio_t));
 
     /* allocate and initialize the shared memory structure */
-    emc_shmem_id = rtapi_shmem_new(key, mot_comp_id, sizeof(emcmot_struct_t));
+    emc_shmem_id = rtapi_shmem_new(key, mot_comp_id, shmem_size);
     if (emc_shmem_id < 0) {
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "MOTION: rtapi_shmem_new failed, returned %d\n", emc_shmem_id);
@@ -613,19 +754,27 @@ static int init_comm_buffers(void)
     }
 
     /* zero shared memory before doing anything else. */
-    memset(emcmotStruct, 0, sizeof(emcmot_struct_t));
+    memset(emcmotStruct, 0, shmem_size);
+    queueTcSpace = (TC_STRUCT *) ((char *) emcmotStruct + queue_offset);
+    queueSyncdioSpace = (syncdio_t *) (queueTcSpace + queue_slots);
 
     /* we'll reference emcmotStruct directly */
-    emcmotCommand = &emcmotStruct->command;
+    emcmotCommandRing = &emcmotStruct->command_ring;
+    emcmotCommand = &emcmotCommandRing->slot[0];
     emcmotStatus = &emcmotStruct->status;
+    emcmotStatusHot = &emcmotStruct->status_hot;
     emcmotConfig = &emcmotStruct->config;
     emcmotDebug = &emcmotStruct->debug;
     emcmotError = &emcmotStruct->error;
+    emcmotVolcomp = &emcmotStruct->volcomp;
 
     /* init error struct */
     emcmotErrorInit(emcmotError);
 
-    /* init command struct */
+    /* init command ring and its first slot */
+    emcmotCommandRing->head = 0;
+    emcmotCommandRing->tail = 0;
+    emcmotCommandRing->errors = 0;
     emcmotCommand->head = 0;
     emcmotCommand->command = 0;
     emcmotCommand->commandNum = 0;
@@ -647,6 +796,12 @@ static int init_comm_buffers(void)
     SET_MOTION_COORD_FLAG(0);
     SET_MOTION_TELEOP_FLAG(0);
     emcmotDebug->split = 0;
+    emcmotDebug->probe_step_count = 0;
+    emcmotDebug->probe_step = -1;
+    emcmotDebug->probe_step_started = 0;
+    emcmotDebug->stream_state = STREAM_IDLE;
+    emcmotStatus->probePointCount = 0;
+    emcmotStatus->probePointsTripped = 0;
     emcmotStatus->heartbeat = 0;
     emcmotConfig->numJoints = num_joints;
     emcmotConfig->numDIO = num_dio;
@@ -716,6 +871,7 @@ static int init_comm_buffers(void)
 
 	joint->comp.entries = 0;
 	joint->comp.entry = &(joint->comp.array[0]);
+	joint->comp.index_buckets = 0;
 	/* the compensation code has -DBL_MAX at one end of the table
 	   and +DBL_MAX at the other so _all_ commanded positions are
 	   guaranteed to be covered by the table */
@@ -752,6 +908,9 @@ static int init_comm_buffers(void)
 
 	/* init internal info */
 	cubicInit(&(joint->cubic));
+	if (quintic_joints_mask & (1 << joint_num)) {
+	    cubicSetOrder(&(joint->cubic), CUBIC_ORDER_QUINTIC);
+	}
     }
 
     /*! \todo FIXME-- add emcmotError */
@@ -761,8 +920,8 @@ static int init_comm_buffers(void)
     emcmotDebug->running_time = 0.0;
 
     /* init motion emcmotDebug->coord_tp */
-    if (-1 == tpCreate(&emcmotDebug->coord_tp, DEFAULT_TC_QUEUE_SIZE,
-	    emcmotDebug->queueTcSpace)) {
+    if (-1 == tpCreate(&emcmotDebug->coord_tp, tc_queue_size,
+	    queueTcSpace, queueSyncdioSpace)) {
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "MOTION: failed to create motion emcmotDebug->coord_tp\n");
 	return -1;
@@ -813,7 +972,8 @@ static int init_threads(void)
     /* create HAL threads for each period */
     /* only create base thread if it is faster than servo thread */
     if (servo_base_ratio > 1) {
-	retval = hal_create_thread("base-thread", base_period_nsec, base_thread_fp);
+	retval = hal_create_thread_cpu("base-thread", base_period_nsec,
+		base_thread_fp, base_thread_cpu);
 	if (retval < 0) {
 	    rtapi_print_msg(RTAPI_MSG_ERR,
 		"MOTION: failed to create %ld nsec base thread\n",
@@ -821,13 +981,26 @@ static int init_threads(void)
 	    return -1;
 	}
     }
-    retval = hal_create_thread("servo-thread", servo_period_nsec, 1);
+    retval = hal_create_thread_cpu("servo-thread", servo_period_nsec, 1,
+	servo_thread_cpu);
     if (retval < 0) {
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "MOTION: failed to create %ld nsec servo thread\n",
 	    servo_period_nsec);
 	return -1;
     }
+    while (servo_thread_workers && *servo_thread_workers) {
+	char *end;
+	long cpu = simple_strtol(servo_thread_workers, &end, 10);
+	if (end == servo_thread_workers || (*end != ',' && *end != '\0')
+	    || hal_thread_add_worker("servo-thread", cpu) < 0) {
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+		"MOTION: failed to add servo thread worker '%s'\n",
+		servo_thread_workers);
+	    return -1;
+	}
+	servo_thread_workers = *end ? end + 1 : end;
+    }
     /* export realtime functions that do the real work */
     retval = hal_export_funct("motion-controller", emcmotController, 0	/* arg 
 	 */ , 1 /* uses_fp */ , 0 /* reentrant */ , mot_comp_id);
@@ -130,6 +130,9 @@ extern "C" {
 	EMCMOT_CLEAR_PROBE_FLAGS,	/* clears probeTripped flag */
 	EMCMOT_PROBE,		/* go to pos, stop if probe trips, record
 				   trip pos */
+	EMCMOT_PROBE_SEQUENCE_ADD,	/* append a move to the probe sequence */
+	EMCMOT_PROBE_SEQUENCE_RUN,	/* run the probe sequence, recording
+					   the trip pos of each probe move */
 	EMCMOT_RIGID_TAP,	/* go to pos, with sync to spindle speed, 
 				   then return to initial pos */
 
@@ -154,6 +157,7 @@ extern "C" {
         EMCMOT_SET_OFFSET, /* set tool offsets */
         EMCMOT_SET_MAX_FEED_OVERRIDE,
         EMCMOT_SETUP_ARC_BLENDS,
+        EMCMOT_SETUP_PLANNER,   /* select trajectory profile and jerk limit */
 
 	EMCMOT_SET_PROBE_ERR_INHIBIT,
 	EMCMOT_ENABLE_WATCHDOG,         /* enable watchdog sound, parport */
@@ -179,6 +183,7 @@ extern "C" {
 	EMCMOT_UPDATE_JOINT_HOMING_PARAMS, /* updates some joint homing parameters */
 	EMCMOT_SET_JOINT_MOTOR_OFFSET,  /* set the offset between joint and motor */
 	EMCMOT_SET_JOINT_COMP,          /* set a compensation triplet for a joint (nominal, forw., rev.) */
+	EMCMOT_SET_VOLCOMP,             /* turn the volumetric compensation grid on or off */
 
         EMCMOT_SET_AXIS_POSITION_LIMITS, /* set the axis position +/- limits */
         EMCMOT_SET_AXIS_VEL_LIMIT,      /* set the max axis vel */
@@ -206,8 +211,8 @@ extern "C" {
        COMMAND STRUCTURE
 *********************************/
 
-/* This is the command structure.  There is one of these in shared
-   memory, and all commands from higher level code come thru it.
+/* This is the command structure.  A ring of these in shared memory
+   carries all commands from higher level code.
 */
     typedef struct emcmot_command_t {
 	unsigned char head;	/* flag count for mutex detect */
@@ -249,6 +254,8 @@ extern "C" {
 	unsigned char now, out, start, end;	/* these are related to synched AOUT/DOUT. now=wether now or synched, out = which gets set, start=start value, end=end value */
 	unsigned char mode;	/* used for turning overrides etc. on/off */
 	double comp_nominal, comp_forward, comp_reverse; /* compensation triplet, nominal, forward, reverse */
+	int volcomp_n[3];	/* volumetric comp grid points, 0 to turn it off */
+	double volcomp_origin[3], volcomp_spacing[3];	/* first point and spacing */
         unsigned char probe_type; /* ~1 = error if probe operation is unsuccessful (ngc default)
                                      |1 = suppress error, report in # instead
                                      ~2 = move until probe trips (ngc default)
@@ -262,14 +269,98 @@ extern "C" {
 	unsigned char wait_for_spindle_at_speed; // EMCMOT_SPINDLE_ON now carries this, for next feed move
 	unsigned char tail;	/* flag count for mutex detect */
         int arcBlendOptDepth;
+        int arcBlendOptMode;
         int arcBlendEnable;
         int arcBlendFallbackEnable;
         int arcBlendGapCycles;
         double arcBlendRampFreq;
         double arcBlendTangentKinkRatio;
         double maxFeedScale;
+        int plannerType;        /* TP_PLANNER_TRAPEZOIDAL or TP_PLANNER_SCURVE */
+        double maxJerk;         /* jerk limit for TP_PLANNER_SCURVE */
+        int rapidIndependent;   /* rapids above rapidClearance may run their
+                                   axes independently */
+        double rapidClearance;  /* [TRAJ]INDEPENDENT_RAPID_Z */
     } emcmot_command_t;
 
+/* One move of a probe sequence.  Probe moves (motion_type
+   EMC_MOTION_TYPE_PROBING) stop where the probe trips and record that
+   point; any other move starts from where the one before it stopped. */
+    typedef struct emcmot_probe_step_t {
+	EmcPose pos;		/* end point */
+	int motion_type;	/* traverse, feed or probing */
+	double vel, ini_maxvel, acc;
+	unsigned char probe_type;	/* as for EMCMOT_PROBE */
+	int id;			/* motion id */
+    } emcmot_probe_step_t;
+
+/* Single-producer/single-consumer ring of commands.  usrmotintf.cc fills
+   slot[head % EMCMOT_COMMAND_RING_SIZE] and then advances head; the motion
+   command handler processes entries up to head and advances tail.  head is
+   only written by the producer and tail and errors only by the consumer. */
+    typedef struct emcmot_command_ring_t {
+	unsigned int head;	/* next slot to be written */
+	unsigned int tail;	/* next slot to be processed */
+	unsigned int errors;	/* count of queued commands that failed */
+	struct emcmot_command_t slot[EMCMOT_COMMAND_RING_SIZE];
+    } emcmot_command_ring_t;
+
+/* ring index accessors; acquire/release so a published slot is complete */
+    static inline unsigned int emcmotRingLoad(unsigned int *idx)
+    {
+	return __atomic_load_n(idx, __ATOMIC_ACQUIRE);
+    }
+
+    static inline void emcmotRingStore(unsigned int *idx, unsigned int val)
+    {
+	__atomic_store_n(idx, val, __ATOMIC_RELEASE);
+    }
+
+/* Sequence lock helpers.  The single writer (the motion thread) makes
+   seq odd for the duration of an update and even again afterwards;
+   readers copy the block and retry if seq was odd or changed under them.
+   Writers never wait, so the servo thread is never held up by a UI. */
+    static inline void emcmotSeqWriteBegin(unsigned int *seq)
+    {
+	__atomic_store_n(seq, *seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+    }
+
+    static inline void emcmotSeqWriteEnd(unsigned int *seq)
+    {
+	__atomic_store_n(seq, *seq + 1, __ATOMIC_RELEASE);
+    }
+
+    static inline unsigned int emcmotSeqReadBegin(unsigned int *seq)
+    {
+	return __atomic_load_n(seq, __ATOMIC_ACQUIRE);
+    }
+
+/* returns non-zero if the copy made since emcmotSeqReadBegin() is torn */
+    static inline int emcmotSeqReadRetry(unsigned int *seq, unsigned int start)
+    {
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	return (start & 1) || __atomic_load_n(seq, __ATOMIC_RELAXED) != start;
+    }
+
+/* Queued commands are the per-segment ones that task streams to the
+   planner.  The writer doesn't wait for them to be echoed; if one fails,
+   motion bumps the ring error count and discards further queued commands
+   until the next non-queued command arrives. */
+    static inline int emcmotCommandIsQueued(cmd_code_t command)
+    {
+	switch (command) {
+	case EMCMOT_SET_LINE:
+	case EMCMOT_SET_CIRCLE:
+	case EMCMOT_SET_TERM_COND:
+	case EMCMOT_SET_SPINDLESYNC:
+	case EMCMOT_PROBE_SEQUENCE_ADD:
+	    return 1;
+	default:
+	    return 0;
+	}
+    }
+
 /*! \todo FIXME - these packed bits might be replaced with chars
    memory is cheap, and being able to access them without those
    damn macros would be nice
@@ -404,14 +495,35 @@ Suggestion: Split this in to an Error and a Status flag register..
     } emcmot_comp_entry_t; 
 
 
-#define EMCMOT_COMP_SIZE 256
+#define EMCMOT_COMP_SIZE 1024
+/* the table is also indexed by buckets of equal width between the first
+   and the last entry, so finding the entry for a position doesn't need
+   a search: index[b] is the last entry before bucket b starts */
+#define EMCMOT_COMP_INDEX (2*EMCMOT_COMP_SIZE)
     typedef struct {
 	int entries;		/* number of entries in the array */
 	emcmot_comp_entry_t *entry;  /* current entry in array */
 	emcmot_comp_entry_t array[EMCMOT_COMP_SIZE+2];
 	/* +2 because array has -HUGE_VAL and +HUGE_VAL entries at the ends */
+	double index_start;	/* nominal of the first real entry */
+	double index_scale;	/* buckets per unit of position */
+	int index_buckets;	/* buckets in use, 0 for no index */
+	unsigned short index[EMCMOT_COMP_INDEX];
     } emcmot_comp_t;
 
+/* volumetric compensation: an XYZ correction on a regular grid, added to
+   the commanded position before the inverse kinematics.  User space
+   writes the grid points while the compensation is off, the rest is set
+   by EMCMOT_SET_VOLCOMP. */
+#define EMCMOT_VOLCOMP_SIZE 32768
+    typedef struct emcmot_volcomp_t {
+	int enabled;
+	int n[3];		/* points along x, y and z, at least 2 each */
+	double origin[3];	/* position of the first point */
+	double scale[3];	/* 1 / spacing of the points */
+	float corr[EMCMOT_VOLCOMP_SIZE][3];	/* x varies fastest, then y */
+    } emcmot_volcomp_t;
+
 /* motion controller states */
 
     typedef enum {
@@ -547,6 +659,8 @@ Suggestion: Split this in to an Error and a Status flag register..
 	int index_enable;	/* current state of index enable pin */
 
 	home_state_t home_state;	/* state machine for homing */
+	double home_phase_time[3];	/* seconds of the last home spent
+				   searching, latching and on the final move */
 	double motor_offset;	/* diff between internal and motor pos, used
 				   to set position to zero during homing */
 	int old_jjog_counts;	/* prior value, used for deltas */
@@ -637,11 +751,13 @@ Suggestion: Split this in to an Error and a Status flag register..
 */
 
     typedef struct emcmot_status_t {
+	unsigned int seq;	/* seqlock, odd while motion is writing */
 	unsigned char head;	/* flag count for mutex detect */
-	/* these three are updated only when a new command is handled */
+	/* these four are updated only when a new command is handled */
 	cmd_code_t commandEcho;	/* echo of input command */
 	int commandNumEcho;	/* echo of input command number */
 	cmd_status_t commandStatus;	/* result of most recent command */
+	unsigned int commandFailures;	/* commands that didn't return OK */
 	/* these are config info, updated when a command changes them */
 	double feed_scale;	/* velocity scale factor for all motion but rapids */
 	double rapid_scale;	/* velocity scale factor for rapids */
@@ -663,7 +779,6 @@ Suggestion: Split this in to an Error and a Status flag register..
 	EmcPose world_home;	/* cartesean coords of home position */
 	int homing_active;	/* non-zero if any joint is homing */
 	home_sequence_state_t homingSequenceState;
-	emcmot_joint_status_t joint_status[EMCMOT_MAX_JOINTS];	/* all joint status data */
         emcmot_axis_status_t axis_status[EMCMOT_MAX_AXIS];	/* all axis status data */
 
 	int on_soft_limit;	/* non-zero if any joint is on soft limit */
@@ -676,6 +791,11 @@ Suggestion: Split this in to an Error and a Status flag register..
         unsigned char probe_type;
 	EmcPose probedPos;	/* Axis positions stored as soon as possible
 				   after last probeTripped */
+	EmcPose probePoints[EMCMOT_MAX_PROBE_POINTS];	/* probedPos of each
+				   probe move of the last probe sequence */
+	int probePointCount;	/* number of probePoints recorded */
+	unsigned int probePointsTripped;	/* bit n set if probePoints[n]
+				   is where the probe tripped */
         int spindle_index_enable;  /* hooked to a canon encoder index-enable */
         int spindleSync;        /* we are doing spindle-synced motion */
         double spindleRevs;     /* position of spindle in revolutions */
@@ -719,9 +839,52 @@ Suggestion: Split this in to an Error and a Status flag register..
         int atspeed_next_feed;  /* at next feed move, wait for spindle to be at speed  */
         int spindle_is_atspeed; /* hal input */
 	unsigned char tail;	/* flag count for mutex detect */
-        
+
+	/* last, so that a reader copies only the joints that are
+	   configured; see usrmotReadEmcmotStatus() */
+	emcmot_joint_status_t joint_status[EMCMOT_MAX_JOINTS];	/* all joint status data */
     } emcmot_status_t;
 
+/* bracket every write to emcmot_status_t; keeps the legacy head/tail
+   counts in step with the seqlock */
+    static inline void emcmotStatusWriteBegin(emcmot_status_t *s)
+    {
+	emcmotSeqWriteBegin(&s->seq);
+	s->head++;
+    }
+
+    static inline void emcmotStatusWriteEnd(emcmot_status_t *s)
+    {
+	s->tail = s->head;
+	emcmotSeqWriteEnd(&s->seq);
+    }
+
+/* The "hot" status is the small subset of emcmot_status_t that UIs poll
+   most often.  Motion refreshes it at the end of every servo cycle under
+   its own seqlock, so it can be copied without pulling the whole status
+   block. */
+    typedef struct emcmot_status_hot_t {
+	unsigned int seq;	/* seqlock, odd while motion is writing */
+	unsigned int heartbeat;	/* emcmotStatus->heartbeat at the copy */
+	motion_state_t motion_state;
+	EMCMOT_MOTION_FLAG motionFlag;
+	EmcPose carte_pos_cmd;
+	EmcPose carte_pos_fb;
+	double current_vel;
+	double requested_vel;
+	double distance_to_go;
+	int id;
+	int depth;
+	int queueFull;
+	int paused;
+	int commandNumEcho;
+	cmd_status_t commandStatus;
+	EMCMOT_JOINT_FLAG joint_flag[EMCMOT_MAX_JOINTS];
+	double joint_pos_cmd[EMCMOT_MAX_JOINTS];
+	double joint_pos_fb[EMCMOT_MAX_JOINTS];
+	double joint_vel_cmd[EMCMOT_MAX_JOINTS];
+    } emcmot_status_hot_t;
+
 /*********************************
         CONFIG STRUCTURE
 *********************************/
@@ -775,12 +938,17 @@ Suggestion: Split this in to an Error and a Status flag register..
 	int debug;		/* copy of DEBUG, from .ini file */
 	unsigned char tail;	/* flag count for mutex detect */
         int arcBlendOptDepth;
+        int arcBlendOptMode;
         int arcBlendEnable;
         int arcBlendFallbackEnable;
         int arcBlendGapCycles;
         double arcBlendRampFreq;
         double arcBlendTangentKinkRatio;
         double maxFeedScale;
+        int plannerType;
+        double maxJerk;
+        int rapidIndependent;
+        double rapidClearance;
         int inhibit_probe_jog_error;
         int inhibit_probe_home_error;
     } emcmot_config_t;
@@ -805,14 +973,21 @@ Suggestion: Split this in to an Error and a Status flag register..
 	unsigned char tail;	/* flag count for mutex detect */
     } emcmot_internal_t;
 
-/* error structure - A ring buffer used to pass formatted printf stings to usr space */
+/* error structure - A ring of variable length records used to pass
+   messages to user space.  Each record is the stashf() form of a message,
+   its format and then its arguments in binary, formatted by the reader,
+   behind a 4 byte length; a length of EMCMOT_ERROR_WRAP means the next
+   record is at the start of data.  head and tail count bytes and only
+   grow; head is written only by the writer that holds busy, tail only by
+   the one reader.  A message that finds the ring full or another writer
+   in it is counted in dropped instead of waiting. */
+#define EMCMOT_ERROR_WRAP 0xffffffffu
     typedef struct emcmot_error_t {
-	unsigned char head;	/* flag count for mutex detect */
-	char error[EMCMOT_ERROR_NUM][EMCMOT_ERROR_LEN];
-	int start;		/* index of oldest error */
-	int end;		/* index of newest error */
-	int num;		/* number of items */
-	unsigned char tail;	/* flag count for mutex detect */
+	unsigned int head;	/* bytes written */
+	unsigned int tail;	/* bytes read */
+	unsigned int busy;	/* a writer is filling a record */
+	unsigned int dropped;	/* messages that didn't fit */
+	unsigned char data[EMCMOT_ERROR_RING_SIZE];
     } emcmot_error_t;
 
 /*
@@ -825,6 +1000,7 @@ Suggestion: Split this in to an Error and a Status flag register..
     extern int emcmotErrorPutfv(emcmot_error_t * errlog, const char *fmt, va_list ap);
     extern int emcmotErrorPutf(emcmot_error_t * errlog, const char *fmt, ...);
     extern int emcmotErrorGet(emcmot_error_t * errlog, char *error);
+    extern unsigned int emcmotErrorDropped(emcmot_error_t * errlog);
 
 #ifdef __cplusplus
 }
@@ -50,9 +50,8 @@ typedef struct emcmot_debug_t {
 
 	TP_STRUCT coord_tp;	/* coordinated mode planner */
 
-/* space for trajectory planner queues, plus 10 more for safety */
-/*! \todo FIXME-- default is used; dynamic is not honored */
-	TC_STRUCT queueTcSpace[DEFAULT_TC_QUEUE_SIZE + 10];
+/* the space for the trajectory planner queue is after emcmot_struct_t
+   in the same shared memory, sized by motmod's tc_queue_size */
 
 	int enabling;		/* starts up disabled */
 	int coordinating;	/* starts up in free mode */
@@ -64,6 +63,15 @@ typedef struct emcmot_debug_t {
 	int stepping;
 	int idForStep;
 
+	emcmot_probe_step_t probe_steps[EMCMOT_MAX_PROBE_STEPS];
+	int probe_step_count;	/* moves loaded by EMCMOT_PROBE_SEQUENCE_ADD */
+	int probe_step;		/* move of the running sequence, -1 if none */
+	int probe_step_started;	/* probe_step has been given to the planner */
+
+	int stream_state;	/* STREAM_IDLE etc, see mot_priv.h */
+	double stream_pos[EMCMOT_MAX_JOINTS];	/* last setpoint from the stream */
+	double stream_vel[EMCMOT_MAX_JOINTS];	/* its change in the last cycle */
+
 #ifdef STRUCTS_IN_SHMEM
 	emcmot_joint_t joints[EMCMOT_MAX_JOINTS];	/* joint data */
 	emcmot_axis_t axes[EMCMOT_MAX_AXIS];	        /* axis data */
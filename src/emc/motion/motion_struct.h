@@ -14,15 +14,19 @@
 
 /* big comm structure, for upper memory */
     typedef struct emcmot_struct_t {
-	struct emcmot_command_t command;	/* struct used to pass commands/data
-					   to the RT module from usr space */
+	struct emcmot_command_ring_t command_ring;	/* ring used to pass
+					   commands/data to the RT module
+					   from usr space */
 	struct emcmot_status_t status;	/* Struct used to store RT status */
+	struct emcmot_status_hot_t status_hot;	/* per-cycle subset of status */
 	struct emcmot_config_t config;	/* Struct used to store RT config */
 	struct emcmot_internal_t internal;	/*! \todo FIXME - doesn't need to be in
 					   shared memory */
 	struct emcmot_error_t error;	/* ring buffer for error messages */
 	struct emcmot_debug_t debug;	/* Struct used to store RT status and debug
 				   data - 2nd largest block */
+	struct emcmot_volcomp_t volcomp;	/* volumetric compensation grid,
+					   the largest block */
     } emcmot_struct_t;
 
 
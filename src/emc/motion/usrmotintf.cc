@@ -17,11 +17,12 @@
 #include <stdlib.h>		/* exit() */
 #include <sys/stat.h>
 #include <string.h>		/* memcpy() */
+#include <stddef.h>		/* offsetof() */
 #include <float.h>		/* DBL_MIN */
 #include "motion.h"		/* emcmot_status_t,CMD */
 #include "motion_debug.h"       /* emcmot_debug_t */
 #include "motion_struct.h"      /* emcmot_struct_t */
-#include "emcmotcfg.h"		/* EMCMOT_ERROR_NUM,LEN */
+#include "emcmotcfg.h"		/* EMCMOT_ERROR_LEN */
 #include "emcmotglb.h"		/* SHMEM_KEY */
 #include "usrmotintf.h"		/* these decls */
 #include "_timer.h"
@@ -39,8 +40,12 @@
 
 static int inited = 0;		/* flag if inited */
 
-static emcmot_command_t *emcmotCommand = 0;
+/* how often a status read is retried while motion is writing it */
+#define EMCMOT_STATUS_READ_RETRIES 100
+
+static emcmot_command_ring_t *emcmotCommandRing = 0;
 static emcmot_status_t *emcmotStatus = 0;
+static emcmot_status_hot_t *emcmotStatusHot = 0;
 static emcmot_config_t *emcmotConfig = 0;
 static emcmot_debug_t *emcmotDebug = 0;
 static emcmot_error_t *emcmotError = 0;
@@ -72,12 +77,15 @@ int usrmotIniLoad(const char *filename)
     return 0;
 }
 
+static int commandNum = 0;
+static unsigned char headCount = 0;
+static unsigned int errorsSeen = 0;
+
 /* writes command from c */
 int usrmotWriteEmcmotCommand(emcmot_command_t * c)
 {
     emcmot_status_t s;
-    static int commandNum = 0;
-    static unsigned char headCount = 0;
+    unsigned int head, errors;
     double end;
 
     if (!MOTION_ID_VALID(c->id)) {
@@ -89,19 +97,41 @@ int usrmotWriteEmcmotCommand(emcmot_command_t * c)
     c->commandNum = ++commandNum;
 
     /* check for mapped mem still around */
-    if (0 == emcmotCommand) {
+    if (0 == emcmotCommandRing) {
         rcs_print("USRMOT: ERROR: can't connect to shared memory\n");
 	return EMCMOT_COMM_ERROR_CONNECT;
     }
-    /* copy entire command structure to shared memory */
-    *emcmotCommand = *c;
-    /* poll for receipt of command */
+    /* queued commands aren't waited for, so a failure shows up as a bump
+       in the ring error count; refuse to keep streaming after one */
+    errors = emcmotRingLoad(&emcmotCommandRing->errors);
+    if (emcmotCommandIsQueued(c->command) && errors != errorsSeen) {
+	errorsSeen = errors;
+        rcs_print("USRMOT: ERROR: queued command failed\n");
+	return EMCMOT_COMM_ERROR_COMMAND;
+    }
     /* set timeout for comm failure, now + timeout */
     end = etime() + EMCMOT_COMM_TIMEOUT;
-    /* now check to see if it got it */
+    /* wait for a free slot, we are the only writer of head */
+    head = emcmotCommandRing->head;
+    while (head - emcmotRingLoad(&emcmotCommandRing->tail) >= EMCMOT_COMMAND_RING_SIZE) {
+	if (etime() >= end) {
+	    rcs_print("USRMOT: ERROR: command ring full\n");
+	    return EMCMOT_COMM_ERROR_TIMEOUT;
+	}
+	esleep(25e-6);
+    }
+    /* copy entire command structure to the ring, then publish it */
+    emcmotCommandRing->slot[head % EMCMOT_COMMAND_RING_SIZE] = *c;
+    emcmotRingStore(&emcmotCommandRing->head, head + 1);
+    if (emcmotCommandIsQueued(c->command)) {
+	return EMCMOT_COMM_OK;
+    }
+    /* poll for receipt of command */
     while (etime() < end) {
 	/* update status */
 	if (( usrmotReadEmcmotStatus(&s) == 0 ) && ( s.commandNumEcho == commandNum )) {
+	    /* everything queued ahead of this one has been handled too */
+	    errorsSeen = emcmotRingLoad(&emcmotCommandRing->errors);
 	    /* now check emcmot status flag */
 	    if (s.commandStatus == EMCMOT_COMMAND_OK) {
 		return EMCMOT_COMM_OK;
@@ -116,26 +146,187 @@ int usrmotWriteEmcmotCommand(emcmot_command_t * c)
     return EMCMOT_COMM_ERROR_TIMEOUT;
 }
 
+/* writes the n queued commands from c, published to motion together */
+int usrmotWriteEmcmotCommands(emcmot_command_t * c, int n)
+{
+    unsigned int head, errors;
+    double end;
+    int k;
+
+    if (n <= 0) {
+	return EMCMOT_COMM_OK;
+    }
+    if (n > EMCMOT_COMMAND_RING_SIZE) {
+	rcs_print("USRMOT: ERROR: %d commands don't fit the ring\n", n);
+	return EMCMOT_COMM_ERROR_COMMAND;
+    }
+    for (k = 0; k < n; k++) {
+	if (!emcmotCommandIsQueued(c[k].command)) {
+	    rcs_print("USRMOT: ERROR: command %d can't be batched\n",
+		      c[k].command);
+	    return EMCMOT_COMM_ERROR_COMMAND;
+	}
+	if (!MOTION_ID_VALID(c[k].id)) {
+	    rcs_print("USRMOT: ERROR: invalid motion id: %d\n", c[k].id);
+	    return EMCMOT_COMM_INVALID_MOTION_ID;
+	}
+    }
+    if (0 == emcmotCommandRing) {
+        rcs_print("USRMOT: ERROR: can't connect to shared memory\n");
+	return EMCMOT_COMM_ERROR_CONNECT;
+    }
+    errors = emcmotRingLoad(&emcmotCommandRing->errors);
+    if (errors != errorsSeen) {
+	errorsSeen = errors;
+        rcs_print("USRMOT: ERROR: queued command failed\n");
+	return EMCMOT_COMM_ERROR_COMMAND;
+    }
+    end = etime() + EMCMOT_COMM_TIMEOUT;
+    head = emcmotCommandRing->head;
+    while (head + n - emcmotRingLoad(&emcmotCommandRing->tail) > EMCMOT_COMMAND_RING_SIZE) {
+	if (etime() >= end) {
+	    rcs_print("USRMOT: ERROR: command ring full\n");
+	    return EMCMOT_COMM_ERROR_TIMEOUT;
+	}
+	esleep(25e-6);
+    }
+    for (k = 0; k < n; k++) {
+	c[k].head = ++headCount;
+	c[k].tail = c[k].head;
+	c[k].commandNum = ++commandNum;
+	emcmotCommandRing->slot[(head + k) % EMCMOT_COMMAND_RING_SIZE] = c[k];
+    }
+    emcmotRingStore(&emcmotCommandRing->head, head + n);
+    return EMCMOT_COMM_OK;
+}
+
+/* writes the n waited-for commands from c together, and waits for the
+   last of them; motion counts the commands that fail, so the count
+   going up while it handled these means one of them did */
+int usrmotWriteEmcmotSettings(emcmot_command_t * c, int n)
+{
+    emcmot_status_t s;
+    unsigned int head, failures;
+    double end;
+    int k;
+
+    if (n <= 0) {
+	return EMCMOT_COMM_OK;
+    }
+    if (n > EMCMOT_COMMAND_RING_SIZE) {
+	rcs_print("USRMOT: ERROR: %d commands don't fit the ring\n", n);
+	return EMCMOT_COMM_ERROR_COMMAND;
+    }
+    for (k = 0; k < n; k++) {
+	if (emcmotCommandIsQueued(c[k].command)) {
+	    rcs_print("USRMOT: ERROR: command %d isn't a setting\n",
+		      c[k].command);
+	    return EMCMOT_COMM_ERROR_COMMAND;
+	}
+	if (!MOTION_ID_VALID(c[k].id)) {
+	    rcs_print("USRMOT: ERROR: invalid motion id: %d\n", c[k].id);
+	    return EMCMOT_COMM_INVALID_MOTION_ID;
+	}
+    }
+    if (0 == emcmotCommandRing) {
+        rcs_print("USRMOT: ERROR: can't connect to shared memory\n");
+	return EMCMOT_COMM_ERROR_CONNECT;
+    }
+    if (usrmotReadEmcmotStatus(&s) != 0) {
+	return EMCMOT_COMM_SPLIT_READ_TIMEOUT;
+    }
+    failures = s.commandFailures;
+    end = etime() + EMCMOT_COMM_TIMEOUT;
+    head = emcmotCommandRing->head;
+    while (head + n - emcmotRingLoad(&emcmotCommandRing->tail) > EMCMOT_COMMAND_RING_SIZE) {
+	if (etime() >= end) {
+	    rcs_print("USRMOT: ERROR: command ring full\n");
+	    return EMCMOT_COMM_ERROR_TIMEOUT;
+	}
+	esleep(25e-6);
+    }
+    for (k = 0; k < n; k++) {
+	c[k].head = ++headCount;
+	c[k].tail = c[k].head;
+	c[k].commandNum = ++commandNum;
+	emcmotCommandRing->slot[(head + k) % EMCMOT_COMMAND_RING_SIZE] = c[k];
+    }
+    emcmotRingStore(&emcmotCommandRing->head, head + n);
+    while (etime() < end) {
+	if (( usrmotReadEmcmotStatus(&s) == 0 ) && ( s.commandNumEcho == commandNum )) {
+	    errorsSeen = emcmotRingLoad(&emcmotCommandRing->errors);
+	    if (s.commandFailures == failures) {
+		return EMCMOT_COMM_OK;
+	    } else {
+                rcs_print("USRMOT: ERROR: invalid command\n");
+		return EMCMOT_COMM_ERROR_COMMAND;
+	    }
+	}
+	esleep(25e-6);
+    }
+    rcs_print("USRMOT: ERROR: command timeout\n");
+    return EMCMOT_COMM_ERROR_TIMEOUT;
+}
+
+/* commands written that motion hadn't handled when it wrote s */
+int usrmotCommandsAhead(const emcmot_status_t * s)
+{
+    return commandNum - s->commandNumEcho;
+}
+
 /* copies status to s */
 int usrmotReadEmcmotStatus(emcmot_status_t * s)
 {
-    int split_read_count;
+    int split_read_count, joints;
+    unsigned int seq;
+    size_t size;
     
     /* check for shmem still around */
     if (0 == emcmotStatus) {
 	return EMCMOT_COMM_ERROR_CONNECT;
     }
+    /* the joints past numJoints are not copied, and keep whatever 's'
+       had in them */
+    size = sizeof(emcmot_status_t);
+    if (emcmotConfig != 0) {
+	joints = emcmotConfig->numJoints;
+	if (joints >= 0 && joints < EMCMOT_MAX_JOINTS) {
+	    size = offsetof(emcmot_status_t, joint_status)
+		+ joints * sizeof(emcmot_joint_status_t);
+	}
+    }
     split_read_count = 0;
     do {
+	seq = emcmotSeqReadBegin(&emcmotStatus->seq);
 	/* copy status struct from shmem to local memory */
-	memcpy(s, emcmotStatus, sizeof(emcmot_status_t));
-	/* got it, now check head-tail matche */
-	if (s->head == s->tail) {
-	    /* head and tail match, done */
+	memcpy(s, emcmotStatus, size);
+	/* got it, now check nothing was written meanwhile */
+	if (!emcmotSeqReadRetry(&emcmotStatus->seq, seq)) {
 	    return EMCMOT_COMM_OK;
 	}
-	/* inc counter and try again, max three times */
-    } while ( ++split_read_count < 3 );
+	/* writer sections are short, so just try again */
+    } while ( ++split_read_count < EMCMOT_STATUS_READ_RETRIES );
+    return EMCMOT_COMM_SPLIT_READ_TIMEOUT;
+}
+
+/* copies the per-cycle status subset to s */
+int usrmotReadEmcmotStatusHot(emcmot_status_hot_t * s)
+{
+    int split_read_count;
+    unsigned int seq;
+
+    /* check for shmem still around */
+    if (0 == emcmotStatusHot) {
+	return EMCMOT_COMM_ERROR_CONNECT;
+    }
+    split_read_count = 0;
+    do {
+	seq = emcmotSeqReadBegin(&emcmotStatusHot->seq);
+	memcpy(s, emcmotStatusHot, sizeof(emcmot_status_hot_t));
+	if (!emcmotSeqReadRetry(&emcmotStatusHot->seq, seq)) {
+	    return EMCMOT_COMM_OK;
+	}
+    } while ( ++split_read_count < EMCMOT_STATUS_READ_RETRIES );
     return EMCMOT_COMM_SPLIT_READ_TIMEOUT;
 }
 
@@ -211,6 +402,12 @@ int usrmotReadEmcmotError(char *e)
     return 0;
 }
 
+/* the number of motion errors dropped because the ring was full */
+unsigned int usrmotEmcmotErrorsDropped(void)
+{
+    return emcmotErrorDropped(emcmotError);
+}
+
 /*
  htostr()
 
@@ -673,8 +870,9 @@ int usrmotInit(const char *modname)
 	return -1;
     }
     /* got it */
-    emcmotCommand = &(emcmotStruct->command);
+    emcmotCommandRing = &(emcmotStruct->command_ring);
     emcmotStatus = &(emcmotStruct->status);
+    emcmotStatusHot = &(emcmotStruct->status_hot);
     emcmotDebug = &(emcmotStruct->debug);
     emcmotConfig = &(emcmotStruct->config);
     emcmotError = &(emcmotStruct->error);
@@ -692,8 +890,9 @@ int usrmotExit(void)
     }
 
     emcmotStruct = 0;
-    emcmotCommand = 0;
+    emcmotCommandRing = 0;
     emcmotStatus = 0;
+    emcmotStatusHot = 0;
     emcmotError = 0;
 /*! \todo Another #if 0 */
 #if 0
@@ -766,6 +965,98 @@ int usrmotLoadComp(int joint, const char *file, int type)
 }
 
 
+/* Loads a volumetric compensation grid.  The file has one line
+       nx ny nz  x0 y0 z0  dx dy dz
+   with the number of points along each axis, the position of the first
+   point and the spacing, followed by nx*ny*nz lines with the x, y and z
+   corrections at each point, x varying fastest and then y.  Lines
+   starting with # are ignored.  The whole file is read before the
+   motion controller is told about it.
+*/
+int usrmotLoadVolComp(const char *file)
+{
+    FILE *fp;
+    char buffer[LINELEN];
+    emcmot_command_t emcmotCommand;
+    float *corr;
+    int n[3], count = 0, total = 0, header = 0;
+    double origin[3], spacing[3];
+    int ret;
+
+    memset(&emcmotCommand, 0, sizeof(emcmotCommand));
+    emcmotCommand.command = EMCMOT_SET_VOLCOMP;
+    if (file == NULL) {
+	/* volcomp_n[0] == 0 turns it off */
+	return usrmotWriteEmcmotCommand(&emcmotCommand);
+    }
+    if (0 == emcmotStruct) {
+	fprintf(stderr, "can't load volumetric compensation, no shared memory\n");
+	return -1;
+    }
+    if (NULL == (fp = fopen(file, "r"))) {
+	fprintf(stderr, "can't open volumetric compensation file %s\n", file);
+	return -1;
+    }
+    corr = (float *) malloc(sizeof(emcmotStruct->volcomp.corr));
+    if (corr == NULL) {
+	fclose(fp);
+	return -1;
+    }
+    while (NULL != fgets(buffer, LINELEN, fp)) {
+	double c[3];
+	if (buffer[strspn(buffer, " \t")] == '#') {
+	    continue;
+	}
+	if (!header) {
+	    if (9 != sscanf(buffer, "%d %d %d %lf %lf %lf %lf %lf %lf",
+		    &n[0], &n[1], &n[2], &origin[0], &origin[1], &origin[2],
+		    &spacing[0], &spacing[1], &spacing[2])) {
+		continue;
+	    }
+	    if (n[0] < 2 || n[1] < 2 || n[2] < 2
+		    || (double) n[0] * n[1] * n[2] > EMCMOT_VOLCOMP_SIZE) {
+		fprintf(stderr, "%s: grid must have at least 2 and at most %d points\n",
+		    file, EMCMOT_VOLCOMP_SIZE);
+		break;
+	    }
+	    total = n[0] * n[1] * n[2];
+	    header = 1;
+	    continue;
+	}
+	if (3 != sscanf(buffer, "%lf %lf %lf", &c[0], &c[1], &c[2])) {
+	    continue;
+	}
+	if (count == total) {
+	    count++;
+	    break;
+	}
+	corr[3 * count] = c[0];
+	corr[3 * count + 1] = c[1];
+	corr[3 * count + 2] = c[2];
+	count++;
+    }
+    fclose(fp);
+    if (!header || count != total) {
+	fprintf(stderr, "%s: expected %d correction lines\n", file, total);
+	free(corr);
+	return -1;
+    }
+
+    /* the points may only be written while the controller ignores them */
+    if (0 != (ret = usrmotWriteEmcmotCommand(&emcmotCommand))) {
+	free(corr);
+	return ret;
+    }
+    memcpy(emcmotStruct->volcomp.corr, corr, 3 * sizeof(float) * total);
+    free(corr);
+    for (int k = 0; k < 3; k++) {
+	emcmotCommand.volcomp_n[k] = n[k];
+	emcmotCommand.volcomp_origin[k] = origin[k];
+	emcmotCommand.volcomp_spacing[k] = spacing[k];
+    }
+    return usrmotWriteEmcmotCommand(&emcmotCommand);
+}
+
 int usrmotPrintComp(int joint)
 {
 /* FIXME-AJ: comp isn't in shmem atm
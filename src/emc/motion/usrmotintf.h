@@ -16,6 +16,7 @@
 #define USRMOTINTF_H
 
 struct emcmot_status_t;
+struct emcmot_status_hot_t;
 struct emcmot_command_t;
 struct emcmot_config_t;
 struct emcmot_debug_t;
@@ -30,9 +31,17 @@ extern "C" {
     extern int usrmotIniLoad(const char *file);
 
 /* usrmotReadEmcmotStatus() gets the status info out of
-   the emcmot controller and puts it in arg */
+   the emcmot controller and puts it in arg.  The copy is consistent:
+   it is taken under the status seqlock and retried while motion is
+   updating the block.  Returns EMCMOT_COMM_SPLIT_READ_TIMEOUT if no
+   clean copy could be made. */
     extern int usrmotReadEmcmotStatus(emcmot_status_t * s);
 
+/* usrmotReadEmcmotStatusHot() gets just the per-cycle subset of the
+   status (positions, velocities, flags) with the same guarantees.  Use
+   it for fast polling instead of copying the whole status block. */
+    extern int usrmotReadEmcmotStatusHot(emcmot_status_hot_t * s);
+
 /* usrmotReadEmcmotConfig() gets the config info out of
    the emcmot controller and puts it in arg */
     extern int usrmotReadEmcmotConfig(emcmot_config_t * s);
@@ -45,6 +54,10 @@ extern "C" {
    the emcmot controller and puts it in arg */
     extern int usrmotReadEmcmotError(char *e);
 
+/* usrmotEmcmotErrorsDropped() is the number of errors motion couldn't
+   queue since it started */
+    extern unsigned int usrmotEmcmotErrorsDropped(void);
+
 /* usrmotPrintEmcmotStatus() prints the status in s, using which
    arg to select sub-prints */
     extern void usrmotPrintEmcmotStatus(emcmot_status_t *s, int which);
@@ -70,6 +83,21 @@ extern "C" {
    Return values are as per the #defines above */
     extern int usrmotWriteEmcmotCommand(emcmot_command_t * c);
 
+/* usrmotWriteEmcmotCommands() writes n queued commands (moves and the
+   like, which aren't waited for) to the emcmot process in one go, at
+   most EMCMOT_COMMAND_RING_SIZE.  Return values as above */
+    extern int usrmotWriteEmcmotCommands(emcmot_command_t * c, int n);
+
+/* usrmotWriteEmcmotSettings() writes n commands that are waited for
+   (settings and the like) in one go, at most EMCMOT_COMMAND_RING_SIZE,
+   and waits for motion to have handled them all.  Fails if any of them
+   did.  Return values as above */
+    extern int usrmotWriteEmcmotSettings(emcmot_command_t * c, int n);
+
+/* usrmotCommandsAhead() is the number of commands written that motion
+   had not handled yet when it wrote the status s */
+    extern int usrmotCommandsAhead(const emcmot_status_t * s);
+
 /* usrmotInit() initializes communication with the emcmot process */
     extern int usrmotInit(const char *name);
 
@@ -79,6 +107,10 @@ extern "C" {
 /* usrmotLoadComp() loads the compensation data in file into the joint */
     extern int usrmotLoadComp(int joint, const char *file, int type);
 
+/* usrmotLoadVolComp() loads a volumetric compensation grid from file, or
+   turns the compensation off if file is NULL */
+    extern int usrmotLoadVolComp(const char *file);
+
 /* usrmotPrintComp() prints the joint compensation data for the specified joint */
     extern int usrmotPrintComp(int joint);
 
@@ -215,6 +215,12 @@ extern void CANON_UPDATE_END_POINT(double x, double y, double z,
 /* Called from emctask to update the canon position during skipping through
    programs started with start-from-line > 0. */
 
+extern bool CANON_SAVE_STATE(CanonConfig_t *state);
+extern void CANON_RESTORE_STATE(const CanonConfig_t *state);
+/* Called from emctask to keep the canon state with the interpreter
+   checkpoints that start-from-line resumes at.  Saving fails while moves
+   are held back for the naive cam detector. */
+
 extern void USE_LENGTH_UNITS(CANON_UNITS u);
 
 /* Use the specified units for length. Conceptually, the units must
@@ -945,6 +951,18 @@ extern FILE *_outfile;		/* where to print, set in main */
 extern CANON_TOOL_TABLE _tools[];	/* in canon.cc */
 extern int _pockets_max;		/* in canon.cc */
 extern char _parameter_file_name[];	/* in canon.cc */
+
+/* what the moves of a program add up to, kept by saicanon.cc for rs274 -j */
+struct CANON_SUMMARY {
+    int moves;
+    double feed_time;		/* seconds at the programmed feed */
+    double traverse_time;	/* seconds at the traverse rate, if set */
+    double traverse_length;
+    double dwell_time;
+    int have_extents;
+    double min[3], max[3];	/* x, y, z reached by the tool */
+};
+extern CANON_SUMMARY _summary;		/* in canon.cc */
 #define PARAMETER_FILE_NAME_LENGTH 100
 
 #define USER_DEFINED_FUNCTION_NUM 100
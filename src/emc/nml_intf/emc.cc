@@ -29,9 +29,12 @@
 #include "emcpos.h"
 #include "cms.hh"
 
+#include <algorithm>
+
 // Forward Function Prototypes
 void EmcPose_update(CMS * cms, EmcPose * x);
 void CANON_TOOL_TABLE_update(CMS * cms, CANON_TOOL_TABLE * x);
+void CANON_TOOL_TABLE_update_used(CMS * cms, int &len, CANON_TOOL_TABLE * x);
 void PmCartesian_update(CMS * cms, PmCartesian * x);
 void initialize_PmCartesian(PmCartesian * x);
 void CANON_VECTOR_update(CMS * cms, CANON_VECTOR * x);
@@ -44,728 +47,230 @@ void initialize_CANON_POSITION(CANON_POSITION * x);
 *	NML/CMS Format function : emcFormat
 *	Automatically generated by NML CodeGen Java Applet.
 *	on Sat Oct 11 13:45:16 UTC 2003
-*/
+*
+*	The message types are kept in one table, sorted by type on first
+*	use, which also gives the name and size of each type.  Looking up a
+*	type is a binary search instead of a walk down a sparse switch.
+*/
+template < class T > static void emc_update(void *buffer, CMS * cms)
+{
+    ((T *) buffer)->update(cms);
+}
+
+struct EMC_MESSAGE_INFO {
+    NMLTYPE type;
+    const char *name;
+    size_t size;
+    void (*update) (void *buffer, CMS * cms);
+};
+
+#define EMC_MESSAGE(T) { T##_TYPE, #T, sizeof(T), emc_update<T> }
+
+static EMC_MESSAGE_INFO emc_messages[] = {
+    EMC_MESSAGE(EMC_ABORT),
+    /* not formatted: emcFormat() has never handled it */
+    { EMC_EXEC_PLUGIN_CALL_TYPE, "EMC_EXEC_PLUGIN_CALL", sizeof(EMC_EXEC_PLUGIN_CALL), NULL },
+    EMC_MESSAGE(EMC_AUX_ESTOP_RESET),
+    EMC_MESSAGE(EMC_AUX_ESTOP_OFF),
+    EMC_MESSAGE(EMC_AUX_ESTOP_ON),
+    EMC_MESSAGE(EMC_AUX_STAT),
+    EMC_MESSAGE(EMC_JOINT_ABORT),
+    EMC_MESSAGE(EMC_JOINT_ACTIVATE),
+    EMC_MESSAGE(EMC_JOINT_DEACTIVATE),
+    EMC_MESSAGE(EMC_JOINT_DISABLE),
+    EMC_MESSAGE(EMC_JOINT_ENABLE),
+    EMC_MESSAGE(EMC_JOINT_HALT),
+    EMC_MESSAGE(EMC_JOINT_HOME),
+    EMC_MESSAGE(EMC_JOINT_UNHOME),
+    EMC_MESSAGE(EMC_JOG_CONT),
+    EMC_MESSAGE(EMC_JOG_INCR),
+    EMC_MESSAGE(EMC_JOG_ABS),
+    EMC_MESSAGE(EMC_JOG_STOP),
+    EMC_MESSAGE(EMC_JOINT_INIT),
+    EMC_MESSAGE(EMC_JOINT_LOAD_COMP),
+    EMC_MESSAGE(EMC_JOINT_OVERRIDE_LIMITS),
+    { EMC_JOINT_SET_JOINT_TYPE, "EMC_JOINT_SET_AXIS", sizeof(EMC_JOINT_SET_JOINT), emc_update<EMC_JOINT_SET_JOINT> },
+    EMC_MESSAGE(EMC_JOINT_SET_FERROR),
+    EMC_MESSAGE(EMC_JOINT_SET_BACKLASH),
+    EMC_MESSAGE(EMC_JOINT_SET_HOMING_PARAMS),
+    EMC_MESSAGE(EMC_JOINT_SET_MAX_POSITION_LIMIT),
+    EMC_MESSAGE(EMC_JOINT_SET_MAX_VELOCITY),
+    EMC_MESSAGE(EMC_JOINT_SET_MIN_FERROR),
+    EMC_MESSAGE(EMC_JOINT_SET_MIN_POSITION_LIMIT),
+    EMC_MESSAGE(EMC_JOINT_SET_UNITS),
+    EMC_MESSAGE(EMC_JOINT_STAT),
+    EMC_MESSAGE(EMC_COOLANT_FLOOD_OFF),
+    EMC_MESSAGE(EMC_COOLANT_FLOOD_ON),
+    EMC_MESSAGE(EMC_COOLANT_MIST_OFF),
+    EMC_MESSAGE(EMC_COOLANT_MIST_ON),
+    EMC_MESSAGE(EMC_COOLANT_STAT),
+    EMC_MESSAGE(EMC_HALT),
+    EMC_MESSAGE(EMC_INIT),
+    EMC_MESSAGE(EMC_IO_ABORT),
+    EMC_MESSAGE(EMC_IO_HALT),
+    EMC_MESSAGE(EMC_IO_INIT),
+    EMC_MESSAGE(EMC_IO_SET_CYCLE_TIME),
+    EMC_MESSAGE(EMC_IO_STAT),
+    EMC_MESSAGE(EMC_LUBE_OFF),
+    EMC_MESSAGE(EMC_LUBE_ON),
+    EMC_MESSAGE(EMC_LUBE_STAT),
+    EMC_MESSAGE(EMC_MOTION_ABORT),
+    EMC_MESSAGE(EMC_MOTION_HALT),
+    EMC_MESSAGE(EMC_MOTION_INIT),
+    EMC_MESSAGE(EMC_MOTION_SET_AOUT),
+    EMC_MESSAGE(EMC_MOTION_SET_DOUT),
+    EMC_MESSAGE(EMC_MOTION_ADAPTIVE),
+    EMC_MESSAGE(EMC_MOTION_STAT),
+    EMC_MESSAGE(EMC_NULL),
+    EMC_MESSAGE(EMC_OPERATOR_DISPLAY),
+    EMC_MESSAGE(EMC_OPERATOR_ERROR),
+    EMC_MESSAGE(EMC_OPERATOR_TEXT),
+    EMC_MESSAGE(EMC_SYSTEM_CMD),
+    EMC_MESSAGE(EMC_SET_DEBUG),
+    EMC_MESSAGE(EMC_SPINDLE_BRAKE_ENGAGE),
+    EMC_MESSAGE(EMC_SPINDLE_BRAKE_RELEASE),
+    EMC_MESSAGE(EMC_SPINDLE_CONSTANT),
+    EMC_MESSAGE(EMC_SPINDLE_DECREASE),
+    EMC_MESSAGE(EMC_SPINDLE_INCREASE),
+    EMC_MESSAGE(EMC_SPINDLE_OFF),
+    EMC_MESSAGE(EMC_SPINDLE_ON),
+    EMC_MESSAGE(EMC_SPINDLE_SPEED),
+    EMC_MESSAGE(EMC_SPINDLE_ORIENT),
+    EMC_MESSAGE(EMC_SPINDLE_WAIT_ORIENT_COMPLETE),
+    EMC_MESSAGE(EMC_SPINDLE_STAT),
+    EMC_MESSAGE(EMC_STAT),
+    EMC_MESSAGE(EMC_TASK_ABORT),
+    EMC_MESSAGE(EMC_TASK_HALT),
+    EMC_MESSAGE(EMC_TASK_INIT),
+    EMC_MESSAGE(EMC_TASK_PLAN_CLOSE),
+    EMC_MESSAGE(EMC_TASK_PLAN_END),
+    EMC_MESSAGE(EMC_TASK_PLAN_EXECUTE),
+    EMC_MESSAGE(EMC_TASK_PLAN_EXECUTE_BATCH),
+    EMC_MESSAGE(EMC_TASK_PLAN_INIT),
+    EMC_MESSAGE(EMC_TASK_PLAN_OPEN),
+    EMC_MESSAGE(EMC_TASK_PLAN_PAUSE),
+    EMC_MESSAGE(EMC_TASK_PLAN_READ),
+    EMC_MESSAGE(EMC_TASK_PLAN_RESUME),
+    EMC_MESSAGE(EMC_TASK_PLAN_RUN),
+    EMC_MESSAGE(EMC_TASK_PLAN_STEP),
+    EMC_MESSAGE(EMC_TASK_PLAN_SYNCH),
+    EMC_MESSAGE(EMC_TASK_PLAN_SET_OPTIONAL_STOP),
+    EMC_MESSAGE(EMC_TASK_PLAN_SET_BLOCK_DELETE),
+    EMC_MESSAGE(EMC_TASK_PLAN_OPTIONAL_STOP),
+    EMC_MESSAGE(EMC_TASK_SET_MODE),
+    EMC_MESSAGE(EMC_TASK_SET_STATE),
+    EMC_MESSAGE(EMC_TASK_STAT),
+    EMC_MESSAGE(EMC_TOOL_ABORT),
+    EMC_MESSAGE(EMC_TOOL_HALT),
+    EMC_MESSAGE(EMC_TOOL_INIT),
+    EMC_MESSAGE(EMC_TOOL_LOAD),
+    EMC_MESSAGE(EMC_TOOL_LOAD_TOOL_TABLE),
+    EMC_MESSAGE(EMC_TOOL_PREPARE),
+    EMC_MESSAGE(EMC_TOOL_SET_OFFSET),
+    EMC_MESSAGE(EMC_TOOL_SET_NUMBER),
+    EMC_MESSAGE(EMC_TOOL_START_CHANGE),
+    EMC_MESSAGE(EMC_TOOL_STAT),
+    EMC_MESSAGE(EMC_TOOL_TABLE_STAT),
+    EMC_MESSAGE(EMC_TOOL_UNLOAD),
+    EMC_MESSAGE(EMC_TRAJ_ABORT),
+    EMC_MESSAGE(EMC_TRAJ_CIRCULAR_MOVE),
+    EMC_MESSAGE(EMC_TRAJ_CLEAR_PROBE_TRIPPED_FLAG),
+    EMC_MESSAGE(EMC_TRAJ_DELAY),
+    EMC_MESSAGE(EMC_TRAJ_DISABLE),
+    EMC_MESSAGE(EMC_TRAJ_ENABLE),
+    EMC_MESSAGE(EMC_TRAJ_HALT),
+    EMC_MESSAGE(EMC_TRAJ_INIT),
+    EMC_MESSAGE(EMC_TRAJ_LINEAR_MOVE),
+    EMC_MESSAGE(EMC_TRAJ_PAUSE),
+    EMC_MESSAGE(EMC_TRAJ_PROBE),
+    EMC_MESSAGE(EMC_TRAJ_PROBE_SEQUENCE),
+    EMC_MESSAGE(EMC_AUX_INPUT_WAIT),
+    EMC_MESSAGE(EMC_TRAJ_RIGID_TAP),
+    EMC_MESSAGE(EMC_TRAJ_RESUME),
+    EMC_MESSAGE(EMC_TRAJ_SET_ACCELERATION),
+    EMC_MESSAGE(EMC_TRAJ_SET_AXES),
+    EMC_MESSAGE(EMC_TRAJ_SET_CYCLE_TIME),
+    EMC_MESSAGE(EMC_TRAJ_SET_HOME),
+    EMC_MESSAGE(EMC_TRAJ_SET_MAX_ACCELERATION),
+    EMC_MESSAGE(EMC_TRAJ_SET_MAX_VELOCITY),
+    EMC_MESSAGE(EMC_TRAJ_SET_MODE),
+    EMC_MESSAGE(EMC_TRAJ_SET_MOTION_ID),
+    EMC_MESSAGE(EMC_TRAJ_SET_OFFSET),
+    EMC_MESSAGE(EMC_TRAJ_SET_G5X),
+    EMC_MESSAGE(EMC_TRAJ_SET_G92),
+    EMC_MESSAGE(EMC_TRAJ_SET_ROTATION),
+    EMC_MESSAGE(EMC_TRAJ_SET_SCALE),
+    EMC_MESSAGE(EMC_TRAJ_SET_RAPID_SCALE),
+    EMC_MESSAGE(EMC_TRAJ_SET_SPINDLE_SCALE),
+    EMC_MESSAGE(EMC_TRAJ_SET_FO_ENABLE),
+    EMC_MESSAGE(EMC_TRAJ_SET_SO_ENABLE),
+    EMC_MESSAGE(EMC_TRAJ_SET_FH_ENABLE),
+    EMC_MESSAGE(EMC_TRAJ_SET_TELEOP_ENABLE),
+    EMC_MESSAGE(EMC_TRAJ_SET_TERM_COND),
+    EMC_MESSAGE(EMC_TRAJ_SET_SPINDLESYNC),
+    EMC_MESSAGE(EMC_TRAJ_SET_UNITS),
+    EMC_MESSAGE(EMC_TRAJ_SET_VELOCITY),
+    EMC_MESSAGE(EMC_TRAJ_STAT),
+    EMC_MESSAGE(EMC_TRAJ_STEP),
+};
+
+#undef EMC_MESSAGE
+
+static const size_t emc_message_count =
+    sizeof(emc_messages) / sizeof(emc_messages[0]);
+
+static bool emc_message_less(const EMC_MESSAGE_INFO & a,
+    const EMC_MESSAGE_INFO & b)
+{
+    return a.type < b.type;
+}
+
+static const EMC_MESSAGE_INFO *emc_message_info(NMLTYPE type)
+{
+    static bool sorted = (std::sort(emc_messages,
+	    emc_messages + emc_message_count, emc_message_less), true);
+    (void) sorted;
+
+    EMC_MESSAGE_INFO key;
+    key.type = type;
+    const EMC_MESSAGE_INFO *end = emc_messages + emc_message_count;
+    const EMC_MESSAGE_INFO *info =
+	std::lower_bound((const EMC_MESSAGE_INFO *) emc_messages, end, key,
+	emc_message_less);
+    if (info == end || info->type != type) {
+	return NULL;
+    }
+    return info;
+}
+
 int emcFormat(NMLTYPE type, void *buffer, CMS * cms)
 {
-    switch (type) {
-    case EMC_ABORT_TYPE:
-	((EMC_ABORT *) buffer)->update(cms);
-	break;
-    case EMC_AUX_ESTOP_RESET_TYPE:
-	((EMC_AUX_ESTOP_RESET *) buffer)->update(cms);
-	break;
-    case EMC_AUX_ESTOP_OFF_TYPE:
-	((EMC_AUX_ESTOP_OFF *) buffer)->update(cms);
-	break;
-    case EMC_AUX_ESTOP_ON_TYPE:
-	((EMC_AUX_ESTOP_ON *) buffer)->update(cms);
-	break;
-    case EMC_AUX_STAT_TYPE:
-	((EMC_AUX_STAT *) buffer)->update(cms);
-	break;
-    case EMC_JOINT_ABORT_TYPE:
-	((EMC_JOINT_ABORT *) buffer)->update(cms);
-	break;
-    case EMC_JOINT_ACTIVATE_TYPE:
-	((EMC_JOINT_ACTIVATE *) buffer)->update(cms);
-	break;
-    case EMC_JOINT_DEACTIVATE_TYPE:
-	((EMC_JOINT_DEACTIVATE *) buffer)->update(cms);
-	break;
-    case EMC_JOINT_DISABLE_TYPE:
-	((EMC_JOINT_DISABLE *) buffer)->update(cms);
-	break;
-    case EMC_JOINT_ENABLE_TYPE:
-	((EMC_JOINT_ENABLE *) buffer)->update(cms);
-	break;
-    case EMC_JOINT_HALT_TYPE:
-	((EMC_JOINT_HALT *) buffer)->update(cms);
-	break;
-    case EMC_JOINT_HOME_TYPE:
-	((EMC_JOINT_HOME *) buffer)->update(cms);
-	break;
-    case EMC_JOINT_UNHOME_TYPE:
-	((EMC_JOINT_UNHOME *) buffer)->update(cms);
-	break;
-    case EMC_JOINT_INIT_TYPE:
-	((EMC_JOINT_INIT *) buffer)->update(cms);
-	break;
-    case EMC_JOG_CONT_TYPE:
-	((EMC_JOG_CONT *) buffer)->update(cms);
-	break;
-    case EMC_JOG_INCR_TYPE:
-	((EMC_JOG_INCR *) buffer)->update(cms);
-	break;
-    case EMC_JOG_ABS_TYPE:
-	((EMC_JOG_ABS *) buffer)->update(cms);
-	break;
-    case EMC_JOG_STOP_TYPE:
-	((EMC_JOG_STOP *) buffer)->update(cms);
-	break;
-    case EMC_JOINT_LOAD_COMP_TYPE:
-	((EMC_JOINT_LOAD_COMP *) buffer)->update(cms);
-	break;
-    case EMC_JOINT_OVERRIDE_LIMITS_TYPE:
-	((EMC_JOINT_OVERRIDE_LIMITS *) buffer)->update(cms);
-	break;
-    case EMC_JOINT_SET_JOINT_TYPE:
-	((EMC_JOINT_SET_JOINT *) buffer)->update(cms);
-	break;
-    case EMC_JOINT_SET_FERROR_TYPE:
-	((EMC_JOINT_SET_FERROR *) buffer)->update(cms);
-	break;
-    case EMC_JOINT_SET_BACKLASH_TYPE:
-	((EMC_JOINT_SET_BACKLASH *) buffer)->update(cms);
-	break;
-    case EMC_JOINT_SET_HOMING_PARAMS_TYPE:
-	((EMC_JOINT_SET_HOMING_PARAMS *) buffer)->update(cms);
-	break;
-    case EMC_JOINT_SET_MAX_POSITION_LIMIT_TYPE:
-	((EMC_JOINT_SET_MAX_POSITION_LIMIT *) buffer)->update(cms);
-	break;
-    case EMC_JOINT_SET_MAX_VELOCITY_TYPE:
-	((EMC_JOINT_SET_MAX_VELOCITY *) buffer)->update(cms);
-	break;
-    case EMC_JOINT_SET_MIN_FERROR_TYPE:
-	((EMC_JOINT_SET_MIN_FERROR *) buffer)->update(cms);
-	break;
-    case EMC_JOINT_SET_MIN_POSITION_LIMIT_TYPE:
-	((EMC_JOINT_SET_MIN_POSITION_LIMIT *) buffer)->update(cms);
-	break;
-    case EMC_JOINT_SET_UNITS_TYPE:
-	((EMC_JOINT_SET_UNITS *) buffer)->update(cms);
-	break;
-    case EMC_JOINT_STAT_TYPE:
-	((EMC_JOINT_STAT *) buffer)->update(cms);
-	break;
-    case EMC_COOLANT_FLOOD_OFF_TYPE:
-	((EMC_COOLANT_FLOOD_OFF *) buffer)->update(cms);
-	break;
-    case EMC_COOLANT_FLOOD_ON_TYPE:
-	((EMC_COOLANT_FLOOD_ON *) buffer)->update(cms);
-	break;
-    case EMC_COOLANT_MIST_OFF_TYPE:
-	((EMC_COOLANT_MIST_OFF *) buffer)->update(cms);
-	break;
-    case EMC_COOLANT_MIST_ON_TYPE:
-	((EMC_COOLANT_MIST_ON *) buffer)->update(cms);
-	break;
-    case EMC_COOLANT_STAT_TYPE:
-	((EMC_COOLANT_STAT *) buffer)->update(cms);
-	break;
-    case EMC_HALT_TYPE:
-	((EMC_HALT *) buffer)->update(cms);
-	break;
-    case EMC_INIT_TYPE:
-	((EMC_INIT *) buffer)->update(cms);
-	break;
-    case EMC_IO_ABORT_TYPE:
-	((EMC_IO_ABORT *) buffer)->update(cms);
-	break;
-    case EMC_IO_HALT_TYPE:
-	((EMC_IO_HALT *) buffer)->update(cms);
-	break;
-    case EMC_IO_INIT_TYPE:
-	((EMC_IO_INIT *) buffer)->update(cms);
-	break;
-    case EMC_IO_SET_CYCLE_TIME_TYPE:
-	((EMC_IO_SET_CYCLE_TIME *) buffer)->update(cms);
-	break;
-    case EMC_IO_STAT_TYPE:
-	((EMC_IO_STAT *) buffer)->update(cms);
-	break;
-    case EMC_LUBE_OFF_TYPE:
-	((EMC_LUBE_OFF *) buffer)->update(cms);
-	break;
-    case EMC_LUBE_ON_TYPE:
-	((EMC_LUBE_ON *) buffer)->update(cms);
-	break;
-    case EMC_LUBE_STAT_TYPE:
-	((EMC_LUBE_STAT *) buffer)->update(cms);
-	break;
-    case EMC_MOTION_ABORT_TYPE:
-	((EMC_MOTION_ABORT *) buffer)->update(cms);
-	break;
-    case EMC_MOTION_HALT_TYPE:
-	((EMC_MOTION_HALT *) buffer)->update(cms);
-	break;
-    case EMC_MOTION_INIT_TYPE:
-	((EMC_MOTION_INIT *) buffer)->update(cms);
-	break;
-    case EMC_MOTION_SET_AOUT_TYPE:
-	((EMC_MOTION_SET_AOUT *) buffer)->update(cms);
-	break;
-    case EMC_MOTION_SET_DOUT_TYPE:
-	((EMC_MOTION_SET_DOUT *) buffer)->update(cms);
-	break;
-    case EMC_MOTION_ADAPTIVE_TYPE:
-	((EMC_MOTION_ADAPTIVE *) buffer)->update(cms);
-	break;
-    case EMC_MOTION_STAT_TYPE:
-	((EMC_MOTION_STAT *) buffer)->update(cms);
-	break;
-    case EMC_NULL_TYPE:
-	((EMC_NULL *) buffer)->update(cms);
-	break;
-    case EMC_OPERATOR_DISPLAY_TYPE:
-	((EMC_OPERATOR_DISPLAY *) buffer)->update(cms);
-	break;
-    case EMC_OPERATOR_ERROR_TYPE:
-	((EMC_OPERATOR_ERROR *) buffer)->update(cms);
-	break;
-    case EMC_OPERATOR_TEXT_TYPE:
-	((EMC_OPERATOR_TEXT *) buffer)->update(cms);
-	break;
-    case EMC_SYSTEM_CMD_TYPE:
-	((EMC_SYSTEM_CMD *) buffer)->update(cms);
-	break;
-    case EMC_SET_DEBUG_TYPE:
-	((EMC_SET_DEBUG *) buffer)->update(cms);
-	break;
-    case EMC_SPINDLE_BRAKE_ENGAGE_TYPE:
-	((EMC_SPINDLE_BRAKE_ENGAGE *) buffer)->update(cms);
-	break;
-    case EMC_SPINDLE_BRAKE_RELEASE_TYPE:
-	((EMC_SPINDLE_BRAKE_RELEASE *) buffer)->update(cms);
-	break;
-    case EMC_SPINDLE_CONSTANT_TYPE:
-	((EMC_SPINDLE_CONSTANT *) buffer)->update(cms);
-	break;
-    case EMC_SPINDLE_DECREASE_TYPE:
-	((EMC_SPINDLE_DECREASE *) buffer)->update(cms);
-	break;
-    case EMC_SPINDLE_INCREASE_TYPE:
-	((EMC_SPINDLE_INCREASE *) buffer)->update(cms);
-	break;
-    case EMC_SPINDLE_OFF_TYPE:
-	((EMC_SPINDLE_OFF *) buffer)->update(cms);
-	break;
-    case EMC_SPINDLE_ON_TYPE:
-	((EMC_SPINDLE_ON *) buffer)->update(cms);
-	break;
-    case EMC_SPINDLE_SPEED_TYPE:
-	((EMC_SPINDLE_SPEED *) buffer)->update(cms);
-	break;
-    case EMC_SPINDLE_ORIENT_TYPE:
-	((EMC_SPINDLE_ORIENT *) buffer)->update(cms);
-	break;
-    case EMC_SPINDLE_WAIT_ORIENT_COMPLETE_TYPE:
-	((EMC_SPINDLE_WAIT_ORIENT_COMPLETE *) buffer)->update(cms);
-	break;
-    case EMC_SPINDLE_STAT_TYPE:
-	((EMC_SPINDLE_STAT *) buffer)->update(cms);
-	break;
-    case EMC_STAT_TYPE:
-	((EMC_STAT *) buffer)->update(cms);
-	break;
-    case EMC_TASK_ABORT_TYPE:
-	((EMC_TASK_ABORT *) buffer)->update(cms);
-	break;
-    case EMC_TASK_HALT_TYPE:
-	((EMC_TASK_HALT *) buffer)->update(cms);
-	break;
-    case EMC_TASK_INIT_TYPE:
-	((EMC_TASK_INIT *) buffer)->update(cms);
-	break;
-    case EMC_TASK_PLAN_CLOSE_TYPE:
-	((EMC_TASK_PLAN_CLOSE *) buffer)->update(cms);
-	break;
-    case EMC_TASK_PLAN_END_TYPE:
-	((EMC_TASK_PLAN_END *) buffer)->update(cms);
-	break;
-    case EMC_TASK_PLAN_EXECUTE_TYPE:
-	((EMC_TASK_PLAN_EXECUTE *) buffer)->update(cms);
-	break;
-    case EMC_TASK_PLAN_INIT_TYPE:
-	((EMC_TASK_PLAN_INIT *) buffer)->update(cms);
-	break;
-    case EMC_TASK_PLAN_OPEN_TYPE:
-	((EMC_TASK_PLAN_OPEN *) buffer)->update(cms);
-	break;
-    case EMC_TASK_PLAN_PAUSE_TYPE:
-	((EMC_TASK_PLAN_PAUSE *) buffer)->update(cms);
-	break;
-    case EMC_TASK_PLAN_READ_TYPE:
-	((EMC_TASK_PLAN_READ *) buffer)->update(cms);
-	break;
-    case EMC_TASK_PLAN_RESUME_TYPE:
-	((EMC_TASK_PLAN_RESUME *) buffer)->update(cms);
-	break;
-    case EMC_TASK_PLAN_RUN_TYPE:
-	((EMC_TASK_PLAN_RUN *) buffer)->update(cms);
-	break;
-    case EMC_TASK_PLAN_STEP_TYPE:
-	((EMC_TASK_PLAN_STEP *) buffer)->update(cms);
-	break;
-    case EMC_TASK_PLAN_SYNCH_TYPE:
-	((EMC_TASK_PLAN_SYNCH *) buffer)->update(cms);
-	break;
-    case EMC_TASK_PLAN_SET_OPTIONAL_STOP_TYPE:
-	((EMC_TASK_PLAN_SET_OPTIONAL_STOP *) buffer)->update(cms);
-	break;
-    case EMC_TASK_PLAN_SET_BLOCK_DELETE_TYPE:
-	((EMC_TASK_PLAN_SET_BLOCK_DELETE *) buffer)->update(cms);
-	break;
-    case EMC_TASK_PLAN_OPTIONAL_STOP_TYPE:
-	((EMC_TASK_PLAN_OPTIONAL_STOP *) buffer)->update(cms);
-	break;
-    case EMC_TASK_SET_MODE_TYPE:
-	((EMC_TASK_SET_MODE *) buffer)->update(cms);
-	break;
-    case EMC_TASK_SET_STATE_TYPE:
-	((EMC_TASK_SET_STATE *) buffer)->update(cms);
-	break;
-    case EMC_TASK_STAT_TYPE:
-	((EMC_TASK_STAT *) buffer)->update(cms);
-	break;
-    case EMC_TOOL_ABORT_TYPE:
-	((EMC_TOOL_ABORT *) buffer)->update(cms);
-	break;
-    case EMC_TOOL_HALT_TYPE:
-	((EMC_TOOL_HALT *) buffer)->update(cms);
-	break;
-    case EMC_TOOL_INIT_TYPE:
-	((EMC_TOOL_INIT *) buffer)->update(cms);
-	break;
-    case EMC_TOOL_LOAD_TYPE:
-	((EMC_TOOL_LOAD *) buffer)->update(cms);
-	break;
-    case EMC_TOOL_LOAD_TOOL_TABLE_TYPE:
-	((EMC_TOOL_LOAD_TOOL_TABLE *) buffer)->update(cms);
-	break;
-    case EMC_TOOL_PREPARE_TYPE:
-	((EMC_TOOL_PREPARE *) buffer)->update(cms);
-	break;
-    case EMC_TOOL_SET_OFFSET_TYPE:
-	((EMC_TOOL_SET_OFFSET *) buffer)->update(cms);
-	break;
-    case EMC_TOOL_SET_NUMBER_TYPE:
-	((EMC_TOOL_SET_NUMBER *) buffer)->update(cms);
-	break;
-    case EMC_TOOL_START_CHANGE_TYPE:
-	((EMC_TOOL_START_CHANGE *) buffer)->update(cms);
-	break;
-    case EMC_TOOL_STAT_TYPE:
-	((EMC_TOOL_STAT *) buffer)->update(cms);
-	break;
-    case EMC_TOOL_UNLOAD_TYPE:
-	((EMC_TOOL_UNLOAD *) buffer)->update(cms);
-	break;
-    case EMC_TRAJ_ABORT_TYPE:
-	((EMC_TRAJ_ABORT *) buffer)->update(cms);
-	break;
-    case EMC_TRAJ_CLEAR_PROBE_TRIPPED_FLAG_TYPE:
-	((EMC_TRAJ_CLEAR_PROBE_TRIPPED_FLAG *) buffer)->update(cms);
-	break;
-    case EMC_TRAJ_DELAY_TYPE:
-	((EMC_TRAJ_DELAY *) buffer)->update(cms);
-	break;
-    case EMC_TRAJ_DISABLE_TYPE:
-	((EMC_TRAJ_DISABLE *) buffer)->update(cms);
-	break;
-    case EMC_TRAJ_ENABLE_TYPE:
-	((EMC_TRAJ_ENABLE *) buffer)->update(cms);
-	break;
-    case EMC_TRAJ_HALT_TYPE:
-	((EMC_TRAJ_HALT *) buffer)->update(cms);
-	break;
-    case EMC_TRAJ_INIT_TYPE:
-	((EMC_TRAJ_INIT *) buffer)->update(cms);
-	break;
-    case EMC_TRAJ_LINEAR_MOVE_TYPE:
-	((EMC_TRAJ_LINEAR_MOVE *) buffer)->update(cms);
-	break;
-    case EMC_TRAJ_CIRCULAR_MOVE_TYPE:
-	((EMC_TRAJ_CIRCULAR_MOVE *) buffer)->update(cms);
-	break;
-    case EMC_TRAJ_RIGID_TAP_TYPE:
-	((EMC_TRAJ_RIGID_TAP *) buffer)->update(cms);
-        break;
-    case EMC_TRAJ_PAUSE_TYPE:
-	((EMC_TRAJ_PAUSE *) buffer)->update(cms);
-	break;
-    case EMC_TRAJ_PROBE_TYPE:
-	((EMC_TRAJ_PROBE *) buffer)->update(cms);
-	break;
-    case EMC_AUX_INPUT_WAIT_TYPE:
-	((EMC_AUX_INPUT_WAIT *) buffer)->update(cms);
-	break;
-    case EMC_TRAJ_RESUME_TYPE:
-	((EMC_TRAJ_RESUME *) buffer)->update(cms);
-	break;
-    case EMC_TRAJ_SET_ACCELERATION_TYPE:
-	((EMC_TRAJ_SET_ACCELERATION *) buffer)->update(cms);
-	break;
-    case EMC_TRAJ_SET_AXES_TYPE:
-	((EMC_TRAJ_SET_AXES *) buffer)->update(cms);
-	break;
-    case EMC_TRAJ_SET_CYCLE_TIME_TYPE:
-	((EMC_TRAJ_SET_CYCLE_TIME *) buffer)->update(cms);
-	break;
-    case EMC_TRAJ_SET_HOME_TYPE:
-	((EMC_TRAJ_SET_HOME *) buffer)->update(cms);
-	break;
-    case EMC_TRAJ_SET_MAX_ACCELERATION_TYPE:
-	((EMC_TRAJ_SET_MAX_ACCELERATION *) buffer)->update(cms);
-	break;
-    case EMC_TRAJ_SET_MAX_VELOCITY_TYPE:
-	((EMC_TRAJ_SET_MAX_VELOCITY *) buffer)->update(cms);
-	break;
-    case EMC_TRAJ_SET_MODE_TYPE:
-	((EMC_TRAJ_SET_MODE *) buffer)->update(cms);
-	break;
-    case EMC_TRAJ_SET_MOTION_ID_TYPE:
-	((EMC_TRAJ_SET_MOTION_ID *) buffer)->update(cms);
-	break;
-    case EMC_TRAJ_SET_OFFSET_TYPE:
-	((EMC_TRAJ_SET_OFFSET *) buffer)->update(cms);
-	break;
-    case EMC_TRAJ_SET_G5X_TYPE:
-	((EMC_TRAJ_SET_G5X *) buffer)->update(cms);
-	break;
-    case EMC_TRAJ_SET_G92_TYPE:
-	((EMC_TRAJ_SET_G92 *) buffer)->update(cms);
-	break;
-    case EMC_TRAJ_SET_ROTATION_TYPE:
-	((EMC_TRAJ_SET_ROTATION *) buffer)->update(cms);
-	break;
-    case EMC_TRAJ_SET_SCALE_TYPE:
-	((EMC_TRAJ_SET_SCALE *) buffer)->update(cms);
-	break;
-    case EMC_TRAJ_SET_RAPID_SCALE_TYPE:
-	((EMC_TRAJ_SET_RAPID_SCALE *) buffer)->update(cms);
-	break;
-    case EMC_TRAJ_SET_SPINDLE_SCALE_TYPE:
-	((EMC_TRAJ_SET_SPINDLE_SCALE *) buffer)->update(cms);
-	break;
-    case EMC_TRAJ_SET_FO_ENABLE_TYPE:
-	((EMC_TRAJ_SET_FO_ENABLE *) buffer)->update(cms);
-	break;
-    case EMC_TRAJ_SET_SO_ENABLE_TYPE:
-	((EMC_TRAJ_SET_SO_ENABLE *) buffer)->update(cms);
-	break;
-    case EMC_TRAJ_SET_FH_ENABLE_TYPE:
-	((EMC_TRAJ_SET_FH_ENABLE *) buffer)->update(cms);
-	break;
-    case EMC_TRAJ_SET_TELEOP_ENABLE_TYPE:
-	((EMC_TRAJ_SET_TELEOP_ENABLE *) buffer)->update(cms);
-	break;
-    case EMC_TRAJ_SET_TERM_COND_TYPE:
-	((EMC_TRAJ_SET_TERM_COND *) buffer)->update(cms);
-	break;
-    case EMC_TRAJ_SET_SPINDLESYNC_TYPE:
-        ((EMC_TRAJ_SET_SPINDLESYNC *) buffer)->update(cms);
-        break;
-    case EMC_TRAJ_SET_UNITS_TYPE:
-	((EMC_TRAJ_SET_UNITS *) buffer)->update(cms);
-	break;
-    case EMC_TRAJ_SET_VELOCITY_TYPE:
-	((EMC_TRAJ_SET_VELOCITY *) buffer)->update(cms);
-	break;
-    case EMC_TRAJ_STAT_TYPE:
-	((EMC_TRAJ_STAT *) buffer)->update(cms);
-	break;
-    case EMC_TRAJ_STEP_TYPE:
-	((EMC_TRAJ_STEP *) buffer)->update(cms);
-	break;
-
-    default:
+    const EMC_MESSAGE_INFO *info = emc_message_info(type);
+    if (NULL == info || NULL == info->update) {
 	return (0);
     }
+    info->update(buffer, cms);
     return 1;
 }
 
 // NML Symbol Lookup Function
 const char *emc_symbol_lookup(uint32_t type)
 {
-    switch (type) {
-    case EMC_ABORT_TYPE:
-	return "EMC_ABORT";
-    case EMC_EXEC_PLUGIN_CALL_TYPE:
-	return "EMC_EXEC_PLUGIN_CALL";
-    case EMC_AUX_ESTOP_RESET_TYPE:
-	return "EMC_AUX_ESTOP_RESET";
-    case EMC_AUX_ESTOP_OFF_TYPE:
-	return "EMC_AUX_ESTOP_OFF";
-    case EMC_AUX_ESTOP_ON_TYPE:
-	return "EMC_AUX_ESTOP_ON";
-    case EMC_AUX_STAT_TYPE:
-	return "EMC_AUX_STAT";
-    case EMC_JOINT_ABORT_TYPE:
-	return "EMC_JOINT_ABORT";
-    case EMC_JOINT_ACTIVATE_TYPE:
-	return "EMC_JOINT_ACTIVATE";
-    case EMC_JOINT_DEACTIVATE_TYPE:
-	return "EMC_JOINT_DEACTIVATE";
-    case EMC_JOINT_DISABLE_TYPE:
-	return "EMC_JOINT_DISABLE";
-    case EMC_JOINT_ENABLE_TYPE:
-	return "EMC_JOINT_ENABLE";
-    case EMC_JOINT_HALT_TYPE:
-	return "EMC_JOINT_HALT";
-    case EMC_JOINT_HOME_TYPE:
-	return "EMC_JOINT_HOME";
-    case EMC_JOINT_UNHOME_TYPE:
-	return "EMC_JOINT_UNHOME";
-    case EMC_JOG_CONT_TYPE:
-	return "EMC_JOG_CONT";
-    case EMC_JOG_INCR_TYPE:
-	return "EMC_JOG_INCR";
-    case EMC_JOG_ABS_TYPE:
-	return "EMC_JOG_ABS";
-    case EMC_JOG_STOP_TYPE:
-	return "EMC_JOG_STOP";
-    case EMC_JOINT_INIT_TYPE:
-	return "EMC_JOINT_INIT";
-    case EMC_JOINT_LOAD_COMP_TYPE:
-	return "EMC_JOINT_LOAD_COMP";
-    case EMC_JOINT_OVERRIDE_LIMITS_TYPE:
-	return "EMC_JOINT_OVERRIDE_LIMITS";
-    case EMC_JOINT_SET_JOINT_TYPE:
-	return "EMC_JOINT_SET_AXIS";
-    case EMC_JOINT_SET_FERROR_TYPE:
-	return "EMC_JOINT_SET_FERROR";
-    case EMC_JOINT_SET_BACKLASH_TYPE:
-	return "EMC_JOINT_SET_BACKLASH";
-    case EMC_JOINT_SET_HOMING_PARAMS_TYPE:
-	return "EMC_JOINT_SET_HOMING_PARAMS";
-    case EMC_JOINT_SET_MAX_POSITION_LIMIT_TYPE:
-	return "EMC_JOINT_SET_MAX_POSITION_LIMIT";
-    case EMC_JOINT_SET_MAX_VELOCITY_TYPE:
-	return "EMC_JOINT_SET_MAX_VELOCITY";
-    case EMC_JOINT_SET_MIN_FERROR_TYPE:
-	return "EMC_JOINT_SET_MIN_FERROR";
-    case EMC_JOINT_SET_MIN_POSITION_LIMIT_TYPE:
-	return "EMC_JOINT_SET_MIN_POSITION_LIMIT";
-    case EMC_JOINT_SET_UNITS_TYPE:
-	return "EMC_JOINT_SET_UNITS";
-    case EMC_JOINT_STAT_TYPE:
-	return "EMC_JOINT_STAT";
-    case EMC_COOLANT_FLOOD_OFF_TYPE:
-	return "EMC_COOLANT_FLOOD_OFF";
-    case EMC_COOLANT_FLOOD_ON_TYPE:
-	return "EMC_COOLANT_FLOOD_ON";
-    case EMC_COOLANT_MIST_OFF_TYPE:
-	return "EMC_COOLANT_MIST_OFF";
-    case EMC_COOLANT_MIST_ON_TYPE:
-	return "EMC_COOLANT_MIST_ON";
-    case EMC_COOLANT_STAT_TYPE:
-	return "EMC_COOLANT_STAT";
-    case EMC_HALT_TYPE:
-	return "EMC_HALT";
-    case EMC_INIT_TYPE:
-	return "EMC_INIT";
-    case EMC_IO_ABORT_TYPE:
-	return "EMC_IO_ABORT";
-    case EMC_IO_HALT_TYPE:
-	return "EMC_IO_HALT";
-    case EMC_IO_INIT_TYPE:
-	return "EMC_IO_INIT";
-    case EMC_IO_SET_CYCLE_TIME_TYPE:
-	return "EMC_IO_SET_CYCLE_TIME";
-    case EMC_IO_STAT_TYPE:
-	return "EMC_IO_STAT";
-    case EMC_LUBE_OFF_TYPE:
-	return "EMC_LUBE_OFF";
-    case EMC_LUBE_ON_TYPE:
-	return "EMC_LUBE_ON";
-    case EMC_LUBE_STAT_TYPE:
-	return "EMC_LUBE_STAT";
-    case EMC_MOTION_ABORT_TYPE:
-	return "EMC_MOTION_ABORT";
-    case EMC_MOTION_HALT_TYPE:
-	return "EMC_MOTION_HALT";
-    case EMC_MOTION_INIT_TYPE:
-	return "EMC_MOTION_INIT";
-    case EMC_MOTION_SET_AOUT_TYPE:
-	return "EMC_MOTION_SET_AOUT";
-    case EMC_MOTION_SET_DOUT_TYPE:
-	return "EMC_MOTION_SET_DOUT";
-    case EMC_MOTION_ADAPTIVE_TYPE:
-	return "EMC_MOTION_ADAPTIVE";
-    case EMC_MOTION_STAT_TYPE:
-	return "EMC_MOTION_STAT";
-    case EMC_NULL_TYPE:
-	return "EMC_NULL";
-    case EMC_OPERATOR_DISPLAY_TYPE:
-	return "EMC_OPERATOR_DISPLAY";
-    case EMC_OPERATOR_ERROR_TYPE:
-	return "EMC_OPERATOR_ERROR";
-    case EMC_OPERATOR_TEXT_TYPE:
-	return "EMC_OPERATOR_TEXT";
-    case EMC_SYSTEM_CMD_TYPE:
-	return "EMC_SYSTEM_CMD";
-    case EMC_SET_DEBUG_TYPE:
-	return "EMC_SET_DEBUG";
-    case EMC_SPINDLE_BRAKE_ENGAGE_TYPE:
-	return "EMC_SPINDLE_BRAKE_ENGAGE";
-    case EMC_SPINDLE_BRAKE_RELEASE_TYPE:
-	return "EMC_SPINDLE_BRAKE_RELEASE";
-    case EMC_SPINDLE_CONSTANT_TYPE:
-	return "EMC_SPINDLE_CONSTANT";
-    case EMC_SPINDLE_DECREASE_TYPE:
-	return "EMC_SPINDLE_DECREASE";
-    case EMC_SPINDLE_INCREASE_TYPE:
-	return "EMC_SPINDLE_INCREASE";
-    case EMC_SPINDLE_OFF_TYPE:
-	return "EMC_SPINDLE_OFF";
-    case EMC_SPINDLE_ON_TYPE:
-	return "EMC_SPINDLE_ON";
-    case EMC_SPINDLE_SPEED_TYPE:
-	return "EMC_SPINDLE_SPEED";
-    case EMC_SPINDLE_ORIENT_TYPE:
-	return "EMC_SPINDLE_ORIENT";
-    case EMC_SPINDLE_WAIT_ORIENT_COMPLETE_TYPE:
-	return "EMC_SPINDLE_WAIT_ORIENT_COMPLETE";
-    case EMC_SPINDLE_STAT_TYPE:
-	return "EMC_SPINDLE_STAT";
-    case EMC_STAT_TYPE:
-	return "EMC_STAT";
-    case EMC_TASK_ABORT_TYPE:
-	return "EMC_TASK_ABORT";
-    case EMC_TASK_HALT_TYPE:
-	return "EMC_TASK_HALT";
-    case EMC_TASK_INIT_TYPE:
-	return "EMC_TASK_INIT";
-    case EMC_TASK_PLAN_CLOSE_TYPE:
-	return "EMC_TASK_PLAN_CLOSE";
-    case EMC_TASK_PLAN_END_TYPE:
-	return "EMC_TASK_PLAN_END";
-    case EMC_TASK_PLAN_EXECUTE_TYPE:
-	return "EMC_TASK_PLAN_EXECUTE";
-    case EMC_TASK_PLAN_INIT_TYPE:
-	return "EMC_TASK_PLAN_INIT";
-    case EMC_TASK_PLAN_OPEN_TYPE:
-	return "EMC_TASK_PLAN_OPEN";
-    case EMC_TASK_PLAN_PAUSE_TYPE:
-	return "EMC_TASK_PLAN_PAUSE";
-    case EMC_TASK_PLAN_READ_TYPE:
-	return "EMC_TASK_PLAN_READ";
-    case EMC_TASK_PLAN_RESUME_TYPE:
-	return "EMC_TASK_PLAN_RESUME";
-    case EMC_TASK_PLAN_RUN_TYPE:
-	return "EMC_TASK_PLAN_RUN";
-    case EMC_TASK_PLAN_STEP_TYPE:
-	return "EMC_TASK_PLAN_STEP";
-    case EMC_TASK_PLAN_SYNCH_TYPE:
-	return "EMC_TASK_PLAN_SYNCH";
-    case EMC_TASK_PLAN_SET_OPTIONAL_STOP_TYPE:
-	return "EMC_TASK_PLAN_SET_OPTIONAL_STOP";
-    case EMC_TASK_PLAN_SET_BLOCK_DELETE_TYPE:
-	return "EMC_TASK_PLAN_SET_BLOCK_DELETE";
-    case EMC_TASK_PLAN_OPTIONAL_STOP_TYPE:
-	return "EMC_TASK_PLAN_OPTIONAL_STOP";
-    case EMC_TASK_SET_MODE_TYPE:
-	return "EMC_TASK_SET_MODE";
-    case EMC_TASK_SET_STATE_TYPE:
-	return "EMC_TASK_SET_STATE";
-    case EMC_TASK_STAT_TYPE:
-	return "EMC_TASK_STAT";
-    case EMC_TOOL_ABORT_TYPE:
-	return "EMC_TOOL_ABORT";
-    case EMC_TOOL_HALT_TYPE:
-	return "EMC_TOOL_HALT";
-    case EMC_TOOL_INIT_TYPE:
-	return "EMC_TOOL_INIT";
-    case EMC_TOOL_LOAD_TYPE:
-	return "EMC_TOOL_LOAD";
-    case EMC_TOOL_LOAD_TOOL_TABLE_TYPE:
-	return "EMC_TOOL_LOAD_TOOL_TABLE";
-    case EMC_TOOL_PREPARE_TYPE:
-	return "EMC_TOOL_PREPARE";
-    case EMC_TOOL_SET_OFFSET_TYPE:
-	return "EMC_TOOL_SET_OFFSET";
-    case EMC_TOOL_SET_NUMBER_TYPE:
-	return "EMC_TOOL_SET_NUMBER";
-    case EMC_TOOL_START_CHANGE_TYPE:
-        return "EMC_TOOL_START_CHANGE";
-    case EMC_TOOL_STAT_TYPE:
-	return "EMC_TOOL_STAT";
-    case EMC_TOOL_UNLOAD_TYPE:
-	return "EMC_TOOL_UNLOAD";
-    case EMC_TRAJ_ABORT_TYPE:
-	return "EMC_TRAJ_ABORT";
-    case EMC_TRAJ_CIRCULAR_MOVE_TYPE:
-	return "EMC_TRAJ_CIRCULAR_MOVE";
-    case EMC_TRAJ_CLEAR_PROBE_TRIPPED_FLAG_TYPE:
-	return "EMC_TRAJ_CLEAR_PROBE_TRIPPED_FLAG";
-    case EMC_TRAJ_DELAY_TYPE:
-	return "EMC_TRAJ_DELAY";
-    case EMC_TRAJ_DISABLE_TYPE:
-	return "EMC_TRAJ_DISABLE";
-    case EMC_TRAJ_ENABLE_TYPE:
-	return "EMC_TRAJ_ENABLE";
-    case EMC_TRAJ_HALT_TYPE:
-	return "EMC_TRAJ_HALT";
-    case EMC_TRAJ_INIT_TYPE:
-	return "EMC_TRAJ_INIT";
-    case EMC_TRAJ_LINEAR_MOVE_TYPE:
-	return "EMC_TRAJ_LINEAR_MOVE";
-    case EMC_TRAJ_PAUSE_TYPE:
-	return "EMC_TRAJ_PAUSE";
-    case EMC_TRAJ_PROBE_TYPE:
-	return "EMC_TRAJ_PROBE";
-    case EMC_AUX_INPUT_WAIT_TYPE:
-	return "EMC_AUX_INPUT_WAIT";
-    case EMC_TRAJ_RIGID_TAP_TYPE:
-	return "EMC_TRAJ_RIGID_TAP";
-    case EMC_TRAJ_RESUME_TYPE:
-	return "EMC_TRAJ_RESUME";
-    case EMC_TRAJ_SET_ACCELERATION_TYPE:
-	return "EMC_TRAJ_SET_ACCELERATION";
-    case EMC_TRAJ_SET_AXES_TYPE:
-	return "EMC_TRAJ_SET_AXES";
-    case EMC_TRAJ_SET_CYCLE_TIME_TYPE:
-	return "EMC_TRAJ_SET_CYCLE_TIME";
-    case EMC_TRAJ_SET_HOME_TYPE:
-	return "EMC_TRAJ_SET_HOME";
-    case EMC_TRAJ_SET_MAX_ACCELERATION_TYPE:
-	return "EMC_TRAJ_SET_MAX_ACCELERATION";
-    case EMC_TRAJ_SET_MAX_VELOCITY_TYPE:
-	return "EMC_TRAJ_SET_MAX_VELOCITY";
-    case EMC_TRAJ_SET_MODE_TYPE:
-	return "EMC_TRAJ_SET_MODE";
-    case EMC_TRAJ_SET_MOTION_ID_TYPE:
-	return "EMC_TRAJ_SET_MOTION_ID";
-    case EMC_TRAJ_SET_OFFSET_TYPE:
-	return "EMC_TRAJ_SET_OFFSET";
-    case EMC_TRAJ_SET_G5X_TYPE:
-	return "EMC_TRAJ_SET_G5X";
-    case EMC_TRAJ_SET_G92_TYPE:
-	return "EMC_TRAJ_SET_G92";
-    case EMC_TRAJ_SET_ROTATION_TYPE:
-	return "EMC_TRAJ_SET_ROTATION";
-    case EMC_TRAJ_SET_SCALE_TYPE:
-	return "EMC_TRAJ_SET_SCALE";
-    case EMC_TRAJ_SET_RAPID_SCALE_TYPE:
-	return "EMC_TRAJ_SET_RAPID_SCALE";
-    case EMC_TRAJ_SET_SPINDLE_SCALE_TYPE:
-	return "EMC_TRAJ_SET_SPINDLE_SCALE";
-    case EMC_TRAJ_SET_FO_ENABLE_TYPE:
-	return "EMC_TRAJ_SET_FO_ENABLE";
-    case EMC_TRAJ_SET_SO_ENABLE_TYPE:
-	return "EMC_TRAJ_SET_SO_ENABLE";
-    case EMC_TRAJ_SET_FH_ENABLE_TYPE:
-	return "EMC_TRAJ_SET_FH_ENABLE";
-    case EMC_TRAJ_SET_TELEOP_ENABLE_TYPE:
-	return "EMC_TRAJ_SET_TELEOP_ENABLE";
-    case EMC_TRAJ_SET_TERM_COND_TYPE:
-	return "EMC_TRAJ_SET_TERM_COND";
-    case EMC_TRAJ_SET_SPINDLESYNC_TYPE:
-	return "EMC_TRAJ_SET_SPINDLESYNC";
-    case EMC_TRAJ_SET_UNITS_TYPE:
-	return "EMC_TRAJ_SET_UNITS";
-    case EMC_TRAJ_SET_VELOCITY_TYPE:
-	return "EMC_TRAJ_SET_VELOCITY";
-    case EMC_TRAJ_STAT_TYPE:
-	return "EMC_TRAJ_STAT";
-    case EMC_TRAJ_STEP_TYPE:
-	return "EMC_TRAJ_STEP";
-    default:
+    const EMC_MESSAGE_INFO *info = emc_message_info((NMLTYPE) type);
+    if (NULL == info) {
 	return "UNKNOWN";
-	break;
     }
-    return (NULL);
+    return info->name;
+}
+
+// Size of the message class for a type, or 0 if the type is not known
+size_t emc_message_size(uint32_t type)
+{
+    const EMC_MESSAGE_INFO *info = emc_message_info((NMLTYPE) type);
+    if (NULL == info) {
+	return 0;
+    }
+    return info->size;
 }
 
 /*
@@ -901,8 +406,20 @@ void EMC_TOOL_STAT::update(CMS * cms)
     EMC_TOOL_STAT_MSG::update(cms);
     cms->update(pocketPrepped);
     cms->update(toolInSpindle);
-    for (int i_toolTable = 0; i_toolTable < CANON_POCKETS_MAX; i_toolTable++)
-	CANON_TOOL_TABLE_update(cms, &(toolTable[i_toolTable]));
+    cms->update(toolTableSerial);
+    CANON_TOOL_TABLE_update_used(cms, toolTableLen, toolTable);
+
+}
+
+/*
+*	NML/CMS Update function for EMC_TOOL_TABLE_STAT
+*/
+void EMC_TOOL_TABLE_STAT::update(CMS * cms)
+{
+
+    EMC_TOOL_STAT_MSG::update(cms);
+    cms->update(toolTableSerial);
+    CANON_TOOL_TABLE_update_used(cms, toolTableLen, toolTable);
 
 }
 
@@ -1729,6 +1246,41 @@ void CANON_TOOL_TABLE_update(CMS * cms, CANON_TOOL_TABLE * x)
 
 }
 
+/*
+*	Updates the pockets of a tool table up to the last one with a tool,
+*	but no more than len if that is set.  The count of pockets is sent
+*	first and stored in len when decoding; the pockets after it are set
+*	empty.
+*/
+void CANON_TOOL_TABLE_update_used(CMS * cms, int &len, CANON_TOOL_TABLE * x)
+{
+    int n = CANON_POCKETS_MAX;
+
+    if (cms->mode == CMS_ENCODE) {
+	for (; n > 1; n--)
+	    if (x[n - 1].toolno != -1)
+		break;
+	if (len >= 1 && len < n)
+	    n = len;
+    }
+    cms->update(n);
+    if (n < 1 || n > CANON_POCKETS_MAX)
+	n = CANON_POCKETS_MAX;
+    for (int i = 0; i < n; i++)
+	CANON_TOOL_TABLE_update(cms, &x[i]);
+    if (cms->mode == CMS_DECODE) {
+	len = n;
+	for (int i = n; i < CANON_POCKETS_MAX; i++) {
+	    x[i].toolno = -1;
+	    ZERO_EMC_POSE(x[i].offset);
+	    x[i].diameter = 0.0;
+	    x[i].frontangle = 0.0;
+	    x[i].backangle = 0.0;
+	    x[i].orientation = 0;
+	}
+    }
+}
+
 /*
 *	NML/CMS Update function for EMC_IO_STAT_MSG
 *	Automatically generated by NML CodeGen Java Applet.
@@ -1975,6 +1527,10 @@ void EMC_TASK_STAT::update(CMS * cms)
     cms->update(interpreter_errcode);
     cms->update(input_timeout);
     cms->update(rotation_xy);
+    cms->update(mdiBatch);
+    cms->update(mdiBatchLines);
+    cms->update(mdiBatchDone);
+    cms->update(mdiBatchError);
 
 }
 
@@ -2367,6 +1923,7 @@ void EMC_TRAJ_STAT::update(CMS * cms)
     cms->update(linearUnits);
     cms->update(angularUnits);
     cms->update(cycleTime);
+    cms->update(joints);
     cms->update(deprecated_axes);
     cms->update(axis_mask);
     cms->update((int *) &mode, 1);
@@ -2390,6 +1947,10 @@ void EMC_TRAJ_STAT::update(CMS * cms)
     cms->update(probeval);
     cms->update(kinematics_type);
     cms->update(motion_type);
+    cms->update(probedPointCount);
+    for (int i = 0; i < EMCMOT_MAX_PROBE_POINTS; i++)
+	EmcPose_update(cms, &probedPoints[i]);
+    cms->update(probedPointsTripped);
 
 }
 
@@ -2581,7 +2142,12 @@ void EMC_MOTION_STAT::update(CMS * cms)
 
     EMC_MOTION_STAT_MSG::update(cms);
     traj.update(cms);
-    for (int i_joint = 0; i_joint < EMCMOT_MAX_JOINTS; i_joint++)
+    // only the configured joints; traj.joints has just been encoded, or
+    // decoded when reading
+    int joints = traj.joints;
+    if (joints < 0 || joints > EMCMOT_MAX_JOINTS)
+	joints = EMCMOT_MAX_JOINTS;
+    for (int i_joint = 0; i_joint < joints; i_joint++)
 	joint[i_joint].update(cms);
     cms->update(debug);
 
@@ -2683,6 +2249,18 @@ void EMC_TASK_PLAN_EXECUTE::update(CMS * cms)
 
 }
 
+/*
+*	NML/CMS Update function for EMC_TASK_PLAN_EXECUTE_BATCH
+*/
+void EMC_TASK_PLAN_EXECUTE_BATCH::update(CMS * cms)
+{
+
+    EMC_TASK_CMD_MSG::update(cms);
+    cms->update(count);
+    cms->update(commands, EMC_TASK_MDI_BATCH_LEN);
+
+}
+
 /*
 *	NML/CMS Update function for EMC_COOLANT_FLOOD_ON
 *	Automatically generated by NML CodeGen Java Applet.
@@ -2843,6 +2421,23 @@ void EMC_TRAJ_PROBE::update(CMS * cms)
     cms->update(probe_type);
 }
 
+/*
+*	NML/CMS Update function for EMC_TRAJ_PROBE_SEQUENCE
+*/
+void EMC_TRAJ_PROBE_SEQUENCE::update(CMS * cms)
+{
+
+    EMC_TRAJ_CMD_MSG::update(cms);
+    cms->update(count);
+    for (int i = 0; i < EMCMOT_MAX_PROBE_STEPS; i++)
+	EmcPose_update(cms, &pos[i]);
+    cms->update(type, EMCMOT_MAX_PROBE_STEPS);
+    cms->update(vel, EMCMOT_MAX_PROBE_STEPS);
+    cms->update(ini_maxvel, EMCMOT_MAX_PROBE_STEPS);
+    cms->update(acc, EMCMOT_MAX_PROBE_STEPS);
+    cms->update(probe_type, EMCMOT_MAX_PROBE_STEPS);
+}
+
 /*
 *	NML/CMS Update function for EMC_AUX_INPUT_WAIT
 *	Automatically generated by Alex Joni.
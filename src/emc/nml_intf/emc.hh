@@ -19,6 +19,7 @@
 #include "emcmotcfg.h"		// EMC_JOINT_MAX, EMC_AXIS_MAX
 #include "nml_type.hh"
 #include "motion_types.h"
+#include <stddef.h>		// size_t
 #include <stdint.h>
 
 // Forward class declarations
@@ -132,6 +133,7 @@ struct PM_CARTESIAN;
 #define EMC_TRAJ_SET_SO_ENABLE_TYPE                  ((NMLTYPE) 235)
 #define EMC_TRAJ_SET_FH_ENABLE_TYPE                  ((NMLTYPE) 236)
 #define EMC_TRAJ_RIGID_TAP_TYPE                      ((NMLTYPE) 237)
+#define EMC_TRAJ_PROBE_SEQUENCE_TYPE                 ((NMLTYPE) 239)
 
 #define EMC_TRAJ_STAT_TYPE                           ((NMLTYPE) 299)
 
@@ -167,6 +169,7 @@ struct PM_CARTESIAN;
 #define EMC_TASK_PLAN_SET_OPTIONAL_STOP_TYPE         ((NMLTYPE) 517)
 #define EMC_TASK_PLAN_SET_BLOCK_DELETE_TYPE          ((NMLTYPE) 518)
 #define EMC_TASK_PLAN_OPTIONAL_STOP_TYPE             ((NMLTYPE) 519)
+#define EMC_TASK_PLAN_EXECUTE_BATCH_TYPE             ((NMLTYPE) 520)
 
 #define EMC_TASK_STAT_TYPE                           ((NMLTYPE) 599)
 
@@ -187,6 +190,9 @@ struct PM_CARTESIAN;
 
 #define EMC_EXEC_PLUGIN_CALL_TYPE                   ((NMLTYPE) 1112)
 #define EMC_IO_PLUGIN_CALL_TYPE                   ((NMLTYPE) 1113)
+// the whole tool table, which task writes to the toolTable buffer
+// when it changes instead of with every EMC_STAT
+#define EMC_TOOL_TABLE_STAT_TYPE                     ((NMLTYPE) 1198)
 #define EMC_TOOL_STAT_TYPE                           ((NMLTYPE) 1199)
 
 // EMC_AUX type declarations
@@ -310,6 +316,7 @@ extern int emcFormat(NMLTYPE type, void *buffer, CMS * cms);
 // NML Symbol Lookup Function
 extern const char *emc_symbol_lookup(uint32_t type);
 #define emcSymbolLookup(a) emc_symbol_lookup(a)
+extern size_t emc_message_size(uint32_t type);
 
 // decls for command line args-- mains are responsible for setting these
 // so that other modules can get cmd line args for ad hoc processing
@@ -363,6 +370,8 @@ extern int emcJointSetHomingParams(int joint, double home, double offset, double
 extern int emcJointUpdateHomingParams(int joint, double home, double offset);
 extern int emcJointSetMaxVelocity(int joint, double vel);
 extern int emcJointSetMaxAcceleration(int joint, double acc);
+extern double emcJointGetMaxVelocity(int joint);
+extern double emcJointGetMaxAcceleration(int joint);
 
 extern int emcJointInit(int joint);
 extern int emcJointHalt(int joint);
@@ -417,15 +426,26 @@ extern int emcTrajLinearMove(EmcPose end, int type, double vel,
                              double ini_maxvel, double acc, int indexrotary);
 extern int emcTrajCircularMove(EmcPose end, PM_CARTESIAN center, PM_CARTESIAN
         normal, int turn, int type, double vel, double ini_maxvel, double acc);
+// moves between these go to motion together; room is how many it can take
+extern int emcTrajBatchRoom();
+extern int emcTrajBeginBatch();
+extern int emcTrajEndBatch();
+// joint, axis and traj settings between these go to motion together
+extern int emcBeginSettings();
+extern int emcEndSettings();
 extern int emcTrajSetTermCond(int cond, double tolerance);
 extern int emcTrajSetSpindleSync(double feed_per_revolution, bool wait_for_index);
 extern int emcTrajSetOffset(EmcPose tool_offset);
 extern int emcTrajSetOrigin(EmcPose origin);
 extern int emcTrajSetRotation(double rotation);
 extern int emcTrajSetHome(EmcPose home);
+extern int emcTrajLoadVolComp(const char *file);
 extern int emcTrajClearProbeTrippedFlag();
 extern int emcTrajProbe(EmcPose pos, int type, double vel, 
                         double ini_maxvel, double acc, unsigned char probe_type);
+extern int emcTrajProbeSequence(int count, const EmcPose *pos, const int *type,
+                        const double *vel, const double *ini_maxvel,
+                        const double *acc, const unsigned char *probe_type);
 extern int emcAuxInputWait(int index, int input_type, int wait_type, int timeout);
 extern int emcTrajRigidTap(EmcPose pos, double vel, double ini_maxvel, double acc);
 
@@ -525,9 +545,12 @@ int emcSetMaxFeedOverride(double maxFeedScale);
 int emcSetupArcBlends(int arcBlendEnable,
         int arcBlendFallbackEnable,
         int arcBlendOptDepth,
+        int arcBlendOptMode,
         int arcBlendGapCycles,
         double arcBlendRampFreq,
         double arcBlendTangentKinkRatio);
+int emcSetupPlanner(int plannerType, double maxJerk,
+        int rapidIndependent, double rapidClearance);
 int emcSetProbeErrorInhibit(int j_inhibit, int h_inhibit);
 
 extern int emcUpdate(EMC_STAT * stat);
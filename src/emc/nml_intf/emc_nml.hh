@@ -989,6 +989,28 @@ class EMC_TRAJ_PROBE:public EMC_TRAJ_CMD_MSG {
     unsigned char probe_type;
 };
 
+// Moves run by motion one after the other without task in between.
+// Each move with type EMC_MOTION_TYPE_PROBING is a probe move like
+// EMC_TRAJ_PROBE, and where it stopped goes to probedPoints of
+// EMC_TRAJ_STAT; the next move starts from there.
+class EMC_TRAJ_PROBE_SEQUENCE:public EMC_TRAJ_CMD_MSG {
+  public:
+    EMC_TRAJ_PROBE_SEQUENCE():EMC_TRAJ_CMD_MSG(EMC_TRAJ_PROBE_SEQUENCE_TYPE,
+				      sizeof(EMC_TRAJ_PROBE_SEQUENCE)), count(0) {
+    };
+
+    // For internal NML/CMS use only.
+    void update(CMS * cms);
+
+    int count;
+    EmcPose pos[EMCMOT_MAX_PROBE_STEPS];
+    int type[EMCMOT_MAX_PROBE_STEPS];
+    double vel[EMCMOT_MAX_PROBE_STEPS];
+    double ini_maxvel[EMCMOT_MAX_PROBE_STEPS];
+    double acc[EMCMOT_MAX_PROBE_STEPS];
+    unsigned char probe_type[EMCMOT_MAX_PROBE_STEPS];
+};
+
 class EMC_TRAJ_RIGID_TAP:public EMC_TRAJ_CMD_MSG {
   public:
     EMC_TRAJ_RIGID_TAP():EMC_TRAJ_CMD_MSG(EMC_TRAJ_RIGID_TAP_TYPE,
@@ -1057,6 +1079,10 @@ class EMC_TRAJ_STAT:public EMC_TRAJ_STAT_MSG {
     bool probing;		// Are we currently looking for a probe
     // signal.
     int probeval;		// Current value of probe input.
+    EmcPose probedPoints[EMCMOT_MAX_PROBE_POINTS];	// of the last probe
+    // sequence, one per probe move
+    int probedPointCount;
+    int probedPointsTripped;	// bit n set if the probe tripped at point n
     int kinematics_type;	// identity=1,serial=2,parallel=3,custom=4
     int motion_type;
     double distance_to_go;         // in current move
@@ -1327,6 +1353,27 @@ class EMC_TASK_PLAN_EXECUTE:public EMC_TASK_CMD_MSG {
     char command[LINELEN];
 };
 
+// room for the lines of an MDI batch, a few KB so that one fits in the
+// emcCommand buffer
+#define EMC_TASK_MDI_BATCH_LEN 4096
+
+// several MDI lines in one message; they go through task's MDI queue one
+// after the other, and EMC_TASK_STAT reports how many are done
+class EMC_TASK_PLAN_EXECUTE_BATCH:public EMC_TASK_CMD_MSG {
+  public:
+    EMC_TASK_PLAN_EXECUTE_BATCH():EMC_TASK_CMD_MSG(EMC_TASK_PLAN_EXECUTE_BATCH_TYPE,
+					     sizeof(EMC_TASK_PLAN_EXECUTE_BATCH))
+    {
+	count = 0;
+    };
+
+    // For internal NML/CMS use only.
+    void update(CMS * cms);
+
+    int count;			// number of lines in commands
+    char commands[EMC_TASK_MDI_BATCH_LEN];	// each line ends in a '\0'
+};
+
 class EMC_TASK_PLAN_PAUSE:public EMC_TASK_CMD_MSG {
   public:
     EMC_TASK_PLAN_PAUSE():EMC_TASK_CMD_MSG(EMC_TASK_PLAN_PAUSE_TYPE,
@@ -1482,6 +1529,10 @@ class EMC_TASK_STAT:public EMC_TASK_STAT_MSG {
     int task_paused;		// non-zero means task is paused
     double delayLeft;           // delay time left of G4, M66..
     int queuedMDIcommands;      // current length of MDI input queue
+    int mdiBatch;		// serial number of the last MDI batch
+    int mdiBatchLines;		// lines in it
+    int mdiBatchDone;		// how many of them have finished
+    int mdiBatchError;		// the line that failed, or -1
 };
 
 // declarations for EMC_TOOL classes
@@ -1631,6 +1682,27 @@ class EMC_TOOL_STAT:public EMC_TOOL_STAT_MSG {
 
     int pocketPrepped;		// pocket ready for loading from
     int toolInSpindle;		// tool loaded, 0 is no tool
+    // pockets of toolTable that are sent in the message: the ones after
+    // the last tool are empty, and are filled in as such when it is read.
+    // A writer may set it lower to send only the first pockets; task
+    // sends just the spindle in EMC_STAT when the toolTable buffer has
+    // the rest.
+    int toolTableLen;
+    // changes whenever task sees the table change; compare it to the
+    // toolTableSerial of the last EMC_TOOL_TABLE_STAT read
+    int toolTableSerial;
+    CANON_TOOL_TABLE toolTable[CANON_POCKETS_MAX];
+};
+
+class EMC_TOOL_TABLE_STAT:public EMC_TOOL_STAT_MSG {
+  public:
+    EMC_TOOL_TABLE_STAT();
+
+    // For internal NML/CMS use only.
+    void update(CMS * cms);
+
+    int toolTableSerial;	// as EMC_TOOL_STAT
+    int toolTableLen;		// as EMC_TOOL_STAT
     CANON_TOOL_TABLE toolTable[CANON_POCKETS_MAX];
 };
 
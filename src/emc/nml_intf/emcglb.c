@@ -32,6 +32,12 @@ double emc_io_cycle_time = DEFAULT_EMC_IO_CYCLE_TIME;
 
 int emc_task_interp_max_len = DEFAULT_EMC_TASK_INTERP_MAX_LEN;
 
+double emc_task_interp_max_time = 0;	/* off unless [TASK] INTERP_MAX_TIME is set */
+
+int emc_task_arc_fitting = 0;	/* off unless [TASK] ARC_FITTING is set */
+
+int emc_task_run_checkpoints = 0;	/* off unless [TASK] RUN_FROM_CHECKPOINTS is set */
+
 char tool_table_file[LINELEN] = DEFAULT_TOOL_TABLE_FILE;
 
 EmcPose tool_change_position;	/* no defaults */
@@ -48,6 +48,15 @@ extern "C" {
 
     extern int emc_task_interp_max_len;
 
+    /* seconds of motion to read ahead, or 0 to read INTERP_MAX_LEN lines */
+    extern double emc_task_interp_max_time;
+
+    /* nonzero to let canon fit chained G1 moves with arcs (G64 Q tolerance) */
+    extern int emc_task_arc_fitting;
+
+    /* nonzero to start run-from-line at checkpoints of an earlier run */
+    extern int emc_task_run_checkpoints;
+
     extern char tool_table_file[LINELEN];
 
     extern struct EmcPose tool_change_position;
@@ -83,6 +83,11 @@ EMC_TRAJ_STAT_MSG(EMC_TRAJ_STAT_TYPE, sizeof(EMC_TRAJ_STAT))
     probe_tripped = OFF;
     probing = OFF;
     probeval = 0;
+    for (int i = 0; i < EMCMOT_MAX_PROBE_POINTS; i++) {
+	ZERO_EMC_POSE(probedPoints[i]);
+    }
+    probedPointCount = 0;
+    probedPointsTripped = 0;
     
     ZERO_EMC_POSE(dtg);
     distance_to_go = 0.0;
@@ -151,6 +156,10 @@ EMC_TASK_STAT_MSG(EMC_TASK_STAT_TYPE, sizeof(EMC_TASK_STAT))
     task_paused = 0;
     delayLeft = 0.0;
     queuedMDIcommands = 0;
+    mdiBatch = 0;
+    mdiBatchLines = 0;
+    mdiBatchDone = 0;
+    mdiBatchError = -1;
 }
 
 EMC_TOOL_STAT::EMC_TOOL_STAT():
@@ -160,6 +169,8 @@ EMC_TOOL_STAT_MSG(EMC_TOOL_STAT_TYPE, sizeof(EMC_TOOL_STAT))
 
     pocketPrepped = 0;
     toolInSpindle = 0;
+    toolTableLen = CANON_POCKETS_MAX;
+    toolTableSerial = 0;
 
     for (t = 0; t < CANON_POCKETS_MAX; t++) {
 	toolTable[t].toolno = 0;
@@ -171,6 +182,24 @@ EMC_TOOL_STAT_MSG(EMC_TOOL_STAT_TYPE, sizeof(EMC_TOOL_STAT))
     }
 }
 
+EMC_TOOL_TABLE_STAT::EMC_TOOL_TABLE_STAT():
+EMC_TOOL_STAT_MSG(EMC_TOOL_TABLE_STAT_TYPE, sizeof(EMC_TOOL_TABLE_STAT))
+{
+    int t;
+
+    toolTableSerial = 0;
+    toolTableLen = CANON_POCKETS_MAX;
+
+    for (t = 0; t < CANON_POCKETS_MAX; t++) {
+	toolTable[t].toolno = -1;
+        ZERO_EMC_POSE(toolTable[t].offset);
+	toolTable[t].diameter = 0.0;
+	toolTable[t].orientation = 0;
+	toolTable[t].frontangle = 0.0;
+	toolTable[t].backangle = 0.0;
+    }
+}
+
 EMC_AUX_STAT::EMC_AUX_STAT():
 EMC_AUX_STAT_MSG(EMC_AUX_STAT_TYPE, sizeof(EMC_AUX_STAT))
 {
@@ -209,6 +238,8 @@ EMC_TOOL_STAT EMC_TOOL_STAT::operator =(EMC_TOOL_STAT s)
 
     pocketPrepped = s.pocketPrepped;
     toolInSpindle = s.toolInSpindle;
+    toolTableLen = s.toolTableLen;
+    toolTableSerial = s.toolTableSerial;
 
     for (t = 0; t < CANON_POCKETS_MAX; t++) {
 	toolTable[t].toolno = s.toolTable[t].toolno;
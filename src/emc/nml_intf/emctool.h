@@ -32,4 +32,64 @@ struct CANON_TOOL_TABLE {
     int orientation;
 };
 
+/* Index from tool number to pocket, so that a tool can be found without
+   scanning the table.  Open addressing; the size is a power of two more
+   than twice CANON_POCKETS_MAX, so it never fills up and probes stay
+   short.  Tool numbers are usually small and consecutive, so the low
+   bits are used as the hash. */
+#define CANON_TOOL_INDEX_SIZE 128
+
+struct CANON_TOOL_INDEX {
+    int toolno[CANON_TOOL_INDEX_SIZE];
+    int pocket[CANON_TOOL_INDEX_SIZE];	// -1 for an empty slot
+};
+
+/* Builds the index of the pockets 0..CANON_POCKETS_MAX-1 of toolTable.
+   If a tool is in more than one pocket the highest one is indexed. */
+static inline void toolIndexBuild(struct CANON_TOOL_INDEX *index,
+	const struct CANON_TOOL_TABLE toolTable[])
+{
+    int i, p, slot;
+
+    for (i = 0; i < CANON_TOOL_INDEX_SIZE; i++) {
+	index->pocket[i] = -1;
+    }
+    for (p = 0; p < CANON_POCKETS_MAX; p++) {
+	if (toolTable[p].toolno == -1) continue;
+	slot = toolTable[p].toolno & (CANON_TOOL_INDEX_SIZE - 1);
+	while (index->pocket[slot] != -1
+		&& index->toolno[slot] != toolTable[p].toolno) {
+	    slot = (slot + 1) & (CANON_TOOL_INDEX_SIZE - 1);
+	}
+	index->toolno[slot] = toolTable[p].toolno;
+	index->pocket[slot] = p;
+    }
+}
+
+/* Returns the pocket of toolno, or -1 if it is not in the table.  The
+   table may have been changed since the index was built, so a hit is
+   checked against it, and a miss is confirmed by a scan. */
+static inline int toolIndexFind(const struct CANON_TOOL_INDEX *index,
+	const struct CANON_TOOL_TABLE toolTable[], int toolno)
+{
+    int slot, p, probes;
+
+    slot = toolno & (CANON_TOOL_INDEX_SIZE - 1);
+    for (probes = 0; probes < CANON_TOOL_INDEX_SIZE
+	    && index->pocket[slot] >= 0; probes++) {
+	if (index->toolno[slot] == toolno) {
+	    p = index->pocket[slot];
+	    if (p < CANON_POCKETS_MAX && toolTable[p].toolno == toolno) {
+		return p;
+	    }
+	    break;
+	}
+	slot = (slot + 1) & (CANON_TOOL_INDEX_SIZE - 1);
+    }
+    for (p = CANON_POCKETS_MAX - 1; p >= 0; p--) {
+	if (toolTable[p].toolno == toolno) return p;
+    }
+    return -1;
+}
+
 #endif
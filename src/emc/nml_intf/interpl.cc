@@ -17,12 +17,14 @@
 
 
 #include <string.h>		/* memcpy() */
+#include <stdlib.h>		/* malloc(), free() */
+#include <math.h>		/* sqrt(), atan2() */
 
-#include "rcs.hh"		// LinkedList
+#include "rcs.hh"
 #include "interpl.hh"		// these decls
 #include "emc.hh"
+#include "emc_nml.hh"		// EMC_TRAJ_LINEAR_MOVE, EMC_TRAJ_CIRCULAR_MOVE
 #include "emcglb.h"
-#include "linklist.hh"
 #include "nmlmsg.hh"            /* class NMLmsg */
 #include "rcs_print.hh"
 
@@ -30,18 +32,56 @@ NML_INTERP_LIST interp_list;	/* NML Union, for interpreter */
 
 NML_INTERP_LIST::NML_INTERP_LIST()
 {
-    linked_list_ptr = new LinkedList;
+    nodes = NULL;
+    size = 0;
+    head = 0;
+    count = 0;
+    held = -1;
+    retired = NULL;
 
     next_line_number = 0;
     line_number = 0;
+    duration = 0;
+    total_duration = 0;
+    have_end = 0;
 }
 
 NML_INTERP_LIST::~NML_INTERP_LIST()
 {
-    if (NULL != linked_list_ptr) {
-	delete linked_list_ptr;
-	linked_list_ptr = NULL;
+    free(nodes);
+    free(retired);
+}
+
+/*
+  Doubles the ring, keeping the nodes in order from the start of the new
+  one.  The message from the last get() is still in use, so if it is in
+  the old ring that stays allocated until the next get() or clear().
+*/
+int NML_INTERP_LIST::grow()
+{
+    int new_size = size ? 2 * size : INTERP_LIST_MIN_NODES;
+    NML_INTERP_LIST_NODE *new_nodes = (NML_INTERP_LIST_NODE *)
+	malloc(new_size * sizeof(NML_INTERP_LIST_NODE));
+    if (NULL == new_nodes) {
+	rcs_print_error("NML_INTERP_LIST::grow : out of memory\n");
+	return -1;
+    }
+    for (int i = 0; i < count; i++) {
+	NML_INTERP_LIST_NODE *node = &nodes[(head + i) % size];
+	NMLmsg *msg = (NMLmsg *) node->command.commandbuf;
+	memcpy(&new_nodes[i], node,
+	       sizeof(*node) - sizeof(node->command) + msg->size);
+    }
+    if (held >= 0) {
+	retired = nodes;
+	held = -1;
+    } else {
+	free(nodes);
     }
+    nodes = new_nodes;
+    size = new_size;
+    head = 0;
+    return 0;
 }
 
 int NML_INTERP_LIST::append(NMLmsg & nml_msg)
@@ -82,39 +122,24 @@ int NML_INTERP_LIST::append(NMLmsg * nml_msg_ptr)
 	    ("NML_INTERP_LIST::append : command size is invalid.");
 	return -1;
     }
-#ifdef DEBUG_INTERPL
-    if (sizeof(temp_node) < MAX_NML_COMMAND_SIZE + 4 ||
-	sizeof(temp_node) > MAX_NML_COMMAND_SIZE + 16 ||
-	((void *) &temp_node.line_number) >
-	((void *) &temp_node.command.commandbuf)) {
-	rcs_print_error
-	    ("NML_INTERP_LIST::append : assumptions about NML_INTERP_LIST_NODE have been violated.");
-	return -1;
-    }
-#endif
-
-    if (NULL == linked_list_ptr) {
+    // the node of the last get() is not reused while it may be in use
+    if (count + (held >= 0) == size && 0 != grow()) {
 	return -1;
     }
-    // fill in the NML_INTERP_LIST_NODE
-    temp_node.line_number = next_line_number;
-    memcpy(temp_node.command.commandbuf, nml_msg_ptr, nml_msg_ptr->size);
-
-    // stick it on the list
-    linked_list_ptr->store_at_tail(&temp_node,
-				   nml_msg_ptr->size +
-				   sizeof(temp_node.line_number) +
-				   sizeof(temp_node.dummy) + 32 + (32 -
-								   nml_msg_ptr->
-								   size %
-								   32), 1);
+    // fill in the NML_INTERP_LIST_NODE at the tail
+    NML_INTERP_LIST_NODE *node = &nodes[(head + count) % size];
+    node->line_number = next_line_number;
+    node->duration = move_time(nml_msg_ptr);
+    total_duration += node->duration;
+    memcpy(node->command.commandbuf, nml_msg_ptr, nml_msg_ptr->size);
+    count++;
 
     if (emc_debug & EMC_DEBUG_INTERP_LIST) {
 	rcs_print
 	    ("NML_INTERP_LIST(%p)::append(nml_msg_ptr{size=%ld,type=%s}) : list_size=%d, line_number=%d\n",
              this,
 	     nml_msg_ptr->size, emc_symbol_lookup(nml_msg_ptr->type),
-	     linked_list_ptr->list_size, temp_node.line_number);
+	     count, node->line_number);
     }
 
     return 0;
@@ -125,19 +150,31 @@ NMLmsg *NML_INTERP_LIST::get()
     NMLmsg *ret;
     NML_INTERP_LIST_NODE *node_ptr;
 
-    if (NULL == linked_list_ptr) {
+    // the message of the previous get() is done with
+    free(retired);
+    retired = NULL;
+    held = -1;
+
+    if (0 == count) {
 	line_number = 0;
+	duration = 0;
+	total_duration = 0;
 	return NULL;
     }
 
-    node_ptr = (NML_INTERP_LIST_NODE *) linked_list_ptr->retrieve_head();
+    node_ptr = &nodes[head];
+    held = head;
+    head = (head + 1) % size;
+    count--;
 
-    if (NULL == node_ptr) {
-	line_number = 0;
-	return NULL;
-    }
     // save line number of this one, for use by get_line_number
     line_number = node_ptr->line_number;
+    duration = node_ptr->duration;
+    total_duration -= duration;
+    if (count == 0 || total_duration < 0) {
+	// don't let rounding build up
+	total_duration = 0;
+    }
 
     // get it off the front
     ret = (NMLmsg *) ((char *) node_ptr->command.commandbuf);
@@ -148,57 +185,144 @@ NMLmsg *NML_INTERP_LIST::get()
             this,
             ret->size,
             emc_symbol_lookup(ret->type),
-            linked_list_ptr->list_size
+            count
         );
     }
 
     return ret;
 }
 
-void NML_INTERP_LIST::clear()
+// the command the next get() returns, left on the list, or NULL
+NMLmsg *NML_INTERP_LIST::peek()
 {
-    if (NULL != linked_list_ptr) {
-        if (emc_debug & EMC_DEBUG_INTERP_LIST) {
-            rcs_print("NML_INTERP_LIST(%p)::clear(): discarding %d items\n", this, linked_list_ptr->list_size);
-        }
+    if (0 == count) {
+	return NULL;
+    }
+    return (NMLmsg *) nodes[head].command.commandbuf;
+}
 
-	linked_list_ptr->delete_members();
+void NML_INTERP_LIST::clear()
+{
+    if (emc_debug & EMC_DEBUG_INTERP_LIST) {
+        rcs_print("NML_INTERP_LIST(%p)::clear(): discarding %d items\n", this, count);
     }
+
+    // the node of the last get() stays held, so this doesn't free anything
+    count = 0;
+    total_duration = 0;
+    // after an abort the next move may not start where the last ended
+    have_end = 0;
 }
 
 void NML_INTERP_LIST::print()
 {
     NMLmsg *ret;
     NML_INTERP_LIST_NODE *node_ptr;
-    int line_number;
 
-    if (NULL == linked_list_ptr) {
-	return;
-    }
-    node_ptr = (NML_INTERP_LIST_NODE *) linked_list_ptr->get_head();
-
-    rcs_print("NML_INTERP_LIST::print(): list size=%d\n",linked_list_ptr->list_size);
-    while (NULL != node_ptr) {
-	line_number = node_ptr->line_number;
+    rcs_print("NML_INTERP_LIST::print(): list size=%d\n", count);
+    for (int i = 0; i < count; i++) {
+	node_ptr = &nodes[(head + i) % size];
 	ret = (NMLmsg *) ((char *) node_ptr->command.commandbuf);
 	rcs_print("--> type=%s,  line_number=%d\n",
 		  emc_symbol_lookup((int)ret->type),
-		  line_number);
-	node_ptr = (NML_INTERP_LIST_NODE *) linked_list_ptr->get_next();
+		  node_ptr->line_number);
     }
     rcs_print("\n");
 }
 
 int NML_INTERP_LIST::len()
 {
-    if (NULL == linked_list_ptr) {
-	return 0;
-    }
-
-    return ((int) linked_list_ptr->list_size);
+    return count;
 }
 
 int NML_INTERP_LIST::get_line_number()
 {
     return line_number;
 }
+
+// duration of the node from the last get(), or 0 if it wasn't a move
+double NML_INTERP_LIST::get_duration()
+{
+    return duration;
+}
+
+// estimated time of all the moves on the list
+double NML_INTERP_LIST::queued_time()
+{
+    return total_duration;
+}
+
+/*
+  Estimates how long a move takes at its requested velocity, from the
+  end of the move appended before it.  Acceleration, blending and the
+  feed override are left out, so it is on the short side; that errs
+  toward reading ahead more, not less.  Anything that isn't a move
+  takes no time, and so does the first move after clear(), since
+  where it starts isn't known here.
+*/
+double NML_INTERP_LIST::move_time(NMLmsg * nml_msg_ptr)
+{
+    EmcPose start = last_end;
+    int known = have_end;
+    double len, vel;
+
+    if (nml_msg_ptr->type == EMC_TRAJ_LINEAR_MOVE_TYPE) {
+	EMC_TRAJ_LINEAR_MOVE *m = (EMC_TRAJ_LINEAR_MOVE *) nml_msg_ptr;
+	double dx = m->end.tran.x - start.tran.x;
+	double dy = m->end.tran.y - start.tran.y;
+	double dz = m->end.tran.z - start.tran.z;
+	last_end = m->end;
+	vel = m->vel;
+	// the planner uses the first of xyz, abc and uvw that moves
+	len = sqrt(dx * dx + dy * dy + dz * dz);
+	if (len < 1e-9) {
+	    double da = m->end.a - start.a;
+	    double db = m->end.b - start.b;
+	    double dc = m->end.c - start.c;
+	    len = sqrt(da * da + db * db + dc * dc);
+	}
+	if (len < 1e-9) {
+	    double du = m->end.u - start.u;
+	    double dv = m->end.v - start.v;
+	    double dw = m->end.w - start.w;
+	    len = sqrt(du * du + dv * dv + dw * dw);
+	}
+    } else if (nml_msg_ptr->type == EMC_TRAJ_CIRCULAR_MOVE_TYPE) {
+	EMC_TRAJ_CIRCULAR_MOVE *m = (EMC_TRAJ_CIRCULAR_MOVE *) nml_msg_ptr;
+	const PM_CARTESIAN &c = m->center, &n = m->normal;
+	// start and end relative to the center, in the plane of the arc
+	double sx = start.tran.x - c.x, sy = start.tran.y - c.y,
+	    sz = start.tran.z - c.z;
+	double ex = m->end.tran.x - c.x, ey = m->end.tran.y - c.y,
+	    ez = m->end.tran.z - c.z;
+	double nn = n.x * n.x + n.y * n.y + n.z * n.z;
+	double sn, en, height, radius, angle;
+	last_end = m->end;
+	vel = m->vel;
+	if (nn < 1e-18) {
+	    return 0;
+	}
+	sn = (sx * n.x + sy * n.y + sz * n.z) / nn;
+	en = (ex * n.x + ey * n.y + ez * n.z) / nn;
+	height = (en - sn) * sqrt(nn);
+	sx -= sn * n.x; sy -= sn * n.y; sz -= sn * n.z;
+	ex -= en * n.x; ey -= en * n.y; ez -= en * n.z;
+	radius = sqrt(sx * sx + sy * sy + sz * sz);
+	// counterclockwise about the normal, plus whole turns
+	angle = atan2(((sy * ez - sz * ey) * n.x + (sz * ex - sx * ez) * n.y +
+		       (sx * ey - sy * ex) * n.z) / sqrt(nn),
+		      sx * ex + sy * ey + sz * ez);
+	if (angle <= 1e-9) {
+	    angle += 2 * M_PI;
+	}
+	angle += 2 * M_PI * m->turn;
+	len = sqrt(radius * angle * radius * angle + height * height);
+    } else {
+	return 0;
+    }
+    have_end = 1;
+    if (!known || vel <= 0) {
+	return 0;
+    }
+    return len / vel;
+}
@@ -18,12 +18,15 @@
 #define INTERP_LIST_HH
 
 #include <stdint.h>
+#include "emcpos.h"		// EmcPose
 
 #define MAX_NML_COMMAND_SIZE 1000
+#define INTERP_LIST_MIN_NODES 256	// nodes allocated by the first append
 
 // these go on the interp list
 struct NML_INTERP_LIST_NODE {
     int line_number;		// line number it was on
+    double duration;		// estimated time of a move, 0 otherwise
     union _dummy_union {
 	int32_t i;
 	int32_t l;
@@ -44,7 +47,8 @@ struct NML_INTERP_LIST_NODE {
     } command;
 };
 
-// here's the interp list itself
+// here's the interp list itself, a ring of nodes that doubles when it
+// fills, so appending a command is one copy of the message and no malloc
 class NML_INTERP_LIST {
   public:
     NML_INTERP_LIST();
@@ -52,18 +56,32 @@ class NML_INTERP_LIST {
 
     int set_line_number(int line);
     int get_line_number();
+    double get_duration();
+    double queued_time();
     int append(NMLmsg &);
     int append(NMLmsg *);
     NMLmsg *get();
+    NMLmsg *peek();
     void clear();
     void print();
     int len();
 
   private:
-    class LinkedList * linked_list_ptr;
-    NML_INTERP_LIST_NODE temp_node;	// filled in and put on the list
+    NML_INTERP_LIST_NODE *nodes;	// the ring
+    int size;			// nodes allocated
+    int head;			// next node for get()
+    int count;			// nodes on the list
+    int held;			// node of the last get(), or -1
+    NML_INTERP_LIST_NODE *retired;	// ring before a grow(), while it holds
+				// the node of the last get()
+    int grow();
     int next_line_number;	// line number used to fill temp_node
     int line_number;		// line number of node from get()
+    double duration;		// duration of node from get()
+    double total_duration;	// sum of the durations on the list
+    EmcPose last_end;		// end of the last move appended
+    int have_end;		// last_end is known
+    double move_time(NMLmsg *);
 };
 
 extern NML_INTERP_LIST interp_list;	/* NML Union, for interpreter */
@@ -21,7 +21,11 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
+#include <sys/inotify.h>
+
+#include <marshal.h>
 
 #include <boost/python/exec.hpp>
 #include <boost/python/extract.hpp>
@@ -115,33 +119,87 @@ int PythonPlugin::call_method(bp::object method, bp::object &retval)
 int PythonPlugin::call(const char *module, const char *callable,
 		       bp::object tupleargs, bp::object kwargs, bp::object &retval)
 {
-    bp::object function;
-
     if (callable == NULL)
 	return PLUGIN_NO_CALLABLE;
 
+    return call(callable_handle(module, callable), tupleargs, kwargs, retval);
+}
+
+int PythonPlugin::callable_handle(const char *module, const char *callable)
+{
+    std::string key = module ? std::string(module) + "." + callable : callable;
+    std::map<std::string, int>::iterator it = callable_handles.find(key);
+
+    if (it != callable_handles.end())
+	return it->second;
+    cached_callable c;
+    if (module)
+	c.module = module;
+    c.callable = callable;
+    callables.push_back(c);
+    callable_handles[key] = callables.size();
+    return callables.size();
+}
+
+// the function for a handle, as a borrowed reference, or NULL if the
+// module or the name isn't there; a namespace that was found is kept
+// until the next initialize()
+PyObject *PythonPlugin::lookup(cached_callable &c)
+{
+    if (c.ns.ptr() == Py_None) {
+	if (c.module.empty()) {
+	    c.ns = main_namespace;
+	} else {
+	    PyObject *submod = PyDict_GetItemString(main_namespace.ptr(),
+						    c.module.c_str());
+	    if (submod == NULL)
+		return NULL;
+	    PyObject *ns = PyObject_GetAttrString(submod, "__dict__");
+	    if (ns == NULL) {
+		PyErr_Clear();
+		return NULL;
+	    }
+	    c.ns = bp::object(bp::handle<>(ns));
+	}
+    }
+    if (c.name.ptr() == Py_None) {
+	PyObject *name = PyString_InternFromString(c.callable.c_str());
+	if (name == NULL) {
+	    PyErr_Clear();
+	    return NULL;
+	}
+	c.name = bp::object(bp::handle<>(name));
+    }
+    return PyDict_GetItem(c.ns.ptr(), c.name.ptr());
+}
+
+int PythonPlugin::call(int handle,
+		       bp::object tupleargs, bp::object kwargs, bp::object &retval)
+{
+    if (handle < 1 || handle > (int) callables.size())
+	return PLUGIN_NO_CALLABLE;
+    cached_callable &c = callables[handle - 1];
+
     reload();
 
     if (status < PLUGIN_OK)
 	return status;
 
     try {
-	if (module == NULL) {  // default to function in toplevel module
-	    function = main_namespace[callable];
-	} else {
-	    bp::object submod =  main_namespace[module];
-	    bp::object submod_namespace = submod.attr("__dict__");
-	    function = submod_namespace[callable];
+	PyObject *function = lookup(c);
+	if (function == NULL) {
+	    PyErr_SetString(PyExc_KeyError, c.callable.c_str());
+	    bp::throw_error_already_set();
 	}
 	// this wont work with boost-python1.34 - needs 1.40
 	//retval = function(*tupleargs, **kwargs);
 
 	// this does
-	PyObject *rv = PyObject_Call(function.ptr(), tupleargs.ptr(), kwargs.ptr());
+	PyObject *rv = PyObject_Call(function, tupleargs.ptr(), kwargs.ptr());
 	if (PyErr_Occurred()) 
 	    bp::throw_error_already_set();
 	if (rv) 
-	    retval = bp::object(bp::borrowed(rv));
+	    retval = bp::object(bp::handle<>(rv));
 	else
 	    retval = bp::object();
 	status = PLUGIN_OK;
@@ -157,9 +215,9 @@ int PythonPlugin::call(const char *module, const char *callable,
     }
     if (status == PLUGIN_EXCEPTION) {
 	logPP(0, "call(%s%s%s): \n%s",
-	      module ? module : "",
-	      module ? "." : "",
-	      callable, exception_msg.c_str());
+	      c.module.c_str(),
+	      c.module.empty() ? "" : ".",
+	      c.callable.c_str(), exception_msg.c_str());
     }
     return status;
 }
@@ -167,59 +225,77 @@ int PythonPlugin::call(const char *module, const char *callable,
 bool PythonPlugin::is_callable(const char *module,
 			       const char *funcname)
 {
-    bool unexpected = false;
+    if (funcname == NULL)
+	return false;
+    return is_callable(callable_handle(module, funcname));
+}
+
+bool PythonPlugin::is_callable(int handle)
+{
     bool result = false;
-    bp::object function;
+
+    if (handle < 1 || handle > (int) callables.size())
+	return false;
+    cached_callable &c = callables[handle - 1];
 
     reload();
-    if ((status != PLUGIN_OK) ||
-	(funcname == NULL)) {
+    if (status != PLUGIN_OK) {
 	return false;
     }
-    try {
-	if (module == NULL) {  // default to function in toplevel module
-	   function = main_namespace[funcname];
-	} else {
-	    bp::object submod =  main_namespace[module];
-	    bp::object submod_namespace = submod.attr("__dict__");
-	    function = submod_namespace[funcname];
-	}
-	result = PyCallable_Check(function.ptr());
-    }
-    catch (bp::error_already_set) {
-	// KeyError expected if not callable
-	if (!PyErr_ExceptionMatches(PyExc_KeyError)) {
-	    // something else, strange
-	    exception_msg = handle_pyerror();
-	    unexpected = true;
-	}
-	result = false;
-	PyErr_Clear();
-    }
-    if (unexpected)
-	logPP(0, "is_callable(%s%s%s): unexpected exception:\n%s",
-	      module ? module : "", module ? "." : "",
-	      funcname,exception_msg.c_str());
+    PyObject *function = lookup(c);
+    result = function && PyCallable_Check(function);
 
     if (log_level)
 	logPP(4, "is_callable(%s%s%s) = %s",
-	      module ? module : "", module ? "." : "",
-	      funcname,result ? "TRUE":"FALSE");
+	      c.module.c_str(), c.module.empty() ? "" : ".",
+	      c.callable.c_str(), result ? "TRUE":"FALSE");
     return result;
 }
 
-// this should be moved to an inotify-based solution and be done with it
+// drains the events of the watch on the toplevel's directory; true if
+// one was about the toplevel, or some may have been lost
+bool PythonPlugin::watch_changed()
+{
+    char buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    const char *base = strrchr(abs_path, '/') + 1;
+    bool changed = false;
+    ssize_t len;
+
+    while ((len = read(watch_fd, buf, sizeof(buf))) > 0) {
+	struct inotify_event *ev;
+	for (char *p = buf; p < buf + len; p += sizeof(*ev) + ev->len) {
+	    ev = (struct inotify_event *) p;
+	    if ((ev->mask & (IN_Q_OVERFLOW | IN_IGNORED))
+		|| (ev->len && strcmp(ev->name, base) == 0))
+		changed = true;
+	}
+    }
+    return changed;
+}
+
+// with a watch, the toplevel is only looked at after it was written,
+// rather than stat()ed on every call
 int PythonPlugin::reload()
 {
     struct stat st;
     if (!reload_on_change)
 	return PLUGIN_OK;
 
+    if (watch_fd >= 0) {
+	if (watch_changed())
+	    reload_pending = true;
+	if (!reload_pending) {
+	    logPP(5, "reload: no-op");
+	    status = PLUGIN_OK;
+	    return status;
+	}
+    }
     if (stat(abs_path, &st)) {
 	logPP(0, "reload: stat(%s) returned %s", abs_path, strerror(errno));
 	status = PLUGIN_STAT_FAILED;
 	return status;
     }
+    reload_pending = false;
     if (st.st_mtime > module_mtime) {
 	module_mtime = st.st_mtime;
 	initialize();
@@ -231,6 +307,80 @@ int PythonPlugin::reload()
     return status;
 }
 
+// the code in a .pyc written by exec_toplevel(), or NULL if there is
+// none for this source and Python
+static PyObject *read_bytecode(const char *path, time_t mtime)
+{
+    FILE *fp = fopen(path, "rb");
+    PyObject *code = NULL;
+
+    if (fp == NULL)
+	return NULL;
+    if (PyMarshal_ReadLongFromFile(fp) == PyImport_GetMagicNumber()
+	&& PyMarshal_ReadLongFromFile(fp) == (long) (int) mtime
+	&& !PyErr_Occurred()) {
+	code = PyMarshal_ReadLastObjectFromFile(fp);
+	if (code != NULL && !PyCode_Check(code)) {
+	    Py_DECREF(code);
+	    code = NULL;
+	}
+    }
+    PyErr_Clear();
+    fclose(fp);
+    return code;
+}
+
+// writes the .pyc the way the import machinery does, through a
+// temporary file so a reader never sees half of one
+static void write_bytecode(const char *path, time_t mtime, PyObject *code)
+{
+    std::string tmp = std::string(path) + ".tmp";
+    FILE *fp = fopen(tmp.c_str(), "wb");
+
+    if (fp == NULL)
+	return;
+    PyMarshal_WriteLongToFile(PyImport_GetMagicNumber(), fp, Py_MARSHAL_VERSION);
+    PyMarshal_WriteLongToFile((long) (int) mtime, fp, Py_MARSHAL_VERSION);
+    PyMarshal_WriteObjectToFile(code, fp, Py_MARSHAL_VERSION);
+    bool ok = !ferror(fp);
+    if (fclose(fp) != 0 || !ok || rename(tmp.c_str(), path) != 0)
+	unlink(tmp.c_str());
+    PyErr_Clear();
+}
+
+// runs the toplevel in main_namespace.  Its compiled code is kept in a
+// .pyc beside it, as Python does for the modules the toplevel imports,
+// so it is only compiled again after it changes.
+void PythonPlugin::exec_toplevel()
+{
+    struct stat st;
+    std::string cache;
+    PyObject *code = NULL;
+    size_t len = strlen(abs_path);
+
+    if (len > 3 && strcmp(abs_path + len - 3, ".py") == 0
+	&& stat(abs_path, &st) == 0) {
+	cache = std::string(abs_path) + "c";
+	code = read_bytecode(cache.c_str(), st.st_mtime);
+    }
+    if (code == NULL) {
+	bp::object source = bp::import("__builtin__").attr("open")(abs_path, "rU").attr("read")();
+	code = Py_CompileString(bp::extract<const char *>(source), abs_path,
+				Py_file_input);
+	if (code == NULL)
+	    bp::throw_error_already_set();
+	if (!cache.empty() && !Py_DontWriteBytecodeFlag)
+	    write_bytecode(cache.c_str(), st.st_mtime, code);
+	logPP(3, "exec_toplevel: compiled %s", abs_path);
+    }
+    bp::handle<> hcode(code);
+    PyObject *rv = PyEval_EvalCode((PyCodeObject *) code,
+				   main_namespace.ptr(), main_namespace.ptr());
+    if (rv == NULL)
+	bp::throw_error_already_set();
+    Py_DECREF(rv);
+}
+
 // decode a Python exception into a string.
 // Free function usable without working plugin instance.
 std::string handle_pyerror()
@@ -259,14 +409,16 @@ int PythonPlugin::initialize()
 	try {
 	    bp::object module = bp::import("__main__");
 	    main_namespace = module.attr("__dict__");
+	    // the namespaces found for handles are from the old modules
+	    for(unsigned i = 0; i < callables.size(); i++) {
+		callables[i].ns = bp::object();
+	    }
 
 	    for(unsigned i = 0; i < inittab_entries.size(); i++) {
 		main_namespace[inittab_entries[i]] = bp::import(inittab_entries[i].c_str());
 	    }
 	    if (toplevel) // only execute a file if there's one configured.
-		bp::object result = working_execfile(abs_path,
-						  main_namespace,
-						  main_namespace);
+		exec_toplevel();
 	    status = PLUGIN_OK;
 	}
 	catch (bp::error_already_set) {
@@ -295,7 +447,9 @@ PythonPlugin::PythonPlugin(struct _inittab *inittab) :
     reload_on_change(0),
     toplevel(0),
     abs_path(0),
-    log_level(0)
+    log_level(0),
+    watch_fd(-1),
+    reload_pending(true)
 {
     Py_SetProgramName((char *) abs_path);
 
@@ -354,6 +508,21 @@ int PythonPlugin::configure(const char *iniFilename,
 	abs_path = strstore(real_path);
 	module_mtime = st.st_mtime;      // record timestamp
 
+	if (reload_on_change && watch_fd < 0) {
+	    // watch the directory, since editors often replace the file
+	    std::string dir(abs_path, strrchr(abs_path, '/') - abs_path + 1);
+	    watch_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	    if (watch_fd >= 0 &&
+		inotify_add_watch(watch_fd, dir.c_str(),
+				  IN_CLOSE_WRITE | IN_ATTRIB | IN_MOVED_TO |
+				  IN_CREATE | IN_DELETE | IN_MOVED_FROM) < 0) {
+		close(watch_fd);
+		watch_fd = -1;
+	    }
+	    if (watch_fd < 0)
+		logPP(1, "no inotify on %s, checking it on each call", dir.c_str());
+	}
+
     } else {
         if (getcwd(real_path, PATH_MAX) == NULL) {
             logPP(1, "path too long");
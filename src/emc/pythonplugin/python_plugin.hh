@@ -23,11 +23,35 @@
 
 #include <vector>
 #include <string>
+#include <map>
+#include <deque>
 #include <sys/types.h>
 
 
 extern std::string handle_pyerror();
 
+// Holds the GIL for its lifetime.  The interpreter takes one around
+// everything it does with Python objects, so that a program running it
+// may release the GIL while it reads and executes blocks (the preview
+// in gcodemodule does).  It nests, and does nothing before Python is
+// initialized.
+class PythonLock {
+public:
+    PythonLock() : held(Py_IsInitialized()) {
+	if (held)
+	    state = PyGILState_Ensure();
+    }
+    ~PythonLock() {
+	if (held)
+	    PyGILState_Release(state);
+    }
+private:
+    PythonLock(const PythonLock &);
+    PythonLock &operator=(const PythonLock &);
+    bool held;
+    PyGILState_STATE state;
+};
+
 
 // PY_EXCEPTION: both exception_msg and error_msg are set
 // PY_ERROR:  error_msg is set
@@ -61,6 +85,13 @@ public:
     bool is_callable(const char *module, const char *funcname);
     int call(const char *module,const char *callable,
 	     boost::python::object tupleargs, boost::python::object kwargs, boost::python::object &retval);
+    // a handle keeps the module namespace and the name of a callable, so
+    // finding it again is one dictionary lookup; handles start at 1 and
+    // stay valid across reloads
+    int callable_handle(const char *module, const char *callable);
+    bool is_callable(int handle);
+    int call(int handle,
+	     boost::python::object tupleargs, boost::python::object kwargs, boost::python::object &retval);
     int run_string(const char *cmd, boost::python::object &retval, bool as_file = false);
     int call_method(boost::python::object method, boost::python::object &retval);
 
@@ -78,6 +109,17 @@ private:
     ~PythonPlugin() {};
 
     int reload();
+    bool watch_changed();
+    void exec_toplevel();
+    struct cached_callable {
+	std::string module;                // empty for the toplevel module
+	std::string callable;
+	boost::python::object name;        // callable as an interned string
+	boost::python::object ns;          // module __dict__, None until found
+    };
+    PyObject *lookup(cached_callable &c);
+    std::deque<cached_callable> callables; // push_back keeps references valid
+    std::map<std::string, int> callable_handles;
     std::vector<std::string> inittab_entries;
     int status;
     time_t module_mtime;                  // toplevel module - last modification time
@@ -88,6 +130,8 @@ private:
     std::string exception_msg;
     std::string error_msg;
     int log_level;
+    int watch_fd;                         // inotify on the toplevel's directory, -1 if none
+    bool reload_pending;                  // toplevel may have changed, stat it
 };
 
 #endif
@@ -23,7 +23,17 @@
 #include "rs274ngc_interp.hh"
 #include "interp_return.hh"
 #include "canon.hh"
+#include "python_plugin.hh"
 #include "config.h"		// LINELEN
+#include "previewkins.hh"
+#include "stocksim.hh"
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <string>
+#include <vector>
 
 int _task = 0; // control preview behaviour when remapping
 
@@ -137,6 +147,532 @@ static PyTypeObject LineCodeType = {
     0,                      /*tp_is_gc*/
 };
 
+static void unrotate(double &x, double &y, double c, double s) {
+    double tx = x * c + y * s;
+    y = -x * s + y * c;
+    x = tx;
+}
+
+static void rotate(double &x, double &y, double c, double s) {
+    double tx = x * c - y * s;
+    y = x * s + y * c;
+    x = tx;
+}
+
+// Preview geometry collected by the canon calls themselves instead of by
+// Python callbacks (see 'native_geometry' below).  Each kind of move has
+// its own part; every segment adds two vertices.
+enum { GEOMETRY_TRAVERSE, GEOMETRY_FEED, GEOMETRY_ARCFEED, GEOMETRY_PARTS };
+enum { ARRAY_VERTICES, ARRAY_COLORS, ARRAY_LINES, ARRAY_OFFSETS,
+       ARRAY_FEEDRATES };
+
+struct geometry_part {
+    std::vector<float> vertices;        // x, y, z of both ends
+    std::vector<unsigned char> colors;  // r, g, b, a of both ends
+    std::vector<int> lines;             // line number of each segment
+    std::vector<float> offsets;         // tool length offset x, y, z
+    std::vector<float> feedrates;       // units per second, 0 for traverses
+    std::vector<int> pockets;           // of the tool in the spindle
+    std::vector<unsigned> order;        // of the segment among all parts
+    unsigned char color[4];
+};
+
+typedef struct {
+    PyObject_HEAD
+    geometry_part *part[GEOMETRY_PARTS];
+    int exports;        // buffers handed out; the arrays must not move
+    bool busy;          // being filled by a parse
+    int arcdivision;
+    double arctolerance;    // chord tolerance of arcs; 0 to use arcdivision
+    // the callback's state that decides where the next move goes
+    double lo[9], g5x[9], g92[9], tlo[9];
+    double rotation_cos, rotation_sin;
+    double feedrate;
+    int plane, suppress, pocket;
+    unsigned segments;
+    bool first_move;
+    // segments of lines outside the window are not kept, but the
+    // extents cover every segment
+    int window_first, window_last;
+    double extents[4][3];
+} Geometry;
+
+typedef struct {
+    PyObject_HEAD
+    Geometry *owner;
+    int kind, which;
+    Py_ssize_t shape[2], strides[2];
+} GeometryArray;
+
+static void Geometry_reset(Geometry *g) {
+    for(int i=0; i<GEOMETRY_PARTS; i++) {
+        geometry_part *p = g->part[i];
+        p->vertices.clear();
+        p->colors.clear();
+        p->lines.clear();
+        p->offsets.clear();
+        p->feedrates.clear();
+        p->pockets.clear();
+        p->order.clear();
+    }
+    for(int ax=0; ax<9; ax++)
+        g->lo[ax] = g->g5x[ax] = g->g92[ax] = g->tlo[ax] = 0;
+    g->rotation_cos = 1;
+    g->rotation_sin = 0;
+    g->feedrate = 1;
+    g->plane = 1;
+    g->suppress = 0;
+    g->pocket = 0;
+    g->segments = 0;
+    g->first_move = true;
+    for(int i=0; i<3; i++) {
+        g->extents[0][i] = g->extents[2][i] = 9e99;
+        g->extents[1][i] = g->extents[3][i] = -9e99;
+    }
+}
+
+// min and max, then min and max with the tool length offset, rounded
+// to floats like the vertices
+static void Geometry_extend(Geometry *g, const double *a) {
+    for(int i=0; i<3; i++) {
+        double c = (float)a[i], t = c + (float)g->tlo[i];
+        g->extents[0][i] = std::min(g->extents[0][i], c);
+        g->extents[1][i] = std::max(g->extents[1][i], c);
+        g->extents[2][i] = std::min(g->extents[2][i], t);
+        g->extents[3][i] = std::max(g->extents[3][i], t);
+    }
+}
+
+static void Geometry_add(Geometry *g, int kind, int line,
+        const double *a, const double *b) {
+    Geometry_extend(g, a);
+    Geometry_extend(g, b);
+    if(line < g->window_first || line > g->window_last) return;
+    geometry_part *p = g->part[kind];
+    for(int i=0; i<3; i++) p->vertices.push_back(a[i]);
+    for(int i=0; i<3; i++) p->vertices.push_back(b[i]);
+    p->colors.insert(p->colors.end(), p->color, p->color + 4);
+    p->colors.insert(p->colors.end(), p->color, p->color + 4);
+    p->lines.push_back(line);
+    for(int i=0; i<3; i++) p->offsets.push_back(g->tlo[i]);
+    p->feedrates.push_back(kind == GEOMETRY_TRAVERSE ? 0 : g->feedrate);
+    p->pockets.push_back(g->pocket);
+    p->order.push_back(g->segments++);
+}
+
+static bool Geometry_color(PyObject *o, unsigned char color[4]) {
+    double c[4] = {1, 1, 1, 1};
+    if(o && !PyArg_ParseTuple(o, "ddd|d:geometry color",
+                &c[0], &c[1], &c[2], &c[3]))
+        return false;
+    for(int i=0; i<4; i++)
+        color[i] = (unsigned char)(std::max(0., std::min(1., c[i])) * 255 + .5);
+    return true;
+}
+
+static PyObject *Geometry_new(PyTypeObject *type, PyObject *args, PyObject *kw) {
+    Geometry *g = (Geometry*)type->tp_alloc(type, 0);
+    if(!g) return NULL;
+    for(int i=0; i<GEOMETRY_PARTS; i++) {
+        g->part[i] = new geometry_part;
+        Geometry_color(0, g->part[i]->color);
+    }
+    g->exports = 0;
+    g->busy = false;
+    g->arcdivision = 64;
+    g->arctolerance = 0;
+    g->window_first = 0;
+    g->window_last = INT_MAX;
+    Geometry_reset(g);
+    return (PyObject*)g;
+}
+
+static int Geometry_init(Geometry *g, PyObject *args, PyObject *kw) {
+    static const char *kwlist[] = {"traverse", "feed", "arcfeed",
+        "arcdivision", "arctolerance", NULL};
+    PyObject *c[GEOMETRY_PARTS] = {0, 0, 0};
+    if(!PyArg_ParseTupleAndKeywords(args, kw, "|OOOid:geometry",
+                (char**)kwlist, &c[0], &c[1], &c[2], &g->arcdivision,
+                &g->arctolerance))
+        return -1;
+    for(int i=0; i<GEOMETRY_PARTS; i++)
+        if(!Geometry_color(c[i], g->part[i]->color)) return -1;
+    return 0;
+}
+
+static void Geometry_dealloc(Geometry *g) {
+    for(int i=0; i<GEOMETRY_PARTS; i++) delete g->part[i];
+    Py_TYPE(g)->tp_free((PyObject*)g);
+}
+
+// A view of one array of a geometry object through the buffer protocol,
+// e.g. numpy.frombuffer(g.vertices(gcode.FEED), 'f').reshape(-1, 3)
+static Py_ssize_t GeometryArray_layout(GeometryArray *a, void **data,
+        Py_ssize_t *itemsize, Py_ssize_t *width, const char **format) {
+    static char empty;
+    geometry_part *p = a->owner->part[a->kind];
+    size_t n;
+    switch(a->which) {
+    case ARRAY_VERTICES:
+        n = p->vertices.size(); *data = n ? &p->vertices[0] : 0;
+        *itemsize = sizeof(float); *width = 3; *format = "f";
+        break;
+    case ARRAY_COLORS:
+        n = p->colors.size(); *data = n ? &p->colors[0] : 0;
+        *itemsize = 1; *width = 4; *format = "B";
+        break;
+    case ARRAY_LINES:
+        n = p->lines.size(); *data = n ? &p->lines[0] : 0;
+        *itemsize = sizeof(int); *width = 1; *format = "i";
+        break;
+    case ARRAY_OFFSETS:
+        n = p->offsets.size(); *data = n ? &p->offsets[0] : 0;
+        *itemsize = sizeof(float); *width = 3; *format = "f";
+        break;
+    default:
+        n = p->feedrates.size(); *data = n ? &p->feedrates[0] : 0;
+        *itemsize = sizeof(float); *width = 1; *format = "f";
+        break;
+    }
+    if(!*data) *data = &empty;
+    return n / *width;
+}
+
+static int GeometryArray_getbuffer(GeometryArray *a, Py_buffer *view, int flags) {
+    void *data;
+    Py_ssize_t itemsize, width;
+    const char *format;
+    if(flags & PyBUF_WRITABLE) {
+        PyErr_SetString(PyExc_BufferError, "geometry arrays are read-only");
+        view->obj = NULL;
+        return -1;
+    }
+    if(a->owner->busy) {
+        PyErr_SetString(PyExc_BufferError, "geometry is being parsed into");
+        view->obj = NULL;
+        return -1;
+    }
+    Py_ssize_t n = GeometryArray_layout(a, &data, &itemsize, &width, &format);
+    a->shape[0] = n;
+    a->shape[1] = width;
+    a->strides[0] = itemsize * width;
+    a->strides[1] = itemsize;
+    view->buf = data;
+    view->obj = (PyObject*)a;
+    Py_INCREF(a);
+    view->len = n * width * itemsize;
+    view->readonly = 1;
+    view->itemsize = itemsize;
+    view->format = (flags & PyBUF_FORMAT) ? (char*)format : NULL;
+    view->ndim = (flags & PyBUF_ND) && width > 1 ? 2 : 1;
+    view->shape = (flags & PyBUF_ND) ? a->shape : NULL;
+    view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? a->strides : NULL;
+    view->suboffsets = NULL;
+    view->internal = NULL;
+    a->owner->exports++;
+    return 0;
+}
+
+static void GeometryArray_releasebuffer(GeometryArray *a, Py_buffer *view) {
+    a->owner->exports--;
+}
+
+static Py_ssize_t GeometryArray_length(GeometryArray *a) {
+    void *data;
+    Py_ssize_t itemsize, width;
+    const char *format;
+    return GeometryArray_layout(a, &data, &itemsize, &width, &format);
+}
+
+static void GeometryArray_dealloc(GeometryArray *a) {
+    Py_DECREF(a->owner);
+    PyObject_Del(a);
+}
+
+static PySequenceMethods GeometryArraySequence;
+static PyBufferProcs GeometryArrayBuffer;
+
+static PyTypeObject GeometryArrayType = {
+    PyObject_HEAD_INIT(NULL)
+    0,                      /*ob_size*/
+    "gcode.geometry_array", /*tp_name*/
+    sizeof(GeometryArray),  /*tp_basicsize*/
+    0,                      /*tp_itemsize*/
+    /* methods */
+    (destructor)GeometryArray_dealloc, /*tp_dealloc*/
+    0,                      /*tp_print*/
+    0,                      /*tp_getattr*/
+    0,                      /*tp_setattr*/
+    0,                      /*tp_compare*/
+    0,                      /*tp_repr*/
+    0,                      /*tp_as_number*/
+    &GeometryArraySequence, /*tp_as_sequence*/
+    0,                      /*tp_as_mapping*/
+    0,                      /*tp_hash*/
+    0,                      /*tp_call*/
+    0,                      /*tp_str*/
+    0,                      /*tp_getattro*/
+    0,                      /*tp_setattro*/
+    &GeometryArrayBuffer,   /*tp_as_buffer*/
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_NEWBUFFER, /*tp_flags*/
+};
+
+static bool Geometry_kind(PyObject *args, int *kind) {
+    if(!PyArg_ParseTuple(args, "i", kind)) return false;
+    if(*kind < 0 || *kind >= GEOMETRY_PARTS) {
+        PyErr_Format(PyExc_ValueError, "no geometry kind %d", *kind);
+        return false;
+    }
+    return true;
+}
+
+static PyObject *Geometry_array(Geometry *g, PyObject *args, int which) {
+    int kind;
+    if(!Geometry_kind(args, &kind)) return NULL;
+    GeometryArray *a = PyObject_New(GeometryArray, &GeometryArrayType);
+    if(!a) return NULL;
+    Py_INCREF(g);
+    a->owner = g;
+    a->kind = kind;
+    a->which = which;
+    return (PyObject*)a;
+}
+
+static PyObject *Geometry_vertices(Geometry *g, PyObject *args) {
+    return Geometry_array(g, args, ARRAY_VERTICES);
+}
+static PyObject *Geometry_colors(Geometry *g, PyObject *args) {
+    return Geometry_array(g, args, ARRAY_COLORS);
+}
+static PyObject *Geometry_lines(Geometry *g, PyObject *args) {
+    return Geometry_array(g, args, ARRAY_LINES);
+}
+static PyObject *Geometry_offsets(Geometry *g, PyObject *args) {
+    return Geometry_array(g, args, ARRAY_OFFSETS);
+}
+static PyObject *Geometry_feedrates(Geometry *g, PyObject *args) {
+    return Geometry_array(g, args, ARRAY_FEEDRATES);
+}
+
+static PyObject *Geometry_count(Geometry *g, PyObject *args) {
+    int kind;
+    if(!Geometry_kind(args, &kind)) return NULL;
+    return PyInt_FromLong(g->part[kind]->lines.size());
+}
+
+static PyObject *Geometry_clear(Geometry *g, PyObject *args) {
+    if(g->exports || g->busy) {
+        PyErr_SetString(PyExc_BufferError, "geometry arrays are in use");
+        return NULL;
+    }
+    Geometry_reset(g);
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+// the same four extents as calc_extents() finds for the Python lists,
+// of every segment of the last parse whether in the window or not
+static PyObject *Geometry_extents(Geometry *g, PyObject *args) {
+    const double (*e)[3] = g->extents;
+    return Py_BuildValue("[ddd][ddd][ddd][ddd]",
+        e[0][0], e[0][1], e[0][2], e[1][0], e[1][1], e[1][2],
+        e[2][0], e[2][1], e[2][2], e[3][0], e[3][1], e[3][2]);
+}
+
+// set_window([first, last]): keep only the segments of lines first..last
+// from the next parse on, or all of them again without arguments.
+// set_window(0, -1) keeps none, for a parse that only finds the extents.
+static PyObject *Geometry_set_window(Geometry *g, PyObject *args) {
+    int first = 0, last = INT_MAX;
+    if(!PyArg_ParseTuple(args, "|ii:set_window", &first, &last))
+        return NULL;
+    g->window_first = first;
+    g->window_last = last;
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+static PyObject *Geometry_lo(Geometry *g) {
+    return Py_BuildValue("(ddddddddd)", g->lo[0], g->lo[1], g->lo[2],
+        g->lo[3], g->lo[4], g->lo[5], g->lo[6], g->lo[7], g->lo[8]);
+}
+
+static PyMethodDef GeometryMethods[] = {
+    {"vertices", (PyCFunction)Geometry_vertices, METH_VARARGS,
+        "Segment end points of one kind of move, float32 x, y, z"},
+    {"colors", (PyCFunction)Geometry_colors, METH_VARARGS,
+        "Vertex colors of one kind of move, uint8 r, g, b, a"},
+    {"lines", (PyCFunction)Geometry_lines, METH_VARARGS,
+        "Line number of each segment, int32"},
+    {"offsets", (PyCFunction)Geometry_offsets, METH_VARARGS,
+        "Tool length offset of each segment, float32 x, y, z"},
+    {"feedrates", (PyCFunction)Geometry_feedrates, METH_VARARGS,
+        "Feed rate of each segment, float32"},
+    {"count", (PyCFunction)Geometry_count, METH_VARARGS,
+        "Number of segments of one kind of move"},
+    {"clear", (PyCFunction)Geometry_clear, METH_NOARGS,
+        "Forget all segments"},
+    {"extents", (PyCFunction)Geometry_extents, METH_NOARGS,
+        "Extents with and without tool offset, like calc_extents"},
+    {"set_window", (PyCFunction)Geometry_set_window, METH_VARARGS,
+        "Keep only the segments of a range of lines"},
+    {NULL}
+};
+
+static PyGetSetDef GeometryGetSet[] = {
+    {(char*)"lo", (getter)Geometry_lo},
+    {NULL, NULL},
+};
+
+static PyMemberDef GeometryMembers[] = {
+    {(char*)"arcdivision", T_INT, offsetof(Geometry, arcdivision), 0},
+    {(char*)"arctolerance", T_DOUBLE, offsetof(Geometry, arctolerance), 0},
+    {NULL}
+};
+
+static PyTypeObject GeometryType = {
+    PyObject_HEAD_INIT(NULL)
+    0,                      /*ob_size*/
+    "gcode.geometry",       /*tp_name*/
+    sizeof(Geometry),       /*tp_basicsize*/
+    0,                      /*tp_itemsize*/
+    /* methods */
+    (destructor)Geometry_dealloc, /*tp_dealloc*/
+    0,                      /*tp_print*/
+    0,                      /*tp_getattr*/
+    0,                      /*tp_setattr*/
+    0,                      /*tp_compare*/
+    0,                      /*tp_repr*/
+    0,                      /*tp_as_number*/
+    0,                      /*tp_as_sequence*/
+    0,                      /*tp_as_mapping*/
+    0,                      /*tp_hash*/
+    0,                      /*tp_call*/
+    0,                      /*tp_str*/
+    0,                      /*tp_getattro*/
+    0,                      /*tp_setattro*/
+    0,                      /*tp_as_buffer*/
+    Py_TPFLAGS_DEFAULT,     /*tp_flags*/
+    "Preview geometry filled in by parse() without Python callbacks", /*tp_doc*/
+    0,                      /*tp_traverse*/
+    0,                      /*tp_clear*/
+    0,                      /*tp_richcompare*/
+    0,                      /*tp_weaklistoffset*/
+    0,                      /*tp_iter*/
+    0,                      /*tp_iternext*/
+    GeometryMethods,        /*tp_methods*/
+    GeometryMembers,        /*tp_members*/
+    GeometryGetSet,         /*tp_getset*/
+    0,                      /*tp_base*/
+    0,                      /*tp_dict*/
+    0,                      /*tp_descr_get*/
+    0,                      /*tp_descr_set*/
+    0,                      /*tp_dictoffset*/
+    (initproc)Geometry_init, /*tp_init*/
+    0,                      /*tp_alloc*/
+    Geometry_new,           /*tp_new*/
+    0,                      /*tp_free*/
+    0,                      /*tp_is_gc*/
+};
+
+
+// Most segments a full turn of an arc is split into by a chord tolerance
+#define ARC_MAX_STEPS_PER_TURN 4096
+
+// Split an arc starting at lo (machine position) into straight segments.
+// The end points go to pts, nine values per point, and their number is
+// returned; the last one is the end of the arc.  With a tolerance above
+// zero the segments are as long as they can be without their middles
+// straying from the arc by more than it; otherwise a semicircle is split
+// into max_segments parts.
+static int arc_points(const double *lo, double x1, double y1,
+        double cx, double cy, int rot, double z1,
+        double a, double b, double c, double u, double v, double w,
+        int plane, const double *g5xoffset, const double *g92offset,
+        double rotation_cos, double rotation_sin, int max_segments,
+        double tolerance, std::vector<double> &pts) {
+    double n[9];
+    int X, Y, Z;
+
+    if(plane == 1) {
+        X=0; Y=1; Z=2;
+    } else if(plane == 3) {
+        X=2; Y=0; Z=1;
+    } else {
+        X=1; Y=2; Z=0;
+    }
+    n[X] = x1;
+    n[Y] = y1;
+    n[Z] = z1;
+    n[3] = a;
+    n[4] = b;
+    n[5] = c;
+    n[6] = u;
+    n[7] = v;
+    n[8] = w;
+    double o[9];
+    for(int ax=0; ax<9; ax++) o[ax] = lo[ax] - g5xoffset[ax];
+    unrotate(o[0], o[1], rotation_cos, rotation_sin);
+    for(int ax=0; ax<9; ax++) o[ax] -= g92offset[ax];
+
+    double theta1 = atan2(o[Y]-cy, o[X]-cx);
+    double theta2 = atan2(n[Y]-cy, n[X]-cx);
+
+    if(rot < 0) {
+        while(theta2 - theta1 > -CIRCLE_FUZZ) theta2 -= 2*M_PI;
+    } else {
+        while(theta2 - theta1 < CIRCLE_FUZZ) theta2 += 2*M_PI;
+    }
+
+    // if multi-turn, add the right number of full circles
+    if(rot < -1) theta2 += 2*M_PI*(rot+1);
+    if(rot > 1) theta2 += 2*M_PI*(rot-1);
+
+    int steps;
+    double turns = fabs(theta1 - theta2) / (2*M_PI);
+    double r = hypot(o[X]-cx, o[Y]-cy);
+    if(tolerance > 0 && r > tolerance) {
+        // a chord spanning 2*acos(1 - tol/r) is tol from the arc at its middle
+        double per_turn = M_PI / acos(1 - tolerance / r);
+        per_turn = std::min(per_turn, (double)ARC_MAX_STEPS_PER_TURN);
+        steps = std::max(3, int(ceil(per_turn * turns)));
+    } else if(tolerance > 0) {
+        steps = 3;
+    } else {
+        steps = std::max(3, int(max_segments * fabs(theta1 - theta2) / M_PI));
+    }
+    double rsteps = 1. / steps;
+    pts.resize(steps * 9);
+
+    double dtheta = theta2 - theta1;
+    double d[9] = {0, 0, 0, n[3]-o[3], n[4]-o[4], n[5]-o[5], n[6]-o[6], n[7]-o[7], n[8]-o[8]};
+    d[Z] = n[Z] - o[Z];
+
+    double tx = o[X] - cx, ty = o[Y] - cy, dc = cos(dtheta*rsteps), ds = sin(dtheta*rsteps);
+    for(int i=0; i<steps-1; i++) {
+        double f = (i+1) * rsteps;
+        double *p = &pts[i*9];
+        rotate(tx, ty, dc, ds);
+        p[X] = tx + cx;
+        p[Y] = ty + cy;
+        p[Z] = o[Z] + d[Z] * f;
+        p[3] = o[3] + d[3] * f;
+        p[4] = o[4] + d[4] * f;
+        p[5] = o[5] + d[5] * f;
+        p[6] = o[6] + d[6] * f;
+        p[7] = o[7] + d[7] * f;
+        p[8] = o[8] + d[8] * f;
+        for(int ax=0; ax<9; ax++) p[ax] += g92offset[ax];
+        rotate(p[0], p[1], rotation_cos, rotation_sin);
+        for(int ax=0; ax<9; ax++) p[ax] += g5xoffset[ax];
+    }
+    for(int ax=0; ax<9; ax++) n[ax] += g92offset[ax];
+    rotate(n[0], n[1], rotation_cos, rotation_sin);
+    for(int ax=0; ax<9; ax++) n[ax] += g5xoffset[ax];
+    std::copy(n, n + 9, &pts[(steps-1)*9]);
+    return steps;
+}
+
 static PyObject *callback;
 static int interp_error;
 static int last_sequence_number;
@@ -149,8 +685,17 @@ static InterpBase *pinterp;
 
 #define callmethod(o, m, f, ...) PyObject_CallMethod((o), (char*)(m), (char*)(f), ## __VA_ARGS__)
 
+// The GIL is released while the interpreter reads and executes a block
+// (see allow_threads); a canon call that needs Python takes it back for
+// its duration with a python_lock, as the interpreter does around its own
+// use of Python.  Only one parse runs at a time.
+static PyThreadState *parse_thread;
+
+typedef PythonLock python_lock;
+
 static void maybe_new_line(int sequence_number=interp_new.sequence_number());
 static void maybe_new_line(int sequence_number) {
+    python_lock gil;
     if(!pinterp) return;
     if(interp_error) return;
     if(sequence_number == last_sequence_number)
@@ -169,6 +714,71 @@ static void maybe_new_line(int sequence_number) {
     Py_XDECREF(result);
 }
 
+// When the callback object has a 'native_geometry' attribute holding a
+// gcode.geometry, the moves are recorded there by the canon calls below
+// and Python only sees the calls that change its state.  The geometry
+// keeps its own copy of the few attributes of GLCanon a move depends on.
+static Geometry *native;
+
+static void native_sync_lo() {
+    PyObject *lo = Geometry_lo(native);
+    if(!lo || PyObject_SetAttrString(callback, "lo", lo) < 0) interp_error ++;
+    Py_XDECREF(lo);
+}
+
+static void native_read_suppress() {
+    PyObject *s = PyObject_GetAttrString(callback, "suppress");
+    if(!s) { PyErr_Clear(); return; }
+    native->suppress = PyInt_AsLong(s);
+    if(PyErr_Occurred()) { PyErr_Clear(); native->suppress = 0; }
+    Py_DECREF(s);
+}
+
+static bool start_native() {
+    Py_XDECREF(native);
+    native = 0;
+    PyObject *g = PyObject_GetAttrString(callback, "native_geometry");
+    if(!g) { PyErr_Clear(); return true; }
+    if(!PyObject_TypeCheck(g, &GeometryType)) { Py_DECREF(g); return true; }
+    native = (Geometry*)g;
+    if(native->exports || native->busy) {
+        PyErr_SetString(PyExc_BufferError,
+                "native_geometry arrays are in use");
+        Py_DECREF(native);
+        native = 0;
+        return false;
+    }
+    Geometry_reset(native);
+    native->busy = true;
+    native_read_suppress();
+    return true;
+}
+
+static void end_native() {
+    if(!native) return;
+    if(!interp_error) native_sync_lo();
+    native->busy = false;
+    Py_DECREF(native);
+    native = 0;
+}
+
+static void native_translate(const double *p, double *l) {
+    for(int ax=0; ax<9; ax++) l[ax] = p[ax] + native->g92[ax];
+    rotate(l[0], l[1], native->rotation_cos, native->rotation_sin);
+    for(int ax=0; ax<9; ax++) l[ax] += native->g5x[ax];
+}
+
+static void native_straight(int kind, int line_number,
+        double x, double y, double z, double a, double b, double c,
+        double u, double v, double w) {
+    if(interp_error || native->suppress > 0) return;
+    double p[9] = {x, y, z, a, b, c, u, v, w}, l[9];
+    native_translate(p, l);
+    if(kind != GEOMETRY_TRAVERSE) native->first_move = false;
+    if(!native->first_move) Geometry_add(native, kind, line_number, native->lo, l);
+    memcpy(native->lo, l, sizeof(l));
+}
+
 void NURBS_FEED(int line_number, std::vector<CONTROL_POINT> nurbs_control_points, unsigned int k) {
     double u = 0.0;
     unsigned int n = nurbs_control_points.size() - 1;
@@ -203,6 +813,25 @@ void ARC_FEED(int line_number,
         v_position /= 25.4;
         w_position /= 25.4;
     }
+    if(native) {
+        if(interp_error || native->suppress > 0) return;
+        native->first_move = false;
+        std::vector<double> pts;
+        int steps = arc_points(native->lo, first_end, second_end,
+                first_axis, second_axis, rotation, axis_end_point,
+                a_position, b_position, c_position,
+                u_position, v_position, w_position, native->plane,
+                native->g5x, native->g92,
+                native->rotation_cos, native->rotation_sin,
+                native->arcdivision, native->arctolerance, pts);
+        for(int i=0; i<steps; i++) {
+            Geometry_add(native, GEOMETRY_ARCFEED, line_number,
+                    native->lo, &pts[i*9]);
+            std::copy(&pts[i*9], &pts[i*9] + 9, native->lo);
+        }
+        return;
+    }
+    python_lock gil;
     maybe_new_line(line_number);
     if(interp_error) return;
     PyObject *result =
@@ -223,6 +852,11 @@ void STRAIGHT_FEED(int line_number,
     _pos_a=a; _pos_b=b; _pos_c=c;
     _pos_u=u; _pos_v=v; _pos_w=w;
     if(metric) { x /= 25.4; y /= 25.4; z /= 25.4; u /= 25.4; v /= 25.4; w /= 25.4; }
+    if(native) {
+        native_straight(GEOMETRY_FEED, line_number, x, y, z, a, b, c, u, v, w);
+        return;
+    }
+    python_lock gil;
     maybe_new_line(line_number);
     if(interp_error) return;
     PyObject *result =
@@ -240,6 +874,11 @@ void STRAIGHT_TRAVERSE(int line_number,
     _pos_a=a; _pos_b=b; _pos_c=c;
     _pos_u=u; _pos_v=v; _pos_w=w;
     if(metric) { x /= 25.4; y /= 25.4; z /= 25.4; u /= 25.4; v /= 25.4; w /= 25.4; }
+    if(native) {
+        native_straight(GEOMETRY_TRAVERSE, line_number, x, y, z, a, b, c, u, v, w);
+        return;
+    }
+    python_lock gil;
     maybe_new_line(line_number);
     if(interp_error) return;
     PyObject *result =
@@ -253,9 +892,14 @@ void SET_G5X_OFFSET(int g5x_index,
                     double x, double y, double z,
                     double a, double b, double c,
                     double u, double v, double w) {
+    python_lock gil;
     if(metric) { x /= 25.4; y /= 25.4; z /= 25.4; u /= 25.4; v /= 25.4; w /= 25.4; }
     maybe_new_line();
     if(interp_error) return;
+    if(native) {
+        double o[9] = {x, y, z, a, b, c, u, v, w};
+        memcpy(native->g5x, o, sizeof(o));
+    }
     PyObject *result =
         callmethod(callback, "set_g5x_offset", "ifffffffff",
                             g5x_index, x, y, z, a, b, c, u, v, w);
@@ -266,9 +910,14 @@ void SET_G5X_OFFSET(int g5x_index,
 void SET_G92_OFFSET(double x, double y, double z,
                     double a, double b, double c,
                     double u, double v, double w) {
+    python_lock gil;
     if(metric) { x /= 25.4; y /= 25.4; z /= 25.4; u /= 25.4; v /= 25.4; w /= 25.4; }
     maybe_new_line();
     if(interp_error) return;
+    if(native) {
+        double o[9] = {x, y, z, a, b, c, u, v, w};
+        memcpy(native->g92, o, sizeof(o));
+    }
     PyObject *result =
         callmethod(callback, "set_g92_offset", "fffffffff",
                             x, y, z, a, b, c, u, v, w);
@@ -277,8 +926,13 @@ void SET_G92_OFFSET(double x, double y, double z,
 }
 
 void SET_XY_ROTATION(double t) {
+    python_lock gil;
     maybe_new_line();
     if(interp_error) return;
+    if(native) {
+        native->rotation_cos = cos(t * (M_PI / 180));
+        native->rotation_sin = sin(t * (M_PI / 180));
+    }
     PyObject *result =
         callmethod(callback, "set_xy_rotation", "f", t);
     if(result == NULL) interp_error ++;
@@ -288,8 +942,10 @@ void SET_XY_ROTATION(double t) {
 void USE_LENGTH_UNITS(CANON_UNITS u) { metric = u == CANON_UNITS_MM; }
 
 void SELECT_PLANE(CANON_PLANE pl) {
+    python_lock gil;
     maybe_new_line();   
     if(interp_error) return;
+    if(native) native->plane = pl;
     PyObject *result =
         callmethod(callback, "set_plane", "i", pl);
     if(result == NULL) interp_error ++;
@@ -297,6 +953,7 @@ void SELECT_PLANE(CANON_PLANE pl) {
 }
 
 void SET_TRAVERSE_RATE(double rate) {
+    python_lock gil;
     maybe_new_line();   
     if(interp_error) return;
     PyObject *result =
@@ -317,8 +974,13 @@ void SET_FEED_MODE(int mode) {
 }
 
 void CHANGE_TOOL(int pocket) {
+    python_lock gil;
     maybe_new_line();
     if(interp_error) return;
+    if(native) {
+        native->first_move = true;
+        native->pocket = pocket;
+    }
     PyObject *result = 
         callmethod(callback, "change_tool", "i", pocket);
     if(result == NULL) interp_error ++;
@@ -326,6 +988,7 @@ void CHANGE_TOOL(int pocket) {
 }
 
 void CHANGE_TOOL_NUMBER(int pocket) {
+    python_lock gil;
     maybe_new_line();
     if(interp_error) return;
 }
@@ -336,9 +999,11 @@ void CHANGE_TOOL_NUMBER(int pocket) {
  * time feed wrong anyway..
  */
 void SET_FEED_RATE(double rate) {
+    python_lock gil;
     maybe_new_line();   
     if(interp_error) return;
     if(metric) rate /= 25.4;
+    if(native) native->feedrate = rate / 60.;
     PyObject *result =
         callmethod(callback, "set_feed_rate", "f", rate);
     if(result == NULL) interp_error ++;
@@ -346,8 +1011,10 @@ void SET_FEED_RATE(double rate) {
 }
 
 void DWELL(double time) {
+    python_lock gil;
     maybe_new_line();   
     if(interp_error) return;
+    if(native) native_sync_lo();
     PyObject *result =
         callmethod(callback, "dwell", "f", time);
     if(result == NULL) interp_error ++;
@@ -355,6 +1022,7 @@ void DWELL(double time) {
 }
 
 void MESSAGE(char *comment) {
+    python_lock gil;
     maybe_new_line();   
     if(interp_error) return;
     PyObject *result =
@@ -369,12 +1037,14 @@ void LOGAPPEND(char *f) {}
 void LOGCLOSE() {}
 
 void COMMENT(const char *comment) {
+    python_lock gil;
     maybe_new_line();   
     if(interp_error) return;
     PyObject *result =
         callmethod(callback, "comment", "s", comment);
     if(result == NULL) interp_error ++;
     Py_XDECREF(result);
+    if(native) native_read_suppress();
 }
 
 void SET_TOOL_TABLE_ENTRY(int pocket, int toolno, EmcPose offset, double diameter,
@@ -382,12 +1052,22 @@ void SET_TOOL_TABLE_ENTRY(int pocket, int toolno, EmcPose offset, double diamete
 }
 
 void USE_TOOL_LENGTH_OFFSET(EmcPose offset) {
+    python_lock gil;
     tool_offset = offset;
     maybe_new_line();
     if(interp_error) return;
     if(metric) {
         offset.tran.x /= 25.4; offset.tran.y /= 25.4; offset.tran.z /= 25.4;
         offset.u /= 25.4; offset.v /= 25.4; offset.w /= 25.4; }
+    if(native) {
+        double o[9] = {offset.tran.x, offset.tran.y, offset.tran.z,
+            offset.a, offset.b, offset.c, offset.u, offset.v, offset.w};
+        native_sync_lo();
+        for(int ax=0; ax<9; ax++)
+            native->lo[ax] += native->tlo[ax] - o[ax];
+        memcpy(native->tlo, o, sizeof(o));
+        native->first_move = true;
+    }
     PyObject *result = callmethod(callback, "tool_offset", "ddddddddd", offset.tran.x, offset.tran.y, offset.tran.z,
         offset.a, offset.b, offset.c, offset.u, offset.v, offset.w);
     if(result == NULL) interp_error ++;
@@ -420,6 +1100,7 @@ int  GET_EXTERNAL_TC_REASON() {return 0;}
 
 
 extern bool GET_BLOCK_DELETE(void) { 
+    python_lock gil;
     int bd = 0;
     if(interp_error) return 0;
     PyObject *result =
@@ -475,6 +1156,11 @@ void STRAIGHT_PROBE(int line_number,
     _pos_a=a; _pos_b=b; _pos_c=c;
     _pos_u=u; _pos_v=v; _pos_w=w;
     if(metric) { x /= 25.4; y /= 25.4; z /= 25.4; u /= 25.4; v /= 25.4; w /= 25.4; }
+    if(native) {
+        native_straight(GEOMETRY_FEED, line_number, x, y, z, a, b, c, u, v, w);
+        return;
+    }
+    python_lock gil;
     maybe_new_line(line_number);
     if(interp_error) return;
     PyObject *result =
@@ -487,6 +1173,17 @@ void STRAIGHT_PROBE(int line_number,
 void RIGID_TAP(int line_number,
                double x, double y, double z) {
     if(metric) { x /= 25.4; y /= 25.4; z /= 25.4; }
+    if(native) {
+        if(interp_error || native->suppress > 0) return;
+        native->first_move = false;
+        double p[9] = {x, y, z, 0, 0, 0, 0, 0, 0}, l[9];
+        native_translate(p, l);
+        for(int ax=3; ax<9; ax++) l[ax] = native->lo[ax];
+        Geometry_add(native, GEOMETRY_FEED, line_number, native->lo, l);
+        Geometry_add(native, GEOMETRY_FEED, line_number, l, native->lo);
+        return;
+    }
+    python_lock gil;
     maybe_new_line(line_number);
     if(interp_error) return;
     PyObject *result =
@@ -518,6 +1215,7 @@ double GET_EXTERNAL_POSITION_V() { return _pos_v; }
 double GET_EXTERNAL_POSITION_W() { return _pos_w; }
 void INIT_CANON() {}
 void GET_EXTERNAL_PARAMETER_FILE_NAME(char *name, int max_size) {
+    python_lock gil;
     PyObject *result = PyObject_GetAttrString(callback, "parameter_file");
     if(!result) { name[0] = 0; return; }
     char *s = PyString_AsString(result);    
@@ -527,6 +1225,7 @@ void GET_EXTERNAL_PARAMETER_FILE_NAME(char *name, int max_size) {
 }
 int GET_EXTERNAL_LENGTH_UNIT_TYPE() { return CANON_UNITS_INCHES; }
 CANON_TOOL_TABLE GET_EXTERNAL_TOOL_TABLE(int pocket) {
+    python_lock gil;
     CANON_TOOL_TABLE t = {-1,{{0,0,0},0,0,0,0,0,0},0,0,0,0};
     if(interp_error) return t;
     PyObject *result =
@@ -546,8 +1245,10 @@ double GET_EXTERNAL_ANALOG_INPUT(int index, double def) { return def; }
 int WAIT(int index, int input_type, int wait_type, double timeout) { return 0;}
 
 static void user_defined_function(int num, double arg1, double arg2) {
+    python_lock gil;
     if(interp_error) return;
     maybe_new_line();
+    if(native) native_sync_lo();
     PyObject *result =
         callmethod(callback, "user_defined_function",
                             "idd", num, arg1, arg2);
@@ -576,6 +1277,7 @@ int GET_EXTERNAL_ADAPTIVE_FEED_ENABLE() {return 0;}
 int GET_EXTERNAL_FEED_HOLD_ENABLE() {return 1;}
 
 int GET_EXTERNAL_AXIS_MASK() {
+    python_lock gil;
     if(interp_error) return 7;
     PyObject *result =
         callmethod(callback, "get_axis_mask", "");
@@ -629,6 +1331,7 @@ static bool PyFloat_CheckAndError(const char *func, PyObject *p)  {
 }
 
 double GET_EXTERNAL_ANGLE_UNITS() {
+    python_lock gil;
     PyObject *result =
         callmethod(callback, "get_external_angular_units", "");
     if(result == NULL) interp_error++;
@@ -644,6 +1347,7 @@ double GET_EXTERNAL_ANGLE_UNITS() {
 }
 
 double GET_EXTERNAL_LENGTH_UNITS() {
+    python_lock gil;
     PyObject *result =
         callmethod(callback, "get_external_length_units", "");
     if(result == NULL) interp_error++;
@@ -681,36 +1385,309 @@ CANON_MOTION_MODE GET_EXTERNAL_MOTION_CONTROL_MODE() { return motion_mode; }
 void SET_NAIVECAM_TOLERANCE(double tolerance) { }
 
 #define RESULT_OK (result == INTERP_OK || result == INTERP_EXECUTE_FINISH)
-static PyObject *parse_file(PyObject *self, PyObject *args) {
-    char *f;
-    char *unitcode=0, *initcode=0, *interpname=0;
-    int error_line_offset = 0;
-    struct timeval t0, t1;
-    int wait = 1;
-    if(!PyArg_ParseTuple(args, "sO|sss", &f, &callback, &unitcode, &initcode, &interpname))
-        return NULL;
 
-    if(pinterp) {
-        delete pinterp;
-        pinterp = 0;
+// parse() and reparse() share the interpreter and the state above, and
+// the interpreter library itself keeps some state in globals
+static pthread_mutex_t parse_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t parse_owner;
+
+static bool lock_parse() {
+    if(pthread_mutex_trylock(&parse_mutex) != 0) {
+        if(pthread_equal(parse_owner, pthread_self())) {
+            PyErr_SetString(PyExc_RuntimeError,
+                    "gcode.parse called from inside a parse");
+            return false;
+        }
+        Py_BEGIN_ALLOW_THREADS
+        pthread_mutex_lock(&parse_mutex);
+        Py_END_ALLOW_THREADS
     }
-    if(interpname && *interpname)
-        pinterp = interp_from_shlib(interpname);
-    if(!pinterp)
-        pinterp = new Interp;
+    parse_owner = pthread_self();
+    return true;
+}
 
-    for(int i=0; i<USER_DEFINED_FUNCTION_NUM; i++) 
-        USER_DEFINED_FUNCTION[i] = user_defined_function;
+static void unlock_parse() {
+    parse_owner = pthread_t();
+    pthread_mutex_unlock(&parse_mutex);
+}
+
+// Let other threads run Python while the interpreter works.  Python
+// remaps and named parameters take the GIL back only while they run.
+static void allow_threads() {
+    parse_thread = PyEval_SaveThread();
+}
+
+static void end_allow_threads() {
+    if(!parse_thread) return;
+    PyEval_RestoreThread(parse_thread);
+    parse_thread = 0;
+}
+
+// Checkpoints for incremental re-parsing (see rs274_reparse).  Every
+// checkpoint_interval lines, when the interpreter is between two blocks of
+// the main program, the interpreter state, the state kept in this module
+// and whatever the callback object's checkpoint() method returns are saved.
+// The callback's value is a tuple (position, state) where state is compared
+// to decide whether two checkpoints are equivalent.
+struct parse_checkpoint {
+    InterpCheckpoint *interp;
+    PyObject *canon;
+    double pos[9];
+    bool metric;
+    CANON_MOTION_MODE motion_mode;
+    EmcPose tool_offset;
+    int last_sequence_number;
+};
+
+static std::vector<parse_checkpoint> checkpoints;
+static int checkpoint_interval = 0;
+// the arguments of the parse the checkpoints belong to, and how it ended
+static std::string checkpoint_key;
+static int checkpoint_result, checkpoint_last_line;
+// whether that parse filled a native geometry, so that its checkpoints
+// can only be resumed by parse_lines
+static bool checkpoint_native;
+
+static void free_checkpoint(parse_checkpoint &cp) {
+    delete cp.interp;
+    Py_XDECREF(cp.canon);
+    cp.interp = 0;
+    cp.canon = 0;
+}
+
+static void free_checkpoints(std::vector<parse_checkpoint> &v) {
+    for(size_t i = 0; i < v.size(); i++) free_checkpoint(v[i]);
+    v.clear();
+}
+
+static bool callback_can_resume() {
+    return PyObject_HasAttrString(callback, "checkpoint")
+        && PyObject_HasAttrString(callback, "rewind");
+}
+
+static bool callback_can_reparse() {
+    // the checkpoints do not cover a native geometry's contents
+    return !native && callback_can_resume()
+        && PyObject_HasAttrString(callback, "converge")
+        && PyObject_HasAttrString(callback, "relocate_checkpoint");
+}
+
+// During a native parse only the geometry keeps lo and first_move up to
+// date; the callback's copies go into its checkpoint.
+static void native_sync_checkpoint() {
+    native_sync_lo();
+    if(PyObject_SetAttrString(callback, "first_move",
+                native->first_move ? Py_True : Py_False) < 0)
+        interp_error ++;
+}
+
+static bool take_checkpoint(parse_checkpoint &cp) {
+    cp.interp = interp_new.checkpoint();
+    if(!cp.interp) return false;
+    if(native) native_sync_checkpoint();
+    if(interp_error) {
+        free_checkpoint(cp);
+        return false;
+    }
+    cp.canon = callmethod(callback, "checkpoint", "");
+    if(!cp.canon || !PyTuple_Check(cp.canon) || PyTuple_Size(cp.canon) != 2) {
+        if(cp.canon && !PyErr_Occurred())
+            PyErr_Format(PyExc_TypeError,
+                "checkpoint() must return a (position, state) tuple");
+        interp_error ++;
+        free_checkpoint(cp);
+        return false;
+    }
+    cp.pos[0] = _pos_x; cp.pos[1] = _pos_y; cp.pos[2] = _pos_z;
+    cp.pos[3] = _pos_a; cp.pos[4] = _pos_b; cp.pos[5] = _pos_c;
+    cp.pos[6] = _pos_u; cp.pos[7] = _pos_v; cp.pos[8] = _pos_w;
+    cp.metric = metric;
+    cp.motion_mode = motion_mode;
+    cp.tool_offset = tool_offset;
+    cp.last_sequence_number = last_sequence_number;
+    return true;
+}
+
+static void restore_checkpoint(const parse_checkpoint &cp) {
+    _pos_x = cp.pos[0]; _pos_y = cp.pos[1]; _pos_z = cp.pos[2];
+    _pos_a = cp.pos[3]; _pos_b = cp.pos[4]; _pos_c = cp.pos[5];
+    _pos_u = cp.pos[6]; _pos_v = cp.pos[7]; _pos_w = cp.pos[8];
+    metric = cp.metric;
+    motion_mode = cp.motion_mode;
+    tool_offset = cp.tool_offset;
+    last_sequence_number = cp.last_sequence_number;
+}
+
+static bool same_checkpoint(const parse_checkpoint &a, const parse_checkpoint &b) {
+    if(memcmp(a.pos, b.pos, sizeof(a.pos))) return false;
+    if(a.metric != b.metric || a.motion_mode != b.motion_mode) return false;
+    if(memcmp(&a.tool_offset, &b.tool_offset, sizeof(a.tool_offset)))
+        return false;
+    if(!interp_new.same_state(a.interp, b.interp)) return false;
+    int r = PyObject_RichCompareBool(PyTuple_GET_ITEM(a.canon, 1),
+            PyTuple_GET_ITEM(b.canon, 1), Py_EQ);
+    if(r < 0) { PyErr_Clear(); return false; }
+    return r;
+}
+
+// an incremental parse in progress: the checkpoints of the previous parse
+// that lie beyond the edited lines, in the old line numbering
+struct reparse_state {
+    std::vector<parse_checkpoint> old;
+    size_t next;
+    int last_line;      // last edited line, new numbering
+    int line_delta;     // lines added by the edit (negative if removed)
+};
+
+// At a line past the edit that matches an old checkpoint, compare states.
+// Once they agree the rest of the previous parse is still valid: hand the
+// old output back to the callback, move the old checkpoints to the new
+// numbering and stop.
+static bool try_converge(reparse_state *rs, int seq) {
+    while(rs->next < rs->old.size()
+            && rs->old[rs->next].interp->sequence_number + rs->line_delta < seq)
+        rs->next++;
+    if(rs->next == rs->old.size()) return false;
+    parse_checkpoint &o = rs->old[rs->next];
+    if(o.interp->sequence_number + rs->line_delta != seq) return false;
+
+    parse_checkpoint cp;
+    if(!take_checkpoint(cp)) return false;
+    if(!same_checkpoint(cp, o)) {
+        free_checkpoint(cp);
+        rs->next++;
+        return false;
+    }
+
+    PyObject *result = callmethod(callback, "converge", "OOi",
+            o.canon, cp.canon, rs->line_delta);
+    if(!result) {
+        interp_error ++;
+        free_checkpoint(cp);
+        return false;
+    }
+    Py_DECREF(result);
+
+    long from = o.interp->offset, delta = cp.interp->offset - from;
+    checkpoints.push_back(cp);
+    for(size_t i = rs->next + 1; i < rs->old.size(); i++) {
+        parse_checkpoint &later = rs->old[i];
+        PyObject *moved = callmethod(callback, "relocate_checkpoint", "OOO",
+                later.canon, o.canon, cp.canon);
+        if(!moved) { interp_error ++; break; }
+        Py_DECREF(later.canon);
+        later.canon = moved;
+        later.interp->relocate(from, delta, rs->line_delta, cp.interp);
+        later.last_sequence_number += rs->line_delta;
+        checkpoints.push_back(later);
+        later.interp = 0;
+        later.canon = 0;
+    }
+    free_checkpoints(rs->old);
+    return !interp_error;
+}
+
+static PyObject *run_parse(int result, reparse_state *rs) {
+    int error_line_offset = 0;
+    struct timeval t0, t1;
+    int wait = 1;
+    int next_checkpoint = interp_new.sequence_number();
+    bool converged = false;
 
     gettimeofday(&t0, NULL);
 
+    while(!interp_error && RESULT_OK) {
+        error_line_offset = 1;
+        if(checkpoint_interval > 0) {
+            int seq = interp_new.sequence_number();
+            if(rs && seq > rs->last_line && try_converge(rs, seq)) {
+                converged = true;
+                break;
+            }
+            if(interp_error) break;
+            parse_checkpoint cp;
+            if(seq >= next_checkpoint && take_checkpoint(cp)) {
+                checkpoints.push_back(cp);
+                next_checkpoint = seq + checkpoint_interval;
+            }
+            if(interp_error) break;
+        }
+        allow_threads();
+        result = interp_new.read();
+        end_allow_threads();
+        gettimeofday(&t1, NULL);
+        if(t1.tv_sec > t0.tv_sec + wait) {
+            if(check_abort()) { interp_error ++; break; }
+            t0 = t1;
+        }
+        if(!RESULT_OK) break;
+        error_line_offset = 0;
+        allow_threads();
+        result = interp_new.execute();
+        end_allow_threads();
+    }
+    if(rs) free_checkpoints(rs->old);
+out_error:
+    if(pinterp) pinterp->close();
+    end_native();
+    if(interp_error) {
+        free_checkpoints(checkpoints);
+        checkpoint_key.clear();
+        if(!PyErr_Occurred()) {
+            PyErr_Format(PyExc_RuntimeError,
+                    "interp_error > 0 but no Python exception set");
+        }
+        return NULL;
+    }
+    PyErr_Clear();
+    if(converged) {
+        checkpoint_last_line += rs->line_delta;
+    } else {
+        maybe_new_line();
+        if(PyErr_Occurred()) { interp_error = 1; goto out_error; }
+        checkpoint_result = result;
+        checkpoint_last_line = last_sequence_number + error_line_offset;
+    }
+    PyObject *retval = PyTuple_New(2);
+    PyTuple_SetItem(retval, 0, PyInt_FromLong(checkpoint_result));
+    PyTuple_SetItem(retval, 1, PyInt_FromLong(checkpoint_last_line));
+    return retval;
+}
+
+static std::string parse_key(const char *f, const char *unitcode,
+        const char *initcode, const char *interpname) {
+    std::string key(f);
+    key += '\0'; if(unitcode) key += unitcode;
+    key += '\0'; if(initcode) key += initcode;
+    key += '\0'; if(interpname) key += interpname;
+    return key;
+}
+
+static void start_parse(const char *interpname) {
+    if(pinterp) {
+        delete pinterp;
+        pinterp = 0;
+    }
+    if(interpname && *interpname)
+        pinterp = interp_from_shlib(interpname);
+    if(!pinterp)
+        pinterp = new Interp;
+
+    for(int i=0; i<USER_DEFINED_FUNCTION_NUM; i++) 
+        USER_DEFINED_FUNCTION[i] = user_defined_function;
+
     metric=false;
     interp_error = 0;
     last_sequence_number = -1;
 
     _pos_x = _pos_y = _pos_z = _pos_a = _pos_b = _pos_c = 0;
     _pos_u = _pos_v = _pos_w = 0;
+}
 
+// Start a parse of f from its first line; returns the result of the
+// unit and startup codes.
+static int start_file(char *f, char *unitcode, char *initcode, char *interpname) {
+    start_parse(interpname);
     interp_new.init();
     interp_new.open(f);
 
@@ -719,28 +1696,137 @@ static PyObject *parse_file(PyObject *self, PyObject *args) {
     int result = INTERP_OK;
     if(unitcode) {
         result = interp_new.read(unitcode);
-        if(!RESULT_OK) goto out_error;
+        if(!RESULT_OK) return result;
         result = interp_new.execute();
     }
     if(initcode && RESULT_OK) {
         result = interp_new.read(initcode);
-        if(!RESULT_OK) goto out_error;
+        if(!RESULT_OK) return result;
         result = interp_new.execute();
     }
-    while(!interp_error && RESULT_OK) {
+    return result;
+}
+
+static PyObject *full_parse(char *f, char *unitcode, char *initcode, char *interpname) {
+    free_checkpoints(checkpoints);
+    checkpoint_key.clear();
+    checkpoint_native = native != 0;
+    if(checkpoint_interval > 0
+            && (native ? callback_can_resume() : callback_can_reparse()))
+        checkpoint_key = parse_key(f, unitcode, initcode, interpname);
+
+    int result = start_file(f, unitcode, initcode, interpname);
+    int saved_interval = checkpoint_interval;
+    if(checkpoint_key.empty()) checkpoint_interval = 0;
+    PyObject *retval = run_parse(result, 0);
+    checkpoint_interval = saved_interval;
+    return retval;
+}
+
+static PyObject *parse_file(PyObject *self, PyObject *args) {
+    char *f;
+    char *unitcode=0, *initcode=0, *interpname=0;
+    PyObject *canon;
+    if(!PyArg_ParseTuple(args, "sO|sss", &f, &canon, &unitcode, &initcode, &interpname))
+        return NULL;
+    if(!lock_parse()) return NULL;
+    callback = canon;
+    PyObject *retval = NULL;
+    if(start_native())
+        retval = full_parse(f, unitcode, initcode, interpname);
+    unlock_parse();
+    return retval;
+}
+
+// reparse(filename, canon, first_line, last_line, line_delta,
+//         [unitcode, initcode, interpname])
+// Parse filename again after lines first_line..last_line (new numbering)
+// were edited, adding line_delta lines.  canon must be the object used for
+// the previous parse.  Falls back to a full parse when no checkpoint from
+// that parse can be used.
+static PyObject *reparse(char *f, int first_line, int last_line,
+        int line_delta, char *unitcode, char *initcode, char *interpname) {
+
+    if(checkpoint_interval <= 0 || checkpoints.empty() || !callback_can_reparse()
+            || checkpoint_native
+            || checkpoint_key != parse_key(f, unitcode, initcode, interpname))
+        return full_parse(f, unitcode, initcode, interpname);
+
+    // keep the checkpoints before the edit, set aside the ones after it
+    // and drop those inside it
+    reparse_state rs;
+    rs.next = 0;
+    rs.last_line = last_line;
+    rs.line_delta = line_delta;
+    std::vector<parse_checkpoint> kept;
+    for(size_t i = 0; i < checkpoints.size(); i++) {
+        parse_checkpoint &cp = checkpoints[i];
+        int seq = cp.interp->sequence_number;
+        if(seq < first_line) kept.push_back(cp);
+        else if(seq + line_delta > last_line) rs.old.push_back(cp);
+        else free_checkpoint(cp);
+    }
+    checkpoints.swap(kept);
+    if(checkpoints.empty()) {
+        free_checkpoints(rs.old);
+        return full_parse(f, unitcode, initcode, interpname);
+    }
+
+    start_parse(interpname);
+    interp_new.init();
+    interp_new.open(f);
+
+    parse_checkpoint &resume = checkpoints.back();
+    if(!interp_new.restore(resume.interp)) {
+        free_checkpoints(rs.old);
+        if(pinterp) pinterp->close();
+        return full_parse(f, unitcode, initcode, interpname);
+    }
+    restore_checkpoint(resume);
+    PyObject *result = callmethod(callback, "rewind", "O", resume.canon);
+    if(!result) {
+        interp_error ++;
+        free_checkpoints(rs.old);
+        return run_parse(INTERP_OK, 0);
+    }
+    Py_DECREF(result);
+    // this checkpoint is taken again as soon as the loop starts
+    free_checkpoint(resume);
+    checkpoints.pop_back();
+
+    return run_parse(INTERP_OK, &rs);
+}
+
+// Parse on to just past last_line, without taking or dropping checkpoints.
+static PyObject *run_lines(int result, int last_line) {
+    int error_line_offset = 0;
+    struct timeval t0, t1;
+    int wait = 1;
+
+    gettimeofday(&t0, NULL);
+
+    while(!interp_error && RESULT_OK
+            && interp_new.sequence_number() < last_line) {
         error_line_offset = 1;
+        allow_threads();
         result = interp_new.read();
+        end_allow_threads();
         gettimeofday(&t1, NULL);
         if(t1.tv_sec > t0.tv_sec + wait) {
-            if(check_abort()) return NULL;
+            if(check_abort()) { interp_error ++; break; }
             t0 = t1;
         }
         if(!RESULT_OK) break;
         error_line_offset = 0;
+        allow_threads();
         result = interp_new.execute();
+        end_allow_threads();
     }
-out_error:
     if(pinterp) pinterp->close();
+    if(!interp_error) {
+        PyErr_Clear();
+        maybe_new_line();
+    }
     if(interp_error) {
         if(!PyErr_Occurred()) {
             PyErr_Format(PyExc_RuntimeError,
@@ -748,15 +1834,142 @@ out_error:
         }
         return NULL;
     }
-    PyErr_Clear();
-    maybe_new_line();
-    if(PyErr_Occurred()) { interp_error = 1; goto out_error; }
-    PyObject *retval = PyTuple_New(2);
-    PyTuple_SetItem(retval, 0, PyInt_FromLong(result));
-    PyTuple_SetItem(retval, 1, PyInt_FromLong(last_sequence_number + error_line_offset));
+    return Py_BuildValue("(ii)", result,
+            last_sequence_number + error_line_offset);
+}
+
+// parse_lines(filename, canon, first_line, last_line,
+//             [unitcode, initcode, interpname])
+// Give canon the moves of lines first_line..last_line of filename, and of
+// the lines before them back to the checkpoint the parse resumes from.
+// The checkpoints are those of the last parse() of filename, which may
+// have filled a native geometry that kept none of the moves; they are
+// kept for the next call.  The moves go to canon's lists: a native
+// geometry of canon is not used.  Without a checkpoint the parse starts
+// at the top of the file, so canon should be new.
+static PyObject *parse_lines(char *f, int first_line, int last_line,
+        char *unitcode, char *initcode, char *interpname) {
+    parse_checkpoint *resume = 0;
+    if(callback_can_resume() && !checkpoint_key.empty()
+            && checkpoint_key == parse_key(f, unitcode, initcode, interpname)) {
+        for(size_t i = 0; i < checkpoints.size(); i++) {
+            if(checkpoints[i].interp->sequence_number >= first_line) break;
+            resume = &checkpoints[i];
+        }
+    }
+    if(!resume)
+        return run_lines(start_file(f, unitcode, initcode, interpname),
+                last_line);
+
+    start_parse(interpname);
+    interp_new.init();
+    interp_new.open(f);
+    if(!interp_new.restore(resume->interp)) {
+        if(pinterp) pinterp->close();
+        return run_lines(start_file(f, unitcode, initcode, interpname),
+                last_line);
+    }
+    restore_checkpoint(*resume);
+    PyObject *result = callmethod(callback, "rewind", "O", resume->canon);
+    if(!result) interp_error ++;
+    Py_XDECREF(result);
+    return run_lines(INTERP_OK, last_line);
+}
+
+static PyObject *rs274_parse_lines(PyObject *self, PyObject *args) {
+    char *f;
+    char *unitcode=0, *initcode=0, *interpname=0;
+    int first_line, last_line;
+    PyObject *canon;
+    if(!PyArg_ParseTuple(args, "sOii|sss", &f, &canon,
+                &first_line, &last_line, &unitcode, &initcode, &interpname))
+        return NULL;
+    if(!lock_parse()) return NULL;
+    callback = canon;
+    Py_XDECREF(native);
+    native = 0;
+    PyObject *retval = parse_lines(f, first_line, last_line,
+            unitcode, initcode, interpname);
+    unlock_parse();
     return retval;
 }
 
+static PyObject *rs274_reparse(PyObject *self, PyObject *args) {
+    char *f;
+    char *unitcode=0, *initcode=0, *interpname=0;
+    int first_line, last_line, line_delta;
+    PyObject *canon;
+    if(!PyArg_ParseTuple(args, "sOiii|sss", &f, &canon,
+                &first_line, &last_line, &line_delta,
+                &unitcode, &initcode, &interpname))
+        return NULL;
+    if(!lock_parse()) return NULL;
+    callback = canon;
+    PyObject *retval = NULL;
+    if(start_native())
+        retval = reparse(f, first_line, last_line, line_delta,
+                unitcode, initcode, interpname);
+    unlock_parse();
+    return retval;
+}
+
+// lint(filename, canon, [threads, interpname])
+// Check filename and the subroutines it calls without running them.  canon
+// answers the interpreter's questions during init, as for parse.  Returns
+// a list of (filename, line, message), empty for a clean program.
+static PyObject *rs274_lint(PyObject *self, PyObject *args) {
+    char *f, *interpname=0;
+    int threads = 0;
+    PyObject *canon;
+    if(!PyArg_ParseTuple(args, "sO|is", &f, &canon, &threads, &interpname))
+        return NULL;
+    if(!lock_parse()) return NULL;
+    callback = canon;
+    Py_XDECREF(native);
+    native = 0;
+    start_parse(interpname);
+    interp_new.init();
+    std::vector<InterpDiagnostic> diagnostics;
+    int count = 0;
+    if(!interp_error) {
+        Py_BEGIN_ALLOW_THREADS
+        count = pinterp->lint(f, diagnostics, threads);
+        Py_END_ALLOW_THREADS
+    }
+    PyObject *retval = NULL;
+    if(interp_error) {
+        if(!PyErr_Occurred())
+            PyErr_Format(PyExc_RuntimeError,
+                    "interp_error > 0 but no Python exception set");
+    } else if(count < 0) {
+        PyErr_SetString(PyExc_NotImplementedError,
+                "this interpreter can't lint");
+    } else {
+        PyErr_Clear();
+        retval = PyList_New(diagnostics.size());
+        for(size_t i=0; retval && i<diagnostics.size(); i++) {
+            const InterpDiagnostic &d = diagnostics[i];
+            PyList_SET_ITEM(retval, i, Py_BuildValue("(sis)",
+                    d.filename.c_str(), d.line, d.message.c_str()));
+        }
+    }
+    unlock_parse();
+    return retval;
+}
+
+static PyObject *rs274_set_checkpoint_interval(PyObject *self, PyObject *args) {
+    int interval;
+    if(!PyArg_ParseTuple(args, "i", &interval)) return NULL;
+    checkpoint_interval = interval;
+    if(interval <= 0) {
+        free_checkpoints(checkpoints);
+        checkpoint_key.clear();
+    }
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+
 
 static int maxerror = -1;
 
@@ -871,29 +2084,18 @@ static bool get_attr(PyObject *o, const char *attr_name, const char *fmt, ...) {
     return result;
 }
 
-static void unrotate(double &x, double &y, double c, double s) {
-    double tx = x * c + y * s;
-    y = -x * s + y * c;
-    x = tx;
-}
-
-static void rotate(double &x, double &y, double c, double s) {
-    double tx = x * c - y * s;
-    y = x * s + y * c;
-    x = tx;
-}
-
 static PyObject *rs274_arc_to_segments(PyObject *self, PyObject *args) {
     PyObject *canon;
     double x1, y1, cx, cy, z1, a, b, c, u, v, w;
-    double o[9], n[9], g5xoffset[9], g92offset[9];
+    double o[9], g5xoffset[9], g92offset[9];
     int rot, plane;
-    int X, Y, Z;
     double rotation_cos, rotation_sin;
     int max_segments = 128;
+    double tolerance = 0;
 
-    if(!PyArg_ParseTuple(args, "Oddddiddddddd|i:arcs_to_segments",
-        &canon, &x1, &y1, &cx, &cy, &rot, &z1, &a, &b, &c, &u, &v, &w, &max_segments)) return NULL;
+    if(!PyArg_ParseTuple(args, "Oddddiddddddd|id:arcs_to_segments",
+        &canon, &x1, &y1, &cx, &cy, &rot, &z1, &a, &b, &c, &u, &v, &w,
+        &max_segments, &tolerance)) return NULL;
     if(!get_attr(canon, "lo", "ddddddddd:arcs_to_segments lo", &o[0], &o[1], &o[2],
                     &o[3], &o[4], &o[5], &o[6], &o[7], &o[8]))
         return NULL;
@@ -919,83 +2121,590 @@ static PyObject *rs274_arc_to_segments(PyObject *self, PyObject *args) {
     if(!get_attr(canon, "g92_offset_v", &g92offset[7])) return NULL;
     if(!get_attr(canon, "g92_offset_w", &g92offset[8])) return NULL;
 
-    if(plane == 1) {
-        X=0; Y=1; Z=2;
-    } else if(plane == 3) {
-        X=2; Y=0; Z=1;
-    } else {
-        X=1; Y=2; Z=0;
+    std::vector<double> pts;
+    int steps = arc_points(o, x1, y1, cx, cy, rot, z1, a, b, c, u, v, w,
+            plane, g5xoffset, g92offset, rotation_cos, rotation_sin,
+            max_segments, tolerance, pts);
+    PyObject *segs = PyList_New(steps);
+    for(int i=0; i<steps; i++) {
+        const double *p = &pts[i*9];
+        PyList_SET_ITEM(segs, i,
+            Py_BuildValue("ddddddddd", p[0], p[1], p[2], p[3], p[4], p[5], p[6], p[7], p[8]));
     }
-    n[X] = x1;
-    n[Y] = y1;
-    n[Z] = z1;
-    n[3] = a;
-    n[4] = b;
-    n[5] = c;
-    n[6] = u;
-    n[7] = v;
-    n[8] = w;
-    for(int ax=0; ax<9; ax++) o[ax] -= g5xoffset[ax];
-    unrotate(o[0], o[1], rotation_cos, rotation_sin);
-    for(int ax=0; ax<9; ax++) o[ax] -= g92offset[ax];
+    return segs;
+}
 
-    double theta1 = atan2(o[Y]-cy, o[X]-cx);
-    double theta2 = atan2(n[Y]-cy, n[X]-cx);
+// One straight piece of the preview, in machine units with the tool
+// length offset added, as the kinematics see it
+struct limit_segment {
+    int line;
+    double start[9], end[9];
+};
 
-    if(rot < 0) {
-        while(theta2 - theta1 > -CIRCLE_FUZZ) theta2 -= 2*M_PI;
-    } else {
-        while(theta2 - theta1 < CIRCLE_FUZZ) theta2 += 2*M_PI;
+struct limit_job {
+    const preview_kins *kins;
+    const std::vector<limit_segment> *segs;
+    size_t first, last;
+    int num_joints;
+    const double *minimum, *maximum;
+    double step, astep;
+    // the violation with the lowest line number in first..last
+    int line, joint;
+    double value;
+};
+
+static void set_pose(EmcPose &p, const double *v) {
+    p.tran.x = v[0]; p.tran.y = v[1]; p.tran.z = v[2];
+    p.a = v[3]; p.b = v[4]; p.c = v[5];
+    p.u = v[6]; p.v = v[7]; p.w = v[8];
+}
+
+static void *check_limits_worker(void *arg) {
+    limit_job *job = (limit_job*)arg;
+    double joints[16];
+    for(size_t i=job->first; i<job->last; i++) {
+        const limit_segment &s = (*job->segs)[i];
+        if(job->joint != -2 && s.line >= job->line) continue;
+        double linear = 0, angular = 0;
+        for(int k=0; k<9; k++) {
+            double d = fabs(s.end[k] - s.start[k]);
+            if(k >= 3 && k < 6) angular = std::max(angular, d);
+            else linear = std::max(linear, d);
+        }
+        int n = std::max(1, (int)std::max(ceil(linear / job->step),
+                    ceil(angular / job->astep)));
+        for(int j=0; j<=n; j++) {
+            double t = (double)j / n, v[9];
+            for(int k=0; k<9; k++)
+                v[k] = s.start[k] + t * (s.end[k] - s.start[k]);
+            EmcPose p;
+            set_pose(p, v);
+            int bad = -2;
+            double value = 0;
+            if(job->kins->inverse(&p, joints)) {
+                bad = -1;
+            } else {
+                for(int k=0; k<job->num_joints; k++) {
+                    if(joints[k] < job->minimum[k]
+                            || joints[k] > job->maximum[k]) {
+                        bad = k; value = joints[k]; break;
+                    }
+                }
+            }
+            if(bad != -2) {
+                job->line = s.line;
+                job->joint = bad;
+                job->value = value;
+                break;
+            }
+        }
     }
+    return NULL;
+}
 
-    // if multi-turn, add the right number of full circles
-    if(rot < -1) theta2 += 2*M_PI*(rot+1);
-    if(rot > 1) theta2 += 2*M_PI*(rot-1);
+static bool get_doubles(PyObject *o, const char *what, std::vector<double> &v) {
+    PyObject *seq = PySequence_Fast(o, what);
+    if(!seq) return false;
+    for(Py_ssize_t i=0; i<PySequence_Fast_GET_SIZE(seq); i++) {
+        double d = PyFloat_AsDouble(PySequence_Fast_GET_ITEM(seq, i));
+        if(d == -1 && PyErr_Occurred()) { Py_DECREF(seq); return false; }
+        v.push_back(d);
+    }
+    Py_DECREF(seq);
+    return true;
+}
 
-    int steps = std::max(3, int(max_segments * fabs(theta1 - theta2) / M_PI));
-    double rsteps = 1. / steps;
-    PyObject *segs = PyList_New(steps);
+static PyObject *rs274_check_joint_limits(PyObject *self, PyObject *args) {
+    const char *name;
+    PyObject *py_params, *py_min, *py_max, *moves;
+    double scale, step = 0.04, astep = 1;
+    int nthreads = 0;
+    if(!PyArg_ParseTuple(args, "sOOOOd|ddi:check_joint_limits", &name,
+                &py_params, &py_min, &py_max, &moves, &scale,
+                &step, &astep, &nthreads))
+        return NULL;
+    const preview_kins *kins = find_preview_kins(name);
+    if(!kins) {
+        PyErr_Format(PyExc_ValueError, "no preview kinematics %s", name);
+        return NULL;
+    }
+    std::vector<double> params, minimum, maximum;
+    if(!get_doubles(py_params, "check_joint_limits params", params)
+            || !get_doubles(py_min, "check_joint_limits minimum", minimum)
+            || !get_doubles(py_max, "check_joint_limits maximum", maximum))
+        return NULL;
+    size_t num_params = 0;
+    while(kins->params[num_params]) num_params++;
+    if(params.size() != num_params || minimum.size() != maximum.size()
+            || minimum.size() > 16) {
+        PyErr_SetString(PyExc_ValueError,
+                "check_joint_limits: wrong number of params or limits");
+        return NULL;
+    }
+    if(step <= 0 || astep <= 0) {
+        PyErr_SetString(PyExc_ValueError,
+                "check_joint_limits: step must be positive");
+        return NULL;
+    }
 
-    double dtheta = theta2 - theta1;
-    double d[9] = {0, 0, 0, n[3]-o[3], n[4]-o[4], n[5]-o[5], n[6]-o[6], n[7]-o[7], n[8]-o[8]};
-    d[Z] = n[Z] - o[Z];
+    // the same items as calc_extents() reads
+    std::vector<limit_segment> segs;
+    for(int i=0; i<PySequence_Length(moves); i++) {
+        PyObject *si = PySequence_GetItem(moves, i);
+        if(!si) return NULL;
+        for(int j=0; j<PySequence_Length(si); j++) {
+            PyObject *sj = PySequence_GetItem(si, j);
+            PyObject *line, *unused;
+            limit_segment s;
+            double *a = s.start, *b = s.end, t[3];
+            int r;
+            if(PyTuple_Size(sj) == 4)
+                r = PyArg_ParseTuple(sj,
+                    "O(ddddddddd)(ddddddddd)(ddd):check_joint_limits item",
+                    &line, &a[0], &a[1], &a[2], &a[3], &a[4], &a[5], &a[6], &a[7], &a[8],
+                    &b[0], &b[1], &b[2], &b[3], &b[4], &b[5], &b[6], &b[7], &b[8],
+                    &t[0], &t[1], &t[2]);
+            else
+                r = PyArg_ParseTuple(sj,
+                    "O(ddddddddd)(ddddddddd)O(ddd):check_joint_limits item",
+                    &line, &a[0], &a[1], &a[2], &a[3], &a[4], &a[5], &a[6], &a[7], &a[8],
+                    &b[0], &b[1], &b[2], &b[3], &b[4], &b[5], &b[6], &b[7], &b[8],
+                    &unused, &t[0], &t[1], &t[2]);
+            if(r) s.line = PyInt_AsLong(line);
+            Py_DECREF(sj);
+            if(!r || (s.line == -1 && PyErr_Occurred())) {
+                Py_DECREF(si);
+                return NULL;
+            }
+            for(int k=0; k<3; k++) { a[k] += t[k]; b[k] += t[k]; }
+            for(int k=0; k<9; k++) {
+                if(k >= 3 && k < 6) continue;
+                a[k] *= scale; b[k] *= scale;
+            }
+            segs.push_back(s);
+        }
+        Py_DECREF(si);
+    }
 
-    double tx = o[X] - cx, ty = o[Y] - cy, dc = cos(dtheta*rsteps), ds = sin(dtheta*rsteps);
-    for(int i=0; i<steps-1; i++) {
-        double f = (i+1) * rsteps;
-        double p[9];
-        rotate(tx, ty, dc, ds);
-        p[X] = tx + cx;
-        p[Y] = ty + cy;
-        p[Z] = o[Z] + d[Z] * f;
-        p[3] = o[3] + d[3] * f;
-        p[4] = o[4] + d[4] * f;
-        p[5] = o[5] + d[5] * f;
-        p[6] = o[6] + d[6] * f;
-        p[7] = o[7] + d[7] * f;
-        p[8] = o[8] + d[8] * f;
-        for(int ax=0; ax<9; ax++) p[ax] += g92offset[ax];
-        rotate(p[0], p[1], rotation_cos, rotation_sin);
-        for(int ax=0; ax<9; ax++) p[ax] += g5xoffset[ax];
-        PyList_SET_ITEM(segs, i,
-            Py_BuildValue("ddddddddd", p[0], p[1], p[2], p[3], p[4], p[5], p[6], p[7], p[8]));
+    if(nthreads <= 0) nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+    nthreads = std::max(1, std::min(nthreads, 8));
+    nthreads = std::min<size_t>(nthreads, segs.size() / 256 + 1);
+    std::vector<limit_job> jobs(nthreads);
+    std::vector<pthread_t> threads(nthreads);
+    std::vector<bool> started(nthreads);
+    // the step is in inches, like the canon lists
+    step *= scale;
+    Py_BEGIN_ALLOW_THREADS
+    kins->set_geometry(params.data());
+    for(int i=0; i<nthreads; i++) {
+        limit_job &job = jobs[i];
+        job.kins = kins;
+        job.segs = &segs;
+        job.first = segs.size() * i / nthreads;
+        job.last = segs.size() * (i + 1) / nthreads;
+        job.num_joints = minimum.size();
+        job.minimum = minimum.data();
+        job.maximum = maximum.data();
+        job.step = step;
+        job.astep = astep;
+        job.line = 0;
+        job.joint = -2;
+        job.value = 0;
+        started[i] = i > 0
+            && pthread_create(&threads[i], NULL, check_limits_worker, &job) == 0;
     }
-    for(int ax=0; ax<9; ax++) n[ax] += g92offset[ax];
-    rotate(n[0], n[1], rotation_cos, rotation_sin);
-    for(int ax=0; ax<9; ax++) n[ax] += g5xoffset[ax];
-    PyList_SET_ITEM(segs, steps-1,
-        Py_BuildValue("ddddddddd", n[0], n[1], n[2], n[3], n[4], n[5], n[6], n[7], n[8]));
-    return segs;
+    for(int i=0; i<nthreads; i++)
+        if(!started[i]) check_limits_worker(&jobs[i]);
+    for(int i=0; i<nthreads; i++)
+        if(started[i]) pthread_join(threads[i], NULL);
+    Py_END_ALLOW_THREADS
+
+    const limit_job *worst = NULL;
+    for(int i=0; i<nthreads; i++)
+        if(jobs[i].joint != -2 && (!worst || jobs[i].line < worst->line))
+            worst = &jobs[i];
+    if(!worst) Py_RETURN_NONE;
+    return Py_BuildValue("iid", worst->line, worst->joint, worst->value);
+}
+
+// A stock removal simulation (see stocksim.hh) driven by the moves a
+// parse() put in a geometry
+typedef struct {
+    PyObject_HEAD
+    stock_sim *sim;
+} Stock;
+
+static PyObject *Stock_new(PyTypeObject *type, PyObject *args, PyObject *kw) {
+    Stock *s = (Stock*)type->tp_alloc(type, 0);
+    if(s) s->sim = 0;
+    return (PyObject*)s;
+}
+
+static int Stock_init(Stock *s, PyObject *args, PyObject *kw) {
+    static const char *kwlist[] = {"min", "max", "cell", NULL};
+    double mn[3], mx[3], cell;
+    if(!PyArg_ParseTupleAndKeywords(args, kw, "(ddd)(ddd)d:stock",
+                (char**)kwlist, &mn[0], &mn[1], &mn[2], &mx[0], &mx[1], &mx[2],
+                &cell))
+        return -1;
+    if(cell <= 0) {
+        PyErr_SetString(PyExc_ValueError, "stock cell size must be positive");
+        return -1;
+    }
+    delete s->sim;
+    s->sim = new stock_sim(mn[0], mn[1], mx[0], mx[1],
+            std::min(mn[2], mx[2]), std::max(mn[2], mx[2]), cell);
+    return 0;
+}
+
+static void Stock_dealloc(Stock *s) {
+    delete s->sim;
+    Py_TYPE(s)->tp_free((PyObject*)s);
+}
+
+static bool Stock_ready(Stock *s) {
+    if(s->sim) return true;
+    PyErr_SetString(PyExc_RuntimeError, "stock not initialized");
+    return false;
+}
+
+// tools[pocket] is the diameter of a flat end mill, a (diameter, ball)
+// tuple, or None for a pocket whose moves are left out
+static bool Stock_tool(PyObject *tools, int pocket, stock_move &m) {
+    m.radius = 0;
+    m.ball = false;
+    if(pocket < 0 || pocket >= PySequence_Size(tools)) {
+        PyErr_Clear();
+        return true;
+    }
+    PyObject *t = PySequence_GetItem(tools, pocket);
+    if(!t) return false;
+    double diameter = 0;
+    int ball = 0;
+    bool ok = true;
+    if(PyTuple_Check(t))
+        ok = PyArg_ParseTuple(t, "d|i:stock tool", &diameter, &ball);
+    else if(t != Py_None) {
+        diameter = PyFloat_AsDouble(t);
+        ok = !PyErr_Occurred();
+    }
+    Py_DECREF(t);
+    m.radius = diameter / 2;
+    m.ball = ball;
+    return ok;
+}
+
+static PyObject *Stock_cut(Stock *s, PyObject *args) {
+    Geometry *g;
+    PyObject *tools;
+    int threads = 0;
+    if(!Stock_ready(s)) return NULL;
+    if(!PyArg_ParseTuple(args, "O!O|i:cut", &GeometryType, &g, &tools,
+                &threads))
+        return NULL;
+    if(g->busy) {
+        PyErr_SetString(PyExc_BufferError, "geometry is being parsed into");
+        return NULL;
+    }
+    if(!PySequence_Check(tools)) {
+        PyErr_SetString(PyExc_TypeError, "tools must be a sequence");
+        return NULL;
+    }
+
+    // the moves of all parts, back in the order they were made
+    std::vector<stock_move> moves(g->segments);
+    for(int k=0; k<GEOMETRY_PARTS; k++) {
+        geometry_part *p = g->part[k];
+        for(size_t n=0; n<p->lines.size(); n++) {
+            stock_move &m = moves[p->order[n]];
+            if(!Stock_tool(tools, p->pockets[n], m)) return NULL;
+            for(int i=0; i<3; i++) {
+                m.start[i] = p->vertices[n*6+i];
+                m.end[i] = p->vertices[n*6+3+i];
+            }
+            m.traverse = k == GEOMETRY_TRAVERSE;
+            m.line = p->lines[n];
+        }
+    }
+
+    std::vector<int> hits;
+    Py_BEGIN_ALLOW_THREADS
+    hits = s->sim->cut(moves, threads);
+    Py_END_ALLOW_THREADS
+
+    PyObject *r = PyList_New(hits.size());
+    for(size_t i=0; r && i<hits.size(); i++)
+        PyList_SET_ITEM(r, i, PyInt_FromLong(hits[i]));
+    return r;
+}
+
+static PyObject *Stock_heights(Stock *s, PyObject *args) {
+    if(!Stock_ready(s)) return NULL;
+    const std::vector<float> &h = s->sim->heights;
+    return PyString_FromStringAndSize((const char*)&h[0],
+            h.size() * sizeof(float));
+}
+
+static PyObject *Stock_height(Stock *s, PyObject *args) {
+    double x, y;
+    if(!Stock_ready(s)) return NULL;
+    if(!PyArg_ParseTuple(args, "dd:height", &x, &y)) return NULL;
+    return PyFloat_FromDouble(s->sim->height(x, y));
+}
+
+static PyObject *Stock_removed(Stock *s, PyObject *args) {
+    if(!Stock_ready(s)) return NULL;
+    return PyFloat_FromDouble(s->sim->removed());
+}
+
+static PyObject *Stock_reset(Stock *s, PyObject *args) {
+    if(!Stock_ready(s)) return NULL;
+    s->sim->reset();
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+static PyObject *Stock_shape(Stock *s) {
+    if(!Stock_ready(s)) return NULL;
+    return Py_BuildValue("(ii)", s->sim->nx, s->sim->ny);
+}
+
+static PyObject *Stock_cell(Stock *s) {
+    if(!Stock_ready(s)) return NULL;
+    return PyFloat_FromDouble(s->sim->cell);
+}
+
+static PyMethodDef StockMethods[] = {
+    {"cut", (PyCFunction)Stock_cut, METH_VARARGS,
+        "Cut the moves of a geometry; returns the lines of traverses into the stock"},
+    {"heights", (PyCFunction)Stock_heights, METH_NOARGS,
+        "Top of each cell, float32, a row per y"},
+    {"height", (PyCFunction)Stock_height, METH_VARARGS,
+        "Top of the stock at x, y"},
+    {"removed", (PyCFunction)Stock_removed, METH_NOARGS,
+        "Volume cut away"},
+    {"reset", (PyCFunction)Stock_reset, METH_NOARGS,
+        "Put back all the stock"},
+    {NULL}
+};
+
+static PyGetSetDef StockGetSet[] = {
+    {(char*)"shape", (getter)Stock_shape},
+    {(char*)"cell", (getter)Stock_cell},
+    {NULL, NULL},
+};
+
+static PyTypeObject StockType = {
+    PyObject_HEAD_INIT(NULL)
+    0,                      /*ob_size*/
+    "gcode.stock",          /*tp_name*/
+    sizeof(Stock),          /*tp_basicsize*/
+    0,                      /*tp_itemsize*/
+    /* methods */
+    (destructor)Stock_dealloc, /*tp_dealloc*/
+    0,                      /*tp_print*/
+    0,                      /*tp_getattr*/
+    0,                      /*tp_setattr*/
+    0,                      /*tp_compare*/
+    0,                      /*tp_repr*/
+    0,                      /*tp_as_number*/
+    0,                      /*tp_as_sequence*/
+    0,                      /*tp_as_mapping*/
+    0,                      /*tp_hash*/
+    0,                      /*tp_call*/
+    0,                      /*tp_str*/
+    0,                      /*tp_getattro*/
+    0,                      /*tp_setattro*/
+    0,                      /*tp_as_buffer*/
+    Py_TPFLAGS_DEFAULT,     /*tp_flags*/
+    "Stock removal simulation: stock((xmin, ymin, zmin), (xmax, ymax, zmax), cell)", /*tp_doc*/
+    0,                      /*tp_traverse*/
+    0,                      /*tp_clear*/
+    0,                      /*tp_richcompare*/
+    0,                      /*tp_weaklistoffset*/
+    0,                      /*tp_iter*/
+    0,                      /*tp_iternext*/
+    StockMethods,           /*tp_methods*/
+    0,                      /*tp_members*/
+    StockGetSet,            /*tp_getset*/
+    0,                      /*tp_base*/
+    0,                      /*tp_dict*/
+    0,                      /*tp_descr_get*/
+    0,                      /*tp_descr_set*/
+    0,                      /*tp_dictoffset*/
+    (initproc)Stock_init,   /*tp_init*/
+    0,                      /*tp_alloc*/
+    Stock_new,              /*tp_new*/
+};
+
+// A line index of a program file, so that a GUI can show any few lines of
+// a program too large to load into its text widget whole.  The file is
+// mapped and scanned once for where each line starts; the text of a line
+// is only read from the mapping when it is asked for.
+typedef struct {
+    PyObject_HEAD
+    int fd;
+    char *data;
+    size_t size;
+    std::vector<size_t> *starts;    // of each line, then the end of the file
+} LineIndex;
+
+static PyObject *LineIndex_new(PyTypeObject *type, PyObject *args, PyObject *kw) {
+    char *f;
+    if(!PyArg_ParseTuple(args, "s:lineindex", &f)) return NULL;
+    int fd = open(f, O_RDONLY);
+    if(fd < 0) return PyErr_SetFromErrnoWithFilename(PyExc_IOError, f);
+    struct stat st;
+    char *data = 0;
+    if(fstat(fd, &st) < 0 || (st.st_size > 0 && (data = (char*)mmap(0,
+                st.st_size, PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED)) {
+        PyErr_SetFromErrnoWithFilename(PyExc_IOError, f);
+        close(fd);
+        return NULL;
+    }
+    LineIndex *ix = (LineIndex*)type->tp_alloc(type, 0);
+    if(!ix) {
+        if(data) munmap(data, st.st_size);
+        close(fd);
+        return NULL;
+    }
+    ix->fd = fd;
+    ix->data = data;
+    ix->size = st.st_size;
+    ix->starts = new std::vector<size_t>(1, 0);
+    Py_BEGIN_ALLOW_THREADS
+    const char *p = data, *end = data + ix->size;
+    while(p < end) {
+        const char *nl = (const char*)memchr(p, '\n', end - p);
+        if(!nl) break;
+        p = nl + 1;
+        ix->starts->push_back(p - data);
+    }
+    // a last line without a newline
+    if(ix->starts->back() != ix->size) ix->starts->push_back(ix->size);
+    Py_END_ALLOW_THREADS
+    return (PyObject*)ix;
+}
+
+static void LineIndex_dealloc(LineIndex *ix) {
+    if(ix->data) munmap(ix->data, ix->size);
+    if(ix->fd >= 0) close(ix->fd);
+    delete ix->starts;
+    Py_TYPE(ix)->tp_free((PyObject*)ix);
 }
 
+static Py_ssize_t LineIndex_length(LineIndex *ix) {
+    return ix->starts->size() - 1;
+}
+
+// lines(first, last): the text of lines first..last, counted from 1 as
+// the interpreter's sequence numbers are, each with its newline
+static PyObject *LineIndex_lines(LineIndex *ix, PyObject *args) {
+    int first, last;
+    if(!PyArg_ParseTuple(args, "ii:lines", &first, &last)) return NULL;
+    // reading a mapping past the end of a file that has since been cut
+    // short would be a SIGBUS
+    struct stat st;
+    if(fstat(ix->fd, &st) < 0 || (size_t)st.st_size != ix->size) {
+        PyErr_SetString(PyExc_IOError, "file changed since it was indexed");
+        return NULL;
+    }
+    int n = LineIndex_length(ix);
+    first = std::max(first, 1);
+    last = std::min(last, n);
+    PyObject *r = PyList_New(std::max(last - first + 1, 0));
+    for(int i=first; r && i<=last; i++) {
+        size_t a = (*ix->starts)[i-1], b = (*ix->starts)[i];
+        PyObject *l = PyString_FromStringAndSize(ix->data + a, b - a);
+        if(!l) { Py_DECREF(r); return NULL; }
+        PyList_SET_ITEM(r, i - first, l);
+    }
+    return r;
+}
+
+// offset(line): where line starts in the file; one past the last line
+// is the size of the file
+static PyObject *LineIndex_offset(LineIndex *ix, PyObject *args) {
+    int line;
+    if(!PyArg_ParseTuple(args, "i:offset", &line)) return NULL;
+    if(line < 1 || line > LineIndex_length(ix) + 1) {
+        PyErr_SetString(PyExc_IndexError, "line out of range");
+        return NULL;
+    }
+    return PyLong_FromSize_t((*ix->starts)[line-1]);
+}
+
+static PyMethodDef LineIndexMethods[] = {
+    {"lines", (PyCFunction)LineIndex_lines, METH_VARARGS,
+        "Text of lines first..last, counting from 1"},
+    {"offset", (PyCFunction)LineIndex_offset, METH_VARARGS,
+        "Offset in the file of the start of a line"},
+    {NULL}
+};
+
+static PySequenceMethods LineIndexSequence;
+
+static PyTypeObject LineIndexType = {
+    PyObject_HEAD_INIT(NULL)
+    0,                      /*ob_size*/
+    "gcode.lineindex",      /*tp_name*/
+    sizeof(LineIndex),      /*tp_basicsize*/
+    0,                      /*tp_itemsize*/
+    /* methods */
+    (destructor)LineIndex_dealloc, /*tp_dealloc*/
+    0,                      /*tp_print*/
+    0,                      /*tp_getattr*/
+    0,                      /*tp_setattr*/
+    0,                      /*tp_compare*/
+    0,                      /*tp_repr*/
+    0,                      /*tp_as_number*/
+    &LineIndexSequence,     /*tp_as_sequence*/
+    0,                      /*tp_as_mapping*/
+    0,                      /*tp_hash*/
+    0,                      /*tp_call*/
+    0,                      /*tp_str*/
+    0,                      /*tp_getattro*/
+    0,                      /*tp_setattro*/
+    0,                      /*tp_as_buffer*/
+    Py_TPFLAGS_DEFAULT,     /*tp_flags*/
+    "Where each line of a file starts: lineindex(filename)", /*tp_doc*/
+    0,                      /*tp_traverse*/
+    0,                      /*tp_clear*/
+    0,                      /*tp_richcompare*/
+    0,                      /*tp_weaklistoffset*/
+    0,                      /*tp_iter*/
+    0,                      /*tp_iternext*/
+    LineIndexMethods,       /*tp_methods*/
+    0,                      /*tp_members*/
+    0,                      /*tp_getset*/
+    0,                      /*tp_base*/
+    0,                      /*tp_dict*/
+    0,                      /*tp_descr_get*/
+    0,                      /*tp_descr_set*/
+    0,                      /*tp_dictoffset*/
+    0,                      /*tp_init*/
+    0,                      /*tp_alloc*/
+    LineIndex_new,          /*tp_new*/
+};
+
 static PyMethodDef gcode_methods[] = {
     {"parse", (PyCFunction)parse_file, METH_VARARGS, "Parse a G-Code file"},
+    {"reparse", (PyCFunction)rs274_reparse, METH_VARARGS,
+        "Parse a G-Code file again after an edit, resuming from a checkpoint"},
+    {"parse_lines", (PyCFunction)rs274_parse_lines, METH_VARARGS,
+        "Parse a range of lines of a G-Code file, resuming from a checkpoint"},
+    {"lint", (PyCFunction)rs274_lint, METH_VARARGS,
+        "Check a G-Code file and its subroutines without running them"},
+    {"set_checkpoint_interval", (PyCFunction)rs274_set_checkpoint_interval,
+        METH_VARARGS, "Save parse checkpoints every N lines (0 to disable)"},
     {"strerror", (PyCFunction)rs274_strerror, METH_VARARGS,
         "Convert a numeric error to a string"},
     {"calc_extents", (PyCFunction)rs274_calc_extents, METH_VARARGS,
         "Calculate information about extents of gcode"},
     {"arc_to_segments", (PyCFunction)rs274_arc_to_segments, METH_VARARGS,
         "Convert an arc to straight segments"},
+    {"check_joint_limits", (PyCFunction)rs274_check_joint_limits, METH_VARARGS,
+        "Find the first line that takes a joint past its limits"},
     {NULL}
 };
 
@@ -1005,9 +2714,36 @@ initgcode(void) {
                 "Interface to EMC rs274ngc interpreter");
     PyType_Ready(&LineCodeType);
     PyModule_AddObject(m, "linecode", (PyObject*)&LineCodeType);
+    GeometryArraySequence.sq_length = (lenfunc)GeometryArray_length;
+    GeometryArrayBuffer.bf_getbuffer = (getbufferproc)GeometryArray_getbuffer;
+    GeometryArrayBuffer.bf_releasebuffer =
+        (releasebufferproc)GeometryArray_releasebuffer;
+    PyType_Ready(&GeometryType);
+    PyType_Ready(&GeometryArrayType);
+    PyModule_AddObject(m, "geometry", (PyObject*)&GeometryType);
+    PyType_Ready(&StockType);
+    PyModule_AddObject(m, "stock", (PyObject*)&StockType);
+    LineIndexSequence.sq_length = (lenfunc)LineIndex_length;
+    PyType_Ready(&LineIndexType);
+    PyModule_AddObject(m, "lineindex", (PyObject*)&LineIndexType);
+    PyModule_AddObject(m, "TRAVERSE", PyInt_FromLong(GEOMETRY_TRAVERSE));
+    PyModule_AddObject(m, "FEED", PyInt_FromLong(GEOMETRY_FEED));
+    PyModule_AddObject(m, "ARCFEED", PyInt_FromLong(GEOMETRY_ARCFEED));
     PyObject_SetAttrString(m, "MAX_ERROR", PyInt_FromLong(maxerror));
     PyObject_SetAttrString(m, "MIN_ERROR",
             PyInt_FromLong(INTERP_MIN_ERROR));
+    PyObject *kinematics = PyDict_New();
+    for(const preview_kins *k = preview_kinematics; k->name; k++) {
+        PyObject *pins = PyList_New(0);
+        for(const char *const *p = k->params; *p; p++) {
+            PyObject *pin = PyString_FromFormat("%s.%s", k->name, *p);
+            PyList_Append(pins, pin);
+            Py_DECREF(pin);
+        }
+        PyDict_SetItemString(kinematics, k->name, pins);
+        Py_DECREF(pins);
+    }
+    PyModule_AddObject(m, "JOINT_LIMIT_KINEMATICS", kinematics);
 }
 
 // vim:ts=8:sts=4:sw=4:et:
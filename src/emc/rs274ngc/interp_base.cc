@@ -22,6 +22,14 @@
 #include <stdio.h>
 
 InterpBase::~InterpBase() {}
+InterpCheckpoint::~InterpCheckpoint() {}
+
+void InterpCheckpoint::relocate(long from, long delta, int lines,
+        const InterpCheckpoint *at) {
+    if(offset < from) return;
+    offset += delta;
+    sequence_number += lines;
+}
 
 InterpBase *interp_from_shlib(const char *shlib) {
     fprintf(stderr, "interp_from_shlib(%s)\n", shlib);
@@ -16,6 +16,8 @@
  *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  */
 #include <stdlib.h>
+#include <string>
+#include <vector>
 #include <boost/noncopyable.hpp>
 
 /* Size of certain arrays */
@@ -23,6 +25,28 @@
 #define ACTIVE_M_CODES 10
 #define ACTIVE_SETTINGS 3
 
+/* Opaque snapshot of interpreter state between two blocks of the main
+   program, used to resume a parse part way through a file (see
+   InterpBase::checkpoint). */
+class InterpCheckpoint : boost::noncopyable {
+public:
+    virtual ~InterpCheckpoint();
+    // account for an edit that moved everything from file position 'from'
+    // on by 'delta' bytes and 'lines' lines; 'at' is a checkpoint taken
+    // at the new position of 'from', holding anything the edit changed
+    virtual void relocate(long from, long delta, int lines,
+                          const InterpCheckpoint *at);
+    long offset;            // file position of the next line to read
+    int sequence_number;    // lines read so far
+};
+
+/* A problem found by InterpBase::lint */
+struct InterpDiagnostic {
+    std::string filename;
+    int line;
+    std::string message;
+};
+
 class InterpBase : boost::noncopyable {
 public:
     virtual ~InterpBase();
@@ -53,6 +77,21 @@ public:
     virtual void active_m_codes(int active_mcodes[ACTIVE_M_CODES]) = 0;
     virtual void active_settings(double active_settings[ACTIVE_SETTINGS]) = 0;
     virtual void set_loglevel(int level) = 0;
+    // time lines, subroutines and remaps, and write a report to filename;
+    // NULL stops
+    virtual void set_profile(const char *filename) {}
+
+    // Incremental re-parse support.  checkpoint() returns NULL when the
+    // current state can't be captured (or isn't supported at all);
+    // restore() is called on a freshly opened file of the same name.
+    virtual InterpCheckpoint *checkpoint() { return 0; }
+    virtual bool restore(const InterpCheckpoint *) { return false; }
+    virtual bool same_state(const InterpCheckpoint *, const InterpCheckpoint *) { return false; }
+    // like same_state, but the current position is not compared
+    virtual bool same_modes(const InterpCheckpoint *, const InterpCheckpoint *) { return false; }
+    // Check a program and the subroutines it calls without running it;
+    // returns the number of diagnostics added, or -1 if not supported
+    virtual int lint(const char *, std::vector<InterpDiagnostic> &, int = 0) { return -1; }
 };
 
 InterpBase *interp_from_shlib(const char *shlib);
@@ -0,0 +1,227 @@
+/********************************************************************
+* Description: interp_checkpoint.cc
+*
+*   Snapshots of the modal interpreter state between top-level blocks,
+*   so that a preview can resume parsing part way through a program
+*   instead of starting again from the first line, and task can start
+*   a run from a line without reading all the lines before it.
+*
+* License: GPL Version 2
+* System: Linux
+*
+********************************************************************/
+
+#include <string.h>
+#include <stdlib.h>
+#include <string>
+
+#include "rs274ngc.hh"
+#include "rs274ngc_return.hh"
+#include "interp_queue.hh"
+#include "interp_internal.hh"
+#include "rs274ngc_interp.hh"
+
+// Everything in the setup model that can change while reading a program
+// and that influences later canon calls.  Each member is copied and
+// compared as plain memory.  The tool table is not included: it only
+// changes through the external tool table in the preview, and through
+// iocontrol in task.
+#define CHECKPOINT_FIELDS(X) \
+    CHECKPOINT_MODAL_FIELDS(X) CHECKPOINT_POSITION_FIELDS(X) X(parameters)
+
+#define CHECKPOINT_POSITION_FIELDS(X) \
+    X(AA_current) X(BB_current) X(CC_current) \
+    X(u_current) X(v_current) X(w_current) \
+    X(current_x) X(current_y) X(current_z) \
+    X(program_x) X(program_y) X(program_z)
+
+#define CHECKPOINT_MODAL_FIELDS(X) \
+    X(AA_axis_offset) X(AA_origin_offset) \
+    X(BB_axis_offset) X(BB_origin_offset) \
+    X(CC_axis_offset) X(CC_origin_offset) \
+    X(u_axis_offset) X(u_origin_offset) \
+    X(v_axis_offset) X(v_origin_offset) \
+    X(w_axis_offset) X(w_origin_offset) \
+    X(active_g_codes) X(active_m_codes) X(active_settings) \
+    X(arc_not_allowed) \
+    X(axis_offset_x) X(axis_offset_y) X(axis_offset_z) \
+    X(control_mode) X(current_pocket) \
+    X(cutter_comp_radius) X(cutter_comp_orientation) X(cutter_comp_side) \
+    X(cycle_cc) X(cycle_i) X(cycle_j) X(cycle_k) X(cycle_l) \
+    X(cycle_p) X(cycle_q) X(cycle_r) X(cycle_il) X(cycle_il_flag) \
+    X(distance_mode) X(ijk_distance_mode) \
+    X(feed_mode) X(feed_override) X(feed_rate) X(flood) \
+    X(length_units) X(mist) X(motion_mode) X(origin_index) \
+    X(origin_offset_x) X(origin_offset_y) X(origin_offset_z) \
+    X(rotation_xy) X(percent_flag) X(plane) \
+    X(probe_flag) X(input_flag) X(toolchange_flag) \
+    X(input_index) X(input_digital) X(cutter_comp_firstmove) \
+    X(retract_mode) \
+    X(selected_pocket) X(selected_tool) X(speed) X(spindle_mode) \
+    X(speed_feed_mode) X(speed_override) X(spindle_turning) \
+    X(tool_offset) X(traverse_rate) \
+    X(adaptive_feed) X(feed_hold) X(lathe_diameter_mode)
+
+struct InterpState : public InterpCheckpoint {
+#define DECLARE_FIELD(f) decltype(setup::f) f;
+    CHECKPOINT_FIELDS(DECLARE_FIELD)
+#undef DECLARE_FIELD
+    parameter_map global_params;
+    offset_map_type offset_map;
+    std::string filename;
+
+    // labels beyond the edit move with it; labels before it are taken
+    // from 'at', which saw the edited text
+    void relocate(long from, long delta, int lines,
+                  const InterpCheckpoint *at_base) {
+        const InterpState *at = dynamic_cast<const InterpState *>(at_base);
+        InterpCheckpoint::relocate(from, delta, lines, at_base);
+        for(offset_map_iterator it = offset_map.begin();
+                it != offset_map.end(); ++it) {
+            offset_struct &o = it->second;
+            if(!o.filename || filename != o.filename)
+                continue;
+            if(o.offset >= from) {
+                o.offset += delta;
+                o.sequence_number += lines;
+            } else if(at) {
+                offset_map_type::const_iterator n = at->offset_map.find(it->first);
+                if(n != at->offset_map.end()) o = n->second;
+            }
+        }
+    }
+};
+
+/***********************************************************************/
+
+/*! Interp::checkpoint
+
+Returned Value: a new checkpoint owned by the caller, or NULL
+
+Called By: external programs (gcodemodule)
+
+A checkpoint can only be taken between two blocks of the main program:
+no file open, a subroutine call or definition in progress, a skip to an
+o-word target, a remap, or cutter compensation moves still waiting in
+the queue all return NULL.
+
+*/
+
+InterpCheckpoint *Interp::checkpoint()
+{
+    if(!_setup.file_pointer) return 0;
+    if(_setup.call_level != 0 || _setup.remap_level != 0) return 0;
+    if(_setup.defining_sub || _setup.skipping_o || _setup.skipping_to_sub)
+        return 0;
+    if(_setup.call_state != CS_NORMAL) return 0;
+    if(!qc().empty()) return 0;
+
+    InterpState *cp = new InterpState;
+    cp->offset = ftell(_setup.file_pointer);
+    cp->sequence_number = _setup.sequence_number;
+#define SAVE_FIELD(f) memcpy(&cp->f, &_setup.f, sizeof(cp->f));
+    CHECKPOINT_FIELDS(SAVE_FIELD)
+#undef SAVE_FIELD
+    cp->global_params = _setup.sub_context[0].named_params;
+    cp->offset_map = _setup.offset_map;
+    cp->filename = _setup.filename;
+    return cp;
+}
+
+/***********************************************************************/
+
+/*! Interp::restore
+
+Returned Value: true on success
+
+Called By: external programs (gcodemodule)
+
+Puts the interpreter back into the state captured by checkpoint().
+The program must already be open (with Interp::open); reading resumes
+at the line following the checkpoint.
+
+*/
+
+bool Interp::restore(const InterpCheckpoint *base)
+{
+    const InterpState *cp = dynamic_cast<const InterpState *>(base);
+    if(!cp || !_setup.file_pointer) return false;
+    if(fseek(_setup.file_pointer, cp->offset, SEEK_SET) != 0) return false;
+    _setup.sequence_number = cp->sequence_number;
+#define RESTORE_FIELD(f) memcpy(&_setup.f, &cp->f, sizeof(cp->f));
+    CHECKPOINT_FIELDS(RESTORE_FIELD)
+#undef RESTORE_FIELD
+    _setup.sub_context[0].named_params = cp->global_params;
+    _setup.sub_context[0].named_generation++;
+    _setup.offset_map = cp->offset_map;
+    return true;
+}
+
+/***********************************************************************/
+
+/*! Interp::same_state
+
+Returned Value: true if both checkpoints describe the same modal state
+
+Called By: external programs (gcodemodule)
+
+The file position and line number are not compared, so that two
+checkpoints taken at corresponding lines before and after an edit can
+be matched up.  Subroutine label offsets are not compared either; the
+caller moves them with InterpCheckpoint::relocate.
+
+*/
+
+bool Interp::same_state(const InterpCheckpoint *base_a,
+                        const InterpCheckpoint *base_b)
+{
+    const InterpState *a = dynamic_cast<const InterpState *>(base_a);
+    const InterpState *b = dynamic_cast<const InterpState *>(base_b);
+    if(!a || !b) return false;
+#define COMPARE_FIELD(f) if(memcmp(&a->f, &b->f, sizeof(a->f))) return false;
+    CHECKPOINT_POSITION_FIELDS(COMPARE_FIELD)
+#undef COMPARE_FIELD
+    if(memcmp(a->parameters, b->parameters, sizeof(a->parameters)))
+        return false;
+    return same_modes(a, b);
+}
+
+/***********************************************************************/
+
+/*! Interp::same_modes
+
+Returned Value: true if both checkpoints describe the same modal state,
+wherever the tool is
+
+Called By: external programs (task)
+
+Like same_state, except that the current position, in the setup and in
+parameters 5420 to 5428, is not compared, so that two runs started from
+different places can be matched up.
+
+*/
+
+bool Interp::same_modes(const InterpCheckpoint *base_a,
+                        const InterpCheckpoint *base_b)
+{
+    const InterpState *a = dynamic_cast<const InterpState *>(base_a);
+    const InterpState *b = dynamic_cast<const InterpState *>(base_b);
+    if(!a || !b) return false;
+#define COMPARE_FIELD(f) if(memcmp(&a->f, &b->f, sizeof(a->f))) return false;
+    CHECKPOINT_MODAL_FIELDS(COMPARE_FIELD)
+#undef COMPARE_FIELD
+    if(memcmp(a->parameters, b->parameters, 5420 * sizeof(double)))
+        return false;
+    if(memcmp(a->parameters + 5429, b->parameters + 5429,
+              (RS274NGC_MAX_PARAMETERS - 5429) * sizeof(double)))
+        return false;
+    if(a->global_params.size() != b->global_params.size()) return false;
+    parameter_map::const_iterator i = a->global_params.begin(),
+        j = b->global_params.begin();
+    for(; i != a->global_params.end(); ++i, ++j) {
+        if(strcasecmp(i->first, j->first)) return false;
+        if(i->second.value != j->second.value) return false;
+        if(i->second.attr != j->second.attr) return false;
+    }
+    return true;
+}
@@ -28,6 +28,7 @@
 #include "rs274ngc_interp.hh"
 #include "interp_internal.hh"
 #include "interp_queue.hh"
+#include "interp_profile.hh"
 
 #include "units.h"
 #define TOOL_INSIDE_ARC(side, turn) (((side)==LEFT&&(turn)>0)||((side)==RIGHT&&(turn)<0))
@@ -638,6 +639,7 @@ int Interp::convert_arc_comp1(int move,  //!< either G_2 (cw arc) or G_3 (ccw ar
                               double CC_end,     //!< c-value at end of arc
                               double u_end, double v_end, double w_end) //!< uvw at end of arc
 {
+    profile_timer timer(settings->profile, PROF_CUTTER_COMP);
     double center_x, center_y;
     double gamma;                 /* direction of perpendicular to arc at end */
     int side;                     /* offset side - right or left              */
@@ -788,6 +790,7 @@ int Interp::convert_arc_comp2(int move,  //!< either G_2 (cw arc) or G_3 (ccw ar
                               double CC_end,     //!< c-value at end of arc
                               double u, double v, double w) //!< uvw at end of arc
 {
+    profile_timer timer(settings->profile, PROF_CUTTER_COMP);
     double alpha;                 /* direction of tangent to start of arc */
     double arc_radius;
     double beta;                  /* angle between two tangents above */
@@ -4729,6 +4732,7 @@ int Interp::convert_straight_comp1(int move,     //!< either G_0 or G_1
                                    double CC_end,        //!< C coordinate of end point          
                                    double u_end, double v_end, double w_end)
 {
+    profile_timer timer(settings->profile, PROF_CUTTER_COMP);
     double alpha;
     double distance;
     double radius = settings->cutter_comp_radius; /* always will be positive */
@@ -4858,6 +4862,7 @@ int Interp::convert_straight_comp2(int move,     //!< either G_0 or G_1
                                    double CC_end,        //!< C coordinate of end point
                                    double u_end, double v_end, double w_end)
 {
+    profile_timer timer(settings->profile, PROF_CUTTER_COMP);
     double alpha;
     double beta;
     double end_x, end_y, end_z;                 /* x-coordinate of actual end point */
@@ -0,0 +1,417 @@
+/********************************************************************
+* Description: interp_expression.cc
+*
+*   Compiled bracketed expressions.  Loops and subroutines read the same
+*   expression text over and over; instead of scanning the characters,
+*   converting the numbers and sorting out operator precedence on every
+*   pass, an expression is turned into a small stack program once and
+*   that is run on later passes.
+*
+* License: GPL Version 2
+* System: Linux
+*
+********************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include <ctype.h>
+#include "rs274ngc.hh"
+#include "rs274ngc_return.hh"
+#include "interp_internal.hh"
+#include "interp_profile.hh"
+#include "rs274ngc_interp.hh"
+#include "rtapi_math.h"
+#include <cmath>
+
+#define MAX_STACK 7
+
+// the length of the bracketed expression at line, or 0 if it is not closed;
+// brackets inside a parameter name (#<_ini[section]name>) do not count
+static int expression_length(const char *line)
+{
+  int depth = 0;
+  for (int i = 0; line[i]; i++) {
+    if (line[i] == '<') {
+      const char *close = strchr(line + i, '>');
+      if (!close) return 0;
+      i = close - line;
+    } else if (line[i] == '[') {
+      depth++;
+    } else if (line[i] == ']') {
+      if (--depth == 0) return i + 1;
+    }
+  }
+  return 0;
+}
+
+static void emit(expression_program &program, int code, int arg = 0,
+                 double value = 0)
+{
+  expression_op op = {code, arg, value};
+  program.ops.push_back(op);
+  switch (code) {
+  case EXPR_NUMBER:
+  case EXPR_NAMED:
+  case EXPR_NAMED_EXISTS:
+    program.sp++;
+    break;
+  case EXPR_ATAN:
+  case EXPR_BINARY:
+    program.sp--;
+    break;
+  }
+  program.stack_size = std::max(program.stack_size, program.sp);
+}
+
+/****************************************************************************/
+
+/*! read_cached_expression
+
+Returned Value: int
+   The result of execute_expression or read_real_expression.
+
+Side effects:
+   As for read_real_expression.  The expression is entered in the
+   expression cache, or compiled if it was already there.
+
+Called by: read_real_expression
+
+Only outermost expressions go through the cache; the expressions nested
+in them are part of the same compiled program.
+
+*/
+
+int Interp::read_cached_expression(char *line,   //!< string: line of RS274/NGC code being processed
+                                   int *counter, //!< pointer to a counter for position on the line
+                                   double *value,        //!< pointer to double to be computed
+                                   double *parameters)   //!< array of system parameters
+{
+  profile_timer timer(_setup.profile, PROF_EXPRESSION);
+  int length = expression_length(line + *counter);
+  std::string key(line + *counter, length);
+  expression_cache_map &cache = _setup.expression_cache;
+  expression_cache_map::iterator it = length ? cache.find(key) : cache.end();
+
+  if (it != cache.end() && !it->second.ops.empty()) {
+    CHP(execute_expression(it->second, value, parameters));
+    *counter += length;
+    return INTERP_OK;
+  }
+
+  _setup.expression_depth++;
+  int status = read_real_expression(line, counter, value, parameters);
+  _setup.expression_depth--;
+  CHP(status);
+  if (!length) return INTERP_OK;
+
+  if (it == cache.end()) {
+    if (cache.size() >= EXPRESSION_CACHE_MAX) cache.clear();
+    cache[key].uses = 1;
+  } else if (it->second.uses > 0) {
+    // read without error once already, so compiling it cannot fail on
+    // bad syntax; anything else that goes wrong leaves it uncompiled
+    expression_program &program = it->second;
+    std::vector<char> text(key.begin(), key.end());
+    text.push_back(0);
+    int position = 0;
+    if (!compile_real_expression(&text[0], &position, program)
+        || position != length || program.sp != 1
+        || program.stack_size > EXPRESSION_STACK) {
+      program = expression_program();
+      program.uses = -1;
+    }
+  }
+  return INTERP_OK;
+}
+
+/****************************************************************************/
+
+/*! compile_real_expression
+
+Returned Value: bool
+   true if the expression was compiled.
+
+Side effects:
+   The program for the expression at the counter is appended to program,
+   and the counter is moved past the closing bracket.
+
+Called by:
+   read_cached_expression
+   compile_real_value
+   compile_unary
+
+This follows read_real_expression step by step, emitting each binary
+operation where read_real_expression would execute it, so that values
+are read and operations executed in the same order and the same error
+is reported first.
+
+*/
+
+bool Interp::compile_real_expression(char *line, int *counter,
+                                     expression_program &program)
+{
+  int operators[MAX_STACK];
+  int stack_index;
+
+  if (line[*counter] != '[') return false;
+  *counter = (*counter + 1);
+  if (!compile_real_value(line, counter, program)) return false;
+  if (read_operation(line, counter, operators) != INTERP_OK) return false;
+  stack_index = 1;
+  for (; operators[0] != RIGHT_BRACKET;) {
+    if (stack_index >= MAX_STACK) return false;
+    if (!compile_real_value(line, counter, program)) return false;
+    if (read_operation(line, counter, operators + stack_index) != INTERP_OK)
+      return false;
+    if (precedence(operators[stack_index]) >
+        precedence(operators[stack_index - 1]))
+      stack_index++;
+    else {
+      for (; precedence(operators[stack_index]) <=
+           precedence(operators[stack_index - 1]);) {
+        emit(program, EXPR_BINARY, operators[stack_index - 1]);
+        operators[stack_index - 1] = operators[stack_index];
+        if ((stack_index > 1) &&
+            (precedence(operators[stack_index - 1]) <=
+             precedence(operators[stack_index - 2])))
+          stack_index--;
+        else
+          break;
+      }
+    }
+  }
+  return true;
+}
+
+/****************************************************************************/
+
+/*! compile_real_value
+
+Returned Value: bool
+   true if the value was compiled.
+
+Called by:
+   compile_real_expression
+   compile_parameter
+   compile_real_value
+
+The compiled counterpart of read_real_value.
+
+*/
+
+bool Interp::compile_real_value(char *line, int *counter,
+                                expression_program &program)
+{
+  char c, c1;
+
+  c = line[*counter];
+  if (c == 0) return false;
+  c1 = line[*counter+1];
+
+  if (c == '[') {
+    if (!compile_real_expression(line, counter, program)) return false;
+  } else if (c == '#') {
+    if (!compile_parameter(line, counter, program, false)) return false;
+  } else if (c == '+' && c1 && !isdigit(c1) && c1 != '.') {
+    (*counter)++;
+    if (!compile_real_value(line, counter, program)) return false;
+  } else if (c == '-' && c1 && !isdigit(c1) && c1 != '.') {
+    (*counter)++;
+    if (!compile_real_value(line, counter, program)) return false;
+    emit(program, EXPR_NEGATE);
+  } else if ((c >= 'a') && (c <= 'z')) {
+    if (!compile_unary(line, counter, program)) return false;
+  } else {
+    double number;
+    if (read_real_number(line, counter, &number) != INTERP_OK) return false;
+    emit(program, EXPR_NUMBER, 0, number);
+  }
+  emit(program, EXPR_CHECK);
+  return true;
+}
+
+/****************************************************************************/
+
+/*! compile_parameter
+
+Returned Value: bool
+   true if the parameter reference was compiled.
+
+Called by:
+   compile_real_value
+   compile_unary
+
+The compiled counterpart of read_parameter.  A numbered parameter is
+looked up by an index computed at run time, since it may be ##n or
+#[expression]; a named parameter keeps its name.
+
+*/
+
+bool Interp::compile_parameter(char *line, int *counter,
+                               expression_program &program, bool check_exists)
+{
+  if (line[*counter] != '#') return false;
+  *counter = (*counter + 1);
+  if (line[*counter] == '<') {
+    char paramNameBuf[LINELEN+1];
+    if (read_name(line, counter, paramNameBuf) != INTERP_OK) return false;
+    program.names.push_back(paramNameBuf);
+    program.slots.push_back(named_slot());
+    emit(program, check_exists ? EXPR_NAMED_EXISTS : EXPR_NAMED,
+         program.names.size() - 1);
+  } else {
+    if (!compile_real_value(line, counter, program)) return false;
+    emit(program, check_exists ? EXPR_PARAMETER_EXISTS : EXPR_PARAMETER);
+  }
+  return true;
+}
+
+/****************************************************************************/
+
+/*! compile_unary
+
+Returned Value: bool
+   true if the unary operation was compiled.
+
+Called by: compile_real_value
+
+The compiled counterpart of read_unary, read_atan and, for exists[],
+read_bracketed_parameter.
+
+*/
+
+bool Interp::compile_unary(char *line, int *counter,
+                           expression_program &program)
+{
+  int operation;
+
+  if (read_operation_unary(line, counter, &operation) != INTERP_OK)
+    return false;
+  if (line[*counter] != '[') return false;
+
+  if (operation == EXISTS) {
+    *counter = (*counter + 1);
+    if (line[*counter] != '#') return false;
+    if (!compile_parameter(line, counter, program, true)) return false;
+    if (line[*counter] != ']') return false;
+    *counter = (*counter + 1);
+    return true;
+  }
+
+  if (!compile_real_expression(line, counter, program)) return false;
+  if (operation == ATAN) {
+    if (line[*counter] != '/') return false;
+    *counter = (*counter + 1);
+    if (line[*counter] != '[') return false;
+    if (!compile_real_expression(line, counter, program)) return false;
+    emit(program, EXPR_ATAN);
+  } else
+    emit(program, EXPR_UNARY, operation);
+  return true;
+}
+
+/****************************************************************************/
+
+/*! execute_expression
+
+Returned Value: int
+   If execute_binary, execute_unary or named_parameter_value returns an
+   error code, this returns that code.
+   If any of the following errors occur, this returns the error code shown.
+   Otherwise, it returns INTERP_OK.
+   1. A parameter index is not an integer: NCE_NON_INTEGER_VALUE_FOR_INTEGER
+   2. A parameter index is out of range: NCE_PARAMETER_NUMBER_OUT_OF_RANGE
+   3. A value is not a number or infinite.
+
+Side effects:
+   The value of the expression is put into what value points at.
+
+Called by: read_cached_expression
+
+The checks are those of read_integer_value, read_parameter and
+read_real_value, made at the same points.
+
+*/
+
+int Interp::execute_expression(const expression_program &program,
+                               double *value,
+                               double *parameters)
+{
+  double stack[EXPRESSION_STACK];
+  int sp = 0;
+
+  for (size_t i = 0; i < program.ops.size(); i++) {
+    const expression_op &op = program.ops[i];
+    switch (op.code) {
+    case EXPR_NUMBER:
+      stack[sp++] = op.value;
+      break;
+    case EXPR_PARAMETER:
+    case EXPR_PARAMETER_EXISTS: {
+      double float_value = stack[sp - 1];
+      int index = (int) floor(float_value);
+      if ((float_value - index) > 0.9999) {
+        index = (int) ceil(float_value);
+      } else if ((float_value - index) > 0.0001)
+        ERS(NCE_NON_INTEGER_VALUE_FOR_INTEGER);
+      if (op.code == EXPR_PARAMETER_EXISTS) {
+        stack[sp - 1] = index >= 1 && index < RS274NGC_MAX_PARAMETERS;
+        break;
+      }
+      CHKS(((index < 1) || (index >= RS274NGC_MAX_PARAMETERS)),
+          NCE_PARAMETER_NUMBER_OUT_OF_RANGE);
+      CHKS(((index >= 5420) && (index <= 5428) && (_setup.cutter_comp_side)),
+           _("Cannot read current position with cutter radius compensation on"));
+      stack[sp - 1] = parameters[index];
+      break;
+    }
+    case EXPR_NAMED:
+    case EXPR_NAMED_EXISTS: {
+      const char *name = program.names[op.arg].c_str();
+      named_slot &slot = program.slots[op.arg];
+      int level = (name[0] == '_') ? 0 : _setup.call_level;
+      context_pointer frame = &_setup.sub_context[level];
+      // values found elsewhere, and unset ones which warn, take the
+      // long way through find_named_param every time
+      if (slot.value && slot.level == level &&
+          slot.generation == frame->named_generation &&
+          !(slot.value->attr & (PA_UNSET | PA_USE_LOOKUP | PA_PYTHON))) {
+        stack[sp++] = (op.code == EXPR_NAMED_EXISTS) ? 1.0 : slot.value->value;
+        break;
+      }
+      stack[sp] = 0;
+      CHP(named_parameter_value(name, &stack[sp], op.code == EXPR_NAMED_EXISTS));
+      sp++;
+      parameter_map_iterator pi = frame->named_params.find(name);
+      slot.level = level;
+      slot.generation = frame->named_generation;
+      slot.value = (pi == frame->named_params.end()) ? 0 : &pi->second;
+      break;
+    }
+    case EXPR_NEGATE:
+      stack[sp - 1] = -stack[sp - 1];
+      break;
+    case EXPR_UNARY:
+      CHP(execute_unary(&stack[sp - 1], op.arg));
+      break;
+    case EXPR_ATAN:
+      sp--;
+      stack[sp - 1] = atan2(stack[sp - 1], stack[sp]);  /* value in radians */
+      stack[sp - 1] = ((stack[sp - 1] * 180.0) / M_PIl);   /* convert to degrees */
+      break;
+    case EXPR_BINARY:
+      sp--;
+      CHP(execute_binary(&stack[sp - 1], op.arg, &stack[sp]));
+      break;
+    case EXPR_CHECK:
+      CHKS(std::isnan(stack[sp - 1]),
+              _("Calculation resulted in 'not a number'"));
+      CHKS(std::isinf(stack[sp - 1]),
+              _("Calculation resulted in 'infinity'"));
+      break;
+    }
+  }
+  *value = stack[0];
+  return INTERP_OK;
+}
@@ -0,0 +1,156 @@
+/********************************************************************
+* Description: interp_file_cache.cc
+*
+*   Opening program and subroutine files.  Subroutine calls reopen
+*   their files over and over, which is slow on network file systems;
+*   files of moderate size are read once and later opens are served
+*   from memory for as long as the file is unchanged.
+*
+* License: GPL Version 2
+* System: Linux
+*
+********************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <string>
+
+#include "rs274ngc.hh"
+#include "rs274ngc_return.hh"
+#include "interp_internal.hh"
+#include "rs274ngc_interp.hh"
+
+// a read-only stream on a cached file; it holds a reference to the text
+struct file_cookie {
+    boost::shared_ptr<const std::string> text;
+    off64_t position;
+};
+
+static ssize_t cookie_read(void *c, char *buf, size_t size)
+{
+    file_cookie *cookie = (file_cookie *) c;
+    const std::string &text = *cookie->text;
+    if (cookie->position >= (off64_t) text.size()) return 0;
+    size_t n = std::min(size, (size_t) (text.size() - cookie->position));
+    memcpy(buf, text.data() + cookie->position, n);
+    cookie->position += n;
+    return n;
+}
+
+static int cookie_seek(void *c, off64_t *offset, int whence)
+{
+    file_cookie *cookie = (file_cookie *) c;
+    off64_t position;
+    switch (whence) {
+    case SEEK_SET: position = *offset; break;
+    case SEEK_CUR: position = cookie->position + *offset; break;
+    case SEEK_END: position = cookie->text->size() + *offset; break;
+    default: errno = EINVAL; return -1;
+    }
+    if (position < 0) { errno = EINVAL; return -1; }
+    *offset = cookie->position = position;
+    return 0;
+}
+
+static int cookie_close(void *c)
+{
+    delete (file_cookie *) c;
+    return 0;
+}
+
+static FILE *open_text(boost::shared_ptr<const std::string> text)
+{
+    cookie_io_functions_t functions = {
+        cookie_read, NULL, cookie_seek, cookie_close
+    };
+    file_cookie *cookie = new file_cookie;
+    cookie->text = text;
+    cookie->position = 0;
+    FILE *fp = fopencookie(cookie, "r", functions);
+    if (!fp) delete cookie;
+    return fp;
+}
+
+static FILE *open_buffered(const char *path)
+{
+    FILE *fp = fopen(path, "r");
+    if (fp) setvbuf(fp, NULL, _IOFBF, FILE_READ_BUFFER);
+    return fp;
+}
+
+static bool same_file(const file_cache_entry &entry, const struct stat &st)
+{
+    return entry.dev == st.st_dev && entry.ino == st.st_ino
+        && entry.size == st.st_size
+        && entry.mtime.tv_sec == st.st_mtim.tv_sec
+        && entry.mtime.tv_nsec == st.st_mtim.tv_nsec;
+}
+
+/***********************************************************************/
+
+/*! Interp::open_ngc_file
+
+Returned Value: an open stream positioned at the start of the file, or
+   NULL with errno set as by fopen
+
+Called By:
+   Interp::open
+   Interp::find_ngc_file
+   Interp::control_back_to
+   Interp::execute_return
+   Interp::unwind_call
+
+Used in place of fopen(path, "r") for G-code files.  Files up to
+FILE_CACHE_MAX_SIZE are kept in settings->file_cache and opened from
+memory; the file is read again once its size, inode or modification
+time has changed.  Larger files, and anything that is not a regular
+file, are opened with a FILE_READ_BUFFER stdio buffer so that each
+refill reads ahead a good part of the program.
+
+*/
+
+FILE *Interp::open_ngc_file(setup_pointer settings, const char *path)
+{
+    struct stat st;
+    if (stat(path, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0
+            || st.st_size > FILE_CACHE_MAX_SIZE)
+        return open_buffered(path);
+
+    file_cache_map::iterator it = settings->file_cache.find(path);
+    if (it != settings->file_cache.end() && same_file(it->second, st))
+        return open_text(it->second.text);
+
+    FILE *fp = fopen(path, "r");
+    if (!fp) return NULL;
+    std::string *text = new std::string;
+    text->resize(st.st_size);
+    size_t n = fread(&(*text)[0], 1, st.st_size, fp);
+    bool complete = n == (size_t) st.st_size && fgetc(fp) == EOF && !ferror(fp);
+    if (!complete) {
+        // changing while we read it; leave it to stdio
+        delete text;
+        fclose(fp);
+        return open_buffered(path);
+    }
+    fclose(fp);
+
+    if (it != settings->file_cache.end()) {
+        settings->file_cache_bytes -= it->second.size;
+        settings->file_cache.erase(it);
+    }
+    if (settings->file_cache_bytes + st.st_size > FILE_CACHE_BYTES) {
+        settings->file_cache.clear();
+        settings->file_cache_bytes = 0;
+    }
+    file_cache_entry &entry = settings->file_cache[path];
+    entry.dev = st.st_dev;
+    entry.ino = st.st_ino;
+    entry.size = st.st_size;
+    entry.mtime = st.st_mtim;
+    entry.text.reset(text);
+    settings->file_cache_bytes += st.st_size;
+    return open_text(entry.text);
+}
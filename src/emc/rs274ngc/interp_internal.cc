@@ -22,6 +22,7 @@
 #include "rs274ngc.hh"
 #include "rs274ngc_return.hh"
 #include "interp_internal.hh"	// interpreter private definitions
+#include "interp_profile.hh"
 #include "rs274ngc_interp.hh"
 
 /****************************************************************************/
@@ -317,8 +318,7 @@ int Interp::init_block(block_pointer block)      //!< pointer to a block to be i
 Returned Value: int
    If any of the following functions returns an error code,
    this returns that code.
-     init_block
-     read_items
+     read_cached_items
      enhance_block
      check_items
    Otherwise, it returns INTERP_OK.
@@ -335,8 +335,7 @@ int Interp::parse_line(char *line,       //!< array holding a line of RS274 code
                       block_pointer block,      //!< pointer to a block to be filled     
                       setup_pointer settings)   //!< pointer to machine settings         
 {
-  CHP(init_block(block));
-  CHP(read_items(block, line, settings->parameters));
+  CHP(read_cached_items(block, line, settings));
 
   if(settings->skipping_o == 0)
   {
@@ -350,6 +349,69 @@ int Interp::parse_line(char *line,       //!< array holding a line of RS274 code
 
 /****************************************************************************/
 
+/*! read_cached_items
+
+Returned Value: int
+   If init_block or read_items returns an error code, this returns that code.
+   Otherwise, it returns INTERP_OK.
+
+Side effects:
+   The block is filled as by init_block and read_items, from the block
+   cache if the line at this file offset was read before.
+
+Called by: parse_line
+
+Loop bodies and subroutines that are run many times read the same lines
+again and again; lines whose reading does not depend on the interpreter
+state are lexed and converted only once.  The fields that are not filled
+by reading a line are kept.
+
+*/
+
+int Interp::read_cached_items(block_pointer block, //!< pointer to a block to be filled
+                              char *line,          //!< array holding a line of RS274 code
+                              setup_pointer settings) //!< pointer to machine settings
+{
+  profile_timer timer(settings->profile, PROF_READ_ITEMS);
+  bool cacheable = settings->file_pointer && settings->filename[0]
+      && !settings->skipping_o && !strpbrk(line, "#;");
+  if (cacheable) {
+    int n = (line[0] == '/');
+    if (line[n] == 'n')
+      for (n++; isdigit(line[n]) || line[n] == '.'; n++);
+    cacheable = line[n] != 'o';
+  }
+  if (!cacheable) {
+    CHP(init_block(block));
+    CHP(read_items(block, line, settings->parameters));
+    return INTERP_OK;
+  }
+
+  block_cache_map::key_type key(settings->filename, block->offset);
+  block_cache_map::iterator it = settings->block_cache.find(key);
+  if (it != settings->block_cache.end() && it->second.text == line &&
+      it->second.lathe_diameter_mode == settings->lathe_diameter_mode) {
+    int saved_line_number = block->saved_line_number;
+    int phase = block->phase;
+    *block = it->second.parsed;
+    block->saved_line_number = saved_line_number;
+    block->phase = phase;
+    return INTERP_OK;
+  }
+
+  CHP(init_block(block));
+  CHP(read_items(block, line, settings->parameters));
+  if (settings->block_cache.size() >= BLOCK_CACHE_MAX)
+    settings->block_cache.clear();
+  block_cache_entry &entry = settings->block_cache[key];
+  entry.text = line;
+  entry.lathe_diameter_mode = settings->lathe_diameter_mode;
+  entry.parsed = *block;
+  return INTERP_OK;
+}
+
+/****************************************************************************/
+
 /*! precedence
 
 Returned Value: int
@@ -19,7 +19,12 @@
 #include <stdio.h>
 #include <set>
 #include <map>
+#include <string>
+#include <vector>
 #include <bitset>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <boost/shared_ptr.hpp>
 #include "canon.hh"
 #include "emcpos.h"
 #include "libintl.h"
@@ -349,6 +354,10 @@ typedef struct remap_struct {
     const char *remap_py;    // Py function maybe  null, OR
     const char *remap_ngc;   // NGC file, maybe  null
     const char *epilog_func; // Py function or null
+    // PythonPlugin::callable_handle() of the functions, 0 until first called
+    int prolog_handle;
+    int remap_py_handle;
+    int epilog_handle;
 } remap;
 
 
@@ -527,6 +536,88 @@ typedef parameter_value *parameter_pointer;
 typedef std::map<const char *, parameter_value, nocase_cmp> parameter_map;
 typedef parameter_map::iterator parameter_map_iterator;
 
+// A bracketed expression compiled into a small stack program by
+// Interp::compile_real_expression and run by Interp::execute_expression.
+// The cache is keyed by the text of the expression; an entry is compiled
+// the second time its text is read, so straight-line programs only pay
+// for the lookup.
+enum expression_codes {
+    EXPR_NUMBER,            // push value
+    EXPR_PARAMETER,         // replace the index on top by #index
+    EXPR_PARAMETER_EXISTS,  // replace the index on top by exists[#index]
+    EXPR_NAMED,             // push the named parameter names[arg]
+    EXPR_NAMED_EXISTS,      // push exists[#<names[arg]>]
+    EXPR_NEGATE,
+    EXPR_UNARY,             // unary operation arg
+    EXPR_ATAN,              // atan[]/[] of the top two
+    EXPR_BINARY,            // binary operation arg on the top two
+    EXPR_CHECK,             // not a number or infinity is an error
+};
+
+struct expression_op {
+    int code;
+    int arg;
+    double value;
+};
+
+#define EXPRESSION_STACK 32
+#define EXPRESSION_CACHE_MAX 1000
+
+// Where a named parameter of a compiled expression was last found: the
+// call level it was looked up at and its entry there.  The entry is used
+// directly while that frame's named_generation is unchanged; map entries
+// don't move when others are added.
+struct named_slot {
+    int level;
+    unsigned generation;
+    parameter_pointer value;    // NULL when not resolved
+    named_slot() : level(0), generation(0), value(0) {}
+};
+
+struct expression_program {
+    int uses;                   // 1 once read successfully, -1 if not compilable
+    int sp, stack_size;         // stack depth while compiling, and its maximum
+    std::vector<expression_op> ops;
+    std::vector<std::string> names;
+    mutable std::vector<named_slot> slots;  // one for each of names
+    expression_program() : uses(0), sp(0), stack_size(0) {}
+};
+
+typedef std::map<std::string, expression_program> expression_cache_map;
+
+// Blocks as left by read_items, by file name and offset of the line.  A
+// line is only cached when reading it has no side effects and does not
+// depend on parameters: no o-word, no '#' and no ';' comment.  An entry
+// is used only if the line text is unchanged, so an edited file simply
+// misses.
+struct block_cache_entry {
+    std::string text;           // blocktext the entry was read from
+    bool lathe_diameter_mode;   // read_x halves x in diameter mode
+    block parsed;
+};
+
+#define BLOCK_CACHE_MAX 4096
+
+typedef std::map<std::pair<std::string, long>, block_cache_entry> block_cache_map;
+
+// Contents of program and subroutine files, by path.  An entry is used
+// while the file's inode, size and modification time are unchanged; the
+// streams opened on it share the text, so replacing an entry does not
+// disturb a file that is still being read.
+struct file_cache_entry {
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    struct timespec mtime;
+    boost::shared_ptr<const std::string> text;
+};
+
+#define FILE_CACHE_MAX_SIZE (4 << 20)    // larger files are read through stdio
+#define FILE_CACHE_BYTES (32 << 20)
+#define FILE_READ_BUFFER (64 << 10)
+
+typedef std::map<std::string, file_cache_entry> file_cache_map;
+
 #define PA_READONLY	1
 #define PA_GLOBAL	2
 #define PA_UNSET	4
@@ -544,6 +635,8 @@ typedef parameter_map::iterator parameter_map_iterator;
 #define M_MODE_OK(m) ((m > 3) && (m < 11))
 #define G_MODE_OK(m) (m == 1)
 
+struct interp_profile;
+
 struct pycontext_impl;
 struct pycontext {
     pycontext();
@@ -562,6 +655,7 @@ typedef struct context_struct {
     const char *subName;       // name of the subroutine (oword)
     double saved_params[INTERP_SUB_PARAMS];
     parameter_map named_params;
+    unsigned named_generation;  // changed whenever an entry is removed
     unsigned char context_status;		// see CONTEXT_ defines below
     int saved_g_codes[ACTIVE_G_CODES];  // array of active G codes
     int saved_m_codes[ACTIVE_M_CODES];  // array of active M codes
@@ -714,6 +808,7 @@ struct setup
   EmcPose tool_offset;          // tool length offset
   int pockets_max;                 // number of pockets in carousel (including pocket 0, the spindle)
   CANON_TOOL_TABLE tool_table[CANON_POCKETS_MAX];      // index is pocket number
+  CANON_TOOL_INDEX tool_index;  // tool number to pocket, built by load_tool_table
   double traverse_rate;         // rate for traverse motions
   double orient_offset;         // added to M19 R word, from [RS274NGC]ORIENT_OFFSET
 
@@ -733,6 +828,11 @@ struct setup
   context sub_context[INTERP_SUB_ROUTINE_LEVELS];
   int call_state;                  //  enum call_states - inidicate Py handler reexecution
   offset_map_type offset_map;      // store label x name, file, line
+  expression_cache_map expression_cache; // compiled expressions by text
+  block_cache_map block_cache;       // parsed lines by file and offset
+  file_cache_map file_cache;         // program files by path
+  long file_cache_bytes;             // total size of file_cache
+  int expression_depth;              // nesting of read_real_expression
 
   bool adaptive_feed;              // adaptive feed is enabled
   bool feed_hold;                  // feed hold is enabled
@@ -772,7 +872,14 @@ struct setup
 #define FEATURE_OWORD_WARNONLY       0x00000020
 
     boost::python::object *pythis;  // boost::cref to 'this'
+    boost::python::object *pyselfargs;  // the tuple (this,) for remap handlers
+    boost::python::object *pyparams, *pyparameters; // this.params, this.parameters
     const char *on_abort_command;
+    interp_profile *profile;  // timing, see interp_profile.hh, or NULL
+    // the parameter file as save_parameters() last wrote it
+    std::string var_file, var_file_text;
+    std::vector<int> var_file_vars;
+    struct stat var_file_stat;
     int_remap_map  g_remapped,m_remapped;
     remap_map remaps;
 #define INIT_FUNC  "__init__"
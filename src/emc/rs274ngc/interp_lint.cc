@@ -0,0 +1,552 @@
+/********************************************************************
+* Description: interp_lint.cc
+*
+*   Checking a program without running it.  The main file and each
+*   subroutine file it reaches are read once, the files of one round
+*   of calls in parallel, and every problem found is reported instead
+*   of only the first.  Lines are lexed, not evaluated, so the checks
+*   cover what is written: the o-word structure, calls of subroutines
+*   that can't be found, named parameters that are read but never set,
+*   and G and M codes that are unknown or clash on one line.
+*
+* License: GPL Version 2
+* System: Linux
+*
+********************************************************************/
+
+#include <ctype.h>
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "rs274ngc.hh"
+#include "rs274ngc_return.hh"
+#include "interp_internal.hh"
+#include "rs274ngc_interp.hh"
+
+#define LINT_CODES 1000     // G codes times ten, and M codes
+
+// Known before the files are read, and shared read-only by the threads
+struct lint_tables {
+    int g_group[LINT_CODES];    // modal group, -1 if unknown
+    int m_group[LINT_CODES];
+    const char *g_ngc[LINT_CODES];      // subroutine of a remap, or NULL
+    const char *m_ngc[LINT_CODES];
+    std::set<std::string> remap_subs;   // get their named locals from the remap
+};
+
+struct lint_use {
+    std::string name;
+    int line;
+};
+
+struct lint_job {
+    const lint_tables *tables;
+    std::string path;
+    bool main;
+    std::string caller, expect; // where the file was called from, for what
+    int caller_line;
+    std::vector<InterpDiagnostic> diags;
+    std::set<std::string> subs;         // defined in the file
+    std::vector<lint_use> calls;        // of subroutines not defined in it
+    std::set<std::string> globals_set;
+    std::vector<lint_use> globals_used;
+    lint_job() : tables(0), main(false), caller_line(0) {}
+};
+
+// named locals of the main program or of one subroutine
+struct lint_scope {
+    bool check;
+    std::set<std::string> set;
+    std::vector<lint_use> used;
+    lint_scope() : check(false) {}
+};
+
+struct lint_block {
+    std::string label;          // "<name>" or the number
+    std::string kind;
+    int line;
+};
+
+static void lint_diag(std::vector<InterpDiagnostic> &diags,
+        const std::string &path, int line, const char *fmt, ...)
+{
+    char buf[LINELEN];
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    InterpDiagnostic d;
+    d.filename = path;
+    d.line = line;
+    d.message = buf;
+    diags.push_back(d);
+}
+
+#define DIAG(line, ...) lint_diag(job->diags, job->path, line, __VA_ARGS__)
+
+static void check_scope(lint_job *job, lint_scope &scope)
+{
+    if (!scope.check) return;
+    std::set<std::string> reported;
+    for (size_t i = 0; i < scope.used.size(); i++) {
+        const lint_use &u = scope.used[i];
+        if (scope.set.count(u.name) || reported.count(u.name)) continue;
+        reported.insert(u.name);
+        DIAG(u.line, _("Named parameter #<%s> is never set"), u.name.c_str());
+    }
+}
+
+// Close the innermost open 'kind' block labelled 'label'; blocks left
+// open inside it are reported
+static bool close_block(lint_job *job, std::vector<lint_block> &stack,
+        const std::string &label, const char *kind, const char *closer,
+        int line)
+{
+    size_t n = stack.size();
+    while (n > 0 && !(stack[n-1].label == label && stack[n-1].kind == kind))
+        n--;
+    if (n == 0) {
+        DIAG(line, _("o%s %s without %s"), label.c_str(), closer, kind);
+        return false;
+    }
+    for (size_t i = stack.size(); i > n; i--)
+        DIAG(stack[i-1].line, _("o%s %s is not closed"),
+             stack[i-1].label.c_str(), stack[i-1].kind.c_str());
+    stack.resize(n - 1);
+    return true;
+}
+
+static bool inside(const std::vector<lint_block> &stack,
+        const std::string &label, const char *k1, const char *k2 = 0,
+        const char *k3 = 0)
+{
+    for (size_t i = 0; i < stack.size(); i++) {
+        const lint_block &b = stack[i];
+        if (b.label == label && (b.kind == k1 || (k2 && b.kind == k2)
+                || (k3 && b.kind == k3)))
+            return true;
+    }
+    return false;
+}
+
+static void check_g(lint_job *job, int line, double v, int *g_modes)
+{
+    const lint_tables *t = job->tables;
+    double v10 = 10.0 * v;
+    int value = (int) floor(v10);
+    if ((v10 - value) > 0.999)
+        value = (int) ceil(v10);
+    else if ((v10 - value) > 0.001) {
+        DIAG(line, "%s", NCE_G_CODE_OUT_OF_RANGE);
+        return;
+    }
+    if (value >= LINT_CODES) {
+        DIAG(line, "%s", NCE_G_CODE_OUT_OF_RANGE);
+        return;
+    }
+    int mode = t->g_group[value];
+    if (mode < 0) {
+        DIAG(line, "%s: G%g", NCE_UNKNOWN_G_CODE_USED, value / 10.0);
+        return;
+    }
+    if (t->g_ngc[value]) {
+        lint_use u = { t->g_ngc[value], line };
+        job->calls.push_back(u);
+    }
+    if (mode >= 16) return;
+    if (value == G_80 && g_modes[mode] != -1)
+        return;
+    if (g_modes[mode] != -1 && g_modes[mode] != G_80)
+        DIAG(line, "%s: G%g G%g", NCE_TWO_G_CODES_USED_FROM_SAME_MODAL_GROUP,
+             g_modes[mode] / 10.0, value / 10.0);
+    g_modes[mode] = value;
+}
+
+static void check_m(lint_job *job, int line, double v, int *m_modes)
+{
+    const lint_tables *t = job->tables;
+    int value = (int) floor(v + 0.0002);
+    if (v - value > 0.0002) {
+        DIAG(line, "%s: M%g", NCE_NON_INTEGER_VALUE_FOR_INTEGER, v);
+        return;
+    }
+    int mode = value < LINT_CODES ? t->m_group[value] : -1;
+    if (mode < 0) {
+        if (value > 199) DIAG(line, NCE_M_CODE_GREATER_THAN_199, value);
+        else DIAG(line, NCE_UNKNOWN_M_CODE_USED, value);
+        return;
+    }
+    if (t->m_ngc[value]) {
+        lint_use u = { t->m_ngc[value], line };
+        job->calls.push_back(u);
+    }
+    if (mode > 10) return;
+    if (m_modes[mode] != -1)
+        DIAG(line, "%s: M%d M%d", NCE_TWO_M_CODES_USED_FROM_SAME_MODAL_GROUP,
+             m_modes[mode], value);
+    m_modes[mode] = value;
+}
+
+// The line as the interpreter sees it: lower case, with no blanks and
+// no comments
+static std::string lint_text(lint_job *job, const char *raw, int line)
+{
+    std::string text;
+    for (const char *p = raw; *p; p++) {
+        if (*p == '(') {
+            const char *close = strchr(p, ')');
+            if (!close) {
+                DIAG(line, "%s", NCE_UNCLOSED_COMMENT_FOUND);
+                break;
+            }
+            p = close;
+        } else if (*p == ';') {
+            break;
+        } else if (!isspace((unsigned char) *p)) {
+            text += tolower((unsigned char) *p);
+        }
+    }
+    return text;
+}
+
+static void *lint_file(void *arg)
+{
+    lint_job *job = (lint_job *) arg;
+    const lint_tables *t = job->tables;
+    FILE *fp = fopen(job->path.c_str(), "r");
+    if (!fp) {
+        DIAG(0, NCE_UNABLE_TO_OPEN_FILE, job->path.c_str());
+        return NULL;
+    }
+
+    std::vector<lint_block> stack;
+    std::vector<lint_use> calls;
+    lint_scope top, sub;
+    bool in_sub = false;
+    top.check = job->main;
+    char *raw = NULL;
+    size_t cap = 0;
+    int line = 0;
+    while (getline(&raw, &cap, fp) >= 0) {
+        line++;
+        std::string text = lint_text(job, raw, line);
+        size_t pos = 0, n = text.size();
+        if (n == 0 || text[0] == '%') continue;
+        if (text[pos] == '/') pos++;
+        if (pos < n && text[pos] == 'n')
+            for (pos++; pos < n && (isdigit(text[pos]) || text[pos] == '.'); )
+                pos++;
+
+        bool oword = pos < n && text[pos] == 'o';
+        if (oword) {
+            std::string label;
+            pos++;
+            if (pos < n && text[pos] == '<') {
+                size_t end = text.find('>', pos);
+                if (end == std::string::npos) {
+                    DIAG(line, "%s", NCE_NAMED_PARAMETER_NOT_TERMINATED);
+                    continue;
+                }
+                label = text.substr(pos, end - pos + 1);
+                pos = end + 1;
+            } else {
+                while (pos < n && isdigit(text[pos])) label += text[pos++];
+            }
+            std::string kw;
+            while (pos < n && isalpha(text[pos])) kw += text[pos++];
+            std::string name = label[0] == '<'
+                ? label.substr(1, label.size() - 2) : label;
+
+            if (label.empty() || label == "<>") {
+                DIAG(line, "%s", NCE_UNKNOWN_OWORD_NUMBER);
+                continue;
+            } else if (kw == "sub") {
+                if (!stack.empty())
+                    DIAG(line, _("o%s sub inside o%s %s"), label.c_str(),
+                         stack.back().label.c_str(), stack.back().kind.c_str());
+                lint_block b = { label, kw, line };
+                stack.push_back(b);
+                job->subs.insert(name);
+                sub = lint_scope();
+                sub.check = !t->remap_subs.count(name);
+                in_sub = true;
+            } else if (kw == "endsub") {
+                if (close_block(job, stack, label, "sub", "endsub", line)) {
+                    check_scope(job, sub);
+                    in_sub = false;
+                }
+            } else if (kw == "do" || kw == "if" || kw == "repeat") {
+                lint_block b = { label, kw, line };
+                stack.push_back(b);
+            } else if (kw == "while") {
+                if (!stack.empty() && stack.back().label == label
+                        && stack.back().kind == "do") {
+                    stack.pop_back();
+                } else {
+                    lint_block b = { label, kw, line };
+                    stack.push_back(b);
+                }
+            } else if (kw == "endwhile") {
+                close_block(job, stack, label, "while", "endwhile", line);
+            } else if (kw == "endif") {
+                close_block(job, stack, label, "if", "endif", line);
+            } else if (kw == "endrepeat") {
+                close_block(job, stack, label, "repeat", "endrepeat", line);
+            } else if (kw == "elseif" || kw == "else") {
+                if (stack.empty() || stack.back().label != label
+                        || stack.back().kind != "if")
+                    DIAG(line, _("o%s %s without if"), label.c_str(), kw.c_str());
+            } else if (kw == "break" || kw == "continue") {
+                if (!inside(stack, label, "while", "do", "repeat"))
+                    DIAG(line, _("o%s %s outside its loop"), label.c_str(),
+                         kw.c_str());
+            } else if (kw == "return") {
+                if (!inside(stack, label, "sub"))
+                    DIAG(line, _("o%s return outside its sub"), label.c_str());
+            } else if (kw == "call") {
+                lint_use u = { name, line };
+                calls.push_back(u);
+            } else {
+                DIAG(line, "%s: o%s %s", NCE_UNKNOWN_COMMAND_IN_O_LINE,
+                     label.c_str(), kw.c_str());
+                continue;
+            }
+        }
+
+        int g_modes[16], m_modes[11];
+        std::fill(g_modes, g_modes + 16, -1);
+        std::fill(m_modes, m_modes + 11, -1);
+        int depth = 0;
+        for (size_t i = pos; i < n; ) {
+            char c = text[i];
+            if (c == '#' && i + 1 < n && text[i+1] == '<') {
+                size_t end = text.find('>', i + 2);
+                if (end == std::string::npos) {
+                    DIAG(line, "%s", NCE_NAMED_PARAMETER_NOT_TERMINATED);
+                    break;
+                }
+                lint_use u = { text.substr(i + 2, end - i - 2), line };
+                bool exists = i >= 7 && text.compare(i - 7, 7, "exists[") == 0;
+                bool assign = !oword && depth == 0 && end + 1 < n
+                    && text[end+1] == '=';
+                i = end + 1;
+                if (exists || u.name.empty()) continue;
+                if (u.name[0] == '_') {
+                    if (assign) job->globals_set.insert(u.name);
+                    else if (u.name.compare(0, 5, "_ini[")
+                             && u.name.compare(0, 5, "_hal["))
+                        job->globals_used.push_back(u);
+                } else {
+                    lint_scope &s = in_sub ? sub : top;
+                    if (assign) s.set.insert(u.name);
+                    else s.used.push_back(u);
+                }
+                continue;
+            }
+            if (c == '[') {
+                depth++;
+            } else if (c == ']') {
+                depth--;
+            } else if (!oword && depth == 0 && (c == 'g' || c == 'm')
+                       && i + 1 < n
+                       && (isdigit(text[i+1]) || text[i+1] == '.')) {
+                // digits and a point only; strtod would take 0x1 or 1e5
+                size_t end = i + 1;
+                bool point = false;
+                while (end < n && (isdigit(text[end])
+                                   || (text[end] == '.' && !point))) {
+                    point = point || text[end] == '.';
+                    end++;
+                }
+                double v = atof(text.substr(i + 1, end - i - 1).c_str());
+                i = end;
+                if (c == 'g') check_g(job, line, v, g_modes);
+                else check_m(job, line, v, m_modes);
+                continue;
+            }
+            i++;
+        }
+    }
+    free(raw);
+    fclose(fp);
+
+    for (size_t i = 0; i < stack.size(); i++)
+        DIAG(stack[i].line, _("o%s %s is not closed"),
+             stack[i].label.c_str(), stack[i].kind.c_str());
+    if (in_sub) check_scope(job, sub);
+    check_scope(job, top);
+
+    // numbered subroutines can only be in the same file
+    for (size_t i = 0; i < calls.size(); i++) {
+        const lint_use &c = calls[i];
+        if (job->subs.count(c.name)) continue;
+        if (isdigit(c.name[0]))
+            DIAG(c.line, "%s: o%s", NCE_UNKNOWN_OWORD_NUMBER, c.name.c_str());
+        else
+            job->calls.push_back(c);
+    }
+    return NULL;
+}
+
+// Read the files, at most 'threads' of them at once
+static void lint_files(std::vector<lint_job *> &jobs, int threads)
+{
+    if (threads <= 0) threads = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = std::max(1, std::min(threads, (int) jobs.size()));
+    for (size_t first = 0; first < jobs.size(); first += threads) {
+        size_t count = std::min((size_t) threads, jobs.size() - first);
+        std::vector<pthread_t> tids(count);
+        std::vector<bool> started(count);
+        for (size_t k = 0; k < count; k++)
+            started[k] = k > 0
+                && pthread_create(&tids[k], NULL, lint_file, jobs[first + k]) == 0;
+        for (size_t k = 0; k < count; k++)
+            if (!started[k]) lint_file(jobs[first + k]);
+        for (size_t k = 0; k < count; k++)
+            if (started[k]) pthread_join(tids[k], NULL);
+    }
+}
+
+static bool diagnostic_before(const InterpDiagnostic &a,
+        const InterpDiagnostic &b)
+{
+    return a.line < b.line;
+}
+
+static std::string lower(const char *s)
+{
+    std::string r(s);
+    for (size_t i = 0; i < r.size(); i++) r[i] = tolower((unsigned char) r[i]);
+    return r;
+}
+
+/***********************************************************************/
+
+/*! Interp::lint
+
+Returned Value: the number of problems found
+
+Called By: external programs (sai, gcodemodule)
+
+Reads filename and the subroutine files it calls, as found from the
+current [RS274NGC] settings and remaps, without executing anything, and
+appends a diagnostic for each problem to 'diagnostics', in file and line
+order.  The files reached by one round of calls are read in parallel, at
+most 'threads' at once or one per CPU when threads is 0.
+
+A named parameter counts as set when some line of its scope assigns it:
+the subroutine for locals, any file reached for globals, which also
+include those the interpreter defines.  Subroutines that a remap calls
+get their locals from the remap and are not checked for them.
+
+*/
+
+int Interp::lint(const char *filename,
+                 std::vector<InterpDiagnostic> &diagnostics, int threads)
+{
+    lint_tables *t = new lint_tables;
+    for (int i = 0; i < LINT_CODES; i++) {
+        int_remap_iterator g = _setup.g_remapped.find(i);
+        int_remap_iterator m = _setup.m_remapped.find(i);
+        bool g_remap = g != _setup.g_remapped.end() && g->second;
+        bool m_remap = m != _setup.m_remapped.end() && m->second;
+        t->g_group[i] = g_remap ? g->second->modal_group : _gees[i];
+        t->g_ngc[i] = g_remap ? g->second->remap_ngc : 0;
+        t->m_group[i] = m_remap ? m->second->modal_group
+            : (i < 200 ? _ems[i] : -1);
+        t->m_ngc[i] = m_remap ? m->second->remap_ngc : 0;
+        if (t->g_ngc[i]) t->remap_subs.insert(lower(t->g_ngc[i]));
+        if (t->m_ngc[i]) t->remap_subs.insert(lower(t->m_ngc[i]));
+    }
+
+    std::vector<lint_job *> jobs, wave;
+    std::set<std::string> defined, looked_up;
+    lint_job *first = new lint_job;
+    first->tables = t;
+    first->path = filename;
+    first->main = true;
+    wave.push_back(first);
+    while (!wave.empty()) {
+        lint_files(wave, threads);
+        for (size_t i = 0; i < wave.size(); i++)
+            defined.insert(wave[i]->subs.begin(), wave[i]->subs.end());
+
+        std::vector<lint_job *> next;
+        for (size_t i = 0; i < wave.size(); i++) {
+            lint_job *job = wave[i];
+            if (!job->expect.empty() && !job->subs.count(job->expect))
+                lint_diag(job->diags, job->caller, job->caller_line,
+                          _("%s does not define o<%s>"), job->path.c_str(),
+                          job->expect.c_str());
+            for (size_t k = 0; k < job->calls.size(); k++) {
+                const lint_use &c = job->calls[k];
+                if (defined.count(c.name) || looked_up.count(c.name))
+                    continue;
+                looked_up.insert(c.name);
+                char path[PATH_MAX+1];
+                FILE *fp = find_ngc_file(&_setup, c.name.c_str(), path);
+                if (!fp) {
+                    DIAG(c.line, NCE_UNABLE_TO_OPEN_FILE, c.name.c_str());
+                    continue;
+                }
+                fclose(fp);
+                lint_job *sub = new lint_job;
+                sub->tables = t;
+                sub->path = path;
+                sub->caller = job->path;
+                sub->caller_line = c.line;
+                sub->expect = c.name;
+                next.push_back(sub);
+            }
+        }
+        jobs.insert(jobs.end(), wave.begin(), wave.end());
+        wave.swap(next);
+    }
+
+    std::set<std::string> globals;
+    parameter_map &predefined = _setup.sub_context[0].named_params;
+    for (parameter_map_iterator it = predefined.begin();
+         it != predefined.end(); ++it)
+        globals.insert(lower(it->first));
+    for (size_t i = 0; i < jobs.size(); i++)
+        globals.insert(jobs[i]->globals_set.begin(), jobs[i]->globals_set.end());
+
+    int count = 0;
+    std::set<std::string> reported;
+    for (size_t i = 0; i < jobs.size(); i++) {
+        lint_job *job = jobs[i];
+        for (size_t k = 0; k < job->globals_used.size(); k++) {
+            const lint_use &u = job->globals_used[k];
+            if (globals.count(u.name) || reported.count(u.name)) continue;
+            reported.insert(u.name);
+            DIAG(u.line, _("Named parameter #<%s> is never set"),
+                 u.name.c_str());
+        }
+    }
+    // a file's own problems, then those of the calls it makes
+    for (size_t i = 0; i < jobs.size(); i++) {
+        std::vector<InterpDiagnostic> mine;
+        for (size_t k = 0; k < jobs.size(); k++) {
+            std::vector<InterpDiagnostic> &d = jobs[k]->diags;
+            for (size_t j = 0; j < d.size(); j++)
+                if (d[j].filename == jobs[i]->path) mine.push_back(d[j]);
+        }
+        std::stable_sort(mine.begin(), mine.end(), diagnostic_before);
+        diagnostics.insert(diagnostics.end(), mine.begin(), mine.end());
+        count += mine.size();
+    }
+    for (size_t i = 0; i < jobs.size(); i++) delete jobs[i];
+    delete t;
+    return count;
+}
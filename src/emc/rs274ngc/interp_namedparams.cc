@@ -37,6 +37,7 @@ namespace bp = boost::python;
 #include "rs274ngc.hh"
 #include "rs274ngc_return.hh"
 #include "interp_internal.hh"
+#include "interp_profile.hh"
 #include "rs274ngc_interp.hh"
 #include "inifile.hh"
 
@@ -142,15 +143,25 @@ int Interp::read_named_parameter(
 				 double *parameters,   //!< array of system parameters
 				 bool check_exists)    //!< test for existence, not value
 {
-    static char name[] = "read_named_parameter";
     char paramNameBuf[LINELEN+1];
-    int exists;
-    double value;
-    parameter_map_iterator pi;
 
     CHKS((line[*counter] != '<'),
 	 NCE_BUG_FUNCTION_SHOULD_NOT_HAVE_BEEN_CALLED);
     CHP(read_name(line, counter, paramNameBuf));
+    CHP(named_parameter_value(paramNameBuf, double_ptr, check_exists));
+    return INTERP_OK;
+}
+
+// the value of the parameter paramNameBuf, for read_named_parameter and
+// for compiled expressions (execute_expression)
+int Interp::named_parameter_value(
+				 const char *paramNameBuf, //!< name without the <>
+				 double *double_ptr,   //!< pointer to double to be read
+				 bool check_exists)    //!< test for existence, not value
+{
+    static char name[] = "read_named_parameter";
+    int exists;
+    double value;
 
     CHP(find_named_param(paramNameBuf, &exists, &value));
     if (check_exists) {
@@ -314,6 +325,7 @@ int Interp::find_named_param(
     double *value   //!< pointer to value of found parameter
     )
 {
+  profile_timer timer(_setup.profile, PROF_NAMED_PARAM);
   context_pointer frame;
   parameter_map_iterator pi;
   int level;
@@ -358,6 +370,7 @@ int Interp::find_named_param(
 	  CHP(lookup_named_param(nameBuf, pv->value, value));
 	  *status = 1;
       } else if (pv->attr & PA_PYTHON) {
+	  PythonLock gil;
 	  bp::object retval, tupleargs, kwargs;
 	  bp::list plist;
 
@@ -474,6 +487,7 @@ int Interp::add_named_param(
 int Interp::free_named_parameters(context_pointer frame)
 {
     frame->named_params.clear();
+    frame->named_generation++;
     return INTERP_OK;
 }
 
@@ -747,6 +761,7 @@ int Interp::init_python_predef_parameter(const char *name)
 	if (exists) {
 	    fprintf(stderr, "warning: redefining named parameter %s\n",name);
 	    _setup.sub_context[0].named_params.erase(name);
+	    _setup.sub_context[0].named_generation++;
 	}
 	param.value = 0.0;
 	param.attr = PA_READONLY|PA_PYTHON|PA_GLOBAL;
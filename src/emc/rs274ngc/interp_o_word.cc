@@ -29,6 +29,7 @@
 #include "rs274ngc_return.hh"
 #include "interp_return.hh"
 #include "interp_internal.hh"
+#include "interp_profile.hh"
 #include "rs274ngc_interp.hh"
 #include "python_plugin.hh"
 #include "interp_python.hh"
@@ -174,7 +175,6 @@ int Interp::execute_call(setup_pointer settings,
 {
     int status = INTERP_OK;
     int i;
-    bp::list plist;
 
     context_pointer previous_frame = &settings->sub_context[settings->call_level-1];
 
@@ -245,11 +245,15 @@ int Interp::execute_call(setup_pointer settings,
 	    settings->value_returned = 0;
 	    previous_frame->sequence_number = settings->sequence_number;
 	    previous_frame->filename = strstore(settings->filename);
-	    plist.append(*settings->pythis); // self
-	    for(int i = 0; i < eblock->param_cnt; i++)
-		plist.append(eblock->params[i]); // positonal args
-	    current_frame->pystuff.impl->tupleargs = bp::tuple(plist);
-	    current_frame->pystuff.impl->kwargs = bp::dict();
+	    {
+		PythonLock gil;
+		bp::list plist;
+		plist.append(*settings->pythis); // self
+		for(int i = 0; i < eblock->param_cnt; i++)
+		    plist.append(eblock->params[i]); // positonal args
+		current_frame->pystuff.impl->tupleargs = bp::tuple(plist);
+		current_frame->pystuff.impl->kwargs = bp::dict();
+	    }
 
 	case CS_REEXEC_PYOSUB:
 	    if (settings->call_state ==  CS_REEXEC_PYOSUB)
@@ -282,8 +286,9 @@ int Interp::execute_call(setup_pointer settings,
 	    if (remap->remap_py || remap->prolog_func || remap->epilog_func) {
 		CHKS(!PYUSABLE, "%s (remapped) uses Python functions, but the Python plugin is not available", 
 		     remap->name);
-		plist.append(*settings->pythis);   //self
-		current_frame->pystuff.impl->tupleargs = bp::tuple(plist);
+		PythonLock gil;
+		// (self,) never changes
+		current_frame->pystuff.impl->tupleargs = *settings->pyselfargs;
 		current_frame->pystuff.impl->kwargs = bp::dict();
 	    }
 	    if (remap->argspec && (strchr(remap->argspec, '@') == NULL)) {
@@ -296,7 +301,8 @@ int Interp::execute_call(setup_pointer settings,
 	case CS_REEXEC_PROLOG:
 	    if (remap->prolog_func) { 
 		status = pycall(settings, current_frame, REMAP_MODULE,remap->prolog_func,
-				settings->call_state == CS_NORMAL ? PY_PROLOG : PY_FINISH_PROLOG);
+				settings->call_state == CS_NORMAL ? PY_PROLOG : PY_FINISH_PROLOG,
+				&remap->prolog_handle);
 		CHKS(status == INTERP_ERROR, "pycall(%s.%s) failed", REMAP_MODULE, remap->prolog_func);
 		switch (status = handler_returned(settings, current_frame, current_frame->subName, false)) {
 		case INTERP_EXECUTE_FINISH:
@@ -313,7 +319,8 @@ int Interp::execute_call(setup_pointer settings,
 	case CS_REEXEC_PYBODY:
 	    if (remap->remap_py) { 
 		status = pycall(settings, current_frame, REMAP_MODULE, remap->remap_py,
-				settings->call_state == CS_NORMAL ? PY_BODY : PY_FINISH_BODY);
+				settings->call_state == CS_NORMAL ? PY_BODY : PY_FINISH_BODY,
+				&remap->remap_py_handle);
 		CHP(status);
 		switch (status = handler_returned(settings, current_frame, current_frame->subName, false)) {
 		case INTERP_EXECUTE_FINISH:
@@ -377,7 +384,8 @@ int Interp::execute_return(setup_pointer settings, context_pointer current_frame
 		    CHP(read_inputs(settings));
 		status = pycall(settings, current_frame, REMAP_MODULE,
 	    			cblock->executing_remap->epilog_func,
-				settings->call_state == CS_NORMAL ? PY_EPILOG : PY_FINISH_EPILOG);
+				settings->call_state == CS_NORMAL ? PY_EPILOG : PY_FINISH_EPILOG,
+				&cblock->executing_remap->epilog_handle);
 		CHP(status);
 		switch (status = handler_returned(settings, current_frame, current_frame->subName, false)) {
 		case INTERP_EXECUTE_FINISH:
@@ -413,7 +421,7 @@ int Interp::execute_return(setup_pointer settings, context_pointer current_frame
 		//!!!KL must open the new file, if changed
 		if (0 != strcmp(settings->filename, previous_frame->filename))  {
 		    fclose(settings->file_pointer);
-		    settings->file_pointer = fopen(previous_frame->filename, "r");
+		    settings->file_pointer = open_ngc_file(settings, previous_frame->filename);
 		    if (settings->file_pointer == NULL)  {
 			ERS(NCE_CANNOT_REOPEN_FILE, 
 			    previous_frame->filename,
@@ -493,7 +501,7 @@ int Interp::control_back_to( block_pointer block, // pointer to block
 	if (0 != strcmp(settings->filename,
 			op->filename)) {
 	    // open the new file...
-	    newFP = fopen(op->filename, "r");
+	    newFP = open_ngc_file(settings, op->filename);
 	    // set the line number
 	    settings->sequence_number = 0;
             strncpy(settings->filename, op->filename, sizeof(settings->filename));
@@ -609,6 +617,12 @@ int Interp::enter_context(setup_pointer settings, block_pointer block)
     frame->pystuff.impl->py_returned_double = 0.0;
     frame->pystuff.impl->py_return_type = -1;
     frame->call_type = block->call_type; // distinguish call frames: oword,python,remap
+    if (settings->profile) {
+	bool remap = block->call_type == CT_REMAP;
+	settings->profile->enter(settings->call_level,
+				 remap ? CONTROLLING_BLOCK(*settings).executing_remap->name
+				       : frame->subName, remap);
+    }
     return INTERP_OK;
 }
 
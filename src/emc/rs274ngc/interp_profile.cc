@@ -0,0 +1,140 @@
+/********************************************************************
+* Description: interp_profile.cc
+*
+*   Where the interpreter spends its time: cumulative time per source
+*   line, O-word subroutine and remap, written as a tab separated report.
+*
+*   Each line of the report is one record; the first field says which:
+*
+*     section <name> <calls> <seconds>
+*     line    <file> <line> <executions> <seconds>
+*     sub     <name> <calls> <seconds>
+*     remap   <name> <calls> <seconds>
+*
+*   A line's time is that of reading and executing it; lines given to
+*   execute() directly, as in MDI, are in the file "MDI".  A subroutine
+*   or remap is charged with all lines read and executed while it is on
+*   the call stack, including the line calling it and the one returning
+*   from it, once even when it calls itself.  The sections are
+*   named as in interp_profile.hh.  Times add up over every program run
+*   until the profile is turned off.
+*
+* License: GPL Version 2
+* System: Linux
+*
+********************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+#include "rs274ngc.hh"
+#include "rs274ngc_return.hh"
+#include "interp_internal.hh"
+#include "interp_profile.hh"
+#include "rs274ngc_interp.hh"
+
+static const char *section_names[PROF_SECTIONS] = {
+    "read", "execute", "read_items", "expression",
+    "named_param", "python", "cutter_comp"
+};
+
+interp_profile::interp_profile(const char *filename) : filename(filename)
+{
+    memset(depth, 0, sizeof(depth));
+    memset(frames, 0, sizeof(frames));
+}
+
+void interp_profile::enter(int level, const char *name, bool remap)
+{
+    frames[level] = name;
+    if (name)
+        (remap ? remaps : subs)[name].calls++;
+}
+
+void interp_profile::block(const char *file, int line, bool executed,
+                           int levels, setup_pointer settings, double t)
+{
+    profile_count &c = lines[std::make_pair(std::string(file), line)];
+    if (executed) c.calls++;
+    c.seconds += t;
+
+    // a frame left by the block keeps its name and status until the
+    // next call at its level replaces them
+    for (int level = 1; level <= levels; level++) {
+        const char *name = frames[level];
+        if (!name) continue;
+        bool again = false;
+        for (int i = 1; i < level && !again; i++)
+            again = frames[i] && !strcmp(frames[i], name);
+        if (again) continue;
+        bool remap = settings->sub_context[level].context_status & REMAP_FRAME;
+        (remap ? remaps : subs)[name].seconds += t;
+    }
+}
+
+static void write_counts(FILE *f, const char *kind,
+                         const std::map<std::string, profile_count> &m)
+{
+    std::map<std::string, profile_count>::const_iterator it;
+    for (it = m.begin(); it != m.end(); ++it)
+        fprintf(f, "%s\t%s\t%ld\t%.9f\n", kind, it->first.c_str(),
+                it->second.calls, it->second.seconds);
+}
+
+// written to a new file that then replaces the old one, so a reader
+// never sees half a report
+int interp_profile::write()
+{
+    std::string tmp = filename + ".tmp";
+    FILE *f = fopen(tmp.c_str(), "w");
+    if (!f) return -1;
+
+    for (int i = 0; i < PROF_SECTIONS; i++)
+        fprintf(f, "section\t%s\t%ld\t%.9f\n", section_names[i],
+                sections[i].calls, sections[i].seconds);
+    std::map<std::pair<std::string, int>, profile_count>::const_iterator it;
+    for (it = lines.begin(); it != lines.end(); ++it)
+        fprintf(f, "line\t%s\t%d\t%ld\t%.9f\n", it->first.first.c_str(),
+                it->first.second, it->second.calls, it->second.seconds);
+    write_counts(f, "sub", subs);
+    write_counts(f, "remap", remaps);
+
+    if (fclose(f) != 0 || rename(tmp.c_str(), filename.c_str()) != 0) {
+        remove(tmp.c_str());
+        return -1;
+    }
+    return 0;
+}
+
+/***********************************************************************/
+
+/*! Interp::set_profile
+
+Starts profiling, with the report written to filename, or with NULL or
+an empty filename stops it.  The report of a profile that is stopped or
+replaced by one for another file is written first.  Naming the file that
+is already in use keeps the times so far, so that init() can be called
+again.
+
+*/
+
+void Interp::set_profile(const char *filename)
+{
+    if (!filename) filename = "";
+    if (_setup.profile && _setup.profile->filename == filename)
+        return;
+    if (_setup.profile) {
+        write_profile();
+        delete _setup.profile;
+        _setup.profile = 0;
+    }
+    if (*filename)
+        _setup.profile = new interp_profile(filename);
+}
+
+void Interp::write_profile()
+{
+    if (_setup.profile && _setup.profile->write() != 0)
+        logDebug("unable to write the profile to %s",
+                 _setup.profile->filename.c_str());
+}
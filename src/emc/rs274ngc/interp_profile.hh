@@ -0,0 +1,104 @@
+/********************************************************************
+* Description: interp_profile.hh
+*
+*   Opt-in timing of the interpreter, turned on by [RS274NGC]PROFILE_FILE
+*   or InterpBase::set_profile().  The time of each outermost read() and
+*   execute() is added to its source line, to every O-word subroutine
+*   and remap on the call stack, and to a total; the parts of the
+*   interpreter listed in profile_sections are timed where they run, so
+*   they overlap each other and read/execute.  The report is written by
+*   close() and exit(), see interp_profile.cc.
+*
+* License: GPL Version 2
+* System: Linux
+*
+********************************************************************/
+#ifndef INTERP_PROFILE_HH
+#define INTERP_PROFILE_HH
+
+#include <time.h>
+#include <map>
+#include <string>
+#include <utility>
+
+#include "interp_internal.hh"
+
+enum profile_sections {
+    PROF_READ,          // Interp::read()
+    PROF_EXECUTE,       // Interp::execute()
+    PROF_READ_ITEMS,    // parsing the words of a block
+    PROF_EXPRESSION,    // [expressions], including their parameters
+    PROF_NAMED_PARAM,   // #<named> parameter lookup
+    PROF_PYTHON,        // Python handlers, o-word subs and named params
+    PROF_CUTTER_COMP,   // cutter compensation moves and queue flushes
+    PROF_SECTIONS
+};
+
+struct profile_count {
+    profile_count() : calls(0), seconds(0) {}
+    void add(double t) { calls++; seconds += t; }
+    long calls;
+    double seconds;
+};
+
+struct interp_profile {
+    interp_profile(const char *filename);
+    // a frame was pushed at call_level 'level'
+    void enter(int level, const char *name, bool remap);
+    // a read() or execute() of this file and line took t seconds, with
+    // the frames up to call_level 'levels' on the stack at some point
+    void block(const char *file, int line, bool executed, int levels,
+               setup_pointer settings, double t);
+    int write();
+
+    std::string filename;
+    int depth[PROF_SECTIONS];
+    profile_count sections[PROF_SECTIONS];
+    std::map<std::pair<std::string, int>, profile_count> lines;
+    std::map<std::string, profile_count> subs, remaps;
+    const char *frames[INTERP_SUB_ROUTINE_LEVELS];
+};
+
+static inline double profile_now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// the profile if a read() or execute() starting now is the outermost one
+static inline interp_profile *profile_toplevel(interp_profile *p)
+{
+    return p && !p->depth[PROF_READ] && !p->depth[PROF_EXECUTE] ? p : 0;
+}
+
+// times one section for its lifetime; a section entered again while it
+// runs (by recursion, or a remap reading a block) is counted once
+class profile_timer {
+public:
+    profile_timer(interp_profile *p, int section)
+        : profile(p), section(section), outer(false), start(0) {
+        if (!p) return;
+        outer = p->depth[section]++ == 0;
+        if (outer) start = profile_now();
+    }
+    ~profile_timer() { stop(); }
+    // the time counted, or -1 for a nested or disabled timer
+    double stop() {
+        interp_profile *p = profile;
+        if (!p) return -1;
+        profile = 0;
+        p->depth[section]--;
+        if (!outer) return -1;
+        double t = profile_now() - start;
+        p->sections[section].add(t);
+        return t;
+    }
+private:
+    interp_profile *profile;
+    int section;
+    bool outer;
+    double start;
+};
+
+#endif
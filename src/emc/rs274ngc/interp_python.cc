@@ -53,6 +53,7 @@ namespace bp = boost::python;
 #include "rs274ngc.hh"
 #include "interp_return.hh"
 #include "interp_internal.hh"
+#include "interp_profile.hh"
 #include "rs274ngc_interp.hh"
 #include "units.h"
 
@@ -95,6 +96,7 @@ std::string handle_pyerror()
 int Interp::py_reload()
 {
     if (PYUSABLE) {
+	PythonLock gil;
 	CHKS((python_plugin->initialize() == PLUGIN_EXCEPTION),
 	     "py_reload:\n%s",  python_plugin->last_exception().c_str());
     }
@@ -109,6 +111,7 @@ bool Interp::is_pycallable(setup_pointer settings,
     if (!PYUSABLE)
       return false;
 
+    PythonLock gil;
     return python_plugin->is_callable(module,funcname);
 }
 
@@ -118,8 +121,11 @@ int Interp::pycall(setup_pointer settings,
 		   context_pointer frame,
 		   const char *module,
 		   const char *funcname,
-		   int calltype)
+		   int calltype,
+		   int *handle)
 {
+    profile_timer timer(_setup.profile, PROF_PYTHON);
+    PythonLock gil;  // released after the objects below are gone
     bp::object retval, function;
     std::string msg;
     bool py_exception = false;
@@ -176,7 +182,13 @@ int Interp::pycall(setup_pointer settings,
 	}
 	break;
     default:
-	python_plugin->call(module,funcname, frame->pystuff.impl->tupleargs,frame->pystuff.impl->kwargs,retval);
+	if (handle) {
+	    // the caller keeps the handle, saving the lookup by name
+	    if (*handle == 0)
+		*handle = python_plugin->callable_handle(module, funcname);
+	    python_plugin->call(*handle, frame->pystuff.impl->tupleargs,frame->pystuff.impl->kwargs,retval);
+	} else
+	    python_plugin->call(module,funcname, frame->pystuff.impl->tupleargs,frame->pystuff.impl->kwargs,retval);
 	CHKS(python_plugin->plugin_status() == PLUGIN_EXCEPTION,
 	     "pycall(%s):\n%s", funcname,
 	     python_plugin->last_exception().c_str());
@@ -287,6 +299,7 @@ int Interp::pycall(setup_pointer settings,
 // called by  (py, ....) or ';py,...' comments
 int Interp::py_execute(const char *cmd, bool as_file)
 {
+    PythonLock gil;
     bp::object retval;
 
     logPy("py_execute(%s)",cmd);
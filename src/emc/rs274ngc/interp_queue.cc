@@ -17,6 +17,7 @@
 #include "rs274ngc_return.hh"
 #include "interp_queue.hh"
 #include "interp_internal.hh"
+#include "interp_profile.hh"
 #include "rs274ngc_interp.hh"
 
 static int debug_qc = 0;
@@ -51,15 +52,30 @@ static double latheorigin_z(setup_pointer settings, double z) {
 static double endpoint[2];
 static int endpoint_valid = 0;
 
+// the queue only grows until the next move in the plane flushes it, and
+// keeps its storage when cleared, so it is not reallocated per move
+static std::vector<queued_canon> queue;
+// where the moves are in the queue, the entries whose endpoints
+// move_endpoint_and_flush changes
+static std::vector<unsigned int> queued_moves;
+
 std::vector<queued_canon>& qc(void) {
-    static std::vector<queued_canon> c;
-    if(0) printf("len %d\n", (int)c.size());
-    return c;
+    return queue;
+}
+
+static void enqueue_move(const queued_canon &q) {
+    queued_moves.push_back(queue.size());
+    queue.push_back(q);
+}
+
+static void clear_queue(void) {
+    queue.clear();
+    queued_moves.clear();
 }
 
 void qc_reset(void) {
     if(debug_qc) printf("qc cleared\n");
-    qc().clear();
+    clear_queue();
     endpoint_valid = 0;
 }
 
@@ -286,7 +302,7 @@ int enqueue_STRAIGHT_FEED(setup_pointer settings, int l,
     q.data.straight_feed.u = u;
     q.data.straight_feed.v = v;
     q.data.straight_feed.w = w;
-    qc().push_back(q);
+    enqueue_move(q);
     if(debug_qc) printf("enqueue straight feed lineno %d to %f %f %f direction %f %f %f\n", l, x,y,z, dx, dy, dz);
     return 0;
 }
@@ -326,7 +342,7 @@ int enqueue_STRAIGHT_TRAVERSE(setup_pointer settings, int l,
     q.data.straight_traverse.v = v;
     q.data.straight_traverse.w = w;
     if(debug_qc) printf("enqueue straight traverse lineno %d to %f %f %f direction %f %f %f\n", l, x,y,z, dx, dy, dz);
-    qc().push_back(q);
+    enqueue_move(q);
     return 0;
 }
 
@@ -356,7 +372,7 @@ void enqueue_ARC_FEED(setup_pointer settings, int l,
     q.data.arc_feed.w = w;
 
     if(debug_qc) printf("enqueue arc lineno %d to %f %f center %f %f turn %d sweeping %f\n", l, end1, end2, center1, center2, turn, original_turns);
-    qc().push_back(q);
+    enqueue_move(q);
 }
 
 void enqueue_M_USER_COMMAND (int index, double p_number, double q_number) {
@@ -395,10 +411,10 @@ void qc_scale(double scale) {
 
     if(debug_qc) printf("scaling qc by %f\n", scale);
 
-    for(unsigned int i = 0; i<qc().size(); i++) {
-        queued_canon &q = qc()[i];
-        endpoint[0] *= scale;
-        endpoint[1] *= scale;
+    endpoint[0] *= scale;
+    endpoint[1] *= scale;
+    for(unsigned int i = 0; i<queued_moves.size(); i++) {
+        queued_canon &q = queue[queued_moves[i]];
         switch(q.type) {
         case QARC_FEED:
             q.data.arc_feed.end1 *= scale;
@@ -433,14 +449,15 @@ void qc_scale(double scale) {
 }
 
 void dequeue_canons(setup_pointer settings) {
+    profile_timer timer(settings->profile, PROF_CUTTER_COMP);
 
     if(debug_qc) printf("dequeueing: endpoint is now invalid\n");
     endpoint_valid = 0;
 
-    if(qc().empty()) return;
+    if(queue.empty()) return;
 
-    for(unsigned int i = 0; i<qc().size(); i++) {
-        queued_canon &q = qc()[i];
+    for(unsigned int i = 0; i<queue.size(); i++) {
+        queued_canon &q = queue[i];
 
         switch(q.type) {
         case QARC_FEED:
@@ -549,7 +566,7 @@ void dequeue_canons(setup_pointer settings) {
             break;
         }
     }
-    qc().clear();
+    clear_queue();
 }
 
 int Interp::move_endpoint_and_flush(setup_pointer settings, double x, double y) {
@@ -559,15 +576,15 @@ int Interp::move_endpoint_and_flush(setup_pointer settings, double x, double y)
     double y2;
     double dot;
 
-    if(qc().empty()) return 0;
+    if(queue.empty()) return 0;
     
-    for(unsigned int i = 0; i<qc().size(); i++) {
+    for(unsigned int i = 0; i<queued_moves.size(); i++) {
         // there may be several moves in the queue, and we need to
         // change all of them.  consider moving into a concave corner,
         // then up and back down, then continuing on.  there will be
         // three moves to change.
 
-        queued_canon &q = qc()[i];
+        queued_canon &q = queue[queued_moves[i]];
 
         switch(q.type) {
         case QARC_FEED:
@@ -2528,6 +2528,8 @@ int Interp::read_real_expression(char *line,     //!< string: line of RS274/NGC
   int stack_index;
 
   CHKS((line[*counter] != '['), NCE_BUG_FUNCTION_SHOULD_NOT_HAVE_BEEN_CALLED);
+  if (_setup.expression_depth == 0)
+    return read_cached_expression(line, counter, value, parameters);
   *counter = (*counter + 1);
   CHP(read_real_value(line, counter, values, parameters));
   CHP(read_operation(line, counter, operators));
@@ -71,7 +71,6 @@ int Interp::convert_remapped_code(block_pointer block,
     char key[2];
     int status;
     block_pointer cblock;
-    bp::list plist;
     char cmd[LINELEN];
 
     if (number == -1)
@@ -219,6 +218,7 @@ int Interp::add_parameters(setup_pointer settings,
 
 #define STORE(name,value)						\
     if (pydict) {							\
+	PythonLock gil;							\
 	try {								\
 	    active_frame->pystuff.impl->kwargs[name] = value;		\
         }								\
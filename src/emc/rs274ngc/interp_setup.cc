@@ -19,6 +19,7 @@
  */
 #include <string.h>
 #include "rs274ngc_interp.hh"
+#include "interp_profile.hh"
 #include <boost/python/object.hpp>
 
 #pragma GCC diagnostic error "-Wmissing-field-initializers"
@@ -174,14 +175,23 @@ setup::setup() :
     feature_set(0),
     disable_g92_persistence(0),
     pythis(),
+    pyselfargs(),
+    pyparams(),
+    pyparameters(),
     on_abort_command(NULL),
+    profile(NULL),
+    var_file_stat(),
     init_once(0)
 {
 }
 
 setup::~setup() {
     assert(!pythis || Py_IsInitialized());
+    if(pyparameters) delete pyparameters;
+    if(pyparams) delete pyparams;
+    if(pyselfargs) delete pyselfargs;
     if(pythis) delete pythis;
+    delete profile;
 }
 
 block_struct::block_struct ()
@@ -68,8 +68,13 @@ static  blocks_array blocks_wrapper ( Interp & inst) {
     return blocks_array(inst._setup.blocks);
 }
 
-static  parameters_array parameters_wrapper ( Interp & inst) {
-    return parameters_array(inst._setup.parameters);
+// made once, so reading self.parameters[n] in a remap doesn't make
+// a new wrapper object each time
+static bp::object parameters_wrapper ( Interp & inst) {
+    if (!inst._setup.pyparameters)
+	inst._setup.pyparameters =
+	    new bp::object(parameters_array(inst._setup.parameters));
+    return *inst._setup.pyparameters;
 }
 
 static  tool_table_array tool_table_wrapper ( Interp & inst) {
@@ -119,9 +124,11 @@ static bp::object wrap_find_tool_pocket(Interp &interp, int toolno)
 }
 
 
-// FIXME not sure if this is really needed
-static  ParamClass param_wrapper ( Interp & inst) {
-    return ParamClass(inst);
+// one Params object, which keeps where the names it was asked for are
+static bp::object param_wrapper ( Interp & inst) {
+    if (!inst._setup.pyparams)
+	inst._setup.pyparams = new bp::object(ParamClass(inst));
+    return *inst._setup.pyparams;
 }
 
 static int get_task(Interp &i) { return _task; };
@@ -954,9 +961,7 @@ BOOST_PYTHON_MODULE(interpreter) {
 
 	.add_property("current_tool", &get_current_tool, &set_current_tool)
 
-	.add_property( "params",
-		       bp::make_function( &param_wrapper,
-					  bp::with_custodian_and_ward_postcall< 0, 1 >()))
+	.add_property( "params", &param_wrapper)
 
 
 	// _setup arrays
@@ -972,9 +977,7 @@ BOOST_PYTHON_MODULE(interpreter) {
 	.add_property( "blocks",
 		       bp::make_function( blocks_w(&blocks_wrapper),
 					  bp::with_custodian_and_ward_postcall< 0, 1 >()))
-	.add_property( "parameters",
-		       bp::make_function( parameters_w(&parameters_wrapper),
-					  bp::with_custodian_and_ward_postcall< 0, 1 >()))
+	.add_property( "parameters", &parameters_wrapper)
 	.add_property( "tool_table",
 		       bp::make_function( tool_table_w(&tool_table_wrapper),
 					  bp::with_custodian_and_ward_postcall< 0, 1 >()))
@@ -16,10 +16,22 @@
  *    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 #include <boost/python/list.hpp>
+#include <unordered_map>
+
+// where a name used as a subscript was last found, by the string object,
+// which is held so its address isn't reused; string constants in remap
+// code are the same object on every call
+struct param_name_slot {
+    boost::python::object name;
+    named_slot slot;
+};
+
+#define PARAM_NAME_CACHE_MAX 256
 
 struct ParamClass {
 
     Interp &interp;
+    std::unordered_map<PyObject *, param_name_slot> names;
 
     ParamClass(Interp &i);
     double getitem( boost::python::object sub);
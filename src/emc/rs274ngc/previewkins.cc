@@ -0,0 +1,76 @@
+/********************************************************************
+* Description: previewkins.cc
+*   Inverse kinematics of the modules whose math is shared with
+*   userspace, for checking joint limits while a program is
+*   previewed and for the joint speed limits task gives moves.  Each header keeps its geometry in statics with the
+*   same names, so each one goes in its own namespace.
+*
+* License: GPL Version 2
+* System: Linux
+*
+********************************************************************/
+
+#include <math.h>
+#include <string.h>
+#include "previewkins.hh"
+
+namespace fiveaxis {
+#include "5axiskins-common.h"
+}
+
+namespace xyzac_trt {
+#include "xyzac-trt-kins-common.h"
+}
+
+namespace xyzbc_trt {
+#include "xyzbc-trt-kins-common.h"
+}
+
+namespace lineardelta {
+#include "lineardeltakins-common.h"
+}
+
+namespace rotarydelta {
+#include "rotarydeltakins-common.h"
+}
+
+static void fiveaxis_geometry(const double *p) {
+    fiveaxis::set_geometry(p[0]);
+}
+
+static void xyzac_trt_geometry(const double *p) {
+    xyzac_trt::set_geometry(p[0], p[1], p[2]);
+}
+
+static void xyzbc_trt_geometry(const double *p) {
+    xyzbc_trt::set_geometry(p[0], p[1], p[2]);
+}
+
+static void lineardelta_geometry(const double *p) {
+    lineardelta::set_geometry(p[0], p[1]);
+}
+
+static void rotarydelta_geometry(const double *p) {
+    rotarydelta::set_geometry(p[0], p[1], p[2], p[3]);
+}
+
+const preview_kins preview_kinematics[] = {
+    {"5axiskins", {"pivot-length", NULL},
+        fiveaxis_geometry, fiveaxis::kinematics_inverse},
+    {"xyzac-trt-kins", {"y-offset", "z-offset", "tool-offset", NULL},
+        xyzac_trt_geometry, xyzac_trt::kinematics_inverse},
+    {"xyzbc-trt-kins", {"x-offset", "z-offset", "tool-offset", NULL},
+        xyzbc_trt_geometry, xyzbc_trt::kinematics_inverse},
+    {"lineardeltakins", {"R", "L", NULL},
+        lineardelta_geometry, lineardelta::kinematics_inverse},
+    {"rotarydeltakins", {"platformradius", "thighlength", "shinlength",
+            "footradius", NULL},
+        rotarydelta_geometry, rotarydelta::kinematics_inverse},
+    {NULL},
+};
+
+const preview_kins *find_preview_kins(const char *name) {
+    for(const preview_kins *k = preview_kinematics; k->name; k++)
+        if(!strcmp(k->name, name)) return k;
+    return NULL;
+}
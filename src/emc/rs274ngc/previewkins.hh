@@ -0,0 +1,36 @@
+/********************************************************************
+* Description: previewkins.hh
+*   Inverse kinematics of the modules whose math is shared with
+*   userspace (the *-common.h headers), for checking joint limits
+*   while a program is previewed.
+*
+* License: GPL Version 2
+* System: Linux
+*
+********************************************************************/
+#ifndef PREVIEWKINS_HH
+#define PREVIEWKINS_HH
+
+#include "emcpos.h"
+
+#define PREVIEW_KINS_MAX_PARAMS 4
+
+struct preview_kins {
+    const char *name;           // the realtime module, e.g. "5axiskins"
+    // the module's HAL pins that hold its geometry, without the module
+    // name, in the order set_geometry() takes them
+    const char *params[PREVIEW_KINS_MAX_PARAMS + 1];
+    void (*set_geometry)(const double *params);
+    // returns nonzero if the pose can't be reached
+    int (*inverse)(const EmcPose *pos, double *joints);
+};
+
+// NULL for kinematics the preview doesn't know.  The geometry is kept
+// in the table entry's statics: it must be set before inverse() is used,
+// and inverse() may then be called from several threads at once.
+extern const preview_kins *find_preview_kins(const char *name);
+
+// the table, ended by an entry with a NULL name
+extern const preview_kins preview_kinematics[];
+
+#endif
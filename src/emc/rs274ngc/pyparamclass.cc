@@ -36,27 +36,63 @@ extern int _task;  // zero in gcodemodule, 1 in milltask
 #include "rs274ngc_interp.hh"
 #include "paramclass.hh"
 
-#define IS_STRING(x) (PyObject_IsInstance(x.ptr(), (PyObject*)&PyString_Type))
-#define IS_INT(x) (PyObject_IsInstance(x.ptr(), (PyObject*)&PyInt_Type))
+#define IS_STRING(x) PyString_Check(x.ptr())
+#define IS_INT(x) PyInt_Check(x.ptr())
 
 // access to named and numbered parameters via a pseudo-dictionary
 // either params["paramname"] or params[5400] is valid
 
 ParamClass::ParamClass(Interp &i) : interp(i) {};
 
+static void check_index(int index)
+{
+    if ((index < 0) || (index > RS274NGC_MAX_PARAMETERS -1)) {
+	std::stringstream sstr;
+	sstr << "params subscript out of range : "
+	     << index << " - must be between 0 and "
+	     << RS274NGC_MAX_PARAMETERS;
+	throw std::runtime_error(sstr.str());
+    }
+}
+
 double ParamClass::getitem( bp::object sub)
 {
     double retval = 0;
     if (IS_STRING(sub)) {
-	char const* varname = bp::extract < char const* > (sub);
+	char const* varname = PyString_AS_STRING(sub.ptr());
+	int level = (varname[0] == '_') ? 0 : interp._setup.call_level;
+	context_pointer frame = &interp._setup.sub_context[level];
+	// an entry found before is read directly, the same way compiled
+	// expressions do; values from elsewhere take the long way
+	param_name_slot *cached = 0;
+	auto it = names.find(sub.ptr());
+	if (it != names.end()) {
+	    cached = &it->second;
+	    named_slot &slot = cached->slot;
+	    if (slot.value && slot.level == level &&
+		slot.generation == frame->named_generation &&
+		!(slot.value->attr & (PA_UNSET | PA_USE_LOOKUP | PA_PYTHON)))
+		return slot.value->value;
+	}
 	int status;
 	interp.find_named_param(varname, &status, &retval);
 	if (!status)
 	    throw std::runtime_error("parameter does not exist: "
 				     + std::string(varname));
+	if (!cached) {
+	    if (names.size() >= PARAM_NAME_CACHE_MAX)
+		names.clear();
+	    cached = &names[sub.ptr()];
+	    cached->name = sub;
+	}
+	parameter_map_iterator pi = frame->named_params.find(varname);
+	cached->slot.level = level;
+	cached->slot.generation = frame->named_generation;
+	cached->slot.value = (pi == frame->named_params.end()) ? 0 : &pi->second;
     } else
 	if (IS_INT(sub)) {
-	    int index = bp::extract < int > (sub);
+	    int index = PyInt_AS_LONG(sub.ptr());
+	    check_index(index);
 	    retval = interp._setup.parameters[index];
 	} else {
 	    throw std::runtime_error("params subscript type must be integer or string");
@@ -76,14 +112,8 @@ double ParamClass::setitem(bp::object sub, double dvalue)
 
     } else
 	if (IS_INT(sub)) {
-	    int index = bp::extract < int > (sub);
-	    if ((index < 0) || (index > RS274NGC_MAX_PARAMETERS -1)) {
-		std::stringstream sstr;
-		sstr << "params subscript out of range : "
-		     << index << " - must be between 0 and "
-		     << RS274NGC_MAX_PARAMETERS;
-		throw std::runtime_error(sstr.str());
-	    }
+	    int index = PyInt_AS_LONG(sub.ptr());
+	    check_index(index);
 	    interp._setup.parameters[index] = dvalue;
 	    return dvalue;
 	} else
@@ -112,6 +112,16 @@ public:
 // Get the parameter file name from the ini file.
  int ini_load(const char *filename);
 
+// snapshot / restore the state between two top-level blocks
+ InterpCheckpoint *checkpoint();
+ bool restore(const InterpCheckpoint *cp);
+ bool same_state(const InterpCheckpoint *a, const InterpCheckpoint *b);
+ bool same_modes(const InterpCheckpoint *a, const InterpCheckpoint *b);
+
+// check a program without running it, see interp_lint.cc
+ int lint(const char *filename, std::vector<InterpDiagnostic> &diagnostics,
+          int threads = 0);
+
  int line() { return sequence_number(); }
  int call_level();
 
@@ -125,6 +135,8 @@ public:
  int on_abort(int reason, const char *message);
 
     void set_loglevel(int level);
+    void set_profile(const char *filename);
+    void write_profile();
 
     // for now, public - for boost.python access
  int find_named_param(const char *nameBuf, int *status, double *value);
@@ -426,6 +438,8 @@ public:
  int read_integer_value(char *line, int *counter, int *integer_ptr,
                               double *parameters);
  int read_items(block_pointer block, char *line, double *parameters);
+ int read_cached_items(block_pointer block, char *line,
+                       setup_pointer settings);
  int read_j(char *line, int *counter, block_pointer block,
                   double *parameters);
  int read_k(char *line, int *counter, block_pointer block,
@@ -473,6 +487,19 @@ public:
                   double *parameters);
  int read_real_expression(char *line, int *counter,
                                 double *hold2, double *parameters);
+ int read_cached_expression(char *line, int *counter,
+                                double *value, double *parameters);
+ bool compile_real_expression(char *line, int *counter,
+                                expression_program &program);
+ bool compile_real_value(char *line, int *counter,
+                                expression_program &program);
+ bool compile_parameter(char *line, int *counter,
+                                expression_program &program, bool check_exists);
+ bool compile_unary(char *line, int *counter, expression_program &program);
+ int execute_expression(const expression_program &program, double *value,
+                                double *parameters);
+ int named_parameter_value(const char *paramNameBuf, double *double_ptr,
+                                bool check_exists);
  int read_real_number(char *line, int *counter, double *double_ptr);
  int read_real_value(char *line, int *counter, double *double_ptr,
                            double *parameters);
@@ -634,10 +661,12 @@ int read_inputs(setup_pointer settings);
 	       context_pointer frame,
 	       const char *module,
 	       const char *funcname,
-	       int calltype);
+	       int calltype,
+	       int *handle = NULL);
     int py_execute(const char *cmd, bool as_file = false); // for (py, ....) comments
     int py_reload();
     FILE *find_ngc_file(setup_pointer settings,const char *basename, char *foundhere = NULL);
+    FILE *open_ngc_file(setup_pointer settings, const char *path);
 
     const char *getSavedError();
     // set error message text without going through printf format interpretation
@@ -85,6 +85,7 @@ include an option for suppressing superfluous commands.
 #include <time.h>
 #include <unistd.h>
 #include <libintl.h>
+#include <algorithm>
 #include <set>
 #include <stdexcept>
 
@@ -94,6 +95,7 @@ include an option for suppressing superfluous commands.
 #include "rs274ngc_return.hh"
 #include "interp_internal.hh"	// interpreter private definitions
 #include "interp_queue.hh"
+#include "interp_profile.hh"
 #include "rs274ngc_interp.hh"
 
 #include "units.h"
@@ -139,6 +141,7 @@ Interp::Interp()
 	// wrapper instance on every init(), abandoning the old one and all user attributes
 	// tacked onto it, so make sure this is done exactly once
 	_setup.pythis = new boost::python::object(boost::cref(*this));
+	_setup.pyselfargs = new boost::python::object(bp::make_tuple(*_setup.pythis));
 	
 	// alias to 'interpreter.this' for the sake of ';py, .... ' comments
 	// besides 'this', eventually use proper instance names to handle
@@ -231,6 +234,7 @@ Called By: external programs
 int Interp::close()
 {
     logOword("close()");
+    write_profile();
     // be "lazy" only if we're not aborting a call in progress
     // in which case we need to reset() the call stack
     // this does not reset the filename properly 
@@ -517,9 +521,21 @@ int Interp::_execute(const char *command)
 int Interp::execute(const char *command)
 {
     int status;
+    interp_profile *p = profile_toplevel(_setup.profile);
+    std::string file;
+    int line = 0, levels = _setup.call_level;
+    if (p) {
+        file = command ? "MDI" : _setup.filename;
+        if (!command) line = _setup.sequence_number;
+    }
+    profile_timer timer(_setup.profile, PROF_EXECUTE);
     if ((status = _execute(command)) > INTERP_MIN_ERROR) {
         unwind_call(status, __FILE__,__LINE__,__FUNCTION__);
     }
+    if (p) {
+        levels = std::max(levels, _setup.call_level);
+        p->block(file.c_str(), line, true, levels, &_setup, timer.stop());
+    }
     return status;
 }
 
@@ -750,8 +766,10 @@ int Interp::exit()
                             RS274NGC_PARAMETER_FILE_NAME_DEFAULT :
                             file_name), _setup.parameters);
   reset();
+  write_profile();
 
   // interpreter shutdown Python hook
+  PythonLock gil;
   if (python_plugin->is_callable(NULL, DELETE_FUNC)) {
 
       bp::object retval, tupleargs, kwargs;
@@ -873,6 +891,10 @@ int Interp::init()
               _setup.loggingLevel = atol(inistring);
           }
 
+	  // opt-in timing report, see interp_profile.cc
+          if(NULL != (inistring = inifile.Find("PROFILE_FILE", "RS274NGC")))
+              set_profile(inistring);
+
 	  // default the log_file to stderr.
           if(NULL != (inistring = inifile.Find("LOG_FILE", "RS274NGC")))
           {
@@ -1168,6 +1190,9 @@ int Interp::init()
   _setup.defining_sub = 0;
   _setup.skipping_o = 0;
   _setup.offset_map.clear();
+  _setup.expression_depth = 0;
+  _setup.file_cache.clear();
+  _setup.file_cache_bytes = 0;
 
   _setup.lathe_diameter_mode = false;
   _setup.parameters[5599] = 1.0; // enable (DEBUG, ) output
@@ -1197,6 +1222,7 @@ int Interp::init()
   // call __init__(self) once in toplevel module if defined
   // once fully set up and sync()ed
   if ((iniFileName != NULL) && _setup.init_once && PYUSABLE ) {
+      PythonLock gil;
 
       // initialize any python global predefined named parameters
       // walk the namedparams module for callables and add their names as predefs
@@ -1286,6 +1312,7 @@ int Interp::load_tool_table()
     _setup.tool_table[n].frontangle = 0;
     _setup.tool_table[n].backangle = 0;
   }
+  toolIndexBuild(&_setup.tool_index, _setup.tool_table);
   set_tool_parameters();
   return INTERP_OK;
 }
@@ -1352,7 +1379,7 @@ int Interp::open(const char *filename) //!< string: the name of the input NC-pro
     }
   CHKS((_setup.file_pointer != NULL), NCE_A_FILE_IS_ALREADY_OPEN);
   CHKS((strlen(filename) > (LINELEN - 1)), NCE_FILE_NAME_TOO_LONG);
-  _setup.file_pointer = fopen(filename, "r");
+  _setup.file_pointer = open_ngc_file(&_setup, filename);
   CHKS((_setup.file_pointer == NULL), NCE_UNABLE_TO_OPEN_FILE, filename);
   line = _setup.linetext;
   for (index = -1; index == -1;) {      /* skip blank lines */
@@ -1608,9 +1635,15 @@ int Interp::_read(const char *command)  //!< may be NULL or a string to read
 int Interp::read(const char *command) 
 {
     int status;
+    interp_profile *p = profile_toplevel(_setup.profile);
+    profile_timer timer(_setup.profile, PROF_READ);
     if ((status = _read(command)) > INTERP_MIN_ERROR) {
 	unwind_call(status, __FILE__,__LINE__,__FUNCTION__);
     }
+    if (p)
+	p->block(command ? "MDI" : _setup.filename,
+		 command ? 0 : _setup.sequence_number, false,
+		 _setup.call_level, &_setup, timer.stop());
     return status;
 }
 
@@ -1644,7 +1677,7 @@ int Interp::unwind_call(int status, const char *file, int line, const char *func
 	if (sub->filename && sub->filename[0]) {
 	    if(0 != strcmp(_setup.filename, sub->filename)) {
 		fclose(_setup.file_pointer);
-		_setup.file_pointer = fopen(sub->filename, "r");
+		_setup.file_pointer = open_ngc_file(&_setup, sub->filename);
 		logDebug("unwind_call: reopening '%s' at %ld",
 			 sub->filename, sub->position);
 		strcpy(_setup.filename, sub->filename);
@@ -1852,7 +1885,20 @@ e.g.
 If a required parameter is missing from the input file, this does not
 complain, but does write it in the output file.
 
+The file is left alone, backup included, when it is still the one this
+last wrote and none of its values changed since, as they will not have
+when a program ends without touching the offsets.
+
 */
+
+static bool same_file(const struct stat &a, const struct stat &b)
+{
+  return a.st_dev == b.st_dev && a.st_ino == b.st_ino
+      && a.st_size == b.st_size
+      && a.st_mtim.tv_sec == b.st_mtim.tv_sec
+      && a.st_mtim.tv_nsec == b.st_mtim.tv_nsec;
+}
+
 int Interp::save_parameters(const char *filename,      //!< name of file to write
                              const double parameters[]) //!< parameters to save   
 {
@@ -1864,6 +1910,21 @@ int Interp::save_parameters(const char *filename,      //!< name of file to writ
   int required;                 // number of next required parameter
   int index;                    // index into _required_parameters
   int k;
+  std::string text;             // what is written, one line per variable
+  std::vector<int> vars;        // the variables written
+  struct stat st;
+
+  if (_setup.var_file == filename && stat(filename, &st) == 0
+      && same_file(st, _setup.var_file_stat)) {
+    for (size_t i = 0; i < _setup.var_file_vars.size(); i++) {
+      k = _setup.var_file_vars[i];
+      sprintf(line, "%d\t%f\n", k, parameters[k]);
+      text += line;
+    }
+    if (text == _setup.var_file_text)
+      return INTERP_OK;
+    text.clear();
+  }
 
   std::string tempfile = std::string(filename) + ".new";
   outfile = fopen(tempfile.c_str(), "w");
@@ -1892,7 +1953,8 @@ int Interp::save_parameters(const char *filename,      //!< name of file to writ
           ERS(NCE_PARAMETER_FILE_OUT_OF_ORDER);
         } else if (k == variable) {
           sprintf(line, "%d\t%f\n", k, parameters[k]);
-          fputs(line, outfile);
+          text += line;
+          vars.push_back(k);
           if (k == required)
             required = _required_parameters[index++];
           k++;
@@ -1900,7 +1962,8 @@ int Interp::save_parameters(const char *filename,      //!< name of file to writ
         } else if (k == required)       // know (k < variable)
         {
           sprintf(line, "%d\t%f\n", k, parameters[k]);
-          fputs(line, outfile);
+          text += line;
+          vars.push_back(k);
           required = _required_parameters[index++];
         }
       }
@@ -1910,11 +1973,13 @@ int Interp::save_parameters(const char *filename,      //!< name of file to writ
   for (; k < RS274NGC_MAX_PARAMETERS; k++) {
     if (k == required) {
       sprintf(line, "%d\t%f\n", k, parameters[k]);
-      fputs(line, outfile);
+      text += line;
+      vars.push_back(k);
       required = _required_parameters[index++];
     }
   }
 
+  fputs(text.c_str(), outfile);
   fflush(outfile);
   fdatasync(fileno(outfile));
   fclose(outfile);
@@ -1923,8 +1988,14 @@ int Interp::save_parameters(const char *filename,      //!< name of file to writ
   unlink(bakfile.c_str());
   if(link(filename, bakfile.c_str()) < 0)
     perror("link (updating variable file)");
+  _setup.var_file.clear();
   if(rename(tempfile.c_str(), filename) < 0)
     perror("rename (updating variable file)");
+  else if (stat(filename, &_setup.var_file_stat) == 0) {
+    _setup.var_file = filename;
+    _setup.var_file_text.swap(text);
+    _setup.var_file_vars.swap(vars);
+  }
   return INTERP_OK;
 }
 
@@ -2488,7 +2559,7 @@ FILE *Interp::find_ngc_file(setup_pointer settings,const char *basename, char *f
 
     // first look in the program_prefix place
     sprintf(newFileName, "%s/%s", settings->program_prefix, tmpFileName);
-    newFP = fopen(newFileName, "r");
+    newFP = open_ngc_file(settings, newFileName);
 
     // then look in the subroutines place
     if (!newFP) {
@@ -2496,7 +2567,7 @@ FILE *Interp::find_ngc_file(setup_pointer settings,const char *basename, char *f
 	    if (!settings->subroutines[dct])
 		continue;
 	    sprintf(newFileName, "%s/%s", settings->subroutines[dct], tmpFileName);
-	    newFP = fopen(newFileName, "r");
+	    newFP = open_ngc_file(settings, newFileName);
 	    if (newFP) {
 		// logOword("fopen: |%s|", newFileName);
 		break; // use first occurrence in dir search
@@ -2512,7 +2583,7 @@ FILE *Interp::find_ngc_file(setup_pointer settings,const char *basename, char *f
 	    // create the long name
 	    sprintf(newFileName, "%s/%s",
 		    foundPlace, tmpFileName);
-	    newFP = fopen(newFileName, "r");
+	    newFP = open_ngc_file(settings, newFileName);
 	}
     }
     if (foundhere && (newFP != NULL)) 
@@ -2534,7 +2605,7 @@ const char *strstore(const char *s)
 
 context_struct::context_struct()
 : position(0), sequence_number(0), filename(""), subName(""),
-context_status(0), call_type(0)
+named_generation(0), context_status(0), call_type(0)
 
 {
     memset(saved_params, 0, sizeof(saved_params));
@@ -0,0 +1,157 @@
+/********************************************************************
+* Description: stocksim.cc
+*   Stock removal simulation on a grid of Z dexels.  For a straight
+*   move the part of it that passes within the tool radius of a cell
+*   centre is found exactly; the lowest point of a flat end mill over
+*   that part is at one of its ends, a ball end mill is sampled along
+*   it.  Arcs come in as chords.
+*
+* License: GPL Version 2
+* System: Linux
+*
+********************************************************************/
+
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <algorithm>
+#include "stocksim.hh"
+
+// samples of a ball end mill across the part of a move near a cell
+#define BALL_SAMPLES 8
+
+stock_sim::stock_sim(double x0, double y0, double x1, double y1,
+        double bottom, double top, double cell)
+    : x0(std::min(x0, x1)), y0(std::min(y0, y1)), bottom(bottom), top(top),
+      cell(cell > 0 ? cell : 1) {
+    nx = std::max(1, (int)ceil(fabs(x1 - x0) / this->cell));
+    ny = std::max(1, (int)ceil(fabs(y1 - y0) / this->cell));
+    reset();
+}
+
+void stock_sim::reset() {
+    heights.assign((size_t)nx * ny, top);
+}
+
+double stock_sim::removed() const {
+    double v = 0;
+    for(size_t i=0; i<heights.size(); i++) v += top - heights[i];
+    return v * cell * cell;
+}
+
+double stock_sim::height(double x, double y) const {
+    int i = (int)floor((x - x0) / cell), j = (int)floor((y - y0) / cell);
+    if(i < 0 || j < 0 || i >= nx || j >= ny) return bottom;
+    return heights[(size_t)j * nx + i];
+}
+
+// The lowest point of the tool over the cell centred at (cx, cy) during
+// the move, or false if the tool doesn't reach the cell
+static bool lowest(const stock_move &m, double cx, double cy, double &z) {
+    double r = m.radius;
+    double dx = m.start[0] - cx, dy = m.start[1] - cy;
+    double ux = m.end[0] - m.start[0], uy = m.end[1] - m.start[1];
+    double uz = m.end[2] - m.start[2];
+    // |d + t u|^2 <= r^2 for t in [t0, t1]
+    double a = ux * ux + uy * uy, b = 2 * (dx * ux + dy * uy);
+    double c = dx * dx + dy * dy - r * r;
+    double t0, t1;
+    if(a < 1e-18) {
+        if(c > 0) return false;
+        t0 = 0; t1 = 1;
+    } else {
+        double disc = b * b - 4 * a * c;
+        if(disc < 0) return false;
+        disc = sqrt(disc);
+        t0 = std::max(0., (-b - disc) / (2 * a));
+        t1 = std::min(1., (-b + disc) / (2 * a));
+        if(t0 > t1) return false;
+    }
+    if(!m.ball) {
+        z = m.start[2] + uz * (uz < 0 ? t1 : t0);
+        return true;
+    }
+    z = 1e99;
+    for(int k=0; k<=BALL_SAMPLES; k++) {
+        double t = t0 + (t1 - t0) * k / BALL_SAMPLES;
+        double ex = dx + t * ux, ey = dy + t * uy;
+        double e = std::max(0., r * r - ex * ex - ey * ey);
+        z = std::min(z, m.start[2] + t * uz + r - sqrt(e));
+    }
+    return true;
+}
+
+struct stock_job {
+    stock_sim *sim;
+    const std::vector<stock_move> *moves;
+    int row0, row1;
+    std::vector<char> hit;      // per move, for traverses into the stock
+};
+
+static void *cut_rows(void *arg) {
+    stock_job *job = (stock_job*)arg;
+    stock_sim *s = job->sim;
+    const std::vector<stock_move> &moves = *job->moves;
+    job->hit.assign(moves.size(), 0);
+    for(size_t n=0; n<moves.size(); n++) {
+        const stock_move &m = moves[n];
+        if(m.radius <= 0) continue;
+        double lo = std::min(m.start[1], m.end[1]) - m.radius;
+        double hi = std::max(m.start[1], m.end[1]) + m.radius;
+        int j0 = std::max(job->row0, (int)floor((lo - s->y0) / s->cell));
+        int j1 = std::min(job->row1, (int)ceil((hi - s->y0) / s->cell));
+        if(j0 >= j1) continue;
+        lo = std::min(m.start[0], m.end[0]) - m.radius;
+        hi = std::max(m.start[0], m.end[0]) + m.radius;
+        int i0 = std::max(0, (int)floor((lo - s->x0) / s->cell));
+        int i1 = std::min(s->nx, (int)ceil((hi - s->x0) / s->cell));
+        for(int j=j0; j<j1; j++) {
+            float *row = &s->heights[(size_t)j * s->nx];
+            double cy = s->y0 + (j + .5) * s->cell;
+            for(int i=i0; i<i1; i++) {
+                double z;
+                if(!lowest(m, s->x0 + (i + .5) * s->cell, cy, z)) continue;
+                if(z >= row[i]) continue;
+                if(m.traverse) {
+                    if(z < row[i] - 1e-6) job->hit[n] = 1;
+                    continue;
+                }
+                row[i] = std::max(z, s->bottom);
+            }
+        }
+    }
+    return NULL;
+}
+
+std::vector<int> stock_sim::cut(const std::vector<stock_move> &moves,
+        int threads) {
+    if(threads <= 0) threads = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = std::max(1, std::min(threads, ny));
+    std::vector<stock_job> jobs(threads);
+    std::vector<pthread_t> tids(threads);
+    std::vector<bool> started(threads);
+    for(int k=0; k<threads; k++) {
+        stock_job &job = jobs[k];
+        job.sim = this;
+        job.moves = &moves;
+        job.row0 = ny * k / threads;
+        job.row1 = ny * (k + 1) / threads;
+        started[k] = k > 0
+            && pthread_create(&tids[k], NULL, cut_rows, &job) == 0;
+    }
+    for(int k=0; k<threads; k++)
+        if(!started[k]) cut_rows(&jobs[k]);
+    for(int k=0; k<threads; k++)
+        if(started[k]) pthread_join(tids[k], NULL);
+
+    std::vector<int> lines;
+    for(size_t n=0; n<moves.size(); n++) {
+        for(int k=0; k<threads; k++) {
+            if(jobs[k].hit[n]) {
+                lines.push_back(moves[n].line);
+                break;
+            }
+        }
+    }
+    return lines;
+}
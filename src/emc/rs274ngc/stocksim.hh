@@ -0,0 +1,47 @@
+/********************************************************************
+* Description: stocksim.hh
+*   Stock removal simulation for checking a program before it runs:
+*   the top of a rectangular block of stock is kept as one Z dexel
+*   per cell of a grid, and each cutting move lowers the cells its
+*   tool sweeps over.  Undercuts can't be shown, which is fine for
+*   three axis milling.
+*
+* License: GPL Version 2
+* System: Linux
+*
+********************************************************************/
+#ifndef STOCKSIM_HH
+#define STOCKSIM_HH
+
+#include <vector>
+
+struct stock_move {
+    double start[3], end[3];    // of the tip of the tool
+    double radius;              // of the tool; a move without one cuts nothing
+    bool ball;                  // ball end mill instead of a flat one
+    bool traverse;              // a traverse doesn't cut; hitting stock is an error
+    int line;
+};
+
+struct stock_sim {
+    // a block from (x0, y0, bottom) to (x1, y1, top), in square cells
+    // of side cell
+    stock_sim(double x0, double y0, double x1, double y1,
+            double bottom, double top, double cell);
+
+    // Sweep the moves over the stock, in order, and return the lines of
+    // the traverses that went through it.  The grid is shared out among
+    // threads by rows, at most one per CPU when threads is 0.
+    std::vector<int> cut(const std::vector<stock_move> &moves,
+            int threads = 0);
+
+    void reset();
+    double removed() const;     // volume cut away
+    double height(double x, double y) const;    // top of the stock
+
+    int nx, ny;
+    double x0, y0, bottom, top, cell;
+    std::vector<float> heights; // nx by ny, a row per y from y0
+};
+
+#endif
@@ -270,3 +270,49 @@ int loadToolTable(const char *filename,
 
     return 0;
 }
+
+// write toolTable back to filename in the format loadToolTable reads
+int saveToolTable(const char *filename,
+	CANON_TOOL_TABLE toolTable[],
+	int fms[],
+	char *ttcomments[],
+	int random_toolchanger)
+{
+    int pocket;
+    FILE *fp;
+    int start_pocket;
+
+    // open tool table file
+    if (NULL == (fp = fopen(filename, "w"))) {
+	// can't open file
+	return -1;
+    }
+
+    if(random_toolchanger) {
+	start_pocket = 0;
+    } else {
+	start_pocket = 1;
+    }
+    for (pocket = start_pocket; pocket < CANON_POCKETS_MAX; pocket++) {
+	if (toolTable[pocket].toolno != -1) {
+	    fprintf(fp, "T%d P%d", toolTable[pocket].toolno, random_toolchanger? pocket: fms[pocket]);
+	    if (toolTable[pocket].diameter) fprintf(fp, " D%f", toolTable[pocket].diameter);
+	    if (toolTable[pocket].offset.tran.x) fprintf(fp, " X%+f", toolTable[pocket].offset.tran.x);
+	    if (toolTable[pocket].offset.tran.y) fprintf(fp, " Y%+f", toolTable[pocket].offset.tran.y);
+	    if (toolTable[pocket].offset.tran.z) fprintf(fp, " Z%+f", toolTable[pocket].offset.tran.z);
+	    if (toolTable[pocket].offset.a) fprintf(fp, " A%+f", toolTable[pocket].offset.a);
+	    if (toolTable[pocket].offset.b) fprintf(fp, " B%+f", toolTable[pocket].offset.b);
+	    if (toolTable[pocket].offset.c) fprintf(fp, " C%+f", toolTable[pocket].offset.c);
+	    if (toolTable[pocket].offset.u) fprintf(fp, " U%+f", toolTable[pocket].offset.u);
+	    if (toolTable[pocket].offset.v) fprintf(fp, " V%+f", toolTable[pocket].offset.v);
+	    if (toolTable[pocket].offset.w) fprintf(fp, " W%+f", toolTable[pocket].offset.w);
+	    if (toolTable[pocket].frontangle) fprintf(fp, " I%+f", toolTable[pocket].frontangle);
+	    if (toolTable[pocket].backangle) fprintf(fp, " J%+f", toolTable[pocket].backangle);
+	    if (toolTable[pocket].orientation) fprintf(fp, " Q%d", toolTable[pocket].orientation);
+	    fprintf(fp, " ;%s\n", ttcomments[pocket]);
+	}
+    }
+
+    fclose(fp);
+    return 0;
+}
@@ -28,6 +28,13 @@ int loadToolTable(const char *filename,
 	int random_toolchanger
 	);
 
+int saveToolTable(const char *filename,
+	struct CANON_TOOL_TABLE toolTable[CANON_POCKETS_MAX],
+	int fms[CANON_POCKETS_MAX],
+	char *ttcomments[CANON_POCKETS_MAX],
+	int random_toolchanger
+	);
+
 #ifdef CPLUSPLUS
 }
 #endif
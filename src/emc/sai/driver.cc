@@ -25,6 +25,7 @@
 #include "canon.hh"		// _parameter_file_name
 #include "config.h"		// LINELEN
 #include "tool_parse.h"
+#include "stocksim.hh"
 #include <stdio.h>    /* gets, etc. */
 #include <stdlib.h>   /* exit       */
 #include <string.h>   /* strcpy     */
@@ -36,6 +37,15 @@
 #include <readline/history.h>
 #include <glob.h>
 #include <wordexp.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+#include <map>
+#include <vector>
+#include <algorithm>
 
 InterpBase *pinterp;
 #define interp_new (*pinterp)
@@ -60,6 +70,7 @@ const char *history = "~/.rs274";
 #define interp_read	 interp_new.read
 #define interp_load_tool_table interp_new.load_tool_table
 #define interp_set_loglevel interp_new.set_loglevel
+#define interp_set_profile interp_new.set_profile
 #define interp_task_init interp_new.task_init
 
 /*
@@ -239,6 +250,8 @@ If the do_next argument is 2, an error stops interpretation.
 
 */
 
+static long _blocks_read = 0;  /* for -r */
+
 int interpret_from_file( /* ARGUMENTS                  */
  int do_next,            /* what to do if error        */
  int block_delete,       /* switch which is ON or OFF  */
@@ -252,6 +265,8 @@ int interpret_from_file( /* ARGUMENTS                  */
   for(; ;)
     {
       status = interp_read();
+      if (status != INTERP_ENDFILE)
+        _blocks_read++;
       if ((status == INTERP_EXECUTE_FINISH) && (block_delete == ON))
         continue;
       else if (status == INTERP_ENDFILE)
@@ -307,6 +322,222 @@ int interpret_from_file( /* ARGUMENTS                  */
 
 /************************************************************************/
 
+/* check_file
+
+Returned Value: int (0 if the program ran to its end, 1 if not)
+
+Side Effects:
+   The program is interpreted, with the canonical commands going to
+   _outfile, and a JSON object describing it is written to out.
+
+Called By: check_files
+
+The object gives the name of the file, whether it ran to its end
+without an error, the last line read, and what saicanon.cc added up in
+_summary: the number of moves, an estimate of the run time in seconds
+from the programmed feeds, the traverse rate if one was set and the
+dwells, and the extents of x, y and z.  With -S, the volume the stock
+simulation cut away and the lines of the traverses that went into the
+stock follow.  On an error, the text of the error is added and the
+totals are those up to it.
+
+*/
+
+extern stock_sim *_stock;       /* in saicanon.cc */
+extern std::vector<int> stock_cut(int threads);
+extern int canon_calls();
+extern int canbin_open(const char *path);
+extern int canbin_close();
+
+static void json_string(FILE *out, const char *s)
+{
+  fputc('"', out);
+  for (; *s; s++)
+    {
+      unsigned char ch = *s;
+      if (ch == '"' || ch == '\\')
+        fprintf(out, "\\%c", ch);
+      else if (ch < 0x20)
+        fprintf(out, "\\u%04x", ch);
+      else
+        fputc(ch, out);
+    }
+  fputc('"', out);
+}
+
+static void json_point(FILE *out, const double p[3])
+{
+  if (_summary.have_extents)
+    fprintf(out, "[%.6f, %.6f, %.6f]", p[0], p[1], p[2]);
+  else
+    fprintf(out, "null");
+}
+
+static int check_file(const char *name, int block_delete, FILE *out)
+{
+  char text[LINELEN];
+  int status;
+  int opened;
+
+  SET_BLOCK_DELETE(block_delete);
+  status = interp_open(name);
+  opened = (status == INTERP_OK);
+  if (opened)
+    {
+      for (;;)
+        {
+          status = interp_read();
+          if ((status == INTERP_EXECUTE_FINISH) && (block_delete == ON))
+            continue;
+          if (status == INTERP_ENDFILE)
+            {
+              status = INTERP_OK;
+              break;
+            }
+          if ((status != INTERP_OK) && (status != INTERP_EXECUTE_FINISH))
+            break;
+          status = interp_execute();
+          if (status == INTERP_EXIT)
+            {
+              status = INTERP_OK;
+              break;
+            }
+          if ((status != INTERP_OK) && (status != INTERP_EXECUTE_FINISH))
+            break;
+        }
+    }
+
+  fprintf(out, "{\"file\": ");
+  json_string(out, name);
+  fprintf(out, ", \"ok\": %s, \"line\": %d",
+          (status == INTERP_OK) ? "true" : "false", sequence_number());
+  if (status != INTERP_OK)
+    {
+      error_text(status, text, LINELEN);
+      fprintf(out, ", \"error\": ");
+      json_string(out, text[0] ? text : "Unknown error, bad error code");
+    }
+  fprintf(out, ", \"moves\": %d, \"time\": %.6f, \"feed_time\": %.6f"
+          ", \"traverse_length\": %.6f, \"dwell\": %.6f, \"min\": ",
+          _summary.moves,
+          _summary.feed_time + _summary.traverse_time + _summary.dwell_time,
+          _summary.feed_time, _summary.traverse_length, _summary.dwell_time);
+  json_point(out, _summary.min);
+  fprintf(out, ", \"max\": ");
+  json_point(out, _summary.max);
+  if (_stock)
+    {
+      /* the other workers have the other CPUs */
+      std::vector<int> hits = stock_cut(1);
+      fprintf(out, ", \"removed\": %.6f, \"rapid_hits\": [", _stock->removed());
+      for (size_t i = 0; i < hits.size(); i++)
+        fprintf(out, "%s%d", i ? ", " : "", hits[i]);
+      fprintf(out, "]");
+    }
+  fprintf(out, "}");
+  if (opened)
+    interp_close();
+  return (status == INTERP_OK) ? 0 : 1;
+}
+
+/* check_files
+
+Returned Value: int (0 if every program ran to its end, 1 if not)
+
+Side Effects:
+   A JSON array with the check_file object of each program, in the
+   order given, is printed on stdout.
+
+Called By: main
+
+Each program is checked in a process of its own, forked from this one
+after the interpreter is initialized, with at most jobs of them
+running at once.  The interpreter keeps its state in globals, so this
+is how several programs are interpreted at the same time; it also
+keeps a program from seeing what another one did to the parameters,
+which are not saved by the workers.
+
+*/
+
+static int check_files(int count, char **names, int jobs, int block_delete)
+{
+  std::vector<std::string> results(count);
+  std::map<pid_t, std::pair<int, FILE *> > running;
+  int next = 0;
+  int failed = 0;
+
+  fflush(stdout);
+  fflush(stderr);
+  while (next < count || !running.empty())
+    {
+      while (next < count && (int) running.size() < jobs)
+        {
+          FILE *out = tmpfile();
+          pid_t pid = out ? fork() : -1;
+          if (pid == 0)
+            {
+              int status = check_file(names[next], block_delete, out);
+              fflush(_outfile);
+              _exit((fflush(out) == 0) ? status : 2);
+            }
+          if (pid < 0)
+            {
+              perror("rs274: starting a worker");
+              if (out)
+                fclose(out);
+              if (running.empty())
+                return 1;
+              break;
+            }
+          running[pid] = std::make_pair(next++, out);
+        }
+
+      int wstatus;
+      pid_t pid = wait(&wstatus);
+      if (pid < 0)
+        break;
+      if (running.find(pid) == running.end())
+        continue;
+      int index = running[pid].first;
+      FILE *out = running[pid].second;
+      running.erase(pid);
+
+      char buffer[4096];
+      size_t n;
+      rewind(out);
+      while ((n = fread(buffer, 1, sizeof(buffer), out)) > 0)
+        results[index].append(buffer, n);
+      fclose(out);
+
+      if (!WIFEXITED(wstatus) || WEXITSTATUS(wstatus) > 1
+          || results[index].empty())
+        {
+          failed = 1;
+          snprintf(buffer, sizeof(buffer), "worker %s %d",
+                   WIFEXITED(wstatus) ? "exited with status" : "killed by signal",
+                   WIFEXITED(wstatus) ? WEXITSTATUS(wstatus) : WTERMSIG(wstatus));
+          std::string r = "{\"file\": \"";
+          for (const char *s = names[index]; *s; s++)
+            {
+              if (*s == '"' || *s == '\\') r += '\\';
+              r += *s;
+            }
+          results[index] = r + "\", \"ok\": false, \"error\": \""
+                           + buffer + "\"}";
+        }
+      else if (WEXITSTATUS(wstatus) != 0)
+        failed = 1;
+    }
+
+  printf("[\n");
+  for (int i = 0; i < count; i++)
+    printf("%s%s\n", results[i].c_str(), (i + 1 < count) ? "," : "");
+  printf("]\n");
+  return failed;
+}
+
+/************************************************************************/
+
 /* read_tool_file
 
 Returned Value: int
@@ -546,6 +777,13 @@ int main (int argc, char ** argv)
   int go_flag;
   char *inifile = NULL;
   int log_level = -1;
+  char *profile_file = NULL;
+  char *canbin_file = NULL;
+  int jobs = 0;
+  int rate_flag = 0, calls = 0;
+  int lint_flag = 0;
+  struct timespec start, end;
+  double stock[7];
   std::string interp;
 
   do_next = 2;  /* 2=stop */
@@ -557,7 +795,7 @@ int main (int argc, char ** argv)
   go_flag = 0;
 
   while(1) {
-      int c = getopt(argc, argv, "p:t:v:bsn:gi:l:T");
+      int c = getopt(argc, argv, "p:t:v:bsn:gi:l:TP:j:S:rLc:");
       if(c == -1) break;
 
       switch(c) {
@@ -571,16 +809,36 @@ int main (int argc, char ** argv)
           case 'g': go_flag = !go_flag; break;
           case 'i': inifile = optarg; break;
           case 'T': _task = 1; break;
+          case 'P': profile_file = optarg; break;
+          case 'j': jobs = atoi(optarg); break;
+          case 'r': rate_flag = 1; break;
+          case 'L': lint_flag = 1; break;
+          case 'c': canbin_file = optarg; break;
+          case 'S':
+            if (sscanf(optarg, "%lf,%lf,%lf,%lf,%lf,%lf,%lf",
+                       &stock[0], &stock[1], &stock[2], &stock[3],
+                       &stock[4], &stock[5], &stock[6]) != 7
+                || stock[6] <= 0)
+              goto usage;
+            _stock = new stock_sim(stock[0], stock[1], stock[3], stock[4],
+                                   std::min(stock[2], stock[5]),
+                                   std::max(stock[2], stock[5]), stock[6]);
+            break;
           case '?': default: goto usage;
       }
   }
 
-  if (argc - optind > 3)
+  if (jobs < 0 || (jobs == 0 && !lint_flag && argc - optind > 3)
+      || ((jobs > 0 || lint_flag) && argc == optind)
+      || (canbin_file && (jobs > 0 || lint_flag || argc == optind)))
     {
 usage:
       fprintf(stderr,
             "Usage: %s [-p interp.so] [-t tool.tbl] [-v var-file.var] [-n 0|1|2]\n"
-            "          [-b] [-s] [-g] [input file [output file]]\n"
+            "          [-b] [-s] [-g] [-P profile] [-S stock] [-r] [-c canbin]\n"
+            "          [input file [output file]]\n"
+            "       %s -j jobs [options] input file...\n"
+            "       %s -L [-j threads] [options] input file...\n"
             "\n"
             "    -p: Specify the pluggable interpreter to use\n"
             "    -t: Specify the .tbl (tool table) file to use\n"
@@ -595,10 +853,29 @@ usage:
             "    -i: specify the .ini file (default: no ini file)\n"
             "    -T: call task_init()\n"
             "    -l: specify the log_level (default: -1)\n"
-            , argv[0]);
+            "    -P: time the lines, subroutines and remaps, and write\n"
+            "        a report to the file profile\n"
+            "    -j: check each input file in a process of its own, up to\n"
+            "        jobs at once, and print a JSON summary of each instead\n"
+            "        of the canonical commands\n"
+            "    -S: simulate cutting a block of stock given as\n"
+            "        xmin,ymin,zmin,xmax,ymax,zmax,cell with the tool in\n"
+            "        the spindle, and report the volume removed and the\n"
+            "        traverses that went into it\n"
+            "    -r: report the blocks read and canonical calls made per\n"
+            "        second and the peak memory use on stderr\n"
+            "    -L: check each input file and the subroutines it calls\n"
+            "        without running them, reading up to threads files at\n"
+            "        once, and print every problem found\n"
+            "    -c: also write the canonical calls of the input file to\n"
+            "        canbin as a binary program that canterp can run\n"
+            , argv[0], argv[0], argv[0]);
       exit(1);
     }
 
+  if (jobs > 0 || lint_flag)
+    go_flag = 1;  /* no menu, the batch is all on the command line */
+
   if(!interp.empty()) {
     pinterp = interp_from_shlib(interp.c_str());
   }
@@ -647,7 +924,16 @@ usage:
   argc = argc - optind + 1;
   argv = argv + optind - 1;
 
-  if (argc == 3)
+  if (jobs > 0 && !lint_flag)
+    {
+      _outfile = fopen("/dev/null", "w");
+      if (_outfile == NULL)
+        {
+          perror("/dev/null");
+          exit(1);
+        }
+    }
+  else if (argc == 3 && !lint_flag)
     {
       _outfile = fopen(argv[2], "w");
       if (_outfile == NULL)
@@ -656,6 +942,11 @@ usage:
           exit(1);
         }
     }
+  if (canbin_file && canbin_open(canbin_file) != 0)
+    {
+      fprintf(stderr, "could not open binary output file %s\n", canbin_file);
+      exit(1);
+    }
   if (inifile!= 0) {
       setenv("INI_FILE_NAME",inifile,1);
   } else
@@ -670,8 +961,35 @@ usage:
   if (log_level != -1)
       interp_set_loglevel(log_level);
 
+  if (profile_file)
+      interp_set_profile(profile_file);
+
 
-  if (argc == 1)
+  if (lint_flag)
+    {
+      int found = 0;
+      for (int i = 1; i < argc; i++)
+        {
+          std::vector<InterpDiagnostic> diagnostics;
+          int count = pinterp->lint(argv[i], diagnostics, jobs);
+          if (count < 0)
+            {
+              fprintf(stderr, "%s: this interpreter can't lint\n", argv[i]);
+              exit(2);
+            }
+          for (size_t k = 0; k < diagnostics.size(); k++)
+            printf("%s:%d: %s\n", diagnostics[k].filename.c_str(),
+                   diagnostics[k].line, diagnostics[k].message.c_str());
+          found += count;
+        }
+      exit(found ? 1 : 0);
+    }
+  else if (jobs > 0)
+    {
+      status = check_files(argc - 1, argv + 1, jobs, block_delete);
+      exit(status);
+    }
+  else if (argc == 1)
     status = interpret_from_keyboard(block_delete, print_stack);
   else /* if (argc == 2 or argc == 3) */
     {
@@ -681,7 +999,37 @@ usage:
           report_error(status, print_stack);
           exit(1);
         }
+      calls = canon_calls();
+      clock_gettime(CLOCK_MONOTONIC, &start);
       status = interpret_from_file(do_next, block_delete, print_stack);
+      clock_gettime(CLOCK_MONOTONIC, &end);
+      if (rate_flag)
+        {
+          struct rusage usage;
+          double t = (end.tv_sec - start.tv_sec)
+            + (end.tv_nsec - start.tv_nsec) * 1e-9;
+          if (t <= 0) t = 1e-9;
+          getrusage(RUSAGE_SELF, &usage);
+          calls = canon_calls() - calls;
+          fprintf(stderr, "rate: %ld blocks, %d canon calls in %.3f s, "
+                  "%.0f blocks/s, %.0f calls/s, peak RSS %ld kB\n",
+                  _blocks_read, calls, t, _blocks_read / t, calls / t,
+                  usage.ru_maxrss);
+        }
+      if (_stock)
+        {
+          std::vector<int> hits = stock_cut(0);
+          fprintf(stderr, "stock: removed %g\n", _stock->removed());
+          for (size_t i = 0; i < hits.size(); i++)
+            fprintf(stderr, "stock: traverse into the stock on line %d\n",
+                    hits[i]);
+        }
+      if (canbin_file && canbin_close() != 0)
+        {
+          fprintf(stderr, "could not write binary output file %s\n",
+                  canbin_file);
+          status = 1;
+        }
       file_name(buffer, 5);  /* called to exercise the function */
       file_name(buffer, 79); /* called to exercise the function */
       interp_close();
@@ -34,6 +34,8 @@
 #include "canon.hh"
 #include "rs274ngc.hh"
 #include "rs274ngc_interp.hh"
+#include "stocksim.hh"
+#include "emc/canterp/canbin.hh"
 #include <math.h>
 #include <stdio.h>
 #include <string.h>
@@ -92,6 +94,205 @@ static bool _toolchanger_fault;
 static int  _toolchanger_reason;
 static bool fo_enable=true, so_enable=true;
 
+CANON_SUMMARY _summary;
+
+/* The extents and times in _summary.  Lengths are of x, y and z only, so
+a move of the rotary axes alone takes no time here. */
+
+static void summary_point(double x, double y, double z)
+{
+  double p[3] = {x, y, z};
+  for (int i = 0; i < 3; i++)
+    {
+      if (!_summary.have_extents || p[i] < _summary.min[i])
+        _summary.min[i] = p[i];
+      if (!_summary.have_extents || p[i] > _summary.max[i])
+        _summary.max[i] = p[i];
+    }
+  _summary.have_extents = 1;
+}
+
+/* starts a move from the current position */
+static void summary_start()
+{
+  _summary.moves++;
+  if (!_summary.have_extents)
+    summary_point(_program_position_x, _program_position_y,
+                  _program_position_z);
+}
+
+static void summary_feed(double length)
+{
+  double rate = _feed_rate;
+
+  if (_feed_mode == 1)          /* inverse time */
+    {
+      if (_feed_rate > 0)
+        _summary.feed_time += 60 / _feed_rate;
+      return;
+    }
+  if (_feed_mode == 2)          /* units per revolution */
+    rate = _feed_rate * _spindle_speed;
+  if (rate > 0)
+    _summary.feed_time += length * 60 / rate;
+}
+
+static void summary_traverse(double length)
+{
+  _summary.traverse_length += length;
+  if (_traverse_rate > 0)
+    _summary.traverse_time += length * 60 / _traverse_rate;
+}
+
+static double summary_length(double x, double y, double z)
+{
+  double dx = x - _program_position_x;
+  double dy = y - _program_position_y;
+  double dz = z - _program_position_z;
+  return sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+/* the first, second and normal axis of the active plane, and the
+radius, start angle and sweep of an arc from the current position */
+static void arc_params(double first_end, double second_end,
+                       double first_axis, double second_axis, int rotation,
+                       double start[3], int axes[3],
+                       double *r, double *a0, double *sweep)
+{
+  start[0] = _program_position_x;
+  start[1] = _program_position_y;
+  start[2] = _program_position_z;
+  if (_active_plane == CANON_PLANE_YZ)
+    { axes[0] = 1; axes[1] = 2; axes[2] = 0; }
+  else if (_active_plane == CANON_PLANE_XZ)
+    { axes[0] = 2; axes[1] = 0; axes[2] = 1; }
+  else
+    { axes[0] = 0; axes[1] = 1; axes[2] = 2; }
+
+  int i1 = axes[0], i2 = axes[1];
+  *r = hypot(start[i1] - first_axis, start[i2] - second_axis);
+  *a0 = atan2(start[i2] - second_axis, start[i1] - first_axis);
+  double a1 = atan2(second_end - second_axis, first_end - first_axis);
+  *sweep = (rotation > 0) ? a1 - *a0 : *a0 - a1;
+  if (*sweep <= 0)
+    *sweep += 2 * M_PI;
+  if (rotation > 1 || rotation < -1)
+    *sweep += (abs(rotation) - 1) * 2 * M_PI;
+}
+
+/* the length of an arc from the current position, with the points
+where it is farthest out along the axes of its plane in the extents */
+static double summary_arc(double first_end, double second_end,
+                          double first_axis, double second_axis,
+                          int rotation, double axis_end_point)
+{
+  double start[3], r, a0, sweep;
+  int axes[3];
+
+  arc_params(first_end, second_end, first_axis, second_axis, rotation,
+             start, axes, &r, &a0, &sweep);
+  int i1 = axes[0], i2 = axes[1], i3 = axes[2];
+
+  for (int k = 0; k < 4 && rotation != 0; k++)
+    {
+      double a = k * M_PI / 2;
+      double from_start = (rotation > 0) ? a - a0 : a0 - a;
+      from_start = fmod(from_start + 4 * M_PI, 2 * M_PI);
+      if (from_start > sweep)
+        continue;
+      double p[3];
+      p[i1] = first_axis + r * cos(a);
+      p[i2] = second_axis + r * sin(a);
+      p[i3] = start[i3];
+      summary_point(p[0], p[1], p[2]);
+    }
+  return hypot(r * sweep, axis_end_point - start[i3]);
+}
+
+/* The moves for the stock removal simulation, when the driver set up
+_stock for -S.  The tool is the one in the spindle, taken to be a flat
+end mill of its diameter, and arcs are cut as chords of at most 1/64 of
+a circle. */
+
+stock_sim *_stock = NULL; /*Not static. Driver writes*/
+static std::vector<stock_move> _stock_moves;
+
+static void stock_segment(int line, const double from[3], const double to[3],
+                          bool traverse)
+{
+  stock_move m;
+  for (int i = 0; i < 3; i++)
+    {
+      m.start[i] = from[i];
+      m.end[i] = to[i];
+    }
+  m.radius = _tools[0].diameter / 2;
+  m.ball = false;
+  m.traverse = traverse;
+  m.line = line;
+  _stock_moves.push_back(m);
+}
+
+static void stock_line(int line, double x, double y, double z, bool traverse)
+{
+  if (!_stock)
+    return;
+  double from[3] = {_program_position_x, _program_position_y,
+                    _program_position_z};
+  double to[3] = {x, y, z};
+  stock_segment(line, from, to, traverse);
+}
+
+static void stock_arc(int line, double first_end, double second_end,
+                      double first_axis, double second_axis, int rotation,
+                      double axis_end_point)
+{
+  if (!_stock)
+    return;
+  double start[3], r, a0, sweep;
+  int axes[3];
+
+  arc_params(first_end, second_end, first_axis, second_axis, rotation,
+             start, axes, &r, &a0, &sweep);
+  int steps = (int) ceil(sweep * 64 / (2 * M_PI));
+  if (steps < 1)
+    steps = 1;
+  double from[3] = {start[0], start[1], start[2]};
+  for (int k = 1; k <= steps; k++)
+    {
+      double a = a0 + ((rotation > 0) ? sweep : -sweep) * k / steps;
+      double to[3];
+      to[axes[0]] = first_axis + r * cos(a);
+      to[axes[1]] = second_axis + r * sin(a);
+      to[axes[2]] = start[axes[2]]
+        + (axis_end_point - start[axes[2]]) * k / steps;
+      if (k == steps)
+        {
+          to[axes[0]] = first_end;
+          to[axes[1]] = second_end;
+        }
+      stock_segment(line, from, to, false);
+      memcpy(from, to, sizeof(from));
+    }
+}
+
+/* the number of canonical calls printed so far */
+int canon_calls()
+{
+  return _line_number - 1;
+}
+
+/* cuts the moves made so far and returns the lines of the traverses
+that went into the stock */
+std::vector<int> stock_cut(int threads)
+{
+  std::vector<int> lines;
+  if (_stock)
+    lines = _stock->cut(_stock_moves, threads);
+  _stock_moves.clear();
+  return lines;
+}
+
 /************************************************************************/
 
 /* Canonical "Do it" functions
@@ -144,6 +345,109 @@ void print_nc_line_number()
 }
 
 
+/* Binary program for canterp, written alongside the printed calls when
+rs274 is run with -c.  The records go straight to the file and the strings
+are kept until canbin_close appends them and fills in the header. */
+
+static FILE *_canbin;
+static uint32_t _canbin_records;
+static std::string _canbin_strings;
+
+int canbin_open(const char *path)
+{
+  struct canbin_header header;
+
+  _canbin = fopen(path, "wb");
+  if (!_canbin)
+    return -1;
+  memset(&header, 0, sizeof(header));
+  _canbin_records = 0;
+  _canbin_strings.clear();
+  return fwrite(&header, sizeof(header), 1, _canbin) == 1 ? 0 : -1;
+}
+
+int canbin_close()
+{
+  struct canbin_header header;
+  int ok;
+
+  if (!_canbin)
+    return 0;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, CANBIN_MAGIC, sizeof(header.magic));
+  header.version = CANBIN_VERSION;
+  header.record_size = sizeof(struct canbin_record);
+  header.records = _canbin_records;
+  header.string_bytes = _canbin_strings.size();
+  ok = fwrite(_canbin_strings.data(), 1, _canbin_strings.size(), _canbin)
+         == _canbin_strings.size()
+    && fseek(_canbin, 0, SEEK_SET) == 0
+    && fwrite(&header, sizeof(header), 1, _canbin) == 1;
+  ok = (fclose(_canbin) == 0) && ok;
+  _canbin = NULL;
+  return ok ? 0 : -1;
+}
+
+static struct canbin_record *canbin_new(int op, int line)
+{
+  static struct canbin_record record;
+
+  memset(&record, 0, sizeof(record));
+  record.op = op;
+  record.line = line;
+  return &record;
+}
+
+static void canbin_put(struct canbin_record *record)
+{
+  if (fwrite(record, sizeof(*record), 1, _canbin) == 1)
+    _canbin_records++;
+}
+
+/* puts a record of the op with up to two integer and one double argument,
+for the calls that are not moves */
+static void canbin_call(int op, int i0 = 0, int i1 = 0, double d0 = 0)
+{
+  struct canbin_record *record;
+
+  if (!_canbin)
+    return;
+  record = canbin_new(op, interp_new.line());
+  record->i[0] = i0;
+  record->i[1] = i1;
+  record->d[0] = d0;
+  canbin_put(record);
+}
+
+static void canbin_move(int op, int line, double x, double y, double z,
+                        double a, double b, double c,
+                        double u, double v, double w, int i0 = 0)
+{
+  struct canbin_record *record;
+
+  if (!_canbin)
+    return;
+  record = canbin_new(op, line);
+  record->i[0] = i0;
+  record->d[0] = x; record->d[1] = y; record->d[2] = z;
+  record->d[3] = a; record->d[4] = b; record->d[5] = c;
+  record->d[6] = u; record->d[7] = v; record->d[8] = w;
+  canbin_put(record);
+}
+
+static void canbin_text(int op, const char *s)
+{
+  struct canbin_record *record;
+
+  if (!_canbin)
+    return;
+  record = canbin_new(op, interp_new.line());
+  record->str = _canbin_strings.size();
+  _canbin_strings.append(s);
+  _canbin_strings.push_back(0);
+  canbin_put(record);
+}
+
 #define PRINT0(control) if (1)                        \
           {{if(_outfile==NULL){_outfile=stdout;}} fprintf(_outfile,  "%5d ", _line_number++); \
            print_nc_line_number();                    \
@@ -264,6 +568,7 @@ void SET_G92_OFFSET(double x, double y, double z,
 
 void USE_LENGTH_UNITS(CANON_UNITS in_unit)
 {
+  canbin_call(CANBIN_USE_LENGTH_UNITS, in_unit);
   if (in_unit == CANON_UNITS_INCHES)
     {
       PRINT0("USE_LENGTH_UNITS(CANON_UNITS_INCHES)\n");
@@ -336,6 +641,11 @@ void STRAIGHT_TRAVERSE( int line_number,
          , b /*BB*/
          , c /*CC*/
          );
+  summary_start();
+  canbin_move(CANBIN_STRAIGHT_TRAVERSE, line_number, x, y, z, a, b, c, u, v, w);
+  summary_traverse(summary_length(x, y, z));
+  summary_point(x, y, z);
+  stock_line(line_number, x, y, z, true);
   _program_position_x = x;
   _program_position_y = y;
   _program_position_z = z;
@@ -353,6 +663,7 @@ void SET_FEED_MODE(int mode)
 void SET_FEED_RATE(double rate)
 {
   PRINT1("SET_FEED_RATE(%.4f)\n", rate);
+  canbin_call(CANBIN_SET_FEED_RATE, 0, 0, rate);
   _feed_rate = rate;
 }
 
@@ -360,10 +671,12 @@ void SET_FEED_REFERENCE(CANON_FEED_REFERENCE reference)
 {
   PRINT1("SET_FEED_REFERENCE(%s)\n",
          (reference == CANON_WORKPIECE) ? "CANON_WORKPIECE" : "CANON_XYZ");
+  canbin_call(CANBIN_SET_FEED_REFERENCE, reference);
 }
 
 extern void SET_MOTION_CONTROL_MODE(CANON_MOTION_MODE mode, double tolerance)
 {
+  canbin_call(CANBIN_SET_MOTION_CONTROL_MODE, mode, 0, tolerance);
   motion_tolerance = 0;
   if (mode == CANON_EXACT_STOP)
     {
@@ -397,6 +710,7 @@ void SELECT_PLANE(CANON_PLANE in_plane)
          ((in_plane == CANON_PLANE_XY) ? "XY" :
           (in_plane == CANON_PLANE_YZ) ? "YZ" :
           (in_plane == CANON_PLANE_XZ) ? "XZ" : "UNKNOWN"));
+  canbin_call(CANBIN_SELECT_PLANE, in_plane);
   _active_plane = in_plane;
 }
 
@@ -416,7 +730,7 @@ void START_SPEED_FEED_SYNCH()
 {PRINT0 ("START_SPEED_FEED_SYNCH()\n");}
 
 void STOP_SPEED_FEED_SYNCH()
-{PRINT0 ("STOP_SPEED_FEED_SYNCH()\n");}
+{PRINT0 ("STOP_SPEED_FEED_SYNCH()\n"); canbin_call(CANBIN_STOP_SPEED_FEED_SYNCH);}
 
 /* Machining Functions */
 
@@ -452,6 +766,23 @@ void ARC_FEED(int line_number,
          , b /*BB*/
          , c /*CC*/
          );
+  if (_canbin)
+    {
+      struct canbin_record *record = canbin_new(CANBIN_ARC_FEED, line_number);
+      double *d = record->d;
+
+      record->i[0] = rotation;
+      d[0] = first_end; d[1] = second_end;
+      d[2] = first_axis; d[3] = second_axis; d[4] = axis_end_point;
+      d[5] = a; d[6] = b; d[7] = c;
+      d[8] = u; d[9] = v; d[10] = w;
+      canbin_put(record);
+    }
+  summary_start();
+  summary_feed(summary_arc(first_end, second_end, first_axis, second_axis,
+                           rotation, axis_end_point));
+  stock_arc(line_number, first_end, second_end, first_axis, second_axis,
+            rotation, axis_end_point);
   if (_active_plane == CANON_PLANE_XY)
     {
       _program_position_x = first_end;
@@ -470,6 +801,8 @@ void ARC_FEED(int line_number,
       _program_position_y = axis_end_point;
       _program_position_z = first_end;
     }
+  summary_point(_program_position_x, _program_position_y,
+                _program_position_z);
   _program_position_a = a; /*AA*/
   _program_position_b = b; /*BB*/
   _program_position_c = c; /*CC*/
@@ -494,6 +827,11 @@ void STRAIGHT_FEED(int line_number,
          , b /*BB*/
          , c /*CC*/
          );
+  summary_start();
+  canbin_move(CANBIN_STRAIGHT_FEED, line_number, x, y, z, a, b, c, u, v, w);
+  summary_feed(summary_length(x, y, z));
+  summary_point(x, y, z);
+  stock_line(line_number, x, y, z, false);
   _program_position_x = x;
   _program_position_y = y;
   _program_position_z = z;
@@ -535,6 +873,12 @@ void STRAIGHT_PROBE(int line_number,
          , b /*BB*/
          , c /*CC*/
          );
+  summary_start();
+  canbin_move(CANBIN_STRAIGHT_PROBE, line_number, x, y, z, a, b, c, u, v, w,
+              probe_type);
+  summary_feed(distance);
+  summary_point(x, y, z);
+  stock_line(line_number, x, y, z, false);
   _probe_position_x = x;
   _probe_position_y = y;
   _probe_position_z = z;
@@ -561,12 +905,20 @@ void RIGID_TAP(int line_number, double x, double y, double z)
     fprintf(_outfile, "%5d ", _line_number++);
     print_nc_line_number();
     fprintf(_outfile, "RIGID_TAP(%.4f, %.4f, %.4f)\n", x, y, z);
+    /* down and back out at the same speed */
+    summary_start();
+    summary_feed(2 * summary_length(x, y, z));
+    summary_point(x, y, z);
 
 }
 
 
 void DWELL(double seconds)
-{PRINT1("DWELL(%.4f)\n", seconds);}
+{
+  PRINT1("DWELL(%.4f)\n", seconds);
+  canbin_call(CANBIN_DWELL, 0, 0, seconds);
+  _summary.dwell_time += seconds;
+}
 
 /* Spindle Functions */
 void SPINDLE_RETRACT_TRAVERSE()
@@ -579,6 +931,7 @@ void SET_SPINDLE_MODE(double arg) {
 void START_SPINDLE_CLOCKWISE(int wait_for_atspeed)
 {
   PRINT0("START_SPINDLE_CLOCKWISE()\n");
+  canbin_call(CANBIN_START_SPINDLE_CLOCKWISE, wait_for_atspeed);
   _spindle_turning = ((_spindle_speed == 0) ? CANON_STOPPED :
                                                    CANON_CLOCKWISE);
 }
@@ -586,6 +939,7 @@ void START_SPINDLE_CLOCKWISE(int wait_for_atspeed)
 void START_SPINDLE_COUNTERCLOCKWISE(int wait_for_atspeed)
 {
   PRINT0("START_SPINDLE_COUNTERCLOCKWISE()\n");
+  canbin_call(CANBIN_START_SPINDLE_COUNTERCLOCKWISE, wait_for_atspeed);
   _spindle_turning = ((_spindle_speed == 0) ? CANON_STOPPED :
                                                    CANON_COUNTERCLOCKWISE);
 }
@@ -593,12 +947,14 @@ void START_SPINDLE_COUNTERCLOCKWISE(int wait_for_atspeed)
 void SET_SPINDLE_SPEED(double rpm)
 {
   PRINT1("SET_SPINDLE_SPEED(%.4f)\n", rpm);
+  canbin_call(CANBIN_SET_SPINDLE_SPEED, 0, 0, rpm);
   _spindle_speed = rpm;
 }
 
 void STOP_SPINDLE_TURNING()
 {
   PRINT0("STOP_SPINDLE_TURNING()\n");
+  canbin_call(CANBIN_STOP_SPINDLE_TURNING);
   _spindle_turning = CANON_STOPPED;
 }
 
@@ -606,7 +962,9 @@ void SPINDLE_RETRACT()
 {PRINT0("SPINDLE_RETRACT()\n");}
 
 void ORIENT_SPINDLE(double orientation, int mode)
-{PRINT2("ORIENT_SPINDLE(%.4f, %d)\n", orientation,mode);
+{
+  PRINT2("ORIENT_SPINDLE(%.4f, %d)\n", orientation,mode);
+  canbin_call(CANBIN_ORIENT_SPINDLE, mode, 0, orientation);
 }
 
 void WAIT_SPINDLE_ORIENT_COMPLETE(double timeout) 
@@ -642,12 +1000,13 @@ void USE_TOOL_LENGTH_OFFSET(EmcPose offset)
 void CHANGE_TOOL(int slot)
 {
   PRINT1("CHANGE_TOOL(%d)\n", slot);
+  canbin_call(CANBIN_CHANGE_TOOL, slot);
   _active_slot = slot;
   _tools[0] = _tools[slot];
 }
 
 void SELECT_POCKET(int slot, int tool)
-{PRINT1("SELECT_POCKET(%d)\n", slot);}
+{PRINT1("SELECT_POCKET(%d)\n", slot); canbin_call(CANBIN_SELECT_POCKET, slot, tool);}
 
 void CHANGE_TOOL_NUMBER(int slot)
 {
@@ -668,7 +1027,7 @@ void CLAMP_AXIS(CANON_AXIS axis)
         (axis == CANON_AXIS_C) ? "CANON_AXIS_C" : "UNKNOWN");}
 
 void COMMENT(const char *s)
-{PRINT1("COMMENT(\"%s\")\n", s);}
+{PRINT1("COMMENT(\"%s\")\n", s); canbin_text(CANBIN_COMMENT, s);}
 
 void DISABLE_ADAPTIVE_FEED()
 {PRINT0("DISABLE_ADAPTIVE_FEED()\n");}
@@ -677,10 +1036,10 @@ void DISABLE_FEED_HOLD()
 {PRINT0("DISABLE_FEED_HOLD()\n");}
 
 void DISABLE_FEED_OVERRIDE()
-{PRINT0("DISABLE_FEED_OVERRIDE()\n"); fo_enable = false; }
+{PRINT0("DISABLE_FEED_OVERRIDE()\n"); canbin_call(CANBIN_DISABLE_FEED_OVERRIDE); fo_enable = false; }
 
 void DISABLE_SPEED_OVERRIDE()
-{PRINT0("DISABLE_SPEED_OVERRIDE()\n"); so_enable = false; }
+{PRINT0("DISABLE_SPEED_OVERRIDE()\n"); canbin_call(CANBIN_DISABLE_SPEED_OVERRIDE); so_enable = false; }
 
 void ENABLE_ADAPTIVE_FEED()
 {PRINT0("ENABLE_ADAPTIVE_FEED()\n");}
@@ -689,20 +1048,22 @@ void ENABLE_FEED_HOLD()
 {PRINT0("ENABLE_FEED_HOLD()\n");}
 
 void ENABLE_FEED_OVERRIDE()
-{PRINT0("ENABLE_FEED_OVERRIDE()\n"); fo_enable = true; }
+{PRINT0("ENABLE_FEED_OVERRIDE()\n"); canbin_call(CANBIN_ENABLE_FEED_OVERRIDE); fo_enable = true; }
 
 void ENABLE_SPEED_OVERRIDE()
-{PRINT0("ENABLE_SPEED_OVERRIDE()\n"); so_enable = true; }
+{PRINT0("ENABLE_SPEED_OVERRIDE()\n"); canbin_call(CANBIN_ENABLE_SPEED_OVERRIDE); so_enable = true; }
 
 void FLOOD_OFF()
 {
   PRINT0("FLOOD_OFF()\n");
+  canbin_call(CANBIN_FLOOD_OFF);
   _flood = 0;
 }
 
 void FLOOD_ON()
 {
   PRINT0("FLOOD_ON()\n");
+  canbin_call(CANBIN_FLOOD_ON);
   _flood = 1;
 }
 
@@ -711,7 +1072,7 @@ void INIT_CANON()
 }
 
 void MESSAGE(char *s)
-{PRINT1("MESSAGE(\"%s\")\n", s);}
+{PRINT1("MESSAGE(\"%s\")\n", s); canbin_text(CANBIN_MESSAGE, s);}
 
 void LOG(char *s)
 {PRINT1("LOG(\"%s\")\n", s);}
@@ -725,23 +1086,25 @@ void LOGCLOSE()
 void MIST_OFF()
 {
   PRINT0("MIST_OFF()\n");
+  canbin_call(CANBIN_MIST_OFF);
   _mist = 0;
 }
 
 void MIST_ON()
 {
   PRINT0("MIST_ON()\n");
+  canbin_call(CANBIN_MIST_ON);
   _mist = 1;
 }
 
 void PALLET_SHUTTLE()
-{PRINT0("PALLET_SHUTTLE()\n");}
+{PRINT0("PALLET_SHUTTLE()\n"); canbin_call(CANBIN_PALLET_SHUTTLE);}
 
 void TURN_PROBE_OFF()
-{PRINT0("TURN_PROBE_OFF()\n");}
+{PRINT0("TURN_PROBE_OFF()\n"); canbin_call(CANBIN_TURN_PROBE_OFF);}
 
 void TURN_PROBE_ON()
-{PRINT0("TURN_PROBE_ON()\n");}
+{PRINT0("TURN_PROBE_ON()\n"); canbin_call(CANBIN_TURN_PROBE_ON);}
 
 void UNCLAMP_AXIS(CANON_AXIS axis)
 {PRINT1("UNCLAMP_AXIS(%s)\n",
@@ -755,7 +1118,7 @@ void UNCLAMP_AXIS(CANON_AXIS axis)
 /* Program Functions */
 
 void PROGRAM_STOP()
-{PRINT0("PROGRAM_STOP()\n");}
+{PRINT0("PROGRAM_STOP()\n"); canbin_call(CANBIN_PROGRAM_STOP);}
 
 void SET_BLOCK_DELETE(bool state)
 {block_delete = state;} //state == ON, means we don't interpret lines starting with "/"
@@ -770,10 +1133,10 @@ bool GET_OPTIONAL_PROGRAM_STOP()
 {return optional_program_stop;} //state == ON, means we stop
 
 void OPTIONAL_PROGRAM_STOP()
-{PRINT0("OPTIONAL_PROGRAM_STOP()\n");}
+{PRINT0("OPTIONAL_PROGRAM_STOP()\n"); canbin_call(CANBIN_OPTIONAL_PROGRAM_STOP);}
 
 void PROGRAM_END()
-{PRINT0("PROGRAM_END()\n");}
+{PRINT0("PROGRAM_END()\n"); canbin_call(CANBIN_PROGRAM_END);}
 
 
 /*************************************************************************/
@@ -807,7 +1170,10 @@ double GET_EXTERNAL_ANGLE_UNITS() {return 1.0;}
 int GET_EXTERNAL_SELECTED_TOOL_SLOT() { return 0; }
 int GET_EXTERNAL_SPINDLE_OVERRIDE_ENABLE() {return so_enable;}
 void START_SPEED_FEED_SYNCH(double sync, bool vel)
-{PRINT2("START_SPEED_FEED_SYNC(%f,%d)\n", sync, vel);}
+{
+  PRINT2("START_SPEED_FEED_SYNC(%f,%d)\n", sync, vel);
+  canbin_call(CANBIN_START_SPEED_FEED_SYNCH, vel, 0, sync);
+}
 CANON_MOTION_MODE motion_mode;
 
 int GET_EXTERNAL_DIGITAL_INPUT(int index, int def) { return def; }
@@ -42,6 +42,7 @@
 #include "canon_position.hh"		// data type for a machine position
 #include "interpl.hh"		// interp_list
 #include "emcglb.h"		// TRAJ_MAX_VELOCITY
+#include "kinslimits.hh"		// kinsLimitsTime()
 
 //#define EMCCANON_DEBUG
 
@@ -521,6 +522,44 @@ void SET_FEED_REFERENCE(CANON_FEED_REFERENCE reference)
     // nothing need be done here
 }
 
+/**
+ * With [TASK] KINS_LIMITS, the time the move from the current position to the
+ * given one takes with its fastest joint at its velocity or acceleration
+ * limit, measured like the axes are below; 0 if the limits are off.
+ */
+static double getKinsLimitTime(double x, double y, double z,
+                               double a, double b, double c,
+                               double u, double v, double w, bool accel)
+{
+    double start[9], end[9], limit[EMCMOT_MAX_JOINTS];
+
+    if (!kinsLimitsActive()) return 0.0;
+
+    start[0] = TO_EXT_LEN(canon.endPoint.x);
+    start[1] = TO_EXT_LEN(canon.endPoint.y);
+    start[2] = TO_EXT_LEN(canon.endPoint.z);
+    start[3] = TO_EXT_ANG(canon.endPoint.a);
+    start[4] = TO_EXT_ANG(canon.endPoint.b);
+    start[5] = TO_EXT_ANG(canon.endPoint.c);
+    start[6] = TO_EXT_LEN(canon.endPoint.u);
+    start[7] = TO_EXT_LEN(canon.endPoint.v);
+    start[8] = TO_EXT_LEN(canon.endPoint.w);
+    end[0] = TO_EXT_LEN(x);
+    end[1] = TO_EXT_LEN(y);
+    end[2] = TO_EXT_LEN(z);
+    end[3] = TO_EXT_ANG(a);
+    end[4] = TO_EXT_ANG(b);
+    end[5] = TO_EXT_ANG(c);
+    end[6] = TO_EXT_LEN(u);
+    end[7] = TO_EXT_LEN(v);
+    end[8] = TO_EXT_LEN(w);
+    for (int j = 0; j < EMCMOT_MAX_JOINTS; j++) {
+        limit[j] = accel ? emcJointGetMaxAcceleration(j)
+                         : emcJointGetMaxVelocity(j);
+    }
+    return kinsLimitsTime(start, end, limit, EMCMOT_MAX_JOINTS);
+}
+
 /**
  * Get the limiting acceleration for a displacement from the current position to the given position.
  * returns a single acceleration that is the minimum of all axis accelerations.
@@ -641,6 +680,15 @@ static AccelData getStraightAcceleration(double x, double y, double z,
 	    out.acc = out.dtot / out.tmax;
 	}
     }
+    // the joints may need more time than the axes, near a singular
+    // orientation of the rotaries of a 5 axis machine most of all
+    if (out.dtot > 0.0) {
+        double tk = getKinsLimitTime(x, y, z, a, b, c, u, v, w, true);
+        if (tk > out.tmax) {
+            out.tmax = tk;
+            out.acc = out.dtot / out.tmax;
+        }
+    }
     if(debug_velacc) 
         printf("cartesian %d ang %d acc %g\n", canon.cartesian_move, canon.angular_move, out.acc);
     return out;
@@ -785,6 +833,13 @@ static VelData getStraightVelocity(double x, double y, double z,
             out.vel = out.dtot / out.tmax;
         }
     }
+    if (out.dtot > 0.0) {
+        double tk = getKinsLimitTime(x, y, z, a, b, c, u, v, w, false);
+        if (tk > out.tmax) {
+            out.tmax = tk;
+            out.vel = out.dtot / out.tmax;
+        }
+    }
     if(debug_velacc) 
         printf("cartesian %d ang %d vel %g\n", canon.cartesian_move, canon.angular_move, out.vel);
     return out;
@@ -809,9 +864,118 @@ struct pt { double x, y, z, a, b, c, u, v, w; int line_no;};
 
 static std::vector<struct pt> chained_points;
 
+/* When ARC_FITTING is enabled, a chain of points that does not collapse to a
+   single line may instead be fit by one XY arc. This holds the fitted circle
+   for the points currently in chained_points. */
+static struct {
+    bool active;
+    double cx, cy, r;
+    double sweep;       // signed included angle, positive is counterclockwise
+} chained_arc;
+
+// The termination condition is sent with the next move, so a mode that
+// is set and set back with no move in between, as canned cycles do for
+// every hole, costs one message rather than two.  It is sent even when
+// it matches the last one, since motion resets its own when disabled.
+static bool term_cond_pending;
+
+static void send_term_cond(void) {
+    if (!term_cond_pending) return;
+    term_cond_pending = false;
+
+    EMC_TRAJ_SET_TERM_COND setTermCondMsg;
+
+    switch (canon.motionMode) {
+    case CANON_CONTINUOUS:
+        setTermCondMsg.cond = EMC_TRAJ_TERM_COND_BLEND;
+        setTermCondMsg.tolerance = TO_EXT_LEN(canon.motionTolerance);
+        break;
+    case CANON_EXACT_PATH:
+        setTermCondMsg.cond = EMC_TRAJ_TERM_COND_EXACT;
+        break;
+
+    case CANON_EXACT_STOP:
+    default:
+        setTermCondMsg.cond = EMC_TRAJ_TERM_COND_STOP;
+        break;
+    }
+
+    interp_list.append(setTermCondMsg);
+}
+
+bool CANON_SAVE_STATE(CanonConfig_t *state)
+{
+    if (!chained_points.empty()) return false;
+    *state = canon;
+    return true;
+}
+
+void CANON_RESTORE_STATE(const CanonConfig_t *state)
+{
+    canon = *state;
+    chained_points.clear();
+    chained_arc.active = false;
+    // send the termination condition again with the next move
+    term_cond_pending = true;
+}
+
+static void flush_chained_arc(void) {
+    struct pt &pos = chained_points.back();
+    CANON_POSITION endpt(pos.x, pos.y, pos.z,
+                         pos.a, pos.b, pos.c,
+                         pos.u, pos.v, pos.w);
+
+#ifdef SHOW_JOINED_SEGMENTS
+    for(unsigned int i=0; i != chained_points.size(); i++) { printf("o"); }
+    printf("\n");
+#endif
+
+    // Same planar limits as ARC_FEED, with only X and Y moving
+    double v_max_axes = MIN(FROM_EXT_LEN(emcAxisGetMaxVelocity(0)),
+                            FROM_EXT_LEN(emcAxisGetMaxVelocity(1)));
+    double a_max_axes = MIN(FROM_EXT_LEN(emcAxisGetMaxAcceleration(0)),
+                            FROM_EXT_LEN(emcAxisGetMaxAcceleration(1)));
+    double a_max_normal = a_max_axes * sqrt(3.0)/2.0;
+    double v_max = MIN(sqrt(a_max_normal * chained_arc.r), v_max_axes);
+    double vel = MIN(canon.linearFeedRate, v_max);
+
+    canon_debug("arc fit: %d points, r = %f, sweep = %f\n",
+            (int)chained_points.size(), chained_arc.r, chained_arc.sweep);
+
+    EMC_TRAJ_CIRCULAR_MOVE circularMoveMsg;
+    circularMoveMsg.feed_mode = canon.feed_mode;
+    circularMoveMsg.end = to_ext_pose(endpt);
+
+    PM_CARTESIAN center_cart(chained_arc.cx, chained_arc.cy, pos.z);
+    PM_CARTESIAN normal_cart(0.0, 0.0, 1.0);
+    circularMoveMsg.center = to_ext_len(center_cart);
+    circularMoveMsg.normal = to_ext_len(normal_cart);
+    circularMoveMsg.turn = chained_arc.sweep > 0 ? 0 : -1;
+    circularMoveMsg.type = EMC_MOTION_TYPE_ARC;
+
+    circularMoveMsg.vel = toExtVel(vel);
+    circularMoveMsg.ini_maxvel = toExtVel(v_max);
+    circularMoveMsg.acc = toExtAcc(a_max_axes);
+
+    if((vel && a_max_axes) || canon.synched) {
+        interp_list.set_line_number(pos.line_no);
+        send_term_cond();
+        interp_list.append(circularMoveMsg);
+    }
+    canonUpdateEndPoint(endpt);
+
+    chained_points.clear();
+    chained_arc.active = false;
+}
+
 static void flush_segments(void) {
     if(chained_points.empty()) return;
 
+    if(chained_arc.active) {
+        flush_chained_arc();
+        return;
+    }
+
     struct pt &pos = chained_points.back();
 
     double x = pos.x, y = pos.y, z = pos.z;
@@ -870,6 +1034,7 @@ static void flush_segments(void) {
     linearMoveMsg.indexrotary = -1;
     if ((vel && acc) || canon.synched) {
         interp_list.set_line_number(line_no);
+        send_term_cond();
         interp_list.append(linearMoveMsg);
     }
     canonUpdateEndPoint(x, y, z, a, b, c, u, v, w);
@@ -926,6 +1091,70 @@ linkable(double x, double y, double z,
     return true;
 }
 
+/* Check whether the chain plus the new point can be replaced by a single
+   circular arc in the XY plane. Every original vertex must lie within
+   the naive cam tolerance of the circle, the chords must bulge less than
+   the tolerance, and the points must advance monotonically around the
+   center. On success the fitted circle is stored in chained_arc. */
+static bool
+arc_linkable(double x, double y, double z,
+             double a, double b, double c,
+             double u, double v, double w) {
+    struct pt &pos = chained_points.back();
+    double tol = canon.naivecamTolerance;
+    if(!emc_task_arc_fitting) return false;
+    if(canon.motionMode != CANON_CONTINUOUS || tol == 0) return false;
+    if(canon.synched) return false;
+    if(chained_points.size() > 100) return false;
+
+    // planar only: no helix, no rotary or UVW motion within the chain
+    if(z != pos.z || pos.z != canon.endPoint.z) return false;
+    if(a != pos.a) return false;
+    if(b != pos.b) return false;
+    if(c != pos.c) return false;
+    if(u != pos.u) return false;
+    if(v != pos.v) return false;
+    if(w != pos.w) return false;
+
+    // circle through the start, a middle vertex and the new point
+    double sx = canon.endPoint.x, sy = canon.endPoint.y;
+    struct pt &mid = chained_points[chained_points.size() / 2];
+    double bx = mid.x - sx, by = mid.y - sy;
+    double ex = x - sx, ey = y - sy;
+    double d = 2 * (bx * ey - by * ex);
+    if(fabs(d) < 1e-12) return false;
+    double b2 = bx*bx + by*by, e2 = ex*ex + ey*ey;
+    double cx = sx + (ey * b2 - by * e2) / d;
+    double cy = sy + (bx * e2 - ex * b2) / d;
+    double r = hypot(sx - cx, sy - cy);
+    int dir = d > 0 ? 1 : -1;
+
+    double th_prev = atan2(sy - cy, sx - cx);
+    double sweep = 0;
+    for(unsigned int i=0; i <= chained_points.size(); i++) {
+        double px = i < chained_points.size() ? chained_points[i].x : x;
+        double py = i < chained_points.size() ? chained_points[i].y : y;
+        if(fabs(hypot(px - cx, py - cy) - r) > tol) return false;
+
+        double th = atan2(py - cy, px - cx);
+        double dth = th - th_prev;
+        if(dth > M_PI) dth -= 2*M_PI;
+        if(dth < -M_PI) dth += 2*M_PI;
+        if(dth * dir <= 0) return false;
+        if(r * (1 - cos(dth / 2)) > tol) return false;
+        sweep += dth;
+        th_prev = th;
+    }
+    if(fabs(sweep) >= 2*M_PI - 1e-6) return false;
+
+    chained_arc.active = true;
+    chained_arc.cx = cx;
+    chained_arc.cy = cy;
+    chained_arc.r = r;
+    chained_arc.sweep = sweep;
+    return true;
+}
+
 static void
 see_segment(int line_number,
 	    double x, double y, double z, 
@@ -939,8 +1168,12 @@ see_segment(int line_number,
         || (v != canon.endPoint.v)
         || (w != canon.endPoint.w);
 
-    if(!chained_points.empty() && !linkable(x, y, z, a, b, c, u, v, w)) {
-        flush_segments();
+    if(!chained_points.empty()) {
+        if(linkable(x, y, z, a, b, c, u, v, w)) {
+            chained_arc.active = false;
+        } else if(!arc_linkable(x, y, z, a, b, c, u, v, w)) {
+            flush_segments();
+        }
     }
     pt pos = {x, y, z, a, b, c, u, v, w, line_number};
     chained_points.push_back(pos);
@@ -990,6 +1223,7 @@ void STRAIGHT_TRAVERSE(int line_number,
 
     if(vel && acc)  {
         interp_list.set_line_number(line_number);
+        send_term_cond();
         interp_list.append(linearMoveMsg);
     }
 
@@ -1044,6 +1278,7 @@ void RIGID_TAP(int line_number, double x, double y, double z)
 
     if(ini_maxvel && acc)  {
         interp_list.set_line_number(line_number);
+        send_term_cond();
         interp_list.append(rigidTapMsg);
     }
 
@@ -1101,6 +1336,7 @@ void STRAIGHT_PROBE(int line_number,
 
     if(vel && acc)  {
         interp_list.set_line_number(line_number);
+        send_term_cond();
         interp_list.append(probeMsg);
     }
     canonUpdateEndPoint(x, y, z, a, b, c, u, v, w);
@@ -1110,29 +1346,11 @@ void STRAIGHT_PROBE(int line_number,
 
 void SET_MOTION_CONTROL_MODE(CANON_MOTION_MODE mode, double tolerance)
 {
-    EMC_TRAJ_SET_TERM_COND setTermCondMsg;
-
     flush_segments();
 
     canon.motionMode = mode;
     canon.motionTolerance =  FROM_PROG_LEN(tolerance);
-
-    switch (mode) {
-    case CANON_CONTINUOUS:
-        setTermCondMsg.cond = EMC_TRAJ_TERM_COND_BLEND;
-        setTermCondMsg.tolerance = TO_EXT_LEN(canon.motionTolerance);
-        break;
-    case CANON_EXACT_PATH:
-        setTermCondMsg.cond = EMC_TRAJ_TERM_COND_EXACT;
-        break;
-
-    case CANON_EXACT_STOP:
-    default:
-        setTermCondMsg.cond = EMC_TRAJ_TERM_COND_STOP;
-        break;
-    }
-
-    interp_list.append(setTermCondMsg);
+    term_cond_pending = true;
 }
 
 void SET_NAIVECAM_TOLERANCE(double tolerance)
@@ -1724,6 +1942,7 @@ void ARC_FEED(int line_number,
         linearMoveMsg.indexrotary = -1;
         if(vel && a_max){
             interp_list.set_line_number(line_number);
+            send_term_cond();
             interp_list.append(linearMoveMsg);
         }
     } else {
@@ -1750,6 +1969,7 @@ void ARC_FEED(int line_number,
         // seems to be a crude way to indicate a zero length segment?
         if(vel && a_max) {
             interp_list.set_line_number(line_number);
+            send_term_cond();
             interp_list.append(circularMoveMsg);
         }
     }
@@ -2023,8 +2243,10 @@ void CHANGE_TOOL(int slot)
 	if(canon.feed_mode)
 	    STOP_SPEED_FEED_SYNCH();
 
-        if(vel && acc) 
+        if(vel && acc) {
+            send_term_cond();
             interp_list.append(linearMoveMsg);
+        }
 
 	if(old_feed_mode)
 	    START_SPEED_FEED_SYNCH(canon.linearFeedRate, 1);
@@ -2440,6 +2662,7 @@ void INIT_CANON()
     double units;
 
     chained_points.clear();
+    chained_arc.active = false;
 
     // initialize locals to original values
     canon.xy_rotation = 0.0;
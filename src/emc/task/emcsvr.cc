@@ -29,6 +29,7 @@
 #include "nml_oi.hh"
 #include "timer.hh"
 #include "nml_srv.hh"           // run_nml_servers()
+#include "cms_cfg.hh"		// load_nml_config_file()
 
 static int tool_channels = 1;
 
@@ -118,6 +119,10 @@ int main(int argc, char *argv[])
     rcs_print("after iniLoad()\n");
 
 
+    // every channel is looked up in the same file, so read it once
+    // rather than again for each of them
+    load_nml_config_file(emc_nmlfile);
+
     start_time = etime();
 
     while (fabs(etime() - start_time) < 10.0 &&
@@ -176,7 +181,7 @@ int main(int argc, char *argv[])
 		toolStatusChannel = NULL;
 	    }
 	}
-	esleep(0.200);
+	esleep_retry(etime() - start_time, 0.200);
     }
 
     set_rcs_print_destination(RCS_PRINT_TO_STDERR);
@@ -207,6 +212,10 @@ int main(int argc, char *argv[])
 				     emc_nmlfile);
 	}
     }
+    unload_nml_config_file(emc_nmlfile);
+
+    // the parent exits, and so the linuxcnc script goes on to start the
+    // clients, only once the channels exist
     daemonize();
     run_nml_servers();
 
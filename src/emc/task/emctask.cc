@@ -19,6 +19,8 @@
 #include <unistd.h>		// stat()
 #include <limits.h>		// PATH_MAX
 #include <dlfcn.h>
+#include <map>
+#include <string>
 
 #include "rcs.hh"		// INIFILE
 #include "emc.hh"		// EMC NML
@@ -47,6 +49,12 @@ InterpBase *pinterp=0;
 #define interp (*pinterp)
 setup_pointer _is = 0; // helper for gdb hardware watchpoints FIXME
 
+// lines between run-from-line checkpoints, doubled whenever there are
+// CHECKPOINT_MAX of them
+#define CHECKPOINT_INTERVAL 200
+#define CHECKPOINT_MAX 256
+static int checkpoint_recording = 0;
+
 
 /*
   format string for user-defined programs, e.g., "programs/M1%02d" means
@@ -610,9 +618,142 @@ int emcTaskPlanClose()
     }
 
     taskplanopen = 0;
+    checkpoint_recording = 0;
     return retval;
 }
 
+/*
+  Checkpoints for run-from-line ([TASK] RUN_FROM_CHECKPOINTS).  While a
+  program runs from the RUN command, the interpreter and canon state is
+  saved every checkpoint_interval lines of the main program.  A later run
+  of the same file from line n then restores the last checkpoint before
+  it and reads only the lines after that in skip mode, instead of all of
+  them.  The checkpoints are only used when the file, the tool table and
+  the modal state at the start of the run are as they were in the run
+  that took them; anything else starts over.
+*/
+struct task_checkpoint {
+    InterpCheckpoint *state;
+    CanonConfig_t canon;
+};
+typedef std::map<int, task_checkpoint> task_checkpoint_map;
+
+static task_checkpoint_map checkpoints;		// by line read
+static InterpCheckpoint *checkpoint_start;	// state the runs began in
+static CANON_TOOL_TABLE checkpoint_tools[CANON_POCKETS_MAX];
+static std::string checkpoint_file;
+static struct stat checkpoint_stat;
+static int checkpoint_interval = CHECKPOINT_INTERVAL;
+static int checkpoint_last;
+
+static void free_checkpoints()
+{
+    for (task_checkpoint_map::iterator it = checkpoints.begin();
+	 it != checkpoints.end(); ++it) {
+	delete it->second.state;
+    }
+    checkpoints.clear();
+    delete checkpoint_start;
+    checkpoint_start = 0;
+    checkpoint_interval = CHECKPOINT_INTERVAL;
+}
+
+static bool same_tool(const CANON_TOOL_TABLE &a, const CANON_TOOL_TABLE &b)
+{
+    return a.toolno == b.toolno
+	&& !memcmp(&a.offset, &b.offset, sizeof(a.offset))
+	&& a.diameter == b.diameter && a.frontangle == b.frontangle
+	&& a.backangle == b.backangle && a.orientation == b.orientation;
+}
+
+// Called when a run starts, before any line is read.  Returns the line
+// the run resumes after: the one of the restored checkpoint, or 0.
+int emcTaskPlanStartRun(const char *file, int line)
+{
+    checkpoint_recording = 0;
+    if (!emc_task_run_checkpoints || !_is || interp.line() != 0) {
+	return 0;
+    }
+    struct stat st;
+    InterpCheckpoint *start = interp.checkpoint();
+    if (!start || stat(file, &st) != 0) {
+	delete start;
+	return 0;
+    }
+
+    bool same = checkpoint_start && checkpoint_file == file
+	&& st.st_mtime == checkpoint_stat.st_mtime
+	&& st.st_size == checkpoint_stat.st_size
+	&& st.st_ino == checkpoint_stat.st_ino
+	&& interp.same_modes(checkpoint_start, start);
+    for (int i = 0; same && i < CANON_POCKETS_MAX; i++) {
+	same = same_tool(checkpoint_tools[i], _is->tool_table[i]);
+    }
+    if (same) {
+	delete start;
+    } else {
+	free_checkpoints();
+	checkpoint_start = start;
+	checkpoint_file = file;
+	checkpoint_stat = st;
+	memcpy(checkpoint_tools, _is->tool_table, sizeof(checkpoint_tools));
+    }
+    checkpoint_recording = 1;
+    checkpoint_last = 0;
+
+    // the line before 'line' is still read in skip mode, which ends it
+    task_checkpoint_map::iterator it = checkpoints.upper_bound(line - 2);
+    if (line < 2 || it == checkpoints.begin()) {
+	return 0;
+    }
+    --it;
+    if (!interp.restore(it->second.state)) {
+	return 0;
+    }
+    CANON_RESTORE_STATE(&it->second.canon);
+    checkpoint_last = it->first;
+    if (emc_debug & EMC_DEBUG_INTERP) {
+	rcs_print("emcTaskPlanStartRun(%s, %d) resumed after line %d\n",
+		  file, line, it->first);
+    }
+    return it->first;
+}
+
+// Called after each line of a run that emcTaskPlanStartRun started.
+void emcTaskPlanCheckpoint()
+{
+    if (!checkpoint_recording) return;
+    int line = interp.line();
+    if (line < checkpoint_last + checkpoint_interval) return;
+    if (checkpoints.count(line)) {
+	checkpoint_last = line;
+	return;
+    }
+
+    task_checkpoint cp;
+    if (!CANON_SAVE_STATE(&cp.canon)) return;
+    cp.state = interp.checkpoint();
+    if (!cp.state) return;
+    checkpoints[line] = cp;
+    checkpoint_last = line;
+
+    // keep every other one of a long program
+    if (checkpoints.size() >= CHECKPOINT_MAX) {
+	bool drop = false;
+	for (task_checkpoint_map::iterator it = checkpoints.begin();
+	     it != checkpoints.end();) {
+	    if (drop) {
+		delete it->second.state;
+		checkpoints.erase(it++);
+	    } else {
+		++it;
+	    }
+	    drop = !drop;
+	}
+	checkpoint_interval *= 2;
+    }
+}
+
 int emcTaskPlanReset()
 {
     int retval = interp.reset();
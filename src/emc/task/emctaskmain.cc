@@ -58,6 +58,7 @@
 #include <ctype.h>		// isspace()
 #include <libintl.h>
 #include <locale.h>
+#include <deque>
 #include "usrmotintf.h"
 
 
@@ -83,6 +84,7 @@ fpu_control_t __fpu_control = _FPU_IEEE & ~(_FPU_MASK_IM | _FPU_MASK_ZM | _FPU_M
 #include "taskclass.hh"
 #include "motion.h"             // EMCMOT_ORIENT_*
 #include "inihal.hh"
+#include "kinslimits.hh"
 
 static emcmot_config_t emcmotConfig;
 
@@ -96,6 +98,8 @@ static emcmot_config_t emcmotConfig;
 static RCS_CMD_CHANNEL *emcCommandBuffer = 0;
 static RCS_STAT_CHANNEL *emcStatusBuffer = 0;
 static NML *emcErrorBuffer = 0;
+// optional: the tool table, written only when it changes
+static RCS_STAT_CHANNEL *emcToolTableBuffer = 0;
 
 // NML command channel data pointer
 static RCS_CMD_MSG *emcCommand = 0;
@@ -115,6 +119,13 @@ static int emcTaskNoDelay = 0;
 // this is set when transferring trajectory data from userspace to kernel
 // space, annd reset otherwise.
 static int emcTaskEager = 0;
+// flag signifying that between cycles task waits for something to happen
+// (a command, an iocontrol reply, a change in the motion status) rather
+// than for the rest of the cycle, from [TASK] EVENT_WAIT
+static int emcTaskEventWait = 0;
+// how often the motion status is looked at while waiting; motion can't
+// wake a user process, so it has to be polled
+#define EMC_TASK_EVENT_POLL 0.0002
 
 static int no_force_homing = 0; // forces the user to home first before allowing MDI and Program run
 //can be overriden by [TRAJ]NO_FORCE_HOMING=1
@@ -432,6 +443,10 @@ static int mdi_execute_wait = 0;
 // Side queue to store MDI commands
 static NML_INTERP_LIST mdi_execute_queue;
 
+// Line of an MDI batch that is executing, from 1; 0 if it isn't one.
+// Batch lines are numbered on mdi_execute_queue, other MDI commands are 0
+static int mdi_batch_line = 0;
+
 // MDI input queue
 static NML_INTERP_LIST mdi_input_queue;
 #define  MAX_MDI_QUEUE 10
@@ -485,12 +500,201 @@ static int checkInterpList(NML_INTERP_LIST * il, EMC_STAT * stat)
 }
 extern int emcTaskMopup();
 
+/*
+  With [TASK] INTERP_MAX_TIME the interpreter reads ahead until the
+  moves on interp_list and in the motion queue add up to that many
+  seconds, instead of until interp_list has INTERP_MAX_LEN entries.
+  The estimated time of each move issued to motion is kept here, oldest
+  first; motion only reports how many segments it has left, so the ones
+  before those are taken to be done.
+*/
+#define EMC_TASK_INTERP_TIME_MAX_LEN 20000 // bound on interp_list anyway
+static std::deque<double> motionMoveTimes;
+static double motionMoveTime;
+
+static void motionTimeIssued(double t)
+{
+    if (emc_task_interp_max_time <= 0 || t <= 0) {
+	return;
+    }
+    motionMoveTimes.push_back(t);
+    motionMoveTime += t;
+}
+
+static double motionTimeLeft(void)
+{
+    while (motionMoveTimes.size() > (size_t) emcStatus->motion.traj.queue) {
+	motionMoveTime -= motionMoveTimes.front();
+	motionMoveTimes.pop_front();
+    }
+    if (motionMoveTimes.empty()) {
+	motionMoveTime = 0;
+    }
+    return motionMoveTime;
+}
+
+// nonzero when the interpreter has read far enough ahead; 'part' is the
+// fraction of the limit to fill in one cycle
+static int readahead_full(double part)
+{
+    if (emc_task_interp_max_time <= 0) {
+	return interp_list.len() > emc_task_interp_max_len * part;
+    }
+    if (interp_list.len() > EMC_TASK_INTERP_TIME_MAX_LEN * part) {
+	return 1;
+    }
+    return interp_list.queued_time() + motionTimeLeft() >=
+	emc_task_interp_max_time * part;
+}
+
+/*
+  What task last saw of the command buffer, iocontrol and motion, for
+  emcTaskWaitForEvent().  They are noted before the command is read and
+  before the status is copied, so a change that comes in after those
+  but before the wait still ends it.
+*/
+static int eventCmdMsgs = -1;
+static int eventIoMsgs = -1;
+static int eventHaveHot;
+static emcmot_status_hot_t eventHot;
+
+static void emcTaskEventArmCommand(void)
+{
+    if (emcTaskEventWait) {
+	eventCmdMsgs = emcCommandBuffer->get_msg_count();
+    }
+}
+
+static void emcTaskEventArmStatus(void)
+{
+    if (emcTaskEventWait) {
+	eventIoMsgs = emcIoStatusMsgCount();
+	eventHaveHot = (0 == usrmotReadEmcmotStatusHot(&eventHot));
+    }
+}
+
+static int emcTaskEventSeen(void)
+{
+    emcmot_status_hot_t hot;
+
+    if (emcCommandBuffer->get_msg_count() != eventCmdMsgs) {
+	return 1;
+    }
+    if (eventIoMsgs != -1 && emcIoStatusMsgCount() != eventIoMsgs) {
+	return 1;
+    }
+    return eventHaveHot && 0 == usrmotReadEmcmotStatusHot(&hot) &&
+	(hot.motion_state != eventHot.motion_state ||
+	 hot.motionFlag != eventHot.motionFlag ||
+	 hot.id != eventHot.id ||
+	 hot.depth != eventHot.depth ||
+	 hot.queueFull != eventHot.queueFull ||
+	 hot.paused != eventHot.paused ||
+	 hot.commandNumEcho != eventHot.commandNumEcho ||
+	 hot.commandStatus != eventHot.commandStatus);
+}
+
+/*
+  Waits up to 'timeout' seconds for a new command, a status write from
+  iocontrol or a change in the motion state, queue or command echo.
+  When the command buffer keeps a write count ('notify' in the nml file)
+  task sleeps on it, and wakes within microseconds of a command being
+  written; otherwise it is polled along with the rest.  Returns 1 if
+  something happened, 0 on timeout.
+*/
+static int emcTaskWaitForEvent(double timeout)
+{
+    double end = etime() + timeout;
+    unsigned int cmdCount;
+    int haveCmdCount;
+
+    haveCmdCount = (0 != emcCommandBuffer->cms &&
+		    0 == emcCommandBuffer->cms->get_write_count(&cmdCount));
+    for (;;) {
+	if (emcTaskEventSeen()) {
+	    return 1;
+	}
+	double left = end - etime();
+	if (left <= 0.0) {
+	    return 0;
+	}
+	if (left > EMC_TASK_EVENT_POLL) {
+	    left = EMC_TASK_EVENT_POLL;
+	}
+	if (haveCmdCount) {
+	    if (emcCommandBuffer->cms->wait_for_write(cmdCount, left) > 0) {
+		return 1;
+	    }
+	} else {
+	    esleep(left);
+	}
+    }
+}
+
+/*
+  The tool table rarely changes, so it is not sent with every status.
+  Task keeps the copy it last wrote to the toolTable buffer, and when the
+  table from io differs from it, bumps toolTableSerial and writes it
+  again.  emcStatus then carries only the spindle pocket and the serial,
+  which readers compare to know when to read the buffer.  Without the
+  buffer the serial is still kept, and the whole table goes in emcStatus.
+*/
+static EMC_TOOL_TABLE_STAT emcToolTable;
+
+static int toolTableDiffers(const CANON_TOOL_TABLE *a,
+			    const CANON_TOOL_TABLE *b)
+{
+    for (int t = 0; t < CANON_POCKETS_MAX; t++) {
+	if (a[t].toolno != b[t].toolno ||
+	    a[t].diameter != b[t].diameter ||
+	    a[t].frontangle != b[t].frontangle ||
+	    a[t].backangle != b[t].backangle ||
+	    a[t].orientation != b[t].orientation ||
+	    a[t].offset.tran.x != b[t].offset.tran.x ||
+	    a[t].offset.tran.y != b[t].offset.tran.y ||
+	    a[t].offset.tran.z != b[t].offset.tran.z ||
+	    a[t].offset.a != b[t].offset.a ||
+	    a[t].offset.b != b[t].offset.b ||
+	    a[t].offset.c != b[t].offset.c ||
+	    a[t].offset.u != b[t].offset.u ||
+	    a[t].offset.v != b[t].offset.v ||
+	    a[t].offset.w != b[t].offset.w) {
+	    return 1;
+	}
+    }
+    return 0;
+}
+
+static void emcTaskToolTableUpdate(void)
+{
+    EMC_TOOL_STAT &tool = emcStatus->io.tool;
+    static int written = 0;
+
+    if (toolTableDiffers(emcToolTable.toolTable, tool.toolTable)) {
+	for (int t = 0; t < CANON_POCKETS_MAX; t++) {
+	    emcToolTable.toolTable[t] = tool.toolTable[t];
+	}
+	emcToolTable.toolTableSerial++;
+	written = 0;
+    }
+    tool.toolTableSerial = emcToolTable.toolTableSerial;
+    if (0 == emcToolTableBuffer) {
+	tool.toolTableLen = CANON_POCKETS_MAX;
+	return;
+    }
+    if (!written) {
+	emcToolTable.toolTableLen = CANON_POCKETS_MAX;
+	written = (0 == emcToolTableBuffer->write(&emcToolTable));
+    }
+    tool.toolTableLen = 1;
+}
+
 void readahead_reading(void)
 {
     int readRetval;
     int execRetval;
 
-		if (interp_list.len() <= emc_task_interp_max_len) {
+		if (!readahead_full(1.0)) {
                     int count = 0;
 interpret_again:
 		    if (emcTaskPlanIsWait()) {
@@ -559,6 +763,9 @@ interpret_again:
 			    } else {
 
 				// executed a good line
+				if (emcTaskPlanLevel() == 0) {
+				    emcTaskPlanCheckpoint();
+				}
 			    }
 
 			    // throw the results away if we're supposed to
@@ -610,7 +817,7 @@ interpret_again:
 
                             if (count++ < emc_task_interp_max_len
                                     && emcStatus->task.interpState == EMC_TASK_INTERP_READING
-                                    && interp_list.len() <= emc_task_interp_max_len * 2/3) {
+                                    && !readahead_full(2.0/3)) {
                                 goto interpret_again;
                             }
 
@@ -636,9 +843,64 @@ static void mdi_execute_abort(void)
     }
     mdi_execute_queue.clear();
 
+    // the rest of a batch won't run; the line it got to failed
+    if (emcStatus->task.mdiBatchError < 0 &&
+	emcStatus->task.mdiBatchDone < emcStatus->task.mdiBatchLines) {
+	emcStatus->task.mdiBatchError = emcStatus->task.mdiBatchDone;
+    }
+    mdi_batch_line = 0;
+
     emcStatus->task.interpState = EMC_TASK_INTERP_IDLE;
 }
 
+/*
+  Puts the lines of an MDI batch on the MDI queue, where they run one
+  after the other like MDI commands sent on their own.  They are numbered
+  from 1 on the queue so that mdi_execute_hook() can tell how far through
+  the batch it is: a line is done once the next one is taken off the
+  queue, or once everything it started has finished.
+*/
+static int mdi_queue_batch(EMC_TASK_PLAN_EXECUTE_BATCH *batch)
+{
+    EMC_TASK_PLAN_EXECUTE execute;
+    const char *line, *end = batch->commands + sizeof(batch->commands);
+    int n;
+
+    if (!all_homed() && !no_force_homing) {
+	emcOperatorError(0, _("Can't issue MDI command when not homed"));
+	return -1;
+    }
+    if (emcStatus->task.mdiBatchError < 0 &&
+	emcStatus->task.mdiBatchDone < emcStatus->task.mdiBatchLines) {
+	emcOperatorError(0, _("MDI batch sent before the last one finished"));
+	return -1;
+    }
+    // check it all before queueing any of it
+    line = batch->commands;
+    for (n = 0; n < batch->count; n++) {
+	size_t len = strnlen(line, end - line);
+	if (len == (size_t) (end - line) || len >= sizeof(execute.command)) {
+	    emcOperatorError(0, _("MDI batch line %d is too long"), n + 1);
+	    return -1;
+	}
+	line += len + 1;
+    }
+
+    emcStatus->task.mdiBatch = batch->serial_number;
+    emcStatus->task.mdiBatchLines = batch->count;
+    emcStatus->task.mdiBatchDone = 0;
+    emcStatus->task.mdiBatchError = -1;
+    line = batch->commands;
+    for (n = 0; n < batch->count; n++) {
+	strcpy(execute.command, line);
+	line += strlen(line) + 1;
+	mdi_execute_queue.set_line_number(n + 1);
+	mdi_execute_queue.append(execute);
+    }
+    mdi_execute_queue.set_line_number(0);
+    return 0;
+}
+
 static void mdi_execute_hook(void)
 {
     if (mdi_execute_wait && emcTaskPlanIsWait()) {
@@ -662,6 +924,11 @@ static void mdi_execute_hook(void)
         && (emcTaskCommand == NULL)
     ) {
 	interp_list.append(mdi_execute_queue.get());
+	mdi_batch_line = mdi_execute_queue.get_line_number();
+	if (mdi_batch_line > 0) {
+	    // the lines of the batch before this one are done
+	    emcStatus->task.mdiBatchDone = mdi_batch_line - 1;
+	}
 	return;
     }
 
@@ -681,11 +948,15 @@ static void mdi_execute_hook(void)
 		      emcStatus->task.command, mdi_input_queue.len());
 	emcStatus->task.command[0] = 0;
 	emcStatus->task.interpState = EMC_TASK_INTERP_IDLE;
+	if (mdi_batch_line > 0) {
+	    emcStatus->task.mdiBatchDone = mdi_batch_line;
+	    mdi_batch_line = 0;
+	}
     }
 
     if (!mdi_execute_next) return;
 
-    if (interp_list.len() > emc_task_interp_max_len) return;
+    if (readahead_full(1.0)) return;
 
     mdi_execute_next = 0;
 
@@ -810,6 +1081,7 @@ static int emcTaskPlan(void)
 	    case EMC_TASK_PLAN_SYNCH_TYPE:
 	    case EMC_TRAJ_CLEAR_PROBE_TRIPPED_FLAG_TYPE:
 	    case EMC_TRAJ_PROBE_TYPE:
+	    case EMC_TRAJ_PROBE_SEQUENCE_TYPE:
 	    case EMC_AUX_INPUT_WAIT_TYPE:
 	    case EMC_MOTION_SET_DOUT_TYPE:
 	    case EMC_MOTION_ADAPTIVE_TYPE:
@@ -930,6 +1202,7 @@ static int emcTaskPlan(void)
 	    case EMC_TASK_PLAN_OPTIONAL_STOP_TYPE:
 	    case EMC_TRAJ_CLEAR_PROBE_TRIPPED_FLAG_TYPE:
 	    case EMC_TRAJ_PROBE_TYPE:
+	    case EMC_TRAJ_PROBE_SEQUENCE_TYPE:
 	    case EMC_AUX_INPUT_WAIT_TYPE:
 	    case EMC_MOTION_SET_DOUT_TYPE:
 	    case EMC_MOTION_SET_AOUT_TYPE:
@@ -1036,6 +1309,7 @@ static int emcTaskPlan(void)
 		case EMC_TASK_PLAN_OPTIONAL_STOP_TYPE:
 		case EMC_TRAJ_CLEAR_PROBE_TRIPPED_FLAG_TYPE:
 		case EMC_TRAJ_PROBE_TYPE:
+		case EMC_TRAJ_PROBE_SEQUENCE_TYPE:
 		case EMC_AUX_INPUT_WAIT_TYPE:
 		case EMC_TRAJ_RIGID_TAP_TYPE:
 		case EMC_SET_DEBUG_TYPE:
@@ -1121,6 +1395,7 @@ static int emcTaskPlan(void)
 		case EMC_TASK_ABORT_TYPE:
 		case EMC_TRAJ_CLEAR_PROBE_TRIPPED_FLAG_TYPE:
 		case EMC_TRAJ_PROBE_TYPE:
+		case EMC_TRAJ_PROBE_SEQUENCE_TYPE:
 		case EMC_AUX_INPUT_WAIT_TYPE:
 		case EMC_TRAJ_RIGID_TAP_TYPE:
 		case EMC_SET_DEBUG_TYPE:
@@ -1205,6 +1480,7 @@ static int emcTaskPlan(void)
 		case EMC_TASK_PLAN_OPTIONAL_STOP_TYPE:
 		case EMC_TRAJ_CLEAR_PROBE_TRIPPED_FLAG_TYPE:
 		case EMC_TRAJ_PROBE_TYPE:
+		case EMC_TRAJ_PROBE_SEQUENCE_TYPE:
 		case EMC_AUX_INPUT_WAIT_TYPE:
 		case EMC_TRAJ_RIGID_TAP_TYPE:
 		case EMC_SET_DEBUG_TYPE:
@@ -1276,6 +1552,7 @@ static int emcTaskPlan(void)
 		case EMC_TASK_ABORT_TYPE:
 		case EMC_TRAJ_CLEAR_PROBE_TRIPPED_FLAG_TYPE:
 		case EMC_TRAJ_PROBE_TYPE:
+		case EMC_TRAJ_PROBE_SEQUENCE_TYPE:
 		case EMC_AUX_INPUT_WAIT_TYPE:
 	        case EMC_TRAJ_RIGID_TAP_TYPE:
 		case EMC_SET_DEBUG_TYPE:
@@ -1369,6 +1646,7 @@ static int emcTaskPlan(void)
 	    case EMC_TASK_ABORT_TYPE:
 	    case EMC_TRAJ_CLEAR_PROBE_TRIPPED_FLAG_TYPE:
 	    case EMC_TRAJ_PROBE_TYPE:
+	    case EMC_TRAJ_PROBE_SEQUENCE_TYPE:
 	    case EMC_AUX_INPUT_WAIT_TYPE:
 	    case EMC_MOTION_SET_DOUT_TYPE:
 	    case EMC_MOTION_SET_AOUT_TYPE:
@@ -1397,6 +1675,10 @@ static int emcTaskPlan(void)
                 }
                 break;
 
+	    case EMC_TASK_PLAN_EXECUTE_BATCH_TYPE:
+		retval = mdi_queue_batch((EMC_TASK_PLAN_EXECUTE_BATCH *) emcCommand);
+		break;
+
 	    case EMC_TOOL_LOAD_TOOL_TABLE_TYPE:
 	    case EMC_TOOL_SET_OFFSET_TYPE:
 		// send to IO
@@ -1462,6 +1744,7 @@ static int emcTaskCheckPreconditions(NMLmsg * cmd)
     case EMC_OPERATOR_DISPLAY_TYPE:
     case EMC_SYSTEM_CMD_TYPE:
     case EMC_TRAJ_PROBE_TYPE:	// prevent blending of this
+    case EMC_TRAJ_PROBE_SEQUENCE_TYPE:
     case EMC_TRAJ_RIGID_TAP_TYPE: //and this
     case EMC_TRAJ_CLEAR_PROBE_TRIPPED_FLAG_TYPE:	// and this
     case EMC_AUX_INPUT_WAIT_TYPE:
@@ -1874,6 +2157,17 @@ static int emcTaskIssueCommand(NMLmsg * cmd)
             ((EMC_TRAJ_PROBE *) cmd)->probe_type);
 	break;
 
+    case EMC_TRAJ_PROBE_SEQUENCE_TYPE:
+	retval = emcTrajProbeSequence(
+	    ((EMC_TRAJ_PROBE_SEQUENCE *) cmd)->count,
+	    ((EMC_TRAJ_PROBE_SEQUENCE *) cmd)->pos,
+	    ((EMC_TRAJ_PROBE_SEQUENCE *) cmd)->type,
+	    ((EMC_TRAJ_PROBE_SEQUENCE *) cmd)->vel,
+	    ((EMC_TRAJ_PROBE_SEQUENCE *) cmd)->ini_maxvel,
+	    ((EMC_TRAJ_PROBE_SEQUENCE *) cmd)->acc,
+	    ((EMC_TRAJ_PROBE_SEQUENCE *) cmd)->probe_type);
+	break;
+
     case EMC_AUX_INPUT_WAIT_TYPE:
 	emcAuxInputWaitMsg = (EMC_AUX_INPUT_WAIT *) cmd;
 	if (emcAuxInputWaitMsg->timeout == WAIT_MODE_IMMEDIATE) { //nothing to do, CANON will get the needed value when asked by the interp
@@ -2243,6 +2537,14 @@ static int emcTaskIssueCommand(NMLmsg * cmd)
 	}
 	run_msg = (EMC_TASK_PLAN_RUN *) cmd;
 	programStartLine = run_msg->line;
+	if (taskplanopen) {
+	    // skip the lines a checkpoint of an earlier run covers
+	    int resumed = emcTaskPlanStartRun(emcStatus->task.file,
+					      programStartLine);
+	    if (resumed > 0) {
+		emcStatus->task.readLine = resumed;
+	    }
+	}
 	emcStatus->task.interpState = EMC_TASK_INTERP_READING;
 	emcStatus->task.task_paused = 0;
 	retval = 0;
@@ -2378,6 +2680,7 @@ static int emcTaskCheckPostconditions(NMLmsg * cmd)
     case EMC_TRAJ_SET_G92_TYPE:
     case EMC_TRAJ_SET_ROTATION_TYPE:
     case EMC_TRAJ_PROBE_TYPE:
+    case EMC_TRAJ_PROBE_SEQUENCE_TYPE:
     case EMC_TRAJ_RIGID_TAP_TYPE:
     case EMC_TRAJ_CLEAR_PROBE_TRIPPED_FLAG_TYPE:
     case EMC_TRAJ_SET_TELEOP_ENABLE_TYPE:
@@ -2449,6 +2752,52 @@ static int emcTaskCheckPostconditions(NMLmsg * cmd)
     return EMC_TASK_EXEC_DONE; // unreached
 }
 
+static int emcTaskIsMove(NMLmsg * cmd)
+{
+    return cmd->type == EMC_TRAJ_LINEAR_MOVE_TYPE
+	|| cmd->type == EMC_TRAJ_CIRCULAR_MOVE_TYPE;
+}
+
+/*
+  Issues emcTaskCommand and, when it is a move, the moves right behind it
+  on interp_list, as many as motion can take before it reports its queue
+  again, in one write of the command ring.  Otherwise each one takes a
+  pass of the main loop.  Each is issued as if it had come through
+  emcTaskExecute() on its own, with its line as the motion id, and
+  emcTaskCommand is left at the last one.  Stepping goes a line at a time.
+*/
+static int emcTaskIssueMoves()
+{
+    int room = 0;
+    if (emcTaskIsMove(emcTaskCommand) && !stepping) {
+	room = emcTrajBatchRoom();
+    }
+    if (room < 2) {
+	return emcTaskIssueCommand(emcTaskCommand);
+    }
+
+    emcTrajBeginBatch();
+    int retval = emcTaskIssueCommand(emcTaskCommand);
+    for (int n = 1; retval == 0 && n < room; n++) {
+	NMLmsg *next = interp_list.peek();
+	// a move waits for IO, see emcTaskCheckPreconditions()
+	if (0 == next || !emcTaskIsMove(next)
+		|| emcStatus->io.status != RCS_DONE) {
+	    break;
+	}
+	motionTimeIssued(interp_list.get_duration());
+	emcTaskCommand = interp_list.get();
+	emcStatus->task.currentLine = interp_list.get_line_number();
+	emcStatus->task.callLevel = emcTaskPlanLevel();
+	emcTrajSetMotionId(emcStatus->task.currentLine);
+	retval = emcTaskIssueCommand(emcTaskCommand);
+    }
+    if (0 != emcTrajEndBatch()) {
+	retval = -1;
+    }
+    return retval;
+}
+
 /*
   STEPPING_CHECK() is a macro that prefaces a switch-case with a check
   for stepping. If stepping is active, it waits until the step has been
@@ -2556,13 +2905,15 @@ static int emcTaskExecute(void)
 		}
 	    } else {
 		// have an outstanding command
-		if (0 != emcTaskIssueCommand(emcTaskCommand)) {
+		if (0 != emcTaskIssueMoves()) {
 		    emcStatus->task.execState = EMC_TASK_EXEC_ERROR;
 		    retval = -1;
 		} else {
 		    emcStatus->task.execState = (enum EMC_TASK_EXEC_ENUM)
 			emcTaskCheckPostconditions(emcTaskCommand);
 		    emcTaskEager = 1;
+		    // it came from interp_list, so this is its duration
+		    motionTimeIssued(interp_list.get_duration());
 		}
 		emcTaskCommand = 0;	// reset it
 	    }
@@ -2799,7 +3150,7 @@ static int emctask_startup()
     int good;
 
 #define RETRY_TIME 10.0		// seconds to wait for subsystems to come up
-#define RETRY_INTERVAL 1.0	// seconds between wait tries for a subsystem
+#define RETRY_INTERVAL 1.0	// most seconds between wait tries for a subsystem
 
     // moved up so it can be exposed in taskmodule at init time
     // // get our status data structure
@@ -2823,8 +3174,7 @@ static int emctask_startup()
 	    good = 1;
 	    break;
 	}
-	esleep(RETRY_INTERVAL);
-	end -= RETRY_INTERVAL;
+	end -= esleep_retry(RETRY_TIME - end, RETRY_INTERVAL);
 	if (done) {
 	    emctask_shutdown();
 	    exit(1);
@@ -2857,8 +3207,7 @@ static int emctask_startup()
 	    good = 1;
 	    break;
 	}
-	esleep(RETRY_INTERVAL);
-	end -= RETRY_INTERVAL;
+	end -= esleep_retry(RETRY_TIME - end, RETRY_INTERVAL);
 	if (done) {
 	    emctask_shutdown();
 	    exit(1);
@@ -2887,8 +3236,7 @@ static int emctask_startup()
 	    good = 1;
 	    break;
 	}
-	esleep(RETRY_INTERVAL);
-	end -= RETRY_INTERVAL;
+	end -= esleep_retry(RETRY_TIME - end, RETRY_INTERVAL);
 	if (done) {
 	    emctask_shutdown();
 	    exit(1);
@@ -2900,6 +3248,19 @@ static int emctask_startup()
 	rcs_print_error("can't get emcError buffer\n");
 	return -1;
     }
+    // the toolTable buffer is optional: without it the whole table
+    // stays in emcStatus
+    if (!(emc_debug & EMC_DEBUG_NML)) {
+	set_rcs_print_destination(RCS_PRINT_TO_NULL);	// inhibit diag
+	// messages
+    }
+    emcToolTableBuffer =
+	new RCS_STAT_CHANNEL(emcFormat, "toolTable", "emc", emc_nmlfile);
+    set_rcs_print_destination(RCS_PRINT_TO_STDOUT);	// restore diag
+    if (!emcToolTableBuffer->valid()) {
+	delete emcToolTableBuffer;
+	emcToolTableBuffer = 0;
+    }
     // get the timer
     if (!emcTaskNoDelay) {
 	timer = new RCS_TIMER(emc_task_cycle_time, "", "");
@@ -2919,8 +3280,7 @@ static int emctask_startup()
 	    good = 1;
 	    break;
 	}
-	esleep(RETRY_INTERVAL);
-	end -= RETRY_INTERVAL;
+	end -= esleep_retry(RETRY_TIME - end, RETRY_INTERVAL);
 	if (done) {
 	    emctask_shutdown();
 	    exit(1);
@@ -2940,8 +3300,7 @@ static int emctask_startup()
 	    good = 1;
 	    break;
 	}
-	esleep(RETRY_INTERVAL);
-	end -= RETRY_INTERVAL;
+	end -= esleep_retry(RETRY_TIME - end, RETRY_INTERVAL);
 	if (done) {
 	    emctask_shutdown();
 	    exit(1);
@@ -2962,8 +3321,7 @@ static int emctask_startup()
 	    good = 1;
 	    break;
 	}
-	esleep(RETRY_INTERVAL);
-	end -= RETRY_INTERVAL;
+	end -= esleep_retry(RETRY_TIME - end, RETRY_INTERVAL);
 	if (done) {
 	    emctask_shutdown();
 	    exit(1);
@@ -2981,8 +3339,7 @@ static int emctask_startup()
 	    good = 1;
 	    break;
 	}
-	esleep(RETRY_INTERVAL);
-	end -= RETRY_INTERVAL;
+	end -= esleep_retry(RETRY_TIME - end, RETRY_INTERVAL);
 	if (done) {
 	    emctask_shutdown();
 	    exit(1);
@@ -3024,6 +3381,7 @@ static int emctask_shutdown(void)
 	emcMotionHalt();
 	emcIoHalt();
     }
+    kinsLimitsExit();
     // delete the timer
     if (0 != timer) {
 	delete timer;
@@ -3036,6 +3394,11 @@ static int emctask_shutdown(void)
 	emcErrorBuffer = 0;
     }
 
+    if (0 != emcToolTableBuffer) {
+	delete emcToolTableBuffer;
+	emcToolTableBuffer = 0;
+    }
+
     if (0 != emcStatusBuffer) {
 	delete emcStatusBuffer;
 	emcStatusBuffer = 0;
@@ -3106,6 +3469,24 @@ static int iniLoad(const char *filename)
 	// not found, use default
     }
 
+    emcTaskEventWait = 0;
+    if (NULL != (inistring = inifile.Find("EVENT_WAIT", "TASK"))) {
+	if (1 != sscanf(inistring, "%d", &emcTaskEventWait)) {
+	    emcTaskEventWait = 0;
+	    rcs_print("invalid [TASK] EVENT_WAIT in %s (%s); waiting out the cycle\n",
+		      filename, inistring);
+	}
+    }
+
+    if (NULL != (inistring = inifile.Find("INTERP_MAX_TIME", "TASK"))) {
+	if (1 != sscanf(inistring, "%lf", &emc_task_interp_max_time)
+		|| emc_task_interp_max_time < 0) {
+	    emc_task_interp_max_time = 0;
+	    rcs_print("invalid [TASK] INTERP_MAX_TIME in %s (%s); reading ahead by lines\n",
+		      filename, inistring);
+	}
+    }
+
     saveInt = emc_task_interp_max_len; //remember default or previously set value
     if (NULL != (inistring = inifile.Find("INTERP_MAX_LEN", "TASK"))) {
 	if (1 == sscanf(inistring, "%d", &emc_task_interp_max_len)) {
@@ -3117,6 +3498,36 @@ static int iniLoad(const char *filename)
 	}
     }
 
+    if (NULL != (inistring = inifile.Find("ARC_FITTING", "TASK"))) {
+	if (1 != sscanf(inistring, "%d", &emc_task_arc_fitting)) {
+	    emc_task_arc_fitting = 0;
+	    rcs_print("invalid [TASK] ARC_FITTING in %s (%s); disabling\n",
+		      filename, inistring);
+	}
+    }
+
+    if (NULL != (inistring = inifile.Find("KINS_LIMITS", "TASK"))) {
+	int kins_limits;
+	if (1 != sscanf(inistring, "%d", &kins_limits)) {
+	    rcs_print("invalid [TASK] KINS_LIMITS in %s (%s); disabling\n",
+		      filename, inistring);
+	} else if (kins_limits) {
+	    const char *kins = inifile.Find("KINEMATICS", "KINS");
+	    if (!kinsLimitsInit(kins)) {
+		rcs_print("[TASK] KINS_LIMITS in %s: no userspace copy of kinematics %s; disabling\n",
+			  filename, kins ? kins : "(none)");
+	    }
+	}
+    }
+
+    if (NULL != (inistring = inifile.Find("RUN_FROM_CHECKPOINTS", "TASK"))) {
+	if (1 != sscanf(inistring, "%d", &emc_task_run_checkpoints)) {
+	    emc_task_run_checkpoints = 0;
+	    rcs_print("invalid [TASK] RUN_FROM_CHECKPOINTS in %s (%s); disabling\n",
+		      filename, inistring);
+	}
+    }
+
     if (NULL != (inistring = inifile.Find("RS274NGC_STARTUP_CODE", "RS274NGC"))) {
 	// copy to global
 	strcpy(rs274ngc_startup_code, inistring);
@@ -3223,6 +3634,9 @@ int main(int argc, char *argv[])
 
     // set print destination to stdout, for console apps
     set_rcs_print_destination(RCS_PRINT_TO_STDOUT);
+    // and write it from a thread, so debug output doesn't hold up the
+    // task cycle
+    set_rcs_print_async(1);
     // process command line args
     if (0 != emcGetArgs(argc, argv)) {
 	rcs_print_error("error in argument list\n");
@@ -3300,6 +3714,7 @@ int main(int argc, char *argv[])
         static int gave_soft_limit_message = 0;
         check_ini_hal_items(emcStatus->motion.traj.joints);
 	// read command
+	emcTaskEventArmCommand();
 	if (0 != emcCommandBuffer->read()) {
 	    // got a new command, so clear out errors
 	    taskPlanError = 0;
@@ -3314,6 +3729,7 @@ int main(int argc, char *argv[])
 	}
 	// update subordinate status
 
+	emcTaskEventArmStatus();
 	emcIoUpdate(&emcStatus->io);
 	emcMotionUpdate(&emcStatus->motion);
 	// synchronize subordinate states
@@ -3468,6 +3884,8 @@ int main(int argc, char *argv[])
 	    emcStatus->task.status = RCS_EXEC;
 	}
 
+	emcTaskToolTableUpdate();
+
 	// write it
 	// since emcStatus was passed to the WM init functions, it
 	// will be updated in the _update() functions above. There's
@@ -3494,6 +3912,13 @@ int main(int argc, char *argv[])
 
 	if ((emcTaskNoDelay) || (emcTaskEager)) {
 	    emcTaskEager = 0;
+	} else if (emcTaskEventWait) {
+	    // whatever woke us has to be seen on this cycle, not the next
+	    if (emcTaskWaitForEvent(emc_task_cycle_time)) {
+		emcTaskEventArmStatus();
+		emcIoUpdate(&emcStatus->io);
+		emcMotionUpdate(&emcStatus->motion);
+	    }
 	} else {
 	    timer->wait();
 	}
@@ -0,0 +1,177 @@
+/********************************************************************
+* Description: kinslimits.cc
+*   Joint velocity and acceleration limits of straight moves, through
+*   the userspace copies of the kinematics in previewkins.cc.
+*
+* License: GPL Version 2
+* System: Linux
+*
+********************************************************************/
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "rtapi.h"
+#include "hal.h"
+#include "hal_priv.h"
+#include "emcmotcfg.h"		// EMCMOT_MAX_JOINTS
+#include "rcs_print.hh"
+#include "previewkins.hh"
+#include "kinslimits.hh"
+
+// the intervals a move is split into; enough to catch a joint that
+// speeds up in the middle of a move that swings a rotary through a
+// singular orientation, without making queueing moves slow
+#define KINS_LIMITS_SAMPLES 16
+
+static const preview_kins *kins;
+static int comp_id = -1;
+
+// where the values of the geometry pins are, looked up again when
+// the HAL changes (hal_data->seq) since they were last looked up
+static hal_float_t *geometry[PREVIEW_KINS_MAX_PARAMS];
+static unsigned int geometry_seq;
+static bool geometry_found, geometry_looked_up;
+
+bool kinsLimitsInit(const char *kinematics)
+{
+    char name[HAL_NAME_LEN + 1];
+
+    if (!kinematics) {
+	return false;
+    }
+    // the module name, without its arguments
+    snprintf(name, sizeof(name), "%s", kinematics);
+    name[strcspn(name, " \t")] = '\0';
+    kins = find_preview_kins(name);
+    if (!kins) {
+	return false;
+    }
+    if (comp_id < 0) {
+	comp_id = hal_init("kinslimits");
+	if (comp_id < 0) {
+	    kins = NULL;
+	    return false;
+	}
+	hal_ready(comp_id);
+    }
+    geometry_looked_up = false;
+    return true;
+}
+
+void kinsLimitsExit(void)
+{
+    if (comp_id >= 0) {
+	hal_exit(comp_id);
+	comp_id = -1;
+    }
+    kins = NULL;
+}
+
+bool kinsLimitsActive(void)
+{
+    return kins != NULL;
+}
+
+static bool lookup_geometry(void)
+{
+    char name[HAL_NAME_LEN + 1];
+    unsigned int seq;
+    int tries, i;
+    bool found;
+
+    for (tries = 0; ; tries++) {
+	seq = halpr_read_begin(tries);
+	found = true;
+	for (i = 0; kins->params[i]; i++) {
+	    snprintf(name, sizeof(name), "%s.%s", kins->name, kins->params[i]);
+	    hal_pin_t *pin = halpr_find_pin_by_name(name);
+	    if (!pin || pin->type != HAL_FLOAT) {
+		found = false;
+		break;
+	    }
+	    if (pin->signal) {
+		hal_sig_t *sig = (hal_sig_t *) SHMPTR(pin->signal);
+		geometry[i] = (hal_float_t *) SHMPTR(sig->data_ptr);
+	    } else {
+		geometry[i] = &pin->dummysig.f;
+	    }
+	}
+	if (!halpr_read_retry(seq, tries)) {
+	    break;
+	}
+    }
+    if (!found && (!geometry_looked_up || geometry_found)) {
+	rcs_print("kinslimits: %s is not loaded, moves get no joint limits\n",
+		kins->name);
+    }
+    geometry_seq = seq;
+    geometry_found = found;
+    geometry_looked_up = true;
+    return found;
+}
+
+static bool read_geometry(double *params)
+{
+    int i;
+
+    if (!geometry_looked_up
+	    || __atomic_load_n(&hal_data->seq, __ATOMIC_ACQUIRE) != geometry_seq) {
+	lookup_geometry();
+    }
+    if (!geometry_found) {
+	return false;
+    }
+    for (i = 0; kins->params[i]; i++) {
+	params[i] = *geometry[i];
+    }
+    return true;
+}
+
+double kinsLimitsTime(const double *start, const double *end,
+	const double *joint_limit, int joints)
+{
+    double params[PREVIEW_KINS_MAX_PARAMS];
+    double q[EMCMOT_MAX_JOINTS], last[EMCMOT_MAX_JOINTS];
+    double p[9], t = 0.0;
+    EmcPose pos;
+    int k, i, j;
+
+    if (!kins || !read_geometry(params)) {
+	return 0.0;
+    }
+    if (joints > EMCMOT_MAX_JOINTS) {
+	joints = EMCMOT_MAX_JOINTS;
+    }
+    kins->set_geometry(params);
+    for (k = 0; k <= KINS_LIMITS_SAMPLES; k++) {
+	double f = (double) k / KINS_LIMITS_SAMPLES;
+
+	for (i = 0; i < 9; i++) {
+	    p[i] = start[i] + (end[i] - start[i]) * f;
+	}
+	pos.tran.x = p[0];
+	pos.tran.y = p[1];
+	pos.tran.z = p[2];
+	pos.a = p[3];
+	pos.b = p[4];
+	pos.c = p[5];
+	pos.u = p[6];
+	pos.v = p[7];
+	pos.w = p[8];
+	memset(q, 0, sizeof(q));
+	if (kins->inverse(&pos, q)) {
+	    return 0.0;
+	}
+	for (j = 0; k > 0 && j < joints; j++) {
+	    if (joint_limit[j] > 0.0) {
+		// the change in the interval is 1/SAMPLES of the move
+		t = fmax(t, fabs(q[j] - last[j]) * KINS_LIMITS_SAMPLES
+			/ joint_limit[j]);
+	    }
+	}
+	memcpy(last, q, sizeof(q));
+    }
+    return t;
+}
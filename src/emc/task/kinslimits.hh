@@ -0,0 +1,34 @@
+/********************************************************************
+* Description: kinslimits.hh
+*   Joint velocity and acceleration limits of straight moves, for
+*   the kinematics task has a userspace copy of (see previewkins.hh),
+*   so the moves canon queues are only as slow as the joints need.
+*
+* License: GPL Version 2
+* System: Linux
+*
+********************************************************************/
+#ifndef KINSLIMITS_HH
+#define KINSLIMITS_HH
+
+// Turns the limits on for the kinematics module 'kinematics', as
+// [KINS]KINEMATICS names it.  Its geometry is read from the module's
+// HAL pins whenever a move is looked at.  Returns false if task has no
+// copy of those kinematics or can't get at HAL, and the limits stay off.
+extern bool kinsLimitsInit(const char *kinematics);
+
+extern void kinsLimitsExit(void);
+
+extern bool kinsLimitsActive(void);
+
+// The straight move from start to end (x y z a b c u v w in the units
+// of the INI file) is sampled along its length, and each joint's
+// largest change per unit of the move, over joint_limit[joint], gives
+// the time the move takes with that joint at its limit.  Returns the
+// longest time over the joints, which is how getStraightVelocity() and
+// getStraightAcceleration() measure the axes, or 0 when the limits are
+// off, no joint with a limit moves, or a pose can't be reached.
+extern double kinsLimitsTime(const double *start, const double *end,
+	const double *joint_limit, int joints);
+
+#endif
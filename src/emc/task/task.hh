@@ -22,6 +22,7 @@ extern int steppingWait;
 extern int emcTaskQueueCommand(NMLmsg *cmd);
 extern int emcPluginCall(EMC_EXEC_PLUGIN_CALL *call_msg);
 extern int emcIoPluginCall(EMC_IO_PLUGIN_CALL *call_msg);
+extern int emcIoStatusMsgCount();
 extern int emcTaskOnce(const char *inifile);
 extern int emcRunHalFiles(const char *filename);
 
@@ -53,6 +54,8 @@ int emcTaskPlanReset();
 int emcTaskPlanLine();
 int emcTaskPlanLevel();
 int emcTaskPlanCommand(char *cmd);
+int emcTaskPlanStartRun(const char *file, int line);
+void emcTaskPlanCheckpoint();
 
 int emcTaskUpdate(EMC_TASK_STAT * stat);
 
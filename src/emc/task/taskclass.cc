@@ -347,10 +347,21 @@ int emcTaskOnce(const char *filename)
     }
  no_pytask:
     if (task_methods == NULL) {
-	if (emc_debug & EMC_DEBUG_PYTHON_TASK) {
-	    rcs_print("emcTaskOnce: no Python Task() instance available, using default iocontrol-based task methods\n");
+	IniFile inifile;
+	const char *io = NULL;
+
+	if (inifile.Open(filename)) {
+	    io = inifile.Find("EMCIO", "EMCIO");
+	}
+	if (io != NULL && !strcmp(io, "internal")) {
+	    // run the iocontrol logic in task instead of the io process
+	    task_methods = new InternalIoTask();
+	} else {
+	    if (emc_debug & EMC_DEBUG_PYTHON_TASK) {
+		rcs_print("emcTaskOnce: no Python Task() instance available, using default iocontrol-based task methods\n");
+	    }
+	    task_methods = new Task();
 	}
-	task_methods = new Task();
     }
     return 0;
 }
@@ -448,14 +459,16 @@ struct _inittab builtin_modules[] = {
 
 
 
-Task::Task() : use_iocontrol(0), random_toolchanger(0) {
+Task::Task() : use_iocontrol(0), internal_io(0), random_toolchanger(0) {
 
     IniFile inifile;
 
     ini_filename = emc_inifile;
 
     if (inifile.Open(ini_filename)) {
-	use_iocontrol = (inifile.Find("EMCIO", "EMCIO") != NULL);
+	const char *io = inifile.Find("EMCIO", "EMCIO");
+	internal_io = (io != NULL && !strcmp(io, "internal"));
+	use_iocontrol = (io != NULL && !internal_io);
 	inifile.Find(&random_toolchanger, "RANDOM_TOOLCHANGER", "EMCIO");
 	const char *t;
 	if ((t = inifile.Find("TOOL_TABLE", "EMCIO")) != NULL)
@@ -741,6 +754,16 @@ int Task::emcIoUpdate(EMC_IO_STAT * stat)
     return 0;
 }
 
+// The number of times iocontrol has written its status, so a reply can
+// be noticed without copying it; -1 when there is no iocontrol
+int emcIoStatusMsgCount()
+{
+    if (0 == emcIoStatusBuffer || !emcIoStatusBuffer->valid()) {
+	return -1;
+    }
+    return emcIoStatusBuffer->get_msg_count();
+}
+
 int Task::emcIoPluginCall(int len, const char *msg)
 {
     if (emc_debug & EMC_DEBUG_PYTHON_TASK) {
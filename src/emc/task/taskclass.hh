@@ -53,14 +53,61 @@ public:
     virtual int emcIoPluginCall(int len, const char *msg);
 
     int use_iocontrol;
+    int internal_io;		// [EMCIO]EMCIO = internal
     int random_toolchanger;
     const char *ini_filename;
     const char *tooltable_filename;
-private:
+protected:
 
     char *ttcomments[CANON_POCKETS_MAX];
 };
 
+// the iocontrol logic run inside task with [EMCIO]EMCIO = internal: the
+// same iocontrol.0 HAL pins, driven from task's own HAL component instead
+// of through NML to the io process
+class InternalIoTask : public Task {
+public:
+    InternalIoTask();
+    virtual ~InternalIoTask();
+
+    virtual int emcIoInit();
+    virtual int emcIoHalt();
+    virtual int emcIoAbort(int reason);
+    virtual int emcToolStartChange();
+    virtual int emcAuxEstopOn();
+    virtual int emcAuxEstopOff();
+    virtual int emcCoolantMistOn();
+    virtual int emcCoolantMistOff();
+    virtual int emcCoolantFloodOn();
+    virtual int emcCoolantFloodOff();
+    virtual int emcLubeOn();
+    virtual int emcLubeOff();
+    virtual int emcIoSetDebug(int debug);
+    virtual int emcToolSetOffset(int pocket, int toolno, EmcPose offset, double diameter,
+				 double frontangle, double backangle, int orientation);
+    virtual int emcToolPrepare(int p, int tool);
+    virtual int emcToolLoad();
+    virtual int emcToolLoadToolTable(const char *file);
+    virtual int emcToolUnload();
+    virtual int emcToolSetNumber(int number);
+    virtual int emcIoUpdate(EMC_IO_STAT * stat);
+
+private:
+    int halInit();
+    void halInitPins();
+    void startPrepare(int p);
+    int startChange();
+    void loadTool(int pocket);
+    void reloadToolNumber(int toolno);
+
+    struct iocontrol_pins *pins;
+    int comp_id;
+    int fms[CANON_POCKETS_MAX];
+    int prep_index;		// pocket being prepared
+    int tool_prep_pipeline;	// [EMCIO]TOOL_PREP_PIPELINE
+    int deferred_load;		// tool change waiting for a pipelined prepare
+};
+
 extern Task *task_methods;
 
 #endif
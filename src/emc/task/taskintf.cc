@@ -74,6 +74,44 @@ static struct AxisConfig_t AxisConfig[EMCMOT_MAX_AXIS];
 
 static emcmot_command_t emcmotCommand;
 
+/*
+  While a settings batch is open the joint, axis and trajectory settings
+  collect here and go to motion in one write of the command ring at
+  emcEndSettings(), which waits for motion to have handled them all,
+  rather than each waiting for its own echo.
+*/
+static emcmot_command_t settingsBatch[EMCMOT_COMMAND_RING_SIZE];
+static int settingsBatchLen = -1;	// -1 when no batch is open
+
+static int writeSetting()
+{
+    if (settingsBatchLen < 0) {
+	return usrmotWriteEmcmotCommand(&emcmotCommand);
+    }
+    if (settingsBatchLen == EMCMOT_COMMAND_RING_SIZE) {
+	int retval = usrmotWriteEmcmotSettings(settingsBatch, settingsBatchLen);
+	settingsBatchLen = 0;
+	if (retval != 0) {
+	    return retval;
+	}
+    }
+    settingsBatch[settingsBatchLen++] = emcmotCommand;
+    return 0;
+}
+
+int emcBeginSettings()
+{
+    settingsBatchLen = 0;
+    return 0;
+}
+
+int emcEndSettings()
+{
+    int n = settingsBatchLen;
+    settingsBatchLen = -1;
+    return usrmotWriteEmcmotSettings(settingsBatch, n);
+}
+
 __attribute__ ((unused))
 static int emcmotIoInited = 0;	// non-zero means io called init
 static int emcmotion_initialized = 0;	// non-zero means both
@@ -141,7 +179,7 @@ int emcJointSetBacklash(int joint, double backlash)
     emcmotCommand.joint = joint;
     emcmotCommand.backlash = backlash;
 
-    int retval = usrmotWriteEmcmotCommand(&emcmotCommand);
+    int retval = writeSetting();
 
     if (emc_debug & EMC_DEBUG_CONFIG) {
         rcs_print("%s(%d, %.4f) returned %d\n", __FUNCTION__, joint, backlash, retval);
@@ -169,7 +207,7 @@ int emcJointSetMinPositionLimit(int joint, double limit)
     emcmotCommand.minLimit = JointConfig[joint].MinLimit;
     emcmotCommand.maxLimit = JointConfig[joint].MaxLimit;
 
-    int retval = usrmotWriteEmcmotCommand(&emcmotCommand);
+    int retval = writeSetting();
 
     if (emc_debug & EMC_DEBUG_CONFIG) {
         rcs_print("%s(%d, %.4f) returned %d\n", __FUNCTION__, joint, limit, retval);
@@ -197,7 +235,7 @@ int emcJointSetMaxPositionLimit(int joint, double limit)
     emcmotCommand.minLimit = JointConfig[joint].MinLimit;
     emcmotCommand.maxLimit = JointConfig[joint].MaxLimit;
 
-    int retval = usrmotWriteEmcmotCommand(&emcmotCommand);
+    int retval = writeSetting();
 
     if (emc_debug & EMC_DEBUG_CONFIG) {
         rcs_print("%s(%d, %.4f) returned %d\n", __FUNCTION__, joint, limit, retval);
@@ -246,7 +284,7 @@ int emcJointSetFerror(int joint, double ferror)
     emcmotCommand.joint = joint;
     emcmotCommand.maxFerror = ferror;
 
-    int retval = usrmotWriteEmcmotCommand(&emcmotCommand);
+    int retval = writeSetting();
 
     if (emc_debug & EMC_DEBUG_CONFIG) {
         rcs_print("%s(%d, %.4f) returned %d\n", __FUNCTION__, joint, ferror, retval);
@@ -270,7 +308,7 @@ int emcJointSetMinFerror(int joint, double ferror)
     emcmotCommand.joint = joint;
     emcmotCommand.minFerror = ferror;
 
-    int retval = usrmotWriteEmcmotCommand(&emcmotCommand);
+    int retval = writeSetting();
 
     if (emc_debug & EMC_DEBUG_CONFIG) {
         rcs_print("%s(%d, %.4f) returned %d\n", __FUNCTION__, joint, ferror, retval);
@@ -356,7 +394,7 @@ int emcJointUpdateHomingParams(int joint, double home, double offset)
     emcmotCommand.home = home;
     emcmotCommand.offset = offset;
 
-    int retval = usrmotWriteEmcmotCommand(&emcmotCommand);
+    int retval = writeSetting();
 
     if (emc_debug & EMC_DEBUG_CONFIG) {
         rcs_print("%s(%d, %.4f, %.4f) returned %d\n",
@@ -383,7 +421,7 @@ int emcJointSetMaxVelocity(int joint, double vel)
     emcmotCommand.joint = joint;
     emcmotCommand.vel = vel;
     
-    int retval = usrmotWriteEmcmotCommand(&emcmotCommand);
+    int retval = writeSetting();
 
     if (emc_debug & EMC_DEBUG_CONFIG) {
         rcs_print("%s(%d, %.4f) returned %d\n", __FUNCTION__, joint, vel, retval);
@@ -407,7 +445,7 @@ int emcJointSetMaxAcceleration(int joint, double acc)
     emcmotCommand.joint = joint;
     emcmotCommand.acc = acc;
     
-    int retval = usrmotWriteEmcmotCommand(&emcmotCommand);
+    int retval = writeSetting();
 
     if (emc_debug & EMC_DEBUG_CONFIG) {
         rcs_print("%s(%d, %.4f) returned %d\n", __FUNCTION__, joint, acc, retval);
@@ -415,6 +453,24 @@ int emcJointSetMaxAcceleration(int joint, double acc)
     return retval;
 }
 
+double emcJointGetMaxVelocity(int joint)
+{
+    if (joint < 0 || joint >= EMCMOT_MAX_JOINTS) {
+	return 0;
+    }
+
+    return JointConfig[joint].MaxVel;
+}
+
+double emcJointGetMaxAcceleration(int joint)
+{
+    if (joint < 0 || joint >= EMCMOT_MAX_JOINTS) {
+	return 0;
+    }
+
+    return JointConfig[joint].MaxAccel;
+}
+
 /*! functions involving carthesian Axes (X,Y,Z,A,B,C,U,V,W) */
     
 int emcAxisSetMinPositionLimit(int axis, double limit)
@@ -432,7 +488,7 @@ int emcAxisSetMinPositionLimit(int axis, double limit)
     emcmotCommand.minLimit = AxisConfig[axis].MinLimit;
     emcmotCommand.maxLimit = AxisConfig[axis].MaxLimit;
 
-    int retval = usrmotWriteEmcmotCommand(&emcmotCommand);
+    int retval = writeSetting();
 
     if (emc_debug & EMC_DEBUG_CONFIG) {
         rcs_print("%s(%d, %.4f) returned %d\n", __FUNCTION__, axis, limit, retval);
@@ -455,7 +511,7 @@ int emcAxisSetMaxPositionLimit(int axis, double limit)
     emcmotCommand.minLimit = AxisConfig[axis].MinLimit;
     emcmotCommand.maxLimit = AxisConfig[axis].MaxLimit;
 
-    int retval = usrmotWriteEmcmotCommand(&emcmotCommand);
+    int retval = writeSetting();
 
     if (emc_debug & EMC_DEBUG_CONFIG) {
         rcs_print("%s(%d, %.4f) returned %d\n", __FUNCTION__, axis, limit, retval);
@@ -480,7 +536,7 @@ int emcAxisSetMaxVelocity(int axis, double vel)
     emcmotCommand.command = EMCMOT_SET_AXIS_VEL_LIMIT;
     emcmotCommand.axis = axis;
     emcmotCommand.vel = vel;
-    int retval = usrmotWriteEmcmotCommand(&emcmotCommand);
+    int retval = writeSetting();
 
     if (emc_debug & EMC_DEBUG_CONFIG) {
         rcs_print("%s(%d, %.4f) returned %d\n", __FUNCTION__, axis, vel, retval);
@@ -505,7 +561,7 @@ int emcAxisSetMaxAcceleration(int axis, double acc)
     emcmotCommand.command = EMCMOT_SET_AXIS_ACC_LIMIT;
     emcmotCommand.axis = axis;
     emcmotCommand.acc = acc;
-    int retval = usrmotWriteEmcmotCommand(&emcmotCommand);
+    int retval = writeSetting();
 
     if (emc_debug & EMC_DEBUG_CONFIG) {
         rcs_print("%s(%d, %.4f) returned %d\n", __FUNCTION__, axis, acc, retval);
@@ -856,6 +912,11 @@ int emcJointLoadComp(int joint, const char *file, int type)
     return usrmotLoadComp(joint, file, type);
 }
 
+int emcTrajLoadVolComp(const char *file)
+{
+    return usrmotLoadVolComp(file);
+}
+
 static emcmot_config_t emcmotConfig;
 int get_emcmot_debug_info = 0;
 
@@ -865,6 +926,7 @@ int get_emcmot_debug_info = 0;
  */
 static emcmot_debug_t emcmotDebug;
 static char errorString[EMCMOT_ERROR_LEN];
+static unsigned int errorsDropped = 0;	// as last reported
 static int new_config = 0;
 
 /*! \todo FIXME - debugging - uncomment the following line to log changes in
@@ -1042,7 +1104,7 @@ int emcTrajSetVelocity(double vel, double ini_maxvel)
     emcmotCommand.vel = vel;
     emcmotCommand.ini_maxvel = ini_maxvel;
 
-    int retval = usrmotWriteEmcmotCommand(&emcmotCommand);
+    int retval = writeSetting();
 
     if (emc_debug & EMC_DEBUG_CONFIG) {
         rcs_print("%s(%.4f, %.4f) returned %d\n", __FUNCTION__, vel, ini_maxvel, retval);
@@ -1061,7 +1123,7 @@ int emcTrajSetAcceleration(double acc)
     emcmotCommand.command = EMCMOT_SET_ACC;
     emcmotCommand.acc = acc;
 
-    int retval = usrmotWriteEmcmotCommand(&emcmotCommand);
+    int retval = writeSetting();
 
     if (emc_debug & EMC_DEBUG_CONFIG) {
         rcs_print("%s(%.4f) returned %d\n", __FUNCTION__, acc, retval);
@@ -1084,7 +1146,7 @@ int emcTrajSetMaxVelocity(double vel)
     emcmotCommand.command = EMCMOT_SET_VEL_LIMIT;
     emcmotCommand.vel = vel;
 
-    int retval = usrmotWriteEmcmotCommand(&emcmotCommand);
+    int retval = writeSetting();
 
     if (emc_debug & EMC_DEBUG_CONFIG) {
         rcs_print("%s(%.4f) returned %d\n", __FUNCTION__, vel, retval);
@@ -1340,6 +1402,52 @@ int emcTrajSetTermCond(int cond, double tolerance)
     return usrmotWriteEmcmotCommand(&emcmotCommand);
 }
 
+/*
+  While a batch is open the moves collect here and go to motion in one
+  write of the command ring at emcTrajEndBatch().  The room is what the
+  ring can take on top of the commands motion hadn't handled when it last
+  reported its queue; one period's worth is kept back since that report
+  and the echo of the commands in it aren't written at the same time.
+*/
+static emcmot_command_t trajBatch[EMCMOT_COMMAND_RING_SIZE];
+static int trajBatchLen = -1;	// -1 when no batch is open
+
+static int trajWriteMove()
+{
+    if (trajBatchLen < 0) {
+	return usrmotWriteEmcmotCommand(&emcmotCommand);
+    }
+    if (trajBatchLen == EMCMOT_COMMAND_RING_SIZE) {
+	int retval = usrmotWriteEmcmotCommands(trajBatch, trajBatchLen);
+	trajBatchLen = 0;
+	if (retval != 0) {
+	    return retval;
+	}
+    }
+    trajBatch[trajBatchLen++] = emcmotCommand;
+    return 0;
+}
+
+int emcTrajBatchRoom()
+{
+    int room = EMCMOT_COMMAND_RING_SIZE - EMCMOT_COMMANDS_PER_PERIOD
+	- usrmotCommandsAhead(&emcmotStatus);
+    return room > 0 ? room : 0;
+}
+
+int emcTrajBeginBatch()
+{
+    trajBatchLen = 0;
+    return 0;
+}
+
+int emcTrajEndBatch()
+{
+    int n = trajBatchLen;
+    trajBatchLen = -1;
+    return usrmotWriteEmcmotCommands(trajBatch, n);
+}
+
 int emcTrajLinearMove(EmcPose end, int type, double vel, double ini_maxvel, double acc,
                       int indexrotary)
 {
@@ -1363,7 +1471,7 @@ int emcTrajLinearMove(EmcPose end, int type, double vel, double ini_maxvel, doub
     emcmotCommand.acc = acc;
     emcmotCommand.turn = indexrotary;
 
-    return usrmotWriteEmcmotCommand(&emcmotCommand);
+    return trajWriteMove();
 }
 
 int emcTrajCircularMove(EmcPose end, PM_CARTESIAN center,
@@ -1400,7 +1508,7 @@ int emcTrajCircularMove(EmcPose end, PM_CARTESIAN center,
     emcmotCommand.ini_maxvel = ini_maxvel;
     emcmotCommand.acc = acc;
 
-    return usrmotWriteEmcmotCommand(&emcmotCommand);
+    return trajWriteMove();
 }
 
 int emcTrajClearProbeTrippedFlag()
@@ -1433,6 +1541,47 @@ int emcTrajProbe(EmcPose pos, int type, double vel, double ini_maxvel, double ac
     return usrmotWriteEmcmotCommand(&emcmotCommand);
 }
 
+// loads the moves into motion, batched like queued moves, then starts
+// them; motion runs the whole sequence without waiting for task
+int emcTrajProbeSequence(int count, const EmcPose *pos, const int *type,
+                         const double *vel, const double *ini_maxvel,
+                         const double *acc, const unsigned char *probe_type)
+{
+    int retval;
+
+    if (count < 1 || count > EMCMOT_MAX_PROBE_STEPS) {
+	rcs_print_error("probe sequence of %d moves, need 1 to %d\n",
+			count, EMCMOT_MAX_PROBE_STEPS);
+	return -1;
+    }
+    // also drops moves left over from a sequence that never ran
+    if ((retval = emcTrajClearProbeTrippedFlag()) != 0) {
+	return retval;
+    }
+
+    emcTrajBeginBatch();
+    for (int i = 0; i < count; i++) {
+	emcmotCommand.command = EMCMOT_PROBE_SEQUENCE_ADD;
+	emcmotCommand.pos = pos[i];
+	emcmotCommand.id = TrajConfig.MotionId;
+	emcmotCommand.motion_type = type[i];
+	emcmotCommand.vel = vel[i];
+	emcmotCommand.ini_maxvel = ini_maxvel[i];
+	emcmotCommand.acc = acc[i];
+	emcmotCommand.probe_type = probe_type[i];
+	if ((retval = trajWriteMove()) != 0) {
+	    emcTrajEndBatch();
+	    return retval;
+	}
+    }
+    if ((retval = emcTrajEndBatch()) != 0) {
+	return retval;
+    }
+
+    emcmotCommand.command = EMCMOT_PROBE_SEQUENCE_RUN;
+    return usrmotWriteEmcmotCommand(&emcmotCommand);
+}
+
 int emcTrajRigidTap(EmcPose pos, double vel, double ini_maxvel, double acc)
 {
 #ifdef ISNAN_TRAP
@@ -1543,6 +1692,11 @@ int emcTrajUpdate(EMC_TRAJ_STAT * stat)
     }
 
     stat->probedPosition = emcmotStatus.probedPos;
+    stat->probedPointCount = emcmotStatus.probePointCount;
+    for (int i = 0; i < emcmotStatus.probePointCount; i++) {
+	stat->probedPoints[i] = emcmotStatus.probePoints[i];
+    }
+    stat->probedPointsTripped = emcmotStatus.probePointsTripped;
 
     stat->probeval = emcmotStatus.probeVal;
     stat->probing = emcmotStatus.probing;
@@ -1845,13 +1999,19 @@ int emcMotionUpdate(EMC_MOTION_STAT * stat)
 	    return -1;
 	}
     }
-    // read the emcmot error
-    if (0 != usrmotReadEmcmotError(errorString)) {
-	// no error, so ignore
-    } else {
-	// an error to report
+    // read the emcmot errors, a burst of them within a few cycles
+    for (int n = 0; n < EMCMOT_ERRORS_PER_UPDATE; n++) {
+	if (0 != usrmotReadEmcmotError(errorString)) {
+	    break;
+	}
 	emcOperatorError(0, "%s", errorString);
     }
+    unsigned int dropped = usrmotEmcmotErrorsDropped();
+    if (dropped != errorsDropped) {
+	emcOperatorError(0, "motion dropped %u error messages",
+			 dropped - errorsDropped);
+	errorsDropped = dropped;
+    }
 
     // save the heartbeat and command number locally,
     // for use with emcMotionUpdate
@@ -1919,6 +2079,7 @@ int emcMotionUpdate(EMC_MOTION_STAT * stat)
 int emcSetupArcBlends(int arcBlendEnable,
         int arcBlendFallbackEnable,
         int arcBlendOptDepth,
+        int arcBlendOptMode,
         int arcBlendGapCycles,
         double arcBlendRampFreq,
         double arcBlendTangentKinkRatio) {
@@ -1927,9 +2088,20 @@ int emcSetupArcBlends(int arcBlendEnable,
     emcmotCommand.arcBlendEnable = arcBlendEnable;
     emcmotCommand.arcBlendFallbackEnable = arcBlendFallbackEnable;
     emcmotCommand.arcBlendOptDepth = arcBlendOptDepth;
+    emcmotCommand.arcBlendOptMode = arcBlendOptMode;
     emcmotCommand.arcBlendGapCycles = arcBlendGapCycles;
     emcmotCommand.arcBlendRampFreq = arcBlendRampFreq;
     emcmotCommand.arcBlendTangentKinkRatio = arcBlendTangentKinkRatio;
+    return writeSetting();
+}
+
+int emcSetupPlanner(int plannerType, double maxJerk,
+        int rapidIndependent, double rapidClearance) {
+    emcmotCommand.command = EMCMOT_SETUP_PLANNER;
+    emcmotCommand.plannerType = plannerType;
+    emcmotCommand.maxJerk = maxJerk;
+    emcmotCommand.rapidIndependent = rapidIndependent;
+    emcmotCommand.rapidClearance = rapidClearance;
     return usrmotWriteEmcmotCommand(&emcmotCommand);
 }
 
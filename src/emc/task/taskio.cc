@@ -0,0 +1,459 @@
+/********************************************************************
+* Description: taskio.cc
+*   The iocontrol logic of ioControl.cc run inside task, selected with
+*   [EMCIO]EMCIO = internal.
+*
+*   Task calls these methods directly instead of sending NML to the io
+*   process and polling its status buffer, so M7/M8/M9, T and M6 take
+*   effect in the same task cycle.  The iocontrol.0 pins are exported
+*   by a HAL component owned by task; as they only exist once task has
+*   started, the HAL files that net them must be POSTTASK_HALFILEs.
+*
+* License: GPL Version 2
+* System: Linux
+*
+********************************************************************/
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "hal.h"
+#include "rtapi.h"
+#include "rcs_print.hh"
+#include "emc.hh"
+#include "emc_nml.hh"
+#include "emcglb.h"		// tool_table_file, emc_inifile
+#include "inifile.hh"
+#include "initool.hh"
+#include "tool_parse.h"
+#include "taskclass.hh"
+
+struct iocontrol_pins {
+    hal_bit_t *user_enable_out;	/* output, TRUE when EMC wants stop */
+    hal_bit_t *emc_enable_in;	/* input, TRUE on any external stop */
+    hal_bit_t *user_request_enable;	/* output, used to reset ENABLE latch */
+    hal_bit_t *coolant_mist;	/* coolant mist output pin */
+    hal_bit_t *coolant_flood;	/* coolant flood output pin */
+    hal_bit_t *lube;		/* lube output pin */
+    hal_bit_t *lube_level;	/* lube level input pin */
+    hal_bit_t *tool_prepare;	/* output, tells HAL to prepare a tool */
+    hal_s32_t *tool_prep_pocket;/* output, P word of the tool to be prepared */
+    hal_s32_t *tool_prep_number;/* output, tool number to be prepared */
+    hal_s32_t *tool_number;	/* output, tool number in the spindle */
+    hal_bit_t *tool_prepared;	/* input, the tool has been prepared */
+    hal_bit_t *tool_change;	/* output, a tool change should happen */
+    hal_bit_t *tool_changed;	/* input, the tool has been changed */
+};
+
+#define IO (emcStatus->io)
+
+InternalIoTask::InternalIoTask() : Task(), pins(0), comp_id(-1),
+				   prep_index(0), tool_prep_pipeline(0),
+				   deferred_load(0)
+{
+    IniFile inifile;
+
+    if (inifile.Open(ini_filename)) {
+	inifile.Find(&tool_prep_pipeline, "TOOL_PREP_PIPELINE", "EMCIO");
+    }
+    for (int i = 0; i < CANON_POCKETS_MAX; i++) {
+	fms[i] = 0;
+	ttcomments[i][0] = '\0';
+    }
+}
+
+InternalIoTask::~InternalIoTask() {}
+
+int InternalIoTask::halInit()
+{
+    int retval = 0;
+
+    comp_id = hal_init("iocontrol");
+    if (comp_id < 0) {
+	rcs_print_error("InternalIoTask: hal_init() failed\n");
+	return -1;
+    }
+    pins = (iocontrol_pins *) hal_malloc(sizeof(iocontrol_pins));
+    if (pins == 0) {
+	rcs_print_error("InternalIoTask: hal_malloc() failed\n");
+	hal_exit(comp_id);
+	comp_id = -1;
+	return -1;
+    }
+
+    retval |= hal_pin_bit_new("iocontrol.0.user-enable-out", HAL_OUT, &pins->user_enable_out, comp_id);
+    retval |= hal_pin_bit_new("iocontrol.0.emc-enable-in", HAL_IN, &pins->emc_enable_in, comp_id);
+    retval |= hal_pin_bit_new("iocontrol.0.user-request-enable", HAL_OUT, &pins->user_request_enable, comp_id);
+    retval |= hal_pin_bit_new("iocontrol.0.coolant-mist", HAL_OUT, &pins->coolant_mist, comp_id);
+    retval |= hal_pin_bit_new("iocontrol.0.coolant-flood", HAL_OUT, &pins->coolant_flood, comp_id);
+    retval |= hal_pin_bit_new("iocontrol.0.lube", HAL_OUT, &pins->lube, comp_id);
+    retval |= hal_pin_bit_new("iocontrol.0.lube_level", HAL_IN, &pins->lube_level, comp_id);
+    retval |= hal_pin_bit_new("iocontrol.0.tool-prepare", HAL_OUT, &pins->tool_prepare, comp_id);
+    retval |= hal_pin_s32_new("iocontrol.0.tool-prep-pocket", HAL_OUT, &pins->tool_prep_pocket, comp_id);
+    retval |= hal_pin_s32_new("iocontrol.0.tool-prep-number", HAL_OUT, &pins->tool_prep_number, comp_id);
+    retval |= hal_pin_s32_new("iocontrol.0.tool-number", HAL_OUT, &pins->tool_number, comp_id);
+    retval |= hal_pin_bit_new("iocontrol.0.tool-prepared", HAL_IN, &pins->tool_prepared, comp_id);
+    retval |= hal_pin_bit_new("iocontrol.0.tool-change", HAL_OUT, &pins->tool_change, comp_id);
+    retval |= hal_pin_bit_new("iocontrol.0.tool-changed", HAL_IN, &pins->tool_changed, comp_id);
+    if (retval < 0) {
+	rcs_print_error("InternalIoTask: exporting the iocontrol.0 pins failed\n");
+	hal_exit(comp_id);
+	comp_id = -1;
+	return -1;
+    }
+    hal_ready(comp_id);
+    return 0;
+}
+
+void InternalIoTask::halInitPins()
+{
+    *(pins->user_enable_out) = 0;
+    *(pins->user_request_enable) = 0;
+    *(pins->coolant_mist) = 0;
+    *(pins->coolant_flood) = 0;
+    *(pins->lube) = 0;
+    *(pins->tool_prepare) = 0;
+    *(pins->tool_prep_number) = 0;
+    *(pins->tool_prep_pocket) = 0;
+    *(pins->tool_change) = 0;
+    prep_index = 0;
+    deferred_load = 0;
+}
+
+int InternalIoTask::emcIoInit()
+{
+    if (0 != iniTool(emc_inifile)) {
+	return -1;
+    }
+    if (comp_id < 0 && 0 != halInit()) {
+	return -1;
+    }
+    halInitPins();
+
+    IO.aux.estop = 1;
+    IO.tool.pocketPrepped = -1;
+    IO.tool.toolInSpindle = 0;
+    IO.coolant.mist = 0;
+    IO.coolant.flood = 0;
+    IO.lube.on = 0;
+    IO.lube.level = 1;
+    IO.fault = 0;
+    IO.reason = 0;
+
+    // on nonrandom machines, always start by assuming the spindle is empty
+    if (!random_toolchanger) {
+	IO.tool.toolTable[0].toolno = -1;
+	ZERO_EMC_POSE(IO.tool.toolTable[0].offset);
+	IO.tool.toolTable[0].diameter = 0.0;
+	IO.tool.toolTable[0].frontangle = 0.0;
+	IO.tool.toolTable[0].backangle = 0.0;
+	IO.tool.toolTable[0].orientation = 0;
+	fms[0] = 0;
+	ttcomments[0][0] = '\0';
+    }
+    if (0 != loadToolTable(tool_table_file, IO.tool.toolTable,
+			   fms, ttcomments, random_toolchanger)) {
+	rcs_print_error("InternalIoTask: can't load tool table.\n");
+    }
+    *(pins->tool_number) = IO.tool.toolInSpindle;
+    IO.status = RCS_DONE;
+    return 0;
+}
+
+int InternalIoTask::emcIoHalt()
+{
+    if (comp_id >= 0) {
+	hal_exit(comp_id);
+	comp_id = -1;
+	pins = 0;
+    }
+    IO.status = RCS_DONE;
+    return 0;
+}
+
+int InternalIoTask::emcIoAbort(int reason)
+{
+    IO.coolant.mist = 0;
+    IO.coolant.flood = 0;
+    if (pins) {
+	*(pins->coolant_mist) = 0;
+	*(pins->coolant_flood) = 0;
+	*(pins->tool_change) = 0;	// abort tool change if in progress
+	*(pins->tool_prepare) = 0;	// abort tool prepare if in progress
+    }
+    deferred_load = 0;
+    IO.status = RCS_DONE;
+    return 0;
+}
+
+int InternalIoTask::emcIoSetDebug(int debug)
+{
+    IO.debug = debug;
+    IO.status = RCS_DONE;
+    return 0;
+}
+
+int InternalIoTask::emcAuxEstopOn()
+{
+    *(pins->user_enable_out) = 0;
+    IO.status = RCS_DONE;
+    return 0;
+}
+
+int InternalIoTask::emcAuxEstopOff()
+{
+    *(pins->user_enable_out) = 1;
+    // rising edge to reset the HAL latch, cleared again by emcIoUpdate()
+    *(pins->user_request_enable) = 1;
+    IO.status = RCS_DONE;
+    return 0;
+}
+
+int InternalIoTask::emcCoolantMistOn()
+{
+    IO.coolant.mist = 1;
+    *(pins->coolant_mist) = 1;
+    IO.status = RCS_DONE;
+    return 0;
+}
+
+int InternalIoTask::emcCoolantMistOff()
+{
+    IO.coolant.mist = 0;
+    *(pins->coolant_mist) = 0;
+    IO.status = RCS_DONE;
+    return 0;
+}
+
+int InternalIoTask::emcCoolantFloodOn()
+{
+    IO.coolant.flood = 1;
+    *(pins->coolant_flood) = 1;
+    IO.status = RCS_DONE;
+    return 0;
+}
+
+int InternalIoTask::emcCoolantFloodOff()
+{
+    IO.coolant.flood = 0;
+    *(pins->coolant_flood) = 0;
+    IO.status = RCS_DONE;
+    return 0;
+}
+
+int InternalIoTask::emcLubeOn()
+{
+    IO.lube.on = 1;
+    *(pins->lube) = 1;
+    IO.status = RCS_DONE;
+    return 0;
+}
+
+int InternalIoTask::emcLubeOff()
+{
+    IO.lube.on = 0;
+    *(pins->lube) = 0;
+    IO.status = RCS_DONE;
+    return 0;
+}
+
+// set the tool number first, then the prepare pin to tell external logic
+// to get started
+void InternalIoTask::startPrepare(int p)
+{
+    prep_index = p;
+    *(pins->tool_prep_pocket) = random_toolchanger? p: fms[p];
+    if (!random_toolchanger && p == 0) {
+	*(pins->tool_prep_number) = 0;
+    } else {
+	*(pins->tool_prep_number) = IO.tool.toolTable[p].toolno;
+    }
+    *(pins->tool_prepare) = 1;
+}
+
+// returns 0 if there is nothing to change
+int InternalIoTask::startChange()
+{
+    // it doesn't make sense to load a tool from the spindle pocket
+    if (random_toolchanger && IO.tool.pocketPrepped == 0) {
+	return 0;
+    }
+    // it's not necessary to load the tool already in the spindle
+    if (!random_toolchanger && IO.tool.pocketPrepped > 0 &&
+	IO.tool.toolInSpindle == IO.tool.toolTable[IO.tool.pocketPrepped].toolno) {
+	return 0;
+    }
+    if (IO.tool.pocketPrepped == -1) {
+	return 0;
+    }
+    *(pins->tool_change) = 1;
+    return 1;
+}
+
+int InternalIoTask::emcToolPrepare(int p, int tool)
+{
+    IO.status = RCS_DONE;
+    // it doesn't make sense to prep the spindle pocket
+    if (random_toolchanger && p == 0) {
+	return 0;
+    }
+    startPrepare(p);
+    if (!tool_prep_pipeline) {
+	// done once tool-prepared comes back, see emcIoUpdate()
+	IO.status = RCS_EXEC;
+    }
+    return 0;
+}
+
+int InternalIoTask::emcToolStartChange()
+{
+    IO.status = RCS_DONE;
+    return 0;
+}
+
+int InternalIoTask::emcToolLoad()
+{
+    IO.status = RCS_DONE;
+    if (*(pins->tool_prepare)) {
+	// a pipelined prepare is still going, change once it is done
+	deferred_load = 1;
+	IO.status = RCS_EXEC;
+    } else if (startChange()) {
+	IO.status = RCS_EXEC;
+    }
+    return 0;
+}
+
+int InternalIoTask::emcToolUnload()
+{
+    IO.tool.toolInSpindle = 0;
+    IO.status = RCS_DONE;
+    return 0;
+}
+
+void InternalIoTask::loadTool(int pocket)
+{
+    if (random_toolchanger) {
+	// swap the tools between the desired pocket and the spindle pocket
+	CANON_TOOL_TABLE temp = IO.tool.toolTable[0];
+	char *comment_temp = ttcomments[0];
+
+	IO.tool.toolTable[0] = IO.tool.toolTable[pocket];
+	IO.tool.toolTable[pocket] = temp;
+	ttcomments[0] = ttcomments[pocket];
+	ttcomments[pocket] = comment_temp;
+
+	if (0 != saveToolTable(tool_table_file, IO.tool.toolTable,
+			       fms, ttcomments, random_toolchanger))
+	    IO.status = RCS_ERROR;
+    } else if (pocket == 0) {
+	// on non-random tool-changers, asking for pocket 0 is the secret
+	// handshake for "unload the tool from the spindle"
+	IO.tool.toolTable[0].toolno = 0;
+	ZERO_EMC_POSE(IO.tool.toolTable[0].offset);
+	IO.tool.toolTable[0].diameter = 0.0;
+	IO.tool.toolTable[0].frontangle = 0.0;
+	IO.tool.toolTable[0].backangle = 0.0;
+	IO.tool.toolTable[0].orientation = 0;
+    } else {
+	// just copy the desired tool to the spindle
+	IO.tool.toolTable[0] = IO.tool.toolTable[pocket];
+    }
+}
+
+void InternalIoTask::reloadToolNumber(int toolno)
+{
+    if (random_toolchanger) return; // doesn't need special handling here
+    for (int i = 1; i < CANON_POCKETS_MAX; i++) {
+	if (IO.tool.toolTable[i].toolno == toolno) {
+	    loadTool(i);
+	    break;
+	}
+    }
+}
+
+int InternalIoTask::emcToolLoadToolTable(const char *file)
+{
+    if (!strlen(file)) file = tool_table_file;
+    IO.status = RCS_DONE;
+    if (0 != loadToolTable(file, IO.tool.toolTable,
+			   fms, ttcomments, random_toolchanger)) {
+	IO.status = RCS_ERROR;
+    } else {
+	reloadToolNumber(IO.tool.toolInSpindle);
+    }
+    return 0;
+}
+
+int InternalIoTask::emcToolSetOffset(int pocket, int toolno, EmcPose offset, double diameter,
+				     double frontangle, double backangle, int orientation)
+{
+    IO.tool.toolTable[pocket].toolno = toolno;
+    IO.tool.toolTable[pocket].offset = offset;
+    IO.tool.toolTable[pocket].diameter = diameter;
+    IO.tool.toolTable[pocket].frontangle = frontangle;
+    IO.tool.toolTable[pocket].backangle = backangle;
+    IO.tool.toolTable[pocket].orientation = orientation;
+    if (IO.tool.toolInSpindle == toolno) {
+	IO.tool.toolTable[0] = IO.tool.toolTable[pocket];
+    }
+    IO.status = RCS_DONE;
+    if (0 != saveToolTable(tool_table_file, IO.tool.toolTable,
+			   fms, ttcomments, random_toolchanger)) {
+	IO.status = RCS_ERROR;
+    }
+    return 0;
+}
+
+int InternalIoTask::emcToolSetNumber(int number)
+{
+    // number is the pocket of the tool now in the spindle
+    loadTool(number);
+    IO.tool.toolInSpindle = IO.tool.toolTable[number].toolno;
+    *(pins->tool_number) = IO.tool.toolInSpindle;
+    IO.status = RCS_DONE;
+    return 0;
+}
+
+// called every task cycle: read the HAL inputs and finish the prepare or
+// change they acknowledge.  The status lives in stat directly, there is
+// nothing to copy.
+int InternalIoTask::emcIoUpdate(EMC_IO_STAT * stat)
+{
+    if (pins == 0) {
+	return -1;
+    }
+    // check for estop from HW
+    stat->aux.estop = !*(pins->emc_enable_in);
+    stat->lube.level = *(pins->lube_level);
+    // clear reset line to allow for a later rising edge
+    *(pins->user_request_enable) = 0;
+
+    if (*(pins->tool_prepare) && *(pins->tool_prepared)) {
+	stat->tool.pocketPrepped = prep_index;
+	*(pins->tool_prepare) = 0;
+	stat->status = RCS_DONE;
+	if (deferred_load) {
+	    deferred_load = 0;
+	    if (startChange()) stat->status = RCS_EXEC;
+	}
+    }
+
+    if (*(pins->tool_change) && *(pins->tool_changed)) {
+	if (!random_toolchanger && stat->tool.pocketPrepped == 0) {
+	    stat->tool.toolInSpindle = 0;
+	} else {
+	    // the tool now in the spindle is the one that was prepared
+	    stat->tool.toolInSpindle = stat->tool.toolTable[stat->tool.pocketPrepped].toolno;
+	}
+	*(pins->tool_number) = stat->tool.toolInSpindle;
+	stat->status = RCS_DONE;
+	loadTool(stat->tool.pocketPrepped);
+	stat->tool.pocketPrepped = -1; // -1 to permit tool 0 to be loaded
+	*(pins->tool_prep_number) = 0;
+	*(pins->tool_prep_pocket) = 0;
+	prep_index = 0;
+	*(pins->tool_change) = 0;
+    }
+    return 0;
+}
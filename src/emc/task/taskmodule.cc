@@ -59,26 +59,46 @@ static int handle_exception(const char *name)
     return -1;
 }
 
-#define EXPAND(method)						\
-    int method() {						\
-	if (bp::override f = this->get_override(#method)) {	\
-	    try {						\
-		return f();					\
-	    }							\
-	    catch( bp::error_already_set ) {			\
-		return handle_exception(#method);		\
-	    }							\
-	}							\
-	else							\
-	    return  Task::method();				\
+// The methods a Python Task() may override.  emcIoUpdate() is called
+// every task cycle, so they are looked up once, all together on the
+// first call, instead of on each call; a method the Python class does
+// not define then costs nothing.  Task.rebind() looks them up again,
+// for a Task that changes its methods after it has been called.
+#define TASK_METHODS(X)							\
+    X(emcIoInit) X(emcIoHalt) X(emcIoAbort) X(emcToolStartChange)	\
+    X(emcAuxEstopOn) X(emcAuxEstopOff) X(emcCoolantMistOn)		\
+    X(emcCoolantMistOff) X(emcCoolantFloodOn) X(emcCoolantFloodOff)	\
+    X(emcLubeOn) X(emcLubeOff) X(emcIoSetDebug) X(emcToolPrepare)	\
+    X(emcToolLoad) X(emcToolLoadToolTable) X(emcToolUnload)		\
+    X(emcToolSetNumber) X(emcIoPluginCall) X(emcToolSetOffset)	\
+    X(emcIoUpdate)
+
+#define METHOD_ID(method) M_##method,
+#define METHOD_NAME(method) #method,
+
+enum task_method { TASK_METHODS(METHOD_ID) M_MAX };
+static const char *task_method_names[M_MAX] = { TASK_METHODS(METHOD_NAME) };
+
+#define EXPAND(method)							\
+    int method() {							\
+	if (PyObject *f = override_of(M_##method)) {			\
+	    try {							\
+		return bp::call<int>(f);				\
+	    }								\
+	    catch( bp::error_already_set ) {				\
+		return handle_exception(#method);			\
+	    }								\
+	}								\
+	else								\
+	    return  Task::method();					\
     }
 
 
 #define EXPAND1(method,type,name)					\
     int method(type name) {						\
-	if (bp::override f = this->get_override(#method)) {		\
+	if (PyObject *f = override_of(M_##method)) {			\
 	    try {							\
-		return f(name);						\
+		return bp::call<int>(f, name);				\
 	    }								\
 	    catch( bp::error_already_set ) {				\
 		return handle_exception(#method);			\
@@ -90,9 +110,9 @@ static int handle_exception(const char *name)
 
 #define EXPAND2(method,type,name,type2,name2)				\
     int method(type name,type2 name2) {					\
-	if (bp::override f = this->get_override(#method)) {		\
+	if (PyObject *f = override_of(M_##method)) {			\
 	    try {							\
-		return f(name,name2);					\
+		return bp::call<int>(f, name, name2);			\
 	    }								\
 	    catch( bp::error_already_set ) {				\
 		return handle_exception(#method);			\
@@ -103,7 +123,23 @@ static int handle_exception(const char *name)
 
 struct TaskWrap : public Task, public bp::wrapper<Task> {
 
-    TaskWrap() : Task() {}
+    TaskWrap() : Task(), bound(false) {}
+
+    // the bound Python method, or NULL if Python doesn't override it
+    PyObject *override_of(task_method id) {
+	if (!bound) {
+	    rebind();
+	}
+	PyObject *f = overrides[id].ptr();
+	return f == Py_None ? NULL : f;
+    }
+
+    void rebind() {
+	for (int i = 0; i < M_MAX; i++) {
+	    overrides[i] = this->get_override(task_method_names[i]);
+	}
+	bound = true;
+    }
 
     EXPAND(emcIoInit)
     EXPAND(emcIoHalt)
@@ -127,11 +163,11 @@ struct TaskWrap : public Task, public bp::wrapper<Task> {
     EXPAND1(emcToolSetNumber,int,number)
 
     int emcIoPluginCall(int len,const char *msg) {
-	if (bp::override f = this->get_override("emcIoPluginCall")) {
+	if (PyObject *f = override_of(M_emcIoPluginCall)) {
 	    try {
 		// binary picklings may contain zeroes
 		std::string buffer(msg,len);
-		return f(len,buffer);
+		return bp::call<int>(f, len, buffer);
 	    }
 	    catch( bp::error_already_set ) {
 		return handle_exception("emcIoPluginCall");
@@ -142,9 +178,9 @@ struct TaskWrap : public Task, public bp::wrapper<Task> {
 
     int emcToolSetOffset(int pocket, int toolno, EmcPose offset, double diameter,
 			 double frontangle, double backangle, int orientation) {
-	if (bp::override f = this->get_override("emcToolSetOffset"))
+	if (PyObject *f = override_of(M_emcToolSetOffset))
 	    try {
-		return f(pocket,toolno,offset,diameter,frontangle,backangle,orientation);
+		return bp::call<int>(f, pocket,toolno,offset,diameter,frontangle,backangle,orientation);
 	    }
 	    catch( bp::error_already_set ) {
 		return handle_exception("emcToolSetOffset");
@@ -154,9 +190,9 @@ struct TaskWrap : public Task, public bp::wrapper<Task> {
     }
 
     int emcIoUpdate(EMC_IO_STAT * stat) {
-	if (bp::override f = this->get_override("emcIoUpdate"))
+	if (PyObject *f = override_of(M_emcIoUpdate))
 	    try {
-		return f(); /// bug in Boost.Python, fixed in 1.44 I guess: return_int("foo",f());
+		return bp::call<int>(f);
 	    }
 	    catch( bp::error_already_set ) {
 		return handle_exception("emcIoUpdate");
@@ -165,9 +201,13 @@ struct TaskWrap : public Task, public bp::wrapper<Task> {
 	    return  Task::emcIoUpdate(stat);
     }
 
+private:
+    bool bound;
+    bp::object overrides[M_MAX];
 };
 
 typedef pp::array_1_t< EMC_AXIS_STAT, EMCMOT_MAX_AXIS> axis_array, (*axis_w)( EMC_MOTION_STAT &m );
+typedef pp::array_1_t< EMC_JOINT_STAT, EMCMOT_MAX_JOINTS> joint_array, (*joint_w)( EMC_MOTION_STAT &m );
 typedef pp::array_1_t< int, EMCMOT_MAX_DIO> synch_dio_array, (*synch_dio_w)( EMC_MOTION_STAT &m );
 typedef pp::array_1_t< double, EMCMOT_MAX_AIO> analog_io_array, (*analog_io_w)( EMC_MOTION_STAT &m );
 
@@ -185,6 +225,10 @@ static  axis_array axis_wrapper ( EMC_MOTION_STAT & m) {
     return axis_array(m.axis);
 }
 
+static  joint_array joint_wrapper ( EMC_MOTION_STAT & m) {
+    return joint_array(m.joint);
+}
+
 static  synch_dio_array synch_di_wrapper ( EMC_MOTION_STAT & m) {
     return synch_dio_array(m.synch_di);
 }
@@ -322,6 +366,8 @@ BOOST_PYTHON_MODULE(emctask) {
 	.def_readonly("use_iocontrol", &Task::use_iocontrol)
 	.def_readonly("random_toolchanger", &Task::random_toolchanger)
 	.def_readonly("tooltable_filename", &Task::tooltable_filename)
+	.def("rebind", &TaskWrap::rebind,
+	     "look up the overridden task methods again")
 	;
 
     class_ <EMC_TRAJ_STAT, noncopyable>("EMC_TRAJ_STAT",no_init)
@@ -408,6 +454,9 @@ BOOST_PYTHON_MODULE(emctask) {
 	.add_property( "axis",
 		       bp::make_function( axis_w(&axis_wrapper),
 					  bp::with_custodian_and_ward_postcall< 0, 1 >()))
+	.add_property( "joint",
+		       bp::make_function( joint_w(&joint_wrapper),
+					  bp::with_custodian_and_ward_postcall< 0, 1 >()))
 
 
 	.def_readwrite("spindle", &emcStatus->motion.spindle)
@@ -506,6 +555,8 @@ BOOST_PYTHON_MODULE(emctask) {
     pp::register_array_1< int, EMCMOT_MAX_DIO> ("DigitalIoArray");
     pp::register_array_1< EMC_AXIS_STAT,EMCMOT_MAX_AXIS,
 	bp::return_internal_reference< 1, bp::default_call_policies > > ("AxisArray");
+    pp::register_array_1< EMC_JOINT_STAT,EMCMOT_MAX_JOINTS,
+	bp::return_internal_reference< 1, bp::default_call_policies > > ("JointArray");
 }
 
 
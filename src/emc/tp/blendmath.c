@@ -11,7 +11,7 @@
 * Last change:
 ********************************************************************/
 
-#include "posemath.h"
+#include "posemath_inline.h"
 #include "tc_types.h"
 #include "tc.h"
 #include "tp_types.h"
@@ -48,6 +48,21 @@ double findMaxTangentAngle(double v_plan, double acc_limit, double cycle_time)
 }
 
 
+/**
+ * Find the maximum speed along an arc for a given jerk limit.
+ * Moving at constant speed v along radius R, the normal acceleration vector
+ * rotates at v / R, so its rate of change (jerk) is v^3 / R^2.
+ * Returns TP_BIG_NUM if there is no jerk limit.
+ */
+double findJerkLimitedVel(double radius, double j_max)
+{
+    if (j_max <= 0.0) {
+        return TP_BIG_NUM;
+    }
+    return pow(j_max * pmSq(radius), 1.0 / 3.0);
+}
+
+
 /**
  * Find the acceleration required to create a specific change in path
  * direction, assuming constant speed.
@@ -218,6 +233,124 @@ static inline int findSpiralApproximation(PmCircle const * const circ,
 }
 
 
+/**
+ * Fit a circle in the blend plane to an arc that leaves it.
+ *
+ * Helical arcs, and arcs in a different plane than the blend, are not
+ * contained in the plane of the tangent vectors at P. Near P such an arc
+ * follows its projection onto that plane, whose curvature is the in-plane
+ * part of the arc's curvature vector. The osculating circle of the
+ * projection stands in for the arc in the planar blend solution. The blend
+ * end points are taken from the arc itself afterwards, and the result is
+ * checked by checkTangentAngle and blendCheckPlaneDeviation.
+ */
+static inline int findPlaneApproximation(PmCircle const * const circ,
+        PmCartesian const * const base_pt,
+        PmCartesian const * const binormal,
+        PmCartesian * const center_out,
+        double * const radius_out,
+        double * const angle_scale)
+{
+    // Radial vector from the circle axis to the base point
+    PmCartesian r_P, r_axial;
+    double h;
+    pmCartCartSub(base_pt, &circ->center, &r_P);
+    pmCartCartDot(&r_P, &circ->normal, &h);
+    pmCartScalMult(&circ->normal, h, &r_axial);
+    pmCartCartSubEq(&r_P, &r_axial);
+
+    double r;
+    pmCartMag(&r_P, &r);
+    if (r < TP_POS_EPSILON) {
+        return TP_ERR_GEOM;
+    }
+
+    // A helix of radius r and lead p per radian has curvature r / (r^2 + p^2),
+    // pointing at the axis
+    double p;
+    pmCartMag(&circ->rHelix, &p);
+    p /= circ->angle;
+
+    PmCartesian k;
+    pmCartScalMult(&r_P, -1.0 / (pmSq(r) + pmSq(p)), &k);
+    double k_mag;
+    pmCartMag(&k, &k_mag);
+
+    // Remove the component out of the blend plane
+    double k_b;
+    PmCartesian k_out;
+    pmCartCartDot(&k, binormal, &k_b);
+    pmCartScalMult(binormal, k_b, &k_out);
+    pmCartCartSubEq(&k, &k_out);
+
+    double k_in;
+    pmCartMag(&k, &k_in);
+    tp_debug_print(" in-plane curvature = %f of %f\n", k_in, k_mag);
+
+    // An arc that curves mostly out of the plane has no useful fit
+    if (k_in < BLEND_PLANE_MIN_CURVATURE_RATIO * k_mag) {
+        return TP_ERR_GEOM;
+    }
+
+    *radius_out = 1.0 / k_in;
+    pmCartScalMult(&k, 1.0 / pmSq(k_in), center_out);
+    pmCartCartAddEq(center_out, base_pt);
+
+    // Arc and projection have the same length near P, so convert between
+    // their angles by the length per radian of each
+    *angle_scale = *radius_out / pmSqrt(pmSq(r) + pmSq(p));
+
+    tp_debug_print(" plane center = %f %f %f\n",
+            center_out->x,
+            center_out->y,
+            center_out->z);
+    tp_debug_print(" plane radius = %f\n", *radius_out);
+
+    return TP_ERR_OK;
+}
+
+
+/**
+ * Find the local circle approximation of an arc at the intersection point.
+ * Arcs in the blend plane use the spiral approximation, others the
+ * projection onto the blend plane.
+ */
+static int blendFitArc(PmCircle const * const circ,
+        BlendGeom3 const * const geom,
+        PmCartesian const * const u_tan,
+        PmCartesian * const center_out,
+        double * const radius_out,
+        double * const angle_scale,
+        int * const coplanar)
+{
+    *coplanar = pmCartCartParallel(&geom->binormal,
+            &circ->normal,
+            TP_ANGLE_EPSILON);
+    tp_debug_print(" arc coplanar: %d\n", *coplanar);
+    if (*coplanar) {
+        *angle_scale = 1.0;
+        return findSpiralApproximation(circ, &geom->P, u_tan, center_out, radius_out);
+    }
+    return findPlaneApproximation(circ, &geom->P, &geom->binormal,
+            center_out, radius_out, angle_scale);
+}
+
+
+/**
+ * Project a secant direction onto the blend plane.
+ */
+static void blendProjectToPlane(BlendGeom3 const * const geom,
+        PmCartesian * const u)
+{
+    double dot;
+    PmCartesian u_out;
+    pmCartCartDot(u, &geom->binormal, &dot);
+    pmCartScalMult(&geom->binormal, dot, &u_out);
+    pmCartCartSubEq(u, &u_out);
+    pmCartUnitEq(u);
+}
+
+
 /**
  * Calculate the angle to trim from a circle based on the blend geometry.
  *
@@ -568,21 +701,20 @@ int quadraticFormula(double A, double B, double C, double * const root0,
  * @param prev_tc first linear move to blend
  * @param tc second linear move to blend
  */
-int blendGeom3Init(BlendGeom3 * const geom,
+/**
+ * Find the tangent vectors and the intersection point of a segment pair.
+ * These are needed by both the tangency check and the blend arc setup, and
+ * are the costly part of the geometry for circular segments, so they are
+ * computed once per pair here and then shared through geom.
+ */
+int blendGeom3Tangents(BlendGeom3 * const geom,
         TC_STRUCT const * const prev_tc,
         TC_STRUCT const * const tc)
 {
-    geom->v_max1 = prev_tc->maxvel;
-    geom->v_max2 = tc->maxvel;
-
     // Get tangent unit vectors to each arc at the intersection point
     int res_u1 = tcGetEndTangentUnitVector(prev_tc, &geom->u_tan1);
     int res_u2 = tcGetStartTangentUnitVector(tc, &geom->u_tan2);
 
-    // Initialize u1 and u2 by assuming they match the tangent direction
-    geom->u1 = geom->u_tan1;
-    geom->u2 = geom->u_tan2;
-
     int res_intersect = tcGetIntersectionPoint(prev_tc, tc, &geom->P);
 
     tp_debug_print("Intersection point P = %f %f %f\n",
@@ -590,6 +722,28 @@ int blendGeom3Init(BlendGeom3 * const geom,
             geom->P.y,
             geom->P.z);
 
+    return res_u1 |
+        res_u2 |
+        res_intersect;
+}
+
+
+/**
+ * Initialize the blend geometry of a segment pair.
+ * The tangent vectors and intersection point must already have been found
+ * by blendGeom3Tangents.
+ */
+int blendGeom3Init(BlendGeom3 * const geom,
+        TC_STRUCT const * const prev_tc,
+        TC_STRUCT const * const tc)
+{
+    geom->v_max1 = prev_tc->maxvel;
+    geom->v_max2 = tc->maxvel;
+
+    // Initialize u1 and u2 by assuming they match the tangent direction
+    geom->u1 = geom->u_tan1;
+    geom->u2 = geom->u_tan2;
+
     // Find angle between tangent vectors
     int res_angle = findIntersectionAngle(&geom->u_tan1,
             &geom->u_tan2,
@@ -608,10 +762,7 @@ int blendGeom3Init(BlendGeom3 * const geom,
 
     blendCalculateNormals3(geom);
 
-    return res_u1 |
-        res_u2 |
-        res_intersect |
-        res_angle;
+    return res_angle;
 }
 
 
@@ -644,6 +795,9 @@ int blendParamKinematics(BlendGeom3 * const geom,
 
     // Store max normal acceleration
     param->a_n_max = param->a_max * BLEND_ACC_RATIO_NORMAL;
+
+    // Jerk limit applies if either segment is jerk limited
+    param->j_max = fmax(prev_tc->maxjerk, tc->maxjerk);
     tp_debug_print("a_max = %f, a_n_max = %f\n", param->a_max,
             param->a_n_max);
 
@@ -731,11 +885,18 @@ int blendInit3FromLineArc(BlendGeom3 * const geom, BlendParameters * const param
     }
 
     //Fit spiral approximation
-    findSpiralApproximation(&tc->coords.circle.xyz,
-            &geom->P,
+    param->coplanar1 = 1;
+    int res_fit = blendFitArc(&tc->coords.circle.xyz,
+            geom,
             &geom->u_tan2,
             &geom->center2,
-            &geom->radius2);
+            &geom->radius2,
+            &geom->angle_scale2,
+            &param->coplanar2);
+    if (res_fit != TP_ERR_OK) {
+        tp_debug_print("no fit of arc to blend plane, aborting arc...\n");
+        return res_fit;
+    }
     // Handle convexity
     param->convex2 = arcConvexTest(&geom->center2, &geom->P, &geom->u_tan1, true);
     tp_debug_print("circ2 convex: %d\n",
@@ -757,6 +918,9 @@ int blendInit3FromLineArc(BlendGeom3 * const geom, BlendParameters * const param
         // Direction is away from P (at start of segment)
         pmCartCartSub(&blend_point, &geom->P,  &geom->u2);
         pmCartUnitEq(&geom->u2);
+        if (!param->coplanar2) {
+            blendProjectToPlane(geom, &geom->u2);
+        }
         //Reduce theta proportionally to the angle between the secant and the normal
         param->theta = fmin(param->theta, geom->theta_tan - param->phi2_max / 4.0);
     }
@@ -817,11 +981,18 @@ int blendInit3FromArcLine(BlendGeom3 * const geom, BlendParameters * const param
         return res_init;
     }
 
-    findSpiralApproximation(&prev_tc->coords.circle.xyz,
-            &geom->P,
+    param->coplanar2 = 1;
+    int res_fit = blendFitArc(&prev_tc->coords.circle.xyz,
+            geom,
             &geom->u_tan1,
             &geom->center1,
-            &geom->radius1);
+            &geom->radius1,
+            &geom->angle_scale1,
+            &param->coplanar1);
+    if (res_fit != TP_ERR_OK) {
+        tp_debug_print("no fit of arc to blend plane, aborting arc...\n");
+        return res_fit;
+    }
 
     param->convex1 = arcConvexTest(&geom->center1, &geom->P, &geom->u_tan2, false);
     tp_debug_print("circ1 convex: %d\n",
@@ -844,6 +1015,9 @@ int blendInit3FromArcLine(BlendGeom3 * const geom, BlendParameters * const param
         // Direction is toward P (at end of segment)
         pmCartCartSub(&geom->P, &blend_point, &geom->u1);
         pmCartUnitEq(&geom->u1);
+        if (!param->coplanar1) {
+            blendProjectToPlane(geom, &geom->u1);
+        }
 
         //Reduce theta proportionally to the angle between the secant and the normal
         param->theta = fmin(param->theta, geom->theta_tan - param->phi1_max / 4.0);
@@ -916,28 +1090,28 @@ int blendInit3FromArcArc(BlendGeom3 * const geom, BlendParameters * const param,
         return res_init;
     }
 
-    findSpiralApproximation(&prev_tc->coords.circle.xyz,
-            &geom->P,
+    // Normals and the intersection point (the start of the second circle)
+    // are already set up by blendGeom3Init
+    int res_fit1 = blendFitArc(&prev_tc->coords.circle.xyz,
+            geom,
             &geom->u_tan1,
             &geom->center1,
-            &geom->radius1);
+            &geom->radius1,
+            &geom->angle_scale1,
+            &param->coplanar1);
 
-    findSpiralApproximation(&tc->coords.circle.xyz,
-            &geom->P,
+    int res_fit2 = blendFitArc(&tc->coords.circle.xyz,
+            geom,
             &geom->u_tan2,
             &geom->center2,
-            &geom->radius2);
-
+            &geom->radius2,
+            &geom->angle_scale2,
+            &param->coplanar2);
 
-    //Do normal calculation here since we need this information for accel / vel limits
-    blendCalculateNormals3(geom);
-
-    // Get intersection point from circle start
-    pmCirclePoint(&tc->coords.circle.xyz, 0.0, &geom->P);
-    tp_debug_print("Intersection point P = %f %f %f\n",
-            geom->P.x,
-            geom->P.y,
-            geom->P.z);
+    if (res_fit1 != TP_ERR_OK || res_fit2 != TP_ERR_OK) {
+        tp_debug_print("no fit of arcs to blend plane, aborting arc...\n");
+        return TP_ERR_GEOM;
+    }
 
     param->convex1 = arcConvexTest(&geom->center1, &geom->P, &geom->u_tan2, false);
     param->convex2 = arcConvexTest(&geom->center2, &geom->P, &geom->u_tan1, true);
@@ -965,6 +1139,9 @@ int blendInit3FromArcArc(BlendGeom3 * const geom, BlendParameters * const param,
         // Direction is toward P (at end of segment)
         pmCartCartSub(&geom->P, &blend_point, &geom->u1);
         pmCartUnitEq(&geom->u1);
+        if (!param->coplanar1) {
+            blendProjectToPlane(geom, &geom->u1);
+        }
 
         //Reduce theta proportionally to the angle between the secant and the normal
         param->theta = fmin(param->theta, geom->theta_tan - param->phi1_max / 4.0);
@@ -980,6 +1157,9 @@ int blendInit3FromArcArc(BlendGeom3 * const geom, BlendParameters * const param,
         // Direction is away from P (at start of segment)
         pmCartCartSub(&blend_point, &geom->P,  &geom->u2);
         pmCartUnitEq(&geom->u2);
+        if (!param->coplanar2) {
+            blendProjectToPlane(geom, &geom->u2);
+        }
 
         //Reduce theta proportionally to the angle between the secant and the normal
         param->theta = fmin(param->theta, geom->theta_tan - param->phi2_max / 4.0);
@@ -1056,6 +1236,8 @@ int blendInit3FromLineLine(BlendGeom3 * const geom, BlendParameters * const para
         return res_init;
     }
 
+    param->coplanar1 = 1;
+    param->coplanar2 = 1;
     param->theta = geom->theta_tan;
 
     tp_debug_print("theta = %f\n", param->theta);
@@ -1134,6 +1316,9 @@ int blendComputeParameters(BlendParameters * const param)
     double v_normal = pmSqrt(param->a_n_max * R_geom);
     tp_debug_print("v_normal = %f\n", v_normal);
 
+    // With S-curve profiles, also respect the jerk of following the arc
+    v_normal = fmin(v_normal, findJerkLimitedVel(R_geom, param->j_max));
+
     param->v_plan = fmin(v_normal, param->v_goal);
 
     /*Get the limiting velocity of the equivalent parabolic blend. We use the
@@ -1151,6 +1336,11 @@ int blendComputeParameters(BlendParameters * const param)
     double R_blend = fmin(s_blend / param->phi, R_geom);   //Clamp by limiting radius
 
     param->R_plan = fmax(pmSq(param->v_plan) / param->a_n_max, R_blend);
+    if (param->j_max > 0.0) {
+        // Smallest radius that keeps v_plan^3 / R^2 within the jerk limit
+        param->R_plan = fmax(param->R_plan,
+                pmSqrt(pmSq(param->v_plan) * param->v_plan / param->j_max));
+    }
     param->d_plan = param->R_plan / tan(param->theta);
 
     tp_debug_print("v_plan = %f\n", param->v_plan);
@@ -1342,7 +1532,7 @@ int blendLineArcPostProcess(BlendPoints3 * const points, BlendPoints3 const * co
 
     points->trim1 = d_L;
 
-    points->trim2 = findTrimAngle(&geom->P,
+    points->trim2 = geom->angle_scale2 * findTrimAngle(&geom->P,
             &points->arc_center,
             &geom->center2);
 
@@ -1427,7 +1617,7 @@ int blendArcLinePostProcess(BlendPoints3 * const points,
     }
     tp_debug_print("T_final = %f\n",T_final);
 
-    points->trim1 = findTrimAngle(&geom->P,
+    points->trim1 = geom->angle_scale1 * findTrimAngle(&geom->P,
             &points->arc_center,
             &geom->center1);
 
@@ -1550,10 +1740,10 @@ int blendArcArcPostProcess(BlendPoints3 * const points, BlendPoints3 const * con
     }
     tp_debug_print("T_final = %f\n",T_final);
 
-    points->trim1 = findTrimAngle(&geom->P,
+    points->trim1 = geom->angle_scale1 * findTrimAngle(&geom->P,
             &points->arc_center,
             &geom->center1);
-    points->trim2 = findTrimAngle(&geom->P,
+    points->trim2 = geom->angle_scale2 * findTrimAngle(&geom->P,
             &points->arc_center,
             &geom->center2);
 
@@ -1577,8 +1767,56 @@ int arcFromBlendPoints3(SphericalArc * const arc, BlendPoints3 const * const poi
     arc->binormal = geom->binormal;
 
     // Create the arc from the processed points
-    return arcInitFromPoints(arc, &points->arc_start,
+    int res_init = arcInitFromPoints(arc, &points->arc_start,
             &points->arc_end, &points->arc_center);
+    if (res_init != TP_ERR_OK || (param->coplanar1 && param->coplanar2)) {
+        return res_init;
+    }
+
+    // End points taken from arcs outside the blend plane tilt the arc a
+    // little, so use its actual plane for the tangent vectors
+    PmCartesian binormal;
+    pmCartCartCross(&arc->rStart, &arc->rEnd, &binormal);
+    if (pmCartUnitEq(&binormal)) {
+        return TP_ERR_GEOM;
+    }
+    double dot;
+    pmCartCartDot(&binormal, &geom->binormal, &dot);
+    if (dot < 0) {
+        pmCartNegEq(&binormal);
+    }
+    arc->binormal = binormal;
+    return TP_ERR_OK;
+}
+
+
+/**
+ * Check that the end points of a blend arc stay close to the blend plane.
+ * The planar solution is only valid if the arcs outside the plane don't
+ * leave it by more than the blend tolerance over the blend.
+ */
+int blendCheckPlaneDeviation(BlendPoints3 const * const points,
+        BlendGeom3 const * const geom,
+        BlendParameters const * const param)
+{
+    if (param->coplanar1 && param->coplanar2) {
+        return TP_ERR_OK;
+    }
+
+    PmCartesian r_start, r_end;
+    pmCartCartSub(&points->arc_start, &geom->P, &r_start);
+    pmCartCartSub(&points->arc_end, &geom->P, &r_end);
+
+    double dev_start, dev_end;
+    pmCartCartDot(&r_start, &geom->binormal, &dev_start);
+    pmCartCartDot(&r_end, &geom->binormal, &dev_end);
+
+    double dev = fmax(fabs(dev_start), fabs(dev_end));
+    tp_debug_print("plane deviation = %f, tolerance = %f\n", dev, param->tolerance);
+    if (dev > param->tolerance) {
+        return TP_ERR_TOLERANCE;
+    }
+    return TP_ERR_OK;
 }
 
 int blendGeom3Print(BlendGeom3 const * const geom)
@@ -20,6 +20,10 @@
 #define BLEND_ACC_RATIO_NORMAL (pmSqrt(1.0 - pmSq(BLEND_ACC_RATIO_TANGENTIAL)))
 #define BLEND_KINK_FACTOR 0.25
 
+/* Smallest part of an arc's curvature that must lie in the blend plane for
+ * the arc to be blended when it is not coplanar with the blend */
+#define BLEND_PLANE_MIN_CURVATURE_RATIO 0.1
+
 typedef enum {
     BLEND_NONE,
     BLEND_LINE_LINE,
@@ -44,6 +48,8 @@ typedef struct {
     PmCartesian center2;    /* Local approximation of center for arc 2 */
     double radius1;         /* Local approximation of radius */
     double radius2;
+    double angle_scale1;    /* circle angle per angle of local approximation 1 */
+    double angle_scale2;
     double theta_tan;
     double v_max1;          /* maximum velocity in direction u_tan1 */
     double v_max2;          /* maximum velocity in direction u_tan2 */
@@ -74,6 +80,7 @@ typedef struct {
     double L2;          /* Available part of line 2 to blend over */
     double v_req;       /* requsted velocity for the blend arc */
     double a_max;       /* max acceleration allowed for blend */
+    double j_max;       /* max jerk allowed for blend (0 = not jerk limited) */
 
     /* These fields are considered "output", and may be refactored into a
      * separate structure in the future */
@@ -94,6 +101,8 @@ typedef struct {
     //Arc specific stuff
     int convex1;
     int convex2;
+    int coplanar1;      /* segment 1 lies in the blend plane */
+    int coplanar2;      /* segment 2 lies in the blend plane */
     double phi1_max;
     double phi2_max;
     
@@ -124,6 +133,8 @@ double findMaxTangentAngle(double v, double acc, double cycle_time);
 
 double findKinkAccel(double kink_angle, double v_plan, double cycle_time);
 
+double findJerkLimitedVel(double radius, double j_max);
+
 double fsign(double f);
 
 int clip_min(double * const x, double min);
@@ -170,6 +181,10 @@ int blendCheckConsume(BlendParameters * const param,
 int blendFindPoints3(BlendPoints3 * const points, BlendGeom3 const * const geom,
         BlendParameters const * const param);
 
+int blendGeom3Tangents(BlendGeom3 * const geom,
+        TC_STRUCT const * const prev_tc,
+        TC_STRUCT const * const tc);
+
 int blendGeom3Init(BlendGeom3 * const geom,
         TC_STRUCT const * const prev_tc,
         TC_STRUCT const * const tc);
@@ -222,6 +237,10 @@ int blendArcLinePostProcess(BlendPoints3 * const points, BlendPoints3 const * co
         BlendParameters * const param, BlendGeom3 const * const geom,
         PmCircle const * const circ1, PmCartLine const * const line2);
 
+int blendCheckPlaneDeviation(BlendPoints3 const * const points,
+        BlendGeom3 const * const geom,
+        BlendParameters const * const param);
+
 int arcFromBlendPoints3(SphericalArc * const arc, BlendPoints3 const * const points,
         BlendGeom3 const * const geom, BlendParameters const * const param);
 
@@ -11,7 +11,7 @@
  *
  ********************************************************************/
 
-#include "posemath.h"
+#include "posemath_inline.h"
 #include "spherical_arc.h"
 #include "tp_types.h"
 #include "rtapi_math.h"
@@ -16,7 +16,7 @@
 
 #include "rtapi.h"		/* rtapi_print_msg */
 #include "rtapi_math.h"
-#include "posemath.h"
+#include "posemath_inline.h"
 #include "blendmath.h"
 #include "emcpose.h"
 #include "tc.h"
@@ -136,7 +136,7 @@ int tcCanConsume(TC_STRUCT const * const tc)
         return false;
     }
 
-    if (tc->syncdio.anychanged || tc->blend_prev || tc->atspeed) {
+    if (tc->syncdio_changed || tc->blend_prev || tc->atspeed) {
         //TODO add other conditions here (for any segment that should not be consumed by blending
         return false;
     }
@@ -237,6 +237,182 @@ int tcGetEndTangentUnitVector(TC_STRUCT const * const tc, PmCartesian * const ou
     return 0;
 }
 
+/**
+ * Duration of a rest to rest trapezoidal move over dist, limited to vel and acc.
+ */
+double tcTrapezoidTime(double dist, double vel, double acc)
+{
+    if (dist <= 0.0) {
+        return 0.0;
+    }
+    if (dist * acc < vel * vel) {
+        // Never reaches vel
+        return 2.0 * pmSqrt(dist / acc);
+    }
+    return dist / vel + vel / acc;
+}
+
+/**
+ * Distance along the trapezoidal move of tcTrapezoidTime at time t, and its
+ * velocity there.
+ */
+STATIC double tcTrapezoidPoint(double dist, double vel, double acc, double t,
+        double * const v)
+{
+    double t_total = tcTrapezoidTime(dist, vel, acc);
+    *v = 0.0;
+    if (t <= 0.0) {
+        return 0.0;
+    }
+    if (t >= t_total) {
+        return dist;
+    }
+    double v_peak = fmin(vel, pmSqrt(dist * acc));
+    double t_acc = v_peak / acc;
+    double t_left = t_total - t;
+    if (t < t_acc) {
+        *v = acc * t;
+        return 0.5 * acc * t * t;
+    } else if (t_left < t_acc) {
+        *v = acc * t_left;
+        return dist - 0.5 * acc * t_left * t_left;
+    }
+    *v = v_peak;
+    return 0.5 * v_peak * t_acc + v_peak * (t - t_acc);
+}
+
+STATIC void tcLine9Points(PmLine9 const * const line9, double * const start,
+        double * const end)
+{
+    start[0] = line9->xyz.start.x;
+    start[1] = line9->xyz.start.y;
+    start[2] = line9->xyz.start.z;
+    start[3] = line9->abc.start.x;
+    start[4] = line9->abc.start.y;
+    start[5] = line9->abc.start.z;
+    start[6] = line9->uvw.start.x;
+    start[7] = line9->uvw.start.y;
+    start[8] = line9->uvw.start.z;
+    end[0] = line9->xyz.end.x;
+    end[1] = line9->xyz.end.y;
+    end[2] = line9->xyz.end.z;
+    end[3] = line9->abc.end.x;
+    end[4] = line9->abc.end.y;
+    end[5] = line9->abc.end.z;
+    end[6] = line9->uvw.end.x;
+    end[7] = line9->uvw.end.y;
+    end[8] = line9->uvw.end.z;
+}
+
+/**
+ * Run a linear segment with each axis on its own time-optimal profile.
+ * vel and acc are the limits of the axes, x y z a b c u v w. Each profile
+ * keeps back part of its axis' acceleration for changes in the rate time
+ * runs at (feed hold, rapid override, abort), which scale every profile at
+ * once. Leaves the segment coordinated if that is no slower.
+ */
+int tcSetupIndependent(TC_STRUCT * const tc,
+        double const * const vel,
+        double const * const acc)
+{
+    double start[9], end[9];
+    double t_max = 0.0, rate_acc = 0.0, speed_sq = 0.0;
+    int i;
+
+    if (tc->motion_type != TC_LINEAR) {
+        return TP_ERR_FAIL;
+    }
+    tcLine9Points(&tc->coords.line, start, end);
+    for (i = 0; i < 9; ++i) {
+        double dist = fabs(end[i] - start[i]);
+        if (dist < TP_POS_EPSILON) {
+            tc->indep.vel[i] = tc->indep.acc[i] = 0.0;
+            continue;
+        }
+        if (vel[i] <= 0.0 || acc[i] <= 0.0) {
+            return TP_ERR_FAIL;
+        }
+        tc->indep.vel[i] = vel[i];
+        tc->indep.acc[i] = acc[i] * BLEND_ACC_RATIO_TANGENTIAL;
+        t_max = fmax(t_max, tcTrapezoidTime(dist, vel[i], tc->indep.acc[i]));
+
+        // The rate may change as fast as the held back acceleration allows
+        // at the highest velocity this axis reaches
+        double v_peak = fmin(vel[i], pmSqrt(dist * tc->indep.acc[i]));
+        double axis_rate_acc = (acc[i] - tc->indep.acc[i]) / v_peak;
+        if (rate_acc <= 0.0 || axis_rate_acc < rate_acc) {
+            rate_acc = axis_rate_acc;
+        }
+        if (i < 3 || i >= 6) {
+            speed_sq += pmSq(vel[i]);
+        }
+    }
+
+    double t_coord = tcTrapezoidTime(tc->target, fmin(tc->reqvel, tc->maxvel),
+            tc->maxaccel);
+    if (t_max <= 0.0 || t_max >= t_coord) {
+        return TP_ERR_NO_ACTION;
+    }
+
+    tc->independent = 1;
+    tc->indep.speed = pmSqrt(speed_sq);
+    tc->target = tc->nominal_length = t_max;
+    tc->reqvel = tc->target_vel = tc->maxvel = 1.0;
+    tc->maxaccel = rate_acc;
+    tc->maxjerk = 0.0;
+    return TP_ERR_OK;
+}
+
+/**
+ * Point of an independent segment at time t.
+ */
+STATIC void tcIndependentPoint(TC_STRUCT const * const tc, double t,
+        PmCartesian * const xyz, PmCartesian * const abc, PmCartesian * const uvw)
+{
+    double start[9], end[9], p[9], v;
+    int i;
+
+    tcLine9Points(&tc->coords.line, start, end);
+    for (i = 0; i < 9; ++i) {
+        double d = end[i] - start[i];
+        if (tc->indep.vel[i] <= 0.0) {
+            p[i] = start[i];
+            continue;
+        }
+        p[i] = start[i] + copysign(tcTrapezoidPoint(fabs(d), tc->indep.vel[i],
+                    tc->indep.acc[i], t, &v), d);
+    }
+    xyz->x = p[0];
+    xyz->y = p[1];
+    xyz->z = p[2];
+    abc->x = p[3];
+    abc->y = p[4];
+    abc->z = p[5];
+    uvw->x = p[6];
+    uvw->y = p[7];
+    uvw->z = p[8];
+}
+
+/**
+ * Current cartesian speed of an independent segment, for the status.
+ */
+double tcIndependentSpeed(TC_STRUCT const * const tc)
+{
+    double start[9], end[9], v, speed_sq = 0.0;
+    int i;
+
+    tcLine9Points(&tc->coords.line, start, end);
+    for (i = 0; i < 9; ++i) {
+        if ((i >= 3 && i < 6) || tc->indep.vel[i] <= 0.0) {
+            continue;
+        }
+        tcTrapezoidPoint(fabs(end[i] - start[i]), tc->indep.vel[i],
+                tc->indep.acc[i], tc->progress, &v);
+        speed_sq += pmSq(v);
+    }
+    return pmSqrt(speed_sq) * tc->currentvel;
+}
+
 /*! tcGetPos() function
  *
  * \brief This function calculates the machine position along the motion's path.
@@ -303,6 +479,10 @@ int tcGetPosReal(TC_STRUCT const * const tc, int of_point, EmcPose * const pos)
             uvw = tc->coords.rigidtap.uvw;
             break;
         case TC_LINEAR:
+            if (tc->independent) {
+                tcIndependentPoint(tc, progress, &xyz, &abc, &uvw);
+                break;
+            }
             pmCartLinePoint(&tc->coords.line.xyz,
                     progress * tc->coords.line.xyz.tmag / tc->target,
                     &xyz);
@@ -495,7 +675,6 @@ double pmLine9Target(PmLine9 * const line9)
     }
 }
 
-
 /**
  * Initialize a new trajectory segment with common parameters.
  *
@@ -561,6 +740,7 @@ int tcSetupState(TC_STRUCT * const tc, TP_STRUCT const * const tp)
     tc->tolerance = tp->tolerance;
     tc->synchronized = tp->synchronized;
     tc->uu_per_rev = tp->uu_per_rev;
+    tc->maxjerk = tp->jMax;
     return TP_ERR_OK;
 }
 
@@ -60,6 +60,14 @@ int pmLine9Init(PmLine9 * const line9,
         EmcPose const * const start,
         EmcPose const * const end);
 
+double tcTrapezoidTime(double dist, double vel, double acc);
+
+int tcSetupIndependent(TC_STRUCT * const tc,
+        double const * const vel,
+        double const * const acc);
+
+double tcIndependentSpeed(TC_STRUCT const * const tc);
+
 double pmCircle9Target(PmCircle9 const * const circ9);
 
 int pmCircle9Init(PmCircle9 * const circ9,
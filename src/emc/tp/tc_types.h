@@ -70,6 +70,14 @@ typedef struct {
     PmCartLine uvw;
 } PmLine9;
 
+/* Profiles of a rapid whose axes each run on their own (tcSetupIndependent),
+ * indexed x y z a b c u v w */
+typedef struct {
+    double vel[9];          // velocity limit of each axis
+    double acc[9];          // acceleration its own profile uses
+    double speed;           // cartesian speed with the linear axes at vel
+} TcIndependent;
+
 typedef struct {
     PmCircle xyz;
     PmCartLine abc;
@@ -108,6 +116,14 @@ typedef struct {
     RIGIDTAP_STATE state;
 } PmRigidTap;
 
+/* Geometry of a segment, the member used depends on its motion_type */
+typedef union {
+    PmLine9 line;
+    PmCircle9 circle;
+    PmRigidTap rigidtap;
+    Arc9 arc;
+} TcCoords;
+
 typedef struct {
     double cycle_time;
     //Position stuff
@@ -126,17 +142,12 @@ typedef struct {
 
     //Acceleration
     double maxaccel;        // accel calc'd by task
+    double currentacc;      // acceleration applied in the last cycle
+    double maxjerk;         // jerk limit, 0 for trapezoidal profiles
     double acc_ratio_tan;// ratio between normal and tangential accel
     
     int id;                 // segment's serial number
 
-    union {                 // describes the segment's start and end positions
-        PmLine9 line;
-        PmCircle9 circle;
-        PmRigidTap rigidtap;
-        Arc9 arc;
-    } coords;
-
     int motion_type;       // TC_LINEAR (coords.line) or
                             // TC_CIRCULAR (coords.circle) or
                             // TC_RIGIDTAP (coords.rigidtap)
@@ -155,9 +166,12 @@ typedef struct {
     int sync_accel;         // we're accelerating up to sync with the spindle
     unsigned char enables;  // Feed scale, etc, enable bits for this move
     int atspeed;           // wait for the spindle to be at-speed before starting this move
-    syncdio_t syncdio;      // synched DIO's for this move. what to turn on/off
+    int syncdio_changed;    // the queue's syncdio slot for this move has
+                            // DIO's to turn on/off (see tcqSyncdio)
     int indexrotary;        // which rotary axis to unlock to make this move, -1 for none
     int optimization_state;             // At peak velocity during blends)
+    double optim_vel_back;  // final velocity from the last backward pass,
+                            // before forward clamping (full look-ahead mode)
     int on_final_decel;
     int blend_prev;
     int accel_mode;
@@ -171,6 +185,15 @@ typedef struct {
 
     // Temporary status flags (reset each cycle)
     int is_blending;
+
+    int independent;        // a rapid with each axis on its own profile;
+                            // progress and target are then in seconds, and
+                            // the velocities are the rate time runs at
+    TcIndependent indep;
+
+    // The geometry is the largest part and only the active segments use
+    // it, so it goes after everything the look-ahead passes touch.
+    TcCoords coords;        // describes the segment's start and end positions
 } TC_STRUCT;
 
 #endif				/* TC_TYPES_H */
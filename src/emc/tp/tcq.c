@@ -40,21 +40,24 @@ static inline int tcqCheck(TC_QUEUE_STRUCT const * const tcq)
  * @param    tcq       pointer to the new TC_QUEUE_STRUCT
  * @param	 _size	   size of the new queue
  * @param	 tcSpace   holds the space allocated for the new queue, allocated in motion.c
+ * @param	 syncdioSpace  holds _size synched IO records, allocated in motion.c
  *
  * @return	 int	   returns success or failure
  */
-int tcqCreate(TC_QUEUE_STRUCT * const tcq, int _size, TC_STRUCT * const tcSpace)
+int tcqCreate(TC_QUEUE_STRUCT * const tcq, int _size, TC_STRUCT * const tcSpace,
+        syncdio_t * const syncdioSpace)
 {
     if (_size <= 0 || 0 == tcq) {
 	return -1;
     } else {
 	tcq->queue = tcSpace;
+	tcq->syncdio = syncdioSpace;
 	tcq->size = _size;
 	tcq->_len = 0;
 	tcq->start = tcq->end = 0;
 	tcq->allFull = 0;
 
-	if (0 == tcq->queue) {
+	if (0 == tcq->queue || 0 == tcq->syncdio) {
 	    return -1;
 	}
 	return 0;
@@ -116,10 +119,12 @@ int tcqInit(TC_QUEUE_STRUCT * const tcq)
  *
  * @param    tcq       pointer to the new TC_QUEUE_STRUCT
  * @param	 tc        the new TC element to be added
+ * @param	 syncdio   the synched IO of tc, copied if tc->syncdio_changed
  *
  * @return	 int	   returns success or failure
  */
-int tcqPut(TC_QUEUE_STRUCT * const tcq, TC_STRUCT const * const tc)
+int tcqPut(TC_QUEUE_STRUCT * const tcq, TC_STRUCT const * const tc,
+        syncdio_t const * const syncdio)
 {
     /* check for initialized */
     if (tcqCheck(tcq)) return -1;
@@ -131,6 +136,9 @@ int tcqPut(TC_QUEUE_STRUCT * const tcq, TC_STRUCT const * const tc)
 
     /* add it */
     tcq->queue[tcq->end] = *tc;
+    if (tc->syncdio_changed) {
+        tcq->syncdio[tcq->end] = *syncdio;
+    }
     tcq->_len++;
 
     /* update end ptr, modulo size of queue */
@@ -303,3 +311,17 @@ TC_STRUCT *tcqLast(TC_QUEUE_STRUCT const * const tcq)
 
 }
 
+/*! tcqSyncdio() function
+ *
+ * \brief the synched IO record of a tc in the queue
+ *
+ * @param    tcq       pointer to the TC_QUEUE_STRUCT
+ * @param	 tc        a TC element returned by tcqItem() or tcqLast()
+ *
+ * @return	 syncdio_t * the record, valid if tc->syncdio_changed
+ */
+syncdio_t * tcqSyncdio(TC_QUEUE_STRUCT const * const tcq,
+        TC_STRUCT const * const tc)
+{
+    return &tcq->syncdio[tc - tcq->queue];
+}
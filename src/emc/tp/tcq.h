@@ -25,6 +25,8 @@
 
 typedef struct {
     TC_STRUCT *queue;	/* ptr to the tcs */
+    syncdio_t *syncdio;	/* synched IO of each tc, same size as queue; kept
+			   apart since few moves have any */
     int size;			/* size of queue */
     int _len;			/* number of tcs now in queue */
     int start, end;		/* indices to next to get, next to put */
@@ -35,7 +37,7 @@ typedef struct {
 
 /* create queue of _size */
 extern int tcqCreate(TC_QUEUE_STRUCT * const tcq, int _size,
-		     TC_STRUCT * const tcSpace);
+		     TC_STRUCT * const tcSpace, syncdio_t * const syncdioSpace);
 
 /* free up queue */
 extern int tcqDelete(TC_QUEUE_STRUCT * const tcq);
@@ -43,8 +45,9 @@ extern int tcqDelete(TC_QUEUE_STRUCT * const tcq);
 /* reset queue to empty */
 extern int tcqInit(TC_QUEUE_STRUCT * const tcq);
 
-/* put tc on end */
-extern int tcqPut(TC_QUEUE_STRUCT * const tcq, TC_STRUCT const * const tc);
+/* put tc on end, with its synched IO if it has any */
+extern int tcqPut(TC_QUEUE_STRUCT * const tcq, TC_STRUCT const * const tc,
+		  syncdio_t const * const syncdio);
 
 /* remove a single tc from the back of the queue */
 extern int tcqPopBack(TC_QUEUE_STRUCT * const tcq);
@@ -63,6 +66,10 @@ extern TC_STRUCT * tcqItem(TC_QUEUE_STRUCT const * const tcq, int n);
  */
 extern TC_STRUCT * tcqLast(TC_QUEUE_STRUCT const * const tcq);
 
+/* the synched IO of a tc in the queue */
+extern syncdio_t * tcqSyncdio(TC_QUEUE_STRUCT const * const tcq,
+			      TC_STRUCT const * const tc);
+
 /* get full status */
 extern int tcqFull(TC_QUEUE_STRUCT const * const tcq);
 
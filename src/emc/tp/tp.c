@@ -11,11 +11,12 @@
 * Copyright (c) 2004 All rights reserved.
 ********************************************************************/
 #include "rtapi.h"              /* rtapi_print_msg */
-#include "posemath.h"           /* Geometry types & functions */
+#include "posemath_inline.h"    /* Geometry types & functions */
 #include "tc.h"
 #include "tp.h"
 #include "emcpose.h"
 #include "rtapi_math.h"
+#include "rtapi_string.h"       /* memcmp, memcpy, memset */
 #include "mot_priv.h"
 #include "motion_debug.h"
 #include "motion_types.h"
@@ -60,7 +61,8 @@ STATIC int tpUpdateCycle(TP_STRUCT * const tp,
 
 STATIC int tpRunOptimization(TP_STRUCT * const tp);
 
-STATIC inline int tpAddSegmentToQueue(TP_STRUCT * const tp, TC_STRUCT * const tc, int inc_id);
+STATIC inline int tpAddSegmentToQueue(TP_STRUCT * const tp, TC_STRUCT * const tc,
+        syncdio_t const * const syncdio, int inc_id);
 
 STATIC inline double tpGetMaxTargetVel(TP_STRUCT const * const tp, TC_STRUCT const * const tc);
 
@@ -246,7 +248,12 @@ STATIC inline double tpGetMaxTargetVel(TP_STRUCT const * const tp, TC_STRUCT con
      */
     if (!tcPureRotaryCheck(tc) && (tc->synchronized != TC_SYNC_POSITION)){
         /*tc_debug_print("Cartesian velocity limit active\n");*/
-        v_max_target = fmin(v_max_target,tp->vLimit);
+        if (tc->independent) {
+            // The rate, so that the axes together stay under the limit
+            v_max_target = fmin(v_max_target, tp->vLimit / tc->indep.speed);
+        } else {
+            v_max_target = fmin(v_max_target,tp->vLimit);
+        }
     }
 
     // Clip maximum velocity by the segment's own maximum velocity
@@ -319,7 +326,8 @@ STATIC inline double tpGetSignedSpindlePosition(double spindle_pos, int spindle_
 /**
  * Create the trajectory planner structure with an empty queue.
  */
-int tpCreate(TP_STRUCT * const tp, int _queueSize, TC_STRUCT * const tcSpace)
+int tpCreate(TP_STRUCT * const tp, int _queueSize, TC_STRUCT * const tcSpace,
+        syncdio_t * const syncdioSpace)
 {
     if (0 == tp) {
         return TP_ERR_FAIL;
@@ -332,7 +340,7 @@ int tpCreate(TP_STRUCT * const tp, int _queueSize, TC_STRUCT * const tcSpace)
     }
 
     /* create the queue */
-    if (-1 == tcqCreate(&tp->queue, tp->queueSize, tcSpace)) {
+    if (-1 == tcqCreate(&tp->queue, tp->queueSize, tcSpace, syncdioSpace)) {
         return TP_ERR_FAIL;
     }
 
@@ -409,6 +417,7 @@ int tpInit(TP_STRUCT * const tp)
     tp->ini_maxvel = 0.0;
     //Accelerations
     tp->aLimit = 0.0;
+    tp->jMax = 0.0;
     PmCartesian acc_bound;
     //FIXME this acceleration bound isn't valid (nor is it used)
     tpGetMachineAccelBounds(&acc_bound);
@@ -428,6 +437,12 @@ int tpInit(TP_STRUCT * const tp)
     tpGetMachineVelBounds(&vel_bound);
     tpGetMachineActiveLimit(&tp->vMax, &vel_bound);
 
+    int i;
+    for (i = 0; i < TP_BLEND_CACHE_SIZE; ++i) {
+        tp->blend_cache[i].valid = 0;
+    }
+    tpClearStats(tp);
+
     return tpClear(tp);
 }
 
@@ -495,6 +510,21 @@ int tpSetAmax(TP_STRUCT * const tp, double aMax)
     return TP_ERR_OK;
 }
 
+/**
+ * Set the jerk limit for subsequent motions.
+ * A value of zero selects trapezoidal velocity profiles.
+ */
+int tpSetJmax(TP_STRUCT * const tp, double jMax)
+{
+    if (0 == tp || jMax < 0.0) {
+        return TP_ERR_FAIL;
+    }
+
+    tp->jMax = jMax;
+
+    return TP_ERR_OK;
+}
+
 /**
  * Sets the id that will be used for the next appended motions.
  * nextId is incremented so that the next time a motion is appended its id will
@@ -664,6 +694,41 @@ STATIC double tpCalculateTriangleVel(TP_STRUCT const * const tp, TC_STRUCT * con
 }
 
 
+/**
+ * Find the highest velocity from which a jerk-limited stop to v_final fits in length.
+ * This inverts the S-curve stopping distance (starting with zero
+ * acceleration), so that the look-ahead plans speeds the S-curve profile can
+ * actually slow down from.
+ */
+STATIC double tpCalculateSCurveBackwardVel(double v_final, double length,
+        double a_max, double j_max)
+{
+    // Profile that reaches full deceleration: solve the quadratic directly
+    double a2_j = pmSq(a_max) / j_max;
+    double c = v_final * a2_j - pmSq(v_final) - 2.0 * a_max * length;
+    double v_full = 0.5 * (-a2_j + pmSqrt(pmSq(a2_j) - 4.0 * c));
+    if (v_full - v_final >= a2_j) {
+        return v_full;
+    }
+
+    // Triangular acceleration profile (never reaches a_max), d = (v + vf) * sqrt((v - vf) / j).
+    // Monotonic in v, so bisect between vf and the trapezoidal limit.
+    double v_lo = v_final;
+    double v_hi = pmSqrt(pmSq(v_final) + 2.0 * a_max * length);
+    int i;
+    for (i = 0; i < 30; ++i) {
+        double v_mid = 0.5 * (v_lo + v_hi);
+        double d = (v_mid + v_final) * pmSqrt((v_mid - v_final) / j_max);
+        if (d > length) {
+            v_hi = v_mid;
+        } else {
+            v_lo = v_mid;
+        }
+    }
+    return v_lo;
+}
+
+
 /**
  * Handles the special case of blending into an unfinalized segment.
  * The problem here is that the last segment in the queue can always be cut
@@ -677,6 +742,10 @@ STATIC double tpCalculateOptimizationInitialVel(TP_STRUCT const * const tp, TC_S
     double acc_scaled = tpGetScaledAccel(tp, tc);
     //FIXME this is defined in two places!
     double triangle_vel = pmSqrt( acc_scaled * tc->target * BLEND_DIST_FRACTION);
+    if (tc->maxjerk > 0.0) {
+        triangle_vel = tpCalculateSCurveBackwardVel(0.0, tc->target * BLEND_DIST_FRACTION,
+                acc_scaled, tc->maxjerk);
+    }
     double max_vel = tpGetMaxTargetVel(tp, tc);
     tp_debug_print("optimization initial vel for segment %d is %f\n", tc->id, triangle_vel);
     return fmin(triangle_vel, max_vel);
@@ -716,7 +785,8 @@ STATIC int tpInitBlendArcFromPrev(TP_STRUCT const * const tp, TC_STRUCT const *
             acc);
 
     // Skip syncdio setup since this blend extends the previous line
-    blend_tc->syncdio = prev_line_tc->syncdio; //enqueue the list of DIOs that need toggling
+    // (tpHandleBlendArc queues it with the previous line's DIOs)
+    blend_tc->syncdio_changed = prev_line_tc->syncdio_changed;
 
     // find "helix" length for target
     double length;
@@ -790,7 +860,8 @@ STATIC int tpCheckTangentPerformance(TP_STRUCT const * const tp,
 }
 
 
-STATIC int tpCreateLineArcBlend(TP_STRUCT * const tp, TC_STRUCT * const prev_tc, TC_STRUCT * const tc, TC_STRUCT * const blend_tc)
+STATIC int tpCreateLineArcBlend(TP_STRUCT * const tp, TC_STRUCT * const prev_tc, TC_STRUCT * const tc, TC_STRUCT * const blend_tc,
+        BlendGeom3 * const geom)
 {
     tp_debug_print("-- Starting LineArc blend arc --\n");
 
@@ -801,12 +872,11 @@ STATIC int tpCreateLineArcBlend(TP_STRUCT * const tp, TC_STRUCT * const prev_tc,
     tpGetMachineVelBounds(&vel_bound);
 
     //Populate blend geometry struct
-    BlendGeom3 geom;
     BlendParameters param;
     BlendPoints3 points_approx;
     BlendPoints3 points_exact;
 
-    int res_init = blendInit3FromLineArc(&geom, &param,
+    int res_init = blendInit3FromLineArc(geom, &param,
             prev_tc,
             tc,
             &acc_bound,
@@ -819,24 +889,14 @@ STATIC int tpCreateLineArcBlend(TP_STRUCT * const tp, TC_STRUCT * const prev_tc,
         return res_init;
     }
 
-    // Check for coplanarity based on binormal and tangents
-    int coplanar = pmCartCartParallel(&geom.binormal,
-            &tc->coords.circle.xyz.normal,
-            TP_ANGLE_EPSILON);
-
-    if (!coplanar) {
-        tp_debug_print("aborting arc, not coplanar\n");
-        return TP_ERR_FAIL;
-    }
-
     int res_param = blendComputeParameters(&param);
 
-    int res_points = blendFindPoints3(&points_approx, &geom, &param);
+    int res_points = blendFindPoints3(&points_approx, geom, &param);
     
     int res_post = blendLineArcPostProcess(&points_exact,
             &points_approx,
             &param, 
-            &geom, &prev_tc->coords.line.xyz,
+            geom, &prev_tc->coords.line.xyz,
             &tc->coords.circle.xyz);
 
     //Catch errors in blend setup
@@ -892,10 +952,15 @@ STATIC int tpCreateLineArcBlend(TP_STRUCT * const tp, TC_STRUCT * const prev_tc,
             &points_exact.arc_end);
     //TODO deal with large spiral values, or else detect and fall back?
 
+    if (blendCheckPlaneDeviation(&points_exact, geom, &param)) {
+        tp_debug_print("arc leaves blend plane, aborting arc\n");
+        return TP_ERR_FAIL;
+    }
+
     blendPoints3Print(&points_exact);
     int res_arc = arcFromBlendPoints3(&blend_tc->coords.arc.xyz,
             &points_exact,
-            &geom,
+            geom,
             &param);
     if (res_arc < 0) {
         tp_debug_print("arc creation failed, aborting arc\n");
@@ -914,7 +979,7 @@ STATIC int tpCreateLineArcBlend(TP_STRUCT * const tp, TC_STRUCT * const prev_tc,
 
     int res_tangent = checkTangentAngle(&circ2_temp,
             &blend_tc->coords.arc.xyz,
-            &geom,
+            geom,
             &param,
             tp->cycleTime,
             true);
@@ -952,7 +1017,8 @@ STATIC int tpCreateLineArcBlend(TP_STRUCT * const tp, TC_STRUCT * const prev_tc,
 }
 
 
-STATIC int tpCreateArcLineBlend(TP_STRUCT * const tp, TC_STRUCT * const prev_tc, TC_STRUCT * const tc, TC_STRUCT * const blend_tc)
+STATIC int tpCreateArcLineBlend(TP_STRUCT * const tp, TC_STRUCT * const prev_tc, TC_STRUCT * const tc, TC_STRUCT * const blend_tc,
+        BlendGeom3 * const geom)
 {
 
     tp_debug_print("-- Starting ArcLine blend arc --\n");
@@ -963,13 +1029,12 @@ STATIC int tpCreateArcLineBlend(TP_STRUCT * const tp, TC_STRUCT * const prev_tc,
     tpGetMachineVelBounds(&vel_bound);
 
     //Populate blend geometry struct
-    BlendGeom3 geom;
     BlendParameters param;
     BlendPoints3 points_approx;
     BlendPoints3 points_exact;
     param.consume = 0;
 
-    int res_init = blendInit3FromArcLine(&geom, &param,
+    int res_init = blendInit3FromArcLine(geom, &param,
             prev_tc,
             tc,
             &acc_bound,
@@ -981,24 +1046,14 @@ STATIC int tpCreateArcLineBlend(TP_STRUCT * const tp, TC_STRUCT * const prev_tc,
         return res_init;
     }
 
-    // Check for coplanarity based on binormal
-    int coplanar = pmCartCartParallel(&geom.binormal,
-            &prev_tc->coords.circle.xyz.normal,
-            TP_ANGLE_EPSILON);
-
-    if (!coplanar) {
-        tp_debug_print("aborting arc, not coplanar\n");
-        return TP_ERR_FAIL;
-    }
-
     int res_param = blendComputeParameters(&param);
 
-    int res_points = blendFindPoints3(&points_approx, &geom, &param);
+    int res_points = blendFindPoints3(&points_approx, geom, &param);
     
     int res_post = blendArcLinePostProcess(&points_exact,
             &points_approx,
             &param, 
-            &geom, &prev_tc->coords.circle.xyz,
+            geom, &prev_tc->coords.circle.xyz,
             &tc->coords.line.xyz);
 
     //Catch errors in blend setup
@@ -1056,9 +1111,14 @@ STATIC int tpCreateArcLineBlend(TP_STRUCT * const tp, TC_STRUCT * const prev_tc,
             0.0,
             &points_exact.arc_end);
 
+    if (blendCheckPlaneDeviation(&points_exact, geom, &param)) {
+        tp_debug_print("arc leaves blend plane, aborting arc\n");
+        return TP_ERR_FAIL;
+    }
+
     blendPoints3Print(&points_exact);
 
-    int res_arc = arcFromBlendPoints3(&blend_tc->coords.arc.xyz, &points_exact, &geom, &param);
+    int res_arc = arcFromBlendPoints3(&blend_tc->coords.arc.xyz, &points_exact, geom, &param);
     if (res_arc < 0) {
         return TP_ERR_FAIL;
     }
@@ -1073,7 +1133,7 @@ STATIC int tpCreateArcLineBlend(TP_STRUCT * const tp, TC_STRUCT * const prev_tc,
             param.v_plan, param.a_max);
     blend_tc->target_vel = param.v_actual;
 
-    int res_tangent = checkTangentAngle(&circ1_temp, &blend_tc->coords.arc.xyz, &geom, &param, tp->cycleTime, false);
+    int res_tangent = checkTangentAngle(&circ1_temp, &blend_tc->coords.arc.xyz, geom, &param, tp->cycleTime, false);
     if (res_tangent) {
         tp_debug_print("failed tangent check, aborting arc...\n");
         return TP_ERR_FAIL;
@@ -1094,18 +1154,11 @@ STATIC int tpCreateArcLineBlend(TP_STRUCT * const tp, TC_STRUCT * const prev_tc,
     return TP_ERR_OK;
 }
 
-STATIC int tpCreateArcArcBlend(TP_STRUCT * const tp, TC_STRUCT * const prev_tc, TC_STRUCT * const tc, TC_STRUCT * const blend_tc)
+STATIC int tpCreateArcArcBlend(TP_STRUCT * const tp, TC_STRUCT * const prev_tc, TC_STRUCT * const tc, TC_STRUCT * const blend_tc,
+        BlendGeom3 * const geom)
 {
 
     tp_debug_print("-- Starting ArcArc blend arc --\n");
-    //TODO type checks
-    int colinear = pmCartCartParallel(&prev_tc->coords.circle.xyz.normal,
-            &tc->coords.circle.xyz.normal, TP_ANGLE_EPSILON);
-    if (!colinear) {
-        // Fail out if not collinear
-        tp_debug_print("arc abort: not coplanar\n");
-        return TP_ERR_FAIL;
-    }
 
     PmCartesian acc_bound, vel_bound;
     
@@ -1114,12 +1167,11 @@ STATIC int tpCreateArcArcBlend(TP_STRUCT * const tp, TC_STRUCT * const prev_tc,
     tpGetMachineVelBounds(&vel_bound);
 
     //Populate blend geometry struct
-    BlendGeom3 geom;
     BlendParameters param;
     BlendPoints3 points_approx;
     BlendPoints3 points_exact;
 
-    int res_init = blendInit3FromArcArc(&geom, &param,
+    int res_init = blendInit3FromArcArc(geom, &param,
             prev_tc,
             tc,
             &acc_bound,
@@ -1132,32 +1184,13 @@ STATIC int tpCreateArcArcBlend(TP_STRUCT * const tp, TC_STRUCT * const prev_tc,
         return res_init;
     }
 
-    int coplanar1 = pmCartCartParallel(&geom.binormal,
-            &prev_tc->coords.circle.xyz.normal,
-            TP_ANGLE_EPSILON);
-
-    if (!coplanar1) {
-        tp_debug_print("aborting blend arc, arc id %d is not coplanar with binormal\n", prev_tc->id);
-        return TP_ERR_FAIL;
-    }
-
-    int coplanar2 = pmCartCartParallel(&geom.binormal,
-            &tc->coords.circle.xyz.normal,
-            TP_ANGLE_EPSILON);
-    if (!coplanar2) {
-        tp_debug_print("aborting blend arc, arc id %d is not coplanar with binormal\n", tc->id);
-        return TP_ERR_FAIL;
-    }
-
-
-
     int res_param = blendComputeParameters(&param);
-    int res_points = blendFindPoints3(&points_approx, &geom, &param);
+    int res_points = blendFindPoints3(&points_approx, geom, &param);
     
     int res_post = blendArcArcPostProcess(&points_exact,
             &points_approx,
             &param, 
-            &geom, &prev_tc->coords.circle.xyz,
+            geom, &prev_tc->coords.circle.xyz,
             &tc->coords.circle.xyz);
 
     //Catch errors in blend setup
@@ -1225,9 +1258,14 @@ STATIC int tpCreateArcArcBlend(TP_STRUCT * const tp, TC_STRUCT * const prev_tc,
             0.0,
             &points_exact.arc_end);
 
+    if (blendCheckPlaneDeviation(&points_exact, geom, &param)) {
+        tp_debug_print("arcs leave blend plane, aborting arc\n");
+        return TP_ERR_FAIL;
+    }
+
     tp_debug_print("Modified arc points\n");
     blendPoints3Print(&points_exact);
-    int res_arc = arcFromBlendPoints3(&blend_tc->coords.arc.xyz, &points_exact, &geom, &param);
+    int res_arc = arcFromBlendPoints3(&blend_tc->coords.arc.xyz, &points_exact, geom, &param);
     if (res_arc < 0) {
         return TP_ERR_FAIL;
     }
@@ -1242,8 +1280,8 @@ STATIC int tpCreateArcArcBlend(TP_STRUCT * const tp, TC_STRUCT * const prev_tc,
             param.v_plan, param.a_max);
     blend_tc->target_vel = param.v_actual;
 
-    int res_tangent1 = checkTangentAngle(&circ1_temp, &blend_tc->coords.arc.xyz, &geom, &param, tp->cycleTime, false);
-    int res_tangent2 = checkTangentAngle(&circ2_temp, &blend_tc->coords.arc.xyz, &geom, &param, tp->cycleTime, true);
+    int res_tangent1 = checkTangentAngle(&circ1_temp, &blend_tc->coords.arc.xyz, geom, &param, tp->cycleTime, false);
+    int res_tangent2 = checkTangentAngle(&circ2_temp, &blend_tc->coords.arc.xyz, geom, &param, tp->cycleTime, true);
     if (res_tangent1 || res_tangent2) {
         tp_debug_print("failed tangent check, aborting arc...\n");
         return TP_ERR_FAIL;
@@ -1267,7 +1305,8 @@ STATIC int tpCreateArcArcBlend(TP_STRUCT * const tp, TC_STRUCT * const prev_tc,
 
 
 STATIC int tpCreateLineLineBlend(TP_STRUCT * const tp, TC_STRUCT * const prev_tc,
-        TC_STRUCT * const tc, TC_STRUCT * const blend_tc)
+        TC_STRUCT * const tc, TC_STRUCT * const blend_tc,
+        BlendGeom3 * const geom)
 {
 
     tp_debug_print("-- Starting LineLine blend arc --\n");
@@ -1278,11 +1317,10 @@ STATIC int tpCreateLineLineBlend(TP_STRUCT * const tp, TC_STRUCT * const prev_tc
     tpGetMachineVelBounds(&vel_bound);
     
     // Setup blend data structures
-    BlendGeom3 geom;
     BlendParameters param;
     BlendPoints3 points;
 
-    int res_init = blendInit3FromLineLine(&geom, &param,
+    int res_init = blendInit3FromLineLine(geom, &param,
             prev_tc,
             tc,
             &acc_bound,
@@ -1300,12 +1338,12 @@ STATIC int tpCreateLineLineBlend(TP_STRUCT * const tp, TC_STRUCT * const prev_tc
         return res_blend;
     }
 
-    blendFindPoints3(&points, &geom, &param);
+    blendFindPoints3(&points, geom, &param);
 
     blendCheckConsume(&param, &points, prev_tc, emcmotConfig->arcBlendGapCycles);
 
     // Set up actual blend arc here
-    int res_arc = arcFromBlendPoints3(&blend_tc->coords.arc.xyz, &points, &geom, &param);
+    int res_arc = arcFromBlendPoints3(&blend_tc->coords.arc.xyz, &points, geom, &param);
     if (res_arc < 0) {
         return TP_ERR_FAIL;
     }
@@ -1351,14 +1389,21 @@ STATIC int tpCreateLineLineBlend(TP_STRUCT * const tp, TC_STRUCT * const prev_tc
  * Add a newly created motion segment to the tp queue.
  * Returns an error code if the queue operation fails, otherwise adds a new
  * segment to the queue and updates the end point of the trajectory planner.
+ * syncdio is the synched IO of the segment, used if tc->syncdio_changed.
  */
-STATIC inline int tpAddSegmentToQueue(TP_STRUCT * const tp, TC_STRUCT * const tc, int inc_id) {
+STATIC inline int tpAddSegmentToQueue(TP_STRUCT * const tp, TC_STRUCT * const tc,
+        syncdio_t const * const syncdio, int inc_id) {
 
     tc->id = tp->nextId;
-    if (tcqPut(&tp->queue, tc) == -1) {
+    if (tcqPut(&tp->queue, tc, syncdio) == -1) {
         rtapi_print_msg(RTAPI_MSG_ERR, "tcqPut failed.\n");
         return TP_ERR_FAIL;
     }
+    if (tc->syncdio_changed && syncdio == &tp->syncdio) {
+        // the queue has its own copy now, clear out the list in order to
+        // prepare for the next time we need to use it
+        tpClearDIOs(tp);
+    }
     if (inc_id) {
         tp->nextId++;
     }
@@ -1389,13 +1434,16 @@ STATIC int tpCheckCanonType(TC_STRUCT * const prev_tc, TC_STRUCT const * const t
     return TP_ERR_OK;
 }
 
+/**
+ * Flag a new segment for the DIOs set since the last one.  The list itself
+ * is copied into the queue by tpAddSegmentToQueue().
+ */
 STATIC int tpSetupSyncedIO(TP_STRUCT * const tp, TC_STRUCT * const tc) {
     if (tp->syncdio.anychanged != 0) {
-        tc->syncdio = tp->syncdio; //enqueue the list of DIOs that need toggling
-        tpClearDIOs(tp); // clear out the list, in order to prepare for the next time we need to use it
+        tc->syncdio_changed = 1;
         return TP_ERR_OK;
     } else {
-        tc->syncdio.anychanged = 0;
+        tc->syncdio_changed = 0;
         return TP_ERR_NO_ACTION;
     }
 }
@@ -1456,7 +1504,7 @@ int tpAddRigidTap(TP_STRUCT * const tp, EmcPose end, double vel, double ini_maxv
     prev_tc = tcqLast(&tp->queue);
     tcFinalizeLength(prev_tc);
     tcFlagEarlyStop(prev_tc, &tc);
-    int retval = tpAddSegmentToQueue(tp, &tc, true);
+    int retval = tpAddSegmentToQueue(tp, &tc, &tp->syncdio, true);
     tpRunOptimization(tp);
     return retval;
 }
@@ -1518,6 +1566,9 @@ STATIC int tpComputeOptimalVelocity(TP_STRUCT const * const tp, TC_STRUCT * cons
 
     // Find the reachable velocity of tc, moving backwards in time
     double vs_back = pmSqrt(pmSq(tc->finalvel) + 2.0 * acc_this * tc->target);
+    if (tc->maxjerk > 0.0) {
+        vs_back = tpCalculateSCurveBackwardVel(tc->finalvel, tc->target, acc_this, tc->maxjerk);
+    }
     // Find the reachable velocity of prev1_tc, moving forwards in time
 
     double vf_limit_this = tc->maxvel;
@@ -1545,15 +1596,163 @@ STATIC int tpComputeOptimalVelocity(TP_STRUCT const * const tp, TC_STRUCT * cons
 }
 
 
+/**
+ * Clamp final velocities of re-planned segments to what is reachable going forwards.
+ * Starting from the final velocity of the segment in front of first_ind, each
+ * segment can at most accelerate over its own length. The front of the queue
+ * is never clamped since its actual starting velocity isn't known here.
+ */
+STATIC int tpRunForwardOptimization(TP_STRUCT * const tp, int first_ind) {
+    TC_STRUCT *tc;
+    TC_STRUCT *prev1_tc;
+
+    int len = tcqLen(&tp->queue);
+    int ind;
+    int hit_peaks = 0;
+
+    if (first_ind < 1) {
+        first_ind = 1;
+    }
+
+    for (ind = first_ind; ind < len - 1; ++ind) {
+        tc = tcqItem(&tp->queue, ind);
+        prev1_tc = tcqItem(&tp->queue, ind-1);
+
+        if (!prev1_tc || !tc) {
+            break;
+        }
+
+        double v_prev = prev1_tc->finalvel;
+        if (prev1_tc->term_cond != TC_TERM_COND_TANGENT) {
+            if (prev1_tc->term_cond == TC_TERM_COND_PARABOLIC || tc->blend_prev) {
+                // Parabolic blends overlap the two segments, so there is no
+                // well-defined start velocity to clamp from
+                continue;
+            }
+            v_prev = 0.0;
+        }
+
+        // Already moving, so the start velocity is outside our control
+        if (tc->progress > 0.0 || tc->term_cond != TC_TERM_COND_TANGENT) {
+            continue;
+        }
+
+        double acc_this = tpGetScaledAccel(tp, tc);
+        double vf_reach = pmSqrt(pmSq(v_prev) + 2.0 * acc_this * tc->target);
+        if (tc->finalvel > vf_reach) {
+            tp_info_print(" forward clamp id %d, fv = %f -> %f\n",
+                    tc->id, tc->finalvel, vf_reach);
+            tc->finalvel = vf_reach;
+            tc->optimization_state = TC_OPTIM_UNTOUCHED;
+        }
+        if (tc->optimization_state == TC_OPTIM_AT_MAX) {
+            hit_peaks++;
+        }
+        tc->active_depth = len - 1 - ind - hit_peaks;
+    }
+    return TP_ERR_OK;
+}
+
+
+/**
+ * Full-queue version of the "rising tide" optimization.
+ * Same backward pass as tpRunOptimization, but not limited to a fixed depth.
+ * Each call only re-plans the suffix of the queue that the newest segment
+ * invalidates: once the backward pass produces the same final velocity for a
+ * segment as last time, everything in front of it was already planned against
+ * that value and the walk stops. A forward pass then clamps the re-planned
+ * segments to their reachable velocities.
+ */
+STATIC int tpRunFullOptimization(TP_STRUCT * const tp) {
+    TC_STRUCT *tc;
+    TC_STRUCT *prev1_tc;
+
+    int ind, x;
+    int len = tcqLen(&tp->queue);
+    // Front-most segment whose final velocity was re-planned in this pass
+    int first_ind = len;
+    bool hit_non_tangent = false;
+
+    for (x = 1; x < len; ++x) {
+        tp_info_print("==== Full optimization step %d ====\n",x);
+
+        ind = len-x;
+        tc = tcqItem(&tp->queue, ind);
+        prev1_tc = tcqItem(&tp->queue, ind-1);
+
+        if ( !prev1_tc || !tc) {
+            tp_debug_print(" Reached end of queue in optimization\n");
+            break;
+        }
+
+        if (prev1_tc->term_cond != TC_TERM_COND_TANGENT) {
+            if (hit_non_tangent) {
+                tp_debug_print("Found 2nd non-tangent segment, stopping optimization\n");
+                break;
+            } else  {
+                tp_debug_print("Found first non-tangent segment, contining\n");
+                hit_non_tangent = true;
+                continue;
+            }
+        }
+
+        double progress_ratio = prev1_tc->progress / prev1_tc->target;
+        double cutoff_ratio = BLEND_DIST_FRACTION / 2.0;
+
+        if (progress_ratio >= cutoff_ratio) {
+            tp_debug_print("segment %d has moved past %f percent progress, cannot blend safely!\n",
+                    ind-1, cutoff_ratio * 100.0);
+            break;
+        }
+
+        if (prev1_tc->splitting || prev1_tc->blending_next) {
+            tp_debug_print("segment %d is already blending, cannot optimize safely!\n",
+                    ind-1);
+            break;
+        }
+
+        if (tc->atspeed) {
+            tp_debug_print("Found atspeed at id %d\n",tc->id);
+            tc->finalvel = 0.0;
+        }
+
+        double vf_back_old = prev1_tc->optim_vel_back;
+        if (!tc->finalized) {
+            tp_debug_print("Segment %d, type %d not finalized, continuing\n",tc->id,tc->motion_type);
+            prev1_tc->finalvel = fmin(prev1_tc->maxvel, tpCalculateOptimizationInitialVel(tp,tc));
+            tc->finalvel = 0.0;
+        } else {
+            tpComputeOptimalVelocity(tp, tc, prev1_tc);
+        }
+        prev1_tc->optim_vel_back = prev1_tc->finalvel;
+        first_ind = ind-1;
+
+        // The tail segments always change, past those an unchanged result
+        // means the rest of the queue is already consistent.
+        if (x > 2 && fabs(prev1_tc->finalvel - vf_back_old) < TP_VEL_EPSILON) {
+            tp_debug_print("Backward pass converged at segment %d\n", prev1_tc->id);
+            break;
+        }
+    }
+
+    return tpRunForwardOptimization(tp, first_ind);
+}
+
+
 /**
  * Do "rising tide" optimization to find allowable final velocities for each queued segment.
  * Walk along the queue from the back to the front. Based on the "current"
  * segment's final velocity, calculate the previous segment's maximum allowable
- * final velocity. The depth we walk along the queue is controlled by the
- * TP_LOOKAHEAD_DEPTH constant for now. The process safetly aborts early due to
+ * final velocity. The depth we walk along the queue is controlled by
+ * [TRAJ]ARC_BLEND_OPTIMIZATION_DEPTH, unless full look-ahead is enabled by
+ * [TRAJ]ARC_BLEND_OPTIMIZATION_MODE. The process safetly aborts early due to
  * a short queue or other conflicts.
  */
 STATIC int tpRunOptimization(TP_STRUCT * const tp) {
+    if (emcmotConfig->arcBlendOptMode == TP_OPTIM_MODE_FULL) {
+        return tpRunFullOptimization(tp);
+    }
+
     // Pointers to the "current", previous, and 2nd previous trajectory
     // components. Current in this context means the segment being optimized,
     // NOT the currently excecuting segment.
@@ -1679,7 +1878,8 @@ STATIC int tpAdjustAccelForTangent(TP_STRUCT const * const tp,
  * rate.
  */
 STATIC int tpSetupTangent(TP_STRUCT const * const tp,
-        TC_STRUCT * const prev_tc, TC_STRUCT * const tc) {
+        TC_STRUCT * const prev_tc, TC_STRUCT * const tc,
+        BlendGeom3 const * const geom) {
     if (!tc || !prev_tc) {
         tp_debug_print("missing tc or prev tc in tangent check\n");
         return TP_ERR_FAIL;
@@ -1701,14 +1901,8 @@ STATIC int tpSetupTangent(TP_STRUCT const * const tp,
         return TP_ERR_FAIL;
     }
 
-    PmCartesian prev_tan, this_tan;
-
-    int res_endtan = tcGetEndTangentUnitVector(prev_tc, &prev_tan);
-    int res_starttan = tcGetStartTangentUnitVector(tc, &this_tan);
-    if (res_endtan || res_starttan) {
-        tp_debug_print("Got %d and %d from tangent vector calc\n",
-                res_endtan, res_starttan);
-    }
+    PmCartesian const prev_tan = geom->u_tan1;
+    PmCartesian const this_tan = geom->u_tan2;
 
     tp_debug_print("prev tangent vector: %f %f %f\n", prev_tan.x, prev_tan.y, prev_tan.z);
     tp_debug_print("this tangent vector: %f %f %f\n", this_tan.x, this_tan.y, this_tan.z);
@@ -1780,6 +1974,83 @@ STATIC int tpSetupTangent(TP_STRUCT const * const tp,
 }
 
 
+/**
+ * Get the limits a blend arc solve reads, with the padding cleared so that
+ * they can be compared as bytes.
+ */
+STATIC void tpBlendCacheLimits(TP_STRUCT const * const tp,
+        tp_blend_limits_t * const limits)
+{
+    memset(limits, 0, sizeof(*limits));
+    tpGetMachineAccelBounds(&limits->acc_bound);
+    tpGetMachineVelBounds(&limits->vel_bound);
+    limits->cycle_time = tp->cycleTime;
+    limits->max_feed_scale = emcmotConfig->maxFeedScale;
+    limits->gap_cycles = emcmotConfig->arcBlendGapCycles;
+}
+
+/**
+ * Get the fields of a segment that a blend arc solve reads, with the padding
+ * cleared so that they can be compared as bytes.
+ */
+STATIC void tpBlendCacheInput(TC_STRUCT const * const tc,
+        tp_blend_input_t * const in)
+{
+    memset(in, 0, sizeof(*in));
+    memcpy(&in->coords, &tc->coords, sizeof(in->coords));
+    in->cycle_time = tc->cycle_time;
+    in->target = tc->target;
+    in->nominal_length = tc->nominal_length;
+    in->reqvel = tc->reqvel;
+    in->maxvel = tc->maxvel;
+    in->kink_vel = tc->kink_vel;
+    in->maxjerk = tc->maxjerk;
+    in->tolerance = tc->tolerance;
+    in->motion_type = tc->motion_type;
+    in->canon_motion_type = tc->canon_motion_type;
+    in->term_cond = tc->term_cond;
+    in->atspeed = tc->atspeed;
+    in->syncdio_changed = tc->syncdio_changed;
+    in->blend_prev = tc->blend_prev;
+    in->finalized = tc->finalized;
+    in->enables = tc->enables;
+}
+
+STATIC void tpBlendCacheSave(TC_STRUCT const * const tc,
+        tp_blend_output_t * const out)
+{
+    memcpy(&out->coords, &tc->coords, sizeof(out->coords));
+    out->target = tc->target;
+    out->kink_vel = tc->kink_vel;
+    out->term_cond = tc->term_cond;
+    out->blend_prev = tc->blend_prev;
+}
+
+STATIC void tpBlendCacheRestore(tp_blend_output_t const * const out,
+        TC_STRUCT * const tc)
+{
+    memcpy(&tc->coords, &out->coords, sizeof(tc->coords));
+    tc->target = out->target;
+    tc->kink_vel = out->kink_vel;
+    tc->term_cond = out->term_cond;
+    tc->blend_prev = out->blend_prev;
+}
+
+/**
+ * Check that a blend cache entry was solved for this pair of segment ids,
+ * from the same segments and limits.
+ */
+STATIC int tpBlendCacheMatch(tp_blend_cache_t const * const entry,
+        int prev_id, int id, tp_blend_input_t const * const in_prev_tc,
+        tp_blend_input_t const * const in_tc,
+        tp_blend_limits_t const * const limits)
+{
+    return entry->valid && entry->prev_id == prev_id && entry->id == id &&
+        memcmp(&entry->in_prev_tc, in_prev_tc, sizeof(*in_prev_tc)) == 0 &&
+        memcmp(&entry->in_tc, in_tc, sizeof(*in_tc)) == 0 &&
+        memcmp(&entry->limits, limits, sizeof(*limits)) == 0;
+}
+
 /**
  * Handle creating a blend arc when a new line segment is about to enter the queue.
  * This function handles the checks, setup, and calculations for creating a new
@@ -1806,9 +2077,14 @@ STATIC int tpHandleBlendArc(TP_STRUCT * const tp, TC_STRUCT * const tc) {
         return TP_ERR_FAIL;
     }
 
+    // Tangents and intersection point are shared by the tangency check and
+    // the blend arc setup
+    BlendGeom3 geom;
+    int res_geom = blendGeom3Tangents(&geom, prev_tc, tc);
+
     // Check for tangency between segments and handle any errors
     // TODO possibly refactor this into a macro?
-    int res_tan = tpSetupTangent(tp, prev_tc, tc);
+    int res_tan = tpSetupTangent(tp, prev_tc, tc, &geom);
     switch (res_tan) {
         // Abort blend arc creation in these cases
         case TP_ERR_FAIL:
@@ -1822,22 +2098,58 @@ STATIC int tpHandleBlendArc(TP_STRUCT * const tp, TC_STRUCT * const tc) {
             break;
     }
 
+    if (res_geom != TP_ERR_OK) {
+        tp_debug_print(" blend geometry failed with code %d, aborting blend arc\n", res_geom);
+        return TP_ERR_FAIL;
+    }
+
     TC_STRUCT blend_tc = {0};
 
+    // The same pair of segments is queued again when a program is resumed
+    // or rerun after an abort; reuse the arc solved for it then. tc gets
+    // its id when it is queued, which will be nextId. Pairs of consecutive
+    // ids step through all of the entries.
+    tp_blend_limits_t limits;
+    tp_blend_input_t in_prev_tc, in_tc;
+    int prev_id = prev_tc->id;
+    tpBlendCacheLimits(tp, &limits);
+    tpBlendCacheInput(prev_tc, &in_prev_tc);
+    tpBlendCacheInput(tc, &in_tc);
+    tp_blend_cache_t *entry = &tp->blend_cache[
+        ((unsigned)prev_id * 16 + (unsigned)tp->nextId) & (TP_BLEND_CACHE_SIZE - 1)];
+    if (tpBlendCacheMatch(entry, prev_id, tp->nextId,
+                &in_prev_tc, &in_tc, &limits)) {
+        tp_debug_print(" reusing blend arc from cache\n");
+        blend_tc.coords.arc = entry->blend_arc;
+        tpInitBlendArcFromPrev(tp, prev_tc, &blend_tc, entry->blend_reqvel,
+                entry->blend_maxvel, entry->blend_maxaccel);
+        blend_tc.target_vel = entry->blend_target_vel;
+        if (entry->consume) {
+            tcqPopBack(&tp->queue);
+        } else {
+            tpBlendCacheRestore(&entry->prev_tc, prev_tc);
+        }
+        tpBlendCacheRestore(&entry->tc, tc);
+        tpAddSegmentToQueue(tp, &blend_tc,
+                tcqSyncdio(&tp->queue, prev_tc), false);
+        return TP_ERR_OK;
+    }
+    int queue_len = tcqLen(&tp->queue);
+
     blend_type_t type = tpCheckBlendArcType(tp, prev_tc, tc);
     int res_create;
     switch (type) { 
         case BLEND_LINE_LINE:
-            res_create = tpCreateLineLineBlend(tp, prev_tc, tc, &blend_tc);
+            res_create = tpCreateLineLineBlend(tp, prev_tc, tc, &blend_tc, &geom);
             break;
         case BLEND_LINE_ARC:
-            res_create = tpCreateLineArcBlend(tp, prev_tc, tc, &blend_tc);
+            res_create = tpCreateLineArcBlend(tp, prev_tc, tc, &blend_tc, &geom);
             break;
         case BLEND_ARC_LINE:
-            res_create = tpCreateArcLineBlend(tp, prev_tc, tc, &blend_tc);
+            res_create = tpCreateArcLineBlend(tp, prev_tc, tc, &blend_tc, &geom);
             break;
         case BLEND_ARC_ARC:
-            res_create = tpCreateArcArcBlend(tp, prev_tc, tc, &blend_tc);
+            res_create = tpCreateArcArcBlend(tp, prev_tc, tc, &blend_tc, &geom);
             break;
         default:
             tp_debug_print("intersection type not recognized, aborting arc\n");
@@ -1846,8 +2158,23 @@ STATIC int tpHandleBlendArc(TP_STRUCT * const tp, TC_STRUCT * const tc) {
     }
 
     if (res_create == TP_ERR_OK) {
+        entry->valid = 1;
+        entry->prev_id = prev_id;
+        entry->id = tp->nextId;
+        entry->consume = tcqLen(&tp->queue) < queue_len;
+        entry->limits = limits;
+        entry->in_prev_tc = in_prev_tc;
+        entry->in_tc = in_tc;
+        tpBlendCacheSave(prev_tc, &entry->prev_tc);
+        tpBlendCacheSave(tc, &entry->tc);
+        entry->blend_arc = blend_tc.coords.arc;
+        entry->blend_reqvel = blend_tc.reqvel;
+        entry->blend_maxvel = blend_tc.maxvel;
+        entry->blend_maxaccel = blend_tc.maxaccel;
+        entry->blend_target_vel = blend_tc.target_vel;
         //Need to do this here since the length changed
-        tpAddSegmentToQueue(tp, &blend_tc, false);
+        tpAddSegmentToQueue(tp, &blend_tc,
+                tcqSyncdio(&tp->queue, prev_tc), false);
     } else {
         return res_create;
     }
@@ -1855,6 +2182,39 @@ STATIC int tpHandleBlendArc(TP_STRUCT * const tp, TC_STRUCT * const tc) {
     return TP_ERR_OK;
 }
 
+/**
+ * Run a rapid with each axis on its own profile, if [TRAJ]INDEPENDENT_RAPID_Z
+ * allows it for this move.
+ * The axes leave the straight line but stay within the box between its end
+ * points, so the move is only taken this way when all of that box is at or
+ * above the clearance height. The axis limits are those of the axes, so this
+ * also needs joints that move with the axes (identity kinematics).
+ */
+STATIC int tpSetupIndependentRapid(TP_STRUCT const * const tp,
+        TC_STRUCT * const tc, EmcPose const * const end)
+{
+    double vel[EMCMOT_MAX_AXIS], acc[EMCMOT_MAX_AXIS];
+    int i;
+
+    if (!emcmotConfig->rapidIndependent ||
+            tc->canon_motion_type != EMC_MOTION_TYPE_TRAVERSE ||
+            tc->synchronized ||
+            emcmotConfig->kinType != KINEMATICS_IDENTITY ||
+            fmin(tp->goalPos.tran.z, end->tran.z) < emcmotConfig->rapidClearance) {
+        return TP_ERR_NO_ACTION;
+    }
+    for (i = 0; i < EMCMOT_MAX_AXIS; ++i) {
+        vel[i] = emcmotDebug->axes[i].vel_limit;
+        acc[i] = emcmotDebug->axes[i].acc_limit;
+    }
+    int res = tcSetupIndependent(tc, vel, acc);
+    if (res == TP_ERR_OK) {
+        tp_debug_print("rapid %d runs its axes independently for %f s\n",
+                tp->nextId, tc->target);
+    }
+    return res;
+}
+
 //TODO final setup steps as separate functions
 //
 /**
@@ -1900,6 +2260,11 @@ int tpAddLine(TP_STRUCT * const tp, EmcPose end, int canon_motion_type, double v
         return TP_ERR_ZERO_LENGTH;
     }
     tc.nominal_length = tc.target;
+    if (indexrotary == -1 &&
+            tpSetupIndependentRapid(tp, &tc, &end) == TP_ERR_OK) {
+        // Nothing blends with it
+        tcSetTermCond(&tc, TC_TERM_COND_STOP);
+    }
     tcClampVelocityByLength(&tc);
 
     // For linear move, set rotary axis settings 
@@ -1909,6 +2274,9 @@ int tpAddLine(TP_STRUCT * const tp, EmcPose end, int canon_motion_type, double v
     TC_STRUCT *prev_tc;
     prev_tc = tcqLast(&tp->queue);
     tpCheckCanonType(prev_tc, &tc);
+    if (prev_tc && tc.independent) {
+        tcSetTermCond(prev_tc, TC_TERM_COND_STOP);
+    }
     if (emcmotConfig->arcBlendEnable){
         tpHandleBlendArc(tp, &tc);
     }
@@ -1916,7 +2284,7 @@ int tpAddLine(TP_STRUCT * const tp, EmcPose end, int canon_motion_type, double v
     tcFinalizeLength(prev_tc);
     tcFlagEarlyStop(prev_tc, &tc);
 
-    int retval = tpAddSegmentToQueue(tp, &tc, true);
+    int retval = tpAddSegmentToQueue(tp, &tc, &tp->syncdio, true);
     //Run speed optimization (will abort safely if there are no tangent segments)
     tpRunOptimization(tp);
 
@@ -1990,6 +2358,8 @@ int tpAddCircle(TP_STRUCT * const tp,
 
     double v_max_actual = pmCircleActualMaxVel(&tc.coords.circle.xyz, &tc.acc_ratio_tan, ini_maxvel, acc, false);
     tp_debug_print("tc.acc_ratio_tan = %f\n",tc.acc_ratio_tan);
+    v_max_actual = fmin(v_max_actual, findJerkLimitedVel(
+                pmCircleEffectiveMinRadius(&tc.coords.circle.xyz), tc.maxjerk));
 
     // Copy in motion parameters
     tcSetupMotion(&tc,
@@ -2009,7 +2379,7 @@ int tpAddCircle(TP_STRUCT * const tp,
     tcFinalizeLength(prev_tc);
     tcFlagEarlyStop(prev_tc, &tc);
 
-    int retval = tpAddSegmentToQueue(tp, &tc, true);
+    int retval = tpAddSegmentToQueue(tp, &tc, &tp->syncdio, true);
 
     tpRunOptimization(tp);
     return retval;
@@ -2130,6 +2500,7 @@ STATIC int tcUpdateDistFromAccel(TC_STRUCT * const tc, double acc, double vel_de
         clip_max(&tc->progress,tc->target);
     }
     tc->currentvel = v_next;
+    tc->currentacc = acc;
 
     // Check if we can make the desired velocity
     tc->on_final_decel = (fabs(vel_desired - tc->currentvel) < TP_VEL_EPSILON) && (acc < 0.0);
@@ -2225,6 +2596,118 @@ void tpCalculateTrapezoidalAccel(TP_STRUCT const * const tp, TC_STRUCT * const t
     *vel_desired = maxnewvel;
 }
 
+/**
+ * Distance needed to slow from v to v_final with a jerk-limited profile.
+ * Any positive acceleration a is first ramped down to zero. If we're already
+ * decelerating, the part of the profile that is behind us is subtracted.
+ */
+STATIC double tpCalculateSCurveStopDistance(double v, double a, double v_final,
+        double a_max, double j_max)
+{
+    double d_pre = 0.0;
+    double d_done = 0.0;
+
+    if (a > 0.0) {
+        // Ramp acceleration down to zero first, gaining a^2 / (2 j) in velocity
+        double t_0 = a / j_max;
+        d_pre = v * t_0 + 0.5 * a * pmSq(t_0) - j_max * pmSq(t_0) * t_0 / 6.0;
+        v += 0.5 * a * t_0;
+    } else if (a < 0.0) {
+        // Find the point where deceleration started to ramp up, and how far
+        // we've traveled since then
+        double t_0 = -a / j_max;
+        double v_start = v + 0.5 * pmSq(a) / j_max;
+        d_done = v_start * t_0 - j_max * pmSq(t_0) * t_0 / 6.0;
+        v = v_start;
+    }
+
+    double dv = v - v_final;
+    if (dv <= 0.0) {
+        return d_pre;
+    }
+
+    double t_stop;
+    if (dv >= pmSq(a_max) / j_max) {
+        // Reaches full deceleration, then holds it
+        t_stop = dv / a_max + a_max / j_max;
+    } else {
+        t_stop = 2.0 * pmSqrt(dv / j_max);
+    }
+    // Velocity curve is symmetric, so the average velocity is the midpoint
+    double d_stop = 0.5 * (v + v_final) * t_stop;
+    return fmax(d_pre + d_stop - d_done, 0.0);
+}
+
+/**
+ * Compute acceleration for a cycle based on a jerk-limited (S-curve) profile.
+ * Acceleration is only allowed to change by maxjerk * dt each cycle. We steer
+ * towards the target velocity, starting to level off early enough that the
+ * acceleration reaches zero at the target. If the distance to finish the
+ * segment with a jerk-limited stop (to the final velocity) would be used up
+ * after this cycle, we start braking instead.
+ */
+STATIC int tpCalculateSCurveAccel(TP_STRUCT const * const tp,
+        TC_STRUCT * const tc,
+        TC_STRUCT const * const nexttc,
+        double * const acc,
+        double * const vel_desired)
+{
+    tc_debug_print("using S-curve acceleration\n");
+
+    double tc_target_vel = tpGetRealTargetVel(tp, tc);
+    double tc_finalvel = tpGetRealFinalVel(tp, tc, nexttc);
+    double a_max = tpGetScaledAccel(tp, tc);
+    double j_max = tc->maxjerk;
+
+    double dt = fmax(tc->cycle_time, TP_TIME_EPSILON);
+    double dx = tc->target - tc->progress;
+    double v_0 = tc->currentvel;
+    // Acceleration limit may have dropped since the last cycle (e.g. blending)
+    double a_0 = saturate(tc->currentacc, a_max);
+    double da = j_max * dt;
+
+    // Velocity we'd settle at if we ramped the acceleration to zero right now
+    double v_settle = v_0 + a_0 * fabs(a_0) / (2.0 * j_max);
+    double a_cmd;
+    if (v_settle < tc_target_vel) {
+        a_cmd = fmin(a_0 + da, a_max);
+    } else {
+        a_cmd = fmax(a_0 - da, -a_max);
+    }
+
+    // Don't overshoot the target velocity within this cycle
+    double a_exact = (tc_target_vel - v_0) / dt;
+    if ((a_cmd > 0.0 && a_cmd > a_exact) || (a_cmd < 0.0 && a_cmd < a_exact)) {
+        a_cmd = fmax(fmin(a_exact, a_0 + da), a_0 - da);
+    }
+
+    // Look at where this acceleration leaves us after one cycle
+    double v_1 = fmax(v_0 + a_cmd * dt, 0.0);
+    double dx_1 = 0.5 * (v_0 + v_1) * dt;
+    double d_stop = tpCalculateSCurveStopDistance(v_1, a_cmd, tc_finalvel, a_max, j_max);
+
+    *vel_desired = tc_target_vel;
+    if (dx - dx_1 <= d_stop) {
+        a_cmd = fmax(a_0 - da, -a_max);
+        // Don't brake below the final velocity
+        double a_final = (tc_finalvel - v_0) / dt;
+        if (a_cmd < a_final) {
+            a_cmd = fmin(a_final, a_0 + da);
+        }
+        // On final decel from here on, so let blending start if needed
+        *vel_desired = v_0 + a_cmd * dt;
+        if (*vel_desired < TP_VEL_EPSILON && dx > TP_POS_EPSILON) {
+            // Came to rest just short of the end, let the trapezoidal
+            // profile creep the rest of the way
+            tc_debug_print("S-curve stopped short by %g, falling back\n", dx);
+            return TP_ERR_FAIL;
+        }
+    }
+
+    *acc = saturate(a_cmd, a_max);
+    return TP_ERR_OK;
+}
+
 /**
  * Calculate "ramp" acceleration for a cycle.
  */
@@ -2274,20 +2757,21 @@ STATIC int tpCalculateRampAccel(TP_STRUCT const * const tp,
     return TP_ERR_OK;
 }
 
-void tpToggleDIOs(TC_STRUCT * const tc) {
+void tpToggleDIOs(TP_STRUCT * const tp, TC_STRUCT * const tc) {
 
     int i=0;
-    if (tc->syncdio.anychanged != 0) { // we have DIO's to turn on or off
+    if (tc->syncdio_changed != 0) { // we have DIO's to turn on or off
+        syncdio_t const * const syncdio = tcqSyncdio(&tp->queue, tc);
         for (i=0; i < emcmotConfig->numDIO; i++) {
-            if (!(tc->syncdio.dio_mask & (1 << i))) continue;
-            if (tc->syncdio.dios[i] > 0) emcmotDioWrite(i, 1); // turn DIO[i] on
-            if (tc->syncdio.dios[i] < 0) emcmotDioWrite(i, 0); // turn DIO[i] off
+            if (!(syncdio->dio_mask & (1 << i))) continue;
+            if (syncdio->dios[i] > 0) emcmotDioWrite(i, 1); // turn DIO[i] on
+            if (syncdio->dios[i] < 0) emcmotDioWrite(i, 0); // turn DIO[i] off
         }
         for (i=0; i < emcmotConfig->numAIO; i++) {
-            if (!(tc->syncdio.aio_mask & (1 << i))) continue;
-            emcmotAioWrite(i, tc->syncdio.aios[i]); // set AIO[i]
+            if (!(syncdio->aio_mask & (1 << i))) continue;
+            emcmotAioWrite(i, syncdio->aios[i]); // set AIO[i]
         }
-        tc->syncdio.anychanged = 0; //we have turned them all on/off, nothing else to do for this TC the next time
+        tc->syncdio_changed = 0; //we have turned them all on/off, nothing else to do for this TC the next time
     }
 }
 
@@ -2409,6 +2893,15 @@ STATIC int tpUpdateMovementStatus(TP_STRUCT * const tp, TC_STRUCT const * const
     emcmotStatus->current_vel = tc->currentvel;
 
     emcPoseSub(&tc_pos, &tp->currentPos, &emcmotStatus->dtg);
+    if (tc->independent) {
+        // progress is in seconds; report distance and speed
+        PmCartesian xyz, abc, uvw;
+        emcPoseToPmCartesian(&emcmotStatus->dtg, &xyz, &abc, &uvw);
+        emcmotStatus->distance_to_go = pmSqrt(pmSq(xyz.x) + pmSq(xyz.y) +
+                pmSq(xyz.z) + pmSq(uvw.x) + pmSq(uvw.y) + pmSq(uvw.z));
+        emcmotStatus->requested_vel = tc->indep.speed;
+        emcmotStatus->current_vel = tcIndependentSpeed(tc);
+    }
     return TP_ERR_OK;
 }
 
@@ -2509,6 +3002,16 @@ STATIC int tpCompleteSegment(TP_STRUCT * const tp,
         }
     }
 
+    if (tc->motion_type == TC_SPHERICAL) {
+        tp->stats.blend_arc++;
+    } else if (tc->term_cond == TC_TERM_COND_TANGENT) {
+        tp->stats.blend_tangent++;
+    } else if (tc->term_cond == TC_TERM_COND_PARABOLIC) {
+        tp->stats.blend_parabolic++;
+    } else {
+        tp->stats.blend_stop++;
+    }
+
     // done with this move
     tcqRemove(&tp->queue, 1);
     tp_debug_print("Finished tc id %d\n", tc->id);
@@ -2792,7 +3295,7 @@ STATIC int tpDoParabolicBlending(TP_STRUCT * const tp, TC_STRUCT * const tc,
     if(tc->currentvel > nexttc->currentvel) {
         tpUpdateMovementStatus(tp, tc);
     } else {
-        tpToggleDIOs(nexttc);
+        tpToggleDIOs(tp, nexttc);
         tpUpdateMovementStatus(tp, nexttc);
     }
 #ifdef TP_SHOW_BLENDS
@@ -2829,9 +3332,12 @@ STATIC int tpUpdateCycle(TP_STRUCT * const tp,
     int res_accel = 1;
     double acc=0, vel_desired=0;
     
-    // If the slowdown is not too great, use velocity ramping instead of trapezoidal velocity
-    // Also, don't ramp up for parabolic blends
-    if (tc->accel_mode && tc->term_cond == TC_TERM_COND_TANGENT) {
+    // Jerk-limited segments always use the S-curve profile
+    if (tc->maxjerk > 0.0) {
+        res_accel = tpCalculateSCurveAccel(tp, tc, nexttc, &acc, &vel_desired);
+    } else if (tc->accel_mode && tc->term_cond == TC_TERM_COND_TANGENT) {
+        // If the slowdown is not too great, use velocity ramping instead of trapezoidal velocity
+        // Also, don't ramp up for parabolic blends
         res_accel = tpCalculateRampAccel(tp, tc, nexttc, &acc, &vel_desired);
     }
 
@@ -3050,6 +3556,8 @@ STATIC int tpHandleSplitCycle(TP_STRUCT * const tp, TC_STRUCT * const tc,
         case TC_TERM_COND_TANGENT:
             nexttc->cycle_time = tp->cycleTime - tc->cycle_time;
             nexttc->currentvel = tc->term_vel;
+            // Carry acceleration across so jerk-limited profiles stay continuous
+            nexttc->currentacc = tc->currentacc;
             tp_debug_print("Doing tangent split\n");
             break;
         case TC_TERM_COND_PARABOLIC:
@@ -3074,10 +3582,10 @@ STATIC int tpHandleSplitCycle(TP_STRUCT * const tp, TC_STRUCT * const tc,
     // FIXME redundant tangent check, refactor to switch
     if (tc->cycle_time > nexttc->cycle_time && tc->term_cond == TC_TERM_COND_TANGENT) {
         //Majority of time spent in current segment
-        tpToggleDIOs(tc);
+        tpToggleDIOs(tp, tc);
         tpUpdateMovementStatus(tp, tc);
     } else {
-        tpToggleDIOs(nexttc);
+        tpToggleDIOs(tp, nexttc);
         tpUpdateMovementStatus(tp, nexttc);
     }
 
@@ -3104,12 +3612,59 @@ STATIC int tpHandleRegularCycle(TP_STRUCT * const tp,
         tpDoParabolicBlending(tp, tc, nexttc);
     } else {
         //Update status for a normal step
-        tpToggleDIOs(tc);
+        tpToggleDIOs(tp, tc);
         tpUpdateMovementStatus(tp, tc);
     }
     return TP_ERR_OK;
 }
 
+/**
+ * Count a cycle that ran tc in the planner statistics.
+ * A cycle under the requested velocity is put down to the first reason that
+ * fits: slowing with nothing queued after tc, slowing for its final velocity,
+ * a velocity limit under the request, or else the acceleration limit. A
+ * cycle that finished tc is split between segments, so only its depth is
+ * counted.
+ */
+STATIC void tpUpdateStats(TP_STRUCT * const tp, TC_STRUCT const * const tc,
+        TC_STRUCT const * const nexttc, double vel_before)
+{
+    tp_stats_t * const stats = &tp->stats;
+    int depth = tcqLen(&tp->queue);
+    int bucket = 0;
+
+    stats->cycles++;
+    while (bucket < TP_STATS_DEPTH_BUCKETS - 1 && depth >> (bucket + 1)) {
+        bucket++;
+    }
+    stats->depth[bucket]++;
+
+    // Position sync makes its own velocity, and a pause asks for none
+    if (tc->remove || tc->synchronized == TC_SYNC_POSITION) {
+        return;
+    }
+    double v_req = (tc->synchronized ? tc->target_vel : tc->reqvel) *
+        tpGetFeedScale(tp, tc);
+    if (v_req < TP_VEL_EPSILON ||
+            tc->currentvel >= v_req * (1.0 - TP_STATS_VEL_MARGIN)) {
+        return;
+    }
+
+    stats->slow_time += tp->cycleTime;
+    if (tc->currentvel < vel_before) {
+        if (!nexttc && tc->term_cond != TC_TERM_COND_STOP &&
+                tc->term_cond != TC_TERM_COND_EXACT) {
+            stats->starved++;
+        } else {
+            stats->lookahead++;
+        }
+    } else if (tpGetMaxTargetVel(tp, tc) < v_req * (1.0 - TP_STATS_VEL_MARGIN)) {
+        stats->vel_limited++;
+    } else {
+        stats->acc_limited++;
+    }
+}
+
 /**
  * Calculate an updated goal position for the next timestep.
  * This is the brains of the operation. It's called every TRAJ period and is
@@ -3201,12 +3756,14 @@ int tpRunCycle(TP_STRUCT * const tp, long period)
 
     tcClearFlags(tc);
     tcClearFlags(nexttc);
+    double vel_before = tc->currentvel;
     // Update the current tc
     if (tc->splitting) {
         tpHandleSplitCycle(tp, tc, nexttc);
     } else {
         tpHandleRegularCycle(tp, tc, nexttc);
     }
+    tpUpdateStats(tp, tc, nexttc, vel_before);
 
 #ifdef TC_DEBUG
     double mag;
@@ -3323,6 +3880,28 @@ int tpActiveDepth(TP_STRUCT * const tp)
     return tp->activeDepth;
 }
 
+int tpGetStats(TP_STRUCT const * const tp, tp_stats_t * const stats)
+{
+    if (0 == tp) {
+        return TP_ERR_FAIL;
+    }
+
+    *stats = tp->stats;
+    return TP_ERR_OK;
+}
+
+int tpClearStats(TP_STRUCT * const tp)
+{
+    static const tp_stats_t zero_stats;
+
+    if (0 == tp) {
+        return TP_ERR_FAIL;
+    }
+
+    tp->stats = zero_stats;
+    return TP_ERR_OK;
+}
+
 int tpSetAout(TP_STRUCT * const tp, unsigned char index, double start, double end) {
     if (0 == tp) {
         return TP_ERR_FAIL;
@@ -19,7 +19,8 @@
 #include "tp_types.h"
 #include "tcq.h"
 
-int tpCreate(TP_STRUCT * const tp, int _queueSize, TC_STRUCT * const tcSpace);
+int tpCreate(TP_STRUCT * const tp, int _queueSize, TC_STRUCT * const tcSpace,
+        syncdio_t * const syncdioSpace);
 int tpClear(TP_STRUCT * const tp);
 int tpInit(TP_STRUCT * const tp);
 int tpClearDIOs(TP_STRUCT * const tp);
@@ -27,6 +28,7 @@ int tpSetCycleTime(TP_STRUCT * const tp, double secs);
 int tpSetVmax(TP_STRUCT * const tp, double vmax, double ini_maxvel);
 int tpSetVlimit(TP_STRUCT * const tp, double vLimit);
 int tpSetAmax(TP_STRUCT * const tp, double aMax);
+int tpSetJmax(TP_STRUCT * const tp, double jMax);
 int tpSetId(TP_STRUCT * const tp, int id);
 int tpGetExecId(TP_STRUCT * const tp);
 int tpSetTermCond(TP_STRUCT * const tp, int cond, double tolerance);
@@ -48,9 +50,11 @@ int tpGetPos(TP_STRUCT const  * const tp, EmcPose * const pos);
 int tpIsDone(TP_STRUCT * const tp);
 int tpQueueDepth(TP_STRUCT * const tp);
 int tpActiveDepth(TP_STRUCT * const tp);
+int tpGetStats(TP_STRUCT const * const tp, tp_stats_t * const stats);
+int tpClearStats(TP_STRUCT * const tp);
 int tpGetMotionType(TP_STRUCT * const tp);
 int tpSetSpindleSync(TP_STRUCT * const tp, double sync, int wait);
-void tpToggleDIOs(TC_STRUCT * const tc); //gets called when a new tc is taken from the queue. it checks and toggles all needed DIO's
+void tpToggleDIOs(TP_STRUCT * const tp, TC_STRUCT * const tc); //gets called when a new tc is taken from the queue. it checks and toggles all needed DIO's
 
 int tpSetAout(TP_STRUCT * const tp, unsigned char index, double start, double end);
 int tpSetDout(TP_STRUCT * const tp, int index, unsigned char start, unsigned char end); //gets called to place DIO toggles on the TC queue
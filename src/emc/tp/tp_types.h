@@ -27,6 +27,24 @@
 /* Values chosen for accel ratio to match parabolic blend acceleration
  * limits. */
 #define TP_OPTIMIZATION_CUTOFF 4
+/* Velocity optimization modes ([TRAJ]ARC_BLEND_OPTIMIZATION_MODE).
+ * DEPTH walks back at most ARC_BLEND_OPTIMIZATION_DEPTH segments, FULL walks
+ * the whole queue but stops as soon as the backward pass converges. */
+#define TP_OPTIM_MODE_DEPTH 0
+#define TP_OPTIM_MODE_FULL 1
+/* Blend arcs kept for reuse when the same pair of segments is queued again,
+ * as it is when a program is resumed after an abort (power of 2) */
+#define TP_BLEND_CACHE_SIZE 32
+/* Queue depth histogram buckets of tp_stats_t: bucket i counts depths from
+ * 2^i to 2^(i+1)-1, and the last one everything deeper */
+#define TP_STATS_DEPTH_BUCKETS 8
+/* Fraction of the requested velocity a segment can be under before the
+ * cycle counts as slowed */
+#define TP_STATS_VEL_MARGIN 0.001
+
+/* Segment velocity profiles ([TRAJ]PLANNER_TYPE) */
+#define TP_PLANNER_TRAPEZOIDAL 0
+#define TP_PLANNER_SCURVE 1
 /* If the queue is shorter than the threshold, assume that we're approaching
  * the end of the program */
 #define TP_QUEUE_THRESHOLD 3
@@ -82,6 +100,95 @@ typedef struct {
      int waiting_for_atspeed;
 } tp_spindle_t;
 
+/**
+ * The limits from the motion configuration that a blend arc solve reads.
+ */
+typedef struct {
+    PmCartesian acc_bound;
+    PmCartesian vel_bound;
+    double cycle_time;
+    double max_feed_scale;
+    int gap_cycles;
+} tp_blend_limits_t;
+
+/**
+ * The fields of a segment that a blend arc solve reads.
+ */
+typedef struct {
+    TcCoords coords;
+    double cycle_time;
+    double target;
+    double nominal_length;
+    double reqvel;
+    double maxvel;
+    double kink_vel;
+    double maxjerk;
+    double tolerance;
+    int motion_type;
+    int canon_motion_type;
+    int term_cond;
+    int atspeed;
+    int syncdio_changed;
+    int blend_prev;
+    int finalized;
+    unsigned char enables;
+} tp_blend_input_t;
+
+/**
+ * The fields of a segment that a blend arc solve changes.
+ */
+typedef struct {
+    TcCoords coords;
+    double target;
+    double kink_vel;
+    int term_cond;
+    int blend_prev;
+} tp_blend_output_t;
+
+/**
+ * A blend arc as it was solved, for tpHandleBlendArc to reuse.
+ * An entry is reused for the same pair of segment ids only if the segments
+ * and limits the solve read are the same as well, since the ids repeat
+ * whenever a program is run again, edited or not.
+ */
+typedef struct {
+    int valid;                  /* 0 in an unused entry */
+    int prev_id;                /* ids of the segment pair */
+    int id;
+    int consume;                /* prev_tc was dropped from the queue */
+    tp_blend_limits_t limits;
+    tp_blend_input_t in_prev_tc;    /* the segments before the solve */
+    tp_blend_input_t in_tc;
+    tp_blend_output_t prev_tc;      /* and after it */
+    tp_blend_output_t tc;
+    Arc9 blend_arc;             /* the arc, and the limits it was set up with */
+    double blend_reqvel;
+    double blend_maxvel;
+    double blend_maxaccel;
+    double blend_target_vel;
+} tp_blend_cache_t;
+
+/**
+ * Counters of what the planner has done, kept across tpClear and tpAbort
+ * until tpClearStats, for the motion.tp.* pins.
+ * tpRunCycle counts each cycle that runs a segment, and what held the
+ * velocity under the requested one (feed times override) in it.  The blend
+ * counts are of segments finished, by how they ended.
+ */
+typedef struct {
+    unsigned int cycles;        /* cycles that ran a segment */
+    unsigned int starved;       /* slowing as there is no next segment */
+    unsigned int lookahead;     /* slowing for the final velocity */
+    unsigned int vel_limited;   /* held under by a velocity limit */
+    unsigned int acc_limited;   /* getting up to speed */
+    unsigned int depth[TP_STATS_DEPTH_BUCKETS];
+    unsigned int blend_tangent; /* ended tangent, into the next or an arc */
+    unsigned int blend_arc;     /* blend arcs */
+    unsigned int blend_parabolic; /* ended in a parabolic blend */
+    unsigned int blend_stop;    /* ended stopped, exact stop or exact path */
+    double slow_time;           /* seconds under the requested velocity */
+} tp_stats_t;
+
 /**
  * Trajectory planner state structure.
  * Stores persistant data for the trajectory planner that should be accessible
@@ -108,6 +215,8 @@ typedef struct {
     double aMaxCartesian; /* max cartesian acceleration by machine bounds */
     double aLimit;        /* max accel (unused) */
 
+    double jMax;        /* max jerk for S-curve profiles, 0 = trapezoidal */
+
     double wMax;		/* rotational velocity max */
     double wDotMax;		/* rotational accelleration max */
     int nextId;
@@ -130,6 +239,11 @@ typedef struct {
 
     syncdio_t syncdio; //record tpSetDout's here
 
+    /* solved blend arcs, kept across tpClear and tpAbort */
+    tp_blend_cache_t blend_cache[TP_BLEND_CACHE_SIZE];
+
+    tp_stats_t stats;
+
 } TP_STRUCT;
 
 #endif				/* TP_TYPES_H */
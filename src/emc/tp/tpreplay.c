@@ -0,0 +1,637 @@
+/********************************************************************
+* Description: tpreplay.c
+*   Replays the motion commands captured by motion-logger through the
+*   trajectory planner, in user space and at a simulated servo
+*   period.  This gives a repeatable benchmark of planner changes on
+*   real part programs: the number of servo cycles the program takes,
+*   the CPU time of each tpRunCycle(), and the largest velocity,
+*   acceleration and jerk of each axis, compared with the limits in
+*   the capture.
+*
+*   syntax:  tpreplay [-p period] [-q queue] [-j jerk] [-m margin]
+*                     [-b option=value]... [-e] [-t timeline] logfile...
+*
+*   Several logs are replayed one after the other, so that a capture
+*   of the startup commands can be shared by many programs.  A log is
+*   either the text or the binary capture of motion-logger, compressed
+*   or not.  With -e, the exit status is 1 if an axis went over a limit.
+*   With -t, the time at which the planner started and finished each
+*   run of cycles on a line is written to a file, which times a program
+*   with the real acceleration, blending and G64 tolerance.
+*
+* License: GPL Version 2
+* System: Linux
+*
+********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <math.h>
+
+#include "rtapi.h"
+#include "posemath.h"
+#include "emcpos.h"
+#include "emcmotcfg.h"
+#include "motion.h"
+#include "motion_debug.h"
+#include "tp.h"
+#include "tcq.h"
+#include "emc/motion-logger/capture.h"
+
+#define NUM_COORDS 9		/* x y z a b c u v w */
+
+/* CPU time histogram, in bins of HIST_NS up to HIST_BINS * HIST_NS */
+#define HIST_NS 10
+#define HIST_BINS 100000
+
+/* Give up if the planner makes no progress for this many seconds of
+   simulated time, e.g. waiting for a spindle that never comes */
+#define STALL_TIMEOUT 60.0
+
+/* The planner's view of motion, as motmod would set it up */
+static emcmot_status_t status;
+static emcmot_config_t config;
+static emcmot_debug_t debug;
+emcmot_status_t *emcmotStatus = &status;
+emcmot_config_t *emcmotConfig = &config;
+emcmot_debug_t *emcmotDebug = &debug;
+
+/* Synched IO and locking rotaries have nothing to drive here */
+void emcmotDioWrite(int index, char value)
+{
+}
+
+void emcmotAioWrite(int index, double value)
+{
+}
+
+void emcmotSetRotaryUnlock(int axis, int unlock)
+{
+}
+
+int emcmotGetRotaryIsUnlocked(int axis)
+{
+    return 1;
+}
+
+static const char coord_names[NUM_COORDS] = "xyzabcuvw";
+
+static double axis_vel_limit[NUM_COORDS];
+static double axis_acc_limit[NUM_COORDS];
+
+static struct {
+    int lines, circles, skipped;
+} counts;
+
+static long hist[HIST_BINS + 1];
+
+/* the arc blend options were given with -b */
+static int blend_options_set;
+
+static void usage()
+{
+    fprintf(stderr,
+	"usage: tpreplay [-p period] [-q queue] [-j jerk] [-m margin]\n"
+	"                [-b option=value]... [-e] [-t timeline] logfile...\n");
+    exit(1);
+}
+
+static void pose_to_array(const EmcPose * pos, double c[])
+{
+    c[0] = pos->tran.x;
+    c[1] = pos->tran.y;
+    c[2] = pos->tran.z;
+    c[3] = pos->a;
+    c[4] = pos->b;
+    c[5] = pos->c;
+    c[6] = pos->u;
+    c[7] = pos->v;
+    c[8] = pos->w;
+}
+
+static long long now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* Returns the time below which the fraction p of the cycles ran. */
+static long hist_percentile(long cycles, double p)
+{
+    long n = 0, k;
+    for (k = 0; k <= HIST_BINS; k++) {
+	n += hist[k];
+	if (n > p * cycles) {
+	    break;
+	}
+    }
+    return k * HIST_NS;
+}
+
+/* Sets one of the [TRAJ]ARC_BLEND options, which the capture does not
+   record.  The defaults are those of initraj.cc. */
+static int set_blend_option(const char *arg)
+{
+    char name[32];
+    double value;
+
+    if (sscanf(arg, "%31[a-z_]=%lf", name, &value) != 2) {
+	return -1;
+    }
+    if (!strcmp(name, "enable")) {
+	config.arcBlendEnable = value;
+    } else if (!strcmp(name, "fallback_enable")) {
+	config.arcBlendFallbackEnable = value;
+    } else if (!strcmp(name, "optimization_depth")) {
+	config.arcBlendOptDepth = value;
+    } else if (!strcmp(name, "optimization_mode")) {
+	config.arcBlendOptMode = value;
+    } else if (!strcmp(name, "gap_cycles")) {
+	config.arcBlendGapCycles = value;
+    } else if (!strcmp(name, "ramp_freq")) {
+	config.arcBlendRampFreq = value;
+    } else if (!strcmp(name, "kink_ratio")) {
+	config.arcBlendTangentKinkRatio = value;
+    } else {
+	return -1;
+    }
+    return 0;
+}
+
+/* Parses the next command of a text log into c, skipping the lines
+   that are not replayed.  Returns 1, 0 at the end of the log, or -1 on
+   a bad SET_CIRCLE. */
+static int parse_command(FILE * log, emcmot_command_t * c)
+{
+    char line[512], arg[4][256];
+    EmcPose *pos = &c->pos;
+    int i;
+
+    memset(c, 0, sizeof(*c));
+    while (fgets(line, sizeof(line), log)) {
+	if (sscanf(line, "SET_LINE x=%lf, y=%lf, z=%lf, a=%lf, b=%lf, "
+		"c=%lf, u=%lf, v=%lf, w=%lf, id=%d, motion_type=%d, "
+		"vel=%lf, ini_maxvel=%lf, acc=%lf, turn=%d",
+		&pos->tran.x, &pos->tran.y, &pos->tran.z, &pos->a, &pos->b,
+		&pos->c, &pos->u, &pos->v, &pos->w, &c->id, &c->motion_type,
+		&c->vel, &c->ini_maxvel, &c->acc, &c->turn) == 15) {
+	    c->command = EMCMOT_SET_LINE;
+	    return 1;
+	}
+	if (!strncmp(line, "SET_CIRCLE:", 11)) {
+	    for (i = 0; i < 4; i++) {
+		if (!fgets(arg[i], sizeof(arg[i]), log)) {
+		    return -1;
+		}
+	    }
+	    if (sscanf(arg[0], " pos: x=%lf, y=%lf, z=%lf, a=%lf, b=%lf, "
+		    "c=%lf, u=%lf, v=%lf, w=%lf", &pos->tran.x, &pos->tran.y,
+		    &pos->tran.z, &pos->a, &pos->b, &pos->c, &pos->u, &pos->v,
+		    &pos->w) != 9
+		|| sscanf(arg[1], " center: x=%lf, y=%lf, z=%lf",
+		    &c->center.x, &c->center.y, &c->center.z) != 3
+		|| sscanf(arg[2], " normal: x=%lf, y=%lf, z=%lf",
+		    &c->normal.x, &c->normal.y, &c->normal.z) != 3
+		|| sscanf(arg[3], " id=%d, motion_type=%d, vel=%lf, "
+		    "ini_maxvel=%lf, acc=%lf, turn=%d", &c->id,
+		    &c->motion_type, &c->vel, &c->ini_maxvel, &c->acc,
+		    &c->turn) != 6) {
+		fprintf(stderr, "tpreplay: bad SET_CIRCLE\n");
+		return -1;
+	    }
+	    c->command = EMCMOT_SET_CIRCLE;
+	    return 1;
+	}
+	if (sscanf(line, "SET_VEL vel=%lf, ini_maxvel=%lf", &c->vel,
+		&c->ini_maxvel) == 2) {
+	    c->command = EMCMOT_SET_VEL;
+	} else if (sscanf(line, "SET_VEL_LIMIT vel=%lf", &c->vel) == 1) {
+	    c->command = EMCMOT_SET_VEL_LIMIT;
+	} else if (sscanf(line, "SET_ACC acc=%lf", &c->acc) == 1) {
+	    c->command = EMCMOT_SET_ACC;
+	} else if (sscanf(line, "SET_TERM_COND termCond=%d, tolerance=%lf",
+		&c->termCond, &c->tolerance) == 2) {
+	    c->command = EMCMOT_SET_TERM_COND;
+	} else if (sscanf(line, "SET_JOINT_VEL_LIMIT joint=%d, vel=%lf",
+		&c->joint, &c->vel) == 2) {
+	    c->command = EMCMOT_SET_JOINT_VEL_LIMIT;
+	} else if (sscanf(line, "SET_JOINT_ACC_LIMIT joint=%d, acc=%lf",
+		&c->joint, &c->acc) == 2) {
+	    c->command = EMCMOT_SET_JOINT_ACC_LIMIT;
+	} else if (sscanf(line, "SET_AXIS_VEL_LIMIT axis=%d vel=%lf",
+		&c->axis, &c->vel) == 2) {
+	    c->command = EMCMOT_SET_AXIS_VEL_LIMIT;
+	} else if (sscanf(line, "SET_AXIS_ACC_LIMIT axis=%d, acc=%lf",
+		&c->axis, &c->acc) == 2) {
+	    c->command = EMCMOT_SET_AXIS_ACC_LIMIT;
+	} else if (sscanf(line, "SET_MAX_FEED_OVERRIDE %lf",
+		&c->maxFeedScale) == 1) {
+	    c->command = EMCMOT_SET_MAX_FEED_OVERRIDE;
+	} else if (sscanf(line, "SETUP_PLANNER type=%d, max_jerk=%lf, rapid_z=%lf",
+		&c->plannerType, &c->maxJerk, &c->rapidClearance) >= 2) {
+	    c->command = EMCMOT_SETUP_PLANNER;
+	    c->rapidIndependent = strstr(line, "rapid_z=") != NULL;
+	} else if (sscanf(line, "SET_SPINDLESYNC sync=%lf, flags=0x%x",
+		&c->spindlesync, (unsigned *) &c->flags) == 2) {
+	    c->command = EMCMOT_SET_SPINDLESYNC;
+	} else if (!strncmp(line, "RIGID_TAP", 9)) {
+	    c->command = EMCMOT_RIGID_TAP;
+	} else if (!strncmp(line, "PROBE", 5)) {
+	    c->command = EMCMOT_PROBE;
+	} else {
+	    continue;
+	}
+	return 1;
+    }
+    return 0;
+}
+
+/* Replays one command.  Returns 1 after a move or setting, 0 for a
+   command that is not replayed, or -1 if a move could not be added. */
+static int replay_command(const emcmot_command_t * c, TP_STRUCT * tp,
+    double *jerk_limit)
+{
+    int n;
+
+    switch (c->command) {
+    case EMCMOT_SET_LINE:
+	tpSetId(tp, c->id);
+	counts.lines++;
+	return tpAddLine(tp, c->pos, c->motion_type, c->vel, c->ini_maxvel,
+	    c->acc, status.enables_new, 0, c->turn) < 0 ? -1 : 1;
+    case EMCMOT_SET_CIRCLE:
+	tpSetId(tp, c->id);
+	counts.circles++;
+	return tpAddCircle(tp, c->pos, c->center, c->normal, c->turn,
+	    c->motion_type, c->vel, c->ini_maxvel, c->acc,
+	    status.enables_new, 0) < 0 ? -1 : 1;
+    case EMCMOT_SET_VEL:
+	status.vel = c->vel;
+	tpSetVmax(tp, c->vel, c->ini_maxvel);
+	return 1;
+    case EMCMOT_SET_VEL_LIMIT:
+	config.limitVel = c->vel;
+	tpSetVlimit(tp, c->vel);
+	return 1;
+    case EMCMOT_SET_ACC:
+	status.acc = c->acc;
+	tpSetAmax(tp, c->acc);
+	return 1;
+    case EMCMOT_SET_TERM_COND:
+	tpSetTermCond(tp, c->termCond, c->tolerance);
+	return 1;
+    case EMCMOT_SET_JOINT_VEL_LIMIT:
+	n = c->joint;
+	if (n < 0 || n >= EMCMOT_MAX_JOINTS) {
+	    return 0;
+	}
+	debug.joints[n].vel_limit = c->vel;
+	return 1;
+    case EMCMOT_SET_JOINT_ACC_LIMIT:
+	n = c->joint;
+	if (n < 0 || n >= EMCMOT_MAX_JOINTS) {
+	    return 0;
+	}
+	debug.joints[n].acc_limit = c->acc;
+	return 1;
+    case EMCMOT_SET_AXIS_VEL_LIMIT:
+	n = c->axis;
+	if (n < 0 || n >= NUM_COORDS) {
+	    return 0;
+	}
+	axis_vel_limit[n] = c->vel;
+	debug.axes[n].vel_limit = c->vel;
+	return 1;
+    case EMCMOT_SET_AXIS_ACC_LIMIT:
+	n = c->axis;
+	if (n < 0 || n >= NUM_COORDS) {
+	    return 0;
+	}
+	axis_acc_limit[n] = c->acc;
+	debug.axes[n].acc_limit = c->acc;
+	return 1;
+    case EMCMOT_SET_MAX_FEED_OVERRIDE:
+	config.maxFeedScale = c->maxFeedScale;
+	return 1;
+    case EMCMOT_SETUP_PLANNER:
+	config.plannerType = c->plannerType;
+	config.maxJerk = c->maxJerk;
+	config.rapidIndependent = c->rapidIndependent;
+	config.rapidClearance = c->rapidClearance;
+	tpSetJmax(tp, c->plannerType == TP_PLANNER_SCURVE ? c->maxJerk : 0.0);
+	if (c->plannerType == TP_PLANNER_SCURVE && *jerk_limit <= 0.0) {
+	    *jerk_limit = c->maxJerk;
+	}
+	return 1;
+    case EMCMOT_SETUP_ARC_BLENDS:
+	/* only binary captures have these, and -b takes precedence */
+	if (blend_options_set) {
+	    return 0;
+	}
+	config.arcBlendEnable = c->arcBlendEnable;
+	config.arcBlendFallbackEnable = c->arcBlendFallbackEnable;
+	config.arcBlendOptDepth = c->arcBlendOptDepth;
+	config.arcBlendOptMode = c->arcBlendOptMode;
+	config.arcBlendGapCycles = c->arcBlendGapCycles;
+	config.arcBlendRampFreq = c->arcBlendRampFreq;
+	config.arcBlendTangentKinkRatio = c->arcBlendTangentKinkRatio;
+	return 1;
+    case EMCMOT_SET_SPINDLESYNC:
+	/* there is no spindle to follow, so synched moves run as feed
+	   moves */
+	if (c->spindlesync != 0.0) {
+	    counts.skipped++;
+	}
+	return 0;
+    case EMCMOT_RIGID_TAP:
+    case EMCMOT_PROBE:
+	/* the capture doesn't record their targets */
+	counts.skipped++;
+	return 0;
+    default:
+	return 0;
+    }
+}
+
+/* Reads commands from the capture until one goes into the queue, as
+   motmod takes one command per servo cycle.  Returns 1 after a move or
+   setting, 0 at the end of the capture, or -1 if a move could not be
+   added or the capture is cut short. */
+static int next_command(capture_t * log, TP_STRUCT * tp, double *jerk_limit)
+{
+    capture_record_t record;
+    int res;
+
+    while (1) {
+	if (log->binary) {
+	    res = capture_read(log, &record);
+	    if (res < 0) {
+		fprintf(stderr, "tpreplay: short record in capture\n");
+	    }
+	} else {
+	    res = parse_command(log->f, &record.command);
+	}
+	if (res <= 0) {
+	    return res;
+	}
+	res = replay_command(&record.command, tp, jerk_limit);
+	if (res != 0) {
+	    return res;
+	}
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    long period = 1000000;
+    int queue_size = DEFAULT_TC_QUEUE_SIZE;
+    double jerk_limit = 0.0, margin = 1e-3;
+    int check = 0, opt, i, more = 1, res, status_code = 0;
+    capture_t log;
+    FILE *timeline = NULL;
+    int line_id = -1, id;
+    long line_start = 0;
+    TP_STRUCT tp;
+    tp_stats_t stats;
+    TC_STRUCT *tcSpace;
+    syncdio_t *syncdioSpace;
+    EmcPose pos = { {0.0, 0.0, 0.0}, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+    double p[NUM_COORDS], last_p[NUM_COORDS], last_v[NUM_COORDS];
+    double last_a[NUM_COORDS];
+    double max_v[NUM_COORDS], max_a[NUM_COORDS], max_j[NUM_COORDS];
+    long over_v[NUM_COORDS], over_a[NUM_COORDS], over_j[NUM_COORDS];
+    long cycles = 0, idle = 0, t_max = 0;
+    long long t, t_sum = 0;
+    double T, v, a, j;
+
+    config.arcBlendEnable = 1;
+    config.arcBlendFallbackEnable = 0;
+    config.arcBlendOptDepth = 50;
+    config.arcBlendOptMode = 0;
+    config.arcBlendGapCycles = 4;
+    config.arcBlendRampFreq = 100.0;
+    config.arcBlendTangentKinkRatio = 0.1;
+    config.maxFeedScale = 1.0;
+    config.kinType = KINEMATICS_IDENTITY;
+
+    while ((opt = getopt(argc, argv, "p:q:j:m:b:et:")) != -1) {
+	switch (opt) {
+	case 'p':
+	    period = atol(optarg);
+	    if (period < 1000) {
+		usage();
+	    }
+	    break;
+	case 'q':
+	    queue_size = atoi(optarg);
+	    if (queue_size < MIN_TC_QUEUE_SIZE
+		|| queue_size > MAX_TC_QUEUE_SIZE) {
+		usage();
+	    }
+	    break;
+	case 'j':
+	    jerk_limit = strtod(optarg, NULL);
+	    break;
+	case 'm':
+	    margin = strtod(optarg, NULL);
+	    break;
+	case 'b':
+	    if (set_blend_option(optarg)) {
+		usage();
+	    }
+	    blend_options_set = 1;
+	    break;
+	case 'e':
+	    check = 1;
+	    break;
+	case 't':
+	    timeline = fopen(optarg, "w");
+	    if (!timeline) {
+		perror(optarg);
+		return 1;
+	    }
+	    break;
+	default:
+	    usage();
+	}
+    }
+    if (optind >= argc) {
+	usage();
+    }
+    if (capture_open(&log, argv[optind]) < 0) {
+	return 1;
+    }
+    T = period * 1e-9;
+
+    /* what motmod sets up before task connects */
+    status.vel = DEFAULT_VELOCITY;
+    status.acc = DEFAULT_ACCELERATION;
+    config.limitVel = DEFAULT_VELOCITY;
+    config.trajCycleTime = T;
+    config.numDIO = EMCMOT_MAX_DIO;
+    config.numAIO = EMCMOT_MAX_AIO;
+    status.feed_scale = 1.0;
+    status.rapid_scale = 1.0;
+    status.spindle_scale = 1.0;
+    status.net_feed_scale = 1.0;
+    status.enables_new = FS_ENABLED | SS_ENABLED | FH_ENABLED;
+    status.enables_queued = status.enables_new;
+    status.spindle_is_atspeed = 1;
+
+    tcSpace = calloc(queue_size + 10, sizeof(TC_STRUCT));
+    syncdioSpace = calloc(queue_size + 10, sizeof(syncdio_t));
+    if (!tcSpace || !syncdioSpace
+	|| tpCreate(&tp, queue_size, tcSpace, syncdioSpace) != 0) {
+	fprintf(stderr, "tpreplay: can't create the planner\n");
+	return 1;
+    }
+    tpSetCycleTime(&tp, T);
+    tpSetPos(&tp, &pos);
+    tpSetVmax(&tp, status.vel, status.vel);
+    tpSetAmax(&tp, status.acc);
+
+    pose_to_array(&pos, p);
+    for (i = 0; i < NUM_COORDS; i++) {
+	last_p[i] = p[i];
+	last_v[i] = last_a[i] = 0.0;
+	max_v[i] = max_a[i] = max_j[i] = 0.0;
+	over_v[i] = over_a[i] = over_j[i] = 0;
+    }
+
+    /* the servo loop: one command, one planner cycle */
+    while (more || !tpIsDone(&tp)) {
+	if (more && !tcqFull(&tp.queue)) {
+	    res = next_command(&log, &tp, &jerk_limit);
+	    if (res < 0) {
+		fprintf(stderr, "tpreplay: can't add move %d\n",
+		    tp.nextId);
+		return 1;
+	    }
+	    if (res == 0 && ++optind < argc) {
+		capture_close(&log);
+		if (capture_open(&log, argv[optind]) < 0) {
+		    return 1;
+		}
+		res = 1;
+	    }
+	    more = res;
+	}
+
+	t = now_ns();
+	tpRunCycle(&tp, period);
+	tpGetPos(&tp, &pos);
+	t = now_ns() - t;
+
+	t_sum += t;
+	if (t > t_max) {
+	    t_max = t;
+	}
+	hist[t / HIST_NS < HIST_BINS ? t / HIST_NS : HIST_BINS]++;
+	cycles++;
+
+	/* the line is that of the segment being executed, the first one
+	   of a blend */
+	id = tpIsDone(&tp) ? -1 : tpGetExecId(&tp);
+	if (timeline && id != line_id) {
+	    if (line_id >= 0) {
+		fprintf(timeline, "%d\t%.6f\t%.6f\n", line_id,
+		    line_start * T, (cycles - 1) * T);
+	    }
+	    line_id = id;
+	    line_start = cycles - 1;
+	}
+
+	pose_to_array(&pos, p);
+	for (i = 0; i < NUM_COORDS; i++) {
+	    v = (p[i] - last_p[i]) / T;
+	    a = (v - last_v[i]) / T;
+	    j = (a - last_a[i]) / T;
+	    if (fabs(v) > max_v[i]) {
+		max_v[i] = fabs(v);
+	    }
+	    if (fabs(a) > max_a[i]) {
+		max_a[i] = fabs(a);
+	    }
+	    if (fabs(j) > max_j[i]) {
+		max_j[i] = fabs(j);
+	    }
+	    if (axis_vel_limit[i] > 0.0
+		&& fabs(v) > axis_vel_limit[i] * (1.0 + margin)) {
+		over_v[i]++;
+	    }
+	    if (axis_acc_limit[i] > 0.0
+		&& fabs(a) > axis_acc_limit[i] * (1.0 + margin)) {
+		over_a[i]++;
+	    }
+	    if (jerk_limit > 0.0 && fabs(j) > jerk_limit * (1.0 + margin)) {
+		over_j[i]++;
+	    }
+	    last_a[i] = a;
+	    last_v[i] = v;
+	}
+
+	/* a planner that stopped moving with work left is stuck */
+	if (memcmp(p, last_p, sizeof(p)) == 0 && !tpIsDone(&tp)) {
+	    if (++idle * T > STALL_TIMEOUT) {
+		fprintf(stderr, "tpreplay: no motion for %g s at cycle %ld, "
+		    "segment %d\n", STALL_TIMEOUT, cycles, tpGetExecId(&tp));
+		status_code = 2;
+		break;
+	    }
+	} else {
+	    idle = 0;
+	}
+	memcpy(last_p, p, sizeof(p));
+    }
+    capture_close(&log);
+    if (timeline) {
+	if (line_id >= 0) {
+	    fprintf(timeline, "%d\t%.6f\t%.6f\n", line_id,
+		line_start * T, cycles * T);
+	}
+	if (fclose(timeline) != 0) {
+	    perror("tpreplay: timeline");
+	    status_code = status_code ? status_code : 1;
+	}
+    }
+
+    printf("segments %d lines, %d arcs, %d not replayed\n", counts.lines,
+	counts.circles, counts.skipped);
+    printf("cycles %ld (%.6f s at %ld ns)\n", cycles, cycles * T, period);
+    printf("cycle time (ns) avg %lld p50 %ld p90 %ld p99 %ld max %ld\n",
+	cycles ? t_sum / cycles : 0, hist_percentile(cycles, 0.5),
+	hist_percentile(cycles, 0.9), hist_percentile(cycles, 0.99), t_max);
+    tpGetStats(&tp, &stats);
+    printf("under requested %.6f s: starved %u lookahead %u velocity %u "
+	"accel %u\n", stats.slow_time, stats.starved, stats.lookahead,
+	stats.vel_limited, stats.acc_limited);
+    printf("queue depth");
+    for (i = 0; i < TP_STATS_DEPTH_BUCKETS; i++) {
+	printf(" %d:%u", 1 << i, stats.depth[i]);
+    }
+    printf("\n");
+    printf("segments ended tangent %u arc %u parabolic %u stop %u\n",
+	stats.blend_tangent, stats.blend_arc, stats.blend_parabolic,
+	stats.blend_stop);
+    printf("%4s %12s %12s %6s %12s %12s %6s %14s %6s\n", "axis", "max vel",
+	"limit", "over", "max acc", "limit", "over", "max jerk", "over");
+    for (i = 0; i < NUM_COORDS; i++) {
+	if (max_v[i] == 0.0 && axis_vel_limit[i] == 0.0) {
+	    continue;
+	}
+	printf("%4c %12.4f %12.4f %6ld %12.4f %12.4f %6ld %14.4f %6ld\n",
+	    coord_names[i], max_v[i], axis_vel_limit[i], over_v[i],
+	    max_a[i], axis_acc_limit[i], over_a[i], max_j[i], over_j[i]);
+	if (check && (over_v[i] || over_a[i] || over_j[i])) {
+	    status_code = status_code ? status_code : 1;
+	}
+    }
+
+    free(tcSpace);
+    free(syncdioSpace);
+    return status_code;
+}
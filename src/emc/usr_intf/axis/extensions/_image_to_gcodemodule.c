@@ -0,0 +1,137 @@
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+// The height map kernel of image-to-gcode: the lowest the tool can go at
+// each pixel without cutting into the image.  The images go in and out as
+// strings of floats, so numpy isn't needed to build this.
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+
+struct dilate_job {
+    const float *image;
+    int cols;
+    const float *tool;
+    int tool_rows, tool_cols;
+    float *out;
+    int out_cols;
+    int row0, row1;
+};
+
+// One row of the tool at a time against a whole row of the output, so the
+// inner loop is a plain max over contiguous floats the compiler vectorizes
+static void *dilate_rows(void *arg) {
+    struct dilate_job *job = arg;
+    int r, a, b, c, n = job->out_cols;
+    for(r = job->row0; r < job->row1; r++) {
+        float *out = job->out + (size_t)r * n;
+        for(c = 0; c < n; c++) out[c] = -INFINITY;
+        for(a = 0; a < job->tool_rows; a++) {
+            const float *in = job->image + (size_t)(r + a) * job->cols;
+            const float *t = job->tool + (size_t)a * job->tool_cols;
+            for(b = 0; b < job->tool_cols; b++) {
+                const float *src = in + b;
+                float tb = t[b];
+                if(isinf(tb)) continue; // outside the tool
+                for(c = 0; c < n; c++) {
+                    float v = src[c] - tb;
+                    out[c] = v > out[c] ? v : out[c];
+                }
+            }
+        }
+    }
+    return NULL;
+}
+
+static PyObject *dilate(PyObject *s, PyObject *o) {
+    const char *image, *tool;
+    Py_ssize_t image_len, tool_len;
+    int rows, cols, tool_rows, tool_cols, threads = 0;
+    if(!PyArg_ParseTuple(o, "s#iis#ii|i:dilate", &image, &image_len,
+                &rows, &cols, &tool, &tool_len, &tool_rows, &tool_cols,
+                &threads))
+        return NULL;
+    if(rows < 1 || cols < 1 || tool_rows < 1 || tool_cols < 1
+            || image_len != (Py_ssize_t)rows * cols * sizeof(float)
+            || tool_len != (Py_ssize_t)tool_rows * tool_cols * sizeof(float)) {
+        PyErr_SetString(PyExc_ValueError, "size does not match the data");
+        return NULL;
+    }
+    if(tool_rows > rows || tool_cols > cols) {
+        PyErr_SetString(PyExc_ValueError, "tool is bigger than the image");
+        return NULL;
+    }
+
+    int out_rows = rows - tool_rows + 1, out_cols = cols - tool_cols + 1;
+    PyObject *result = PyString_FromStringAndSize(NULL,
+            (Py_ssize_t)out_rows * out_cols * sizeof(float));
+    if(!result) return NULL;
+    float *out = (float*)PyString_AS_STRING(result);
+
+    if(threads <= 0) threads = sysconf(_SC_NPROCESSORS_ONLN);
+    if(threads < 1) threads = 1;
+    if(threads > out_rows) threads = out_rows;
+    struct dilate_job *jobs = malloc(threads * sizeof(*jobs));
+    pthread_t *tids = malloc(threads * sizeof(*tids));
+    char *started = calloc(threads, 1);
+    if(!jobs || !tids || !started) {
+        free(jobs); free(tids); free(started);
+        Py_DECREF(result);
+        return PyErr_NoMemory();
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    int k;
+    for(k=0; k<threads; k++) {
+        struct dilate_job *job = &jobs[k];
+        job->image = (const float*)image;
+        job->cols = cols;
+        job->tool = (const float*)tool;
+        job->tool_rows = tool_rows;
+        job->tool_cols = tool_cols;
+        job->out = out;
+        job->out_cols = out_cols;
+        job->row0 = (long)out_rows * k / threads;
+        job->row1 = (long)out_rows * (k + 1) / threads;
+        started[k] = k > 0
+            && pthread_create(&tids[k], NULL, dilate_rows, job) == 0;
+    }
+    for(k=0; k<threads; k++)
+        if(!started[k]) dilate_rows(&jobs[k]);
+    for(k=0; k<threads; k++)
+        if(started[k]) pthread_join(tids[k], NULL);
+    Py_END_ALLOW_THREADS
+
+    free(jobs); free(tids); free(started);
+    return result;
+}
+
+static PyMethodDef methods[] = {
+    {"dilate", dilate, METH_VARARGS,
+        "dilate(image, rows, cols, tool, tool_rows, tool_cols[, threads])\n"
+        "The maximum of image - tool over the tool at each place it fits in\n"
+        "the image.  image and tool are strings of floats by rows; places\n"
+        "where the tool is +inf are outside it.  The result has\n"
+        "rows-tool_rows+1 rows of cols-tool_cols+1 floats.  The rows are\n"
+        "shared out among threads, one per CPU when threads is 0."},
+    {NULL}
+};
+
+PyMODINIT_FUNC
+init_image_to_gcode(void) {
+    Py_InitModule3("_image_to_gcode", methods,
+        "Height map kernel for image-to-gcode");
+}
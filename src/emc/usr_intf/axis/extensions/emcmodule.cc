@@ -22,6 +22,10 @@
 #include <pthread.h>
 #include <structmember.h>
 #include <inttypes.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
 #include "config.h"
 #include "rcs.hh"
 #include "emc.hh"
@@ -78,10 +82,38 @@ struct pyIniFile {
     IniFile *i;
 };
 
+// The parts of the status the costly attributes are built from, and the
+// fields GUIs signal on.  poll() bumps the version of each one that
+// changed, and an attribute is only rebuilt when the version of its
+// section is not the one it was built at.
+enum stat_section {
+    SEC_JOINT, SEC_AXIS, SEC_TOOL_TABLE, SEC_GCODES, SEC_MCODES,
+    SEC_SETTINGS, SEC_DIN, SEC_DOUT, SEC_AIN, SEC_AOUT,
+    SEC_TASK_STATE, SEC_TASK_MODE, SEC_INTERP_STATE, SEC_CALL_LEVEL,
+    SEC_FILE, SEC_MOTION_LINE, SEC_MOTION_MODE, SEC_TOOL_IN_SPINDLE,
+    SEC_HOMED, SEC_MAX
+};
+
+enum stat_cached {
+    C_JOINT, C_JOINT_POSITION, C_JOINT_ACTUAL, C_LIMIT, C_HOMED, C_AXIS,
+    C_TOOL_TABLE, C_GCODES, C_MCODES, C_SETTINGS, C_DIN, C_DOUT, C_AIN,
+    C_AOUT, C_MAX
+};
+
 struct pyStatChannel {
     PyObject_HEAD
     RCS_STAT_CHANNEL *c;
     EMC_STAT status;
+    EMC_STAT previous;
+    unsigned section_version[SEC_MAX];
+    unsigned changed_sections;
+    PyObject *cached[C_MAX];
+    unsigned cached_version[C_MAX];
+    // the toolTable buffer, opened on the first use of tool_table
+    RCS_STAT_CHANNEL *tt;
+    bool tt_tried;
+    int tt_serial;
+    CANON_TOOL_TABLE tool_table[CANON_POCKETS_MAX];
 };
 
 struct pyCommandChannel {
@@ -269,7 +301,10 @@ static int Stat_init(pyStatChannel *self, PyObject *a, PyObject *k) {
 }
 
 static void Stat_dealloc(PyObject *self) {
+    pyStatChannel *s = (pyStatChannel*)self;
+    for(int i = 0; i < C_MAX; i++) Py_XDECREF(s->cached[i]);
     delete ((pyStatChannel*)self)->c;
+    delete ((pyStatChannel*)self)->tt;
     PyObject_Del(self);
 }
 
@@ -281,21 +316,106 @@ static bool check_stat(RCS_STAT_CHANNEL *emcStatusBuffer) {
     return true;
 }
 
+// a section is 'count' fields of 'size' bytes, 'stride' bytes apart
+#define SECTION(n, x) { n, offsetof(EMC_STAT, x), sizeof(((EMC_STAT*)0)->x), 1, 0 }
+#define JOINT_SECTION(n, x) { n, offsetof(EMC_STAT, motion.joint[0].x), \
+    sizeof(((EMC_STAT*)0)->motion.joint[0].x), EMCMOT_MAX_JOINTS, \
+    sizeof(EMC_JOINT_STAT) }
+static const struct {
+    const char *name;
+    size_t offset, size;
+    int count;
+    size_t stride;
+} stat_sections[SEC_MAX] = {
+    SECTION("joint", motion.joint),
+    SECTION("axis", motion.axis),
+    SECTION("tool_table", io.tool),
+    SECTION("gcodes", task.activeGCodes),
+    SECTION("mcodes", task.activeMCodes),
+    SECTION("settings", task.activeSettings),
+    SECTION("din", motion.synch_di),
+    SECTION("dout", motion.synch_do),
+    SECTION("ain", motion.analog_input),
+    SECTION("aout", motion.analog_output),
+    SECTION("task_state", task.state),
+    SECTION("task_mode", task.mode),
+    SECTION("interp_state", task.interpState),
+    SECTION("call_level", task.callLevel),
+    SECTION("file", task.file),
+    SECTION("motion_line", task.motionLine),
+    SECTION("motion_mode", motion.traj.mode),
+    SECTION("tool_in_spindle", io.tool.toolInSpindle),
+    JOINT_SECTION("homed", homed),
+};
+#undef SECTION
+#undef JOINT_SECTION
+
+static bool section_changed(pyStatChannel *s, int i) {
+    size_t off = stat_sections[i].offset;
+    for(int j = 0; j < stat_sections[i].count; j++) {
+        if(memcmp((const char *)&s->status + off,
+                    (const char *)&s->previous + off, stat_sections[i].size))
+            return true;
+        off += stat_sections[i].stride;
+    }
+    return false;
+}
+
+static const stat_section cached_section[C_MAX] = {
+    SEC_JOINT, SEC_JOINT, SEC_JOINT, SEC_JOINT, SEC_JOINT, SEC_AXIS,
+    SEC_TOOL_TABLE, SEC_GCODES, SEC_MCODES, SEC_SETTINGS, SEC_DIN, SEC_DOUT,
+    SEC_AIN, SEC_AOUT
+};
+
 static PyObject *poll(pyStatChannel *s, PyObject *o) {
     if(!check_stat(s->c)) return NULL;
-    if(s->c->peek() == EMC_STAT_TYPE) {
-        EMC_STAT *emcStatus = static_cast<EMC_STAT*>(s->c->get_address());
-        memcpy(&s->status, emcStatus, sizeof(EMC_STAT));
+    memcpy((void*)&s->previous, (void*)&s->status, sizeof(EMC_STAT));
+    s->c->peek_copy(&s->status, sizeof(EMC_STAT));
+    s->changed_sections = 0;
+    for(int i = 0; i < SEC_MAX; i++) {
+        if(section_changed(s, i)) {
+            s->section_version[i]++;
+            s->changed_sections |= 1u << i;
+        }
     }
     Py_INCREF(Py_None);
     return Py_None;
 }
 
+static PyObject *Stat_changed(pyStatChannel *s, PyObject *o) {
+    PyObject *res = PyList_New(0);
+    for(int i = 0; i < SEC_MAX; i++) {
+        if(!(s->changed_sections & (1u << i))) continue;
+        PyObject *name = PyString_FromString(stat_sections[i].name);
+        PyList_Append(res, name);
+        Py_XDECREF(name);
+    }
+    return res;
+}
+
 static PyMethodDef Stat_methods[] = {
     {"poll", (PyCFunction)poll, METH_NOARGS, "Update current machine state"},
+    {"changed", (PyCFunction)Stat_changed, METH_NOARGS,
+        "Names of the sections of the status that changed in the last poll"},
     {NULL}
 };
 
+// Returns a new reference to the cached value of attribute 'which', built
+// again with 'build' when its section changed since it was last built.
+static PyObject *stat_cached(pyStatChannel *s, stat_cached which,
+        PyObject *(*build)(pyStatChannel *)) {
+    unsigned version = s->section_version[cached_section[which]];
+    if(!s->cached[which] || s->cached_version[which] != version) {
+        PyObject *res = build(s);
+        if(!res) return NULL;
+        Py_XDECREF(s->cached[which]);
+        s->cached[which] = res;
+        s->cached_version[which] = version;
+    }
+    Py_INCREF(s->cached[which]);
+    return s->cached[which];
+}
+
 #define O(x) offsetof(pyStatChannel,status.x)
 static PyMemberDef Stat_members[] = {
 // stat 
@@ -322,6 +442,10 @@ static PyMemberDef Stat_members[] = {
     {(char*)"rotation_xy", T_DOUBLE, O(task.rotation_xy), READONLY},
     {(char*)"delay_left", T_DOUBLE, O(task.delayLeft), READONLY},
     {(char*)"queued_mdi_commands", T_INT, O(task.queuedMDIcommands), READONLY},
+    {(char*)"mdi_batch", T_INT, O(task.mdiBatch), READONLY},
+    {(char*)"mdi_batch_lines", T_INT, O(task.mdiBatchLines), READONLY},
+    {(char*)"mdi_batch_done", T_INT, O(task.mdiBatchDone), READONLY},
+    {(char*)"mdi_batch_error", T_INT, O(task.mdiBatchError), READONLY},
 
 // motion
 //   EMC_TRAJ_STAT traj
@@ -369,6 +493,7 @@ static PyMemberDef Stat_members[] = {
 // EMC_TOOL_STAT io.tool
     {(char*)"pocket_prepped", T_INT, O(io.tool.pocketPrepped), READONLY},
     {(char*)"tool_in_spindle", T_INT, O(io.tool.toolInSpindle), READONLY},
+    {(char*)"tool_table_serial", T_INT, O(io.tool.toolTableSerial), READONLY},
 
 // EMC_COOLANT_STAT io.cooland
     {(char*)"mist", T_INT, O(io.coolant.mist), READONLY},
@@ -443,7 +568,7 @@ static PyObject *Stat_actual(pyStatChannel *s) {
     return pose(s->status.motion.traj.actualPosition);
 }
 
-static PyObject *Stat_joint_position(pyStatChannel *s) {
+static PyObject *build_joint_position(pyStatChannel *s) {
     PyObject *res = PyTuple_New(EMCMOT_MAX_JOINTS);
     for(int i=0; i<EMCMOT_MAX_JOINTS; i++) {
         PyTuple_SetItem(res, i,
@@ -452,7 +577,11 @@ static PyObject *Stat_joint_position(pyStatChannel *s) {
     return res;
 }
 
-static PyObject *Stat_joint_actual(pyStatChannel *s) {
+static PyObject *Stat_joint_position(pyStatChannel *s) {
+    return stat_cached(s, C_JOINT_POSITION, build_joint_position);
+}
+
+static PyObject *build_joint_actual(pyStatChannel *s) {
     PyObject *res = PyTuple_New(EMCMOT_MAX_JOINTS);
     for(int i=0; i<EMCMOT_MAX_JOINTS; i++) {
         PyTuple_SetItem(res, i,
@@ -461,31 +590,74 @@ static PyObject *Stat_joint_actual(pyStatChannel *s) {
     return res;
 }
 
+static PyObject *Stat_joint_actual(pyStatChannel *s) {
+    return stat_cached(s, C_JOINT_ACTUAL, build_joint_actual);
+}
+
 static PyObject *Stat_probed(pyStatChannel *s) {
     return pose(s->status.motion.traj.probedPosition);
 }
 
-static PyObject *Stat_activegcodes(pyStatChannel *s) {
+static PyObject *Stat_probed_points(pyStatChannel *s) {
+    int n = s->status.motion.traj.probedPointCount;
+    PyObject *res = PyTuple_New(n);
+    for(int i = 0; i < n; i++) {
+        PyTuple_SET_ITEM(res, i, pose(s->status.motion.traj.probedPoints[i]));
+    }
+    return res;
+}
+
+static PyObject *Stat_probed_points_tripped(pyStatChannel *s) {
+    int n = s->status.motion.traj.probedPointCount;
+    PyObject *res = PyTuple_New(n);
+    for(int i = 0; i < n; i++) {
+        PyTuple_SET_ITEM(res, i, PyBool_FromLong(
+            s->status.motion.traj.probedPointsTripped & (1 << i)));
+    }
+    return res;
+}
+
+static PyObject *build_activegcodes(pyStatChannel *s) {
     return int_array(s->status.task.activeGCodes, ACTIVE_G_CODES);
 }
 
-static PyObject *Stat_activemcodes(pyStatChannel *s) {
+static PyObject *Stat_activegcodes(pyStatChannel *s) {
+    return stat_cached(s, C_GCODES, build_activegcodes);
+}
+
+static PyObject *build_activemcodes(pyStatChannel *s) {
     return int_array(s->status.task.activeMCodes, ACTIVE_M_CODES);
 }
 
-static PyObject *Stat_activesettings(pyStatChannel *s) {
+static PyObject *Stat_activemcodes(pyStatChannel *s) {
+    return stat_cached(s, C_MCODES, build_activemcodes);
+}
+
+static PyObject *build_activesettings(pyStatChannel *s) {
    return double_array(s->status.task.activeSettings, ACTIVE_SETTINGS);
 }
 
-static PyObject *Stat_din(pyStatChannel *s) {
+static PyObject *Stat_activesettings(pyStatChannel *s) {
+    return stat_cached(s, C_SETTINGS, build_activesettings);
+}
+
+static PyObject *build_din(pyStatChannel *s) {
     return int_array(s->status.motion.synch_di, EMCMOT_MAX_AIO);
 }
 
-static PyObject *Stat_dout(pyStatChannel *s) {
+static PyObject *Stat_din(pyStatChannel *s) {
+    return stat_cached(s, C_DIN, build_din);
+}
+
+static PyObject *build_dout(pyStatChannel *s) {
     return int_array(s->status.motion.synch_do, EMCMOT_MAX_AIO);
 }
 
-static PyObject *Stat_limit(pyStatChannel *s) {
+static PyObject *Stat_dout(pyStatChannel *s) {
+    return stat_cached(s, C_DOUT, build_dout);
+}
+
+static PyObject *build_limit(pyStatChannel *s) {
     PyObject *res = PyTuple_New(EMCMOT_MAX_JOINTS);
     for(int i = 0; i < EMCMOT_MAX_JOINTS; i++) {
         int v = 0;
@@ -498,7 +670,11 @@ static PyObject *Stat_limit(pyStatChannel *s) {
     return res;
 }
 
-static PyObject *Stat_homed(pyStatChannel *s) {
+static PyObject *Stat_limit(pyStatChannel *s) {
+    return stat_cached(s, C_LIMIT, build_limit);
+}
+
+static PyObject *build_homed(pyStatChannel *s) {
     PyObject *res = PyTuple_New(EMCMOT_MAX_JOINTS);
     for(int i = 0; i < EMCMOT_MAX_JOINTS; i++) {
         PyTuple_SET_ITEM(res, i, PyInt_FromLong(s->status.motion.joint[i].homed));
@@ -506,14 +682,26 @@ static PyObject *Stat_homed(pyStatChannel *s) {
     return res;
 }
 
-static PyObject *Stat_ain(pyStatChannel *s) {
+static PyObject *Stat_homed(pyStatChannel *s) {
+    return stat_cached(s, C_HOMED, build_homed);
+}
+
+static PyObject *build_ain(pyStatChannel *s) {
     return double_array(s->status.motion.analog_input, EMCMOT_MAX_AIO);
 }
 
-static PyObject *Stat_aout(pyStatChannel *s) {
+static PyObject *Stat_ain(pyStatChannel *s) {
+    return stat_cached(s, C_AIN, build_ain);
+}
+
+static PyObject *build_aout(pyStatChannel *s) {
     return double_array(s->status.motion.analog_output, EMCMOT_MAX_AIO);
 }
 
+static PyObject *Stat_aout(pyStatChannel *s) {
+    return stat_cached(s, C_AOUT, build_aout);
+}
+
 static void dict_add(PyObject *d, const char *name, unsigned char v) {
     PyObject *o;
     PyDict_SetItemString(d, name, o = PyInt_FromLong(v));
@@ -555,7 +743,7 @@ static PyObject *Stat_joint_one(pyStatChannel *s, int jointno) {
 #undef F
 #undef F2
 
-static PyObject *Stat_joint(pyStatChannel *s) {
+static PyObject *build_joint(pyStatChannel *s) {
     PyObject *res = PyTuple_New(EMCMOT_MAX_JOINTS);
     for(int i=0; i<EMCMOT_MAX_JOINTS; i++) {
         PyTuple_SetItem(res, i, Stat_joint_one(s, i));
@@ -563,6 +751,10 @@ static PyObject *Stat_joint(pyStatChannel *s) {
     return res;
 }
 
+static PyObject *Stat_joint(pyStatChannel *s) {
+    return stat_cached(s, C_JOINT, build_joint);
+}
+
 #define F(x) F2(#x, x)
 #define F2(y,x) dict_add(res, y, s->status.motion.axis[axisno].x)
 static PyObject *Stat_axis_one(pyStatChannel *s, int axisno) {
@@ -576,7 +768,7 @@ static PyObject *Stat_axis_one(pyStatChannel *s, int axisno) {
 #undef F
 #undef F2
 
-static PyObject *Stat_axis(pyStatChannel *s) {
+static PyObject *build_axis(pyStatChannel *s) {
     PyObject *res = PyTuple_New(EMCMOT_MAX_AXIS);
     for(int i=0; i<EMCMOT_MAX_AXIS; i++) {
         PyTuple_SetItem(res, i, Stat_axis_one(s, i));
@@ -584,6 +776,10 @@ static PyObject *Stat_axis(pyStatChannel *s) {
     return res;
 }
 
+static PyObject *Stat_axis(pyStatChannel *s) {
+    return stat_cached(s, C_AXIS, build_axis);
+}
+
 static PyStructSequence_Field tool_fields[] = {
     {(char*)"id", },
     {(char*)"xoffset", },
@@ -611,11 +807,49 @@ static PyStructSequence_Desc tool_result_desc = {
 
 static PyTypeObject ToolResultType;
 
-static PyObject *Stat_tool_table(pyStatChannel *s) {
+// When task has the toolTable buffer, the status only has the spindle
+// pocket of the tool table, and the rest is read from the buffer when
+// toolTableSerial says it has changed.
+static const CANON_TOOL_TABLE *stat_tool_table(pyStatChannel *s) {
+    EMC_TOOL_STAT &tool = s->status.io.tool;
+    if(tool.toolTableLen != 1) return tool.toolTable;
+    if(!s->tt_tried) {
+        s->tt_tried = true;
+        char *file = get_nmlfile();
+        if(file == NULL) {
+            PyErr_Clear();
+            return tool.toolTable;
+        }
+        // an nml file without the buffer is not an error
+        RCS_PRINT_DESTINATION_TYPE dest = get_rcs_print_destination();
+        set_rcs_print_destination(RCS_PRINT_TO_NULL);
+        s->tt = new RCS_STAT_CHANNEL(emcFormat, "toolTable", "xemc", file);
+        set_rcs_print_destination(dest);
+        if(!s->tt->valid()) {
+            delete s->tt;
+            s->tt = NULL;
+        } else {
+            s->tt_serial = tool.toolTableSerial - 1;
+        }
+    }
+    if(!s->tt) return tool.toolTable;
+    if(s->tt_serial != tool.toolTableSerial
+            && s->tt->peek() == EMC_TOOL_TABLE_STAT_TYPE) {
+        EMC_TOOL_TABLE_STAT *table =
+            static_cast<EMC_TOOL_TABLE_STAT*>(s->tt->get_address());
+        memcpy(s->tool_table, table->toolTable, sizeof(s->tool_table));
+        s->tt_serial = table->toolTableSerial;
+    }
+    s->tool_table[0] = tool.toolTable[0];
+    return s->tool_table;
+}
+
+static PyObject *build_tool_table(pyStatChannel *s) {
+    const CANON_TOOL_TABLE *table = stat_tool_table(s);
     PyObject *res = PyTuple_New(CANON_POCKETS_MAX);
     int j=0;
     for(int i=0; i<CANON_POCKETS_MAX; i++) {
-        struct CANON_TOOL_TABLE &t = s->status.io.tool.toolTable[i];
+        const struct CANON_TOOL_TABLE &t = table[i];
         PyObject *tool = PyStructSequence_New(&ToolResultType);
         PyStructSequence_SET_ITEM(tool, 0, PyInt_FromLong(t.toolno));
         PyStructSequence_SET_ITEM(tool, 1, PyFloat_FromDouble(t.offset.tran.x));
@@ -638,6 +872,14 @@ static PyObject *Stat_tool_table(pyStatChannel *s) {
     return res;
 }
 
+static PyObject *Stat_tool_table(pyStatChannel *s) {
+    PyObject *res = stat_cached(s, C_TOOL_TABLE, build_tool_table);
+    // the toolTable buffer may not have caught up with the status yet
+    if(res && s->tt && s->tt_serial != s->status.io.tool.toolTableSerial)
+        Py_CLEAR(s->cached[C_TOOL_TABLE]);
+    return res;
+}
+
 static PyObject *Stat_axes(pyStatChannel *s) {
     PyErr_WarnEx(PyExc_DeprecationWarning, "stat.axes is deprecated and will be removed in the future", 0);
     return PyInt_FromLong(s->status.motion.traj.deprecated_axes);
@@ -666,6 +908,8 @@ static PyGetSetDef Stat_getsetlist[] = {
     {(char*)"joint_position", (getter)Stat_joint_position},
     {(char*)"joint_actual_position", (getter)Stat_joint_actual},
     {(char*)"probed_position", (getter)Stat_probed},
+    {(char*)"probed_points", (getter)Stat_probed_points},
+    {(char*)"probed_points_tripped", (getter)Stat_probed_points_tripped},
     {(char*)"settings", (getter)Stat_activesettings, (setter)NULL,
         (char*)"This is an array containing the Interp active settings: sequence number,\n"
         "feed rate, and spindle speed."
@@ -891,6 +1135,74 @@ static PyObject *mdi(pyCommandChannel *s, PyObject *o) {
     return Py_None;
 }
 
+// Sends a list of MDI lines in one message.  Task runs them in order;
+// stat.mdi_batch_done counts the ones that have finished.
+static PyObject *mdi_batch(pyCommandChannel *s, PyObject *o) {
+    EMC_TASK_PLAN_EXECUTE_BATCH m;
+    EMC_TASK_PLAN_EXECUTE line;
+    PyObject *lines, *seq;
+    size_t used = 0;
+    if(!PyArg_ParseTuple(o, "O", &lines)) return NULL;
+    seq = PySequence_Fast(lines, "MDI batch must be a sequence of strings");
+    if(!seq) return NULL;
+    Py_ssize_t n = PySequence_Fast_GET_SIZE(seq);
+    for(Py_ssize_t i = 0; i < n; i++) {
+        char *cmd;
+        Py_ssize_t len;
+        if(PyString_AsStringAndSize(PySequence_Fast_GET_ITEM(seq, i), &cmd, &len) < 0) {
+            Py_DECREF(seq);
+            return NULL;
+        }
+        if(size_t(len) > sizeof(line.command) - 1) {
+            Py_DECREF(seq);
+            PyErr_Format(PyExc_ValueError, "MDI commands limited to %zu characters", sizeof(line.command) - 1);
+            return NULL;
+        }
+        if(used + len + 1 > sizeof(m.commands)) {
+            Py_DECREF(seq);
+            PyErr_Format(PyExc_ValueError, "MDI batch limited to %zu characters", sizeof(m.commands));
+            return NULL;
+        }
+        memcpy(m.commands + used, cmd, len);
+        m.commands[used + len] = 0;
+        used += len + 1;
+    }
+    Py_DECREF(seq);
+    memset(m.commands + used, 0, sizeof(m.commands) - used);
+    m.count = n;
+    emcSendCommand(s, m);
+    return PyInt_FromLong(s->serial);
+}
+
+// Waits for the batch sent with serial number 'serial' to finish or fail,
+// and returns (lines done, line that failed or -1); on timeout the lines
+// done so far.
+static PyObject *wait_mdi_batch(pyCommandChannel *s, PyObject *o) {
+    int serial;
+    double timeout = EMC_COMMAND_TIMEOUT;
+    int done = 0, failed = -1;
+    if (!PyArg_ParseTuple(o, "i|d:emc.command.wait_mdi_batch", &serial, &timeout))
+        return NULL;
+    double start = etime();
+    do {
+        double now = etime();
+        if(s->s->peek() == EMC_STAT_TYPE) {
+            EMC_STAT *stat = (EMC_STAT*)s->s->get_address();
+            if(stat->task.mdiBatch == serial) {
+                done = stat->task.mdiBatchDone;
+                failed = stat->task.mdiBatchError;
+                if(failed >= 0 || done >= stat->task.mdiBatchLines) break;
+            } else if(stat->echo_serial_number - serial >= 0) {
+                // task took it but didn't run it
+                failed = 0;
+                break;
+            }
+        }
+        esleep(fmin(timeout - (now - start), EMC_COMMAND_DELAY));
+    } while (etime() - start < timeout);
+    return Py_BuildValue("(ii)", done, failed);
+}
+
 static PyObject *state(pyCommandChannel *s, PyObject *o) {
     EMC_TASK_SET_STATE m;
     if(!PyArg_ParseTuple(o, "i", &m.state)) return NULL;
@@ -1014,6 +1326,53 @@ static PyObject *override_limits(pyCommandChannel *s, PyObject *o) {
     return Py_None;
 }
 
+// Sends moves for motion to run as one probe sequence.  Each move is
+// (position, velocity, acceleration, probe_type); probe_type 0 to 3 makes
+// it a probe move like G38.2 to G38.5, -1 a plain feed move.
+static PyObject *probe_sequence(pyCommandChannel *s, PyObject *o) {
+    EMC_TRAJ_PROBE_SEQUENCE m;
+    PyObject *moves, *seq;
+    if(!PyArg_ParseTuple(o, "O", &moves)) return NULL;
+    seq = PySequence_Fast(moves, "probe sequence must be a sequence of moves");
+    if(!seq) return NULL;
+    Py_ssize_t n = PySequence_Fast_GET_SIZE(seq);
+    if(n < 1 || n > EMCMOT_MAX_PROBE_STEPS) {
+        Py_DECREF(seq);
+        PyErr_Format(PyExc_ValueError, "probe sequence needs 1 to %d moves", EMCMOT_MAX_PROBE_STEPS);
+        return NULL;
+    }
+    int probes = 0;
+    for(Py_ssize_t i = 0; i < n; i++) {
+        EmcPose &p = m.pos[i];
+        int probe_type;
+        if(!PyArg_ParseTuple(PySequence_Fast_GET_ITEM(seq, i),
+                "(ddddddddd)ddi:emc.command.probe_sequence",
+                &p.tran.x, &p.tran.y, &p.tran.z, &p.a, &p.b, &p.c,
+                &p.u, &p.v, &p.w, &m.vel[i], &m.acc[i], &probe_type)) {
+            Py_DECREF(seq);
+            return NULL;
+        }
+        if(probe_type < -1 || probe_type > 3) {
+            Py_DECREF(seq);
+            PyErr_Format(PyExc_ValueError, "probe_type must be -1 to 3, not %d", probe_type);
+            return NULL;
+        }
+        m.ini_maxvel[i] = m.vel[i];
+        m.type[i] = probe_type < 0 ? EMC_MOTION_TYPE_FEED : EMC_MOTION_TYPE_PROBING;
+        m.probe_type[i] = probe_type < 0 ? 0 : probe_type;
+        probes += probe_type >= 0;
+    }
+    Py_DECREF(seq);
+    if(probes > EMCMOT_MAX_PROBE_POINTS) {
+        PyErr_Format(PyExc_ValueError, "probe sequence limited to %d probe moves", EMCMOT_MAX_PROBE_POINTS);
+        return NULL;
+    }
+    m.count = n;
+    emcSendCommand(s, m);
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
 static PyObject *home(pyCommandChannel *s, PyObject *o) {
     EMC_JOINT_HOME m;
     if(!PyArg_ParseTuple(o, "i", &m.joint)) return NULL;
@@ -1267,6 +1626,278 @@ static PyObject *set_analog_output(pyCommandChannel *s, PyObject *o) {
     return Py_None;
 }
 
+// A command in flight.  One watcher thread, started by the first
+// command.completion(), reads the status for every completion in the
+// process and resolves them as task echoes their serial numbers, so the
+// callers need not each poll.  The Python object frees its completion;
+// everything else in it is under completion_mutex.
+struct completion {
+    int serial;
+    int state;              // RCS_EXEC until resolved, then RCS_DONE or RCS_ERROR
+    int fd;                 // eventfd, readable once resolved; -1 until fileno()
+    bool pending;           // on completion_list
+    completion *next;
+};
+
+struct pyCompletion {
+    PyObject_HEAD
+    completion *c;
+    int serial;
+};
+
+static pthread_mutex_t completion_mutex = PTHREAD_MUTEX_INITIALIZER;
+// signalled when completion_list gains an entry or entries are resolved
+static pthread_cond_t completion_cond = PTHREAD_COND_INITIALIZER;
+static completion *completion_list;
+static RCS_STAT_CHANNEL *completion_stat;
+
+static void completion_resolve(completion *c, int state) {
+    c->state = state;
+    if(c->fd >= 0) {
+        uint64_t one = 1;
+        if(write(c->fd, &one, sizeof(one)) < 0) {
+            // the counter can't overflow from one write
+        }
+    }
+}
+
+static void *completion_watcher(void *) {
+    pthread_mutex_lock(&completion_mutex);
+    for(;;) {
+        while(!completion_list)
+            pthread_cond_wait(&completion_cond, &completion_mutex);
+        pthread_mutex_unlock(&completion_mutex);
+
+        // as in shcom, the count is taken before the read so that a
+        // status written in between ends the wait below at once
+        unsigned int count;
+        bool haveCount = completion_stat->cms &&
+            completion_stat->cms->get_write_count(&count) == 0;
+        bool haveStat = completion_stat->peek() == EMC_STAT_TYPE;
+        EMC_STAT *stat = (EMC_STAT*)completion_stat->get_address();
+
+        pthread_mutex_lock(&completion_mutex);
+        bool resolved = false;
+        for(completion **p = &completion_list; haveStat && *p; ) {
+            completion *c = *p;
+            int serial_diff = stat->echo_serial_number - c->serial;
+            int state = RCS_EXEC;
+            if(serial_diff > 0) {
+                state = RCS_DONE;
+            } else if(serial_diff == 0 &&
+                    (stat->status == RCS_DONE || stat->status == RCS_ERROR)) {
+                state = stat->status;
+            }
+            if(state == RCS_EXEC) {
+                p = &c->next;
+                continue;
+            }
+            *p = c->next;
+            c->pending = false;
+            completion_resolve(c, state);
+            resolved = true;
+        }
+        if(resolved) pthread_cond_broadcast(&completion_cond);
+        if(!completion_list) continue;
+        pthread_mutex_unlock(&completion_mutex);
+
+        if(!haveCount ||
+                completion_stat->cms->wait_for_write(count, EMC_COMMAND_DELAY) < 0)
+            esleep(EMC_COMMAND_DELAY);
+        pthread_mutex_lock(&completion_mutex);
+    }
+    return NULL;
+}
+
+// Called with the GIL held, which keeps two threads from both starting it.
+static int completion_start(void) {
+    if(completion_stat) return 0;
+
+    char *file = get_nmlfile();
+    if(file == NULL) return -1;
+    RCS_STAT_CHANNEL *c =
+        new RCS_STAT_CHANNEL(emcFormat, "emcStatus", "xemc", file);
+    if(!c->valid()) {
+        delete c;
+        PyErr_Format( error, "new RCS_STAT_CHANNEL failed");
+        return -1;
+    }
+    completion_stat = c;
+
+    pthread_t thread;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    int res = pthread_create(&thread, &attr, completion_watcher, NULL);
+    pthread_attr_destroy(&attr);
+    if(res) {
+        completion_stat = NULL;
+        delete c;
+        errno = res;
+        PyErr_SetFromErrno(PyExc_OSError);
+        return -1;
+    }
+    return 0;
+}
+
+static void Completion_dealloc(PyObject *self) {
+    completion *c = ((pyCompletion*)self)->c;
+    pthread_mutex_lock(&completion_mutex);
+    if(c->pending) {
+        completion **p = &completion_list;
+        while(*p != c) p = &(*p)->next;
+        *p = c->next;
+    }
+    pthread_mutex_unlock(&completion_mutex);
+    if(c->fd >= 0) close(c->fd);
+    delete c;
+    PyObject_Del(self);
+}
+
+static PyObject *Completion_done(pyCompletion *s) {
+    pthread_mutex_lock(&completion_mutex);
+    bool done = s->c->state != RCS_EXEC;
+    pthread_mutex_unlock(&completion_mutex);
+    return PyBool_FromLong(done);
+}
+
+static PyObject *Completion_wait(pyCompletion *s, PyObject *o) {
+    double timeout = EMC_COMMAND_TIMEOUT;
+    if (!PyArg_ParseTuple(o, "|d:emc.completion.wait", &timeout))
+        return NULL;
+
+    int state;
+    Py_BEGIN_ALLOW_THREADS
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += (time_t)timeout;
+    deadline.tv_nsec += (long)((timeout - floor(timeout)) * 1e9);
+    if(deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_nsec -= 1000000000L;
+        deadline.tv_sec++;
+    }
+    pthread_mutex_lock(&completion_mutex);
+    while(s->c->state == RCS_EXEC &&
+            pthread_cond_timedwait(&completion_cond, &completion_mutex,
+                &deadline) != ETIMEDOUT) {
+    }
+    state = s->c->state;
+    pthread_mutex_unlock(&completion_mutex);
+    Py_END_ALLOW_THREADS
+    return PyInt_FromLong(state == RCS_EXEC ? -1 : state);
+}
+
+static PyObject *Completion_fileno(pyCompletion *s) {
+    completion *c = s->c;
+    pthread_mutex_lock(&completion_mutex);
+    if(c->fd < 0) {
+        c->fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if(c->fd >= 0 && c->state != RCS_EXEC) completion_resolve(c, c->state);
+    }
+    int fd = c->fd;
+    pthread_mutex_unlock(&completion_mutex);
+    if(fd < 0) return PyErr_SetFromErrno(PyExc_OSError);
+    return PyInt_FromLong(fd);
+}
+
+static PyObject *Completion_state(pyCompletion *s, void *) {
+    pthread_mutex_lock(&completion_mutex);
+    int state = s->c->state;
+    pthread_mutex_unlock(&completion_mutex);
+    return PyInt_FromLong(state);
+}
+
+static PyMemberDef Completion_members[] = {
+    {(char*)"serial", T_INT, offsetof(pyCompletion, serial), READONLY},
+    {NULL}
+};
+
+static PyGetSetDef Completion_getset[] = {
+    {(char*)"state", (getter)Completion_state, NULL},
+    {NULL}
+};
+
+static PyMethodDef Completion_methods[] = {
+    {"done", (PyCFunction)Completion_done, METH_NOARGS,
+        "True once the command is done or has failed"},
+    {"wait", (PyCFunction)Completion_wait, METH_VARARGS,
+        "wait([timeout]) -> RCS_DONE, RCS_ERROR, or -1 on timeout"},
+    {"fileno", (PyCFunction)Completion_fileno, METH_NOARGS,
+        "A descriptor that becomes readable once the command is done"},
+    {NULL}
+};
+
+static PyTypeObject Completion_Type = {
+    PyObject_HEAD_INIT(NULL)
+    0,                      /*ob_size*/
+    "linuxcnc.completion",  /*tp_name*/
+    sizeof(pyCompletion),   /*tp_basicsize*/
+    0,                      /*tp_itemsize*/
+    /* methods */
+    (destructor)Completion_dealloc, /*tp_dealloc*/
+    0,                      /*tp_print*/
+    0,                      /*tp_getattr*/
+    0,                      /*tp_setattr*/
+    0,                      /*tp_compare*/
+    0,                      /*tp_repr*/
+    0,                      /*tp_as_number*/
+    0,                      /*tp_as_sequence*/
+    0,                      /*tp_as_mapping*/
+    0,                      /*tp_hash*/
+    0,                      /*tp_call*/
+    0,                      /*tp_str*/
+    0,                      /*tp_getattro*/
+    0,                      /*tp_setattro*/
+    0,                      /*tp_as_buffer*/
+    Py_TPFLAGS_DEFAULT,     /*tp_flags*/
+    0,                      /*tp_doc*/
+    0,                      /*tp_traverse*/
+    0,                      /*tp_clear*/
+    0,                      /*tp_richcompare*/
+    0,                      /*tp_weaklistoffset*/
+    0,                      /*tp_iter*/
+    0,                      /*tp_iternext*/
+    Completion_methods,     /*tp_methods*/
+    Completion_members,     /*tp_members*/
+    Completion_getset,      /*tp_getset*/
+    0,                      /*tp_base*/
+    0,                      /*tp_dict*/
+    0,                      /*tp_descr_get*/
+    0,                      /*tp_descr_set*/
+    0,                      /*tp_dictoffset*/
+    0,                      /*tp_init*/
+    0,                      /*tp_alloc*/
+    0,                      /*tp_new*/
+    0,                      /*tp_free*/
+    0,                      /*tp_is_gc*/
+};
+
+// Returns a completion for the command with serial number 'serial', by
+// default the last one sent on this channel.
+static PyObject *command_completion(pyCommandChannel *s, PyObject *o) {
+    int serial = s->serial;
+    if (!PyArg_ParseTuple(o, "|i:emc.command.completion", &serial))
+        return NULL;
+    if(completion_start() < 0) return NULL;
+
+    pyCompletion *r = PyObject_New(pyCompletion, &Completion_Type);
+    if(!r) return NULL;
+    completion *c = new completion;
+    c->serial = serial;
+    c->state = RCS_EXEC;
+    c->fd = -1;
+    c->pending = true;
+    r->c = c;
+    r->serial = serial;
+
+    pthread_mutex_lock(&completion_mutex);
+    c->next = completion_list;
+    completion_list = c;
+    pthread_cond_broadcast(&completion_cond);
+    pthread_mutex_unlock(&completion_mutex);
+    return (PyObject*)r;
+}
+
 static PyObject *wait_complete(pyCommandChannel *s, PyObject *o) {
     double timeout = EMC_COMMAND_TIMEOUT;
     if (!PyArg_ParseTuple(o, "|d:emc.command.wait_complete", &timeout))
@@ -1284,8 +1915,11 @@ static PyMethodDef Command_methods[] = {
     {"teleop_enable", (PyCFunction)teleop, METH_VARARGS},
     {"traj_mode", (PyCFunction)set_traj_mode, METH_VARARGS},
     {"wait_complete", (PyCFunction)wait_complete, METH_VARARGS},
+    {"completion", (PyCFunction)command_completion, METH_VARARGS},
     {"state", (PyCFunction)state, METH_VARARGS},
     {"mdi", (PyCFunction)mdi, METH_VARARGS},
+    {"mdi_batch", (PyCFunction)mdi_batch, METH_VARARGS},
+    {"wait_mdi_batch", (PyCFunction)wait_mdi_batch, METH_VARARGS},
     {"mode", (PyCFunction)mode, METH_VARARGS},
     {"feedrate", (PyCFunction)feedrate, METH_VARARGS},
     {"rapidrate", (PyCFunction)rapidrate, METH_VARARGS},
@@ -1300,6 +1934,7 @@ static PyMethodDef Command_methods[] = {
     {"abort", (PyCFunction)emcabort, METH_NOARGS},
     {"task_plan_synch", (PyCFunction)task_plan_synch, METH_NOARGS},
     {"override_limits", (PyCFunction)override_limits, METH_NOARGS},
+    {"probe_sequence", (PyCFunction)probe_sequence, METH_VARARGS},
     {"home", (PyCFunction)home, METH_VARARGS},
     {"unhome", (PyCFunction)unhome, METH_VARARGS},
     {"jog", (PyCFunction)jog, METH_VARARGS,
@@ -1485,6 +2120,7 @@ static PyTypeObject Error_Type = {
 };
 
 #include <GL/gl.h>
+#include <vector>
 
 static void rotate_z(double pt[3], double a) {
     double theta = a * M_PI / 180;
@@ -1551,10 +2187,40 @@ static void glvertex9(const double pt[9], const char *geometry) {
     glVertex3dv(p);
 }
 
+// Where the line strips of draw_lines() go: straight to GL, or into an
+// array of GL_LINES pairs for a vertex buffer (see line_vertices)
+struct gl_strips {
+    void begin() { glBegin(GL_LINE_STRIP); }
+    void end() { glEnd(); }
+    void vertex(const double pt[9], const char *geometry) {
+        glvertex9(pt, geometry);
+    }
+};
+
+struct buffer_strips {
+    std::vector<float> v;
+    bool started;
+    float last[3];
+    void begin() { started = false; }
+    void end() { }
+    void vertex(const double pt[9], const char *geometry) {
+        double p[3];
+        vertex9(pt, p, geometry);
+        if(started) {
+            v.insert(v.end(), last, last + 3);
+            v.push_back(p[0]); v.push_back(p[1]); v.push_back(p[2]);
+        }
+        last[0] = p[0]; last[1] = p[1]; last[2] = p[2];
+        started = true;
+    }
+};
+
 #define max(a,b) ((a) < (b) ? (b) : (a))
 #define max3(a,b,c) (max((a),max((b),(c))))
 
-static void line9(const double p1[9], const double p2[9], const char *geometry) {
+template<class S>
+static void line9(const double p1[9], const double p2[9], const char *geometry,
+        S &out) {
     if(p1[3] != p2[3] || p1[4] != p2[4] || p1[5] != p2[5]) {
         double dc = max3(
             fabs(p2[3] - p1[3]),
@@ -1568,10 +2234,10 @@ static void line9(const double p1[9], const double p2[9], const char *geometry)
             double v = 1.0 - t;
             double pt[9];
             for(int j=0; j<9; j++) { pt[j] = t * p2[j] + v * p1[j]; }
-            glvertex9(pt, geometry);
+            out.vertex(pt, geometry);
         }
     } else {
-        glvertex9(p2, geometry);
+        out.vertex(p2, geometry);
     }
 }
 
@@ -1632,18 +2298,30 @@ static PyObject *pyvertex9(PyObject *s, PyObject *o) {
     return Py_BuildValue("(ddd)", &pt[0], &pt[1], &pt[2]);
 }
 
-static PyObject *pydraw_lines(PyObject *s, PyObject *o) {
-    PyListObject *li;
-    int for_selection = 0;
+// Whether the line from pe to p is shorter than tolerance in both XYZ
+// and UVW and leaves the rotary axes alone, so it can be left out of a
+// simplified strip
+static int near9(const double pe[9], const double p[9], double tolerance) {
+    if(pe[3] != p[3] || pe[4] != p[4] || pe[5] != p[5]) return 0;
+    double dxyz = 0, duvw = 0;
+    for(int j=0; j<3; j++) {
+        dxyz += (p[j] - pe[j]) * (p[j] - pe[j]);
+        duvw += (p[j+6] - pe[j+6]) * (p[j+6] - pe[j+6]);
+    }
+    return max(dxyz, duvw) < tolerance * tolerance;
+}
+
+// With a tolerance, points of a strip closer than it to the last point
+// drawn are skipped; each one is still within tolerance of the line that
+// replaces it.  The last point of every strip is always drawn.
+template<class S>
+static bool draw_lines(PyListObject *li, const char *geometry,
+        int for_selection, double tolerance, S &out) {
     int i;
     int first = 1;
     int nl = -1, n;
-    double p1[9], p2[9], pl[9];
-    char *geometry;
-
-    if(!PyArg_ParseTuple(o, "sO!|i:draw_lines",
-			    &geometry, &PyList_Type, &li, &for_selection))
-        return NULL;
+    int pending = 0;
+    double p1[9], p2[9], pl[9], pe[9];
 
     for(i=0; i<PyList_GET_SIZE(li); i++) {
         PyObject *it = PyList_GET_ITEM(li, i);
@@ -1656,30 +2334,74 @@ static PyObject *pydraw_lines(PyObject *s, PyObject *o) {
                     p2+3, p2+4, p2+5,
                     p2+6, p2+7, p2+8,
                     &dummy1, &dummy2, &dummy3)) {
-            if(!first) glEnd();
-            return NULL;
+            if(!first) out.end();
+            return false;
         }
         if(first || memcmp(p1, pl, sizeof(p1))
                 || (for_selection && n != nl)) {
-            if(!first) glEnd();
+            if(pending) out.vertex(pl, geometry);
+            if(!first) out.end();
             if(for_selection && n != nl) {
                 glLoadName(n);
                 nl = n;
             }
-            glBegin(GL_LINE_STRIP);
-            glvertex9(p1, geometry);
+            out.begin();
+            out.vertex(p1, geometry);
+            memcpy(pe, p1, sizeof(p1));
+            pending = 0;
             first = 0;
         }
-        line9(p1, p2, geometry);
+        if(tolerance > 0 && near9(pe, p2, tolerance)) {
+            pending = 1;
+        } else {
+            line9(pe, p2, geometry, out);
+            memcpy(pe, p2, sizeof(p1));
+            pending = 0;
+        }
         memcpy(pl, p2, sizeof(p1));
     }
 
-    if(!first) glEnd();
+    if(pending) out.vertex(pl, geometry);
+    if(!first) out.end();
+    return true;
+}
+
+static PyObject *pydraw_lines(PyObject *s, PyObject *o) {
+    PyListObject *li;
+    int for_selection = 0;
+    double tolerance = 0;
+    char *geometry;
+
+    if(!PyArg_ParseTuple(o, "sO!|id:draw_lines",
+			    &geometry, &PyList_Type, &li, &for_selection,
+                            &tolerance))
+        return NULL;
+
+    gl_strips gl;
+    if(!draw_lines(li, geometry, for_selection, tolerance, gl)) return NULL;
 
     Py_INCREF(Py_None);
     return Py_None;
 }
 
+// The same lines as draw_lines() draws, as a string of GL_LINES vertex
+// pairs of three floats each, ready for glBufferData
+static PyObject *pyline_vertices(PyObject *s, PyObject *o) {
+    PyListObject *li;
+    double tolerance = 0;
+    char *geometry;
+
+    if(!PyArg_ParseTuple(o, "sO!|d:line_vertices",
+			    &geometry, &PyList_Type, &li, &tolerance))
+        return NULL;
+
+    buffer_strips buf;
+    if(!draw_lines(li, geometry, 0, tolerance, buf)) return NULL;
+
+    return PyString_FromStringAndSize(buf.v.empty() ? "" : (char*)&buf.v[0],
+            buf.v.size() * sizeof(float));
+}
+
 static PyObject *pydraw_dwells(PyObject *s, PyObject *o) {
     PyListObject *li;
     int for_selection = 0, is_lathe = 0, i, n;
@@ -1770,9 +2492,18 @@ struct logger_point {
 
 #define NUMCOLORS (6)
 #define MAX_POINTS (10000)
+
+// The plot is a ring of points written by the logger thread and drawn by
+// the GUI without a lock.  Every point is stored twice, at i and i+cap,
+// so the last npts points always lie in one run of the array and can be
+// handed to glDrawArrays or a vertex buffer as they are.  head and tail
+// count points since the last clear; only the logger thread moves them.
+// The ring has room for budget/10 points beyond the budget, so the ones
+// written while a frame is drawn land on points that left the plot.
 typedef struct {
     PyObject_HEAD
-    int npts, mpts, lpts;
+    int budget, cap;
+    unsigned head, tail, lpts;
     struct logger_point *p;
     struct color colors[NUMCOLORS];
     bool exit, clear, changed;
@@ -1780,6 +2511,7 @@ typedef struct {
     int is_xyuv;
     double foam_z, foam_w;
     pyStatChannel *st;
+    Py_ssize_t shape[1];
 } pyPositionLogger;
 
 static const double epsilon = 1e-4; // 1-cos(1 deg) ~= 1e-4
@@ -1797,23 +2529,50 @@ static inline bool colinear(float xa, float ya, float za, float xb, float yb, fl
     return false;
 }
 
-static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct logger_point *Logger_at(pyPositionLogger *s, unsigned i) {
+    return &s->p[i % s->cap];
+}
 
-static void LOCK() { pthread_mutex_lock(&mutex); }
-static void UNLOCK() { pthread_mutex_unlock(&mutex); }
+// Overwrite point i, which must be on the plot or the next one
+static void Logger_set(pyPositionLogger *s, unsigned i,
+        const struct logger_point &np) {
+    s->p[i % s->cap] = np;
+    s->p[i % s->cap + s->cap] = np;
+}
+
+static void Logger_push(pyPositionLogger *s, const struct logger_point &np) {
+    unsigned h = s->head;
+    Logger_set(s, h, np);
+    __atomic_store_n(&s->head, h + 1, __ATOMIC_RELEASE);
+    if(h + 1 - s->tail > (unsigned)s->budget)
+        __atomic_store_n(&s->tail, h + 1 - s->budget, __ATOMIC_RELEASE);
+}
+
+// The points on the plot as of now: n of them, from index first; returns
+// the count of points added, as head
+static unsigned Logger_window(pyPositionLogger *s, unsigned *first, int *n) {
+    unsigned h = __atomic_load_n(&s->head, __ATOMIC_ACQUIRE);
+    unsigned t = __atomic_load_n(&s->tail, __ATOMIC_ACQUIRE);
+    int count = (int)(h - t);
+    if(count < 0) count = 0;
+    if(count > s->budget) count = s->budget;
+    *n = count;
+    *first = (h - count) % s->cap;
+    return h;
+}
 
 static int Logger_init(pyPositionLogger *self, PyObject *a, PyObject *k) {
     char *geometry;
     struct color *c = self->colors;
-    self->p = (logger_point*)malloc(0);
-    self->npts = self->mpts = 0;
+    self->budget = MAX_POINTS;
+    self->head = self->tail = self->lpts = 0;
     self->exit = self->clear = 0;
     self->changed = 1;
     self->st = 0;
     self->is_xyuv = 0;
     self->foam_z = 0;
     self->foam_w = 1.5;  // temporarily hard-code
-    if(!PyArg_ParseTuple(a, "O!(BBBB)(BBBB)(BBBB)(BBBB)(BBBB)(BBBB)s|i",
+    if(!PyArg_ParseTuple(a, "O!(BBBB)(BBBB)(BBBB)(BBBB)(BBBB)(BBBB)s|ii",
             &Stat_Type, &self->st,
             &c[0].r,&c[0].g, &c[0].b, &c[0].a,
             &c[1].r,&c[1].g, &c[1].b, &c[1].a,
@@ -1821,9 +2580,20 @@ static int Logger_init(pyPositionLogger *self, PyObject *a, PyObject *k) {
             &c[3].r,&c[3].g, &c[3].b, &c[3].a,
             &c[4].r,&c[4].g, &c[4].b, &c[4].a,
             &c[5].r,&c[5].g, &c[5].b, &c[5].a,
-            &geometry, &self->is_xyuv
+            &geometry, &self->is_xyuv, &self->budget
             ))
         return -1;
+    if(self->budget < 2) {
+        PyErr_Format(PyExc_ValueError, "point budget %d is less than 2",
+                self->budget);
+        return -1;
+    }
+    self->cap = self->budget + self->budget / 10 + 2;
+    self->p = (logger_point*)calloc(2 * self->cap, sizeof(logger_point));
+    if(!self->p) {
+        PyErr_NoMemory();
+        return -1;
+    }
     Py_INCREF(self->st);
     self->geometry = strdup(geometry);
     return 0;
@@ -1863,12 +2633,12 @@ static PyObject *Logger_start(pyPositionLogger *s, PyObject *o) {
 
     s->exit = 0;
     s->clear = 0;
-    s->npts = 0;
+    __atomic_store_n(&s->tail, s->head, __ATOMIC_RELEASE);
 
     Py_BEGIN_ALLOW_THREADS
     while(!s->exit) {
         if(s->clear) {
-            s->npts = 0;
+            __atomic_store_n(&s->tail, s->head, __ATOMIC_RELEASE);
             s->lpts = 0;
             s->clear = 0;
         }
@@ -1878,9 +2648,10 @@ static PyObject *Logger_start(pyPositionLogger *s, PyObject *o) {
             colornum = status->motion.traj.motion_type;
             if(colornum < 0 || colornum > NUMCOLORS) colornum = 0;
             struct color c = s->colors[colornum];
-            struct logger_point *op = &s->p[s->npts-1];
-            struct logger_point *oop = &s->p[s->npts-2];
-            bool add_point = s->npts < 2 || c != op->c;
+            int npts = s->head - s->tail;
+            struct logger_point *op = Logger_at(s, s->head-1);
+            struct logger_point *oop = Logger_at(s, s->head-2);
+            bool add_point = npts < 2 || c != op->c;
             double x, y, z, rx, ry, rz;
             if(s->is_xyuv) {
                 x = status->motion.traj.position.tran.x - status->task.toolOffset.tran.x,
@@ -1922,53 +2693,20 @@ static PyObject *Logger_start(pyPositionLogger *s, PyObject *o) {
                                 op->x, op->y, op->z,
                                 oop->x, oop->y, oop->z);
             }
+            struct logger_point np;
+            np.x = x; np.y = y; np.z = z;
+            np.rx = rx; np.ry = ry; np.rz = rz;
+            np.c = np.c2 = c;
             if(add_point) {
-                // 1 or 2 points may be added, make room whenever
-                // fewer than 2 are left
-                bool changed_color = s->npts && c != op->c;
-                if(s->npts+2 > s->mpts) {
-                    LOCK();
-                    if(s->mpts >= MAX_POINTS) {
-                        int adjust = MAX_POINTS / 10;
-                        if(adjust < 2) adjust = 2;
-                        s->npts -= adjust;
-                        memmove(s->p, s->p + adjust, 
-                                sizeof(struct logger_point) * s->npts);
-                    } else {
-                        s->mpts = 2 * s->mpts + 2;
-                        s->changed = 1;
-                        s->p = (struct logger_point*) realloc(s->p,
-                                    sizeof(struct logger_point) * s->mpts);
-                    }
-                    UNLOCK();
-                    op = &s->p[s->npts-1];
-                    oop = &s->p[s->npts-2];
-                }
-                if(changed_color) {
-                    {
-                    struct logger_point &np = s->p[s->npts];
-                    np.x = op->x; np.y = op->y; np.z = op->z;
-                    np.rx = rx; np.ry = ry; np.rz = rz;
-                    np.c = np.c2 = c;
-                    }
-                    {
-                    struct logger_point &np = s->p[s->npts+1];
-                    np.x = x; np.y = y; np.z = z;
-                    np.rx = rx; np.ry = ry; np.rz = rz;
-                    np.c = np.c2 = c;
-                    }
-                    s->npts += 2;
-                } else {
-                    struct logger_point &np = s->p[s->npts];
-                    np.x = x; np.y = y; np.z = z;
-                    np.rx = rx; np.ry = ry; np.rz = rz;
-                    np.c = np.c2 = c;
-                    s->npts++;
+                if(npts && c != op->c) {
+                    struct logger_point cp = np;
+                    cp.x = op->x; cp.y = op->y; cp.z = op->z;
+                    Logger_push(s, cp);
                 }
+                Logger_push(s, np);
             } else {
-                struct logger_point &np = s->p[s->npts-1];
-                np.x = x; np.y = y; np.z = z;
-                np.rx = rx; np.ry = ry; np.rz = rz;
+                np.c = op->c; np.c2 = op->c2;
+                Logger_set(s, s->head-1, np);
             }
         }
         nanosleep(&ts, NULL);
@@ -1993,7 +2731,9 @@ static PyObject* Logger_stop(pyPositionLogger *s, PyObject *o) {
 
 static PyObject* Logger_call(pyPositionLogger *s, PyObject *o) {
     if(!s->clear) {
-        LOCK();
+        unsigned first;
+        int n;
+        unsigned head = Logger_window(s, &first, &n);
         if(s->is_xyuv) {
             if(s->changed) {
                 glVertexPointer(3, GL_FLOAT,
@@ -2004,8 +2744,7 @@ static PyObject* Logger_call(pyPositionLogger *s, PyObject *o) {
                 glEnableClientState(GL_VERTEX_ARRAY);
                 s->changed = 0;
             }
-            s->lpts = s->npts;
-            glDrawArrays(GL_LINES, 0, 2*s->npts);
+            glDrawArrays(GL_LINES, 2*first, 2*n);
         } else {
             if(s->changed) {
                 glVertexPointer(3, GL_FLOAT,
@@ -2016,10 +2755,9 @@ static PyObject* Logger_call(pyPositionLogger *s, PyObject *o) {
                 glEnableClientState(GL_VERTEX_ARRAY);
                 s->changed = 0;
             }
-            s->lpts = s->npts;
-            glDrawArrays(GL_LINE_STRIP, 0, s->npts);
+            glDrawArrays(GL_LINE_STRIP, first, n);
         }
-        UNLOCK();
+        s->lpts = head;
     }
     Py_INCREF(Py_None);
     return Py_None;
@@ -2028,31 +2766,70 @@ static PyObject* Logger_call(pyPositionLogger *s, PyObject *o) {
 static PyObject *Logger_last(pyPositionLogger *s, PyObject *o) {
     int flag=1;
     if(!PyArg_ParseTuple(o, "|i:emc.positionlogger.last", &flag)) return NULL;
-    PyObject *result = NULL;
-    LOCK();
-    int idx = flag ? s->lpts : s->npts;
-    if(!idx) {
+    unsigned head = __atomic_load_n(&s->head, __ATOMIC_ACQUIRE);
+    unsigned tail = __atomic_load_n(&s->tail, __ATOMIC_ACQUIRE);
+    unsigned idx = flag ? s->lpts : head;
+    if((int)(idx - tail) <= 0 || (int)(head - idx) < 0) {
         Py_INCREF(Py_None);
-        result = Py_None;
-    } else {
-        result = PyTuple_New(6);
-        struct logger_point &p = s->p[idx-1];
-        PyTuple_SET_ITEM(result, 0, PyFloat_FromDouble(p.x));
-        PyTuple_SET_ITEM(result, 1, PyFloat_FromDouble(p.y));
-        PyTuple_SET_ITEM(result, 2, PyFloat_FromDouble(p.z));
-        PyTuple_SET_ITEM(result, 3, PyFloat_FromDouble(p.rx));
-        PyTuple_SET_ITEM(result, 4, PyFloat_FromDouble(p.ry));
-        PyTuple_SET_ITEM(result, 5, PyFloat_FromDouble(p.rz));
-    }
-    UNLOCK();
-    return result;
+        return Py_None;
+    }
+    struct logger_point p = *Logger_at(s, idx-1);
+    return Py_BuildValue("dddddd", p.x, p.y, p.z, p.rx, p.ry, p.rz);
+}
+
+static PyObject *Logger_get_npts(pyPositionLogger *s, void *unused) {
+    return PyInt_FromLong(__atomic_load_n(&s->head, __ATOMIC_ACQUIRE));
+}
+
+static PyObject *Logger_get_window(pyPositionLogger *s, void *unused) {
+    unsigned first;
+    int n;
+    Logger_window(s, &first, &n);
+    return Py_BuildValue("ii", (int)first, n);
+}
+
+// The whole ring as bytes, for uploading to a vertex buffer; window says
+// which points of it are on the plot
+static int Logger_getbuffer(pyPositionLogger *s, Py_buffer *view, int flags) {
+    if(flags & PyBUF_WRITABLE) {
+        PyErr_SetString(PyExc_BufferError, "the plot is read-only");
+        view->obj = NULL;
+        return -1;
+    }
+    s->shape[0] = 2 * s->cap * sizeof(struct logger_point);
+    view->buf = s->p;
+    view->obj = (PyObject*)s;
+    Py_INCREF(s);
+    view->len = s->shape[0];
+    view->readonly = 1;
+    view->itemsize = 1;
+    view->format = (flags & PyBUF_FORMAT) ? (char*)"B" : NULL;
+    view->ndim = 1;
+    view->shape = (flags & PyBUF_ND) ? s->shape : NULL;
+    view->strides = NULL;
+    view->suboffsets = NULL;
+    view->internal = NULL;
+    return 0;
 }
 
+static PyBufferProcs Logger_buffer;
+
 static PyMemberDef Logger_members[] = {
-    {(char*)"npts", T_INT, offsetof(pyPositionLogger, npts), READONLY},
+    {(char*)"budget", T_INT, offsetof(pyPositionLogger, budget), READONLY},
     {0, 0, 0, 0},
 };
 
+static PyGetSetDef Logger_getset[] = {
+    {(char*)"npts", (getter)Logger_get_npts, NULL,
+        (char*)"Points added since the last clear; the plot holds the last "
+        "budget of them"},
+    {(char*)"window", (getter)Logger_get_window, NULL,
+        (char*)"(first, count) of the points on the plot in the buffer, "
+        "each x y z as floats, RGBA as bytes, then the same for the "
+        "rotary axes or UVW"},
+    {NULL}
+};
+
 static PyMethodDef Logger_methods[] = {
     {"start", (PyCFunction)Logger_start, METH_VARARGS,
         "Start the position logger and run every ARG seconds"},
@@ -2090,8 +2867,8 @@ static PyTypeObject PositionLoggerType = {
     0,                      /*tp_str*/
     0,                      /*tp_getattro*/
     0,                      /*tp_setattro*/
-    0,                      /*tp_as_buffer*/
-    Py_TPFLAGS_DEFAULT,     /*tp_flags*/
+    &Logger_buffer,         /*tp_as_buffer*/
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_NEWBUFFER, /*tp_flags*/
     0,                      /*tp_doc*/
     0,                      /*tp_traverse*/
     0,                      /*tp_clear*/
@@ -2101,7 +2878,7 @@ static PyTypeObject PositionLoggerType = {
     0,                      /*tp_iternext*/
     Logger_methods,         /*tp_methods*/
     Logger_members,         /*tp_members*/
-    0,                      /*tp_getset*/
+    Logger_getset,          /*tp_getset*/
     0,                      /*tp_base*/
     0,                      /*tp_dict*/
     0,                      /*tp_descr_get*/
@@ -2117,6 +2894,7 @@ static PyTypeObject PositionLoggerType = {
 static PyMethodDef emc_methods[] = {
 #define METH(name, doc) { #name, (PyCFunction) py##name, METH_VARARGS, doc }
 METH(draw_lines, "Draw a bunch of lines in the 'rs274.glcanon' format"),
+METH(line_vertices, "Get the vertices draw_lines would draw, for a vertex buffer"),
 METH(draw_dwells, "Draw a bunch of dwell positions in the 'rs274.glcanon' format"),
 METH(line9, "Draw a single line in the 'rs274.glcanon' format; assumes glBegin(GL_LINES)"),
 METH(vertex9, "Get the 3d location for a 9d point"),
@@ -2141,19 +2919,21 @@ initlinuxcnc(void) {
 
     PyType_Ready(&Stat_Type);
     PyType_Ready(&Command_Type);
+    PyType_Ready(&Completion_Type);
     PyType_Ready(&Error_Type);
     PyType_Ready(&Ini_Type);
     error = PyErr_NewException((char*)"linuxcnc.error", PyExc_RuntimeError, NULL);
 
     PyModule_AddObject(m, "stat", (PyObject*)&Stat_Type);
     PyModule_AddObject(m, "command", (PyObject*)&Command_Type);
+    PyModule_AddObject(m, "completion", (PyObject*)&Completion_Type);
     PyModule_AddObject(m, "error_channel", (PyObject*)&Error_Type);
     PyModule_AddObject(m, "ini", (PyObject*)&Ini_Type);
     PyModule_AddObject(m, "error", error);
 
+    Logger_buffer.bf_getbuffer = (getbufferproc)Logger_getbuffer;
     PyType_Ready(&PositionLoggerType);
     PyModule_AddObject(m, "positionlogger", (PyObject*)&PositionLoggerType);
-    pthread_mutex_init(&mutex, NULL);
 
     PyModule_AddStringConstant(m, "PREFIX", EMC2_HOME);
     PyModule_AddStringConstant(m, "SHARE", EMC2_HOME "/share");
@@ -150,6 +150,9 @@ GLCALL3V(glStencilFunc, "iii", int, int, int);
 GLCALL3V(glStencilOp, "iii", int, int, int);
 GLCALL1V(glDrawBuffer, "i", int)
 GLCALL3V(glDrawArrays, "iii", int, int, int)
+GLCALL1V(glEnableClientState, "i", int)
+GLCALL1V(glDisableClientState, "i", int)
+GLCALL2V(glBindBuffer, "ii", int, int)
 GLCALL1V(glMatrixMode, "i", int)
 GLCALL6V(glOrtho, "ffffff", float, float, float, float, float, float);
 GLCALL3V(glTranslatef, "fff", float, float, float);
@@ -207,6 +210,60 @@ static PyObject *pyglGenLists(PyObject *s, PyObject *o) {
     return PyInt_FromLong(glGenLists(range));
 }
 
+static PyObject *pyglGetString(PyObject *s, PyObject *o) {
+    int name;
+    const GLubyte *r;
+    if(!PyArg_ParseTuple(o, "i:glGetString", &name)) return NULL;
+    r = glGetString(name);
+    CHECK_ERROR;
+    if(!r) { Py_INCREF(Py_None); return Py_None; }
+    return PyString_FromString((const char *)r);
+}
+
+// Buffer objects are handled one at a time
+static PyObject *pyglGenBuffers(PyObject *s, PyObject *o) {
+    GLuint buffer;
+    if(!PyArg_ParseTuple(o, ":glGenBuffers")) return NULL;
+    glGenBuffers(1, &buffer);
+    CHECK_ERROR;
+    return PyInt_FromLong(buffer);
+}
+
+static PyObject *pyglDeleteBuffers(PyObject *s, PyObject *o) {
+    int buffer;
+    GLuint b;
+    if(!PyArg_ParseTuple(o, "i:glDeleteBuffers", &buffer)) return NULL;
+    b = buffer;
+    glDeleteBuffers(1, &b);
+    CHECK_ERROR;
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+static PyObject *pyglBufferData(PyObject *s, PyObject *o) {
+    int target, usage, size;
+    const char *data;
+    if(!PyArg_ParseTuple(o, "is#i:glBufferData", &target, &data, &size, &usage))
+        return NULL;
+    glBufferData(target, size, data, usage);
+    CHECK_ERROR;
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+// The pointer is an offset into the buffer bound to GL_ARRAY_BUFFER
+static PyObject *pyglVertexPointer(PyObject *s, PyObject *o) {
+    int size, type, stride;
+    long offset;
+    if(!PyArg_ParseTuple(o, "iiil:glVertexPointer", &size, &type, &stride,
+                &offset))
+        return NULL;
+    glVertexPointer(size, type, stride, (const GLvoid *)offset);
+    CHECK_ERROR;
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
 static PyObject *pyglGetDoublev(PyObject *s, PyObject *o) {
     int what;
     if(!PyArg_ParseTuple(o, "i:glGetDoublev", &what)) return NULL;
@@ -737,6 +794,14 @@ METH(glStencilOp, "specify the stencil buffer operation"),
 METH(glFlush, "force execution of GL commands in finite time"),
 METH(glDrawBuffer, "specify which color buffers are to be drawn into"),
 METH(glDrawArrays, "render primitives from array data"),
+METH(glEnableClientState, "enable a client-side capability"),
+METH(glDisableClientState, "disable a client-side capability"),
+METH(glGenBuffers, "generate a buffer object name"),
+METH(glDeleteBuffers, "delete a named buffer object"),
+METH(glBindBuffer, "bind a named buffer object"),
+METH(glBufferData, "create and initialize a buffer object's data store"),
+METH(glVertexPointer, "define an array of vertex data"),
+METH(glGetString, "return a string describing the current GL connection"),
 METH(glDrawPixels, "write a block of pixels to the frame buffer"),
 METH(glMatrixMode, "specify which matrix is the current matrix"),
 METH(glOrtho, "multiply the current matrix with an orthographic matrix"),
@@ -870,5 +935,10 @@ void initminigl(void) {
     CONST(GL_UNPACK_ALIGNMENT);
     CONST(GL_LUMINANCE);
     CONST(GL_UNSIGNED_BYTE);
+    CONST(GL_FLOAT);
+    CONST(GL_VERSION);
+    CONST(GL_VERTEX_ARRAY);
+    CONST(GL_ARRAY_BUFFER);
+    CONST(GL_STATIC_DRAW);
 
 }
@@ -458,13 +458,15 @@ class MyOpengl(GlCanonDraw, Opengl):
 
     def set_current_line(self, line):
         if line == vars.running_line.get(): return
+        stream_follow(line)
         t.tag_remove("executing", "0.0", "end")
         if line is not None and line > 0:
             vupdate(vars.running_line, line)
+            tl = text_line(line)
             if vars.highlight_line.get() <= 0:
-                t.see("%d.0" % (line+2))
-                t.see("%d.0" % line)
-            t.tag_add("executing", "%d.0" % line, "%d.end" % line)
+                t.see("%d.0" % (tl+2))
+                t.see("%d.0" % tl)
+            t.tag_add("executing", "%d.0" % tl, "%d.end" % tl)
         else:
             vupdate(vars.running_line, 0)
 
@@ -473,12 +475,14 @@ class MyOpengl(GlCanonDraw, Opengl):
 
     def set_highlight_line(self, line):
         if line == self.get_highlight_line(): return
+        stream_follow(line)
         GlCanonDraw.set_highlight_line(self, line)
         t.tag_remove("sel", "0.0", "end")
         if line is not None and line > 0:
-            t.see("%d.0" % (line+2))
-            t.see("%d.0" % line)
-            t.tag_add("sel", "%d.0" % line, "%d.end" % line)
+            tl = text_line(line)
+            t.see("%d.0" % (tl+2))
+            t.see("%d.0" % tl)
+            t.tag_add("sel", "%d.0" % tl, "%d.end" % tl)
             vupdate(vars.highlight_line, line)
         else:
             vupdate(vars.highlight_line, -1)
@@ -589,17 +593,25 @@ class MyOpengl(GlCanonDraw, Opengl):
             self.font_vertspace = text.tk.call(
                 "font", "metrics", (font, -100, "bold"), "-linespace") - 100
             self.last_font = None
+            self.last_droposstrs = None
+            self.last_dro_size = None
         font_width = self.font_width
         font_vertspace = self.font_vertspace
 
-        text.delete("0.0", "end")
-        t = droposstrs[:]
-        text.insert("end", "\n".join(t))
+        # the text and the font are only set again when they would change
+        if droposstrs != self.last_droposstrs:
+            text.delete("0.0", "end")
+            text.insert("end", "\n".join(droposstrs))
+            self.last_droposstrs = droposstrs[:]
 
         window_height = text.winfo_height()
         window_width = text.winfo_width()
         dro_lines = len(droposstrs)
         dro_width = len(droposstrs[0]) + 3
+        dro_size = (window_height, window_width, dro_lines, dro_width)
+        if dro_size == self.last_dro_size:
+            return
+        self.last_dro_size = dro_size
         # pixels of height required, for "100 pixel" font
         req_height = dro_lines * 100 + (dro_lines + 1) * font_vertspace
         # pixels of width required, for "100 pixel" font
@@ -626,7 +638,7 @@ def toggle_perspective(e):
 
 def select_line(event):
     i = t.index("@%d,%d" % (event.x, event.y))
-    i = int(i.split('.')[0])
+    i = int(i.split('.')[0]) + text_first - 1
     o.set_highlight_line(i)
     o.tkRedraw()
     return "break"
@@ -675,6 +687,8 @@ class LivePlotter:
         self.last_limit = None
         self.last_motion_mode = None
         self.last_joint_position = None
+        self.last_tool_label = None
+        self.last_codes = None
         self.notifications_clear = False
         self.notifications_clear_info = False
         self.notifications_clear_error = False
@@ -870,6 +884,21 @@ class LivePlotter:
         vupdate(vars.on_any_limit, on_any_limit)
         global current_tool
         current_tool = self.stat.tool_table[0]
+        # the tool label and the active codes are only built again when
+        # what they show changed
+        tool_label = (current_tool, self.stat.tool_in_spindle)
+        if tool_label != self.last_tool_label:
+            self.last_tool_label = tool_label
+            self.show_tool(current_tool)
+
+        codes = (self.stat.gcodes, self.stat.mcodes, self.stat.settings)
+        if codes != self.last_codes:
+            self.last_codes = codes
+            self.show_codes()
+
+        user_live_update()
+
+    def show_tool(self, current_tool):
         if current_tool:
             tool_data = {'tool': current_tool[0], 'zo': current_tool[3], 'xo': current_tool[1], 'dia': current_tool[10]}
         if current_tool is None:
@@ -880,6 +909,8 @@ class LivePlotter:
             vupdate(vars.tool, _("Tool %(tool)d, offset %(zo)g, diameter %(dia)g") % tool_data)
         else:
             vupdate(vars.tool, _("Tool %(tool)d, zo %(zo)g, xo %(xo)g, dia %(dia)g") % tool_data)
+
+    def show_codes(self):
         active_codes = []
         for i in self.stat.gcodes[1:]:
             if i == -1: continue
@@ -903,8 +934,6 @@ class LivePlotter:
         widgets.code_text.insert("end", codes)
         widgets.code_text.configure(state="disabled")
 
-        user_live_update()
-
     def clear(self):
         self.logger.clear()
         o.redraw_soon()
@@ -1010,7 +1039,8 @@ class Progress:
                 "-text", text)
 
 class AxisCanon(GLCanon, StatMixin):
-    def __init__(self, widget, text, linecount, progress, arcdivision):
+    def __init__(self, widget, text, linecount, progress, arcdivision,
+            arctolerance=0):
         GLCanon.__init__(self, widget.colors, geometry, foam)
         StatMixin.__init__(self, s, random_toolchanger)
         self.text = text
@@ -1018,6 +1048,7 @@ class AxisCanon(GLCanon, StatMixin):
         self.progress = progress
         self.aborted = False
         self.arcdivision = arcdivision
+        self.arctolerance = arctolerance
 
     def change_tool(self, pocket):
         GLCanon.change_tool(self, pocket)
@@ -1101,6 +1132,56 @@ def cancel_open(event=None):
     if o.canon is not None:
         o.canon.aborted = True
 
+# A program of at least [DISPLAY]PREVIEW_STREAM_SIZE megabytes is streamed:
+# loading it only finds its extents, in gcode.geometry without keeping the
+# moves, and the preview shows PREVIEW_STREAM_LINES lines of it at a time
+# around the line that is running or selected, parsed again from the
+# nearest checkpoint of the load whenever that line nears the window's end.
+stream_window = None
+# The text of a streamed program holds only the lines of the window, read
+# from a gcode.lineindex of the file, and line 1 of the text is program
+# line text_first.
+text_index = None
+text_first = 1
+
+def text_line(line):
+    return line - text_first + 1
+
+def show_text_lines(first, last):
+    global text_first
+    text_first = first
+    t.configure(state="normal")
+    t.tk.call("delete_all", t)
+    code = []
+    for i, l in enumerate(text_index.lines(first, last)):
+        code.extend(["%6d: " % (first + i), "lineno",
+            l.expandtabs().replace("\r", ""), ""])
+    if code:
+        t.insert("end", *code)
+    t.configure(state="disabled")
+    set_first_line(program_start_line)
+    for tag, line in (("executing", vars.running_line.get()),
+            ("sel", vars.highlight_line.get())):
+        if first <= line <= last:
+            t.tag_add(tag, "%d.0" % text_line(line), "%d.end" % text_line(line))
+
+def stream_follow(line):
+    global stream_window
+    if stream_window is None or not line or line < 0: return
+    f, codes, first, last, total = stream_window
+    if first <= line and (line <= last - stream_lines / 4 or last >= total):
+        return
+    first = max(1, line - stream_lines / 4)
+    last = first + stream_lines
+    stream_window = f, codes, first, last, total
+    try:
+        show_text_lines(first, last)
+        o.load_preview_lines(f, o.canon, first, last, *codes)
+    except Exception, e:
+        stream_window = None
+        notifications.add("error", str(e))
+    o.tkRedraw()
+
 loaded_file = None
 def open_file_guts(f, filtered=False, addrecent=True):
     s.poll()
@@ -1137,8 +1218,18 @@ def open_file_guts(f, filtered=False, addrecent=True):
         c.task_plan_synch()
         c.wait_complete()
         c.program_open(f)
-        lines = open(f).readlines()
-        progress = Progress(2, len(lines))
+        global stream_window, text_index, text_first
+        stream_window = text_index = None
+        text_first = 1
+        streaming = (stream_size > 0
+                and os.path.getsize(f) >= stream_size * 1e6)
+        if streaming:
+            text_index = gcode.lineindex(f)
+            lines = []
+        else:
+            lines = open(f).readlines()
+        linecount = len(text_index) if streaming else len(lines)
+        progress = Progress(2, linecount)
         t.configure(state="normal")
         t.tk.call("delete_all", t)
         code = []
@@ -1153,9 +1244,13 @@ def open_file_guts(f, filtered=False, addrecent=True):
                 progress.update(i)
         if code:
             t.insert("end", *code)
-        progress.nextphase(len(lines))
+        if streaming:
+            i = max(0, linecount - 1)
+            show_text_lines(1, stream_lines)
+        progress.nextphase(linecount)
         f = os.path.abspath(f)
-        o.canon = canon = AxisCanon(o, widgets.text, i, progress, arcdivision)
+        o.canon = canon = AxisCanon(o, widgets.text, i, progress, arcdivision,
+                arctolerance)
         root_window.bind_class(".info.progress", "<Escape>", cancel_open)
 
         parameter = inifile.find("RS274NGC", "PARAMETER_FILE")
@@ -1171,8 +1266,17 @@ def open_file_guts(f, filtered=False, addrecent=True):
             unitcode = "G%d" % (20 + (s.linear_units == 1))
         else:
             unitcode = ''
+        gcode.set_checkpoint_interval(streaming and stream_lines / 4 or 0)
+        if streaming:
+            canon.native_geometry = gcode.geometry(arcdivision=arcdivision,
+                    arctolerance=arctolerance)
+            canon.native_geometry.set_window(0, -1)
         try:
             result, seq = o.load_preview(f, canon, unitcode, initcode, interpname)
+            if streaming:
+                codes = unitcode, initcode, interpname
+                o.load_preview_lines(f, canon, 1, stream_lines, *codes)
+                stream_window = f, codes, 1, stream_lines, linecount
         except KeyboardInterrupt:
             result, seq = 0, 0
         # According to the documentation, MIN_ERROR is the largest value that is
@@ -1325,8 +1429,8 @@ def set_first_line(lineno):
     global program_start_line
     program_start_line = lineno
     t.tag_remove("ignored", "0.0", "end")
-    if lineno > 0:
-        t.tag_add("ignored", "0.0", "%d.end" % (lineno-1))
+    if lineno > 0 and text_line(lineno-1) > 0:
+        t.tag_add("ignored", "0.0", "%d.end" % text_line(lineno-1))
 
 def parse_increment(jogincr):
     if jogincr.endswith("mm"):
@@ -1731,6 +1835,30 @@ def get_max_jog_speed_map(a):
         a = "XYZABCUVW".index(axis_letter)
     return get_max_jog_speed(a)
 
+def joint_limit_warning():
+    # Only for the kinematics whose inverse the gcode module has a copy
+    # of; their geometry is read from the realtime module's pins
+    kins = kinstype.split()[0] if kinstype else ""
+    pins = gcode.JOINT_LIMIT_KINEMATICS.get(kins)
+    if pins is None: return None
+    import subprocess
+    try:
+        params = [float(subprocess.check_output(["halcmd", "-s", "getp", pin]))
+                    for pin in pins]
+    except (OSError, ValueError, subprocess.CalledProcessError):
+        return None
+    joints = s.joint[:num_joints]
+    result = gcode.check_joint_limits(kins, params,
+        [j['min_position_limit'] for j in joints],
+        [j['max_position_limit'] for j in joints],
+        (o.canon.traverse, o.canon.feed, o.canon.arcfeed),
+        from_internal_linear_unit(1.))
+    if result is None: return None
+    line, joint, value = result
+    if joint < 0:
+        return _("Line %d moves to a position the machine can't reach") % line
+    return _("Line %d moves joint %d past its limit (%.4f)") % (line, joint, value)
+
 def run_warn():
     warnings = []
     if o.canon:
@@ -1743,6 +1871,8 @@ def run_warn():
             if o.canon.max_extents_notool[i] > machine_limit_max[i]:
                 warnings.append(_("Program exceeds machine maximum on axis %s")
                     % "XYZABCUVW"[i])
+        joint_warning = joint_limit_warning()
+        if joint_warning: warnings.append(joint_warning)
     if warnings:
         text = "\n".join(warnings)
         return int(root_window.tk.call("nf_dialog", ".error",
@@ -1879,7 +2009,10 @@ class TclCommands(nf.TclCommands):
                 props['name'] = name
 
             size = os.stat(loaded_file).st_size
-            lines = int(widgets.text.index("end").split(".")[0])-2
+            if text_index is not None:
+                lines = len(text_index)
+            else:
+                lines = int(widgets.text.index("end").split(".")[0])-2
             props['size'] = _("%(size)s bytes\n%(lines)s gcode lines") % {'size': size, 'lines': lines}
 
             if vars.metric.get():
@@ -1903,12 +2036,14 @@ class TclCommands(nf.TclCommands):
                 o.canon.dwell_time
                 )
  
-            props['g0'] = "%f %s".replace("%f", fmt) % (from_internal_linear_unit(g0, conv), units)
-            props['g1'] = "%f %s".replace("%f", fmt) % (from_internal_linear_unit(g1, conv), units)
-            if gt > 120:
-                props['run'] = _("%.1f minutes") % (gt/60)
-            else:
-                props['run'] = _("%d seconds") % (int(gt))
+            # a streamed preview only holds the moves of a window of lines
+            if stream_window is None:
+                props['g0'] = "%f %s".replace("%f", fmt) % (from_internal_linear_unit(g0, conv), units)
+                props['g1'] = "%f %s".replace("%f", fmt) % (from_internal_linear_unit(g1, conv), units)
+                if gt > 120:
+                    props['run'] = _("%.1f minutes") % (gt/60)
+                else:
+                    props['run'] = _("%d seconds") % (int(gt))
 
             min_extents = from_internal_units(o.canon.min_extents, conv)
             max_extents = from_internal_units(o.canon.max_extents, conv)
@@ -1963,7 +2098,8 @@ class TclCommands(nf.TclCommands):
         if vars.running_line.get() != -1: line = vars.running_line.get()
         if vars.highlight_line.get() != -1: line = vars.highlight_line.get()
         if line == -1: return
-        selection.set_value(t.get("%d.8" % line, "%d.end" % line))
+        tl = text_line(line)
+        selection.set_value(t.get("%d.8" % tl, "%d.end" % tl))
 
     def task_run_line(*args):
         line = vars.highlight_line.get()
@@ -2763,8 +2899,8 @@ class TclCommands(nf.TclCommands):
         line = o.get_highlight_line()
         if not line: line = vars.running_line.get()
         if line is not None and line > 0:
-            t.see("%d.0" % (line+2))
-            t.see("%d.0" % line)
+            t.see("%d.0" % (text_line(line)+2))
+            t.see("%d.0" % text_line(line))
 
     def dynamic_tab(name, text):
         return _dynamic_tab(name,text) # caller: make a frame and pack
@@ -3434,6 +3570,9 @@ root_window.call(widgets.jogincr._w, "select", 0)
 vcp = inifile.find("DISPLAY", "PYVCP")
 
 arcdivision = int(inifile.find("DISPLAY", "ARCDIVISION") or 64)
+arctolerance = float(inifile.find("DISPLAY", "ARC_TOLERANCE") or 0)
+stream_size = float(inifile.find("DISPLAY", "PREVIEW_STREAM_SIZE") or 0)
+stream_lines = max(4, int(inifile.find("DISPLAY", "PREVIEW_STREAM_LINES") or 20000))
 
 del sys.argv[1:3]
 
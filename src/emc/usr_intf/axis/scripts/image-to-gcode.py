@@ -28,6 +28,11 @@ import Image
 import numpy.core
 plus_inf = numpy.core.Inf
 
+try:
+    import _image_to_gcode
+except ImportError:
+    _image_to_gcode = None
+
 from rs274.author import Gcode
 import rs274.options
 
@@ -69,6 +74,36 @@ def make_tool_shape(f, wdia, resp):
     n = n - n.min()
     return n
 
+def dilate(image, tool):
+    """The height map of tool over image: for each place the tool fits in
+    the image, the lowest it can go there without cutting into it"""
+    rows, cols = image.shape
+    tr, tc = tool.shape
+    if _image_to_gcode:
+        image = numpy.ascontiguousarray(image, dtype=numpy.float32)
+        tool = numpy.ascontiguousarray(tool, dtype=numpy.float32)
+        result = _image_to_gcode.dilate(image.tostring(), rows, cols,
+            tool.tostring(), tr, tc)
+        return numpy.fromstring(result, dtype=numpy.float32).reshape(
+            (rows-tr+1, cols-tc+1))
+    result = numpy.zeros((rows-tr+1, cols-tc+1), dtype=numpy.float32)
+    result[:] = -plus_inf
+    for a in range(tr):
+        for b in range(tc):
+            if tool[a,b] == plus_inf: continue
+            numpy.maximum(result,
+                image[a:a+rows-tr+1, b:b+cols-tc+1] - tool[a,b], result)
+    return result
+
+def slopes(z, d):
+    """The slope of z along the columns, over a pixel on each side and
+    over the one next to it at the edges, in units of d per pixel"""
+    s = numpy.empty(z.shape, dtype=numpy.float64)
+    s[:,1:-1] = (z[:,2:] - z[:,:-2]) / (2*d)
+    s[:,0] = (z[:,1] - z[:,0]) / d
+    s[:,-1] = (z[:,-1] - z[:,-2]) / d
+    return s
+
 def amax(seq):
     res = 0
     for i in seq:
@@ -221,7 +256,7 @@ class Converter:
         self.roughing_delta = roughing_delta
         self.roughing_feed = roughing_feed
 
-        self.cache = {}
+        self.heights = None
 
         w, h = self.w, self.h = image.shape
         ts = self.ts = tool_shape.shape[0]
@@ -234,6 +269,7 @@ class Converter:
     def one_pass(self):
         g = self.g
         g.set_feed(self.feed)
+        self.make_z()
 
         if self.convert_cols and self.cols_first_flag:
             self.g.set_plane(19)
@@ -270,11 +306,7 @@ class Converter:
             h1 = h + th
             nim1 = numpy.zeros((w1, h1), dtype=numpy.float32) + base_image.min()
             nim1[tw/2:tw/2+w, th/2:th/2+h] = base_image
-            self.image = numpy.zeros((w,h), dtype=numpy.float32)
-            for j in range(0, w):
-                progress(j,w)
-                for i in range(0, h):
-                    self.image[j,i] = (nim1[j:j+tw,i:i+th] - rough).max()
+            self.image = dilate(nim1, rough)[:w,:h]
             self.feed = self.roughing_feed
             r = -self.roughing_delta
             m = self.image.min()
@@ -287,32 +319,33 @@ class Converter:
                 self.rd = m
                 self.one_pass()
             self.image = base_image
-            self.cache.clear()
+            self.heights = None
         self.feed = self.base_feed
         self.ro = 0
         self.rd = self.image.min()
         self.one_pass()
         g.end()
 
+    def make_z(self):
+        """The depth of the tool at each pixel for this pass, and its
+        slopes along x and y"""
+        if self.heights is None:
+            self.heights = dilate(self.image, self.tool)
+        z = numpy.minimum(0,
+            numpy.maximum(self.rd, self.heights.astype(numpy.float64))
+            + self.ro)
+        self.z = z
+        self.dz_dx = slopes(z, self.pixelsize)
+        self.dz_dy = slopes(z.transpose(), self.pixelsize).transpose()
+
     def get_z(self, x, y):
-        try:
-            return min(0, max(self.rd, self.cache[x,y]) + self.ro)
-        except KeyError:
-            m1 = self.image[y:y+self.ts, x:x+self.ts]
-            self.cache[x,y] = d = (m1 - self.tool).max()
-            return min(0, max(self.rd, d) + self.ro)
-        
+        return self.z[y, x]
+
     def get_dz_dy(self, x, y):
-        y1 = max(0, y-1)
-        y2 = min(self.image.shape[0]-1, y+1)
-        dy = self.pixelsize * (y2-y1)
-        return (self.get_z(x, y2) - self.get_z(x, y1)) / dy
-        
+        return self.dz_dy[y, x]
+
     def get_dz_dx(self, x, y):
-        x1 = max(0, x-1)
-        x2 = min(self.image.shape[1]-1, x+1)
-        dx = self.pixelsize * (x2-x1)
-        return (self.get_z(x2, y) - self.get_z(x1, y)) / dx
+        return self.dz_dx[y, x]
 
     def mill_rows(self, convert_scan, primary):
         w1 = self.w1; h1 = self.h1;
@@ -324,12 +357,11 @@ class Converter:
         for j in jrange:
             progress(jrange.index(j), len(jrange))
             y = (w1-j) * pixelsize
-            scan = []
-            for i in irange:
-                x = i * pixelsize
-                milldata = (i, (x, y, self.get_z(i, j)),
-                    self.get_dz_dx(i, j), self.get_dz_dy(i, j))
-                scan.append(milldata)
+            z = self.z[j,:h1].tolist()
+            dz_dx = self.dz_dx[j,:h1].tolist()
+            dz_dy = self.dz_dy[j,:h1].tolist()
+            scan = [(i, (i * pixelsize, y, z[i]), dz_dx[i], dz_dy[i])
+                for i in irange]
             for flag, points in convert_scan(primary, scan):
                 if flag:
                     self.entry_cut(self, points[0][0], j, points)
@@ -348,12 +380,11 @@ class Converter:
         for j in jrange:
             progress(jrange.index(j), len(jrange))
             x = j * pixelsize
-            scan = []
-            for i in irange:
-                y = (w1-i) * pixelsize
-                milldata = (i, (x, y, self.get_z(j, i)),
-                    self.get_dz_dy(j, i), self.get_dz_dx(j, i))
-                scan.append(milldata)
+            z = self.z[:w1,j].tolist()
+            dz_dy = self.dz_dy[:w1,j].tolist()
+            dz_dx = self.dz_dx[:w1,j].tolist()
+            scan = [(i, (x, (w1-i) * pixelsize, z[i]), dz_dy[i], dz_dx[i])
+                for i in irange]
             for flag, points in convert_scan(primary, scan):
                 if flag:
                     self.entry_cut(self, j, points[0][0], points)
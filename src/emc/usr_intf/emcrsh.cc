@@ -28,6 +28,7 @@
 #include <sys/uio.h>
 #include <netinet/in.h>
 #include <pthread.h>
+#include <sys/epoll.h>
 #include <errno.h>
 #include <limits.h>
 
@@ -60,6 +61,10 @@
             to max sessions. Default is no limit (-1).
   With -- --path Sets the base path to program (G-Code) files, default is "../../nc_files/".
             Make sure to include the final slash (/).
+  With -- --events Serves all the connections from one thread with epoll, which
+            reads the status once for all of them and allows subscriptions.
+  With -- --period <ms> Sets how often subscriptions are checked with --events,
+            default 100.
   With -- -ini <inifile>, uses inifile instead of emc.ini. 
 
   There are six commands supported, Where the commands set and get contain LinuxCNC
@@ -103,6 +108,32 @@
   connection has control of the CNC (see enable sub-command below). This command
   has no parameters.
   
+  ==> Subscribe <==
+
+  Subscribe <get sub-command> [<parameters>]
+  Only with --events.  The value the get command would return is sent again
+  each time it changes, checked every --period.  A connection may have
+  MAX_SUBSCRIPTIONS of them.  The server responds with SUBSCRIBE ACK or
+  SUBSCRIBE NAK.
+
+  ==> Unsubscribe <==
+
+  Unsubscribe [<get sub-command> [<parameters>]]
+  Removes the subscription given, or all of them.
+
+  ==> Stream <==
+
+  Stream <period ms> | On_change <field> [<field> ...]
+  Stream Off
+  Stream Fields
+  Only with --events.  Sends a record with the fields given every period, or
+  each time one of them changes, checked every --period.  With comm_mode
+  ascii a record is a line of JSON; with comm_mode binary it is a frame of
+  "LS", the payload length (16 bits), a sequence number (32 bits) and the
+  time (a double), then for each field the number of its values (8 bits)
+  and the values as doubles, all in the byte order of the server.  Stream
+  Fields lists the fields there are.
+
   ==> Help <==
   
   The help command will return help information in text format over the telnet
@@ -422,7 +453,8 @@
 // EMC_STAT *emcStatus;
 
 typedef enum {
-  cmdHello, cmdSet, cmdGet, cmdQuit, cmdShutdown, cmdHelp, cmdUnknown} commandTokenType;
+  cmdHello, cmdSet, cmdGet, cmdQuit, cmdShutdown, cmdHelp, cmdSubscribe,
+  cmdUnsubscribe, cmdStream, cmdUnknown} commandTokenType;
   
 typedef enum {
   scEcho, scVerbose, scEnable, scConfig, scCommMode, scCommProt, scIniFile,
@@ -444,7 +476,29 @@ typedef enum {
   rtNoError, rtHandledNoError, rtStandardError, rtCustomError, rtCustomHandledError
   } cmdResponseType;
   
-typedef struct {  
+#define MAX_SUBSCRIPTIONS 16
+
+typedef struct {
+  char cmd[64];      // the get command, as given
+  char last[1024];   // the reply last sent for it
+} subscriptionRecType;
+
+#define MAX_STREAM_FIELDS 32
+#define MAX_STREAM_VALUES (MAX_STREAM_FIELDS * EMCMOT_MAX_JOINTS)
+
+typedef struct {
+  bool active;
+  bool onChange;
+  double period;     // seconds between records, when not onChange
+  double next;
+  unsigned seq;
+  int nFields;
+  int fields[MAX_STREAM_FIELDS];
+  int nLast;
+  double last[MAX_STREAM_VALUES];  // the values last sent, for onChange
+} streamRecType;
+
+typedef struct connectionRec {
   int cliSock;
   char hostName[80];
   char version[8];
@@ -456,7 +510,12 @@ typedef struct {
   int commProt;
   char inBuf[256];
   char outBuf[4096];
-  char progName[PATH_MAX];} connectionRecType;
+  char progName[PATH_MAX];
+  int inLen;
+  int nSubs;
+  subscriptionRecType subs[MAX_SUBSCRIPTIONS];
+  streamRecType stream;
+  struct connectionRec *next;} connectionRecType;
 
 int port = 5007;
 int server_sockfd;
@@ -472,6 +531,9 @@ char enablePWD[16] = "EMCTOO\0";
 char serverName[24] = "EMCNETSVR\0";
 int sessions = 0;
 int maxSessions = -1;
+bool eventMode = false;
+int eventPeriod = 100;
+static connectionRecType *clients = NULL;
 
 const char *setCommands[] = {
   "ECHO", "VERBOSE", "ENABLE", "CONFIG", "COMM_MODE", "COMM_PROT", "INIFILE", "PLAT", "INI", "DEBUG",
@@ -488,7 +550,8 @@ const char *setCommands[] = {
   "PROBE_VALUE", "PROBE", "TELEOP_ENABLE", "KINEMATICS_TYPE", "OVERRIDE_LIMITS", 
   "SPINDLE_OVERRIDE", "OPTIONAL_STOP", ""};
 
-const char *commands[] = {"HELLO", "SET", "GET", "QUIT", "SHUTDOWN", "HELP", ""};
+const char *commands[] = {"HELLO", "SET", "GET", "QUIT", "SHUTDOWN", "HELP",
+  "SUBSCRIBE", "UNSUBSCRIBE", "STREAM", ""};
 
 struct option longopts[] = {
   {"help", 0, NULL, 'h'},
@@ -498,6 +561,8 @@ struct option longopts[] = {
   {"connectpw", 1, NULL, 'w'},
   {"enablepw", 1, NULL, 'e'},
   {"path", 1, NULL, 'd'},
+  {"events", 0, NULL, 'E'},
+  {"period", 1, NULL, 'P'},
   {0,0,0,0}};
 
 /* static char *skipWhite(char *s)
@@ -2336,23 +2401,18 @@ static cmdResponseType getOptionalStop(char *s, connectionRecType *context)
   return rtNoError;
 }
 
-int commandGet(connectionRecType *context)
+// put the reply to get sub-command pch in context->outBuf; the status is
+// read by the event loop in event mode
+static cmdResponseType doGet(char *pch, connectionRecType *context)
 {
-  const static char *setNakStr = "GET NAK\r\n";
-  const static char *setCmdNakStr = "GET %s NAK\r\n";
   setCommandType cmd;
-  char *pch;
   cmdResponseType ret = rtNoError;
-  
-  pch = strtok(NULL, delims);
-  if (pch == NULL) {
-    return write(context->cliSock, setNakStr, strlen(setNakStr));
-    }
-  if (emcUpdateType == EMC_UPDATE_AUTO) updateStatus();
+
+  if (emcUpdateType == EMC_UPDATE_AUTO && !eventMode) updateStatus();
   strupr(pch);
   cmd = lookupSetCommand(pch);
   if (cmd > scIni)
-    if (emcUpdateType == EMC_UPDATE_AUTO) updateStatus();
+    if (emcUpdateType == EMC_UPDATE_AUTO && !eventMode) updateStatus();
   switch (cmd) {
     case scEcho: ret = getEcho(pch, context); break;
     case scVerbose: ret = getVerbose(pch, context); break;
@@ -2432,6 +2492,21 @@ int commandGet(connectionRecType *context)
     case scOptionalStop: ret = getOptionalStop(pch, context); break;
     case scUnknown: ret = rtStandardError;
     }
+  return ret;
+}
+
+int commandGet(connectionRecType *context)
+{
+  const static char *setNakStr = "GET NAK\r\n";
+  const static char *setCmdNakStr = "GET %s NAK\r\n";
+  char *pch;
+  cmdResponseType ret;
+
+  pch = strtok(NULL, delims);
+  if (pch == NULL) {
+    return write(context->cliSock, setNakStr, strlen(setNakStr));
+    }
+  ret = doGet(pch, context);
   switch (ret) {
     case rtNoError: // Standard ok response, just write value in buffer
       sockWrite(context);
@@ -2450,6 +2525,274 @@ int commandGet(connectionRecType *context)
   return 0;
 }
 
+// the rest of the command line, with the words separated by one space
+static void restOfLine(char *buf, size_t len)
+{
+  char *pch;
+
+  buf[0] = 0;
+  while ((pch = strtok(NULL, delims)) != NULL) {
+    if (buf[0]) strncat(buf, " ", len - strlen(buf) - 1);
+    strncat(buf, pch, len - strlen(buf) - 1);
+    }
+}
+
+int commandSubscribe(connectionRecType *context)
+{
+  static const char *subAckStr = "SUBSCRIBE ACK\r\n";
+  static const char *subNakStr = "SUBSCRIBE NAK\r\n";
+  char cmd[64], word[64];
+  int i;
+
+  restOfLine(cmd, sizeof(cmd));
+  sscanf(cmd, "%63s", word);
+  strupr(word);
+  if (!eventMode || cmd[0] == 0 || lookupSetCommand(word) == scUnknown)
+    return write(context->cliSock, subNakStr, strlen(subNakStr));
+  for (i = 0; i < context->nSubs; i++)
+    if (strcasecmp(context->subs[i].cmd, cmd) == 0) break;
+  if (i == context->nSubs) {
+    if (i == MAX_SUBSCRIPTIONS)
+      return write(context->cliSock, subNakStr, strlen(subNakStr));
+    strcpy(context->subs[i].cmd, cmd);
+    context->nSubs++;
+    }
+  // sent again on the next check
+  context->subs[i].last[0] = 0;
+  return write(context->cliSock, subAckStr, strlen(subAckStr));
+}
+
+int commandUnsubscribe(connectionRecType *context)
+{
+  static const char *unsubAckStr = "UNSUBSCRIBE ACK\r\n";
+  static const char *unsubNakStr = "UNSUBSCRIBE NAK\r\n";
+  char cmd[64];
+  int i;
+
+  restOfLine(cmd, sizeof(cmd));
+  if (cmd[0] == 0) {
+    context->nSubs = 0;
+    return write(context->cliSock, unsubAckStr, strlen(unsubAckStr));
+    }
+  for (i = 0; i < context->nSubs; i++)
+    if (strcasecmp(context->subs[i].cmd, cmd) == 0) break;
+  if (i == context->nSubs)
+    return write(context->cliSock, unsubNakStr, strlen(unsubNakStr));
+  context->nSubs--;
+  memmove(&context->subs[i], &context->subs[i + 1],
+    (context->nSubs - i) * sizeof(subscriptionRecType));
+  return write(context->cliSock, unsubAckStr, strlen(unsubAckStr));
+}
+
+// send the subscribed values of context that changed since they were sent
+static void pushSubscriptions(connectionRecType *context)
+{
+  char cmd[64];
+  char *pch;
+  int i;
+
+  for (i = 0; i < context->nSubs; i++) {
+    subscriptionRecType *sub = &context->subs[i];
+
+    strcpy(cmd, sub->cmd);
+    pch = strtok(cmd, delims);
+    if (pch == NULL) continue;
+    context->outBuf[0] = 0;
+    if (doGet(pch, context) != rtNoError) continue;
+    if (strncmp(context->outBuf, sub->last, sizeof(sub->last) - 1) == 0)
+      continue;
+    strncpy(sub->last, context->outBuf, sizeof(sub->last) - 1);
+    sub->last[sizeof(sub->last) - 1] = 0;
+    sockWrite(context);
+    }
+}
+
+static int poseValues(const EmcPose &p, double *v)
+{
+  v[0] = p.tran.x; v[1] = p.tran.y; v[2] = p.tran.z;
+  v[3] = p.a; v[4] = p.b; v[5] = p.c;
+  v[6] = p.u; v[7] = p.v; v[8] = p.w;
+  return 9;
+}
+
+static int sfTaskState(double *v) { v[0] = emcStatus->task.state; return 1; }
+static int sfTaskMode(double *v) { v[0] = emcStatus->task.mode; return 1; }
+static int sfInterpState(double *v) { v[0] = emcStatus->task.interpState; return 1; }
+static int sfExecState(double *v) { v[0] = emcStatus->task.execState; return 1; }
+static int sfEStop(double *v) { v[0] = emcStatus->io.aux.estop; return 1; }
+static int sfProgramLine(double *v) { v[0] = emcStatus->task.motionLine; return 1; }
+static int sfCurrentLine(double *v) { v[0] = emcStatus->task.currentLine; return 1; }
+static int sfTool(double *v) { v[0] = emcStatus->io.tool.toolInSpindle; return 1; }
+static int sfFeedOverride(double *v) { v[0] = emcStatus->motion.traj.scale; return 1; }
+static int sfSpindleOverride(double *v) { v[0] = emcStatus->motion.traj.spindle_scale; return 1; }
+static int sfSpindleSpeed(double *v) { v[0] = emcStatus->motion.spindle.speed; return 1; }
+static int sfCurrentVel(double *v) { v[0] = emcStatus->motion.traj.current_vel; return 1; }
+static int sfAbsCmdPos(double *v) { return poseValues(emcStatus->motion.traj.position, v); }
+static int sfAbsActPos(double *v) { return poseValues(emcStatus->motion.traj.actualPosition, v); }
+static int sfDtg(double *v) { return poseValues(emcStatus->motion.traj.dtg, v); }
+
+static int streamJoints()
+{
+  int n = emcStatus->motion.traj.joints;
+  if (n < 0) n = 0;
+  if (n > EMCMOT_MAX_JOINTS) n = EMCMOT_MAX_JOINTS;
+  return n;
+}
+
+static int sfJointPos(double *v)
+{
+  int i, n = streamJoints();
+  for (i = 0; i < n; i++) v[i] = emcStatus->motion.joint[i].input;
+  return n;
+}
+
+static int sfJointHomed(double *v)
+{
+  int i, n = streamJoints();
+  for (i = 0; i < n; i++) v[i] = emcStatus->motion.joint[i].homed;
+  return n;
+}
+
+// the status fields a stream can have; each puts up to EMCMOT_MAX_JOINTS
+// values in v and returns how many.  A list is an array in JSON.
+static const struct {
+  const char *name;
+  int (*get)(double *v);
+  bool list;
+} streamFields[] = {
+  {"task_state", sfTaskState, false}, {"task_mode", sfTaskMode, false},
+  {"interp_state", sfInterpState, false}, {"exec_state", sfExecState, false},
+  {"estop", sfEStop, false}, {"program_line", sfProgramLine, false},
+  {"current_line", sfCurrentLine, false}, {"tool", sfTool, false},
+  {"feed_override", sfFeedOverride, false},
+  {"spindle_override", sfSpindleOverride, false},
+  {"spindle_speed", sfSpindleSpeed, false},
+  {"current_vel", sfCurrentVel, false},
+  {"abs_cmd_pos", sfAbsCmdPos, true}, {"abs_act_pos", sfAbsActPos, true},
+  {"dtg", sfDtg, true}, {"joint_pos", sfJointPos, true},
+  {"joint_homed", sfJointHomed, true},
+  {NULL, NULL, false}};
+
+int commandStream(connectionRecType *context)
+{
+  static const char *streamAckStr = "STREAM ACK\r\n";
+  static const char *streamNakStr = "STREAM NAK\r\n";
+  streamRecType *stream = &context->stream;
+  int fields[MAX_STREAM_FIELDS];
+  int nFields = 0;
+  bool onChange;
+  double period;
+  char *pch;
+  int i;
+
+  pch = strtok(NULL, delims);
+  if (!eventMode || pch == NULL)
+    return write(context->cliSock, streamNakStr, strlen(streamNakStr));
+  strupr(pch);
+  if (strcmp(pch, "OFF") == 0) {
+    stream->active = false;
+    return write(context->cliSock, streamAckStr, strlen(streamAckStr));
+    }
+  if (strcmp(pch, "FIELDS") == 0) {
+    strcpy(context->outBuf, "STREAM FIELDS");
+    for (i = 0; streamFields[i].name; i++) {
+      strcat(context->outBuf, " ");
+      strcat(context->outBuf, streamFields[i].name);
+      }
+    return sockWrite(context);
+    }
+
+  onChange = strcmp(pch, "ON_CHANGE") == 0;
+  period = onChange ? 0 : atof(pch) / 1000.0;
+  if (!onChange && period <= 0)
+    return write(context->cliSock, streamNakStr, strlen(streamNakStr));
+  while ((pch = strtok(NULL, delims)) != NULL) {
+    for (i = 0; streamFields[i].name; i++)
+      if (strcasecmp(streamFields[i].name, pch) == 0) break;
+    if (streamFields[i].name == NULL || nFields == MAX_STREAM_FIELDS)
+      return write(context->cliSock, streamNakStr, strlen(streamNakStr));
+    fields[nFields++] = i;
+    }
+  if (nFields == 0)
+    return write(context->cliSock, streamNakStr, strlen(streamNakStr));
+  memcpy(stream->fields, fields, nFields * sizeof(int));
+  stream->nFields = nFields;
+  stream->onChange = onChange;
+  stream->period = period;
+  stream->next = 0;
+  stream->seq = 0;
+  stream->nLast = -1;
+  stream->active = true;
+  return write(context->cliSock, streamAckStr, strlen(streamAckStr));
+}
+
+// send a record of context's stream if it is due at time now
+static void pushStream(connectionRecType *context, double now)
+{
+  streamRecType *stream = &context->stream;
+  double values[MAX_STREAM_VALUES];
+  int counts[MAX_STREAM_FIELDS];
+  int i, j, n = 0;
+
+  if (!stream->active) return;
+  if (!stream->onChange && now < stream->next) return;
+  for (i = 0; i < stream->nFields; i++) {
+    counts[i] = streamFields[stream->fields[i]].get(values + n);
+    n += counts[i];
+    }
+  if (stream->onChange) {
+    if (n == stream->nLast
+        && memcmp(values, stream->last, n * sizeof(double)) == 0)
+      return;
+    memcpy(stream->last, values, n * sizeof(double));
+    stream->nLast = n;
+    }
+  else {
+    // keep to the period, unless a whole one went by
+    stream->next += stream->period;
+    if (stream->next < now) stream->next = now + stream->period;
+    }
+  stream->seq++;
+
+  if (context->commMode == 1) {
+    char buf[16 + MAX_STREAM_FIELDS + MAX_STREAM_VALUES * sizeof(double)];
+    unsigned short len;
+    size_t pos = 16;
+
+    for (i = 0, n = 0; i < stream->nFields; i++) {
+      buf[pos++] = (char)counts[i];
+      memcpy(buf + pos, values + n, counts[i] * sizeof(double));
+      pos += counts[i] * sizeof(double);
+      n += counts[i];
+      }
+    buf[0] = 'L';
+    buf[1] = 'S';
+    len = pos - 16;
+    memcpy(buf + 2, &len, 2);
+    memcpy(buf + 4, &stream->seq, 4);
+    memcpy(buf + 8, &now, 8);
+    if (write(context->cliSock, buf, pos) != (ssize_t)pos)
+      fprintf(stderr, "linuxcncrsh: write() failed: %s", strerror(errno));
+    return;
+    }
+
+  char json[24 * MAX_STREAM_VALUES + 32 * MAX_STREAM_FIELDS + 64];
+  int pos = snprintf(json, sizeof(json), "{\"seq\":%u,\"time\":%.6f",
+    stream->seq, now);
+  for (i = 0, n = 0; i < stream->nFields; i++) {
+    bool list = streamFields[stream->fields[i]].list;
+    pos += snprintf(json + pos, sizeof(json) - pos, ",\"%s\":%s",
+      streamFields[stream->fields[i]].name, list ? "[" : "");
+    for (j = 0; j < counts[i]; j++, n++)
+      pos += snprintf(json + pos, sizeof(json) - pos, "%s%.10g",
+        j ? "," : "", values[n]);
+    if (list) pos += snprintf(json + pos, sizeof(json) - pos, "]");
+    }
+  pos += snprintf(json + pos, sizeof(json) - pos, "}\r\n");
+  if (write(context->cliSock, json, pos) != (ssize_t)pos)
+    fprintf(stderr, "linuxcncrsh: write() failed: %s", strerror(errno));
+}
+
 int commandQuit(connectionRecType *context)
 {
   printf("Closing connection with %s\n", context->hostName);
@@ -2474,6 +2817,9 @@ static int helpGeneral(connectionRecType *context)
   strcat(context->outBuf, "  Get <LinuxCNC command>\n\r");
   strcat(context->outBuf, "  Set <LinuxCNC command>\n\r");
   strcat(context->outBuf, "  Shutdown\n\r");
+  strcat(context->outBuf, "  Subscribe <LinuxCNC command>\n\r");
+  strcat(context->outBuf, "  Unsubscribe [<LinuxCNC command>]\n\r");
+  strcat(context->outBuf, "  Stream <Period ms | On_change> <Field> ... | Off | Fields\n\r");
   strcat(context->outBuf, "  Help <command>\n\r");
   sockWrite(context);
   return 0;
@@ -2638,6 +2984,32 @@ static int helpShutdown(connectionRecType *context)
   return 0;
 }
 
+static int helpSubscribe(connectionRecType *context)
+{
+  sprintf(context->outBuf, "Usage:\n\r");
+  strcat(context->outBuf, "  Subscribe <LinuxCNC command>\n\r");
+  strcat(context->outBuf, "  Unsubscribe [<LinuxCNC command>]\n\r");
+  strcat(context->outBuf, "  With the server started with --events, subscribe sends the reply to\n\r");
+  strcat(context->outBuf, "  Get <LinuxCNC command> each time it changes.  Unsubscribe without a\n\r");
+  strcat(context->outBuf, "  command removes all the subscriptions of the connection.\n\r");
+  sockWrite(context);
+  return 0;
+}
+
+static int helpStream(connectionRecType *context)
+{
+  sprintf(context->outBuf, "Usage:\n\r");
+  strcat(context->outBuf, "  Stream <Period ms | On_change> <Field> [<Field> ...]\n\r");
+  strcat(context->outBuf, "  Stream Off\n\r");
+  strcat(context->outBuf, "  Stream Fields\n\r");
+  strcat(context->outBuf, "  With the server started with --events, stream sends a record of the\n\r");
+  strcat(context->outBuf, "  fields each period, or when one of them changes.  The record is a line\n\r");
+  strcat(context->outBuf, "  of JSON with Comm_mode ASCII and a binary frame with Comm_mode Binary.\n\r");
+  strcat(context->outBuf, "  Stream Fields lists the fields.\n\r");
+  sockWrite(context);
+  return 0;
+}
+
 static int helpHelp(connectionRecType *context)
 {
   sprintf(context->outBuf, "If you need help on help, it is time to look into another line of work.\n\r");
@@ -2657,6 +3029,9 @@ int commandHelp(connectionRecType *context)
   if (strcmp(pch, "SET") == 0) return (helpSet(context));
   if (strcmp(pch, "QUIT") == 0) return (helpQuit(context));
   if (strcmp(pch, "SHUTDOWN") == 0) return (helpShutdown(context));
+  if (strcmp(pch, "SUBSCRIBE") == 0) return (helpSubscribe(context));
+  if (strcmp(pch, "UNSUBSCRIBE") == 0) return (helpSubscribe(context));
+  if (strcmp(pch, "STREAM") == 0) return (helpStream(context));
   if (strcmp(pch, "HELP") == 0) return (helpHelp(context));
   sprintf(context->outBuf, "%s is not a valid command.", pch);
   sockWrite(context);
@@ -2719,66 +3094,83 @@ int parseCommand(connectionRecType *context)
       case cmdHelp:
         ret = commandHelp(context);
 	break;
+      case cmdSubscribe:
+        ret = commandSubscribe(context);
+        break;
+      case cmdUnsubscribe:
+        ret = commandUnsubscribe(context);
+        break;
+      case cmdStream:
+        ret = commandStream(context);
+        break;
       case cmdUnknown: ret = -2;
       }
     }
   return ret;
 }  
 
-void *readClient(void *arg)
+// read what the client sent and handle the complete lines in it; returns
+// -1 on eof or a read error.  quit is set when a command returned -1,
+// as quit does.
+static int readInput(connectionRecType *context, bool *quit)
 {
   char buf[1600];
-  int context_index;
   int i;
   int len;
-  connectionRecType *context = (connectionRecType *)arg;
 
-  context_index = 0;
+  len = read(context->cliSock, buf, sizeof(buf));
+  if (len < 0) {
+    fprintf(stderr, "linuxcncrsh: error reading from client: %s\n", strerror(errno));
+    return -1;
+  }
+  if (len == 0) {
+    printf("linuxcncrsh: eof from client\n");
+    return -1;
+  }
 
-  while (1) {
-    // We always start this loop with an empty buf, though there may be one
-    // partial line in context->inBuf[0..context_index].
-    len = read(context->cliSock, buf, sizeof(buf));
-    if (len < 0) {
-      fprintf(stderr, "linuxcncrsh: error reading from client: %s\n", strerror(errno));
-      goto finished;
-    }
-    if (len == 0) {
-      printf("linuxcncrsh: eof from client\n");
-      goto finished;
+  if (context->echo && context->linked)
+    if(write(context->cliSock, buf, len) != (ssize_t)len) {
+      fprintf(stderr, "linuxcncrsh: write() failed: %s", strerror(errno));
     }
 
-    if (context->echo && context->linked)
-      if(write(context->cliSock, buf, len) != (ssize_t)len) {
-        fprintf(stderr, "linuxcncrsh: write() failed: %s", strerror(errno));
+  for (i = 0; i < len; i ++) {
+      if ((buf[i] != '\n') && (buf[i] != '\r')) {
+          // an overlong line is cut at the size of inBuf
+          if (context->inLen < (int)sizeof(context->inBuf) - 1) {
+              context->inBuf[context->inLen] = buf[i];
+              context->inLen ++;
+          }
+          continue;
       }
 
-    for (i = 0; i < len; i ++) {
-        if ((buf[i] != '\n') && (buf[i] != '\r')) {
-            context->inBuf[context_index] = buf[i];
-            context_index ++;
-            continue;
-        }
-
-        // if we get here, i is the index of a line terminator in buf
+      // if we get here, i is the index of a line terminator in buf
 
-        if (context_index > 0) {
-            // we have some bytes in the context buffer, parse them now
-            context->inBuf[context_index] = '\0';
+      if (context->inLen > 0) {
+          // we have some bytes in the context buffer, parse them now
+          context->inBuf[context->inLen] = '\0';
 
-            // The return value from parseCommand was meant to indicate
-            // success or error, but it is unusable.  Some paths return
-            // the return value of write(2) and some paths return small
-            // positive integers (cmdResponseType) to indicate failure.
-            // We're best off just ignoring it.
-            (void)parseCommand(context);
+          // The return value from parseCommand was meant to indicate
+          // success or error, but it is unusable.  Some paths return
+          // the return value of write(2) and some paths return small
+          // positive integers (cmdResponseType) to indicate failure.
+          // Only -1, from quit or a failed write, is looked at.
+          if (parseCommand(context) == -1) *quit = true;
 
-            context_index = 0;
-        }
-    }
+          context->inLen = 0;
+      }
   }
+  return 0;
+}
+
+void *readClient(void *arg)
+{
+  connectionRecType *context = (connectionRecType *)arg;
+  bool quit = false;
+
+  // quit is ignored here, as it always was
+  while (readInput(context, &quit) == 0)
+    ;
 
-finished:
   printf("linuxcncrsh: disconnecting client %s (%s)\n", context->hostName, context->version);
   close(context->cliSock);
   free(context);
@@ -2786,6 +3178,33 @@ finished:
   sessions--;  // FIXME: not reached
 }
 
+static connectionRecType *newContext(int client_sockfd)
+{
+  connectionRecType *context;
+
+  context = (connectionRecType *) malloc(sizeof(connectionRecType));
+  if (context == NULL) {
+    fprintf(stderr, "linuxcncrsh: out of memory\n");
+    exit(1);
+  }
+
+  context->cliSock = client_sockfd;
+  context->linked = false;
+  context->echo = true;
+  context->verbose = false;
+  strcpy(context->version, "1.0");
+  strcpy(context->hostName, "Default");
+  context->enabled = false;
+  context->commMode = 0;
+  context->commProt = 0;
+  context->inBuf[0] = 0;
+  context->inLen = 0;
+  context->nSubs = 0;
+  context->stream.active = false;
+  context->next = NULL;
+  return context;
+}
+
 int sockMain()
 {
     int res;
@@ -2808,23 +3227,7 @@ int sockMain()
           exit(1);
         }
 
-        context = (connectionRecType *) malloc(sizeof(connectionRecType));
-        if (context == NULL) {
-          fprintf(stderr, "linuxcncrsh: out of memory\n");
-          exit(1);
-        }
-
-        context->cliSock = client_sockfd;
-        context->linked = false;
-        context->echo = true;
-        context->verbose = false;
-        strcpy(context->version, "1.0");
-        strcpy(context->hostName, "Default");
-        context->enabled = false;
-        context->commMode = 0;
-        context->commProt = 0;
-        context->inBuf[0] = 0;
-
+        context = newContext(client_sockfd);
         res = pthread_create(thrd, NULL, readClient, (void *)context);
       } else {
         res = -1;
@@ -2837,6 +3240,94 @@ int sockMain()
     return 0;
 }
 
+static void closeClient(int epfd, connectionRecType *context)
+{
+  connectionRecType **p;
+
+  printf("linuxcncrsh: disconnecting client %s (%s)\n", context->hostName, context->version);
+  epoll_ctl(epfd, EPOLL_CTL_DEL, context->cliSock, NULL);
+  close(context->cliSock);
+  for (p = &clients; *p; p = &(*p)->next)
+    if (*p == context) {
+      *p = context->next;
+      break;
+      }
+  if (context->cliSock == enabledConn) enabledConn = -1;
+  free(context);
+  sessions--;
+}
+
+// With --events all the connections are served from this thread: the
+// status is read once for each round of requests and for each check of
+// the subscriptions, and each session's commands run in turn, so they
+// never see each other half way.
+int eventMain()
+{
+  struct epoll_event ev, events[32];
+  double nextPush = etime();
+  int epfd, n, i;
+
+  epfd = epoll_create1(0);
+  if (epfd < 0) {
+    fprintf(stderr, "linuxcncrsh: epoll_create1: %s\n", strerror(errno));
+    exit(1);
+  }
+  ev.events = EPOLLIN;
+  ev.data.ptr = NULL;
+  epoll_ctl(epfd, EPOLL_CTL_ADD, server_sockfd, &ev);
+
+  while (1) {
+    int timeout = (int)((nextPush - etime()) * 1000.0);
+    if (timeout < 0) timeout = 0;
+    n = epoll_wait(epfd, events, 32, timeout);
+    if (n < 0 && errno != EINTR) {
+      fprintf(stderr, "linuxcncrsh: epoll_wait: %s\n", strerror(errno));
+      exit(1);
+    }
+    if (emcUpdateType == EMC_UPDATE_AUTO) updateStatus();
+
+    for (i = 0; i < n; i++) {
+      connectionRecType *context = (connectionRecType *)events[i].data.ptr;
+      bool quit = false;
+
+      if (context == NULL) {
+        int client_sockfd;
+
+        client_len = sizeof(client_address);
+        client_sockfd = accept(server_sockfd,
+          (struct sockaddr *)&client_address, &client_len);
+        if (client_sockfd < 0) exit(0);
+        if ((maxSessions != -1) && (sessions >= maxSessions)) {
+          close(client_sockfd);
+          continue;
+          }
+        sessions++;
+        context = newContext(client_sockfd);
+        context->next = clients;
+        clients = context;
+        ev.events = EPOLLIN;
+        ev.data.ptr = context;
+        epoll_ctl(epfd, EPOLL_CTL_ADD, client_sockfd, &ev);
+        continue;
+        }
+      if (readInput(context, &quit) < 0 || quit)
+        closeClient(epfd, context);
+      }
+
+    if (etime() >= nextPush) {
+      connectionRecType *context;
+      double now = etime();
+
+      for (context = clients; context; context = context->next) {
+        pushSubscriptions(context);
+        pushStream(context, now);
+        }
+      nextPush = etime() + eventPeriod / 1000.0;
+      }
+    }
+  return 0;
+}
+
 static void initMain()
 {
     emcWaitType = EMC_WAIT_RECEIVED;
@@ -2867,9 +3358,11 @@ static void usage(char* pname) {
            "         --enablepw   <password>     (default=%s)\n"
            "         --sessions   <max sessions> (default=%d) (-1 ==> no limit) \n"
            "         --path       <path>         (default=%s)\n"
+           "         --events                    (serve all connections from one thread)\n"
+           "         --period     <ms>           (default=%d) (subscription check period with --events)\n"
            "LinuxCNC_Options:\n"
            "          -ini        <inifile>      (default=%s)\n"
-          ,pname,port,serverName,pwd,enablePWD,maxSessions,defaultPath,emc_inifile
+          ,pname,port,serverName,pwd,enablePWD,maxSessions,defaultPath,eventPeriod,emc_inifile
           );
 }
 
@@ -2879,7 +3372,7 @@ int main(int argc, char *argv[])
 
     initMain();
     // process local command line args
-    while((opt = getopt_long(argc, argv, "he:n:p:s:w:d:", longopts, NULL)) != - 1) {
+    while((opt = getopt_long(argc, argv, "he:n:p:s:w:d:EP:", longopts, NULL)) != - 1) {
       switch(opt) {
         case 'h': usage(argv[0]); exit(1);
         case 'e': strncpy(enablePWD, optarg, strlen(optarg) + 1); break;
@@ -2887,7 +3380,9 @@ int main(int argc, char *argv[])
         case 'p': sscanf(optarg, "%d", &port); break;
         case 's': sscanf(optarg, "%d", &maxSessions); break;
         case 'w': strncpy(pwd, optarg, strlen(optarg) + 1); break;
-        case 'd': strncpy(defaultPath, optarg, strlen(optarg) + 1);
+        case 'd': strncpy(defaultPath, optarg, strlen(optarg) + 1); break;
+        case 'E': eventMode = true; break;
+        case 'P': sscanf(optarg, "%d", &eventPeriod); break;
         }
       }
 
@@ -2933,7 +3428,10 @@ int main(int argc, char *argv[])
         sigaction(SIGPIPE, &act, NULL);
     }
 
-    if (useSockets) sockMain();
+    if (useSockets) {
+      if (eventMode) eventMain();
+      else sockMain();
+      }
 
     return 0;
 }
@@ -23,6 +23,7 @@
 #include <math.h>
 #include <sys/types.h>
 #include <list>
+#include <vector>
 #include <stdint.h>
 
 #include "rcs.hh"
@@ -100,6 +101,18 @@ SchedEntry::SchedEntry() {
 
 list<SchedEntry> q;
 
+// The next job, got ready while the one before it runs: its path, with
+// the file read through once so that task opens it from the page cache,
+// and the MDI lines that set up its offsets.
+static struct {
+  bool valid;
+  int tagId;
+  string fileName;
+  bool readable;
+  string path;
+  vector<string> setup;
+} staged;
+
 bool operator<(const SchedEntry &a, const SchedEntry &b) {
   return a.getPriority() < b.getPriority();
   }
@@ -245,65 +258,79 @@ bool interlocksOk() {
   return true;
 }
 
+static void stageJob(SchedEntry &e) {
+  static const char *zones[] = {"G54", "G55", "G56", "G57", "G58", "G59",
+    "G59.1", "G59.2", "G59.3"};
+  char buf[65536];
+  char cmd[80];
+  float x, y, z;
+  FILE *f;
+
+  if (staged.valid && staged.tagId == e.getTagId()
+      && staged.fileName == e.getFileName())
+    return;
+  staged.valid = true;
+  staged.tagId = e.getTagId();
+  staged.fileName = e.getFileName();
+  staged.path = string(defaultPath) + e.getFileName();
+  f = fopen(staged.path.c_str(), "r");
+  staged.readable = f != NULL;
+  if (f) {
+    while (fread(buf, 1, sizeof(buf), f) == sizeof(buf))
+      ;
+    if (ferror(f)) staged.readable = false;
+    fclose(f);
+    }
+  staged.setup.clear();
+  staged.setup.push_back("G92.1");
+  if (e.getZone() >= 1 && e.getZone() <= 9)
+    staged.setup.push_back(zones[e.getZone() - 1]);
+  else if (e.getZone() == 0) {
+    e.getOffsets(x, y, z);
+    sprintf(cmd, "G0 X%f Y%f Z%f", x, y, z);
+    staged.setup.push_back(cmd);
+    staged.setup.push_back("G92 X0 Y0 Z0");
+    }
+  }
+
 void updateQueue() {
   char fileStr[255];
-  float x, y, z;
-  char cmd[80];
+  const char *setup[4];
 
   if (queueStatus == qsRun) {
+    updateStatus();
     if (isIdle() && q.empty()) {
       queueStatus = qsStop;
       return;
       }
     if (!q.empty()) {
+      // get the next job ready while this one runs
+      stageJob(q.front());
       if (isIdle()) {
         q.front().setPriority(MAX_PRIORITY); // Lock job as first job
+        if (!staged.readable) {
+          queueStatus = qsError;
+          return;
+          }
         if (interlocksOk()) {
           sendFeedOverride(((double) q.front().getFeedOverride()) / 100.0);
           sendSpindleOverride(((double) q.front().getSpindleOverride()) / 100.0);             
           sendMdi();
-          sendMdiCmd("G92.1\n");
-          if (emcCommandWaitDone() != 0) {
+          // the offsets are set up by one batch of MDI lines
+          for (size_t i = 0; i < staged.setup.size(); i++)
+            setup[i] = staged.setup[i].c_str();
+          if (sendMdiBatch(setup, staged.setup.size()) != 0
+              || emcMdiBatchWaitDone() != 0) {
             queueStatus = qsError;
             return;
             }
-          if (q.front().getZone() != 0) {
-            switch (q.front().getZone()) {
-              case 1: sendMdiCmd("G54\n"); break;
-              case 2: sendMdiCmd("G55\n"); break;
-              case 3: sendMdiCmd("G56\n"); break;
-              case 4: sendMdiCmd("G57\n"); break;
-              case 5: sendMdiCmd("G58\n"); break;
-              case 6: sendMdiCmd("G59\n"); break;
-              case 7: sendMdiCmd("G59.1\n"); break;
-              case 8: sendMdiCmd("G59.2\n"); break;
-              case 9: sendMdiCmd("G59.3\n");
-              }
-            if (emcCommandWaitDone() != 0) {
-              queueStatus = qsError;
-              return;
-              }
-            }
-          else {
-             q.front().getOffsets(x, y, z);
-             sprintf(cmd, "G0 X%f Y%f Z%f\n", x, y, z); 
-             sendMdiCmd(cmd);
-             if (emcCommandWaitDone() != 0) {
-               queueStatus = qsError;
-               return;
-               }
-             sendMdiCmd("G92 X0 Y0 Z0\n");
-             if (emcCommandWaitDone() != 0) {
-               queueStatus = qsError;
-               return;
-               }
-             }
           if (sendTaskPlanInit() != 0) {
             queueStatus = qsError;
             }
           sendAuto();
-          strcpy(fileStr, defaultPath);
-          strcat(fileStr, q.front().getFileName().c_str());
+          strncpy(fileStr, staged.path.c_str(), sizeof(fileStr) - 1);
+          fileStr[sizeof(fileStr) - 1] = 0;
+          staged.valid = false;
           if (sendProgramOpen(fileStr) != 0) {
             queueStatus = qsError;
             return;
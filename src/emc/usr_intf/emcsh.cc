@@ -93,10 +93,17 @@
   is a real number. If it's <= 0.0, it means wait forever. Default is 0.0,
   wait forever.
 
-  emc_update (none) | none | auto
+  emc_update (none) | none | auto | snapshot (<period>)
   With no arg, forces an update of the EMC status. With "none", doesn't
   cause an automatic update of status with other emc_ words. With "auto",
   makes emc_ words automatically update status before they return values.
+  With "snapshot", the status is updated at most once per <period> seconds
+  (default 0.05), and the emc_ words of one refresh share it.
+
+  emc_status <word> (<word> ...)
+  Updates the status once and returns a dict of what each emc_<word>
+  returns.  A word may be a list of the name and its arguments, e.g.
+  emc_status estop mode {abs_act_pos 0}
 
   emc_error
   Returns the current EMC error string, or "ok" if no error.
@@ -423,6 +430,24 @@ static int emc_ini(ClientData clientdata,
     return TCL_OK;
 }
 
+// With "emc_update snapshot", the status read at most once per
+// snapshotPeriod serves all the emc_ words that ask for it until then.
+static double snapshotPeriod = 0.05;
+static double snapshotTime = -1.0;
+
+static void autoUpdateStatus()
+{
+    if (emcUpdateType == EMC_UPDATE_AUTO) {
+	updateStatus();
+    } else if (emcUpdateType == EMC_UPDATE_SNAPSHOT) {
+	double now = etime();
+	if (snapshotTime < 0.0 || now - snapshotTime >= snapshotPeriod) {
+	    updateStatus();
+	    snapshotTime = now;
+	}
+    }
+}
+
 static int emc_Debug(ClientData clientdata,
 		     Tcl_Interp * interp, int objc, Tcl_Obj * CONST objv[])
 {
@@ -430,9 +455,7 @@ static int emc_Debug(ClientData clientdata,
     int debug;
 
     CHECKEMC
-    if (emcUpdateType == EMC_UPDATE_AUTO) {
-	updateStatus();
-    }
+    autoUpdateStatus();
 
     if (objc == 1) {
 	// no arg-- return current value
@@ -554,24 +577,99 @@ static int emc_update(ClientData clientdata,
     if (objc == 1) {
 	// no arg-- return status
 	updateStatus();
+	snapshotTime = etime();
 	return TCL_OK;
     }
 
-    if (objc == 2) {
+    if (objc == 2 || objc == 3) {
 	objstr = Tcl_GetStringFromObj(objv[1], 0);
-	if (!strcmp(objstr, "none")) {
+	if (objc == 2 && !strcmp(objstr, "none")) {
 	    emcUpdateType = EMC_UPDATE_NONE;
 	    return TCL_OK;
 	}
-	if (!strcmp(objstr, "auto")) {
+	if (objc == 2 && !strcmp(objstr, "auto")) {
 	    emcUpdateType = EMC_UPDATE_AUTO;
 	    return TCL_OK;
 	}
+	if (!strcmp(objstr, "snapshot")) {
+	    double period = snapshotPeriod;
+	    if (objc == 3 &&
+		(TCL_OK != Tcl_GetDoubleFromObj(0, objv[2], &period)
+		 || period < 0.0)) {
+		setresult(interp,"emc_update: need snapshot period in seconds");
+		return TCL_ERROR;
+	    }
+	    snapshotPeriod = period;
+	    snapshotTime = -1.0;
+	    emcUpdateType = EMC_UPDATE_SNAPSHOT;
+	    return TCL_OK;
+	}
     }
 
     return TCL_OK;
 }
 
+/*
+  emc_status <word> ?<word> ...?  Reads the status once and returns a dict
+  of what each "emc_<word>" returns for it, where a word may be a list of
+  the name and its arguments, such as {abs_act_pos 0}.
+*/
+static int emc_status(ClientData clientdata,
+		      Tcl_Interp * interp, int objc,
+		      Tcl_Obj * CONST objv[])
+{
+    EMC_UPDATE_TYPE saved = emcUpdateType;
+    Tcl_Obj *dict, *cmdv[8];
+    int i, j, n, ret = TCL_OK;
+    Tcl_Obj **words;
+
+    CHECKEMC
+    if (objc < 2) {
+	setresult(interp,"emc_status: need one or more status words");
+	return TCL_ERROR;
+    }
+
+    if (emcUpdateType != EMC_UPDATE_NONE) {
+	updateStatus();
+	snapshotTime = etime();
+    }
+    emcUpdateType = EMC_UPDATE_NONE;
+    dict = Tcl_NewDictObj();
+    Tcl_IncrRefCount(dict);
+    for (i = 1; i < objc && ret == TCL_OK; i++) {
+	if (Tcl_ListObjGetElements(interp, objv[i], &n, &words) != TCL_OK) {
+	    ret = TCL_ERROR;
+	    break;
+	}
+	if (n < 1 || n > 8) {
+	    setresult(interp,"emc_status: bad status word");
+	    ret = TCL_ERROR;
+	    break;
+	}
+	cmdv[0] = Tcl_NewStringObj("emc_", -1);
+	Tcl_AppendObjToObj(cmdv[0], words[0]);
+	for (j = 1; j < n; j++) {
+	    cmdv[j] = words[j];
+	}
+	for (j = 0; j < n; j++) {
+	    Tcl_IncrRefCount(cmdv[j]);
+	}
+	ret = Tcl_EvalObjv(interp, n, cmdv, 0);
+	if (ret == TCL_OK) {
+	    Tcl_DictObjPut(interp, dict, objv[i], Tcl_GetObjResult(interp));
+	}
+	for (j = 0; j < n; j++) {
+	    Tcl_DecrRefCount(cmdv[j]);
+	}
+    }
+    emcUpdateType = saved;
+    if (ret == TCL_OK) {
+	Tcl_SetObjResult(interp, dict);
+    }
+    Tcl_DecrRefCount(dict);
+    return ret;
+}
+
 static int emc_time(ClientData clientdata,
 		    Tcl_Interp * interp, int objc, Tcl_Obj * CONST objv[])
 {
@@ -670,9 +768,7 @@ static int emc_estop(ClientData clientdata,
     CHECKEMC
     if (objc == 1) {
 	// no arg-- return status
-	if (emcUpdateType == EMC_UPDATE_AUTO) {
-	    updateStatus();
-	}
+	autoUpdateStatus();
 	if (emcStatus->task.state == EMC_TASK_STATE_ESTOP) {
 	    setresult(interp,"on");
 	} else {
@@ -706,9 +802,7 @@ static int emc_machine(ClientData clientdata,
     CHECKEMC
     if (objc == 1) {
 	// no arg-- return status
-	if (emcUpdateType == EMC_UPDATE_AUTO) {
-	    updateStatus();
-	}
+	autoUpdateStatus();
 	if (emcStatus->task.state == EMC_TASK_STATE_ON) {
 	    setresult(interp,"on");
 	} else {
@@ -741,9 +835,7 @@ static int emc_mode(ClientData clientdata,
     CHECKEMC
     if (objc == 1) {
 	// no arg-- return status
-	if (emcUpdateType == EMC_UPDATE_AUTO) {
-	    updateStatus();
-	}
+	autoUpdateStatus();
 	switch (emcStatus->task.mode) {
 	case EMC_TASK_MODE_MANUAL:
 	    setresult(interp,"manual");
@@ -789,9 +881,7 @@ static int emc_mist(ClientData clientdata,
     CHECKEMC
     if (objc == 1) {
 	// no arg-- return status
-	if (emcUpdateType == EMC_UPDATE_AUTO) {
-	    updateStatus();
-	}
+	autoUpdateStatus();
 	if (emcStatus->io.coolant.mist == 1) {
 	    setresult(interp,"on");
 	} else {
@@ -824,9 +914,7 @@ static int emc_flood(ClientData clientdata,
     CHECKEMC
     if (objc == 1) {
 	// no arg-- return status
-	if (emcUpdateType == EMC_UPDATE_AUTO) {
-	    updateStatus();
-	}
+	autoUpdateStatus();
 	if (emcStatus->io.coolant.flood == 1) {
 	    setresult(interp,"on");
 	} else {
@@ -858,9 +946,7 @@ static int emc_lube(ClientData clientdata,
     CHECKEMC
     if (objc == 1) {
 	// no arg-- return status
-	if (emcUpdateType == EMC_UPDATE_AUTO) {
-	    updateStatus();
-	}
+	autoUpdateStatus();
 	if (emcStatus->io.lube.on == 0) {
 	    setresult(interp,"off");
 	} else {
@@ -892,9 +978,7 @@ static int emc_lube_level(ClientData clientdata,
     CHECKEMC
     if (objc == 1) {
 	// no arg-- return status
-	if (emcUpdateType == EMC_UPDATE_AUTO) {
-	    updateStatus();
-	}
+	autoUpdateStatus();
 	if (emcStatus->io.lube.level == 0) {
 	    setresult(interp,"low");
 	} else {
@@ -916,9 +1000,7 @@ static int emc_spindle(ClientData clientdata,
     CHECKEMC
     if (objc == 1) {
 	// no arg-- return status
-	if (emcUpdateType == EMC_UPDATE_AUTO) {
-	    updateStatus();
-	}
+	autoUpdateStatus();
 	if (emcStatus->motion.spindle.increasing > 0) {
 	    setresult(interp,"increase");
 	} else if (emcStatus->motion.spindle.increasing < 0) {
@@ -973,9 +1055,7 @@ static int emc_brake(ClientData clientdata,
     CHECKEMC
     if (objc == 1) {
 	// no arg-- return status
-	if (emcUpdateType == EMC_UPDATE_AUTO) {
-	    updateStatus();
-	}
+	autoUpdateStatus();
 	if (emcStatus->motion.spindle.brake == 1) {
 	    setresult(interp,"on");
 	} else {
@@ -1011,9 +1091,7 @@ static int emc_tool(ClientData clientdata,
 	return TCL_ERROR;
     }
 
-    if (emcUpdateType == EMC_UPDATE_AUTO) {
-	updateStatus();
-    }
+    autoUpdateStatus();
 
     toolobj = Tcl_NewIntObj(emcStatus->io.tool.toolInSpindle);
 
@@ -1035,9 +1113,7 @@ static int emc_tool_offset(ClientData clientdata,
 	return TCL_ERROR;
     }
 
-    if (emcUpdateType == EMC_UPDATE_AUTO) {
-	updateStatus();
-    }
+    autoUpdateStatus();
 
     if (objc != 1) {
        strncpy(string, Tcl_GetStringFromObj(objv[1], 0),1);
@@ -1155,9 +1231,7 @@ static int emc_abs_cmd_pos(ClientData clientdata,
 	return TCL_ERROR;
     }
 
-    if (emcUpdateType == EMC_UPDATE_AUTO) {
-	updateStatus();
-    }
+    autoUpdateStatus();
 
     strncpy(string, Tcl_GetStringFromObj(objv[1], 0),1);
 
@@ -1220,9 +1294,7 @@ static int emc_abs_act_pos(ClientData clientdata,
 	return TCL_ERROR;
     }
 
-    if (emcUpdateType == EMC_UPDATE_AUTO) {
-	updateStatus();
-    }
+    autoUpdateStatus();
 
     strncpy(string, Tcl_GetStringFromObj(objv[1], 0),1);
 
@@ -1285,9 +1357,7 @@ static int emc_rel_cmd_pos(ClientData clientdata,
 	return TCL_ERROR;
     }
 
-    if (emcUpdateType == EMC_UPDATE_AUTO) {
-	updateStatus();
-    }
+    autoUpdateStatus();
 
     strncpy(string, Tcl_GetStringFromObj(objv[1], 0),1);
 
@@ -1369,9 +1439,7 @@ static int emc_rel_act_pos(ClientData clientdata,
 	return TCL_ERROR;
     }
 
-    if (emcUpdateType == EMC_UPDATE_AUTO) {
-	updateStatus();
-    }
+    autoUpdateStatus();
 
     strncpy(string, Tcl_GetStringFromObj(objv[1], 0),1);
 
@@ -1454,9 +1522,7 @@ static int emc_joint_pos(ClientData clientdata,
 	return TCL_ERROR;
     }
 
-    if (emcUpdateType == EMC_UPDATE_AUTO) {
-	updateStatus();
-    }
+    autoUpdateStatus();
 
     if (TCL_OK == Tcl_GetIntFromObj(0, objv[1], &joint)) {
 	posobj = Tcl_NewDoubleObj(emcStatus->motion.joint[joint].input);
@@ -1482,9 +1548,7 @@ static int emc_pos_offset(ClientData clientdata,
 	return TCL_ERROR;
     }
 
-    if (emcUpdateType == EMC_UPDATE_AUTO) {
-	updateStatus();
-    }
+    autoUpdateStatus();
 
     strncpy(string, Tcl_GetStringFromObj(objv[1], 0),1);
 
@@ -1546,9 +1610,7 @@ static int emc_joint_limit(ClientData clientdata,
 	return TCL_ERROR;
     }
 
-    if (emcUpdateType == EMC_UPDATE_AUTO) {
-	updateStatus();
-    }
+    autoUpdateStatus();
 
     if (TCL_OK == Tcl_GetIntFromObj(0, objv[1], &joint)) {
 	if (joint < 0 || joint >= EMCMOT_MAX_JOINTS) {
@@ -1590,9 +1652,7 @@ static int emc_joint_fault(ClientData clientdata,
 	return TCL_ERROR;
     }
 
-    if (emcUpdateType == EMC_UPDATE_AUTO) {
-	updateStatus();
-    }
+    autoUpdateStatus();
 
     if (TCL_OK == Tcl_GetIntFromObj(0, objv[1], &joint)) {
 	if (joint < 0 || joint >= EMCMOT_MAX_JOINTS) {
@@ -1623,9 +1683,7 @@ static int emc_override_limit(ClientData clientdata,
     CHECKEMC
     if (objc == 1) {
 	// no arg-- return status
-	if (emcUpdateType == EMC_UPDATE_AUTO) {
-	    updateStatus();
-	}
+	autoUpdateStatus();
 	// motion overrides all axes at same time, so just reference index 0
 	obj = Tcl_NewIntObj(emcStatus->motion.joint[0].overrideLimits);
 	Tcl_SetObjResult(interp, obj);
@@ -1668,9 +1726,7 @@ static int emc_joint_homed(ClientData clientdata,
 	return TCL_ERROR;
     }
 
-    if (emcUpdateType == EMC_UPDATE_AUTO) {
-	updateStatus();
-    }
+    autoUpdateStatus();
 
     if (TCL_OK == Tcl_GetIntFromObj(0, objv[1], &joint)) {
 	if (joint < 0 || joint >= EMCMOT_MAX_JOINTS) {
@@ -1868,9 +1924,7 @@ static int emc_feed_override(ClientData clientdata,
     CHECKEMC
     if (objc == 1) {
 	// no arg-- return status
-	if (emcUpdateType == EMC_UPDATE_AUTO) {
-	    updateStatus();
-	}
+	autoUpdateStatus();
 	feedobj =
 	    Tcl_NewIntObj((int)
 			  (emcStatus->motion.traj.scale * 100.0 + 0.5));
@@ -1902,9 +1956,7 @@ static int emc_rapid_override(ClientData clientdata,
     CHECKEMC
     if (objc == 1) {
 	// no arg-- return status
-	if (emcUpdateType == EMC_UPDATE_AUTO) {
-	    updateStatus();
-	}
+	autoUpdateStatus();
 	rapidobj =
 	    Tcl_NewIntObj((int)
 			  (emcStatus->motion.traj.rapid_scale * 100.0 + 0.5));
@@ -1936,9 +1988,7 @@ static int emc_spindle_override(ClientData clientdata,
     CHECKEMC
     if (objc == 1) {
 	// no arg-- return status
-	if (emcUpdateType == EMC_UPDATE_AUTO) {
-	    updateStatus();
-	}
+	autoUpdateStatus();
 	feedobj =
 	    Tcl_NewIntObj((int)
 			  (emcStatus->motion.traj.spindle_scale * 100.0 + 0.5));
@@ -2039,9 +2089,7 @@ static int emc_optional_stop(ClientData clientdata,
     CHECKEMC
     if (objc == 1) {
 	// no arg-- return status
-	if (emcUpdateType == EMC_UPDATE_AUTO) {
-	    updateStatus();
-	}
+	autoUpdateStatus();
 	// get the current state from the status
 	obj = Tcl_NewIntObj(emcStatus->task.optional_stop_state);
 	Tcl_SetObjResult(interp, obj);
@@ -2112,9 +2160,7 @@ static int emc_program(ClientData clientdata,
 	return TCL_ERROR;
     }
 
-    if (emcUpdateType == EMC_UPDATE_AUTO) {
-	updateStatus();
-    }
+    autoUpdateStatus();
 
     if (0 != emcStatus->task.file[0]) {
 	setresult(interp,emcStatus->task.file);
@@ -2135,9 +2181,7 @@ static int emc_program_status(ClientData clientdata,
 	return TCL_ERROR;
     }
 
-    if (emcUpdateType == EMC_UPDATE_AUTO) {
-	updateStatus();
-    }
+    autoUpdateStatus();
 
     switch (emcStatus->task.interpState) {
     case EMC_TASK_INTERP_READING:
@@ -2173,9 +2217,7 @@ static int emc_program_line(ClientData clientdata,
 	return TCL_ERROR;
     }
 
-    if (emcUpdateType == EMC_UPDATE_AUTO) {
-	updateStatus();
-    }
+    autoUpdateStatus();
 
     if (programStartLine < 0
 	|| emcStatus->task.readLine < programStartLine) {
@@ -2219,9 +2261,7 @@ static int emc_program_codes(ClientData clientdata,
 	return TCL_ERROR;
     }
 
-    if (emcUpdateType == EMC_UPDATE_AUTO) {
-	updateStatus();
-    }
+    autoUpdateStatus();
     // fill in the active G codes
     codes_string[0] = 0;
     for (t = 1; t < ACTIVE_G_CODES; t++) {
@@ -2269,9 +2309,7 @@ static int emc_joint_type(ClientData clientdata,
 	return TCL_ERROR;
     }
 
-    if (emcUpdateType == EMC_UPDATE_AUTO) {
-	updateStatus();
-    }
+    autoUpdateStatus();
 
     if (TCL_OK == Tcl_GetIntFromObj(0, objv[1], &joint)) {
 	if (joint < 0 || joint >= EMCMOT_MAX_JOINTS) {
@@ -2310,9 +2348,7 @@ static int emc_joint_units(ClientData clientdata,
 	return TCL_ERROR;
     }
 
-    if (emcUpdateType == EMC_UPDATE_AUTO) {
-	updateStatus();
-    }
+    autoUpdateStatus();
 
     if (TCL_OK == Tcl_GetIntFromObj(0, objv[1], &joint)) {
 	if (joint < 0 || joint >= EMCMOT_MAX_JOINTS) {
@@ -2393,9 +2429,7 @@ static int emc_program_linear_units(ClientData clientdata,
 	return TCL_ERROR;
     }
 
-    if (emcUpdateType == EMC_UPDATE_AUTO) {
-	updateStatus();
-    }
+    autoUpdateStatus();
 
     switch (emcStatus->task.programUnits) {
     case CANON_UNITS_INCHES:
@@ -2433,9 +2467,7 @@ static int emc_program_angular_units(ClientData clientdata,
 	return TCL_ERROR;
     }
 
-    if (emcUpdateType == EMC_UPDATE_AUTO) {
-	updateStatus();
-    }
+    autoUpdateStatus();
     // currently the EMC doesn't have separate program angular units, so
     // these are simply "deg"
     setresult(interp,"deg");
@@ -2452,9 +2484,7 @@ static int emc_user_linear_units(ClientData clientdata,
 	return TCL_ERROR;
     }
 
-    if (emcUpdateType == EMC_UPDATE_AUTO) {
-	updateStatus();
-    }
+    autoUpdateStatus();
 
     /* try mm */
     if (CLOSE(emcStatus->motion.traj.linearUnits, 1.0, LINEAR_CLOSENESS)) {
@@ -2489,9 +2519,7 @@ static int emc_user_angular_units(ClientData clientdata,
 	return TCL_ERROR;
     }
 
-    if (emcUpdateType == EMC_UPDATE_AUTO) {
-	updateStatus();
-    }
+    autoUpdateStatus();
 
     /* try degrees */
     if (CLOSE(emcStatus->motion.traj.angularUnits, 1.0, ANGULAR_CLOSENESS)) {
@@ -2526,9 +2554,7 @@ static int emc_display_linear_units(ClientData clientdata,
 	return TCL_ERROR;
     }
 
-    if (emcUpdateType == EMC_UPDATE_AUTO) {
-	updateStatus();
-    }
+    autoUpdateStatus();
 
     switch (linearUnitConversion) {
     case LINEAR_UNITS_INCH:
@@ -2571,9 +2597,7 @@ static int emc_display_angular_units(ClientData clientdata,
 	return TCL_ERROR;
     }
 
-    if (emcUpdateType == EMC_UPDATE_AUTO) {
-	updateStatus();
-    }
+    autoUpdateStatus();
 
     switch (angularUnitConversion) {
     case ANGULAR_UNITS_DEG:
@@ -2722,9 +2746,7 @@ static int emc_task_heartbeat(ClientData clientdata,
 	return TCL_ERROR;
     }
 
-    if (emcUpdateType == EMC_UPDATE_AUTO) {
-	updateStatus();
-    }
+    autoUpdateStatus();
 
     hbobj = Tcl_NewIntObj(emcStatus->task.heartbeat);
 
@@ -2744,9 +2766,7 @@ static int emc_task_command(ClientData clientdata,
 	return TCL_ERROR;
     }
 
-    if (emcUpdateType == EMC_UPDATE_AUTO) {
-	updateStatus();
-    }
+    autoUpdateStatus();
 
     commandobj = Tcl_NewIntObj(emcStatus->task.command_type);
 
@@ -2766,9 +2786,7 @@ static int emc_task_command_number(ClientData clientdata,
 	return TCL_ERROR;
     }
 
-    if (emcUpdateType == EMC_UPDATE_AUTO) {
-	updateStatus();
-    }
+    autoUpdateStatus();
 
     commandnumber = Tcl_NewIntObj(emcStatus->task.echo_serial_number);
 
@@ -2788,9 +2806,7 @@ static int emc_task_command_status(ClientData clientdata,
 	return TCL_ERROR;
     }
 
-    if (emcUpdateType == EMC_UPDATE_AUTO) {
-	updateStatus();
-    }
+    autoUpdateStatus();
 
     commandstatus = Tcl_NewIntObj(emcStatus->task.status);
 
@@ -2810,9 +2826,7 @@ static int emc_io_heartbeat(ClientData clientdata,
 	return TCL_ERROR;
     }
 
-    if (emcUpdateType == EMC_UPDATE_AUTO) {
-	updateStatus();
-    }
+    autoUpdateStatus();
 
     hbobj = Tcl_NewIntObj(emcStatus->io.heartbeat);
 
@@ -2832,9 +2846,7 @@ static int emc_io_command(ClientData clientdata,
 	return TCL_ERROR;
     }
 
-    if (emcUpdateType == EMC_UPDATE_AUTO) {
-	updateStatus();
-    }
+    autoUpdateStatus();
 
     commandobj = Tcl_NewIntObj(emcStatus->io.command_type);
 
@@ -2854,9 +2866,7 @@ static int emc_io_command_number(ClientData clientdata,
 	return TCL_ERROR;
     }
 
-    if (emcUpdateType == EMC_UPDATE_AUTO) {
-	updateStatus();
-    }
+    autoUpdateStatus();
 
     commandnumber = Tcl_NewIntObj(emcStatus->io.echo_serial_number);
 
@@ -2876,9 +2886,7 @@ static int emc_io_command_status(ClientData clientdata,
 	return TCL_ERROR;
     }
 
-    if (emcUpdateType == EMC_UPDATE_AUTO) {
-	updateStatus();
-    }
+    autoUpdateStatus();
 
     commandstatus = Tcl_NewIntObj(emcStatus->io.status);
 
@@ -2898,9 +2906,7 @@ static int emc_motion_heartbeat(ClientData clientdata,
 	return TCL_ERROR;
     }
 
-    if (emcUpdateType == EMC_UPDATE_AUTO) {
-	updateStatus();
-    }
+    autoUpdateStatus();
 
     hbobj = Tcl_NewIntObj(emcStatus->motion.heartbeat);
 
@@ -2920,9 +2926,7 @@ static int emc_motion_command(ClientData clientdata,
 	return TCL_ERROR;
     }
 
-    if (emcUpdateType == EMC_UPDATE_AUTO) {
-	updateStatus();
-    }
+    autoUpdateStatus();
 
     commandobj = Tcl_NewIntObj(emcStatus->motion.command_type);
 
@@ -2942,9 +2946,7 @@ static int emc_motion_command_number(ClientData clientdata,
 	return TCL_ERROR;
     }
 
-    if (emcUpdateType == EMC_UPDATE_AUTO) {
-	updateStatus();
-    }
+    autoUpdateStatus();
 
     commandnumber = Tcl_NewIntObj(emcStatus->motion.echo_serial_number);
 
@@ -2964,9 +2966,7 @@ static int emc_motion_command_status(ClientData clientdata,
 	return TCL_ERROR;
     }
 
-    if (emcUpdateType == EMC_UPDATE_AUTO) {
-	updateStatus();
-    }
+    autoUpdateStatus();
 
     commandstatus = Tcl_NewIntObj(emcStatus->motion.status);
 
@@ -3039,9 +3039,7 @@ static int emc_joint_enable(ClientData clientdata,
     }
 
     if (objc == 2) {
-	if (emcUpdateType == EMC_UPDATE_AUTO) {
-	    updateStatus();
-	}
+	autoUpdateStatus();
 	enobj = Tcl_NewIntObj(emcStatus->motion.joint[joint].enabled);
 	Tcl_SetObjResult(interp, enobj);
 	return TCL_OK;
@@ -3102,9 +3100,7 @@ int emc_teleop_enable(ClientData clientdata,
 	sendSetTeleopEnable(enable);
     }
 
-    if (emcUpdateType == EMC_UPDATE_AUTO) {
-	updateStatus();
-    }
+    autoUpdateStatus();
 
     Tcl_SetObjResult(interp,
 		     Tcl_NewIntObj(emcStatus->motion.traj.mode ==
@@ -3117,9 +3113,7 @@ int emc_kinematics_type(ClientData clientdata,
 			Tcl_Obj * CONST objv[])
 {
 
-    if (emcUpdateType == EMC_UPDATE_AUTO) {
-	updateStatus();
-    }
+    autoUpdateStatus();
 
     Tcl_SetObjResult(interp,
 		     Tcl_NewIntObj(emcStatus->motion.traj.
@@ -3135,9 +3129,7 @@ int emc_probe_clear(ClientData clientdata,
 	return TCL_ERROR;
     }
 
-    if (emcUpdateType == EMC_UPDATE_AUTO) {
-	updateStatus();
-    }
+    autoUpdateStatus();
 
     Tcl_SetObjResult(interp, Tcl_NewIntObj(sendClearProbeTrippedFlag()));
     return TCL_OK;
@@ -3151,9 +3143,7 @@ int emc_probe_value(ClientData clientdata,
 	return TCL_ERROR;
     }
 
-    if (emcUpdateType == EMC_UPDATE_AUTO) {
-	updateStatus();
-    }
+    autoUpdateStatus();
 
     Tcl_SetObjResult(interp,
 		     Tcl_NewIntObj(emcStatus->motion.traj.probeval));
@@ -3169,9 +3159,7 @@ int emc_probe_tripped(ClientData clientdata,
 	return TCL_ERROR;
     }
 
-    if (emcUpdateType == EMC_UPDATE_AUTO) {
-	updateStatus();
-    }
+    autoUpdateStatus();
 
     Tcl_SetObjResult(interp,
 		     Tcl_NewIntObj(emcStatus->motion.traj.probe_tripped));
@@ -3215,9 +3203,7 @@ static int emc_probed_pos(ClientData clientdata,
 	return TCL_ERROR;
     }
 
-    if (emcUpdateType == EMC_UPDATE_AUTO) {
-	updateStatus();
-    }
+    autoUpdateStatus();
 
     strncpy(string, Tcl_GetStringFromObj(objv[1], 0),1);
 
@@ -3548,6 +3534,9 @@ int Linuxcnc_Init(Tcl_Interp * interp)
     Tcl_CreateObjCommand(interp, "emc_update", emc_update,
 			 (ClientData) NULL, (Tcl_CmdDeleteProc *) NULL);
 
+    Tcl_CreateObjCommand(interp, "emc_status", emc_status,
+			 (ClientData) NULL, (Tcl_CmdDeleteProc *) NULL);
+
     Tcl_CreateObjCommand(interp, "emc_time", emc_time, (ClientData) NULL,
 			 (Tcl_CmdDeleteProc *) NULL);
 
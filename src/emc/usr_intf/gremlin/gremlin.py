@@ -58,6 +58,7 @@ import os
 import sys
 
 import thread
+import threading
 
 from minigl import *
 
@@ -71,9 +72,24 @@ class StatCanon(rs274.glcanon.GLCanon, rs274.interpret.StatMixin):
         rs274.interpret.StatMixin.__init__(self, stat, random)
         self.progress = DummyProgress()
         self.lathe_view_option = lathe_view_option
+        # set by a load in a thread: called with the canon each time the
+        # number of segments doubles, so the preview can be shown early
+        self.on_segments = None
+        self.show_segments = 1000
+        self.aborted = False
 
     def is_lathe(self): return self.lathe_view_option
 
+    def next_line(self, st):
+        rs274.glcanon.GLCanon.next_line(self, st)
+        if self.on_segments is None: return
+        n = len(self.traverse) + len(self.feed) + len(self.arcfeed)
+        if n >= self.show_segments:
+            self.show_segments = 2 * n
+            self.on_segments(self)
+
+    def check_abort(self): return self.aborted
+
     def change_tool(self, pocket):
         rs274.glcanon.GLCanon.change_tool(self,pocket)
         rs274.interpret.StatMixin.change_tool(self,pocket)
@@ -105,6 +121,9 @@ class Gremlin(gtk.gtkgl.widget.DrawingArea, glnav.GlNavBase,
             self.get_geometry()
         )
         thread.start_new_thread(self.logger.start, (.01,))
+        # the preview is parsed in a thread of its own, see load()
+        gobject.threads_init()
+        self.load_in_thread = True
 
         rs274.glcanon.GlCanonDraw.__init__(self, linuxcnc.stat(), self.logger)
 
@@ -266,14 +285,63 @@ class Gremlin(gtk.gtkgl.widget.DrawingArea, glnav.GlNavBase,
 
             unitcode = "G%d" % (20 + (s.linear_units == 1))
             initcode = self.inifile.find("RS274NGC", "RS274NGC_STARTUP_CODE") or ""
+            if self.load_in_thread:
+                self.load_thread(filename, canon, unitcode, initcode, td)
+                return
             result, seq = self.load_preview(filename, canon, unitcode, initcode)
             if result > gcode.MIN_ERROR:
                 self.report_gcode_error(result, seq, filename)
 
-        finally:
+        except:
             shutil.rmtree(td)
+            raise
+        shutil.rmtree(td)
+
+        self.set_current_view()
+
+    # A big program takes a while to parse, so the parse runs in a thread
+    # and the GUI stays usable meanwhile.  The canon lists only grow while
+    # it runs, so they are drawn as they are whenever the number of
+    # segments doubled, and once more with the extents when it is done.
+    # Starting another load abandons the one running.
+    def load_thread(self, filename, canon, unitcode, initcode, td):
+        if self.canon is not None:
+            self.canon.aborted = True
+        self.set_canon(canon)
+        canon.on_segments = lambda c: gobject.idle_add(self.load_progress, c)
+        def run():
+            try:
+                result, seq = gcode.parse(filename, canon, unitcode, initcode)
+            except (Exception, KeyboardInterrupt), detail:
+                result, seq = None, str(detail)
+            finally:
+                shutil.rmtree(td)
+            gobject.idle_add(self.load_done, canon, result, seq, filename)
+        t = threading.Thread(target=run)
+        t.daemon = True
+        t.start()
 
+    @rs274.glcanon.with_context
+    def load_progress(self, canon):
+        if canon is self.canon and self.initialised:
+            self.stale_program_lists()
+            self.queue_draw()
+        return False
+
+    @rs274.glcanon.with_context
+    def load_done(self, canon, result, seq, filename):
+        canon.on_segments = None
+        if canon is not self.canon or canon.aborted:
+            return False
+        if result is None:
+            sys.stderr.write("G-Code load of %s failed: %s\n" % (filename, seq))
+        elif result > gcode.MIN_ERROR:
+            self.report_gcode_error(result, seq, filename)
+        else:
+            self._finish_preview(canon, result, seq)
         self.set_current_view()
+        self.queue_draw()
+        return False
 
     def get_program_alpha(self): return self.program_alpha
     def get_num_joints(self): return self.num_joints
@@ -43,6 +43,9 @@ static int axis_mask = 0;
 
 #define MDI_MAX 64
 
+#define POLL_PERIOD 0.002	// seconds between looks at the input pins
+#define STATUS_PERIOD 0.02	// seconds between status updates
+
 #define HAL_FIELDS \
     FIELD(hal_bit_t,machine_on) /* pin for setting machine On */ \
     FIELD(hal_bit_t,machine_off) /* pin for setting machine Off */ \
@@ -217,6 +220,8 @@ typedef halui_str_base<VALUE> local_halui_str;
 
 static halui_str *halui_data;
 static local_halui_str old_halui_data;
+// the pins as last polled, to tell cheaply whether any of them changed
+static local_halui_str polled_halui_data;
 
 static char *mdi_commands[MDI_MAX];
 static int num_mdi_commands=0;
@@ -311,7 +316,7 @@ static int tryNml()
     double end;
     int good;
 #define RETRY_TIME 10.0		// seconds to wait for subsystems to come up
-#define RETRY_INTERVAL 1.0	// seconds between wait tries for a subsystem
+#define RETRY_INTERVAL 1.0	// most seconds between wait tries for a subsystem
 
     if ((emc_debug & EMC_DEBUG_NML) == 0) {
 	set_rcs_print_destination(RCS_PRINT_TO_NULL);	// inhibit diag
@@ -324,8 +329,7 @@ static int tryNml()
 	    good = 1;
 	    break;
 	}
-	esleep(RETRY_INTERVAL);
-	end -= RETRY_INTERVAL;
+	end -= esleep_retry(RETRY_TIME - end, RETRY_INTERVAL);
     } while (end > 0.0);
     if ((emc_debug & EMC_DEBUG_NML) == 0) {
 	set_rcs_print_destination(RCS_PRINT_TO_STDOUT);	// inhibit diag
@@ -346,8 +350,7 @@ static int tryNml()
 	    good = 1;
 	    break;
 	}
-	esleep(RETRY_INTERVAL);
-	end -= RETRY_INTERVAL;
+	end -= esleep_retry(RETRY_TIME - end, RETRY_INTERVAL);
     } while (end > 0.0);
     if ((emc_debug & EMC_DEBUG_NML) == 0) {
 	set_rcs_print_destination(RCS_PRINT_TO_STDOUT);	// inhibit diag
@@ -377,7 +380,7 @@ static int updateStatus()
 	return -1;
     }
 
-    switch (type = emcStatusBuffer->peek()) {
+    switch (type = emcStatusBuffer->peek_copy(emcStatus, sizeof(EMC_STAT))) {
     case -1:
 	// error on CMS channel
         rtapi_print("halui: %s: error peeking status buffer\n", __func__);
@@ -1582,7 +1585,7 @@ static bool jogging_selected_axis(local_halui_str &hal) {
 
 // this function looks if any of the hal pins has changed
 // and sends appropiate messages if so
-static void check_hal_changes()
+static void check_hal_changes(const local_halui_str &new_halui_data)
 {
     hal_s32_t counts;
     int jselect_changed, joint;
@@ -1593,10 +1596,6 @@ static void check_hal_changes()
     int jjog_speed_changed;
     int ajog_speed_changed;
 
-    local_halui_str new_halui_data_mutable;
-    copy_hal_data(*halui_data, new_halui_data_mutable);
-    const local_halui_str &new_halui_data = new_halui_data_mutable;
-
 
     //check if machine_on pin has changed (the rest work exactly the same)
     if (check_bit_changed(new_halui_data.machine_on, old_halui_data.machine_on) != 0)
@@ -2258,14 +2257,24 @@ int main(int argc, char *argv[])
     signal(SIGTERM, quit);
 
     while (!done) {
+	// poll the pins often so a button is acted on at once, but only go
+	// through them one by one when the copy differs from the last poll.
+	// Only inputs change between polls, apart from the outputs
+	// modify_hal_pins() writes once per status update.
+	for (double t = 0; t < STATUS_PERIOD && !done; t += POLL_PERIOD) {
+	    static local_halui_str new_halui_data;
+
+	    copy_hal_data(*halui_data, new_halui_data);
+	    if (memcmp(&new_halui_data, &polled_halui_data, sizeof(new_halui_data))) {
+		check_hal_changes(new_halui_data); //if anything changed send NML messages
+		memcpy(&polled_halui_data, &new_halui_data, sizeof(new_halui_data));
+	    }
+	    esleep(POLL_PERIOD);
+	}
 
-	check_hal_changes(); //if anything changed send NML messages
+	updateStatus();
 
 	modify_hal_pins(); //if status changed modify HAL too
-	
-	esleep(0.02); //sleep for a while
-	
-	updateStatus();
     }
     thisQuit();
     return 0;
@@ -219,7 +219,8 @@
 
   PollRate <rate>
   With set, sets the rate at which the scheduler polls for information. The default is 1.0 or one
-  second. With get, returns the current poll rate.
+  second. While the queue runs it polls at least every 10 ms, so that the next program, got
+  ready while the one before runs, starts right after it. With get, returns the current poll rate.
 */
 
 // EMC_STAT *emcStatus;
@@ -1137,7 +1138,10 @@ void *checkQueue(void *arg)
 {
   while (1) {
     updateQueue();
-    sleep((unsigned)pollDelay);
+    // while the queue runs, look often enough to start the next job
+    // right after the last one ends
+    if (getStatus() == qsRun && pollDelay > 0.01) esleep(0.01);
+    else esleep(pollDelay);
     }
   return 0;
 }  
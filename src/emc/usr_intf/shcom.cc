@@ -140,8 +140,7 @@ int tryNml(double retry_time, double retry_interval)
 	    good = 1;
 	    break;
 	}
-	esleep(retry_interval);
-	end -= retry_interval;
+	end -= esleep_retry(retry_time - end, retry_interval);
     } while (end > 0.0);
     if ((emc_debug & EMC_DEBUG_NML) == 0) {
 	set_rcs_print_destination(RCS_PRINT_TO_STDOUT);	// inhibit diag
@@ -162,8 +161,7 @@ int tryNml(double retry_time, double retry_interval)
 	    good = 1;
 	    break;
 	}
-	esleep(retry_interval);
-	end -= retry_interval;
+	end -= esleep_retry(retry_time - end, retry_interval);
     } while (end > 0.0);
     if ((emc_debug & EMC_DEBUG_NML) == 0) {
 	set_rcs_print_destination(RCS_PRINT_TO_STDOUT);	// inhibit diag
@@ -185,7 +183,7 @@ int updateStatus()
 	return -1;
     }
 
-    switch (type = emcStatusBuffer->peek()) {
+    switch (type = emcStatusBuffer->peek_copy(emcStatus, sizeof(EMC_STAT))) {
     case -1:
 	// error on CMS channel
 	return -1;
@@ -279,40 +277,78 @@ int updateError()
     return 0;
 }
 
-#define EMC_COMMAND_DELAY   0.1	// how long to sleep between checks
+#define EMC_COMMAND_DELAY   0.01	// how long to sleep between checks
+#define EMC_COMMAND_WAIT    1.0		// longest single wait on the status
+
+/*
+  When the status buffer keeps a write count ('notify' in the nml file)
+  the waits below sleep on it, and wake as soon as task writes the status
+  that echoes the command; otherwise they poll every EMC_COMMAND_DELAY.
+  The count is taken before the status is read, so a write in between
+  ends the wait at once rather than being missed.
+*/
+static bool statusWriteCount(unsigned int *count)
+{
+    return 0 != emcStatusBuffer && 0 != emcStatusBuffer->cms &&
+	0 == emcStatusBuffer->cms->get_write_count(count);
+}
+
+// false once 'end' (from etime()) has passed
+static bool waitForStatus(bool haveCount, unsigned int count, double end)
+{
+    double left = EMC_COMMAND_WAIT;
+
+    if (emcTimeout > 0.0) {
+	left = end - etime();
+	if (left <= 0.0) {
+	    return false;
+	}
+	if (left > EMC_COMMAND_WAIT) {
+	    left = EMC_COMMAND_WAIT;
+	}
+    }
+    if (!haveCount || emcStatusBuffer->cms->wait_for_write(count, left) < 0) {
+	esleep(left < EMC_COMMAND_DELAY ? left : EMC_COMMAND_DELAY);
+    }
+    return true;
+}
 
 int emcCommandWaitDone()
 {
-    double end;
-    for (end = 0.0; emcTimeout <= 0.0 || end < emcTimeout; end += EMC_COMMAND_DELAY) {
+    double end = etime() + emcTimeout;
+    unsigned int count = 0;
+
+    for (;;) {
+	bool haveCount = statusWriteCount(&count);
 	updateStatus();
 	int serial_diff = emcStatus->echo_serial_number - emcCommandSerialNumber;
-	if (serial_diff < 0) {
-	    continue;
-	}
-
 	if (serial_diff > 0) {
 	    return 0;
 	}
 
-	if (emcStatus->status == RCS_DONE) {
-	    return 0;
+	if (serial_diff == 0) {
+	    if (emcStatus->status == RCS_DONE) {
+		return 0;
+	    }
+
+	    if (emcStatus->status == RCS_ERROR) {
+		return -1;
+	    }
 	}
 
-	if (emcStatus->status == RCS_ERROR) {
+	if (!waitForStatus(haveCount, count, end)) {
 	    return -1;
 	}
-
-	esleep(EMC_COMMAND_DELAY);
     }
-
-    return -1;
 }
 
 int emcCommandWaitReceived()
 {
-    double end;
-    for (end = 0.0; emcTimeout <= 0.0 || end < emcTimeout; end += EMC_COMMAND_DELAY) {
+    double end = etime() + emcTimeout;
+    unsigned int count = 0;
+
+    for (;;) {
+	bool haveCount = statusWriteCount(&count);
 	updateStatus();
 
 	int serial_diff = emcStatus->echo_serial_number - emcCommandSerialNumber;
@@ -320,10 +356,10 @@ int emcCommandWaitReceived()
 	    return 0;
 	}
 
-	esleep(EMC_COMMAND_DELAY);
+	if (!waitForStatus(haveCount, count, end)) {
+	    return -1;
+	}
     }
-
-    return -1;
 }
 
 int emcCommandSend(RCS_CMD_MSG & cmd)
@@ -1087,6 +1123,52 @@ int sendMdiCmd(const char *mdi)
     return 0;
 }
 
+// Sends count MDI lines as one EMC_TASK_PLAN_EXECUTE_BATCH.  Task takes
+// the message at once and runs the lines after, so wait for them with
+// emcMdiBatchWaitDone().
+int sendMdiBatch(const char *const *lines, int count)
+{
+    EMC_TASK_PLAN_EXECUTE_BATCH emc_task_plan_execute_batch_msg;
+    size_t used = 0;
+
+    for (int i = 0; i < count; i++) {
+	size_t len = strlen(lines[i]) + 1;
+	if (used + len > sizeof(emc_task_plan_execute_batch_msg.commands)) {
+	    return -1;
+	}
+	memcpy(emc_task_plan_execute_batch_msg.commands + used, lines[i], len);
+	used += len;
+    }
+    emc_task_plan_execute_batch_msg.count = count;
+    emcCommandSend(emc_task_plan_execute_batch_msg);
+    return emcCommandWaitReceived();
+}
+
+// Waits for the lines of the last sendMdiBatch() to finish; -1 if one of
+// them failed or it timed out.
+int emcMdiBatchWaitDone()
+{
+    double end;
+    for (end = 0.0; emcTimeout <= 0.0 || end < emcTimeout; end += EMC_COMMAND_DELAY) {
+	updateStatus();
+	if (emcStatus->echo_serial_number == emcCommandSerialNumber
+		&& emcStatus->status == RCS_ERROR) {
+	    return -1;
+	}
+	if (emcStatus->task.mdiBatch == emcCommandSerialNumber) {
+	    if (emcStatus->task.mdiBatchError >= 0) {
+		return -1;
+	    }
+	    if (emcStatus->task.mdiBatchDone == emcStatus->task.mdiBatchLines) {
+		return 0;
+	    }
+	}
+	esleep(EMC_COMMAND_DELAY);
+    }
+
+    return -1;
+}
+
 int sendLoadToolTable(const char *file)
 {
     EMC_TOOL_LOAD_TOOL_TABLE emc_tool_load_tool_table_msg;
@@ -70,7 +70,8 @@ extern double emcTimeout;
 
 enum EMC_UPDATE_TYPE {
     EMC_UPDATE_NONE = 1,
-    EMC_UPDATE_AUTO
+    EMC_UPDATE_AUTO,
+    EMC_UPDATE_SNAPSHOT
 };
 extern EMC_UPDATE_TYPE emcUpdateType;
 
@@ -136,6 +137,8 @@ extern int sendProgramResume();
 extern int sendSetOptionalStop(bool state);
 extern int sendProgramStep();
 extern int sendMdiCmd(const char *mdi);
+extern int sendMdiBatch(const char *const *lines, int count);
+extern int emcMdiBatchWaitDone();
 extern int sendLoadToolTable(const char *file);
 extern int sendToolSetOffset(int tool, double length, double diameter);
 extern int sendJointSetBacklash(int axis, double backlash);
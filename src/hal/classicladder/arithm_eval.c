@@ -46,6 +46,9 @@ char * Expr;
 char * ErrorDesc;
 char * VerifyErrorDesc;
 int UnderVerify;
+/* expression being compiled, the parser then also emits the ops */
+StrArithmExpr * CompileTarget = NULL;
+int CompileFailed;
 
 /* for RTLinux module */
 #if defined( MODULE )
@@ -68,12 +71,31 @@ int pow_int(int a,int b)
 
 void SyntaxError(void)
 {
+	if (CompileTarget)
+		CompileFailed = TRUE;
 	if (UnderVerify)
 		VerifyErrorDesc = ErrorDesc;
 	else
 		debug_printf("Syntax error : '%s' , at %s !!!!!\n",ErrorDesc,Expr);
 }
 
+/* Add an op to the expression being compiled, if any */
+StrArithmOp * EmitArithmOp(char Code)
+{
+	static StrArithmOp NotCompiled;
+	StrArithmOp * pOp = &NotCompiled;
+	if (CompileTarget)
+	{
+		if (CompileTarget->NbrOps<ARITHM_EXPR_SIZE)
+			pOp = &CompileTarget->Prog[ CompileTarget->NbrOps++ ];
+		else
+			CompileFailed = TRUE;
+	}
+	pOp->Code = Code;
+	pOp->Arg = 0;
+	return pOp;
+}
+
 arithmtype Constant(void)
 {
 	arithmtype Res = 0;
@@ -113,6 +135,7 @@ arithmtype Constant(void)
 	}
 	if ( cIsNeg )
 		Res = Res * -1;
+	EmitArithmOp( ARITHM_OP_CONST )->Value = Res;
 	return Res;
 }
 
@@ -210,19 +233,39 @@ int IdentifyVarIndexedOrNot(char *StartExpr,int * ResType,int * ResOffset, int *
 	return FALSE;
 }
 
+/* Fill the var fields of an op from a var, indexed or not */
+int IdentifyVarOp( char *StartExpr, StrArithmOp * pOp )
+{
+	int VarType,VarOffset,IndexVarType,IndexVarOffset;
+	int SyntaxOk = IdentifyVarIndexedOrNot( StartExpr, &VarType, &VarOffset, &IndexVarType, &IndexVarOffset );
+	if ( SyntaxOk )
+	{
+		pOp->VarType = VarType;
+		pOp->Value = VarOffset;
+		pOp->IndexType = ( IndexVarType!=-1 && IndexVarOffset!=-1 )?IndexVarType:-1;
+		pOp->IndexOffset = IndexVarOffset;
+	}
+	return SyntaxOk;
+}
+
+/* Give final offset of the var of an op (taking into acount the value of an index if present) */
+int VarOpOffset( StrArithmOp * pOp )
+{
+	// add index value from content of the index variable
+	if ( pOp->IndexType!=-1 )
+		return pOp->Value + ReadVar( pOp->IndexType, pOp->IndexOffset );
+	return pOp->Value;
+}
+
 /* Give final variable (taking into acount the value of an index if present) */
 int IdentifyFinalVar( char *StartExpr, int * ResType,int * ResOffset )
 {
-	int IndexVarType,IndexVarOffset;
-	int SyntaxOk = IdentifyVarIndexedOrNot( StartExpr, ResType, ResOffset, &IndexVarType, &IndexVarOffset );
+	StrArithmOp VarOp;
+	int SyntaxOk = IdentifyVarOp( StartExpr, &VarOp );
 	if ( SyntaxOk )
 	{
-		if ( IndexVarType!=-1 && IndexVarOffset!=-1 )
-		{
-			// add index value from content of the index variable
-			int IndexValue = ReadVar( IndexVarType, IndexVarOffset );
-			*ResOffset = *ResOffset + IndexValue;
-		}
+		*ResType = VarOp.VarType;
+		*ResOffset = VarOpOffset( &VarOp );
 //printf("Final var for %s => %d/%d\n", StartExpr, *ResType, *ResOffset );
 	}
 	return SyntaxOk;
@@ -230,10 +273,13 @@ int IdentifyFinalVar( char *StartExpr, int * ResType,int * ResOffset )
 
 arithmtype Variable(void)
 {
-	int VarType,VarOffset;
-	if (IdentifyFinalVar(Expr, &VarType,&VarOffset))
+	StrArithmOp VarOp;
+	if (IdentifyVarOp(Expr, &VarOp))
 	{
-//printf("Variable:%d/%d\n", VarType, VarOffset);
+//printf("Variable:%d/%d\n", VarOp.VarType, VarOp.Value);
+		VarOp.Code = ARITHM_OP_VAR;
+		VarOp.Arg = 0;
+		*EmitArithmOp( ARITHM_OP_VAR ) = VarOp;
 		/* flush var found */
 		Expr++;
 		do
@@ -243,7 +289,7 @@ arithmtype Variable(void)
 		while( (*Expr!='@') && (*Expr!='\0') );
 		Expr++;
 		/* return var value */
-		return (arithmtype)ReadVar(VarType,VarOffset);
+		return (arithmtype)ReadVar(VarOp.VarType,VarOpOffset(&VarOp));
 	}
 	else
 	{
@@ -272,6 +318,7 @@ arithmtype Function(void)
 		Res = Variable( );
 		if ( Res<0 )
 			Res = Res * -1;
+		EmitArithmOp( ARITHM_OP_ABS );
 		Expr++; /* ) */
 		return Res;
 	}
@@ -279,31 +326,37 @@ arithmtype Function(void)
 	/* functions with many parameters = many variables separated per ',' */
 	if ( !strcmp(tcFonc, "MINI") )
 	{
+		int NbrVars = 0;
 		Res = 0x7FFFFFFF;
 		do
 		{
 			int iValVar;
 			Expr++; /* ( -ou- , */
 			iValVar = Variable( );
+			NbrVars++;
 			if ( iValVar<Res )
 				Res = iValVar;
 		}
 		while( *Expr!=')' );
+		EmitArithmOp( ARITHM_OP_MINI )->Arg = NbrVars;
 		Expr++; /* ) */
 		return Res;
 	}
 	if ( !strcmp(tcFonc, "MAXI") )
 	{
+		int NbrVars = 0;
 		Res = 0x80000000;
 		do
 		{
 			int iValVar;
 			Expr++; /* ( -or- , */
 			iValVar = Variable( );
+			NbrVars++;
 			if ( iValVar>Res )
 				Res = iValVar;
 		}
 		while( *Expr!=')' );
+		EmitArithmOp( ARITHM_OP_MAXI )->Arg = NbrVars;
 		Expr++; /* ) */
 		return Res;
 	}
@@ -319,6 +372,7 @@ arithmtype Function(void)
 			Res = Res + ValVar;
 		}
 		while( *Expr!=')' );
+		EmitArithmOp( ARITHM_OP_AVG )->Arg = NbrVars;
 		Expr++; /* ) */
 		Res = Res/NbrVars;
 		return Res;
@@ -365,8 +419,11 @@ arithmtype Term(void)
 	}
 	else if (*Expr=='!')
 	{
+		arithmtype Res;
 		Expr++;
-		return Term()?0:1;
+		Res = Term()?0:1;
+		EmitArithmOp( ARITHM_OP_NOT );
+		return Res;
 	}
 	else
 	{
@@ -389,6 +446,7 @@ arithmtype Pow(void)
 		Expr++;
 		Q = Pow();
 		Res = pow_int(Res,Q);
+		EmitArithmOp( ARITHM_OP_POW );
 	}
 	return Res;
 }
@@ -407,22 +465,26 @@ arithmtype MulDivMod(void)
 		{
 			Expr++;
 			Res = Res * Pow();
+			EmitArithmOp( ARITHM_OP_MUL );
 		}
 		else
 		if (*Expr=='/')
 		{
 			Expr++;
 			Val = Pow();
-			if ( ErrorDesc==NULL )
+			/* the values of the vars do not matter when compiling */
+			if ( ErrorDesc==NULL && CompileTarget==NULL )
 				Res = Res / Val;
+			EmitArithmOp( ARITHM_OP_DIV );
 		}
 		else
 		if (*Expr=='%')
 		{
 			Expr++;
 			Val = Pow();
-			if ( ErrorDesc==NULL )
+			if ( ErrorDesc==NULL && CompileTarget==NULL )
 				Res = Res % Val;
+			EmitArithmOp( ARITHM_OP_MOD );
 		}
 		else
 		{
@@ -445,12 +507,14 @@ arithmtype AddSub(void)
 		{
 			Expr++;
 			Res = Res + MulDivMod();
+			EmitArithmOp( ARITHM_OP_ADD );
 		}
 		else
 		if (*Expr=='-')
 		{
 			Expr++;
 			Res = Res - MulDivMod();
+			EmitArithmOp( ARITHM_OP_SUB );
 		}
 		else
 		{
@@ -471,6 +535,7 @@ arithmtype And(void)
 		{
 			Expr++;
 			Res = Res & AddSub();
+			EmitArithmOp( ARITHM_OP_AND );
 		}
 		else
 		{
@@ -490,6 +555,7 @@ arithmtype Xor(void)
 		{
 			Expr++;
 			Res = Res ^ And();
+			EmitArithmOp( ARITHM_OP_XOR );
 		}
 		else
 		{
@@ -509,6 +575,7 @@ arithmtype Or(void)
 		{
 			Expr++;
 			Res = Res | Xor();
+			EmitArithmOp( ARITHM_OP_OR );
 		}
 		else
 		{
@@ -589,6 +656,18 @@ int EvalCompare(char * CompareString)
 			BoolRes = 1;
 		if ( (*SearchSep=='=' || *(SearchSep+1)=='=') && EvalFirst==EvalSecond )
 			BoolRes = 1;
+		if ( CompileTarget )
+		{
+			StrArithmOp * pOp = EmitArithmOp( ARITHM_OP_COMPARE );
+			if ( *SearchSep=='>' )
+				pOp->Arg |= ARITHM_CMP_GT;
+			if ( *SearchSep=='<' && *(SearchSep+1)!='>' )
+				pOp->Arg |= ARITHM_CMP_LT;
+			if ( *SearchSep=='<' && *(SearchSep+1)=='>' )
+				pOp->Arg |= ARITHM_CMP_NE;
+			if ( *SearchSep=='=' || *(SearchSep+1)=='=' )
+				pOp->Arg |= ARITHM_CMP_EQ;
+		}
 	}
 	else
 	{
@@ -604,7 +683,7 @@ int EvalCompare(char * CompareString)
 void MakeCalc(char * CalcString,int VerifyMode)
 {
 	char StrCopy[ARITHM_EXPR_SIZE+1]; /* used for putting null char after first expr */
-	int TargetVarType,TargetVarOffset;
+	StrArithmOp TargetVar;
 	int  Found = FALSE;
 
 	/* null expression ? */
@@ -614,8 +693,9 @@ void MakeCalc(char * CalcString,int VerifyMode)
 	strcpy(StrCopy,CalcString);
 
 	Expr = StrCopy;
-	if (IdentifyFinalVar(Expr,&TargetVarType,&TargetVarOffset))
+	if (IdentifyVarOp(Expr,&TargetVar))
 	{
+		int TargetVarOffset = VarOpOffset(&TargetVar);
 		/* flush var found */
 		Expr++;
 		do
@@ -646,14 +726,20 @@ void MakeCalc(char * CalcString,int VerifyMode)
 //printf("Calc - Eval String=%s\n",Expr);
 			EvalExpr = EvalExpression(Expr);
 //printf("Calc - Result=%d\n",EvalExpr);
-			if (!VerifyMode)
+			if ( CompileTarget )
+			{
+				TargetVar.Code = ARITHM_OP_STORE;
+				TargetVar.Arg = 0;
+				*EmitArithmOp( ARITHM_OP_STORE ) = TargetVar;
+			}
+			else if (!VerifyMode)
 			{
-				WriteVar(TargetVarType,TargetVarOffset,(int)EvalExpr);
+				WriteVar(TargetVar.VarType,TargetVarOffset,(int)EvalExpr);
 			}
 #ifdef GTK_INTERFACE
 			else
 			{
-				if ( !TestVarIsReadWrite( TargetVarType, TargetVarOffset ) )
+				if ( !TestVarIsReadWrite( TargetVar.VarType, TargetVarOffset ) )
 				{
 					ErrorDesc = "Target variable must be read/write !";
 					SyntaxError();
@@ -690,3 +776,104 @@ char * VerifySyntaxForMakeCalc(char * StringToVerify)
 	return VerifyErrorDesc;
 }
 
+
+/* Compile an expression once for the refresh, with the parser above */
+/* emitting a stack program with the vars already identified. */
+/* If the syntax is bad, the expression is left to the parser (ProgState */
+/* stays to ARITHM_PROG_NONE), that will report the error at each refresh */
+void CompileArithmExpr(StrArithmExpr * pArithmExpr,int ForCompare)
+{
+	char LastCode = ForCompare?ARITHM_OP_COMPARE:ARITHM_OP_STORE;
+	pArithmExpr->ProgState = ARITHM_PROG_NONE;
+	pArithmExpr->NbrOps = 0;
+	CompileTarget = pArithmExpr;
+	CompileFailed = FALSE;
+	ErrorDesc = NULL;
+	if (ForCompare)
+		EvalCompare(pArithmExpr->Expr);
+	else
+		MakeCalc(pArithmExpr->Expr,FALSE /* verify mode */);
+	CompileTarget = NULL;
+	if ( !CompileFailed && pArithmExpr->NbrOps>0 && pArithmExpr->Prog[ pArithmExpr->NbrOps-1 ].Code==LastCode )
+		pArithmExpr->ProgState = ForCompare?ARITHM_PROG_COMPARE:ARITHM_PROG_CALC;
+}
+
+/* Run a compiled expression : return the result of a compare, */
+/* or make the calc and return 0 */
+int ExecArithmExpr(StrArithmExpr * pArithmExpr)
+{
+	arithmtype Stack[ARITHM_EXPR_SIZE];
+	int Top = -1;
+	int ScanOp;
+	int NbrVars;
+	arithmtype Res,Val;
+	for ( ScanOp=0; ScanOp<pArithmExpr->NbrOps; ScanOp++ )
+	{
+		StrArithmOp * pOp = &pArithmExpr->Prog[ ScanOp ];
+		switch( pOp->Code )
+		{
+			case ARITHM_OP_CONST:
+				Stack[ ++Top ] = pOp->Value;
+				break;
+			case ARITHM_OP_VAR:
+				Stack[ ++Top ] = (arithmtype)ReadVar( pOp->VarType, VarOpOffset( pOp ) );
+				break;
+			case ARITHM_OP_NOT:
+				Stack[ Top ] = Stack[ Top ]?0:1;
+				break;
+			case ARITHM_OP_ABS:
+				if ( Stack[ Top ]<0 )
+					Stack[ Top ] = Stack[ Top ] * -1;
+				break;
+			case ARITHM_OP_MINI:
+			case ARITHM_OP_MAXI:
+			case ARITHM_OP_AVG:
+				Res = pOp->Code==ARITHM_OP_MINI?0x7FFFFFFF:(pOp->Code==ARITHM_OP_MAXI?0x80000000:0);
+				for ( NbrVars=0; NbrVars<pOp->Arg; NbrVars++ )
+				{
+					Val = Stack[ Top-NbrVars ];
+					if ( pOp->Code==ARITHM_OP_MINI && Val<Res )
+						Res = Val;
+					if ( pOp->Code==ARITHM_OP_MAXI && Val>Res )
+						Res = Val;
+					if ( pOp->Code==ARITHM_OP_AVG )
+						Res = Res + Val;
+				}
+				if ( pOp->Code==ARITHM_OP_AVG )
+					Res = Res/pOp->Arg;
+				Top = Top-pOp->Arg+1;
+				Stack[ Top ] = Res;
+				break;
+			case ARITHM_OP_COMPARE:
+				Val = Stack[ Top-- ];
+				Res = Stack[ Top ];
+				Stack[ Top ] = ( (pOp->Arg&ARITHM_CMP_GT) && Res>Val )
+					|| ( (pOp->Arg&ARITHM_CMP_LT) && Res<Val )
+					|| ( (pOp->Arg&ARITHM_CMP_NE) && Res!=Val )
+					|| ( (pOp->Arg&ARITHM_CMP_EQ) && Res==Val );
+				break;
+			case ARITHM_OP_STORE:
+				WriteVar( pOp->VarType, VarOpOffset( pOp ), (int)Stack[ Top-- ] );
+				break;
+			default:
+				/* the binary operators */
+				Val = Stack[ Top-- ];
+				Res = Stack[ Top ];
+				switch( pOp->Code )
+				{
+					case ARITHM_OP_POW: Res = pow_int(Res,Val); break;
+					case ARITHM_OP_MUL: Res = Res * Val; break;
+					case ARITHM_OP_DIV: Res = Res / Val; break;
+					case ARITHM_OP_MOD: Res = Res % Val; break;
+					case ARITHM_OP_ADD: Res = Res + Val; break;
+					case ARITHM_OP_SUB: Res = Res - Val; break;
+					case ARITHM_OP_AND: Res = Res & Val; break;
+					case ARITHM_OP_XOR: Res = Res ^ Val; break;
+					case ARITHM_OP_OR: Res = Res | Val; break;
+				}
+				Stack[ Top ] = Res;
+				break;
+		}
+	}
+	return ( pArithmExpr->ProgState==ARITHM_PROG_COMPARE && Top>=0 )?Stack[ Top ]:0;
+}
@@ -30,6 +30,9 @@
 #ifdef __RTL__
 #include <rtlinux_signal.h>
 #endif
+#ifdef RTAPI
+#include "rtapi.h"
+#endif
 
 #include "classicladder.h"
 #include "global.h"
@@ -50,6 +53,7 @@ void InitRungs()
 		RungArray[NumRung].Used = FALSE;
 		strcpy(RungArray[NumRung].Label,"");
 		strcpy(RungArray[NumRung].Comment,"");
+		RungArray[NumRung].NbrCompiledCells = 0;
 		for (y=0;y<RUNG_HEIGHT;y++)
 		{
 			for(x=0;x<RUNG_WIDTH;x++)
@@ -94,8 +98,28 @@ void PrepareRungs()
 				}
 			}
 		}
+		CompileRung(&RungArray[NumRung]);
 	}
 }
+/* List the cells of a rung RefreshRung() has to look at, in the order of */
+/* the scan (column by column). Free cells are left out unless they carry */
+/* a connection with the top, whose state is drawn. To be called each time */
+/* the elements of the rung are changed. */
+void CompileRung(StrRung * Rung)
+{
+	int x,y;
+	int NbrCells = 0;
+	for(x=0;x<RUNG_WIDTH;x++)
+	{
+		for (y=0;y<RUNG_HEIGHT;y++)
+		{
+			if ( (Rung->Element[x][y].Type!=ELE_FREE && Rung->Element[x][y].Type!=ELE_UNUSABLE)
+				|| Rung->Element[x][y].ConnectedWithTop )
+				Rung->CompiledCell[ NbrCells++ ] = x*RUNG_HEIGHT+y;
+		}
+	}
+	Rung->NbrCompiledCells = NbrCells;
+}
 #ifdef OLD_TIMERS_MONOS_SUPPORT
 void InitTimers()
 {
@@ -201,6 +225,7 @@ void PrepareAllDatasBeforeRun( )
 	PrepareCounters( );
 	PrepareTimersIEC( );
 	PrepareRungs( );
+	CompileAllArithmExpr( );
 #ifdef SEQUENTIAL_SUPPORT
 	PrepareSequential( );
 #endif
@@ -210,7 +235,31 @@ void InitArithmExpr()
 {
     int NumExpr;
     for (NumExpr=0; NumExpr<NBR_ARITHM_EXPR; NumExpr++)
+    {
         strcpy(ArithmExpr[NumExpr].Expr,"");
+        ArithmExpr[NumExpr].ProgState = ARITHM_PROG_NONE;
+    }
+}
+/* Compile the expressions used by the compar and operate blocks of the */
+/* rungs, so that the refresh does not have to parse them at each scan */
+void CompileAllArithmExpr()
+{
+	int NumRung;
+	int x,y;
+	for (NumRung=0;NumRung<NBR_RUNGS;NumRung++)
+	{
+		if ( !RungArray[NumRung].Used )
+			continue;
+		for (y=0;y<RUNG_HEIGHT;y++)
+		{
+			for(x=0;x<RUNG_WIDTH;x++)
+			{
+				StrElement * pElement = &RungArray[NumRung].Element[x][y];
+				if ( pElement->Type==ELE_COMPAR || pElement->Type==ELE_OUTPUT_OPERATE )
+					CompileArithmExpr( &ArithmExpr[ pElement->VarNum ], pElement->Type==ELE_COMPAR );
+			}
+		}
+	}
 }
 void InitIOConf( )
 {
@@ -625,7 +674,12 @@ char CalcTypeCompar(int x,int y,StrRung * UpdateRung)
     char State;
     char StateElement;
 
-    StateElement = EvalCompare(ArithmExpr[UpdateRung->Element[x][y].VarNum].Expr);
+    StrArithmExpr * pArithmExpr = &ArithmExpr[UpdateRung->Element[x][y].VarNum];
+
+    if (pArithmExpr->ProgState==ARITHM_PROG_COMPARE)
+        StateElement = ExecArithmExpr(pArithmExpr);
+    else
+        StateElement = EvalCompare(pArithmExpr->Expr);
     UpdateRung->Element[x][y].DynamicState = StateElement;
     if (x==2)
     {
@@ -644,9 +698,15 @@ char CalcTypeCompar(int x,int y,StrRung * UpdateRung)
 char CalcTypeOutputOperate(int x,int y,StrRung * UpdateRung)
 {
     char State;
+    StrArithmExpr * pArithmExpr = &ArithmExpr[UpdateRung->Element[x][y].VarNum];
     State = StateOnLeft(x-2,y,UpdateRung);
     if (State)
-        MakeCalc(ArithmExpr[UpdateRung->Element[x][y].VarNum].Expr,FALSE /* verify mode */);
+    {
+        if (pArithmExpr->ProgState==ARITHM_PROG_CALC)
+            ExecArithmExpr(pArithmExpr);
+        else
+            MakeCalc(pArithmExpr->Expr,FALSE /* verify mode */);
+    }
     UpdateRung->Element[x][y].DynamicInput = State;
     UpdateRung->Element[x][y].DynamicState = State;
     return State;
@@ -655,94 +715,91 @@ char CalcTypeOutputOperate(int x,int y,StrRung * UpdateRung)
 
 int RefreshRung(StrRung * Rung, int * JumpTo)
 {
-	int x = 0, y = 0;
+	int x, y;
+	int ScanCell = 0;
 	int JumpToRung = -1;
 	int SectionToCall = -1;
 
-	do
+	while( ScanCell<Rung->NbrCompiledCells && JumpToRung==-1 )
 	{
-		do
+		x = Rung->CompiledCell[ ScanCell ] / RUNG_HEIGHT;
+		y = Rung->CompiledCell[ ScanCell ] % RUNG_HEIGHT;
+		switch(Rung->Element[x][y].Type)
 		{
-			switch(Rung->Element[x][y].Type)
-			{
-				/* MLD,16/5/2001,V0.2.8 , fixed for drawing */
-				case ELE_FREE:
-				case ELE_UNUSABLE:
-					if (StateOnLeft(x,y,Rung))
-						Rung->Element[x][y].DynamicInput = 1;
-					else
-						Rung->Element[x][y].DynamicInput = 0;
-					break;
-				/* End fix */
-				case ELE_INPUT:
-					CalcTypeInput(x,y,Rung,FALSE,FALSE);
-					break;
-				case ELE_INPUT_NOT:
-					CalcTypeInput(x,y,Rung,TRUE,FALSE);
-					break;
-				case ELE_RISING_INPUT:
-					CalcTypeInput(x,y,Rung,FALSE,TRUE);
-					break;
-				case ELE_FALLING_INPUT:
-					CalcTypeInput(x,y,Rung,TRUE,TRUE);
-					break;
-				case ELE_CONNECTION:
-					CalcTypeConnection(x,y,Rung);
-					break;
+			/* MLD,16/5/2001,V0.2.8 , fixed for drawing */
+			case ELE_FREE:
+			case ELE_UNUSABLE:
+				if (StateOnLeft(x,y,Rung))
+					Rung->Element[x][y].DynamicInput = 1;
+				else
+					Rung->Element[x][y].DynamicInput = 0;
+				break;
+			/* End fix */
+			case ELE_INPUT:
+				CalcTypeInput(x,y,Rung,FALSE,FALSE);
+				break;
+			case ELE_INPUT_NOT:
+				CalcTypeInput(x,y,Rung,TRUE,FALSE);
+				break;
+			case ELE_RISING_INPUT:
+				CalcTypeInput(x,y,Rung,FALSE,TRUE);
+				break;
+			case ELE_FALLING_INPUT:
+				CalcTypeInput(x,y,Rung,TRUE,TRUE);
+				break;
+			case ELE_CONNECTION:
+				CalcTypeConnection(x,y,Rung);
+				break;
 #ifdef OLD_TIMERS_MONOS_SUPPORT
-				case ELE_TIMER:
-					CalcTypeTimer(x,y,Rung);
-					break;
-				case ELE_MONOSTABLE:
-					CalcTypeMonostable(x,y,Rung);
-					break;
+			case ELE_TIMER:
+				CalcTypeTimer(x,y,Rung);
+				break;
+			case ELE_MONOSTABLE:
+				CalcTypeMonostable(x,y,Rung);
+				break;
 #endif
-				case ELE_COUNTER:
-					CalcTypeCounter(x,y,Rung);
-					break;
-				case ELE_TIMER_IEC:
-					CalcTypeTimerIEC(x,y,Rung);
-					break;
-				case ELE_COMPAR:
-					CalcTypeCompar(x,y,Rung);
-					break;
-				case ELE_OUTPUT:
-					CalcTypeOutput(x,y,Rung,FALSE);
-					break;
-				case ELE_OUTPUT_NOT:
-					CalcTypeOutput(x,y,Rung,TRUE);
-					break;
-				case ELE_OUTPUT_SET:
-					CalcTypeOutputSetReset(x,y,Rung,FALSE);
-					break;
-				case ELE_OUTPUT_RESET:
-					CalcTypeOutputSetReset(x,y,Rung,TRUE);
-					break;
-				case ELE_OUTPUT_JUMP:
-					JumpToRung = CalcTypeOutputJump(x,y,Rung);
-					// we will now abort the refresh of the rung immediately...
-					break;
-				case ELE_OUTPUT_CALL:
-					SectionToCall = CalcTypeOutputCall(x,y,Rung);
-					if ( SectionToCall!=-1 )
-					{
-						StrSection * pSubRoutineSection = &SectionArray[ SectionToCall ];
-						if ( pSubRoutineSection->Used && pSubRoutineSection->SubRoutineNumber>=0 )
-							RefreshASection( pSubRoutineSection ); //recursive call! ;-)
-						else
-							debug_printf("Refresh rungs aborted - call to a sub-routine undefined or programmed as main !!!");
-					}
-					break;
-				case ELE_OUTPUT_OPERATE:
-					CalcTypeOutputOperate(x,y,Rung);
-					break;
-			}
-			y++;
-		}while( y<RUNG_HEIGHT && JumpToRung==-1 );
-		y = 0;
-		x++;
+			case ELE_COUNTER:
+				CalcTypeCounter(x,y,Rung);
+				break;
+			case ELE_TIMER_IEC:
+				CalcTypeTimerIEC(x,y,Rung);
+				break;
+			case ELE_COMPAR:
+				CalcTypeCompar(x,y,Rung);
+				break;
+			case ELE_OUTPUT:
+				CalcTypeOutput(x,y,Rung,FALSE);
+				break;
+			case ELE_OUTPUT_NOT:
+				CalcTypeOutput(x,y,Rung,TRUE);
+				break;
+			case ELE_OUTPUT_SET:
+				CalcTypeOutputSetReset(x,y,Rung,FALSE);
+				break;
+			case ELE_OUTPUT_RESET:
+				CalcTypeOutputSetReset(x,y,Rung,TRUE);
+				break;
+			case ELE_OUTPUT_JUMP:
+				JumpToRung = CalcTypeOutputJump(x,y,Rung);
+				// we will now abort the refresh of the rung immediately...
+				break;
+			case ELE_OUTPUT_CALL:
+				SectionToCall = CalcTypeOutputCall(x,y,Rung);
+				if ( SectionToCall!=-1 )
+				{
+					StrSection * pSubRoutineSection = &SectionArray[ SectionToCall ];
+					if ( pSubRoutineSection->Used && pSubRoutineSection->SubRoutineNumber>=0 )
+						RefreshASection( pSubRoutineSection ); //recursive call! ;-)
+					else
+						debug_printf("Refresh rungs aborted - call to a sub-routine undefined or programmed as main !!!");
+				}
+				break;
+			case ELE_OUTPUT_OPERATE:
+				CalcTypeOutputOperate(x,y,Rung);
+				break;
+		}
+		ScanCell++;
 	}
-	while( x<RUNG_WIDTH && JumpToRung==-1 );
 
 	*JumpTo = JumpToRung;
 	return TRUE;
@@ -795,6 +852,9 @@ void ClassicLadder_RefreshAllSections()
 {
 	int ScanMainSection;
 	StrSection * pScanSection;
+#ifdef RTAPI
+	long long SectionStart;
+#endif
 
 	CycleStart();
 
@@ -802,6 +862,9 @@ void ClassicLadder_RefreshAllSections()
 	{
 
 		pScanSection = &SectionArray[ ScanMainSection ];
+#ifdef RTAPI
+		SectionStart = rtapi_get_time();
+#endif
 
 		// current section defined and is a main-section (not a sub-routine)
 		// and in Ladder language ?
@@ -817,6 +880,9 @@ void ClassicLadder_RefreshAllSections()
 			RefreshSequentialPage( pScanSection->SequentialPage );
 		}
 #endif
+#ifdef RTAPI
+		pScanSection->DurationOfLastScan = rtapi_get_time() - SectionStart;
+#endif
 
 	}// for( )
 
@@ -16,6 +16,7 @@
 
 void InitRungs(void);
 void PrepareRungs(void);
+void CompileRung(StrRung * Rung);
 void InitTimers(void);
 void PrepareTimers(void);
 void InitMonostables(void);
@@ -26,6 +27,7 @@ void InitTimersIEC(void);
 void PrepareTimersIEC(void);
 void PrepareAllDatasBeforeRun(void);
 void InitArithmExpr(void);
+void CompileAllArithmExpr(void);
 void InitIOConf( void );
 void RefreshASection( StrSection * pSection );
 void ClassicLadder_RefreshAllSections(void);
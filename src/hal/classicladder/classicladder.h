@@ -223,6 +223,9 @@ typedef struct StrRung
 	char Label[LGT_LABEL];
 	char Comment[LGT_COMMENT];
 	StrElement Element[RUNG_WIDTH][RUNG_HEIGHT];
+	/* cells to refresh in scan order (x*RUNG_HEIGHT+y), set by CompileRung() */
+	int NbrCompiledCells;
+	unsigned char CompiledCell[RUNG_WIDTH*RUNG_HEIGHT];
 }StrRung;
 
 #ifdef OLD_TIMERS_MONOS_SUPPORT
@@ -279,9 +282,24 @@ typedef struct StrTimerIEC
 	int ValueToReachOneBaseUnit;
 }StrTimerIEC;
 
+/* one step of an arithmetic expression compiled by CompileArithmExpr() */
+typedef struct StrArithmOp
+{
+	char Code;	/* ARITHM_OP_ */
+	char Arg;	/* number of vars for MINI, MAXI, AVG, or ARITHM_CMP_ flags */
+	short VarType;
+	short IndexType;	/* -1 if the var is not indexed */
+	int Value;	/* constant, or var offset */
+	int IndexOffset;
+}StrArithmOp;
+
 typedef struct StrArithmExpr
 {
 	char Expr[ARITHM_EXPR_SIZE];
+	/* the same expression compiled for the refresh (if ProgState is not ARITHM_PROG_NONE) */
+	char ProgState;
+	short NbrOps;
+	StrArithmOp Prog[ARITHM_EXPR_SIZE];
 }StrArithmExpr;
 
 #define DEVICE_TYPE_DIRECT_ACCESS 0	/* used inb( ) and outb( ) calls */
@@ -388,6 +406,8 @@ typedef struct StrSection
 	int LastRung;
 	/* if section is in Sequential */
 	int SequentialPage;
+	/* time for the last scan of this main section in ns (if calc on RT side) */
+	int DurationOfLastScan;
 }StrSection;
 
 #define LGT_VAR_NAME 10
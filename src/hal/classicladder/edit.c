@@ -552,7 +552,13 @@ void ApplyNewArithmExpr()
 {
 	int NumExpr;
 	for (NumExpr=0; NumExpr<NBR_ARITHM_EXPR; NumExpr++)
+	{
+		/* the refresh goes back to the parser until compiled again */
+		if ( strcmp(ArithmExpr[NumExpr].Expr,EditArithmExpr[NumExpr].Expr)!=0 )
+			ArithmExpr[NumExpr].ProgState = ARITHM_PROG_NONE;
 		strcpy(ArithmExpr[NumExpr].Expr,EditArithmExpr[NumExpr].Expr);
+	}
+	CompileAllArithmExpr( );
 }
 void CheckForFreeingArithmExpr(int PosiX,int PosiY)
 {
@@ -823,6 +829,7 @@ void DeleteCurrentRung()
 				if ( (RungArray[OldCurrent].Element[x][y].Type == ELE_COMPAR)
 				|| (RungArray[OldCurrent].Element[x][y].Type == ELE_OUTPUT_OPERATE) )
 				{
+					ArithmExpr[ RungArray[OldCurrent].Element[x][y].VarNum ].ProgState = ARITHM_PROG_NONE;
 					strcpy(ArithmExpr[ RungArray[OldCurrent].Element[x][y].VarNum ].Expr,"");
 				}
 			}
@@ -846,6 +853,7 @@ void ApplyRungEdited()
 	int PrevNew;
 	int NextNew;
 	save_label_comment_edited();
+	CompileRung(&EditDatas.Rung);
 	CopyRungToRung(&EditDatas.Rung,&RungArray[EditDatas.NumRung]);
 	ApplyNewArithmExpr();
 
@@ -203,6 +203,7 @@ char LoadRung(char * FileName,StrRung * BufRung)
         }
         while(LineOk);
         fclose(File);
+        CompileRung(BufRung);
         Okay = TRUE;
     }
     return (Okay);
@@ -46,6 +46,7 @@ void InitSections( void )
 		pSection->FirstRung = 0;
 		pSection->LastRung = 0;
 		pSection->SequentialPage = 0;
+		pSection->DurationOfLastScan = 0;
 	}
 
 	// we directly create one section in ladder...
@@ -74,6 +74,7 @@ hal_s32_t **hal_s32_outputs;
 hal_s32_t *hal_state;
 hal_float_t **hal_float_inputs;
 hal_float_t **hal_float_outputs;
+hal_s32_t **hal_section_scan_time;
 
 extern StrGeneralParams GeneralParamsMirror; 
 
@@ -134,6 +135,7 @@ void HalWriteFloatOutputs(void) {
 
 static void hal_task(void *arg, long period) {
 	unsigned long t0, t1,milliseconds;
+	int i;
 	static unsigned long leftover=0;
 	leftover += period;
 	milliseconds= leftover / 1000000;
@@ -161,6 +163,9 @@ static void hal_task(void *arg, long period) {
     
 				HalWriteFloatOutputs();
 			}
+		for( i=0; i<GeneralParamsMirror.SizesInfos.nbr_sections; i++ ) {
+			*hal_section_scan_time[i] = SectionArray[i].DurationOfLastScan;
+		}
 	 	t1 = rtapi_get_time();
 	 	InfosGene->DurationOfLastScan = t1 - t0;
 	}
@@ -245,6 +250,14 @@ error:
 		if(result < 0) goto error;
 	}
 
+	hal_section_scan_time = hal_malloc(sizeof(hal_s32_t*) * GeneralParamsMirror.SizesInfos.nbr_sections);
+	if(!hal_section_scan_time) { result = -ENOMEM; goto error; }
+	for(i=0; i<GeneralParamsMirror.SizesInfos.nbr_sections; i++) {
+		result = hal_pin_s32_newf(HAL_OUT, &hal_section_scan_time[i], compId,
+				"classicladder.0.section-%02d-scan-time", i);
+		if(result < 0) goto error;
+	}
+
 	hal_ready(compId);
 	ClassicLadder_AllocAll( );
 	return 0;
@@ -17,7 +17,7 @@
     1KHz for even the slowest computers, and may reach 10KHz on fast
     ones.  It is a realtime component.
 
-    It supports up to eight counters, with optional index pulses.
+    It supports up to sixteen counters, with optional index pulses.
     The number of counters is set by the module parameter 'num_chan='
     when the component is insmod'ed.  Alternatively, use the
     names= specifier and a list of unique names separated by commas.
@@ -28,6 +28,12 @@
     called in a high speed thread, at least twice the maximum desired
     count rate.  "encoder.capture-position" can be called at a much
     slower rate, and updates the output variables.
+
+    With 'bulk=1', "encoder.update-counters" decodes the x4 channels
+    together, one bit per channel, and only touches the channels that
+    counted or saw an index or latch edge.  The counts are the same as
+    those of the channel by channel decoder, but with many channels
+    the base thread runs in less time.
 */
 
 /** Copyright (C) 2003 John Kasunich
@@ -72,9 +78,11 @@ MODULE_LICENSE("GPL");
 static int num_chan;
 static int default_num_chan=3;
 static int howmany;
+static int bulk;
 RTAPI_MP_INT(num_chan, "number of encoder channels");
+RTAPI_MP_INT(bulk, "decode the x4 channels together");
 
-#define MAX_CHAN 8
+#define MAX_CHAN 16
 char *names[MAX_CHAN] = {0,};
 RTAPI_MP_ARRAY_STRING(names, MAX_CHAN, "names of encoder");
 
@@ -140,6 +148,16 @@ static rtapi_u32 timebase;		/* master timestamp for all counters */
 /* pointer to array of counter_t structs in shmem, 1 per counter */
 static counter_t *counter_array;
 
+/* decoder state for update_bulk(), bit n is counter n.  oldA and oldB
+   hold bits 2 and 3 of the state machine state, as 'state' does for
+   update() */
+static struct {
+    rtapi_u32 oldA;		/* u:rw state machine bit 2 */
+    rtapi_u32 oldB;		/* u:rw state machine bit 3 */
+    rtapi_u32 oldZ;		/* u:rw previous value of phase Z */
+    rtapi_u32 old_latch;	/* u:rw previous value of latch-in */
+} bulk_state;
+
 /* bitmasks for quadrature decode state machine */
 #define SM_PHASE_A_MASK 0x01
 #define SM_PHASE_B_MASK 0x02
@@ -183,6 +201,7 @@ static int comp_id;		/* component ID */
 
 static int export_encoder(counter_t * addr,char * prefix);
 static void update(void *arg, long period);
+static void update_bulk(void *arg, long period);
 static void capture(void *arg, long period);
 
 /***********************************************************************
@@ -283,8 +302,8 @@ int rtapi_app_main(void)
 	cntr->counts_since_timeout = 0;
     }
     /* export functions */
-    retval = hal_export_funct("encoder.update-counters", update,
-	counter_array, 0, 0, comp_id);
+    retval = hal_export_funct("encoder.update-counters",
+	bulk ? update_bulk : update, counter_array, 0, 0, comp_id);
     if (retval != 0) {
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "ENCODER: ERROR: count funct export failed\n");
@@ -390,6 +409,114 @@ static void update(void *arg, long period)
     /* done */
 }
 
+/* Same as update(), for all the channels at once.  In x4 mode a change
+   of one phase counts up or down depending on the other phase, and a
+   change of both is a glitch that doesn't count (see lut_x4), which
+   can be worked out with bitwise operations on the inputs of all the
+   channels.  The x1 and counter mode channels still go through their
+   lookup tables. */
+static void update_bulk(void *arg, long period)
+{
+    counter_t *cntr;
+    atomic *buf;
+    int n;
+    unsigned char state;
+    rtapi_u32 bit, A, B, Z, latch, x4, Zena;
+    rtapi_u32 onlyA, onlyB, up, down, index, latched, work;
+
+    cntr = arg;
+    A = B = Z = latch = x4 = Zena = 0;
+    /* gather the inputs, one bit per channel */
+    for (n = 0; n < howmany; n++) {
+	A |= (rtapi_u32) *(cntr[n].phaseA) << n;
+	B |= (rtapi_u32) *(cntr[n].phaseB) << n;
+	Z |= (rtapi_u32) *(cntr[n].phaseZ) << n;
+	latch |= (rtapi_u32) *(cntr[n].latch_in) << n;
+	x4 |= (rtapi_u32) (*(cntr[n].x4_mode) & !*(cntr[n].counter_mode)) << n;
+	Zena |= (rtapi_u32) (cntr[n].Zmask != 0) << n;
+    }
+    /* decode the x4 channels */
+    onlyA = (A ^ bulk_state.oldA) & ~(B ^ bulk_state.oldB);
+    onlyB = (B ^ bulk_state.oldB) & ~(A ^ bulk_state.oldA);
+    up = ((onlyA & (A ^ B)) | (onlyB & ~(A ^ B))) & x4;
+    down = (onlyA | onlyB) & x4 & ~up;
+    bulk_state.oldA = (bulk_state.oldA & ~x4) | (A & x4);
+    bulk_state.oldB = (bulk_state.oldB & ~x4) | (B & x4);
+    /* rising edges of phase Z with index enabled, changes of latch-in */
+    index = Z & ~bulk_state.oldZ & Zena;
+    bulk_state.oldZ = Z;
+    latched = latch ^ bulk_state.old_latch;
+    bulk_state.old_latch = latch;
+    /* visit the channels that have something to do */
+    work = up | down | index | latched | (~x4 & ((1u << howmany) - 1));
+    for (n = 0, bit = 1; work; n++, bit <<= 1, work >>= 1) {
+	if (!(work & 1)) {
+	    continue;
+	}
+	buf = (atomic *) cntr[n].bp;
+	if (!(x4 & bit)) {
+	    /* rebuild the state machine state, as update() keeps it */
+	    state = 0;
+	    if (bulk_state.oldA & bit) {
+		state |= 0x04;
+	    }
+	    if (bulk_state.oldB & bit) {
+		state |= 0x08;
+	    }
+	    if (A & bit) {
+		state |= SM_PHASE_A_MASK;
+	    }
+	    if (B & bit) {
+		state |= SM_PHASE_B_MASK;
+	    }
+	    if ( *(cntr[n].counter_mode) ) {
+		state = lut_ctr[state & (SM_LOOKUP_MASK & ~SM_PHASE_B_MASK)];
+	    } else {
+		state = lut_x1[state & SM_LOOKUP_MASK];
+	    }
+	    if (state & SM_CNT_UP_MASK) {
+		up |= bit;
+	    } else if (state & SM_CNT_DN_MASK) {
+		down |= bit;
+	    }
+	    bulk_state.oldA &= ~bit;
+	    bulk_state.oldB &= ~bit;
+	    if (state & 0x04) {
+		bulk_state.oldA |= bit;
+	    }
+	    if (state & 0x08) {
+		bulk_state.oldB |= bit;
+	    }
+	}
+	/* should we count? */
+	if (up & bit) {
+	    (*cntr[n].raw_counts)++;
+	    buf->raw_count = *(cntr[n].raw_counts);
+	    buf->timestamp = timebase;
+	    buf->count_detected = 1;
+	} else if (down & bit) {
+	    (*cntr[n].raw_counts)--;
+	    buf->raw_count = *(cntr[n].raw_counts);
+	    buf->timestamp = timebase;
+	    buf->count_detected = 1;
+	}
+	if (index & bit) {
+	    /* capture counts, reset Zmask */
+	    buf->index_count = *(cntr[n].raw_counts);
+	    buf->index_detected = 1;
+	    cntr[n].Zmask = 0;
+	}
+	/* test for latch enabled and desired edge on latch-in */
+	if ((latched & bit) && ((latch & bit) ? *(cntr[n].latch_rising)
+		: *(cntr[n].latch_falling))) {
+	    buf->latch_detected = 1;
+	    buf->latch_count = *(cntr[n].raw_counts);
+	}
+    }
+    /* increment main timestamp counter */
+    timebase += period;
+}
+
 
 static void capture(void *arg, long period)
 {
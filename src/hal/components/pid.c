@@ -96,6 +96,10 @@
     This component exports one function called 'pid.x.do-pid-calcs'
     for each PID loop.  This allows loops to be included in different
     threads and execute at different rates.
+
+    With "all=1", it instead exports one function 'pid.do-pid-calcs-all'
+    that runs every loop, in order.  This saves one function call per
+    loop when all the loops are in the same thread.
 */
 
 /** Copyright (C) 2003 John Kasunich
@@ -148,6 +152,9 @@ RTAPI_MP_ARRAY_STRING(names, MAX_CHAN,"pid names");
 static int debug = 0;		/* flag to export optional params */
 RTAPI_MP_INT(debug, "enables optional params");
 
+static int all = 0;		/* flag to export one funct for all loops */
+RTAPI_MP_INT(all, "one do-pid-calcs-all funct instead of one per loop");
+
 /***********************************************************************
 *                STRUCTURES AND GLOBAL VARIABLES                       *
 ************************************************************************/
@@ -214,6 +221,7 @@ static int comp_id;		/* component ID */
 
 static int export_pid(hal_pid_t * addr,char * prefix);
 static void calc_pid(void *arg, long period);
+static void calc_pid_all(void *arg, long period);
 
 /***********************************************************************
 *                       INIT AND EXIT CODE                             *
@@ -280,6 +288,16 @@ int rtapi_app_main(void)
 	    return -1;
 	}
     }
+    if (all) {
+	retval = hal_export_funct("pid.do-pid-calcs-all", calc_pid_all,
+	    pid_array, 1, 0, comp_id);
+	if (retval != 0) {
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+		"PID: ERROR: do_pid_calcs_all funct export failed\n");
+	    hal_exit(comp_id);
+	    return -1;
+	}
+    }
     rtapi_print_msg(RTAPI_MSG_INFO, "PID: installed %d PID loops\n",
 	howmany);
     hal_ready(comp_id);
@@ -295,26 +313,24 @@ void rtapi_app_exit(void)
 *                   REALTIME PID LOOP CALCULATIONS                     *
 ************************************************************************/
 
-static void calc_pid(void *arg, long period)
+/* One period of one loop.  Each pin is read once and each output pin
+   written once, the limits and gains are used from locals. */
+static inline void pid_loop(hal_pid_t * pid, long period, double periodfp,
+    double periodrecip)
 {
-    hal_pid_t *pid;
-    double tmp1, tmp2, command, feedback;
-    int enable;
-    double periodfp, periodrecip;
+    double tmp1, tmp2, command, feedback, lim, error_i, error_d, cmd_d, cmd_dd;
+    int enable, index_enable, index_reset;
 
-    /* point to the data for this PID loop */
-    pid = arg;
-    /* precalculate some timing constants */
-    periodfp = period * 0.000000001;
-    periodrecip = 1.0 / periodfp;
     /* get the enable bit */
     enable = *(pid->enable);
     /* read the command and feedback only once */
     command = *(pid->command);
     feedback = *(pid->feedback);
+    /* falling edge of index_enable: prev_cmd can't be trusted */
+    index_enable = *(pid->index_enable);
+    index_reset = pid->prev_ie && !index_enable;
     /* calculate the error */
-    if((!(pid->prev_ie && !*(pid->index_enable))) && 
-       (*(pid->error_previous_target))) {
+    if(!index_reset && (*(pid->error_previous_target))) {
         // the user requests ferror against prev_cmd, and we can honor
         // that request because we haven't just had an index reset that
         // screwed it up.  Otherwise, if we did just have an index
@@ -328,62 +344,70 @@ static void calc_pid(void *arg, long period)
     /* store error to error pin */
     *(pid->error) = tmp1;
     /* apply error limits */
-    if (*(pid->maxerror) != 0.0) {
-	if (tmp1 > *(pid->maxerror)) {
-	    tmp1 = *(pid->maxerror);
-	} else if (tmp1 < -*(pid->maxerror)) {
-	    tmp1 = -*(pid->maxerror);
+    lim = *(pid->maxerror);
+    if (lim != 0.0) {
+	if (tmp1 > lim) {
+	    tmp1 = lim;
+	} else if (tmp1 < -lim) {
+	    tmp1 = -lim;
 	}
     }
     /* apply the deadband */
-    if (tmp1 > *(pid->deadband)) {
-	tmp1 -= *(pid->deadband);
-    } else if (tmp1 < -*(pid->deadband)) {
-	tmp1 += *(pid->deadband);
+    lim = *(pid->deadband);
+    if (tmp1 > lim) {
+	tmp1 -= lim;
+    } else if (tmp1 < -lim) {
+	tmp1 += lim;
     } else {
 	tmp1 = 0;
     }
     /* do integrator calcs only if enabled */
     if (enable != 0) {
+	error_i = *(pid->error_i);
 	/* if output is in limit, don't let integrator wind up */
 	if ( ( tmp1 * pid->limit_state ) <= 0.0 ) {
 	    /* compute integral term */
-	    *(pid->error_i) += tmp1 * periodfp;
+	    error_i += tmp1 * periodfp;
 	}
 	/* apply integrator limits */
-	if (*(pid->maxerror_i) != 0.0) {
-	    if (*(pid->error_i) > *(pid->maxerror_i)) {
-		*(pid->error_i) = *(pid->maxerror_i);
-	    } else if (*(pid->error_i) < -*(pid->maxerror_i)) {
-		*(pid->error_i) = -*(pid->maxerror_i);
+	lim = *(pid->maxerror_i);
+	if (lim != 0.0) {
+	    if (error_i > lim) {
+		error_i = lim;
+	    } else if (error_i < -lim) {
+		error_i = -lim;
 	    }
 	}
     } else {
 	/* not enabled, reset integrator */
-	*(pid->error_i) = 0;
+	error_i = 0;
     }
+    *(pid->error_i) = error_i;
     /* compute command and feedback derivatives to dummysigs */
-    if(!(pid->prev_ie && !*(pid->index_enable))) {
+    if(!index_reset) {
         *(pid->commandvds) = (command - pid->prev_cmd) * periodrecip;
         *(pid->feedbackvds) = (feedback - pid->prev_fb) * periodrecip;
     }
-    /* and calculate derivative term as difference of derivatives */
-    *(pid->error_d) = *(pid->commandv) - *(pid->feedbackv);
+    /* and calculate derivative term as difference of derivatives; the
+       derivative pins may be the dummysigs just written */
+    error_d = *(pid->commandv) - *(pid->feedbackv);
     pid->prev_error = tmp1;
     /* apply derivative limits */
-    if (*(pid->maxerror_d) != 0.0) {
-	if (*(pid->error_d) > *(pid->maxerror_d)) {
-	    *(pid->error_d) = *(pid->maxerror_d);
-	} else if (*(pid->error_d) < -*(pid->maxerror_d)) {
-	    *(pid->error_d) = -*(pid->maxerror_d);
+    lim = *(pid->maxerror_d);
+    if (lim != 0.0) {
+	if (error_d > lim) {
+	    error_d = lim;
+	} else if (error_d < -lim) {
+	    error_d = -lim;
 	}
     }
+    *(pid->error_d) = error_d;
     /* calculate derivative of command */
     /* save old value for 2nd derivative calc later */
-    tmp2 = *(pid->cmd_d);
-    if(!(pid->prev_ie && !*(pid->index_enable))) {
+    tmp2 = cmd_d = *(pid->cmd_d);
+    if(!index_reset) {
         // not falling edge of index_enable: the normal case
-        *(pid->cmd_d) = (command - pid->prev_cmd) * periodrecip;
+        cmd_d = (command - pid->prev_cmd) * periodrecip;
     }
     // else: leave cmd_d alone and use last period's.  prev_cmd
     // shouldn't be trusted because index homing has caused us to have
@@ -392,44 +416,49 @@ static void calc_pid(void *arg, long period)
     // slow steady speed.
 
     // save ie for next time
-    pid->prev_ie = *(pid->index_enable);
+    pid->prev_ie = index_enable;
 
     pid->prev_cmd = command;
     pid->prev_fb = feedback;
 
     /* apply derivative limits */
-    if (*(pid->maxcmd_d) != 0.0) {
-	if (*(pid->cmd_d) > *(pid->maxcmd_d)) {
-	    *(pid->cmd_d) = *(pid->maxcmd_d);
-	} else if (*(pid->cmd_d) < -*(pid->maxcmd_d)) {
-	    *(pid->cmd_d) = -*(pid->maxcmd_d);
+    lim = *(pid->maxcmd_d);
+    if (lim != 0.0) {
+	if (cmd_d > lim) {
+	    cmd_d = lim;
+	} else if (cmd_d < -lim) {
+	    cmd_d = -lim;
 	}
     }
+    *(pid->cmd_d) = cmd_d;
     /* calculate 2nd derivative of command */
-    *(pid->cmd_dd) = (*(pid->cmd_d) - tmp2) * periodrecip;
+    cmd_dd = (cmd_d - tmp2) * periodrecip;
     /* apply 2nd derivative limits */
-    if (*(pid->maxcmd_dd) != 0.0) {
-	if (*(pid->cmd_dd) > *(pid->maxcmd_dd)) {
-	    *(pid->cmd_dd) = *(pid->maxcmd_dd);
-	} else if (*(pid->cmd_dd) < -*(pid->maxcmd_dd)) {
-	    *(pid->cmd_dd) = -*(pid->maxcmd_dd);
+    lim = *(pid->maxcmd_dd);
+    if (lim != 0.0) {
+	if (cmd_dd > lim) {
+	    cmd_dd = lim;
+	} else if (cmd_dd < -lim) {
+	    cmd_dd = -lim;
 	}
     }
+    *(pid->cmd_dd) = cmd_dd;
     /* do output calcs only if enabled */
     if (enable != 0) {
 	/* calculate the output value */
 	tmp1 =
-	    *(pid->bias) + *(pid->pgain) * tmp1 + *(pid->igain) * *(pid->error_i) +
-	    *(pid->dgain) * *(pid->error_d);
-	tmp1 += command * *(pid->ff0gain) + *(pid->cmd_d) * *(pid->ff1gain) +
-	    *(pid->cmd_dd) * *(pid->ff2gain);
+	    *(pid->bias) + *(pid->pgain) * tmp1 + *(pid->igain) * error_i +
+	    *(pid->dgain) * error_d;
+	tmp1 += command * *(pid->ff0gain) + cmd_d * *(pid->ff1gain) +
+	    cmd_dd * *(pid->ff2gain);
 	/* apply output limits */
-	if (*(pid->maxoutput) != 0.0) {
-	    if (tmp1 > *(pid->maxoutput)) {
-		tmp1 = *(pid->maxoutput);
+	lim = *(pid->maxoutput);
+	if (lim != 0.0) {
+	    if (tmp1 > lim) {
+		tmp1 = lim;
 		pid->limit_state = 1.0;
-	    } else if (tmp1 < -*(pid->maxoutput)) {
-		tmp1 = -*(pid->maxoutput);
+	    } else if (tmp1 < -lim) {
+		tmp1 = -lim;
 		pid->limit_state = -1.0;
 	    } else {
 		pid->limit_state = 0.0;
@@ -457,6 +486,32 @@ static void calc_pid(void *arg, long period)
     /* done */
 }
 
+static void calc_pid(void *arg, long period)
+{
+    double periodfp;
+
+    /* precalculate some timing constants */
+    periodfp = period * 0.000000001;
+    pid_loop(arg, period, periodfp, 1.0 / periodfp);
+}
+
+/* every loop, in one funct */
+static void calc_pid_all(void *arg, long period)
+{
+    hal_pid_t *pid;
+    double periodfp, periodrecip;
+    int n;
+
+    /* the timing constants are the same for all the loops */
+    periodfp = period * 0.000000001;
+    periodrecip = 1.0 / periodfp;
+    pid = arg;
+    for (n = 0; n < howmany; n++) {
+	pid_loop(pid, period, periodfp, periodrecip);
+	pid++;
+    }
+}
+
 /***********************************************************************
 *                   LOCAL FUNCTION DEFINITIONS                         *
 ************************************************************************/
@@ -666,15 +721,17 @@ static int export_pid(hal_pid_t * addr, char * prefix)
     *(addr->ff1gain) = 0.0;
     *(addr->ff2gain) = 0.0;
     *(addr->maxoutput) = 0.0;
-    /* export function for this loop */
-    rtapi_snprintf(buf, sizeof(buf), "%s.do-pid-calcs", prefix);
-    retval =
-	hal_export_funct(buf, calc_pid, addr, 1, 0, comp_id);
-    if (retval != 0) {
-	rtapi_print_msg(RTAPI_MSG_ERR,
-	    "PID: ERROR: do_pid_calcs funct export failed\n");
-	hal_exit(comp_id);
-	return -1;
+    /* export function for this loop, unless they all run in one */
+    if (!all) {
+	rtapi_snprintf(buf, sizeof(buf), "%s.do-pid-calcs", prefix);
+	retval =
+	    hal_export_funct(buf, calc_pid, addr, 1, 0, comp_id);
+	if (retval != 0) {
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+		"PID: ERROR: do_pid_calcs funct export failed\n");
+	    hal_exit(comp_id);
+	    return -1;
+	}
     }
     /* restore saved message level */
     rtapi_set_msg_level(msg);
@@ -0,0 +1,328 @@
+/********************************************************************
+* Description:  recorder.c
+*               A HAL component that keeps a history of HAL pins
+*               for 'halrecorder', which saves it to a file when
+*               a trigger pin changes.
+*
+* License: GPL Version 2
+*
+********************************************************************/
+/** This file, 'recorder.c', is the realtime part of a HAL component
+    that records HAL pins all the time, so that what led up to an
+    event such as a following error can be looked at afterwards.
+    It works like 'sampler': when loaded, it creates a fifo in shared
+    memory and captures the pins into it, every 'decimate' periods of
+    its thread.  The user space program 'halrecorder' reads the fifo
+    continuously and keeps the last records in memory, and when a
+    record is tagged as a trigger, writes the records before and
+    after it to a compressed file.
+
+    The trigger pin is checked every period, not just when a record
+    is taken, so that a short pulse isn't missed.  The edge that was
+    seen tags the next record; the tag is the last element of the
+    record, after the pins.
+
+    Loading:
+
+    loadrt recorder depth=4000 cfg=ffffb
+
+*/
+
+/** This program is free software; you can redistribute it and/or
+    modify it under the terms of version 2 of the GNU General
+    Public License as published by the Free Software Foundation.
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111 USA
+
+    THE AUTHORS OF THIS LIBRARY ACCEPT ABSOLUTELY NO LIABILITY FOR
+    ANY HARM OR LOSS RESULTING FROM ITS USE.  IT IS _EXTREMELY_ UNWISE
+    TO RELY ON SOFTWARE ALONE FOR SAFETY.  Any machinery capable of
+    harming persons must have provisions for completely removing power
+    from all motors, etc, before persons enter any danger area.  All
+    machinery must be designed to comply with local and national safety
+    codes, and the authors of this software can not, and do not, take
+    any responsibility for such compliance.
+
+    This code was written as part of the EMC HAL project.  For more
+    information, go to www.linuxcnc.org.
+*/
+
+#include "rtapi.h"              /* RTAPI realtime OS API */
+#include "rtapi_app.h"          /* RTAPI realtime module decls */
+#include "hal.h"                /* HAL public API decls */
+#include "streamer.h"		/* decls and such for fifos */
+#include "rtapi_errno.h"
+#include "rtapi_string.h"
+
+/* module information */
+MODULE_DESCRIPTION("Realtime HAL Recorder");
+MODULE_LICENSE("GPL");
+static char *cfg[MAX_RECORDERS];	/* config string, no default */
+RTAPI_MP_ARRAY_STRING(cfg,MAX_RECORDERS,"config string");
+static int depth[MAX_RECORDERS];	/* depth of fifo, default 0 */
+RTAPI_MP_ARRAY_INT(depth,MAX_RECORDERS,"fifo depth");
+
+/***********************************************************************
+*                STRUCTURES AND GLOBAL VARIABLES                       *
+************************************************************************/
+
+/* this structure contains the HAL shared memory data for one recorder */
+
+typedef struct {
+    hal_stream_t fifo;		/* pointer to user/RT fifo */
+    hal_s32_t *curr_depth;	/* pin: current fifo depth */
+    hal_s32_t *overruns;	/* pin: number of overruns */
+    hal_bit_t *trigger;		/* pin: records are saved when it changes */
+    hal_bit_t *falling;		/* pin: trigger on falling edge, not rising */
+    hal_u32_t *decimate;	/* pin: take a record every N periods */
+    hal_bit_t last_trigger;	/* trigger pin in the last period */
+    int pending;		/* edge seen, not yet in a record */
+    hal_u32_t count;		/* periods since the last record */
+    int num_pins;
+    pin_data_t pins[HAL_STREAM_MAX_PINS];
+} recorder_t;
+
+/* other globals */
+static int comp_id;		/* component ID */
+static int nrecorders;
+static recorder_t *recorders;
+
+/***********************************************************************
+*                  LOCAL FUNCTION DECLARATIONS                         *
+************************************************************************/
+
+static int init_recorder(int num, recorder_t *rec);
+static void record(void *arg, long period);
+
+/***********************************************************************
+*                       INIT AND EXIT CODE                             *
+************************************************************************/
+
+int rtapi_app_main(void)
+{
+    int n, retval;
+    char types[HAL_STREAM_MAX_PINS + 2];
+
+    comp_id = hal_init("recorder");
+    if (comp_id < 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR, "RECORDER: ERROR: hal_init() failed\n");
+	return -EINVAL;
+    }
+
+    recorders = hal_malloc(MAX_RECORDERS * sizeof(recorder_t));
+    /* validate config info */
+    for ( n = 0 ; n < MAX_RECORDERS ; n++ ) {
+	if (( cfg[n] == NULL ) || ( *cfg[n] == '\0' ) || ( depth[n] <= 0 )) {
+	    break;
+	}
+	/* the last element of each record is the trigger tag */
+	if ( strlen(cfg[n]) >= HAL_STREAM_MAX_PINS ) {
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+		"RECORDER: ERROR: more than %d pins in '%s'\n",
+		HAL_STREAM_MAX_PINS - 1, cfg[n]);
+	    retval = -EINVAL;
+	    goto fail;
+	}
+	rtapi_snprintf(types, sizeof(types), "%sb", cfg[n]);
+	retval = hal_stream_create(&recorders[n].fifo, comp_id,
+	    RECORDER_SHMEM_KEY+n, depth[n], types);
+	if(retval < 0) {
+	    goto fail;
+	}
+	nrecorders++;
+	retval = init_recorder(n, &recorders[n]);
+	if(retval < 0) {
+	    goto fail;
+	}
+    }
+    if ( n == 0 ) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "RECORDER: ERROR: no channels specified\n");
+	hal_exit(comp_id);
+	return -EINVAL;
+    }
+
+    hal_ready(comp_id);
+    return 0;
+fail:
+    for(n=0; n<nrecorders; n++) hal_stream_detach(&recorders[n].fifo);
+    hal_exit(comp_id);
+    return retval;
+}
+
+void rtapi_app_exit(void)
+{
+    int i;
+    for(i=0; i<nrecorders; i++) hal_stream_detach(&recorders[i].fifo);
+    hal_exit(comp_id);
+}
+
+/***********************************************************************
+*                      REALTIME RECORDING FUNCTION                     *
+************************************************************************/
+
+static void record(void *arg, long period)
+{
+    recorder_t *rec;
+    pin_data_t *pptr;
+    hal_bit_t trigger;
+    int n;
+
+    /* point at recorder struct in HAL shmem */
+    rec = arg;
+    /* look for the trigger edge every period */
+    trigger = *(rec->trigger);
+    if ( trigger != rec->last_trigger
+	    && trigger == (*(rec->falling) ? 0 : 1) ) {
+	rec->pending = 1;
+    }
+    rec->last_trigger = trigger;
+    /* is it time for a record? */
+    if ( ++rec->count < *(rec->decimate) ) {
+	return;
+    }
+    rec->count = 0;
+    /* point at pins in hal shmem */
+    pptr = rec->pins;
+    union hal_stream_data data[HAL_STREAM_MAX_PINS], *dptr=data;
+    /* copy data from HAL pins to fifo */
+    for ( n = 0 ; n < rec->num_pins ; n++ ) {
+	switch ( hal_stream_element_type(&rec->fifo, n) ) {
+	case HAL_FLOAT:
+	    dptr->f = *(pptr->hfloat);
+	    break;
+	case HAL_BIT:
+	    if ( *(pptr->hbit) ) {
+		dptr->b = 1;
+	    } else {
+		dptr->b = 0;
+	    }
+	    break;
+	case HAL_U32:
+	    dptr->u = *(pptr->hu32);
+	    break;
+	case HAL_S32:
+	    dptr->s = *(pptr->hs32);
+	    break;
+	default:
+	    break;
+	}
+	dptr++;
+	pptr++;
+    }
+    dptr->b = rec->pending;
+    if ( hal_stream_write(&rec->fifo, data) < 0) {
+	/* fifo is full, data is lost; keep the edge for the next one */
+	(*rec->overruns)++;
+	*(rec->curr_depth) = hal_stream_maxdepth(&rec->fifo);
+    } else {
+	rec->pending = 0;
+	*(rec->curr_depth) = hal_stream_depth(&rec->fifo);
+    }
+}
+
+/***********************************************************************
+*                   LOCAL FUNCTION DEFINITIONS                         *
+************************************************************************/
+
+static int init_recorder(int num, recorder_t *rec)
+{
+    int retval, usefp, n;
+    pin_data_t *pptr;
+    char buf[HAL_NAME_LEN + 1];
+
+    /* export "standard" pins */
+    retval = hal_pin_bit_newf(HAL_IN, &(rec->trigger), comp_id,
+	"recorder.%d.trigger", num);
+    if (retval != 0 ) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "RECORDER: ERROR: 'trigger' pin export failed\n");
+	return -EIO;
+    }
+    retval = hal_pin_bit_newf(HAL_IN, &(rec->falling), comp_id,
+	"recorder.%d.falling", num);
+    if (retval != 0 ) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "RECORDER: ERROR: 'falling' pin export failed\n");
+	return -EIO;
+    }
+    retval = hal_pin_u32_newf(HAL_IN, &(rec->decimate), comp_id,
+	"recorder.%d.decimate", num);
+    if (retval != 0 ) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "RECORDER: ERROR: 'decimate' pin export failed\n");
+	return -EIO;
+    }
+    retval = hal_pin_s32_newf(HAL_OUT, &(rec->curr_depth), comp_id,
+	"recorder.%d.curr-depth", num);
+    if (retval != 0 ) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "RECORDER: ERROR: 'curr-depth' pin export failed\n");
+	return -EIO;
+    }
+    retval = hal_pin_s32_newf(HAL_IO, &(rec->overruns), comp_id,
+	"recorder.%d.overruns", num);
+    if (retval != 0 ) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "RECORDER: ERROR: 'overruns' pin export failed\n");
+	return -EIO;
+    }
+    /* init the standard pins */
+    *(rec->trigger) = 0;
+    *(rec->falling) = 0;
+    *(rec->decimate) = 1;
+    *(rec->curr_depth) = 0;
+    *(rec->overruns) = 0;
+    rec->last_trigger = 0;
+    rec->pending = 0;
+    rec->count = 0;
+    /* all but the trigger tag are pins */
+    rec->num_pins = hal_stream_element_count(&rec->fifo) - 1;
+    pptr = rec->pins;
+    usefp = 0;
+    /* export user specified pins (the ones that are recorded) */
+    for ( n = 0 ; n < rec->num_pins ; n++ ) {
+	rtapi_snprintf(buf, sizeof(buf), "recorder.%d.pin.%d", num, n);
+	retval = hal_pin_new(buf, hal_stream_element_type(&rec->fifo, n), HAL_IN, (void **)pptr, comp_id );
+	if (retval != 0 ) {
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+		"RECORDER: ERROR: pin '%s' export failed\n", buf);
+	    return -EIO;
+	}
+	/* init the pin value */
+	switch ( hal_stream_element_type(&rec->fifo, n) ) {
+	case HAL_FLOAT:
+	    *(pptr->hfloat) = 0.0;
+	    usefp = 1;
+	    break;
+	case HAL_BIT:
+	    *(pptr->hbit) = 0;
+	    break;
+	case HAL_U32:
+	    *(pptr->hu32) = 0;
+	    break;
+	case HAL_S32:
+	    *(pptr->hs32) = 0;
+	    break;
+	default:
+	    break;
+	}
+	pptr++;
+    }
+    /* export update function */
+    rtapi_snprintf(buf, sizeof(buf), "recorder.%d", num);
+    retval = hal_export_funct(buf, record, rec, usefp, 0, comp_id);
+    if (retval != 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "RECORDER: ERROR: function export failed\n");
+	return retval;
+    }
+
+    return 0;
+}
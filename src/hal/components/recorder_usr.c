@@ -0,0 +1,382 @@
+/********************************************************************
+* Description:  recorder_usr.c
+*               User space part of "recorder", a HAL component that
+*		keeps a history of HAL pins and saves it to a file
+*		when a trigger pin changes.
+*
+* License: GPL Version 2
+*
+********************************************************************/
+/** This file, 'recorder_usr.c', is the user part of a HAL component
+    that records HAL pins all the time, so that what led up to a fault
+    can be looked at afterwards.  The realtime part, 'recorder', puts
+    the pins into a stream; this program empties the stream
+    continuously, keeping the last 'before' records in memory.  When
+    a record is tagged as a trigger, it writes those records, the
+    trigger record and the 'after' records that follow it to a file
+    compressed with gzip, and then waits for the next trigger.
+
+    Invoking:
+
+    halrecorder [-c chan_num] [-b before] [-a after] [-n count]
+		[-d directory]
+
+    'chan_num', if present, specifies the recorder channel to use.
+    The default is channel zero.
+
+    'before' and 'after' are the number of records to save before
+    and after the trigger, 1000 of each by default.
+
+    'count', if present, is the number of files to write before
+    exiting.  If omitted it runs until killed.
+
+    'directory' is where the files are written, the current directory
+    by default.  They are named recorder-<chan>-<date>-<time>.txt.gz,
+    and have one line per record in the format of 'halsampler -t',
+    after comment lines that describe the recording.  A gap in the
+    sample numbers means the stream overran.
+*/
+
+/** This program is free software; you can redistribute it and/or
+    modify it under the terms of version 2 of the GNU General
+    Public License as published by the Free Software Foundation.
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111 USA
+
+    THE AUTHORS OF THIS LIBRARY ACCEPT ABSOLUTELY NO LIABILITY FOR
+    ANY HARM OR LOSS RESULTING FROM ITS USE.  IT IS _EXTREMELY_ UNWISE
+    TO RELY ON SOFTWARE ALONE FOR SAFETY.  Any machinery capable of
+    harming persons must have provisions for completely removing power
+    from all motors, etc, before persons enter any danger area.  All
+    machinery must be designed to comply with local and national safety
+    codes, and the authors of this software can not, and do not, take
+    any responsibility for such compliance.
+
+    This code was written as part of the EMC HAL project.  For more
+    information, go to www.linuxcnc.org.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "rtapi.h"		/* RTAPI realtime OS API */
+#include "hal.h"                /* HAL public API decls */
+#include "streamer.h"
+
+/***********************************************************************
+*                         GLOBAL VARIABLES                             *
+************************************************************************/
+
+int comp_id = -1;	/* -1 means hal_init() not called yet */
+int exitval = 1;	/* program return code - 1 means error */
+int ignore_sig = 0;	/* used to flag critical regions */
+char comp_name[HAL_NAME_LEN+1];	/* name for this instance of recorder */
+
+/* history of the last 'before' records, oldest first from 'hist_next' */
+static union hal_stream_data *hist;
+static unsigned *hist_sampleno;
+static long hist_len, hist_count, hist_next;
+
+/***********************************************************************
+*                            MAIN PROGRAM                              *
+************************************************************************/
+
+/* signal handler */
+static sig_atomic_t stop;
+static void quit(int sig)
+{
+    if ( ignore_sig ) {
+	return;
+    }
+    stop = 1;
+}
+
+#define BATCH 256
+
+/* Starts gzip writing to 'filename' and returns a stream that feeds it,
+   or NULL.  The stream is closed with close_gzip(). */
+static FILE *open_gzip(const char *filename, pid_t *pid)
+{
+    int fd, pipefd[2];
+    FILE *fp;
+
+    fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if ( fd < 0 ) {
+	return NULL;
+    }
+    if ( pipe(pipefd) < 0 ) {
+	close(fd);
+	return NULL;
+    }
+    *pid = fork();
+    if ( *pid < 0 ) {
+	close(fd);
+	close(pipefd[0]);
+	close(pipefd[1]);
+	return NULL;
+    }
+    if ( *pid == 0 ) {
+	dup2(pipefd[0], 0);
+	dup2(fd, 1);
+	close(pipefd[0]);
+	close(pipefd[1]);
+	close(fd);
+	execlp("gzip", "gzip", "-c", (char *) NULL);
+	_exit(127);
+    }
+    close(fd);
+    close(pipefd[0]);
+    fp = fdopen(pipefd[1], "w");
+    if ( fp == NULL ) {
+	close(pipefd[1]);
+    }
+    return fp;
+}
+
+static int close_gzip(FILE *fp, pid_t pid)
+{
+    int status, retval;
+
+    retval = fclose(fp);
+    if ( waitpid(pid, &status, 0) < 0 || !WIFEXITED(status)
+	    || WEXITSTATUS(status) != 0 ) {
+	retval = -1;
+    }
+    return retval;
+}
+
+static void print_record(FILE *fp, hal_stream_t *stream, int num_pins,
+    union hal_stream_data *buf, unsigned sampleno)
+{
+    int n;
+
+    fprintf ( fp, "%u ", sampleno-1 );
+    for ( n = 0 ; n < num_pins; n++ ) {
+	switch ( hal_stream_element_type(stream, n) ) {
+	case HAL_FLOAT:
+	    fprintf ( fp, "%f ", buf[n].f);
+	    break;
+	case HAL_BIT:
+	    if ( buf[n].b ) {
+		fprintf ( fp, "1 " );
+	    } else {
+		fprintf ( fp, "0 " );
+	    }
+	    break;
+	case HAL_U32:
+	    fprintf ( fp, "%lu ", (unsigned long)buf[n].u);
+	    break;
+	case HAL_S32:
+	    fprintf ( fp, "%ld ", (long)buf[n].s);
+	    break;
+	default:
+	    break;
+	}
+    }
+    fprintf ( fp, "\n" );
+}
+
+/* adds a record to the history, dropping the oldest if it is full */
+static void hist_add(int stride, union hal_stream_data *buf, unsigned sampleno)
+{
+    if ( hist_len == 0 ) {
+	return;
+    }
+    memcpy(&hist[hist_next * stride], buf,
+	sizeof(union hal_stream_data) * stride);
+    hist_sampleno[hist_next] = sampleno;
+    if ( ++hist_next == hist_len ) {
+	hist_next = 0;
+    }
+    if ( hist_count < hist_len ) {
+	hist_count++;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int n, channel, num_pins, stride;
+    long before, after, count, post;
+    char *cp, *cp2, *dir;
+    hal_stream_t stream;
+    FILE *out = NULL;
+    pid_t gzip_pid = 0;
+    char filename[4096];
+
+    /* set return code to "fail", clear it later if all goes well */
+    exitval = 1;
+    channel = 0;
+    before = 1000;
+    after = 1000;
+    count = -1;  /* -1 means run forever */
+    dir = ".";
+    for ( n = 1 ; n < argc ; n++ ) {
+	long *val = NULL;
+	cp = argv[n];
+	if ( *cp != '-' ) {
+	    break;
+	}
+	switch ( *(++cp) ) {
+	case 'c':
+	    if (( *(++cp) == '\0' ) && ( ++n < argc )) {
+		cp = argv[n];
+	    }
+	    channel = strtol(cp, &cp2, 10);
+	    if (( *cp2 ) || ( channel < 0 ) || ( channel >= MAX_RECORDERS )) {
+		fprintf(stderr,"ERROR: invalid channel number '%s'\n", cp );
+		exit(1);
+	    }
+	    break;
+	case 'b':
+	    val = &before;
+	    break;
+	case 'a':
+	    val = &after;
+	    break;
+	case 'n':
+	    val = &count;
+	    break;
+	case 'd':
+	    if (( *(++cp) == '\0' ) && ( ++n < argc )) {
+		cp = argv[n];
+	    }
+	    dir = cp;
+	    break;
+	default:
+	    fprintf(stderr,"ERROR: unknown option '%s'\n", cp );
+	    exit(1);
+	    break;
+	}
+	if ( val ) {
+	    if (( *(++cp) == '\0' ) && ( ++n < argc )) {
+		cp = argv[n];
+	    }
+	    *val = strtol(cp, &cp2, 10);
+	    if (( *cp2 ) || ( *val < 0 )) {
+		fprintf(stderr, "ERROR: invalid count '%s'\n", cp );
+		exit(1);
+	    }
+	}
+    }
+    /* register signal handlers - if the process is killed
+       we need to call hal_exit() to free the shared memory */
+    signal(SIGINT, quit);
+    signal(SIGTERM, quit);
+    signal(SIGPIPE, SIG_IGN);
+    /* connect to HAL */
+    /* create a unique module name, to allow for multiple recorders */
+    snprintf(comp_name, sizeof(comp_name), "halrecorder%d", getpid());
+    /* connect to the HAL */
+    ignore_sig = 1;
+    comp_id = hal_init(comp_name);
+    ignore_sig = 0;
+    /* check result */
+    if (comp_id < 0) {
+	fprintf(stderr, "ERROR: hal_init() failed: %d\n", comp_id );
+	goto out;
+    }
+    hal_ready(comp_id);
+    int res = hal_stream_attach(&stream, comp_id, RECORDER_SHMEM_KEY+channel, 0);
+    if (res < 0) {
+	errno = -res;
+	perror("hal_stream_attach");
+	goto out;
+    }
+    /* the last element is the trigger tag */
+    stride = hal_stream_element_count(&stream);
+    num_pins = stride - 1;
+    hist_len = before;
+    hist = malloc(sizeof(union hal_stream_data) * stride * (hist_len + 1));
+    hist_sampleno = malloc(sizeof(unsigned) * (hist_len + 1));
+    if ( hist == NULL || hist_sampleno == NULL ) {
+	fprintf(stderr, "ERROR: not enough memory for %ld records\n", before);
+	goto out;
+    }
+    post = -1;	/* -1 means not saving */
+    while ( count != 0 ) {
+	union hal_stream_data buf[BATCH * stride];
+	unsigned sampleno[BATCH];
+	int i, got;
+
+	hal_stream_wait_readable(&stream, &stop);
+	if ( stop ) {
+	    break;
+	}
+	got = hal_stream_read_n(&stream, buf, BATCH, sampleno);
+	for ( i = 0 ; i < got && count != 0 ; i++ ) {
+	    union hal_stream_data *rec = &buf[i * stride];
+	    if ( post < 0 && rec[num_pins].b ) {
+		/* trigger, save the history and start on the rest */
+		char stamp[32];
+		time_t now = time(NULL);
+		long h;
+		strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S",
+		    localtime(&now));
+		snprintf(filename, sizeof(filename),
+		    "%s/recorder-%d-%s.txt.gz", dir, channel, stamp);
+		out = open_gzip(filename, &gzip_pid);
+		if ( out == NULL ) {
+		    fprintf(stderr, "ERROR: '%s' could not be created\n",
+			filename);
+		    goto out;
+		}
+		fprintf(out, "# halrecorder channel %d, trigger at sample %u\n",
+		    channel, sampleno[i] - 1);
+		fprintf(out, "# %ld records before, %ld after\n",
+		    hist_count, after);
+		for ( h = 0 ; h < hist_count ; h++ ) {
+		    long k = (hist_next - hist_count + h + hist_len) % hist_len;
+		    print_record(out, &stream, num_pins, &hist[k * stride],
+			hist_sampleno[k]);
+		}
+		print_record(out, &stream, num_pins, rec, sampleno[i]);
+		post = after;
+	    } else if ( post > 0 ) {
+		print_record(out, &stream, num_pins, rec, sampleno[i]);
+		post--;
+	    }
+	    if ( post == 0 ) {
+		/* all saved, wait for the next trigger */
+		if ( close_gzip(out, gzip_pid) < 0 ) {
+		    fprintf(stderr, "ERROR: writing '%s' failed\n", filename);
+		} else {
+		    fprintf(stderr, "Recording '%s' written\n", filename);
+		}
+		out = NULL;
+		post = -1;
+		if ( count > 0 ) {
+		    count--;
+		}
+	    }
+	    hist_add(stride, rec, sampleno[i]);
+	}
+    }
+    /* run was succesfull */
+    exitval = 0;
+
+out:
+    ignore_sig = 1;
+    if ( out != NULL ) {
+	/* stopped while saving, keep what there is */
+	close_gzip(out, gzip_pid);
+    }
+    hal_stream_detach(&stream);
+    if ( comp_id >= 0 ) {
+	hal_exit(comp_id);
+    }
+    return exitval;
+}
@@ -20,7 +20,7 @@
 
     Invoking:
 
-    halsampler [-c chan_num] [-n num_samples] [-t]
+    halsampler [-c chan_num] [-n num_samples] [-t] [-b]
 
     'chan_num', if present, specifies the sampler channel to use.
     The default is channel zero.
@@ -32,6 +32,8 @@
     '-t' tells sampler to print the sample number at the start
     of each line.
 
+    '-b' tells sampler to write binary records instead of lines.
+
 */
 
 /** This program is free software; you can redistribute it and/or
@@ -103,10 +105,56 @@ static void quit(int sig)
 }
 
 #define BUF_SIZE 4000
+#define BATCH 256
+
+/* Copies the FIFO to stdout as binary records, a batch at a time.
+   Each record is the hal_stream_data of every pin, preceded by the
+   sample number in a hal_stream_data if 'tag' is set.  Overruns are
+   reported on stderr.  Returns the exit code. */
+static int binary_samples(hal_stream_t *stream, long int samples, int tag)
+{
+    int num_pins = hal_stream_element_count(stream);
+    int stride = num_pins + tag;
+    union hal_stream_data buf[BATCH * num_pins], out[BATCH * stride];
+    unsigned sampleno[BATCH], last_sample = 0;
+    int i, n;
+
+    while ( samples != 0 ) {
+	n = BATCH;
+	if ( samples > 0 && samples < n ) {
+	    n = samples;
+	}
+	hal_stream_wait_readable(stream, &stop);
+	if ( stop ) {
+	    break;
+	}
+	n = hal_stream_read_n(stream, buf, n, sampleno);
+	for ( i = 0 ; i < n ; i++ ) {
+	    if ( sampleno[i] != ++last_sample ) {
+		fprintf(stderr, "overrun\n");
+		last_sample = sampleno[i];
+	    }
+	    if ( tag ) {
+		out[i * stride].u = sampleno[i] - 1;
+	    }
+	    memcpy(&out[i * stride + tag], &buf[i * num_pins],
+		sizeof(union hal_stream_data) * num_pins);
+	}
+	if ( fwrite(out, sizeof(union hal_stream_data) * stride, n, stdout)
+		!= (size_t) n ) {
+	    return 1;
+	}
+	if ( samples > 0 ) {
+	    samples -= n;
+	}
+    }
+    fflush(stdout);
+    return 0;
+}
 
 int main(int argc, char **argv)
 {
-    int n, channel, tag;
+    int n, channel, tag, binary;
     long int samples;
     unsigned this_sample, last_sample=0;
     char *cp, *cp2;
@@ -116,6 +164,7 @@ int main(int argc, char **argv)
     exitval = 1;
     channel = 0;
     tag = 0;
+    binary = 0;
     samples = -1;  /* -1 means run forever */
     /* FIXME - if I wasn't so lazy I'd learn how to use getopt() here */
     for ( n = 1 ; n < argc ; n++ ) {
@@ -147,6 +196,9 @@ int main(int argc, char **argv)
 	case 't':
 	    tag = 1;
 	    break;
+	case 'b':
+	    binary = 1;
+	    break;
 	default:
 	    fprintf(stderr,"ERROR: unknown option '%s'\n", cp );
 	    exit(1);
@@ -189,6 +241,10 @@ int main(int argc, char **argv)
 	goto out;
     }
     int num_pins = hal_stream_element_count(&stream);
+    if ( binary ) {
+	exitval = binary_samples(&stream, samples, tag);
+	goto out;
+    }
     while ( samples != 0 ) {
 	union hal_stream_data buf[num_pins];
 	hal_stream_wait_readable(&stream, &stop);
@@ -51,6 +51,13 @@
     values of the position feedback counters.  Both 'update-freq' and
     'capture-position' use floating point, 'make-pulses' does not.
 
+    With 'schedule=1', 'stepgen.update-freq' also precomputes the
+    reciprocal of each channel's step rate, and 'make-pulses' uses it
+    to work out how many periods are left until the next step.  Until
+    then it only advances the accumulator of a channel that is idle or
+    running at a steady rate, instead of going through the timers, the
+    ramp and the outputs every period.  The output is the same.
+
     Polarity:
 
     All signals from this module have fixed polarity (active high
@@ -319,6 +326,8 @@ RTAPI_MP_ARRAY_STRING(ctrl_type,MAX_CHAN,"control type (pos or vel) for up to 16
 int user_step_type[] = { [0 ... MAX_CYCLE-1] = -1 };
 RTAPI_MP_ARRAY_INT(user_step_type, MAX_CYCLE,
 	"lookup table for user-defined step type");
+int schedule = 0;
+RTAPI_MP_INT(schedule, "skip steady channels until their next step");
 
 /***********************************************************************
 *                STRUCTURES AND GLOBAL VARIABLES                       *
@@ -340,9 +349,11 @@ typedef struct {
     hal_s32_t rawcount;		/* param: position feedback in counts */
     int curr_dir;		/* current direction */
     int state;			/* current position in state table */
+    unsigned int wait;		/* periods left before the next step */
     /* stuff that is read but not written by makepulses */
     hal_bit_t *enable;		/* pin for enable stepgen */
     long target_addval;		/* desired freq generator add value */
+    rtapi_u32 addval_recip;	/* 2^32 / abs(target_addval) */
     long deltalim;		/* max allowed change per period */
     hal_u32_t step_len;		/* parameter: step pulse length */
     hal_u32_t dir_hold_dly;	/* param: direction hold time or delay */
@@ -434,6 +445,7 @@ static int export_stepgen(int num, stepgen_t * addr, int step_type, int pos_mode
 static void make_pulses(void *arg, long period);
 static void update_freq(void *arg, long period);
 static void update_pos(void *arg, long period);
+static unsigned int steps_wait(stepgen_t * stepgen);
 static int setup_user_step_type(void);
 static CONTROL parse_ctrl_type(const char *ctrl);
 
@@ -568,6 +580,16 @@ static void make_pulses(void *arg, long period)
     stepgen = arg;
 
     for (n = 0; n < num_chan; n++) {
+	/* in schedule mode, a channel that is enabled, has no timers
+	   running and is at its target rate only needs the accumulator
+	   advanced until its next step */
+	if ( stepgen->wait && stepgen->addval == stepgen->target_addval
+		&& *(stepgen->enable) ) {
+	    stepgen->accum += stepgen->addval;
+	    stepgen->wait--;
+	    stepgen++;
+	    continue;
+	}
 	/* decrement "timing constraint" timers */
 	if ( stepgen->timer1 > 0 ) {
 	    if ( stepgen->timer1 > periodns ) {
@@ -705,6 +727,13 @@ static void make_pulses(void *arg, long period)
 		outbits >>= 1;
 	    }
 	}
+	/* with all the timers expired, nothing but the next step will
+	   change the outputs */
+	if ( schedule && stepgen->timer3 == 0 && !stepgen->hold_dds ) {
+	    stepgen->wait = steps_wait(stepgen);
+	} else {
+	    stepgen->wait = 0;
+	}
 	/* move on to next step generator */
 	stepgen++;
     }
@@ -752,6 +781,42 @@ static void update_pos(void *arg, long period)
     /* done */
 }
 
+/* helper function - computes the number of periods make_pulses() can run
+   at the current addval before the pickoff bit toggles.  The division is
+   done with the reciprocal from update_freq(), and checked, since that
+   may be for a newer target_addval; 0 means "don't know" */
+static unsigned int steps_wait(stepgen_t * stepgen)
+{
+    unsigned long long q, a;
+    unsigned int left;
+    int tries;
+
+    if ( stepgen->addval == 0 ) {
+	/* no step ever */
+	return ~0u;
+    }
+    /* distance to the next toggle, less one */
+    left = stepgen->accum & ((1L << PICKOFF) - 1);
+    if ( stepgen->addval > 0 ) {
+	left = ((1L << PICKOFF) - 1) - left;
+	a = stepgen->addval;
+    } else {
+	a = -stepgen->addval;
+    }
+    /* the quotient from the reciprocal is low by at most a few counts */
+    q = ((unsigned long long) left * stepgen->addval_recip) >> 32;
+    if ( q * a > left ) {
+	return 0;
+    }
+    for (tries = 0; (q + 1) * a <= left; tries++) {
+	if ( tries == 2 ) {
+	    return 0;
+	}
+	q++;
+    }
+    return q;
+}
+
 /* helper function - computes integeral multiple of increment that is greater
    or equal to value */
 static unsigned long ulceil(unsigned long value, unsigned long increment)
@@ -770,7 +835,7 @@ static void update_freq(void *arg, long period)
     long long int accum_a, accum_b;
     double pos_cmd, vel_cmd, curr_pos, curr_vel, avg_v, max_freq, max_ac;
     double match_ac, match_time, est_out, est_cmd, est_err, dp, dv, new_vel;
-    double desired_freq;
+    double desired_freq, abs_addval;
     /*! \todo FIXME - while this code works just fine, there are a bunch of
        internal variables, many of which hold intermediate results that
        don't really need their own variables.  They are used either for
@@ -869,6 +934,7 @@ static void update_freq(void *arg, long period)
 	    stepgen->freq = 0;
 	    stepgen->addval = 0;
 	    stepgen->target_addval = 0;
+	    stepgen->addval_recip = 0;
 	    /* and skip to next one */
 	    stepgen++;
 	    continue;
@@ -1017,6 +1083,15 @@ static void update_freq(void *arg, long period)
 	stepgen->freq = new_vel;
 	/* calculate new addval */
 	stepgen->target_addval = stepgen->freq * freqscale;
+	if ( schedule ) {
+	    /* precompute the divide make_pulses() needs to schedule steps */
+	    abs_addval = fabs((double) stepgen->target_addval);
+	    if ( abs_addval < 1.5 ) {
+		stepgen->addval_recip = abs_addval ? 0xFFFFFFFF : 0;
+	    } else {
+		stepgen->addval_recip = 4294967296.0 / abs_addval;
+	    }
+	}
 	/* calculate new deltalim */
 	stepgen->deltalim = max_ac * accelscale;
 	/* move on to next channel */
@@ -1183,6 +1258,8 @@ static int export_stepgen(int num, stepgen_t * addr, int step_type, int pos_mode
     addr->state = 0;
     *(addr->enable) = 0;
     addr->target_addval = 0;
+    addr->addval_recip = 0;
+    addr->wait = 0;
     addr->deltalim = 0;
     /* other init */
     addr->printed_error = 0;
@@ -12,10 +12,12 @@
 
 #define MAX_STREAMERS		8
 #define MAX_SAMPLERS		8
+#define MAX_RECORDERS		8
 #define MAX_PINS 		20
 #define MAX_SHMEM 		128000
 #define STREAMER_SHMEM_KEY 	0x48535430
 #define SAMPLER_SHMEM_KEY	0x48534130
+#define RECORDER_SHMEM_KEY	0x48524330
 
 /* this struct lives in HAL shared memory */
 
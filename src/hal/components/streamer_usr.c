@@ -20,10 +20,11 @@
 
     Invoking:
 
-    halstreamer [chan_num]
+    halstreamer [-c chan_num] [-b]
 
     'chan_num', if present, specifies the streamer channel to use.
-    The default is channel zero.  Since hal_stream takes its data
+    The default is channel zero.  '-b' reads binary records, as
+    written by 'halsampler -b', instead of lines of text.  Since hal_stream takes its data
     from stdin, it will almost always either need to have stdin 
     redirected from a file, or have data piped into it from some
     other program.
@@ -98,10 +99,42 @@ static void quit(int sig)
 }
 
 #define BUF_SIZE 4000
+#define BATCH 256
+
+/* Copies binary records from stdin to the FIFO, a batch at a time.
+   Each record is the hal_stream_data of every pin, in the order of
+   the config string, as written by 'halsampler -b'. */
+static void binary_stream(hal_stream_t *stream)
+{
+    int num_pins = hal_stream_element_count(stream);
+    union hal_stream_data buf[BATCH * num_pins];
+    size_t n, have = 0;
+    int records, done;
+
+    while ( (n = fread(buf + have, sizeof(union hal_stream_data),
+		BATCH * num_pins - have, stdin)) > 0 ) {
+	have += n;
+	records = have / num_pins;
+	for ( done = 0 ; done < records ; ) {
+	    hal_stream_wait_writable(stream, &stop);
+	    if ( stop ) {
+		return;
+	    }
+	    done += hal_stream_write_n(stream, buf + done * num_pins,
+		records - done);
+	}
+	have -= records * num_pins;
+	memmove(buf, buf + records * num_pins,
+	    sizeof(union hal_stream_data) * have);
+    }
+    if ( have ) {
+	fprintf(stderr, "partial record at end of input, ignored\n");
+    }
+}
 
 int main(int argc, char **argv)
 {
-    int n, channel, line=0;
+    int n, channel, line=0, binary=0;
     char *cp, *cp2;
     hal_stream_t stream;
     char buf[BUF_SIZE];
@@ -126,6 +159,9 @@ int main(int argc, char **argv)
 		exit(1);
 	    }
 	    break;
+	case 'b':
+	    binary = 1;
+	    break;
 	default:
 	    fprintf(stderr,"ERROR: unknown option '%s'\n", cp );
 	    exit(1);
@@ -169,6 +205,11 @@ int main(int argc, char **argv)
 	goto out;
     }
     int num_pins = hal_stream_element_count(&stream);
+    if ( binary ) {
+	binary_stream(&stream);
+	exitval = 0;
+	goto out;
+    }
     while ( fgets(buf, BUF_SIZE, stdin) ) {
 	/* skip comment lines */
 	if ( buf[0] == '#' ) {
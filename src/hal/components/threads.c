@@ -16,7 +16,8 @@
     It will mostly be used for testing - when EMC is run normally,
     the motion module creates all the neccessary threads.
     
-    The module has three pairs of parameters, "name1, period1", etc.
+    The module has three sets of parameters, "name1, period1, fp1, cpu1",
+    etc.
 */
 
 /** Copyright (C) 2003 John Kasunich
@@ -63,18 +64,30 @@ static int fp1 = 1;		/* use floating point? default = yes */
 RTAPI_MP_INT(fp1, "thread1 uses floating point");
 static long period1 = 1000000;	/* thread period - default = 1ms thread */
 RTAPI_MP_LONG(period1,  "thread1 period (nsecs)");
+static int cpu1 = -1;		/* cpu to run on - default = automatic */
+RTAPI_MP_INT(cpu1, "thread1 cpu, or -1 for the default");
+static char *workers1 = NULL;	/* cpus of worker tasks */
+RTAPI_MP_STRING(workers1, "cpus of the workers of thread1, as 2,3");
 static char *name2 = NULL;	/* name of thread */
 RTAPI_MP_STRING(name2, "name of thread 2");
 static int fp2 = 1;		/* use floating point? default = yes */
 RTAPI_MP_INT(fp2, "thread2 uses floating point");
 static long period2 = 0;	/* thread period - default = no thread */
 RTAPI_MP_LONG(period2, "thread2 period (nsecs)");
+static int cpu2 = -1;		/* cpu to run on - default = automatic */
+RTAPI_MP_INT(cpu2, "thread2 cpu, or -1 for the default");
+static char *workers2 = NULL;	/* cpus of worker tasks */
+RTAPI_MP_STRING(workers2, "cpus of the workers of thread2, as 2,3");
 static char *name3 = NULL;	/* name of thread */
 RTAPI_MP_STRING(name3, "name of thread 3");
 static int fp3 = 1;		/* use floating point? default = yes */
 RTAPI_MP_INT(fp3, "thread1 uses floating point");
 static long period3 = 0;	/* thread period - default = no thread */
 RTAPI_MP_LONG(period3, "thread3 period (nsecs)");
+static int cpu3 = -1;		/* cpu to run on - default = automatic */
+RTAPI_MP_INT(cpu3, "thread3 cpu, or -1 for the default");
+static char *workers3 = NULL;	/* cpus of worker tasks */
+RTAPI_MP_STRING(workers3, "cpus of the workers of thread3, as 2,3");
 
 /***********************************************************************
 *                STRUCTURES AND GLOBAL VARIABLES                       *
@@ -87,6 +100,7 @@ static int comp_id;		/* component ID */
 *                  LOCAL FUNCTION DECLARATIONS                         *
 ************************************************************************/
 
+static int add_workers(const char *name, const char *cpus);
 
 /***********************************************************************
 *                       INIT AND EXIT CODE                             *
@@ -106,7 +120,7 @@ int rtapi_app_main(void)
     /* was 'period' specified in the insmod command? */
     if ((period1 > 0) && (name1 != NULL) && (*name1 != '\0')) {
 	/* create a thread */
-	retval = hal_create_thread(name1, period1, fp1);
+	retval = hal_create_thread_cpu(name1, period1, fp1, cpu1);
 	if (retval < 0) {
 	    rtapi_print_msg(RTAPI_MSG_ERR,
 		"THREADS: ERROR: could not create thread '%s'\n", name1);
@@ -115,10 +129,14 @@ int rtapi_app_main(void)
 	} else {
 	    rtapi_print_msg(RTAPI_MSG_INFO, "THREADS: created %ld uS thread\n", period1 / 1000);
 	}
+	if (add_workers(name1, workers1) < 0) {
+	    hal_exit(comp_id);
+	    return -1;
+	}
     }
     if ((period2 > 0) && (name2 != NULL) && (*name2 != '\0')) {
 	/* create a thread */
-	retval = hal_create_thread(name2, period2, fp2);
+	retval = hal_create_thread_cpu(name2, period2, fp2, cpu2);
 	if (retval < 0) {
 	    rtapi_print_msg(RTAPI_MSG_ERR,
 		"THREADS: ERROR: could not create thread '%s'\n", name2);
@@ -127,10 +145,14 @@ int rtapi_app_main(void)
 	} else {
 	    rtapi_print_msg(RTAPI_MSG_INFO, "THREADS: created %ld uS thread\n", period2 / 1000);
 	}
+	if (add_workers(name2, workers2) < 0) {
+	    hal_exit(comp_id);
+	    return -1;
+	}
     }
     if ((period3 > 0) && (name3 != NULL) && (*name3 != '\0')) {
 	/* create a thread */
-	retval = hal_create_thread(name3, period3, fp3);
+	retval = hal_create_thread_cpu(name3, period3, fp3, cpu3);
 	if (retval < 0) {
 	    rtapi_print_msg(RTAPI_MSG_ERR,
 		"THREADS: ERROR: could not create thread '%s'\n", name3);
@@ -139,11 +161,38 @@ int rtapi_app_main(void)
 	} else {
 	    rtapi_print_msg(RTAPI_MSG_INFO, "THREADS: created %ld uS thread\n", period3 / 1000);
 	}
+	if (add_workers(name3, workers3) < 0) {
+	    hal_exit(comp_id);
+	    return -1;
+	}
     }
     hal_ready(comp_id);
     return 0;
 }
 
+/* starts a worker of thread 'name' on each cpu in the list 'cpus' */
+static int add_workers(const char *name, const char *cpus)
+{
+    char *end;
+    long cpu;
+
+    while (cpus != NULL && *cpus != '\0') {
+	cpu = simple_strtol(cpus, &end, 10);
+	if (end == cpus || (*end != ',' && *end != '\0')) {
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+		"THREADS: ERROR: bad worker cpus '%s'\n", cpus);
+	    return -1;
+	}
+	if (hal_thread_add_worker(name, cpu) < 0) {
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+		"THREADS: ERROR: could not add worker to '%s'\n", name);
+	    return -1;
+	}
+	cpus = *end ? end + 1 : end;
+    }
+    return 0;
+}
+
 void rtapi_app_exit(void)
 {
     hal_exit(comp_id);
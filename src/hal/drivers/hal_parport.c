@@ -147,6 +147,9 @@ typedef struct {
     unsigned char outdata_ctrl;
     unsigned char reset_mask_ctrl;  /* reset flag for pin 1, 14, 16, 17 */
     unsigned char reset_val_ctrl;   /* reset values for pin 1, 14, 16, 17 */
+    unsigned char hw_data;          /* last byte written to data port */
+    unsigned char hw_ctrl;          /* last byte written to control port */
+    unsigned char hw_valid;         /* HW_DATA_VALID, HW_CTRL_VALID */
     struct hal_parport_t portdata;
 } parport_t;
 
@@ -157,6 +160,11 @@ static parport_t *port_data_array;
 static int comp_id;		/* component ID */
 static int num_ports;		/* number of ports configured */
 
+/* set in hw_valid once the port has been written, so that the first
+   write always reaches the hardware */
+#define HW_DATA_VALID 0x01
+#define HW_CTRL_VALID 0x02
+
 static unsigned long ns2tsc_factor;
 #define ns2tsc(x) (((x) * (unsigned long long)ns2tsc_factor) >> 12)
 
@@ -171,6 +179,7 @@ static unsigned long ns2tsc_factor;
 static void read_port(void *arg, long period);
 static void reset_port(void *arg, long period);
 static void write_port(void *arg, long period);
+static void write_reset_port(void *arg, long period);
 static void read_all(void *arg, long period);
 static void write_all(void *arg, long period);
 
@@ -287,6 +296,17 @@ rtapi_print ( "config string '%s'\n", cfg );
 	    hal_exit(comp_id);
 	    return -1;
 	}
+	/* make write-reset function name */
+	rtapi_snprintf(name, sizeof(name), "parport.%d.write-reset", n);
+	/* export write-reset function */
+	retval = hal_export_funct(name, write_reset_port,
+	    &(port_data_array[n]), 0, 0, comp_id);
+	if (retval != 0) {
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+		"PARPORT: ERROR: port %d write-reset funct export failed\n", n);
+	    hal_exit(comp_id);
+	    return -1;
+	}
     }
     /* export functions that read and write all ports */
     retval = hal_export_funct("parport.read-all", read_all,
@@ -324,6 +344,33 @@ void rtapi_app_exit(void)
 *                  REALTIME PORT READ AND WRITE FUNCTIONS              *
 ************************************************************************/
 
+/* Each port access is a slow bus cycle (about a microsecond on PCI and
+   PCIe cards), so the output registers are only written when the byte
+   differs from what the port already holds.  write_time and
+   write_time_ctrl keep the time of the last real write, which is when
+   the pins last changed. */
+static inline void write_data(parport_t *port, unsigned char outdata)
+{
+    if ((port->hw_valid & HW_DATA_VALID) && outdata == port->hw_data) {
+	return;
+    }
+    rtapi_outb(outdata, port->base_addr);
+    port->write_time = rtapi_get_clocks();
+    port->hw_data = outdata;
+    port->hw_valid |= HW_DATA_VALID;
+}
+
+static inline void write_ctrl(parport_t *port, unsigned char outdata)
+{
+    if ((port->hw_valid & HW_CTRL_VALID) && outdata == port->hw_ctrl) {
+	return;
+    }
+    rtapi_outb(outdata, port->base_addr + 2);
+    port->write_time_ctrl = rtapi_get_clocks();
+    port->hw_ctrl = outdata;
+    port->hw_valid |= HW_CTRL_VALID;
+}
+
 static void read_port(void *arg, long period)
 {
     parport_t *port;
@@ -378,7 +425,7 @@ static void reset_port(void *arg, long period) {
     if(outdata != port->outdata) {
         deadline = port->write_time + reset_time_tsc;
         while(rtapi_get_clocks() < deadline) {}
-        rtapi_outb(outdata, port->base_addr);
+        write_data(port, outdata);
     }
 
     outdata = (port->outdata_ctrl&~port->reset_mask_ctrl)^port->reset_val_ctrl;
@@ -388,7 +435,7 @@ static void reset_port(void *arg, long period) {
 	outdata ^= 0x0B;
         deadline = port->write_time_ctrl + reset_time_tsc;
         while(rtapi_get_clocks() < deadline) {}
-        rtapi_outb(outdata, port->base_addr + 2);
+        write_ctrl(port, outdata);
     }
 }
 
@@ -421,8 +468,7 @@ static void write_port(void *arg, long period)
 	    mask <<= 1;
 	}
 	/* write it to the hardware */
-	rtapi_outb(outdata, port->base_addr);
-	port->write_time = rtapi_get_clocks();
+	write_data(port, outdata);
 	port->reset_val = reset_val;
 	port->reset_mask = reset_mask;
 	port->outdata = outdata;
@@ -461,8 +507,15 @@ static void write_port(void *arg, long period)
     /* correct for hardware inverters on pins 1, 14, & 17 */
     outdata ^= 0x0B;
     /* write it to the hardware */
-    rtapi_outb(outdata, port->base_addr + 2);
-    port->write_time_ctrl = rtapi_get_clocks();
+    write_ctrl(port, outdata);
+}
+
+/* write and reset in one funct, for DoubleStep when nothing else needs
+   to run between the two */
+static void write_reset_port(void *arg, long period)
+{
+    write_port(arg, period);
+    reset_port(arg, period);
 }
 
 void read_all(void *arg, long period)
@@ -704,6 +757,7 @@ static int export_port(int portnum, parport_t * port)
 			"parport.%d.debug2", portnum);
 	port->write_time = 0;
     }
+    port->hw_valid = 0;
     if(port->use_control_in == 0) {
 	/* declare output variables (control port) */
 	retval += export_output_pin(portnum, 1,
@@ -92,6 +92,8 @@ int hm2_dpll_parse_md(hostmot2_t *hm2, int md_index) {
             hm2->llio->comp_id, "%s.dpll.ddsize", hm2->llio->name);
     r += hal_pin_u32_newf(HAL_OUT, &(hm2->dpll.pins->prescale),
             hm2->llio->comp_id, "%s.dpll.prescale", hm2->llio->name);
+    r += hal_pin_s32_newf(HAL_IN, &(hm2->dpll.pins->sample_timer),
+            hm2->llio->comp_id, "%s.dpll.sample-timer", hm2->llio->name);
     if (r < 0) {
         HM2_ERR("error adding hm2_dpll timer pins, Aborting\n");
         goto fail0;
@@ -101,6 +103,7 @@ int hm2_dpll_parse_md(hostmot2_t *hm2, int md_index) {
     *hm2->dpll.pins->time3_us = 100.0;
     *hm2->dpll.pins->time4_us = 100.0;
     *hm2->dpll.pins->prescale = 1;
+    *hm2->dpll.pins->sample_timer = -1;
     *hm2->dpll.pins->base_freq = -1; // An indication it needs init
     /* This value is an empirical compromise between insensitivity to
      * single-cycle variations (larger values) and being resilient to changes to
@@ -131,6 +134,15 @@ int hm2_dpll_parse_md(hostmot2_t *hm2, int md_index) {
 
 }
 
+// The timer a module with timer-number "timer_num" samples on: modules
+// left at -1 follow dpll.sample-timer, so all of them can be latched by
+// the same timer with one pin
+int hm2_dpll_get_timer_num(hostmot2_t *hm2, int timer_num){
+    if (timer_num != -1) return timer_num;
+    if (hm2->dpll.num_instances == 0 || hm2->dpll.pins == NULL) return -1;
+    return *hm2->dpll.pins->sample_timer;
+}
+
 void hm2_dpll_process_tram_read(hostmot2_t *hm2, long period){
     hm2_dpll_pins_t *pins;
     
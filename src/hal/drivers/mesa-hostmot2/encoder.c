@@ -205,7 +205,8 @@ void hm2_encoder_write(hostmot2_t *hm2) {
     }
 
     if(hm2->encoder.dpll_timer_num_addr) {
-        int32_t dpll_timer_num = *hm2->encoder.hal->pin.dpll_timer_num;
+        int32_t dpll_timer_num = hm2_dpll_get_timer_num(hm2,
+                *hm2->encoder.hal->pin.dpll_timer_num);
         if(dpll_timer_num < -1 || dpll_timer_num > 4) dpll_timer_num = -1;
         if(dpll_timer_num == -1)
             hm2->encoder.desired_dpll_timer_reg = 0;
@@ -20,9 +20,16 @@
 #include <sys/fcntl.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <poll.h>
 #include <linux/sockios.h>
+#include <linux/if_packet.h>
+#include <linux/if_ether.h>
+#include <net/if.h>
 #include <net/if_arp.h>
 #include <netinet/in.h>
+#include <netinet/ip.h>
+#include <netinet/udp.h>
 #include <arpa/inet.h>
 #include <errno.h>
 #include <ifaddrs.h>
@@ -91,6 +98,12 @@ RTAPI_MP_ARRAY_STRING(board_ip, MAX_ETH_BOARDS, "ip address of ethernet board(s)
 static char *config[MAX_ETH_BOARDS];
 RTAPI_MP_ARRAY_STRING(config, MAX_ETH_BOARDS, "config string for the AnyIO boards (see hostmot2(9) manpage)")
 
+static int irq_cpu = -1;
+RTAPI_MP_INT(irq_cpu, "cpu for the interrupts of the network interface(s), or -1 to leave them");
+
+static int raw_socket = 0;
+RTAPI_MP_INT(raw_socket, "send and receive through a packet socket instead of the kernel UDP stack");
+
 int debug = 0;
 RTAPI_MP_INT(debug, "Developer/debug use only!  Enable debug logging.");
 
@@ -109,6 +122,7 @@ static hm2_eth_t boards[MAX_ETH_BOARDS];
 
 /// ethernet io functions
 
+static int init_raw_socket(hm2_eth_t *board);
 static int eth_socket_send(int sockfd, const void *buffer, int len, int flags);
 static int eth_socket_recv(int sockfd, void *buffer, int len, int flags);
 
@@ -284,6 +298,39 @@ static int install_iptables_perinterface(const char *ifbuf) {
     return 0;
 }
 
+/* Send the interrupts of the interface to irq_cpu.  The last field of
+   a line of /proc/interrupts is the name of its handler, the interface
+   name or the interface name followed by the queue, as "eth0-rx-0". */
+static int set_irq_affinity(const char *ifbuf) {
+    FILE *f = fopen("/proc/interrupts", "r");
+    if(!f) {
+        LL_PRINT("ERROR: can't open /proc/interrupts: %s\n", strerror(errno));
+        return -errno;
+    }
+    char line[1024];
+    size_t len = strlen(ifbuf);
+    int found = 0, res = 0;
+    while(fgets(line, sizeof(line), f)) {
+        int irq;
+        if(sscanf(line, " %d:", &irq) != 1) continue;
+        char *end = line + strlen(line);
+        while(end > line && isspace((unsigned char)end[-1])) end--;
+        *end = 0;
+        char *name = end;
+        while(name > line && !isspace((unsigned char)name[-1])) name--;
+        if(strncmp(name, ifbuf, len) != 0) continue;
+        if(name[len] != 0 && name[len] != '-') continue;
+        found = 1;
+        res = eshellf("echo %d > /proc/irq/%d/smp_affinity_list", irq_cpu, irq);
+        if(res < 0) break;
+        LL_PRINT("%s: irq %d on cpu %d\n", ifbuf, irq, irq_cpu);
+    }
+    fclose(f);
+    if(!found)
+        LL_PRINT("WARNING: no interrupts found for %s\n", ifbuf);
+    return res;
+}
+
 static int fetch_hwaddr(const char *board_ip, int sockfd, unsigned char buf[6]) {
     lbp16_cmd_addr packet;
     unsigned char response[6];
@@ -389,12 +436,159 @@ static int init_board(hm2_eth_t *board, const char *board_ip) {
         if(ret < 0) return ret;
     }
 
+    if(raw_socket) {
+        ret = init_raw_socket(board);
+        if(ret < 0) return ret;
+    }
+
     board->write_packet_ptr = board->write_packet;
     board->read_packet_ptr = board->read_packet;
 
     return 0;
 }
 
+// the UDP/IP framing of raw_socket=1
+#define RAW_HEADER_SIZE (sizeof(struct iphdr) + sizeof(struct udphdr))
+#define RAW_MAX_PACKET 1500
+
+static int open_raw_socket(void *arg) {
+    hm2_eth_t *board = (hm2_eth_t *)arg;
+    board->rawfd = socket(AF_PACKET, SOCK_DGRAM, htons(ETH_P_IP));
+    return board->rawfd;
+}
+
+// switches the board to the packet socket, once the UDP socket has found
+// its interface, local port and hardware address
+static int init_raw_socket(hm2_eth_t *board) {
+    char ifbuf[64];
+    struct timeval timeout;
+    socklen_t addrlen = sizeof(board->raw_local_addr);
+    int ifindex, one = 1;
+
+    if(!fetch_ifname(board->sockfd, ifbuf, sizeof(ifbuf))
+            || !(ifindex = if_nametoindex(ifbuf))) {
+        LL_PRINT("ERROR: raw_socket: can't find the interface of the board\n");
+        return -ENODEV;
+    }
+    if(getsockname(board->sockfd, (struct sockaddr *)&board->raw_local_addr, &addrlen) < 0) {
+        LL_PRINT("ERROR: raw_socket: getsockname: %s\n", strerror(errno));
+        return -errno;
+    }
+
+    if(rtapi_do_as_root(open_raw_socket, board) < 0) {
+        LL_PRINT("ERROR: raw_socket: can't open packet socket: %s\n", strerror(errno));
+        return -errno;
+    }
+
+    memset(&board->raw_addr, 0, sizeof(board->raw_addr));
+    board->raw_addr.sll_family = AF_PACKET;
+    board->raw_addr.sll_protocol = htons(ETH_P_IP);
+    board->raw_addr.sll_ifindex = ifindex;
+    if(bind(board->rawfd, (struct sockaddr *)&board->raw_addr, sizeof(board->raw_addr)) < 0) {
+        LL_PRINT("ERROR: raw_socket: can't bind to %s: %s\n", ifbuf, strerror(errno));
+        close(board->rawfd);
+        return -errno;
+    }
+    board->raw_addr.sll_halen = ETH_ALEN;
+    memcpy(board->raw_addr.sll_addr, board->req.arp_ha.sa_data, ETH_ALEN);
+
+    // the queueing discipline is of no use on a dedicated interface
+    setsockopt(board->rawfd, SOL_PACKET, PACKET_QDISC_BYPASS, &one, sizeof(one));
+
+    timeout.tv_sec = 0;
+    timeout.tv_usec = RECV_TIMEOUT_US;
+    setsockopt(board->rawfd, SOL_SOCKET, SO_RCVTIMEO, (char *)&timeout, sizeof(timeout));
+    timeout.tv_usec = SEND_TIMEOUT_US;
+    setsockopt(board->rawfd, SOL_SOCKET, SO_SNDTIMEO, (char *)&timeout, sizeof(timeout));
+
+    board->raw_active = true;
+    LL_PRINT("%s: using packet socket on %s\n", inet_ntoa(board->server_addr.sin_addr), ifbuf);
+    return 0;
+}
+
+static hm2_eth_t *raw_board(int sockfd) {
+    int i;
+    for(i = 0; i < MAX_ETH_BOARDS; i++) {
+        if(boards[i].raw_active && boards[i].sockfd == sockfd) return &boards[i];
+    }
+    return NULL;
+}
+
+static uint16_t ip_checksum(const void *data, int len) {
+    const uint16_t *p = data;
+    uint32_t sum = 0;
+    for(; len > 1; len -= 2) sum += *p++;
+    if(len) sum += *(const uint8_t *)p;
+    while(sum >> 16) sum = (sum & 0xffff) + (sum >> 16);
+    return ~sum;
+}
+
+static int raw_sendv(hm2_eth_t *board, const void *buf1, int len1,
+        const void *buf2, int len2, int flags) {
+    rtapi_u8 packet[RAW_MAX_PACKET];
+    struct iphdr *ip = (struct iphdr *)packet;
+    struct udphdr *udp = (struct udphdr *)(packet + sizeof(struct iphdr));
+    int len = len1 + len2;
+    int res;
+
+    if(len + RAW_HEADER_SIZE > sizeof(packet)) {
+        errno = EMSGSIZE;
+        return -1;
+    }
+    memcpy(packet + RAW_HEADER_SIZE, buf1, len1);
+    if(len2) memcpy(packet + RAW_HEADER_SIZE + len1, buf2, len2);
+
+    ip->version = 4;
+    ip->ihl = sizeof(struct iphdr) / 4;
+    ip->tos = 0;
+    ip->tot_len = htons(RAW_HEADER_SIZE + len);
+    ip->id = htons(board->raw_ip_id++);
+    ip->frag_off = htons(IP_DF);
+    ip->ttl = 64;
+    ip->protocol = IPPROTO_UDP;
+    ip->check = 0;
+    ip->saddr = board->raw_local_addr.sin_addr.s_addr;
+    ip->daddr = board->server_addr.sin_addr.s_addr;
+    ip->check = ip_checksum(ip, sizeof(struct iphdr));
+
+    udp->source = board->raw_local_addr.sin_port;
+    udp->dest = board->server_addr.sin_port;
+    udp->len = htons(sizeof(struct udphdr) + len);
+    udp->check = 0; // optional over IPv4
+
+    res = sendto(board->rawfd, packet, RAW_HEADER_SIZE + len, flags,
+            (struct sockaddr *)&board->raw_addr, sizeof(board->raw_addr));
+    if(res < 0) return res;
+    return res - RAW_HEADER_SIZE;
+}
+
+// receives the next UDP packet from the board, skipping anything else seen
+// on the interface
+static int raw_recv(hm2_eth_t *board, void *buffer, int len, int flags) {
+    rtapi_u8 packet[RAW_MAX_PACKET];
+
+    while(1) {
+        int res = recv(board->rawfd, packet, sizeof(packet), flags);
+        if(res < 0) return res;
+
+        struct iphdr *ip = (struct iphdr *)packet;
+        if(res < RAW_HEADER_SIZE || ip->protocol != IPPROTO_UDP
+                || ip->saddr != board->server_addr.sin_addr.s_addr) continue;
+        int ihl = ip->ihl * 4;
+        struct udphdr *udp = (struct udphdr *)(packet + ihl);
+        if(res < ihl + (int)sizeof(struct udphdr)
+                || udp->source != board->server_addr.sin_port
+                || udp->dest != board->raw_local_addr.sin_port) continue;
+
+        int size = ntohs(udp->len) - sizeof(struct udphdr);
+        if(size > res - ihl - (int)sizeof(struct udphdr))
+            size = res - ihl - sizeof(struct udphdr);
+        if(size > len) size = len;
+        memcpy(buffer, packet + ihl + sizeof(struct udphdr), size);
+        return size;
+    }
+}
+
 static int close_board(hm2_eth_t *board) {
     if(use_iptables()) clear_iptables();
 
@@ -402,6 +596,10 @@ static int close_board(hm2_eth_t *board) {
         int ret = rtapi_do_as_root(ioctl_siocdarp, board);
         if(ret < 0) perror("ioctl SIOCDARP");
     }
+    if(board->raw_active) {
+        board->raw_active = false;
+        close(board->rawfd);
+    }
     int ret = shutdown(board->sockfd, SHUT_RDWR);
     if (ret < 0)
         LL_PRINT("ERROR: can't close socket: %s\n", strerror(errno));
@@ -410,13 +608,44 @@ static int close_board(hm2_eth_t *board) {
 }
 
 static int eth_socket_send(int sockfd, const void *buffer, int len, int flags) {
+    hm2_eth_t *board = raw_board(sockfd);
+    if(board) return raw_sendv(board, buffer, len, NULL, 0, flags);
     return send(sockfd, buffer, len, flags);
 }
 
 static int eth_socket_recv(int sockfd, void *buffer, int len, int flags) {
+    hm2_eth_t *board = raw_board(sockfd);
+    if(board) return raw_recv(board, buffer, len, flags);
     return recv(sockfd, buffer, len, flags);
 }
 
+// send two buffers back to back as a single datagram
+static int eth_socket_sendv(int sockfd, const void *buf1, int len1,
+        const void *buf2, int len2, int flags) {
+    hm2_eth_t *board = raw_board(sockfd);
+    if(board) return raw_sendv(board, buf1, len1, buf2, len2, flags);
+    struct iovec iov[2] = {
+        { .iov_base = (void*)buf1, .iov_len = len1 },
+        { .iov_base = (void*)buf2, .iov_len = len2 },
+    };
+    struct msghdr msg = { .msg_iov = iov, .msg_iovlen = 2 };
+    return sendmsg(sockfd, &msg, flags);
+}
+
+// sleep until the socket is readable or the deadline (in rtapi_get_time
+// nanoseconds) passes, whichever comes first
+static void eth_socket_wait(int sockfd, unsigned long long deadline) {
+    long long remaining = deadline - rtapi_get_time();
+    if(remaining <= 0) return;
+    hm2_eth_t *board = raw_board(sockfd);
+    struct pollfd pfd = { .fd = board ? board->rawfd : sockfd, .events = POLLIN };
+    struct timespec ts = {
+        .tv_sec = remaining / 1000000000,
+        .tv_nsec = remaining % 1000000000
+    };
+    ppoll(&pfd, 1, &ts, NULL);
+}
+
 static int eth_socket_recv_loop(int sockfd, void *buffer, int len, int flags, long timeout) {
     long long end = rtapi_get_clocks() + timeout;
     int result;
@@ -476,6 +705,18 @@ static int hm2_eth_read(hm2_lowlevel_io_t *this, rtapi_u32 addr, void *buffer, i
     return 1;  // success
 }
 
+static int hm2_eth_flush_pending_writes(hm2_eth_t *board) {
+    int send = eth_socket_send(board->sockfd, (void*) &board->write_packet, board->write_packet_size, 0);
+    board->write_packet_ptr = board->write_packet;
+    board->write_packet_size = 0;
+    board->write_pending = false;
+    if(send < 0) {
+        LL_PRINT("ERROR: sending packet: %s\n", strerror(errno));
+        return 0;
+    }
+    return 1;
+}
+
 static int hm2_eth_send_queued_reads(hm2_lowlevel_io_t *this) {
     hm2_eth_t *board = this->private;
     int send;
@@ -504,7 +745,25 @@ static int hm2_eth_send_queued_reads(hm2_lowlevel_io_t *this) {
     board->queue_reads_count++;
     board->queue_buff_size += 8;
 
-    send = eth_socket_send(board->sockfd, (void*) &board->read_packet, board->read_packet_ptr - board->read_packet, 0);
+    int read_size = board->read_packet_ptr - board->read_packet;
+    if(board->write_pending
+            && board->write_packet_size + read_size > (int)sizeof(board->read_packet)) {
+        // too big to share one datagram; send the writes on their own
+        if(!hm2_eth_flush_pending_writes(board)) return 0;
+    }
+
+    if(board->write_pending) {
+        // the writes from the last cycle go first so that the readback of
+        // the write count at 0x14 confirms them in the same round trip
+        send = eth_socket_sendv(board->sockfd,
+                board->write_packet, board->write_packet_size,
+                board->read_packet, read_size, 0);
+        board->write_packet_ptr = board->write_packet;
+        board->write_packet_size = 0;
+        board->write_pending = false;
+    } else {
+        send = eth_socket_send(board->sockfd, (void*) &board->read_packet, read_size, 0);
+    }
     if(send < 0) {
         LL_PRINT("ERROR: sending packet: %s\n", strerror(errno));
         return 0;
@@ -539,6 +798,58 @@ static void decrement_soft_error(hm2_eth_t *board) {
     *board->hal->packet_error_exceeded = 0;
 }
 
+// clear the latency histogram when the user asks for it
+static void latency_check_reset(hm2_eth_t *board) {
+    int i;
+    if(!board->hal->latency_reset) return;
+    for(i = 0; i < HM2_ETH_LATENCY_BUCKETS; i++)
+        *board->hal->latency_hist[i] = 0;
+    *board->hal->latency_max = 0;
+    *board->hal->latency_samples = 0;
+    *board->hal->latency_timeouts = 0;
+    board->hal->latency_reset = 0;
+}
+
+static void latency_record(hm2_eth_t *board, long long rtt) {
+    long long width = board->hal->latency_bucket_width;
+    if(width < 1000) width = 1000;
+    long long bucket = rtt / width;
+    if(bucket < 0) bucket = 0;
+    if(bucket >= HM2_ETH_LATENCY_BUCKETS) bucket = HM2_ETH_LATENCY_BUCKETS - 1;
+    (*board->hal->latency_hist[bucket])++;
+    (*board->hal->latency_samples)++;
+    if(rtt > 0x7fffffff) rtt = 0x7fffffff;
+    *board->hal->latency = rtt;
+    if(rtt > *board->hal->latency_max) *board->hal->latency_max = rtt;
+}
+
+// Size the read timeout from the measured round trip distribution: twice
+// the upper edge of the bucket holding the 99.9th percentile, but never
+// more than the configured timeout.  Until enough samples have been
+// collected, or right after a timeout, the configured value is used.
+static long latency_adaptive_timeout(hm2_eth_t *board, long limit) {
+    rtapi_u32 total = *board->hal->latency_samples;
+    long long width = board->hal->latency_bucket_width;
+    rtapi_u32 seen = 0, want;
+    int i;
+
+    if(!board->hal->read_timeout_adaptive) return limit;
+    if(total < HM2_ETH_LATENCY_MIN_SAMPLES || board->latency_backoff) {
+        if(board->latency_backoff) board->latency_backoff--;
+        return limit;
+    }
+    if(width < 1000) width = 1000;
+    want = total - total / 1000;
+    for(i = 0; i < HM2_ETH_LATENCY_BUCKETS - 1; i++) {
+        seen += *board->hal->latency_hist[i];
+        if(seen >= want) break;
+    }
+    // the overflow bucket is open ended, so nothing better than the limit
+    if(i == HM2_ETH_LATENCY_BUCKETS - 1) return limit;
+    long long timeout = 2 * (i + 1) * width;
+    return timeout < limit ? timeout : limit;
+}
+
 static int hm2_eth_receive_queued_reads(hm2_lowlevel_io_t *this) {
     hm2_eth_t *board = this->private;
     int recv, i = 0;
@@ -559,16 +870,21 @@ static int hm2_eth_receive_queued_reads(hm2_lowlevel_io_t *this) {
         read_timeout = 80;
     if(read_timeout < 100)
         read_timeout = rtapi_div_s64(read_timeout * (unsigned long long)board->llio.period, 100);
+    if(board->hal) {
+        latency_check_reset(board);
+        read_timeout = latency_adaptive_timeout(board, read_timeout);
+    }
     if(read_timeout < 100000)
         read_timeout = 100000;
- 
+    if(board->hal) *board->hal->read_timeout_used = read_timeout;
+
     if(!board->hal) this->read_time = t1;
     unsigned long long read_deadline = this->read_time + read_timeout;
     do {
 do_recv_packet:
         errno = 0;
         recv = eth_socket_recv(board->sockfd, (void*) &tmp_buffer, board->queue_buff_size, MSG_DONTWAIT);
-        if(recv < 0) rtapi_delay(READ_PCK_DELAY_NS);
+        if(recv < 0) eth_socket_wait(board->sockfd, read_deadline);
         t2 = rtapi_get_time();
         i++;
     } while (recv != board->queue_buff_size && t2 < read_deadline);
@@ -576,6 +892,12 @@ do_recv_packet:
         board->read_packet_ptr = board->read_packet;
         board->queue_reads_count = 0;
         board->queue_buff_size = 0;
+        if(board->hal) {
+            (*board->hal->latency_timeouts)++;
+            // fall back to the configured timeout for a while in case the
+            // adaptive one was too tight
+            board->latency_backoff = HM2_ETH_LATENCY_MIN_SAMPLES;
+        }
         if(!record_soft_error(board)) return 0;
         return -EAGAIN;
     }
@@ -589,6 +911,9 @@ do_recv_packet:
     if(board->confirm_read_cnt != board->read_cnt && t2 < read_deadline)
         goto do_recv_packet;
 
+    if(board->hal && board->confirm_read_cnt == board->read_cnt)
+        latency_record(board, t2 - this->read_time);
+
     board->read_packet_ptr = board->read_packet;
     board->queue_reads_count = 0;
     board->queue_buff_size = 0;
@@ -608,7 +933,13 @@ static int hm2_eth_enqueue_read(hm2_lowlevel_io_t *this, rtapi_u32 addr, void *b
     hm2_eth_t *board = this->private;
     if (comm_active == 0) return 1;
     if (size == 0) return 1;
-    // XXX this is missing a check for exceeding the maximum packet size!
+    // XXX the size of the reply is not checked against the packet size
+    if (board->queue_reads_count == MAX_ETH_READS
+            || board->read_packet_ptr + sizeof(lbp16_cmd_addr)
+                > board->read_packet + sizeof(board->read_packet)) {
+        LL_PRINT("ERROR: too many queued reads\n");
+        return 0;
+    }
     LBP16_INIT_PACKET4(*(lbp16_cmd_addr*)board->read_packet_ptr, CMD_READ_HOSTMOT2_ADDR32_INCR(size/4), addr);
     board->read_packet_ptr += sizeof(lbp16_cmd_addr);
     board->queue_reads[board->queue_reads_count].buffer = buffer;
@@ -661,7 +992,19 @@ static int hm2_eth_send_queued_writes(hm2_lowlevel_io_t *this) {
     memcpy(board->write_packet_ptr, &board->write_cnt, 4);
     board->write_packet_ptr += 4;
     board->write_packet_size += (sizeof(*packet) + 4);
-    
+
+    if(board->write_pending) {
+        // the read-request that should have carried the last cycle's
+        // writes never ran; send both cycles' writes now
+        return hm2_eth_flush_pending_writes(board);
+    }
+    if(board->hal && board->hal->merge_writes) {
+        // leave the writes queued; the next send_queued_reads carries
+        // them in front of its read request
+        board->write_pending = true;
+        return 1;
+    }
+
     t0 = rtapi_get_time();
     send = eth_socket_send(board->sockfd, (void*) &board->write_packet, board->write_packet_size, 0);
     if(send < 0) {
@@ -836,7 +1179,7 @@ static int hm2_eth_probe(hm2_eth_t *board) {
 }
 
 static int hm2_eth_items(hm2_eth_t *board) {
-    int r;
+    int r, i;
 
     board->hal = hal_malloc(sizeof(*board->hal));
     if(!board->hal) return -ENOMEM;
@@ -873,6 +1216,88 @@ static int hm2_eth_items(hm2_eth_t *board) {
         return r;
     board->hal->packet_error_decrement = 1;
 
+    if((r = hal_param_bit_newf(HAL_RW,
+            &board->hal->merge_writes,
+            board->llio.comp_id,
+            "%s.packet-merge-writes",
+            board->llio.name)) < 0)
+        return r;
+    board->hal->merge_writes = 0;
+
+    if((r = hal_param_bit_newf(HAL_RW,
+            &board->hal->read_timeout_adaptive,
+            board->llio.comp_id,
+            "%s.packet-read-timeout-adaptive",
+            board->llio.name)) < 0)
+        return r;
+    board->hal->read_timeout_adaptive = 0;
+
+    if((r = hal_pin_s32_newf(HAL_OUT,
+            &board->hal->read_timeout_used,
+            board->llio.comp_id,
+            "%s.packet-read-timeout-used",
+            board->llio.name)) < 0)
+        return r;
+    *board->hal->read_timeout_used = 0;
+
+    if((r = hal_param_s32_newf(HAL_RW,
+            &board->hal->latency_bucket_width,
+            board->llio.comp_id,
+            "%s.packet-latency-bucket-ns",
+            board->llio.name)) < 0)
+        return r;
+    board->hal->latency_bucket_width = 25000;
+
+    if((r = hal_param_bit_newf(HAL_RW,
+            &board->hal->latency_reset,
+            board->llio.comp_id,
+            "%s.packet-latency-reset",
+            board->llio.name)) < 0)
+        return r;
+    board->hal->latency_reset = 0;
+
+    if((r = hal_pin_s32_newf(HAL_OUT,
+            &board->hal->latency,
+            board->llio.comp_id,
+            "%s.packet-latency",
+            board->llio.name)) < 0)
+        return r;
+    *board->hal->latency = 0;
+
+    if((r = hal_pin_s32_newf(HAL_OUT,
+            &board->hal->latency_max,
+            board->llio.comp_id,
+            "%s.packet-latency-max",
+            board->llio.name)) < 0)
+        return r;
+    *board->hal->latency_max = 0;
+
+    if((r = hal_pin_u32_newf(HAL_OUT,
+            &board->hal->latency_samples,
+            board->llio.comp_id,
+            "%s.packet-latency-samples",
+            board->llio.name)) < 0)
+        return r;
+    *board->hal->latency_samples = 0;
+
+    if((r = hal_pin_u32_newf(HAL_OUT,
+            &board->hal->latency_timeouts,
+            board->llio.comp_id,
+            "%s.packet-latency-timeouts",
+            board->llio.name)) < 0)
+        return r;
+    *board->hal->latency_timeouts = 0;
+
+    for(i = 0; i < HM2_ETH_LATENCY_BUCKETS; i++) {
+        if((r = hal_pin_u32_newf(HAL_OUT,
+                &board->hal->latency_hist[i],
+                board->llio.comp_id,
+                "%s.packet-latency-hist.%02d",
+                board->llio.name, i)) < 0)
+            return r;
+        *board->hal->latency_hist[i] = 0;
+    }
+
     if((r = hal_pin_bit_newf(HAL_OUT,
             &board->hal->packet_error,
             board->llio.comp_id,
@@ -950,9 +1375,16 @@ int rtapi_app_main(void) {
         int *added = kvlist_lookup(&ifnames, ifptr);
         if(*added) continue;
         install_iptables_perinterface(ifptr);
+        if(irq_cpu >= 0) set_irq_affinity(ifptr);
         *added = 1;
     }
 
+    if (num_boards > 1) {
+        ret = hm2_export_read_all(comp_id, HM2_LLIO_NAME ".read-all");
+        if (ret < 0)
+            goto error;
+    }
+
     hal_ready(comp_id);
 
     return 0;
@@ -27,7 +27,13 @@
 #define HM2_ETH_VERSION "0.2"
 #define HM2_LLIO_NAME "hm2_eth"
 
-#define MAX_ETH_READS 64
+#define MAX_ETH_READS 256
+
+// round trip latency histogram; the last bucket also collects everything
+// beyond it
+#define HM2_ETH_LATENCY_BUCKETS 16
+// samples needed before packet-read-timeout-adaptive starts trimming
+#define HM2_ETH_LATENCY_MIN_SAMPLES 1000
 
 typedef struct {
     void *buffer;
@@ -51,20 +57,43 @@ typedef struct {
     rtapi_u8 write_packet[1400];
     rtapi_u8 *write_packet_ptr;
     int write_packet_size;
+    // TRUE when write_packet holds a finished cycle's writes that will be
+    // sent together with the next read request (packet-merge-writes)
+    bool write_pending;
     uint32_t read_cnt, write_cnt;
     // these two fields must be kept together, they're read by a single
     // read-request
     uint32_t confirm_read_cnt, confirm_write_cnt;
 
     int comm_error_counter;
+    // cycles left using the configured timeout after a read timeout
+    int latency_backoff;
     uint16_t old_rxudpcount, rxudpcount;
     struct arpreq req;
 
+    // raw_socket=1: the LBP16 packets go through an AF_PACKET socket on the
+    // board's interface, with the IP and UDP headers built by the driver
+    bool raw_active;
+    int rawfd;
+    struct sockaddr_ll raw_addr;
+    struct sockaddr_in raw_local_addr;
+    uint16_t raw_ip_id;
+
     struct {
         hal_s32_t read_timeout;
         hal_s32_t packet_error_limit;
         hal_s32_t packet_error_increment;
         hal_s32_t packet_error_decrement;
+        hal_bit_t merge_writes;
+        hal_bit_t read_timeout_adaptive;
+        hal_s32_t *read_timeout_used;
+        hal_s32_t latency_bucket_width;
+        hal_bit_t latency_reset;
+        hal_s32_t *latency;
+        hal_s32_t *latency_max;
+        hal_u32_t *latency_samples;
+        hal_u32_t *latency_timeouts;
+        hal_u32_t *latency_hist[HM2_ETH_LATENCY_BUCKETS];
         hal_bit_t *packet_error;
         hal_s32_t *packet_error_level;
         hal_bit_t *packet_error_exceeded;
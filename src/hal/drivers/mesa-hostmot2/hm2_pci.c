@@ -41,6 +41,9 @@ MODULE_SUPPORTED_DEVICE("Mesa-AnythingIO-5i20");  // FIXME
 static char *config[HM2_PCI_MAX_BOARDS];
 RTAPI_MP_ARRAY_STRING(config, HM2_PCI_MAX_BOARDS, "config string for the AnyIO boards (see hostmot2(9) manpage)");
 
+static int write_combining = 1;
+RTAPI_MP_INT(write_combining, "send multi-word writes as bursts where the BAR allows it (default 1)");
+
 static int comp_id;
 
 
@@ -205,27 +208,26 @@ MODULE_DEVICE_TABLE(pci, hm2_pci_tbl);
 
 static int hm2_pci_read(hm2_lowlevel_io_t *this, rtapi_u32 addr, void *buffer, int size) {
     hm2_pci_t *board = this->private;
-    void *src = board->base + addr;
 
-    while (size > 0) {
-        *(rtapi_u32*)buffer = *(rtapi_u32*)src;
-        src += 4;
-        buffer += 4;
-        size -=4;
-    }
+    rtapi_memcpy_fromio32(buffer, board->base + addr, size);
 
     return 1;  // success
 }
 
+// Blocks of more than one word (the TRAM write regions) go through the
+// write-combining map when there is one, so they leave the CPU as
+// bursts instead of one PCI transaction per word.  The flush makes the
+// block reach the board before anything written or read after it.
+// Reads always use the uncached map, since reading some registers has
+// side effects.
 static int hm2_pci_write(hm2_lowlevel_io_t *this, rtapi_u32 addr, void *buffer, int size) {
     hm2_pci_t *board = this->private;
-    void *dest = board->base + addr;
 
-    while (size > 0) {
-        *(rtapi_u32*)dest = *(rtapi_u32*)buffer;
-        dest += 4;
-        buffer += 4;
-        size -=4;
+    if (board->wc_base != NULL && size > 4) {
+        rtapi_memcpy_toio32(board->wc_base + addr, buffer, size);
+        rtapi_wc_flush();
+    } else {
+        rtapi_memcpy_toio32(board->base + addr, buffer, size);
     }
 
     return 1;  // success
@@ -421,6 +423,7 @@ static int hm2_plx9054_reset(hm2_lowlevel_io_t *this) {
 
 static int hm2_pci_probe(struct rtapi_pci_dev *dev, const struct rtapi_pci_device_id *id) {
     int r;
+    int bar;
     hm2_pci_t *board;
     hm2_lowlevel_io_t *this;
 
@@ -633,8 +636,9 @@ static int hm2_pci_probe(struct rtapi_pci_dev *dev, const struct rtapi_pci_devic
             board->data_base_addr = rtapi_pci_resource_start(dev, 2);
 
             // BAR 5 is 64K mem (32 bit)
-            board->len = rtapi_pci_resource_len(dev, dev->subsystem_device ? 5 : 3);
-            board->base = rtapi_pci_ioremap_bar(dev, dev->subsystem_device ? 5 : 3);
+            bar = dev->subsystem_device ? 5 : 3;
+            board->len = rtapi_pci_resource_len(dev, bar);
+            board->base = rtapi_pci_ioremap_bar(dev, bar);
             if (board->base == NULL) {
                 THIS_ERR("could not map in FPGA address space\n");
                 r = -ENODEV;
@@ -656,8 +660,9 @@ static int hm2_pci_probe(struct rtapi_pci_dev *dev, const struct rtapi_pci_devic
             board->data_base_addr = rtapi_pci_resource_start(dev, 2);
 
             // BAR 3 is 64K mem (32 bit)
-            board->len = rtapi_pci_resource_len(dev, 3);
-            board->base = rtapi_pci_ioremap_bar(dev, 3);
+            bar = 3;
+            board->len = rtapi_pci_resource_len(dev, bar);
+            board->base = rtapi_pci_ioremap_bar(dev, bar);
             if (board->base == NULL) {
                 THIS_ERR("could not map in FPGA address space\n");
                 r = -ENODEV;
@@ -674,8 +679,9 @@ static int hm2_pci_probe(struct rtapi_pci_dev *dev, const struct rtapi_pci_devic
         case HM2_PCI_DEV_MESA5I25:
         case HM2_PCI_DEV_MESA6I25: {
               // BAR 0 is 64K mem (32 bit)
-            board->len = rtapi_pci_resource_len(dev, 0);
-            board->base = rtapi_pci_ioremap_bar(dev, 0);
+            bar = 0;
+            board->len = rtapi_pci_resource_len(dev, bar);
+            board->base = rtapi_pci_ioremap_bar(dev, bar);
             if (board->base == NULL) {
                 THIS_ERR("could not map in FPGA address space\n");
                 r = -ENODEV;
@@ -692,6 +698,14 @@ static int hm2_pci_probe(struct rtapi_pci_dev *dev, const struct rtapi_pci_devic
     }
 
 
+    board->wc_base = NULL;
+    if (write_combining) {
+        board->wc_base = rtapi_pci_ioremap_wc_bar(dev, bar);
+        if (board->wc_base != NULL) {
+            THIS_PRINT("using write-combining for block writes\n");
+        }
+    }
+
     board->dev = dev;
 
     rtapi_pci_set_drvdata(dev, board);
@@ -718,6 +732,10 @@ static int hm2_pci_probe(struct rtapi_pci_dev *dev, const struct rtapi_pci_devic
 
 fail1:
     rtapi_pci_set_drvdata(dev, NULL);
+    if (board->wc_base != NULL) {
+        rtapi_iounmap(board->wc_base);
+        board->wc_base = NULL;
+    }
     rtapi_iounmap(board->base);
     board->base = NULL;
 
@@ -740,6 +758,10 @@ static void hm2_pci_remove(struct rtapi_pci_dev *dev) {
             hm2_unregister(&board->llio);
 
             // Unmap board memory
+            if (board->wc_base != NULL) {
+                rtapi_iounmap(board->wc_base);
+                board->wc_base = NULL;
+            }
             if (board->base != NULL) {
                 rtapi_iounmap(board->base);
                 board->base = NULL;
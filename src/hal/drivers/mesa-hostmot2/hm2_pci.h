@@ -135,6 +135,7 @@
 typedef struct {
     struct rtapi_pci_dev *dev;
     void rtapi__iomem *base;
+    void rtapi__iomem *wc_base;     // write-combining map of base, or NULL
     int len;
     unsigned long ctrl_base_addr;
     unsigned long data_base_addr;
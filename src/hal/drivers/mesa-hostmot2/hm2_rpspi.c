@@ -70,6 +70,9 @@ static uint32_t mk_read_cmd(uint16_t, unsigned, bool);
 static uint32_t mk_write_cmd(uint16_t, unsigned, bool);
 static int hm2_rpspi_write(hm2_lowlevel_io_t *, uint32_t, void *, int);
 static int hm2_rpspi_read(hm2_lowlevel_io_t *, uint32_t, void *, int);
+static int hm2_rpspi_queue_write(hm2_lowlevel_io_t *, uint32_t, void *, int);
+static int hm2_rpspi_queue_read(hm2_lowlevel_io_t *, uint32_t, void *, int);
+static int hm2_rpspi_send_queued(hm2_lowlevel_io_t *);
 static int check_cookie(hm2_rpspi_t *);
 static int read_ident(hm2_rpspi_t *, char *);
 static int probe_board(hm2_rpspi_t *, uint16_t);
@@ -87,8 +90,9 @@ RTAPI_MP_ARRAY_STRING(config, MAX_BOARDS, "config string for the AnyIO boards (s
 struct hm2_rpspi_struct {
 	hm2_lowlevel_io_t llio;
 	int nr;
-	uint32_t txBuf[MAX_MSG];
-	uint32_t rxBuf[MAX_MSG];
+	uint32_t trxbuf[MAX_MSG];
+	uint32_t *scatter[MAX_MSG];
+	int nbuf;
 	uint16_t spiclkdiv;
 	uint8_t spibpf;	//bits per frame
 };
@@ -129,138 +133,123 @@ SPI_CS_RXD		0x00020000
 		0 = RX FIFO is empty.
 		1 = RX FIFO contains at least 1 byte.
 */
-static int hm2_rpspi_write(hm2_lowlevel_io_t *llio, uint32_t addr, void *buffer, int size) {
-	//rtapi_print_msg(RTAPI_MSG_ERR, "hm2_rpspi_write addr: %08x, size: %d", addr, size);
-	hm2_rpspi_t *this = (hm2_rpspi_t*) llio;
-	if(size == 0) return 0;
-	if(size % 4) return -EINVAL;
+static int do_pending(hm2_rpspi_t *this) {
+	if(this->nbuf == 0) return 0;
 
-	int msgsize = size/4;
-	uint8_t *tbuff;
-	uint32_t *buffer32 = (uint32_t *)buffer;
-	int i=0, j=0;
-	uint8_t  gully __attribute__((unused));	// it's like a drain or nulldevice.
-
-	this->txBuf[0] = mk_write_cmd(addr, msgsize, true);
+	uint8_t *buff = (uint8_t *)this->trxbuf;
+	int len = 4 * this->nbuf;
+	int tx=0, rx=0;
+	uint32_t cs;
 
-	 for(i=0; i<msgsize; i++)
-		this->txBuf[i+1] = buffer32[i];
-	
 	/* activate transfer and clear fifos */
-	//BCM2835_SPICS = SPI_CS_TA|SPI_CS_CPHA|SPI_CS_CLEAR_TX|SPI_CS_CLEAR_RX;
 	BCM2835_SPICS |= SPI_CS_TA|SPI_CS_CLEAR_TX|SPI_CS_CLEAR_RX;
 
-	tbuff = (uint8_t *)this->txBuf;
-
-	/* send txBuf */
-	/* RPi SPI transfers 8 bits at a time only */
-	for (i=0; i<msgsize+1; i++) {
-		for(j=3; j>=0; j--){
-			BCM2835_SPIFIFO = tbuff[j];
-			if(!(BCM2835_SPICS & SPI_CS_TXD))
-				rtapi_print_msg(RTAPI_MSG_ERR, "TX-FIFO is full!\n");
+	/* RPi SPI transfers 8 bits at a time only, most significant byte of
+	 * each word first. Keep the TX FIFO filled while draining the RX FIFO,
+	 * so the whole buffer goes out in one transfer without waiting for
+	 * each word. Each received byte replaces the byte sent in its place. */
+	while(rx < len) {
+		cs = BCM2835_SPICS;
+		if(tx < len && (cs & SPI_CS_TXD)) {
+			BCM2835_SPIFIFO = buff[tx ^ 3];
+			tx++;
 		}
-		/* wait until transfer is finished */
-		while (!(BCM2835_SPICS & SPI_CS_DONE));
-		
-		if((BCM2835_SPICS & SPI_CS_RXR) || (BCM2835_SPICS & SPI_CS_RXF))
-			rtapi_print_msg(RTAPI_MSG_ERR, "RX-FIFO is full!\n");
-		
-		for(j=3; j>=0; j--){
-			if(!(BCM2835_SPICS & SPI_CS_RXD))
-				rtapi_print_msg(RTAPI_MSG_ERR, "RX-FIFO is empty!\n");
-			gully = BCM2835_SPIFIFO;	// discard one byte from read FIFO
+		if(cs & SPI_CS_RXD) {
+			buff[rx ^ 3] = BCM2835_SPIFIFO;
+			rx++;
 		}
-		
-		tbuff += 4;
 	}
-	
+
+	/* wait until transfer is finished */
+	while (!(BCM2835_SPICS & SPI_CS_DONE));
+
 	/* Stop transfer */
 	BCM2835_SPICS &= ~SPI_CS_TA;
 
+	uint32_t **scatter = this->scatter;
+	int i=0;
+	for(i=0; i<this->nbuf; i++) {
+		uint32_t *target = scatter[i];
+		if(target) *target = this->trxbuf[i];
+	}
+
+	this->nbuf = 0;
 	return 1;
 }
 
+// Add a word to the transaction.  The "send_data" word is transmitted, and the
+// response to that word is stored at "recv_addr" if it is not NULL.
+#define PUT(send_data, recv_addr) do { \
+	this->trxbuf[this->nbuf] = send_data; \
+	this->scatter[this->nbuf++] = recv_addr; \
+} while(0)
+
 /*************************************************/
-static int hm2_rpspi_read(hm2_lowlevel_io_t *llio, uint32_t addr, void *buffer, int size) {
-	//rtapi_print_msg(RTAPI_MSG_ERR, "hm2_rpspi_read addr: %08x, size: %d", addr, size);
-	
+static int hm2_rpspi_queue_write(hm2_lowlevel_io_t *llio, uint32_t addr, void *buffer, int size) {
 	hm2_rpspi_t *this = (hm2_rpspi_t*) llio;
 	if(size == 0) return 0;
 	if(size % 4) return -EINVAL;
 
 	int msgsize = size/4;
-	uint8_t *tbuff, *rbuff;
+	if(msgsize + 1 > MAX_MSG) return -EINVAL;
+	if(msgsize + this->nbuf + 1 > MAX_MSG) {
+		int r = do_pending(this);
+		if(r < 0) return r;
+	}
+
 	uint32_t *buffer32 = (uint32_t *)buffer;
-	int j=0, i=0;
-	this->txBuf[0] = mk_read_cmd(addr, msgsize, true);
-	
+	int i=0;
+	PUT(mk_write_cmd(addr, msgsize, true), 0);
 	for(i=0; i<msgsize; i++)
-		this->txBuf[i+1] = 0;	//just zeros for read
-	
-	/* activate transfer and clear fifos */
-	//BCM2835_SPICS = SPI_CS_TA|SPI_CS_CPHA|SPI_CS_CLEAR_TX|SPI_CS_CLEAR_RX;
-	BCM2835_SPICS |= SPI_CS_TA|SPI_CS_CLEAR_TX|SPI_CS_CLEAR_RX;
+		PUT(buffer32[i], 0);
 
-	/*rtapi_print_msg(RTAPI_MSG_ERR, "Out-Data: ");
-	for (i=0; i<msgsize; i++) {
-		rtapi_print_msg(RTAPI_MSG_ERR, "%08x:", this->txBuf[i]);
-	} 
-		rtapi_print_msg(RTAPI_MSG_ERR, "1 BCM2835_SPICS: %08x:", BCM2835_SPICS);
-	*/
-	
-	tbuff = (uint8_t *)this->txBuf;
-	rbuff = (uint8_t *)this->rxBuf;
-	
-	
-	/* send txBuf */
-	/* RPi SPI transfers 8 bits at a time only */
-	for (i=0; i<msgsize+1; i++) {
-		for(j=3; j>=0; j--){
-			//while(!(BCM2835_SPICS & SPI_CS_TXD));	// wait for  free space in fifo
-			BCM2835_SPIFIFO = tbuff[j];
-			if(!(BCM2835_SPICS & SPI_CS_TXD))
-				rtapi_print_msg(RTAPI_MSG_ERR, "TX-FIFO is full!\n");
-		}
-		
-		/* wait until transfer is finished */
-		while (!(BCM2835_SPICS & SPI_CS_DONE));
-		
-		//rtapi_print_msg(RTAPI_MSG_ERR, "2 BCM2835_SPICS: %08x:", BCM2835_SPICS);
-		
-		if((BCM2835_SPICS & SPI_CS_RXR) || (BCM2835_SPICS & SPI_CS_RXF))
-			rtapi_print_msg(RTAPI_MSG_ERR, "RX-FIFO is full!\n");
-		
-		for(j=3; j>=0; j--){
-			//while(!(BCM2835_SPICS & SPI_CS_RXD));	// wait for data in fifo
-			if(!(BCM2835_SPICS & SPI_CS_RXD))
-				rtapi_print_msg(RTAPI_MSG_ERR, "RX-FIFO is empty!\n");
-			rbuff[j] = BCM2835_SPIFIFO;
-		}
-		tbuff += 4;
-		rbuff += 4;
-	}
-	
-	/*rtapi_print_msg(RTAPI_MSG_ERR, "In-Data: ");
-	for (i=0; i<msgsize; i++) {
-		rtapi_print_msg(RTAPI_MSG_ERR, "%08x:", this->rxBuf[i]);
-	}
-	rtapi_print_msg(RTAPI_MSG_ERR, "\n"); */
-	
-	/* Stop transfer */
-	BCM2835_SPICS &= ~SPI_CS_TA;
-	
-	//rtapi_print_msg(RTAPI_MSG_ERR, "3 BCM2835_SPICS: %08x:", BCM2835_SPICS);
-	
-	/*buff = (char *)this->rxBuf;
-	buff += 4; //skip the cookie */
-	for (i=0; i<msgsize; i++) {
-		buffer32[i] = this->rxBuf[i+1];
+	return 1;
+}
+
+/*************************************************/
+static int hm2_rpspi_queue_read(hm2_lowlevel_io_t *llio, uint32_t addr, void *buffer, int size) {
+	hm2_rpspi_t *this = (hm2_rpspi_t*) llio;
+	if(size == 0) return 0;
+	if(size % 4) return -EINVAL;
+
+	int msgsize = size/4;
+	if(msgsize + 1 > MAX_MSG) return -EINVAL;
+	if(msgsize + this->nbuf + 1 > MAX_MSG) {
+		int r = do_pending(this);
+		if(r < 0) return r;
 	}
-	
+
+	uint32_t *buffer32 = (uint32_t *)buffer;
+	int i=0;
+	PUT(mk_read_cmd(addr, msgsize, true), 0);
+	for(i=0; i<msgsize; i++)
+		PUT(0, &buffer32[i]);	//just zeros for read
+
 	return 1;
 }
 
+/*************************************************/
+static int hm2_rpspi_send_queued(hm2_lowlevel_io_t *llio) {
+	hm2_rpspi_t *this = (hm2_rpspi_t*) llio;
+	return do_pending(this);
+}
+
+/*************************************************/
+static int hm2_rpspi_write(hm2_lowlevel_io_t *llio, uint32_t addr, void *buffer, int size) {
+	hm2_rpspi_t *this = (hm2_rpspi_t*) llio;
+	int r = hm2_rpspi_queue_write(llio, addr, buffer, size);
+	if(r <= 0) return r;
+	return do_pending(this);
+}
+
+/*************************************************/
+static int hm2_rpspi_read(hm2_lowlevel_io_t *llio, uint32_t addr, void *buffer, int size) {
+	hm2_rpspi_t *this = (hm2_rpspi_t*) llio;
+	int r = hm2_rpspi_queue_read(llio, addr, buffer, size);
+	if(r <= 0) return r;
+	return do_pending(this);
+}
+
 /*************************************************/
 static int check_cookie(hm2_rpspi_t *board) {
 	uint32_t cookie[4];
@@ -322,8 +311,10 @@ static int probe_board(hm2_rpspi_t *board, uint16_t spiclkdiv) {
 	board->llio.private = &board;
 	board->llio.read = hm2_rpspi_read;
 	board->llio.write = hm2_rpspi_write;
-	board->llio.queue_read = 0;
-	board->llio.queue_write = 0;
+	board->llio.queue_read = hm2_rpspi_queue_read;
+	board->llio.send_queued_reads = hm2_rpspi_send_queued;
+	board->llio.queue_write = hm2_rpspi_queue_write;
+	board->llio.send_queued_writes = hm2_rpspi_send_queued;
 
 	return 0;
 }
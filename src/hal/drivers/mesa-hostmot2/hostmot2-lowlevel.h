@@ -165,6 +165,9 @@ struct hm2_lowlevel_io_struct {
 int hm2_register(hm2_lowlevel_io_t *llio, char *config);
 void hm2_unregister(hm2_lowlevel_io_t *llio);
 
+// exports a function that reads all the boards registered with this comp_id
+int hm2_export_read_all(int llio_comp_id, const char *name);
+
 
 #endif //  HOSTMOT2_LOWLEVEL_H
 
@@ -31,6 +31,11 @@
 #include "hostmot2.h"
 #include "bitfile.h"
 
+#ifndef __KERNEL__
+#include <stdio.h>
+#include <unistd.h>
+#endif
+
 
 
 
@@ -118,6 +123,25 @@ static void hm2_read(void *void_hm2, long period) {
 }
 
 
+// reads all the boards of one low-level driver, sending every read request
+// before waiting for the first response, so the round trips overlap
+static void hm2_read_all(void *void_llio_comp_id, long period) {
+    int llio_comp_id = *(int *)void_llio_comp_id;
+    struct rtapi_list_head *ptr;
+
+    rtapi_list_for_each(ptr, &hm2_list) {
+        hostmot2_t *hm2 = rtapi_list_entry(ptr, hostmot2_t, list);
+        if (hm2->llio->comp_id != llio_comp_id) continue;
+        hm2_read_request(hm2, period);
+    }
+    rtapi_list_for_each(ptr, &hm2_list) {
+        hostmot2_t *hm2 = rtapi_list_entry(ptr, hostmot2_t, list);
+        if (hm2->llio->comp_id != llio_comp_id) continue;
+        hm2_read(hm2, period);
+    }
+}
+
+
 static void hm2_write(void *void_hm2, long period) {
     hostmot2_t *hm2 = void_hm2;
 
@@ -363,6 +387,7 @@ static int hm2_parse_config_string(hostmot2_t *hm2, char *config_string) {
     hm2->config.num_dplls = -1;
     hm2->config.num_leds = -1;
     hm2->config.enable_raw = 0;
+    hm2->config.keep_firmware = 0;
     hm2->config.firmware = NULL;
 
     if (config_string == NULL) return 0;
@@ -469,6 +494,9 @@ static int hm2_parse_config_string(hostmot2_t *hm2, char *config_string) {
         } else if (strncmp(token, "enable_raw", 10) == 0) {
             hm2->config.enable_raw = 1;
 
+        } else if (strncmp(token, "keep_firmware", 13) == 0) {
+            hm2->config.keep_firmware = 1;
+
         } else if (strncmp(token, "firmware=", 9) == 0) {
             // FIXME: we leak this in hm2_register
             hm2->config.firmware = rtapi_kstrdup(token + 9, RTAPI_GFP_KERNEL);
@@ -501,6 +529,7 @@ static int hm2_parse_config_string(hostmot2_t *hm2, char *config_string) {
     HM2_DBG("    num_uarts=%d\n", hm2->config.num_uarts);
     HM2_DBG("    num_pktuarts=%d\n", hm2->config.num_pktuarts);
     HM2_DBG("    enable_raw=%d\n",   hm2->config.enable_raw);
+    HM2_DBG("    keep_firmware=%d\n", hm2->config.keep_firmware);
     HM2_DBG("    firmware=%s\n",   hm2->config.firmware ? hm2->config.firmware : "(NULL)");
 
     rtapi_argv_free(argv);
@@ -1060,6 +1089,137 @@ static void hm2_release_device(struct rtapi_device *dev) {
     // nothing to do here
 }
 
+
+
+
+//
+// With "keep_firmware" in the config string, a board that is still
+// running the firmware this driver last programmed into it is not
+// programmed again.  What was programmed is kept in a file per board in
+// /dev/shm, which like the FPGA's configuration does not survive a
+// reboot: the hash of the bitfile's config data, and a fingerprint of
+// the IDROM that firmware came up with.  Programming is skipped only if
+// the board answers with the same fingerprint now.  Kernel builds have
+// nowhere to keep the file, and always program the board.
+//
+
+static rtapi_u32 hm2_fnv1a(rtapi_u32 hash, const void *data, int size) {
+    const rtapi_u8 *p = data;
+    int i;
+
+    for (i = 0; i < size; i ++) {
+        hash = (hash ^ p[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// hashes what the board says about its firmware: the cookie, the config
+// name, and the IDROM with its module and pin descriptors
+static int hm2_fpga_fingerprint(hostmot2_t *hm2, rtapi_u32 *fingerprint) {
+    hm2_lowlevel_io_t *llio = hm2->llio;
+    hm2_idrom_t idrom;
+    rtapi_u32 d[3], idrom_offset;
+    rtapi_u32 hash = 2166136261u;
+    char name[HM2_CONFIGNAME_LENGTH];
+    int i, addr;
+
+    if (!llio->read(llio, HM2_ADDR_IOCOOKIE, d, 4) || d[0] != HM2_IOCOOKIE) {
+        return -ENODEV;
+    }
+    if (!llio->read(llio, HM2_ADDR_CONFIGNAME, name, HM2_CONFIGNAME_LENGTH)
+        || strncmp(name, HM2_CONFIGNAME, HM2_CONFIGNAME_LENGTH) != 0) {
+        return -ENODEV;
+    }
+    if (!llio->read(llio, HM2_ADDR_IDROM_OFFSET, &idrom_offset, 4)) {
+        return -EIO;
+    }
+    idrom_offset &= 0xFFFF;
+    if (!llio->read(llio, idrom_offset, &idrom, sizeof(idrom))) {
+        return -EIO;
+    }
+    if ((idrom.idrom_type != 2) && (idrom.idrom_type != 3)) {
+        return -ENODEV;
+    }
+    hash = hm2_fnv1a(hash, &idrom_offset, sizeof(idrom_offset));
+    hash = hm2_fnv1a(hash, &idrom, sizeof(idrom));
+
+    addr = idrom_offset + idrom.offset_to_modules;
+    for (i = 0; i < HM2_MAX_MODULE_DESCRIPTORS; i ++, addr += 12) {
+        if (!llio->read(llio, addr, d, 12)) {
+            return -EIO;
+        }
+        hash = hm2_fnv1a(hash, d, 12);
+        if ((d[0] & 0x000000FF) == 0) break;
+    }
+
+    addr = idrom_offset + idrom.offset_to_pin_desc;
+    for (i = 0; i < idrom.io_width && i < HM2_MAX_PIN_DESCRIPTORS; i ++, addr += 4) {
+        if (!llio->read(llio, addr, d, 4)) {
+            return -EIO;
+        }
+        hash = hm2_fnv1a(hash, d, 4);
+    }
+
+    *fingerprint = hash;
+    return 0;
+}
+
+#ifndef __KERNEL__
+static void hm2_firmware_record_path(hostmot2_t *hm2, char *path, int size) {
+    rtapi_snprintf(path, size, "/dev/shm/hostmot2-%s.firmware", hm2->llio->name);
+}
+#endif
+
+// returns 1 if the board is running the firmware with this hash
+static int hm2_firmware_is_loaded(hostmot2_t *hm2, rtapi_u32 firmware_hash) {
+#ifndef __KERNEL__
+    char path[HAL_NAME_LEN + 32];
+    unsigned int hash, fingerprint;
+    rtapi_u32 now;
+    FILE *f;
+    int n;
+
+    hm2_firmware_record_path(hm2, path, sizeof(path));
+    f = fopen(path, "r");
+    if (f == NULL) return 0;
+    n = fscanf(f, "%x %x", &hash, &fingerprint);
+    fclose(f);
+    if (n != 2 || hash != firmware_hash) return 0;
+
+    if (hm2_fpga_fingerprint(hm2, &now) != 0) return 0;
+    return now == fingerprint;
+#else
+    return 0;
+#endif
+}
+
+static void hm2_firmware_forget(hostmot2_t *hm2) {
+#ifndef __KERNEL__
+    char path[HAL_NAME_LEN + 32];
+
+    hm2_firmware_record_path(hm2, path, sizeof(path));
+    unlink(path);
+#endif
+}
+
+static void hm2_firmware_remember(hostmot2_t *hm2, rtapi_u32 firmware_hash) {
+#ifndef __KERNEL__
+    char path[HAL_NAME_LEN + 32];
+    rtapi_u32 fingerprint;
+    FILE *f;
+
+    if (hm2_fpga_fingerprint(hm2, &fingerprint) != 0) return;
+    hm2_firmware_record_path(hm2, path, sizeof(path));
+    f = fopen(path, "w");
+    if (f == NULL) {
+        HM2_INFO("cannot write %s, the board will be programmed again next time\n", path);
+        return;
+    }
+    fprintf(f, "%08x %08x\n", firmware_hash, fingerprint);
+    fclose(f);
+#endif
+}
+
 static int dummy_queue_write(hm2_lowlevel_io_t *this, rtapi_u32 addr,
         void *buffer, int size) {
     if(size >= 0) return this->write(this, addr, buffer, size);
@@ -1227,6 +1387,7 @@ int hm2_register(hm2_lowlevel_io_t *llio, char *config_string) {
         const struct rtapi_firmware *fw;
         bitfile_t bitfile;
         struct rtapi_device dev;
+        rtapi_u32 firmware_hash;
 
         // check firmware name length
         if (strlen(hm2->config.firmware) > FIRMWARE_NAME_MAX) {
@@ -1284,20 +1445,32 @@ int hm2_register(hm2_lowlevel_io_t *llio, char *config_string) {
             }
         }
 
-        if (llio->reset != NULL) {
-            r = llio->reset(llio);
+        firmware_hash = hm2_fnv1a(2166136261u, bitfile.e.data, bitfile.e.size);
+        if (hm2->config.keep_firmware && hm2_firmware_is_loaded(hm2, firmware_hash)) {
+            HM2_INFO("board is still running %s, not programming it again\n", hm2->config.firmware);
+            rtapi_release_firmware(fw);
+        } else {
+            hm2_firmware_forget(hm2);
+
+            if (llio->reset != NULL) {
+                r = llio->reset(llio);
+                if (r != 0) {
+                    rtapi_release_firmware(fw);
+                    HM2_ERR("failed to reset fpga, aborting hm2_register\n");
+                    goto fail0;
+                }
+            }
+
+            r = llio->program_fpga(llio, &bitfile);
+            rtapi_release_firmware(fw);
             if (r != 0) {
-                rtapi_release_firmware(fw);
-                HM2_ERR("failed to reset fpga, aborting hm2_register\n");
+                HM2_ERR("failed to program fpga, aborting hm2_register\n");
                 goto fail0;
             }
-        }
 
-        r = llio->program_fpga(llio, &bitfile);
-        rtapi_release_firmware(fw);
-        if (r != 0) {
-            HM2_ERR("failed to program fpga, aborting hm2_register\n");
-            goto fail0;
+            if (hm2->config.keep_firmware) {
+                hm2_firmware_remember(hm2, firmware_hash);
+            }
         }
     }
 
@@ -1625,6 +1798,29 @@ fail0:
 
 
 
+EXPORT_SYMBOL_GPL(hm2_export_read_all);
+int hm2_export_read_all(int llio_comp_id, const char *name) {
+    int *arg;
+    int r;
+
+    arg = (int *)hal_malloc(sizeof(int));
+    if (arg == NULL) {
+        HM2_ERR_NO_LL("out of memory!\n");
+        return -ENOMEM;
+    }
+    *arg = llio_comp_id;
+
+    r = hal_export_funct(name, hm2_read_all, arg, 1, 0, llio_comp_id);
+    if (r != 0) {
+        HM2_ERR_NO_LL("error %d exporting read function %s\n", r, name);
+        return -EINVAL;
+    }
+    return 0;
+}
+
+
+
+
 EXPORT_SYMBOL_GPL(hm2_unregister);
 void hm2_unregister(hm2_lowlevel_io_t *llio) {
     struct rtapi_list_head *ptr;
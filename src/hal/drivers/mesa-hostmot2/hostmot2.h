@@ -734,7 +734,7 @@ typedef struct {
 
     // module-global HAL objects...
     hm2_stepgen_module_global_t *hal;
-    rtapi_u32 written_dpll_timer_num;
+    rtapi_s32 written_dpll_timer_num;
 
     // write this (via TRAM) every hm2_<foo>.write
     rtapi_u32 step_rate_addr;
@@ -846,6 +846,8 @@ typedef struct {
     rtapi_u32 rx_bitrate_addr;
     rtapi_u32 rx_addr;
     rtapi_u32 rx_mode_addr;
+    rtapi_u32 *tx_status_reg;	// the mode registers, read with the TRAM
+    rtapi_u32 *rx_status_reg;
     char name[HAL_NAME_LEN+1];
 } hm2_pktuart_instance_t;
 
@@ -872,6 +874,7 @@ typedef struct {
     hal_u32_t *ddssize;
     hal_u32_t *time_const;
     hal_u32_t *prescale;
+    hal_s32_t *sample_timer;
 } hm2_dpll_pins_t ;
 
 typedef struct {
@@ -995,6 +998,25 @@ typedef struct {
 } hm2_tram_entry_t;
 
 
+//
+// a run of tram entries at consecutive addresses, transferred with one
+// queue_read or queue_write
+//
+
+typedef struct {
+    rtapi_u16 addr;
+    rtapi_u16 size;
+    rtapi_u32 *buffer;
+} hm2_tram_block_t;
+
+typedef struct {
+    hal_u32_t read_bytes;
+    hal_u32_t read_transactions;
+    hal_u32_t write_bytes;
+    hal_u32_t write_transactions;
+} hm2_tram_stats_t;
+
+
 
 
 // 
@@ -1021,6 +1043,7 @@ typedef struct {
         int num_dplls;
         char sserial_modes[4][8];
         int enable_raw;
+        int keep_firmware;
         char *firmware;
     } config;
 
@@ -1047,6 +1070,13 @@ typedef struct {
     rtapi_u32 *tram_write_buffer;
     rtapi_u16 tram_write_size;
 
+    // the entries merged into the transfers done each cycle
+    hm2_tram_block_t *tram_read_blocks;
+    int num_tram_read_blocks;
+    hm2_tram_block_t *tram_write_blocks;
+    int num_tram_write_blocks;
+    hm2_tram_stats_t *tram_stats;
+
     // the hostmot2 "Functions"
     hm2_encoder_t encoder;
     hm2_absenc_t absenc;
@@ -1304,6 +1334,11 @@ void hm2_pktuart_process_tram_read(hostmot2_t *hm2, long period);  //  ??
 int hm2_pktuart_setup(char *name, int bitrate, rtapi_s32 tx_mode, rtapi_s32 rx_mode, int txclear, int rxclear);
 int hm2_pktuart_send(char *name,  unsigned char data[], rtapi_u8 *num_frames, rtapi_u16 frame_sizes[]);
 int hm2_pktuart_read(char *name, unsigned char data[],  rtapi_u8 *num_frames, rtapi_u16 *max_frame_length, rtapi_u16 frame_sizes[]);
+rtapi_u32 hm2_pktuart_get_rx_status(char *name);
+rtapi_u32 hm2_pktuart_get_tx_status(char *name);
+int hm2_pktuart_queue_send(char *name, unsigned char data[], rtapi_u8 *num_frames, rtapi_u16 frame_sizes[]);
+int hm2_pktuart_queue_get_frame_sizes(char *name, rtapi_u32 fsizes[]);
+int hm2_pktuart_queue_read_data(char *name, rtapi_u32 data[], int bytes);
 
 //
 // hm2dpll functions
@@ -1314,6 +1349,7 @@ int hm2_dpll_force_write(hostmot2_t *hm2);
 int hm2_dpll_parse_md(hostmot2_t *hm2, int md_index);
 void hm2_dpll_process_tram_read(hostmot2_t *hm2, long period);
 void hm2_dpll_write(hostmot2_t *hm2, long period);
+int hm2_dpll_get_timer_num(hostmot2_t *hm2, int timer_num);
 
 // 
 // watchdog functions
@@ -114,6 +114,15 @@ int hm2_pktuart_parse_md(hostmot2_t *hm2, int md_index)
             inst->tx_mode_addr = (md->base_address 
                                   + 3 * md->register_stride
                                   +i * md->instance_stride);  
+            // the mode registers come in with the TRAM read, for
+            // hm2_pktuart_get_tx_status() and hm2_pktuart_get_rx_status()
+            r = hm2_register_tram_read_region(hm2, inst->tx_mode_addr,
+                                              sizeof(rtapi_u32),
+                                              &inst->tx_status_reg);
+            if (r < 0) {
+                HM2_ERR("error registering tram read region for PktUART Tx mode register\n");
+                goto fail0;
+            }
         }
         else if (md->gtag == HM2_GTAG_PKTUART_RX){
             inst->rx_addr = md->base_address + i * md->instance_stride;
@@ -126,6 +135,13 @@ int hm2_pktuart_parse_md(hostmot2_t *hm2, int md_index)
             inst->rx_mode_addr = (md->base_address 
                                   + 3 * md->register_stride 
                                   +i * md->instance_stride);    
+            r = hm2_register_tram_read_region(hm2, inst->rx_mode_addr,
+                                              sizeof(rtapi_u32),
+                                              &inst->rx_status_reg);
+            if (r < 0) {
+                HM2_ERR("error registering tram read region for PktUART Rx mode register\n");
+                goto fail0;
+            }
         }
         else{
             HM2_ERR("Something very wierd happened");
@@ -505,6 +521,163 @@ int hm2_pktuart_read(char *name, unsigned char data[], rtapi_u8 *num_frames, rta
     return bytes_total;
 }
 
+/*
+   The queued interface.  hm2_pktuart_send() and hm2_pktuart_read() wait
+   for a bus transaction for every register access, which on hm2_eth
+   is a packet round trip each.  These functions only queue theirs,
+   so that a component exchanging frames every servo cycle costs no
+   transactions beyond the ones hostmot2 makes anyway: queued writes go
+   out with the hm2 write function, queued reads come back with the
+   next hm2 read, and the mode registers are read with the TRAM.
+
+   A typical servo cycle, in a function between read and write:
+       look at hm2_pktuart_get_rx_status(), and at the frame sizes and
+       data queued in the last cycle
+       hm2_pktuart_queue_get_frame_sizes() and
+       hm2_pktuart_queue_read_data() for the frames waiting now
+       hm2_pktuart_queue_send() the next request
+   The buffers given for queued reads must stay in place until then.
+*/
+
+EXPORT_SYMBOL_GPL(hm2_pktuart_get_rx_status);
+rtapi_u32 hm2_pktuart_get_rx_status(char *name)
+{
+    hostmot2_t *hm2;
+    int inst = hm2_get_pktuart(&hm2, name);
+
+    if (inst < 0 || hm2->pktuart.instance[inst].rx_status_reg == NULL) {
+        HM2_ERR_NO_LL("Can not find PktUART instance %s.\n", name);
+        return 0;
+    }
+    return *hm2->pktuart.instance[inst].rx_status_reg;
+}
+
+EXPORT_SYMBOL_GPL(hm2_pktuart_get_tx_status);
+rtapi_u32 hm2_pktuart_get_tx_status(char *name)
+{
+    hostmot2_t *hm2;
+    int inst = hm2_get_pktuart(&hm2, name);
+
+    if (inst < 0 || hm2->pktuart.instance[inst].tx_status_reg == NULL) {
+        HM2_ERR_NO_LL("Can not find PktUART instance %s.\n", name);
+        return 0;
+    }
+    return *hm2->pktuart.instance[inst].tx_status_reg;
+}
+
+EXPORT_SYMBOL_GPL(hm2_pktuart_queue_send);
+int hm2_pktuart_queue_send(char *name, unsigned char data[], rtapi_u8 *num_frames, rtapi_u16 frame_sizes[])
+{
+    hostmot2_t *hm2;
+    hm2_pktuart_instance_t *inst;
+    rtapi_u32 buff;
+    rtapi_u8 nframes, i;
+    int c = 0, count = 0, k, i_inst;
+
+    i_inst = hm2_get_pktuart(&hm2, name);
+    if (i_inst < 0){
+        HM2_ERR_NO_LL("Can not find PktUART instance %s.\n", name);
+        return -EINVAL;
+    }
+    inst = &hm2->pktuart.instance[i_inst];
+    if (inst->bitrate == 0){
+        HM2_ERR("%s has not been configured.\n", name);
+        return -EINVAL;
+    }
+
+    nframes = *num_frames > MaxTrFrames ? MaxTrFrames : *num_frames;
+    *num_frames = 0;
+
+    for (i = 0; i < nframes; i++){
+        count = count + frame_sizes[i];
+        // the last word of a frame is padded with zeroes
+        while (c < count){
+            buff = 0;
+            for (k = 0; k < 4 && c + k < count; k++){
+                buff |= (rtapi_u32)data[c + k] << (8 * k);
+            }
+            if (!hm2->llio->queue_write(hm2->llio, inst->tx_addr,
+                                        &buff, sizeof(rtapi_u32))) {
+                HM2_ERR("%s queue send: hm2->llio->queue_write failure\n", name);
+                return -1;
+            }
+            c = c + 4;
+        }
+        c = count;
+
+        // the send count starts the frame; a Send Count FIFO error shows
+        // in hm2_pktuart_get_tx_status() after the next read
+        buff = (rtapi_u32) frame_sizes[i];
+        if (!hm2->llio->queue_write(hm2->llio, inst->tx_fifo_count_addr,
+                                    &buff, sizeof(rtapi_u32))) {
+            HM2_ERR("%s queue send: hm2->llio->queue_write failure\n", name);
+            return -1;
+        }
+        (*num_frames)++;
+    }
+    return count;
+}
+
+EXPORT_SYMBOL_GPL(hm2_pktuart_queue_get_frame_sizes);
+int hm2_pktuart_queue_get_frame_sizes(char *name, rtapi_u32 fsizes[])
+{
+    hostmot2_t *hm2;
+    hm2_pktuart_instance_t *inst;
+    int i, i_inst, countp;
+
+    i_inst = hm2_get_pktuart(&hm2, name);
+    if (i_inst < 0){
+        HM2_ERR_NO_LL("Can not find PktUART instance %s.\n", name);
+        return -EINVAL;
+    }
+    inst = &hm2->pktuart.instance[i_inst];
+    if (inst->bitrate == 0 || inst->rx_status_reg == NULL){
+        HM2_ERR("%s has not been configured.\n", name);
+        return -EINVAL;
+    }
+
+    // Frames received, mode register bits 20..16, as of the TRAM read.
+    // Each read of the receive count FIFO pops one, so only that many.
+    countp = (*inst->rx_status_reg >> 16) & 0x1f;
+    for (i = 0; i < countp; i++){
+        if (!hm2->llio->queue_read(hm2->llio, inst->rx_fifo_count_addr,
+                                   &fsizes[i], sizeof(rtapi_u32))) {
+            HM2_ERR("%s queue read: hm2->llio->queue_read failure\n", name);
+            return -1;
+        }
+    }
+    return countp;
+}
+
+EXPORT_SYMBOL_GPL(hm2_pktuart_queue_read_data);
+int hm2_pktuart_queue_read_data(char *name, rtapi_u32 data[], int bytes)
+{
+    hostmot2_t *hm2;
+    hm2_pktuart_instance_t *inst;
+    int i, i_inst;
+
+    i_inst = hm2_get_pktuart(&hm2, name);
+    if (i_inst < 0){
+        HM2_ERR_NO_LL("Can not find PktUART instance %s.\n", name);
+        return -EINVAL;
+    }
+    inst = &hm2->pktuart.instance[i_inst];
+    if (inst->bitrate == 0){
+        HM2_ERR("%s has not been configured.\n", name);
+        return -EINVAL;
+    }
+
+    // the data FIFO is one register, so one read per word
+    for (i = 0; i < (bytes + 3) / 4; i++){
+        if (!hm2->llio->queue_read(hm2->llio, inst->rx_addr,
+                                   &data[i], sizeof(rtapi_u32))) {
+            HM2_ERR("%s queue read: hm2->llio->queue_read failure\n", name);
+            return -1;
+        }
+    }
+    return i;
+}
+
 void hm2_pktuart_print_module(hostmot2_t *hm2){
     int i;
     HM2_PRINT("PktUART: %d\n", hm2->pktuart.num_instances);
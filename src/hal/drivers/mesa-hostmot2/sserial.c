@@ -789,6 +789,7 @@ int hm2_sserial_create_pins(hostmot2_t *hm2, hm2_sserial_remote_t *chan){
                                                  * sizeof(hm2_sserial_pins_t));
     
     chan->num_read_bits = 0 ; chan->num_write_bits = 0;
+    chan->last_read_valid = false ; chan->last_write_valid = false;
 
     for (i = 0 ; i < chan->num_confs ; i++ ){
 
@@ -1271,23 +1272,20 @@ void hm2_sserial_prepare_tram_write(hostmot2_t *hm2, long period){
                 // All seems well, handle the pins. 
                 for (r = 0 ; r < inst->num_remotes ; r++ ) {
                     hm2_sserial_remote_t *chan = &inst->remotes[r];
-                    bitcount = 0;
-                    if (chan->reg_0_write) *chan->reg_0_write = 0;
-                    if (chan->reg_1_write) *chan->reg_1_write = 0;
-                    if (chan->reg_2_write) *chan->reg_2_write = 0;
+                    bool changed = ! chan->last_write_valid;
                     for (p = 0 ; p < chan->num_confs ; p++){
                         hm2_sserial_data_t *conf = &chan->confs[p];
                         hm2_sserial_pins_t *pin = &chan->pins[p];
                         if (conf->DataDir & 0xC0){
                             switch (conf->DataType){
                                 case LBP_PAD:
-                                    // do nothing
+                                    buff = 0;
                                     break;
                                 case LBP_BITS:
                                     buff = 0;
                                     for (b = 0 ; b < conf->DataLength ; b++){
-                                        buff |= ((rtapi_u64)(*pin->bit_pins[b] != 0) << b)
-                                        ^ ((rtapi_u64)(pin->invert[b] != 0) << b);
+                                        buff |= (rtapi_u64)((*pin->bit_pins[b] != 0)
+                                                        ^ (pin->invert[b] != 0)) << b;
                                     }
                                     break;
                                 case LBP_UNSIGNED:
@@ -1318,13 +1316,32 @@ void hm2_sserial_prepare_tram_write(hostmot2_t *hm2, long period){
                                 case LBP_ENCODER:
                                      // Would we ever write to a counter? 
                                     // Assume not for the time being
+                                    buff = 0;
                                     break;
                                 default:
+                                    buff = 0;
                                     HM2_ERR("Unsupported output datatype %i (name ""%s"")\n",
                                             conf->DataType, conf->NameString);
                                     
                             }
-                            bitcount = setbits(chan, &buff, bitcount, conf->DataLength);
+                            if (buff != pin->last_write){
+                                pin->last_write = buff;
+                                changed = true;
+                            }
+                        }
+                    }
+                    // The TRAM write buffer keeps the data packed last time,
+                    // so it only needs packing again when a value changed
+                    if (! changed) continue;
+                    chan->last_write_valid = true;
+                    bitcount = 0;
+                    if (chan->reg_0_write) *chan->reg_0_write = 0;
+                    if (chan->reg_1_write) *chan->reg_1_write = 0;
+                    if (chan->reg_2_write) *chan->reg_2_write = 0;
+                    for (p = 0 ; p < chan->num_confs ; p++){
+                        if (chan->confs[p].DataDir & 0xC0){
+                            bitcount = setbits(chan, &chan->pins[p].last_write,
+                                               bitcount, chan->confs[p].DataLength);
                         }
                     }
                 }
@@ -1371,7 +1388,7 @@ int hm2_sserial_read_pins(hm2_sserial_remote_t *chan){
     static rtapi_u64 buff_store;             //and part turns are not contiguous
     int b, p, r;
     int bitcount = 0;
-    rtapi_u64 buff;
+    rtapi_u64 buff, changed;
     rtapi_s32 buff32;
     rtapi_s64 buff64;
     chan->status = *chan->reg_cs_read;
@@ -1387,9 +1404,18 @@ int hm2_sserial_read_pins(hm2_sserial_remote_t *chan){
                 // do nothing
                 break;
             case LBP_BITS:
-                for (b = 0 ; b < conf->DataLength ; b++){
-                    *pin->bit_pins[b] = ((buff & (1LL << b)) != 0);
-                    *pin->bit_pins_not[b] = ! *pin->bit_pins[b];
+                // Input-only pins are only written by this driver, so only
+                // the bits that changed since the last read need updating
+                changed = ~0ull;
+                if (chan->last_read_valid && conf->DataDir == LBP_IN){
+                    changed = buff ^ pin->last_read;
+                }
+                pin->last_read = buff;
+                for (b = 0 ; changed != 0 && b < conf->DataLength ; b++, changed >>= 1){
+                    if (changed & 1){
+                        *pin->bit_pins[b] = ((buff & (1LL << b)) != 0);
+                        *pin->bit_pins_not[b] = ! *pin->bit_pins[b];
+                    }
                 }
                 break;
             case LBP_UNSIGNED:
@@ -1511,6 +1537,7 @@ int hm2_sserial_read_pins(hm2_sserial_remote_t *chan){
             bitcount += conf->DataLength;
         }
     }
+    chan->last_read_valid = true;
     return 0;
 }
 
@@ -182,6 +182,8 @@ typedef struct {
     rtapi_s64 oldval; // not pins, but this way every pin can have one
     rtapi_s64 accum; // these two are only currently used by encoders
     rtapi_s64 offset;
+    rtapi_u64 last_read; // last process data, to only update the pins that
+    rtapi_u64 last_write; // changed and to only pack the data when it changed
 }hm2_sserial_pins_t;
 
 typedef struct {
@@ -225,6 +227,8 @@ typedef struct {
     rtapi_u32 data_written;
     rtapi_u32 data2_written;
     rtapi_u32 data3_written;
+    bool last_read_valid;
+    bool last_write_valid;
     int myinst;
     char name[29];
     char raw_name[5];
@@ -390,15 +390,17 @@ static void hm2_stepgen_update_mode(hostmot2_t *hm2, int i) {
 
 static void hm2_stepgen_set_dpll_timer(hostmot2_t *hm2) {
     rtapi_u32 data = 0;
+    int timer_num;
 
     if ((*hm2->stepgen.hal->pin.dpll_timer_num < -1) || (*hm2->stepgen.hal->pin.dpll_timer_num > 4)) {
         *hm2->stepgen.hal->pin.dpll_timer_num = 0;
     }
-    if (*hm2->stepgen.hal->pin.dpll_timer_num > -1) {
-        data = (*hm2->stepgen.hal->pin.dpll_timer_num << 12) | (1 << 15);
+    timer_num = hm2_dpll_get_timer_num(hm2, *hm2->stepgen.hal->pin.dpll_timer_num);
+    if (timer_num > -1 && timer_num <= 4) {
+        data = (timer_num << 12) | (1 << 15);
     }
     hm2->llio->write(hm2->llio, hm2->stepgen.dpll_timer_num_addr, &data, sizeof(rtapi_u32));
-    hm2->stepgen.written_dpll_timer_num = *hm2->stepgen.hal->pin.dpll_timer_num;
+    hm2->stepgen.written_dpll_timer_num = timer_num;
 }
 
 
@@ -437,7 +439,8 @@ void hm2_stepgen_write(hostmot2_t *hm2) {
         }
     }
     if (hm2->stepgen.num_instances > 0 && hm2->dpll_module_present) {
-        if (*hm2->stepgen.hal->pin.dpll_timer_num != hm2->stepgen.written_dpll_timer_num) {
+        if (hm2_dpll_get_timer_num(hm2, *hm2->stepgen.hal->pin.dpll_timer_num)
+                != hm2->stepgen.written_dpll_timer_num) {
             hm2_stepgen_set_dpll_timer(hm2);
         }
     }
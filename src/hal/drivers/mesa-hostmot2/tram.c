@@ -81,6 +81,56 @@ int hm2_register_tram_write_region(hostmot2_t *hm2, rtapi_u16 addr, rtapi_u16 si
 }
 
 
+//
+// Merges the entries of a tram list into blocks.  The buffers are laid out
+// in list order, so an entry that starts where the previous one ended
+// continues its block.  The order of the entries is kept, as the modules
+// rely on it (the sserial DoIt command, for one).
+//
+
+// the SPI and LBP16 commands count up to 127 words
+#define HM2_TRAM_MAX_BLOCK_SIZE (127 * sizeof(rtapi_u32))
+
+static int hm2_merge_tram_entries(hostmot2_t *hm2, struct rtapi_list_head *entries,
+        hm2_tram_block_t **blocks, int *num_blocks) {
+    struct rtapi_list_head *ptr;
+    hm2_tram_block_t *block = NULL;
+    int n = 0;
+
+    rtapi_list_for_each(ptr, entries) {
+        n ++;
+    }
+
+    if (*blocks != NULL) rtapi_kfree(*blocks);
+    *num_blocks = 0;
+    if (n == 0) {
+        *blocks = NULL;
+        return 0;
+    }
+
+    *blocks = rtapi_kmalloc(n * sizeof(hm2_tram_block_t), RTAPI_GFP_KERNEL);
+    if (*blocks == NULL) {
+        HM2_ERR("out of memory!\n");
+        return -ENOMEM;
+    }
+
+    rtapi_list_for_each(ptr, entries) {
+        hm2_tram_entry_t *tram_entry = rtapi_list_entry(ptr, hm2_tram_entry_t, list);
+        if (block != NULL && block->addr + block->size == tram_entry->addr
+                && block->size + tram_entry->size <= HM2_TRAM_MAX_BLOCK_SIZE) {
+            block->size += tram_entry->size;
+            continue;
+        }
+        block = &(*blocks)[(*num_blocks)++];
+        block->addr = tram_entry->addr;
+        block->size = tram_entry->size;
+        block->buffer = *tram_entry->buffer;
+    }
+
+    return 0;
+}
+
+
 int hm2_allocate_tram_regions(hostmot2_t *hm2) {
     struct rtapi_list_head *ptr;
     rtapi_u16 offset;
@@ -140,20 +190,56 @@ int hm2_allocate_tram_regions(hostmot2_t *hm2) {
         offset += tram_entry->size;
         HM2_DBG("    addr=0x%04x, size=%d, buffer=%p\n", tram_entry->addr, tram_entry->size, *tram_entry->buffer);
     }
-    
+
+    if (hm2_merge_tram_entries(hm2, &hm2->tram_read_entries,
+                               &hm2->tram_read_blocks, &hm2->num_tram_read_blocks) < 0
+            || hm2_merge_tram_entries(hm2, &hm2->tram_write_entries,
+                                      &hm2->tram_write_blocks, &hm2->num_tram_write_blocks) < 0) {
+        return -ENOMEM;
+    }
+    HM2_DBG("Translation RAM transfers: %d reads, %d writes\n",
+            hm2->num_tram_read_blocks, hm2->num_tram_write_blocks);
+
+    if (hm2->tram_stats == NULL) {
+        int r;
+
+        hm2->tram_stats = (hm2_tram_stats_t *)hal_malloc(sizeof(hm2_tram_stats_t));
+        if (hm2->tram_stats == NULL) {
+            HM2_ERR("out of memory!\n");
+            return -ENOMEM;
+        }
+
+        r = hal_param_u32_newf(HAL_RO, &hm2->tram_stats->read_bytes, hm2->llio->comp_id,
+                               "%s.tram.read-bytes", hm2->llio->name);
+        r += hal_param_u32_newf(HAL_RO, &hm2->tram_stats->read_transactions, hm2->llio->comp_id,
+                                "%s.tram.read-transactions", hm2->llio->name);
+        r += hal_param_u32_newf(HAL_RO, &hm2->tram_stats->write_bytes, hm2->llio->comp_id,
+                                "%s.tram.write-bytes", hm2->llio->name);
+        r += hal_param_u32_newf(HAL_RO, &hm2->tram_stats->write_transactions, hm2->llio->comp_id,
+                                "%s.tram.write-transactions", hm2->llio->name);
+        if (r < 0) {
+            HM2_ERR("error adding tram params, aborting\n");
+            return -EINVAL;
+        }
+    }
+    hm2->tram_stats->read_bytes = hm2->tram_read_size;
+    hm2->tram_stats->read_transactions = hm2->num_tram_read_blocks;
+    hm2->tram_stats->write_bytes = hm2->tram_write_size;
+    hm2->tram_stats->write_transactions = hm2->num_tram_write_blocks;
+
     return 0;
 }
 
 
 static rtapi_u32 tram_read_iteration = 0;
 int hm2_tram_read(hostmot2_t *hm2) {
-    struct rtapi_list_head *ptr;
+    int i;
 
-    rtapi_list_for_each(ptr, &hm2->tram_read_entries) {
-        hm2_tram_entry_t *tram_entry = rtapi_list_entry(ptr, hm2_tram_entry_t, list);
+    for (i = 0; i < hm2->num_tram_read_blocks; i ++) {
+        hm2_tram_block_t *block = &hm2->tram_read_blocks[i];
 
-        if (!hm2->llio->queue_read(hm2->llio, tram_entry->addr, *tram_entry->buffer, tram_entry->size)) {
-            HM2_ERR("TRAM read error! (addr=0x%04x, size=%d, iter=%u)\n", tram_entry->addr, tram_entry->size, tram_read_iteration);
+        if (!hm2->llio->queue_read(hm2->llio, block->addr, block->buffer, block->size)) {
+            HM2_ERR("TRAM read error! (addr=0x%04x, size=%d, iter=%u)\n", block->addr, block->size, tram_read_iteration);
             return -EIO;
         }
     }
@@ -187,13 +273,13 @@ int hm2_finish_read(hostmot2_t *hm2) {
 
 static rtapi_u32 tram_write_iteration = 0;
 int hm2_tram_write(hostmot2_t *hm2) {
-    struct rtapi_list_head *ptr;
+    int i;
 
-    rtapi_list_for_each(ptr, &hm2->tram_write_entries) {
-        hm2_tram_entry_t *tram_entry = rtapi_list_entry(ptr, hm2_tram_entry_t, list);
+    for (i = 0; i < hm2->num_tram_write_blocks; i ++) {
+        hm2_tram_block_t *block = &hm2->tram_write_blocks[i];
 
-        if (!hm2->llio->queue_write(hm2->llio, tram_entry->addr, *tram_entry->buffer, tram_entry->size)) {
-            HM2_ERR("TRAM write error! (addr=0x%04x, size=%d, iter=%u)\n", tram_entry->addr, tram_entry->size, tram_write_iteration);
+        if (!hm2->llio->queue_write(hm2->llio, block->addr, block->buffer, block->size)) {
+            HM2_ERR("TRAM write error! (addr=0x%04x, size=%d, iter=%u)\n", block->addr, block->size, tram_write_iteration);
             return -EIO;
         }
     }
@@ -228,6 +314,9 @@ void hm2_tram_cleanup(hostmot2_t *hm2) {
         rtapi_kfree(te);
     }
 
+    if (hm2->tram_read_blocks != NULL) rtapi_kfree(hm2->tram_read_blocks);
+    if (hm2->tram_write_blocks != NULL) rtapi_kfree(hm2->tram_write_blocks);
+
     // free the tram buffers
     if (hm2->tram_read_buffer != NULL) rtapi_kfree(hm2->tram_read_buffer);
     if (hm2->tram_write_buffer != NULL) rtapi_kfree(hm2->tram_write_buffer);
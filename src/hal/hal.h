@@ -197,14 +197,15 @@ extern int hal_exit(int comp_id);
     allocated space, or NULL (0) on error.  The returned pointer
     will be properly aligned for any variable HAL supports (see
     HAL_TYPE below.)
-    The allocator is very simple, and there is no 'free'.  It is
-    assumed that a component will allocate all the memory it needs
-    during initialization.  The entire HAL shared memory area is
-    freed when the last component calls hal_exit().  This means
-    that if you continuously install and remove one component
-    while other components are present, you eventually will fill
-    up the shared memory and an install will fail.  Removing
-    all components completely clears memory and you start
+    There is no 'free'.  It is assumed that a component will
+    allocate all the memory it needs during initialization.  What a
+    user space component allocates before hal_ready() is given back
+    (zeroed) for reuse when it calls hal_exit().  Everything else is
+    freed only when the last component calls hal_exit().  This means
+    that if you continuously install and remove one realtime
+    component while other components are present, you eventually
+    will fill up the shared memory and an install will fail.
+    Removing all components completely clears memory and you start
     fresh.
 */
 extern void *hal_malloc(long int size);
@@ -653,6 +654,28 @@ extern int hal_export_funct(const char *name, void (*funct) (void *, long),
 extern int hal_create_thread(const char *name, unsigned long period_nsec,
     int uses_fp);
 
+/** hal_create_thread_cpu() is hal_create_thread(), but runs the
+    thread on CPU 'cpu'.  A negative 'cpu' gives the default CPU, as
+    hal_create_thread() does.  In user space threads on different
+    CPUs run at the same time, so a function of the slower thread
+    may see the pins of the faster one change while it runs.
+*/
+extern int hal_create_thread_cpu(const char *name, unsigned long period_nsec,
+    int uses_fp, int cpu);
+
+/** hal_thread_add_worker() starts a worker task for thread 'name' on
+    CPU 'cpu', which should not be the CPU of the thread itself.  The
+    workers of a thread run the functions of each stage of its list
+    alongside it; a stage is the functions from one barrier (see
+    hal_add_funct_to_thread_barrier()) up to the next, so functions
+    between two barriers may run at the same time, in any order.  A
+    thread can have up to HAL_MAX_WORKERS workers.  Without realtime
+    they would only take turns with the thread, so none are started.
+    Returns 0, or a negative error code.  Call only from realtime
+    init code.
+*/
+extern int hal_thread_add_worker(const char *name, int cpu);
+
 /** hal_thread_delete() deletes a realtime thread.
     'name' is the name of the thread, which must have been created
     by 'hal_create_thread()'.
@@ -689,6 +712,15 @@ extern int hal_thread_delete(const char *name);
 extern int hal_add_funct_to_thread(const char *funct_name, const char *thread_name,
     int position);
 
+/** hal_add_funct_to_thread_barrier() is hal_add_funct_to_thread(),
+    but if 'barrier' is non-zero, on a thread with workers neither the
+    function nor those after it start until all of the functions before
+    it have finished.  Without workers, a thread runs its functions one
+    after the other anyway and barriers do nothing.
+*/
+extern int hal_add_funct_to_thread_barrier(const char *funct_name,
+    const char *thread_name, int position, int barrier);
+
 /** hal_del_funct_from_thread() removes a function from a thread.
     'funct_name' is the name of the function, as specified in
     a call to hal_export_funct().
@@ -700,6 +732,34 @@ extern int hal_add_funct_to_thread(const char *funct_name, const char *thread_na
 */
 extern int hal_del_funct_from_thread(const char *funct_name, const char *thread_name);
 
+/** hal_set_thread_profile() turns per-function execution profiling
+    on (non-zero 'enable') or off for the thread 'thread_name', or for
+    every thread if 'thread_name' is NULL.  While it is on, each run of
+    each function on the thread is added to a log2 histogram of CPU
+    cycles that halcmd can display.  When it is off the thread loop
+    does no extra work.
+    Returns 0, or a negative error code.  Call only from within user
+    space or init code, not from realtime code.
+*/
+extern int hal_set_thread_profile(const char *thread_name, int enable);
+
+/** hal_reset_thread_profile() clears the profile histograms of the
+    functions on 'thread_name', or on every thread if it is NULL.
+    Returns 0, or a negative error code.
+*/
+extern int hal_reset_thread_profile(const char *thread_name);
+
+/** hal_compact_signals() moves signal values into one contiguous,
+    cache line aligned block per thread, ordered by the position on the
+    thread of the first function whose component uses each signal, and
+    updates every linked pin to point at the new location.  It improves
+    cache behaviour on threads with many functions.  Threads must be
+    stopped; call it after the configuration is loaded and before
+    hal_start_threads().  Previously used signal memory is not reused.
+    Returns the number of signals moved, or a negative error code.
+*/
+extern int hal_compact_signals(void);
+
 /** hal_start_threads() starts all threads that have been created.
     This is the point at which realtime functions start being called.
     On success it returns 0, on failure a negative
@@ -777,6 +837,23 @@ extern bool hal_stream_writable(hal_stream_t *stream);
 extern void hal_stream_wait_writable(hal_stream_t *stream, sig_atomic_t *stop);
 #endif
 
+/** batch transfer: these move up to 'n' records, packed
+    hal_stream_element_count() to a record, and return how many they moved.
+    hal_stream_read_n() doesn't count an underrun when the stream is empty,
+    nor hal_stream_write_n() an overrun when it is full. */
+extern int hal_stream_read_n(hal_stream_t *stream, union hal_stream_data *buf, int n, unsigned *sampleno);
+extern int hal_stream_write_n(hal_stream_t *stream, union hal_stream_data *buf, int n);
+
+/** direct access to the ring in shared memory: the span functions return
+    the first record and set 'count' to the number of records that follow
+    it without wrapping.  Records are hal_stream_element_count()+1 elements
+    apart; the last element of a record holds its sample number, which
+    hal_stream_write_commit() fills in. */
+extern union hal_stream_data *hal_stream_read_span(hal_stream_t *stream, int *count);
+extern void hal_stream_read_release(hal_stream_t *stream, int n);
+extern union hal_stream_data *hal_stream_write_span(hal_stream_t *stream, int *count);
+extern void hal_stream_write_commit(hal_stream_t *stream, int n);
+
 RTAPI_END_DECLS
 
 #endif /* HAL_H */
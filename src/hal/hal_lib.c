@@ -59,6 +59,7 @@
 
 #include "rtapi_string.h"
 #include "rtapi_atomic.h"
+#include "rtapi_math64.h"
 
 #ifdef RTAPI
 #include "rtapi_app.h"
@@ -66,6 +67,13 @@
 MODULE_AUTHOR("John Kasunich");
 MODULE_DESCRIPTION("Hardware Abstraction Layer for EMC");
 MODULE_LICENSE("GPL");
+
+/* The shared memory size is set when realtime starts, from the
+   HAL_SHMEM_SIZE environment variable or [HAL]SHMEM_SIZE.  Non-realtime
+   processes map HAL_SIZE, the smallest allowed, and then use the whole
+   block, since the mapping always covers all of it. */
+static long hal_size = HAL_SIZE;
+RTAPI_MP_LONG(hal_size, "size of the HAL shared memory in bytes");
 #endif /* RTAPI */
 
 #if defined(ULAPI)
@@ -90,7 +98,7 @@ static int lib_mem_id = 0;	/* RTAPI shmem ID for library module */
     if the structure has not already been initialized.  (The init
     is done by the first HAL component to be loaded.
 */
-static int init_hal_data(void);
+static int init_hal_data(long int size);
 
 /** The 'shmalloc_xx()' functions allocate blocks of shared memory.
     Each function allocates a block that is 'size' bytes long.
@@ -115,6 +123,25 @@ static int init_hal_data(void);
 static void *shmalloc_up(long int size);
 static void *shmalloc_dn(long int size);
 
+/** 'arena_alloc()' allocates 'size' bytes of zeroed memory from the
+    arena for component 'owner', and 'arena_reclaim()' returns all of
+    the blocks of 'owner' to the free lists.  Both expect the mutex to
+    be held.
+*/
+#ifdef ULAPI
+static void *arena_alloc(long int size, int owner);
+
+/** 'arena_owner()' returns the component that hal_malloc() memory
+    belongs to: the one component of this process that has not called
+    hal_ready() yet.  hal_malloc() doesn't say which component it is
+    for, so if there are several of them, or none, it returns 0 and the
+    memory comes from 'shmalloc_up()', never to be reclaimed.  Expects
+    the mutex to be held.
+*/
+static int arena_owner(void);
+#endif
+static void arena_reclaim(int owner);
+
 /** The alloc_xxx_struct() functions allocate a structure of the
     appropriate type and return a pointer to it, or 0 if they fail.
     They attempt to re-use freed structs first, if none are
@@ -151,12 +178,48 @@ static void free_funct_entry_struct(hal_funct_entry_t * funct_entry);
 static void free_thread_struct(hal_thread_t * thread);
 #endif /* RTAPI */
 
+/** These functions maintain the name hash tables described in
+    hal_priv.h.  'hash_name()' hashes a name; the xxx_BUCKET() macros
+    point to the bucket for a name.  'hash_add()' puts 'obj', whose
+    'hash_next' field is at 'link', at the head of 'bucket', and
+    'hash_remove()' takes it out again; it does nothing if 'obj' is not
+    in the bucket.  An object must be removed before its name changes.
+    The caller must hold the hal_data mutex.
+*/
+static unsigned int hash_name(const char *name);
+static void hash_add(int *bucket, void *obj, int *link);
+static void hash_remove(int *bucket, void *obj, int *link);
+
+#define PIN_BUCKET(name) \
+    (&hal_data->pin_hash[hash_name(name) & (HAL_HASH_SIZE - 1)])
+#define SIG_BUCKET(name) \
+    (&hal_data->sig_hash[hash_name(name) & (HAL_HASH_SIZE - 1)])
+#define PARAM_BUCKET(name) \
+    (&hal_data->param_hash[hash_name(name) & (HAL_HASH_SIZE - 1)])
+#define FUNCT_BUCKET(name) \
+    (&hal_data->funct_hash[hash_name(name) & (HAL_HASH_SIZE - 1)])
+#define PIN_ALIAS_BUCKET(name) \
+    (&hal_data->pin_alias_hash[hash_name(name) & (HAL_ALIAS_HASH_SIZE - 1)])
+#define PARAM_ALIAS_BUCKET(name) \
+    (&hal_data->param_alias_hash[hash_name(name) & (HAL_ALIAS_HASH_SIZE - 1)])
+
+/** 'profile_thread_functs()' makes sure every function on 'thread' has
+    a profile block, clearing existing ones if 'clear' is set.  The
+    caller must hold the hal_data mutex.
+*/
+static int profile_thread_functs(hal_thread_t *thread, int clear);
+
 #ifdef RTAPI
 /** 'thread_task()' is a function that is invoked as a realtime task.
     It implements a thread, by running down the thread's function list
     and calling each function in turn.
 */
 static void thread_task(void *arg);
+
+/** 'worker_task()' is the task of a worker of a thread, which helps
+    the thread with the stages of its function list.
+*/
+static void worker_task(void *arg);
 #endif /* RTAPI */
 
 /***********************************************************************
@@ -217,7 +280,7 @@ int hal_init(const char *name)
         hal_shmem_base = (char *) mem;
         hal_data = (hal_data_t *) mem;
 	/* perform a global init if needed */
-	retval = init_hal_data();
+	retval = init_hal_data(HAL_SIZE);
 	if ( retval ) {
 	    rtapi_print_msg(RTAPI_MSG_ERR,
 		"HAL: ERROR: could not init shared memory\n");
@@ -238,11 +301,11 @@ int hal_init(const char *name)
 	return -EINVAL;
     }
     /* get mutex before manipulating the shared data */
-    rtapi_mutex_get(&(hal_data->mutex));
+    halpr_lock();
     /* make sure name is unique in the system */
     if (halpr_find_comp_by_name(hal_name) != 0) {
 	/* a component with this name already exists */
-	rtapi_mutex_give(&(hal_data->mutex));
+	halpr_unlock();
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: duplicate component name '%s'\n", hal_name);
 	rtapi_exit(comp_id);
@@ -252,7 +315,7 @@ int hal_init(const char *name)
     comp = halpr_alloc_comp_struct();
     if (comp == 0) {
 	/* couldn't allocate structure */
-	rtapi_mutex_give(&(hal_data->mutex));
+	halpr_unlock();
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: insufficient memory for component '%s'\n", hal_name);
 	rtapi_exit(comp_id);
@@ -275,7 +338,7 @@ int hal_init(const char *name)
     comp->next_ptr = hal_data->comp_list_ptr;
     hal_data->comp_list_ptr = SHMOFF(comp);
     /* done with list, release mutex */
-    rtapi_mutex_give(&(hal_data->mutex));
+    halpr_unlock();
     /* done */
     rtapi_print_msg(RTAPI_MSG_DBG,
 	"HAL: component '%s' initialized, ID = %02d\n", hal_name, comp_id);
@@ -296,13 +359,13 @@ int hal_exit(int comp_id)
     }
     rtapi_print_msg(RTAPI_MSG_DBG, "HAL: removing component %02d\n", comp_id);
     /* grab mutex before manipulating list */
-    rtapi_mutex_get(&(hal_data->mutex));
+    halpr_lock();
     /* search component list for 'comp_id' */
     prev = &(hal_data->comp_list_ptr);
     next = *prev;
     if (next == 0) {
 	/* list is empty - should never happen, but... */
-	rtapi_mutex_give(&(hal_data->mutex));
+	halpr_unlock();
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: component %d not found\n", comp_id);
 	return -EINVAL;
@@ -314,7 +377,7 @@ int hal_exit(int comp_id)
 	next = *prev;
 	if (next == 0) {
 	    /* reached end of list without finding component */
-	    rtapi_mutex_give(&(hal_data->mutex));
+	    halpr_unlock();
 	    rtapi_print_msg(RTAPI_MSG_ERR,
 		"HAL: ERROR: component %d not found\n", comp_id);
 	    return -EINVAL;
@@ -345,7 +408,7 @@ int hal_exit(int comp_id)
     }
 #endif
     /* release mutex */
-    rtapi_mutex_give(&(hal_data->mutex));
+    halpr_unlock();
     --ref_cnt;
 #ifdef ULAPI
     if(ref_cnt == 0) {
@@ -370,6 +433,9 @@ int hal_exit(int comp_id)
 void *hal_malloc(long int size)
 {
     void *retval;
+#ifdef ULAPI
+    int owner;
+#endif
 
     if (hal_data == 0) {
 	rtapi_print_msg(RTAPI_MSG_ERR,
@@ -377,11 +443,17 @@ void *hal_malloc(long int size)
 	return 0;
     }
     /* get the mutex */
-    rtapi_mutex_get(&(hal_data->mutex));
+    halpr_lock();
     /* allocate memory */
+#ifdef ULAPI
+    owner = arena_owner();
+    if (owner != 0) {
+	retval = arena_alloc(size, owner);
+    } else
+#endif
     retval = shmalloc_up(size);
     /* release the mutex */
-    rtapi_mutex_give(&(hal_data->mutex));
+    halpr_unlock();
     /* check return value */
     if (retval == 0) {
 	rtapi_print_msg(RTAPI_MSG_DBG,
@@ -395,13 +467,13 @@ int hal_set_constructor(int comp_id, constructor make) {
     int next;
     hal_comp_t *comp;
 
-    rtapi_mutex_get(&(hal_data->mutex));
+    halpr_lock();
 
     /* search component list for 'comp_id' */
     next = hal_data->comp_list_ptr;
     if (next == 0) {
 	/* list is empty - should never happen, but... */
-	rtapi_mutex_give(&(hal_data->mutex));
+	halpr_unlock();
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: component %d not found\n", comp_id);
 	return -EINVAL;
@@ -413,7 +485,7 @@ int hal_set_constructor(int comp_id, constructor make) {
 	next = comp->next_ptr;
 	if (next == 0) {
 	    /* reached end of list without finding component */
-	    rtapi_mutex_give(&(hal_data->mutex));
+	    halpr_unlock();
 	    rtapi_print_msg(RTAPI_MSG_ERR,
 		"HAL: ERROR: component %d not found\n", comp_id);
 	    return -EINVAL;
@@ -423,7 +495,7 @@ int hal_set_constructor(int comp_id, constructor make) {
     
     comp->make = make;
 
-    rtapi_mutex_give(&(hal_data->mutex));
+    halpr_unlock();
     return 0;
 }
 #endif
@@ -432,13 +504,13 @@ int hal_ready(int comp_id) {
     int next;
     hal_comp_t *comp;
 
-    rtapi_mutex_get(&(hal_data->mutex));
+    halpr_lock();
 
     /* search component list for 'comp_id' */
     next = hal_data->comp_list_ptr;
     if (next == 0) {
 	/* list is empty - should never happen, but... */
-	rtapi_mutex_give(&(hal_data->mutex));
+	halpr_unlock();
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: component %d not found\n", comp_id);
 	return -EINVAL;
@@ -450,7 +522,7 @@ int hal_ready(int comp_id) {
 	next = comp->next_ptr;
 	if (next == 0) {
 	    /* reached end of list without finding component */
-	    rtapi_mutex_give(&(hal_data->mutex));
+	    halpr_unlock();
 	    rtapi_print_msg(RTAPI_MSG_ERR,
 		"HAL: ERROR: component %d not found\n", comp_id);
 	    return -EINVAL;
@@ -460,11 +532,11 @@ int hal_ready(int comp_id) {
     if(comp->ready > 0) {
         rtapi_print_msg(RTAPI_MSG_ERR,
                 "HAL: ERROR: Component '%s' already ready\n", comp->name);
-        rtapi_mutex_give(&(hal_data->mutex));
+        halpr_unlock();
         return -EINVAL;
     }
     comp->ready = 1;
-    rtapi_mutex_give(&(hal_data->mutex));
+    halpr_unlock();
     return 0;
 }
 
@@ -472,10 +544,10 @@ char *hal_comp_name(int comp_id)
 {
     hal_comp_t *comp;
     char *result = NULL;
-    rtapi_mutex_get(&(hal_data->mutex));
+    halpr_lock();
     comp = halpr_find_comp_by_id(comp_id);
     if(comp) result = comp->name;
-    rtapi_mutex_give(&(hal_data->mutex));
+    halpr_unlock();
     return result;
 }
 
@@ -645,12 +717,12 @@ int hal_pin_new(const char *name, hal_type_t type, hal_pin_dir_t dir,
 
     rtapi_print_msg(RTAPI_MSG_DBG, "HAL: creating pin '%s'\n", name);
     /* get mutex before accessing shared data */
-    rtapi_mutex_get(&(hal_data->mutex));
+    halpr_lock();
     /* validate comp_id */
     comp = halpr_find_comp_by_id(comp_id);
     if (comp == 0) {
 	/* bad comp_id */
-	rtapi_mutex_give(&(hal_data->mutex));
+	halpr_unlock();
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: component %d not found\n", comp_id);
 	return -EINVAL;
@@ -658,13 +730,13 @@ int hal_pin_new(const char *name, hal_type_t type, hal_pin_dir_t dir,
     /* validate passed in pointer - must point to HAL shmem */
     if (! SHMCHK(data_ptr_addr)) {
 	/* bad pointer */
-	rtapi_mutex_give(&(hal_data->mutex));
+	halpr_unlock();
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: data_ptr_addr not in shared memory\n");
 	return -EINVAL;
     }
     if(comp->ready) {
-	rtapi_mutex_give(&(hal_data->mutex));
+	halpr_unlock();
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: pin_new called after hal_ready\n");
 	return -EINVAL;
@@ -673,7 +745,7 @@ int hal_pin_new(const char *name, hal_type_t type, hal_pin_dir_t dir,
     new = alloc_pin_struct();
     if (new == 0) {
 	/* alloc failed */
-	rtapi_mutex_give(&(hal_data->mutex));
+	halpr_unlock();
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: insufficient memory for pin '%s'\n", name);
 	return -ENOMEM;
@@ -696,7 +768,8 @@ int hal_pin_new(const char *name, hal_type_t type, hal_pin_dir_t dir,
 	    /* reached end of list, insert here */
 	    new->next_ptr = next;
 	    *prev = SHMOFF(new);
-	    rtapi_mutex_give(&(hal_data->mutex));
+	    hash_add(PIN_BUCKET(new->name), new, &new->hash_next);
+	    halpr_unlock();
 	    return 0;
 	}
 	ptr = SHMPTR(next);
@@ -705,13 +778,14 @@ int hal_pin_new(const char *name, hal_type_t type, hal_pin_dir_t dir,
 	    /* found the right place for it, insert here */
 	    new->next_ptr = next;
 	    *prev = SHMOFF(new);
-	    rtapi_mutex_give(&(hal_data->mutex));
+	    hash_add(PIN_BUCKET(new->name), new, &new->hash_next);
+	    halpr_unlock();
 	    return 0;
 	}
 	if (cmp == 0) {
 	    /* name already in list, can't insert */
 	    free_pin_struct(new);
-	    rtapi_mutex_give(&(hal_data->mutex));
+	    halpr_unlock();
 	    rtapi_print_msg(RTAPI_MSG_ERR,
 		"HAL: ERROR: duplicate variable '%s'\n", name);
 	    return -EINVAL;
@@ -746,11 +820,11 @@ int hal_pin_alias(const char *pin_name, const char *alias)
 	}
     }
     /* get mutex before accessing shared data */
-    rtapi_mutex_get(&(hal_data->mutex));
+    halpr_lock();
     if (alias != NULL ) {
 	pin = halpr_find_pin_by_name(alias);
 	if ( pin != NULL ) {
-	    rtapi_mutex_give(&(hal_data->mutex));
+	    halpr_unlock();
 	    rtapi_print_msg(RTAPI_MSG_ERR,
 	        "HAL: ERROR: duplicate pin/alias name '%s'\n", alias);
 	    return -EINVAL;
@@ -764,7 +838,7 @@ int hal_pin_alias(const char *pin_name, const char *alias)
        to succeed since at least one struct is on the free list. */
     oldname = halpr_alloc_oldname_struct();
     if ( oldname == NULL ) {
-	rtapi_mutex_give(&(hal_data->mutex));
+	halpr_unlock();
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: insufficient memory for pin_alias\n");
 	return -EINVAL;
@@ -776,7 +850,7 @@ int hal_pin_alias(const char *pin_name, const char *alias)
     while (1) {
 	if (next == 0) {
 	    /* reached end of list, not found */
-	    rtapi_mutex_give(&(hal_data->mutex));
+	    halpr_unlock();
 	    rtapi_print_msg(RTAPI_MSG_ERR,
 		"HAL: ERROR: pin '%s' not found\n", pin_name);
 	    return -EINVAL;
@@ -799,6 +873,8 @@ int hal_pin_alias(const char *pin_name, const char *alias)
 	prev = &(pin->next_ptr);
 	next = *prev;
     }
+    /* it is filed under its current name, which may be about to change */
+    hash_remove(PIN_BUCKET(pin->name), pin, &pin->hash_next);
     if ( alias != NULL ) {
 	/* adding a new alias */
 	if ( pin->oldname == 0 ) {
@@ -806,6 +882,9 @@ int hal_pin_alias(const char *pin_name, const char *alias)
 	    oldname = halpr_alloc_oldname_struct();
 	    pin->oldname = SHMOFF(oldname);
 	    rtapi_snprintf(oldname->name, sizeof(oldname->name), "%s", pin->name);
+	    oldname->owner_ptr = SHMOFF(pin);
+	    hash_add(PIN_ALIAS_BUCKET(oldname->name), oldname,
+		&oldname->hash_next);
 	}
 	/* change pin's name to 'alias' */
 	rtapi_snprintf(pin->name, sizeof(pin->name), "%s", alias);
@@ -816,9 +895,12 @@ int hal_pin_alias(const char *pin_name, const char *alias)
 	    oldname = SHMPTR(pin->oldname);
 	    rtapi_snprintf(pin->name, sizeof(pin->name), "%s", oldname->name);
 	    pin->oldname = 0;
+	    hash_remove(PIN_ALIAS_BUCKET(oldname->name), oldname,
+		&oldname->hash_next);
 	    free_oldname_struct(oldname);
 	}
     }
+    hash_add(PIN_BUCKET(pin->name), pin, &pin->hash_next);
     /* insert pin back into list in proper place */
     prev = &(hal_data->pin_list_ptr);
     next = *prev;
@@ -827,7 +909,7 @@ int hal_pin_alias(const char *pin_name, const char *alias)
 	    /* reached end of list, insert here */
 	    pin->next_ptr = next;
 	    *prev = SHMOFF(pin);
-	    rtapi_mutex_give(&(hal_data->mutex));
+	    halpr_unlock();
 	    return 0;
 	}
 	ptr = SHMPTR(next);
@@ -836,7 +918,7 @@ int hal_pin_alias(const char *pin_name, const char *alias)
 	    /* found the right place for it, insert here */
 	    pin->next_ptr = next;
 	    *prev = SHMOFF(pin);
-	    rtapi_mutex_give(&(hal_data->mutex));
+	    halpr_unlock();
 	    return 0;
 	}
 	/* didn't find it yet, look at next one */
@@ -875,10 +957,10 @@ int hal_signal_new(const char *name, hal_type_t type)
 
     rtapi_print_msg(RTAPI_MSG_DBG, "HAL: creating signal '%s'\n", name);
     /* get mutex before accessing shared data */
-    rtapi_mutex_get(&(hal_data->mutex));
+    halpr_lock();
     /* check for an existing signal with the same name */
     if (halpr_find_sig_by_name(name) != 0) {
-	rtapi_mutex_give(&(hal_data->mutex));
+	halpr_unlock();
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: duplicate signal '%s'\n", name);
 	return -EINVAL;
@@ -898,7 +980,7 @@ int hal_signal_new(const char *name, hal_type_t type)
 	data_addr = shmalloc_up(sizeof(hal_float_t));
 	break;
     default:
-	rtapi_mutex_give(&(hal_data->mutex));
+	halpr_unlock();
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: illegal signal type %d'\n", type);
 	return -EINVAL;
@@ -908,7 +990,7 @@ int hal_signal_new(const char *name, hal_type_t type)
     new = alloc_sig_struct();
     if ((new == 0) || (data_addr == 0)) {
 	/* alloc failed */
-	rtapi_mutex_give(&(hal_data->mutex));
+	halpr_unlock();
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: insufficient memory for signal '%s'\n", name);
 	return -ENOMEM;
@@ -945,7 +1027,8 @@ int hal_signal_new(const char *name, hal_type_t type)
 	    /* reached end of list, insert here */
 	    new->next_ptr = next;
 	    *prev = SHMOFF(new);
-	    rtapi_mutex_give(&(hal_data->mutex));
+	    hash_add(SIG_BUCKET(new->name), new, &new->hash_next);
+	    halpr_unlock();
 	    return 0;
 	}
 	ptr = SHMPTR(next);
@@ -954,7 +1037,8 @@ int hal_signal_new(const char *name, hal_type_t type)
 	    /* found the right place for it, insert here */
 	    new->next_ptr = next;
 	    *prev = SHMOFF(new);
-	    rtapi_mutex_give(&(hal_data->mutex));
+	    hash_add(SIG_BUCKET(new->name), new, &new->hash_next);
+	    halpr_unlock();
 	    return 0;
 	}
 	/* didn't find it yet, look at next one */
@@ -982,7 +1066,7 @@ int hal_signal_delete(const char *name)
     
     rtapi_print_msg(RTAPI_MSG_DBG, "HAL: deleting signal '%s'\n", name);
     /* get mutex before accessing shared data */
-    rtapi_mutex_get(&(hal_data->mutex));
+    halpr_lock();
     /* search for the signal */
     prev = &(hal_data->sig_list_ptr);
     next = *prev;
@@ -994,7 +1078,7 @@ int hal_signal_delete(const char *name)
 	    /* and delete it */
 	    free_sig_struct(sig);
 	    /* done */
-	    rtapi_mutex_give(&(hal_data->mutex));
+	    halpr_unlock();
 	    return 0;
 	}
 	/* no match, try the next one */
@@ -1002,7 +1086,7 @@ int hal_signal_delete(const char *name)
 	next = *prev;
     }
     /* if we get here, we didn't find a match */
-    rtapi_mutex_give(&(hal_data->mutex));
+    halpr_unlock();
     rtapi_print_msg(RTAPI_MSG_ERR, "HAL: ERROR: signal '%s' not found\n",
 	name);
     return -EINVAL;
@@ -1012,8 +1096,7 @@ int hal_link(const char *pin_name, const char *sig_name)
 {
     hal_pin_t *pin;
     hal_sig_t *sig;
-    hal_comp_t *comp;
-    void **data_ptr_addr, *data_addr;
+    int retval;
 
     if (hal_data == 0) {
 	rtapi_print_msg(RTAPI_MSG_ERR,
@@ -1039,12 +1122,12 @@ int hal_link(const char *pin_name, const char *sig_name)
     rtapi_print_msg(RTAPI_MSG_DBG,
 	"HAL: linking pin '%s' to '%s'\n", pin_name, sig_name);
     /* get mutex before accessing data structures */
-    rtapi_mutex_get(&(hal_data->mutex));
+    halpr_lock();
     /* locate the pin */
     pin = halpr_find_pin_by_name(pin_name);
     if (pin == 0) {
 	/* not found */
-	rtapi_mutex_give(&(hal_data->mutex));
+	halpr_unlock();
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: pin '%s' not found\n", pin_name);
 	return -EINVAL;
@@ -1053,48 +1136,54 @@ int hal_link(const char *pin_name, const char *sig_name)
     sig = halpr_find_sig_by_name(sig_name);
     if (sig == 0) {
 	/* not found */
-	rtapi_mutex_give(&(hal_data->mutex));
+	halpr_unlock();
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: signal '%s' not found\n", sig_name);
 	return -EINVAL;
     }
-    /* found both pin and signal, are they already connected? */
+    retval = halpr_link_pin(pin, sig);
+    /* done, release the mutex and return */
+    halpr_unlock();
+    return retval;
+}
+
+int halpr_link_pin(hal_pin_t *pin, hal_sig_t *sig)
+{
+    hal_comp_t *comp;
+    void **data_ptr_addr, *data_addr;
+
+    /* are they already connected? */
     if (SHMPTR(pin->signal) == sig) {
-	rtapi_mutex_give(&(hal_data->mutex));
 	rtapi_print_msg(RTAPI_MSG_WARN,
-	    "HAL: Warning: pin '%s' already linked to '%s'\n", pin_name, sig_name);
+	    "HAL: Warning: pin '%s' already linked to '%s'\n", pin->name, sig->name);
 	return 0;
     }
     /* is the pin connected to something else? */
     if(pin->signal) {
-	rtapi_mutex_give(&(hal_data->mutex));
-	sig = SHMPTR(pin->signal);
+	hal_sig_t *other = SHMPTR(pin->signal);
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: pin '%s' is linked to '%s', cannot link to '%s'\n",
-	    pin_name, sig->name, sig_name);
+	    pin->name, other->name, sig->name);
 	return -EINVAL;
     }
     /* check types */
     if (pin->type != sig->type) {
-	rtapi_mutex_give(&(hal_data->mutex));
 	rtapi_print_msg(RTAPI_MSG_ERR,
-	    "HAL: ERROR: type mismatch '%s' <- '%s'\n", pin_name, sig_name);
+	    "HAL: ERROR: type mismatch '%s' <- '%s'\n", pin->name, sig->name);
 	return -EINVAL;
     }
     /* linking output pin to sig that already has output or I/O pins? */
     if ((pin->dir == HAL_OUT) && ((sig->writers > 0) || (sig->bidirs > 0 ))) {
 	/* yes, can't do that */
-	rtapi_mutex_give(&(hal_data->mutex));
 	rtapi_print_msg(RTAPI_MSG_ERR,
-	    "HAL: ERROR: signal '%s' already has output or I/O pin(s)\n", sig_name);
+	    "HAL: ERROR: signal '%s' already has output or I/O pin(s)\n", sig->name);
 	return -EINVAL;
     }
     /* linking bidir pin to sig that already has output pin? */
     if ((pin->dir == HAL_IO) && (sig->writers > 0)) {
 	/* yes, can't do that */
-	rtapi_mutex_give(&(hal_data->mutex));
 	rtapi_print_msg(RTAPI_MSG_ERR,
-	    "HAL: ERROR: signal '%s' already has output pin\n", sig_name);
+	    "HAL: ERROR: signal '%s' already has output pin\n", sig->name);
 	return -EINVAL;
     }
     /* everything is OK, make the new link */
@@ -1148,8 +1237,6 @@ int hal_link(const char *pin_name, const char *sig_name)
     }
     /* and update the pin */
     pin->signal = SHMOFF(sig);
-    /* done, release the mutex and return */
-    rtapi_mutex_give(&(hal_data->mutex));
     return 0;
 }
 
@@ -1176,12 +1263,12 @@ int hal_unlink(const char *pin_name)
     rtapi_print_msg(RTAPI_MSG_DBG,
 	"HAL: unlinking pin '%s'\n", pin_name);
     /* get mutex before accessing data structures */
-    rtapi_mutex_get(&(hal_data->mutex));
+    halpr_lock();
     /* locate the pin */
     pin = halpr_find_pin_by_name(pin_name);
     if (pin == 0) {
 	/* not found */
-	rtapi_mutex_give(&(hal_data->mutex));
+	halpr_unlock();
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: pin '%s' not found\n", pin_name);
 	return -EINVAL;
@@ -1189,7 +1276,7 @@ int hal_unlink(const char *pin_name)
     /* found pin, unlink it */
     unlink_pin(pin);
     /* done, release the mutex and return */
-    rtapi_mutex_give(&(hal_data->mutex));
+    halpr_unlock();
     return 0;
 }
 
@@ -1322,12 +1409,12 @@ int hal_param_new(const char *name, hal_type_t type, hal_param_dir_t dir, void *
 
     rtapi_print_msg(RTAPI_MSG_DBG, "HAL: creating parameter '%s'\n", name);
     /* get mutex before accessing shared data */
-    rtapi_mutex_get(&(hal_data->mutex));
+    halpr_lock();
     /* validate comp_id */
     comp = halpr_find_comp_by_id(comp_id);
     if (comp == 0) {
 	/* bad comp_id */
-	rtapi_mutex_give(&(hal_data->mutex));
+	halpr_unlock();
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: component %d not found\n", comp_id);
 	return -EINVAL;
@@ -1335,13 +1422,13 @@ int hal_param_new(const char *name, hal_type_t type, hal_param_dir_t dir, void *
     /* validate passed in pointer - must point to HAL shmem */
     if (! SHMCHK(data_addr)) {
 	/* bad pointer */
-	rtapi_mutex_give(&(hal_data->mutex));
+	halpr_unlock();
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: data_addr not in shared memory\n");
 	return -EINVAL;
     }
     if(comp->ready) {
-	rtapi_mutex_give(&(hal_data->mutex));
+	halpr_unlock();
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: param_new called after hal_ready\n");
 	return -EINVAL;
@@ -1350,7 +1437,7 @@ int hal_param_new(const char *name, hal_type_t type, hal_param_dir_t dir, void *
     new = alloc_param_struct();
     if (new == 0) {
 	/* alloc failed */
-	rtapi_mutex_give(&(hal_data->mutex));
+	halpr_unlock();
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: insufficient memory for parameter '%s'\n", name);
 	return -ENOMEM;
@@ -1369,7 +1456,8 @@ int hal_param_new(const char *name, hal_type_t type, hal_param_dir_t dir, void *
 	    /* reached end of list, insert here */
 	    new->next_ptr = next;
 	    *prev = SHMOFF(new);
-	    rtapi_mutex_give(&(hal_data->mutex));
+	    hash_add(PARAM_BUCKET(new->name), new, &new->hash_next);
+	    halpr_unlock();
 	    return 0;
 	}
 	ptr = SHMPTR(next);
@@ -1378,13 +1466,14 @@ int hal_param_new(const char *name, hal_type_t type, hal_param_dir_t dir, void *
 	    /* found the right place for it, insert here */
 	    new->next_ptr = next;
 	    *prev = SHMOFF(new);
-	    rtapi_mutex_give(&(hal_data->mutex));
+	    hash_add(PARAM_BUCKET(new->name), new, &new->hash_next);
+	    halpr_unlock();
 	    return 0;
 	}
 	if (cmp == 0) {
 	    /* name already in list, can't insert */
 	    free_param_struct(new);
-	    rtapi_mutex_give(&(hal_data->mutex));
+	    halpr_unlock();
 	    rtapi_print_msg(RTAPI_MSG_ERR,
 		"HAL: ERROR: duplicate parameter '%s'\n", name);
 	    return -EINVAL;
@@ -1438,27 +1527,27 @@ int hal_param_set(const char *name, hal_type_t type, void *value_addr)
     
     rtapi_print_msg(RTAPI_MSG_DBG, "HAL: setting parameter '%s'\n", name);
     /* get mutex before accessing shared data */
-    rtapi_mutex_get(&(hal_data->mutex));
+    halpr_lock();
 
     /* search param list for name */
     param = halpr_find_param_by_name(name);
     if (param == 0) {
 	/* parameter not found */
-	rtapi_mutex_give(&(hal_data->mutex));
+	halpr_unlock();
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: parameter '%s' not found\n", name);
 	return -EINVAL;
     }
     /* found it, is type compatible? */
     if (param->type != type) {
-	rtapi_mutex_give(&(hal_data->mutex));
+	halpr_unlock();
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: type mismatch setting param '%s'\n", name);
 	return -EINVAL;
     }
     /* is it read only? */
     if (param->dir == HAL_RO) {
-	rtapi_mutex_give(&(hal_data->mutex));
+	halpr_unlock();
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: param '%s' is not writable\n", name);
 	return -EINVAL;
@@ -1484,12 +1573,12 @@ int hal_param_set(const char *name, hal_type_t type, void *value_addr)
 	break;
     default:
 	/* Shouldn't get here, but just in case... */
-	rtapi_mutex_give(&(hal_data->mutex));
+	halpr_unlock();
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: bad type %d setting param\n", param->type);
 	return -EINVAL;
     }
-    rtapi_mutex_give(&(hal_data->mutex));
+    halpr_unlock();
     return 0;
 }
 
@@ -1517,11 +1606,11 @@ int hal_param_alias(const char *param_name, const char *alias)
 	}
     }
     /* get mutex before accessing shared data */
-    rtapi_mutex_get(&(hal_data->mutex));
+    halpr_lock();
     if (alias != NULL ) {
 	param = halpr_find_param_by_name(alias);
 	if ( param != NULL ) {
-	    rtapi_mutex_give(&(hal_data->mutex));
+	    halpr_unlock();
 	    rtapi_print_msg(RTAPI_MSG_ERR,
 	        "HAL: ERROR: duplicate pin/alias name '%s'\n", alias);
 	    return -EINVAL;
@@ -1535,7 +1624,7 @@ int hal_param_alias(const char *param_name, const char *alias)
        to succeed since at least one struct is on the free list. */
     oldname = halpr_alloc_oldname_struct();
     if ( oldname == NULL ) {
-	rtapi_mutex_give(&(hal_data->mutex));
+	halpr_unlock();
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: insufficient memory for param_alias\n");
 	return -EINVAL;
@@ -1547,7 +1636,7 @@ int hal_param_alias(const char *param_name, const char *alias)
     while (1) {
 	if (next == 0) {
 	    /* reached end of list, not found */
-	    rtapi_mutex_give(&(hal_data->mutex));
+	    halpr_unlock();
 	    rtapi_print_msg(RTAPI_MSG_ERR,
 		"HAL: ERROR: param '%s' not found\n", param_name);
 	    return -EINVAL;
@@ -1570,6 +1659,8 @@ int hal_param_alias(const char *param_name, const char *alias)
 	prev = &(param->next_ptr);
 	next = *prev;
     }
+    /* it is filed under its current name, which may be about to change */
+    hash_remove(PARAM_BUCKET(param->name), param, &param->hash_next);
     if ( alias != NULL ) {
 	/* adding a new alias */
 	if ( param->oldname == 0 ) {
@@ -1577,6 +1668,9 @@ int hal_param_alias(const char *param_name, const char *alias)
 	    oldname = halpr_alloc_oldname_struct();
 	    param->oldname = SHMOFF(oldname);
 	    rtapi_snprintf(oldname->name, sizeof(oldname->name), "%s", param->name);
+	    oldname->owner_ptr = SHMOFF(param);
+	    hash_add(PARAM_ALIAS_BUCKET(oldname->name), oldname,
+		&oldname->hash_next);
 	}
 	/* change param's name to 'alias' */
 	rtapi_snprintf(param->name, sizeof(param->name), "%s", alias);
@@ -1587,9 +1681,12 @@ int hal_param_alias(const char *param_name, const char *alias)
 	    oldname = SHMPTR(param->oldname);
 	    rtapi_snprintf(param->name, sizeof(param->name), "%s", oldname->name);
 	    param->oldname = 0;
+	    hash_remove(PARAM_ALIAS_BUCKET(oldname->name), oldname,
+		&oldname->hash_next);
 	    free_oldname_struct(oldname);
 	}
     }
+    hash_add(PARAM_BUCKET(param->name), param, &param->hash_next);
     /* insert param back into list in proper place */
     prev = &(hal_data->param_list_ptr);
     next = *prev;
@@ -1598,7 +1695,7 @@ int hal_param_alias(const char *param_name, const char *alias)
 	    /* reached end of list, insert here */
 	    param->next_ptr = next;
 	    *prev = SHMOFF(param);
-	    rtapi_mutex_give(&(hal_data->mutex));
+	    halpr_unlock();
 	    return 0;
 	}
 	ptr = SHMPTR(next);
@@ -1607,7 +1704,7 @@ int hal_param_alias(const char *param_name, const char *alias)
 	    /* found the right place for it, insert here */
 	    param->next_ptr = next;
 	    *prev = SHMOFF(param);
-	    rtapi_mutex_give(&(hal_data->mutex));
+	    halpr_unlock();
 	    return 0;
 	}
 	/* didn't find it yet, look at next one */
@@ -1649,25 +1746,25 @@ int hal_export_funct(const char *name, void (*funct) (void *, long),
     
     rtapi_print_msg(RTAPI_MSG_DBG, "HAL: exporting function '%s'\n", name);
     /* get mutex before accessing shared data */
-    rtapi_mutex_get(&(hal_data->mutex));
+    halpr_lock();
     /* validate comp_id */
     comp = halpr_find_comp_by_id(comp_id);
     if (comp == 0) {
 	/* bad comp_id */
-	rtapi_mutex_give(&(hal_data->mutex));
+	halpr_unlock();
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: component %d not found\n", comp_id);
 	return -EINVAL;
     }
     if (comp->type == 0) {
 	/* not a realtime component */
-	rtapi_mutex_give(&(hal_data->mutex));
+	halpr_unlock();
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: component %d is not realtime\n", comp_id);
 	return -EINVAL;
     }
     if(comp->ready) {
-	rtapi_mutex_give(&(hal_data->mutex));
+	halpr_unlock();
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: export_funct called after hal_ready\n");
 	return -EINVAL;
@@ -1676,7 +1773,7 @@ int hal_export_funct(const char *name, void (*funct) (void *, long),
     new = alloc_funct_struct();
     if (new == 0) {
 	/* alloc failed */
-	rtapi_mutex_give(&(hal_data->mutex));
+	halpr_unlock();
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: insufficient memory for function '%s'\n", name);
 	return -ENOMEM;
@@ -1697,6 +1794,7 @@ int hal_export_funct(const char *name, void (*funct) (void *, long),
 	    /* reached end of list, insert here */
 	    new->next_ptr = next;
 	    *prev = SHMOFF(new);
+	    hash_add(FUNCT_BUCKET(new->name), new, &new->hash_next);
 	    /* break out of loop and init the new function */
 	    break;
 	}
@@ -1706,13 +1804,14 @@ int hal_export_funct(const char *name, void (*funct) (void *, long),
 	    /* found the right place for it, insert here */
 	    new->next_ptr = next;
 	    *prev = SHMOFF(new);
+	    hash_add(FUNCT_BUCKET(new->name), new, &new->hash_next);
 	    /* break out of loop and init the new function */
 	    break;
 	}
 	if (cmp == 0) {
 	    /* name already in list, can't insert */
 	    free_funct_struct(new);
-	    rtapi_mutex_give(&(hal_data->mutex));
+	    halpr_unlock();
 	    rtapi_print_msg(RTAPI_MSG_ERR,
 		"HAL: ERROR: duplicate function '%s'\n", name);
 	    return -EINVAL;
@@ -1722,7 +1821,7 @@ int hal_export_funct(const char *name, void (*funct) (void *, long),
 	next = *prev;
     }
     /* at this point we have a new function and can yield the mutex */
-    rtapi_mutex_give(&(hal_data->mutex));
+    halpr_unlock();
 
     /* create a pin with the function's runtime in it */
     if (hal_pin_s32_newf(HAL_OUT, &(new->runtime), comp_id,"%s.time",name)) {
@@ -1749,6 +1848,12 @@ int hal_export_funct(const char *name, void (*funct) (void *, long),
 }
 
 int hal_create_thread(const char *name, unsigned long period_nsec, int uses_fp)
+{
+    return hal_create_thread_cpu(name, period_nsec, uses_fp, -1);
+}
+
+int hal_create_thread_cpu(const char *name, unsigned long period_nsec,
+    int uses_fp, int cpu)
 {
     int next, cmp, prev_priority;
     int retval, n;
@@ -1781,7 +1886,7 @@ int hal_create_thread(const char *name, unsigned long period_nsec, int uses_fp)
     }
 
     /* get mutex before accessing shared data */
-    rtapi_mutex_get(&(hal_data->mutex));
+    halpr_lock();
     /* make sure name is unique on thread list */
     next = hal_data->thread_list_ptr;
     while (next != 0) {
@@ -1789,7 +1894,7 @@ int hal_create_thread(const char *name, unsigned long period_nsec, int uses_fp)
 	cmp = strcmp(tptr->name, name);
 	if (cmp == 0) {
 	    /* name already in list, can't insert */
-	    rtapi_mutex_give(&(hal_data->mutex));
+	    halpr_unlock();
 	    rtapi_print_msg(RTAPI_MSG_ERR,
 		"HAL: ERROR: duplicate thread name %s\n", name);
 	    return -EINVAL;
@@ -1801,7 +1906,7 @@ int hal_create_thread(const char *name, unsigned long period_nsec, int uses_fp)
     new = alloc_thread_struct();
     if (new == 0) {
 	/* alloc failed */
-	rtapi_mutex_give(&(hal_data->mutex));
+	halpr_unlock();
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: insufficient memory to create thread\n");
 	return -ENOMEM;
@@ -1818,7 +1923,7 @@ int hal_create_thread(const char *name, unsigned long period_nsec, int uses_fp)
 	    /* not running, start it */
 	    curr_period = rtapi_clock_set_period(period_nsec);
 	    if (curr_period < 0) {
-		rtapi_mutex_give(&(hal_data->mutex));
+		halpr_unlock();
 		rtapi_print_msg(RTAPI_MSG_ERR,
 		    "HAL_LIB: ERROR: clock_set_period returned %ld\n",
 		    curr_period);
@@ -1827,7 +1932,7 @@ int hal_create_thread(const char *name, unsigned long period_nsec, int uses_fp)
 	}
 	/* make sure period <= desired period (allow 1% roundoff error) */
 	if (curr_period > (period_nsec + (period_nsec / 100))) {
-	    rtapi_mutex_give(&(hal_data->mutex));
+	    halpr_unlock();
 	    rtapi_print_msg(RTAPI_MSG_ERR,
 		"HAL_LIB: ERROR: clock period too long: %ld\n", curr_period);
 	    return -EINVAL;
@@ -1849,7 +1954,7 @@ int hal_create_thread(const char *name, unsigned long period_nsec, int uses_fp)
 	prev_priority = tptr->priority;
     }
     if ( period_nsec < hal_data->base_period) { 
-	rtapi_mutex_give(&(hal_data->mutex));
+	halpr_unlock();
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL_LIB: ERROR: new thread period %ld is less than clock period %ld\n",
 	     period_nsec, hal_data->base_period);
@@ -1859,7 +1964,7 @@ int hal_create_thread(const char *name, unsigned long period_nsec, int uses_fp)
     n = (period_nsec + hal_data->base_period / 2) / hal_data->base_period;
     new->period = hal_data->base_period * n;
     if ( new->period < prev_period ) {
-	rtapi_mutex_give(&(hal_data->mutex));
+	halpr_unlock();
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL_LIB: ERROR: new thread period %ld is less than existing thread period %ld\n",
 	     period_nsec, prev_period);
@@ -1871,16 +1976,25 @@ int hal_create_thread(const char *name, unsigned long period_nsec, int uses_fp)
     retval = rtapi_task_new(thread_task, new, new->priority,
 	lib_module_id, HAL_STACKSIZE, uses_fp);
     if (retval < 0) {
-	rtapi_mutex_give(&(hal_data->mutex));
+	halpr_unlock();
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL_LIB: could not create task for thread %s\n", name);
 	return -EINVAL;
     }
     new->task_id = retval;
+    /* place task */
+    retval = rtapi_task_set_cpu(new->task_id, cpu);
+    if (retval < 0) {
+	rtapi_task_delete(new->task_id);
+	halpr_unlock();
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL_LIB: could not run thread %s on cpu %d\n", name, cpu);
+	return -EINVAL;
+    }
     /* start task */
     retval = rtapi_task_start(new->task_id, new->period);
     if (retval < 0) {
-	rtapi_mutex_give(&(hal_data->mutex));
+	halpr_unlock();
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL_LIB: could not start task for thread %s: %d\n", name, retval);
 	return -EINVAL;
@@ -1889,7 +2003,7 @@ int hal_create_thread(const char *name, unsigned long period_nsec, int uses_fp)
     new->next_ptr = hal_data->thread_list_ptr;
     hal_data->thread_list_ptr = SHMOFF(new);
     /* done, release mutex */
-    rtapi_mutex_give(&(hal_data->mutex));
+    halpr_unlock();
 
     rtapi_snprintf(buf,sizeof(buf), HAL_PSEUDO_COMP_PREFIX"%s",new->name); // pseudo prefix
     new->comp_id = hal_init(buf);
@@ -1907,6 +2021,34 @@ int hal_create_thread(const char *name, unsigned long period_nsec, int uses_fp)
         return -EINVAL;
     }
 
+    if (hal_param_s32_newf(HAL_RO, &(new->latency_min), new->comp_id,
+	    "%s.latency-min", new->name)
+	|| hal_param_s32_newf(HAL_RO, &(new->latency_max), new->comp_id,
+	    "%s.latency-max", new->name)
+	|| hal_param_s32_newf(HAL_RO, &(new->latency_mean), new->comp_id,
+	    "%s.latency-mean", new->name)
+	|| hal_param_u32_newf(HAL_RO, &(new->latency_count), new->comp_id,
+	    "%s.latency-count", new->name)
+	|| hal_param_bit_newf(HAL_RW, &(new->latency_reset), new->comp_id,
+	    "%s.latency-reset", new->name)
+	|| hal_param_u32_newf(HAL_RO, &(new->overruns), new->comp_id,
+	    "%s.overruns", new->name)
+	|| hal_param_s32_newf(HAL_RW, &(new->spin), new->comp_id,
+	    "%s.spin", new->name)) {
+        rtapi_print_msg(RTAPI_MSG_ERR,
+           "HAL: ERROR: fail to create latency params for '%s'\n", new->name);
+        return -EINVAL;
+    }
+    for (n = 0; n < HAL_LATENCY_BUCKETS; n++) {
+	if (hal_param_u32_newf(HAL_RO, &(new->latency_hist[n]), new->comp_id,
+		"%s.latency-hist-%d", new->name, n)) {
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+	       "HAL: ERROR: fail to create latency histogram for '%s'\n",
+	       new->name);
+	    return -EINVAL;
+	}
+    }
+
     if (hal_pin_s32_newf(HAL_OUT, &(new->runtime), new->comp_id,"%s.time",new->name)) {
         rtapi_print_msg(RTAPI_MSG_ERR,
            "HAL: ERROR: fail to create pin '%s.time'\n", new->name);
@@ -1938,7 +2080,7 @@ extern int hal_thread_delete(const char *name)
     
     rtapi_print_msg(RTAPI_MSG_DBG, "HAL: deleting thread '%s'\n", name);
     /* get mutex before accessing shared data */
-    rtapi_mutex_get(&(hal_data->mutex));
+    halpr_lock();
     /* search for the signal */
     prev = &(hal_data->thread_list_ptr);
     next = *prev;
@@ -1954,7 +2096,7 @@ extern int hal_thread_delete(const char *name)
 	    /* and delete it */
 	    free_thread_struct(thread);
 	    /* done */
-	    rtapi_mutex_give(&(hal_data->mutex));
+	    halpr_unlock();
 	    return 0;
 	}
 	/* no match, try the next one */
@@ -1962,15 +2104,83 @@ extern int hal_thread_delete(const char *name)
 	next = *prev;
     }
     /* if we get here, we didn't find a match */
-    rtapi_mutex_give(&(hal_data->mutex));
+    halpr_unlock();
     rtapi_print_msg(RTAPI_MSG_ERR, "HAL: ERROR: thread '%s' not found\n",
 	name);
     return -EINVAL;
 }
 
+int hal_thread_add_worker(const char *name, int cpu)
+{
+    hal_thread_t *thread;
+    int retval;
+
+    if (hal_data == 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: thread_add_worker called before init\n");
+	return -EINVAL;
+    }
+    if (cpu < 0) {
+	/* on the CPU of the thread, a worker would only get in its way */
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: the worker of thread '%s' needs a cpu\n", name);
+	return -EINVAL;
+    }
+    if (!rtapi_is_realtime()) {
+	/* without realtime, tasks take turns and a worker can't help */
+	rtapi_print_msg(RTAPI_MSG_INFO,
+	    "HAL: not realtime, thread '%s' runs without workers\n", name);
+	return 0;
+    }
+    halpr_lock();
+    thread = halpr_find_thread_by_name(name);
+    if (thread == 0) {
+	halpr_unlock();
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: thread '%s' not found\n", name);
+	return -EINVAL;
+    }
+    if (thread->workers == HAL_MAX_WORKERS) {
+	halpr_unlock();
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: thread '%s' has %d workers already\n", name,
+	    HAL_MAX_WORKERS);
+	return -EINVAL;
+    }
+    /* workers run at the priority of their thread */
+    retval = rtapi_task_new(worker_task, thread, thread->priority,
+	lib_module_id, HAL_STACKSIZE, thread->uses_fp);
+    if (retval < 0) {
+	halpr_unlock();
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL_LIB: could not create worker task for thread %s\n", name);
+	return -EINVAL;
+    }
+    thread->worker_ids[thread->workers] = retval;
+    if (rtapi_task_set_cpu(retval, cpu) < 0
+	|| rtapi_task_start(retval, thread->period) < 0) {
+	rtapi_task_delete(retval);
+	halpr_unlock();
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL_LIB: could not start worker of thread %s on cpu %d\n",
+	    name, cpu);
+	return -EINVAL;
+    }
+    thread->workers++;
+    halpr_unlock();
+    return 0;
+}
+
 #endif /* RTAPI */
 
 int hal_add_funct_to_thread(const char *funct_name, const char *thread_name, int position)
+{
+    return hal_add_funct_to_thread_barrier(funct_name, thread_name,
+	position, 0);
+}
+
+int hal_add_funct_to_thread_barrier(const char *funct_name,
+    const char *thread_name, int position, int barrier)
 {
     hal_thread_t *thread;
     hal_funct_t *funct;
@@ -1994,25 +2204,25 @@ int hal_add_funct_to_thread(const char *funct_name, const char *thread_name, int
 	"HAL: adding function '%s' to thread '%s'\n",
 	funct_name, thread_name);
     /* get mutex before accessing data structures */
-    rtapi_mutex_get(&(hal_data->mutex));
+    halpr_lock();
     /* make sure position is valid */
     if (position == 0) {
 	/* zero is not allowed */
-	rtapi_mutex_give(&(hal_data->mutex));
+	halpr_unlock();
 	rtapi_print_msg(RTAPI_MSG_ERR, "HAL: ERROR: bad position: 0\n");
 	return -EINVAL;
     }
     /* make sure we were given a function name */
     if (funct_name == 0) {
 	/* no name supplied */
-	rtapi_mutex_give(&(hal_data->mutex));
+	halpr_unlock();
 	rtapi_print_msg(RTAPI_MSG_ERR, "HAL: ERROR: missing function name\n");
 	return -EINVAL;
     }
     /* make sure we were given a thread name */
     if (thread_name == 0) {
 	/* no name supplied */
-	rtapi_mutex_give(&(hal_data->mutex));
+	halpr_unlock();
 	rtapi_print_msg(RTAPI_MSG_ERR, "HAL: ERROR: missing thread name\n");
 	return -EINVAL;
     }
@@ -2020,14 +2230,14 @@ int hal_add_funct_to_thread(const char *funct_name, const char *thread_name, int
     funct = halpr_find_funct_by_name(funct_name);
     if (funct == 0) {
 	/* function not found */
-	rtapi_mutex_give(&(hal_data->mutex));
+	halpr_unlock();
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: function '%s' not found\n", funct_name);
 	return -EINVAL;
     }
     /* found the function, is it available? */
     if ((funct->users > 0) && (funct->reentrant == 0)) {
-	rtapi_mutex_give(&(hal_data->mutex));
+	halpr_unlock();
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: function '%s' may only be added to one thread\n", funct_name);
 	return -EINVAL;
@@ -2036,14 +2246,14 @@ int hal_add_funct_to_thread(const char *funct_name, const char *thread_name, int
     thread = halpr_find_thread_by_name(thread_name);
     if (thread == 0) {
 	/* thread not found */
-	rtapi_mutex_give(&(hal_data->mutex));
+	halpr_unlock();
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: thread '%s' not found\n", thread_name);
 	return -EINVAL;
     }
     /* ok, we have thread and function, are they compatible? */
     if ((funct->uses_fp) && (!thread->uses_fp)) {
-	rtapi_mutex_give(&(hal_data->mutex));
+	halpr_unlock();
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: function '%s' needs FP\n", funct_name);
 	return -EINVAL;
@@ -2059,7 +2269,7 @@ int hal_add_funct_to_thread(const char *funct_name, const char *thread_name, int
 	    list_entry = list_next(list_entry);
 	    if (list_entry == list_root) {
 		/* reached end of list */
-		rtapi_mutex_give(&(hal_data->mutex));
+		halpr_unlock();
 		rtapi_print_msg(RTAPI_MSG_ERR,
 		    "HAL: ERROR: position '%d' is too high\n", position);
 		return -EINVAL;
@@ -2072,7 +2282,7 @@ int hal_add_funct_to_thread(const char *funct_name, const char *thread_name, int
 	    list_entry = list_prev(list_entry);
 	    if (list_entry == list_root) {
 		/* reached end of list */
-		rtapi_mutex_give(&(hal_data->mutex));
+		halpr_unlock();
 		rtapi_print_msg(RTAPI_MSG_ERR,
 		    "HAL: ERROR: position '%d' is too low\n", position);
 		return -EINVAL;
@@ -2085,7 +2295,7 @@ int hal_add_funct_to_thread(const char *funct_name, const char *thread_name, int
     funct_entry = alloc_funct_entry_struct();
     if (funct_entry == 0) {
 	/* alloc failed */
-	rtapi_mutex_give(&(hal_data->mutex));
+	halpr_unlock();
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: insufficient memory for thread->function link\n");
 	return -ENOMEM;
@@ -2094,11 +2304,16 @@ int hal_add_funct_to_thread(const char *funct_name, const char *thread_name, int
     funct_entry->funct_ptr = SHMOFF(funct);
     funct_entry->arg = funct->arg;
     funct_entry->funct = funct->funct;
+    funct_entry->barrier = barrier != 0;
     /* add the entry to the list */
     list_add_after((hal_list_t *) funct_entry, list_entry);
     /* update the function usage count */
     funct->users++;
-    rtapi_mutex_give(&(hal_data->mutex));
+    /* a thread being profiled profiles its new function too */
+    if (thread->profile) {
+	profile_thread_functs(thread, 0);
+    }
+    halpr_unlock();
     return 0;
 }
 
@@ -2125,18 +2340,18 @@ int hal_del_funct_from_thread(const char *funct_name, const char *thread_name)
 	"HAL: removing function '%s' from thread '%s'\n",
 	funct_name, thread_name);
     /* get mutex before accessing data structures */
-    rtapi_mutex_get(&(hal_data->mutex));
+    halpr_lock();
     /* make sure we were given a function name */
     if (funct_name == 0) {
 	/* no name supplied */
-	rtapi_mutex_give(&(hal_data->mutex));
+	halpr_unlock();
 	rtapi_print_msg(RTAPI_MSG_ERR, "HAL: ERROR: missing function name\n");
 	return -EINVAL;
     }
     /* make sure we were given a thread name */
     if (thread_name == 0) {
 	/* no name supplied */
-	rtapi_mutex_give(&(hal_data->mutex));
+	halpr_unlock();
 	rtapi_print_msg(RTAPI_MSG_ERR, "HAL: ERROR: missing thread name\n");
 	return -EINVAL;
     }
@@ -2144,14 +2359,14 @@ int hal_del_funct_from_thread(const char *funct_name, const char *thread_name)
     funct = halpr_find_funct_by_name(funct_name);
     if (funct == 0) {
 	/* function not found */
-	rtapi_mutex_give(&(hal_data->mutex));
+	halpr_unlock();
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: function '%s' not found\n", funct_name);
 	return -EINVAL;
     }
     /* found the function, is it in use? */
     if (funct->users == 0) {
-	rtapi_mutex_give(&(hal_data->mutex));
+	halpr_unlock();
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: function '%s' is not in use\n", funct_name);
 	return -EINVAL;
@@ -2160,7 +2375,7 @@ int hal_del_funct_from_thread(const char *funct_name, const char *thread_name)
     thread = halpr_find_thread_by_name(thread_name);
     if (thread == 0) {
 	/* thread not found */
-	rtapi_mutex_give(&(hal_data->mutex));
+	halpr_unlock();
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: thread '%s' not found\n", thread_name);
 	return -EINVAL;
@@ -2171,7 +2386,7 @@ int hal_del_funct_from_thread(const char *funct_name, const char *thread_name)
     while (1) {
 	if (list_entry == list_root) {
 	    /* reached end of list, funct not found */
-	    rtapi_mutex_give(&(hal_data->mutex));
+	    halpr_unlock();
 	    rtapi_print_msg(RTAPI_MSG_ERR,
 		"HAL: ERROR: thread '%s' doesn't use %s\n", thread_name,
 		funct_name);
@@ -2184,7 +2399,7 @@ int hal_del_funct_from_thread(const char *funct_name, const char *thread_name)
 	    /* and delete it */
 	    free_funct_entry_struct(funct_entry);
 	    /* done */
-	    rtapi_mutex_give(&(hal_data->mutex));
+	    halpr_unlock();
 	    return 0;
 	}
 	/* try next one */
@@ -2192,6 +2407,85 @@ int hal_del_funct_from_thread(const char *funct_name, const char *thread_name)
     }
 }
 
+static int profile_thread_functs(hal_thread_t *thread, int clear)
+{
+    hal_list_t *list_root, *list_entry;
+    hal_funct_entry_t *funct_entry;
+    hal_funct_t *funct;
+    hal_profile_t *prof;
+
+    list_root = &(thread->funct_list);
+    list_entry = list_next(list_root);
+    while (list_entry != list_root) {
+	funct_entry = (hal_funct_entry_t *) list_entry;
+	funct = SHMPTR(funct_entry->funct_ptr);
+	if (funct->profile_ptr == 0) {
+	    prof = shmalloc_up(sizeof(hal_profile_t));
+	    if (prof == 0) {
+		rtapi_print_msg(RTAPI_MSG_ERR,
+		    "HAL: ERROR: insufficient memory for profile of '%s'\n",
+		    funct->name);
+		return -ENOMEM;
+	    }
+	    memset(prof, 0, sizeof(hal_profile_t));
+	    funct->profile_ptr = SHMOFF(prof);
+	} else if (clear) {
+	    memset(SHMPTR(funct->profile_ptr), 0, sizeof(hal_profile_t));
+	}
+	list_entry = list_next(list_entry);
+    }
+    return 0;
+}
+
+static int set_thread_profile(const char *thread_name, int enable, int clear)
+{
+    hal_thread_t *thread;
+    int next, retval = 0, found = 0;
+
+    if (hal_data == 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: thread_profile called before init\n");
+	return -EINVAL;
+    }
+    halpr_lock();
+    next = hal_data->thread_list_ptr;
+    while (next != 0 && retval == 0) {
+	thread = SHMPTR(next);
+	if (thread_name == 0 || strcmp(thread->name, thread_name) == 0) {
+	    found = 1;
+	    if (enable >= 0) {
+		if (enable) {
+		    retval = profile_thread_functs(thread, 0);
+		}
+		if (retval == 0) {
+		    thread->profile = enable;
+		}
+	    }
+	    if (clear && retval == 0) {
+		retval = profile_thread_functs(thread, 1);
+	    }
+	}
+	next = thread->next_ptr;
+    }
+    halpr_unlock();
+    if (thread_name != 0 && !found) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: thread '%s' not found\n", thread_name);
+	return -EINVAL;
+    }
+    return retval;
+}
+
+int hal_set_thread_profile(const char *thread_name, int enable)
+{
+    return set_thread_profile(thread_name, enable != 0, 0);
+}
+
+int hal_reset_thread_profile(const char *thread_name)
+{
+    return set_thread_profile(thread_name, -1, 1);
+}
+
 int hal_start_threads(void)
 {
     /* a trivial function for a change! */
@@ -2233,6 +2527,134 @@ int hal_stop_threads(void)
     return 0;
 }
 
+/* moves the value of 'sig' to newly allocated memory at the current
+   bottom of the arena and points every linked pin at it; caller holds
+   the mutex */
+static int relocate_signal(hal_sig_t *sig)
+{
+    hal_pin_t *pin;
+    hal_comp_t *comp;
+    void *new_addr, *old_addr, **data_ptr_addr;
+    long int size;
+    int next;
+
+    switch (sig->type) {
+    case HAL_BIT:
+	size = sizeof(hal_bit_t);
+	break;
+    case HAL_S32:
+	size = sizeof(hal_s32_t);
+	break;
+    case HAL_U32:
+	size = sizeof(hal_u32_t);
+	break;
+    case HAL_FLOAT:
+	size = sizeof(hal_float_t);
+	break;
+    default:
+	return -EINVAL;
+    }
+    new_addr = shmalloc_up(size);
+    if (new_addr == 0) {
+	return -ENOMEM;
+    }
+    old_addr = SHMPTR(sig->data_ptr);
+    memcpy(new_addr, old_addr, size);
+    sig->data_ptr = SHMOFF(new_addr);
+    /* rewrite the pointers of all linked pins, in their owners' mapping */
+    next = hal_data->pin_list_ptr;
+    while (next != 0) {
+	pin = SHMPTR(next);
+	if (pin->signal == SHMOFF(sig)) {
+	    comp = SHMPTR(pin->owner_ptr);
+	    data_ptr_addr = SHMPTR(pin->data_ptr_addr);
+	    *data_ptr_addr = comp->shmem_base + sig->data_ptr;
+	}
+	next = pin->next_ptr;
+    }
+    return 0;
+}
+
+int hal_compact_signals(void)
+{
+    hal_thread_t *thread;
+    hal_list_t *list_root, *list_entry;
+    hal_funct_entry_t *funct_entry;
+    hal_funct_t *funct;
+    hal_pin_t *pin;
+    hal_sig_t *sig;
+    long int run_start, pad;
+    int next_thread, next_pin, moved = 0, retval = 0;
+
+    if (hal_data == 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: compact_signals called before init\n");
+	return -EINVAL;
+    }
+    if (hal_data->lock & HAL_LOCK_CONFIG) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: compact_signals called while HAL is locked\n");
+	return -EPERM;
+    }
+    halpr_lock();
+    /* realtime code caches nothing but the pin pointers, which are about
+       to change under it, so the threads must not be running */
+    if (hal_data->threads_running > 0) {
+	halpr_unlock();
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: compact_signals called while threads are running\n");
+	return -EBUSY;
+    }
+    /* everything at or above run_start was allocated by this pass, which
+       is how a signal already moved (e.g. shared by two threads) is told
+       apart */
+    run_start = hal_data->shmem_bot;
+    next_thread = hal_data->thread_list_ptr;
+    while (next_thread != 0 && retval == 0) {
+	thread = SHMPTR(next_thread);
+	/* start each thread's block on a fresh cache line */
+	pad = ((hal_data->shmem_bot + HAL_CACHELINE - 1) & ~(HAL_CACHELINE - 1))
+	    - hal_data->shmem_bot;
+	if (pad > 0 && shmalloc_up(pad) == 0) {
+	    retval = -ENOMEM;
+	    break;
+	}
+	/* signals are laid out in the order the functions first touch them */
+	list_root = &(thread->funct_list);
+	list_entry = list_next(list_root);
+	while (list_entry != list_root && retval == 0) {
+	    funct_entry = (hal_funct_entry_t *) list_entry;
+	    funct = SHMPTR(funct_entry->funct_ptr);
+	    next_pin = hal_data->pin_list_ptr;
+	    while (next_pin != 0 && retval == 0) {
+		pin = SHMPTR(next_pin);
+		next_pin = pin->next_ptr;
+		if (pin->owner_ptr != funct->owner_ptr || pin->signal == 0) {
+		    continue;
+		}
+		sig = SHMPTR(pin->signal);
+		if (sig->data_ptr >= run_start) {
+		    continue;
+		}
+		retval = relocate_signal(sig);
+		moved++;
+	    }
+	    list_entry = list_next(list_entry);
+	}
+	next_thread = thread->next_ptr;
+    }
+    halpr_unlock();
+    if (retval != 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: insufficient memory to compact signals\n");
+	return retval;
+    }
+    rtapi_print_msg(RTAPI_MSG_DBG,
+	"HAL: compacted %d signals into %ld bytes\n", moved,
+	hal_data->shmem_bot - run_start);
+    return moved;
+}
+
 /***********************************************************************
 *                    PRIVATE FUNCTION CODE                             *
 ************************************************************************/
@@ -2309,6 +2731,42 @@ hal_list_t *list_remove_entry(hal_list_t * entry)
     return next;
 }
 
+static unsigned int hash_name(const char *name)
+{
+    unsigned int hash = 2166136261u;
+
+    /* FNV-1a */
+    while (*name != '\0') {
+	hash ^= (unsigned char) *name++;
+	hash *= 16777619u;
+    }
+    return hash;
+}
+
+static void hash_add(int *bucket, void *obj, int *link)
+{
+    *link = *bucket;
+    *bucket = SHMOFF(obj);
+}
+
+static void hash_remove(int *bucket, void *obj, int *link)
+{
+    int *prev, offset;
+
+    /* all objects in a bucket have their link at the same offset */
+    offset = (char *) link - (char *) obj;
+    prev = bucket;
+    while (*prev != 0) {
+	if (*prev == SHMOFF(obj)) {
+	    /* found it, unlink from bucket */
+	    *prev = *link;
+	    *link = 0;
+	    return;
+	}
+	prev = (int *) ((char *) SHMPTR(*prev) + offset);
+    }
+}
+
 hal_comp_t *halpr_find_comp_by_name(const char *name)
 {
     int next;
@@ -2335,23 +2793,26 @@ hal_pin_t *halpr_find_pin_by_name(const char *name)
     hal_pin_t *pin;
     hal_oldname_t *oldname;
 
-    /* search pin list for 'name' */
-    next = hal_data->pin_list_ptr;
+    /* search the bucket for 'name' */
+    next = *PIN_BUCKET(name);
     while (next != 0) {
 	pin = SHMPTR(next);
 	if (strcmp(pin->name, name) == 0) {
 	    /* found a match */
 	    return pin;
 	}
-	if (pin->oldname != 0 ) {
-	    oldname = SHMPTR(pin->oldname);
-	    if (strcmp(oldname->name, name) == 0) {
-		/* found a match */
-		return pin;
-	    }
-	}
 	/* didn't find it yet, look at next one */
-	next = pin->next_ptr;
+	next = pin->hash_next;
+    }
+    /* not a current name, but it may be the original name of an alias */
+    next = *PIN_ALIAS_BUCKET(name);
+    while (next != 0) {
+	oldname = SHMPTR(next);
+	if (strcmp(oldname->name, name) == 0) {
+	    /* found a match */
+	    return SHMPTR(oldname->owner_ptr);
+	}
+	next = oldname->hash_next;
     }
     /* if loop terminates, we reached end of list with no match */
     return 0;
@@ -2362,8 +2823,8 @@ hal_sig_t *halpr_find_sig_by_name(const char *name)
     int next;
     hal_sig_t *sig;
 
-    /* search signal list for 'name' */
-    next = hal_data->sig_list_ptr;
+    /* search the bucket for 'name' */
+    next = *SIG_BUCKET(name);
     while (next != 0) {
 	sig = SHMPTR(next);
 	if (strcmp(sig->name, name) == 0) {
@@ -2371,7 +2832,7 @@ hal_sig_t *halpr_find_sig_by_name(const char *name)
 	    return sig;
 	}
 	/* didn't find it yet, look at next one */
-	next = sig->next_ptr;
+	next = sig->hash_next;
     }
     /* if loop terminates, we reached end of list with no match */
     return 0;
@@ -2383,23 +2844,26 @@ hal_param_t *halpr_find_param_by_name(const char *name)
     hal_param_t *param;
     hal_oldname_t *oldname;
 
-    /* search parameter list for 'name' */
-    next = hal_data->param_list_ptr;
+    /* search the bucket for 'name' */
+    next = *PARAM_BUCKET(name);
     while (next != 0) {
 	param = SHMPTR(next);
 	if (strcmp(param->name, name) == 0) {
 	    /* found a match */
 	    return param;
 	}
-	if (param->oldname != 0 ) {
-	    oldname = SHMPTR(param->oldname);
-	    if (strcmp(oldname->name, name) == 0) {
-		/* found a match */
-		return param;
-	    }
-	}
 	/* didn't find it yet, look at next one */
-	next = param->next_ptr;
+	next = param->hash_next;
+    }
+    /* not a current name, but it may be the original name of an alias */
+    next = *PARAM_ALIAS_BUCKET(name);
+    while (next != 0) {
+	oldname = SHMPTR(next);
+	if (strcmp(oldname->name, name) == 0) {
+	    /* found a match */
+	    return SHMPTR(oldname->owner_ptr);
+	}
+	next = oldname->hash_next;
     }
     /* if loop terminates, we reached end of list with no match */
     return 0;
@@ -2430,8 +2894,8 @@ hal_funct_t *halpr_find_funct_by_name(const char *name)
     int next;
     hal_funct_t *funct;
 
-    /* search function list for 'name' */
-    next = hal_data->funct_list_ptr;
+    /* search the bucket for 'name' */
+    next = *FUNCT_BUCKET(name);
     while (next != 0) {
 	funct = SHMPTR(next);
 	if (strcmp(funct->name, name) == 0) {
@@ -2439,7 +2903,7 @@ hal_funct_t *halpr_find_funct_by_name(const char *name)
 	    return funct;
 	}
 	/* didn't find it yet, look at next one */
-	next = funct->next_ptr;
+	next = funct->hash_next;
     }
     /* if loop terminates, we reached end of list with no match */
     return 0;
@@ -2644,8 +3108,17 @@ int rtapi_app_main(void)
 	rtapi_print_msg(RTAPI_MSG_ERR, "HAL_LIB: ERROR: rtapi init failed\n");
 	return -EINVAL;
     }
+    /* whole pages, no smaller than the default */
+    if (hal_size < HAL_SIZE || hal_size > HAL_SIZE_MAX) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL_LIB: ERROR: hal_size must be between %ld and %ld\n",
+	    (long)HAL_SIZE, (long)HAL_SIZE_MAX);
+	rtapi_exit(lib_module_id);
+	return -EINVAL;
+    }
+    hal_size = (hal_size + 4095) & ~4095L;
     /* get HAL shared memory block from RTAPI */
-    lib_mem_id = rtapi_shmem_new(HAL_KEY, lib_module_id, HAL_SIZE);
+    lib_mem_id = rtapi_shmem_new(HAL_KEY, lib_module_id, hal_size);
     if (lib_mem_id < 0) {
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL_LIB: ERROR: could not open shared memory\n");
@@ -2664,7 +3137,7 @@ int rtapi_app_main(void)
     hal_shmem_base = (char *) mem;
     hal_data = (hal_data_t *) mem;
     /* perform a global init if needed */
-    retval = init_hal_data();
+    retval = init_hal_data(hal_size);
     if ( retval ) {
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL_LIB: ERROR: could not init shared memory\n");
@@ -2691,7 +3164,7 @@ void rtapi_app_exit(void)
     rtapi_print_msg(RTAPI_MSG_DBG, "HAL_LIB: removing kernel lib\n");
     hal_proc_clean();
     /* grab mutex before manipulating list */
-    rtapi_mutex_get(&(hal_data->mutex));
+    halpr_lock();
     /* must remove all threads before unloading this module */
     while (hal_data->thread_list_ptr != 0) {
 	/* point to a thread */
@@ -2702,7 +3175,7 @@ void rtapi_app_exit(void)
 	free_thread_struct(thread);
     }
     /* release mutex */
-    rtapi_mutex_give(&(hal_data->mutex));
+    halpr_unlock();
     /* release RTAPI resources */
     rtapi_shmem_delete(lib_mem_id, lib_module_id);
     rtapi_exit(lib_module_id);
@@ -2713,6 +3186,197 @@ void rtapi_app_exit(void)
 
 /* this is the task function that implements threads in realtime */
 
+/* adds one run of 'cycles' to a function profile */
+static void profile_record(hal_profile_t *prof, long long int cycles)
+{
+    int bucket = 0;
+
+    while (cycles > 1 && bucket < HAL_PROFILE_BUCKETS - 1) {
+	cycles >>= 1;
+	bucket++;
+    }
+    prof->hist[bucket]++;
+    prof->calls++;
+}
+
+/* records the wakeup at 'now', in nsec, in the latency statistics */
+static void latency_record(hal_thread_t *thread, long long int now)
+{
+    long long int latency;
+    int bucket;
+
+    if (thread->latency_reset) {
+	thread->latency_sum = 0;
+	thread->latency_min = 0;
+	thread->latency_max = 0;
+	thread->latency_mean = 0;
+	thread->latency_count = 0;
+	for (bucket = 0; bucket < HAL_LATENCY_BUCKETS; bucket++) {
+	    thread->latency_hist[bucket] = 0;
+	}
+	thread->overruns = 0;
+	thread->latency_reset = 0;
+    }
+    if (thread->next_start == 0) {
+	/* first wakeup, assume it was on time */
+	thread->next_start = now + thread->period;
+	return;
+    }
+    latency = now - thread->next_start;
+    thread->next_start += thread->period;
+    if (latency < 0) {
+	/* earlier than expected, so the first wakeup was late */
+	thread->next_start += latency;
+	latency = 0;
+    }
+    if (latency > 0x7fffffff) {
+	latency = 0x7fffffff;
+    }
+    if (thread->latency_count == 0 || latency < thread->latency_min) {
+	thread->latency_min = latency;
+    }
+    if (latency > thread->latency_max) {
+	thread->latency_max = latency;
+    }
+    /* halve the sums well before they overflow, to keep a mean */
+    if (thread->latency_count >= 0x80000000u) {
+	thread->latency_count >>= 1;
+	thread->latency_sum >>= 1;
+    }
+    thread->latency_sum += latency;
+    thread->latency_count++;
+    thread->latency_mean =
+	rtapi_div_u64(thread->latency_sum, thread->latency_count);
+    for (bucket = 0; bucket < HAL_LATENCY_BUCKETS - 1; bucket++) {
+	if (latency < (1000LL << bucket)) {
+	    break;
+	}
+    }
+    thread->latency_hist[bucket]++;
+    /* and in those of the CPU it woke up on */
+    thread->cpu = rtapi_cpu_self();
+    if (thread->cpu >= 0 && thread->cpu < HAL_MAX_CPUS) {
+	hal_cpu_latency_t *cpu = &hal_data->cpu_latency[thread->cpu];
+	if (cpu->count >= 0x80000000u) {
+	    cpu->count >>= 1;
+	    cpu->sum >>= 1;
+	}
+	cpu->count++;
+	cpu->sum += latency;
+	if (latency > cpu->max) {
+	    cpu->max = latency;
+	}
+	cpu->hist[bucket]++;
+    }
+}
+
+/* runs one funct and updates its execution time data */
+static void run_funct(hal_thread_t *thread, hal_funct_entry_t *funct_entry,
+    int profile)
+{
+    hal_funct_t *funct;
+    long long int start_time, end_time;
+
+    start_time = rtapi_get_clocks();
+    funct_entry->funct(funct_entry->arg, thread->period);
+    end_time = rtapi_get_clocks();
+    funct = SHMPTR(funct_entry->funct_ptr);
+    *(funct->runtime) = (hal_s32_t)(end_time - start_time);
+    if ( *(funct->runtime) > funct->maxtime) {
+	funct->maxtime = *(funct->runtime);
+	funct->maxtime_increased = 1;
+    } else {
+	funct->maxtime_increased = 0;
+    }
+    if (profile && funct->profile_ptr) {
+	profile_record(SHMPTR(funct->profile_ptr), end_time - start_time);
+    }
+}
+
+/* takes and runs functs of the current stage of 'thread' until none
+   are left; the thread and its workers all call this */
+static void run_stage(hal_thread_t *thread, int profile)
+{
+    unsigned long long ticket;
+    hal_list_t *entry;
+    unsigned int n;
+
+    ticket = __atomic_load_n(&thread->ticket, __ATOMIC_ACQUIRE);
+    while ((ticket & 0xffff) < ((ticket >> 16) & 0xffff)) {
+	/* on failure the ticket is reloaded, and we try again */
+	if (!__atomic_compare_exchange_n(&thread->ticket, &ticket,
+		ticket + 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+	    continue;
+	}
+	/* the stage can't end before this funct is done */
+	entry = SHMPTR(thread->stage_first);
+	for (n = ticket & 0xffff; n > 0; n--) {
+	    entry = list_next(entry);
+	}
+	run_funct(thread, (hal_funct_entry_t *) entry, profile);
+	__atomic_fetch_add(&thread->stage_done, 1, __ATOMIC_RELEASE);
+	ticket = __atomic_load_n(&thread->ticket, __ATOMIC_ACQUIRE);
+    }
+}
+
+/* runs the function list of a thread with workers, a stage at a time */
+static void run_stages(hal_thread_t *thread, int profile)
+{
+    hal_list_t *funct_root, *first, *last;
+    unsigned long long seq;
+    int n;
+
+    funct_root = &(thread->funct_list);
+    first = list_next(funct_root);
+    seq = thread->ticket >> 32;
+    while (first != funct_root) {
+	/* the stage runs up to the next barrier */
+	n = 1;
+	last = list_next(first);
+	while (last != funct_root && !((hal_funct_entry_t *) last)->barrier
+		&& n < 0xffff) {
+	    last = list_next(last);
+	    n++;
+	}
+	if (n == 1) {
+	    run_funct(thread, (hal_funct_entry_t *) first, profile);
+	} else {
+	    thread->stage_first = SHMOFF(first);
+	    thread->stage_done = 0;
+	    seq++;
+	    __atomic_store_n(&thread->ticket,
+		(seq << 32) | ((unsigned long long) n << 16), __ATOMIC_RELEASE);
+	    run_stage(thread, profile);
+	    /* wait for the functs the workers took */
+	    while (__atomic_load_n(&thread->stage_done, __ATOMIC_ACQUIRE) < n)
+		;
+	}
+	first = last;
+    }
+    __atomic_store_n(&thread->cycle, thread->cycle + 1, __ATOMIC_RELEASE);
+}
+
+static void worker_task(void *arg)
+{
+    hal_thread_t *thread;
+    unsigned int cycle;
+    long long int give_up;
+
+    thread = arg;
+    while (1) {
+	/* help until the thread finishes the period, but if it doesn't
+	   in half a period, sleep rather than hog the CPU */
+	cycle = __atomic_load_n(&thread->cycle, __ATOMIC_ACQUIRE);
+	give_up = rtapi_get_time() + thread->period / 2;
+	while (hal_data->threads_running > 0
+		&& __atomic_load_n(&thread->cycle, __ATOMIC_ACQUIRE) == cycle
+		&& rtapi_get_time() < give_up) {
+	    run_stage(thread, thread->profile);
+	}
+	rtapi_wait();
+    }
+}
+
 static void thread_task(void *arg)
 {
     hal_thread_t *thread;
@@ -2720,10 +3384,20 @@ static void thread_task(void *arg)
     hal_funct_entry_t *funct_root, *funct_entry;
     long long int start_time, end_time;
     long long int thread_start_time;
+    int profile;
 
     thread = arg;
     while (1) {
-	if (hal_data->threads_running > 0) {
+	if (hal_data->threads_running > 0 && thread->workers > 0) {
+	    thread_start_time = rtapi_get_clocks();
+	    run_stages(thread, thread->profile);
+	    *(thread->runtime) =
+		(hal_s32_t)(rtapi_get_clocks() - thread_start_time);
+	    if ( *(thread->runtime) > thread->maxtime) {
+	        thread->maxtime = *(thread->runtime);
+	    }
+	} else if (hal_data->threads_running > 0) {
+	    profile = thread->profile;
 	    /* point at first function on function list */
 	    funct_root = (hal_funct_entry_t *) & (thread->funct_list);
 	    funct_entry = SHMPTR(funct_root->links.next);
@@ -2747,6 +3421,10 @@ static void thread_task(void *arg)
 		} else {
 		    funct->maxtime_increased = 0;
 		}
+		if (profile && funct->profile_ptr) {
+		    profile_record(SHMPTR(funct->profile_ptr),
+			end_time - start_time);
+		}
 		/* point to next next entry in list */
 		funct_entry = SHMPTR(funct_entry->links.next);
 		/* prepare to measure time for next funct */
@@ -2758,8 +3436,17 @@ static void thread_task(void *arg)
 	        thread->maxtime = *(thread->runtime);
 	    }
 	}
+	/* did the functs run into the next period? */
+	if (thread->next_start != 0 && rtapi_get_time() > thread->next_start) {
+	    thread->overruns++;
+	}
+	if (thread->spin != thread->spin_set) {
+	    rtapi_task_set_spin(thread->task_id, thread->spin);
+	    thread->spin_set = thread->spin;
+	}
 	/* wait until next period */
 	rtapi_wait();
+	latency_record(thread, rtapi_get_time());
     }
 }
 #endif /* RTAPI */
@@ -2768,7 +3455,7 @@ static void thread_task(void *arg)
    a description of what they do.
 */
 
-static int init_hal_data(void)
+static int init_hal_data(long int size)
 {
     /* has the block already been initialized? */
     if (hal_data->version != 0) {
@@ -2785,6 +3472,7 @@ static int init_hal_data(void)
     rtapi_mutex_try(&(hal_data->mutex));
     /* set version code so nobody else init's the block */
     hal_data->version = HAL_VER;
+    hal_data->seq = 0;
     /* initialize everything */
     hal_data->comp_list_ptr = 0;
     hal_data->pin_list_ptr = 0;
@@ -2805,9 +3493,22 @@ static int init_hal_data(void)
     list_init_entry(&(hal_data->funct_entry_free));
     hal_data->thread_free_ptr = 0;
     hal_data->exact_base_period = 0;
+    memset(hal_data->pin_hash, 0, sizeof(hal_data->pin_hash));
+    memset(hal_data->cpu_latency, 0, sizeof(hal_data->cpu_latency));
+    memset(hal_data->sig_hash, 0, sizeof(hal_data->sig_hash));
+    memset(hal_data->param_hash, 0, sizeof(hal_data->param_hash));
+    memset(hal_data->funct_hash, 0, sizeof(hal_data->funct_hash));
+    memset(hal_data->pin_alias_hash, 0, sizeof(hal_data->pin_alias_hash));
+    memset(hal_data->param_alias_hash, 0, sizeof(hal_data->param_alias_hash));
+    hal_data->arena_owned_ptr = 0;
+    memset(hal_data->arena_free_ptr, 0, sizeof(hal_data->arena_free_ptr));
+    hal_data->arena_used = 0;
+    hal_data->arena_requested = 0;
+    hal_data->arena_free = 0;
     /* set up for shmalloc_xx() */
+    hal_data->shmem_size = size;
     hal_data->shmem_bot = sizeof(hal_data_t);
-    hal_data->shmem_top = HAL_SIZE;
+    hal_data->shmem_top = size;
     hal_data->lock = HAL_LOCK_NONE;
     /* done, release mutex */
     rtapi_mutex_give(&(hal_data->mutex));
@@ -2873,6 +3574,106 @@ static void *shmalloc_dn(long int size)
     return retval;
 }
 
+/* the size class of a block of 'size' bytes, header included */
+static int arena_class(long int size)
+{
+    int cls;
+
+    for (cls = 0; cls < HAL_ARENA_CLASSES - 1; cls++) {
+	if (size <= ((long int)HAL_ARENA_MIN_BLOCK << cls)) {
+	    break;
+	}
+    }
+    return cls;
+}
+
+#ifdef ULAPI
+static int arena_owner(void)
+{
+    hal_comp_t *comp;
+    int next, owner = 0, pid = getpid();
+
+    for (next = hal_data->comp_list_ptr; next != 0; next = comp->next_ptr) {
+	comp = SHMPTR(next);
+	if (comp->type == 0 && comp->pid == pid && comp->ready == 0) {
+	    if (owner != 0) {
+		return 0;
+	    }
+	    owner = comp->comp_id;
+	}
+    }
+    return owner;
+}
+
+static void *arena_alloc(long int size, int owner)
+{
+    hal_arena_block_t *block = 0;
+    long int need;
+    int cls, *prev, next;
+
+    need = size + sizeof(hal_arena_block_t);
+    cls = arena_class(need);
+    if (cls < HAL_ARENA_CLASSES - 1) {
+	need = (long int)HAL_ARENA_MIN_BLOCK << cls;
+    } else {
+	need = (need + 15) & ~15;
+    }
+    /* reuse a free block if there is one; all the blocks of a class
+       but the last have the same size, so this is the first one */
+    prev = &(hal_data->arena_free_ptr[cls]);
+    while ((next = *prev) != 0) {
+	block = SHMPTR(next);
+	if (block->size >= need) {
+	    *prev = block->next_ptr;
+	    hal_data->arena_free -= block->size;
+	    break;
+	}
+	prev = &(block->next_ptr);
+	block = 0;
+    }
+    if (block == 0) {
+	block = shmalloc_up(need);
+	if (block == 0) {
+	    return 0;
+	}
+	block->size = need;
+    }
+    block->owner = owner;
+    block->requested = size;
+    block->next_ptr = hal_data->arena_owned_ptr;
+    hal_data->arena_owned_ptr = SHMOFF(block);
+    hal_data->arena_used += block->size;
+    hal_data->arena_requested += size;
+    /* fresh shared memory is zero, keep reused blocks the same */
+    memset(block + 1, 0, block->size - sizeof(hal_arena_block_t));
+    return block + 1;
+}
+#endif /* ULAPI */
+
+static void arena_reclaim(int owner)
+{
+    hal_arena_block_t *block;
+    int *prev, next, cls;
+
+    prev = &(hal_data->arena_owned_ptr);
+    while ((next = *prev) != 0) {
+	block = SHMPTR(next);
+	if (block->owner != owner) {
+	    prev = &(block->next_ptr);
+	    continue;
+	}
+	*prev = block->next_ptr;
+	hal_data->arena_used -= block->size;
+	hal_data->arena_requested -= block->requested;
+	hal_data->arena_free += block->size;
+	cls = arena_class(block->size);
+	block->owner = 0;
+	block->requested = 0;
+	block->next_ptr = hal_data->arena_free_ptr[cls];
+	hal_data->arena_free_ptr[cls] = next;
+    }
+}
+
 hal_comp_t *halpr_alloc_comp_struct(void)
 {
     hal_comp_t *p;
@@ -2923,6 +3724,7 @@ static hal_pin_t *alloc_pin_struct(void)
 	p->type = 0;
 	p->dir = 0;
 	p->signal = 0;
+	p->hash_next = 0;
 	memset(&p->dummysig, 0, sizeof(hal_data_u));
 	p->name[0] = '\0';
     }
@@ -2952,6 +3754,7 @@ static hal_sig_t *alloc_sig_struct(void)
 	p->readers = 0;
 	p->writers = 0;
 	p->bidirs = 0;
+	p->hash_next = 0;
 	p->name[0] = '\0';
     }
     return p;
@@ -2977,6 +3780,7 @@ static hal_param_t *alloc_param_struct(void)
 	p->next_ptr = 0;
 	p->data_ptr = 0;
 	p->owner_ptr = 0;
+	p->hash_next = 0;
 	p->type = 0;
 	p->name[0] = '\0';
     }
@@ -3001,6 +3805,8 @@ static hal_oldname_t *halpr_alloc_oldname_struct(void)
     if (p) {
 	/* make sure it's empty */
 	p->next_ptr = 0;
+	p->owner_ptr = 0;
+	p->hash_next = 0;
 	p->name[0] = '\0';
     }
     return p;
@@ -3021,8 +3827,15 @@ static hal_funct_t *alloc_funct_struct(void)
     } else {
 	/* nothing on free list, allocate a brand new one */
 	p = shmalloc_dn(sizeof(hal_funct_t));
+	if (p) {
+	    p->profile_ptr = 0;
+	}
     }
     if (p) {
+	/* a recycled struct keeps its profile block, but starts clean */
+	if (p->profile_ptr != 0) {
+	    memset(SHMPTR(p->profile_ptr), 0, sizeof(hal_profile_t));
+	}
 	/* make sure it's empty */
 	p->next_ptr = 0;
 	p->uses_fp = 0;
@@ -3031,6 +3844,7 @@ static hal_funct_t *alloc_funct_struct(void)
 	p->users = 0;
 	p->arg = 0;
 	p->funct = 0;
+	p->hash_next = 0;
 	p->name[0] = '\0';
     }
     return p;
@@ -3060,6 +3874,7 @@ static hal_funct_entry_t *alloc_funct_entry_struct(void)
 	p->funct_ptr = 0;
 	p->arg = 0;
 	p->funct = 0;
+	p->barrier = 0;
     }
     return p;
 }
@@ -3068,6 +3883,7 @@ static hal_funct_entry_t *alloc_funct_entry_struct(void)
 static hal_thread_t *alloc_thread_struct(void)
 {
     hal_thread_t *p;
+    int n;
 
     /* check the free list */
     if (hal_data->thread_free_ptr != 0) {
@@ -3088,6 +3904,26 @@ static hal_thread_t *alloc_thread_struct(void)
 	p->priority = 0;
 	p->task_id = 0;
 	list_init_entry(&(p->funct_list));
+	p->profile = 0;
+	p->next_start = 0;
+	p->latency_sum = 0;
+	p->latency_min = 0;
+	p->latency_max = 0;
+	p->latency_mean = 0;
+	p->latency_count = 0;
+	for (n = 0; n < HAL_LATENCY_BUCKETS; n++) {
+	    p->latency_hist[n] = 0;
+	}
+	p->latency_reset = 0;
+	p->cpu = -1;
+	p->overruns = 0;
+	p->spin = 0;
+	p->spin_set = 0;
+	p->workers = 0;
+	p->ticket = 0;
+	p->stage_first = 0;
+	p->stage_done = 0;
+	p->cycle = 0;
 	p->name[0] = '\0';
     }
     return p;
@@ -3155,6 +3991,8 @@ static void free_comp_struct(hal_comp_t * comp)
 	}
 	next = *prev;
     }
+    /* the pins are gone, so nothing points into its memory any more */
+    arena_reclaim(comp->comp_id);
     /* now we can delete the component itself */
     /* clear contents of struct */
     comp->comp_id = 0;
@@ -3224,10 +4062,19 @@ static void unlink_pin(hal_pin_t * pin)
 
 static void free_pin_struct(hal_pin_t * pin)
 {
+    hal_oldname_t *oldname;
 
     unlink_pin(pin);
+    /* take it out of the hash tables */
+    hash_remove(PIN_BUCKET(pin->name), pin, &pin->hash_next);
+    if ( pin->oldname != 0 ) {
+	oldname = SHMPTR(pin->oldname);
+	hash_remove(PIN_ALIAS_BUCKET(oldname->name), oldname,
+	    &oldname->hash_next);
+	free_oldname_struct(oldname);
+    }
     /* clear contents of struct */
-    if ( pin->oldname != 0 ) free_oldname_struct(SHMPTR(pin->oldname));
+    pin->oldname = 0;
     pin->data_ptr_addr = 0;
     pin->owner_ptr = 0;
     pin->type = 0;
@@ -3252,6 +4099,8 @@ static void free_sig_struct(hal_sig_t * sig)
 	/* check for another pin linked to the signal */
 	pin = halpr_find_pin_by_sig(sig, pin);
     }
+    /* take it out of the hash table */
+    hash_remove(SIG_BUCKET(sig->name), sig, &sig->hash_next);
     /* clear contents of struct */
     sig->data_ptr = 0;
     sig->type = 0;
@@ -3266,8 +4115,18 @@ static void free_sig_struct(hal_sig_t * sig)
 
 static void free_param_struct(hal_param_t * p)
 {
+    hal_oldname_t *oldname;
+
+    /* take it out of the hash tables */
+    hash_remove(PARAM_BUCKET(p->name), p, &p->hash_next);
+    if ( p->oldname != 0 ) {
+	oldname = SHMPTR(p->oldname);
+	hash_remove(PARAM_ALIAS_BUCKET(oldname->name), oldname,
+	    &oldname->hash_next);
+	free_oldname_struct(oldname);
+    }
     /* clear contents of struct */
-    if ( p->oldname != 0 ) free_oldname_struct(SHMPTR(p->oldname));
+    p->oldname = 0;
     p->data_ptr = 0;
     p->owner_ptr = 0;
     p->type = 0;
@@ -3328,6 +4187,8 @@ static void free_funct_struct(hal_funct_t * funct)
 	    next_thread = thread->next_ptr;
 	}
     }
+    /* take it out of the hash table */
+    hash_remove(FUNCT_BUCKET(funct->name), funct, &funct->hash_next);
     /* clear contents of struct */
     funct->uses_fp = 0;
     funct->owner_ptr = 0;
@@ -3374,7 +4235,12 @@ static void free_thread_struct(hal_thread_t * thread)
 
     /* if we're deleting a thread, we need to stop all threads */
     hal_data->threads_running = 0;
-    /* and stop the task associated with this thread */
+    /* and stop the task associated with this thread, and its workers */
+    while (thread->workers > 0) {
+	thread->workers--;
+	rtapi_task_pause(thread->worker_ids[thread->workers]);
+	rtapi_task_delete(thread->worker_ids[thread->workers]);
+    }
     rtapi_task_pause(thread->task_id);
     rtapi_task_delete(thread->task_id);
     /* clear contents of struct */
@@ -3617,6 +4483,81 @@ int hal_stream_read(hal_stream_t *stream, union hal_stream_data *buf, unsigned *
     return 0;
 }
 
+/* number of records between out and in */
+static int hal_stream_used(hal_stream_t *stream, int in, int out) {
+    int used = in - out;
+    if(used < 0) used += stream->fifo->depth;
+    return used;
+}
+
+int hal_stream_read_n(hal_stream_t *stream, union hal_stream_data *buf, int n, unsigned *this_sample) {
+    int in = hal_stream_atomic_load_in(stream),
+        out = stream->fifo->out;
+    int num_pins = stream->fifo->num_pins;
+    int stride = num_pins + 1;
+    int i, used = hal_stream_used(stream, in, out);
+    if(n > used) n = used;
+    for(i = 0; i < n; i++) {
+        union hal_stream_data *dptr = &stream->fifo->data[out * stride];
+        memcpy(buf + i * num_pins, dptr, sizeof(union hal_stream_data) * num_pins);
+        if(this_sample) this_sample[i] = dptr[num_pins].s;
+        out = hal_stream_advance(stream, out);
+    }
+    hal_stream_atomic_store_out(stream, out);
+    return n;
+}
+
+int hal_stream_write_n(hal_stream_t *stream, union hal_stream_data *buf, int n) {
+    int in = stream->fifo->in,
+        out = hal_stream_atomic_load_out(stream);
+    int num_pins = stream->fifo->num_pins;
+    int stride = num_pins + 1;
+    int i, room = stream->fifo->depth - 1 - hal_stream_used(stream, in, out);
+    if(n > room) n = room;
+    for(i = 0; i < n; i++) {
+        union hal_stream_data *dptr = &stream->fifo->data[in * stride];
+        memcpy(dptr, buf + i * num_pins, sizeof(union hal_stream_data) * num_pins);
+        dptr[num_pins].s = ++stream->fifo->this_sample;
+        in = hal_stream_advance(stream, in);
+    }
+    hal_stream_atomic_store_in(stream, in);
+    return n;
+}
+
+union hal_stream_data *hal_stream_read_span(hal_stream_t *stream, int *count) {
+    int in = hal_stream_atomic_load_in(stream),
+        out = stream->fifo->out;
+    *count = in >= out ? in - out : stream->fifo->depth - out;
+    return &stream->fifo->data[out * (stream->fifo->num_pins + 1)];
+}
+
+void hal_stream_read_release(hal_stream_t *stream, int n) {
+    int out = stream->fifo->out + n;
+    if(out >= stream->fifo->depth) out -= stream->fifo->depth;
+    hal_stream_atomic_store_out(stream, out);
+}
+
+union hal_stream_data *hal_stream_write_span(hal_stream_t *stream, int *count) {
+    int in = stream->fifo->in,
+        out = hal_stream_atomic_load_out(stream);
+    /* stop one short of out, and of the end if out is at the start */
+    if(out > in) *count = out - in - 1;
+    else *count = stream->fifo->depth - in - (out == 0);
+    return &stream->fifo->data[in * (stream->fifo->num_pins + 1)];
+}
+
+void hal_stream_write_commit(hal_stream_t *stream, int n) {
+    int in = stream->fifo->in;
+    int num_pins = stream->fifo->num_pins;
+    int stride = num_pins + 1;
+    int i;
+    for(i = 0; i < n; i++) {
+        stream->fifo->data[in * stride + num_pins].s = ++stream->fifo->this_sample;
+        in = hal_stream_advance(stream, in);
+    }
+    hal_stream_atomic_store_in(stream, in);
+}
+
 int hal_stream_attach(hal_stream_t *stream, int comp_id, int key, const char *typestring) {
     int i;
 
@@ -3752,10 +4693,16 @@ EXPORT_SYMBOL(hal_set_constructor);
 EXPORT_SYMBOL(hal_export_funct);
 
 EXPORT_SYMBOL(hal_create_thread);
+EXPORT_SYMBOL(hal_create_thread_cpu);
+EXPORT_SYMBOL(hal_thread_add_worker);
 
 EXPORT_SYMBOL(hal_add_funct_to_thread);
+EXPORT_SYMBOL(hal_add_funct_to_thread_barrier);
 EXPORT_SYMBOL(hal_del_funct_from_thread);
 
+EXPORT_SYMBOL(hal_set_thread_profile);
+EXPORT_SYMBOL(hal_reset_thread_profile);
+EXPORT_SYMBOL(hal_compact_signals);
 EXPORT_SYMBOL(hal_start_threads);
 EXPORT_SYMBOL(hal_stop_threads);
 
@@ -3773,6 +4720,7 @@ EXPORT_SYMBOL(halpr_find_param_by_owner);
 EXPORT_SYMBOL(halpr_find_funct_by_owner);
 
 EXPORT_SYMBOL(halpr_find_pin_by_sig);
+EXPORT_SYMBOL(halpr_link_pin);
 
 EXPORT_SYMBOL(hal_pin_alias);
 EXPORT_SYMBOL(hal_param_alias);
@@ -3784,6 +4732,12 @@ EXPORT_SYMBOL_GPL(hal_stream_depth);
 EXPORT_SYMBOL_GPL(hal_stream_maxdepth);
 EXPORT_SYMBOL_GPL(hal_stream_write);
 EXPORT_SYMBOL_GPL(hal_stream_read);
+EXPORT_SYMBOL_GPL(hal_stream_read_n);
+EXPORT_SYMBOL_GPL(hal_stream_write_n);
+EXPORT_SYMBOL_GPL(hal_stream_read_span);
+EXPORT_SYMBOL_GPL(hal_stream_read_release);
+EXPORT_SYMBOL_GPL(hal_stream_write_span);
+EXPORT_SYMBOL_GPL(hal_stream_write_commit);
 EXPORT_SYMBOL_GPL(hal_stream_attach);
 EXPORT_SYMBOL_GPL(hal_stream_detach);
 EXPORT_SYMBOL_GPL(hal_stream_element_count);
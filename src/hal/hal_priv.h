@@ -151,9 +151,66 @@ typedef struct {
 */
 typedef struct {
     int next_ptr;		/* next struct (used for free list only) */
+    int owner_ptr;		/* pin or parameter that had this name */
+    int hash_next;		/* next oldname in the same hash bucket */
     char name[HAL_NAME_LEN + 1];	/* the original name */
 } hal_oldname_t;
 
+/** Name hash tables.
+    Besides the sorted lists, pins, signals, parameters and functions
+    are kept in hash tables so that finding one by name doesn't need
+    to walk a list that may have thousands of entries.  Each bucket
+    is the offset of the first object whose name hashes to it, and
+    the objects in a bucket are chained through their 'hash_next'
+    fields.  The original names of aliased pins and parameters have
+    tables of their own.  Like the lists, the tables are only touched
+    with the mutex held.  Sizes must be powers of two.
+*/
+#define HAL_HASH_SIZE 512
+#define HAL_ALIAS_HASH_SIZE 64
+
+/** Each thread keeps a histogram of how late it wakes up.  Bucket 0
+    counts wakeups less than 1 us late, bucket n those between 2^(n-1)
+    and 2^n us, and the last one everything later.
+*/
+#define HAL_LATENCY_BUCKETS 10
+
+/** The same statistics are kept for each CPU, over all the threads
+    that woke up on it since the HAL was created, so the tails of a
+    long running machine can be told apart by core.  They have no
+    reset, and as threads on one CPU may preempt each other while
+    recording, a wakeup is very rarely lost.  CPUs numbered
+    HAL_MAX_CPUS or more are not recorded.
+*/
+#define HAL_MAX_CPUS 32
+
+typedef struct {
+    hal_u32_t count;		/* wakeups measured */
+    hal_s32_t max;		/* largest wakeup latency, nsec */
+    long long int sum;		/* sum of the wakeup latencies, nsec */
+    hal_u32_t hist[HAL_LATENCY_BUCKETS];	/* histogram, as for threads */
+} hal_cpu_latency_t;
+
+/** Memory that a user space component gets from hal_malloc() before it
+    calls hal_ready() is taken from a size class arena, so that it can be
+    given back when the component exits and reused by the next one.
+    Each block starts with a hal_arena_block_t header.  Blocks in use
+    are chained on 'arena_owned_ptr', free ones on the list of their
+    class: HAL_ARENA_MIN_BLOCK << n bytes for class n, header included,
+    and any size for the last class, which is searched first fit.
+    Realtime components and anything allocated after hal_ready() use
+    the plain allocator and are never freed, as before.
+*/
+#define HAL_ARENA_MIN_BLOCK 32
+#define HAL_ARENA_CLASSES 10
+
+typedef struct {
+    int next_ptr;		/* next owned block, or next free block */
+    int owner;			/* comp_id of the owner, 0 if free */
+    int size;			/* size of the block, header included */
+    int requested;		/* size given to hal_malloc() */
+} hal_arena_block_t;
+
 /* Master HAL data structure
    There is a single instance of this structure in the machine.
    It resides at the base of the HAL shared memory block, where it
@@ -165,6 +222,7 @@ typedef struct {
 typedef struct {
     int version;		/* version code for structs, etc */
     rtapi_mutex_t mutex;	/* protection for linked lists, etc. */
+    unsigned int seq;		/* odd while the lists are being changed */
     hal_s32_t shmem_avail;	/* amount of shmem left free */
     constructor pending_constructor;
 			/* pointer to the pending constructor function */
@@ -172,6 +230,7 @@ typedef struct {
 			        /* prefix of name for new instance */
     char constructor_arg[HAL_NAME_LEN+1];
 			        /* prefix of name for new instance */
+    long shmem_size;		/* size of the HAL shared memory */
     int shmem_bot;		/* bottom of free shmem (first free byte) */
     int shmem_top;		/* top of free shmem (1 past last free) */
     int comp_list_ptr;		/* root of linked list of components */
@@ -193,6 +252,18 @@ typedef struct {
     int exact_base_period;      /* if set, pretend that rtapi satisfied our
 				   period request exactly */
     unsigned char lock;         /* hal locking, can be one of the HAL_LOCK_* types */
+    int pin_hash[HAL_HASH_SIZE];	/* pins by name */
+    int sig_hash[HAL_HASH_SIZE];	/* signals by name */
+    int param_hash[HAL_HASH_SIZE];	/* parameters by name */
+    int funct_hash[HAL_HASH_SIZE];	/* functions by name */
+    int pin_alias_hash[HAL_ALIAS_HASH_SIZE];	/* pins by original name */
+    int param_alias_hash[HAL_ALIAS_HASH_SIZE];	/* params by original name */
+    hal_cpu_latency_t cpu_latency[HAL_MAX_CPUS];	/* wakeups by CPU */
+    int arena_owned_ptr;	/* arena blocks in use */
+    int arena_free_ptr[HAL_ARENA_CLASSES];	/* free arena blocks by class */
+    long arena_used;		/* bytes in arena blocks in use */
+    long arena_requested;	/* bytes asked for in those blocks */
+    long arena_free;		/* bytes in free arena blocks */
 } hal_data_t;
 
 /** HAL 'component' data structure.
@@ -223,6 +294,7 @@ typedef struct {
     int signal;			/* signal to which pin is linked */
     hal_data_u dummysig;	/* if unlinked, data_ptr points here */
     int oldname;		/* old name if aliased, else zero */
+    int hash_next;		/* next pin in the same hash bucket */
     hal_type_t type;		/* data type */
     hal_pin_dir_t dir;		/* pin direction */
     char name[HAL_NAME_LEN + 1];	/* pin name */
@@ -238,6 +310,7 @@ typedef struct {
     int readers;		/* number of input pins linked */
     int writers;		/* number of output pins linked */
     int bidirs;			/* number of I/O pins linked */
+    int hash_next;		/* next signal in the same hash bucket */
     char name[HAL_NAME_LEN + 1];	/* signal name */
 } hal_sig_t;
 
@@ -249,6 +322,7 @@ typedef struct {
     int data_ptr;		/* offset of parameter value */
     int owner_ptr;		/* component that owns this signal */
     int oldname;		/* old name if aliased, else zero */
+    int hash_next;		/* next parameter in the same hash bucket */
     hal_type_t type;		/* data type */
     hal_param_dir_t dir;	/* data direction */
     char name[HAL_NAME_LEN + 1];	/* parameter name */
@@ -270,6 +344,20 @@ typedef struct {
     that identify the functions connected to that thread.
 */
 
+/** Optional per-function execution profile.  'hist[n]' counts runs
+    that took between 2^n and 2^(n+1) CPU cycles.  It is allocated the
+    first time profiling is turned on for a thread using the function.
+*/
+#define HAL_PROFILE_BUCKETS 32
+
+/* alignment of each thread's block of signals after hal_compact_signals() */
+#define HAL_CACHELINE 64
+
+typedef struct {
+    hal_u32_t calls;		/* number of runs recorded */
+    hal_u32_t hist[HAL_PROFILE_BUCKETS];	/* log2 histogram of runtime */
+} hal_profile_t;
+
 typedef struct {
     int next_ptr;		/* next function in linked list */
     int uses_fp;		/* floating point flag */
@@ -281,6 +369,8 @@ typedef struct {
     hal_s32_t* runtime;	/* (pin) duration of last run, in CPU cycles */
     hal_s32_t maxtime;	/* (param) duration of longest run, in CPU cycles */
     hal_bit_t maxtime_increased;	/* on last call, maxtime increased */
+    int profile_ptr;		/* hal_profile_t, 0 if never profiled */
+    int hash_next;		/* next function in the same hash bucket */
     char name[HAL_NAME_LEN + 1];	/* function name */
 } hal_funct_t;
 
@@ -289,10 +379,22 @@ typedef struct {
     void *arg;			/* argument for function */
     void (*funct) (void *, long);	/* ptr to function code */
     int funct_ptr;		/* pointer to function */
+    int barrier;		/* waits for all functs before it */
 } hal_funct_entry_t;
 
 #define HAL_STACKSIZE 16384	/* realtime task stacksize */
 
+/** A thread may have worker tasks on other CPUs that help it run its
+    functs.  The funct list is cut into stages at each funct added as
+    a barrier; the functs of a stage are taken in list order by
+    whichever of the thread and its workers is free, and a stage
+    starts only when the previous one has finished.  'ticket' holds
+    the number of the current stage in its top 32 bits, the number of
+    functs in it in the next 16 and the index of the next funct to
+    take in the low 16.
+*/
+#define HAL_MAX_WORKERS 8
+
 typedef struct {
     int next_ptr;		/* next thread in linked list */
     int uses_fp;		/* floating point flag */
@@ -302,6 +404,25 @@ typedef struct {
     hal_s32_t* runtime;	/* (pin) duration of last run, in CPU cycles */
     hal_s32_t maxtime;	/* (param) duration of longest run, in CPU cycles */
     hal_list_t funct_list;	/* list of functions to run */
+    int profile;		/* non-zero to record funct profiles */
+    long long int next_start;	/* expected start of next period, nsec */
+    long long int latency_sum;	/* sum of the wakeup latencies, nsec */
+    hal_s32_t latency_min;	/* (param) smallest wakeup latency, nsec */
+    hal_s32_t latency_max;	/* (param) largest wakeup latency, nsec */
+    hal_s32_t latency_mean;	/* (param) average wakeup latency, nsec */
+    hal_u32_t latency_count;	/* (param) wakeups measured */
+    hal_u32_t latency_hist[HAL_LATENCY_BUCKETS];	/* (params) histogram */
+    hal_bit_t latency_reset;	/* (param) set to clear the statistics */
+    int cpu;			/* CPU of the last wakeup, or -1 */
+    hal_u32_t overruns;		/* (param) periods the functs overran */
+    hal_s32_t spin;		/* (param) nsec to busy-wait before a period */
+    hal_s32_t spin_set;		/* spin last given to rtapi_task_set_spin */
+    int workers;		/* number of worker tasks */
+    int worker_ids[HAL_MAX_WORKERS];	/* their task IDs */
+    unsigned long long ticket;	/* stage, functs in it, next to take */
+    int stage_first;		/* first funct entry of the stage */
+    int stage_done;		/* functs of the stage finished */
+    unsigned int cycle;		/* periods the thread has finished */
     char name[HAL_NAME_LEN + 1];	/* thread name */
     int comp_id;
 } hal_thread_t;
@@ -329,8 +450,9 @@ typedef struct {
 */
 
 #define HAL_KEY   0x48414C32	/* key used to open HAL shared memory */
-#define HAL_VER   0x0000000D	/* version code */
-#define HAL_SIZE  (75*4096)
+#define HAL_VER   0x00000015	/* version code */
+#define HAL_SIZE  (75*4096)	/* default and smallest size, see hal_size */
+#define HAL_SIZE_MAX  (1L << 30)
 #define HAL_PSEUDO_COMP_PREFIX "__" /* prefix to identify a pseudo component */
 
 /* These pointers are set by hal_init() to point to the shmem block
@@ -344,6 +466,74 @@ typedef struct {
 extern char *hal_shmem_base;
 extern hal_data_t *hal_data;
 
+/** Everything that changes the lists or hash tables does so between
+    'halpr_lock()' and 'halpr_unlock()'.  Besides getting and giving
+    the mutex these make 'hal_data->seq' odd for the duration of the
+    change and even again afterwards, so that code which only looks
+    at the lists can do so without the mutex, the way the motion
+    status is read:
+
+        for (tries = 0; ; tries++) {
+            seq = halpr_read_begin(tries);
+            ... look, copying out what is needed ...
+            if (!halpr_read_retry(seq, tries)) break;
+        }
+
+    A reader that sees 'seq' change has to throw its copy away and
+    start again.  Structs are never given back to the allocator, so
+    a torn walk only ever follows offsets of live or freed structs of
+    the right type, and a walk that goes wrong can stop early by
+    checking 'halpr_read_torn()'.  After HAL_READ_TRIES torn reads,
+    'halpr_read_begin()' takes the mutex, so that a reader can't be
+    starved by a script that keeps changing the HAL, and the matching
+    'halpr_read_retry()' gives it back.  Values of pins, signals and
+    parameters are not covered; as before, they change under readers.
+*/
+#define HAL_READ_TRIES 8
+
+static inline void halpr_lock(void)
+{
+    rtapi_mutex_get(&(hal_data->mutex));
+    __atomic_store_n(&hal_data->seq, hal_data->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void halpr_unlock(void)
+{
+    __atomic_store_n(&hal_data->seq, hal_data->seq + 1, __ATOMIC_RELEASE);
+    rtapi_mutex_give(&(hal_data->mutex));
+}
+
+static inline unsigned int halpr_read_begin(int tries)
+{
+    if (tries >= HAL_READ_TRIES) {
+	rtapi_mutex_get(&(hal_data->mutex));
+	/* with the mutex held, an odd seq was left by a writer that died */
+	if (hal_data->seq & 1) {
+	    __atomic_store_n(&hal_data->seq, hal_data->seq + 1,
+		__ATOMIC_RELAXED);
+	}
+    }
+    return __atomic_load_n(&hal_data->seq, __ATOMIC_ACQUIRE);
+}
+
+/* returns non-zero if what was read since halpr_read_begin() may be torn */
+static inline int halpr_read_torn(unsigned int start)
+{
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return (start & 1)
+	|| __atomic_load_n(&hal_data->seq, __ATOMIC_RELAXED) != start;
+}
+
+static inline int halpr_read_retry(unsigned int start, int tries)
+{
+    if (tries >= HAL_READ_TRIES) {
+	rtapi_mutex_give(&(hal_data->mutex));
+	return 0;
+    }
+    return halpr_read_torn(start);
+}
+
 /***********************************************************************
 *            PRIVATE HAL FUNCTIONS - NOT PART OF THE API               *
 ************************************************************************/
@@ -387,7 +577,10 @@ hal_list_t *list_remove_entry(hal_list_t * entry);
 
 /** The 'find_xxx_by_name()' functions search the appropriate list for
     an object that matches 'name'.  They return a pointer to the object,
-    or NULL if no matching object is found.
+    or NULL if no matching object is found.  Pins, signals, parameters
+    and functions are looked up in the name hash tables rather than by
+    walking the lists; pins and parameters also match their original
+    name if they have been aliased.
 */
 extern hal_comp_t *halpr_find_comp_by_name(const char *name);
 extern hal_pin_t *halpr_find_pin_by_name(const char *name);
@@ -427,6 +620,12 @@ extern hal_funct_t *halpr_find_funct_by_owner(hal_comp_t * owner,
 */
 extern hal_pin_t *halpr_find_pin_by_sig(hal_sig_t * sig, hal_pin_t * start);
 
+/** 'link_pin()' links 'pin' to 'sig' like hal_link(), for callers that
+    already hold the mutex and have found both.  Returns 0 on success or
+    a negative error code.
+*/
+extern int halpr_link_pin(hal_pin_t * pin, hal_sig_t * sig);
+
 #define HAL_STREAM_MAGIC_NUM		0x4649464F
 struct hal_stream_shm {
     unsigned int magic;
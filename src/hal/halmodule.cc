@@ -20,6 +20,7 @@
 #include <structmember.h>
 #include <string>
 #include <map>
+#include <vector>
 using namespace std;
 
 #include "config.h"
@@ -177,6 +178,8 @@ struct pyhalitem {
 };
 
 static PyObject * pyhal_pin_new(halitem * pin, const char *name);
+struct halobject;
+static PyObject * pyhal_group_new(struct halobject *comp, PyObject *names);
 
 typedef std::map<std::string, struct halitem> itemmap;
 
@@ -453,6 +456,17 @@ static PyObject *pyhal_get_pin(PyObject *_self, PyObject *o) {
     return pyhal_pin_new(pin, name);
 }
 
+static PyObject *pyhal_group(PyObject *_self, PyObject *o) {
+    PyObject *names;
+    halobject *self = (halobject *)_self;
+
+    if(!PyArg_ParseTuple(o, "O", &names))
+        return NULL;
+    EXCEPTION_IF_NOT_LIVE(NULL);
+
+    return pyhal_group_new(self, names);
+}
+
 static PyObject *pyhal_ready(PyObject *_self, PyObject *o) {
     // hal_ready did not exist in EMC 2.0.x, make it a no-op
     halobject *self = (halobject *)_self;
@@ -509,6 +523,25 @@ static PyObject *pyhal_get_prefix(PyObject *_self, PyObject *args) {
     return PyString_FromString(self->prefix);
 }
 
+static PyObject *pyhal_get_names(PyObject *_self, PyObject *args) {
+    halobject* self = (halobject*)_self;
+    if(!PyArg_ParseTuple(args, "")) return NULL;
+    EXCEPTION_IF_NOT_LIVE(NULL);
+
+    PyObject *result = PyList_New(0);
+    if(!result) return NULL;
+    for(itemmap::iterator i = self->items->begin(); i != self->items->end(); i++) {
+        PyObject *name = PyString_FromString(i->first.c_str());
+        if(!name || PyList_Append(result, name) < 0) {
+            Py_XDECREF(name);
+            Py_DECREF(result);
+            return NULL;
+        }
+        Py_DECREF(name);
+    }
+    return result;
+}
+
 
 static PyObject *pyhal_set_prefix(PyObject *_self, PyObject *args) {
     char *newprefix;
@@ -539,6 +572,10 @@ static PyMethodDef hal_methods[] = {
         "Create a new pin"},
     {"getitem", pyhal_get_pin, METH_VARARGS,
         "Get existing pin object"},
+    {"group", pyhal_group, METH_VARARGS,
+        "Get a group of existing pins and parameters to read or write at once"},
+    {"getnames", pyhal_get_names, METH_VARARGS,
+        "Get the names of the pins and parameters of the component"},
     {"exit", pyhal_exit, METH_NOARGS,
         "Call hal_exit"},
     {"ready", pyhal_ready, METH_NOARGS,
@@ -757,6 +794,259 @@ static PyObject * pyhal_pin_new(halitem * pin, const char * name) {
     return (PyObject *) pypin;
 }
 
+// A group is a list of the component's pins and parameters, looked up
+// once, whose values are all read or written in one call.  The HAL mutex
+// is held while the values are copied, so nothing is relinked halfway
+// through, but it is not held while they are converted to and from Python.
+struct groupobj {
+    PyObject_HEAD
+    halobject *comp;
+    std::vector<halitem> *items;
+    PyObject *names;
+};
+
+static void group_read_value(halitem *item, paramunion *v) {
+    if(item->is_pin) {
+        switch(item->type) {
+            case HAL_BIT: v->b = *item->u->pin.b; break;
+            case HAL_U32: v->u32 = *item->u->pin.u32; break;
+            case HAL_S32: v->s32 = *item->u->pin.s32; break;
+            case HAL_FLOAT: v->f = *item->u->pin.f; break;
+            default: break;
+        }
+    } else {
+        *v = item->u->param;
+    }
+}
+
+static void group_write_value(halitem *item, paramunion *v) {
+    if(item->is_pin) {
+        switch(item->type) {
+            case HAL_BIT: *item->u->pin.b = v->b; break;
+            case HAL_U32: *item->u->pin.u32 = v->u32; break;
+            case HAL_S32: *item->u->pin.s32 = v->s32; break;
+            case HAL_FLOAT: *item->u->pin.f = v->f; break;
+            default: break;
+        }
+    } else {
+        item->u->param = *v;
+    }
+}
+
+static bool group_from_python(halitem *item, PyObject *o, paramunion *v) {
+    switch(item->type) {
+        case HAL_BIT: v->b = PyObject_IsTrue(o); return true;
+        case HAL_U32: { uint32_t tmp;
+            if(!from_python(o, &tmp)) return false;
+            v->u32 = tmp; return true; }
+        case HAL_S32: { int32_t tmp;
+            if(!from_python(o, &tmp)) return false;
+            v->s32 = tmp; return true; }
+        case HAL_FLOAT: { double tmp;
+            if(!from_python(o, &tmp)) return false;
+            v->f = tmp; return true; }
+        default:
+            PyErr_Format(pyhal_error_type, "Invalid item type %d", item->type);
+            return false;
+    }
+}
+
+static PyObject *group_to_python(halitem *item, paramunion *v) {
+    switch(item->type) {
+        case HAL_BIT: return to_python(v->b);
+        case HAL_U32: return to_python(v->u32);
+        case HAL_S32: return to_python(v->s32);
+        case HAL_FLOAT: return to_python(v->f);
+        default:
+            PyErr_Format(pyhal_error_type, "Invalid item type %d", item->type);
+            return NULL;
+    }
+}
+
+#define GROUP_IF_NOT_LIVE(retval) do { \
+    if(self->comp->hal_id <= 0) { \
+        PyErr_SetString(PyExc_RuntimeError, "Invalid operation on closed HAL component"); \
+        return retval; \
+    } \
+} while(0)
+
+static PyObject *pygroup_get(PyObject *_self, PyObject *) {
+    groupobj *self = (groupobj *)_self;
+    GROUP_IF_NOT_LIVE(NULL);
+
+    size_t n = self->items->size();
+    std::vector<paramunion> values(n);
+    rtapi_mutex_get(&(hal_data->mutex));
+    for(size_t i=0; i<n; i++)
+        group_read_value(&(*self->items)[i], &values[i]);
+    rtapi_mutex_give(&(hal_data->mutex));
+
+    PyObject *r = PyTuple_New(n);
+    if(!r) return NULL;
+    for(size_t i=0; i<n; i++) {
+        PyObject *o = group_to_python(&(*self->items)[i], &values[i]);
+        if(!o) {
+            Py_DECREF(r);
+            return NULL;
+        }
+        PyTuple_SET_ITEM(r, i, o);
+    }
+    return r;
+}
+
+static PyObject *pygroup_set(PyObject *_self, PyObject *o) {
+    groupobj *self = (groupobj *)_self;
+    GROUP_IF_NOT_LIVE(NULL);
+
+    PyObject *seq = PySequence_Fast(o, "Sequence of values expected");
+    if(!seq) return NULL;
+    size_t n = self->items->size();
+    if((size_t)PySequence_Fast_GET_SIZE(seq) != n) {
+        PyErr_Format(PyExc_ValueError, "Expected %d values, not %d",
+                (int)n, (int)PySequence_Fast_GET_SIZE(seq));
+        Py_DECREF(seq);
+        return NULL;
+    }
+    // convert everything first, so a bad value leaves all items unchanged
+    std::vector<paramunion> values(n);
+    for(size_t i=0; i<n; i++) {
+        if(!group_from_python(&(*self->items)[i],
+                    PySequence_Fast_GET_ITEM(seq, i), &values[i])) {
+            Py_DECREF(seq);
+            return NULL;
+        }
+    }
+    Py_DECREF(seq);
+
+    rtapi_mutex_get(&(hal_data->mutex));
+    for(size_t i=0; i<n; i++)
+        group_write_value(&(*self->items)[i], &values[i]);
+    rtapi_mutex_give(&(hal_data->mutex));
+    Py_RETURN_NONE;
+}
+
+static PyObject *pygroup_get_names(PyObject *_self, PyObject *) {
+    groupobj *self = (groupobj *)_self;
+    Py_INCREF(self->names);
+    return self->names;
+}
+
+static Py_ssize_t pygroup_len(PyObject *_self) {
+    groupobj *self = (groupobj *)_self;
+    return self->items->size();
+}
+
+static PyObject *pygroup_repr(PyObject *_self) {
+    groupobj *self = (groupobj *)_self;
+    return PyString_FromFormat("<hal group of %d items>",
+            (int)self->items->size());
+}
+
+static int pygroup_init(PyObject *_self, PyObject *, PyObject *) {
+    PyErr_Format(PyExc_RuntimeError,
+	    "Cannot be constructed directly");
+    return -1;
+}
+
+static void pygroup_delete(PyObject *_self) {
+    groupobj *self = (groupobj *)_self;
+    delete self->items;
+    Py_XDECREF(self->names);
+    Py_XDECREF(self->comp);
+    PyObject_Del(self);
+}
+
+static PyMethodDef group_methods[] = {
+    {"get", pygroup_get, METH_NOARGS, "Get the values of all items as a tuple"},
+    {"set", pygroup_set, METH_O, "Set all items from a sequence of values"},
+    {"get_names", pygroup_get_names, METH_NOARGS, "Get the item names"},
+    {NULL},
+};
+
+static PySequenceMethods group_sequence = {
+    pygroup_len,               /*sq_length*/
+};
+
+static
+PyTypeObject group_type = {
+    PyObject_HEAD_INIT(NULL)
+    0,                         /*ob_size*/
+    "hal.group",               /*tp_name*/
+    sizeof(groupobj),          /*tp_basicsize*/
+    0,                         /*tp_itemsize*/
+    pygroup_delete,            /*tp_dealloc*/
+    0,                         /*tp_print*/
+    0,                         /*tp_getattr*/
+    0,                         /*tp_setattr*/
+    0,                         /*tp_compare*/
+    pygroup_repr,              /*tp_repr*/
+    0,                         /*tp_as_number*/
+    &group_sequence,           /*tp_as_sequence*/
+    0,                         /*tp_as_mapping*/
+    0,                         /*tp_hash */
+    0,                         /*tp_call*/
+    0,                         /*tp_str*/
+    0,                         /*tp_getattro*/
+    0,                         /*tp_setattro*/
+    0,                         /*tp_as_buffer*/
+    Py_TPFLAGS_DEFAULT,        /*tp_flags*/
+    "HAL Group",               /*tp_doc*/
+    0,                         /*tp_traverse*/
+    0,                         /*tp_clear*/
+    0,                         /*tp_richcompare*/
+    0,                         /*tp_weaklistoffset*/
+    0,                         /*tp_iter*/
+    0,                         /*tp_iternext*/
+    group_methods,             /*tp_methods*/
+    0,                         /*tp_members*/
+    0,                         /*tp_getset*/
+    0,                         /*tp_base*/
+    0,                         /*tp_dict*/
+    0,                         /*tp_descr_get*/
+    0,                         /*tp_descr_set*/
+    0,                         /*tp_dictoffset*/
+    pygroup_init,              /*tp_init*/
+    0,                         /*tp_alloc*/
+    PyType_GenericNew,         /*tp_new*/
+    0,                         /*tp_free*/
+    0,                         /*tp_is_gc*/
+};
+
+static PyObject * pyhal_group_new(halobject *comp, PyObject *names) {
+    PyObject *seq = PySequence_Fast(names, "Sequence of item names expected");
+    if(!seq) return NULL;
+
+    Py_ssize_t n = PySequence_Fast_GET_SIZE(seq);
+    std::vector<halitem> *items = new std::vector<halitem>;
+    PyObject *t = PyTuple_New(n);
+    if(!t) goto fail;
+    for(Py_ssize_t i=0; i<n; i++) {
+        PyObject *name = PySequence_Fast_GET_ITEM(seq, i);
+        halitem *item = find_item(comp, PyString_AsString(name));
+        if(!item) goto fail;
+        items->push_back(*item);
+        Py_INCREF(name);
+        PyTuple_SET_ITEM(t, i, name);
+    }
+
+    {
+        groupobj *group = PyObject_New(groupobj, &group_type);
+        if(!group) goto fail;
+        Py_INCREF(comp);
+        group->comp = comp;
+        group->items = items;
+        group->names = t;
+        Py_DECREF(seq);
+        return (PyObject *) group;
+    }
+
+fail:
+    delete items;
+    Py_XDECREF(t);
+    Py_DECREF(seq);
+    return NULL;
+}
+
 PyObject *pin_has_writer(PyObject *self, PyObject *args) {
     char *name;
     if(!PyArg_ParseTuple(args, "s", &name)) return NULL;
@@ -1405,10 +1695,12 @@ void init_hal(void) {
     PyType_Ready(&shm_type);
     PyType_Ready(&halpin_type);
     PyType_Ready(&stream_type);
+    PyType_Ready(&group_type);
     PyModule_AddObject(m, "component", (PyObject*)&halobject_type);
     PyModule_AddObject(m, "shm", (PyObject*)&shm_type);
     PyModule_AddObject(m, "item", (PyObject*)&halpin_type);
     PyModule_AddObject(m, "stream", (PyObject*)&stream_type);
+    PyModule_AddObject(m, "group", (PyObject*)&group_type);
 
     PyModule_AddIntConstant(m, "MSG_NONE", RTAPI_MSG_NONE);
     PyModule_AddIntConstant(m, "MSG_ERR", RTAPI_MSG_ERR);
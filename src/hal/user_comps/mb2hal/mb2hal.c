@@ -120,8 +120,8 @@ QUIT_CLEANUP:
 void *link_loop_and_logic(void *thrd_link_num)
 {
     char *fnct_name = "link_loop_and_logic";
-    int ret, ret_available, ret_connected;
-    int tx_counter;
+    int ret, ret_connected;
+    double wait_time;
     mb_tx_t   *this_mb_tx = NULL;
     int        this_mb_tx_num;
     mb_link_t *this_mb_link = NULL;
@@ -140,162 +140,196 @@ void *link_loop_and_logic(void *thrd_link_num)
 
     while (1) {
 
-        for (tx_counter = 0; tx_counter < gbl.tot_mb_tx; tx_counter++) {
+        if (gbl.quit_flag != 0) { //tell the threads to quit (SIGTERM o SGIQUIT) (unloadusr mb2hal).
+            return NULL;
+        }
 
-            if (gbl.quit_flag != 0) { //tell the threads to quit (SIGTERM o SGIQUIT) (unloadusr mb2hal).
-                return NULL;
-            }
+        //the tx of this link with the earliest next time (update_rate)
+        if (get_next_tx(this_mb_link_num, &this_mb_tx_num, &wait_time) != retOK) {
+            ERR(gbl.init_dbg, "mb_links[%d] thread[%d] fd[%d] get_next_tx ERR",
+                this_mb_link_num, this_mb_link_num, modbus_get_socket(this_mb_link->modbus));
+            return NULL;
+        }
+        if (wait_time > 0) { //not yet, sleep (checking quit_flag at least each 0.1 s)
+            usleep((wait_time < 0.1 ? wait_time : 0.1) * 1000 * 1000);
+            continue;
+        }
+        this_mb_tx = &gbl.mb_tx[this_mb_tx_num];
 
-            this_mb_tx_num = tx_counter;
-            this_mb_tx = &gbl.mb_tx[this_mb_tx_num];
+        DBG(this_mb_tx->cfg_debug, "mb_tx_num[%d] mb_links[%d] thread[%d] fd[%d] going to TEST connection",
+            this_mb_tx_num, this_mb_tx->mb_link_num, this_mb_link_num, modbus_get_socket(this_mb_link->modbus));
 
-            DBG(this_mb_tx->cfg_debug, "mb_tx_num[%d] mb_links[%d] thread[%d] fd[%d] going to TEST availability",
+        //first time connection or reconnection, run time parameters setting
+        if (get_tx_connection(this_mb_tx_num, &ret_connected) != retOK) {
+            ERR(this_mb_tx->cfg_debug, "mb_tx_num[%d] mb_links[%d] thread[%d] fd[%d] get_tx_connection ERR",
                 this_mb_tx_num, this_mb_tx->mb_link_num, this_mb_link_num, modbus_get_socket(this_mb_link->modbus));
-
-            //corresponding link and time (update_rate)
-            if (is_this_tx_ready(this_mb_link_num, this_mb_tx_num, &ret_available) != retOK) {
-                ERR(this_mb_tx->cfg_debug, "mb_tx_num[%d] mb_links[%d] thread[%d] fd[%d] is_this_tx_ready ERR",
-                    this_mb_tx_num, this_mb_tx->mb_link_num, this_mb_link_num, modbus_get_socket(this_mb_link->modbus));
-                return NULL;
-            }
-            if (ret_available == 0) {
-                DBG(this_mb_tx->cfg_debug, "mb_tx_num[%d] mb_links[%d] thread[%d] fd[%d] NOT available",
-                    this_mb_tx_num, this_mb_tx->mb_link_num, this_mb_link_num, modbus_get_socket(this_mb_link->modbus));
-                continue;
-            }
-
-            DBG(this_mb_tx->cfg_debug, "mb_tx_num[%d] mb_links[%d] thread[%d] fd[%d] going to TEST connection",
+            return NULL;
+        }
+        if (ret_connected == 0) {
+            DBG(this_mb_tx->cfg_debug, "mb_tx_num[%d] mb_links[%d] thread[%d] fd[%d] NOT connected",
                 this_mb_tx_num, this_mb_tx->mb_link_num, this_mb_link_num, modbus_get_socket(this_mb_link->modbus));
+            set_next_tx_time(this_mb_tx);
+            continue;
+        }
 
-            //first time connection or reconnection, run time parameters setting
-            if (get_tx_connection(this_mb_tx_num, &ret_connected) != retOK) {
-                ERR(this_mb_tx->cfg_debug, "mb_tx_num[%d] mb_links[%d] thread[%d] fd[%d] get_tx_connection ERR",
-                    this_mb_tx_num, this_mb_tx->mb_link_num, this_mb_link_num, modbus_get_socket(this_mb_link->modbus));
-                return NULL;
-            }
-            if (ret_connected == 0) {
-                DBG(this_mb_tx->cfg_debug, "mb_tx_num[%d] mb_links[%d] thread[%d] fd[%d] NOT connected",
-                    this_mb_tx_num, this_mb_tx->mb_link_num, this_mb_link_num, modbus_get_socket(this_mb_link->modbus));
-                continue;
-            }
-
-            DBG(this_mb_tx->cfg_debug, "mb_tx_num[%d] mb_links[%d] thread[%d] fd[%d] lk_dbg[%d] going to EXECUTE transaction",
-                this_mb_tx_num, this_mb_tx->mb_link_num, this_mb_link_num, modbus_get_socket(this_mb_link->modbus),
-                this_mb_tx->protocol_debug);
-
-            switch (this_mb_tx->mb_tx_fnct) {
-            case mbtx_02_READ_DISCRETE_INPUTS:
-                ret = fnct_02_read_discrete_inputs(this_mb_tx, this_mb_link);
-                break;
-            case mbtx_03_READ_HOLDING_REGISTERS:
-                ret = fnct_03_read_holding_registers(this_mb_tx, this_mb_link);
-                break;
-            case mbtx_04_READ_INPUT_REGISTERS:
-                ret = fnct_04_read_input_registers(this_mb_tx, this_mb_link);
-                break;
-            case mbtx_15_WRITE_MULTIPLE_COILS:
-                ret = fnct_15_write_multiple_coils(this_mb_tx, this_mb_link);
-                break;
-            case mbtx_16_WRITE_MULTIPLE_REGISTERS:
-                ret = fnct_16_write_multiple_registers(this_mb_tx, this_mb_link);
-                break;
-            default:
-                ret = -1;
-                ERR(this_mb_tx->cfg_debug, "case error with mb_tx_fnct %d [%s] in mb_tx_num[%d]",
-                    this_mb_tx->mb_tx_fnct, this_mb_tx->mb_tx_fnct_name, this_mb_tx_num);
-                break;
-            }
+        DBG(this_mb_tx->cfg_debug, "mb_tx_num[%d] mb_links[%d] thread[%d] fd[%d] lk_dbg[%d] going to EXECUTE transaction",
+            this_mb_tx_num, this_mb_tx->mb_link_num, this_mb_link_num, modbus_get_socket(this_mb_link->modbus),
+            this_mb_tx->protocol_debug);
+
+        switch (this_mb_tx->mb_tx_fnct) {
+        case mbtx_02_READ_DISCRETE_INPUTS:
+            ret = fnct_02_read_discrete_inputs(this_mb_tx, this_mb_link);
+            break;
+        case mbtx_03_READ_HOLDING_REGISTERS:
+            ret = fnct_03_read_holding_registers(this_mb_tx, this_mb_link);
+            break;
+        case mbtx_04_READ_INPUT_REGISTERS:
+            ret = fnct_04_read_input_registers(this_mb_tx, this_mb_link);
+            break;
+        case mbtx_15_WRITE_MULTIPLE_COILS:
+            ret = fnct_15_write_multiple_coils(this_mb_tx, this_mb_link);
+            break;
+        case mbtx_16_WRITE_MULTIPLE_REGISTERS:
+            ret = fnct_16_write_multiple_registers(this_mb_tx, this_mb_link);
+            break;
+        default:
+            ret = -1;
+            ERR(this_mb_tx->cfg_debug, "case error with mb_tx_fnct %d [%s] in mb_tx_num[%d]",
+                this_mb_tx->mb_tx_fnct, this_mb_tx->mb_tx_fnct_name, this_mb_tx_num);
+            break;
+        }
 
-            if (gbl.quit_flag != 0) { //tell the threads to quit (SIGTERM o SGIQUIT) (unloadusr mb2hal).
-                return NULL;
-            }
+        if (gbl.quit_flag != 0) { //tell the threads to quit (SIGTERM o SGIQUIT) (unloadusr mb2hal).
+            return NULL;
+        }
 
-            if (ret != retOK && modbus_get_socket(this_mb_link->modbus) < 0) { //link failure
-                (*this_mb_tx->num_errors)++;
-                ERR(this_mb_tx->cfg_debug, "mb_tx_num[%d] mb_links[%d] thread[%d] fd[%d] link failure, going to close link",
-                    this_mb_tx_num, this_mb_tx->mb_link_num, this_mb_link_num, modbus_get_socket(this_mb_link->modbus));
-                modbus_close(this_mb_link->modbus);
-            }
-            else if (ret != retOK) {  //transaction failure but link OK
-                (**this_mb_tx->num_errors)++;
-                ERR(this_mb_tx->cfg_debug, "mb_tx_num[%d] mb_links[%d] thread[%d] fd[%d] transaction failure, num_errors[%d]",
-                    this_mb_tx_num, this_mb_tx->mb_link_num, this_mb_link_num, modbus_get_socket(this_mb_link->modbus), **this_mb_tx->num_errors);
-            }
-            else { //transaction and link OK
-                OK(this_mb_tx->cfg_debug, "mb_tx_num[%d] mb_links[%d] thread[%d] fd[%d] transaction OK, update_HZ[%0.03f]",
-                   this_mb_tx_num, this_mb_tx->mb_link_num, this_mb_link_num, modbus_get_socket(this_mb_link->modbus),
-                   1.0/(get_time()-this_mb_tx->last_time_ok));
-                this_mb_tx->last_time_ok = get_time();
-                (**this_mb_tx->num_errors) = 0;
+        if (ret != retOK && modbus_get_socket(this_mb_link->modbus) < 0) { //link failure
+            (*this_mb_tx->num_errors)++;
+            ERR(this_mb_tx->cfg_debug, "mb_tx_num[%d] mb_links[%d] thread[%d] fd[%d] link failure, going to close link",
+                this_mb_tx_num, this_mb_tx->mb_link_num, this_mb_link_num, modbus_get_socket(this_mb_link->modbus));
+            modbus_close(this_mb_link->modbus);
+        }
+        else if (ret != retOK) {  //transaction failure but link OK
+            (**this_mb_tx->num_errors)++;
+            ERR(this_mb_tx->cfg_debug, "mb_tx_num[%d] mb_links[%d] thread[%d] fd[%d] transaction failure, num_errors[%d]",
+                this_mb_tx_num, this_mb_tx->mb_link_num, this_mb_link_num, modbus_get_socket(this_mb_link->modbus), **this_mb_tx->num_errors);
+        }
+        else { //transaction and link OK
+            OK(this_mb_tx->cfg_debug, "mb_tx_num[%d] mb_links[%d] thread[%d] fd[%d] transaction OK, update_HZ[%0.03f]",
+               this_mb_tx_num, this_mb_tx->mb_link_num, this_mb_link_num, modbus_get_socket(this_mb_link->modbus),
+               1.0/(get_time()-this_mb_tx->last_time_ok));
+            if (this_mb_tx->last_time_ok > 0) {
+                (**this_mb_tx->rate) = 1.0/(get_time()-this_mb_tx->last_time_ok);
+                (**this_mb_tx->latency) = get_time() - this_mb_tx->next_time;
             }
+            this_mb_tx->last_time_ok = get_time();
+            (**this_mb_tx->num_errors) = 0;
+        }
+        set_merged_tx_status(this_mb_tx);
 
-            //set the next (waiting) time for update rate
-            this_mb_tx->next_time = get_time() + this_mb_tx->time_increment;
-
-            //wait time for serial lines
-            if (this_mb_tx->cfg_link_type == linkRTU) {
-                DBG(this_mb_tx->cfg_debug, "mb_tx_num[%d] mb_links[%d] thread[%d] fd[%d] SERIAL_DELAY_MS activated [%d]",
-                    this_mb_tx_num, this_mb_tx->mb_link_num, this_mb_link_num, modbus_get_socket(this_mb_link->modbus),
-                    this_mb_tx->cfg_serial_delay_ms);
-                usleep(this_mb_tx->cfg_serial_delay_ms * 1000);
-            }
+        //set the next (waiting) time for update rate
+        set_next_tx_time(this_mb_tx);
 
-            //wait time to gbl.slowdown activity (debugging)
-            if (gbl.slowdown > 0) {
-                DBG(this_mb_tx->cfg_debug, "mb_tx_num[%d] mb_links[%d] thread[%d] fd[%d] gbl.slowdown activated [%0.3f]",
-                    this_mb_tx_num, this_mb_tx->mb_link_num, this_mb_link_num, modbus_get_socket(this_mb_link->modbus), gbl.slowdown);
-                usleep(gbl.slowdown * 1000 * 1000);
-            }
-        }  //end for
+        //wait time for serial lines
+        if (this_mb_tx->cfg_link_type == linkRTU) {
+            DBG(this_mb_tx->cfg_debug, "mb_tx_num[%d] mb_links[%d] thread[%d] fd[%d] SERIAL_DELAY_MS activated [%d]",
+                this_mb_tx_num, this_mb_tx->mb_link_num, this_mb_link_num, modbus_get_socket(this_mb_link->modbus),
+                this_mb_tx->cfg_serial_delay_ms);
+            usleep(this_mb_tx->cfg_serial_delay_ms * 1000);
+        }
 
+        //wait time to gbl.slowdown activity (debugging)
+        if (gbl.slowdown > 0) {
+            DBG(this_mb_tx->cfg_debug, "mb_tx_num[%d] mb_links[%d] thread[%d] fd[%d] gbl.slowdown activated [%0.3f]",
+                this_mb_tx_num, this_mb_tx->mb_link_num, this_mb_link_num, modbus_get_socket(this_mb_link->modbus), gbl.slowdown);
+            usleep(gbl.slowdown * 1000 * 1000);
+        }
     } //end while
 
     return NULL;
 }
 
 /*
- * Check if the transaction is available for this link
+ * The next transaction of this link: the one with the earliest next_time
+ * (deadline of its update rate). ret_wait_time is the time left to it.
  */
 
-retCode is_this_tx_ready(const int this_mb_link_num, const int this_mb_tx_num, int *ret_available)
+retCode get_next_tx(const int this_mb_link_num, int *ret_mb_tx_num, double *ret_wait_time)
 {
-    char *fnct_name = "is_this_tx_available";
-    mb_tx_t *this_mb_tx;
-    int this_mb_tx_link_num;
+    char *fnct_name = "get_next_tx";
+    int tx_counter;
+    mb_tx_t *this_mb_tx, *next_mb_tx = NULL;
 
-    if (this_mb_tx_num < 0 || this_mb_tx_num > gbl.tot_mb_tx) {
-        ERR(gbl.init_dbg, "parameter out of range this_mb_tx_num[%d]", this_mb_tx_num);
+    if (ret_mb_tx_num == NULL || ret_wait_time == NULL) {
+        ERR(gbl.init_dbg, "NULL pointer");
         return retERR;
     }
-    this_mb_tx = &gbl.mb_tx[this_mb_tx_num];
-
-    if (ret_available == NULL) {
-        ERR(this_mb_tx->cfg_debug, "NULL pointer");
+    if (this_mb_link_num < 0 || this_mb_link_num >= gbl.tot_mb_links) {
+        ERR(gbl.init_dbg, "parameter out of range this_mb_link_num[%d]", this_mb_link_num);
         return retERR;
     }
 
-    this_mb_tx_link_num = this_mb_tx->mb_link_num;
-    if (this_mb_tx_link_num < 0 || this_mb_tx_link_num >= gbl.tot_mb_links) {
-        ERR(this_mb_tx->cfg_debug, "parameter out of range this_mb_tx_link_num[%d]", this_mb_tx_link_num);
-        return retERR;
+    for (tx_counter = 0; tx_counter < gbl.tot_mb_tx; tx_counter++) {
+        this_mb_tx = &gbl.mb_tx[tx_counter];
+        //the tx is not of this link, or is done in the request of the tx it was merged to
+        if (this_mb_tx->mb_link_num != this_mb_link_num || this_mb_tx->mb_tx_merged_to >= 0) {
+            continue;
+        }
+        if (next_mb_tx == NULL || this_mb_tx->next_time < next_mb_tx->next_time) {
+            next_mb_tx = this_mb_tx;
+        }
     }
 
-    *ret_available = 0; //defaults to not available
-
-    //the tx is not of this link
-    if (this_mb_link_num != this_mb_tx_link_num) {
+    if (next_mb_tx == NULL) { //all the tx of this link were merged to other links
+        *ret_mb_tx_num = -1;
+        *ret_wait_time = 1.0;
         return retOK;
     }
 
-    //not now
-    if (get_time() < this_mb_tx->next_time) {
-        return retOK;
+    *ret_mb_tx_num = next_mb_tx->mb_tx_num;
+    *ret_wait_time = next_mb_tx->next_time - get_time();
+    if (*ret_wait_time < 0) { //now
+        *ret_wait_time = 0;
     }
-
-    *ret_available = 1; //is available
     return retOK;
 }
 
+/*
+ * Next deadline of a tx done: one period after the last one, to hold the
+ * update rate on average, or now if it is more than one period late
+ * (or has no update rate)
+ */
+
+void set_next_tx_time(mb_tx_t *this_mb_tx)
+{
+    double now = get_time();
+
+    this_mb_tx->next_time += this_mb_tx->time_increment;
+    if (this_mb_tx->next_time < now - this_mb_tx->time_increment) {
+        this_mb_tx->next_time = now;
+    }
+}
+
+/*
+ * Copy the result of a request to the tx merged to this_mb_tx
+ */
+
+void set_merged_tx_status(mb_tx_t *this_mb_tx)
+{
+    int tx_counter;
+    mb_tx_t *merged_mb_tx;
+
+    for (tx_counter = this_mb_tx->mb_tx_num + 1; tx_counter < gbl.tot_mb_tx; tx_counter++) {
+        merged_mb_tx = &gbl.mb_tx[tx_counter];
+        if (merged_mb_tx->mb_tx_merged_to == this_mb_tx->mb_tx_num) {
+            merged_mb_tx->last_time_ok = this_mb_tx->last_time_ok;
+            (**merged_mb_tx->num_errors) = (**this_mb_tx->num_errors);
+            (**merged_mb_tx->rate) = (**this_mb_tx->rate);
+            (**merged_mb_tx->latency) = (**this_mb_tx->latency);
+        }
+    }
+}
+
 /*
  * First time connection or reconnection
  */
@@ -389,6 +423,7 @@ void set_init_gbl_params()
     gbl.hal_mod_id   = -1;
     gbl.init_dbg     = debugERR; //until readed in config file
     gbl.slowdown     = 0;        //until readed in config file
+    gbl.merge_tx     = 0;        //until readed in config file
     gbl.mb_tx_fncts[mbtxERR]                         = "";
     gbl.mb_tx_fncts[mbtx_02_READ_DISCRETE_INPUTS]    = "fnct_02_read_discrete_inputs";
     gbl.mb_tx_fncts[mbtx_03_READ_HOLDING_REGISTERS]  = "fnct_03_read_holding_registers";
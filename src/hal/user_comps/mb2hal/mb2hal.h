@@ -72,12 +72,16 @@ typedef struct {
     int  cfg_serial_delay_ms;  //delay between tx in serial lines
     char cfg_tcp_ip[17];       //tcp address
     int  cfg_tcp_port;         //tcp port number
+    int  cfg_tcp_connections;  //tcp connections (links) to this address
     //mb_* are Modbus transaction protocol related params
     int        mb_tx_slave_id; //MB device id
     mb_tx_fnct mb_tx_fnct;     //MB function code id
     char       mb_tx_fnct_name[64]; //str version of mb_tx_fnct
     int        mb_tx_1st_addr; //MB first register
     int        mb_tx_nelem;    //MB n registers
+    int        mb_tx_merged_to;    //-1, or the tx whose request also covers this tx
+    int        mb_tx_req_1st_addr; //MB first register of the request (this tx and the merged ones)
+    int        mb_tx_req_nelem;    //MB n registers of the request
     int        mb_response_timeout_ms; //MB response timeout
     int        mb_byte_timeout_ms;     //MB byte timeout
     //cfg_* are others INI config params
@@ -100,6 +104,8 @@ typedef struct {
     //hal_float_t *offset; //not yet implemented
     hal_bit_t **bit;
     hal_u32_t **num_errors;     //num of acummulated errors (0=last tx OK)
+    hal_float_t **rate;         //achieved update rate (Hz)
+    hal_float_t **latency;      //last tx done, seconds after its due time
 } mb_tx_t;
 
 //Modbus link structure (mb_link_t)
@@ -133,6 +139,7 @@ typedef struct {
     //INI config, common section
     int    init_dbg;
     double slowdown;
+    int    merge_tx;
     //HAL related
     int   hal_mod_id;
     char *hal_mod_name;
@@ -151,8 +158,10 @@ extern gbl_t gbl;
 
 //mb2hal.c
 void *link_loop_and_logic(void *thrd_link_num);
-retCode is_this_tx_ready(const int this_mb_link_num, const int this_mb_tx_num, int *ret_available);
+retCode get_next_tx(const int this_mb_link_num, int *ret_mb_tx_num, double *ret_wait_time);
+void set_next_tx_time(mb_tx_t *this_mb_tx);
 retCode get_tx_connection(const int mb_tx_num, int *ret_connected);
+void set_merged_tx_status(mb_tx_t *this_mb_tx);
 void set_init_gbl_params();
 double get_time();
 void quit_signal(int signal);
@@ -169,6 +178,7 @@ retCode check_int_in(int n_args, const int int_value, ...);
 retCode check_str_in(int n_args, const char *str_value, ...);
 retCode init_mb_links();
 retCode init_mb_tx();
+retCode merge_mb_tx();
 
 //mb2hal_hal.c
 retCode create_HAL_pins();
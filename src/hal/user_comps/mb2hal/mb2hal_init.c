@@ -101,6 +101,10 @@ retCode parse_common_section()
     iniFindDouble(gbl.ini_file_ptr, tag, section, &gbl.slowdown);
     DBG(gbl.init_dbg, "[%s] [%s] [%0.3f]", section, tag, gbl.slowdown);
 
+    tag     = "MERGE_TRANSACTIONS"; //optional
+    iniFindInt(gbl.ini_file_ptr, tag, section, &gbl.merge_tx);
+    DBG(gbl.init_dbg, "[%s] [%s] [%d]", section, tag, gbl.merge_tx);
+
     tag     = "TOTAL_TRANSACTIONS"; //required
     if (iniFindInt(gbl.ini_file_ptr, tag, section, &gbl.tot_mb_tx) != 0) {
         ERR(gbl.init_dbg, "required [%s] [%s] not found", section, tag);
@@ -387,6 +391,21 @@ retCode parse_tcp_subsection(const char *section, const int mb_tx_num)
     }
     DBG(gbl.init_dbg, "[%s] [%s] [%d]", section, tag, this_mb_tx->cfg_tcp_port);
 
+    tag = "TCP_CONNECTIONS"; //optional
+    this_mb_tx->cfg_tcp_connections = 1; //default
+    if (iniFindInt(gbl.ini_file_ptr, tag, section, &this_mb_tx->cfg_tcp_connections) != 0) { //not found
+        if (mb_tx_num > 0) { //previous value?
+            if (strcasecmp(this_mb_tx->cfg_link_type_str, gbl.mb_tx[mb_tx_num-1].cfg_link_type_str) == 0) {
+                this_mb_tx->cfg_tcp_connections = gbl.mb_tx[mb_tx_num-1].cfg_tcp_connections;
+            }
+        }
+    }
+    if (this_mb_tx->cfg_tcp_connections < 1) {
+        ERR(gbl.init_dbg, "[%s] [%s] [%d] out of range", section, tag, this_mb_tx->cfg_tcp_connections);
+        return retERR;
+    }
+    DBG(gbl.init_dbg, "[%s] [%s] [%d]", section, tag, this_mb_tx->cfg_tcp_connections);
+
     return retOK;
 }
 
@@ -611,13 +630,27 @@ retCode init_mb_links()
             }
         }
         else { //tcp
+            //with TCP_CONNECTIONS > 1, up to that many links to the same address,
+            //each tx goes to the one with less tx
+            int tot_connections = 0, lk_tot_tx, min_tot_tx = -1, tx_scan;
             for (lk_counter = 0; lk_counter < gbl.tot_mb_links; lk_counter++) {
                 if (strcasecmp(this_mb_tx->cfg_tcp_ip, gbl.mb_links[lk_counter].lp_tcp_ip) == 0) {
-                    isNewLink = 0; //repeated link
-                    this_mb_tx->mb_link_num = lk_counter; //each tx know its own link
-                    break;
+                    tot_connections++;
+                    lk_tot_tx = 0;
+                    for (tx_scan = 0; tx_scan < tx_counter; tx_scan++) {
+                        if (gbl.mb_tx[tx_scan].mb_link_num == lk_counter) {
+                            lk_tot_tx++;
+                        }
+                    }
+                    if (min_tot_tx < 0 || lk_tot_tx < min_tot_tx) {
+                        min_tot_tx = lk_tot_tx;
+                        this_mb_tx->mb_link_num = lk_counter; //each tx know its own link
+                    }
                 }
             }
+            if (tot_connections > 0 && tot_connections >= this_mb_tx->cfg_tcp_connections) {
+                isNewLink = 0; //repeated link
+            }
         }
         if (isNewLink != 0) { //initialize new link
             this_mb_tx->mb_link_num = gbl.mb_links[gbl.tot_mb_links].mb_link_num  = gbl.tot_mb_links; //next available unused link
@@ -717,10 +750,111 @@ retCode init_mb_tx()
         }
         this_mb_tx->next_time = 0; //next time for this tx
 
+        //default = one request per transaction
+        this_mb_tx->mb_tx_merged_to = -1;
+        this_mb_tx->mb_tx_req_1st_addr = this_mb_tx->mb_tx_1st_addr;
+        this_mb_tx->mb_tx_req_nelem = this_mb_tx->mb_tx_nelem;
+
         DBG(gbl.init_dbg, "MB_TX %d lk_n[%d] tx_n[%d] cfg_dbg[%d] lk_dbg[%d] t_inc[%0.3f] nxt_t[%0.3f]",
             tx_counter, this_mb_tx->mb_link_num, this_mb_tx->mb_tx_num, this_mb_tx->cfg_debug,
             this_mb_tx->protocol_debug, this_mb_tx->time_increment, this_mb_tx->next_time);
     }
 
+    if (gbl.merge_tx != 0) {
+        return merge_mb_tx();
+    }
+
+    return retOK;
+}
+
+/*
+ * MERGE_TRANSACTIONS: a transaction whose elements are next to or overlap
+ * the ones of a previous transaction, with the same device, slave, function
+ * code, update rate and timeouts, is done in the request of that previous
+ * transaction, while the request size allows it.
+ */
+static int max_nelem(mb_tx_fnct fnct)
+{
+    switch (fnct) {
+    case mbtx_02_READ_DISCRETE_INPUTS:
+        return MB2HAL_MAX_FNCT02_ELEMENTS;
+    case mbtx_03_READ_HOLDING_REGISTERS:
+        return MB2HAL_MAX_FNCT03_ELEMENTS;
+    case mbtx_04_READ_INPUT_REGISTERS:
+        return MB2HAL_MAX_FNCT04_ELEMENTS;
+    case mbtx_15_WRITE_MULTIPLE_COILS:
+        return MB2HAL_MAX_FNCT15_ELEMENTS;
+    case mbtx_16_WRITE_MULTIPLE_REGISTERS:
+        return MB2HAL_MAX_FNCT16_ELEMENTS;
+    default:
+        return 0;
+    }
+}
+
+static int can_merge_mb_tx(const mb_tx_t *to, const mb_tx_t *tx)
+{
+    int req_1st, req_end;
+
+    if (to->cfg_link_type != tx->cfg_link_type
+            || to->mb_tx_slave_id != tx->mb_tx_slave_id
+            || to->mb_tx_fnct != tx->mb_tx_fnct
+            || to->cfg_update_rate != tx->cfg_update_rate
+            || to->mb_response_timeout_ms != tx->mb_response_timeout_ms
+            || to->mb_byte_timeout_ms != tx->mb_byte_timeout_ms) {
+        return 0;
+    }
+    if (to->cfg_link_type == linkRTU) { //serial
+        if (to->mb_link_num != tx->mb_link_num) {
+            return 0;
+        }
+    }
+    else if (strcasecmp(to->cfg_tcp_ip, tx->cfg_tcp_ip) != 0 || to->cfg_tcp_port != tx->cfg_tcp_port) { //tcp
+        return 0;
+    }
+    //next to or overlapping
+    if (tx->mb_tx_1st_addr > to->mb_tx_req_1st_addr + to->mb_tx_req_nelem
+            || to->mb_tx_req_1st_addr > tx->mb_tx_1st_addr + tx->mb_tx_nelem) {
+        return 0;
+    }
+    req_1st = (tx->mb_tx_1st_addr < to->mb_tx_req_1st_addr)? tx->mb_tx_1st_addr : to->mb_tx_req_1st_addr;
+    req_end = (tx->mb_tx_1st_addr + tx->mb_tx_nelem > to->mb_tx_req_1st_addr + to->mb_tx_req_nelem)?
+              tx->mb_tx_1st_addr + tx->mb_tx_nelem : to->mb_tx_req_1st_addr + to->mb_tx_req_nelem;
+    return (req_end - req_1st <= max_nelem(to->mb_tx_fnct));
+}
+
+retCode merge_mb_tx()
+{
+    char *fnct_name="merge_mb_tx";
+    int to_counter, tx_counter, merged;
+    mb_tx_t *to_mb_tx, *this_mb_tx;
+
+    for (to_counter = 0; to_counter < gbl.tot_mb_tx; to_counter++) {
+        to_mb_tx = &gbl.mb_tx[to_counter];
+        if (to_mb_tx->mb_tx_merged_to >= 0) {
+            continue;
+        }
+        do { //a growing request may now reach a tx already tested
+            merged = 0;
+            for (tx_counter = to_counter + 1; tx_counter < gbl.tot_mb_tx; tx_counter++) {
+                this_mb_tx = &gbl.mb_tx[tx_counter];
+                if (this_mb_tx->mb_tx_merged_to >= 0 || !can_merge_mb_tx(to_mb_tx, this_mb_tx)) {
+                    continue;
+                }
+                if (this_mb_tx->mb_tx_1st_addr < to_mb_tx->mb_tx_req_1st_addr) {
+                    to_mb_tx->mb_tx_req_nelem += to_mb_tx->mb_tx_req_1st_addr - this_mb_tx->mb_tx_1st_addr;
+                    to_mb_tx->mb_tx_req_1st_addr = this_mb_tx->mb_tx_1st_addr;
+                }
+                if (this_mb_tx->mb_tx_1st_addr + this_mb_tx->mb_tx_nelem > to_mb_tx->mb_tx_req_1st_addr + to_mb_tx->mb_tx_req_nelem) {
+                    to_mb_tx->mb_tx_req_nelem = this_mb_tx->mb_tx_1st_addr + this_mb_tx->mb_tx_nelem - to_mb_tx->mb_tx_req_1st_addr;
+                }
+                this_mb_tx->mb_tx_merged_to = to_counter;
+                this_mb_tx->mb_link_num = to_mb_tx->mb_link_num;
+                merged = 1;
+                DBG(gbl.init_dbg, "MB_TX %d merged to MB_TX %d, request 1st_addr[%d] nelem[%d]",
+                    tx_counter, to_counter, to_mb_tx->mb_tx_req_1st_addr, to_mb_tx->mb_tx_req_nelem);
+            }
+        } while (merged);
+    }
+
     return retOK;
 }
@@ -1,24 +1,45 @@
 #include <sys/time.h>
 #include "mb2hal.h"
 
+/*
+ * Next transaction done in the request of this_mb_tx: this_mb_tx itself,
+ * then the ones merged to it (MERGE_TRANSACTIONS), NULL at the end
+ */
+
+static mb_tx_t *next_tx_of_request(mb_tx_t *this_mb_tx, mb_tx_t *prev_mb_tx)
+{
+    int tx_counter;
+
+    if (prev_mb_tx == NULL) {
+        return this_mb_tx;
+    }
+    for (tx_counter = prev_mb_tx->mb_tx_num + 1; tx_counter < gbl.tot_mb_tx; tx_counter++) {
+        if (gbl.mb_tx[tx_counter].mb_tx_merged_to == this_mb_tx->mb_tx_num) {
+            return &gbl.mb_tx[tx_counter];
+        }
+    }
+    return NULL;
+}
+
 retCode fnct_02_read_discrete_inputs(mb_tx_t *this_mb_tx, mb_link_t *this_mb_link)
 {
     char *fnct_name = "fnct_02_read_discrete_inputs";
-    int counter, ret;
+    int counter, offset, ret;
+    mb_tx_t *req_mb_tx;
     uint8_t bits[MB2HAL_MAX_FNCT02_ELEMENTS];
 
     if (this_mb_tx == NULL || this_mb_link == NULL) {
         return retERR;
     }
-    if (this_mb_tx->mb_tx_nelem > MB2HAL_MAX_FNCT02_ELEMENTS) {
+    if (this_mb_tx->mb_tx_req_nelem > MB2HAL_MAX_FNCT02_ELEMENTS) {
         return retERR;
     }
 
     DBG(this_mb_tx->cfg_debug, "mb_tx[%d] mb_links[%d] slave[%d] fd[%d] 1st_addr[%d] nelem[%d]",
         this_mb_tx->mb_tx_num, this_mb_tx->mb_link_num, this_mb_tx->mb_tx_slave_id, modbus_get_socket(this_mb_link->modbus),
-        this_mb_tx->mb_tx_1st_addr, this_mb_tx->mb_tx_nelem);
+        this_mb_tx->mb_tx_req_1st_addr, this_mb_tx->mb_tx_req_nelem);
 
-    ret = modbus_read_input_bits(this_mb_link->modbus, this_mb_tx->mb_tx_1st_addr, this_mb_tx->mb_tx_nelem, bits);
+    ret = modbus_read_input_bits(this_mb_link->modbus, this_mb_tx->mb_tx_req_1st_addr, this_mb_tx->mb_tx_req_nelem, bits);
     if (ret < 0) {
         if (modbus_get_socket(this_mb_link->modbus) < 0) {
             modbus_close(this_mb_link->modbus);
@@ -29,8 +50,11 @@ retCode fnct_02_read_discrete_inputs(mb_tx_t *this_mb_tx, mb_link_t *this_mb_lin
         return retERR;
     }
 
-    for (counter = 0; counter < this_mb_tx->mb_tx_nelem; counter++) {
-        *(this_mb_tx->bit[counter]) = bits[counter];
+    for (req_mb_tx = next_tx_of_request(this_mb_tx, NULL); req_mb_tx != NULL; req_mb_tx = next_tx_of_request(this_mb_tx, req_mb_tx)) {
+        offset = req_mb_tx->mb_tx_1st_addr - this_mb_tx->mb_tx_req_1st_addr;
+        for (counter = 0; counter < req_mb_tx->mb_tx_nelem; counter++) {
+            *(req_mb_tx->bit[counter]) = bits[offset + counter];
+        }
     }
 
     return retOK;
@@ -39,21 +63,22 @@ retCode fnct_02_read_discrete_inputs(mb_tx_t *this_mb_tx, mb_link_t *this_mb_lin
 retCode fnct_03_read_holding_registers(mb_tx_t *this_mb_tx, mb_link_t *this_mb_link)
 {
     char *fnct_name = "fnct_03_read_holding_registers";
-    int counter, ret;
+    int counter, offset, ret;
+    mb_tx_t *req_mb_tx;
     uint16_t data[MB2HAL_MAX_FNCT03_ELEMENTS];
 
     if (this_mb_tx == NULL || this_mb_link == NULL) {
         return retERR;
     }
-    if (this_mb_tx->mb_tx_nelem > MB2HAL_MAX_FNCT03_ELEMENTS) {
+    if (this_mb_tx->mb_tx_req_nelem > MB2HAL_MAX_FNCT03_ELEMENTS) {
         return retERR;
     }
 
     DBG(this_mb_tx->cfg_debug, "mb_tx[%d] mb_links[%d] slave[%d] fd[%d] 1st_addr[%d] nelem[%d]",
         this_mb_tx->mb_tx_num, this_mb_tx->mb_link_num, this_mb_tx->mb_tx_slave_id,
-        modbus_get_socket(this_mb_link->modbus), this_mb_tx->mb_tx_1st_addr, this_mb_tx->mb_tx_nelem);
+        modbus_get_socket(this_mb_link->modbus), this_mb_tx->mb_tx_req_1st_addr, this_mb_tx->mb_tx_req_nelem);
 
-    ret = modbus_read_registers(this_mb_link->modbus, this_mb_tx->mb_tx_1st_addr, this_mb_tx->mb_tx_nelem, data);
+    ret = modbus_read_registers(this_mb_link->modbus, this_mb_tx->mb_tx_req_1st_addr, this_mb_tx->mb_tx_req_nelem, data);
     if (ret < 0) {
         if (modbus_get_socket(this_mb_link->modbus) < 0) {
             modbus_close(this_mb_link->modbus);
@@ -64,12 +89,15 @@ retCode fnct_03_read_holding_registers(mb_tx_t *this_mb_tx, mb_link_t *this_mb_l
         return retERR;
     }
 
-    for (counter = 0; counter < this_mb_tx->mb_tx_nelem; counter++) {
-        float val = data[counter];
-        //val *= this_mb_tx->scale[counter];
-        //val += this_mb_tx->offset[counter];
-        *(this_mb_tx->float_value[counter]) = val;
-        *(this_mb_tx->int_value[counter]) = (hal_s32_t) val;
+    for (req_mb_tx = next_tx_of_request(this_mb_tx, NULL); req_mb_tx != NULL; req_mb_tx = next_tx_of_request(this_mb_tx, req_mb_tx)) {
+        offset = req_mb_tx->mb_tx_1st_addr - this_mb_tx->mb_tx_req_1st_addr;
+        for (counter = 0; counter < req_mb_tx->mb_tx_nelem; counter++) {
+            float val = data[offset + counter];
+            //val *= req_mb_tx->scale[counter];
+            //val += req_mb_tx->offset[counter];
+            *(req_mb_tx->float_value[counter]) = val;
+            *(req_mb_tx->int_value[counter]) = (hal_s32_t) val;
+        }
     }
 
     return retOK;
@@ -78,21 +106,22 @@ retCode fnct_03_read_holding_registers(mb_tx_t *this_mb_tx, mb_link_t *this_mb_l
 retCode fnct_04_read_input_registers(mb_tx_t *this_mb_tx, mb_link_t *this_mb_link)
 {
     char *fnct_name = "fnct_04_read_input_registers";
-    int counter, ret;
+    int counter, offset, ret;
+    mb_tx_t *req_mb_tx;
     uint16_t data[MB2HAL_MAX_FNCT04_ELEMENTS];
 
     if (this_mb_tx == NULL || this_mb_link == NULL) {
         return retERR;
     }
-    if (this_mb_tx->mb_tx_nelem > MB2HAL_MAX_FNCT04_ELEMENTS) {
+    if (this_mb_tx->mb_tx_req_nelem > MB2HAL_MAX_FNCT04_ELEMENTS) {
         return retERR;
     }
 
     DBG(this_mb_tx->cfg_debug, "mb_tx[%d] mb_links[%d] slave[%d] fd[%d] 1st_addr[%d] nelem[%d]",
         this_mb_tx->mb_tx_num, this_mb_tx->mb_link_num, this_mb_tx->mb_tx_slave_id,
-        modbus_get_socket(this_mb_link->modbus), this_mb_tx->mb_tx_1st_addr, this_mb_tx->mb_tx_nelem);
+        modbus_get_socket(this_mb_link->modbus), this_mb_tx->mb_tx_req_1st_addr, this_mb_tx->mb_tx_req_nelem);
 
-    ret = modbus_read_input_registers(this_mb_link->modbus, this_mb_tx->mb_tx_1st_addr, this_mb_tx->mb_tx_nelem, data);
+    ret = modbus_read_input_registers(this_mb_link->modbus, this_mb_tx->mb_tx_req_1st_addr, this_mb_tx->mb_tx_req_nelem, data);
     if (ret < 0) {
         if (modbus_get_socket(this_mb_link->modbus) < 0) {
             modbus_close(this_mb_link->modbus);
@@ -103,12 +132,15 @@ retCode fnct_04_read_input_registers(mb_tx_t *this_mb_tx, mb_link_t *this_mb_lin
         return retERR;
     }
 
-    for (counter = 0; counter < this_mb_tx->mb_tx_nelem; counter++) {
-        float val = data[counter];
-        //val += this_mb_tx->offset[counter];
-        //val *= this_mb_tx->scale[counter];
-        *(this_mb_tx->float_value[counter]) = val;
-        *(this_mb_tx->int_value[counter]) = (hal_s32_t) val;
+    for (req_mb_tx = next_tx_of_request(this_mb_tx, NULL); req_mb_tx != NULL; req_mb_tx = next_tx_of_request(this_mb_tx, req_mb_tx)) {
+        offset = req_mb_tx->mb_tx_1st_addr - this_mb_tx->mb_tx_req_1st_addr;
+        for (counter = 0; counter < req_mb_tx->mb_tx_nelem; counter++) {
+            float val = data[offset + counter];
+            //val += req_mb_tx->offset[counter];
+            //val *= req_mb_tx->scale[counter];
+            *(req_mb_tx->float_value[counter]) = val;
+            *(req_mb_tx->int_value[counter]) = (hal_s32_t) val;
+        }
     }
 
     return retOK;
@@ -117,25 +149,30 @@ retCode fnct_04_read_input_registers(mb_tx_t *this_mb_tx, mb_link_t *this_mb_lin
 retCode fnct_15_write_multiple_coils(mb_tx_t *this_mb_tx, mb_link_t *this_mb_link)
 {
     char *fnct_name = "fnct_15_write_multiple_coils";
-    int counter, ret;
+    int counter, offset, ret;
+    mb_tx_t *req_mb_tx;
     uint8_t bits[MB2HAL_MAX_FNCT15_ELEMENTS];
 
     if (this_mb_tx == NULL || this_mb_link == NULL) {
         return retERR;
     }
-    if (this_mb_tx->mb_tx_nelem > MB2HAL_MAX_FNCT15_ELEMENTS) {
+    if (this_mb_tx->mb_tx_req_nelem > MB2HAL_MAX_FNCT15_ELEMENTS) {
         return retERR;
     }
 
-    for (counter = 0; counter < this_mb_tx->mb_tx_nelem; counter++) {
-        bits[counter] = *(this_mb_tx->bit[counter]);
+    //in tx order, so an overlapping element gets the value of the last tx as before
+    for (req_mb_tx = next_tx_of_request(this_mb_tx, NULL); req_mb_tx != NULL; req_mb_tx = next_tx_of_request(this_mb_tx, req_mb_tx)) {
+        offset = req_mb_tx->mb_tx_1st_addr - this_mb_tx->mb_tx_req_1st_addr;
+        for (counter = 0; counter < req_mb_tx->mb_tx_nelem; counter++) {
+            bits[offset + counter] = *(req_mb_tx->bit[counter]);
+        }
     }
 
     DBG(this_mb_tx->cfg_debug, "mb_tx[%d] mb_links[%d] slave[%d] fd[%d] 1st_addr[%d] nelem[%d]",
         this_mb_tx->mb_tx_num, this_mb_tx->mb_link_num, this_mb_tx->mb_tx_slave_id,
-        modbus_get_socket(this_mb_link->modbus), this_mb_tx->mb_tx_1st_addr, this_mb_tx->mb_tx_nelem);
+        modbus_get_socket(this_mb_link->modbus), this_mb_tx->mb_tx_req_1st_addr, this_mb_tx->mb_tx_req_nelem);
 
-    ret = modbus_write_bits(this_mb_link->modbus, this_mb_tx->mb_tx_1st_addr, this_mb_tx->mb_tx_nelem, bits);
+    ret = modbus_write_bits(this_mb_link->modbus, this_mb_tx->mb_tx_req_1st_addr, this_mb_tx->mb_tx_req_nelem, bits);
     if (ret < 0) {
         if (modbus_get_socket(this_mb_link->modbus) < 0) {
             modbus_close(this_mb_link->modbus);
@@ -152,28 +189,33 @@ retCode fnct_15_write_multiple_coils(mb_tx_t *this_mb_tx, mb_link_t *this_mb_lin
 retCode fnct_16_write_multiple_registers(mb_tx_t *this_mb_tx, mb_link_t *this_mb_link)
 {
     char *fnct_name = "fnct_16_write_multiple_registers";
-    int counter, ret;
+    int counter, offset, ret;
+    mb_tx_t *req_mb_tx;
     uint16_t data[MB2HAL_MAX_FNCT16_ELEMENTS];
 
     if (this_mb_tx == NULL || this_mb_link == NULL) {
         return retERR;
     }
-    if (this_mb_tx->mb_tx_nelem > MB2HAL_MAX_FNCT16_ELEMENTS) {
+    if (this_mb_tx->mb_tx_req_nelem > MB2HAL_MAX_FNCT16_ELEMENTS) {
         return retERR;
     }
 
-    for (counter = 0; counter < this_mb_tx->mb_tx_nelem; counter++) {
-        //float val = *(this_mb_tx->float_value[counter]) / this_mb_tx->scale[counter];
-        //val -= this_mb_tx->offset[counter];
-        float val = *(this_mb_tx->float_value[counter]);
-        data[counter] = (int) val;
+    //in tx order, so an overlapping element gets the value of the last tx as before
+    for (req_mb_tx = next_tx_of_request(this_mb_tx, NULL); req_mb_tx != NULL; req_mb_tx = next_tx_of_request(this_mb_tx, req_mb_tx)) {
+        offset = req_mb_tx->mb_tx_1st_addr - this_mb_tx->mb_tx_req_1st_addr;
+        for (counter = 0; counter < req_mb_tx->mb_tx_nelem; counter++) {
+            //float val = *(req_mb_tx->float_value[counter]) / req_mb_tx->scale[counter];
+            //val -= req_mb_tx->offset[counter];
+            float val = *(req_mb_tx->float_value[counter]);
+            data[offset + counter] = (int) val;
+        }
     }
 
     DBG(this_mb_tx->cfg_debug, "mb_tx[%d] mb_links[%d] slave[%d] fd[%d] 1st_addr[%d] nelem[%d]",
         this_mb_tx->mb_tx_num, this_mb_tx->mb_link_num, this_mb_tx->mb_tx_slave_id,
-        modbus_get_socket(this_mb_link->modbus), this_mb_tx->mb_tx_1st_addr, this_mb_tx->mb_tx_nelem);
+        modbus_get_socket(this_mb_link->modbus), this_mb_tx->mb_tx_req_1st_addr, this_mb_tx->mb_tx_req_nelem);
 
-    ret = modbus_write_registers(this_mb_link->modbus, this_mb_tx->mb_tx_1st_addr, this_mb_tx->mb_tx_nelem, data);
+    ret = modbus_write_registers(this_mb_link->modbus, this_mb_tx->mb_tx_req_1st_addr, this_mb_tx->mb_tx_req_nelem, data);
     if (ret < 0) {
         if (modbus_get_socket(this_mb_link->modbus) < 0) {
             modbus_close(this_mb_link->modbus);
@@ -177,6 +177,15 @@ struct libusb_transfer *transfer_in  = NULL;
 unsigned char in_buf[32];
 void setup_asynch_transfer(libusb_device_handle *dev_handle);
 
+// The display is sent as 6 control transfers, one after the other from
+// the completion of the last, and only when its contents change
+struct libusb_transfer *transfer_out = NULL;
+unsigned char out_buf[LIBUSB_CONTROL_SETUP_SIZE + 8];
+unsigned char display_data[6*8];	// shown or being sent
+static bool display_valid = false;	// the pendant shows display_data
+static int display_packet = -1;		// being sent, -1 if none
+static bool input_seen = false;		// since the last main loop pass
+
 extern "C" const char *
 iniFind(FILE *fp, const char *tag, const char *section)
 {
@@ -269,26 +278,59 @@ void xhc_display_encode(xhc_t *xhc, unsigned char *data, int len)
 	}
 }
 
+void cb_display_out(struct libusb_transfer *transfer);
+
+void submit_display_packet(libusb_device_handle *dev_handle, int packet)
+{
+	libusb_fill_control_setup(out_buf,
+	              LIBUSB_DT_HID, //bmRequestType 0x21
+	              LIBUSB_REQUEST_SET_CONFIGURATION, //bRequest 0x09
+	              0x0306,         //wValue
+	              0x00,           //wIndex
+	              8);             //wLength
+	memcpy(out_buf + LIBUSB_CONTROL_SETUP_SIZE, display_data + 8*packet, 8);
+	libusb_fill_control_transfer(transfer_out, dev_handle, out_buf,
+		cb_display_out, NULL, 1000);
+	display_packet = packet;
+	if (libusb_submit_transfer(transfer_out) < 0) {
+		display_packet = -1;
+		do_reconnect = 1;
+	}
+}
+
+void cb_display_out(struct libusb_transfer *transfer)
+{
+	switch (transfer->status) {
+	case LIBUSB_TRANSFER_COMPLETED:
+		if (display_packet < 5) {
+			submit_display_packet(transfer->dev_handle, display_packet + 1);
+			return;
+		}
+		display_valid = true;
+		break;
+	case LIBUSB_TRANSFER_TIMED_OUT:
+	case LIBUSB_TRANSFER_CANCELLED:
+		break;		// sent again on the next change
+	default:
+		do_reconnect = 1;
+		break;
+	}
+	display_packet = -1;
+}
+
 void xhc_set_display(libusb_device_handle *dev_handle, xhc_t *xhc)
 {
 	unsigned char data[6*8];
-	int packet;
+
+	if (display_packet >= 0) return;	// still sending the last one
 
 	xhc_display_encode(xhc, data, sizeof(data));
+	if (display_valid && memcmp(data, display_data, sizeof(data)) == 0)
+		return;
 
-	for (packet=0; packet<6; packet++) {
-		int r = libusb_control_transfer(dev_handle,
-		              LIBUSB_DT_HID, //bmRequestType 0x21
-		              LIBUSB_REQUEST_SET_CONFIGURATION, //bRequest 0x09
-		              0x0306,         //wValue
-		              0x00,           //wIndex
-		              data+8*packet,  //*data
-		              8,              //wLength
-		              0);             //timeout
-		if (r < 0) {
-			do_reconnect = 1;
-		}
-	}
+	memcpy(display_data, data, sizeof(data));
+	display_valid = false;
+	submit_display_packet(dev_handle, 0);
 }
 
 void hexdump(unsigned char *data, int len)
@@ -427,10 +469,19 @@ void handle_step(xhc_t *xhc)
 	*(xhc->hal->jog_scale) = *(xhc->hal->stepsize) * 0.001f;
 }
 
+void xhc_update(xhc_t *xhc)
+{
+	compute_velocity(xhc);
+	if (simu_mode) linuxcnc_simu(xhc);
+	handle_step(xhc);
+}
+
 void cb_response_in(struct libusb_transfer *transfer)
 {
 	int i;
 
+	if (transfer->status == LIBUSB_TRANSFER_CANCELLED) return;
+
 	if (transfer->actual_length > 0) {
 		if (simu_mode) hexdump(in_buf, transfer->actual_length);
 
@@ -497,9 +548,14 @@ void cb_response_in(struct libusb_transfer *transfer)
 					if (simu_mode) {
 						fprintf(stderr,"Wake\n");
 					}
+					display_valid = false;
 				}
 				*(xhc.hal->sleeping) = 0;
 			}
+
+		// jog right away rather than on the next pass of the main loop
+		xhc_update(&xhc);
+		input_seen = true;
 	}
 
 	libusb_submit_transfer(transfer);
@@ -845,6 +901,9 @@ int main (int argc,char **argv)
 			}
 			//allocate the transfer struct here only once after successful connection
 			transfer_in  = libusb_alloc_transfer(0);
+			transfer_out = libusb_alloc_transfer(0);
+			display_valid = false;
+			display_packet = -1;
 		}
 
 		*(xhc.hal->connected) = 1;
@@ -865,13 +924,21 @@ int main (int argc,char **argv)
 				tv.tv_sec  = 0;
 				tv.tv_usec = 30000;
 				r = libusb_handle_events_timeout(ctx, &tv);
-				compute_velocity(&xhc);
-			    if (simu_mode) linuxcnc_simu(&xhc);
-				handle_step(&xhc);
+				// without input, still let the jog velocity decay
+				// and follow the step size buttons in simulation
+				if (!input_seen) xhc_update(&xhc);
+				input_seen = false;
 				xhc_set_display(dev_handle, &xhc);
 			}
 			*(xhc.hal->connected) = 0;
 			printf("%s: connection lost, cleaning up\n",modname);
+			if (display_packet >= 0) {
+				struct timeval tv = { 0, 100000 };
+				libusb_cancel_transfer(transfer_out);
+				for (int n = 0; display_packet >= 0 && n < 10; n++)
+					libusb_handle_events_timeout(ctx, &tv);
+			}
+			if (display_packet < 0) libusb_free_transfer(transfer_out);
 			libusb_cancel_transfer(transfer_in);
 			libusb_free_transfer(transfer_in);
 			libusb_release_interface(dev_handle, 0);
@@ -67,6 +67,7 @@ FILE *halcmd_inifile = NULL;
 #include "hal.h"		/* HAL public API decls */
 #include "../hal_priv.h"	/* private HAL decls */
 #include "halcmd_commands.h"
+#include "halwatch.h"
 
 /***********************************************************************
 *                  LOCAL FUNCTION DECLARATIONS                         *
@@ -85,6 +86,8 @@ int hal_flag = 0;	/* used to indicate that halcmd might have the
 			   exit, instead it must set 'done' */
 int halcmd_done = 0;		/* used to break out of processing loop */
 int scriptmode = 0;	/* used to make output "script friendly" (suppress headers) */
+int parallel_mode = 0;	/* loadusr -W does not wait until the next command
+			   that may need the component */
 int echo_mode = 0;
 char comp_name[HAL_NAME_LEN+1];	/* name for this instance of halcmd */
 
@@ -123,6 +126,7 @@ int halcmd_startup(int quiet) {
 void halcmd_shutdown(void) {
     /* tell the signal handler we might have the mutex */
     hal_flag = 1;
+    halwatch_detach();
     hal_exit(comp_id);
 }
 
@@ -136,11 +140,13 @@ void halcmd_shutdown(void) {
 struct halcmd_command halcmd_commands[] = {
     {"addf",    FUNCT(do_addf_cmd),    A_TWO | A_PLUS },
     {"alias",   FUNCT(do_alias_cmd),   A_THREE },
+    {"compact", FUNCT(do_compact_cmd), A_ZERO },
     {"delf",    FUNCT(do_delf_cmd),    A_TWO | A_OPTIONAL },
     {"delsig",  FUNCT(do_delsig_cmd),  A_ONE },
     {"echo",    FUNCT(do_echo_cmd),    A_ZERO },
     {"getp",    FUNCT(do_getp_cmd),    A_ONE },
     {"gets",    FUNCT(do_gets_cmd),    A_ONE },
+    {"profile", FUNCT(do_profile_cmd), A_TWO | A_OPTIONAL },
     {"ptype",   FUNCT(do_ptype_cmd),   A_ONE },
     {"stype",   FUNCT(do_stype_cmd),   A_ONE },
     {"help",    FUNCT(do_help_cmd),    A_ONE | A_OPTIONAL },
@@ -148,6 +154,7 @@ struct halcmd_command halcmd_commands[] = {
     {"linkps",  FUNCT(do_linkps_cmd),  A_TWO | A_REMOVE_ARROWS },
     {"linksp",  FUNCT(do_linksp_cmd),  A_TWO | A_REMOVE_ARROWS },
     {"list",    FUNCT(do_list_cmd),    A_ONE | A_PLUS },
+    {"loadbin", FUNCT(do_loadbin_cmd), A_TWO | A_OPTIONAL | A_TILDE },
     {"loadrt",  FUNCT(do_loadrt_cmd),  A_ONE | A_PLUS },
     {"loadusr", FUNCT(do_loadusr_cmd), A_PLUS | A_TILDE },
     {"lock",    FUNCT(do_lock_cmd),    A_ONE | A_OPTIONAL },
@@ -169,7 +176,9 @@ struct halcmd_command halcmd_commands[] = {
     {"unloadrt", FUNCT(do_unloadrt_cmd), A_ONE },
     {"unloadusr", FUNCT(do_unloadusr_cmd), A_ONE },
     {"unlock",  FUNCT(do_unlock_cmd),  A_ONE | A_OPTIONAL },
+    {"unwatch", FUNCT(do_unwatch_cmd), A_PLUS },
     {"waitusr", FUNCT(do_waitusr_cmd), A_ONE },
+    {"watch",   FUNCT(do_watch_cmd),   A_PLUS },
 };
 int halcmd_ncommands = (sizeof(halcmd_commands) / sizeof(halcmd_commands[0]));
 
@@ -191,6 +200,7 @@ pid_t hal_systemv_nowait(char *const argv[]) {
 
     /* now we need to fork, and then exec .... */
     /* disconnect from the HAL shmem area before forking */
+    halwatch_detach();
     hal_exit(comp_id);
     comp_id = 0;
     /* now the fork() */
@@ -310,6 +320,12 @@ static int parse_cmd1(char **argv) {
     if(argc == 0)
         return 0;
 
+    /* anything but loading more components may use the pins of those
+       still starting up */
+    if(strcmp(argv[0], "loadusr") && strcmp(argv[0], "loadrt")
+            && halcmd_wait_pending() != 0)
+        return -1;
+
     if(!command) {
 	// special case: pin/param = newvalue
 	if(argc == 3 && !strcmp(argv[1], "=")) {
@@ -42,10 +42,12 @@
 #include "hal.h"		/* HAL public API decls */
 #include "../hal_priv.h"	/* private HAL decls */
 #include "halcmd_commands.h"
+#include "halwatch.h"
 #include <rtapi_mutex.h>
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdarg.h>
 #include <ctype.h>
 #include <string.h>
 #include <sys/stat.h>
@@ -55,6 +57,7 @@
 #include <errno.h>
 #include <time.h>
 #include <fnmatch.h>
+#include <math.h>
 
 
 static int unloadrt_comp(char *mod_name);
@@ -67,6 +70,7 @@ static void print_script_sig_info(int type, char **patterns);
 static void print_param_info(int type, char **patterns);
 static void print_funct_info(char **patterns);
 static void print_thread_info(char **patterns);
+static void print_latency_info(char **patterns);
 static void print_comp_names(char **patterns);
 static void print_pin_names(char **patterns);
 static void print_sig_names(char **patterns);
@@ -76,14 +80,38 @@ static void print_thread_names(char **patterns);
 static void print_lock_status();
 static int count_list(int list_root);
 static void print_mem_status();
+static void print_arena_status(void);
 static const char *data_type(int type);
 static const char *data_type2(int type);
+
+/* loadusr -W programs that were started in parallel mode, but whose
+   components have not been waited for yet */
+#define MAX_PENDING_USR 64
+
+struct pending_usr {
+    pid_t pid;
+    char *prog_name;
+    char *comp_name;
+    char *args;		/* command line, for 'save binary' */
+    int done;
+};
+
+static struct pending_usr pending_usr[MAX_PENDING_USR];
+static int num_pending_usr;
 static const char *pin_data_dir(int dir);
 static const char *param_data_dir(int dir);
 static const char *data_arrow1(int dir);
 static const char *data_arrow2(int dir);
 static char *data_value(int type, void *valptr);
 static char *data_value2(int type, void *valptr);
+static void listing_reset(void);
+static void listing_output(const char *format, ...)
+    __attribute__((format(printf,1,2)));
+static void listing_flush(void);
+static void listing_write(FILE *dst);
+static int sig_pins_build(const unsigned int *seq);
+static hal_pin_t *sig_pin_next(hal_sig_t *sig, hal_pin_t *pin, size_t *pos);
+static void print_json_info(char **patterns);
 static void save_comps(FILE *dst);
 static void save_aliases(FILE *dst);
 static void save_signals(FILE *dst, int only_unlinked);
@@ -92,6 +120,7 @@ static void save_nets(FILE *dst, int arrows);
 static void save_params(FILE *dst);
 static void save_unconnected_input_pin_values(FILE *dst);
 static void save_threads(FILE *dst);
+static int save_snapshot(char *filename);
 static void print_help_commands(void);
 
 static int tmatch(int req_type, int type) {
@@ -300,6 +329,84 @@ int do_stop_cmd(void) {
     return retval;
 }
 
+int do_compact_cmd(void) {
+    int retval = hal_compact_signals();
+    if (retval >= 0) {
+        halcmd_info("Compacted %d signals\n", retval);
+        retval = 0;
+    }
+    return retval;
+}
+
+static int print_thread_profile(char *thread_name)
+{
+    int next_thread, n, found = 0;
+    hal_thread_t *tptr;
+    hal_list_t *list_root, *list_entry;
+    hal_funct_entry_t *fentry;
+    hal_funct_t *funct;
+    hal_profile_t *prof;
+
+    rtapi_mutex_get(&(hal_data->mutex));
+    next_thread = hal_data->thread_list_ptr;
+    while (next_thread != 0) {
+	tptr = SHMPTR(next_thread);
+	next_thread = tptr->next_ptr;
+	if (thread_name && strcmp(thread_name, tptr->name) != 0) {
+	    continue;
+	}
+	found = 1;
+	halcmd_output("Thread %s (profiling %s)\n", tptr->name,
+	    tptr->profile ? "on" : "off");
+	list_root = &(tptr->funct_list);
+	list_entry = list_next(list_root);
+	while (list_entry != list_root) {
+	    fentry = (hal_funct_entry_t *) list_entry;
+	    list_entry = list_next(list_entry);
+	    funct = SHMPTR(fentry->funct_ptr);
+	    if (funct->profile_ptr == 0) {
+		halcmd_output("  %-32s  (no data)\n", funct->name);
+		continue;
+	    }
+	    prof = SHMPTR(funct->profile_ptr);
+	    halcmd_output("  %-32s  calls %10lu  max %10ld\n", funct->name,
+		(unsigned long)prof->calls, (long)funct->maxtime);
+	    for (n = 0; n < HAL_PROFILE_BUCKETS; n++) {
+		if (prof->hist[n] == 0) continue;
+		halcmd_output("    >= 2^%-2d cycles  %10lu\n", n,
+		    (unsigned long)prof->hist[n]);
+	    }
+	}
+    }
+    rtapi_mutex_give(&(hal_data->mutex));
+    return found;
+}
+
+int do_profile_cmd(char *action, char *thread) {
+    int retval;
+
+    if (strcmp(action, "on") == 0) {
+	retval = hal_set_thread_profile(thread, 1);
+    } else if (strcmp(action, "off") == 0) {
+	retval = hal_set_thread_profile(thread, 0);
+    } else if (strcmp(action, "reset") == 0) {
+	retval = hal_reset_thread_profile(thread);
+    } else if (strcmp(action, "show") == 0) {
+	if (!print_thread_profile(thread) && thread) {
+	    halcmd_error("thread '%s' not found\n", thread);
+	    return -EINVAL;
+	}
+	return 0;
+    } else {
+	halcmd_error("unknown profile action '%s'\n", action);
+	return -EINVAL;
+    }
+    if (retval != 0) {
+	halcmd_error("profile %s failed\n", action);
+    }
+    return retval;
+}
+
 int do_echo_cmd(void) {
     printf("Echo on\n");
     return 0;
@@ -309,13 +416,16 @@ int do_unecho_cmd(void) {
     return 0;
 }
 int do_addf_cmd(char *func, char *thread, char **opt) {
-    char *position_str = opt ? opt[0] : NULL;
-    int position = -1;
-    int retval;
+    int position = -1, barrier = 0;
+    int retval, i;
 
-    if(position_str && *position_str) position = atoi(position_str);
+    /* the options are a position and 'barrier', in either order */
+    for(i = 0; opt && opt[i] && *opt[i]; i++) {
+        if(strcmp(opt[i], "barrier") == 0) barrier = 1;
+        else position = atoi(opt[i]);
+    }
 
-    retval = hal_add_funct_to_thread(func, thread, position);
+    retval = hal_add_funct_to_thread_barrier(func, thread, position, barrier);
     if(retval == 0) {
         halcmd_info("Function '%s' added to thread '%s'\n",
                     func, thread);
@@ -582,12 +692,12 @@ int do_newinst_cmd(char *comp_name, char *inst_name) {
     }
     }
 #endif
-    rtapi_mutex_get(&hal_data->mutex);
+    halpr_lock();
     {
     hal_comp_t *inst = halpr_alloc_comp_struct();
     if (inst == 0) {
         /* couldn't allocate structure */
-        rtapi_mutex_give(&(hal_data->mutex));
+        halpr_unlock();
         halcmd_error(
             "insufficient memory for instance '%s'\n", inst_name);
         return -ENOMEM;
@@ -603,7 +713,7 @@ int do_newinst_cmd(char *comp_name, char *inst_name) {
     inst->next_ptr = hal_data->comp_list_ptr;
     hal_data->comp_list_ptr = SHMOFF(inst);
 
-    rtapi_mutex_give(&(hal_data->mutex));
+    halpr_unlock();
     }
     return 0;
 }
@@ -758,31 +868,40 @@ int do_ptype_cmd(char *name)
     hal_param_t *param;
     hal_pin_t *pin;
     hal_type_t type;
+    int tries, found;
+    unsigned int seq;
     
     rtapi_print_msg(RTAPI_MSG_DBG, "getting parameter '%s'\n", name);
-    /* get mutex before accessing shared data */
-    rtapi_mutex_get(&(hal_data->mutex));
-    /* search param list for name */
-    param = halpr_find_param_by_name(name);
-    if (param) {
-        /* found it */
-        type = param->type;
-        halcmd_output("%s\n", data_type2(type));
-        rtapi_mutex_give(&(hal_data->mutex));
-        return 0;
+    /* look it up without the mutex, see halpr_read_begin() */
+    for (tries = 0; ; tries++) {
+	seq = halpr_read_begin(tries);
+	listing_reset();
+	found = 0;
+	/* search param list for name */
+	param = halpr_find_param_by_name(name);
+	if (param) {
+	    /* found it */
+	    type = param->type;
+	    listing_output("%s\n", data_type2(type));
+	    found = 1;
+	} else {
+	    /* not found, search pin list for name */
+	    pin = halpr_find_pin_by_name(name);
+	    if(pin) {
+		/* found it */
+		type = pin->type;
+		listing_output("%s\n", data_type2(type));
+		found = 1;
+	    }
+	}
+	if (!halpr_read_retry(seq, tries)) {
+	    break;
+	}
+    }
+    if (found) {
+	listing_flush();
+	return 0;
     }
-        
-    /* not found, search pin list for name */
-    pin = halpr_find_pin_by_name(name);
-    if(pin) {
-        /* found it */
-        type = pin->type;
-        halcmd_output("%s\n", data_type2(type));
-        rtapi_mutex_give(&(hal_data->mutex));
-        return 0;
-    }   
-    
-    rtapi_mutex_give(&(hal_data->mutex));
     halcmd_error("pin or parameter '%s' not found\n", name);
     return -EINVAL;
 }
@@ -795,39 +914,48 @@ int do_getp_cmd(char *name)
     hal_sig_t *sig;
     hal_type_t type;
     void *d_ptr;
+    int tries, found;
+    unsigned int seq;
     
     rtapi_print_msg(RTAPI_MSG_DBG, "getting parameter '%s'\n", name);
-    /* get mutex before accessing shared data */
-    rtapi_mutex_get(&(hal_data->mutex));
-    /* search param list for name */
-    param = halpr_find_param_by_name(name);
-    if (param) {
-        /* found it */
-        type = param->type;
-        d_ptr = SHMPTR(param->data_ptr);
-        halcmd_output("%s\n", data_value2((int) type, d_ptr));
-        rtapi_mutex_give(&(hal_data->mutex));
-        return 0;
+    /* look it up without the mutex, see halpr_read_begin() */
+    for (tries = 0; ; tries++) {
+	seq = halpr_read_begin(tries);
+	listing_reset();
+	found = 0;
+	/* search param list for name */
+	param = halpr_find_param_by_name(name);
+	if (param) {
+	    /* found it */
+	    type = param->type;
+	    d_ptr = SHMPTR(param->data_ptr);
+	    listing_output("%s\n", data_value2((int) type, d_ptr));
+	    found = 1;
+	} else {
+	    /* not found, search pin list for name */
+	    pin = halpr_find_pin_by_name(name);
+	    if(pin) {
+		/* found it */
+		type = pin->type;
+		if (pin->signal != 0) {
+		    sig = SHMPTR(pin->signal);
+		    d_ptr = SHMPTR(sig->data_ptr);
+		} else {
+		    sig = 0;
+		    d_ptr = &(pin->dummysig);
+		}
+		listing_output("%s\n", data_value2((int) type, d_ptr));
+		found = 1;
+	    }
+	}
+	if (!halpr_read_retry(seq, tries)) {
+	    break;
+	}
+    }
+    if (found) {
+	listing_flush();
+	return 0;
     }
-        
-    /* not found, search pin list for name */
-    pin = halpr_find_pin_by_name(name);
-    if(pin) {
-        /* found it */
-        type = pin->type;
-        if (pin->signal != 0) {
-            sig = SHMPTR(pin->signal);
-            d_ptr = SHMPTR(sig->data_ptr);
-        } else {
-            sig = 0;
-            d_ptr = &(pin->dummysig);
-        }
-        halcmd_output("%s\n", data_value2((int) type, d_ptr));
-        rtapi_mutex_give(&(hal_data->mutex));
-        return 0;
-    }   
-    
-    rtapi_mutex_give(&(hal_data->mutex));
     halcmd_error("pin or parameter '%s' not found\n", name);
     return -EINVAL;
 }
@@ -873,46 +1001,156 @@ int do_sets_cmd(char *name, char *value)
 int do_stype_cmd(char *name)
 {
     hal_sig_t *sig;
-    hal_type_t type;
+    int tries;
+    unsigned int seq;
 
     rtapi_print_msg(RTAPI_MSG_DBG, "getting signal '%s'\n", name);
-    /* get mutex before accessing shared data */
-    rtapi_mutex_get(&(hal_data->mutex));
-    /* search signal list for name */
-    sig = halpr_find_sig_by_name(name);
+    /* look it up without the mutex, see halpr_read_begin() */
+    for (tries = 0; ; tries++) {
+	seq = halpr_read_begin(tries);
+	listing_reset();
+	/* search signal list for name */
+	sig = halpr_find_sig_by_name(name);
+	if (sig) {
+	    listing_output("%s\n", data_type2(sig->type));
+	}
+	if (!halpr_read_retry(seq, tries)) {
+	    break;
+	}
+    }
     if (sig == 0) {
-	rtapi_mutex_give(&(hal_data->mutex));
 	halcmd_error("signal '%s' not found\n", name);
 	return -EINVAL;
     }
-    /* found it */
-    type = sig->type;
-    halcmd_output("%s\n", data_type2(type));
-    rtapi_mutex_give(&(hal_data->mutex));
+    listing_flush();
     return 0;
 }
 
 int do_gets_cmd(char *name)
 {
     hal_sig_t *sig;
-    hal_type_t type;
-    void *d_ptr;
+    int tries;
+    unsigned int seq;
 
     rtapi_print_msg(RTAPI_MSG_DBG, "getting signal '%s'\n", name);
-    /* get mutex before accessing shared data */
-    rtapi_mutex_get(&(hal_data->mutex));
-    /* search signal list for name */
-    sig = halpr_find_sig_by_name(name);
+    /* look it up without the mutex, see halpr_read_begin() */
+    for (tries = 0; ; tries++) {
+	seq = halpr_read_begin(tries);
+	listing_reset();
+	/* search signal list for name */
+	sig = halpr_find_sig_by_name(name);
+	if (sig) {
+	    listing_output("%s\n",
+		data_value2((int) sig->type, SHMPTR(sig->data_ptr)));
+	}
+	if (!halpr_read_retry(seq, tries)) {
+	    break;
+	}
+    }
     if (sig == 0) {
-	rtapi_mutex_give(&(hal_data->mutex));
 	halcmd_error("signal '%s' not found\n", name);
 	return -EINVAL;
     }
-    /* found it */
-    type = sig->type;
-    d_ptr = SHMPTR(sig->data_ptr);
-    halcmd_output("%s\n", data_value2((int) type, d_ptr));
-    rtapi_mutex_give(&(hal_data->mutex));
+    listing_flush();
+    return 0;
+}
+
+/* reads 'name' as a pin, signal or parameter without the mutex, the
+   way the halwatch service looks it up; returns its type or -1 */
+static int watch_direct(char *name, hal_data_u *value)
+{
+    hal_pin_t *pin;
+    hal_sig_t *sig;
+    hal_param_t *param;
+    hal_data_u *d_ptr;
+    int tries, type;
+    unsigned int seq;
+
+    for (tries = 0; ; tries++) {
+	seq = halpr_read_begin(tries);
+	type = -1;
+	d_ptr = 0;
+	if ((pin = halpr_find_pin_by_name(name)) != 0) {
+	    type = pin->type;
+	    if (pin->signal != 0) {
+		sig = SHMPTR(pin->signal);
+		d_ptr = SHMPTR(sig->data_ptr);
+	    } else {
+		d_ptr = &(pin->dummysig);
+	    }
+	} else if ((sig = halpr_find_sig_by_name(name)) != 0) {
+	    type = sig->type;
+	    d_ptr = SHMPTR(sig->data_ptr);
+	} else if ((param = halpr_find_param_by_name(name)) != 0) {
+	    type = param->type;
+	    d_ptr = SHMPTR(param->data_ptr);
+	}
+	if (d_ptr) {
+	    memset(value, 0, sizeof(*value));
+	    switch (type) {
+	    case HAL_BIT: value->b = d_ptr->b; break;
+	    case HAL_S32: value->s = d_ptr->s; break;
+	    case HAL_U32: value->u = d_ptr->u; break;
+	    case HAL_FLOAT: value->f = d_ptr->f; break;
+	    default: break;
+	    }
+	}
+	if (!halpr_read_retry(seq, tries)) {
+	    break;
+	}
+    }
+    return type;
+}
+
+int do_watch_cmd(char *names[])
+{
+    halwatch_sample_t sample;
+    int i, slot, retval = 0;
+
+    if (!names[0] || !*names[0]) {
+	halcmd_error("watch needs at least one name\n");
+	return -EINVAL;
+    }
+    listing_reset();
+    for (i = 0; names[i] && *names[i]; i++) {
+	slot = -1;
+	if (halwatch_attach(comp_id) == 0) {
+	    slot = halwatch_take(names[i], HALWATCH_ANY);
+	}
+	if (slot < 0 || halwatch_read(slot, &sample) == -EAGAIN) {
+	    /* no service, or it hasn't sampled the item yet */
+	    sample.type = watch_direct(names[i], &sample.value);
+	    sample.min = sample.max = sample.value;
+	}
+	if (sample.type <= 0) {
+	    halcmd_error("pin, signal or parameter '%s' not found\n", names[i]);
+	    retval = -EINVAL;
+	    continue;
+	}
+	listing_output("%s", data_value2(sample.type, &sample.value));
+	listing_output(" %s", data_value2(sample.type, &sample.min));
+	listing_output(" %s\n", data_value2(sample.type, &sample.max));
+    }
+    listing_flush();
+    return retval;
+}
+
+int do_unwatch_cmd(char *names[])
+{
+    int i, slot;
+
+    if (halwatch_attach(comp_id) != 0) {
+	return 0;
+    }
+    if (!names[0] || !*names[0]) {
+	halwatch_give_all();
+	return 0;
+    }
+    for (i = 0; names[i] && *names[i]; i++) {
+	/* taking it again finds the slot this process already has */
+	slot = halwatch_take(names[i], HALWATCH_ANY);
+	halwatch_give(slot);
+    }
     return 0;
 }
 
@@ -988,9 +1226,13 @@ int do_show_cmd(char *type, char **patterns)
 	print_funct_info(patterns);
     } else if (strcmp(type, "thread") == 0) {
 	print_thread_info(patterns);
+    } else if (strcmp(type, "latency") == 0) {
+	print_latency_info(patterns);
     } else if (strcmp(type, "alias") == 0) {
 	print_pin_aliases(patterns);
 	print_param_aliases(patterns);
+    } else if (strcmp(type, "json") == 0) {
+	print_json_info(patterns);
     } else {
 	halcmd_error("Unknown 'show' type '%s'\n", type);
 	return -1;
@@ -1056,13 +1298,12 @@ int do_status_cmd(char *type)
     return 0;
 }
 
-int do_loadrt_cmd(char *mod_name, char *args[])
+static int loadrt_record_args(char *mod_name, char *args[]);
+
+static int loadrt_module(char *mod_name, char *args[])
 {
-    char arg_string[MAX_CMD_LEN+1];
     int m=0, n=0, retval;
-    hal_comp_t *comp;
     char *argv[MAX_TOK+3];
-    char *cp1;
 #if defined(RTAPI_USPACE)
     argv[m++] = "-Wn";
     argv[m++] = mod_name;
@@ -1074,7 +1315,13 @@ int do_loadrt_cmd(char *mod_name, char *args[])
         argv[m++] = args[n++];
     }
     argv[m++] = NULL;
-    retval = do_loadusr_cmd(argv);
+    {
+        /* the component is needed below, parallel mode or not */
+        int save_parallel = parallel_mode;
+        parallel_mode = 0;
+        retval = do_loadusr_cmd(argv);
+        parallel_mode = save_parallel;
+    }
 #else
     static char *rtmod_dir = EMC2_RTLIB_DIR;
     struct stat stat_buf;
@@ -1133,6 +1380,17 @@ int do_loadrt_cmd(char *mod_name, char *args[])
         , mod_name, retval );
 	return -1;
     }
+    return loadrt_record_args(mod_name, args);
+}
+
+/* keeps the args that were passed to the module with its component */
+static int loadrt_record_args(char *mod_name, char *args[])
+{
+    char arg_string[MAX_CMD_LEN+1];
+    int n;
+    hal_comp_t *comp;
+    char *cp1;
+
     /* make the args that were passed to the module into a single string */
     n = 0;
     arg_string[0] = '\0';
@@ -1165,6 +1423,88 @@ int do_loadrt_cmd(char *mod_name, char *args[])
     return 0;
 }
 
+#if defined(RTAPI_USPACE)
+/* loads all the modules of 'loadrt a [args] ; b [args]' with one request
+   to rtapi_app, instead of starting it once for each */
+static int loadrt_list(char *mod_name, char *args[])
+{
+    int m=0, n, start, retval;
+    char *argv[MAX_TOK+5];
+    char *group[MAX_TOK+1];
+
+    argv[m++] = "-w";
+    argv[m++] = EMC2_BIN_DIR "/rtapi_app";
+    argv[m++] = "loadlist";
+    argv[m++] = mod_name;
+    for (n = 0; args[n] && args[n][0] != '\0'; n++) {
+        argv[m++] = args[n];
+    }
+    argv[m] = NULL;
+    {
+        int save_parallel = parallel_mode;
+        parallel_mode = 0;
+        retval = do_loadusr_cmd(argv);
+        parallel_mode = save_parallel;
+    }
+    if ( retval != 0 ) {
+	halcmd_error("loading %s and the modules after it failed, returned %d\n",
+            mod_name, retval);
+	return -1;
+    }
+
+    /* the args of each module, up to the next ';' */
+    start = 0;
+    for (n = 0; ; n++) {
+        if (args[n] && args[n][0] != '\0' && strcmp(args[n], ";") != 0) {
+            continue;
+        }
+        memcpy(group, args + start, (n - start) * sizeof(char *));
+        group[n - start] = NULL;
+        retval = loadrt_record_args(mod_name, group);
+        if (retval != 0 || !args[n] || args[n][0] == '\0') {
+            return retval;
+        }
+        mod_name = args[n + 1];
+        start = n + 2;
+        n++;
+    }
+}
+#endif
+
+int do_loadrt_cmd(char *mod_name, char *args[])
+{
+    int n;
+
+    /* several modules may be given, separated by ';' */
+    for (n = 0; args[n] && args[n][0] != '\0'; n++) {
+        if (strcmp(args[n], ";") == 0) {
+            break;
+        }
+    }
+    if (!args[n] || args[n][0] == '\0') {
+        return loadrt_module(mod_name, args);
+    }
+    if (!args[n+1] || args[n+1][0] == '\0' || strcmp(args[n+1], ";") == 0) {
+        halcmd_error("loadrt: missing module name after ';'\n");
+        return -1;
+    }
+#if defined(RTAPI_USPACE)
+    return loadrt_list(mod_name, args);
+#else
+    {
+        char *group[MAX_TOK+1];
+        int retval;
+        memcpy(group, args, n * sizeof(char *));
+        group[n] = NULL;
+        retval = loadrt_module(mod_name, group);
+        if (retval != 0) {
+            return retval;
+        }
+        return do_loadrt_cmd(args[n+1], args + n + 2);
+    }
+#endif
+}
+
 int do_delsig_cmd(char *mod_name)
 {
     int next, retval, retval1, n;
@@ -1385,6 +1725,127 @@ static char *guess_comp_name(char *prog_name)
     return name;
 }
 
+/* Keeps the command line of a loadusr -W program with its component, as
+   loadrt does with the module arguments, so that 'save binary' can start
+   it again. */
+static void set_usr_args(const char *comp_name, const char *args)
+{
+    hal_comp_t *comp;
+    char *cp;
+    int want;
+
+    rtapi_mutex_get(&(hal_data->mutex));
+    comp = halpr_find_comp_by_name(comp_name);
+    want = comp && comp->type == 0 && comp->insmod_args == 0;
+    rtapi_mutex_give(&(hal_data->mutex));
+    if (!want || (cp = hal_malloc(strlen(args)+1)) == NULL) {
+        return;
+    }
+    strcpy(cp, args);
+    rtapi_mutex_get(&(hal_data->mutex));
+    comp = halpr_find_comp_by_name(comp_name);
+    if (comp) {
+        comp->insmod_args = SHMOFF(cp);
+    }
+    rtapi_mutex_give(&(hal_data->mutex));
+}
+
+/* Waits until each of the n components has become ready, or its program
+   has exited without making it ready.  Returns 0 if all of them became
+   ready. */
+static int wait_usr_ready(struct pending_usr *usr, int n)
+{
+    int left = n, count = 0, result = 0, i, retval, status;
+    hal_comp_t *comp;
+
+    for (i = 0; i < n; i++) {
+        usr[i].done = 0;
+    }
+    while (left > 0) {
+        /* sleep for 10mS */
+        struct timespec ts = {0, 10 * 1000 * 1000};
+        nanosleep(&ts, NULL);
+        for (i = 0; i < n; i++) {
+            int ready = 0, exited = 0;
+            if (usr[i].done) {
+                continue;
+            }
+            /* check for program ending */
+            retval = waitpid( usr[i].pid, &status, WNOHANG );
+            if ( retval != 0 ) {
+                exited = 1;
+                if (WIFEXITED(status) && WEXITSTATUS(status)) {
+                    halcmd_error("waitpid failed %s %s\n",
+                        usr[i].prog_name, usr[i].comp_name);
+                }
+            }
+            /* check for program becoming ready */
+            if ( !exited || !WIFEXITED(status) || !WEXITSTATUS(status) ) {
+                rtapi_mutex_get(&(hal_data->mutex));
+                comp = halpr_find_comp_by_name(usr[i].comp_name);
+                if(comp && comp->ready) {
+                    ready = 1;
+                }
+                rtapi_mutex_give(&(hal_data->mutex));
+            }
+            if (ready) {
+                set_usr_args(usr[i].comp_name, usr[i].args);
+                halcmd_info("Component '%s' ready\n", usr[i].comp_name);
+            } else if (exited) {
+                if ( retval < 0 ) {
+                    halcmd_error("\nwaitpid(%d) failed\n", usr[i].pid);
+                } else {
+                    halcmd_error("%s exited without becoming ready\n",
+                        usr[i].prog_name);
+                }
+                result = -1;
+            } else {
+                continue;
+            }
+            usr[i].done = 1;
+            left--;
+        }
+        /* pacify the user */
+        count++;
+        if(count == 200 && left > 0) {
+            for (i = 0; usr[i].done; i++);
+            if (left == 1) {
+                fprintf(stderr, "Waiting for component '%s' to become ready.",
+                        usr[i].comp_name);
+            } else {
+                fprintf(stderr, "Waiting for %d components to become ready.",
+                        left);
+            }
+            fflush(stderr);
+        } else if(count > 200 && count % 10 == 0) {
+            fprintf(stderr, ".");
+            fflush(stderr);
+        }
+    }
+    if (count >= 100) {
+        /* terminate pacifier */
+        fprintf(stderr, "\n");
+    }
+    return result;
+}
+
+int halcmd_wait_pending(void)
+{
+    int i, retval;
+
+    if (num_pending_usr == 0) {
+        return 0;
+    }
+    retval = wait_usr_ready(pending_usr, num_pending_usr);
+    for (i = 0; i < num_pending_usr; i++) {
+        free(pending_usr[i].prog_name);
+        free(pending_usr[i].comp_name);
+        free(pending_usr[i].args);
+    }
+    num_pending_usr = 0;
+    return retval;
+}
+
 static void reset_getopt_state() {
 /*
 
@@ -1453,6 +1914,11 @@ int do_loadusr_cmd(char *args[])
     args += optind;
     prog_name = *args++;
     if (prog_name == 0) { return -EINVAL; }
+    /* a program that is waited for may use the pending components */
+    if ( (wait_flag || num_pending_usr == MAX_PENDING_USR)
+            && halcmd_wait_pending() != 0 ) {
+        return -1;
+    }
     if(!new_comp_name) {
 	new_comp_name = guess_comp_name(prog_name);
     }
@@ -1476,56 +1942,30 @@ int do_loadusr_cmd(char *args[])
     }
     hal_ready(comp_id);
     if ( wait_comp_flag ) {
-        int ready = 0, count=0, exited=0;
-        hal_comp_t *comp = NULL;
-	retval = 0;
-        while(!ready && !exited) {
-	    /* sleep for 10mS */
-            struct timespec ts = {0, 10 * 1000 * 1000};
-            nanosleep(&ts, NULL);
-	    /* check for program ending */
-	    retval = waitpid( pid, &status, WNOHANG );
-	    if ( retval != 0 ) {
-		    exited = 1;
-	        if (WIFEXITED(status) && WEXITSTATUS(status)) {
-	            halcmd_error("waitpid failed %s %s\n",prog_name,new_comp_name);
-	            ready = 0;
-	            break;
-	        }
-	    }
-	    /* check for program becoming ready */
-            rtapi_mutex_get(&(hal_data->mutex));
-            comp = halpr_find_comp_by_name(new_comp_name);
-            if(comp && comp->ready) {
-                ready = 1;
-            }
-            rtapi_mutex_give(&(hal_data->mutex));
-	    /* pacify the user */
-            count++;
-            if(count == 200) {
-                fprintf(stderr, "Waiting for component '%s' to become ready.",
-                        new_comp_name);
-                fflush(stderr);
-            } else if(count > 200 && count % 10 == 0) {
-                fprintf(stderr, ".");
-                fflush(stderr);
-            }
+        struct pending_usr usr;
+        char arg_string[MAX_CMD_LEN+1] = "";
+        for (n = 0; argv[n]; n++) {
+            strncat(arg_string, argv[n], MAX_CMD_LEN - strlen(arg_string));
+            strncat(arg_string, " ", MAX_CMD_LEN - strlen(arg_string));
+        }
+        usr.pid = pid;
+        usr.prog_name = strdup(prog_name);
+        usr.comp_name = strdup(new_comp_name);
+        usr.args = strdup(arg_string);
+        if ( parallel_mode && !wait_flag ) {
+            /* waited for by halcmd_wait_pending(), together with the
+               others started since the last command that needed them */
+            pending_usr[num_pending_usr++] = usr;
+            halcmd_info("Program '%s' started\n", prog_name);
+            return 0;
+        }
+        retval = wait_usr_ready(&usr, 1);
+        free(usr.prog_name);
+        free(usr.comp_name);
+        free(usr.args);
+        if ( retval != 0 ) {
+            return -1;
         }
-        if (count >= 100) {
-	    /* terminate pacifier */
-	    fprintf(stderr, "\n");
-	}
-	/* did it work? */
-	if (ready) {
-	    halcmd_info("Component '%s' ready\n", new_comp_name);
-	} else {
-	    if ( retval < 0 ) {
-		halcmd_error("\nwaitpid(%d) failed\n", pid);
-	    } else {
-		halcmd_error("%s exited without becoming ready\n", prog_name);
-	    }
-	    return -1;
-	}
     }
     if ( wait_flag ) {
 	/* wait for child process to complete */
@@ -1598,6 +2038,170 @@ int do_waitusr_cmd(char *comp_name)
 }
 
 
+/* The listings of pins, signals and parameters walk the lists without
+   the mutex (see halpr_read_begin()), so that a UI polling them can't
+   hold up loadrt or net.  What they print is formatted into this
+   buffer and only output once the walk is known not to be torn. */
+static char *listing_text;
+static size_t listing_len, listing_size;
+
+static void listing_reset(void)
+{
+    listing_len = 0;
+}
+
+static void listing_output(const char *format, ...)
+{
+    va_list ap;
+    int n;
+
+    va_start(ap, format);
+    n = vsnprintf(listing_text + listing_len, listing_size - listing_len, format, ap);
+    va_end(ap);
+    if (n < 0) {
+	return;
+    }
+    if (listing_len + n >= listing_size) {
+	size_t size = listing_size ? listing_size : 4096;
+	char *text;
+
+	while (size <= listing_len + n) {
+	    size *= 2;
+	}
+	text = realloc(listing_text, size);
+	if (text == NULL) {
+	    return;
+	}
+	listing_text = text;
+	listing_size = size;
+	va_start(ap, format);
+	vsnprintf(listing_text + listing_len, listing_size - listing_len, format, ap);
+	va_end(ap);
+    }
+    listing_len += n;
+}
+
+/* outputs the buffer a line at a time, as halsh wants it */
+static void listing_flush(void)
+{
+    size_t start = 0, end;
+
+    while (start < listing_len) {
+	for (end = start; end < listing_len && listing_text[end] != '\n'; end++) {
+	}
+	if (end < listing_len) {
+	    end++;
+	}
+	halcmd_output("%.*s", (int) (end - start), listing_text + start);
+	start = end;
+    }
+    listing_len = 0;
+}
+
+/* 'save' formats into the same buffer while it holds the mutex, and
+   writes the file once it has let go of it */
+static void listing_write(FILE *dst)
+{
+    if (listing_len) {
+	fwrite(listing_text, 1, listing_len, dst);
+    }
+    fflush(dst);
+    listing_len = 0;
+}
+
+/* The pins linked to each signal, grouped by signal and in the order of
+   the pin list, so a listing of the signals with their pins takes one
+   walk of the pins rather than one for each signal, as
+   halpr_find_pin_by_sig() does.  Built under the mutex or in a lockless
+   read (seq is then that of halpr_read_begin(), or NULL). */
+struct sig_pin {
+    int sig;
+    int order;
+    int pin;
+};
+
+static struct sig_pin *sig_pins;
+static size_t sig_pins_len, sig_pins_size;
+static int sig_pins_ok;
+
+static int sig_pin_cmp(const void *a, const void *b)
+{
+    const struct sig_pin *pa = a, *pb = b;
+
+    if (pa->sig != pb->sig) {
+	return pa->sig < pb->sig ? -1 : 1;
+    }
+    return pa->order - pb->order;
+}
+
+static int sig_pins_build(const unsigned int *seq)
+{
+    int next, order = 0;
+    hal_pin_t *pin;
+
+    sig_pins_len = 0;
+    sig_pins_ok = 0;
+    next = hal_data->pin_list_ptr;
+    while (next != 0) {
+	if (seq && halpr_read_torn(*seq)) {
+	    return -1;
+	}
+	pin = SHMPTR(next);
+	if (pin->signal != 0) {
+	    if (sig_pins_len == sig_pins_size) {
+		size_t size = sig_pins_size ? sig_pins_size * 2 : 1024;
+		struct sig_pin *p = realloc(sig_pins, size * sizeof(*p));
+
+		if (p == NULL) {
+		    /* sig_pin_next() falls back to searching the pins */
+		    return -1;
+		}
+		sig_pins = p;
+		sig_pins_size = size;
+	    }
+	    sig_pins[sig_pins_len].sig = pin->signal;
+	    sig_pins[sig_pins_len].order = order;
+	    sig_pins[sig_pins_len].pin = next;
+	    sig_pins_len++;
+	}
+	order++;
+	next = pin->next_ptr;
+    }
+    qsort(sig_pins, sig_pins_len, sizeof(*sig_pins), sig_pin_cmp);
+    sig_pins_ok = 1;
+    return 0;
+}
+
+/* like halpr_find_pin_by_sig(), with pos the place in the table */
+static hal_pin_t *sig_pin_next(hal_sig_t *sig, hal_pin_t *pin, size_t *pos)
+{
+    int offset = SHMOFF(sig);
+
+    if (!sig_pins_ok) {
+	return halpr_find_pin_by_sig(sig, pin);
+    }
+    if (pin == 0) {
+	size_t lo = 0, hi = sig_pins_len;
+
+	while (lo < hi) {
+	    size_t mid = lo + (hi - lo) / 2;
+
+	    if (sig_pins[mid].sig < offset) {
+		lo = mid + 1;
+	    } else {
+		hi = mid;
+	    }
+	}
+	*pos = lo;
+    } else {
+	(*pos)++;
+    }
+    if (*pos < sig_pins_len && sig_pins[*pos].sig == offset) {
+	return SHMPTR(sig_pins[*pos].pin);
+    }
+    return 0;
+}
+
 static void print_comp_info(char **patterns)
 {
     int next;
@@ -1608,38 +2212,41 @@ static void print_comp_info(char **patterns)
 	halcmd_output("ID      Type  %-*s PID   State\n", HAL_NAME_LEN, "Name");
     }
     rtapi_mutex_get(&(hal_data->mutex));
+    listing_reset();
     next = hal_data->comp_list_ptr;
     while (next != 0) {
 	comp = SHMPTR(next);
 	if ( match(patterns, comp->name) ) {
             if(comp->type == 2) {
                 hal_comp_t *comp1 = halpr_find_comp_by_id(comp->comp_id & 0xffff);
-                halcmd_output("    INST %s %s",
+                listing_output("    INST %s %s",
                         comp1 ? comp1->name : "(unknown)", 
                         comp->name);
             } else {
-                halcmd_output(" %5d  %-4s  %-*s",
+                listing_output(" %5d  %-4s  %-*s",
                     comp->comp_id, (comp->type ? "RT" : "User"),
                     HAL_NAME_LEN, comp->name);
                 if(comp->type == 0) {
-                        halcmd_output(" %5d %s", comp->pid, comp->ready > 0 ?
+                        listing_output(" %5d %s", comp->pid, comp->ready > 0 ?
                                 "ready" : "initializing");
                 } else {
-                        halcmd_output(" %5s %s", "", comp->ready > 0 ?
+                        listing_output(" %5s %s", "", comp->ready > 0 ?
                                 "ready" : "initializing");
                 }
             }
-            halcmd_output("\n");
+            listing_output("\n");
 	}
 	next = comp->next_ptr;
     }
     rtapi_mutex_give(&(hal_data->mutex));
+    listing_flush();
     halcmd_output("\n");
 }
 
 static void print_pin_info(int type, char **patterns)
 {
-    int next;
+    int next, tries;
+    unsigned int seq;
     hal_pin_t *pin;
     hal_comp_t *comp;
     hal_sig_t *sig;
@@ -1649,43 +2256,49 @@ static void print_pin_info(int type, char **patterns)
 	halcmd_output("Component Pins:\n");
 	halcmd_output("Owner   Type  Dir         Value  Name\n");
     }
-    rtapi_mutex_get(&(hal_data->mutex));
-    next = hal_data->pin_list_ptr;
-    while (next != 0) {
-	pin = SHMPTR(next);
-	if ( tmatch(type, pin->type) && match(patterns, pin->name) ) {
-	    comp = SHMPTR(pin->owner_ptr);
-	    if (pin->signal != 0) {
-		sig = SHMPTR(pin->signal);
-		dptr = SHMPTR(sig->data_ptr);
-	    } else {
-		sig = 0;
-		dptr = &(pin->dummysig);
-	    }
-	    if (scriptmode == 0) {
-		halcmd_output(" %5d  %5s %-3s  %9s  %s",
-		    comp->comp_id,
-		    data_type((int) pin->type),
-		    pin_data_dir((int) pin->dir),
-		    data_value((int) pin->type, dptr),
-		    pin->name);
-	    } else {
-		halcmd_output("%s %s %s %s %s",
-		    comp->name,
-		    data_type((int) pin->type),
-		    pin_data_dir((int) pin->dir),
-		    data_value2((int) pin->type, dptr),
-		    pin->name);
-	    } 
-	    if (sig == 0) {
-		halcmd_output("\n");
-	    } else {
-		halcmd_output(" %s %s\n", data_arrow1((int) pin->dir), sig->name);
+    for (tries = 0; ; tries++) {
+	seq = halpr_read_begin(tries);
+	listing_reset();
+	next = hal_data->pin_list_ptr;
+	while (next != 0 && !halpr_read_torn(seq)) {
+	    pin = SHMPTR(next);
+	    if ( tmatch(type, pin->type) && match(patterns, pin->name) ) {
+		comp = SHMPTR(pin->owner_ptr);
+		if (pin->signal != 0) {
+		    sig = SHMPTR(pin->signal);
+		    dptr = SHMPTR(sig->data_ptr);
+		} else {
+		    sig = 0;
+		    dptr = &(pin->dummysig);
+		}
+		if (scriptmode == 0) {
+		    listing_output(" %5d  %5s %-3s  %9s  %s",
+			comp->comp_id,
+			data_type((int) pin->type),
+			pin_data_dir((int) pin->dir),
+			data_value((int) pin->type, dptr),
+			pin->name);
+		} else {
+		    listing_output("%s %s %s %s %s",
+			comp->name,
+			data_type((int) pin->type),
+			pin_data_dir((int) pin->dir),
+			data_value2((int) pin->type, dptr),
+			pin->name);
+		} 
+		if (sig == 0) {
+		    listing_output("\n");
+		} else {
+		    listing_output(" %s %s\n", data_arrow1((int) pin->dir), sig->name);
+		}
 	    }
+	    next = pin->next_ptr;
+	}
+	if (!halpr_read_retry(seq, tries)) {
+	    break;
 	}
-	next = pin->next_ptr;
     }
-    rtapi_mutex_give(&(hal_data->mutex));
+    listing_flush();
     halcmd_output("\n");
 }
 
@@ -1700,6 +2313,7 @@ static void print_pin_aliases(char **patterns)
 	halcmd_output(" %-*s  %s\n", HAL_NAME_LEN, "Alias", "Original Name");
     }
     rtapi_mutex_get(&(hal_data->mutex));
+    listing_reset();
     next = hal_data->pin_list_ptr;
     while (next != 0) {
 	pin = SHMPTR(next);
@@ -1708,24 +2322,27 @@ static void print_pin_aliases(char **patterns)
 	    oldname = SHMPTR(pin->oldname);
 	    if ( match(patterns, pin->name) || match(patterns, oldname->name) ) {
 		if (scriptmode == 0) {
-		    halcmd_output(" %-*s  %s\n", HAL_NAME_LEN, pin->name, oldname->name);
+		    listing_output(" %-*s  %s\n", HAL_NAME_LEN, pin->name, oldname->name);
 		} else {
-		    halcmd_output(" %s  %s\n", pin->name, oldname->name);
+		    listing_output(" %s  %s\n", pin->name, oldname->name);
 		}
 	    }
 	}
 	next = pin->next_ptr;
     }
     rtapi_mutex_give(&(hal_data->mutex));
+    listing_flush();
     halcmd_output("\n");
 }
 
 static void print_sig_info(int type, char **patterns)
 {
-    int next;
+    int next, tries;
+    unsigned int seq;
     hal_sig_t *sig;
     void *dptr;
     hal_pin_t *pin;
+    size_t pos;
 
     if (scriptmode != 0) {
     	print_script_sig_info(type, patterns);
@@ -1733,64 +2350,81 @@ static void print_sig_info(int type, char **patterns)
     }
     halcmd_output("Signals:\n");
     halcmd_output("Type          Value  Name     (linked to)\n");
-    rtapi_mutex_get(&(hal_data->mutex));
-    next = hal_data->sig_list_ptr;
-    while (next != 0) {
-	sig = SHMPTR(next);
-	if ( tmatch(type, sig->type) && match(patterns, sig->name) ) {
-	    dptr = SHMPTR(sig->data_ptr);
-	    halcmd_output("%s  %s  %s\n", data_type((int) sig->type),
-		data_value((int) sig->type, dptr), sig->name);
-	    /* look for pin(s) linked to this signal */
-	    pin = halpr_find_pin_by_sig(sig, 0);
-	    while (pin != 0) {
-		halcmd_output("                         %s %s\n",
-		    data_arrow2((int) pin->dir), pin->name);
-		pin = halpr_find_pin_by_sig(sig, pin);
+    for (tries = 0; ; tries++) {
+	seq = halpr_read_begin(tries);
+	listing_reset();
+	sig_pins_build(&seq);
+	next = hal_data->sig_list_ptr;
+	while (next != 0 && !halpr_read_torn(seq)) {
+	    sig = SHMPTR(next);
+	    if ( tmatch(type, sig->type) && match(patterns, sig->name) ) {
+		dptr = SHMPTR(sig->data_ptr);
+		listing_output("%s  %s  %s\n", data_type((int) sig->type),
+		    data_value((int) sig->type, dptr), sig->name);
+		/* look for pin(s) linked to this signal */
+		pin = sig_pin_next(sig, 0, &pos);
+		while (pin != 0 && !halpr_read_torn(seq)) {
+		    listing_output("                         %s %s\n",
+			data_arrow2((int) pin->dir), pin->name);
+		    pin = sig_pin_next(sig, pin, &pos);
+		}
 	    }
+	    next = sig->next_ptr;
+	}
+	if (!halpr_read_retry(seq, tries)) {
+	    break;
 	}
-	next = sig->next_ptr;
     }
-    rtapi_mutex_give(&(hal_data->mutex));
+    listing_flush();
     halcmd_output("\n");
 }
 
 static void print_script_sig_info(int type, char **patterns)
 {
-    int next;
+    int next, tries;
+    unsigned int seq;
     hal_sig_t *sig;
     void *dptr;
     hal_pin_t *pin;
+    size_t pos;
 
     if (scriptmode == 0) {
     	return;
     }
-    rtapi_mutex_get(&(hal_data->mutex));
-    next = hal_data->sig_list_ptr;
-    while (next != 0) {
-	sig = SHMPTR(next);
-	if ( tmatch(type, sig->type) && match(patterns, sig->name) ) {
-	    dptr = SHMPTR(sig->data_ptr);
-	    halcmd_output("%s  %s  %s", data_type((int) sig->type),
-		data_value2((int) sig->type, dptr), sig->name);
-	    /* look for pin(s) linked to this signal */
-	    pin = halpr_find_pin_by_sig(sig, 0);
-	    while (pin != 0) {
-		halcmd_output(" %s %s",
-		    data_arrow2((int) pin->dir), pin->name);
-		pin = halpr_find_pin_by_sig(sig, pin);
+    for (tries = 0; ; tries++) {
+	seq = halpr_read_begin(tries);
+	listing_reset();
+	sig_pins_build(&seq);
+	next = hal_data->sig_list_ptr;
+	while (next != 0 && !halpr_read_torn(seq)) {
+	    sig = SHMPTR(next);
+	    if ( tmatch(type, sig->type) && match(patterns, sig->name) ) {
+		dptr = SHMPTR(sig->data_ptr);
+		listing_output("%s  %s  %s", data_type((int) sig->type),
+		    data_value2((int) sig->type, dptr), sig->name);
+		/* look for pin(s) linked to this signal */
+		pin = sig_pin_next(sig, 0, &pos);
+		while (pin != 0 && !halpr_read_torn(seq)) {
+		    listing_output(" %s %s",
+			data_arrow2((int) pin->dir), pin->name);
+		    pin = sig_pin_next(sig, pin, &pos);
+		}
+		listing_output("\n");
 	    }
-	    halcmd_output("\n");
+	    next = sig->next_ptr;
+	}
+	if (!halpr_read_retry(seq, tries)) {
+	    break;
 	}
-	next = sig->next_ptr;
     }
-    rtapi_mutex_give(&(hal_data->mutex));
+    listing_flush();
     halcmd_output("\n");
 }
 
 static void print_param_info(int type, char **patterns)
 {
-    int next;
+    int next, tries;
+    unsigned int seq;
     hal_param_t *param;
     hal_comp_t *comp;
 
@@ -1798,29 +2432,35 @@ static void print_param_info(int type, char **patterns)
 	halcmd_output("Parameters:\n");
 	halcmd_output("Owner   Type  Dir         Value  Name\n");
     }
-    rtapi_mutex_get(&(hal_data->mutex));
-    next = hal_data->param_list_ptr;
-    while (next != 0) {
-	param = SHMPTR(next);
-	if ( tmatch(type, param->type), match(patterns, param->name) ) {
-	    comp = SHMPTR(param->owner_ptr);
-	    if (scriptmode == 0) {
-		halcmd_output(" %5d  %5s %-3s  %9s  %s\n",
-		    comp->comp_id, data_type((int) param->type),
-		    param_data_dir((int) param->dir),
-		    data_value((int) param->type, SHMPTR(param->data_ptr)),
-		    param->name);
-	    } else {
-		halcmd_output("%s %s %s %s %s\n",
-		    comp->name, data_type((int) param->type),
-		    param_data_dir((int) param->dir),
-		    data_value2((int) param->type, SHMPTR(param->data_ptr)),
-		    param->name);
-	    } 
+    for (tries = 0; ; tries++) {
+	seq = halpr_read_begin(tries);
+	listing_reset();
+	next = hal_data->param_list_ptr;
+	while (next != 0 && !halpr_read_torn(seq)) {
+	    param = SHMPTR(next);
+	    if ( tmatch(type, param->type), match(patterns, param->name) ) {
+		comp = SHMPTR(param->owner_ptr);
+		if (scriptmode == 0) {
+		    listing_output(" %5d  %5s %-3s  %9s  %s\n",
+			comp->comp_id, data_type((int) param->type),
+			param_data_dir((int) param->dir),
+			data_value((int) param->type, SHMPTR(param->data_ptr)),
+			param->name);
+		} else {
+		    listing_output("%s %s %s %s %s\n",
+			comp->name, data_type((int) param->type),
+			param_data_dir((int) param->dir),
+			data_value2((int) param->type, SHMPTR(param->data_ptr)),
+			param->name);
+		} 
+	    }
+	    next = param->next_ptr;
+	}
+	if (!halpr_read_retry(seq, tries)) {
+	    break;
 	}
-	next = param->next_ptr;
     }
-    rtapi_mutex_give(&(hal_data->mutex));
+    listing_flush();
     halcmd_output("\n");
 }
 
@@ -1835,6 +2475,7 @@ static void print_param_aliases(char **patterns)
 	halcmd_output(" %-*s  %s\n", HAL_NAME_LEN, "Alias", "Original Name");
     }
     rtapi_mutex_get(&(hal_data->mutex));
+    listing_reset();
     next = hal_data->param_list_ptr;
     while (next != 0) {
 	param = SHMPTR(next);
@@ -1843,18 +2484,251 @@ static void print_param_aliases(char **patterns)
 	    oldname = SHMPTR(param->oldname);
 	    if ( match(patterns, param->name) || match(patterns, oldname->name) ) {
 		if (scriptmode == 0) {
-		    halcmd_output(" %-*s  %s\n", HAL_NAME_LEN, param->name, oldname->name);
+		    listing_output(" %-*s  %s\n", HAL_NAME_LEN, param->name, oldname->name);
 		} else {
-		    halcmd_output(" %s  %s\n", param->name, oldname->name);
+		    listing_output(" %s  %s\n", param->name, oldname->name);
 		}
 	    }
 	}
 	next = param->next_ptr;
     }
     rtapi_mutex_give(&(hal_data->mutex));
+    listing_flush();
     halcmd_output("\n");
 }
 
+/* 'show json' prints one JSON object a line, for programs that read the
+   HAL as it streams in rather than parse the tables above */
+static void json_string(const char *str)
+{
+    listing_output("\"");
+    for (; *str; str++) {
+	unsigned char c = *str;
+
+	if (c == '"' || c == '\\') {
+	    listing_output("\\%c", c);
+	} else if (c < 0x20) {
+	    listing_output("\\u%04x", c);
+	} else {
+	    listing_output("%c", c);
+	}
+    }
+    listing_output("\"");
+}
+
+static void json_value(int type, void *valptr)
+{
+    double f;
+
+    switch (type) {
+    case HAL_BIT:
+	listing_output("%s", *((char *) valptr) ? "true" : "false");
+	break;
+    case HAL_FLOAT:
+	f = *((hal_float_t *) valptr);
+	if (isfinite(f)) {
+	    listing_output("%.17g", f);
+	} else {
+	    listing_output("null");
+	}
+	break;
+    case HAL_S32:
+	listing_output("%ld", (long)*((hal_s32_t *) valptr));
+	break;
+    case HAL_U32:
+	listing_output("%lu", (unsigned long)*((hal_u32_t *) valptr));
+	break;
+    default:
+	listing_output("null");
+    }
+}
+
+static void print_json_comps(char **patterns)
+{
+    int next;
+    hal_comp_t *comp;
+
+    rtapi_mutex_get(&(hal_data->mutex));
+    listing_reset();
+    for (next = hal_data->comp_list_ptr; next != 0; next = comp->next_ptr) {
+	comp = SHMPTR(next);
+	if (!match(patterns, comp->name)) {
+	    continue;
+	}
+	listing_output("{\"kind\":\"comp\",\"name\":");
+	json_string(comp->name);
+	if (comp->type == 2) {
+	    hal_comp_t *comp1 = halpr_find_comp_by_id(comp->comp_id & 0xffff);
+	    listing_output(",\"type\":\"inst\",\"owner\":");
+	    if (comp1) {
+		json_string(comp1->name);
+	    } else {
+		listing_output("null");
+	    }
+	} else {
+	    listing_output(",\"type\":\"%s\",\"id\":%d",
+		comp->type ? "rt" : "user", comp->comp_id);
+	    if (comp->type == 0) {
+		listing_output(",\"pid\":%d", comp->pid);
+	    }
+	}
+	listing_output(",\"ready\":%s}\n", comp->ready > 0 ? "true" : "false");
+    }
+    rtapi_mutex_give(&(hal_data->mutex));
+    listing_flush();
+}
+
+static void print_json_pins(int type, char **patterns)
+{
+    int next, tries;
+    unsigned int seq;
+    hal_pin_t *pin;
+    hal_comp_t *comp;
+    hal_sig_t *sig;
+
+    for (tries = 0; ; tries++) {
+	seq = halpr_read_begin(tries);
+	listing_reset();
+	next = hal_data->pin_list_ptr;
+	while (next != 0 && !halpr_read_torn(seq)) {
+	    pin = SHMPTR(next);
+	    if (tmatch(type, pin->type) && match(patterns, pin->name)) {
+		comp = SHMPTR(pin->owner_ptr);
+		sig = pin->signal ? SHMPTR(pin->signal) : 0;
+		listing_output("{\"kind\":\"pin\",\"name\":");
+		json_string(pin->name);
+		listing_output(",\"owner\":");
+		json_string(comp->name);
+		listing_output(",\"type\":\"%s\",\"dir\":\"%s\",\"value\":",
+		    data_type2((int) pin->type), pin_data_dir((int) pin->dir));
+		json_value((int) pin->type,
+		    sig ? SHMPTR(sig->data_ptr) : (void *) &(pin->dummysig));
+		listing_output(",\"signal\":");
+		if (sig) {
+		    json_string(sig->name);
+		} else {
+		    listing_output("null");
+		}
+		listing_output("}\n");
+	    }
+	    next = pin->next_ptr;
+	}
+	if (!halpr_read_retry(seq, tries)) {
+	    break;
+	}
+    }
+    listing_flush();
+}
+
+static void print_json_sigs(int type, char **patterns)
+{
+    int next, tries, first;
+    unsigned int seq;
+    hal_sig_t *sig;
+    hal_pin_t *pin;
+    size_t pos;
+
+    for (tries = 0; ; tries++) {
+	seq = halpr_read_begin(tries);
+	listing_reset();
+	sig_pins_build(&seq);
+	next = hal_data->sig_list_ptr;
+	while (next != 0 && !halpr_read_torn(seq)) {
+	    sig = SHMPTR(next);
+	    if (tmatch(type, sig->type) && match(patterns, sig->name)) {
+		listing_output("{\"kind\":\"sig\",\"name\":");
+		json_string(sig->name);
+		listing_output(",\"type\":\"%s\",\"value\":",
+		    data_type2((int) sig->type));
+		json_value((int) sig->type, SHMPTR(sig->data_ptr));
+		listing_output(",\"pins\":[");
+		first = 1;
+		pin = sig_pin_next(sig, 0, &pos);
+		while (pin != 0 && !halpr_read_torn(seq)) {
+		    listing_output("%s{\"name\":", first ? "" : ",");
+		    json_string(pin->name);
+		    listing_output(",\"dir\":\"%s\"}", pin_data_dir((int) pin->dir));
+		    first = 0;
+		    pin = sig_pin_next(sig, pin, &pos);
+		}
+		listing_output("]}\n");
+	    }
+	    next = sig->next_ptr;
+	}
+	if (!halpr_read_retry(seq, tries)) {
+	    break;
+	}
+    }
+    listing_flush();
+}
+
+static void print_json_params(int type, char **patterns)
+{
+    int next, tries;
+    unsigned int seq;
+    hal_param_t *param;
+    hal_comp_t *comp;
+
+    for (tries = 0; ; tries++) {
+	seq = halpr_read_begin(tries);
+	listing_reset();
+	next = hal_data->param_list_ptr;
+	while (next != 0 && !halpr_read_torn(seq)) {
+	    param = SHMPTR(next);
+	    if (tmatch(type, param->type) && match(patterns, param->name)) {
+		comp = SHMPTR(param->owner_ptr);
+		listing_output("{\"kind\":\"param\",\"name\":");
+		json_string(param->name);
+		listing_output(",\"owner\":");
+		json_string(comp->name);
+		listing_output(",\"type\":\"%s\",\"dir\":\"%s\",\"value\":",
+		    data_type2((int) param->type),
+		    param_data_dir((int) param->dir));
+		json_value((int) param->type, SHMPTR(param->data_ptr));
+		listing_output("}\n");
+	    }
+	    next = param->next_ptr;
+	}
+	if (!halpr_read_retry(seq, tries)) {
+	    break;
+	}
+    }
+    listing_flush();
+}
+
+/* show json [comp|pin|sig|param|all] [-t type] [pattern...] */
+static void print_json_info(char **patterns)
+{
+    const char *what = "all";
+    int type;
+
+    if (patterns && patterns[0]) {
+	if (strcmp(patterns[0], "comp") == 0
+		|| strcmp(patterns[0], "pin") == 0
+		|| strcmp(patterns[0], "sig") == 0
+		|| strcmp(patterns[0], "signal") == 0
+		|| strcmp(patterns[0], "param") == 0
+		|| strcmp(patterns[0], "parameter") == 0
+		|| strcmp(patterns[0], "all") == 0) {
+	    what = patterns[0];
+	    patterns++;
+	}
+    }
+    type = get_type(&patterns);
+    if (strcmp(what, "all") == 0 || strcmp(what, "comp") == 0) {
+	print_json_comps(patterns);
+    }
+    if (strcmp(what, "all") == 0 || strcmp(what, "pin") == 0) {
+	print_json_pins(type, patterns);
+    }
+    if (strcmp(what, "all") == 0 || strncmp(what, "sig", 3) == 0) {
+	print_json_sigs(type, patterns);
+    }
+    if (strcmp(what, "all") == 0 || strncmp(what, "param", 5) == 0) {
+	print_json_params(type, patterns);
+    }
+}
+
 static void print_funct_info(char **patterns)
 {
     int next;
@@ -1948,7 +2822,8 @@ static void print_thread_info(char **patterns)
 		/* scriptmode only uses one line per thread, which contains: 
 		   thread period, FP flag, name, then all functs separated by spaces  */
 		if (scriptmode == 0) {
-		    halcmd_output("                 %2d %s\n", n, funct->name);
+		    halcmd_output("                 %2d %s%s\n", n, funct->name,
+			fentry->barrier ? " (barrier)" : "");
 		} else {
 		    halcmd_output(" %s", funct->name);
 		}
@@ -1965,6 +2840,79 @@ static void print_thread_info(char **patterns)
     halcmd_output("\n");
 }
 
+/* upper bound of a latency bucket, as printed by 'show latency' */
+static const char *latency_bucket_name(int bucket)
+{
+    static char buf[16];
+    if (bucket == HAL_LATENCY_BUCKETS - 1) {
+	snprintf(buf, sizeof(buf), ">=%dus", 1 << (bucket - 1));
+    } else {
+	snprintf(buf, sizeof(buf), "<%dus", 1 << bucket);
+    }
+    return buf;
+}
+
+static void print_latency_hist(const hal_u32_t *hist)
+{
+    int n;
+    for (n = 0; n < HAL_LATENCY_BUCKETS; n++) {
+	if (hist[n] == 0) continue;
+	halcmd_output("    %-8s %10lu\n", latency_bucket_name(n),
+	    (unsigned long)hist[n]);
+    }
+}
+
+static void print_latency_info(char **patterns)
+{
+    int next_thread, n;
+    hal_thread_t *tptr;
+    hal_cpu_latency_t *cpu;
+
+    if (scriptmode == 0) {
+	halcmd_output("Wakeup latency by thread (nsec):\n");
+	halcmd_output("%-20s %4s %10s %8s %8s %8s %8s\n",
+	    "Name", "CPU", "Count", "Min", "Mean", "Max", "Overruns");
+    }
+    rtapi_mutex_get(&(hal_data->mutex));
+    next_thread = hal_data->thread_list_ptr;
+    while (next_thread != 0) {
+	tptr = SHMPTR(next_thread);
+	next_thread = tptr->next_ptr;
+	if (!match(patterns, tptr->name)) {
+	    continue;
+	}
+	halcmd_output(((scriptmode == 0) ? "%-20s %4d %10lu %8ld %8ld %8ld %8lu\n"
+					 : "%s %d %lu %ld %ld %ld %lu\n"),
+	    tptr->name, tptr->cpu, (unsigned long)tptr->latency_count,
+	    (long)tptr->latency_min, (long)tptr->latency_mean,
+	    (long)tptr->latency_max, (unsigned long)tptr->overruns);
+	if (scriptmode == 0) {
+	    print_latency_hist(tptr->latency_hist);
+	}
+    }
+    rtapi_mutex_give(&(hal_data->mutex));
+    halcmd_output("\n");
+
+    /* the CPU statistics are only written by the threads, no need to
+       hold the mutex */
+    if (scriptmode == 0) {
+	halcmd_output("Wakeup latency by CPU (nsec):\n");
+	halcmd_output("%-4s %10s %8s %8s\n", "CPU", "Count", "Mean", "Max");
+    }
+    for (n = 0; n < HAL_MAX_CPUS; n++) {
+	cpu = &hal_data->cpu_latency[n];
+	if (cpu->count == 0) continue;
+	halcmd_output(((scriptmode == 0) ? "%-4d %10lu %8ld %8ld\n"
+					 : "cpu%d %lu %ld %ld\n"), n,
+	    (unsigned long)cpu->count, (long)(cpu->sum / cpu->count),
+	    (long)cpu->max);
+	if (scriptmode == 0) {
+	    print_latency_hist(cpu->hist);
+	}
+    }
+    halcmd_output("\n");
+}
+
 static void print_comp_names(char **patterns)
 {
     int next;
@@ -2109,6 +3057,58 @@ static int count_list(int list_root)
     return n;
 }
 
+/* usage of the arena that user components' hal_malloc() memory comes
+   from: 'waste' is the part of the blocks in use that was not asked for,
+   'free' what is waiting in the free lists for the next component */
+static void print_arena_status(void)
+{
+    int cls, next;
+    int active[HAL_ARENA_CLASSES] = {0}, recycled[HAL_ARENA_CLASSES] = {0};
+    long total;
+    hal_arena_block_t *block;
+
+    rtapi_mutex_get(&(hal_data->mutex));
+    next = hal_data->arena_owned_ptr;
+    while (next != 0) {
+	block = SHMPTR(next);
+	for (cls = 0; cls < HAL_ARENA_CLASSES - 1; cls++) {
+	    if (block->size <= (HAL_ARENA_MIN_BLOCK << cls)) break;
+	}
+	active[cls]++;
+	next = block->next_ptr;
+    }
+    for (cls = 0; cls < HAL_ARENA_CLASSES; cls++) {
+	next = hal_data->arena_free_ptr[cls];
+	while (next != 0) {
+	    block = SHMPTR(next);
+	    recycled[cls]++;
+	    next = block->next_ptr;
+	}
+    }
+    total = hal_data->arena_used + hal_data->arena_free;
+    halcmd_output("  arena used/waste/free bytes: %ld/%ld/%ld",
+	hal_data->arena_used,
+	hal_data->arena_used - hal_data->arena_requested,
+	hal_data->arena_free);
+    if (total > 0) {
+	halcmd_output(" (%ld%% free)", 100 * hal_data->arena_free / total);
+    }
+    halcmd_output("\n");
+    rtapi_mutex_give(&(hal_data->mutex));
+    for (cls = 0; cls < HAL_ARENA_CLASSES; cls++) {
+	if (active[cls] == 0 && recycled[cls] == 0) {
+	    continue;
+	}
+	if (cls == HAL_ARENA_CLASSES - 1) {
+	    halcmd_output("    active/free blocks >%6d: %d/%d\n",
+		HAL_ARENA_MIN_BLOCK << (cls - 1), active[cls], recycled[cls]);
+	} else {
+	    halcmd_output("    active/free blocks %7d: %d/%d\n",
+		HAL_ARENA_MIN_BLOCK << cls, active[cls], recycled[cls]);
+	}
+    }
+}
+
 static void print_mem_status()
 {
     int active, recycled, next;
@@ -2116,7 +3116,7 @@ static void print_mem_status()
     hal_param_t *param;
 
     halcmd_output("HAL memory status\n");
-    halcmd_output("  used/total shared memory:   %ld/%d\n", (long)(HAL_SIZE - hal_data->shmem_avail), HAL_SIZE);
+    halcmd_output("  used/total shared memory:   %ld/%ld\n", (long)(hal_data->shmem_size - hal_data->shmem_avail), (long)hal_data->shmem_size);
     // count components
     active = count_list(hal_data->comp_list_ptr);
     recycled = count_list(hal_data->comp_free_ptr);
@@ -2159,6 +3159,7 @@ static void print_mem_status()
     active = count_list(hal_data->thread_list_ptr);
     recycled = count_list(hal_data->thread_free_ptr);
     halcmd_output("  active/recycled threads:    %d/%d\n", active, recycled);
+    print_arena_status();
 }
 
 /* Switch function for pin/sig/param type for the print_*_list functions */
@@ -2365,6 +3366,10 @@ int do_save_cmd(char *type, char *filename)
 {
     FILE *dst;
 
+    if (type && strcmp(type, "binary") == 0) {
+	return save_snapshot(filename);
+    }
+
     if (rtapi_get_msg_level() == RTAPI_MSG_NONE) {
 	/* must be -Q, don't print anything */
 	return 0;
@@ -2439,8 +3444,9 @@ static void save_comps(FILE *dst)
     int next;
     hal_comp_t *comp;
 
-    fprintf(dst, "# components\n");
     rtapi_mutex_get(&(hal_data->mutex));
+    listing_reset();
+    listing_output("# components\n");
 
     int ncomps = 0;
     next = hal_data->comp_list_ptr;
@@ -2468,9 +3474,9 @@ static void save_comps(FILE *dst)
         comp = comps[i];
         /* only print realtime components */
         if ( comp->insmod_args == 0 ) {
-            fprintf(dst, "#loadrt %s  (not loaded by loadrt, no args saved)\n", comp->name);
+            listing_output("#loadrt %s  (not loaded by loadrt, no args saved)\n", comp->name);
         } else {
-            fprintf(dst, "loadrt %s %s\n", comp->name,
+            listing_output("loadrt %s %s\n", comp->name,
                 (char *)SHMPTR(comp->insmod_args));
         }
     }
@@ -2480,12 +3486,13 @@ static void save_comps(FILE *dst)
 	comp = SHMPTR(next);
 	if ( comp->type == 2 ) {
             hal_comp_t *comp1 = halpr_find_comp_by_id(comp->comp_id & 0xffff);
-            fprintf(dst, "newinst %s %s\n", comp1->name, comp->name);
+            listing_output("newinst %s %s\n", comp1->name, comp->name);
         }
 	next = comp->next_ptr;
     }
 #endif
     rtapi_mutex_give(&(hal_data->mutex));
+    listing_write(dst);
 }
 
 static void save_aliases(FILE *dst)
@@ -2495,30 +3502,32 @@ static void save_aliases(FILE *dst)
     hal_param_t *param;
     hal_oldname_t *oldname;
 
-    fprintf(dst, "# pin aliases\n");
     rtapi_mutex_get(&(hal_data->mutex));
+    listing_reset();
+    listing_output("# pin aliases\n");
     next = hal_data->pin_list_ptr;
     while (next != 0) {
 	pin = SHMPTR(next);
 	if ( pin->oldname != 0 ) {
 	    /* name is an alias */
 	    oldname = SHMPTR(pin->oldname);
-	    fprintf(dst, "alias pin %s %s\n", oldname->name, pin->name);
+	    listing_output("alias pin %s %s\n", oldname->name, pin->name);
 	}
 	next = pin->next_ptr;
     }
-    fprintf(dst, "# param aliases\n");
+    listing_output("# param aliases\n");
     next = hal_data->param_list_ptr;
     while (next != 0) {
 	param = SHMPTR(next);
 	if ( param->oldname != 0 ) {
 	    /* name is an alias */
 	    oldname = SHMPTR(param->oldname);
-	    fprintf(dst, "alias param %s %s\n", oldname->name, param->name);
+	    listing_output("alias param %s %s\n", oldname->name, param->name);
 	}
 	next = param->next_ptr;
     }
     rtapi_mutex_give(&(hal_data->mutex));
+    listing_write(dst);
 }
 
 static void save_signals(FILE *dst, int only_unlinked)
@@ -2526,15 +3535,17 @@ static void save_signals(FILE *dst, int only_unlinked)
     int next;
     hal_sig_t *sig;
 
-    fprintf(dst, "# signals\n");
     rtapi_mutex_get(&(hal_data->mutex));
+    listing_reset();
+    listing_output("# signals\n");
     
     for( next = hal_data->sig_list_ptr; next; next = sig->next_ptr) {
 	sig = SHMPTR(next);
         if(only_unlinked && (sig->readers || sig->writers)) continue;
-	fprintf(dst, "newsig %s %s\n", sig->name, data_type((int) sig->type));
+	listing_output("newsig %s %s\n", sig->name, data_type((int) sig->type));
     }
     rtapi_mutex_give(&(hal_data->mutex));
+    listing_write(dst);
 }
 
 static void save_links(FILE *dst, int arrow)
@@ -2544,8 +3555,9 @@ static void save_links(FILE *dst, int arrow)
     hal_sig_t *sig;
     const char *arrow_str;
 
-    fprintf(dst, "# links\n");
     rtapi_mutex_get(&(hal_data->mutex));
+    listing_reset();
+    listing_output("# links\n");
     next = hal_data->pin_list_ptr;
     while (next != 0) {
 	pin = SHMPTR(next);
@@ -2556,11 +3568,12 @@ static void save_links(FILE *dst, int arrow)
 	    } else {
 		arrow_str = "\0";
 	    }
-	    fprintf(dst, "linkps %s %s %s\n", pin->name, arrow_str, sig->name);
+	    listing_output("linkps %s %s %s\n", pin->name, arrow_str, sig->name);
 	}
 	next = pin->next_ptr;
     }
     rtapi_mutex_give(&(hal_data->mutex));
+    listing_write(dst);
 }
 
 static void save_nets(FILE *dst, int arrow)
@@ -2569,9 +3582,12 @@ static void save_nets(FILE *dst, int arrow)
     hal_pin_t *pin;
     hal_sig_t *sig;
     const char *arrow_str;
+    size_t pos;
 
-    fprintf(dst, "# nets\n");
     rtapi_mutex_get(&(hal_data->mutex));
+    listing_reset();
+    listing_output("# nets\n");
+    sig_pins_build(NULL);
     
     for (next = hal_data->sig_list_ptr; next != 0; next = sig->next_ptr) {
 	sig = SHMPTR(next);
@@ -2579,71 +3595,72 @@ static void save_nets(FILE *dst, int arrow)
             int state = 0, first = 1;
 
             /* If there are no pins connected to this signal, do nothing */
-            pin = halpr_find_pin_by_sig(sig, 0);
+            pin = sig_pin_next(sig, 0, &pos);
             if(!pin) continue;
 
-            fprintf(dst, "net %s", sig->name);
+            listing_output("net %s", sig->name);
 
             /* Step 1: Output pin, if any */
             
-            for(pin = halpr_find_pin_by_sig(sig, 0); pin;
-                    pin = halpr_find_pin_by_sig(sig, pin)) {
+            for(pin = sig_pin_next(sig, 0, &pos); pin;
+                    pin = sig_pin_next(sig, pin, &pos)) {
                 if(pin->dir != HAL_OUT) continue;
-                fprintf(dst, " %s", pin->name);
+                listing_output(" %s", pin->name);
                 state = 1;
             }
             
             /* Step 2: I/O pins, if any */
-            for(pin = halpr_find_pin_by_sig(sig, 0); pin;
-                    pin = halpr_find_pin_by_sig(sig, pin)) {
+            for(pin = sig_pin_next(sig, 0, &pos); pin;
+                    pin = sig_pin_next(sig, pin, &pos)) {
                 if(pin->dir != HAL_IO) continue;
-                fprintf(dst, " ");
-                if(state) { fprintf(dst, "=> "); state = 0; }
-                else if(!first) { fprintf(dst, "<=> "); }
-                fprintf(dst, "%s", pin->name);
+                listing_output(" ");
+                if(state) { listing_output("=> "); state = 0; }
+                else if(!first) { listing_output("<=> "); }
+                listing_output("%s", pin->name);
                 first = 0;
             }
             if(!first) state = 1;
 
             /* Step 3: Input pins, if any */
-            for(pin = halpr_find_pin_by_sig(sig, 0); pin;
-                    pin = halpr_find_pin_by_sig(sig, pin)) {
+            for(pin = sig_pin_next(sig, 0, &pos); pin;
+                    pin = sig_pin_next(sig, pin, &pos)) {
                 if(pin->dir != HAL_IN) continue;
-                fprintf(dst, " ");
-                if(state) { fprintf(dst, "=> "); state = 0; }
-                fprintf(dst, "%s", pin->name);
+                listing_output(" ");
+                if(state) { listing_output("=> "); state = 0; }
+                listing_output("%s", pin->name);
             }
 
-            fprintf(dst, "\n");
+            listing_output("\n");
         } else if(arrow == 2) {
             /* If there are no pins connected to this signal, do nothing */
-            pin = halpr_find_pin_by_sig(sig, 0);
+            pin = sig_pin_next(sig, 0, &pos);
             if(!pin) continue;
 
-            fprintf(dst, "net %s", sig->name);
-            pin = halpr_find_pin_by_sig(sig, 0);
+            listing_output("net %s", sig->name);
+            pin = sig_pin_next(sig, 0, &pos);
             while (pin != 0) {
-                fprintf(dst, " %s", pin->name);
-                pin = halpr_find_pin_by_sig(sig, pin);
+                listing_output(" %s", pin->name);
+                pin = sig_pin_next(sig, pin, &pos);
             }
-            fprintf(dst, "\n");
+            listing_output("\n");
         } else {
-            fprintf(dst, "newsig %s %s\n",
+            listing_output("newsig %s %s\n",
                     sig->name, data_type((int) sig->type));
-            pin = halpr_find_pin_by_sig(sig, 0);
+            pin = sig_pin_next(sig, 0, &pos);
             while (pin != 0) {
                 if (arrow != 0) {
                     arrow_str = data_arrow2((int) pin->dir);
                 } else {
                     arrow_str = "\0";
                 }
-                fprintf(dst, "linksp %s %s %s\n",
+                listing_output("linksp %s %s %s\n",
                         sig->name, arrow_str, pin->name);
-                pin = halpr_find_pin_by_sig(sig, pin);
+                pin = sig_pin_next(sig, pin, &pos);
             }
         }
     }
     rtapi_mutex_give(&(hal_data->mutex));
+    listing_write(dst);
 }
 
 static void save_params(FILE *dst)
@@ -2651,19 +3668,21 @@ static void save_params(FILE *dst)
     int next;
     hal_param_t *param;
 
-    fprintf(dst, "# parameter values\n");
     rtapi_mutex_get(&(hal_data->mutex));
+    listing_reset();
+    listing_output("# parameter values\n");
     next = hal_data->param_list_ptr;
     while (next != 0) {
 	param = SHMPTR(next);
 	if (param->dir != HAL_RO) {
 	    /* param is writable, save its value */
-	    fprintf(dst, "setp %s %s\n", param->name,
+	    listing_output("setp %s %s\n", param->name,
 		data_value((int) param->type, SHMPTR(param->data_ptr)));
 	}
 	next = param->next_ptr;
     }
     rtapi_mutex_give(&(hal_data->mutex));
+    listing_write(dst);
 }
 
 static void save_threads(FILE *dst)
@@ -2674,8 +3693,9 @@ static void save_threads(FILE *dst)
     hal_funct_entry_t *fentry;
     hal_funct_t *funct;
 
-    fprintf(dst, "# realtime thread/function links\n");
     rtapi_mutex_get(&(hal_data->mutex));
+    listing_reset();
+    listing_output("# realtime thread/function links\n");
     next_thread = hal_data->thread_list_ptr;
     while (next_thread != 0) {
 	tptr = SHMPTR(next_thread);
@@ -2685,12 +3705,14 @@ static void save_threads(FILE *dst)
 	    /* print the function info */
 	    fentry = (hal_funct_entry_t *) list_entry;
 	    funct = SHMPTR(fentry->funct_ptr);
-	    fprintf(dst, "addf %s %s\n", funct->name, tptr->name);
+	    listing_output("addf %s %s%s\n", funct->name, tptr->name,
+		fentry->barrier ? " barrier" : "");
 	    list_entry = list_next(list_entry);
 	}
 	next_thread = tptr->next_ptr;
     }
     rtapi_mutex_give(&(hal_data->mutex));
+    listing_write(dst);
 }
 
 static void save_unconnected_input_pin_values(FILE *dst)
@@ -2698,7 +3720,9 @@ static void save_unconnected_input_pin_values(FILE *dst)
     hal_pin_t *pin;
     void *dptr;
     int next;
-    fprintf(dst, "# unconnected pin values\n");
+    rtapi_mutex_get(&(hal_data->mutex));
+    listing_reset();
+    listing_output("# unconnected pin values\n");
     for(next = hal_data->pin_list_ptr; next; next=pin->next_ptr)
     {
         pin = SHMPTR(next);
@@ -2706,10 +3730,637 @@ static void save_unconnected_input_pin_values(FILE *dst)
             && ( (pin->dir == HAL_IN) || (pin->dir == HAL_IO) )
            ) {
             dptr = &(pin->dummysig);
-            fprintf(dst, "setp %s %s\n",
+            listing_output("setp %s %s\n",
                    pin->name, data_value((int) pin->type, dptr));
         }
     }
+    rtapi_mutex_give(&(hal_data->mutex));
+    listing_write(dst);
+}
+
+/* 'save binary' writes the HAL as built so far to a snapshot file, and
+   'loadbin' builds the same HAL from it without running the HAL files
+   again.  The file is a header followed by tagged records, in the order
+   loadbin applies them:
+
+     'C' component:   type, name, load arguments, module/program version
+     'A', 'a'         pin and param aliases: old name, alias
+     'S' signal:      name, type
+     'L' link:        pin name, index of its signal among the 'S' records
+     'V' value:       signal name, type, value
+     'P' parameter:   name, type, value
+     'U' pin:         name, type, value of an unconnected input pin
+     'F' function:    function name, thread name
+     'B' function:    the same, for a function added as a barrier
+     'E' end
+
+   Signals, links, parameters and pins are written in the order of the
+   (sorted) HAL lists, so loadbin finds them in one walk of each list.
+   The file is in the host's byte order and meant for the same machine. */
+#define SNAPSHOT_MAGIC "HALSNAP"
+#define SNAPSHOT_VERSION 1
+
+struct snapshot_rec {
+    char tag;
+    int type;
+    int index;
+    hal_data_u value;
+    char name[HAL_NAME_LEN+1];
+    char name2[HAL_NAME_LEN+1];
+    char *args;
+    long long version[2];	/* mtime and size of the module or program */
+};
+
+static void snap_put(FILE *dst, const void *p, size_t n)
+{
+    fwrite(p, n, 1, dst);
+}
+
+static void snap_put_int(FILE *dst, int v)
+{
+    snap_put(dst, &v, sizeof(v));
+}
+
+static void snap_put_str(FILE *dst, const char *str)
+{
+    snap_put_int(dst, strlen(str));
+    snap_put(dst, str, strlen(str));
+}
+
+static void snap_put_value(FILE *dst, hal_type_t type, void *d_ptr)
+{
+    hal_data_u v;
+    memset(&v, 0, sizeof(v));
+    switch (type) {
+    case HAL_BIT: v.b = *((hal_bit_t *) d_ptr); break;
+    case HAL_S32: v.s = *((hal_s32_t *) d_ptr); break;
+    case HAL_U32: v.u = *((hal_u32_t *) d_ptr); break;
+    case HAL_FLOAT: v.f = *((hal_float_t *) d_ptr); break;
+    default: break;
+    }
+    snap_put_int(dst, type);
+    snap_put(dst, &v, sizeof(v));
+}
+
+static void snap_set_value(hal_type_t type, void *d_ptr, const hal_data_u *v)
+{
+    switch (type) {
+    case HAL_BIT: *((hal_bit_t *) d_ptr) = v->b; break;
+    case HAL_S32: *((hal_s32_t *) d_ptr) = v->s; break;
+    case HAL_U32: *((hal_u32_t *) d_ptr) = v->u; break;
+    case HAL_FLOAT: *((hal_float_t *) d_ptr) = v->f; break;
+    default: break;
+    }
+}
+
+static int snap_get(FILE *src, void *p, size_t n)
+{
+    return fread(p, n, 1, src) == 1 ? 0 : -1;
+}
+
+static int snap_get_str(FILE *src, char *buf, size_t size)
+{
+    int n;
+    if (snap_get(src, &n, sizeof(n)) || n < 0 || (size_t) n >= size
+            || (n && snap_get(src, buf, n))) {
+        return -1;
+    }
+    buf[n] = '\0';
+    return 0;
+}
+
+/* The mtime and size of the file a component is loaded from, so that a
+   snapshot is not used once a module or program has been rebuilt. */
+static void component_version(int type, const char *name, const char *args,
+    long long version[2])
+{
+    char path[PATH_MAX], prog[PATH_MAX];
+    struct stat st;
+    int found = 0;
+
+    version[0] = version[1] = 0;
+    if (type == 1) {
+        snprintf(path, sizeof(path), "%s/%s%s", EMC2_RTLIB_DIR, name,
+            MODULE_EXT);
+        found = stat(path, &st) == 0;
+    } else {
+        const char *dirs = getenv("PATH");
+        size_t len = strcspn(args, " ");
+        snprintf(prog, sizeof(prog), "%.*s", (int) len, args);
+        if (strchr(prog, '/') || dirs == NULL) {
+            found = stat(prog, &st) == 0;
+        } else {
+            while (!found && *dirs) {
+                len = strcspn(dirs, ":");
+                snprintf(path, sizeof(path), "%.*s/%s", (int) len, dirs, prog);
+                found = stat(path, &st) == 0;
+                dirs += len + (dirs[len] == ':');
+            }
+        }
+    }
+    if (found) {
+        version[0] = st.st_mtime;
+        version[1] = st.st_size;
+    }
+}
+
+static int save_snapshot(char *filename)
+{
+    FILE *dst;
+    int next, i, nsigs;
+    hal_comp_t *comp;
+    hal_pin_t *pin;
+    hal_param_t *param;
+    hal_sig_t *sig;
+    hal_oldname_t *oldname;
+    hal_thread_t *tptr;
+    hal_list_t *list_root, *list_entry;
+    long long version[2];
+
+    if (filename == NULL || *filename == '\0') {
+	halcmd_error("'save binary' needs a file name\n");
+	return -1;
+    }
+    dst = fopen(filename, "wb");
+    if (dst == NULL) {
+	halcmd_error("Can't open 'save' destination '%s'\n", filename);
+	return -1;
+    }
+    snap_put(dst, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    snap_put_int(dst, SNAPSHOT_VERSION);
+
+    rtapi_mutex_get(&(hal_data->mutex));
+    /* components, in the order they were loaded */
+    int ncomps = 0;
+    for (next = hal_data->comp_list_ptr; next; next = comp->next_ptr) {
+	comp = SHMPTR(next);
+	ncomps++;
+    }
+    hal_comp_t *comps[ncomps], **compptr = comps;
+    for (next = hal_data->comp_list_ptr; next; next = comp->next_ptr) {
+	comp = SHMPTR(next);
+	*compptr++ = comp;
+    }
+    for (i = ncomps; i--;) {
+	comp = comps[i];
+	if (comp->comp_id == comp_id || comp->type > 1) {
+	    continue;
+	}
+	if (comp->insmod_args == 0) {
+	    if (comp->type == 1) {
+		/* made by some other module, like the text save skips it */
+		continue;
+	    }
+	    rtapi_mutex_give(&(hal_data->mutex));
+	    halcmd_error("component '%s' was not started by 'loadusr -W', "
+		"it can't be saved\n", comp->name);
+	    fclose(dst);
+	    unlink(filename);
+	    return -1;
+	}
+	snap_put(dst, "C", 1);
+	snap_put_int(dst, comp->type);
+	snap_put_str(dst, comp->name);
+	snap_put_str(dst, SHMPTR(comp->insmod_args));
+	component_version(comp->type, comp->name, SHMPTR(comp->insmod_args),
+	    version);
+	snap_put(dst, version, sizeof(version));
+    }
+    for (next = hal_data->pin_list_ptr; next; next = pin->next_ptr) {
+	pin = SHMPTR(next);
+	if (pin->oldname != 0) {
+	    oldname = SHMPTR(pin->oldname);
+	    snap_put(dst, "A", 1);
+	    snap_put_str(dst, oldname->name);
+	    snap_put_str(dst, pin->name);
+	}
+    }
+    for (next = hal_data->param_list_ptr; next; next = param->next_ptr) {
+	param = SHMPTR(next);
+	if (param->oldname != 0) {
+	    oldname = SHMPTR(param->oldname);
+	    snap_put(dst, "a", 1);
+	    snap_put_str(dst, oldname->name);
+	    snap_put_str(dst, param->name);
+	}
+    }
+    nsigs = 0;
+    for (next = hal_data->sig_list_ptr; next; next = sig->next_ptr) {
+	sig = SHMPTR(next);
+	snap_put(dst, "S", 1);
+	snap_put_str(dst, sig->name);
+	snap_put_int(dst, sig->type);
+	nsigs++;
+    }
+    int sig_index[nsigs ? nsigs : 1];
+    i = 0;
+    for (next = hal_data->sig_list_ptr; next; next = sig->next_ptr) {
+	sig = SHMPTR(next);
+	sig_index[i++] = next;
+    }
+    for (next = hal_data->pin_list_ptr; next; next = pin->next_ptr) {
+	pin = SHMPTR(next);
+	if (pin->signal == 0) {
+	    continue;
+	}
+	for (i = 0; sig_index[i] != pin->signal; i++);
+	snap_put(dst, "L", 1);
+	snap_put_str(dst, pin->name);
+	snap_put_int(dst, i);
+    }
+    /* values of signals without a writer, set by 'sets' */
+    for (next = hal_data->sig_list_ptr; next; next = sig->next_ptr) {
+	sig = SHMPTR(next);
+	if (sig->writers == 0 && sig->bidirs == 0) {
+	    snap_put(dst, "V", 1);
+	    snap_put_str(dst, sig->name);
+	    snap_put_value(dst, sig->type, SHMPTR(sig->data_ptr));
+	}
+    }
+    for (next = hal_data->param_list_ptr; next; next = param->next_ptr) {
+	param = SHMPTR(next);
+	if (param->dir != HAL_RO) {
+	    snap_put(dst, "P", 1);
+	    snap_put_str(dst, param->name);
+	    snap_put_value(dst, param->type, SHMPTR(param->data_ptr));
+	}
+    }
+    for (next = hal_data->pin_list_ptr; next; next = pin->next_ptr) {
+	pin = SHMPTR(next);
+	if (pin->signal == 0 && (pin->dir == HAL_IN || pin->dir == HAL_IO)) {
+	    snap_put(dst, "U", 1);
+	    snap_put_str(dst, pin->name);
+	    snap_put_value(dst, pin->type, &(pin->dummysig));
+	}
+    }
+    for (next = hal_data->thread_list_ptr; next; next = tptr->next_ptr) {
+	tptr = SHMPTR(next);
+	list_root = &(tptr->funct_list);
+	for (list_entry = list_next(list_root); list_entry != list_root;
+		list_entry = list_next(list_entry)) {
+	    hal_funct_entry_t *fentry = (hal_funct_entry_t *) list_entry;
+	    hal_funct_t *funct = SHMPTR(fentry->funct_ptr);
+	    snap_put(dst, fentry->barrier ? "B" : "F", 1);
+	    snap_put_str(dst, funct->name);
+	    snap_put_str(dst, tptr->name);
+	}
+    }
+    rtapi_mutex_give(&(hal_data->mutex));
+    snap_put(dst, "E", 1);
+
+    if (ferror(dst) | fclose(dst)) {
+	halcmd_error("error writing '%s'\n", filename);
+	unlink(filename);
+	return -1;
+    }
+    halcmd_info("HAL saved to '%s'\n", filename);
+    return 0;
+}
+
+static struct snapshot_rec *read_snapshot(FILE *src, int *count)
+{
+    char magic[sizeof(SNAPSHOT_MAGIC)];
+    char args[MAX_CMD_LEN+1];
+    int version, n = 0, size = 0, bad = 0;
+    struct snapshot_rec *recs = NULL, *r;
+
+    if (snap_get(src, magic, sizeof(magic))
+	    || memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic))
+	    || snap_get(src, &version, sizeof(version))
+	    || version != SNAPSHOT_VERSION) {
+	return NULL;
+    }
+    while (1) {
+	if (n == size) {
+	    size = size ? 2 * size : 256;
+	    r = realloc(recs, size * sizeof(*recs));
+	    if (r == NULL) {
+		bad = 1;
+		break;
+	    }
+	    recs = r;
+	}
+	r = &recs[n];
+	memset(r, 0, sizeof(*r));
+	if (snap_get(src, &r->tag, 1)) {
+	    bad = 1;
+	    break;
+	}
+	n++;
+	switch (r->tag) {
+	case 'C':
+	    bad = snap_get(src, &r->type, sizeof(r->type))
+		|| snap_get_str(src, r->name, sizeof(r->name))
+		|| snap_get_str(src, args, sizeof(args))
+		|| snap_get(src, r->version, sizeof(r->version));
+	    if (!bad) {
+		r->args = strdup(args);
+	    }
+	    break;
+	case 'A':
+	case 'a':
+	case 'F':
+	case 'B':
+	    bad = snap_get_str(src, r->name, sizeof(r->name))
+		|| snap_get_str(src, r->name2, sizeof(r->name2));
+	    break;
+	case 'S':
+	    bad = snap_get_str(src, r->name, sizeof(r->name))
+		|| snap_get(src, &r->type, sizeof(r->type));
+	    break;
+	case 'L':
+	    bad = snap_get_str(src, r->name, sizeof(r->name))
+		|| snap_get(src, &r->index, sizeof(r->index));
+	    break;
+	case 'V':
+	case 'P':
+	case 'U':
+	    bad = snap_get_str(src, r->name, sizeof(r->name))
+		|| snap_get(src, &r->type, sizeof(r->type))
+		|| snap_get(src, &r->value, sizeof(r->value));
+	    break;
+	case 'E':
+	    *count = n;
+	    return recs;
+	default:
+	    bad = 1;
+	}
+	if (bad) {
+	    break;
+	}
+    }
+    while (n--) {
+	free(recs[n].args);
+    }
+    free(recs);
+    return NULL;
+}
+
+/* The next pin, signal or param called 'name', searching on from 'next'
+   in the list; names that come out of order are searched for in the
+   whole list. */
+static hal_pin_t *next_pin_by_name(int *next, const char *name)
+{
+    while (*next) {
+	hal_pin_t *pin = SHMPTR(*next);
+	int cmp = strcmp(pin->name, name);
+	if (cmp == 0) return pin;
+	if (cmp > 0) break;
+	*next = pin->next_ptr;
+    }
+    return halpr_find_pin_by_name(name);
+}
+
+static hal_sig_t *next_sig_by_name(int *next, const char *name)
+{
+    while (*next) {
+	hal_sig_t *sig = SHMPTR(*next);
+	int cmp = strcmp(sig->name, name);
+	if (cmp == 0) return sig;
+	if (cmp > 0) break;
+	*next = sig->next_ptr;
+    }
+    return halpr_find_sig_by_name(name);
+}
+
+static hal_param_t *next_param_by_name(int *next, const char *name)
+{
+    while (*next) {
+	hal_param_t *param = SHMPTR(*next);
+	int cmp = strcmp(param->name, name);
+	if (cmp == 0) return param;
+	if (cmp > 0) break;
+	*next = param->next_ptr;
+    }
+    return halpr_find_param_by_name(name);
+}
+
+/* Starts the components of the snapshot that are not running already;
+   the userspace ones all at once. */
+static int load_snapshot_comps(struct snapshot_rec *recs, int n)
+{
+    char *argv[MAX_TOK+4];
+    char args[MAX_CMD_LEN+1];
+    int i, m, exists, retval = 0, save_parallel = parallel_mode;
+
+    parallel_mode = 1;
+    for (i = 0; i < n && retval == 0; i++) {
+	if (recs[i].tag != 'C') {
+	    continue;
+	}
+	rtapi_mutex_get(&(hal_data->mutex));
+	exists = halpr_find_comp_by_name(recs[i].name) != NULL;
+	rtapi_mutex_give(&(hal_data->mutex));
+	if (exists) {
+	    halcmd_info("Component '%s' already loaded\n", recs[i].name);
+	    continue;
+	}
+	snprintf(args, sizeof(args), "%s", recs[i].args);
+	m = 0;
+	argv[m++] = "loadusr";
+	if (recs[i].type == 0) {
+	    argv[m++] = "-Wn";
+	    argv[m++] = recs[i].name;
+	}
+	for (argv[m] = strtok(args, " "); argv[m] && m < MAX_TOK + 2;
+		argv[++m] = strtok(NULL, " "));
+	argv[m] = NULL;
+	if (recs[i].type == 1) {
+	    retval = do_loadrt_cmd(recs[i].name, argv + 1);
+	} else {
+	    retval = do_loadusr_cmd(argv + 1);
+	}
+    }
+    parallel_mode = save_parallel;
+    if (halcmd_wait_pending() != 0) {
+	retval = -1;
+    }
+    return retval;
+}
+
+/* Links all the 'L' records with one hold of the mutex and one walk of
+   the pin and signal lists. */
+static int link_snapshot(struct snapshot_rec *recs, int n)
+{
+    int i, nsigs = 0, next_sig, next_pin, retval = 0;
+
+    for (i = 0; i < n; i++) {
+	nsigs += recs[i].tag == 'S';
+    }
+    hal_sig_t *sigs[nsigs ? nsigs : 1];
+
+    halpr_lock();
+    next_sig = hal_data->sig_list_ptr;
+    nsigs = 0;
+    for (i = 0; i < n; i++) {
+	if (recs[i].tag == 'S') {
+	    sigs[nsigs++] = next_sig_by_name(&next_sig, recs[i].name);
+	}
+    }
+    next_pin = hal_data->pin_list_ptr;
+    for (i = 0; i < n && retval == 0; i++) {
+	hal_pin_t *pin;
+	if (recs[i].tag != 'L') {
+	    continue;
+	}
+	pin = next_pin_by_name(&next_pin, recs[i].name);
+	if (pin == NULL || recs[i].index < 0 || recs[i].index >= nsigs
+		|| sigs[recs[i].index] == NULL) {
+	    halcmd_error("pin '%s' or its signal not found\n", recs[i].name);
+	    retval = -EINVAL;
+	} else {
+	    retval = halpr_link_pin(pin, sigs[recs[i].index]);
+	}
+    }
+    halpr_unlock();
+    return retval;
+}
+
+/* Sets the values of the 'V', 'P' and 'U' records. */
+static int set_snapshot_values(struct snapshot_rec *recs, int n)
+{
+    int i, next_param, next_pin, retval = 0;
+
+    rtapi_mutex_get(&(hal_data->mutex));
+    next_param = hal_data->param_list_ptr;
+    next_pin = hal_data->pin_list_ptr;
+    for (i = 0; i < n && retval == 0; i++) {
+	struct snapshot_rec *r = &recs[i];
+	if (r->tag == 'V') {
+	    hal_sig_t *sig = halpr_find_sig_by_name(r->name);
+	    if (sig && sig->type == r->type
+		    && sig->writers == 0 && sig->bidirs == 0) {
+		snap_set_value(sig->type, SHMPTR(sig->data_ptr), &r->value);
+	    }
+	} else if (r->tag == 'P') {
+	    hal_param_t *param = next_param_by_name(&next_param, r->name);
+	    if (param == NULL || param->type != r->type
+		    || param->dir == HAL_RO) {
+		halcmd_error("param '%s' not found or not writable\n", r->name);
+		retval = -EINVAL;
+	    } else {
+		snap_set_value(param->type, SHMPTR(param->data_ptr), &r->value);
+	    }
+	} else if (r->tag == 'U') {
+	    hal_pin_t *pin = next_pin_by_name(&next_pin, r->name);
+	    if (pin && pin->type == r->type && pin->signal == 0) {
+		snap_set_value(pin->type, &(pin->dummysig), &r->value);
+	    }
+	}
+    }
+    rtapi_mutex_give(&(hal_data->mutex));
+    return retval;
+}
+
+/* true if funct is in thread already */
+static int funct_in_thread(const char *funct_name, const char *thread_name)
+{
+    hal_thread_t *tptr;
+    hal_list_t *list_root, *list_entry;
+    int found = 0;
+
+    rtapi_mutex_get(&(hal_data->mutex));
+    tptr = halpr_find_thread_by_name(thread_name);
+    if (tptr) {
+	list_root = &(tptr->funct_list);
+	for (list_entry = list_next(list_root); list_entry != list_root;
+		list_entry = list_next(list_entry)) {
+	    hal_funct_t *funct =
+		SHMPTR(((hal_funct_entry_t *) list_entry)->funct_ptr);
+	    if (strcmp(funct->name, funct_name) == 0) {
+		found = 1;
+		break;
+	    }
+	}
+    }
+    rtapi_mutex_give(&(hal_data->mutex));
+    return found;
+}
+
+int do_loadbin_cmd(char *filename, char *check)
+{
+    FILE *src;
+    struct snapshot_rec *recs;
+    int n, i, exists, retval = 0;
+    long long version[2];
+
+    if (filename == NULL || (check && strcmp(check, "check") != 0)) {
+	halcmd_error("usage: loadbin filename [check]\n");
+	return -EINVAL;
+    }
+    if (hal_get_lock()&HAL_LOCK_LOAD) {
+	halcmd_error("HAL is locked, loading of modules is not permitted\n");
+	return -EPERM;
+    }
+    src = fopen(filename, "rb");
+    if (src == NULL) {
+	halcmd_error("Can't open snapshot '%s'\n", filename);
+	return -1;
+    }
+    recs = read_snapshot(src, &n);
+    fclose(src);
+    if (recs == NULL) {
+	halcmd_error("'%s' is not a HAL snapshot of this version\n", filename);
+	return -1;
+    }
+    /* nothing is done if any module or program has changed, so that the
+       HAL files can be run instead */
+    for (i = 0; i < n && retval == 0; i++) {
+	if (recs[i].tag != 'C') {
+	    continue;
+	}
+	component_version(recs[i].type, recs[i].name, recs[i].args, version);
+	if (version[0] != recs[i].version[0]
+		|| version[1] != recs[i].version[1]) {
+	    halcmd_error("snapshot '%s' is out of date: '%s' has changed\n",
+		filename, recs[i].name);
+	    retval = -1;
+	}
+    }
+    if (retval == 0 && check == NULL) {
+	retval = load_snapshot_comps(recs, n);
+    }
+    for (i = 0; i < n && retval == 0 && check == NULL; i++) {
+	struct snapshot_rec *r = &recs[i];
+	switch (r->tag) {
+	case 'A':
+	    retval = hal_pin_alias(r->name, r->name2);
+	    break;
+	case 'a':
+	    retval = hal_param_alias(r->name, r->name2);
+	    break;
+	case 'S':
+	    rtapi_mutex_get(&(hal_data->mutex));
+	    exists = halpr_find_sig_by_name(r->name) != NULL;
+	    rtapi_mutex_give(&(hal_data->mutex));
+	    if (!exists) {
+		retval = hal_signal_new(r->name, r->type);
+	    }
+	    break;
+	case 'F':
+	case 'B':
+	    if (!funct_in_thread(r->name, r->name2)) {
+		retval = hal_add_funct_to_thread_barrier(r->name, r->name2, -1,
+		    r->tag == 'B');
+	    }
+	    break;
+	}
+	/* after the signals and before the functions, as in a HAL file */
+	if (retval == 0 && r->tag == 'S' && (i + 1 == n || r[1].tag != 'S')) {
+	    retval = link_snapshot(recs, n);
+	    if (retval == 0) {
+		retval = set_snapshot_values(recs, n);
+	    }
+	}
+    }
+    for (i = 0; i < n; i++) {
+	free(recs[i].args);
+    }
+    free(recs);
+    if (retval == 0 && check == NULL) {
+	halcmd_info("HAL loaded from '%s'\n", filename);
+    }
+    return retval;
 }
 
 int do_setexact_cmd() {
@@ -2837,6 +4488,16 @@ int do_help_cmd(char *command)
     } else if (strcmp(command, "gets") == 0) {
 	printf("gets signame\n");
 	printf("  Gets the value of signal 'signame'.\n");
+    } else if (strcmp(command, "watch") == 0) {
+	printf("watch name [name...]\n");
+	printf("  Prints, for each pin, signal or parameter 'name', its value and\n");
+	printf("  its least and greatest value since the last 'watch' of it.  The\n");
+	printf("  values come from the halwatch service if it is loaded, and the\n");
+	printf("  least and greatest are just the value if it is not.\n");
+    } else if (strcmp(command, "unwatch") == 0) {
+	printf("unwatch [name...]\n");
+	printf("  Stops the halwatch service sampling 'name' for this halcmd, or\n");
+	printf("  all of the names it watches.\n");
     } else if (strcmp(command, "stype") == 0) {
 	printf("stype signame\n");
 	printf("  Gets the type of signal 'signame'\n");
@@ -2855,10 +4516,14 @@ int do_help_cmd(char *command)
 	printf("show [type] [pattern]\n");
 	printf("  Prints info about HAL items of the specified type.\n");
 	printf("  'type' is 'comp', 'pin', 'sig', 'param', 'funct',\n");
-	printf("  'thread', or 'all'.  If 'type' is omitted, it assumes\n");
-	printf("  'all' with no pattern.  If 'pattern' is specified\n");
-	printf("  it prints only those items whose names match the\n");
-	printf("  pattern, which may be a 'shell glob'.\n");
+	printf("  'thread', 'latency', or 'all'.  If 'type' is omitted,\n");
+	printf("  it assumes 'all' with no pattern.  If 'pattern' is\n");
+	printf("  specified it prints only those items whose names match\n");
+	printf("  the pattern, which may be a 'shell glob'.  'latency'\n");
+	printf("  prints the wakeup latency histograms of the threads\n");
+	printf("  and of each CPU.\n");
+	printf("show json [comp|pin|sig|param|all] [-ttype] [pattern]\n");
+	printf("  Prints the matching items as one JSON object a line.\n");
     } else if (strcmp(command, "list") == 0) {
 	printf("list type [pattern]\n");
 	printf("  Prints the names of HAL items of the specified type.\n");
@@ -2890,13 +4555,35 @@ int do_help_cmd(char *command)
 	printf("  'comp', 'alias', 'sigu', 'netla', 'param', 'unconnectedinpins' and 'thread'.\n\n");
         printf("  If 'type' is omitted (or type is 'all'), does the equivalent of:\n");
 	printf("  'comp', 'alias', 'sigu', 'netla', 'param', and 'thread'.\n\n");
+        printf("  'save binary filename' instead writes a snapshot of the HAL for\n");
+        printf("  'loadbin'.\n");
         printf("  See the man page ($man halcmd) for save option details\n");
+    } else if (strcmp(command, "loadbin") == 0) {
+	printf("loadbin filename [check]\n");
+	printf("  Builds the HAL saved by 'save binary filename': loads the\n");
+	printf("  components that are not loaded yet, makes the aliases,\n");
+	printf("  signals and links, sets the values and adds the functions\n");
+	printf("  to their threads.  Does nothing if a module or program\n");
+	printf("  has changed since the snapshot was taken.  With 'check',\n");
+	printf("  only tells whether the snapshot can be loaded.\n");
     } else if (strcmp(command, "start") == 0) {
 	printf("start\n");
 	printf("  Starts all realtime threads.\n");
     } else if (strcmp(command, "stop") == 0) {
 	printf("stop\n");
 	printf("  Stops all realtime threads.\n");
+    } else if (strcmp(command, "compact") == 0) {
+	printf("compact\n");
+	printf("  Moves the values of the signals used by each realtime\n");
+	printf("  thread into one contiguous, cache aligned block, in the\n");
+	printf("  order the thread's functions run.  Threads must be stopped;\n");
+	printf("  use it after all 'net' commands and before 'start'.\n");
+    } else if (strcmp(command, "profile") == 0) {
+	printf("profile on|off|reset|show [threadname]\n");
+	printf("  Turns per-function execution profiling on or off, clears\n");
+	printf("  the collected data, or prints a log2 histogram of how many\n");
+	printf("  CPU cycles each function on the thread took.  Without\n");
+	printf("  'threadname' the action applies to all threads.\n");
     } else if (strcmp(command, "quit") == 0) {
 	printf("quit\n");
 	printf("  Stop processing input and terminate halcmd (when\n");
@@ -2949,6 +4636,7 @@ static void print_help_commands(void)
     printf("  newsig, delsig      Create/delete a signal\n");
     printf("  getp, gets          Get the value of a pin, parameter or signal\n");
     printf("  ptype, stype        Get the type of a pin, parameter or signal\n");
+    printf("  watch, unwatch      Sample values and their range through halwatch\n");
     printf("  setp, sets          Set the value of a pin, parameter or signal\n");
     printf("  addf, delf          Add/remove function to/from a thread\n");
     printf("  show                Display info about HAL objects\n");
@@ -2956,7 +4644,10 @@ static void print_help_commands(void)
     printf("  source              Execute commands from another .hal file\n");
     printf("  status              Display status information\n");
     printf("  save                Print config as commands\n");
+    printf("  loadbin             Build the HAL from a 'save binary' snapshot\n");
     printf("  start, stop         Start/stop realtime threads\n");
+    printf("  profile             Profile function execution times\n");
+    printf("  compact             Pack signal values in thread order\n");
     printf("  alias, unalias      Add or remove pin or parameter name aliases\n");
     printf("  echo, unecho        Echo commands from stdin to stderr\n");
     printf("  quit, exit          Exit from halcmd\n");
@@ -55,6 +55,8 @@ extern int do_linkps_cmd(char *pin, char *signal);
 extern int do_linksp_cmd(char *signal, char *pin);
 extern int do_start_cmd();
 extern int do_stop_cmd();
+extern int do_profile_cmd(char *action, char *thread);
+extern int do_compact_cmd();
 extern int do_help_cmd(char *command);
 extern int do_lock_cmd(char *command);
 extern int do_unlock_cmd(char *command);
@@ -68,6 +70,8 @@ extern int do_setp_cmd(char *name, char *value);
 extern int do_getp_cmd(char *name);
 extern int do_sets_cmd(char *name, char *value);
 extern int do_gets_cmd(char *name);
+extern int do_watch_cmd(char *names[]);
+extern int do_unwatch_cmd(char *names[]);
 extern int do_ptype_cmd(char *name);
 extern int do_stype_cmd(char *name);
 extern int do_show_cmd(char *type, char **patterns);
@@ -83,12 +87,17 @@ extern int do_unloadusr_cmd(char *mod_name);
 extern int do_loadusr_cmd(char *args[]);
 extern int do_waitusr_cmd(char *comp_name);
 extern int do_save_cmd(char *type, char *filename);
+extern int do_loadbin_cmd(char *filename, char *check);
 extern int do_setexact_cmd(void);
 
 pid_t hal_systemv_nowait(char *const argv[]);
 int hal_systemv(char *const argv[]);
 
-extern int scriptmode, comp_id;
+/* waits for the components of loadusr -W programs started in parallel
+   mode; returns 0 if they all became ready */
+extern int halcmd_wait_pending(void);
+
+extern int scriptmode, comp_id, parallel_mode;
 
 RTAPI_END_DECLS
 
@@ -50,8 +50,9 @@ static const char *command_table[] = {
     "loadrt", "loadusr", "unload", "lock", "unlock",
     "linkps", "linksp", "linkpp", "unlinkp",
     "net", "newsig", "delsig", "getp", "gets", "setp", "sets", "ptype", "stype",
+    "watch", "unwatch",
     "addf", "delf", "show", "list", "status", "save", "source",
-    "start", "stop", "quit", "exit", "help", "alias", "unalias", 
+    "start", "stop", "profile", "compact", "quit", "exit", "help", "alias", "unalias", 
     NULL,
 };
 
@@ -67,6 +68,7 @@ static const char *alias_table[] = {
 
 static const char *show_table[] = {
     "all", "alias", "comp", "pin", "sig", "param", "funct", "thread",
+    "latency", "json",
     NULL,
 };
 
@@ -654,6 +656,8 @@ char **halcmd_completer(const char *text, int start, int end, hal_completer_func
         result = func(text, signal_generator);
     } else if(startswith(buffer, "gets ") && argno == 1) {
         result = func(text, signal_generator);
+    } else if(startswith(buffer, "watch ") || startswith(buffer, "unwatch ")) {
+        result = func(text, getp_generator);
     } else if(startswith(buffer, "list ")) {
         if (argno == 1) {
             result = completion_matches_table(text, list_table, func);
@@ -684,7 +688,7 @@ char **halcmd_completer(const char *text, int start, int end, hal_completer_func
                 result = func(text, parameter_generator);
             } else if (startswith(n, "funct")) {
                 result = func(text, funct_generator);
-            } else if (startswith(n, "thread")) {
+            } else if (startswith(n, "thread") || startswith(n, "latency")) {
                 result = func(text, thread_generator);
             }
         }
@@ -66,6 +66,53 @@ static int propose_completion(char *all, char *fragment, int start);
 
 static char *prompt = "";
 
+/* with HALCMD_TIMING_FILE in the environment ('linuxcnc -t'), each
+   command of a file that takes a millisecond or more is appended to it
+   as a line "start-ns end-ns description" for the startup timeline */
+static FILE *timing_file;
+
+static long long timing_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void timing_open(void)
+{
+    char *path = getenv("HALCMD_TIMING_FILE");
+
+    if (path == NULL || *path == '\0') {
+	return;
+    }
+    timing_file = fopen(path, "a");
+    if (timing_file != NULL) {
+	fcntl(fileno(timing_file), F_SETFD, FD_CLOEXEC);
+    }
+}
+
+static void timing_record(long long start, char **tokens)
+{
+    char desc[80];
+    const char *name;
+    long long end = timing_now();
+    int n, i;
+
+    if (timing_file == NULL || end - start < 1000000) {
+	return;
+    }
+    name = strrchr(halcmd_get_filename(), '/');
+    name = name ? name + 1 : halcmd_get_filename();
+    n = snprintf(desc, sizeof(desc), "%s:%d:", name, halcmd_get_linenumber());
+    for (i = 0; tokens != NULL && i < MAX_TOK && tokens[i][0] != '\0'
+	    && n < (int) sizeof(desc); i++) {
+	n += snprintf(desc + n, sizeof(desc) - n, " %s", tokens[i]);
+    }
+    fprintf(timing_file, "%lld %lld   %s\n", start, end, desc);
+    fflush(timing_file);
+}
+
 
 /***********************************************************************
 *                   LOCAL FUNCTION DEFINITIONS                         *
@@ -93,7 +140,7 @@ int main(int argc, char **argv)
     keep_going = 0;
     /* start parsing the command line, options first */
     while(1) {
-        c = getopt(argc, argv, "+RCfi:kqQsvVhe");
+        c = getopt(argc, argv, "+RCfi:kPqQsvVhe");
         if(c == -1) break;
         switch(c) {
             case 'R':
@@ -117,6 +164,10 @@ int main(int argc, char **argv)
 		/* -k = keep going */
 		keep_going = 1;
 		break;
+	    case 'P':
+		/* -P = parallel loadusr -W */
+		parallel_mode = 1;
+		break;
 	    case 'q':
 		/* -q = quiet (default) */
 		rtapi_set_msg_level(RTAPI_MSG_ERR);
@@ -249,9 +300,11 @@ int main(int argc, char **argv)
             }
         }
     } else {
+	timing_open();
 	/* read command line(s) from 'srcfile' */
 	while (get_input(srcfile, raw_buf, MAX_CMD_LEN)) {
 	    char *tokens[MAX_TOK+1];
+	    long long start = timing_now();
 	    halcmd_set_linenumber(linenumber++);
 	    /* remove comments, do var substitution, and tokenise */
 	    retval = halcmd_preprocess_line(raw_buf, tokens);
@@ -266,6 +319,7 @@ int main(int argc, char **argv)
 		}
 		/* process command */
 		retval = halcmd_parse_cmd(tokens);
+		timing_record(start, tokens);
 	    }
 	    /* did a signal happen while we were busy? */
 	    if ( halcmd_done ) {
@@ -283,6 +337,16 @@ int main(int argc, char **argv)
 	    }
 	}
     }
+    /* the components still starting up in parallel mode */
+    {
+	long long start = timing_now();
+	char *tokens[] = { "(waiting", "for", "parallel", "loadusr)", "" };
+
+	if ( !halcmd_done && halcmd_wait_pending() != 0 ) {
+	    errorcount++;
+	}
+	timing_record(start, tokens);
+    }
     /* all done */
     halcmd_shutdown();
     if ( errorcount > 0 ) {
@@ -326,6 +390,10 @@ static int release_HAL_mutex(void)
     }
     /* set up internal pointers to shared mem and data structure */
     hal_data = (hal_data_t *) mem;
+    /* an odd seq was left by the same crash, see halpr_lock() */
+    if (hal_data->seq & 1) {
+	hal_data->seq++;
+    }
     /* release mutex  */
     rtapi_mutex_give(&(hal_data->mutex));
     /* release RTAPI resources */
@@ -371,6 +439,9 @@ static void print_help_general(int showR)
 #endif
     printf("  -k             Keep going after failed command.  Default\n");
     printf("                 is to exit if any command fails. (Useful with -f)\n");
+    printf("  -P             Parallel - loadusr -W waits for its component\n");
+    printf("                 only before the next command that is not\n");
+    printf("                 loadusr or loadrt.\n");
     printf("  -q             Quiet - print errors only (default).\n");
     printf("  -Q             Very quiet - print nothing.\n");
     if (showR != 0) {
@@ -137,6 +137,9 @@ dirmap = {'r': 'HAL_RO', 'rw': 'HAL_RW', 'in': 'HAL_IN', 'out': 'HAL_OUT', 'io':
 typemap = {'signed': 's32', 'unsigned': 'u32'}
 deprmap = {'s32': 'signed', 'u32': 'unsigned'}
 deprecated = ['s32', 'u32']
+# the types of the copies of the pins with option cache_pins
+localtypemap = {'bit': 'bool', 'float': 'real_t', 's32': 'rtapi_s32',
+    'u32': 'rtapi_u32'}
 
 def initialize():
     global functions, params, pins, options, comp_name, names, docs, variables
@@ -343,6 +346,18 @@ static int comp_id;
 
     print >>f, "};"
 
+    if options.get("cache_pins"):
+        # FUNCTION bodies work on copies of the pins, which the compiler
+        # can keep in registers because no store can alias them
+        print >>f, "struct __comp_pins {"
+        for name, type, array, dir, value, personality in pins:
+            if array:
+                if isinstance(array, tuple): array = array[0]
+                print >>f, "    %s %s[%s];" % (localtypemap[type], to_c(name), array)
+            else:
+                print >>f, "    %s %s;" % (localtypemap[type], to_c(name))
+        print >>f, "};"
+
     if options.get("userspace"):
         print >>f, "#include <stdlib.h>"
 
@@ -353,6 +368,8 @@ static int comp_id;
         if names.has_key(name):
             Error("Duplicate item name: %s" % name)
         print >>f, "static void %s(struct __comp_state *__comp_inst, long period);" % to_c(name)
+        if options.get("cache_pins"):
+            print >>f, "static void __comp_body_%s(struct __comp_state *__comp_inst, struct __comp_pins *__restrict__ __comp_pins, long period);" % to_c(name)
         names[name] = 1
 
     print >>f, "static int __comp_get_data_size(void);"
@@ -376,7 +393,7 @@ static int comp_id;
         print >>f, "static int export(char *prefix, long extra_arg, long personality) {"
     else:
         print >>f, "static int export(char *prefix, long extra_arg) {"
-    if len(functions) > 0:
+    if len(functions) > 0 and not options.get("batch"):
         print >>f, "    char buf[HAL_NAME_LEN + 1];"
     print >>f, "    int r = 0;"
     if has_array:
@@ -450,6 +467,7 @@ static int comp_id;
             print >>f, "    inst->%s = %s;" % (name, value)
 
     for name, fp in functions:
+        if options.get("batch"): break
         print >>f, "    rtapi_snprintf(buf, sizeof(buf), \"%%s%s\", prefix);"\
             % to_hal("." + name)
         print >>f, "    r = hal_export_funct(buf, (void(*)(void *inst, long))%s, inst, %s, 0, comp_id);" % (
@@ -461,6 +479,27 @@ static int comp_id;
     print >>f, "    return 0;"
     print >>f, "}"
 
+    if options.get("batch"):
+        # one funct for each function, running it for all the instances
+        # in the order they were made
+        for name, fp in functions:
+            print >>f
+            print >>f, "static void __comp_all_%s(void *arg, long period) {" % to_c(name)
+            print >>f, "    struct __comp_state *inst;"
+            print >>f, "    for(inst = __comp_first_inst; inst; inst = inst->_next)"
+            print >>f, "        %s(inst, period);" % to_c(name)
+            print >>f, "}"
+        print >>f
+        print >>f, "static int export_all(void) {"
+        print >>f, "    int r = 0;"
+        for name, fp in functions:
+            print >>f, "    r = hal_export_funct(\"%s.all%s\", __comp_all_%s, 0, %s, 0, comp_id);" % (
+                to_hal(removeprefix(comp_name, "hal_")), to_hal("." + name),
+                to_c(name), int(fp))
+            print >>f, "    if(r != 0) return r;"
+        print >>f, "    return r;"
+        print >>f, "}"
+
     if options.get("count_function"):
         print >>f, "static int get_count(void);"
 
@@ -546,6 +585,8 @@ static int comp_id;
             print >>f, "       }"
             print >>f, "    }"
 
+        if options.get("batch"):
+            print >>f, "    if(r == 0) r = export_all();"
         if options.get("constructable") and not options.get("singleton"):
             print >>f, "    hal_set_constructor(comp_id, export_1);"
         print >>f, "    if(r) {"
@@ -635,9 +676,15 @@ int __comp_parse_names(int *argc, char **argv) {
         print >>f, "}"
 
     print >>f
+    cache = options.get("cache_pins")
+    if cache:
+        cache_wrappers(f)
     if not options.get("no_convenience_defines"):
         print >>f, "#undef FUNCTION"
-        print >>f, "#define FUNCTION(name) static void name(struct __comp_state *__comp_inst, long period)"
+        if cache:
+            print >>f, "#define FUNCTION(name) static void __comp_body_##name(struct __comp_state *__comp_inst, struct __comp_pins *__restrict__ __comp_pins, long period)"
+        else:
+            print >>f, "#define FUNCTION(name) static void name(struct __comp_state *__comp_inst, long period)"
         print >>f, "#undef EXTRA_SETUP"
         print >>f, "#define EXTRA_SETUP() static int extra_setup(struct __comp_state *__comp_inst, char *prefix, long extra_arg)"
         print >>f, "#undef EXTRA_CLEANUP"
@@ -646,6 +693,18 @@ int __comp_parse_names(int *argc, char **argv) {
         print >>f, "#define fperiod (period * 1e-9)"
         for name, type, array, dir, value, personality in pins:
             print >>f, "#undef %s" % to_c(name)
+            if cache:
+                if array:
+                    if dir == 'in':
+                        print >>f, "#define %s(i) (0+__comp_pins->%s[i])" % (to_c(name), to_c(name))
+                    else:
+                        print >>f, "#define %s(i) (__comp_pins->%s[i])" % (to_c(name), to_c(name))
+                else:
+                    if dir == 'in':
+                        print >>f, "#define %s (0+__comp_pins->%s)" % (to_c(name), to_c(name))
+                    else:
+                        print >>f, "#define %s (__comp_pins->%s)" % (to_c(name), to_c(name))
+                continue
             if array:
                 if dir == 'in':
                     print >>f, "#define %s(i) (0+*(__comp_inst->%s[i]))" % (to_c(name), to_c(name))
@@ -681,6 +740,40 @@ int __comp_parse_names(int *argc, char **argv) {
     print >>f
     print >>f
 
+def copy_pins(f, fmt, dirs):
+    for name, type, array, dir, value, personality in pins:
+        if dir not in dirs: continue
+        c = to_c(name)
+        # pins made only for some personalities may not exist
+        check = personality or isinstance(array, tuple)
+        indent = "    "
+        if array:
+            if isinstance(array, tuple): array = array[0]
+            print >>f, "    for(j=0; j < (%s); j++)" % array
+            indent += "    "
+            c = c + "[j]"
+        if check:
+            print >>f, indent + "if(__comp_inst->%s)" % c
+            indent += "    "
+        print >>f, indent + fmt % {'pin': c}
+
+def cache_wrappers(f):
+    # the functions exported to HAL copy the pins in, call the FUNCTION
+    # body and copy the outputs back; they come before the pin macros
+    has_array = [p for p in pins if p[2]]
+    for name, fp in functions:
+        print >>f, "static void %s(struct __comp_state *__comp_inst, long period) {" % to_c(name)
+        print >>f, "    struct __comp_pins __comp_pins;"
+        if has_array:
+            print >>f, "    int j;"
+        copy_pins(f, "__comp_pins.%(pin)s = *__comp_inst->%(pin)s;",
+            ('in', 'out', 'io'))
+        print >>f, "    __comp_body_%s(__comp_inst, &__comp_pins, period);" % to_c(name)
+        copy_pins(f, "*__comp_inst->%(pin)s = __comp_pins.%(pin)s;",
+            ('out', 'io'))
+        print >>f, "}"
+        print >>f
+
 def epilogue(f):
     data = options.get('data')
     print >>f
@@ -866,7 +959,10 @@ def document(filename, outfilename):
         print >>f, ".SH FUNCTIONS"
         for _, name, fp, doc in finddocs('funct'):
             print >>f, ".TP"
-            print >>f, "\\fB%s\\fR" % to_hal_man(name),
+            if options.get("batch"):
+                print >>f, "\\fB%s\\fR" % to_hal_man_unnumbered("all." + name),
+            else:
+                print >>f, "\\fB%s\\fR" % to_hal_man(name),
             if fp:
                 print >>f, "(requires a floating-point thread)"
             else:
@@ -965,6 +1061,14 @@ def process(filename, mode, outfilename):
         if options.get("userspace"):
             if functions:
                 raise SystemExit, "Userspace components may not have functions"
+        if options.get("batch") and options.get("singleton"):
+            raise SystemExit, "A singleton component may not use 'option batch'"
+        if options.get("cache_pins"):
+            if options.get("userspace") or options.get("no_convenience_defines"):
+                raise SystemExit, "'option cache_pins' needs FUNCTION() and the pin macros"
+            for p in pins:
+                if p[1] not in localtypemap:
+                    raise SystemExit, "'option cache_pins' can't copy %s pin %s" % (p[1], p[0])
         if not pins:
             raise SystemExit, "Component must have at least one pin"
         prologue(f)
@@ -105,8 +105,9 @@
   
   comm_mode ascii | binary
   With get, will return the current communications mode. With set, will
-  set the communications mode to the specified mode. The binary protocol 
-  is TBD.
+  set the communications mode to the specified mode. In binary mode the
+  replies of Values and Watch are binary frames, described there; all
+  other replies stay text.
   
   comm_prot <version no>
   With get, returns the current protocol version used by the server,
@@ -271,6 +272,43 @@
 
   Stop
 
+  Handles [<name> ...]
+
+  Get only, gives each pin, signal or parameter named a handle, a number
+  that the Values and Watch commands take in place of the name.  Names
+  are looked up once, and again only when the HAL has changed, so a
+  client polling many values doesn't have them searched for each time.
+  The reply is a line for each name of
+    HANDLE <handle> <name> PIN | SIGNAL | PARAM <type>
+  or HANDLE NAK <name> if there is no such item.  Handles belong to the
+  connection and last as long as it does; naming an item again gives the
+  same handle.  Without names, it lists all the handles of the connection,
+  with NONE in place of the kind and type of any whose item has since
+  been deleted.
+
+  Values [<handle> ...]
+
+  With get, returns the values of the handles, or of all of them, on one
+  line of
+    VALUES <handle> <value> [<handle> <value> ...]
+  with NONE for the value of a handle whose item has been deleted.  They
+  are read without the HAL mutex.  With set, and control enabled, the
+  arguments are handle and value pairs, written by the rules of SetP and
+  SetS; it stops at the first that can't be written.
+
+  Watch [<handle> ...]
+
+  Get only, like Values, but the line starts with WATCH and only has the
+  handles whose values have changed since the last Watch that included
+  them.  The first Watch of a handle always has it.
+
+  In binary comm_mode, the replies of Values and Watch are a frame of the
+  bytes 'H' and 'V' (or 'W' for Watch), the number of values as a 32 bit
+  integer, and then 12 bytes for each value: the handle as a 16 bit
+  integer, the HAL type (1 bit, 2 float, 3 s32, 4 u32, or 0 for NONE), a
+  zero byte, and the value, as an IEEE double for a float and as a 64 bit
+  signed integer otherwise.  All the integers are little endian.
+
 ****************************************************************************/
 
 #include "config.h"
@@ -295,6 +333,7 @@
 #include <netinet/in.h>
 #include <sys/uio.h>
 #include <pthread.h>
+#include <stdint.h>
 #include <fnmatch.h>
 #include <getopt.h>
 
@@ -317,6 +356,10 @@
 #define MAX_TOK 20
 #define MAX_CMD_LEN 1024
 #define MAX_EXPECTED_SIGS 999
+#define MAX_HANDLES 65535	/* handles are 16 bits in a binary frame */
+#define HANDLE_BATCH 64		/* values read between checks for a torn read */
+#define HANDLE_ENTRY_SIZE 12	/* bytes of a value in a binary frame */
+#define HANDLE_SEQ_STALE 1	/* odd, so never the seq of a stable HAL */
 
 static int release_HAL_mutex(void);
 static int do_help_cmd(char *command);
@@ -356,6 +399,18 @@ char serverName[24] = "EMCNETSVR\0"; // Server name written in hello response
 int sessions = 0;                    // Number of open sessions
 int maxSessions = -1;                // Maximum number of sessions to allow
 
+typedef enum {
+  HANDLE_PIN = 1, HANDLE_SIG, HANDLE_PARAM} handleKindType;
+
+typedef struct {
+  char name[HAL_NAME_LEN+1];
+  handleKindType kind;
+  hal_type_t type;
+  int item;			// offset of the pin, signal or param, or 0
+  hal_data_u last;		// value at the last watch
+  int lastType;			// type at the last watch, 0 if it was NONE
+  int watched;} remoteHandleType;
+
 typedef struct {  
   int cliSock;
   char hostName[80];
@@ -366,9 +421,18 @@ typedef struct {
   int enabled;
   int commMode;
   int commProt;
-  char inBuf[256];
+  char inBuf[1600];
   char outBuf[4096];
-  char progName[256];} connectionRecType;
+  char progName[256];
+  remoteHandleType *handles;
+  int numHandles;
+  int maxHandles;
+  unsigned int handleSeq;	// hal_data->seq the handles were looked up at
+  int *list;			// handles of a get values or get watch
+  int listSize;
+  char *bulkBuf;		// replies of the handle commands
+  size_t bulkLen;
+  size_t bulkSize;} connectionRecType;
 
 
 int port = 5006;
@@ -393,7 +457,7 @@ typedef enum {
   hcComp, hcPin, hcPinVal, hcSig, hcSigVal, hcParam, hcParamVal, hcFunct, hcThread,
   hcLoadRt, hcUnload, hcLoadUsr, hcLinkps, hcLinksp, hcLinkpp, hcNet, hcUnlinkp,
   hcLock, hcUnlock, hcNewSig, hcDelSig, hcSetP, hcSetS, hcAddF, hcDelF,
-  hcSave, hcStart, hcStop, hcUnknown
+  hcSave, hcStart, hcStop, hcHandles, hcValues, hcWatch, hcUnknown
   } halCommandType;
   
 typedef enum {
@@ -416,7 +480,7 @@ const char *halCommands[] = {
   "COMP", "PIN", "PINVAL", "SIGNAL", "SIGVAL", "PARAM", "PARAMVAL", "FUNCT", "THREAD",
   "LOADRT", "UNLOAD", "LOADUSR", "LINKPS", "LINKSP", "LINKPP", "NET", "UNLINKP",
   "LOCK", "UNLOCK", "NEWSIG", "DELSIG", "SETP", "SETS", "ADDF", "DELF",
-  "SAVE", "START", "STOP", ""};
+  "SAVE", "START", "STOP", "HANDLES", "VALUES", "WATCH", ""};
 
 #ifndef NO_INI
     FILE *inifile = NULL;
@@ -1898,6 +1962,402 @@ static void getThreadInfo(char *pattern, connectionRecType *context)
     rtapi_mutex_give(&(hal_data->mutex));
 }
 
+/* Handles: 'get handles' looks each name up once and gives the client a
+   number for it, that 'get values', 'get watch' and 'set values' take
+   instead of the name.  The table belongs to the connection and lasts
+   as long as it does.  What a handle points at is looked up again by
+   name when the HAL has changed (hal_data->seq) since it last was, so
+   a handle whose pin is linked or unlinked keeps working, and one whose
+   item has been deleted reads as NONE until it is created again. */
+
+static hal_data_u *handle_data(remoteHandleType *h)
+{
+    hal_pin_t *pin;
+    hal_sig_t *sig;
+
+    switch (h->kind) {
+    case HANDLE_PIN:
+	pin = SHMPTR(h->item);
+	if (pin->signal != 0) {
+	    sig = SHMPTR(pin->signal);
+	    return SHMPTR(sig->data_ptr);
+	}
+	return &(pin->dummysig);
+    case HANDLE_SIG:
+	sig = SHMPTR(h->item);
+	return SHMPTR(sig->data_ptr);
+    default:
+	return SHMPTR(((hal_param_t *) SHMPTR(h->item))->data_ptr);
+    }
+}
+
+/* only the member of the type is copied, the rest is zeroed so that a
+   watch can compare the whole union */
+static void readHandle(remoteHandleType *h, hal_data_u *v)
+{
+    hal_data_u *d = handle_data(h);
+
+    memset(v, 0, sizeof(*v));
+    switch (h->type) {
+    case HAL_BIT: v->b = d->b; break;
+    case HAL_S32: v->s = d->s; break;
+    case HAL_U32: v->u = d->u; break;
+    case HAL_FLOAT: v->f = d->f; break;
+    default: break;
+    }
+}
+
+/* the caller holds the mutex or is in a lockless read */
+static void resolveHandle(remoteHandleType *h)
+{
+    hal_pin_t *pin;
+    hal_sig_t *sig;
+    hal_param_t *param;
+
+    h->item = 0;
+    if ((pin = halpr_find_pin_by_name(h->name)) != 0) {
+	h->kind = HANDLE_PIN;
+	h->type = pin->type;
+	h->item = SHMOFF(pin);
+    } else if ((sig = halpr_find_sig_by_name(h->name)) != 0) {
+	h->kind = HANDLE_SIG;
+	h->type = sig->type;
+	h->item = SHMOFF(sig);
+    } else if ((param = halpr_find_param_by_name(h->name)) != 0) {
+	h->kind = HANDLE_PARAM;
+	h->type = param->type;
+	h->item = SHMOFF(param);
+    }
+}
+
+static void resolveHandles(connectionRecType *context, unsigned int seq)
+{
+    int i;
+
+    if (context->handleSeq == seq && !(seq & 1)) return;
+    for (i = 0; i < context->numHandles; i++)
+	resolveHandle(&context->handles[i]);
+    context->handleSeq = seq;
+}
+
+static int bulkReserve(connectionRecType *context, size_t n)
+{
+    char *buf;
+    size_t size;
+
+    if (context->bulkLen + n <= context->bulkSize) return 0;
+    size = context->bulkSize ? context->bulkSize : 4096;
+    while (size < context->bulkLen + n) size *= 2;
+    buf = realloc(context->bulkBuf, size);
+    if (buf == NULL) return -1;
+    context->bulkBuf = buf;
+    context->bulkSize = size;
+    return 0;
+}
+
+static void bulkText(connectionRecType *context, const char *s)
+{
+    size_t n = strlen(s);
+
+    if (bulkReserve(context, n) == 0) {
+	memcpy(context->bulkBuf + context->bulkLen, s, n);
+	context->bulkLen += n;
+    }
+}
+
+/* binary entry: handle, HAL type (0 for NONE), 0, then the value as a
+   double for a float and as a signed 64 bit integer for the others,
+   all little endian */
+static void bulkBinary(connectionRecType *context, int handle, int type,
+    hal_data_u *value)
+{
+    unsigned char *p;
+    uint64_t v = 0;
+    int i;
+
+    if (bulkReserve(context, HANDLE_ENTRY_SIZE) != 0) return;
+    switch (type) {
+    case HAL_BIT: v = value->b ? 1 : 0; break;
+    case HAL_S32: v = (uint64_t)(int64_t) value->s; break;
+    case HAL_U32: v = value->u; break;
+    case HAL_FLOAT: {
+	double f = value->f;
+	memcpy(&v, &f, sizeof(v));
+	break;
+	}
+    default: type = 0;
+    }
+    p = (unsigned char *) context->bulkBuf + context->bulkLen;
+    p[0] = handle & 0xff;
+    p[1] = (handle >> 8) & 0xff;
+    p[2] = type;
+    p[3] = 0;
+    for (i = 0; i < 8; i++)
+	p[4 + i] = (v >> (8 * i)) & 0xff;
+    context->bulkLen += HANDLE_ENTRY_SIZE;
+}
+
+static int bulkSend(connectionRecType *context)
+{
+    size_t done = 0;
+    ssize_t n;
+
+    while (done < context->bulkLen) {
+	n = write(context->cliSock, context->bulkBuf + done,
+	    context->bulkLen - done);
+	if (n < 0 && errno == EINTR) continue;
+	if (n <= 0) return -1;
+	done += n;
+    }
+    context->bulkLen = 0;
+    return 0;
+}
+
+static int findHandle(char *name, connectionRecType *context)
+{
+    int i;
+
+    for (i = 0; i < context->numHandles; i++)
+	if (strcmp(context->handles[i].name, name) == 0) return i;
+    return -1;
+}
+
+static const char *handleKind(int kind)
+{
+    switch (kind) {
+    case HANDLE_PIN: return "PIN";
+    case HANDLE_SIG: return "SIGNAL";
+    default: return "PARAM";
+    }
+}
+
+static const char *handleType(int type)
+{
+    switch (type) {
+    case HAL_BIT: return "bit";
+    case HAL_FLOAT: return "float";
+    case HAL_S32: return "s32";
+    case HAL_U32: return "u32";
+    default: return "undef";
+    }
+}
+
+static void handleLine(int i, connectionRecType *context)
+{
+    char line[HAL_NAME_LEN + 64];
+    remoteHandleType *h = &context->handles[i];
+
+    if (h->item == 0)
+	snprintf(line, sizeof(line), "HANDLE %d %s NONE\r\n", i, h->name);
+    else
+	snprintf(line, sizeof(line), "HANDLE %d %s %s %s\r\n", i, h->name,
+	    handleKind(h->kind), handleType((int) h->type));
+    bulkText(context, line);
+}
+
+/* the handle of name, registering it if it isn't yet; -1 if it isn't
+   the name of a pin, signal or parameter */
+static int addHandle(char *name, connectionRecType *context)
+{
+    remoteHandleType *h;
+    int i, n;
+
+    if (strlen(name) > HAL_NAME_LEN) return -1;
+    if ((i = findHandle(name, context)) >= 0) return i;
+    if (context->numHandles == context->maxHandles) {
+	n = context->maxHandles ? context->maxHandles * 2 : 64;
+	if (n > MAX_HANDLES) n = MAX_HANDLES;
+	if (n == context->maxHandles) return -1;
+	h = realloc(context->handles, n * sizeof(*h));
+	if (h == NULL) return -1;
+	context->handles = h;
+	context->maxHandles = n;
+    }
+    h = &context->handles[context->numHandles];
+    memset(h, 0, sizeof(*h));
+    strcpy(h->name, name);
+    resolveHandle(h);
+    if (h->item == 0) return -1;
+    return context->numHandles++;
+}
+
+/* get handles [<name> ...]: registers the names that aren't yet, and
+   answers a HANDLE line for each name, or for every handle */
+static cmdResponseType getHandles(char *s, connectionRecType *context)
+{
+    char line[HAL_NAME_LEN + 64];
+    int i;
+
+    context->bulkLen = 0;
+    rtapi_mutex_get(&(hal_data->mutex));
+    resolveHandles(context, hal_data->seq);
+    if (s == NULL) {
+	for (i = 0; i < context->numHandles; i++) handleLine(i, context);
+    }
+    for (; s != NULL; s = strtok(NULL, delims)) {
+	if ((i = addHandle(s, context)) >= 0) {
+	    handleLine(i, context);
+	} else {
+	    snprintf(line, sizeof(line), "HANDLE NAK %.*s\r\n", HAL_NAME_LEN, s);
+	    bulkText(context, line);
+	}
+    }
+    rtapi_mutex_give(&(hal_data->mutex));
+    bulkSend(context);
+    return rtHandledNoError;
+}
+
+/* get values [<handle> ...] and get watch [<handle> ...]: the values of
+   the handles given, or of all of them, in one line or binary frame.
+   watch leaves out the handles whose values are the same as at their
+   last watch. */
+static cmdResponseType getHandleValues(char *s, int watch, connectionRecType *context)
+{
+    hal_data_u values[HANDLE_BATCH];
+    char text[32];
+    unsigned int seq;
+    int count = 0, sent = 0, tries, i, j, n;
+    remoteHandleType *h;
+    int *list;
+
+    /* the handles asked for, checked before anything is written */
+    if (context->listSize < context->numHandles) {
+	int *p = realloc(context->list, context->numHandles * sizeof(*p));
+	if (p == NULL) return rtStandardError;
+	context->list = p;
+	context->listSize = context->numHandles;
+    }
+    list = context->list;
+    if (s == NULL) {
+	for (i = 0; i < context->numHandles; i++) list[count++] = i;
+    } else {
+	for (; s != NULL; s = strtok(NULL, delims)) {
+	    char *end;
+	    long l = strtol(s, &end, 10);
+
+	    if (*end != '\0' || l < 0 || l >= context->numHandles
+		    || count == context->listSize)
+		return rtStandardError;
+	    list[count++] = l;
+	}
+    }
+
+    context->bulkLen = 0;
+    if (bulkReserve(context, 8 + (size_t) count
+	    * (context->commMode == 1 ? HANDLE_ENTRY_SIZE : 24)) != 0)
+	return rtStandardError;
+    if (context->commMode == 1) {
+	/* frame: 'H', 'V' or 'W', entries as a little endian uint32 */
+	context->bulkBuf[0] = 'H';
+	context->bulkBuf[1] = watch ? 'W' : 'V';
+	context->bulkLen = 6;
+    } else {
+	bulkText(context, watch ? "WATCH" : "VALUES");
+    }
+    /* without the mutex, a batch at a time so a torn read repeats few */
+    for (i = 0; i < count; i += HANDLE_BATCH) {
+	n = count - i < HANDLE_BATCH ? count - i : HANDLE_BATCH;
+	for (tries = 0; ; tries++) {
+	    seq = halpr_read_begin(tries);
+	    resolveHandles(context, seq);
+	    for (j = 0; j < n && !halpr_read_torn(seq); j++) {
+		h = &context->handles[list[i + j]];
+		if (h->item != 0) readHandle(h, &values[j]);
+	    }
+	    if (!halpr_read_retry(seq, tries)) break;
+	    /* what was looked up may be torn too */
+	    context->handleSeq = HANDLE_SEQ_STALE;
+	}
+	for (j = 0; j < n; j++) {
+	    int type;
+
+	    h = &context->handles[list[i + j]];
+	    type = h->item != 0 ? (int) h->type : 0;
+	    if (watch) {
+		if (type == h->lastType && type != 0
+			&& memcmp(&values[j], &h->last, sizeof(values[j])) == 0)
+		    continue;
+		if (type == 0 && h->lastType == 0 && h->watched)
+		    continue;
+		h->last = values[j];
+		h->lastType = type;
+		h->watched = 1;
+	    }
+	    if (context->commMode == 1) {
+		bulkBinary(context, list[i + j], type, &values[j]);
+	    } else if (type == 0) {
+		snprintf(text, sizeof(text), " %d NONE", list[i + j]);
+		bulkText(context, text);
+	    } else {
+		snprintf(text, sizeof(text), " %d %s", list[i + j],
+		    data_value2(type, &values[j]));
+		bulkText(context, text);
+	    }
+	    sent++;
+	}
+    }
+    if (context->commMode == 1) {
+	for (j = 0; j < 4; j++)
+	    context->bulkBuf[2 + j] = (sent >> (8 * j)) & 0xff;
+    } else {
+	bulkText(context, "\r\n");
+    }
+    bulkSend(context);
+    return rtHandledNoError;
+}
+
+/* set values <handle> <value> [<handle> <value> ...]: writes the same
+   items as setp and sets would, all under one take of the mutex */
+static cmdResponseType setHandleValues(char *s, connectionRecType *context)
+{
+    const char *nakStr = "SET VALUES NAK";
+    remoteHandleType *h;
+    char *value, *end;
+    long l;
+    int retval = 0;
+
+    if (s == NULL) return rtStandardError;
+    rtapi_mutex_get(&(hal_data->mutex));
+    resolveHandles(context, hal_data->seq);
+    for (; s != NULL && retval == 0; s = strtok(NULL, delims)) {
+	value = strtok(NULL, delims);
+	l = strtol(s, &end, 10);
+	if (value == NULL || *end != '\0' || l < 0 || l >= context->numHandles) {
+	    sprintf(errorStr, "HAL:%d: ERROR: bad handle '%s'", linenumber, s);
+	    retval = -EINVAL;
+	    break;
+	}
+	h = &context->handles[l];
+	if (h->item == 0) {
+	    sprintf(errorStr, "HAL:%d: ERROR: '%s' not found", linenumber, h->name);
+	    retval = -EINVAL;
+	} else if (h->kind == HANDLE_PIN
+		&& (((hal_pin_t *) SHMPTR(h->item))->dir == HAL_OUT
+		    || ((hal_pin_t *) SHMPTR(h->item))->signal != 0)) {
+	    sprintf(errorStr, "HAL:%d: ERROR: pin '%s' is not writable", linenumber, h->name);
+	    retval = -EINVAL;
+	} else if (h->kind == HANDLE_SIG
+		&& ((hal_sig_t *) SHMPTR(h->item))->writers > 0) {
+	    sprintf(errorStr, "HAL:%d: ERROR: signal '%s' already has writer(s)",
+		linenumber, h->name);
+	    retval = -EINVAL;
+	} else if (h->kind == HANDLE_PARAM
+		&& ((hal_param_t *) SHMPTR(h->item))->dir == HAL_RO) {
+	    sprintf(errorStr, "HAL:%d: ERROR: param '%s' is not writable", linenumber, h->name);
+	    retval = -EINVAL;
+	} else if ((retval = set_common(h->type, handle_data(h), value, context)) != 0) {
+	    sprintf(errorStr, "HAL:%d: ERROR: bad value '%s' for '%s'", linenumber,
+		value, h->name);
+	}
+    }
+    rtapi_mutex_give(&(hal_data->mutex));
+    if (retval != 0) {
+	sockWriteError(nakStr, context);
+	return rtCustomHandledError;
+    }
+    return rtNoError;
+}
+
 
 /* Switch function for pin/sig/param type for the print_*_list functions */
 static const char *data_type(int type)
@@ -2737,7 +3197,10 @@ int commandGet(connectionRecType *context)
     case hcDelF: ;
     case hcSave: ;
     case hcStart: ;
-    case hcStop: ;
+    case hcStop: ret = rtStandardError; break;
+    case hcHandles: ret = getHandles(strtok(NULL, delims), context); break;
+    case hcValues: ret = getHandleValues(strtok(NULL, delims), 0, context); break;
+    case hcWatch: ret = getHandleValues(strtok(NULL, delims), 1, context); break;
     case hcUnknown: ret = rtStandardError;
     }
   switch (ret) {
@@ -3067,6 +3530,11 @@ int commandSet(connectionRecType *context)
     sprintf(context->outBuf, setCmdNakStr, pcmd);
     return write(context->cliSock, context->outBuf, strlen(context->outBuf));
     }
+  if (cmd == hcValues) {
+    // any number of pairs, so it takes them from strtok itself
+    ret = setHandleValues(strtok(NULL, delims), context);
+    goto respond;
+    }
   pch = strtok(NULL, delims);
   i = 0;
   while (pch != NULL) {
@@ -3118,8 +3586,12 @@ int commandSet(connectionRecType *context)
     case hcSave: setSave(tokens[0], tokens[1], context); break;
     case hcStart: setStart(context); break;
     case hcStop: setStop(context); break;
+    case hcHandles: ;
+    case hcValues: ;
+    case hcWatch: ;
     case hcUnknown: ret = rtStandardError;
     }
+respond:
   switch (ret) {
     case rtNoError:  
       if (context->verbose) {
@@ -3205,6 +3677,7 @@ static int helpGet(connectionRecType *context)
   strcat(context->outBuf, "    Enable\n\r");
   strcat(context->outBuf, "    Funct <funct name>\n\r");
   strcat(context->outBuf, "    Functs\n\r");
+  strcat(context->outBuf, "    Handles [<name> ..]\n\r");
   strcat(context->outBuf, "    Param <param name>\n\r");
   strcat(context->outBuf, "    Params\n\r");
   strcat(context->outBuf, "    ParamVal <param name>\n\r");
@@ -3219,7 +3692,9 @@ static int helpGet(connectionRecType *context)
   strcat(context->outBuf, "    SigVals\n\r");
   strcat(context->outBuf, "    Thread <thread name>\n\r");
   strcat(context->outBuf, "    Threads\n\r");
+  strcat(context->outBuf, "    Values [<handle> ..]\n\r");
   strcat(context->outBuf, "    Verbose\n\r");
+  strcat(context->outBuf, "    Watch [<handle> ..]\n\r");
 //  strcat(outBuf, "CONFIG\n\r");
   sockWrite(context);
   return 0;
@@ -3256,6 +3731,7 @@ static int helpSet(connectionRecType *context)
   strcat(context->outBuf, "    Unlink <pin name>\n\r");
   strcat(context->outBuf, "    Unload <name>\n\r");
   strcat(context->outBuf, "    Unlock <command>\n\r");
+  strcat(context->outBuf, "    Values <handle> <value> [<handle> <value> ..]\n\r");
   
   sockWrite(context);
   return 0;
@@ -3387,12 +3863,22 @@ void *readClient(void *arg)
   context->commMode = 0;
   context->commProt = 0;
   context->inBuf[0] = 0;
+  context->handles = NULL;
+  context->numHandles = 0;
+  context->maxHandles = 0;
+  context->handleSeq = HANDLE_SEQ_STALE;
+  context->list = NULL;
+  context->listSize = 0;
+  context->bulkBuf = NULL;
+  context->bulkLen = 0;
+  context->bulkSize = 0;
   buf[0] = 0;
   
   while (1) {
-    len = read(context->cliSock, &str, 1600);
+    len = read(context->cliSock, &str, sizeof(str) - 1);
     if (len <= 0) goto finished;
     str[len] = 0;
+    if (strlen(buf) + len >= sizeof(buf)) goto finished;
     strcat(buf, str);
     if (!memchr(str, 0x0d, strlen(str))) continue;
     if ((context->echo == 1) && (context->linked == 1)) {
@@ -3405,8 +3891,10 @@ void *readClient(void *arg)
     j = 0;
     while (i <= strlen(buf)) {
       if ((buf[i] != '\n') && (buf[i] != '\r')) {
-        context->inBuf[j] = buf[i];
-	j++;
+        if (j < sizeof(context->inBuf) - 1) {
+          context->inBuf[j] = buf[i];
+	  j++;
+	  }
 	}
       else
         if (j > 0)
@@ -3422,6 +3910,9 @@ void *readClient(void *arg)
 
 finished:
   close(context->cliSock);
+  free(context->handles);
+  free(context->list);
+  free(context->bulkBuf);
   free(context);
   pthread_exit((void *)0);
 }
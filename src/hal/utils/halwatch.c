@@ -0,0 +1,298 @@
+/** This file, 'halwatch.c', is the halwatch service: a userspace HAL
+    component that samples the pins, signals and parameters its clients
+    ask for into a table in shared memory.  See 'halwatch.h'.
+
+    Usage: loadusr -W halwatch [rate]
+
+    'rate' is in samples per second, HALWATCH_RATE_DEFAULT if omitted.
+*/
+
+/** This program is free software; you can redistribute it and/or
+    modify it under the terms of version 2 of the GNU General
+    Public License as published by the Free Software Foundation.
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111 USA
+*/
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "rtapi.h"
+#include <rtapi_mutex.h>
+#include "hal.h"
+#include "../hal_priv.h"
+#include "halwatch.h"
+
+static int comp_id = -1, shm_id = -1;
+static halwatch_shm_t *watch;
+static volatile sig_atomic_t done;
+
+/* what each slot was looked up to, private to the service */
+static struct {
+    unsigned int gen;
+    int type;
+    hal_data_u *data;
+} found[HALWATCH_SLOTS];
+static unsigned int found_seq = 1;	/* odd: nothing looked up yet */
+
+static void quit(int sig)
+{
+    done = 1;
+}
+
+static int lookup(halwatch_slot_t *s, hal_data_u **data)
+{
+    hal_pin_t *pin;
+    hal_sig_t *sig;
+    hal_param_t *param;
+
+    if (s->kind == HALWATCH_ANY || s->kind == HALWATCH_PIN) {
+	pin = halpr_find_pin_by_name(s->name);
+	if (pin != NULL) {
+	    if (pin->signal != 0) {
+		sig = SHMPTR(pin->signal);
+		*data = SHMPTR(sig->data_ptr);
+	    } else {
+		*data = &(pin->dummysig);
+	    }
+	    return pin->type;
+	}
+    }
+    if (s->kind == HALWATCH_ANY || s->kind == HALWATCH_SIG) {
+	sig = halpr_find_sig_by_name(s->name);
+	if (sig != NULL) {
+	    *data = SHMPTR(sig->data_ptr);
+	    return sig->type;
+	}
+    }
+    if (s->kind == HALWATCH_ANY || s->kind == HALWATCH_PARAM) {
+	param = halpr_find_param_by_name(s->name);
+	if (param != NULL) {
+	    *data = SHMPTR(param->data_ptr);
+	    return param->type;
+	}
+    }
+    *data = NULL;
+    return -1;
+}
+
+/* looks up the slots that are new, or all of them if the HAL changed */
+static void lookup_slots(void)
+{
+    unsigned int seq;
+    int tries, i, all;
+
+    seq = __atomic_load_n(&hal_data->seq, __ATOMIC_ACQUIRE);
+    all = seq != found_seq;
+    for (i = 0; i < HALWATCH_SLOTS && !all; i++) {
+	halwatch_slot_t *s = &watch->slot[i];
+
+	if (__atomic_load_n(&s->owner, __ATOMIC_ACQUIRE) != 0
+		&& s->gen != found[i].gen) {
+	    break;
+	}
+    }
+    if (!all && i == HALWATCH_SLOTS) {
+	return;
+    }
+    for (tries = 0; ; tries++) {
+	seq = halpr_read_begin(tries);
+	for (i = 0; i < HALWATCH_SLOTS && !halpr_read_torn(seq); i++) {
+	    halwatch_slot_t *s = &watch->slot[i];
+	    unsigned int gen;
+
+	    if (__atomic_load_n(&s->owner, __ATOMIC_ACQUIRE) == 0) {
+		continue;
+	    }
+	    gen = s->gen;
+	    if (gen == found[i].gen && seq == found_seq) {
+		continue;
+	    }
+	    found[i].type = lookup(s, &found[i].data);
+	    found[i].gen = gen;
+	}
+	if (!halpr_read_retry(seq, tries)) {
+	    break;
+	}
+	/* look everything up again */
+	found_seq = 1;
+    }
+    found_seq = seq;
+}
+
+static void read_value(int type, hal_data_u *data, hal_data_u *v)
+{
+    memset(v, 0, sizeof(*v));
+    switch (type) {
+    case HAL_BIT: v->b = data->b; break;
+    case HAL_S32: v->s = data->s; break;
+    case HAL_U32: v->u = data->u; break;
+    case HAL_FLOAT: v->f = data->f; break;
+    default: break;
+    }
+}
+
+static void update_range(int type, hal_data_u *v, hal_data_u *min, hal_data_u *max)
+{
+    switch (type) {
+    case HAL_BIT:
+	if (!v->b) min->b = 0;
+	if (v->b) max->b = 1;
+	break;
+    case HAL_S32:
+	if (v->s < min->s) min->s = v->s;
+	if (v->s > max->s) max->s = v->s;
+	break;
+    case HAL_U32:
+	if (v->u < min->u) min->u = v->u;
+	if (v->u > max->u) max->u = v->u;
+	break;
+    case HAL_FLOAT:
+	if (v->f < min->f) min->f = v->f;
+	if (v->f > max->f) max->f = v->f;
+	break;
+    default: break;
+    }
+}
+
+static void sample(void)
+{
+    int i;
+
+    lookup_slots();
+    for (i = 0; i < HALWATCH_SLOTS; i++) {
+	halwatch_slot_t *s = &watch->slot[i];
+	unsigned int reset;
+	hal_data_u v;
+	int type = found[i].type;
+
+	if (__atomic_load_n(&s->owner, __ATOMIC_ACQUIRE) == 0) {
+	    continue;
+	}
+	if (type > 0) {
+	    read_value(type, found[i].data, &v);
+	}
+	reset = __atomic_load_n(&s->reset, __ATOMIC_ACQUIRE);
+	__atomic_store_n(&s->seq, s->seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	if (s->sample_gen != found[i].gen || s->type != type) {
+	    s->sample_gen = found[i].gen;
+	    s->type = type;
+	    s->samples = 0;
+	}
+	if (type > 0) {
+	    /* bits start out as neither ever FALSE nor ever TRUE */
+	    if (s->samples == 0 || reset != s->reset_done) {
+		s->min = v;
+		s->max = v;
+		s->reset_done = reset;
+		s->samples = 0;
+	    }
+	    s->value = v;
+	    update_range(type, &v, &s->min, &s->max);
+	    s->samples++;
+	}
+	__atomic_store_n(&s->seq, s->seq + 1, __ATOMIC_RELEASE);
+    }
+}
+
+/* gives back the slots of clients that have exited without doing so */
+static void reap_slots(void)
+{
+    int i, pid;
+
+    rtapi_mutex_get(&(watch->mutex));
+    for (i = 0; i < HALWATCH_SLOTS; i++) {
+	pid = watch->slot[i].owner;
+	if (pid != 0 && kill(pid, 0) < 0 && errno == ESRCH) {
+	    __atomic_store_n(&watch->slot[i].owner, 0, __ATOMIC_RELEASE);
+	}
+    }
+    rtapi_mutex_give(&(watch->mutex));
+}
+
+static void exit_from_hal(void)
+{
+    if (watch != NULL) {
+	__atomic_store_n(&watch->magic, 0, __ATOMIC_RELEASE);
+	watch = NULL;
+    }
+    if (shm_id >= 0) {
+	rtapi_shmem_delete(shm_id, comp_id);
+	shm_id = -1;
+    }
+    if (comp_id >= 0) {
+	hal_exit(comp_id);
+	comp_id = -1;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    struct timespec next, now;
+    long period_ns;
+    int rate = HALWATCH_RATE_DEFAULT, n = 0;
+    void *ptr;
+
+    if (argc > 2 || (argc == 2 && (rate = atoi(argv[1])) <= 0)) {
+	fprintf(stderr, "Usage: halwatch [rate]\n");
+	return 1;
+    }
+    if (rate > 10000) {
+	rate = 10000;
+    }
+    comp_id = hal_init("halwatch");
+    if (comp_id < 0) {
+	fprintf(stderr, "halwatch: ERROR: hal_init() failed\n");
+	return 1;
+    }
+    shm_id = rtapi_shmem_new(HALWATCH_SHM_KEY, comp_id, sizeof(halwatch_shm_t));
+    if (shm_id < 0 || rtapi_shmem_getptr(shm_id, &ptr) < 0) {
+	fprintf(stderr, "halwatch: ERROR: failed to get shared memory\n");
+	exit_from_hal();
+	return 1;
+    }
+    watch = ptr;
+    memset(watch, 0, sizeof(*watch));
+    watch->pid = getpid();
+    watch->rate = rate;
+    __atomic_store_n(&watch->magic, HALWATCH_MAGIC, __ATOMIC_RELEASE);
+    signal(SIGINT, quit);
+    signal(SIGTERM, quit);
+    hal_ready(comp_id);
+
+    period_ns = 1000000000L / rate;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while (!done) {
+	next.tv_nsec += period_ns;
+	while (next.tv_nsec >= 1000000000L) {
+	    next.tv_nsec -= 1000000000L;
+	    next.tv_sec++;
+	}
+	clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+	sample();
+	/* after a stall, carry on from now rather than catch up */
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	if ((now.tv_sec - next.tv_sec) * 1000000000L
+		+ (now.tv_nsec - next.tv_nsec) > period_ns) {
+	    next = now;
+	}
+	if (++n >= rate) {
+	    reap_slots();
+	    n = 0;
+	}
+    }
+    exit_from_hal();
+    return 0;
+}
@@ -0,0 +1,107 @@
+#ifndef HALWATCH_H
+#define HALWATCH_H
+/** This file, 'halwatch.h', declares the shared memory of the halwatch
+    service and the calls its clients use.  One halwatch process
+    samples the pins, signals and parameters that any number of
+    programs (halmeter, halcmd 'watch', and so halshow) have asked for,
+    so that they read the values from its table instead of each
+    looking the items up and taking the HAL mutex to read them.
+
+    A client takes a slot for a name.  The service looks the name up,
+    again only when the HAL has changed, and at each sample writes the
+    value along with the least and greatest value since the client last
+    read the slot.  A slot belongs to the process that took it, and the
+    service gives back the slots of processes that have gone.
+*/
+
+/** This program is free software; you can redistribute it and/or
+    modify it under the terms of version 2 of the GNU General
+    Public License as published by the Free Software Foundation.
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111 USA
+*/
+
+#include "hal.h"
+#include "../hal_priv.h"
+
+#define HALWATCH_SHM_KEY 0x48574154	/* "HWAT" */
+#define HALWATCH_MAGIC 0x48574131
+#define HALWATCH_SLOTS 256
+#define HALWATCH_RATE_DEFAULT 100	/* samples per second */
+
+/* what a slot watches: a name is looked up as a pin, signal and then
+   parameter unless the client says which */
+#define HALWATCH_ANY 0
+#define HALWATCH_PIN 1
+#define HALWATCH_SIG 2
+#define HALWATCH_PARAM 3
+
+/* The letters say who writes each field: "C" the client that owns the
+   slot, "S" the service. */
+typedef struct {
+    int owner;			/* C pid of the client, 0 if the slot is free */
+    int kind;			/* C HALWATCH_ANY .. HALWATCH_PARAM */
+    unsigned int gen;		/* C changed each time the slot is taken */
+    char name[HAL_NAME_LEN + 1];	/* C */
+    unsigned int reset;		/* C changed to restart min and max */
+    unsigned int seq;		/* S odd while the sample is being written */
+    unsigned int sample_gen;	/* S the 'gen' the sample is for */
+    int type;			/* S HAL type; 0 not looked up, -1 not found */
+    unsigned int reset_done;	/* S the 'reset' min and max restarted at */
+    unsigned int samples;	/* S samples since min and max restarted */
+    hal_data_u value;		/* S */
+    hal_data_u min;		/* S for a bit, whether it was ever FALSE */
+    hal_data_u max;		/* S for a bit, whether it was ever TRUE */
+} halwatch_slot_t;
+
+typedef struct {
+    int magic;			/* HALWATCH_MAGIC while the service runs */
+    int pid;			/* of the service */
+    int rate;			/* samples per second */
+    rtapi_mutex_t mutex;	/* held by clients taking and giving slots */
+    halwatch_slot_t slot[HALWATCH_SLOTS];
+} halwatch_shm_t;
+
+/* a consistent copy of a slot, from halwatch_read() */
+typedef struct {
+    int type;
+    unsigned int samples;
+    hal_data_u value;
+    hal_data_u min;
+    hal_data_u max;
+} halwatch_sample_t;
+
+/** 'halwatch_attach()' maps the table if the halwatch service is
+    running, as a client that is HAL component 'comp_id'.  Returns 0,
+    or -1 if there is no service, in which case the client reads the
+    HAL itself as before.  It is cheap to call again once attached.
+*/
+extern int halwatch_attach(int comp_id);
+extern void halwatch_detach(void);
+
+/** 'halwatch_take()' returns the slot of this process for 'name' and
+    'kind', taking a free one if it has none, or -1 if not attached or
+    all the slots are in use.
+*/
+extern int halwatch_take(const char *name, int kind);
+
+/** 'halwatch_give()' gives a slot back, and 'halwatch_give_all()'
+    all of the slots of this process.
+*/
+extern void halwatch_give(int slot);
+extern void halwatch_give_all(void);
+
+/** 'halwatch_read()' copies the last sample of a slot and restarts its
+    min and max.  Returns 0, -EAGAIN if the service hasn't sampled it
+    yet or has stopped, so the caller reads the item itself this time,
+    or -ENOENT if there is no such item.
+*/
+extern int halwatch_read(int slot, halwatch_sample_t *sample);
+
+#endif /* HALWATCH_H */
@@ -0,0 +1,176 @@
+/** This file, 'halwatch_client.c', is the client side of the halwatch
+    service, linked into the programs that read values from it.  See
+    'halwatch.h'.
+*/
+
+/** This program is free software; you can redistribute it and/or
+    modify it under the terms of version 2 of the GNU General
+    Public License as published by the Free Software Foundation.
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111 USA
+*/
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "rtapi.h"
+#include <rtapi_mutex.h>
+#include "hal.h"
+#include "../hal_priv.h"
+#include "halwatch.h"
+
+static halwatch_shm_t *watch;
+static int watch_shm_id = -1, watch_comp_id;
+
+int halwatch_attach(int comp_id)
+{
+    hal_comp_t *comp;
+    void *ptr;
+    int running, shm_id;
+
+    if (watch != NULL) {
+	return 0;
+    }
+    if (hal_data == NULL) {
+	return -1;
+    }
+    rtapi_mutex_get(&(hal_data->mutex));
+    comp = halpr_find_comp_by_name("halwatch");
+    running = comp != NULL && comp->ready > 0;
+    rtapi_mutex_give(&(hal_data->mutex));
+    if (!running) {
+	return -1;
+    }
+    shm_id = rtapi_shmem_new(HALWATCH_SHM_KEY, comp_id, sizeof(halwatch_shm_t));
+    if (shm_id < 0) {
+	return -1;
+    }
+    if (rtapi_shmem_getptr(shm_id, &ptr) < 0
+	    || ((halwatch_shm_t *) ptr)->magic != HALWATCH_MAGIC) {
+	rtapi_shmem_delete(shm_id, comp_id);
+	return -1;
+    }
+    watch = ptr;
+    watch_shm_id = shm_id;
+    watch_comp_id = comp_id;
+    return 0;
+}
+
+void halwatch_detach(void)
+{
+    if (watch == NULL) {
+	return;
+    }
+    halwatch_give_all();
+    rtapi_shmem_delete(watch_shm_id, watch_comp_id);
+    watch = NULL;
+    watch_shm_id = -1;
+}
+
+int halwatch_take(const char *name, int kind)
+{
+    halwatch_slot_t *s;
+    int i, pid = getpid(), found = -1;
+
+    if (watch == NULL || strlen(name) > HAL_NAME_LEN) {
+	return -1;
+    }
+    rtapi_mutex_get(&(watch->mutex));
+    for (i = 0; i < HALWATCH_SLOTS; i++) {
+	s = &watch->slot[i];
+	if (s->owner == pid && s->kind == kind && strcmp(s->name, name) == 0) {
+	    rtapi_mutex_give(&(watch->mutex));
+	    return i;
+	}
+	if (found < 0 && s->owner == 0) {
+	    found = i;
+	}
+    }
+    if (found >= 0) {
+	s = &watch->slot[found];
+	strcpy(s->name, name);
+	s->kind = kind;
+	s->type = 0;
+	s->samples = 0;
+	s->gen++;
+	/* the service only looks at a slot once it has an owner */
+	__atomic_store_n(&s->owner, pid, __ATOMIC_RELEASE);
+    }
+    rtapi_mutex_give(&(watch->mutex));
+    return found;
+}
+
+void halwatch_give(int slot)
+{
+    if (watch == NULL || slot < 0 || slot >= HALWATCH_SLOTS
+	    || watch->slot[slot].owner != getpid()) {
+	return;
+    }
+    rtapi_mutex_get(&(watch->mutex));
+    __atomic_store_n(&watch->slot[slot].owner, 0, __ATOMIC_RELEASE);
+    rtapi_mutex_give(&(watch->mutex));
+}
+
+void halwatch_give_all(void)
+{
+    int i, pid = getpid();
+
+    if (watch == NULL) {
+	return;
+    }
+    rtapi_mutex_get(&(watch->mutex));
+    for (i = 0; i < HALWATCH_SLOTS; i++) {
+	if (watch->slot[i].owner == pid) {
+	    __atomic_store_n(&watch->slot[i].owner, 0, __ATOMIC_RELEASE);
+	}
+    }
+    rtapi_mutex_give(&(watch->mutex));
+}
+
+int halwatch_read(int slot, halwatch_sample_t *sample)
+{
+    halwatch_slot_t *s;
+    unsigned int seq, gen;
+    int tries = 0;
+
+    if (watch == NULL || slot < 0 || slot >= HALWATCH_SLOTS) {
+	return -ENOENT;
+    }
+    if (__atomic_load_n(&watch->magic, __ATOMIC_ACQUIRE) != HALWATCH_MAGIC) {
+	/* the service has stopped */
+	return -EAGAIN;
+    }
+    s = &watch->slot[slot];
+    do {
+	/* the service writes a sample in well under a microsecond, so
+	   one that stays odd is a service that died writing it */
+	while ((seq = __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE)) & 1) {
+	    if (++tries > 1000) {
+		return -EAGAIN;
+	    }
+	}
+	gen = s->sample_gen;
+	sample->type = s->type;
+	sample->samples = s->samples;
+	sample->value = s->value;
+	sample->min = s->min;
+	sample->max = s->max;
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while (__atomic_load_n(&s->seq, __ATOMIC_RELAXED) != seq);
+    if (gen != s->gen || sample->type == 0
+	    || (sample->type > 0 && sample->samples == 0)) {
+	return -EAGAIN;
+    }
+    if (sample->type < 0) {
+	return -ENOENT;
+    }
+    __atomic_store_n(&s->reset, s->reset + 1, __ATOMIC_RELEASE);
+    return 0;
+}
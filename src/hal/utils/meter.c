@@ -60,6 +60,7 @@
 #include "rtapi.h"		/* RTAPI realtime OS API */
 #include "hal.h"		/* HAL public API decls */
 #include "../hal_priv.h"	/* private HAL decls */
+#include "halwatch.h"		/* halwatch service client */
 #include <rtapi_mutex.h>
 
 #include <gtk/gtk.h>
@@ -81,6 +82,8 @@ typedef struct {
     hal_pin_t *pin;		/* metadata (if it's a pin) */
     hal_sig_t *sig;		/* metadata (if it's a signal) */
     hal_param_t *param;		/* metadata (if it's a parameter) */
+    int watch;			/* halwatch slot, -1 if none */
+    char watch_name[HAL_NAME_LEN + 1];	/* name the slot watches */
     GtkWidget *window;		/* selection dialog window */
     GtkWidget *notebook;	/* pointer to the notebook */
     GtkWidget *lists[3];	/* lists for pins, sigs, and params */
@@ -373,6 +376,7 @@ probe_t *probe_new(char *probe_name)
     /* init the fields */
     new->pickname = NULL;
     new->listnum = -1;
+    new->watch = -1;
     new->pin = NULL;
     new->sig = NULL;
     new->param = NULL;
@@ -505,6 +509,7 @@ static void quit(int sig)
 
 static void exit_from_hal(void)
 {
+    halwatch_detach();
     hal_exit(comp_id);
 }
 
@@ -515,6 +520,7 @@ static int refresh_value(gpointer data)
     probe_t *probe;
     char *value_str, *name_str;
     hal_sig_t *sig;
+    halwatch_sample_t sample;
     static int first = 1;
 
     meter = (meter_t *) data;
@@ -527,6 +533,16 @@ static int refresh_value(gpointer data)
 	}
     }
 
+    /* the halwatch service has the value without taking the mutex; if
+       it hasn't, or the item is gone, read it as before */
+    if (probe->watch >= 0 && halwatch_read(probe->watch, &sample) == 0) {
+	gtk_label_set_text(GTK_LABEL(meter->value_label),
+	    data_value(sample.type, &sample.value));
+	if (!small) {
+	    gtk_label_set_text(GTK_LABEL(meter->name_label), probe->watch_name);
+	}
+	return 1;
+    }
     rtapi_mutex_get(&(hal_data->mutex));
     if (probe->pin != NULL) {
 	if (probe->pin->name[0] == '\0') {
@@ -712,6 +728,8 @@ static void apply_selection(GtkWidget * widget, gpointer data)
     probe->pin = NULL;
     probe->sig = NULL;
     probe->param = NULL;
+    halwatch_give(probe->watch);
+    probe->watch = -1;
     if (probe->pickname == NULL) {
 	/* not a valid selection */
 	/* should pop up a message or something here, instead we ignore it */
@@ -729,6 +747,13 @@ static void apply_selection(GtkWidget * widget, gpointer data)
     }
     /* at this point, the probe structure contain a pointer to the item we
        wish to display, or all three are NULL if the item doesn't exist */
+    if ((probe->pin || probe->sig || probe->param)
+	    && halwatch_attach(comp_id) == 0) {
+	/* HALWATCH_PIN, _SIG and _PARAM follow the order of the lists */
+	snprintf(probe->watch_name, sizeof(probe->watch_name), "%s",
+	    probe->pickname);
+	probe->watch = halwatch_take(probe->watch_name, probe->listnum + 1);
+    }
 }
 
 static void close_selection(GtkWidget * widget, gpointer data)
@@ -98,6 +98,10 @@ static void rm_stop_button_clicked(GtkWidget * widget, gpointer * gdata);
 ************************************************************************/
 static void *shm_base;
 
+/* the part of the record that is in the display buffer, so that roll
+   mode copies only what is new; copied_start is -1 if none */
+static int copied_start = -1, copied_samples;
+
 
 int main(int argc, gchar * argv[])
 {
@@ -105,6 +109,7 @@ int main(int argc, gchar * argv[])
     int num_samples = SCOPE_NUM_SAMPLES_DEFAULT;
     char *ifilename = "autosave.halscope";
     char *ofilename = "autosave.halscope";
+    char *cfilename = NULL;
 
     bindtextdomain("linuxcnc", EMC2_PO_DIR);
     setlocale(LC_MESSAGES,"");
@@ -118,13 +123,13 @@ int main(int argc, gchar * argv[])
 
     while(1) {
         int c;
-        c = getopt(argc, argv, "hi:o:");
+        c = getopt(argc, argv, "hi:o:c:");
         if(c == -1) break;
         switch(c) {
          case 'h':
             rtapi_print_msg(RTAPI_MSG_ERR,
             _("Usage:\n  halscope [-h] [-i infile] [-o outfile]"
-            " [num_samples]\n"));
+            " [-c capturefile] [num_samples]\n"));
             return -1;
             break;
          case 'i':
@@ -133,6 +138,9 @@ int main(int argc, gchar * argv[])
          case 'o':
             ofilename = optarg;
             break;
+         case 'c':
+            cfilename = optarg;
+            break;
         }
     }
     if(argc > optind) num_samples = atoi(argv[argc-1]);
@@ -210,10 +218,16 @@ int main(int argc, gchar * argv[])
     gtk_widget_show(ctrl_usr->main_win);
     /* read the saved config file */
     read_config_file(ifilename);
+    if (cfilename != NULL) {
+	/* capture to a file instead of sweeping, heartbeat() starts it */
+	ctrl_usr->capture.filename = cfilename;
+	set_run_mode(0);
+    }
     /* arrange for periodic call of heartbeat() */
     gtk_timeout_add(100, heartbeat, NULL);
     /* enter the main loop */
     gtk_main();
+    stop_file_capture();
     write_config_file(ofilename);
 
     return (0);
@@ -242,6 +256,17 @@ static int heartbeat(gpointer data)
             start_capture();
         }
     }
+    if (ctrl_usr->capture.active) {
+	drain_file_capture();
+	if (ctrl_shm->state != INIT && ctrl_shm->state != STREAM) {
+	    /* stopped, or a setting was changed */
+	    stop_file_capture();
+	}
+    } else if (ctrl_usr->capture.filename && ctrl_shm->state == IDLE
+	    && !ctrl_usr->pending_restart && ctrl_shm->watchdog < 10) {
+	/* the sample function is running, start the capture */
+	start_file_capture();
+    }
     if (ctrl_usr->display_refresh_timer > 0) {
 	/* decrement timer, did it time out? */
 	if (--ctrl_usr->display_refresh_timer == 0) {
@@ -269,6 +294,7 @@ void start_capture(void)
 	/* already running! */
 	return;
     }
+    copied_start = -1;
     for (n = 0; n < 16; n++) {
 	/* point to user space channel data */
 	chan = &(ctrl_usr->chan[n]);
@@ -331,8 +357,9 @@ void start_capture(void)
     ctrl_shm->state = INIT;
 }
 
-void capture_copy_data(void) {
-    int n, offs;
+/* returns the number of samples copied */
+int capture_copy_data(void) {
+    int n, offs, start, samples;
     scope_data_t *src, *dst, *src_end;
     int samp_len, samp_size;
 
@@ -348,15 +375,29 @@ void capture_copy_data(void) {
 	}
     }
     /* copy data from shared buffer to display buffer */
-    ctrl_usr->samples = ctrl_shm->samples;
+    start = ctrl_shm->start;
+    samples = ctrl_shm->samples;
     samp_len = ctrl_shm->sample_len;
     samp_size = samp_len * sizeof(scope_data_t);
-    dst = ctrl_usr->disp_buf;
-    memset(dst, 0, sizeof(scope_data_t) * ctrl_shm->buf_len);
-    src = ctrl_usr->buffer + ctrl_shm->start;
     src_end = ctrl_usr->buffer + (ctrl_shm->rec_len * samp_len);
-    n = 0;
-    while (n < ctrl_usr->samples) {
+    if (start == copied_start && samples >= copied_samples) {
+	/* the record has only grown since the last copy (pre- or
+	   post-trigger), the samples already copied are still valid */
+	n = copied_samples;
+    } else {
+	memset(ctrl_usr->disp_buf, 0, sizeof(scope_data_t) * ctrl_shm->buf_len);
+	n = 0;
+    }
+    copied_start = start;
+    copied_samples = samples;
+    ctrl_usr->samples = samples;
+    dst = ctrl_usr->disp_buf + n * samp_len;
+    src = ctrl_usr->buffer + start + n * samp_len;
+    while (src >= src_end) {
+	src -= src_end - ctrl_usr->buffer;
+    }
+    offs = n;
+    while (n < samples) {
 	/* copy one sample */
 	memcpy(dst, src, samp_size);
 	n++;
@@ -366,12 +407,15 @@ void capture_copy_data(void) {
 	    src = ctrl_usr->buffer;
 	}
     }
+    return samples - offs;
 }
 
 void capture_cont()
 {
-    capture_copy_data();
-    refresh_display();
+    /* redraw only if there is something new to show */
+    if (capture_copy_data() > 0) {
+	refresh_display();
+    }
 }
 
 void capture_complete(void)
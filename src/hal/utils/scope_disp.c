@@ -765,6 +765,56 @@ void draw_baseline(int chan_num, int highlight) {
     line(chan_num | 0x100, 0, y1, disp->width, y1);
 }
 
+/* When there are more samples than pixels, each column of pixels is
+   drawn as its first, least, greatest and last point, in the order the
+   samples came.  The trace looks the same as one drawn through every
+   sample, but has no more than four points a column. */
+struct column {
+    int x, first, last, lo, hi, lo_n, hi_n;
+};
+
+static void add_point(GdkPoint *points, int *pn, int x, int y)
+{
+    if (*pn == 0 || points[*pn - 1].x != x || points[*pn - 1].y != y) {
+	points[*pn].x = x;
+	points[*pn].y = y;
+	(*pn)++;
+    }
+}
+
+static void column_start(struct column *col, int x, int y, int n)
+{
+    col->x = x;
+    col->first = col->last = col->lo = col->hi = y;
+    col->lo_n = col->hi_n = n;
+}
+
+static void column_add(struct column *col, int y, int n)
+{
+    if (y < col->lo) {
+	col->lo = y;
+	col->lo_n = n;
+    }
+    if (y > col->hi) {
+	col->hi = y;
+	col->hi_n = n;
+    }
+    col->last = y;
+}
+
+static void column_end(struct column *col, GdkPoint *points, int *pn)
+{
+    add_point(points, pn, col->x, col->first);
+    if (col->lo_n < col->hi_n) {
+	add_point(points, pn, col->x, col->lo);
+	add_point(points, pn, col->x, col->hi);
+    } else {
+	add_point(points, pn, col->x, col->hi);
+	add_point(points, pn, col->x, col->lo);
+    }
+    add_point(points, pn, col->x, col->last);
+}
+
 /* waveform styles: if neither is defined, an intermediate style is used */
 // #define DRAW_STEPPED
 // #define DRAW_SMOOTH
@@ -780,6 +830,8 @@ void draw_waveform(int chan_num, int highlight)
     hal_type_t type;
     int x1, y1, x2, y2, miny, maxy, midx, ct, pn;
     int first=1;
+    struct column col;
+    int col_open = 0;
     scope_horiz_t *horiz = &(ctrl_usr->horiz);
 
     cursor_valid = 0;
@@ -801,7 +853,11 @@ void draw_waveform(int chan_num, int highlight)
     start = disp->start_sample;
     end = disp->end_sample;
     ct = end - start + 1;
-    GdkPoint points[2*ct];
+    if (xscale < 1) {
+	/* four points a column, see column_end() */
+	ct = 2 * ((int) (ct * xscale) + 3);
+    }
+    GdkPoint points[2*ct+1];
     pn = 0;
     n = start;
     dptr += n * sample_len;
@@ -856,8 +912,15 @@ void draw_waveform(int chan_num, int highlight)
                 points[pn].x = x1; points[pn].y = y1; pn++;
             }
             if(xscale < 1) {
-                if(points[pn-1].x != x2 || points[pn-1].y != y2) {
-                    points[pn].x = x2; points[pn].y = y2; pn++;
+                if(!col_open) {
+                    column_start(&col, x1, y1, n - 1);
+                    col_open = 1;
+                }
+                if(x2 != col.x) {
+                    column_end(&col, points, &pn);
+                    column_start(&col, x2, y2, n);
+                } else {
+                    column_add(&col, y2, n);
                 }
             } else {
 #if defined(DRAW_SMOOTH)
@@ -895,6 +958,9 @@ void draw_waveform(int chan_num, int highlight)
 	n++;
         prev_fy = fy;
     }
+    if(col_open) {
+        column_end(&col, points, &pn);
+    }
     if(pn) {
         lines(chan_num, points, pn);
         if(DRAWING) {
@@ -33,6 +33,8 @@
 */
 
 #include <sys/types.h>
+#include <sys/mman.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -345,6 +347,169 @@ void write_sample(FILE *fp, char *label, scope_data_t *dptr, hal_type_t type)
 }
 
 
+/* The capture file is written through a window of this size, mapped
+   at successive offsets as it fills.  It must be a multiple of the
+   page size. */
+#define CAPTURE_MAP_SIZE (16 * 1024 * 1024)
+
+static int capture_write(const char *src, size_t len)
+{
+    scope_capture_t *cap;
+    size_t n;
+
+    cap = &(ctrl_usr->capture);
+    while (len > 0) {
+	if (cap->map != NULL && cap->map_used == CAPTURE_MAP_SIZE) {
+	    /* window is full, move it along */
+	    munmap(cap->map, CAPTURE_MAP_SIZE);
+	    cap->map = NULL;
+	    cap->map_offset += CAPTURE_MAP_SIZE;
+	}
+	if (cap->map == NULL) {
+	    if (ftruncate(cap->fd, cap->map_offset + CAPTURE_MAP_SIZE) < 0) {
+		return -1;
+	    }
+	    cap->map = mmap(NULL, CAPTURE_MAP_SIZE, PROT_READ | PROT_WRITE,
+		MAP_SHARED, cap->fd, cap->map_offset);
+	    if (cap->map == MAP_FAILED) {
+		cap->map = NULL;
+		return -1;
+	    }
+	    cap->map_used = 0;
+	}
+	n = CAPTURE_MAP_SIZE - cap->map_used;
+	if (n > len) {
+	    n = len;
+	}
+	memcpy(cap->map + cap->map_used, src, n);
+	cap->map_used += n;
+	src += n;
+	len -= n;
+    }
+    return 0;
+}
+
+/* Starts a continuous capture of the enabled channels into the file
+   given with 'halscope -c'.  The realtime code fills the shared buffer
+   as a ring, and drain_file_capture() empties it into the file. */
+int start_file_capture(void)
+{
+    scope_capture_t *cap;
+
+    cap = &(ctrl_usr->capture);
+    if (cap->filename == NULL || cap->active || ctrl_shm->state != IDLE) {
+	return -1;
+    }
+    cap->fd = open(cap->filename, O_RDWR | O_CREAT | O_TRUNC, 0666);
+    if (cap->fd < 0) {
+	fprintf(stderr, "ERROR: capture file '%s' could not be created\n",
+	    cap->filename);
+	cap->filename = NULL;
+	return -1;
+    }
+    cap->map = NULL;
+    cap->map_offset = SCOPE_CAPTURE_DATA_OFFSET;
+    cap->map_used = 0;
+    cap->records = 0;
+    ctrl_shm->stream_in = 0;
+    ctrl_shm->stream_out = 0;
+    ctrl_shm->stream_overruns = 0;
+    ctrl_shm->stream = 1;
+    start_capture();
+    cap->active = 1;
+    fprintf(stderr, "Capturing to '%s'.\n", cap->filename);
+    return 0;
+}
+
+/* Copies the records captured since the last call to the file. */
+void drain_file_capture(void)
+{
+    scope_capture_t *cap;
+    unsigned int in, out, idx, n, num_records;
+    size_t record_size;
+
+    cap = &(ctrl_usr->capture);
+    if (!cap->active || ctrl_shm->state == INIT) {
+	return;
+    }
+    record_size = ctrl_shm->sample_len * sizeof(scope_data_t);
+    num_records = ctrl_shm->buf_len / ctrl_shm->sample_len;
+    in = __atomic_load_n(&ctrl_shm->stream_in, __ATOMIC_ACQUIRE);
+    out = ctrl_shm->stream_out;
+    while (out != in) {
+	/* copy up to the end of the ring at a time */
+	idx = out % num_records;
+	n = in - out;
+	if (n > num_records - idx) {
+	    n = num_records - idx;
+	}
+	if (capture_write((char *) (ctrl_usr->buffer +
+		    idx * ctrl_shm->sample_len), n * record_size) < 0) {
+	    fprintf(stderr, "ERROR: writing capture file '%s' failed\n",
+		cap->filename);
+	    ctrl_shm->state = RESET;
+	    break;
+	}
+	out += n;
+	cap->records += n;
+    }
+    __atomic_store_n(&ctrl_shm->stream_out, out, __ATOMIC_RELEASE);
+}
+
+/* Writes what is left in the ring, completes the header and closes
+   the file.  There is one capture per run of halscope. */
+void stop_file_capture(void)
+{
+    scope_capture_t *cap;
+    scope_capture_header_t hdr;
+    int n;
+
+    cap = &(ctrl_usr->capture);
+    if (!cap->active) {
+	return;
+    }
+    if (ctrl_shm->state == STREAM) {
+	/* RT code is still capturing, tell it to stop */
+	ctrl_shm->state = RESET;
+    }
+    drain_file_capture();
+    if (cap->map != NULL) {
+	munmap(cap->map, CAPTURE_MAP_SIZE);
+	cap->map = NULL;
+    }
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, SCOPE_CAPTURE_MAGIC, sizeof(hdr.magic));
+    for (n = 0; n < 16; n++) {
+	if (ctrl_shm->data_len[n] != 0) {
+	    snprintf(hdr.chan[hdr.channels].name,
+		sizeof(hdr.chan[0].name), "%s",
+		ctrl_usr->chan[n].name ? ctrl_usr->chan[n].name : "");
+	    hdr.chan[hdr.channels].type = ctrl_shm->data_type[n];
+	    hdr.channels++;
+	}
+    }
+    hdr.record_size = ctrl_shm->sample_len * sizeof(scope_data_t);
+    hdr.sample_period_ns =
+	(rtapi_u64) ctrl_usr->horiz.thread_period_ns * ctrl_shm->mult;
+    hdr.records = cap->records;
+    hdr.overruns = ctrl_shm->stream_overruns;
+    if (ftruncate(cap->fd, SCOPE_CAPTURE_DATA_OFFSET
+		+ cap->records * hdr.record_size) < 0
+	    || pwrite(cap->fd, &hdr, sizeof(hdr), 0) != sizeof(hdr)) {
+	fprintf(stderr, "ERROR: writing capture file '%s' failed\n",
+	    cap->filename);
+    } else {
+	fprintf(stderr, "Capture file '%s' written, %llu records, "
+	    "%llu lost.\n", cap->filename, cap->records,
+	    (unsigned long long) hdr.overruns);
+    }
+    close(cap->fd);
+    ctrl_shm->stream = 0;
+    cap->active = 0;
+    cap->filename = NULL;
+}
+
+
 /***********************************************************************
 *                         LOCAL FUNCTION CODE                          *
 ************************************************************************/
@@ -286,11 +286,12 @@ void refresh_state_info(void)
 	"TRIGGER?",
 	"TRIGGERED",
 	"DONE",
-	"RESET"
+	"RESET",
+	"CAPTURE"
     };
 
     horiz = &(ctrl_usr->horiz);
-    if (ctrl_shm->state > RESET) {
+    if (ctrl_shm->state > STREAM) {
 	ctrl_shm->state = IDLE;
     }
     gtk_label_set_text_if(horiz->state_label, state_names[ctrl_shm->state]);
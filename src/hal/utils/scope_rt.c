@@ -182,9 +182,29 @@ static void sample(void *arg, long period)
 	    ctrl_rt->data_type[n] = ctrl_shm->data_type[n];
 	    ctrl_rt->data_len[n] = ctrl_shm->data_len[n];
 	}
+	if (ctrl_shm->stream) {
+	    ctrl_shm->stream_in = 0;
+	    ctrl_shm->stream_overruns = 0;
+	    ctrl_shm->state = STREAM;
+	    break;
+	}
 	/* set next state */
 	ctrl_shm->state = PRE_TRIG;
 	break;
+    case STREAM:
+	/* is there room in the ring for another record? */
+	if (ctrl_shm->stream_in
+		- __atomic_load_n(&ctrl_shm->stream_out, __ATOMIC_ACQUIRE)
+		>= (unsigned int) (ctrl_shm->buf_len / ctrl_shm->sample_len)) {
+	    /* no, user code is behind, drop it */
+	    ctrl_shm->stream_overruns++;
+	    break;
+	}
+	capture_sample();
+	/* hand it to the user code */
+	__atomic_store_n(&ctrl_shm->stream_in, ctrl_shm->stream_in + 1,
+	    __ATOMIC_RELEASE);
+	break;
     case PRE_TRIG:
 	/* acquire a sample */
 	capture_sample();
@@ -284,6 +304,14 @@ static void capture_sample(void)
 
 // TODO: type-independent way to get high bit
 // #define SIGN_BIT (~(((ireal_t)~(ireal_t)0)>>1))
+static inline ireal_t float_key(ireal_t bits)
+{
+    ireal_t sign = bits >> 63;
+
+    /* all ones for a negative value, just the sign bit otherwise */
+    return bits ^ ((-sign) | 0x8000000000000000ull);
+}
+
 static int check_trigger(void)
 {
     static int compare_result = 0;
@@ -321,43 +349,12 @@ static int check_trigger(void)
 	compare_result = value->d_u8;
 	break;
     case HAL_FLOAT:
-	{
-	ireal_t tmp1, tmp2;
-	/* don't want to use the FPU in this function, so we use */
-	/* a hack - see http://en.wikipedia.org/wiki/IEEE_754 */
-	/* this _only_ works with IEEE-754 floating point numbers */
-	/* and will probably fail for infinities, NANs, etc. */
-	/* OK, here we go! */
-	/* get the value as an integer */
-	tmp1 = value->d_ireal;
-	/* get the trigger as an integer */
-	tmp2 = level->d_ireal;
-	/* is the value negative? (highest bit) */
-	if (tmp1 & 0x8000000000000000ull) {
-	    /* yes, is the trigger level negative? */
-	    if (tmp2 & 0x8000000000000000ull) {
-		/* yes, make both positive */
-		tmp1 ^= 0x8000000000000000ull;
-		tmp2 ^= 0x8000000000000000ull;
-		/* and compare them as unsigned ints */
-		/* because of negation, we reverse the compare */
-		compare_result = (tmp1 < tmp2);
-	    } else {
-		/* trigger level positive, value negative */
-		compare_result = 0;
-	    }
-	} else {
-	    /* value is positive, is trigger level negative? */
-	    if (tmp2 & 0x8000000000000000ull) {
-		/* trigger level negative, value positive */
-		compare_result = 1;
-	    } else {
-		/* both are positive */
-		/* compare them as unsigned ints */
-		compare_result = (tmp1 > tmp2);
-	    }
-	}
-	}
+	/* don't want to use the FPU in this function, so the compare is
+	   done on the bits of the IEEE-754 values: flipping the sign bit
+	   of a positive value, and all the bits of a negative one, gives
+	   integers that sort the way the values do.  NANs sort beyond the
+	   infinities. */
+	compare_result = (float_key(value->d_ireal) > float_key(level->d_ireal));
 	break;
     case HAL_S32:
 	compare_result = (value->d_s32 > level->d_s32);
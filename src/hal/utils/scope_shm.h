@@ -51,7 +51,8 @@ typedef enum {
     TRIG_WAIT,			/* waiting for trigger */
     POST_TRIG,			/* acquiring post-trigger data */
     DONE,			/* data acquisition complete */
-    RESET			/* data acquisition interrupted */
+    RESET,			/* data acquisition interrupted */
+    STREAM			/* continuous capture, see 'stream' */
 } scope_state_t;
 
 /* this struct holds a single value - one sample of one channel */
@@ -91,6 +92,15 @@ typedef struct {
     int data_offset[16];	/* U data addr in shmem for each channel */
     hal_type_t data_type[16];	/* U data type for each channel */
     char data_len[16];		/* U data size, 0 if not to be acquired */
+    /* In continuous capture the buffer is a ring of records of
+       'sample_len' values, that the user code drains while the
+       realtime code fills it.  Records are counted, not indexed;
+       record N is at (N % (buf_len / sample_len)) * sample_len.  When
+       the ring is full, new records are dropped and counted. */
+    int stream;			/* U INIT starts STREAM instead of PRE_TRIG */
+    unsigned int stream_in;	/* R records captured */
+    unsigned int stream_out;	/* U records drained */
+    unsigned int stream_overruns;	/* R records dropped */
 } scope_shm_control_t;
 
 #endif /* HALSC_SHM_H */
@@ -194,6 +194,41 @@ typedef struct {
 	GtkWidget *log_prefs_label;
 } scope_log_t;
 
+/* this struct holds data relating to continuous capture to a file */
+
+typedef struct {
+	char *filename;		/* file to capture to, NULL if none */
+	int active;		/* nonzero while capturing */
+	int fd;			/* the open file */
+	char *map;		/* part of the file mapped for writing */
+	long long map_offset;	/* offset of that part in the file */
+	size_t map_used;	/* bytes of it written so far */
+	unsigned long long records;	/* records written so far */
+} scope_capture_t;
+
+/* A capture file starts with this header, padded to
+   SCOPE_CAPTURE_DATA_OFFSET bytes.  The records follow, 'record_size'
+   bytes each.  A record starts with one scope_data_t for each channel
+   in the header, in that order; a bit is in the first byte of its
+   scope_data_t.  'records' and 'overruns' are filled in when the
+   capture stops. */
+
+#define SCOPE_CAPTURE_MAGIC "HALSCAP1"
+#define SCOPE_CAPTURE_DATA_OFFSET 65536	/* a multiple of any page size */
+
+typedef struct {
+	char magic[8];		/* SCOPE_CAPTURE_MAGIC */
+	rtapi_u32 channels;	/* channels in each record */
+	rtapi_u32 record_size;	/* bytes in each record */
+	rtapi_u64 sample_period_ns;	/* time between records */
+	rtapi_u64 records;	/* records in the file */
+	rtapi_u64 overruns;	/* records lost because the ring was full */
+	struct {
+		char name[HAL_NAME_LEN + 1];	/* pin, signal or param */
+		rtapi_u32 type;	/* hal_type_t */
+	} chan[16];
+} scope_capture_header_t;
+
 /* this is the master user space control structure */
 
 typedef enum { STOP = 0, NORMAL, SINGLE, ROLL } scope_run_mode_t;
@@ -230,6 +265,7 @@ typedef struct {
     scope_trig_t trig;		/* triggering data */
     scope_disp_t disp;		/* display data */
 	scope_log_t log;  		/* logging preferences */
+    scope_capture_t capture;	/* continuous capture */
 } scope_usr_control_t;
 
 /***********************************************************************
@@ -270,6 +306,9 @@ void write_vert_config(FILE *fp);
 void write_trig_config(FILE *fp);
 void write_log_file (char *filename);
 void write_sample(FILE *fp, char *label, scope_data_t *dptr, hal_type_t type);
+int start_file_capture(void);
+void drain_file_capture(void);
+void stop_file_capture(void);
 
 /* the following functions set various parameters, they are normally
    called by the GUI, but can also be called by code reading a file
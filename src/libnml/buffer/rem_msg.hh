@@ -49,9 +49,20 @@ enum REMOTE_CMS_REQUEST_TYPE {
     REMOTE_CMS_GET_MSG_COUNT_REQUEST_TYPE,
     REMOTE_CMS_GET_QUEUE_LENGTH_REQUEST_TYPE,
     REMOTE_CMS_GET_SPACE_AVAILABLE_REQUEST_TYPE,
+    REMOTE_CMS_SET_DELTA_REQUEST_TYPE,
 
 };
 
+/* Once a TCP client has turned on delta mode for a buffer, the data of
+   every read reply for that buffer is
+	total size (4 bytes)
+	followed by any number of (offset, length, bytes) records,
+   all big endian, which patch the message the client received last.
+   A reply the client has no base for is one record covering the whole
+   message, so the payload is never more than REMOTE_CMS_DELTA_OVERHEAD
+   bytes longer than the message itself. */
+#define REMOTE_CMS_DELTA_OVERHEAD 12
+
 struct REMOTE_CMS_REQUEST:public REMOTE_CMS_MESSAGE {
     REMOTE_CMS_REQUEST(REMOTE_CMS_REQUEST_TYPE _type) {
 	type = (int) _type;
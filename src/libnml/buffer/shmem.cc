@@ -27,6 +27,11 @@ extern "C" {
 #include <errno.h>		// errno
 #include <string.h>		/* strchr(), memcpy(), memset() */
 #include <stdlib.h>		/* strtod */
+#include <limits.h>		/* INT_MAX */
+#include <time.h>		/* struct timespec */
+#include <unistd.h>		/* syscall() */
+#include <sys/syscall.h>	/* SYS_futex */
+#include <linux/futex.h>	/* FUTEX_WAIT, FUTEX_WAKE */
 #include <physmem.hh>           /* PHYSMEM_HANDLE */
 
 #ifdef __cplusplus
@@ -39,6 +44,7 @@ extern "C" {
 //#include "sem.hh"             /* class RCS_SEMAPHORE */
 #include "memsem.hh"		/* mem_get_access(), mem_release_access() */
 #include "timer.hh"		/* etime(), esleep() */
+#include "cmsstats.hh"		/* struct CMS_STATS_AREA */
 /* Common Definitions. */
 //#include "autokey.h"
 /* rw-rw-r-- permissions */
@@ -60,6 +66,28 @@ static int not_zero(volatile double x)
     return 0;
 }
 
+/* The ring kept in place of the queue when 'ring=n' is configured.  The
+   positions only ever grow; position p uses slot p % n.  Each slot has
+   a sequence telling whose turn it is, stored less the slot index so
+   that the zeroed memory of a new or cleared buffer is an empty ring:
+   the slot is free for position p when it holds p - i and holds the
+   message for p when it holds p + 1 - i.  Writers and readers each
+   claim a position with a compare and swap, so neither ever waits for
+   the other or takes the buffer mutex. */
+struct SHMEM_RING {
+    volatile unsigned long enqueue_pos;
+    char pad0[64 - sizeof(unsigned long)];
+    volatile unsigned long dequeue_pos;
+    char pad1[64 - sizeof(unsigned long)];
+    volatile unsigned long write_id;
+    char pad2[64 - sizeof(unsigned long)];
+};
+
+struct SHMEM_RING_SLOT {
+    volatile unsigned long sequence;
+    CMS_HEADER header;
+};
+
 /* SHMEM Member Functions. */
 
 /* Constructor for hard coded tests. */
@@ -68,6 +96,15 @@ SHMEM::SHMEM(const char *n, long s, int nt, key_t k, int m):CMS(s)
     /* Set pointers to null so only properly opened pointers are closed. */
     shm = NULL;
 //  sem = NULL;
+    write_sequence = NULL;
+    in_place_id = 0;
+    notify = 0;
+    write_count = NULL;
+    write_waiters = NULL;
+    ring_slots = 0;
+    ring = NULL;
+    ring_slot_size = 0;
+    keep_stats = 0;
 
     /* save constructor args */
     master = m;
@@ -91,6 +128,15 @@ SHMEM::SHMEM(const char *bufline, const char *procline, int set_to_server,
     mutex_type = OS_SEM_MUTEX;
     bsem_key = -1;
     second_read = 0;
+    write_sequence = NULL;
+    in_place_id = 0;
+    notify = 0;
+    write_count = NULL;
+    write_waiters = NULL;
+    ring_slots = 0;
+    ring = NULL;
+    ring_slot_size = 0;
+    keep_stats = 0;
 
     if (status < 0) {
 	rcs_print_error("SHMEM: status = %d\n", status);
@@ -156,6 +202,38 @@ SHMEM::SHMEM(const char *bufline, const char *procline, int set_to_server,
 	use_os_sem_only = 0;
     }
 
+    if (NULL != strstr(buflineupper, "ZEROCOPY")) {
+	if (neutral || queuing_enabled || split_buffer
+	    || total_subdivisions > 1 || enable_diagnostics
+	    || mutex_type == NO_MUTEX) {
+	    rcs_print_error
+		("SHMEM: %s can not use zerocopy; it needs a raw (neut=0) buffer with a mutex and without queue, split, subdivisions or diag.\n",
+		BufferName);
+	} else {
+	    zero_copy = 1;
+	}
+    }
+
+    if (NULL != strstr(buflineupper, "NOTIFY")) {
+	notify = 1;
+    }
+
+    if (NULL != strstr(buflineupper, "STATS")) {
+	keep_stats = 1;
+    }
+
+    char *ring_string;
+    if (NULL != (ring_string = strstr(buflineupper, "RING="))) {
+	if (!queuing_enabled || split_buffer || total_subdivisions > 1
+	    || enable_diagnostics) {
+	    rcs_print_error
+		("SHMEM: %s can not use ring; it needs a queue buffer without split, subdivisions or diag.\n",
+		BufferName);
+	} else {
+	    ring_slots = strtol(ring_string + 5, (char **) NULL, 0);
+	}
+    }
+
     /* Open the shared memory buffer and create mutual exclusion semaphore. */
     open();
 }
@@ -184,9 +262,22 @@ int SHMEM::open()
 	autokey_table_size = sizeof(AUTOKEY_TABLE_ENTRY) * total_connections;
     }
 #endif
+    /* With zerocopy, notify or stats a few words are kept just past the
+       configured size, so the layout of the rest of the buffer does not
+       change: the write sequence for peek_in_place(), then the write
+       count and waiter count for wait_for_write(), then the stats. */
+    long shm_size = size;
+    long extra_offset = (size + 7) & ~7L;
+    if (zero_copy || notify || keep_stats) {
+	shm_size = extra_offset + 16;
+    }
+    if (keep_stats) {
+	shm_size += sizeof(CMS_STATS_AREA);
+    }
+
     /* set up the shared memory address and semaphore, in given state */
     if (master) {
-	shm = new RCS_SHAREDMEM(key, size, RCS_SHAREDMEM_CREATE, (int) MODE);
+	shm = new RCS_SHAREDMEM(key, shm_size, RCS_SHAREDMEM_CREATE, (int) MODE);
 	if (shm->addr == NULL) {
 	    switch (shm->create_errno) {
 	    case EACCES:
@@ -242,7 +333,7 @@ int SHMEM::open()
 	}
 	in_buffer_id = 0;
     } else {
-	shm = new RCS_SHAREDMEM(key, size, RCS_SHAREDMEM_NOCREATE);
+	shm = new RCS_SHAREDMEM(key, shm_size, RCS_SHAREDMEM_NOCREATE);
 	if (NULL == shm) {
 	    rcs_print_error
 		("CMS: couldn't create RCS_SHAREDMEM(%d(0x%X), %ld(0x%lX), RCS_SHAREDMEM_NOCREATE).\n",
@@ -307,6 +398,20 @@ int SHMEM::open()
 	}
     }
 
+    if (zero_copy) {
+	write_sequence = (volatile unsigned long *)
+	    ((char *) shm->addr + extra_offset);
+    }
+    if (notify) {
+	write_count = (volatile unsigned int *)
+	    ((char *) shm->addr + extra_offset + 8);
+	write_waiters = write_count + 1;
+    }
+    if (keep_stats) {
+	attach_stats((CMS_STATS_AREA *)
+	    ((char *) shm->addr + extra_offset + 16));
+    }
+
     if (min_compatible_version < 3.44 && min_compatible_version > 0) {
 	total_subdivisions = 1;
     }
@@ -380,6 +485,25 @@ int SHMEM::open()
 	shm_addr_offset = shm->addr;
     }
     skip_area = 32 + total_connections + autokey_table_size;
+
+    if (ring_slots > 0) {
+	char *base = (char *) shm->addr;
+	long ring_area = size;
+	if (min_compatible_version > 2.58 || min_compatible_version < 1E-6) {
+	    base += skip_area;
+	    ring_area -= skip_area;
+	}
+	ring_area -= sizeof(SHMEM_RING);
+	ring_slot_size = (ring_area / ring_slots) & ~63L;
+	if (ring_slot_size <= (long) sizeof(SHMEM_RING_SLOT)) {
+	    rcs_print_error
+		("SHMEM: %s is too small for a ring of %d slots.\n",
+		BufferName, ring_slots);
+	    ring_slots = 0;
+	} else {
+	    ring = (SHMEM_RING *) base;
+	}
+    }
     mao.data = shm_addr_offset;
     mao.timeout = timeout;
     mao.total_connections = total_connections;
@@ -460,7 +584,7 @@ CMS_STATUS SHMEM::main_access(void *_local, int *serial_number)
 	return (status = CMS_MISC_ERROR);
     }
 
-    if (bsem == NULL && not_zero(blocking_timeout)) {
+    if (bsem == NULL && write_count == NULL && not_zero(blocking_timeout)) {
 	rcs_print_error
 	    ("No blocking semaphore available. Can not call blocking_read(%f).\n",
 	    blocking_timeout);
@@ -468,11 +592,21 @@ CMS_STATUS SHMEM::main_access(void *_local, int *serial_number)
 	return (status = CMS_NO_BLOCKING_SEM_ERROR);
     }
 
+    /* Ring buffers are read and written without the mutex. */
+    int lock_free = (NULL != ring &&
+	internal_access_type != CMS_CLEAR_ACCESS &&
+	internal_access_type != CMS_GET_DIAG_INFO_ACCESS);
+
+    double access_start = 0;
+    if (NULL != stats_proc) {
+	access_start = etime();
+    }
+
     mao.read_only = ((internal_access_type == CMS_CHECK_IF_READ_ACCESS) ||
 	(internal_access_type == CMS_PEEK_ACCESS) ||
 	(internal_access_type == CMS_READ_ACCESS));
 
-    switch (mutex_type) {
+    switch (lock_free ? NO_MUTEX : mutex_type) {
     case NO_MUTEX:
 	break;
 
@@ -538,21 +672,67 @@ CMS_STATUS SHMEM::main_access(void *_local, int *serial_number)
 	break;
     }
 
+    if (NULL != stats_proc && !lock_free && mutex_type != NO_MUTEX) {
+	double wait = etime() - access_start;
+	stats_proc->lock_waits++;
+	stats_proc->lock_wait_time += wait;
+	if (wait > stats_proc->max_lock_wait_time) {
+	    stats_proc->max_lock_wait_time = wait;
+	}
+    }
+
     if (second_read > 0 && enable_diagnostics) {
 	disable_diag_store = 1;
     }
 
+    /* Writers make the sequence odd for the duration of the write, so
+       that peek_in_place() can tell a torn read. */
+    int writing = (internal_access_type == CMS_WRITE_ACCESS
+	|| internal_access_type == CMS_WRITE_IF_READ_ACCESS
+	|| internal_access_type == CMS_CLEAR_ACCESS);
+    if (writing && NULL != write_sequence) {
+	(*write_sequence)++;
+	__sync_synchronize();
+    }
+
+    /* Writers bump the count before they give up the mutex, so a write
+       after this read is sure to move it on from here. */
+    unsigned int count_read = 0;
+    if (NULL != write_count) {
+	count_read = *write_count;
+    }
+
     /* Perform access function. */
-    internal_access(shm->addr, size, _local, serial_number);
+    if (lock_free) {
+	ring_access(_local, serial_number);
+    } else {
+	internal_access(shm->addr, size, _local, serial_number);
+    }
+
+    if (writing && NULL != write_sequence) {
+	__sync_synchronize();
+	(*write_sequence)++;
+    }
+    if (writing && NULL != write_count) {
+	__sync_fetch_and_add(write_count, 1);
+	if (*write_waiters) {
+	    syscall(SYS_futex, write_count, FUTEX_WAKE, INT_MAX, NULL, NULL,
+		0);
+	}
+    }
 
     disable_diag_store = 0;
 
+    if (NULL != stats_proc) {
+	record_stats();
+    }
+
     if (NULL != bsem &&
 	(internal_access_type == CMS_WRITE_ACCESS
 	    || internal_access_type == CMS_WRITE_IF_READ_ACCESS)) {
 	bsem->flush();
     }
-    switch (mutex_type) {
+    switch (lock_free ? NO_MUTEX : mutex_type) {
     case NO_MUTEX:
 	break;
 
@@ -576,7 +756,26 @@ CMS_STATUS SHMEM::main_access(void *_local, int *serial_number)
     switch (internal_access_type) {
 
     case CMS_READ_ACCESS:
-	if (NULL != bsem && status == CMS_READ_OLD &&
+	/* With notify, sleep on the write count rather than the blocking
+	   semaphore; the reader wakes as soon as the write is done. */
+	if (NULL != write_count && status == CMS_READ_OLD &&
+	    (blocking_timeout > 1e-6 || blocking_timeout < -1E-6)) {
+	    if (second_read > 10 && total_subdivisions <= 1) {
+		status = CMS_MISC_ERROR;
+		rcs_print_error
+		    ("CMS: Blocking read error. The write count has changed %d times but there is still no new data.\n",
+		    second_read);
+		second_read = 0;
+		return (status);
+	    }
+	    second_read++;
+	    if (!wait_for_write(count_read, blocking_timeout)) {
+		status = CMS_TIMED_OUT;
+		second_read = 0;
+		return (status);
+	    }
+	    main_access(_local, serial_number);
+	} else if (NULL != bsem && status == CMS_READ_OLD &&
 	    (blocking_timeout > 1e-6 || blocking_timeout < -1E-6)) {
 	    if (second_read > 10 && total_subdivisions <= 1) {
 		status = CMS_MISC_ERROR;
@@ -616,3 +815,304 @@ CMS_STATUS SHMEM::main_access(void *_local, int *serial_number)
     second_read = 0;
     return (status);
 }
+
+/* Zero-copy peek.  Rather than copying the message out of the shared
+   buffer under the semaphore, return a pointer to it.  The caller copies
+   what it needs and then calls peek_in_place_done(): a return of 0 means
+   a writer changed the message meanwhile and the caller must peek again.
+   No locks are taken, so readers never hold up the writer. */
+CMS_STATUS SHMEM::peek_in_place(const void **message, unsigned long *sequence)
+{
+    if (NULL == write_sequence || NULL == shm) {
+	return (status = CMS_NO_IMPLEMENTATION_ERROR);
+    }
+    if (!read_permission_flag) {
+	rcs_print_error("CMS: %s was not configured to read %s\n",
+	    ProcessName, BufferName);
+	return (status = CMS_PERMISSIONS_ERROR);
+    }
+
+    unsigned long seq;
+    double start_time = etime();
+    while ((seq = *write_sequence) & 1) {
+	if (timeout >= 0 && etime() - start_time > timeout) {
+	    return (status = CMS_TIMED_OUT);
+	}
+	esleep(sem_delay);
+    }
+    __sync_synchronize();
+
+    char *base = (char *) shm->addr;
+    if (min_compatible_version > 2.58 || min_compatible_version < 1E-6) {
+	base += skip_area;
+    }
+    in_place_id = ((volatile CMS_HEADER *) base)->write_id;
+    *message = base + sizeof(CMS_HEADER);
+    *sequence = seq;
+    if (0 == in_place_id || in_place_id == in_buffer_id) {
+	return (status = CMS_READ_OLD);
+    }
+    return (status = CMS_READ_OK);
+}
+
+int SHMEM::peek_in_place_done(unsigned long sequence)
+{
+    if (NULL == write_sequence) {
+	return 0;
+    }
+    __sync_synchronize();
+    if (*write_sequence != sequence) {
+	return 0;
+    }
+    status = CMS_STATUS_NOT_SET;
+    check_id(in_place_id);
+    return 1;
+}
+
+/* Queue operations on the ring, in place of the queue_* functions of
+   CMS that work under the mutex.  Neutral buffers queue the encoded
+   message, raw buffers the message itself. */
+CMS_STATUS SHMEM::ring_access(void *_local, int *serial_number)
+{
+    unsigned long length = ring->enqueue_pos - ring->dequeue_pos;
+    if ((long) length < 0) {
+	length = 0;
+    }
+
+    switch (internal_access_type) {
+    case CMS_READ_ACCESS:
+	return ring_read(neutral ? encoded_data : subdiv_data, 1);
+
+    case CMS_PEEK_ACCESS:
+	return ring_read(neutral ? encoded_data : subdiv_data, 0);
+
+    case CMS_WRITE_IF_READ_ACCESS:
+	if (length > 0) {
+	    return (status = CMS_WRITE_WAS_BLOCKED);
+	}
+	/* FALLTHROUGH */
+    case CMS_WRITE_ACCESS:
+	if (!write_permission_flag) {
+	    rcs_print_error("CMS: %s was not configured to write to %s\n",
+		ProcessName, BufferName);
+	    return (status = CMS_PERMISSIONS_ERROR);
+	}
+	return ring_write(neutral ? encoded_data : _local, serial_number);
+
+    case CMS_CHECK_IF_READ_ACCESS:
+	header.was_read = (length == 0);
+	return status;
+
+    case CMS_GET_QUEUE_LENGTH_ACCESS:
+	queuing_header.queue_length = length;
+	return status;
+
+    case CMS_GET_SPACE_AVAILABLE_ACCESS:
+	free_space = (ring_slots - (long) length)
+	    * (ring_slot_size - (long) sizeof(SHMEM_RING_SLOT));
+	if (free_space < 0) {
+	    free_space = 0;
+	}
+	return status;
+
+    case CMS_GET_MSG_COUNT_ACCESS:
+	header.write_id = ring->write_id;
+	return status;
+
+    default:
+	return (status = CMS_INTERNAL_ACCESS_ERROR);
+    }
+}
+
+CMS_STATUS SHMEM::ring_write(const void *message, int *serial_number)
+{
+    long message_size = header.in_buffer_size;
+    if (message_size > ring_slot_size - (long) sizeof(SHMEM_RING_SLOT)) {
+	rcs_print_error
+	    ("CMS: %s message of %ld bytes does not fit a ring slot of %ld bytes.\n",
+	    BufferName, message_size,
+	    ring_slot_size - (long) sizeof(SHMEM_RING_SLOT));
+	return (status = CMS_INSUFFICIENT_SPACE_ERROR);
+    }
+
+    char *slots = (char *) (ring + 1);
+    SHMEM_RING_SLOT *slot;
+    unsigned long pos = __atomic_load_n(&ring->enqueue_pos, __ATOMIC_RELAXED);
+    unsigned long index;
+    while (1) {
+	index = pos % ring_slots;
+	slot = (SHMEM_RING_SLOT *) (slots + index * ring_slot_size);
+	unsigned long seq =
+	    __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+	long diff = (long) (seq - (pos - index));
+	if (diff == 0) {
+	    if (__atomic_compare_exchange_n(&ring->enqueue_pos, &pos, pos + 1,
+		    0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+		break;
+	    }
+	} else if (diff < 0) {
+	    if (cms_print_queue_full_messages) {
+		rcs_print_error("CMS: %s message queue is full.\n",
+		    BufferName);
+	    }
+	    return (status = CMS_QUEUE_FULL);
+	} else {
+	    pos = __atomic_load_n(&ring->enqueue_pos, __ATOMIC_RELAXED);
+	}
+    }
+
+    CMS_HEADER slot_header;
+    slot_header.write_id = __sync_add_and_fetch(&ring->write_id, 1);
+    slot_header.was_read = 0;
+    slot_header.in_buffer_size = message_size;
+    slot->header = slot_header;
+    memcpy((char *) (slot + 1), message, message_size);
+    __atomic_store_n(&slot->sequence, pos + 1 - index, __ATOMIC_RELEASE);
+
+    header.write_id = slot_header.write_id;
+    if (NULL != serial_number) {
+	*serial_number = (int) slot_header.write_id;
+    }
+    return (status = CMS_WRITE_OK);
+}
+
+/* Take the message at the head of the ring, or with consume 0 copy it
+   and leave it there. */
+CMS_STATUS SHMEM::ring_read(void *message, int consume)
+{
+    if (!read_permission_flag) {
+	rcs_print_error("CMS: %s was not configured to read %s\n",
+	    ProcessName, BufferName);
+	return (status = CMS_PERMISSIONS_ERROR);
+    }
+
+    char *slots = (char *) (ring + 1);
+    SHMEM_RING_SLOT *slot;
+    unsigned long pos = __atomic_load_n(&ring->dequeue_pos, __ATOMIC_RELAXED);
+    unsigned long index;
+    while (1) {
+	index = pos % ring_slots;
+	slot = (SHMEM_RING_SLOT *) (slots + index * ring_slot_size);
+	unsigned long seq =
+	    __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+	long diff = (long) (seq - (pos + 1 - index));
+	if (diff < 0) {
+	    return (status = CMS_READ_OLD);
+	}
+	if (diff > 0) {
+	    pos = __atomic_load_n(&ring->dequeue_pos, __ATOMIC_RELAXED);
+	    continue;
+	}
+	if (consume) {
+	    if (!__atomic_compare_exchange_n(&ring->dequeue_pos, &pos,
+		    pos + 1, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+		continue;
+	    }
+	}
+	header = slot->header;
+	if (header.in_buffer_size > max_message_size ||
+	    header.in_buffer_size >
+	    ring_slot_size - (long) sizeof(SHMEM_RING_SLOT)) {
+	    if (!consume) {
+		pos = __atomic_load_n(&ring->dequeue_pos, __ATOMIC_RELAXED);
+		continue;
+	    }
+	    rcs_print_error
+		("CMS:(%s) Message size of %ld exceeds maximum of %ld\n",
+		BufferName, header.in_buffer_size, max_message_size);
+	    __atomic_store_n(&slot->sequence, pos + ring_slots - index,
+		__ATOMIC_RELEASE);
+	    return (status = CMS_INTERNAL_ACCESS_ERROR);
+	}
+	memcpy(message, (char *) (slot + 1), header.in_buffer_size);
+	if (consume) {
+	    /* hand the slot back to the writers */
+	    __atomic_store_n(&slot->sequence, pos + ring_slots - index,
+		__ATOMIC_RELEASE);
+	    break;
+	}
+	/* a peek is good only if no reader took the slot meanwhile */
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	if (__atomic_load_n(&slot->sequence, __ATOMIC_RELAXED) ==
+	    pos + 1 - index) {
+	    break;
+	}
+	pos = __atomic_load_n(&ring->dequeue_pos, __ATOMIC_RELAXED);
+    }
+    header.was_read = 1;
+    check_id(header.write_id);
+    return (status);
+}
+
+/* Count the access just made in this process's stats entry. */
+void SHMEM::record_stats()
+{
+    switch (internal_access_type) {
+    case CMS_READ_ACCESS:
+	stats_proc->reads++;
+	if (status == CMS_READ_OK) {
+	    stats_proc->new_reads++;
+	}
+	break;
+
+    case CMS_PEEK_ACCESS:
+	stats_proc->peeks++;
+	break;
+
+    case CMS_WRITE_ACCESS:
+    case CMS_WRITE_IF_READ_ACCESS:
+	stats_proc->writes++;
+	if (queuing_enabled && status == CMS_WRITE_OK) {
+	    long length = queuing_header.queue_length;
+	    if (NULL != ring) {
+		length = ring->enqueue_pos - ring->dequeue_pos;
+	    }
+	    long high_water;
+	    while (length > (high_water = stats->queue_high_water) &&
+		!__sync_bool_compare_and_swap(&stats->queue_high_water,
+		    high_water, length)) {
+	    }
+	}
+	break;
+
+    default:
+	break;
+    }
+    stats_proc->last_access_time = etime();
+}
+
+int SHMEM::get_write_count(unsigned int *count)
+{
+    if (NULL == write_count) {
+	return -1;
+    }
+    *count = *write_count;
+    return 0;
+}
+
+/* Sleep on the write count until a writer moves it on from count, or
+   for at most timeout seconds (forever if timeout is negative).
+   Writers only make the futex system call when someone is waiting. */
+int SHMEM::wait_for_write(unsigned int count, double timeout)
+{
+    if (NULL == write_count) {
+	return -1;
+    }
+    double end_time = etime() + timeout;
+    __sync_fetch_and_add(write_waiters, 1);
+    while (*write_count == count) {
+	struct timespec ts, *tsp = NULL;
+	if (timeout >= 0) {
+	    double left = end_time - etime();
+	    if (left <= 0) {
+		break;
+	    }
+	    ts.tv_sec = (time_t) left;
+	    ts.tv_nsec = (long) ((left - ts.tv_sec) * 1e9);
+	    tsp = &ts;
+	}
+	syscall(SYS_futex, write_count, FUTEX_WAIT, count, tsp, NULL, 0);
+    }
+    __sync_fetch_and_sub(write_waiters, 1);
+    return *write_count != count;
+}
@@ -34,6 +34,8 @@ extern "C" {
 #include "shm.hh"		/* class RCS_SHAREDMEM */
 #include "memsem.hh"		/* struct mem_access_object */
 
+struct SHMEM_RING;
+
 class SHMEM:public CMS {
   public:
     SHMEM(const char *name, long size, int neutral, key_t key, int m = 0);
@@ -42,6 +44,11 @@ class SHMEM:public CMS {
     virtual ~ SHMEM();
 
     CMS_STATUS main_access(void *_local, int *serial_number);
+    CMS_STATUS peek_in_place(const void **message, unsigned long *sequence);
+    int peek_in_place_done(unsigned long sequence);
+    int get_write_count(unsigned int *count);
+    int wait_for_write(unsigned int count, double timeout);
+    CMS_STATUS ring_access(void *_local, int *serial_number);
 
   private:
 
@@ -78,6 +85,22 @@ class SHMEM:public CMS {
     RCS_SEMAPHORE *bsem;	// blocking semaphore
     int autokey_table_size;
 
+    volatile unsigned long *write_sequence;	// odd while a write is in
+    // progress, for peek_in_place(); NULL unless zerocopy is configured
+    CMSID in_place_id;		// write_id seen by the last peek_in_place()
+    int notify;			// 'notify' configured
+    volatile unsigned int *write_count;	// bumped after every write; a
+    // futex for wait_for_write(); NULL unless notify is configured
+    volatile unsigned int *write_waiters;	// processes in wait_for_write()
+    int ring_slots;		// 'ring=n' configured: a lock-free queue of
+    // n fixed size slots replaces the queue under the mutex
+    SHMEM_RING *ring;		// NULL unless ring is configured
+    long ring_slot_size;	// bytes each slot takes, its header included
+    CMS_STATUS ring_write(const void *message, int *serial_number);
+    CMS_STATUS ring_read(void *message, int consume);
+    int keep_stats;		// 'stats' configured
+    void record_stats();
+
 };
 
 #endif /* !SHMEM_HH */
@@ -100,6 +100,22 @@ TCPMEM::TCPMEM(const char *_bufline, const char *_procline):CMS(_bufline, _procl
     if (NULL != strstr(ProcessLine, "noreconnect")) {
 	autoreconnect = 0;
     }
+    delta_requested = (NULL != strstr(ProcessLine, "delta"));
+    delta = 0;
+    delta_base = NULL;
+    delta_base_size = 0;
+    delta_data = NULL;
+    reply_data = (char *) encoded_data;
+    max_reply_size = max_encoded_message_size;
+    if (delta_requested) {
+	delta_base = (char *) malloc(max_encoded_message_size);
+	delta_data = (char *)
+	    malloc(max_encoded_message_size + REMOTE_CMS_DELTA_OVERHEAD);
+	if (NULL == delta_base || NULL == delta_data) {
+	    rcs_print_error("TCPMEM: Can't allocate delta buffers.\n");
+	    delta_requested = 0;
+	}
+    }
     server_host_entry = NULL;
 
     /* Set up the socket address stucture. */
@@ -509,6 +525,8 @@ void TCPMEM::reconnect()
     }
     read_socket_fd = socket_fd;
 
+    set_delta();
+
     memset(temp_buffer, 0, 32);
     if (total_subdivisions > 1) {
 	subscription_type = CMS_NO_SUBSCRIPTION;
@@ -631,6 +649,96 @@ void TCPMEM::reconnect()
 TCPMEM::~TCPMEM()
 {
     disconnect();
+    if (NULL != delta_base) {
+	free(delta_base);
+	delta_base = NULL;
+    }
+    if (NULL != delta_data) {
+	free(delta_data);
+	delta_data = NULL;
+    }
+}
+
+/* Ask the server to send only the changes between successive messages
+   on this buffer.  Servers that predate delta mode never answer. */
+void TCPMEM::set_delta()
+{
+    delta = 0;
+    delta_base_size = 0;
+    reply_data = (char *) encoded_data;
+    max_reply_size = max_encoded_message_size;
+    if (!delta_requested || total_subdivisions > 1) {
+	return;
+    }
+    putbe32(temp_buffer, (uint32_t) serial_number);
+    putbe32(temp_buffer + 4, REMOTE_CMS_SET_DELTA_REQUEST_TYPE);
+    putbe32(temp_buffer + 8, (uint32_t) buffer_number);
+    putbe32(temp_buffer + 12, 1);
+    putbe32(temp_buffer + 16, 0);
+    if (sendn(socket_fd, temp_buffer, 20, 0, 30) < 0) {
+	rcs_print_error("TCPMEM: Can't set up delta mode.\n");
+	return;
+    }
+    serial_number++;
+    rcs_print_debug(PRINT_ALL_SOCKET_REQUESTS,
+	"TCPMEM sending request: fd = %d, serial_number=%ld, request_type=%d, buffer_number=%ld\n",
+	socket_fd, serial_number,
+	ntohl(*((uint32_t *) temp_buffer + 1)), buffer_number);
+    memset(temp_buffer, 0, 8);
+    recvd_bytes = 0;
+    if (recvn(socket_fd, temp_buffer, 8, 0, 2.0, &recvd_bytes) < 0) {
+	if (recvd_bytes > 0) {
+	    bytes_to_throw_away = 8 - recvd_bytes;
+	} else {
+	    rcs_print_error
+		("TCPMEM: Server for %s does not support delta mode.\n",
+		BufferName);
+	}
+	recvd_bytes = 0;
+	return;
+    }
+    recvd_bytes = 0;
+    if (!getbe32(temp_buffer + 4)) {
+	return;
+    }
+    delta = 1;
+    reply_data = delta_data;
+    max_reply_size = max_encoded_message_size + REMOTE_CMS_DELTA_OVERHEAD;
+}
+
+/* Patch the last message received with the delta reply of size bytes
+   in delta_data and copy the result to encoded_data. */
+int TCPMEM::apply_delta(long size)
+{
+    if (size < 4) {
+	rcs_print_error("TCPMEM: Delta reply too short. (%ld)\n", size);
+	return -1;
+    }
+    unsigned long total = getbe32(delta_data);
+    if (total > (unsigned long) max_encoded_message_size) {
+	rcs_print_error("Recieved message is too big. (%lu > %ld)\n",
+	    total, max_encoded_message_size);
+	return -1;
+    }
+    long pos = 4;
+    while (pos < size) {
+	if (pos + 8 > size) {
+	    rcs_print_error("TCPMEM: Bad delta reply.\n");
+	    return -1;
+	}
+	unsigned long offset = getbe32(delta_data + pos);
+	unsigned long length = getbe32(delta_data + pos + 4);
+	pos += 8;
+	if (offset + length > total || length > (unsigned long) (size - pos)) {
+	    rcs_print_error("TCPMEM: Bad delta reply.\n");
+	    return -1;
+	}
+	memcpy(delta_base + offset, delta_data + pos, length);
+	pos += length;
+    }
+    delta_base_size = total;
+    memcpy(encoded_data, delta_base, total);
+    return 0;
 }
 
 void TCPMEM::disconnect()
@@ -717,9 +825,9 @@ CMS_STATUS TCPMEM::handle_old_replies()
 		(CMS_STATUS) ntohl(*((uint32_t *) temp_buffer + 1));
 	    timedout_request_writeid = ntohl(*((uint32_t *) temp_buffer + 3));
 	    header.was_read = ntohl(*((uint32_t *) temp_buffer + 4));
-	    if (message_size > max_encoded_message_size) {
+	    if (message_size > max_reply_size) {
 		rcs_print_error("Recieved message is too big. (%ld > %ld)\n",
-		    message_size, max_encoded_message_size);
+		    message_size, max_reply_size);
 		fatal_error_occurred = 1;
 		reconnect_needed = 1;
 		return (status = CMS_INSUFFICIENT_SPACE_ERROR);
@@ -729,7 +837,7 @@ CMS_STATUS TCPMEM::handle_old_replies()
 	}
 	if (message_size > 0) {
 	    if (recvn
-		(socket_fd, encoded_data, message_size, 0, timeout,
+		(socket_fd, reply_data, message_size, 0, timeout,
 		    &recvd_bytes) < 0) {
 		if (recvn_timedout) {
 		    if (!waiting_for_message) {
@@ -763,6 +871,11 @@ CMS_STATUS TCPMEM::handle_old_replies()
 	    if (waiting_for_message) {
 		timedout_request_writeid = waiting_message_id;
 	    }
+	    if (delta && apply_delta(message_size) < 0) {
+		fatal_error_occurred = 1;
+		reconnect_needed = 1;
+		return (status = CMS_MISC_ERROR);
+	    }
 	}
 	break;
 
@@ -1016,9 +1129,9 @@ CMS_STATUS TCPMEM::read()
     message_size = ntohl(*((uint32_t *) temp_buffer + 2));
     id = ntohl(*((uint32_t *) temp_buffer + 3));
     header.was_read = ntohl(*((uint32_t *) temp_buffer + 4));
-    if (message_size > max_encoded_message_size) {
+    if (message_size > max_reply_size) {
 	rcs_print_error("Recieved message is too big. (%ld > %ld)\n",
-	    message_size, max_encoded_message_size);
+	    message_size, max_reply_size);
 	fatal_error_occurred = 1;
 	reconnect_needed = 1;
 	reenable_sigpipe();
@@ -1026,7 +1139,7 @@ CMS_STATUS TCPMEM::read()
     }
     if (message_size > 0) {
 	if (recvn
-	    (socket_fd, encoded_data, message_size, 0, timeout,
+	    (socket_fd, reply_data, message_size, 0, timeout,
 		&recvd_bytes) < 0) {
 	    if (recvn_timedout) {
 		if (!waiting_for_message) {
@@ -1050,6 +1163,12 @@ CMS_STATUS TCPMEM::read()
 		return (status = CMS_MISC_ERROR);
 	    }
 	}
+	if (delta && apply_delta(message_size) < 0) {
+	    fatal_error_occurred = 1;
+	    reconnect_needed = 1;
+	    reenable_sigpipe();
+	    return (status = CMS_MISC_ERROR);
+	}
     }
     recvd_bytes = 0;
     check_id(id);
@@ -1219,9 +1338,9 @@ CMS_STATUS TCPMEM::blocking_read(double _blocking_timeout)
     message_size = ntohl(*((uint32_t *) temp_buffer + 2));
     id = ntohl(*((uint32_t *) temp_buffer + 3));
     header.was_read = ntohl(*((uint32_t *) temp_buffer + 4));
-    if (message_size > max_encoded_message_size) {
+    if (message_size > max_reply_size) {
 	rcs_print_error("Recieved message is too big. (%ld > %ld)\n",
-	    message_size, max_encoded_message_size);
+	    message_size, max_reply_size);
 	fatal_error_occurred = 1;
 	reconnect_needed = 1;
 	reenable_sigpipe();
@@ -1229,7 +1348,7 @@ CMS_STATUS TCPMEM::blocking_read(double _blocking_timeout)
     }
     if (message_size > 0) {
 	if (recvn
-	    (socket_fd, encoded_data, message_size, 0, blocking_timeout,
+	    (socket_fd, reply_data, message_size, 0, blocking_timeout,
 		&recvd_bytes) < 0) {
 	    if (recvn_timedout) {
 		if (!waiting_for_message) {
@@ -1253,6 +1372,12 @@ CMS_STATUS TCPMEM::blocking_read(double _blocking_timeout)
 		return (status = CMS_MISC_ERROR);
 	    }
 	}
+	if (delta && apply_delta(message_size) < 0) {
+	    fatal_error_occurred = 1;
+	    reconnect_needed = 1;
+	    reenable_sigpipe();
+	    return (status = CMS_MISC_ERROR);
+	}
     }
     recvd_bytes = 0;
     check_id(id);
@@ -1405,16 +1530,16 @@ CMS_STATUS TCPMEM::peek()
     message_size = ntohl(*((uint32_t *) temp_buffer + 2));
     id = ntohl(*((uint32_t *) temp_buffer + 3));
     header.was_read = ntohl(*((uint32_t *) temp_buffer + 4));
-    if (message_size > max_encoded_message_size) {
+    if (message_size > max_reply_size) {
 	reconnect_needed = 1;
 	rcs_print_error("Recieved message is too big. (%ld > %ld)\n",
-	    message_size, max_encoded_message_size);
+	    message_size, max_reply_size);
 	reenable_sigpipe();
 	return (status = CMS_MISC_ERROR);
     }
     if (message_size > 0) {
 	if (recvn
-	    (socket_fd, encoded_data, message_size, 0, timeout,
+	    (socket_fd, reply_data, message_size, 0, timeout,
 		&recvd_bytes) < 0) {
 	    if (recvn_timedout) {
 		if (!waiting_for_message) {
@@ -1438,6 +1563,12 @@ CMS_STATUS TCPMEM::peek()
 		return (status = CMS_MISC_ERROR);
 	    }
 	}
+	if (delta && apply_delta(message_size) < 0) {
+	    fatal_error_occurred = 1;
+	    reconnect_needed = 1;
+	    reenable_sigpipe();
+	    return (status = CMS_MISC_ERROR);
+	}
     }
     recvd_bytes = 0;
     check_id(id);
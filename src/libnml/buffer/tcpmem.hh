@@ -81,6 +81,15 @@ class TCPMEM:public CMS {
     void reenable_sigpipe();
     void verify_bufname();
     int subscription_count;
+    void set_delta();
+    int apply_delta(long size);
+    int delta_requested;
+    int delta;
+    char *delta_base;
+    long delta_base_size;
+    char *delta_data;
+    char *reply_data;
+    long max_reply_size;
 };
 
 #endif
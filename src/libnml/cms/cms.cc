@@ -28,6 +28,8 @@ extern "C" {
     /* strcmp(),strchr() */
 #include <ctype.h>		// tolower(), toupper()
 #include <errno.h>		/* errno, ERANGE */
+#include <unistd.h>		/* getpid() */
+#include <signal.h>		/* kill() */
 
 #ifdef __cplusplus
 }
@@ -37,9 +39,11 @@ extern "C" {
 #include "cms_xup.hh"		/* class CMS_XDR_UPDATER */
 #include "cms_aup.hh"		/* class CMS_ASCII_UPDATER */
 #include "cms_dup.hh"		/* class CMS_DISPLAY_ASCII_UPDATER */
+#include "cms_pup.hh"		/* class CMS_PACKED_UPDATER */
 #include "rcs_print.hh"		/* rcs_print_error(), separate_words() */
 				/* rcs_print_debug() */
 #include "cmsdiag.hh"
+#include "cmsstats.hh"		/* struct CMS_STATS_AREA */
 #include "linklist.hh"          /* LinkedList */
 #include "physmem.hh"
 
@@ -137,7 +141,11 @@ CMS::CMS(long s)
     last_im = CMS_NOT_A_MODE;
     min_compatible_version = 0;
     confirm_write = 0;
+    max_connections = 0;
     disable_final_write_raw_for_dma = 0;
+    zero_copy = 0;
+    stats = NULL;
+    stats_proc = NULL;
     subdiv_data = 0;
     enable_diagnostics = 0;
     dpi = NULL;
@@ -195,7 +203,11 @@ CMS::CMS(const char *bufline_in, const char *procline_in, int set_to_server)
     force_raw = 0;
     serial = 0;
     confirm_write = 0;
+    max_connections = 0;
     disable_final_write_raw_for_dma = 0;
+    zero_copy = 0;
+    stats = NULL;
+    stats_proc = NULL;
     /* Init string buffers */
     memset(BufferName, 0, CMS_CONFIG_LINELEN);
     memset(BufferHost, 0, CMS_CONFIG_LINELEN);
@@ -371,14 +383,18 @@ CMS::CMS(const char *bufline_in, const char *procline_in, int set_to_server)
 	    neutral_encoding_method = CMS_DISPLAY_ASCII_ENCODING;
 	    continue;
 	}
-	if (!strcmp(buflineupper, "ASCII")) {
+	if (!strcmp(word[i], "ASCII")) {
 	    neutral_encoding_method = CMS_ASCII_ENCODING;
 	    continue;
 	}
-	if (!strcmp(buflineupper, "XDR")) {
+	if (!strcmp(word[i], "XDR")) {
 	    neutral_encoding_method = CMS_XDR_ENCODING;
 	    continue;
 	}
+	if (!strcmp(word[i], "PACKED")) {
+	    neutral_encoding_method = CMS_PACKED_ENCODING;
+	    continue;
+	}
 
 	char *port_string;
 	if (NULL != (port_string = strstr(word[i], "STCP="))) {
@@ -419,6 +435,12 @@ CMS::CMS(const char *bufline_in, const char *procline_in, int set_to_server)
 	    continue;
 	}
 
+	char *max_conn_string;
+	if (NULL != (max_conn_string = strstr(word[i], "MAX_CONNECTIONS="))) {
+	    max_connections = strtol(max_conn_string + 16, (char **) NULL, 0);
+	    continue;
+	}
+
 	if (!strcmp(word[i], "SERIAL")) {
 	    serial = 1;
 	    continue;
@@ -679,6 +701,10 @@ void CMS::open(void)
 	    updater = new CMS_DISPLAY_ASCII_UPDATER(this);
 	    break;
 
+	case CMS_PACKED_ENCODING:
+	    updater = new CMS_PACKED_UPDATER(this);
+	    break;
+
 	default:
 	    updater = (CMS_UPDATER *) NULL;
 	    status = CMS_UPDATE_ERROR;
@@ -1033,6 +1059,69 @@ CMS_STATUS CMS::peek()
     return (status);
 }
 
+/* Only buffers that can hand out a pointer to the message in place
+   implement these; see SHMEM::peek_in_place(). */
+CMS_STATUS CMS::peek_in_place(const void **message, unsigned long *sequence)
+{
+    return (status = CMS_NO_IMPLEMENTATION_ERROR);
+}
+
+int CMS::peek_in_place_done(unsigned long sequence)
+{
+    return 0;
+}
+
+/* A count of the writes to the buffer, and a way to sleep until it
+   moves on from count, for buffers that keep one (see SHMEM with
+   'notify').  Both return -1 when the buffer has no count;
+   wait_for_write() returns 1 after a write and 0 on timeout. */
+int CMS::get_write_count(unsigned int *count)
+{
+    return -1;
+}
+
+int CMS::wait_for_write(unsigned int count, double timeout)
+{
+    return -1;
+}
+
+/* Find or claim this process's entry in a shared stats area.  An entry
+   left behind by a process that has exited is taken over once all are
+   in use; if none can be had, nothing is recorded. */
+void CMS::attach_stats(CMS_STATS_AREA * area)
+{
+    stats = area;
+    stats_proc = NULL;
+    if (NULL == stats) {
+	return;
+    }
+    int pid = getpid();
+    int i;
+    for (i = 0; i < CMS_STATS_MAX_PROCS; i++) {
+	if (stats->procs[i].pid == pid) {
+	    stats_proc = &stats->procs[i];
+	    return;
+	}
+    }
+    for (i = 0; i < CMS_STATS_MAX_PROCS * 2 && NULL == stats_proc; i++) {
+	CMS_STATS_PROC *entry = &stats->procs[i % CMS_STATS_MAX_PROCS];
+	int old_pid = entry->pid;
+	if (i < CMS_STATS_MAX_PROCS ? old_pid != 0 :
+	    (old_pid == 0 || kill(old_pid, 0) == 0 || errno != ESRCH)) {
+	    continue;
+	}
+	if (__sync_bool_compare_and_swap(&entry->pid, old_pid, pid)) {
+	    stats_proc = entry;
+	}
+    }
+    if (NULL == stats_proc) {
+	return;
+    }
+    memset(stats_proc->name, 0,
+	sizeof(CMS_STATS_PROC) - offsetof(CMS_STATS_PROC, name));
+    strncpy(stats_proc->name, ProcessName, sizeof(stats_proc->name) - 1);
+}
+
 CMS_STATUS CMS::write(void *user_data, int *serial_number)
 {
     internal_access_type = CMS_WRITE_ACCESS;
@@ -1123,6 +1212,10 @@ void CMS::set_temp_updater(CMS_NEUTRAL_ENCODING_METHOD temp_encoding_method)
 	    temp_updater = new CMS_DISPLAY_ASCII_UPDATER(this);
 	    break;
 
+	case CMS_PACKED_ENCODING:
+	    temp_updater = new CMS_PACKED_UPDATER(this);
+	    break;
+
 	default:
 	    temp_updater = (CMS_UPDATER *) NULL;
 	    status = CMS_UPDATE_ERROR;
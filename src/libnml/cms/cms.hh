@@ -28,6 +28,8 @@ extern "C" {
 #include "cms_cfg.hh"		/* CMS_CONFIG_LINELEN */
 
 class PHYSMEM_HANDLE;
+struct CMS_STATS_AREA;
+struct CMS_STATS_PROC;
 struct PM_CARTESIAN;
 struct PM_CYLINDRICAL;
 struct PM_EULER_ZYX;
@@ -163,7 +165,8 @@ enum CMS_NEUTRAL_ENCODING_METHOD {
     CMS_NO_ENCODING,
     CMS_XDR_ENCODING,
     CMS_ASCII_ENCODING,
-    CMS_DISPLAY_ASCII_ENCODING
+    CMS_DISPLAY_ASCII_ENCODING,
+    CMS_PACKED_ENCODING
 };
 
 /* CMS class declaration. */
@@ -200,6 +203,11 @@ class CMS {
     virtual void disconnect();
     virtual int get_queue_length();
     virtual int get_space_available();
+    virtual CMS_STATUS peek_in_place(const void **message,
+	unsigned long *sequence);	/* Zero-copy peek. */
+    virtual int peek_in_place_done(unsigned long sequence);
+    virtual int get_write_count(unsigned int *count);	/* Writes so far. */
+    virtual int wait_for_write(unsigned int count, double timeout);
 
     /* Protocol Defined Virtual Function Stubs. */
     virtual CMS_STATUS main_access(void *_local, int *serial_number = NULL);
@@ -443,7 +451,14 @@ class CMS {
     double blocking_timeout;
     double min_compatible_version;
     int confirm_write;
+    int max_connections;	/* TCP server refuses clients beyond this;
+				   0 for no limit */
     int disable_final_write_raw_for_dma;
+    int zero_copy;		/* peek_in_place() is available */
+    CMS_STATS_AREA *stats;	/* 'stats' configured: access counters in
+				   shared memory */
+    CMS_STATS_PROC *stats_proc;	/* this process's entry in stats */
+    void attach_stats(CMS_STATS_AREA * area);
     virtual const char *status_string(int);
 
     int total_subdivisions;
@@ -0,0 +1,458 @@
+/********************************************************************
+* Description: cms_pup.cc
+*   Provides the interface to CMS used by NML update functions
+*   including a CMS update function for all the basic C data types
+*   to convert NMLmsgs to the packed binary encoding.
+*
+*   Values are stored least significant byte first with no padding:
+*   bool and char take 1 byte, short 2, int 4, long 8, float 4 and
+*   double 8.  long double travels as a double, as it does with XDR.
+*   On little endian hosts arrays of all but long double are copied
+*   with a single memcpy().
+*
+* License: LGPL Version 2
+* System: Linux
+*
+********************************************************************/
+
+extern "C" {
+#include <stdlib.h>		/* malloc(), free() */
+#include <string.h>		/* memcpy() */
+#include <stdint.h>		/* int64_t */
+}
+
+#include "cms.hh"		/* class CMS */
+#include "cms_pup.hh"		/* class CMS_PACKED_UPDATER */
+#include "rcs_print.hh"		/* rcs_print_error() */
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define PACKED_NATIVE 1
+#else
+#define PACKED_NATIVE 0
+#endif
+
+/* Copy bytes bytes between host and packed order. */
+static inline void copy_packed(void *to, const void *from, long bytes)
+{
+#if PACKED_NATIVE
+    memcpy(to, from, bytes);
+#else
+    for (long i = 0; i < bytes; i++) {
+	((char *) to)[i] = ((const char *) from)[bytes - 1 - i];
+    }
+#endif
+}
+
+/* Member functions for CMS_PACKED_UPDATER Class */
+CMS_PACKED_UPDATER::CMS_PACKED_UPDATER(CMS * _cms_parent):CMS_UPDATER
+    (_cms_parent, 0, 2)
+{
+    current_buffer = NULL;
+    current_buffer_size = 0;
+    current_position = NULL;
+    memset(positions, 0, sizeof(positions));
+    encoded_header = NULL;
+    encoded_queuing_header = NULL;
+    encoded_header_buffer_size = 0;
+    encoded_queuing_header_buffer_size = 0;
+
+    if (!cms_parent->isserver) {
+	encoded_data = NULL;
+    }
+    using_external_encoded_data = 0;
+
+    cms_parent = _cms_parent;
+    if (NULL == cms_parent) {
+	rcs_print_error("CMS parent for updater is NULL.\n");
+	status = CMS_UPDATE_ERROR;
+	return;
+    }
+
+    encoded_header_buffer_size = neutral_size_factor * sizeof(CMS_HEADER);
+    encoded_header = malloc(encoded_header_buffer_size);
+    if (encoded_header == NULL) {
+	rcs_print_error("CMS:can't malloc encoded_header");
+	status = CMS_CREATE_ERROR;
+	return;
+    }
+    if (cms_parent->queuing_enabled) {
+	encoded_queuing_header_buffer_size =
+	    neutral_size_factor * sizeof(CMS_QUEUING_HEADER);
+	encoded_queuing_header = malloc(encoded_queuing_header_buffer_size);
+	if (encoded_queuing_header == NULL) {
+	    rcs_print_error("CMS:can't malloc encoded_queuing_header");
+	    status = CMS_CREATE_ERROR;
+	    return;
+	}
+    }
+    if (!cms_parent->isserver) {
+	if (cms_parent->enc_max_size > 0
+	    && cms_parent->enc_max_size < neutral_size_factor * size) {
+	    set_encoded_data(malloc(cms_parent->enc_max_size),
+		cms_parent->enc_max_size);
+	} else {
+	    set_encoded_data(malloc(neutral_size_factor * size),
+		neutral_size_factor * size);
+	}
+    }
+    using_external_encoded_data = 0;
+}
+
+CMS_PACKED_UPDATER::~CMS_PACKED_UPDATER()
+{
+    if (NULL != encoded_data && !using_external_encoded_data) {
+	free(encoded_data);
+	encoded_data = NULL;
+    }
+    if (NULL != encoded_header) {
+	free(encoded_header);
+	encoded_header = NULL;
+    }
+    if (NULL != encoded_queuing_header) {
+	free(encoded_queuing_header);
+	encoded_queuing_header = NULL;
+    }
+}
+
+void CMS_PACKED_UPDATER::set_encoded_data(void *_encoded_data,
+    long _encoded_data_size)
+{
+    /* If the encoded data area has already been setup then release it. */
+    if (NULL != encoded_data && !using_external_encoded_data) {
+	free(encoded_data);
+	encoded_data = NULL;
+    }
+
+    encoded_data_size = _encoded_data_size;
+    encoded_data = _encoded_data;
+    using_external_encoded_data = 1;
+    if (encoded_data == NULL) {
+	rcs_print_error
+	    ("CMS: Attempt to set  encoded_data buffer to NULL.\n");
+	status = CMS_MISC_ERROR;
+	return;
+    }
+    positions[CMS_ENCODE_DATA] = 0;
+    positions[CMS_DECODE_DATA] = 0;
+    if (mode == CMS_ENCODE_DATA || mode == CMS_DECODE_DATA) {
+	set_mode(mode);
+    }
+}
+
+int CMS_PACKED_UPDATER::set_mode(CMS_UPDATER_MODE _mode)
+{
+    mode = _mode;
+    CMS_UPDATER::set_mode(_mode);
+    switch (mode) {
+    case CMS_NO_UPDATE:
+	current_buffer = NULL;
+	current_buffer_size = 0;
+	current_position = NULL;
+	return (0);
+
+    case CMS_ENCODE_DATA:
+    case CMS_DECODE_DATA:
+	current_buffer = (char *) encoded_data;
+	current_buffer_size = encoded_data_size;
+	if (current_buffer_size > cms_parent->max_encoded_message_size
+	    && cms_parent->max_encoded_message_size > 0) {
+	    current_buffer_size = cms_parent->max_encoded_message_size;
+	}
+	break;
+
+    case CMS_ENCODE_HEADER:
+    case CMS_DECODE_HEADER:
+	current_buffer = (char *) encoded_header;
+	current_buffer_size = encoded_header_buffer_size;
+	break;
+
+    case CMS_ENCODE_QUEUING_HEADER:
+    case CMS_DECODE_QUEUING_HEADER:
+	current_buffer = (char *) encoded_queuing_header;
+	current_buffer_size = encoded_queuing_header_buffer_size;
+	break;
+
+    default:
+	rcs_print_error("CMS updater in invalid mode.(%d)\n", mode);
+	return (-1);
+    }
+    current_position = &positions[mode];
+    return (0);
+}
+
+/* Repositions the data buffer to the very beginning */
+void CMS_PACKED_UPDATER::rewind()
+{
+    CMS_UPDATER::rewind();
+    if (NULL != current_position) {
+	*current_position = 0;
+    } else {
+	rcs_print_error
+	    ("CMS_PACKED_UPDATER: Can't rewind because there is no current buffer.\n");
+    }
+    if (NULL != cms_parent) {
+	cms_parent->format_size = 0;
+    }
+}
+
+int CMS_PACKED_UPDATER::get_encoded_msg_size()
+{
+    if (NULL == current_position) {
+	rcs_print_error
+	    ("CMS_PACKED_UPDATER can not provide encoded_msg_size because there is no current buffer.\n");
+	return (-1);
+    }
+    return (*current_position);
+}
+
+/* Check a value of local_bytes at x and room for packed_bytes in the
+   encoded buffer; returns where they go and moves past them. */
+char *CMS_PACKED_UPDATER::next(char *x, long local_bytes, long packed_bytes)
+{
+    if (NULL == cms_parent || NULL == current_buffer) {
+	rcs_print_error("CMS_PACKED_UPDATER: Required pointer is NULL.\n");
+	status = CMS_UPDATE_ERROR;
+	return NULL;
+    }
+    if (*current_position + packed_bytes > current_buffer_size) {
+	rcs_print_error
+	    ("Encoded message buffer full. (pos=%ld,_bytes=%ld,size=%ld)\n",
+	    *current_position, packed_bytes, current_buffer_size);
+	status = CMS_UPDATE_ERROR;
+	return NULL;
+    }
+    if (-1 == cms_parent->check_pointer(x, local_bytes)) {
+	status = CMS_UPDATE_ERROR;
+	return NULL;
+    }
+    char *p = current_buffer + *current_position;
+    *current_position += packed_bytes;
+    return p;
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::scalar(void *x, long bytes)
+{
+    char *p = next((char *) x, bytes, bytes);
+    if (NULL == p) {
+	return (CMS_UPDATE_ERROR);
+    }
+    if (encoding) {
+	copy_packed(p, x, bytes);
+    } else {
+	copy_packed(x, p, bytes);
+    }
+    return (status);
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::vector(void *x, unsigned int len, long bytes)
+{
+    char *p = next((char *) x, len * bytes, len * bytes);
+    if (NULL == p) {
+	return (CMS_UPDATE_ERROR);
+    }
+#if PACKED_NATIVE
+    if (encoding) {
+	memcpy(p, x, len * bytes);
+    } else {
+	memcpy(x, p, len * bytes);
+    }
+#else
+    for (unsigned int i = 0; i < len; i++) {
+	if (encoding) {
+	    copy_packed(p + i * bytes, (char *) x + i * bytes, bytes);
+	} else {
+	    copy_packed((char *) x + i * bytes, p + i * bytes, bytes);
+	}
+    }
+#endif
+    return (status);
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(bool &x)
+{
+    char c = x;
+    char *p = next((char *) &x, sizeof(bool), 1);
+    if (NULL == p) {
+	return (CMS_UPDATE_ERROR);
+    }
+    if (encoding) {
+	*p = c;
+    } else {
+	x = (*p != 0);
+    }
+    return (status);
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(char &x)
+{
+    return scalar(&x, 1);
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(char *x, unsigned int len)
+{
+    return vector(x, len, 1);
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(unsigned char &x)
+{
+    return scalar(&x, 1);
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(unsigned char *x, unsigned int len)
+{
+    return vector(x, len, 1);
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(short int &x)
+{
+    return scalar(&x, sizeof(short));
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(short *x, unsigned int len)
+{
+    return vector(x, len, sizeof(short));
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(unsigned short int &x)
+{
+    return scalar(&x, sizeof(unsigned short));
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(unsigned short *x, unsigned int len)
+{
+    return vector(x, len, sizeof(unsigned short));
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(int &x)
+{
+    return scalar(&x, sizeof(int));
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(int *x, unsigned int len)
+{
+    return vector(x, len, sizeof(int));
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(unsigned int &x)
+{
+    return scalar(&x, sizeof(unsigned int));
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(unsigned int *x, unsigned int len)
+{
+    return vector(x, len, sizeof(unsigned int));
+}
+
+/* LONG: always 8 bytes, so 32 and 64 bit hosts can talk to each other. */
+
+CMS_STATUS CMS_PACKED_UPDATER::update(long int &x)
+{
+    if (sizeof(long) == 8) {
+	return scalar(&x, 8);
+    }
+    char *p = next((char *) &x, sizeof(long), 8);
+    if (NULL == p) {
+	return (CMS_UPDATE_ERROR);
+    }
+    int64_t y = x;
+    if (encoding) {
+	copy_packed(p, &y, 8);
+    } else {
+	copy_packed(&y, p, 8);
+	x = (long) y;
+    }
+    return (status);
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(long *x, unsigned int len)
+{
+    if (sizeof(long) == 8) {
+	return vector(x, len, 8);
+    }
+    for (unsigned int i = 0; i < len; i++) {
+	if (update(x[i]) == CMS_UPDATE_ERROR) {
+	    return (CMS_UPDATE_ERROR);
+	}
+    }
+    return (status);
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(unsigned long int &x)
+{
+    if (sizeof(unsigned long) == 8) {
+	return scalar(&x, 8);
+    }
+    char *p = next((char *) &x, sizeof(unsigned long), 8);
+    if (NULL == p) {
+	return (CMS_UPDATE_ERROR);
+    }
+    uint64_t y = x;
+    if (encoding) {
+	copy_packed(p, &y, 8);
+    } else {
+	copy_packed(&y, p, 8);
+	x = (unsigned long) y;
+    }
+    return (status);
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(unsigned long *x, unsigned int len)
+{
+    if (sizeof(unsigned long) == 8) {
+	return vector(x, len, 8);
+    }
+    for (unsigned int i = 0; i < len; i++) {
+	if (update(x[i]) == CMS_UPDATE_ERROR) {
+	    return (CMS_UPDATE_ERROR);
+	}
+    }
+    return (status);
+}
+
+/* FLOAT */
+
+CMS_STATUS CMS_PACKED_UPDATER::update(float &x)
+{
+    return scalar(&x, sizeof(float));
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(float *x, unsigned int len)
+{
+    return vector(x, len, sizeof(float));
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(double &x)
+{
+    return scalar(&x, sizeof(double));
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(double *x, unsigned int len)
+{
+    return vector(x, len, sizeof(double));
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(long double &x)
+{
+    char *p = next((char *) &x, sizeof(long double), sizeof(double));
+    if (NULL == p) {
+	return (CMS_UPDATE_ERROR);
+    }
+    double y = (double) x;
+    if (encoding) {
+	copy_packed(p, &y, sizeof(double));
+    } else {
+	copy_packed(&y, p, sizeof(double));
+	x = (long double) y;
+    }
+    return (status);
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(long double *x, unsigned int len)
+{
+    for (unsigned int i = 0; i < len; i++) {
+	if (update(x[i]) == CMS_UPDATE_ERROR) {
+	    return (CMS_UPDATE_ERROR);
+	}
+    }
+    return (status);
+}
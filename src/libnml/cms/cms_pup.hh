@@ -0,0 +1,62 @@
+/********************************************************************
+* Description: cms_pup.hh
+*   Packed binary encoding for NML messages: each value is stored
+*   little endian with a fixed size and no padding or length words,
+*   so that arrays can be copied in one piece on little endian hosts.
+*
+* License: LGPL Version 2
+* System: Linux
+*
+********************************************************************/
+
+#ifndef CMS_PUP_HH
+#define CMS_PUP_HH
+
+#include "cms_up.hh"		/* class CMS_UPDATER */
+
+class CMS_PACKED_UPDATER:public CMS_UPDATER {
+  public:
+    CMS_STATUS update(bool &x);
+    CMS_STATUS update(char &x);
+    CMS_STATUS update(unsigned char &x);
+    CMS_STATUS update(short int &x);
+    CMS_STATUS update(unsigned short int &x);
+    CMS_STATUS update(int &x);
+    CMS_STATUS update(unsigned int &x);
+    CMS_STATUS update(long int &x);
+    CMS_STATUS update(unsigned long int &x);
+    CMS_STATUS update(float &x);
+    CMS_STATUS update(double &x);
+    CMS_STATUS update(long double &x);
+    CMS_STATUS update(char *x, unsigned int len);
+    CMS_STATUS update(unsigned char *x, unsigned int len);
+    CMS_STATUS update(short *x, unsigned int len);
+    CMS_STATUS update(unsigned short *x, unsigned int len);
+    CMS_STATUS update(int *x, unsigned int len);
+    CMS_STATUS update(unsigned int *x, unsigned int len);
+    CMS_STATUS update(long *x, unsigned int len);
+    CMS_STATUS update(unsigned long *x, unsigned int len);
+    CMS_STATUS update(float *x, unsigned int len);
+    CMS_STATUS update(double *x, unsigned int len);
+    CMS_STATUS update(long double *x, unsigned int len);
+    int set_mode(CMS_UPDATER_MODE);
+    void rewind();
+    int get_encoded_msg_size();
+    void set_encoded_data(void *, long _encoded_data_size);
+  protected:
+    char *next(char *x, long local_bytes, long packed_bytes);
+    CMS_STATUS scalar(void *x, long bytes);
+    CMS_STATUS vector(void *x, unsigned int len, long bytes);
+      CMS_PACKED_UPDATER(CMS *);
+      virtual ~ CMS_PACKED_UPDATER();
+    friend class CMS;
+    char *current_buffer;
+    long current_buffer_size;
+    long *current_position;
+    long encoded_header_buffer_size;
+    long encoded_queuing_header_buffer_size;
+    long positions[CMS_DECODE_QUEUING_HEADER + 1];
+};
+
+#endif
+// !defined(CMS_PUP_HH)
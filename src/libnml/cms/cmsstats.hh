@@ -0,0 +1,42 @@
+/********************************************************************
+* Description: cmsstats.hh
+*   Access statistics kept in shared memory for buffers configured
+*   with 'stats', for nmlstats to show while the system is running.
+*
+* Author:
+* License: LGPL Version 2
+* System: Linux
+*
+* Copyright (c) 2004 All rights reserved.
+*
+* Last change:
+********************************************************************/
+
+#ifndef CMSSTATS_HH
+#define CMSSTATS_HH
+
+#define CMS_STATS_MAX_PROCS 32
+
+/* One entry per process using the buffer.  Only the process that owns
+   an entry writes to it, so the counters need no locking. */
+struct CMS_STATS_PROC {
+    volatile int pid;		/* 0 while the entry is free */
+    char name[32];		/* process name from the config file */
+    unsigned long reads;	/* reads and blocking reads */
+    unsigned long new_reads;	/* reads that found a new message */
+    unsigned long peeks;
+    unsigned long writes;
+    unsigned long lock_waits;	/* accesses that took the mutex */
+    double lock_wait_time;	/* seconds spent waiting for the mutex */
+    double max_lock_wait_time;
+    unsigned long formats;	/* encodes and decodes of a message */
+    double format_time;		/* seconds spent in them */
+    double last_access_time;	/* etime() of the last access */
+};
+
+struct CMS_STATS_AREA {
+    volatile long queue_high_water;	/* most messages ever queued */
+    CMS_STATS_PROC procs[CMS_STATS_MAX_PROCS];
+};
+
+#endif /* !CMSSTATS_HH */
@@ -40,6 +40,9 @@ extern "C" {
 
 #include <sys/types.h>
 #include <sys/wait.h>		// waitpid
+#include <sys/eventfd.h>	// eventfd()
+#include <sys/epoll.h>		// epoll_create(), epoll_wait()
+#include <stdint.h>		// uint64_t
 
 #include <arpa/inet.h>		/* inet_ntoa */
 #include "cms.hh"		/* class CMS */
@@ -74,6 +77,7 @@ TCPSVR_BLOCKING_READ_REQUEST::TCPSVR_BLOCKING_READ_REQUEST()
     _client_tcp_port = NULL;
     remport = NULL;
     server = NULL;
+    delta = 0;
     _nml = NULL;
     _reply = NULL;
     _data = NULL;
@@ -133,7 +137,8 @@ CMS_SERVER_REMOTE_PORT(_cms_server)
     client_ports = (LinkedList *) NULL;
     connection_socket = 0;
     connection_port = 0;
-    maxfdpl = 0;
+    epoll_fd = -1;
+    max_connections = 0;
     dtimeout = 20.0;
 
     memset(&server_socket_address, 0, sizeof(server_socket_address));
@@ -152,8 +157,9 @@ CMS_SERVER_REMOTE_PORT(_cms_server)
     select_timeout.tv_usec = 30;
     subscription_buffers = NULL;
     current_poll_interval_millis = 30000;
-    memset(&read_fd_set, 0, sizeof(read_fd_set));
-    memset(&write_fd_set, 0, sizeof(write_fd_set));
+    delta_buffer = NULL;
+    delta_buffer_size = 0;
+    notify_fd = -1;
 }
 
 CMS_SERVER_REMOTE_TCP_PORT::~CMS_SERVER_REMOTE_TCP_PORT()
@@ -164,6 +170,18 @@ CMS_SERVER_REMOTE_TCP_PORT::~CMS_SERVER_REMOTE_TCP_PORT()
 	delete client_ports;
 	client_ports = (LinkedList *) NULL;
     }
+    if (NULL != delta_buffer) {
+	free(delta_buffer);
+	delta_buffer = NULL;
+    }
+    if (notify_fd >= 0) {
+	close(notify_fd);
+	notify_fd = -1;
+    }
+    if (epoll_fd >= 0) {
+	close(epoll_fd);
+	epoll_fd = -1;
+    }
 }
 
 void blocking_thread_kill(long int id)
@@ -239,6 +257,9 @@ int CMS_SERVER_REMOTE_TCP_PORT::accept_local_port_cms(CMS * _cms)
 	    confirm_write = _cms->confirm_write;
 	}
     }
+    if (_cms->max_connections > max_connections) {
+	max_connections = _cms->max_connections;
+    }
     if (_cms->total_subdivisions > max_total_subdivisions) {
 	max_total_subdivisions = _cms->total_subdivisions;
     }
@@ -301,6 +322,82 @@ static void handle_pipe_error(int signum)
     rcs_print_error("SIGPIPE intercepted.\n");
 }
 
+/* Take a client off the event set and the client list and free it, along
+   with its subscriptions. */
+void CMS_SERVER_REMOTE_TCP_PORT::close_client_port(CLIENT_TCP_PORT *
+    _client_tcp_port)
+{
+    if (NULL != _client_tcp_port->subscriptions) {
+	TCP_CLIENT_SUBSCRIPTION_INFO *clnt_sub_info =
+	    (TCP_CLIENT_SUBSCRIPTION_INFO *)
+	    _client_tcp_port->subscriptions->get_head();
+	while (NULL != clnt_sub_info) {
+	    if (NULL != clnt_sub_info->sub_buf_info &&
+		clnt_sub_info->subscription_list_id >= 0) {
+		if (NULL != clnt_sub_info->sub_buf_info->sub_clnt_info) {
+		    clnt_sub_info->sub_buf_info->sub_clnt_info->
+			delete_node(clnt_sub_info->subscription_list_id);
+		    if (clnt_sub_info->sub_buf_info->sub_clnt_info->
+			list_size < 1) {
+			delete clnt_sub_info->sub_buf_info->sub_clnt_info;
+			clnt_sub_info->sub_buf_info->sub_clnt_info = NULL;
+			if (NULL != subscription_buffers
+			    && clnt_sub_info->sub_buf_info->list_id >= 0) {
+			    subscription_buffers->
+				delete_node(clnt_sub_info->sub_buf_info->
+				list_id);
+			    delete clnt_sub_info->sub_buf_info;
+			    clnt_sub_info->sub_buf_info = NULL;
+			}
+		    }
+		    clnt_sub_info->sub_buf_info = NULL;
+		}
+	    }
+	    delete clnt_sub_info;
+	    clnt_sub_info =
+		(TCP_CLIENT_SUBSCRIPTION_INFO *)
+		_client_tcp_port->subscriptions->get_next();
+	}
+	delete _client_tcp_port->subscriptions;
+	_client_tcp_port->subscriptions = NULL;
+	recalculate_polling_interval();
+    }
+    if (_client_tcp_port->threadId > 0 && _client_tcp_port->blocking) {
+	blocking_thread_kill(_client_tcp_port->threadId);
+    }
+    if (_client_tcp_port->socket_fd >= 0) {
+	epoll_ctl(epoll_fd, EPOLL_CTL_DEL, _client_tcp_port->socket_fd,
+	    NULL);
+	close(_client_tcp_port->socket_fd);
+	_client_tcp_port->socket_fd = -1;
+    }
+    CLIENT_TCP_PORT *client_port_to_check =
+	(CLIENT_TCP_PORT *) client_ports->get_head();
+    while (NULL != client_port_to_check) {
+	if (client_port_to_check == _client_tcp_port) {
+	    client_ports->delete_current_node();
+	    break;
+	}
+	client_port_to_check = (CLIENT_TCP_PORT *) client_ports->get_next();
+    }
+    delete _client_tcp_port;
+    current_clients--;
+}
+
+int CMS_SERVER_REMOTE_TCP_PORT::watch_fd(int fd, void *ptr)
+{
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.ptr = ptr;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+	rcs_print_error("server: epoll_ctl error.(errno = %d | %s)\n",
+	    errno, strerror(errno));
+	return -1;
+    }
+    return 0;
+}
+
 void CMS_SERVER_REMOTE_TCP_PORT::run()
 {
     int bytes_ready;
@@ -310,194 +407,128 @@ void CMS_SERVER_REMOTE_TCP_PORT::run()
 	return;
     }
     CLIENT_TCP_PORT *new_client_port, *client_port_to_check;
-    FD_ZERO(&read_fd_set);
-    FD_ZERO(&write_fd_set);
-    FD_SET(connection_socket, &read_fd_set);
-    maxfdpl = connection_socket + 1;
+    /* Each event carries the client port it is for; the connection socket
+       has NULL and the write notification descriptor &notify_fd. */
+    epoll_fd = epoll_create(16);
+    if (epoll_fd < 0) {
+	rcs_print_error("server: epoll_create error.(errno = %d | %s)\n",
+	    errno, strerror(errno));
+	return;
+    }
+    if (watch_fd(connection_socket, NULL) < 0) {
+	return;
+    }
+    /* Watchers of subscribed buffers post here after every write. */
+    notify_fd = eventfd(0, EFD_NONBLOCK);
+    if (notify_fd >= 0) {
+	watch_fd(notify_fd, &notify_fd);
+    }
     signal(SIGPIPE, handle_pipe_error);
     rcs_print_debug(PRINT_CMS_CONFIG_INFO,
 	"running server for TCP port %d (connection_socket = %d).\n",
 	ntohs(server_socket_address.sin_port), connection_socket);
 
     cms_server_count++;
-    fd_set read_fd_set_copy, write_fd_set_copy;
-    FD_ZERO(&read_fd_set_copy);
-    FD_ZERO(&write_fd_set_copy);
-    FD_SET(connection_socket, &read_fd_set_copy);
+    struct epoll_event events[TCP_SERVER_MAX_EVENTS];
 
     while (1) {
-	if (polling_enabled) {
-	    memcpy(&read_fd_set_copy, &read_fd_set, sizeof(fd_set));
-	    memcpy(&write_fd_set_copy, &write_fd_set, sizeof(fd_set));
-	    select_timeout.tv_sec = current_poll_interval_millis / 1000;
-	    select_timeout.tv_usec =
-		(current_poll_interval_millis % 1000) * 1000;
-	    ready_descriptors =
-		select(maxfdpl, &read_fd_set, &write_fd_set,
-		(fd_set *) NULL, (timeval *) & select_timeout);
-	    if (ready_descriptors == 0) {
-		update_subscriptions();
-		memcpy(&read_fd_set, &read_fd_set_copy, sizeof(fd_set));
-		memcpy(&write_fd_set, &write_fd_set_copy, sizeof(fd_set));
-		continue;
-	    }
-	} else {
-	    ready_descriptors =
-		select(maxfdpl, &read_fd_set, &write_fd_set,
-		(fd_set *) NULL, (timeval *) NULL);
-
+	ready_descriptors = epoll_wait(epoll_fd, events,
+	    TCP_SERVER_MAX_EVENTS,
+	    polling_enabled ? current_poll_interval_millis : -1);
+	if (ready_descriptors == 0) {
+	    update_subscriptions();
+	    continue;
 	}
 	if (ready_descriptors < 0) {
-	    rcs_print_error("server: select error.(errno = %d | %s)\n",
-		errno, strerror(errno));
+	    if (errno != EINTR) {
+		rcs_print_error("server: epoll_wait error.(errno = %d | %s)\n",
+		    errno, strerror(errno));
+	    }
+	    continue;
 	}
 	if (NULL == client_ports) {
 	    rcs_print_error("CMS_SERVER: List of client ports is NULL.\n");
 	    return;
 	}
-	client_port_to_check = (CLIENT_TCP_PORT *) client_ports->get_head();
-	while (NULL != client_port_to_check) {
-	    if (FD_ISSET(client_port_to_check->socket_fd, &read_fd_set)) {
-		ioctl(client_port_to_check->socket_fd, FIONREAD,
-		    (caddr_t) & bytes_ready);
-		if (bytes_ready <= 0) {
-		    rcs_print_debug(PRINT_SOCKET_CONNECT,
-			"Socket closed by host with IP address %s.\n",
-			inet_ntoa(client_port_to_check->address.sin_addr));
-		    if (NULL != client_port_to_check->subscriptions) {
-			TCP_CLIENT_SUBSCRIPTION_INFO *clnt_sub_info =
-			    (TCP_CLIENT_SUBSCRIPTION_INFO *)
-			    client_port_to_check->subscriptions->get_head();
-			while (NULL != clnt_sub_info) {
-			    if (NULL != clnt_sub_info->sub_buf_info &&
-				clnt_sub_info->subscription_list_id >= 0) {
-				if (NULL !=
-				    clnt_sub_info->sub_buf_info->
-				    sub_clnt_info) {
-				    clnt_sub_info->sub_buf_info->
-					sub_clnt_info->
-					delete_node(clnt_sub_info->
-					subscription_list_id);
-				    if (clnt_sub_info->sub_buf_info->
-					sub_clnt_info->list_size < 1) {
-					delete clnt_sub_info->sub_buf_info->
-					    sub_clnt_info;
-					clnt_sub_info->sub_buf_info->
-					    sub_clnt_info = NULL;
-					if (NULL != subscription_buffers
-					    && clnt_sub_info->sub_buf_info->
-					    list_id >= 0) {
-					    subscription_buffers->
-						delete_node(clnt_sub_info->
-						sub_buf_info->list_id);
-					    delete clnt_sub_info->
-						sub_buf_info;
-					    clnt_sub_info->sub_buf_info =
-						NULL;
-					}
-				    }
-				    clnt_sub_info->sub_buf_info = NULL;
-				}
-				delete clnt_sub_info;
-				clnt_sub_info =
-				    (TCP_CLIENT_SUBSCRIPTION_INFO *)
-				    client_port_to_check->subscriptions->
-				    get_next();
-			    }
-			    delete client_port_to_check->subscriptions;
-			    client_port_to_check->subscriptions = NULL;
-			    recalculate_polling_interval();
-			}
-		    }
-		    if (client_port_to_check->threadId > 0
-			&& client_port_to_check->blocking) {
-			blocking_thread_kill(client_port_to_check->threadId);
-		    }
-		    close(client_port_to_check->socket_fd);
-		    FD_CLR(client_port_to_check->socket_fd, &read_fd_set);
-		    client_port_to_check->socket_fd = -1;
-		    delete client_port_to_check;
-		    client_ports->delete_current_node();
-		} else {
-		    if (client_port_to_check->blocking) {
-			if (client_port_to_check->threadId > 0) {
-			    rcs_print_debug(PRINT_SERVER_THREAD_ACTIVITY,
-				"Data recieved from %s:%d when it should be blocking (bytes_ready=%d).\n",
-				inet_ntoa
-				(client_port_to_check->address.
-				    sin_addr),
-				client_port_to_check->socket_fd, bytes_ready);
-			    rcs_print_debug(PRINT_SERVER_THREAD_ACTIVITY,
-				"Killing handler %d.\n",
-				client_port_to_check->threadId);
-
-			    blocking_thread_kill
-				(client_port_to_check->threadId);
-#if 0
-			    *((uint32_t *) temp_buffer) =
-				htonl(client_port_to_check->serial_number);
-			    *((uint32_t *) temp_buffer + 1) =
-				htonl((unsigned long)
-				CMS_SERVER_SIDE_ERROR);
-			    putbe32(temp_buffer + 8, 0);	/* size
-									 */
-			    putbe32(temp_buffer + 12, 0);	/* write_id
-									 */
-			    putbe32(temp_buffer + 16, 0);	/* was_read
-									 */
-			    sendn(client_port_to_check->socket_fd,
-				temp_buffer, 20, 0, dtimeout);
-#endif
-			    client_port_to_check->threadId = 0;
-			    client_port_to_check->blocking = 0;
-			}
-		    }
-		    handle_request(client_port_to_check);
+	/* A port is only ever freed while its own event is handled, so the
+	   rest of the batch stays valid. */
+	for (int i = 0; i < ready_descriptors; i++) {
+	    if (events[i].data.ptr == &notify_fd) {
+		uint64_t writes;
+		if (::read(notify_fd, &writes, sizeof(writes)) < 0) {
+		    writes = 0;
 		}
-		ready_descriptors--;
-	    } else {
-		FD_SET(client_port_to_check->socket_fd, &read_fd_set);
-	    }
-	    client_port_to_check =
-		(CLIENT_TCP_PORT *) client_ports->get_next();
-	}
-	if (FD_ISSET(connection_socket, &read_fd_set)
-	    && ready_descriptors > 0) {
-	    ready_descriptors--;
-	    socklen_t client_address_length;
-	    new_client_port = new CLIENT_TCP_PORT();
-	    client_address_length = sizeof(new_client_port->address);
-	    new_client_port->socket_fd = accept(connection_socket,
-		(struct sockaddr *)
-		&new_client_port->address, &client_address_length);
-	    current_clients++;
-	    if (current_clients > max_clients) {
-		max_clients = current_clients;
-	    }
-	    if (new_client_port->socket_fd < 0) {
-		rcs_print_error("server: accept error -- %d %s \n", errno,
-		    strerror(errno));
 		continue;
 	    }
-	    rcs_print_debug(PRINT_SOCKET_CONNECT,
-		"Socket opened by host with IP address %s.\n",
-		inet_ntoa(new_client_port->address.sin_addr));
-	    new_client_port->serial_number = 0;
-	    new_client_port->blocking = 0;
-	    if (NULL != client_ports) {
+	    if (events[i].data.ptr == NULL) {
+		socklen_t client_address_length;
+		new_client_port = new CLIENT_TCP_PORT();
+		client_address_length = sizeof(new_client_port->address);
+		new_client_port->socket_fd = accept(connection_socket,
+		    (struct sockaddr *)
+		    &new_client_port->address, &client_address_length);
+		if (new_client_port->socket_fd < 0) {
+		    rcs_print_error("server: accept error -- %d %s \n", errno,
+			strerror(errno));
+		    delete new_client_port;
+		    continue;
+		}
+		if (max_connections > 0 && current_clients >= max_connections) {
+		    rcs_print_error
+			("server: refusing connection from %s, already %d clients (max_connections=%d).\n",
+			inet_ntoa(new_client_port->address.sin_addr),
+			current_clients, max_connections);
+		    close(new_client_port->socket_fd);
+		    new_client_port->socket_fd = -1;
+		    delete new_client_port;
+		    continue;
+		}
+		rcs_print_debug(PRINT_SOCKET_CONNECT,
+		    "Socket opened by host with IP address %s.\n",
+		    inet_ntoa(new_client_port->address.sin_addr));
+		new_client_port->serial_number = 0;
+		new_client_port->blocking = 0;
+		if (watch_fd(new_client_port->socket_fd, new_client_port) < 0) {
+		    close(new_client_port->socket_fd);
+		    new_client_port->socket_fd = -1;
+		    delete new_client_port;
+		    continue;
+		}
+		current_clients++;
+		if (current_clients > max_clients) {
+		    max_clients = current_clients;
+		}
 		client_ports->store_at_tail(new_client_port,
 		    sizeof(new_client_port), 0);
+		continue;
 	    }
-	    if (maxfdpl < new_client_port->socket_fd + 1) {
-		maxfdpl = new_client_port->socket_fd + 1;
+	    client_port_to_check = (CLIENT_TCP_PORT *) events[i].data.ptr;
+	    bytes_ready = 0;
+	    ioctl(client_port_to_check->socket_fd, FIONREAD,
+		(caddr_t) & bytes_ready);
+	    if (bytes_ready <= 0) {
+		rcs_print_debug(PRINT_SOCKET_CONNECT,
+		    "Socket closed by host with IP address %s.\n",
+		    inet_ntoa(client_port_to_check->address.sin_addr));
+		close_client_port(client_port_to_check);
+		continue;
 	    }
-	    FD_SET(new_client_port->socket_fd, &read_fd_set);
-	} else {
-	    FD_SET(connection_socket, &read_fd_set);
-	}
-	if (0 != ready_descriptors) {
-	    rcs_print_error("%d descriptors ready but not serviced.\n",
-		ready_descriptors);
+	    if (client_port_to_check->blocking) {
+		if (client_port_to_check->threadId > 0) {
+		    rcs_print_debug(PRINT_SERVER_THREAD_ACTIVITY,
+			"Data recieved from %s:%d when it should be blocking (bytes_ready=%d).\n",
+			inet_ntoa(client_port_to_check->address.sin_addr),
+			client_port_to_check->socket_fd, bytes_ready);
+		    rcs_print_debug(PRINT_SERVER_THREAD_ACTIVITY,
+			"Killing handler %d.\n",
+			client_port_to_check->threadId);
+
+		    blocking_thread_kill(client_port_to_check->threadId);
+		    client_port_to_check->threadId = 0;
+		    client_port_to_check->blocking = 0;
+		}
+	    }
+	    handle_request(client_port_to_check);
 	}
 	update_subscriptions();
     }
@@ -582,17 +613,26 @@ void *tcpsvr_handle_blocking_request(void *_req)
 	tcpsvr_threads_returned_early++;
 	return 0;
     }
+    int header_size = 20;
+    if (blocking_read_req->delta && read_reply->size > 0) {
+	/* The delta base was dropped when this read started, so the
+	   message goes out whole as a single record. */
+	putbe32(temp_buffer + 20, read_reply->size);
+	putbe32(temp_buffer + 24, 0);
+	putbe32(temp_buffer + 28, read_reply->size);
+	header_size += REMOTE_CMS_DELTA_OVERHEAD;
+    }
     putbe32(temp_buffer, _client_tcp_port->serial_number);
     putbe32(temp_buffer + 4, read_reply->status);
-    putbe32(temp_buffer + 8, read_reply->size);
+    putbe32(temp_buffer + 8, read_reply->size + header_size - 20);
     putbe32(temp_buffer + 12, read_reply->write_id);
     putbe32(temp_buffer + 16, read_reply->was_read);
-    if (read_reply->size < (0x2000 - 20) && read_reply->size > 0) {
-	memcpy(temp_buffer + 20, read_reply->data, read_reply->size);
+    if (read_reply->size < (0x2000 - header_size) && read_reply->size > 0) {
+	memcpy(temp_buffer + header_size, read_reply->data, read_reply->size);
 	_client_tcp_port->blocking = 0;
 	if (sendn
-	    (_client_tcp_port->socket_fd, temp_buffer, 20 + read_reply->size,
-		0, dtimeout) < 0) {
+	    (_client_tcp_port->socket_fd, temp_buffer,
+		header_size + read_reply->size, 0, dtimeout) < 0) {
 	    _client_tcp_port->blocking = 0;
 	    _client_tcp_port->errors++;
 	    _client_tcp_port->blocking_read_req = NULL;
@@ -603,8 +643,8 @@ void *tcpsvr_handle_blocking_request(void *_req)
 	}
     } else {
 	_client_tcp_port->blocking = 0;
-	if (sendn(_client_tcp_port->socket_fd, temp_buffer, 20, 0, dtimeout) <
-	    0) {
+	if (sendn(_client_tcp_port->socket_fd, temp_buffer, header_size, 0,
+		dtimeout) < 0) {
 	    _client_tcp_port->blocking = 0;
 	    _client_tcp_port->errors++;
 	    _client_tcp_port->blocking_read_req = NULL;
@@ -644,7 +684,6 @@ void *tcpsvr_handle_blocking_request(void *_req)
 void CMS_SERVER_REMOTE_TCP_PORT::handle_request(CLIENT_TCP_PORT *
     _client_tcp_port)
 {
-    CLIENT_TCP_PORT *client_port_to_check = NULL;
     pid_t pid = getpid();
     pid_t tid = 0;
     CMS_SERVER *server;
@@ -663,20 +702,8 @@ void CMS_SERVER_REMOTE_TCP_PORT::handle_request(CLIENT_TCP_PORT *
     if (_client_tcp_port->errors >= _client_tcp_port->max_errors) {
 	rcs_print_error("Too many errors - closing connection(%d)\n",
 	    _client_tcp_port->socket_fd);
-	client_port_to_check = (CLIENT_TCP_PORT *) client_ports->get_head();
-	while (NULL != client_port_to_check) {
-	    if (client_port_to_check->socket_fd ==
-		_client_tcp_port->socket_fd) {
-		delete client_port_to_check;
-		client_ports->delete_current_node();
-	    }
-	    client_port_to_check =
-		(CLIENT_TCP_PORT *) client_ports->get_next();
-	}
-	close(_client_tcp_port->socket_fd);
-	current_clients--;
-	FD_CLR(_client_tcp_port->socket_fd, &read_fd_set);
-	_client_tcp_port->socket_fd = -1;
+	close_client_port(_client_tcp_port);
+	return;
     }
 
     if (recvn(_client_tcp_port->socket_fd, temp_buffer, 20, 0, -1, NULL) < 0) {
@@ -733,7 +760,6 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
     long request_type, long buffer_number, long received_serial_number)
 {
     int total_subdivisions = 1;
-    CLIENT_TCP_PORT *client_port_to_check = NULL;
     switch (request_type) {
     case REMOTE_CMS_SET_DIAG_INFO_REQUEST_TYPE:
 	{
@@ -999,6 +1025,16 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	    = new TCPSVR_BLOCKING_READ_REQUEST();
 #endif
 	    blocking_read_req->buffer_number = buffer_number;
+	    blocking_read_req->delta = 0;
+	    TCP_CLIENT_DELTA_INFO *delta_info =
+		_client_tcp_port->get_delta_info(buffer_number);
+	    if (NULL != delta_info) {
+		/* The reply is sent from another thread or process, which
+		   cannot update the base kept here. */
+		blocking_read_req->delta = 1;
+		delta_info->last_id_sent = -1;
+		delta_info->size = 0;
+	    }
 	    blocking_read_req->access_type =
 		ntohl(*((uint32_t *) temp_buffer + 3));
 	    blocking_read_req->last_id_read =
@@ -1146,36 +1182,10 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	    sendn(_client_tcp_port->socket_fd, temp_buffer, 20, 0, dtimeout);
 	    return;
 	}
-	putbe32(temp_buffer, _client_tcp_port->serial_number);
-	putbe32(temp_buffer + 4, server->read_reply->status);
-	putbe32(temp_buffer + 8, server->read_reply->size);
-	putbe32(temp_buffer + 12, server->read_reply->write_id);
-	putbe32(temp_buffer + 16, server->read_reply->was_read);
-	if (server->read_reply->size < (0x2000 - 20)
-	    && server->read_reply->size > 0) {
-	    memcpy(temp_buffer + 20, server->read_reply->data,
-		server->read_reply->size);
-	    if (sendn
-		(_client_tcp_port->socket_fd, temp_buffer,
-		    20 + server->read_reply->size, 0, dtimeout) < 0) {
-		_client_tcp_port->errors++;
-		return;
-	    }
-	} else {
-	    if (sendn
-		(_client_tcp_port->socket_fd, temp_buffer, 20, 0,
-		    dtimeout) < 0) {
-		_client_tcp_port->errors++;
-		return;
-	    }
-	    if (server->read_reply->size > 0) {
-		if (sendn
-		    (_client_tcp_port->socket_fd, server->read_reply->data,
-			server->read_reply->size, 0, dtimeout) < 0) {
-		    _client_tcp_port->errors++;
-		    return;
-		}
-	    }
+	if (send_read_reply(_client_tcp_port, buffer_number,
+		server->read_reply, server->read_req.last_id_read) < 0) {
+	    _client_tcp_port->errors++;
+	    return;
 	}
 	break;
 
@@ -1372,24 +1382,7 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	break;
 
     case REMOTE_CMS_CLOSE_CHANNEL_REQUEST_TYPE:
-	client_port_to_check = (CLIENT_TCP_PORT *) client_ports->get_head();
-	while (NULL != client_port_to_check) {
-	    if (client_port_to_check->socket_fd ==
-		_client_tcp_port->socket_fd) {
-		break;
-	    }
-	    client_port_to_check =
-		(CLIENT_TCP_PORT *) client_ports->get_next();
-	}
-	FD_CLR(_client_tcp_port->socket_fd, &read_fd_set);
-	close(_client_tcp_port->socket_fd);
-	current_clients--;
-	if (NULL != _client_tcp_port->subscriptions) {
-	    remove_subscription_client(_client_tcp_port, buffer_number);
-	}
-	_client_tcp_port->socket_fd = -1;
-	delete _client_tcp_port;
-	client_ports->delete_current_node();
+	close_client_port(_client_tcp_port);
 	break;
 
     case REMOTE_CMS_GET_KEYS_REQUEST_TYPE:
@@ -1494,6 +1487,38 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	}
 	break;
 
+    case REMOTE_CMS_SET_DELTA_REQUEST_TYPE:
+	{
+	    int enable = ntohl(*((uint32_t *) temp_buffer + 3));
+	    int success = 1;
+	    total_subdivisions = 1;
+	    if (max_total_subdivisions > 1) {
+		total_subdivisions =
+		    server->get_total_subdivisions(buffer_number);
+	    }
+	    TCP_CLIENT_DELTA_INFO *delta_info =
+		_client_tcp_port->get_delta_info(buffer_number);
+	    if (enable && total_subdivisions > 1) {
+		/* each subdivision holds a different message */
+		success = 0;
+	    } else if (enable && NULL == delta_info) {
+		if (NULL == _client_tcp_port->deltas) {
+		    _client_tcp_port->deltas = new LinkedList();
+		}
+		delta_info = new TCP_CLIENT_DELTA_INFO();
+		delta_info->buffer_number = buffer_number;
+		_client_tcp_port->deltas->store_at_tail(delta_info,
+		    sizeof(*delta_info), 0);
+	    } else if (!enable && NULL != delta_info) {
+		_client_tcp_port->deltas->delete_current_node();
+		delete delta_info;
+	    }
+	    putbe32(temp_buffer, _client_tcp_port->serial_number);
+	    putbe32(temp_buffer + 4, success);
+	    sendn(_client_tcp_port->socket_fd, temp_buffer, 8, 0, dtimeout);
+	}
+	break;
+
     default:
 	_client_tcp_port->errors++;
 	rcs_print_error("Unrecognized request type received.(%ld)\n",
@@ -1502,6 +1527,108 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
     }
 }
 
+/* Send the reply to a read request or a subscription update.  Clients
+   that turned on delta mode for the buffer only get the bytes that
+   changed since the last message sent to them, if client_id shows that
+   they still have that message (-1 for updates the client did not ask
+   for, which always follow the previous reply on the stream). */
+int CMS_SERVER_REMOTE_TCP_PORT::send_read_reply(CLIENT_TCP_PORT * clnt,
+    long buffer_number, REMOTE_READ_REPLY * reply, long client_id)
+{
+    const char *data = (const char *) reply->data;
+    long data_size = reply->size;
+    TCP_CLIENT_DELTA_INFO *delta_info = NULL;
+    if (reply->size > 0) {
+	delta_info = clnt->get_delta_info(buffer_number);
+    }
+    if (NULL != delta_info) {
+	long needed = reply->size + REMOTE_CMS_DELTA_OVERHEAD;
+	if (needed > delta_buffer_size || needed > delta_info->allocated_size) {
+	    char *new_delta_buffer = (char *) realloc(delta_buffer, needed);
+	    char *new_base = (char *) realloc(delta_info->data, needed);
+	    if (NULL != new_delta_buffer) {
+		delta_buffer = new_delta_buffer;
+		delta_buffer_size = needed;
+	    }
+	    if (NULL != new_base) {
+		delta_info->data = new_base;
+		delta_info->allocated_size = needed;
+	    }
+	    if (NULL == new_delta_buffer || NULL == new_base) {
+		rcs_print_error("TCPSVR: Can't allocate delta buffer.\n");
+		return -1;
+	    }
+	}
+	const char *base = delta_info->data;
+	long common = 0;
+	if (client_id < 0 || client_id == delta_info->last_id_sent) {
+	    common = delta_info->size < reply->size ?
+		delta_info->size : reply->size;
+	}
+	putbe32(delta_buffer, reply->size);
+	long pos = 4;
+	long i = 0;
+	while (i < reply->size) {
+	    while (i < common && base[i] == data[i]) {
+		i++;
+	    }
+	    if (i >= reply->size) {
+		break;
+	    }
+	    /* Runs of matching bytes shorter than a record header are
+	       cheaper to send than to split the record at. */
+	    long start = i, end = i, same = 0;
+	    while (i < reply->size && same < 8) {
+		if (i < common && base[i] == data[i]) {
+		    same++;
+		} else {
+		    same = 0;
+		    end = i + 1;
+		}
+		i++;
+	    }
+	    i = end;
+	    if (pos + 8 + (end - start) > needed) {
+		pos = needed;
+		break;
+	    }
+	    putbe32(delta_buffer + pos, start);
+	    putbe32(delta_buffer + pos + 4, end - start);
+	    memcpy(delta_buffer + pos + 8, data + start, end - start);
+	    pos += 8 + (end - start);
+	}
+	if (pos >= needed) {
+	    putbe32(delta_buffer + 4, 0);
+	    putbe32(delta_buffer + 8, reply->size);
+	    memcpy(delta_buffer + 12, data, reply->size);
+	    pos = needed;
+	}
+	memcpy(delta_info->data, data, reply->size);
+	delta_info->size = reply->size;
+	delta_info->last_id_sent = reply->write_id;
+	data = delta_buffer;
+	data_size = pos;
+    }
+
+    putbe32(temp_buffer, clnt->serial_number);
+    putbe32(temp_buffer + 4, reply->status);
+    putbe32(temp_buffer + 8, data_size);
+    putbe32(temp_buffer + 12, reply->write_id);
+    putbe32(temp_buffer + 16, reply->was_read);
+    if (data_size < (0x2000 - 20) && data_size > 0) {
+	memcpy(temp_buffer + 20, data, data_size);
+	return sendn(clnt->socket_fd, temp_buffer, 20 + data_size, 0,
+	    dtimeout);
+    }
+    if (sendn(clnt->socket_fd, temp_buffer, 20, 0, dtimeout) < 0) {
+	return -1;
+    }
+    if (data_size > 0) {
+	return sendn(clnt->socket_fd, data, data_size, 0, dtimeout);
+    }
+    return 0;
+}
+
 void CMS_SERVER_REMOTE_TCP_PORT::add_subscription_client(int buffer_number,
     int subscription_type, int poll_interval_millis, CLIENT_TCP_PORT * clnt)
 {
@@ -1528,6 +1655,14 @@ void CMS_SERVER_REMOTE_TCP_PORT::add_subscription_client(int buffer_number,
 	buf_info->list_id =
 	    subscription_buffers->store_at_tail(buf_info, sizeof(*buf_info),
 	    0);
+	CMS_SERVER *server = find_server(getpid(), 0);
+	if (NULL != server) {
+	    CMS_SERVER_LOCAL_PORT *local_port =
+		server->find_local_port(buffer_number);
+	    if (NULL != local_port) {
+		watch_writes(buf_info, local_port->cms);
+	    }
+	}
     }
     buf_info->min_last_id = 0;
     if (NULL == clnt->subscriptions) {
@@ -1668,11 +1803,6 @@ void CMS_SERVER_REMOTE_TCP_PORT::update_subscriptions()
 		subscription_buffers->get_next();
 	    continue;
 	}
-	putbe32(temp_buffer, 0);
-	putbe32(temp_buffer + 4, server->read_reply->status);
-	putbe32(temp_buffer + 8, server->read_reply->size);
-	putbe32(temp_buffer + 12, server->read_reply->write_id);
-	putbe32(temp_buffer + 16, server->read_reply->was_read);
 	TCP_CLIENT_SUBSCRIPTION_INFO *temp_clnt_info =
 	    (TCP_CLIENT_SUBSCRIPTION_INFO *) buf_info->sub_clnt_info->
 	    get_head();
@@ -1692,31 +1822,10 @@ void CMS_SERVER_REMOTE_TCP_PORT::update_subscriptions()
 		temp_clnt_info->last_id_read = server->read_reply->write_id;
 		temp_clnt_info->last_sub_sent_time = cur_time;
 		temp_clnt_info->clnt_port->serial_number++;
-		putbe32(temp_buffer, temp_clnt_info->clnt_port->serial_number);
-		if (server->read_reply->size < 0x2000 - 20
-		    && server->read_reply->size > 0) {
-		    memcpy(temp_buffer + 20, server->read_reply->data,
-			server->read_reply->size);
-		    if (sendn
-			(temp_clnt_info->clnt_port->socket_fd, temp_buffer,
-			    20 + server->read_reply->size, 0, dtimeout) < 0) {
-			temp_clnt_info->clnt_port->errors++;
-			return;
-		    }
-		} else {
-		    if (sendn(temp_clnt_info->clnt_port->socket_fd,
-			    temp_buffer, 20, 0, dtimeout) < 0) {
-			temp_clnt_info->clnt_port->errors++;
-			return;
-		    }
-		    if (server->read_reply->size > 0) {
-			if (sendn(temp_clnt_info->clnt_port->socket_fd,
-				server->read_reply->data,
-				server->read_reply->size, 0, dtimeout) < 0) {
-			    temp_clnt_info->clnt_port->errors++;
-			    return;
-			}
-		    }
+		if (send_read_reply(temp_clnt_info->clnt_port,
+			buf_info->buffer_number, server->read_reply, -1) < 0) {
+		    temp_clnt_info->clnt_port->errors++;
+		    return;
 		}
 	    }
 	    if (temp_clnt_info->last_id_read < buf_info->min_last_id) {
@@ -1730,16 +1839,72 @@ void CMS_SERVER_REMOTE_TCP_PORT::update_subscriptions()
     }
 }
 
+/* Buffers that keep a write count (SHMEM with 'notify') get a child
+   process that sleeps on it and posts notify_fd after every write, so
+   that subscribers are sent each new message right away instead of at
+   the next poll or request.  A child rather than a thread, as for
+   blocking reads. */
+void CMS_SERVER_REMOTE_TCP_PORT::watch_writes(TCP_BUFFER_SUBSCRIPTION_INFO *
+    buf_info, CMS * cms)
+{
+    unsigned int count;
+    if (notify_fd < 0 || NULL == cms || cms->get_write_count(&count) < 0) {
+	return;
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+	rcs_print_error("TCPSVR: fork error: %d %s\n", errno,
+	    strerror(errno));
+	return;
+    }
+    if (pid > 0) {
+	buf_info->watcher_pid = pid;
+	return;
+    }
+
+    /* Keep nothing but notify_fd open, so that client connections the
+       server closes are really closed. */
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    long max_fd = sysconf(_SC_OPEN_MAX);
+    for (int fd = 3; fd < max_fd; fd++) {
+	if (fd != notify_fd) {
+	    close(fd);
+	}
+    }
+    pid_t parent = getppid();
+    while (getppid() == parent) {
+	int ret = cms->wait_for_write(count, 1.0);
+	if (ret < 0) {
+	    break;
+	}
+	if (ret > 0) {
+	    cms->get_write_count(&count);
+	    uint64_t one = 1;
+	    if (write(notify_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+		break;
+	    }
+	}
+    }
+    _exit(0);
+}
+
 TCP_BUFFER_SUBSCRIPTION_INFO::TCP_BUFFER_SUBSCRIPTION_INFO()
 {
     buffer_number = -1;
     min_last_id = 0;
     list_id = -1;
     sub_clnt_info = NULL;
+    watcher_pid = 0;
 }
 
 TCP_BUFFER_SUBSCRIPTION_INFO::~TCP_BUFFER_SUBSCRIPTION_INFO()
 {
+    if (watcher_pid > 0) {
+	kill(watcher_pid, SIGTERM);
+	waitpid(watcher_pid, NULL, 0);
+	watcher_pid = 0;
+    }
     buffer_number = -1;
     min_last_id = 0;
     list_id = -1;
@@ -1775,6 +1940,23 @@ TCP_CLIENT_SUBSCRIPTION_INFO::~TCP_CLIENT_SUBSCRIPTION_INFO()
     clnt_port = NULL;
 }
 
+TCP_CLIENT_DELTA_INFO::TCP_CLIENT_DELTA_INFO()
+{
+    buffer_number = -1;
+    last_id_sent = -1;
+    size = 0;
+    allocated_size = 0;
+    data = NULL;
+}
+
+TCP_CLIENT_DELTA_INFO::~TCP_CLIENT_DELTA_INFO()
+{
+    if (NULL != data) {
+	free(data);
+	data = NULL;
+    }
+}
+
 CLIENT_TCP_PORT::CLIENT_TCP_PORT()
 {
     serial_number = 0;
@@ -1785,6 +1967,7 @@ CLIENT_TCP_PORT::CLIENT_TCP_PORT()
     address.sin_addr.s_addr = htonl(INADDR_ANY);
     socket_fd = -1;
     subscriptions = NULL;
+    deltas = NULL;
     tid = -1;
     pid = -1;
     blocking_read_req = NULL;
@@ -1809,6 +1992,16 @@ CLIENT_TCP_PORT::~CLIENT_TCP_PORT()
 	delete subscriptions;
 	subscriptions = NULL;
     }
+    if (NULL != deltas) {
+	TCP_CLIENT_DELTA_INFO *delta_info =
+	    (TCP_CLIENT_DELTA_INFO *) deltas->get_head();
+	while (NULL != delta_info) {
+	    delete delta_info;
+	    delta_info = (TCP_CLIENT_DELTA_INFO *) deltas->get_next();
+	}
+	delete deltas;
+	deltas = NULL;
+    }
 #ifdef NO_THREADS
     if (NULL != blocking_read_req) {
 	delete blocking_read_req;
@@ -1820,3 +2013,20 @@ CLIENT_TCP_PORT::~CLIENT_TCP_PORT()
 	diag_info = NULL;
     }
 }
+
+/* Leaves the list positioned on the entry found. */
+TCP_CLIENT_DELTA_INFO *CLIENT_TCP_PORT::get_delta_info(int buffer_number)
+{
+    if (NULL == deltas) {
+	return NULL;
+    }
+    TCP_CLIENT_DELTA_INFO *delta_info =
+	(TCP_CLIENT_DELTA_INFO *) deltas->get_head();
+    while (NULL != delta_info) {
+	if (delta_info->buffer_number == buffer_number) {
+	    break;
+	}
+	delta_info = (TCP_CLIENT_DELTA_INFO *) deltas->get_next();
+    }
+    return delta_info;
+}
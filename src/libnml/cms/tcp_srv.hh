@@ -42,7 +42,9 @@ extern "C" {
 #endif
 
 #define MAX_TCP_BUFFER_SIZE 16
+#define TCP_SERVER_MAX_EVENTS 64
 class CLIENT_TCP_PORT;
+class TCP_BUFFER_SUBSCRIPTION_INFO;
 
 class CMS_SERVER_REMOTE_TCP_PORT:public CMS_SERVER_REMOTE_PORT {
   public:
@@ -54,9 +56,11 @@ class CMS_SERVER_REMOTE_TCP_PORT:public CMS_SERVER_REMOTE_PORT {
     void unregister_port();
     double dtimeout;
   protected:
-      fd_set read_fd_set, write_fd_set;
     void handle_request(CLIENT_TCP_PORT *);
-    int maxfdpl;
+    void close_client_port(CLIENT_TCP_PORT *);
+    int watch_fd(int fd, void *ptr);
+    int epoll_fd;
+    int max_connections;	/* 0 for no limit */
     LinkedList *client_ports;
     LinkedList *subscription_buffers;
     int connection_socket;
@@ -77,6 +81,12 @@ class CMS_SERVER_REMOTE_TCP_PORT:public CMS_SERVER_REMOTE_PORT {
 	_client_tcp_port,
 	CMS_SERVER * server, long request_type, long buffer_number, long
 	received_serial_number);
+    int send_read_reply(CLIENT_TCP_PORT * clnt, long buffer_number,
+	REMOTE_READ_REPLY * reply, long client_id);
+    char *delta_buffer;
+    long delta_buffer_size;
+    int notify_fd;
+    void watch_writes(TCP_BUFFER_SUBSCRIPTION_INFO * buf_info, CMS * cms);
 };
 
 class TCP_BUFFER_SUBSCRIPTION_INFO {
@@ -87,6 +97,7 @@ class TCP_BUFFER_SUBSCRIPTION_INFO {
     int min_last_id;
     int list_id;
     LinkedList *sub_clnt_info;
+    pid_t watcher_pid;
 };
 
 class TCP_CLIENT_SUBSCRIPTION_INFO {
@@ -104,6 +115,19 @@ class TCP_CLIENT_SUBSCRIPTION_INFO {
     CLIENT_TCP_PORT *clnt_port;
 };
 
+/* The last message sent in delta mode to one client for one buffer; the
+   next reply for that buffer only carries the bytes that differ from it. */
+class TCP_CLIENT_DELTA_INFO {
+  public:
+    TCP_CLIENT_DELTA_INFO();
+    ~TCP_CLIENT_DELTA_INFO();
+    int buffer_number;
+    long last_id_sent;
+    long size;
+    long allocated_size;
+    char *data;
+};
+
 class TCPSVR_BLOCKING_READ_REQUEST;
 
 class CLIENT_TCP_PORT {
@@ -115,6 +139,8 @@ class CLIENT_TCP_PORT {
     struct sockaddr_in address;
     int socket_fd;
     LinkedList *subscriptions;
+    LinkedList *deltas;
+    TCP_CLIENT_DELTA_INFO *get_delta_info(int buffer_number);
     pid_t tid;
     pid_t pid;
     int blocking;
@@ -136,6 +162,7 @@ class TCPSVR_BLOCKING_READ_REQUEST:public REMOTE_BLOCKING_READ_REQUEST {
     CMS_SERVER_REMOTE_TCP_PORT *remport;
     CMS_SERVER *server;
     REMOTE_BLOCKING_READ_REPLY *read_reply;
+    int delta;
 };
 
 #endif /* TCP_SRV_HH */
@@ -18,6 +18,9 @@
 #include <string.h>             /* strstr() */
 #include <ctype.h>              /* isspace() */
 #include <fcntl.h>
+#include <map>
+#include <string>
+#include <vector>
 
 
 #include "config.h"
@@ -25,6 +28,30 @@
 
 #define MAX_EXTEND_LINES 20
 
+/* The characters that may follow a tag on its line. */
+#define TAG_END " \r\t\n="
+
+/* Every tag found while reading the file on Open(), so that Find() does
+   not have to read the file again.  The index keeps the order of the
+   file: a tag's values are listed as they appear, sections are entered
+   the first time their [section] line is seen, and a section's tags run
+   up to the next line starting with '['. */
+struct IniValue {
+    bool                        found;  /* false if there is no value after '=' */
+    std::string                 value;
+    unsigned int                lineNo;
+};
+
+struct IniSection {
+    std::map<std::string, std::vector<IniValue> > tags;
+    unsigned int                endLine;    /* line that ends the section */
+};
+
+struct IniFile::Index {
+    IniSection                  all;        /* tags in any section */
+    std::map<std::string, IniSection> sections;
+};
+
 /// Return TRUE if the line has a line-ending problem
 static bool check_line_endings(const char *s) {
     if(!s) return false;
@@ -50,6 +77,7 @@ IniFile::IniFile(int _errMask, FILE *_fp)
     fp = _fp;
     errMask = _errMask;
     owned = false;
+    index = NULL;
 
     if(fp != NULL)
         LockFile();
@@ -77,6 +105,12 @@ IniFile::Open(const char *file)
     if(!LockFile())
         return(false);
 
+    index = new Index;
+    if(!BuildIndex()){
+        delete index;
+        index = NULL;
+    }
+
     return(true);
 }
 
@@ -99,6 +133,9 @@ IniFile::Close()
         fp = NULL;
     }
 
+    delete index;
+    index = NULL;
+
     return(rVal == 0);
 }
 
@@ -217,6 +254,12 @@ IniFile::Find(const char *_tag, const char *_section, int _num, int *lineno)
     if(!CheckIfOpen())
         return(NULL);
 
+    /* tags and sections that the index cannot give the same answer for
+       are left to the scan below */
+    if(index != NULL && strpbrk(tag, TAG_END) == NULL
+       && (section == NULL || strchr(section, ']') == NULL))
+        return(FindIndexed(lineno));
+
     /* start from beginning */
     rewind(fp);
 
@@ -378,6 +421,50 @@ IniFile::Find(const char *_tag, const char *_section, int _num, int *lineno)
     return(NULL);
 }
 
+/*! Looks up the tag in the index built by Open(), with the same result
+   and exceptions as reading the file.
+
+   @return pointer to the the variable after the '=' delimiter */
+const char *
+IniFile::FindIndexed(int *lineno)
+{
+    static char                 value[(LINELEN + 2) * (MAX_EXTEND_LINES + 1)];
+    const IniSection            *s = &index->all;
+
+    if(section != NULL){
+        std::map<std::string, IniSection>::const_iterator it =
+            index->sections.find(section);
+        if(it == index->sections.end()){
+            lineNo = index->all.endLine;
+            ThrowException(ERR_SECTION_NOT_FOUND);
+            return(NULL);
+        }
+        s = &it->second;
+    }
+
+    std::map<std::string, std::vector<IniValue> >::const_iterator t =
+        s->tags.find(tag);
+    size_t n = num > 1 ? num - 1 : 0;
+    if(t == s->tags.end() || n >= t->second.size()){
+        lineNo = s->endLine;
+        ThrowException(ERR_TAG_NOT_FOUND);
+        return(NULL);
+    }
+
+    const IniValue &v = t->second[n];
+    lineNo = v.lineNo;
+    if(!v.found){
+        ThrowException(ERR_TAG_NOT_FOUND);
+        return(NULL);
+    }
+
+    /* callers may keep the pointer after the file is closed */
+    snprintf(value, sizeof(value), "%s", v.value.c_str());
+    if (lineno)
+        *lineno = lineNo;
+    return(value);
+}
+
 const char *
 IniFile::FindString(char *dest, size_t n, const char *_tag, const char *_section, int _num, int *lineno)
 {
@@ -416,6 +503,116 @@ IniFile::CheckIfOpen(void)
 }
 
 
+/*! Reads the whole file once into the index, joining lines continued
+   with a backslash as Find() does.
+
+   @return false if the file has something (ambiguous carriage returns,
+   too many continued lines) that is to be reported when a Find() comes
+   across it, which only the scan in Find() does */
+bool
+IniFile::BuildIndex(void)
+{
+    char                        line[LINELEN + 2];
+    char                        eline[(LINELEN + 2) * (MAX_EXTEND_LINES + 1)];
+    char                        *elineptr = line;
+    char                        *elinenext = eline;
+    int                         extend_ct = 0;
+    unsigned int                count = 0;
+    IniSection                  *current = NULL;
+
+    rewind(fp);
+
+    while(fgets(line, LINELEN + 1, fp) != NULL){
+        if(check_line_endings(line))
+            return(false);
+
+        count++;
+
+        /* strip off newline */
+        int newLinePos = strlen(line) - 1;
+        if (newLinePos < 0) {
+            newLinePos = 0;
+        }
+        if (line[newLinePos] == '\n') {
+            line[newLinePos] = 0;
+        }
+        // honor backslash (\) as line-end escape
+        if (newLinePos > 0 && line[newLinePos-1] == '\\') {
+            newLinePos = newLinePos-1;
+            line[newLinePos] = 0;
+            if (!extend_ct) {
+                elineptr = eline;
+                elinenext = eline;
+            }
+            strncpy(elinenext,line,newLinePos);
+            elinenext = elinenext + newLinePos;
+            *elinenext = 0;
+            if (++extend_ct > MAX_EXTEND_LINES)
+                return(false);
+            continue;
+        }
+        if (extend_ct) {
+            strncpy(elinenext,line,newLinePos);
+            elinenext = elinenext + newLinePos;
+            *elinenext = 0;
+        } else {
+            elineptr = line;
+        }
+        extend_ct = 0;
+
+        char *nonWhite = SkipWhite(elineptr);
+        if (nonWhite == NULL)
+            continue;
+
+        bool header = false;
+        if (nonWhite[0] == '[') {
+            /* ends the section we are in; only the first [section] of a
+               name is searched */
+            if (current != NULL)
+                current->endLine = count;
+            current = NULL;
+            const char *close = strchr(nonWhite, ']');
+            if (close != NULL) {
+                std::string name(nonWhite + 1, close - nonWhite - 1);
+                if (index->sections.find(name) == index->sections.end()) {
+                    current = &index->sections[name];
+                    header = true;
+                }
+            }
+        }
+
+        size_t len = strcspn(nonWhite, TAG_END);
+        if (nonWhite[len] == 0)
+            continue;
+
+        IniValue v;
+        v.lineNo = count;
+        char *valueString = AfterEqual(nonWhite + len);
+        v.found = valueString != NULL;
+        if (v.found) {
+            char *endValueString = valueString + strlen(valueString) - 1;
+            while (*endValueString == ' ' || *endValueString == '\t'
+                   || *endValueString == '\r') {
+                *endValueString = 0;
+                endValueString--;
+            }
+            v.value = valueString;
+        }
+
+        std::string key(nonWhite, len);
+        index->all.tags[key].push_back(v);
+        if (current != NULL && !header)
+            current->tags[key].push_back(v);
+    }
+
+    if (current != NULL)
+        current->endLine = count;
+    index->all.endLine = count;
+
+    return(true);
+}
+
+
 bool
 IniFile::LockFile(void)
 {
@@ -143,9 +143,12 @@ protected:
 
 
 private:
+    struct Index;
+
     FILE                        *fp;
     struct flock                lock;
     bool                        owned;
+    Index                       *index;
 
     Exception                   exception;
     int                         errMask;
@@ -157,9 +160,14 @@ private:
 
     bool                        CheckIfOpen(void);
     bool                        LockFile(void);
+    bool                        BuildIndex(void);
+    const char *                FindIndexed(int *lineno);
     void                        ThrowException(ErrorCode);
     char                        *AfterEqual(const char *string);
     char                        *SkipWhite(const char *string);
+
+                                IniFile(const IniFile &);
+    IniFile &                   operator=(const IniFile &);
 };
 #endif
 
@@ -18,10 +18,67 @@ extern "C" {
 #include <stdlib.h>		/* malloc() */
 #include <string.h>		/* memcpy() */
 #include <stdio.h>		/* fprintf(), stderr */
+#include <pthread.h>		/* pthread_mutex_lock() */
 #ifdef __cplusplus
 }
 #endif
+#include <new>			/* operator new */
 #include "linklist.hh"		/* class LinkedList */
+
+/* Nodes come from a free list shared by all the lists, filled a block at
+   a time and never given back, so once the lists have grown to their
+   working size storing and deleting nodes doesn't go to malloc. */
+#define LINKED_LIST_NODE_BLOCK 64
+
+struct free_node {
+    free_node *next;
+};
+
+static pthread_mutex_t node_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static free_node *node_pool = NULL;
+
+void *LinkedListNode::operator new(size_t _size)
+{
+    if (_size != sizeof(LinkedListNode)) {
+	return ::operator new(_size);
+    }
+    pthread_mutex_lock(&node_pool_mutex);
+    if (NULL == node_pool) {
+	char *block =
+	    (char *) malloc(sizeof(LinkedListNode) * LINKED_LIST_NODE_BLOCK);
+	if (NULL == block) {
+	    pthread_mutex_unlock(&node_pool_mutex);
+	    return ::operator new(_size);
+	}
+	for (int i = 0; i < LINKED_LIST_NODE_BLOCK; i++) {
+	    free_node *node =
+		(free_node *) (block + i * sizeof(LinkedListNode));
+	    node->next = node_pool;
+	    node_pool = node;
+	}
+    }
+    free_node *node = node_pool;
+    node_pool = node->next;
+    pthread_mutex_unlock(&node_pool_mutex);
+    return node;
+}
+
+void LinkedListNode::operator delete(void *_node, size_t _size)
+{
+    if (NULL == _node) {
+	return;
+    }
+    if (_size != sizeof(LinkedListNode)) {
+	::operator delete(_node);
+	return;
+    }
+    pthread_mutex_lock(&node_pool_mutex);
+    free_node *node = (free_node *) _node;
+    node->next = node_pool;
+    node_pool = node;
+    pthread_mutex_unlock(&node_pool_mutex);
+}
+
 LinkedListNode::LinkedListNode(void *_data, size_t _size)
 {
     data = _data;
@@ -42,6 +42,9 @@ class LinkedListNode {
     friend class LinkedList;
       LinkedListNode(void *_data, size_t _size);
      ~LinkedListNode();
+    /* Nodes are kept in a pool rather than freed. */
+    static void *operator new(size_t _size);
+    static void operator delete(void *_node, size_t _size);
 };
 
 class LinkedList {
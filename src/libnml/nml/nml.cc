@@ -43,6 +43,7 @@ extern "C" {
 #define MAXHOSTNAMELEN 64
 #endif
 #include "nmldiag.hh"		// NML_DIAGNOSTICS_INFO
+#include "cmsstats.hh"		// struct CMS_STATS_PROC
 /* Pointer to a global list of NML channels. */
 LinkedList *NML_Main_Channel_List = (LinkedList *) NULL;
 
@@ -233,6 +234,8 @@ void NML::reconstruct(NML_FORMAT_PTR f_ptr, const char *buf, const char *proc,
     error_type = NML_NO_ERROR;
     fast_mode = 0;
     ignore_format_chain = 0;
+    last_format_type = 0;
+    last_format_function = NULL;
     info_printed = 0;
 
     format_chain = new LinkedList;
@@ -361,6 +364,8 @@ NML::NML(const char *buf, const char *proc, const char *file, int set_to_server,
     channel_list_id = 0;
     error_type = NML_NO_ERROR;
     ignore_format_chain = 0;
+    last_format_type = 0;
+    last_format_function = NULL;
     fast_mode = 0;
 
     channel_type = NML_GENERIC_CHANNEL_TYPE;
@@ -473,6 +478,8 @@ NML::NML(const char *buffer_line, const char *proc_line)
     channel_list_id = 0;
     error_type = NML_NO_ERROR;
     ignore_format_chain = 0;
+    last_format_type = 0;
+    last_format_function = NULL;
     fast_mode = 0;
 
     channel_type = NML_GENERIC_CHANNEL_TYPE;
@@ -610,6 +617,8 @@ NML::NML(NML * nml_ptr, int set_to_server, int set_to_master)
     format_chain = (LinkedList *) NULL;
     error_type = NML_NO_ERROR;
     ignore_format_chain = 0;
+    last_format_type = 0;
+    last_format_function = NULL;
     channel_list_id = 0;
     fast_mode = 0;
     info_printed = 0;
@@ -1385,6 +1394,98 @@ NMLTYPE NML::peek()
 
 }
 
+/***********************************************************
+* NML Member Function: peek_in_place()
+* Purpose: Zero-copy version of peek(). Instead of copying the
+* message into the local buffer, *msg is pointed at the message in
+* the shared memory buffer.
+* Returns:
+*  0 The data was not updated since the last read.
+*  -1 The buffer could not be read, or does not support it.
+*  o.w. The type of the new NMLmsg is returned.
+* Notes:
+*  1. Only local SHMEM buffers with zerocopy in the buffer line
+* support it; check can_peek_in_place() and use peek() otherwise.
+*  2. The message may be changed by a writer at any time. Copy what
+* is needed from *msg, then call peek_in_place_done(sequence); if that
+* returns 0 the copy may be torn and the peek must be repeated.
+* The message only counts as read once peek_in_place_done() has
+* returned 1.
+***********************************************************/
+NMLTYPE NML::peek_in_place(const NMLmsg ** msg, unsigned long *sequence)
+{
+    error_type = NML_NO_ERROR;
+    if (NULL == cms) {
+	if (error_type != NML_INVALID_CONFIGURATION) {
+	    error_type = NML_INVALID_CONFIGURATION;
+	    rcs_print_error("NML::peek_in_place: CMS not configured.\n");
+	}
+	return (-1);
+    }
+
+    const void *message;
+    cms->peek_in_place(&message, sequence);
+    switch (cms->status) {
+    case CMS_READ_OLD:
+	*msg = (const NMLmsg *) message;
+	return (0);
+    case CMS_READ_OK:
+	*msg = (const NMLmsg *) message;
+	/* not checked for a valid type: that is only safe to do after
+	   peek_in_place_done() */
+	return (((const NMLmsg *) message)->type);
+
+    default:
+	set_error();
+	return -1;
+    }
+}
+
+int NML::peek_in_place_done(unsigned long sequence)
+{
+    if (NULL == cms) {
+	return 0;
+    }
+    return cms->peek_in_place_done(sequence);
+}
+
+int NML::can_peek_in_place()
+{
+    return NULL != cms && cms->zero_copy && !cms->is_phantom;
+}
+
+/* Copies the message into dest if it is new, with peek_in_place when the
+   buffer allows it and with peek() otherwise.  A poll that finds nothing
+   new then only compares the write sequence, without the mutex or a copy.
+   Returns the type of a new message, 0 if there is none and -1 on error. */
+NMLTYPE NML::peek_copy(void *dest, size_t size)
+{
+    if (!can_peek_in_place()) {
+	NMLTYPE type = peek();
+	if (type > 0 && dest != get_address()) {
+	    memcpy(dest, get_address(), size);
+	}
+	return type;
+    }
+    const NMLmsg *msg;
+    unsigned long sequence;
+    NMLTYPE type;
+    /* retry if a write overlapped the copy */
+    while ((type = peek_in_place(&msg, &sequence)) > 0) {
+	memcpy(dest, msg, size);
+	if (peek_in_place_done(sequence)) {
+	    break;
+	}
+    }
+    if (type > 0 && ((NMLmsg *) dest)->type <= 0) {
+	rcs_print_error
+	    ("NML: New data recieved but type of %d is invalid.\n",
+	    (int) ((NMLmsg *) dest)->type);
+	return -1;
+    }
+    return type;
+}
+
 /***********************************************************
 * NML Member Function: format_output()
 * Purpose: Formats the data read from a CMS buffer as required
@@ -1430,6 +1531,11 @@ int NML::format_output()
 	new_type = forced_type;
     }
 
+    double format_start = 0;
+    if (NULL != cms->stats_proc && cms->mode != CMS_RAW_OUT) {
+	format_start = etime();
+    }
+
     switch (cms->mode) {
     case CMS_RAW_OUT:
 	break;
@@ -1553,6 +1659,10 @@ int NML::format_output()
     if (forced_type > 0) {
 	((NMLmsg *) cms->subdiv_data)->type = forced_type;
     }
+    if (NULL != cms->stats_proc && cms->mode != CMS_RAW_OUT) {
+	cms->stats_proc->formats++;
+	cms->stats_proc->format_time += etime() - format_start;
+    }
 
     return (((int) cms->status < 0) ? -1 : 0);
 }
@@ -1842,6 +1952,11 @@ int NML::format_input(NMLmsg * nml_msg)
 	cms->mode = CMS_RAW_IN;
     }
 
+    double format_start = 0;
+    if (NULL != cms->stats_proc && cms->mode != CMS_RAW_IN) {
+	format_start = etime();
+    }
+
     switch (cms->mode) {
     case CMS_RAW_IN:
 	/* Make sure the message size is not larger than the buffer size. */
@@ -1942,6 +2057,10 @@ int NML::format_input(NMLmsg * nml_msg)
 	rcs_print_error("NML::format_input: invalid mode (%d).\n", cms->mode);
 	return (-1);
     }
+    if (NULL != cms->stats_proc && cms->mode != CMS_RAW_IN) {
+	cms->stats_proc->formats++;
+	cms->stats_proc->format_time += etime() - format_start;
+    }
 
     return (((int) cms->status < 0) ? -1 : 0);
 }
@@ -1950,6 +2069,17 @@ int NML::run_format_chain(NMLTYPE type, void *buf)
 {
     NML_FORMAT_PTR format_function;
 
+    /* Most channels carry the same type over and over; go straight to
+       the function that took it last time. */
+    if (NULL != last_format_function && type == last_format_type) {
+	switch ((*last_format_function) (type, buf, cms)) {
+	case -1:
+	    return (-1);
+	case 1:
+	    return (0);
+	}
+    }
+
     format_function = (NML_FORMAT_PTR) format_chain->get_head();
     while (NULL != format_function) {
 	switch ((*format_function) (type, buf, cms)) {
@@ -1958,6 +2088,8 @@ int NML::run_format_chain(NMLTYPE type, void *buf)
 	case 0:
 	    break;
 	case 1:
+	    last_format_type = type;
+	    last_format_function = format_function;
 	    return (0);
 	}
 	format_function = (NML_FORMAT_PTR) format_chain->get_next();
@@ -1973,6 +2105,7 @@ int NML::prefix_format_chain(NML_FORMAT_PTR f_ptr)
     if (NULL != format_chain) {
 	format_chain->store_at_head((void *) f_ptr, 0, 0);
     }
+    last_format_function = NULL;
     return (0);
 }
 
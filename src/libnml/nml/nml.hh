@@ -66,6 +66,8 @@ class NML_DIAGNOSTICS_INFO;
 class NML:public virtual CMS_USER {
   protected:
     int run_format_chain(NMLTYPE, void *);
+    NMLTYPE last_format_type;	/* type last formatted, and the function */
+    NML_FORMAT_PTR last_format_function;	/* in the chain that took it */
     int format_input(NMLmsg * nml_msg);	/* Format message if neccessary */
     int format_output();	/* Decode message if neccessary. */
 
@@ -97,6 +99,10 @@ class NML:public virtual CMS_USER {
     NMLTYPE peek();		/* Read buffer without changing was_read */
     NMLTYPE read(void *, long);
     NMLTYPE peek(void *, long);
+    NMLTYPE peek_in_place(const NMLmsg ** msg, unsigned long *sequence);	/* Zero-copy peek */
+    int peek_in_place_done(unsigned long sequence);
+    int can_peek_in_place();
+    NMLTYPE peek_copy(void *dest, size_t size);	/* Copy out if new */
     int write(NMLmsg & nml_msg, int *serial_number = NULL);	/* Write a message. (Use reference) */
     int write(NMLmsg * nml_msg, int *serial_number = NULL);	/* Write a message. (Use pointer) */
     int write_if_read(NMLmsg & nml_msg, int *serial_number = NULL);	/* Write only if buffer
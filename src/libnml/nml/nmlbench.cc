@@ -0,0 +1,500 @@
+/********************************************************************
+* Description: nmlbench.cc
+*   Measures how fast messages go through NML buffers: the messages per
+*   second a writer can push through a queued buffer to a reader, and
+*   the time from the write to the read of single messages.  The
+*   buffers come from a generated NML file, so that transports,
+*   encodings and buffer options can be compared on one machine.
+*
+*   syntax:  nmlbench [-t shmem|locmem|tcp] [-e native|xdr|ascii|disp|packed]
+*                     [-m small|stat] [-n count] [-i interval] [-P]
+*                     [-r read|blocking|peek] [-b option]... [-k key]
+*
+*   -m stat sends messages the size of the EMC status, -m small ones
+*   the size of a motion command.  -P reads in a process of its own
+*   instead of a thread.  -i is the time between the writes timed for
+*   latency, in microseconds.  -b adds an option such as zerocopy to
+*   the buffer lines.
+*
+* License: GPL Version 2
+* System: Linux
+*
+********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/wait.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "nml.hh"
+#include "nmlmsg.hh"
+#include "nml_srv.hh"		/* run_nml_servers() */
+#include "cms.hh"
+#include "rcs_print.hh"
+#include "timer.hh"		/* esleep() */
+
+extern int cms_print_queue_full_messages;
+
+#define BENCH_SMALL_TYPE ((NMLTYPE) 9901)
+#define BENCH_STAT_TYPE ((NMLTYPE) 9902)
+
+/* About an EMC_TRAJ_LINEAR_MOVE */
+class BENCH_SMALL:public NMLmsg {
+  public:
+    BENCH_SMALL():NMLmsg(BENCH_SMALL_TYPE, sizeof(BENCH_SMALL)) {};
+    void update(CMS *);
+
+    int serial;
+    double sent;		/* CLOCK_MONOTONIC, in seconds */
+    double end[9];
+    double vel, ini_maxvel, acc;
+    int type, feed_mode, indexrotary;
+};
+
+/* About an EMC_STAT: mostly doubles, some ints and a few strings */
+class BENCH_STAT:public NMLmsg {
+  public:
+    BENCH_STAT():NMLmsg(BENCH_STAT_TYPE, sizeof(BENCH_STAT)) {};
+    void update(CMS *);
+
+    int serial;
+    double sent;
+    double d[640];
+    int i[320];
+    char text[4][256];
+};
+
+void BENCH_SMALL::update(CMS * cms)
+{
+    cms->update(serial);
+    cms->update(sent);
+    cms->update(end, 9);
+    cms->update(vel);
+    cms->update(ini_maxvel);
+    cms->update(acc);
+    cms->update(type);
+    cms->update(feed_mode);
+    cms->update(indexrotary);
+}
+
+void BENCH_STAT::update(CMS * cms)
+{
+    cms->update(serial);
+    cms->update(sent);
+    cms->update(d, 640);
+    cms->update(i, 320);
+    for (int k = 0; k < 4; k++) {
+	cms->update(text[k], 256);
+    }
+}
+
+static int bench_format(NMLTYPE type, void *buf, CMS * cms)
+{
+    switch (type) {
+    case BENCH_SMALL_TYPE:
+	((BENCH_SMALL *) buf)->update(cms);
+	return 1;
+    case BENCH_STAT_TYPE:
+	((BENCH_STAT *) buf)->update(cms);
+	return 1;
+    default:
+	return 0;
+    }
+}
+
+/* Both message types start with the serial and the time sent, so
+   either can be looked at as a BENCH_SMALL for those. */
+static BENCH_SMALL *head(NML * nml)
+{
+    return (BENCH_SMALL *) nml->get_address();
+}
+
+static const char *transport = "shmem";
+static const char *encoding = "native";
+static const char *read_mode = "read";
+static int stat_msgs = 0;
+static int count = 10000;
+static double interval = 100e-6;
+static int use_process = 0;
+static std::string options;
+static int key = 0;
+static char cfgfile[] = "/tmp/nmlbench.XXXXXX";
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void usage()
+{
+    fprintf(stderr,
+	"usage: nmlbench [-t shmem|locmem|tcp] [-e native|xdr|ascii|disp|packed]\n"
+	"                [-m small|stat] [-n count] [-i interval] [-P]\n"
+	"                [-r read|blocking|peek] [-b option]... [-k key]\n");
+    exit(1);
+}
+
+/* Writes the NML file: 'bench' for latency and the queued 'benchQueue'
+   for throughput, a master (the TCP server with -t tcp), the writer
+   and the reader, which is remote with -t tcp. */
+static int write_config(long size)
+{
+    int fd = mkstemp(cfgfile);
+    if (fd < 0) {
+	perror("nmlbench: mkstemp");
+	return -1;
+    }
+    FILE *f = fdopen(fd, "w");
+    int tcp = !strcmp(transport, "tcp");
+    int locmem = !strcmp(transport, "locmem");
+    int neutral = tcp ? 0 : strcmp(encoding, "native") != 0;
+    std::string extra;
+    if (strcmp(encoding, "native")) {
+	extra += " ";
+	extra += encoding;
+    }
+    if (tcp) {
+	char port[32];
+	snprintf(port, sizeof(port), " TCP=%d", 5200 + key % 100);
+	extra += port;
+    }
+    extra += options;
+
+    const char *bufs[2] = { "bench", "benchQueue" };
+    for (int k = 0; k < 2; k++) {
+	fprintf(f, "B %-12s %-6s localhost %ld %d 0 %d 8", bufs[k],
+	    locmem ? "LOCMEM" : "SHMEM", size, neutral, k + 1);
+	if (!locmem) {
+	    fprintf(f, " %d", key + k);
+	}
+	fprintf(f, "%s%s\n", extra.c_str(), k ? " queue" : "");
+    }
+    for (int k = 0; k < 2; k++) {
+	fprintf(f, "P master %-12s LOCAL localhost RW %d 5.0 1 0\n",
+	    bufs[k], tcp);
+	fprintf(f, "P writer %-12s LOCAL localhost W 0 5.0 0 1\n", bufs[k]);
+	fprintf(f, "P reader %-12s %s localhost R 0 5.0 0 2\n", bufs[k],
+	    tcp ? "REMOTE" : "LOCAL");
+    }
+    return fclose(f);
+}
+
+/* Reads one message the way -r asks, except that a queue is never
+   peeked.  Returns the type, 0 if nothing new, or -1 on an error. */
+static NMLTYPE read_one(NML * nml, int *serial, int queued)
+{
+    NMLTYPE type;
+    if (!strcmp(read_mode, "blocking")) {
+	type = nml->blocking_read(0.1);
+    } else if (!strcmp(read_mode, "peek") && !queued) {
+	type = nml->peek();
+    } else {
+	type = nml->read();
+    }
+    if (type <= 0) {
+	return type;
+    }
+    if (head(nml)->serial == *serial) {
+	return 0;		/* a peek of one seen before */
+    }
+    *serial = head(nml)->serial;
+    return type;
+}
+
+struct reader_result {
+    int got_queued, got_latest;
+    double first_sent, last_read;
+    std::vector<double> latency;
+    int status;
+};
+
+static void reader(int ready_fd, reader_result * r)
+{
+    NML q(bench_format, "benchQueue", "reader", cfgfile);
+    NML c(bench_format, "bench", "reader", cfgfile);
+    r->status = 1;
+    r->got_queued = r->got_latest = 0;
+    if (!q.valid() || !c.valid()) {
+	fprintf(stderr, "nmlbench: the reader can't open the buffers\n");
+	(void) !write(ready_fd, "e", 1);
+	return;
+    }
+    /* drop what was left in the buffers before the writer has started */
+    int serial = -1;
+    while (read_one(&q, &serial, 1) > 0);
+    while (read_one(&c, &serial, 0) > 0);
+    (void) !write(ready_fd, "r", 1);
+
+    /* as many as the writer could queue */
+    double idle = now();
+    serial = -1;
+    while (r->got_queued < count && now() - idle < 5.0) {
+	NMLTYPE type = read_one(&q, &serial, 1);
+	if (type < 0) {
+	    fprintf(stderr, "nmlbench: queued read failed\n");
+	    return;
+	}
+	if (type > 0) {
+	    if (r->got_queued++ == 0) {
+		r->first_sent = head(&q)->sent;
+	    }
+	    r->last_read = idle = now();
+	}
+    }
+
+    /* one at a time, timing each from write to read */
+    idle = now();
+    serial = -1;
+    r->latency.reserve(count);
+    while (serial < count - 1 && now() - idle < 5.0) {
+	NMLTYPE type = read_one(&c, &serial, 0);
+	if (type < 0) {
+	    fprintf(stderr, "nmlbench: read failed\n");
+	    return;
+	}
+	if (type > 0) {
+	    idle = now();
+	    r->latency.push_back(idle - head(&c)->sent);
+	    r->got_latest++;
+	}
+    }
+    r->status = 0;
+}
+
+static int writer(int ready_fd)
+{
+    /* the reader has its channels open first, so that two threads never
+       open channels at once */
+    char ready;
+    if (read(ready_fd, &ready, 1) != 1 || ready != 'r') {
+	return 1;
+    }
+    NML q(bench_format, "benchQueue", "writer", cfgfile);
+    NML c(bench_format, "bench", "writer", cfgfile);
+    if (!q.valid() || !c.valid()) {
+	fprintf(stderr, "nmlbench: the writer can't open the buffers\n");
+	return 1;
+    }
+
+    BENCH_SMALL small;
+    BENCH_STAT *stat = new BENCH_STAT;
+    for (int k = 0; k < 640; k++) {
+	stat->d[k] = k * 0.001;
+    }
+    for (int k = 0; k < 4; k++) {
+	snprintf(stat->text[k], sizeof(stat->text[k]), "text %d", k);
+    }
+    NMLmsg *msg = stat_msgs ? (NMLmsg *) stat : (NMLmsg *) & small;
+    BENCH_SMALL *h = (BENCH_SMALL *) msg;
+
+    cms_print_queue_full_messages = 0;
+    for (int k = 0; k < count; k++) {
+	h->serial = k;
+	h->sent = now();
+	while (q.write(msg) < 0) {
+	    if (q.error_type != NML_QUEUE_FULL_ERROR) {
+		fprintf(stderr, "nmlbench: queued write failed\n");
+		return 1;
+	    }
+	    sched_yield();
+	}
+    }
+
+    double next = now() + 0.1;	/* let the reader finish the queue */
+    for (int k = 0; k < count; k++) {
+	while (now() < next);
+	h->serial = k;
+	h->sent = now();
+	if (c.write(msg) < 0) {
+	    fprintf(stderr, "nmlbench: write failed\n");
+	    return 1;
+	}
+	next = h->sent + interval;
+    }
+    delete stat;
+    return 0;
+}
+
+static void *reader_thread(void *arg)
+{
+    std::pair<int, reader_result *> *a =
+	(std::pair<int, reader_result *> *) arg;
+    reader(a->first, a->second);
+    return NULL;
+}
+
+static void print_result(reader_result * r, long size)
+{
+    printf("%s %s, %s messages of %ld bytes, read by %s (%s)\n", transport,
+	encoding, stat_msgs ? "stat" : "small", size,
+	use_process ? "a process" : "a thread", read_mode);
+    if (r->got_queued > 1) {
+	printf("throughput %.0f msgs/s (%d of %d)\n",
+	    r->got_queued / (r->last_read - r->first_sent), r->got_queued,
+	    count);
+    } else {
+	printf("throughput: no messages arrived\n");
+    }
+    std::vector<double> &l = r->latency;
+    if (l.empty()) {
+	printf("latency: no messages arrived\n");
+	return;
+    }
+    std::sort(l.begin(), l.end());
+    size_t n = l.size();
+    printf("latency (us) p50 %.1f p90 %.1f p99 %.1f max %.1f "
+	"(%d of %d)\n", l[n / 2] * 1e6, l[n * 9 / 10] * 1e6,
+	l[n * 99 / 100] * 1e6, l[n - 1] * 1e6, r->got_latest, count);
+}
+
+int main(int argc, char *argv[])
+{
+    int opt;
+    while ((opt = getopt(argc, argv, "t:e:m:n:i:Pr:b:k:")) != -1) {
+	switch (opt) {
+	case 't':
+	    transport = optarg;
+	    break;
+	case 'e':
+	    encoding = optarg;
+	    break;
+	case 'm':
+	    if (strcmp(optarg, "small") && strcmp(optarg, "stat")) {
+		usage();
+	    }
+	    stat_msgs = !strcmp(optarg, "stat");
+	    break;
+	case 'n':
+	    count = atoi(optarg);
+	    break;
+	case 'i':
+	    interval = atof(optarg) * 1e-6;
+	    break;
+	case 'P':
+	    use_process = 1;
+	    break;
+	case 'r':
+	    read_mode = optarg;
+	    break;
+	case 'b':
+	    options += " ";
+	    options += optarg;
+	    break;
+	case 'k':
+	    key = atoi(optarg);
+	    break;
+	default:
+	    usage();
+	}
+    }
+    if (optind != argc || count < 1
+	|| (strcmp(transport, "shmem") && strcmp(transport, "locmem")
+	    && strcmp(transport, "tcp"))
+	|| (strcmp(encoding, "native") && strcmp(encoding, "xdr")
+	    && strcmp(encoding, "ascii") && strcmp(encoding, "disp")
+	    && strcmp(encoding, "packed"))
+	|| (strcmp(read_mode, "read") && strcmp(read_mode, "blocking")
+	    && strcmp(read_mode, "peek"))) {
+	usage();
+    }
+    if (!strcmp(transport, "locmem") && use_process) {
+	fprintf(stderr, "nmlbench: a locmem buffer can't be read by "
+	    "another process\n");
+	return 1;
+    }
+    if (!strcmp(transport, "tcp") && !strcmp(encoding, "native")) {
+	encoding = "xdr";
+    }
+    if (key == 0) {
+	key = 7000 + getpid() % 1000 * 2;
+    }
+
+    long msg_size = stat_msgs ? sizeof(BENCH_STAT) : sizeof(BENCH_SMALL);
+    /* room for a few queued messages in the largest encoding */
+    long size = (msg_size * 4 + 4096 + 1023) / 1024 * 1024;
+    if (!strcmp(encoding, "ascii") || !strcmp(encoding, "disp")) {
+	size *= 4;
+    }
+    if (write_config(size) != 0) {
+	return 1;
+    }
+    set_rcs_print_destination(RCS_PRINT_TO_STDERR);
+
+    int status = 0;
+    pid_t server = 0;
+    NML *master[2] = { NULL, NULL };
+    if (!strcmp(transport, "tcp")) {
+	server = fork();
+	if (server == 0) {
+	    NML a(bench_format, "bench", "master", cfgfile);
+	    NML b(bench_format, "benchQueue", "master", cfgfile);
+	    run_nml_servers();
+	    _exit(0);
+	}
+	esleep(1.0);		/* for the server to listen */
+    } else {
+	master[0] = new NML(bench_format, "bench", "master", cfgfile);
+	master[1] = new NML(bench_format, "benchQueue", "master", cfgfile);
+	if (!master[0]->valid() || !master[1]->valid()) {
+	    fprintf(stderr, "nmlbench: can't create the buffers\n");
+	    status = 1;
+	}
+    }
+
+    int fds[2];
+    if (status == 0 && pipe(fds) < 0) {
+	perror("nmlbench: pipe");
+	status = 1;
+    }
+    if (status == 0 && use_process) {
+	fflush(stdout);
+	pid_t pid = fork();
+	if (pid == 0) {
+	    reader_result r;
+	    reader(fds[1], &r);
+	    if (r.status == 0) {
+		print_result(&r, msg_size);
+	    }
+	    fflush(stdout);
+	    _exit(r.status);
+	}
+	status = writer(fds[0]);
+	int wstatus;
+	if (waitpid(pid, &wstatus, 0) < 0 || !WIFEXITED(wstatus)
+	    || WEXITSTATUS(wstatus) != 0) {
+	    status = 1;
+	}
+    } else if (status == 0) {
+	reader_result r;
+	std::pair<int, reader_result *> arg(fds[1], &r);
+	pthread_t tid;
+	pthread_create(&tid, NULL, reader_thread, &arg);
+	status = writer(fds[0]);
+	pthread_join(tid, NULL);
+	if (r.status == 0) {
+	    print_result(&r, msg_size);
+	} else {
+	    status = 1;
+	}
+    }
+
+    delete master[0];
+    delete master[1];
+    if (server > 0) {
+	kill(server, SIGINT);
+	waitpid(server, NULL, 0);
+    }
+    unlink(cfgfile);
+    return status;
+}
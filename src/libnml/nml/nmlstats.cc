@@ -0,0 +1,164 @@
+/********************************************************************
+* Description: nmlstats.cc
+*   Prints the access statistics of a SHMEM buffer configured with
+*   'stats', once a second, so that it can be seen which process is
+*   reading or writing a buffer how often and what that costs.
+*
+*   syntax:  nmlstats [-n] <nmlfile> <buffer> [interval]
+*
+*   -n prints the totals once instead of the rates every interval
+*   seconds (default 1).
+*
+* Author:
+* License: GPL Version 2
+* System: Linux
+*
+* Copyright (c) 2004 All rights reserved.
+*
+* Last change:
+********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+
+#include "cms.hh"		/* class CMS */
+#include "cms_cfg.hh"		/* cms_create_from_lines() */
+#include "cmsstats.hh"		/* struct CMS_STATS_AREA */
+#include "timer.hh"		/* etime(), esleep() */
+
+static void usage()
+{
+    fprintf(stderr, "usage: nmlstats [-n] <nmlfile> <buffer> [interval]\n");
+    exit(1);
+}
+
+/* The buffer line for buffer in the NML file. */
+static char *find_buffer_line(const char *file, const char *buffer)
+{
+    static char line[CMS_CONFIG_LINELEN];
+    char name[CMS_CONFIG_LINELEN];
+    FILE *fp = fopen(file, "r");
+    if (NULL == fp) {
+	fprintf(stderr, "nmlstats: can't open %s: %s\n", file,
+	    strerror(errno));
+	return NULL;
+    }
+    while (fgets(line, sizeof(line), fp)) {
+	if (line[0] != 'B') {
+	    continue;
+	}
+	if (sscanf(line, "%*s %s", name) == 1 && !strcmp(name, buffer)) {
+	    fclose(fp);
+	    return line;
+	}
+    }
+    fclose(fp);
+    fprintf(stderr, "nmlstats: no buffer %s in %s\n", buffer, file);
+    return NULL;
+}
+
+static void print_stats(CMS_STATS_AREA * stats, CMS_STATS_PROC * last,
+    double interval)
+{
+    double now = etime();
+    if (interval > 0) {
+	printf("%6s %-16s %9s %9s %9s %9s %10s %10s %10s\n", "pid", "name",
+	    "reads/s", "new/s", "peeks/s", "writes/s", "lock(us)",
+	    "maxlock", "format(us)");
+    } else {
+	printf("%6s %-16s %9s %9s %9s %9s %10s %10s %10s\n", "pid", "name",
+	    "reads", "new", "peeks", "writes", "lock(us)", "maxlock",
+	    "format(us)");
+    }
+    for (int i = 0; i < CMS_STATS_MAX_PROCS; i++) {
+	CMS_STATS_PROC p = stats->procs[i];
+	if (p.pid == 0 || p.pid == getpid()) {
+	    continue;
+	}
+	CMS_STATS_PROC d = p;
+	double scale = 1.0;
+	if (interval > 0) {
+	    if (last[i].pid == p.pid) {
+		d.reads -= last[i].reads;
+		d.new_reads -= last[i].new_reads;
+		d.peeks -= last[i].peeks;
+		d.writes -= last[i].writes;
+		d.lock_waits -= last[i].lock_waits;
+		d.lock_wait_time -= last[i].lock_wait_time;
+		d.formats -= last[i].formats;
+		d.format_time -= last[i].format_time;
+	    }
+	    scale = 1.0 / interval;
+	}
+	last[i] = p;
+	const char *state = "";
+	if (kill(p.pid, 0) < 0 && errno == ESRCH) {
+	    state = " (exited)";
+	} else if (now - p.last_access_time > 10.0) {
+	    state = " (idle)";
+	}
+	printf("%6d %-16.16s %9.1f %9.1f %9.1f %9.1f %10.1f %10.1f %10.1f%s\n",
+	    p.pid, p.name, d.reads * scale, d.new_reads * scale,
+	    d.peeks * scale, d.writes * scale,
+	    d.lock_waits ? d.lock_wait_time * 1e6 / d.lock_waits : 0.0,
+	    p.max_lock_wait_time * 1e6,
+	    d.formats ? d.format_time * 1e6 / d.formats : 0.0, state);
+    }
+    printf("queue high water: %ld\n\n", stats->queue_high_water);
+    fflush(stdout);
+}
+
+int main(int argc, char *argv[])
+{
+    int once = 0;
+    if (argc > 1 && !strcmp(argv[1], "-n")) {
+	once = 1;
+	argc--;
+	argv++;
+    }
+    if (argc < 3 || argc > 4) {
+	usage();
+    }
+    double interval = 1.0;
+    if (argc == 4) {
+	interval = strtod(argv[3], NULL);
+	if (interval <= 0) {
+	    usage();
+	}
+    }
+
+    char *buffer_line = find_buffer_line(argv[1], argv[2]);
+    if (NULL == buffer_line) {
+	return 1;
+    }
+    char proc_line[CMS_CONFIG_LINELEN];
+    snprintf(proc_line, sizeof(proc_line),
+	"P nmlstats %s LOCAL localhost R 0 1.0 0 0", argv[2]);
+
+    CMS *cms = NULL;
+    if (-1 == cms_create_from_lines(&cms, buffer_line, proc_line)
+	|| NULL == cms || cms->status < 0) {
+	fprintf(stderr, "nmlstats: can't open buffer %s\n", argv[2]);
+	return 1;
+    }
+    if (NULL == cms->stats) {
+	fprintf(stderr,
+	    "nmlstats: %s is not a SHMEM buffer configured with 'stats'\n",
+	    argv[2]);
+	delete cms;
+	return 1;
+    }
+
+    static CMS_STATS_PROC last[CMS_STATS_MAX_PROCS];
+    print_stats(cms->stats, last, 0);
+    while (!once) {
+	esleep(interval);
+	print_stats(cms->stats, last, interval);
+    }
+    delete cms;
+    return 0;
+}
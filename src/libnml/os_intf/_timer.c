@@ -94,6 +94,20 @@ void esleep(double seconds_to_sleep)
     return;
 }
 
+/* sleeps before the next try of something that has been retried for
+   'waited' seconds: 10 ms at first, twice as long each time after that,
+   and never longer than 'interval'.  Returns the time slept. */
+double esleep_retry(double waited, double interval)
+{
+    double secs = waited < 0.01 ? 0.01 : waited;
+
+    if (secs > interval) {
+	secs = interval;
+    }
+    esleep(secs);
+    return secs;
+}
+
 void print_etime()
 {
     printf("etime = %f\n", etime());
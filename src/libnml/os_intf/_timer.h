@@ -28,6 +28,8 @@ extern "C" {
     extern double etime(void);
 /* sleeps # of seconds, to clock tick resolution */
     extern void esleep(double secs);
+/* sleeps between retries, longer the longer they have gone on */
+    extern double esleep_retry(double waited, double interval);
     void start_timer_server(int priority, int sem_id);
     void kill_timer_server(void);
     extern void print_etime(void);
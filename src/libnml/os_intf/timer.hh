@@ -32,6 +32,13 @@ extern "C" {
     /* Go to sleep for _secs seconds. The time will be rounded up to the
        resolution of the system clock or the most precise sleep or delay
        function available for the given platform. */
+
+    /* sleeps before the next of a series of retries */
+    extern double esleep_retry(double waited, double interval);
+    /* The sleep is 10 ms after the first try, twice as long after each
+       further one, and at most _interval seconds, so that something that
+       comes up soon after it was first asked for is found soon.  _waited
+       is the time since the first try.  Returns the time slept. */
 }
 class RCS_SEMAPHORE;
 
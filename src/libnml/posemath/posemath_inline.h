@@ -0,0 +1,212 @@
+/********************************************************************
+* Description: posemath_inline.h
+*   Inline versions of the PmCartesian functions the trajectory planner
+*   and kinematics call every servo cycle.
+*
+*   Include this instead of posemath.h.  Unless PM_DEBUG is defined,
+*   the functions below are redirected to inline versions that leave
+*   pmErrno alone and skip the checks that only guard against misuse
+*   (aliased arguments, null pointers, bad quaternions), so the compiler
+*   can keep the values in registers and vectorize the arithmetic.
+*   Errors the callers act on, such as the unit vector of a zero vector
+*   or a circle of zero angle, are still returned.  With PM_DEBUG the
+*   calls go to the library and report errors as before.
+*
+* License: LGPL Version 2
+* System: Linux
+*
+********************************************************************/
+
+#ifndef POSEMATH_INLINE_H
+#define POSEMATH_INLINE_H
+
+#include "posemath.h"
+#include "rtapi_math.h"
+
+#ifndef PM_DEBUG
+
+static inline int pmCartCartDotInline(PmCartesian const * const v1,
+        PmCartesian const * const v2, double * const d)
+{
+    *d = v1->x * v2->x + v1->y * v2->y + v1->z * v2->z;
+    return 0;
+}
+
+static inline int pmCartCartCrossInline(PmCartesian const * const v1,
+        PmCartesian const * const v2, PmCartesian * const vout)
+{
+    double x = v1->y * v2->z - v1->z * v2->y;
+    double y = v1->z * v2->x - v1->x * v2->z;
+    double z = v1->x * v2->y - v1->y * v2->x;
+    vout->x = x;
+    vout->y = y;
+    vout->z = z;
+    return 0;
+}
+
+static inline int pmCartMagSqInline(PmCartesian const * const v,
+        double * const d)
+{
+    *d = pmSq(v->x) + pmSq(v->y) + pmSq(v->z);
+    return 0;
+}
+
+static inline int pmCartMagInline(PmCartesian const * const v,
+        double * const d)
+{
+    *d = sqrt(pmSq(v->x) + pmSq(v->y) + pmSq(v->z));
+    return 0;
+}
+
+static inline int pmCartCartDispInline(PmCartesian const * const v1,
+        PmCartesian const * const v2, double * const d)
+{
+    *d = sqrt(pmSq(v2->x - v1->x) + pmSq(v2->y - v1->y)
+            + pmSq(v2->z - v1->z));
+    return 0;
+}
+
+static inline int pmCartCartAddInline(PmCartesian const * const v1,
+        PmCartesian const * const v2, PmCartesian * const vout)
+{
+    vout->x = v1->x + v2->x;
+    vout->y = v1->y + v2->y;
+    vout->z = v1->z + v2->z;
+    return 0;
+}
+
+static inline int pmCartCartSubInline(PmCartesian const * const v1,
+        PmCartesian const * const v2, PmCartesian * const vout)
+{
+    vout->x = v1->x - v2->x;
+    vout->y = v1->y - v2->y;
+    vout->z = v1->z - v2->z;
+    return 0;
+}
+
+static inline int pmCartScalMultInline(PmCartesian const * const v1,
+        double d, PmCartesian * const vout)
+{
+    vout->x = v1->x * d;
+    vout->y = v1->y * d;
+    vout->z = v1->z * d;
+    return 0;
+}
+
+static inline int pmCartCartAddEqInline(PmCartesian * const v,
+        PmCartesian const * const v_add)
+{
+    v->x += v_add->x;
+    v->y += v_add->y;
+    v->z += v_add->z;
+    return 0;
+}
+
+static inline int pmCartCartSubEqInline(PmCartesian * const v,
+        PmCartesian const * const v_sub)
+{
+    v->x -= v_sub->x;
+    v->y -= v_sub->y;
+    v->z -= v_sub->z;
+    return 0;
+}
+
+static inline int pmCartScalMultEqInline(PmCartesian * const v, double d)
+{
+    v->x *= d;
+    v->y *= d;
+    v->z *= d;
+    return 0;
+}
+
+static inline int pmCartNegEqInline(PmCartesian * const v)
+{
+    v->x = -v->x;
+    v->y = -v->y;
+    v->z = -v->z;
+    return 0;
+}
+
+/* A zero vector is left as it is and PM_NORM_ERR returned, as the
+   library does */
+static inline int pmCartUnitEqInline(PmCartesian * const v)
+{
+    double size = sqrt(pmSq(v->x) + pmSq(v->y) + pmSq(v->z));
+    double scale = size == 0.0 ? 1.0 : 1.0 / size;
+    v->x *= scale;
+    v->y *= scale;
+    v->z *= scale;
+    return size == 0.0 ? PM_NORM_ERR : 0;
+}
+
+static inline int pmCartUnitInline(PmCartesian const * const v,
+        PmCartesian * const vout)
+{
+    *vout = *v;
+    return pmCartUnitEqInline(vout);
+}
+
+static inline int pmQuatCartMultInline(PmQuaternion const * const q1,
+        PmCartesian const * const v2, PmCartesian * const vout)
+{
+    double cx = q1->y * v2->z - q1->z * v2->y;
+    double cy = q1->z * v2->x - q1->x * v2->z;
+    double cz = q1->x * v2->y - q1->y * v2->x;
+    double x = v2->x + 2.0 * (q1->s * cx + q1->y * cz - q1->z * cy);
+    double y = v2->y + 2.0 * (q1->s * cy + q1->z * cx - q1->x * cz);
+    double z = v2->z + 2.0 * (q1->s * cz + q1->x * cy - q1->y * cx);
+    vout->x = x;
+    vout->y = y;
+    vout->z = z;
+    return 0;
+}
+
+static inline int pmCirclePointInline(PmCircle const * const circle,
+        double angle, PmCartesian * const point)
+{
+    double c = cos(angle), s = sin(angle);
+    double x, y, z, r, k, scale;
+
+    /* radius vector rel to center */
+    x = circle->rTan.x * c + circle->rPerp.x * s;
+    y = circle->rTan.y * c + circle->rPerp.y * s;
+    z = circle->rTan.z * c + circle->rPerp.z * s;
+
+    if (circle->angle == 0.0) {
+        point->x = x;
+        point->y = y;
+        point->z = z;
+        return PM_DIV_ERR;
+    }
+    scale = angle / circle->angle;
+
+    /* scaled in radial dir for spiral, on a zero radius there is none */
+    r = sqrt(x * x + y * y + z * z);
+    k = r == 0.0 ? 1.0 : 1.0 + scale * circle->spiral / r;
+
+    point->x = circle->center.x + x * k + circle->rHelix.x * scale;
+    point->y = circle->center.y + y * k + circle->rHelix.y * scale;
+    point->z = circle->center.z + z * k + circle->rHelix.z * scale;
+    return 0;
+}
+
+#define pmCartCartDot pmCartCartDotInline
+#define pmCartCartCross pmCartCartCrossInline
+#define pmCartMagSq pmCartMagSqInline
+#define pmCartMag pmCartMagInline
+#define pmCartCartDisp pmCartCartDispInline
+#define pmCartCartAdd pmCartCartAddInline
+#define pmCartCartSub pmCartCartSubInline
+#define pmCartScalMult pmCartScalMultInline
+#define pmCartCartAddEq pmCartCartAddEqInline
+#define pmCartCartSubEq pmCartCartSubEqInline
+#define pmCartScalMultEq pmCartScalMultEqInline
+#define pmCartNegEq pmCartNegEqInline
+#define pmCartUnitEq pmCartUnitEqInline
+#define pmCartUnit pmCartUnitInline
+#define pmQuatCartMult pmQuatCartMultInline
+#define pmCirclePoint pmCirclePointInline
+
+#endif /* PM_DEBUG */
+
+#endif /* POSEMATH_INLINE_H */
@@ -24,6 +24,8 @@ extern "C" {
 
 #include <sys/types.h>
 #include <unistd.h>		/* getpid() */
+#include <pthread.h>
+#include <semaphore.h>
 
 #ifdef __cplusplus
 }
@@ -327,6 +329,180 @@ int rcs_puts(const char *_str)
     return (retval);
 }
 
+/* Asynchronous printing: the strings for stdout, stderr and the print
+   file go into a ring of records, and a thread writes them out.  The
+   printing thread only claims a record with a compare and swap and
+   copies the string in, so it never waits for the terminal or the
+   disk; if the ring is full the string is dropped and counted. */
+#define RCS_PRINT_RECORDS 1024
+#define RCS_PRINT_RECORD_SIZE 256
+
+struct rcs_print_record {
+    volatile int ready;
+    RCS_PRINT_DESTINATION_TYPE destination;
+    char text[RCS_PRINT_RECORD_SIZE];
+};
+
+static struct rcs_print_record *rcs_print_ring = NULL;
+static volatile unsigned long rcs_print_head = 0;	/* next to claim */
+static volatile unsigned long rcs_print_tail = 0;	/* next to write */
+static volatile unsigned long rcs_print_dropped = 0;
+static volatile int rcs_print_async = 0;
+static volatile int rcs_print_stopping = 0;
+static sem_t rcs_print_sem;
+static pthread_t rcs_print_thread;
+
+static int rcs_write(RCS_PRINT_DESTINATION_TYPE destination, const char *_str)
+{
+    int retval = EOF;
+    switch (destination) {
+    case RCS_PRINT_TO_LOGGER:
+
+    case RCS_PRINT_TO_STDOUT:
+	retval = fputs(_str, stdout);
+	fflush(stdout);
+	break;
+
+    case RCS_PRINT_TO_STDERR:
+	retval = fputs(_str, stderr);
+	fflush(stderr);
+	break;
+
+    case RCS_PRINT_TO_FILE:
+	if (NULL == rcs_print_file_stream) {
+	    rcs_print_file_stream = fopen(rcs_print_file_name, "a+");
+	}
+	if (NULL == rcs_print_file_stream) {
+	    return EOF;
+	}
+	retval = fputs(_str, rcs_print_file_stream);
+	fflush(rcs_print_file_stream);
+	break;
+
+    default:
+	break;
+    }
+    return retval;
+}
+
+static int rcs_queue(RCS_PRINT_DESTINATION_TYPE destination, const char *_str)
+{
+    int len = strlen(_str);
+    int done = 0;
+    while (done < len) {
+	unsigned long head = rcs_print_head;
+	if (head - __atomic_load_n(&rcs_print_tail, __ATOMIC_ACQUIRE)
+	    >= RCS_PRINT_RECORDS) {
+	    __atomic_fetch_add(&rcs_print_dropped, 1, __ATOMIC_RELAXED);
+	    break;
+	}
+	if (!__atomic_compare_exchange_n(&rcs_print_head, &head, head + 1, 0,
+		__ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+	    continue;
+	}
+	struct rcs_print_record *r = &rcs_print_ring[head % RCS_PRINT_RECORDS];
+	int n = len - done;
+	if (n > RCS_PRINT_RECORD_SIZE - 1) {
+	    n = RCS_PRINT_RECORD_SIZE - 1;
+	}
+	memcpy(r->text, _str + done, n);
+	r->text[n] = 0;
+	r->destination = destination;
+	__atomic_store_n(&r->ready, 1, __ATOMIC_RELEASE);
+	done += n;
+    }
+    sem_post(&rcs_print_sem);
+    return len;
+}
+
+/* Write out the records that are ready, in order; false if there were
+   none */
+static int rcs_write_queued()
+{
+    int any = 0;
+    for (;;) {
+	unsigned long tail = rcs_print_tail;
+	struct rcs_print_record *r = &rcs_print_ring[tail % RCS_PRINT_RECORDS];
+	if (!__atomic_load_n(&r->ready, __ATOMIC_ACQUIRE)) {
+	    break;
+	}
+	rcs_write(r->destination, r->text);
+	r->ready = 0;
+	__atomic_store_n(&rcs_print_tail, tail + 1, __ATOMIC_RELEASE);
+	any = 1;
+    }
+    unsigned long dropped = __atomic_exchange_n(&rcs_print_dropped, 0,
+	__ATOMIC_RELAXED);
+    if (dropped) {
+	char buf[80];
+	snprintf(buf, sizeof(buf), "rcs_print: %lu lines dropped\n", dropped);
+	rcs_write(RCS_PRINT_TO_STDERR, buf);
+    }
+    return any;
+}
+
+static void *rcs_print_writer(void *arg)
+{
+    for (;;) {
+	sem_wait(&rcs_print_sem);
+	rcs_write_queued();
+	if (rcs_print_stopping) {
+	    while (rcs_write_queued()) {
+	    }
+	    return NULL;
+	}
+    }
+}
+
+void rcs_print_flush()
+{
+    if (!rcs_print_async) {
+	return;
+    }
+    sem_post(&rcs_print_sem);
+    while (__atomic_load_n(&rcs_print_tail, __ATOMIC_ACQUIRE)
+	!= __atomic_load_n(&rcs_print_head, __ATOMIC_ACQUIRE)) {
+	usleep(1000);
+    }
+}
+
+static void rcs_print_stop()
+{
+    if (!rcs_print_async) {
+	return;
+    }
+    rcs_print_async = 0;
+    rcs_print_stopping = 1;
+    sem_post(&rcs_print_sem);
+    pthread_join(rcs_print_thread, NULL);
+}
+
+int set_rcs_print_async(int on)
+{
+    if (!on) {
+	rcs_print_stop();
+	return 0;
+    }
+    if (rcs_print_async) {
+	return 0;
+    }
+    if (NULL == rcs_print_ring) {
+	rcs_print_ring = (struct rcs_print_record *)
+	    calloc(RCS_PRINT_RECORDS, sizeof(struct rcs_print_record));
+	if (NULL == rcs_print_ring) {
+	    return -1;
+	}
+	sem_init(&rcs_print_sem, 0, 0);
+	atexit(rcs_print_stop);
+    }
+    rcs_print_stopping = 0;
+    if (pthread_create(&rcs_print_thread, NULL, rcs_print_writer, NULL)) {
+	return -1;
+    }
+    rcs_print_async = 1;
+    return 0;
+}
+
 int rcs_fputs(const char *_str)
 {
     int retval = EOF;
@@ -336,15 +512,14 @@ int rcs_fputs(const char *_str)
 	}
 	switch (rcs_print_destination) {
 	case RCS_PRINT_TO_LOGGER:
-
 	case RCS_PRINT_TO_STDOUT:
-	    retval = fputs(_str, stdout);
-	    fflush(stdout);
-	    break;
-
 	case RCS_PRINT_TO_STDERR:
-	    retval = fputs(_str, stderr);
-	    fflush(stderr);
+	case RCS_PRINT_TO_FILE:
+	    if (rcs_print_async) {
+		retval = rcs_queue(rcs_print_destination, _str);
+	    } else {
+		retval = rcs_write(rcs_print_destination, _str);
+	    }
 	    break;
 
 	case RCS_PRINT_TO_LIST:
@@ -366,19 +541,6 @@ int rcs_fputs(const char *_str)
 	case RCS_PRINT_TO_NULL:
 	    retval = strlen(_str);
 	    break;
-	case RCS_PRINT_TO_FILE:
-	    if (NULL == rcs_print_file_stream) {
-		if (NULL == rcs_print_file_name) {
-		    return EOF;
-		}
-		rcs_print_file_stream = fopen(rcs_print_file_name, "a+");
-	    }
-	    if (NULL == rcs_print_file_stream) {
-		return EOF;
-	    }
-	    retval = fputs(_str, rcs_print_file_stream);
-	    fflush(rcs_print_file_stream);
-	    break;
 
 	default:
 	    break;
@@ -392,6 +554,7 @@ int rcs_fputs(const char *_str)
 
 void close_rcs_printing()
 {
+    rcs_print_flush();
     switch (rcs_print_destination) {
     case RCS_PRINT_TO_LIST:
 	clean_print_list();
@@ -417,6 +580,7 @@ int set_rcs_print_file(char *_file_name)
     if (strlen(_file_name) > 80) {
 	return -1;
     }
+    rcs_print_flush();
     strcpy(rcs_print_file_name, _file_name);
     if (NULL != rcs_print_file_stream) {
 	fclose(rcs_print_file_stream);
@@ -100,6 +100,13 @@ extern "C" {
     extern void set_rcs_print_notify(RCS_PRINT_NOTIFY_FUNC_PTR);
     extern int set_rcs_print_file(const char *_file_name);
     extern void close_rcs_printing(void);
+    extern int set_rcs_print_async(int on);
+    /* With on, the output to stdout, stderr and the print file is
+       queued and written by a thread of its own, so printing doesn't
+       wait for it; lines that don't fit in the queue are dropped.
+       Returns -1 if the thread can't be started. */
+    extern void rcs_print_flush(void);
+    /* Waits until the queued output has been written. */
 
 #ifdef __cplusplus
 }
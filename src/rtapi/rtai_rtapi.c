@@ -775,6 +775,35 @@ static int task_delete(int task_id)
     return 0;
 }
 
+int rtapi_task_set_cpu(int task_id, int cpu)
+{
+    /* validate task ID */
+    if ((task_id < 1) || (task_id > RTAPI_MAX_TASKS)) {
+	return -EINVAL;
+    }
+    if (task_array[task_id].state != PAUSED) {
+	return -EINVAL;
+    }
+    if (cpu < 0) {
+	cpu = rtapi_data->rt_cpu;
+    }
+    if (cpu >= NR_CPUS || !cpu_online(cpu)) {
+	return -EINVAL;
+    }
+    rt_set_runnable_on_cpuid(ostask_array[task_id], cpu);
+    return 0;
+}
+
+int rtapi_task_set_spin(int task_id, long spin_nsec)
+{
+    return -ENOSYS;
+}
+
+int rtapi_cpu_self(void)
+{
+    return raw_smp_processor_id();
+}
+
 int rtapi_task_start(int task_id, unsigned long int period_nsec)
 {
     int retval;
@@ -1713,6 +1742,9 @@ EXPORT_SYMBOL(rtapi_prio_next_lower);
 EXPORT_SYMBOL(rtapi_task_new);
 EXPORT_SYMBOL(rtapi_task_delete);
 EXPORT_SYMBOL(rtapi_task_start);
+EXPORT_SYMBOL(rtapi_task_set_cpu);
+EXPORT_SYMBOL(rtapi_task_set_spin);
+EXPORT_SYMBOL(rtapi_cpu_self);
 EXPORT_SYMBOL(rtapi_wait);
 EXPORT_SYMBOL(rtapi_task_resume);
 EXPORT_SYMBOL(rtapi_task_pause);
@@ -384,6 +384,30 @@ RTAPI_BEGIN_DECLS
 */
     extern int rtapi_task_start(int task_id, unsigned long int period_nsec);
 
+/** 'rtapi_task_set_cpu()' selects the CPU a task runs on.  'task_id'
+    is a task ID from a call to rtapi_task_new(), and must not have
+    been started yet.  A negative 'cpu' restores the default, which
+    is the last isolated CPU if there are any in user space, else the
+    last CPU.  Returns a status code.  Call only from within
+    init/cleanup code, not from realtime tasks.
+*/
+    extern int rtapi_task_set_cpu(int task_id, int cpu);
+
+/** 'rtapi_task_set_spin()' makes rtapi_wait() in task 'task_id' sleep
+    until 'spin_nsec' before the start of the next period and busy-wait
+    for the rest, to wake up on time more reliably at the cost of that
+    much CPU time per period.  Zero turns it off.  Only available in
+    user space with POSIX threads; elsewhere returns -ENOSYS.  May be
+    called from the task itself.
+*/
+    extern int rtapi_task_set_spin(int task_id, long spin_nsec);
+
+/** 'rtapi_cpu_self()' returns the number of the CPU the calling task
+    is running on, or a negative value if it is not known.  May be
+    called from realtime tasks.
+*/
+    extern int rtapi_cpu_self(void);
+
 /** 'rtapi_wait()' suspends execution of the current task until the
     next period.  The task must be periodic, if not, the result is
     undefined.  The function will return at the beginning of the
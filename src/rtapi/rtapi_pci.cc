@@ -68,6 +68,11 @@ void rtapi__iomem *rtapi_pci_ioremap_bar(struct rtapi_pci_dev *dev, int bar)
     return NULL;
 }
 
+void rtapi__iomem *rtapi_pci_ioremap_wc_bar(struct rtapi_pci_dev *dev, int bar)
+{
+    return NULL;
+}
+
 void rtapi_iounmap(volatile void rtapi__iomem *addr)
 {
 }
@@ -272,20 +277,10 @@ void rtapi_pci_unregister_driver(struct rtapi_pci_driver *driver)
 typedef std::map<void rtapi__iomem*, size_t> IoMap;
 IoMap iomaps;
 
-void rtapi__iomem *rtapi_pci_ioremap_bar(struct rtapi_pci_dev *dev, int bar)
+static void rtapi__iomem *map_bar(struct rtapi_pci_dev *dev, int bar, const char *path)
 {
     WITH_ROOT;
     void *mmio;
-    char path[256];
-
-    rtapi_print_msg(RTAPI_MSG_DBG, "RTAPI_PCI: Map BAR %i\n", bar);
-
-    if (bar < 0 || bar >= 6) {
-        rtapi_print_msg(RTAPI_MSG_ERR, "Invalid PCI BAR %d\n", bar);
-        return NULL;
-    }
-
-    snprintf(path, sizeof(path), "%s/resource%i", dev->sys_path, bar);
 
     /* Open the resource node */
     int fd = open(path, O_RDWR | O_SYNC);
@@ -310,6 +305,49 @@ void rtapi__iomem *rtapi_pci_ioremap_bar(struct rtapi_pci_dev *dev, int bar)
     return mmio;
 }
 
+void rtapi__iomem *rtapi_pci_ioremap_bar(struct rtapi_pci_dev *dev, int bar)
+{
+    char path[256];
+
+    rtapi_print_msg(RTAPI_MSG_DBG, "RTAPI_PCI: Map BAR %i\n", bar);
+
+    if (bar < 0 || bar >= 6) {
+        rtapi_print_msg(RTAPI_MSG_ERR, "Invalid PCI BAR %d\n", bar);
+        return NULL;
+    }
+
+    snprintf(path, sizeof(path), "%s/resource%i", dev->sys_path, bar);
+    return map_bar(dev, bar, path);
+}
+
+void rtapi__iomem *rtapi_pci_ioremap_wc_bar(struct rtapi_pci_dev *dev, int bar)
+{
+    char path[256];
+
+    rtapi_print_msg(RTAPI_MSG_DBG, "RTAPI_PCI: Map BAR %i write-combining\n", bar);
+
+    if (bar < 0 || bar >= 6) {
+        rtapi_print_msg(RTAPI_MSG_ERR, "Invalid PCI BAR %d\n", bar);
+        return NULL;
+    }
+
+    if (!(rtapi_pci_resource_flags(dev, bar) & RTAPI_IORESOURCE_PREFETCH)) {
+        rtapi_print_msg(RTAPI_MSG_DBG,
+            "RTAPI_PCI: BAR %d is not prefetchable, no write-combining\n", bar);
+        return NULL;
+    }
+
+    /* the kernel only provides resourceN_wc where it can map it so */
+    snprintf(path, sizeof(path), "%s/resource%i_wc", dev->sys_path, bar);
+    if (access(path, F_OK) != 0) {
+        rtapi_print_msg(RTAPI_MSG_DBG,
+            "RTAPI_PCI: no write-combining mapping for BAR %d\n", bar);
+        return NULL;
+    }
+
+    return map_bar(dev, bar, path);
+}
+
 void rtapi_iounmap(volatile void rtapi__iomem *addr)
 {
     rtapi_print_msg(RTAPI_MSG_DBG, "RTAPI_PCI: Unmap BAR\n");
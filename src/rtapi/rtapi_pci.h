@@ -36,6 +36,27 @@
 #define rtapi_pci_resource_len(dev, bar) pci_resource_len(dev, bar)
 #define rtapi_pci_set_drvdata pci_set_drvdata
 #define rtapi_iounmap iounmap
+#define RTAPI_IORESOURCE_PREFETCH IORESOURCE_PREFETCH
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,3,0)
+#define rtapi_pci_ioremap_wc_bar pci_ioremap_wc_bar
+#else
+#define rtapi_pci_ioremap_wc_bar(dev, bar) ((void __iomem *)NULL)
+#endif
+
+/* Copy size bytes (a multiple of 4) as 32-bit accesses */
+static inline void rtapi_memcpy_toio32(void __iomem *dest, const void *src,
+        size_t size) {
+    const u32 *s = src;
+    for (; size >= 4; size -= 4, dest += 4) iowrite32(*s++, dest);
+}
+
+static inline void rtapi_memcpy_fromio32(void *dest, const void __iomem *src,
+        size_t size) {
+    u32 *d = dest;
+    for (; size >= 4; size -= 4, src += 4) *d++ = ioread32(src);
+}
+
+#define rtapi_wc_flush() wmb()
 
 #else
 #include <rtapi.h>
@@ -109,6 +130,40 @@ static inline void rtapi_pci_set_drvdata(struct rtapi_pci_dev *pdev, void *data)
 
 void rtapi_iounmap(volatile void *addr);
 
+/* Flag of a prefetchable BAR in rtapi_pci_resource_flags */
+#define RTAPI_IORESOURCE_PREFETCH 0x00002000
+
+/* Map a BAR write-combining, so that consecutive writes can go out on
+   the bus as one burst.  Returns NULL if the BAR is not prefetchable,
+   since write-combining is only safe where reads have no side effects
+   and the device accepts merged writes.  The mapping is released with
+   rtapi_iounmap. */
+void rtapi__iomem *rtapi_pci_ioremap_wc_bar(struct rtapi_pci_dev *pdev, int bar);
+
+/* Copy size bytes (a multiple of 4) as 32-bit accesses */
+static inline void rtapi_memcpy_toio32(void rtapi__iomem *dest,
+        const void *src, size_t size) {
+    volatile rtapi_u32 *d = (volatile rtapi_u32 *)dest;
+    const rtapi_u32 *s = (const rtapi_u32 *)src;
+    for (; size >= 4; size -= 4) *d++ = *s++;
+}
+
+static inline void rtapi_memcpy_fromio32(void *dest,
+        const void rtapi__iomem *src, size_t size) {
+    rtapi_u32 *d = (rtapi_u32 *)dest;
+    const volatile rtapi_u32 *s = (const volatile rtapi_u32 *)src;
+    for (; size >= 4; size -= 4) *d++ = *s++;
+}
+
+/* Push out writes held in the write-combining buffers */
+static inline void rtapi_wc_flush(void) {
+#if defined(__i386__) || defined(__x86_64__)
+    __asm__ __volatile__("sfence" ::: "memory");
+#else
+    __sync_synchronize();
+#endif
+}
+
 int rtapi_pci_register_driver(struct rtapi_pci_driver *driver);
 void rtapi_pci_unregister_driver(struct rtapi_pci_driver *driver);
 
@@ -20,6 +20,7 @@
 #include <sys/fsuid.h>
 #include <unistd.h>
 #include <pthread.h>
+#include <errno.h>
 #include <atomic>
 
 inline void rtapi_timespec_add(timespec &result, const timespec &ta, const timespec &tb) {
@@ -55,6 +56,8 @@ struct rtapi_task {
   int uses_fp;
   size_t stacksize;
   int prio;
+  int cpu;			/* from rtapi_task_set_cpu, or -1 */
+  long spin;			/* from rtapi_task_set_spin */
   long period;
   struct timespec nextstart;
   unsigned ratio;
@@ -77,6 +80,9 @@ struct RtapiApp
     virtual rtapi_task *do_task_new() = 0;
     static int allocate_task_id();
     static struct rtapi_task *get_task(int task_id);
+    int task_set_cpu(int task_id, int cpu);
+    static int task_cpu(const rtapi_task *task);
+    virtual int task_set_spin(int, long) { return -ENOSYS; }
     void unexpected_realtime_delay(rtapi_task *task, int nperiod=1);
     virtual int task_delete(int id) = 0;
     virtual int task_start(int task_id, unsigned long period_nsec) = 0;
@@ -52,6 +52,66 @@ typedef struct {
 
 static rtapi_shmem_handle shmem_array[MAX_SHM] = {{0},};
 
+#ifdef RTAPI
+/* the default huge page size in bytes, or 0 if there are none */
+static unsigned long hugepage_size(void)
+{
+  static long size = -1;
+  if(size < 0) {
+    char line[128];
+    FILE *f = fopen("/proc/meminfo", "r");
+    size = 0;
+    if(f) {
+      while(fgets(line, sizeof(line), f)) {
+        if(sscanf(line, "Hugepagesize: %ld kB", &size) == 1) {
+          size *= 1024;
+          break;
+        }
+      }
+      fclose(f);
+    }
+  }
+  return size;
+}
+
+#include <sys/syscall.h>
+#ifndef MPOL_PREFERRED
+#define MPOL_PREFERRED 1
+#endif
+
+/* the NUMA node of cpu, or -1 on a system of a single node */
+static int cpu_node(int cpu)
+{
+  char path[64];
+  int node, nodes = 0, found = -1;
+  for(node = 0; node < 1024; node++) {
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d", node);
+    if(access(path, F_OK) != 0) break;
+    nodes++;
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/node%d",
+        cpu, node);
+    if(access(path, F_OK) == 0) found = node;
+  }
+  return nodes > 1 ? found : -1;
+}
+
+/* with RTAPI_SHM_NUMA=1, prefer the memory of the node the realtime
+   tasks run on for the pages of a new block, before they are touched */
+static void shmem_bind_node(void *mem, unsigned long size)
+{
+  const char *env = getenv("RTAPI_SHM_NUMA");
+  if(!env || atoi(env) == 0) return;
+  int cpu = RtapiApp::task_cpu(NULL);
+  int node = cpu < 0 ? -1 : cpu_node(cpu);
+  if(node < 0 || node >= (int)(8 * sizeof(unsigned long))) return;
+  unsigned long mask = 1ul << node;
+  if(syscall(SYS_mbind, mem, size, MPOL_PREFERRED, &mask,
+        8 * sizeof(mask), 0) < 0)
+    rtapi_print_msg(RTAPI_MSG_WARN,
+        "rtapi_shmem_new: mbind to node %d: %s\n", node, strerror(errno));
+}
+#endif
+
 int rtapi_shmem_new(int key, int module_id, unsigned long int size)
 {
 #ifdef RTAPI
@@ -75,7 +135,24 @@ int rtapi_shmem_new(int key, int module_id, unsigned long int size)
   shmem = &shmem_array[i];
 
   /* now get shared memory block from OS */
-  shmem->id = shmget((key_t) key, (int) size, IPC_CREAT | 0600);
+  shmem->id = -1;
+#ifdef RTAPI
+  /* a block of whole huge pages is made of them if the system has
+     some reserved (vm.nr_hugepages), to save TLB entries; otherwise,
+     or if the block already exists, this is the same as below */
+  unsigned long hps = hugepage_size();
+  /* with RTAPI_HUGEPAGES=1, the larger blocks (emcmot_struct, scope)
+     are rounded up to whole huge pages to get the same */
+  const char *huge = getenv("RTAPI_HUGEPAGES");
+  unsigned long rounded = size;
+  if(hps && huge && atoi(huge) && size >= 65536)
+    rounded = (size + hps - 1) / hps * hps;
+  if(hps && rounded % hps == 0)
+    shmem->id = shmget((key_t) key, (int) rounded, IPC_CREAT | SHM_HUGETLB | 0600);
+  if(shmem->id != -1) size = rounded;
+#endif
+  if (shmem->id == -1)
+    shmem->id = shmget((key_t) key, (int) size, IPC_CREAT | 0600);
   if (shmem->id == -1) {
     rtapi_print_msg(RTAPI_MSG_ERR, "rtapi_shmem_new failed due to shmget(key=0x%08x): %s\n", key, strerror(errno));
     return -errno;
@@ -114,6 +191,10 @@ int rtapi_shmem_new(int key, int module_id, unsigned long int size)
     return -errno;
   }
 
+#ifdef RTAPI
+  shmem_bind_node(shmem->mem, size);
+#endif
+
   long pagesize = sysconf(_SC_PAGESIZE);
   /* touch every page */
   for(size_t off = 0; off < size; off += pagesize)
@@ -360,6 +441,8 @@ static int detect_xenomai() {
 #endif
 static int detect_realtime() {
     struct stat st;
+    if (getenv("RTAPI_TIME_WARP"))
+        return 0; /* tasks take turns on a simulated clock */
     if ((stat(EMC2_BIN_DIR "/rtapi_app", &st) < 0)
             || st.st_uid != 0 || !(st.st_mode & S_ISUID))
         return 0;
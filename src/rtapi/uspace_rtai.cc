@@ -82,9 +82,9 @@ struct RtaiApp : RtapiApp {
         rt_set_periodic_mode();
         start_rt_timer(nano2count(task->period));
         if(task->uses_fp) rt_task_use_fpu(task->rt_task, 1);
-        // assumes processor numbers are contiguous
-        int nprocs = sysconf( _SC_NPROCESSORS_ONLN );
-        rt_set_runnable_on_cpus(task->rt_task, 1u << (nprocs - 1));
+        int cpu = task_cpu(task);
+        if(cpu >= 0 && cpu < 32)
+            rt_set_runnable_on_cpus(task->rt_task, 1u << cpu);
         rt_make_hard_real_time();
         rt_task_make_periodic_relative_ns(task->rt_task, task->period, task->period);
         (task->taskcode) (task->arg);
@@ -32,6 +32,8 @@
 #include <string>
 #include <map>
 #include <algorithm>
+#include <atomic>
+#include <math.h>
 #include <sys/time.h>
 #include <time.h>
 #include <stdlib.h>
@@ -56,6 +58,9 @@
 #include <sys/ipc.h>		/* IPC_* */
 #include <sys/shm.h>		/* shmget() */
 #include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <stddef.h>
 #include <boost/lockfree/queue.hpp>
 
 std::atomic<int> WithRoot::level;
@@ -97,13 +102,223 @@ namespace
 {
 RtapiApp &App();
 
+// Messages printed from realtime threads are queued for queue_function to
+// print.  Formatting is left to it too: the format and its arguments are
+// queued, with the strings of %s arguments copied into text since they may
+// not outlive the call.  A message whose format can't be redone that way
+// (%n, %m, positional or too many arguments) is formatted at once into
+// text, with fmt null.
+const size_t MSG_MAX_ARGS = 16;
+
+enum msg_arg_kind {
+    ARG_INT, ARG_LONG, ARG_LLONG, ARG_SIZE, ARG_INTMAX, ARG_PTRDIFF,
+    ARG_DOUBLE, ARG_LDOUBLE, ARG_PTR, ARG_STR
+};
+
+union msg_arg_t {
+    intmax_t j;                 // every integer kind, and * widths
+    double d;
+    long double ld;
+    const void *p;
+    size_t str;                 // where its copy starts in text
+};
+
 struct message_t {
     msg_level_t level;
-    char msg[1024-sizeof(level)];
+    unsigned nargs;
+    const char *fmt;
+    msg_arg_t args[MSG_MAX_ARGS];
+    char text[512];
+};
+
+typedef boost::lockfree::queue<message_t, boost::lockfree::fixed_sized<true>>
+    msg_queue_t;
+// RTAPI_MSG_QUEUE_SIZE messages, made by master() before any realtime
+// thread exists
+msg_queue_t *rtapi_msg_queue;
+size_t rtapi_msg_queue_size = 1024;
+std::atomic<unsigned long> rtapi_msg_dropped;
+// held while formatting, so that unloading a module waits for the
+// formats in it to be done with
+pthread_mutex_t rtapi_msg_lock = PTHREAD_MUTEX_INITIALIZER;
+
+struct conversion_t {
+    size_t len;                 // from after the % to the conversion
+    unsigned stars;             // * width and precision, int arguments
+    msg_arg_kind kind;
 };
 
-boost::lockfree::queue<message_t, boost::lockfree::capacity<128>>
-rtapi_msg_queue;
+// Parses the conversion at p, just after its %; false for one that can't
+// be redone later
+bool parse_conversion(const char *p, conversion_t &c) {
+    const char *s = p;
+    c.stars = 0;
+    while(*s && strchr("-+ #0'", *s)) s++;
+    if(*s == '*') { c.stars++; s++; }
+    else while(isdigit(*s)) s++;
+    if(*s == '.') {
+        s++;
+        if(*s == '*') { c.stars++; s++; }
+        else while(isdigit(*s)) s++;
+    }
+    enum { NONE, L, LL, BIGL, J, Z, T } length = NONE;
+    if(*s == 'h') { s++; if(*s == 'h') s++; }
+    else if(*s == 'l') { s++; length = L; if(*s == 'l') { s++; length = LL; } }
+    else if(*s == 'q') { s++; length = LL; }
+    else if(*s == 'L') { s++; length = BIGL; }
+    else if(*s == 'j') { s++; length = J; }
+    else if(*s == 'z') { s++; length = Z; }
+    else if(*s == 't') { s++; length = T; }
+    switch(*s) {
+    case 'd': case 'i': case 'o': case 'u': case 'x': case 'X': case 'c':
+        switch(length) {
+        case L: c.kind = ARG_LONG; break;
+        case LL: case BIGL: c.kind = ARG_LLONG; break;
+        case J: c.kind = ARG_INTMAX; break;
+        case Z: c.kind = ARG_SIZE; break;
+        case T: c.kind = ARG_PTRDIFF; break;
+        default: c.kind = ARG_INT; break;
+        }
+        if(*s == 'c' && length != NONE) return false;
+        break;
+    case 'f': case 'F': case 'e': case 'E': case 'g': case 'G':
+    case 'a': case 'A':
+        c.kind = length == BIGL ? ARG_LDOUBLE : ARG_DOUBLE;
+        break;
+    case 's':
+        if(length != NONE) return false;
+        c.kind = ARG_STR;
+        break;
+    case 'p':
+        c.kind = ARG_PTR;
+        break;
+    default:
+        return false;
+    }
+    c.len = s + 1 - p;
+    return true;
+}
+
+// Takes the arguments of fmt from ap into m; false if it can't
+bool capture_message(message_t &m, const char *fmt, va_list ap) {
+    size_t used = 0;
+    m.fmt = fmt;
+    m.nargs = 0;
+    for(const char *p = fmt; (p = strchr(p, '%')); ) {
+        p++;
+        if(*p == '%') { p++; continue; }
+        conversion_t c;
+        if(!parse_conversion(p, c) || m.nargs + c.stars + 1 > MSG_MAX_ARGS)
+            return false;
+        for(unsigned i = 0; i < c.stars; i++)
+            m.args[m.nargs++].j = va_arg(ap, int);
+        msg_arg_t &a = m.args[m.nargs++];
+        switch(c.kind) {
+        case ARG_INT: a.j = va_arg(ap, int); break;
+        case ARG_LONG: a.j = va_arg(ap, long); break;
+        case ARG_LLONG: a.j = va_arg(ap, long long); break;
+        case ARG_SIZE: a.j = va_arg(ap, size_t); break;
+        case ARG_INTMAX: a.j = va_arg(ap, intmax_t); break;
+        case ARG_PTRDIFF: a.j = va_arg(ap, ptrdiff_t); break;
+        case ARG_DOUBLE: a.d = va_arg(ap, double); break;
+        case ARG_LDOUBLE: a.ld = va_arg(ap, long double); break;
+        case ARG_PTR: a.p = va_arg(ap, void *); break;
+        case ARG_STR: {
+            const char *s = va_arg(ap, const char *);
+            if(!s) s = "(null)";
+            size_t n = strlen(s) + 1;
+            if(used + n > sizeof(m.text)) return false;
+            memcpy(m.text + used, s, n);
+            a.str = used;
+            used += n;
+            break;
+        }
+        }
+        p += c.len;
+    }
+    return true;
+}
+
+template<class T>
+void append_conversion(std::string &out, const char *spec,
+        const msg_arg_t *stars, unsigned nstars, T value) {
+    char buf[1024];
+    switch(nstars) {
+    case 0: snprintf(buf, sizeof(buf), spec, value); break;
+    case 1: snprintf(buf, sizeof(buf), spec, (int)stars[0].j, value); break;
+    default:
+        snprintf(buf, sizeof(buf), spec, (int)stars[0].j, (int)stars[1].j,
+                value);
+        break;
+    }
+    out += buf;
+}
+
+void format_message(const message_t &m, std::string &out) {
+    if(!m.fmt) {
+        out += m.text;
+        return;
+    }
+    unsigned n = 0;
+    const char *p = m.fmt;
+    while(const char *pct = strchr(p, '%')) {
+        out.append(p, pct - p);
+        p = pct + 1;
+        if(*p == '%') { out += '%'; p++; continue; }
+        conversion_t c;
+        parse_conversion(p, c);
+        std::string spec(pct, c.len + 1);
+        const msg_arg_t *stars = &m.args[n];
+        const msg_arg_t &a = m.args[n + c.stars];
+        n += c.stars + 1;
+        const char *f = spec.c_str();
+        switch(c.kind) {
+        case ARG_INT: append_conversion(out, f, stars, c.stars, (int)a.j); break;
+        case ARG_LONG: append_conversion(out, f, stars, c.stars, (long)a.j); break;
+        case ARG_LLONG: append_conversion(out, f, stars, c.stars, (long long)a.j); break;
+        case ARG_SIZE: append_conversion(out, f, stars, c.stars, (size_t)a.j); break;
+        case ARG_INTMAX: append_conversion(out, f, stars, c.stars, a.j); break;
+        case ARG_PTRDIFF: append_conversion(out, f, stars, c.stars, (ptrdiff_t)a.j); break;
+        case ARG_DOUBLE: append_conversion(out, f, stars, c.stars, a.d); break;
+        case ARG_LDOUBLE: append_conversion(out, f, stars, c.stars, a.ld); break;
+        case ARG_PTR: append_conversion(out, f, stars, c.stars, a.p); break;
+        case ARG_STR: append_conversion(out, f, stars, c.stars, m.text + a.str); break;
+        }
+        p += c.len;
+    }
+    out += p;
+}
+
+// Prints the queued messages, each run of them for one stream with a
+// single write
+void drain_messages() {
+    static unsigned long reported;
+    std::string out;
+    FILE *stream = nullptr;
+
+    pthread_mutex_lock(&rtapi_msg_lock);
+    if(rtapi_msg_queue) {
+        rtapi_msg_queue->consume_all([&](const message_t &m) {
+            FILE *f = m.level == RTAPI_MSG_ALL ? stdout : stderr;
+            if(f != stream && !out.empty()) {
+                fputs(out.c_str(), stream);
+                out.clear();
+            }
+            stream = f;
+            format_message(m, out);
+        });
+    }
+    pthread_mutex_unlock(&rtapi_msg_lock);
+    if(!out.empty()) fputs(out.c_str(), stream);
+
+    unsigned long dropped = rtapi_msg_dropped.load();
+    if(dropped != reported) {
+        fprintf(stderr, "rtapi: %lu realtime messages dropped, "
+            "the queue of %zu was full\n", dropped - reported,
+            rtapi_msg_queue_size);
+        reported = dropped;
+    }
+}
 
 pthread_t queue_thread;
 void *queue_function(void *arg) {
@@ -113,9 +328,7 @@ void *queue_function(void *arg) {
     while(1) {
         pthread_testcancel();
         pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, nullptr);
-        rtapi_msg_queue.consume_all([](const message_t &m) {
-            fputs(m.msg, m.level == RTAPI_MSG_ALL ? stdout : stderr);
-        });
+        drain_messages();
         pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, nullptr);
         struct timespec ts = {0, 10000000};
         rtapi_clock_nanosleep(CLOCK_MONOTONIC, 0, &ts, NULL, NULL);
@@ -320,6 +533,23 @@ static int do_load_cmd(string name, vector<string> args) {
     }
 }
 
+// loadlist mod [args] ; mod [args] ...: loads each in turn in one request,
+// stopping at the first that fails
+static int do_loadlist_cmd(vector<string> args) {
+    vector<string>::iterator first = args.begin();
+    while(first != args.end()) {
+        vector<string>::iterator last = find(first, args.end(), string(";"));
+        if(first == last) {
+            rtapi_print_msg(RTAPI_MSG_ERR, "loadlist: missing module name\n");
+            return -1;
+        }
+        int result = do_load_cmd(*first, vector<string>(first, last));
+        if(result != 0) return result;
+        first = last == args.end() ? last : last + 1;
+    }
+    return 0;
+}
+
 static int do_unload_cmd(string name) {
     void *w = modules[name];
     if(w == NULL) {
@@ -329,6 +559,8 @@ static int do_unload_cmd(string name) {
         int (*stop)(void) = DLSYM<int(*)(void)>(w, "rtapi_app_exit");
 	if(stop) stop();
 	modules.erase(modules.find(name));
+        // the queued messages may have their formats in the module
+        drain_messages();
         dlclose(w);
         instance_count --;
     }
@@ -396,6 +628,9 @@ static int handle_command(vector<string> args) {
         string name = args[1];
         args.erase(args.begin());
         return do_load_cmd(name, args);
+    } else if(args.size() >= 2 && args[0] == "loadlist") {
+        args.erase(args.begin());
+        return do_loadlist_cmd(args);
     } else if(args.size() == 2 && args[0] == "unload") {
         return do_unload_cmd(args[1]);
     } else if(args.size() == 3 && args[0] == "newinst") {
@@ -457,12 +692,21 @@ static int callback(int fd)
 static pthread_t main_thread{};
 
 static int master(int fd, vector<string> args) {
+    if(getenv("RTAPI_MSG_QUEUE_SIZE")) {
+        // the most a fixed size boost::lockfree::queue can hold
+        rtapi_msg_queue_size = std::min<size_t>(65534,
+            std::max(16L, atol(getenv("RTAPI_MSG_QUEUE_SIZE"))));
+    }
+    rtapi_msg_queue = new msg_queue_t(rtapi_msg_queue_size);
     main_thread = pthread_self();
     if(pthread_create(&queue_thread, nullptr, &queue_function, nullptr) < 0) {
         perror("pthread_create (queue function)");
         return -1;
     }
-    do_load_cmd("hal_lib", vector<string>()); instance_count = 0;
+    vector<string> hal_args;
+    if(getenv("HAL_SHMEM_SIZE"))
+        hal_args.push_back(string("hal_size=") + getenv("HAL_SHMEM_SIZE"));
+    do_load_cmd("hal_lib", hal_args); instance_count = 0;
     App(); // force rtapi_app to be created
     int result=0;
     if(args.size()) {
@@ -474,9 +718,7 @@ static int master(int fd, vector<string> args) {
 out:
     pthread_cancel(queue_thread);
     pthread_join(queue_thread, nullptr);
-    rtapi_msg_queue.consume_all([](const message_t &m) {
-        fputs(m.msg, m.level == RTAPI_MSG_ALL ? stdout : stderr);
-    });
+    drain_messages();
     return result;
 }
 
@@ -599,8 +841,8 @@ struct rtapi_module {
 #define MODULE_OFFSET 32768
 
 rtapi_task::rtapi_task()
-    : magic{}, id{}, owner{}, stacksize{}, prio{},
-      period{}, nextstart{},
+    : magic{}, id{}, owner{}, stacksize{}, prio{}, cpu{-1},
+      spin{}, period{}, nextstart{},
       ratio{}, arg{}, taskcode{}
 {}
 
@@ -608,10 +850,11 @@ namespace
 {
 struct PosixTask : rtapi_task
 {
-    PosixTask() : rtapi_task{}, thr{}
+    PosixTask() : rtapi_task{}, thr{}, warp_waiting{}
     {}
 
     pthread_t thr;                /* thread's context */
+    bool warp_waiting;            /* in wait() with time warp */
 };
 
 struct Posix : RtapiApp
@@ -620,9 +863,11 @@ struct Posix : RtapiApp
         pthread_once(&key_once, init_key);
         if(do_thread_lock)
             pthread_mutex_init(&thread_lock, 0);
+        init_time_warp();
     }
     int task_delete(int id);
     int task_start(int task_id, unsigned long period_nsec);
+    int task_set_spin(int task_id, long spin_nsec);
     int task_pause(int task_id);
     int task_resume(int task_id);
     int task_self();
@@ -643,12 +888,33 @@ struct Posix : RtapiApp
         pthread_key_create(&key, NULL);
     }
 
-    long long do_get_time(void) {
+    // With RTAPI_TIME_WARP in the environment, the tasks run back to back
+    // in the order of their deadlines on a simulated clock, which jumps
+    // to each deadline instead of waiting for it.  RTAPI_TIME_WARP=n
+    // keeps the simulated clock at most n times faster than the real
+    // one, so that user space can keep up; 0 runs as fast as the tasks
+    // can.
+    bool warp;
+    double warp_speed;
+    std::atomic<long long> warp_now;
+    long long warp_real_start, warp_sim_start;
+    pthread_cond_t warp_cond;
+    void init_time_warp();
+    void warp_wait(PosixTask *task);
+    PosixTask *warp_next();
+    static void warp_cancelled(void *arg);
+
+    static long long real_time(void) {
         struct timespec ts;
         clock_gettime(CLOCK_MONOTONIC, &ts);
         return ts.tv_sec * 1000000000LL + ts.tv_nsec;
     }
 
+    long long do_get_time(void) {
+        if(warp) return warp_now.load(std::memory_order_relaxed);
+        return real_time();
+    }
+
     void do_delay(long ns);
 };
 
@@ -890,6 +1156,7 @@ int RtapiApp::task_new(void (*taskcode) (void*), void *arg,
   task->stacksize = stacksize;
   task->taskcode = taskcode;
   task->prio = prio;
+  task->cpu = -1;
   task->magic = TASK_MAGIC;
   task_array[n] = task;
 
@@ -908,6 +1175,49 @@ rtapi_task *RtapiApp::get_task(int task_id) {
     return task;
 }
 
+int RtapiApp::task_set_cpu(int task_id, int cpu) {
+    rtapi_task *task = get_task(task_id);
+    if(!task) return -EINVAL;
+    if(cpu >= CPU_SETSIZE) return -EINVAL;
+    task->cpu = cpu < 0 ? -1 : cpu;
+    return 0;
+}
+
+/* The highest numbered CPU in /sys/devices/system/cpu/isolated, which
+   holds a list like "2-3,5", or -1 if no CPUs are isolated */
+static int isolated_cpu() {
+    FILE *f = fopen("/sys/devices/system/cpu/isolated", "r");
+    if(!f) return -1;
+    char buf[1024];
+    int result = -1;
+    if(fgets(buf, sizeof(buf), f)) {
+        for(char *s = strtok(buf, ",-\n"); s; s = strtok(NULL, ",-\n")) {
+            int cpu = atoi(s);
+            if(cpu > result) result = cpu;
+        }
+    }
+    fclose(f);
+    return result;
+}
+
+/* The CPU a task runs on: the one set with rtapi_task_set_cpu, else the
+   last isolated CPU, else the last CPU.  -1 on a single processor
+   system, where the task is not pinned at all.  With a NULL task, the
+   CPU tasks run on by default. */
+int RtapiApp::task_cpu(const rtapi_task *task) {
+    if(task && task->cpu >= 0) return task->cpu;
+    static int cpu = -2;
+    if(cpu == -2) {
+        int nprocs = sysconf( _SC_NPROCESSORS_ONLN );
+        cpu = isolated_cpu();
+        if(cpu < 0 && nprocs > 1)
+            cpu = nprocs-1; // assumes processor numbers are contiguous
+        if(cpu >= CPU_SETSIZE) cpu = -1;
+        rtapi_print_msg(RTAPI_MSG_INFO, "rtapi: realtime tasks run on cpu %d\n", cpu);
+    }
+    return cpu;
+}
+
 void RtapiApp::unexpected_realtime_delay(rtapi_task *task, int nperiod) {
     static int printed = 0;
     if(!printed)
@@ -949,8 +1259,8 @@ int Posix::task_start(int task_id, unsigned long int period_nsec)
 
   cpu_set_t cpuset;
   CPU_ZERO(&cpuset);
-  int nprocs = sysconf( _SC_NPROCESSORS_ONLN );
-  CPU_SET(nprocs-1, &cpuset); // assumes processor numbers are contiguous
+  int cpu = task_cpu(task);
+  if(cpu >= 0) CPU_SET(cpu, &cpuset);
 
   pthread_attr_t attr;
   if(pthread_attr_init(&attr) < 0)
@@ -963,11 +1273,11 @@ int Posix::task_start(int task_id, unsigned long int period_nsec)
       return -errno;
   if(pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED) < 0)
       return -errno;
-  if(nprocs > 1)
+  if(cpu >= 0)
       if(pthread_attr_setaffinity_np(&attr, sizeof(cpuset), &cpuset) < 0)
           return -errno;
-  if(pthread_create(&task->thr, &attr, &wrapper, reinterpret_cast<void*>(task)) < 0)
-      return -errno;
+  if(int err = pthread_create(&task->thr, &attr, &wrapper, reinterpret_cast<void*>(task)))
+      return -err;
 
   return 0;
 }
@@ -996,9 +1306,13 @@ void *Posix::wrapper(void *arg)
   if(papp.do_thread_lock)
       pthread_mutex_lock(&papp.thread_lock);
 
-  struct timespec now;
-  clock_gettime(RTAPI_CLOCK, &now);
-  rtapi_timespec_advance(task->nextstart, now, task->period);
+  // start periods on multiples of the period, so tasks with the same
+  // period wake together (as the workers of a HAL thread need), and
+  // the periods of faster tasks start with those of slower ones
+  long long ns = papp.do_get_time();
+  ns += 2 * task->period - ns % task->period;
+  task->nextstart.tv_sec = ns / 1000000000;
+  task->nextstart.tv_nsec = ns % 1000000000;
 
   /* call the task function with the task argument */
   (task->taskcode) (task->arg);
@@ -1021,7 +1335,87 @@ int Posix::task_self() {
     return task->id;
 }
 
+int Posix::task_set_spin(int task_id, long spin_nsec) {
+    auto task = ::rtapi_get_task<PosixTask>(task_id);
+    if(!task) return -EINVAL;
+    if(spin_nsec < 0 || spin_nsec >= 1000000000) return -EINVAL;
+    task->spin = spin_nsec;
+    return 0;
+}
+
+void Posix::init_time_warp() {
+    const char *env = getenv("RTAPI_TIME_WARP");
+    warp = env != nullptr;
+    warp_speed = env ? atof(env) : 0;
+    warp_real_start = warp_sim_start = real_time();
+    warp_now = warp_sim_start;
+    if(!warp) return;
+    // the tasks take turns under thread_lock
+    if(!do_thread_lock) {
+        do_thread_lock = true;
+        pthread_mutex_init(&thread_lock, 0);
+    }
+    pthread_cond_init(&warp_cond, 0);
+    if(warp_speed > 0)
+        rtapi_print_msg(RTAPI_MSG_ERR,
+            "Note: time warp, at most %g times real time\n", warp_speed);
+    else
+        rtapi_print_msg(RTAPI_MSG_ERR, "Note: time warp, no speed limit\n");
+}
+
+// The waiting task with the earliest deadline, the higher priority one
+// of those with the same deadline
+PosixTask *Posix::warp_next() {
+    PosixTask *next = nullptr;
+    for(int i = 0; i < MAX_TASKS; i++) {
+        auto task = ::rtapi_get_task<PosixTask>(i);
+        if(!task || !task->warp_waiting) continue;
+        if(!next || rtapi_timespec_less(task->nextstart, next->nextstart)
+                || (!rtapi_timespec_less(next->nextstart, task->nextstart)
+                    && task->prio > next->prio))
+            next = task;
+    }
+    return next;
+}
+
+void Posix::warp_cancelled(void *arg) {
+    auto task = reinterpret_cast<PosixTask*>(arg);
+    Posix &papp = reinterpret_cast<Posix&>(App());
+    task->warp_waiting = false;
+    pthread_cond_broadcast(&papp.warp_cond);
+    pthread_mutex_unlock(&papp.thread_lock);
+}
+
+// Called with thread_lock held, and returns with it held when the task
+// is the next to run.  A task deleted meanwhile is cancelled in
+// pthread_cond_wait or the sleep, both with thread_lock held again.
+void Posix::warp_wait(PosixTask *task) {
+    rtapi_timespec_advance(task->nextstart, task->nextstart, task->period);
+    task->warp_waiting = true;
+    pthread_cleanup_push(warp_cancelled, task);
+    pthread_cond_broadcast(&warp_cond);
+    while(warp_next() != task)
+        pthread_cond_wait(&warp_cond, &thread_lock);
+    task->warp_waiting = false;
+
+    long long deadline = task->nextstart.tv_sec * 1000000000LL
+        + task->nextstart.tv_nsec;
+    if(deadline > warp_now) warp_now = deadline;
+    if(warp_speed > 0) {
+        long long due = warp_real_start
+            + llround((warp_now - warp_sim_start) / warp_speed);
+        struct timespec ts = { time_t(due / 1000000000), long(due % 1000000000) };
+        if(due > real_time())
+            rtapi_clock_nanosleep(RTAPI_CLOCK, TIMER_ABSTIME, &ts, nullptr, nullptr);
+    }
+    pthread_cleanup_pop(0);
+}
+
 void Posix::wait() {
+    if(warp) {
+        warp_wait(reinterpret_cast<PosixTask*>(pthread_getspecific(key)));
+        return;
+    }
     if(do_thread_lock)
         pthread_mutex_unlock(&thread_lock);
     pthread_testcancel();
@@ -1034,6 +1428,23 @@ void Posix::wait() {
         if(policy == SCHED_FIFO)
             unexpected_realtime_delay(task);
     }
+    else if(task->spin)
+    {
+        // sleep until 'spin' before the deadline, then poll the clock
+        struct timespec wake = task->nextstart;
+        wake.tv_nsec -= task->spin;
+        if(wake.tv_nsec < 0) {
+            wake.tv_sec--;
+            wake.tv_nsec += 1000000000;
+        }
+        if(rtapi_timespec_less(now, wake)) {
+            int res = rtapi_clock_nanosleep(RTAPI_CLOCK, TIMER_ABSTIME, &wake, nullptr, &now);
+            if(res < 0) perror("clock_nanosleep");
+        }
+        do {
+            clock_gettime(RTAPI_CLOCK, &now);
+        } while(rtapi_timespec_less(now, task->nextstart));
+    }
     else
     {
         int res = rtapi_clock_nanosleep(RTAPI_CLOCK, TIMER_ABSTIME, &task->nextstart, nullptr, &now);
@@ -1109,6 +1520,21 @@ int rtapi_task_delete(int id) {
     return App().task_delete(id);
 }
 
+int rtapi_task_set_cpu(int task_id, int cpu)
+{
+    return App().task_set_cpu(task_id, cpu);
+}
+
+int rtapi_task_set_spin(int task_id, long spin_nsec)
+{
+    return App().task_set_spin(task_id, spin_nsec);
+}
+
+int rtapi_cpu_self(void)
+{
+    return sched_getcpu();
+}
+
 int rtapi_task_start(int task_id, unsigned long period_nsec)
 {
     return App().task_start(task_id, period_nsec);
@@ -1164,9 +1590,15 @@ long long rtapi_get_time() {
 void default_rtapi_msg_handler(msg_level_t level, const char *fmt, va_list ap) {
     if(main_thread && pthread_self() != main_thread) {
         message_t m;
+        va_list args;
         m.level = level;
-        vsnprintf(m.msg, sizeof(m.msg), fmt, ap);
-        rtapi_msg_queue.push(m);
+        va_copy(args, ap);
+        if(!capture_message(m, fmt, args)) {
+            m.fmt = nullptr;
+            vsnprintf(m.text, sizeof(m.text), fmt, ap);
+        }
+        va_end(args);
+        if(!rtapi_msg_queue->bounded_push(m)) rtapi_msg_dropped++;
     } else {
         vfprintf(level == RTAPI_MSG_ALL ? stdout : stderr, fmt, ap);
     }
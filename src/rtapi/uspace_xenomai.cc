@@ -48,8 +48,8 @@ struct XenomaiApp : RtapiApp {
 
         cpu_set_t cpuset;
         CPU_ZERO(&cpuset);
-        int nprocs = sysconf( _SC_NPROCESSORS_ONLN );
-        CPU_SET(nprocs-1, &cpuset); // assumes processor numbers are contiguous
+        int cpu = task_cpu(task);
+        if(cpu >= 0) CPU_SET(cpu, &cpuset);
 
         pthread_attr_t attr;
         if(pthread_attr_init(&attr) < 0)
@@ -62,11 +62,11 @@ struct XenomaiApp : RtapiApp {
             return -errno;
         if(pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED) < 0)
             return -errno;
-        if(nprocs > 1)
+        if(cpu >= 0)
             if(pthread_attr_setaffinity_np(&attr, sizeof(cpuset), &cpuset) < 0)
                 return -errno;
-        if(pthread_create(&task->thr, &attr, &wrapper, reinterpret_cast<void*>(task)) < 0)
-            return -errno;
+        if(int err = pthread_create(&task->thr, &attr, &wrapper, reinterpret_cast<void*>(task)))
+            return -err;
 
         return 0;
     }
@@ -431,19 +431,33 @@ set ::watching 0
 proc watchLoop {} {
     set ::watching 1
     set which $::watchstring
+    # pins and parameters are read with one 'watch', from the halwatch
+    # service when it is loaded; a signal may share its name with a pin
+    set names {}
     foreach var $which {
         scan $var {%i %s %s} cnum vartype varname
         if {$vartype == "sig" } {
-            set ret [hal gets $varname]
+            set ret($cnum) [hal gets $varname]
         } else {
-            set ret [hal getp $varname]
+            lappend names $varname
         }
-        if {$ret == "TRUE"} {
+    }
+    if {$names != {}} {
+        set values [split [eval hal watch $names] "\n"]
+    }
+    set i 0
+    foreach var $which {
+        scan $var {%i %s %s} cnum vartype varname
+        if {$vartype != "sig" } {
+            set ret($cnum) [lindex [lindex $values $i] 0]
+            incr i
+        }
+        if {$ret($cnum) == "TRUE"} {
             $::cisp itemconfigure oval$cnum -fill yellow
-        } elseif {$ret == "FALSE"} {
+        } elseif {$ret($cnum) == "FALSE"} {
             $::cisp itemconfigure oval$cnum -fill firebrick4
         } else {
-            set value [expr $ret]
+            set value [expr $ret($cnum)]
             $::cisp itemconfigure text$cnum -text $value
         }
     }
@@ -456,6 +470,7 @@ proc watchLoop {} {
 
 proc watchReset {del} {
     $::cisp delete all
+    hal unwatch
     switch -- $del {
         all {
             watchHAL zzz
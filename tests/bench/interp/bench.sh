@@ -0,0 +1,70 @@
+#!/bin/bash
+set -e -o pipefail
+
+TMPDIR=`mktemp -d /tmp/interpbench.XXXXXX`
+trap "rm -rf $TMPDIR" 0 1 2 3 9 15
+cd $TMPDIR
+
+# a raster of 1M short moves with the Z of a surface
+awk 'BEGIN {
+    print "G21 G90 G64 P0.01 F2000"
+    for (n = 0; n < 1000000; n++) {
+        row = int(n / 1000); col = n % 1000
+        x = (row % 2 ? 999 - col : col) * .1
+        y = row * .1
+        printf "G1 X%.3f Y%.3f Z%.4f\n", x, y, sin(x / 10) * cos(y / 10)
+    }
+    print "M2"
+}' > surfacing.ngc
+
+# rings of a cone, a point per degree, from subroutine calls in a loop
+cat > parametric.ngc <<'EOT'
+o<ring> sub
+    #<a> = 0
+    o101 while [#<a> LT 360]
+        G1 X[#1 * COS[#<a>]] Y[#1 * SIN[#<a>]] Z[#2]
+        #<a> = [#<a> + 1]
+    o101 endwhile
+o<ring> endsub
+G21 G90 G64 P0.01 F2000
+#<r> = 1
+o100 while [#<r> LE 300]
+    o102 if [[#<r> MOD 2] EQ 0]
+        o<ring> call [#<r> / 10] [-#<r> / 100]
+    o102 else
+        o<ring> call [#<r> / 10 + 0.05] [-#<r> / 100]
+    o102 endif
+    #<r> = [#<r> + 1]
+o100 endwhile
+M2
+EOT
+
+# every move through a remapped G code with an NGC body
+cat > remap.ini <<'EOT'
+[RS274NGC]
+SUBROUTINE_PATH = .
+REMAP=G88.1 modalgroup=1 argspec=XYZ ngc=rg881
+EOT
+cat > rg881.ngc <<'EOT'
+o<rg881> sub
+G1 X#<x> Y#<y> Z#<z>
+o<rg881> endsub
+M2
+EOT
+awk 'BEGIN {
+    print "G21 G90 F2000"
+    for (n = 0; n < 100000; n++)
+        printf "G88.1 X%.3f Y%.3f Z%.4f\n", (n % 1000) * .1,
+            int(n / 1000) * .1, -(n % 7) * .01
+    print "M2"
+}' > remap.ngc
+
+for prog in surfacing parametric remap; do
+    ini=""
+    if [ -f $prog.ini ]; then ini="-i $prog.ini"; fi
+    rs274 -g -r $ini $prog.ngc /dev/null 2> $prog.err
+    awk -v prog=$prog '$1 == "rate:" {
+        printf "%s.ns-per-block %.0f\n", prog, $8 * 1e9 / $2
+        printf "%s.ns-per-call %.0f\n", prog, $8 * 1e9 / $4
+        printf "%s.peak-rss-kB %d\n", prog, $16 }' $prog.err
+done
@@ -0,0 +1,9 @@
+#!/bin/bash
+set -o pipefail
+realtime start
+kinsbench -n 5000 \
+    | awk 'NF == 12 && $1 != "module" { print $1 ".forward", $2;
+        print $1 ".inverse", $6 }'
+result=$?
+realtime stop
+exit $result
@@ -0,0 +1,35 @@
+#!/bin/bash
+set -e -o pipefail
+
+TMPDIR=`mktemp -d /tmp/tpbench.XXXXXX`
+trap "rm -rf $TMPDIR" 0 1 2 3 9 15
+
+awk 'BEGIN {
+    print "SET_NUM_JOINTS 3"
+    print "SET_VEL vel=1.000000, ini_maxvel=2.000000"
+    print "SET_VEL_LIMIT vel=2.000000"
+    print "SET_ACC acc=20.000000"
+    print "SETUP_ARC_BLENDS"
+    print "SETUP_PLANNER type=0, max_jerk=0.000000"
+    print "SET_MAX_FEED_OVERRIDE 1.000000"
+    for (axis = 0; axis < 3; axis++) {
+        printf "SET_AXIS_VEL_LIMIT axis=%d vel=2.000000\n", axis
+        printf "SET_AXIS_ACC_LIMIT axis=%d, acc=20.000000\n", axis
+    }
+    print "SET_TERM_COND termCond=2, tolerance=0.001000"
+    # 20 rows of 100 moves, each row back the other way
+    for (n = 0; n < 2000; n++) {
+        row = int(n / 100); col = n % 100
+        x = (row % 2 ? 99 - col : col + 1) * .01
+        y = row * .05
+        z = -.1 + .02 * sin(x * 20) * cos(y * 10)
+        printf "SET_LINE x=%f, y=%f, z=%f, a=0.000000, b=0.000000, " \
+            "c=0.000000, u=0.000000, v=0.000000, w=0.000000, id=%d, " \
+            "motion_type=2, vel=1.000000, ini_maxvel=2.000000, " \
+            "acc=20.000000, turn=-1\n", x, y, z, n + 1
+    }
+}' > $TMPDIR/raster.log
+
+tpreplay -p 1000000 $TMPDIR/raster.log \
+    | awk '/^cycle time/ { print "tp.avg", $5; print "tp.p50", $7;
+        print "tp.p90", $9 }'
@@ -0,0 +1,31 @@
+#!/bin/sh
+python <<EOF2
+import gcode, threading
+from rs274.batch import check_files, CheckCanon
+
+def write(name, text):
+    f = open(name, "w")
+    f.write(text)
+    f.close()
+
+write("good.ngc", "G20 F10\nG0 X1\nG1 X2\nG1 Y1\nG2 X3 Y2 I1 J0\nM2\n")
+write("bad.ngc", "G20 F10\nG1 X1\nG99999\nM2\n")
+names = ["good.ngc", "bad.ngc"] * 4
+
+results = check_files(names, processes=2)
+print([r.filename for r in results] == names)
+good = results[0]
+print(good.ok(), good.result, good.lineno)
+print(good.max_extents)
+print([r.ok() for r in results[:2]], results[1].error is not None)
+
+def parse(canon, out):
+    out.append(gcode.parse("good.ngc", canon))
+canons = [CheckCanon() for i in range(4)]
+out = []
+threads = [threading.Thread(target=parse, args=(c, out)) for c in canons]
+for t in threads: t.start()
+for t in threads: t.join()
+print(out == [(1, 6)] * 4)
+print([c.native_geometry.count(gcode.FEED) for c in canons])
+EOF2
@@ -0,0 +1,19 @@
+#!/bin/sh
+python <<EOF2
+import gcode
+
+for text in ["a\nbb\n\nlast", "", "x\n"]:
+    open("test.ngc", "w").write(text)
+    ix = gcode.lineindex("test.ngc")
+    print(len(ix), ix.lines(1, 10), ix.lines(2, 2), ix.lines(5, 3),
+        [ix.offset(i) for i in range(1, len(ix) + 2)])
+
+open("test.ngc", "w").write("".join("G1 X%d\n" % i for i in range(200000)))
+ix = gcode.lineindex("test.ngc")
+print(len(ix), ix.lines(150000, 150001))
+open("test.ngc", "w").write("M2\n")
+try:
+    ix.lines(1, 1)
+except IOError as e:
+    print(e)
+EOF2
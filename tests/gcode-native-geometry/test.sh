@@ -0,0 +1,92 @@
+#!/bin/sh
+python <<EOF2
+import gcode, array
+from rs274.interpret import Translated, ArcsToSegmentsMixin
+
+class Canon(Translated, ArcsToSegmentsMixin):
+    parameter_file = ""
+    native_geometry = None
+    def __init__(self):
+        self.lo = (0,) * 9
+        self.first_move = True
+        self.suppress = 0
+        self.lineno = 0
+        self.segs = {gcode.TRAVERSE: [], gcode.FEED: [], gcode.ARCFEED: []}
+        self.set_xy_rotation(0)
+    def next_line(self, st):
+        self.lineno = st.sequence_number
+    def get_tool(self, pocket):
+        return -1, 0,0,0, 0,0,0, 0,0,0, 0,0,0, 0
+    def get_axis_mask(self): return 7
+    def get_external_angular_units(self): return 1.0
+    def get_external_length_units(self): return 0.03937007874015748
+    def get_block_delete(self): return 0
+    def check_abort(self): return False
+    def __getattr__(self, name):
+        if name.startswith('__'): raise AttributeError(name)
+        return lambda *args: None
+
+    def comment(self, arg):
+        if arg == "AXIS,hide": self.suppress += 1
+        if arg == "AXIS,show": self.suppress -= 1
+    def add(self, kind, l):
+        self.segs[kind].append((self.lineno, self.lo[:3], l[:3]))
+        self.lo = tuple(l)
+    def straight_traverse_translated(self, *l):
+        if self.suppress > 0: return
+        if self.first_move: self.lo = l
+        else: self.add(gcode.TRAVERSE, l)
+    def straight_feed_translated(self, *l):
+        if self.suppress > 0: return
+        self.first_move = False
+        self.add(gcode.FEED, l)
+    def arc_feed(self, *args):
+        if self.suppress > 0: return
+        self.first_move = False
+        ArcsToSegmentsMixin.arc_feed(self, *args)
+    def straight_arcsegments(self, segs):
+        for l in segs: self.add(gcode.ARCFEED, l)
+
+f = open("test.ngc", "w")
+f.write("""G20 G90 F10
+G0 X1 Y1 Z1
+G1 X2 Y1.5
+G2 X3 Y1.5 I0.5 J0
+G3 X2 Y1.5 R0.5
+(AXIS,hide)
+G1 X5 Y5
+(AXIS,show)
+G92 X0 Y0
+G18 G2 X1 Z0 I0.5 K-0.5
+G17 G10 L2 P1 X0.25 R30
+G0 X1 Y1
+G1 X0 Y2 Z-1
+M2
+""")
+f.close()
+
+python = Canon()
+print(gcode.parse("test.ngc", python))
+
+native = Canon()
+native.native_geometry = g = gcode.geometry()
+print(gcode.parse("test.ngc", native))
+print([len(native.segs[k]) for k in (gcode.TRAVERSE, gcode.FEED, gcode.ARCFEED)])
+
+def floats(seq): return array.array('f', seq)
+def data(kind, a): return array.array(kind, memoryview(a).tobytes())
+for k in (gcode.TRAVERSE, gcode.FEED, gcode.ARCFEED):
+    segs = python.segs[k]
+    print(k, g.count(k) == len(segs),
+        list(data('i', g.lines(k))) == [s[0] for s in segs],
+        data('f', g.vertices(k)) == floats(sum([tuple(s[1]) + tuple(s[2]) for s in segs], ())))
+print(len(g.colors(gcode.FEED)) == 2 * g.count(gcode.FEED))
+
+held = memoryview(g.vertices(gcode.FEED))
+try:
+    gcode.parse("test.ngc", native)
+except BufferError:
+    print("busy")
+del held
+print(gcode.parse("test.ngc", native))
+EOF2
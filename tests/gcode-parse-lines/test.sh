@@ -0,0 +1,68 @@
+#!/bin/sh
+python <<EOF2
+import gcode
+from rs274.interpret import Translated
+
+class Canon(Translated):
+    parameter_file = ""
+    native_geometry = None
+    def __init__(self):
+        self.lo = (0,) * 9
+        self.first_move = True
+        self.lineno = 0
+        self.feed = []
+        self.set_xy_rotation(0)
+    def next_line(self, st):
+        self.lineno = st.sequence_number
+    def get_tool(self, pocket):
+        return -1, 0,0,0, 0,0,0, 0,0,0, 0,0,0, 0
+    def get_axis_mask(self): return 7
+    def get_external_angular_units(self): return 1.0
+    def get_external_length_units(self): return 0.03937007874015748
+    def get_block_delete(self): return 0
+    def check_abort(self): return False
+    def __getattr__(self, name):
+        if name.startswith('__'): raise AttributeError(name)
+        return lambda *args: None
+
+    def straight_feed_translated(self, *l):
+        self.first_move = False
+        self.feed.append((self.lineno, self.lo[:3], l[:3]))
+        self.lo = tuple(l)
+    def checkpoint(self):
+        return len(self.feed), (tuple(self.lo), self.first_move)
+    def rewind(self, cp):
+        del self.feed[cp[0]:]
+        self.lo, self.first_move = cp[1]
+
+f = open("test.ngc", "w")
+f.write("\n".join(["G21 G90 F100"]
+    + ["G1 X%d Y%d" % (i, i % 7) for i in range(400)] + ["M2", ""]))
+f.close()
+
+gcode.set_checkpoint_interval(50)
+full = Canon()
+print(gcode.parse("test.ngc", full))
+
+whole = Canon()
+whole.native_geometry = gcode.geometry()
+print(gcode.parse("test.ngc", whole))
+
+streamed = Canon()
+streamed.native_geometry = g = gcode.geometry()
+g.set_window(0, -1)
+print(gcode.parse("test.ngc", streamed))
+print(g.count(gcode.FEED), g.extents() == whole.native_geometry.extents())
+
+def check(first, last):
+    print(gcode.parse_lines("test.ngc", streamed, first, last))
+    lines = [l[0] for l in streamed.feed]
+    print(min(lines) <= first, max(lines) == last,
+        streamed.feed == [l for l in full.feed
+            if min(lines) <= l[0] <= max(lines)])
+    del streamed.feed[:]
+
+streamed.native_geometry = None
+check(200, 250)
+check(320, 380)
+EOF2
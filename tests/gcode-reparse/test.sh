@@ -0,0 +1,59 @@
+#!/bin/sh
+python <<EOF2
+import gcode
+
+class Canon:
+    parameter_file = ""
+    def __init__(self):
+        self.out = []
+        self.lineno = 0
+        self.calls = 0
+    def next_line(self, st):
+        self.lineno = st.sequence_number
+    def get_tool(self, pocket):
+        return -1, 0,0,0, 0,0,0, 0,0,0, 0,0,0, 0
+    def get_axis_mask(self): return 7
+    def get_external_angular_units(self): return 1.0
+    def get_external_length_units(self): return 0.03937007874015748
+    def get_block_delete(self): return 0
+    def check_abort(self): return False
+    def __getattr__(self, name):
+        if name.startswith('__'): raise AttributeError(name)
+        def record(*args):
+            self.calls += 1
+            self.out.append((self.lineno, name) + args)
+        return record
+
+    def checkpoint(self): return len(self.out), None
+    def rewind(self, cp):
+        self.old = self.out[:]
+        del self.out[cp[0]:]
+    def converge(self, old, new, delta):
+        self.out.extend([(l[0] + delta,) + l[1:] for l in self.old[old[0]:]])
+    def relocate_checkpoint(self, cp, old, new):
+        return cp[0] - old[0] + new[0], cp[1]
+
+def write(lines):
+    f = open("test.ngc", "w")
+    f.write("\n".join(lines + ["M2", ""]))
+    f.close()
+
+lines = ["G21 G90 F100"] + ["G1 X%d Y%d" % (i, i % 7) for i in range(400)]
+write(lines)
+gcode.set_checkpoint_interval(50)
+canon = Canon()
+print(gcode.parse("test.ngc", canon))
+full_calls = canon.calls
+
+# change line 151 and insert a new line after it
+lines[150] = "G1 X150.5 Y3"
+lines.insert(151, "G1 X150.7 Y2")
+write(lines)
+canon.calls = 0
+print(gcode.reparse("test.ngc", canon, 151, 152, 1))
+print(canon.calls < full_calls / 2)
+
+fresh = Canon()
+print(gcode.parse("test.ngc", fresh))
+print(fresh.out == canon.out)
+EOF2
@@ -0,0 +1,6 @@
+#!/bin/bash
+# with option batch, a funct is exported for each function, not for
+# each instance
+rm -f batch_test.c
+halcompile --preprocess batch_test.comp || exit 1
+grep -o 'hal_export_funct([^,]*' batch_test.c
@@ -0,0 +1,6 @@
+#!/bin/bash
+# with option cache_pins, the exported function copies the pins in and
+# out around the FUNCTION body
+rm -f cache_pins.c
+halcompile --preprocess cache_pins.comp || exit 1
+sed -n '/^static void _(struct __comp_state \*__comp_inst, long period) {$/,/^}$/p' cache_pins.c
@@ -0,0 +1,20 @@
+#!/bin/sh
+realtime start
+python <<EOF2
+import hal
+a = hal.component("arena-a")
+b = hal.component("arena-b")
+a.newpin("x", hal.HAL_S32, hal.HAL_OUT)
+a.ready()
+b.newpin("x", hal.HAL_S32, hal.HAL_OUT)
+b.ready()
+a["x"] = 42
+b.exit()
+c = hal.component("arena-c")
+c.newpin("y", hal.HAL_S32, hal.HAL_OUT)
+c.ready()
+c["y"] = 7
+print "a.x", a["x"]
+print "c.y", c["y"]
+EOF2
+realtime stop
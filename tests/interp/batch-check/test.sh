@@ -0,0 +1,6 @@
+#!/bin/bash
+printf 'G21 F600\nG0 X10\nG1 X20\nG2 X30 Y0 I5 J0\nG4 P0.5\nM2\n' > good.ngc
+printf 'G21 F600\nG1 X1\nG99999\nM2\n' > bad.ngc
+rs274 -j 2 good.ngc bad.ngc good.ngc
+echo "exit $?"
+rm -f good.ngc bad.ngc
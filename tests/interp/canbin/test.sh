@@ -0,0 +1,4 @@
+#!/bin/bash
+rs274 -g -c test.canbin test.ngc > /dev/null || exit 1
+rs274 -p ../../../lib/libcanterp.so -g test.canbin | awk '{$1=""; print}'
+exit ${PIPESTATUS[0]}
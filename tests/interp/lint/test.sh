@@ -0,0 +1,3 @@
+#!/bin/bash
+rs274 -L -i lint.ini test.ngc | sed "s|$PWD/||"
+echo "exit ${PIPESTATUS[0]}"
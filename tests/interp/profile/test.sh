@@ -0,0 +1,9 @@
+#!/bin/bash
+P=$(mktemp)
+trap 'rm -f $P' EXIT
+rs274 -g -P $P test.ngc > /dev/null || exit 1
+awk -F'\t' '
+$1 == "section" { sections++ }
+$1 == "sub" { print "sub", $2, $3 }
+$1 == "line" && $3 == 2 { print "line 2 executed", ($4 >= 3 ? "at least 3" : $4), "times" }
+END { print sections, "sections" }' $P
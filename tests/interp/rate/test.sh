@@ -0,0 +1,6 @@
+#!/bin/bash
+# 15 blocks at least: 1 + 3 passes of 4 + the last while + M2
+rs274 -g -r test.ngc 2>&1 > /dev/null | awk '$1 == "rate:" {
+    print ($2 >= 15 ? "loop" : "no loop"), "blocks counted"
+    print ($4 > 0 ? "some" : "no"), "canon calls" }'
+exit ${PIPESTATUS[0]}
@@ -0,0 +1,5 @@
+#!/bin/bash
+printf 'T1 P1 D2\n' > test.tbl
+printf 'T1 M6\nG0 X0 Y5 Z1\nG1 Z-1 F100\nG1 X10\nG0 Z1\nG0 X5 Y8 Z-0.5\nM2\n' > test.ngc
+rs274 -g -t test.tbl -S 0,0,-2,10,10,0,0.05 test.ngc 2>&1 >/dev/null | grep '^stock:'
+rm -f test.tbl test.ngc
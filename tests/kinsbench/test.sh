@@ -0,0 +1,6 @@
+#!/bin/sh
+realtime start
+kinsbench -n 2000 -e 1e-3
+result=$?
+realtime stop
+exit $result
@@ -0,0 +1,62 @@
+#!/usr/bin/env python
+
+import linuxcnc
+
+import math
+import sys
+
+
+retval = 0
+
+
+c = linuxcnc.command()
+s = linuxcnc.stat()
+e = linuxcnc.error_channel()
+
+c.state(linuxcnc.STATE_ESTOP_RESET)
+c.state(linuxcnc.STATE_ON)
+c.mode(linuxcnc.MODE_MDI)
+
+s.poll()
+if s.mdi_batch_error != -1:
+    print "mdi_batch_error is %d at startup, should be -1" % s.mdi_batch_error
+    retval = 1
+
+# a batch that runs to the end
+serial = c.mdi_batch(['G90 G21', 'G0 X1 Y2', 'G0 Z-3'])
+done, error = c.wait_mdi_batch(serial)
+c.wait_complete()
+s.poll()
+print "batch 1: done=%d error=%d" % (done, error)
+
+if done != 3 or error != -1:
+    print "batch 1 should be done=3 error=-1"
+    retval = 1
+
+if s.mdi_batch != serial or s.mdi_batch_lines != 3:
+    print "status has batch %d with %d lines, should be %d with 3" % (s.mdi_batch, s.mdi_batch_lines, serial)
+    retval = 1
+
+for axis, want in enumerate((1, 2, -3)):
+    if math.fabs(s.position[axis] - want) > 0.000001:
+        print "axis %d is at %.6f, should be %.6f" % (axis, s.position[axis], want)
+        retval = 1
+
+# a batch whose second line fails: G1 with no feed rate
+serial = c.mdi_batch(['G0 X0', 'F0 G1 Y0', 'G0 Z0'])
+done, error = c.wait_mdi_batch(serial)
+c.wait_complete()
+s.poll()
+print "batch 2: done=%d error=%d" % (done, error)
+print e.poll()
+
+if done != 1 or error != 1:
+    print "batch 2 should be done=1 error=1"
+    retval = 1
+
+# the line after the error must not have run
+if math.fabs(s.position[2] + 3) > 0.000001:
+    print "Z is at %.6f, the batch went on after the error" % s.position[2]
+    retval = 1
+
+sys.exit(retval)
@@ -0,0 +1,5 @@
+#!/bin/bash -e
+
+rm -f out.capture out.motion-logger
+
+linuxcnc -r mountaindew.ini
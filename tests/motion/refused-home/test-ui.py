@@ -0,0 +1,97 @@
+#!/usr/bin/env python
+
+# Motion refuses HOME and UNHOME in world mode.  A refused command must
+# still finish its update of the motion status, or task can't read the
+# status any more and stops following what motion does.
+
+import linuxcnc
+import linuxcnc_util
+import time
+import sys
+
+
+def wait_for(what, test, timeout=5.0):
+    start_time = time.time()
+    while time.time() - start_time < timeout:
+        s.poll()
+        if test():
+            print "%s: ok" % what
+            sys.stdout.flush()
+            return
+        time.sleep(0.050)
+    print "timeout waiting for %s" % what
+    print "s.motion_mode:", s.motion_mode
+    print "s.homed:", s.homed
+    sys.exit(1)
+
+
+#
+# connect to LinuxCNC
+#
+
+c = linuxcnc.command()
+s = linuxcnc.stat()
+e = linuxcnc.error_channel()
+
+l = linuxcnc_util.LinuxCNC(command=c, status=s, error=e)
+
+c.state(linuxcnc.STATE_ESTOP_RESET)
+c.state(linuxcnc.STATE_ON)
+c.mode(linuxcnc.MODE_MANUAL)
+
+c.home(-1)
+c.wait_complete()
+l.wait_for_home([1, 1, 1, 0, 0, 0, 0, 0, 0])
+
+
+#
+# world mode, where motion refuses to home or unhome
+#
+
+c.teleop_enable(1)
+c.wait_complete()
+wait_for("world mode", lambda: s.motion_mode == linuxcnc.TRAJ_MODE_TELEOP)
+
+for i in range(3):
+    c.home(0)
+    c.wait_complete()
+    c.unhome(0)
+    c.wait_complete()
+    c.unhome(-1)
+    c.wait_complete()
+
+# the refusals are reported, and nothing was unhomed
+time.sleep(0.5)
+s.poll()
+if s.homed[:3] != (1, 1, 1):
+    print "a refused unhome unhomed a joint: s.homed:", s.homed
+    sys.exit(1)
+errors = 0
+while True:
+    error = e.poll()
+    if not error:
+        break
+    print "error:", error[1]
+    errors += 1
+if errors == 0:
+    print "motion reported no errors for the refused commands"
+    sys.exit(1)
+
+
+#
+# the status still follows motion
+#
+
+c.teleop_enable(0)
+c.wait_complete()
+wait_for("joint mode", lambda: s.motion_mode == linuxcnc.TRAJ_MODE_FREE)
+
+c.unhome(1)
+c.wait_complete()
+wait_for("joint 1 unhomed", lambda: s.homed[:3] == (1, 0, 1))
+
+c.home(1)
+c.wait_complete()
+wait_for("joint 1 homed", lambda: s.homed[:3] == (1, 1, 1))
+
+sys.exit(0)